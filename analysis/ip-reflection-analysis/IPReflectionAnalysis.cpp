@@ -8,16 +8,24 @@
 #include "IPReflectionAnalysis.h"
 
 #include <fstream>
+#include <memory>
+#include <unordered_map>
 
 #include "AbstractDomain.h"
 #include "CallGraph.h"
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
 #include "MethodOverrideGraph.h"
+#include "PassManager.h"
 #include "PatriciaTreeMapAbstractEnvironment.h"
 #include "PatriciaTreeMapAbstractPartition.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "SpartaInterprocedural.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
 
 namespace {
 
@@ -129,11 +137,181 @@ struct Summary : public AbstractDomain<Summary> {
   reflection::ReflectionSites m_reflection_sites;
 };
 
+using CalleeReturns =
+    std::unordered_map<const IRInstruction*, reflection::AbstractObjectDomain>;
+
+// The outcome of the intraprocedural analysis of a method, along with its
+// inputs. The code doesn't change while the analysis runs, so the outcome
+// stays valid for as long as the calling context and the return values of the
+// callees are the same.
+struct CachedAnalysis {
+  reflection::CallingContext context;
+  CalleeReturns callee_returns;
+  reflection::AbstractObjectDomain return_value;
+  reflection::ReflectionSites reflection_sites;
+  reflection::CallingContextMap calling_contexts;
+};
+
 struct AnalysisParameters {
   // For speeding up reflection analysis
   reflection::MetadataCache refl_meta_cache;
+  // The methods worth analyzing, or none if all of them are. This is only
+  // read during the analysis.
+  boost::optional<std::unordered_set<const DexMethod*>> relevant_methods;
+  // The last analysis of each method, which later iterations reuse when its
+  // inputs haven't changed.
+  ConcurrentMap<const DexMethod*, std::shared_ptr<const CachedAnalysis>>
+      analysis_cache;
+
+  bool is_relevant(const DexMethod* method) const {
+    return !relevant_methods || relevant_methods->count(method) != 0;
+  }
 };
 
+// Whether a value of this type may hold an object tracked by the reflection
+// analysis, i.e., a string, a class, a field or a method, or an array of them.
+bool may_hold_reflection_object(const DexType* type) {
+  if (type::is_array(type)) {
+    type = type::get_array_element_type(type);
+  }
+  return type == type::java_lang_Object() || type == type::java_lang_String() ||
+         type == type::java_lang_Class() ||
+         boost::starts_with(type->get_name()->str(), "Ljava/lang/reflect/");
+}
+
+bool may_pass_reflection_object(const DexProto* proto) {
+  if (may_hold_reflection_object(proto->get_rtype())) {
+    return true;
+  }
+  for (const DexType* arg : proto->get_args()->get_type_list()) {
+    if (may_hold_reflection_object(arg)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Finds the methods whose analysis may yield reflection sites, or whose
+ * summaries and calling contexts may matter to such methods. A method is
+ * relevant if its code creates strings or classes, calls into the reflection
+ * API, reads a class-typed field or may return one of its arguments, or if it
+ * may exchange such objects with a relevant callee. Calls that are not
+ * statically bound are conservatively deemed to exchange objects with a
+ * relevant callee whenever their signature allows it. All other methods are
+ * skipped, which is what keeps the analysis of large apps within memory.
+ */
+std::unordered_set<const DexMethod*> find_relevant_methods(
+    const Scope& scope) {
+  ConcurrentSet<const DexMethod*> relevant;
+  // The statically bound callees a method exchanges objects with.
+  ConcurrentMap<const DexMethod*, std::vector<const DexMethod*>> dependencies;
+  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
+    const DexProto* proto = method->get_proto();
+    bool is_relevant = may_hold_reflection_object(proto->get_rtype()) &&
+                       may_pass_reflection_object(proto);
+    std::vector<const DexMethod*> callees;
+    for (const auto& mie : InstructionIterable(code)) {
+      if (is_relevant) {
+        break;
+      }
+      const IRInstruction* insn = mie.insn;
+      switch (insn->opcode()) {
+      case OPCODE_CONST_STRING:
+      case OPCODE_CONST_CLASS:
+        is_relevant = true;
+        break;
+      case OPCODE_NEW_ARRAY:
+      case OPCODE_FILLED_NEW_ARRAY:
+        is_relevant = may_hold_reflection_object(insn->get_type());
+        break;
+      case OPCODE_IGET_OBJECT:
+      case OPCODE_SGET_OBJECT:
+        is_relevant = insn->get_field()->get_type() == type::java_lang_Class();
+        break;
+      case OPCODE_INVOKE_VIRTUAL:
+      case OPCODE_INVOKE_SUPER:
+      case OPCODE_INVOKE_INTERFACE:
+      case OPCODE_INVOKE_DIRECT:
+      case OPCODE_INVOKE_STATIC: {
+        DexMethodRef* callee_ref = insn->get_method();
+        const DexType* owner = callee_ref->get_class();
+        if (owner == type::java_lang_Class() ||
+            boost::starts_with(owner->get_name()->str(),
+                               "Ljava/lang/reflect/") ||
+            callee_ref->get_name()->str() == "getClass") {
+          is_relevant = true;
+          break;
+        }
+        if (!may_pass_reflection_object(callee_ref->get_proto())) {
+          break;
+        }
+        if (insn->opcode() != OPCODE_INVOKE_STATIC &&
+            insn->opcode() != OPCODE_INVOKE_DIRECT) {
+          is_relevant = true;
+          break;
+        }
+        const DexMethod* callee =
+            resolve_method(callee_ref, opcode_to_search(insn), method);
+        if (callee != nullptr && callee->get_code() != nullptr) {
+          callees.push_back(callee);
+        }
+        break;
+      }
+      default:
+        break;
+      }
+    }
+    if (is_relevant) {
+      relevant.insert(method);
+    } else if (!callees.empty()) {
+      dependencies.emplace(method, std::move(callees));
+    }
+  });
+
+  // Relevance flows from callees to their callers.
+  std::unordered_map<const DexMethod*, std::vector<const DexMethod*>> callers;
+  for (const auto& entry : dependencies) {
+    for (const DexMethod* callee : entry.second) {
+      callers[callee].push_back(entry.first);
+    }
+  }
+  std::unordered_set<const DexMethod*> result(relevant.begin(),
+                                              relevant.end());
+  std::vector<const DexMethod*> worklist(result.begin(), result.end());
+  while (!worklist.empty()) {
+    const DexMethod* method = worklist.back();
+    worklist.pop_back();
+    auto it = callers.find(method);
+    if (it == callers.end()) {
+      continue;
+    }
+    for (const DexMethod* caller : it->second) {
+      if (result.insert(caller).second) {
+        worklist.push_back(caller);
+      }
+    }
+  }
+  return result;
+}
+
+// Only objects the callee can make sense of are passed in calling contexts:
+// integers and locally allocated arrays are dropped, which keeps contexts to
+// the values that may end up in reflection sites. A dropped argument is
+// treated by the callee like any argument of unknown value.
+reflection::CallingContext bound_calling_context(
+    const reflection::CallingContext& context) {
+  reflection::CallingContext bounded;
+  for (const auto& entry : context.bindings()) {
+    auto aobj = entry.second.get_object();
+    if (aobj && aobj->obj_kind != reflection::INT &&
+        !(aobj->obj_kind == reflection::OBJECT && aobj->heap_address)) {
+      bounded.set(entry.first, entry.second);
+    }
+  }
+  return bounded;
+}
+
 using CallerContext = typename Caller::Domain;
 
 template <typename Base>
@@ -142,52 +320,87 @@ class ReflectionAnalyzer : public Base {
   const DexMethod* m_method;
   Summary m_summary;
 
+  reflection::AbstractObjectDomain query_callee_returns(
+      const IRInstruction* insn) {
+    auto callees = call_graph::resolve_callees_in_graph(
+        *this->get_call_graph(), m_method, insn);
+
+    reflection::AbstractObjectDomain ret =
+        reflection::AbstractObjectDomain::bottom();
+    for (const DexMethod* method : callees) {
+      auto domain =
+          this->get_summaries()->get(method, Summary::top()).get_return_value();
+      ret.join_with(domain);
+    }
+    return ret;
+  }
+
  public:
   explicit ReflectionAnalyzer(const DexMethod* method) : m_method(method) {}
 
   void analyze() override {
-    if (!m_method) {
+    if (!m_method || !this->get_analysis_parameters()->is_relevant(m_method)) {
       return;
     }
 
-    reflection::SummaryQueryFn query_fn =
-        [&](const IRInstruction* insn) -> reflection::AbstractObjectDomain {
-      auto callees = call_graph::resolve_callees_in_graph(
-          *this->get_call_graph(), m_method, insn);
-
-      reflection::AbstractObjectDomain ret =
-          reflection::AbstractObjectDomain::bottom();
-      for (const DexMethod* method : callees) {
-        auto domain = this->get_summaries()
-                          ->get(method, Summary::top())
-                          .get_return_value();
-        ret.join_with(domain);
+    // The callee summaries are queried once up front, so that the analysis
+    // of the method only depends on its calling context and on these values.
+    CalleeReturns callee_returns;
+    if (const IRCode* code = m_method->get_code()) {
+      for (const auto& mie : InstructionIterable(code)) {
+        const IRInstruction* insn = mie.insn;
+        if (opcode::is_an_invoke(insn->opcode())) {
+          callee_returns.emplace(insn, query_callee_returns(insn));
+        }
       }
-      return ret;
-    };
+    }
 
     auto context = this->get_caller_context()->get(m_method);
-    reflection::ReflectionAnalysis analysis(
-        const_cast<DexMethod*>(m_method),
-        &context,
-        &query_fn,
-        &this->get_analysis_parameters()->refl_meta_cache);
+    auto& cache = this->get_analysis_parameters()->analysis_cache;
+    auto cached = cache.get(m_method, nullptr);
+    if (!cached || !cached->context.equals(context) ||
+        cached->callee_returns != callee_returns) {
+      reflection::SummaryQueryFn query_fn =
+          [&](const IRInstruction* insn) -> reflection::AbstractObjectDomain {
+        return callee_returns.at(insn);
+      };
+      reflection::ReflectionAnalysis analysis(
+          const_cast<DexMethod*>(m_method),
+          &context,
+          &query_fn,
+          &this->get_analysis_parameters()->refl_meta_cache);
+
+      auto entry = std::make_shared<CachedAnalysis>();
+      entry->context = std::move(context);
+      entry->callee_returns = std::move(callee_returns);
+      entry->return_value = analysis.get_return_value();
+      entry->reflection_sites = analysis.get_reflection_sites();
+      entry->calling_contexts = analysis.get_calling_context_partition();
+      cache.insert_or_assign(std::make_pair(m_method, entry));
+      cached = std::move(entry);
+    }
 
-    m_summary.set_value(analysis.get_return_value());
-    m_summary.set_reflection_sites(analysis.get_reflection_sites());
+    m_summary.set_value(cached->return_value);
+    m_summary.set_reflection_sites(cached->reflection_sites);
 
-    auto partition = analysis.get_calling_context_partition();
+    const auto& partition = cached->calling_contexts;
     if (!partition.is_top() && !partition.is_bottom()) {
       for (const auto& entry : partition.bindings()) {
         auto insn = entry.first;
-        auto calling_context = entry.second;
+        auto calling_context = bound_calling_context(entry.second);
         auto op = insn->opcode();
         always_assert(opcode::is_an_invoke(op));
+        if (calling_context.is_bottom()) {
+          continue;
+        }
 
         auto callees = call_graph::resolve_callees_in_graph(
             *this->get_call_graph(), m_method, insn);
 
         for (const DexMethod* method : callees) {
+          if (!this->get_analysis_parameters()->is_relevant(method)) {
+            continue;
+          }
           this->get_caller_context()->update(
               method, [&](const reflection::CallingContext& original_context) {
                 return calling_context.join(original_context);
@@ -198,7 +411,7 @@ class ReflectionAnalyzer : public Base {
   }
 
   void summarize() override {
-    if (!m_method) {
+    if (!m_method || !this->get_analysis_parameters()->is_relevant(m_method)) {
       return;
     }
     this->get_summaries()->maybe_update(m_method, [&](Summary& old) {
@@ -233,10 +446,14 @@ using Analysis =
 
 void IPReflectionAnalysisPass::run_pass(DexStoresVector& stores,
                                         ConfigFiles& conf,
-                                        PassManager& /* pm */) {
+                                        PassManager& pm) {
 
   Scope scope = build_class_scope(stores);
   AnalysisParameters param;
+  if (m_prune_methods) {
+    param.relevant_methods = find_relevant_methods(scope);
+    pm.set_metric("relevant_methods", param.relevant_methods->size());
+  }
   auto analysis = Analysis(scope, m_max_iteration, &param);
   analysis.run();
   auto summaries = analysis.registry.get_map();
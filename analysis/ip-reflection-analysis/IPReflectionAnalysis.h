@@ -20,6 +20,10 @@ class IPReflectionAnalysisPass : public Pass {
     bind("export_results", false, m_export_results,
          "Generate redex-reflection-analysis.txt file containing the analysis "
          "results.");
+    bind("prune_methods", true, m_prune_methods,
+         "Only analyze the methods that may produce or pass around reflection "
+         "objects, as found by a scan of their instructions. The other "
+         "methods get no reflection sites.");
   }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
@@ -33,5 +37,6 @@ class IPReflectionAnalysisPass : public Pass {
  private:
   unsigned m_max_iteration;
   bool m_export_results;
+  bool m_prune_methods;
   std::shared_ptr<Result> m_result;
 };
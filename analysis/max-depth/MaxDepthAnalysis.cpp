@@ -7,198 +7,256 @@
 
 #include "MaxDepthAnalysis.h"
 
-#include "AbstractDomain.h"
-#include "ConstantAbstractDomain.h"
-#include "ControlFlow.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <numeric>
+
 #include "DexClass.h"
-#include "HashedSetAbstractDomain.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
-#include "PatriciaTreeMapAbstractEnvironment.h"
-#include "SpartaInterprocedural.h"
+#include "Resolver.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
-using namespace sparta;
-using namespace sparta_interprocedural;
-
 // Description for the analysis
 
-// - We initialize the max depth of each method to Top, which means unknown or
-//   potentially infinite depth of calls.
-// - Every step will progressively reduce the depth by considering the cases
-//   where the depth is known and is not Top.
-// - The steps are iterated until a global fixpoint for the summaries is found.
-
-// Define an abstract domain as a summary for a method. The summary should
-// contain what properties we are interested in knowing such a method.
-struct DepthDomain : public AbstractDomain<DepthDomain> {
-  explicit DepthDomain() : m_depth(0), m_kind(sparta::AbstractValueKind::Top) {}
-
-  explicit DepthDomain(unsigned i)
-      : m_depth(i), m_kind(sparta::AbstractValueKind::Value) {}
-
-  bool is_bottom() const override {
-    return m_kind == sparta::AbstractValueKind::Bottom;
-  }
-
-  bool is_value() const { return m_kind == sparta::AbstractValueKind::Value; }
+// - The call graph is given by the resolved callee of each invoke.
+// - Its strongly connected components are condensed into a DAG. A component
+//   with more than one method, or whose method calls itself, has an unknown
+//   (potentially infinite) depth, and so has every method calling into it.
+// - The components are then processed bottom-up, level by level: all the
+//   components whose callees are done are processed in parallel.
+
+constexpr int kUnknownDepth = -1;
+
+struct MethodCalls {
+  // Indices of the methods in scope that are called, sorted and unique.
+  std::vector<uint32_t> callees;
+  // Whether one of the calls could not be resolved, which counts as a call to
+  // a method of depth 0.
+  bool has_unresolved_call{false};
+  // Whether one of the calls is to a method whose depth we can't know, like an
+  // external method.
+  bool has_unknown_call{false};
+};
 
-  bool is_top() const override {
-    return m_kind == sparta::AbstractValueKind::Top;
+MethodCalls gather_calls(
+    const DexMethod* method,
+    const std::unordered_map<const DexMethod*, uint32_t>& method_indices) {
+  MethodCalls calls;
+  auto code = method->get_code();
+  if (!code) {
+    return calls;
   }
-
-  bool leq(const DepthDomain& other) const override {
-    if (is_bottom()) {
-      return true;
-    } else if (m_kind == sparta::AbstractValueKind::Value) {
-      return m_depth <= other.m_depth;
-    } else {
-      return other.is_top();
+  for (auto& mie : InstructionIterable(code)) {
+    always_assert_log(mie.insn,
+                      "IR is malformed, MIE holding an nullptr instruction.");
+    IRInstruction* insn = mie.insn;
+    if (!opcode::is_an_invoke(insn->opcode())) {
+      continue;
     }
-  }
-
-  bool equals(const DepthDomain& other) const override {
-    if (m_kind != other.m_kind) {
-      return false;
+    auto callee =
+        resolve_method(insn->get_method(), opcode_to_search(insn), method);
+    if (!callee) {
+      calls.has_unresolved_call = true;
+      continue;
+    }
+    auto it = method_indices.find(callee);
+    if (it == method_indices.end()) {
+      calls.has_unknown_call = true;
     } else {
-      return (m_kind == sparta::AbstractValueKind::Value)
-                 ? m_depth == other.m_depth
-                 : true;
+      calls.callees.push_back(it->second);
     }
   }
+  std::sort(calls.callees.begin(), calls.callees.end());
+  calls.callees.erase(std::unique(calls.callees.begin(), calls.callees.end()),
+                      calls.callees.end());
+  return calls;
+}
 
-  void set_to_bottom() override { not_reached(); }
-  virtual void set_value(unsigned depth) {
-    m_kind = sparta::AbstractValueKind::Value;
-    m_depth = depth;
-  }
-  void set_to_top() override { m_kind = sparta::AbstractValueKind::Top; }
-
-  void join_with(const DepthDomain& other) override {
-    if (is_bottom() || other.is_top()) {
-      *this = other;
-    } else if (is_value() && other.is_value()) {
-      if (other.m_depth > m_depth) {
-        m_depth = other.m_depth;
+// Tarjan's algorithm, without recursion so that long call chains can't
+// overflow the stack. Returns the component of each method; components are
+// numbered in reverse topological order, i.e., callees first.
+std::vector<uint32_t> find_components(const std::vector<MethodCalls>& calls,
+                                      uint32_t* num_components) {
+  constexpr uint32_t kUnvisited = std::numeric_limits<uint32_t>::max();
+  const uint32_t size = calls.size();
+  std::vector<uint32_t> component(size, kUnvisited);
+  std::vector<uint32_t> index(size, kUnvisited);
+  std::vector<uint32_t> lowlink(size);
+  std::vector<bool> on_stack(size, false);
+  std::vector<uint32_t> stack;
+  // The DFS frames: a method and the position of its next callee to visit.
+  std::vector<std::pair<uint32_t, size_t>> frames;
+  uint32_t next_index = 0;
+  *num_components = 0;
+  for (uint32_t root = 0; root < size; ++root) {
+    if (index[root] != kUnvisited) {
+      continue;
+    }
+    frames.emplace_back(root, 0);
+    while (!frames.empty()) {
+      auto& frame = frames.back();
+      uint32_t v = frame.first;
+      if (frame.second == 0 && index[v] == kUnvisited) {
+        index[v] = lowlink[v] = next_index++;
+        stack.push_back(v);
+        on_stack[v] = true;
+      }
+      const auto& callees = calls[v].callees;
+      if (frame.second < callees.size()) {
+        uint32_t w = callees[frame.second++];
+        if (index[w] == kUnvisited) {
+          frames.emplace_back(w, 0);
+        } else if (on_stack[w]) {
+          lowlink[v] = std::min(lowlink[v], index[w]);
+        }
+        continue;
+      }
+      if (lowlink[v] == index[v]) {
+        uint32_t w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          on_stack[w] = false;
+          component[w] = *num_components;
+        } while (w != v);
+        ++*num_components;
+      }
+      frames.pop_back();
+      if (!frames.empty()) {
+        uint32_t parent = frames.back().first;
+        lowlink[parent] = std::min(lowlink[parent], lowlink[v]);
       }
     }
   }
+  return component;
+}
 
-  void widen_with(const DepthDomain& other) override { join_with(other); }
+} // namespace
 
-  void meet_with(const DepthDomain& /* other */) override {
-    throw std::runtime_error("meet_with not implemented!");
-  }
+namespace max_depth {
 
-  void narrow_with(const DepthDomain& /* other */) override {
-    throw std::runtime_error("narrow_with not implemented!");
+std::unordered_map<const DexMethod*, int> compute_max_call_depths(
+    const Scope& scope) {
+  std::vector<const DexMethod*> methods;
+  walk::methods(scope, [&](DexMethod* method) { methods.push_back(method); });
+  std::unordered_map<const DexMethod*, uint32_t> method_indices;
+  method_indices.reserve(methods.size());
+  for (uint32_t i = 0; i < methods.size(); ++i) {
+    method_indices.emplace(methods[i], i);
   }
 
-  unsigned depth() const { return m_depth; }
-
- private:
-  unsigned m_depth;
-  AbstractValueKind m_kind;
-};
-
-// Callsite is mostly used to describe calling context. It can be partitioned
-// based on call edges. In this analysis, the call depth is irrelevant to the
-// calling context, so we leave it unused.
-struct Caller {
-  using Domain = HashedSetAbstractDomain<DexMethod*>;
-};
-
-// Core part of the analysis. This analyzer should be similar to an
-// intraprocedural analysis, except that we have access to the summaries and the
-// calling context.
-template <typename Base>
-class MaxDepthFunctionAnalyzer : public Base {
- private:
-  const DexMethod* m_method;
-  DepthDomain m_domain;
-
- public:
-  explicit MaxDepthFunctionAnalyzer(const DexMethod* method)
-      : m_method(method), m_domain(0) {}
-
-  void analyze() override {
-    if (!m_method) {
-      return;
+  std::vector<MethodCalls> calls(methods.size());
+  std::vector<uint32_t> indices(methods.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<uint32_t>(
+      [&](uint32_t i) { calls[i] = gather_calls(methods[i], method_indices); },
+      indices);
+
+  // Condense the call graph.
+  uint32_t num_components;
+  auto component = find_components(calls, &num_components);
+  std::vector<std::vector<uint32_t>> members(num_components);
+  for (uint32_t i = 0; i < methods.size(); ++i) {
+    members[component[i]].push_back(i);
+  }
+  std::vector<std::vector<uint32_t>> component_callers(num_components);
+  std::vector<std::atomic<uint32_t>> pending_callees(num_components);
+  std::vector<int> depths(num_components, 0);
+  for (uint32_t c = 0; c < num_components; ++c) {
+    std::vector<uint32_t> callee_components;
+    bool recursive = members[c].size() > 1;
+    for (uint32_t m : members[c]) {
+      for (uint32_t callee : calls[m].callees) {
+        if (component[callee] == c) {
+          recursive = true;
+        } else {
+          callee_components.push_back(component[callee]);
+        }
+      }
     }
-    auto code = m_method->get_code();
-    if (!code) {
-      return;
+    std::sort(callee_components.begin(), callee_components.end());
+    callee_components.erase(
+        std::unique(callee_components.begin(), callee_components.end()),
+        callee_components.end());
+    for (uint32_t callee : callee_components) {
+      component_callers[callee].push_back(c);
     }
-    for (auto& mie : InstructionIterable(code)) {
-      always_assert_log(mie.insn,
-                        "IR is malformed, MIE holding an nullptr instruction.");
-
-      analyze_insn(mie.insn);
+    pending_callees[c] = callee_components.size();
+    if (recursive) {
+      depths[c] = kUnknownDepth;
     }
   }
 
-  void analyze_insn(IRInstruction* insn) {
-    if (opcode::is_an_invoke(insn->opcode())) {
-      analyze_invoke(insn);
+  // Process the components bottom-up. A component only reads the depths of
+  // its callees, which are all final by the time it is in the frontier.
+  std::vector<uint32_t> frontier;
+  for (uint32_t c = 0; c < num_components; ++c) {
+    if (pending_callees[c] == 0) {
+      frontier.push_back(c);
     }
   }
-
-  void analyze_invoke(IRInstruction* insn) {
-    auto callee = insn->get_method();
-    auto callee_method =
-        resolve_method(callee, opcode_to_search(insn), m_method);
-    if (callee_method) {
-      auto summary =
-          this->get_summaries()->get(callee_method, DepthDomain::top());
-      if (summary.is_value()) {
-        m_domain.join_with(DepthDomain(summary.depth() + 1u));
-      } else {
-        m_domain.join_with(summary);
-      }
-    } else {
-      m_domain.join_with(DepthDomain(1u));
-    }
+  while (!frontier.empty()) {
+    std::vector<uint32_t> next_frontier;
+    std::mutex next_frontier_mutex;
+    workqueue_run<uint32_t>(
+        [&](uint32_t c) {
+          int depth = depths[c];
+          for (uint32_t m : members[c]) {
+            if (depth == kUnknownDepth) {
+              break;
+            }
+            const auto& method_calls = calls[m];
+            if (method_calls.has_unknown_call) {
+              depth = kUnknownDepth;
+              break;
+            }
+            if (method_calls.has_unresolved_call) {
+              depth = std::max(depth, 1);
+            }
+            for (uint32_t callee : method_calls.callees) {
+              int callee_depth = depths[component[callee]];
+              if (callee_depth == kUnknownDepth) {
+                depth = kUnknownDepth;
+                break;
+              }
+              depth = std::max(depth, callee_depth + 1);
+            }
+          }
+          depths[c] = depth;
+          for (uint32_t caller : component_callers[c]) {
+            if (--pending_callees[caller] == 0) {
+              std::lock_guard<std::mutex> lock(next_frontier_mutex);
+              next_frontier.push_back(caller);
+            }
+          }
+        },
+        frontier);
+    frontier = std::move(next_frontier);
   }
 
-  void summarize() override {
-    if (!m_method) {
-      return;
+  std::unordered_map<const DexMethod*, int> result;
+  for (uint32_t i = 0; i < methods.size(); ++i) {
+    int depth = depths[component[i]];
+    if (depth != kUnknownDepth) {
+      result.emplace(methods[i], depth);
     }
-    this->get_summaries()->update(m_method,
-                                  [&](const DepthDomain&) { return m_domain; });
   }
-};
-
-// The adaptor supplies the necessary typenames to the analyzer so that template
-// instantiation assembles the different parts. It's also possible to override
-// type aliases in the adaptor base class.
-struct MaxDepthAnalysisAdaptor : public BottomUpAnalysisAdaptorBase {
-  // Registry is used to hold the summaries.
-  using Registry = MethodSummaryRegistry<DepthDomain>;
-  using FunctionSummary = DepthDomain;
-
-  template <typename IntraproceduralBase>
-  using FunctionAnalyzer = MaxDepthFunctionAnalyzer<IntraproceduralBase>;
-  using Callsite = Caller;
-};
-
-using Analysis = InterproceduralAnalyzer<MaxDepthAnalysisAdaptor>;
+  return result;
+}
 
-} // namespace
+} // namespace max_depth
 
 void MaxDepthAnalysisPass::run_pass(DexStoresVector& stores,
                                     ConfigFiles& /* conf */,
                                     PassManager& /* pm */) {
-  auto analysis = Analysis(build_class_scope(stores), m_max_iteration);
-  analysis.run();
-  m_result = std::make_shared<std::unordered_map<const DexMethod*, int>>();
-
-  for (const auto& entry : analysis.registry.get_map()) {
-    if (entry.second.is_value()) {
-      (*m_result)[entry.first] = entry.second.depth();
-    }
-  }
+  m_result = std::make_shared<Result>(
+      max_depth::compute_max_call_depths(build_class_scope(stores)));
 }
 
 static MaxDepthAnalysisPass s_pass;
@@ -12,10 +12,23 @@
 #include "DexClass.h"
 #include "Pass.h"
 
+namespace max_depth {
+
+/*
+ * Computes the maximum depth of the calls made by each method in `scope`: 0
+ * for a method that makes no call, and otherwise one more than the largest
+ * depth of its callees, where a call that can't be resolved counts as a call to
+ * a method of depth 0. Methods that are recursive, call an external method, or
+ * call such methods have no depth.
+ */
+std::unordered_map<const DexMethod*, int> compute_max_call_depths(
+    const Scope& scope);
+
+} // namespace max_depth
+
 class MaxDepthAnalysisPass : public Pass {
  public:
   MaxDepthAnalysisPass() : Pass("MaxDepthAnalysisPass", Pass::ANALYSIS) {}
-  void bind_config() override { bind("max_iteration", 20U, m_max_iteration); }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   using Result = std::unordered_map<const DexMethod*, int>;
@@ -25,6 +38,5 @@ class MaxDepthAnalysisPass : public Pass {
   void destroy_analysis_result() override { m_result = nullptr; }
 
  private:
-  unsigned m_max_iteration;
   std::shared_ptr<Result> m_result = nullptr;
 };
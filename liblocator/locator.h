@@ -6,6 +6,7 @@
  */
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 namespace facebook {
@@ -228,4 +229,93 @@ uint32_t Locator::decodeGlobalClassIndex(const char* descriptor) noexcept {
   }
 }
 
+//
+// A locator table maps the type descriptors of all the classes of an app to
+// their locators, for class loaders that look classes up by name: a lookup
+// hashes the descriptor twice and reads one table entry, instead of reading
+// and decoding a locator string from the string table of a dex.
+//
+// The table is a minimal-ish perfect hash built by hash-and-displace: the
+// descriptors are spread over `nbuckets` buckets by a first hash, and each
+// bucket has its own seed for a second hash, picked when the table is built
+// so that all the descriptors of the table end up in distinct slots. Each
+// slot also records the first hash of its descriptor, so that descriptors
+// that aren't in the table are rejected, except for the rare ones that share
+// both the slot and the first hash of a class of the table.
+//
+// The table is laid out as follows, little-endian like the dex format:
+//
+//   Header header
+//   uint32_t seeds[header.nbuckets]
+//   Entry entries[header.nslots]
+//
+// Empty slots have a dexnr of 0, as no class of the app is in the special
+// dex 0.
+//
+class LocatorTable {
+ public:
+  constexpr static const uint32_t magic = 0x544c4f4c; // "LOLT"
+  constexpr static const uint32_t version = 1;
+
+  struct Header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nbuckets;
+    uint32_t nslots;
+  };
+
+  struct Entry {
+    uint32_t hash;
+    uint16_t strnr;
+    uint16_t dexnr;
+    uint32_t clsnr;
+  };
+
+  static inline uint32_t hash(const char* descriptor, uint32_t seed) noexcept;
+
+  // Checks that the table has a known format and is as large as its header
+  // says, before any lookup.
+  static inline bool isValid(const void* table, size_t size) noexcept;
+
+  // Returns the locator of the class with the given descriptor, or (0, 0, 0)
+  // if the class isn't in the table.
+  static inline Locator find(const void* table,
+                             const char* descriptor) noexcept;
+};
+
+uint32_t LocatorTable::hash(const char* descriptor, uint32_t seed) noexcept {
+  // FNV-1a, with the seed folded into the offset basis.
+  uint32_t value = 2166136261u ^ (seed * 0x9e3779b9u);
+  for (const uint8_t* pos = (const uint8_t*)descriptor; *pos != 0; ++pos) {
+    value = (value ^ *pos) * 16777619u;
+  }
+  return value;
+}
+
+bool LocatorTable::isValid(const void* table, size_t size) noexcept {
+  if (size < sizeof(Header)) {
+    return false;
+  }
+  const Header* header = (const Header*)table;
+  return header->magic == magic && header->version == version &&
+         header->nbuckets != 0 && header->nslots != 0 &&
+         (size - sizeof(Header)) / sizeof(uint32_t) >= header->nbuckets &&
+         (size - sizeof(Header) - header->nbuckets * sizeof(uint32_t)) /
+                 sizeof(Entry) >=
+             header->nslots;
+}
+
+Locator LocatorTable::find(const void* table, const char* descriptor) noexcept {
+  const Header* header = (const Header*)table;
+  const uint32_t* seeds = (const uint32_t*)(header + 1);
+  const Entry* entries = (const Entry*)(seeds + header->nbuckets);
+  uint32_t first = hash(descriptor, 0);
+  uint32_t seed = seeds[first % header->nbuckets];
+  const Entry& entry = entries[hash(descriptor, seed) % header->nslots];
+  if (entry.dexnr == 0 || entry.hash != first) {
+    return Locator(0, 0, 0);
+  }
+  return Locator(entry.strnr, entry.dexnr, entry.clsnr);
+}
+
 } // namespace facebook
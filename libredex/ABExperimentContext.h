@@ -14,9 +14,12 @@ struct RedexTest;
 namespace ab_test {
 
 /**
- * RAII object that controls whether mutations happening to a CFG after the
- * experiment context has been created and before it has been flushed will
- * actually be visible (i.e. applied) or not, depending on its setup.
+ * Tells a pass whether the experiment it runs under is set up as CONTROL or
+ * TEST, so that the pass only makes the experimental mutations in TEST.
+ *
+ * No copies of the code are kept: the pass checks the state before mutating
+ * anything and skips the mutations in CONTROL, so an experiment costs no
+ * memory however many methods it covers.
  */
 class ABExperimentContext {
   friend RedexTest;
@@ -31,9 +34,8 @@ class ABExperimentContext {
   virtual bool use_test() = 0;
 
   /**
-   * Decide which version (CONTROL/TEST) of code will be applied and also clears
-   * the CFG that was created by the constructor. The method's CFG
-   * should not be used anymore after the context is flushed.
+   * Ends the experiment. Only valid in TEST, since the mutations of a CONTROL
+   * experiment are never made in the first place.
    */
   virtual void flush() = 0;
 
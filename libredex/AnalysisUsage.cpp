@@ -73,3 +73,20 @@ void AnalysisUsage::check_dependencies(const std::vector<Pass*>& passes) {
                          "Unsatisfied analysis pass dependencies:\n%s",
                          error.str().c_str());
 }
+
+bool AnalysisUsage::is_required_after(const std::vector<Pass*>& passes,
+                                      size_t index,
+                                      const AnalysisID& id) {
+  for (size_t i = index + 1; i < passes.size(); ++i) {
+    Pass* pass = passes[i];
+    AnalysisUsage analysis_usage;
+    pass->set_analysis_usage(analysis_usage);
+    if (analysis_usage.m_required_passes.count(id)) {
+      return true;
+    }
+    if (get_analysis_id_by_pass(pass) == id || !analysis_usage.preserves(id)) {
+      return false;
+    }
+  }
+  return false;
+}
@@ -57,6 +57,11 @@ class AnalysisUsage {
     return m_required_passes;
   }
 
+  // Whether the analysis survives the current pass.
+  bool preserves(const AnalysisID& id) const {
+    return m_preserve_all || m_preserve_specific.count(id);
+  }
+
   // Called from PassManager. Invalidates preserved pass according to the pass
   // invalidation policy set up by the pass in which the AnalysisUsage is
   // defined.
@@ -67,6 +72,12 @@ class AnalysisUsage {
   // without running any pass.
   static void check_dependencies(const std::vector<Pass*>& passes);
 
+  // Whether a pass after the one at `index` requires the result of the
+  // analysis `id`, before the analysis is invalidated or run again.
+  static bool is_required_after(const std::vector<Pass*>& passes,
+                                size_t index,
+                                const AnalysisID& id);
+
  private:
   bool m_preserve_all = false;
   std::unordered_set<AnalysisID> m_required_passes;
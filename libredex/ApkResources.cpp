@@ -767,8 +767,11 @@ void ApkResources::remap_xml_reference_attributes(
 ResourcesArscFile::ResourcesArscFile(const std::string& path)
     : m_f(RedexMappedFile::open(path, /* read_only= */ false)) {
   m_arsc_len = m_f.size();
+  // The table points straight into the writable mapping instead of copying
+  // it, so edits to its values land in the mapped file until serialize()
+  // overwrites it.
   int error = res_table.add(m_f.const_data(), m_f.size(), /* cookie */ -1,
-                            /* copyData*/ true);
+                            /* copyData*/ false);
   always_assert_log(error == 0, "Reading arsc failed with error code: %d",
                     error);
 
@@ -779,10 +782,9 @@ ResourcesArscFile::ResourcesArscFile(const std::string& path)
     uint32_t id = sorted_res_ids[index];
     android::ResTable::resource_name name;
     res_table.getResourceName(id, true, &name);
-    std::string name_string(
-        android::String8(name.name8, name.nameLen).string());
-    id_to_name.emplace(id, name_string);
+    std::string name_string(name.name8, name.nameLen);
     name_to_ids[name_string].push_back(id);
+    id_to_name.emplace(id, std::move(name_string));
   }
 }
 
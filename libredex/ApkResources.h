@@ -100,6 +100,8 @@ class ResourcesArscFile {
   void remap_ids(const std::map<uint32_t, uint32_t>& old_to_remapped_ids);
   std::unordered_set<uint32_t> get_types_by_name(
       const std::unordered_set<std::string>& type_names);
+  // Writes the table back to the file it was read from. The table refers to
+  // the file's mapping, so it must not be used afterwards.
   size_t serialize();
   ~ResourcesArscFile();
 
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Debug.h"
+
+void* Arena::allocate(size_t size, size_t alignment) {
+  always_assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  std::lock_guard<std::mutex> guard(m_lock);
+  auto align = [alignment](char* p) {
+    auto addr = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((addr + alignment - 1) & ~(alignment - 1));
+  };
+  char* result = m_current == nullptr ? nullptr : align(m_current);
+  if (result == nullptr || result + size > m_end) {
+    // The chunk is allocated with new[], which only guarantees the alignment
+    // of max_align_t, so leave room for more.
+    auto chunk_size = std::max(m_next_chunk_size, size + alignment);
+    m_chunks.emplace_back(new char[chunk_size]);
+    m_reserved += chunk_size;
+    m_next_chunk_size = std::min(m_next_chunk_size * 2, MAX_CHUNK_SIZE);
+    m_current = m_chunks.back().get();
+    m_end = m_current + chunk_size;
+    result = align(m_current);
+  }
+  m_current = result + size;
+  return result;
+}
+
+size_t Arena::reserved_bytes() const {
+  std::lock_guard<std::mutex> guard(m_lock);
+  return m_reserved;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/*
+ * A thread-safe bump allocator, for many small objects that live as long as
+ * the arena, e.g. the DexStrings of a RedexContext. It saves the bookkeeping
+ * of one heap allocation per object, and places objects created together
+ * next to each other.
+ *
+ * Memory is carved out of chunks of increasing size, and only released when
+ * the arena is destroyed. The arena never runs the destructors of the objects
+ * it holds.
+ */
+class Arena final {
+ public:
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+  template <typename T, typename... Args>
+  T* make(Args&&... args) {
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  // Includes the unused tail of the chunks.
+  size_t reserved_bytes() const;
+
+ private:
+  static constexpr size_t MIN_CHUNK_SIZE = 4 * 1024;
+  static constexpr size_t MAX_CHUNK_SIZE = 1024 * 1024;
+
+  mutable std::mutex m_lock;
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+  size_t m_reserved{0};
+  size_t m_next_chunk_size{MIN_CHUNK_SIZE};
+  char* m_current{nullptr};
+  char* m_end{nullptr};
+};
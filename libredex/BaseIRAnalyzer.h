@@ -7,25 +7,39 @@
 
 #pragma once
 
+#include <unordered_map>
+
+#include "BigBlocks.h"
 #include "ControlFlow.h"
 #include "IRInstruction.h"
 #include "MonotonicFixpointIterator.h"
 
 namespace ir_analyzer {
 
-template <typename Domain>
-class BaseIRAnalyzer
+/*
+ * The analyses derived from StaticIRAnalyzer<Derived, Domain> provide a
+ * non-virtual
+ *
+ *   void analyze_instruction(const IRInstruction*, Domain*) const;
+ *
+ * which the analysis of each block calls directly, without an indirect call
+ * per instruction. BaseIRAnalyzer is the variant where analyze_instruction is
+ * virtual, for analyses that are further subclassed.
+ */
+template <typename Derived, typename Domain>
+class StaticIRAnalyzer
     : public sparta::MonotonicFixpointIterator<cfg::GraphInterface, Domain> {
  public:
   using NodeId = cfg::Block*;
 
-  explicit BaseIRAnalyzer(const cfg::ControlFlowGraph& cfg)
+  explicit StaticIRAnalyzer(const cfg::ControlFlowGraph& cfg)
       : sparta::MonotonicFixpointIterator<cfg::GraphInterface, Domain>(
             cfg, cfg.blocks().size()) {}
 
   void analyze_node(const NodeId& node, Domain* current_state) const override {
+    const auto& derived = static_cast<const Derived&>(*this);
     for (auto& mie : ir_list::InstructionIterable(node)) {
-      analyze_instruction(mie.insn, current_state);
+      derived.analyze_instruction(mie.insn, current_state);
     }
   }
 
@@ -33,28 +47,172 @@ class BaseIRAnalyzer
                       const Domain& exit_state_at_source) const override {
     return exit_state_at_source;
   }
+};
+
+template <typename Domain>
+class BaseIRAnalyzer
+    : public StaticIRAnalyzer<BaseIRAnalyzer<Domain>, Domain> {
+ public:
+  explicit BaseIRAnalyzer(const cfg::ControlFlowGraph& cfg)
+      : StaticIRAnalyzer<BaseIRAnalyzer<Domain>, Domain>(cfg) {}
 
   virtual void analyze_instruction(const IRInstruction* insn,
                                    Domain* current_state) const = 0;
 };
 
+namespace details {
+
+// The graph must exist before the fixpoint iterator, which computes its
+// weak partial ordering upon construction.
+struct BigBlockGraphHolder {
+  explicit BigBlockGraphHolder(const cfg::ControlFlowGraph& cfg)
+      : m_big_block_graph(cfg) {}
+
+  const big_blocks::BigBlockGraph m_big_block_graph;
+};
+
+} // namespace details
+
+/*
+ * Same as StaticIRAnalyzer, but the fixpoint iteration goes over the big
+ * blocks of the cfg (see BigBlocks.h) rather than over its blocks. On code
+ * with many small blocks, e.g. in try regions, where every instruction that
+ * may throw ends a block, that leaves fewer nodes to schedule, to join into
+ * and to keep states for.
+ *
+ * The states within big blocks are recorded when their big block is
+ * analyzed, so get_entry_state_at and get_exit_state_at still take any
+ * block, and an edge that leaves a big block from one of its inner blocks
+ * sees the state at the exit of that block. Instead of analyze_node and
+ * analyze_edge, which work on big blocks here, the analyses may provide
+ *
+ *   void analyze_block(cfg::Block*, Domain*) const;
+ *   Domain analyze_block_edge(cfg::Edge*, const Domain&) const;
+ *
+ * which are also applied to the blocks and GOTO edges within big blocks.
+ * Since the recorded states live in the analyzer, run_incremental isn't
+ * supported.
+ */
+template <typename Derived, typename Domain>
+class StaticBigBlockIRAnalyzer
+    : private details::BigBlockGraphHolder,
+      public sparta::MonotonicFixpointIterator<big_blocks::GraphInterface,
+                                               Domain> {
+  using Base =
+      sparta::MonotonicFixpointIterator<big_blocks::GraphInterface, Domain>;
+
+ public:
+  using NodeId = cfg::Block*;
+
+  explicit StaticBigBlockIRAnalyzer(const cfg::ControlFlowGraph& cfg)
+      : details::BigBlockGraphHolder(cfg),
+        Base(m_big_block_graph, m_big_block_graph.size()) {}
+
+  void run(const Domain& init) {
+    m_entry_states_within.clear();
+    m_exit_states_within.clear();
+    Base::run(init);
+  }
+
+  template <typename Nodes>
+  void run_incremental(const Domain& init, const Nodes& dirty_nodes) = delete;
+
+  void analyze_node(const NodeId& node, Domain* current_state) const override {
+    const auto& derived = static_cast<const Derived&>(*this);
+    const auto& blocks = m_big_block_graph.blocks(node);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      auto block = blocks[i];
+      if (i > 0) {
+        m_entry_states_within[block] = *current_state;
+      }
+      derived.analyze_block(block, current_state);
+      if (i + 1 < blocks.size()) {
+        m_exit_states_within[block] = *current_state;
+        auto edge = block->cfg().get_succ_edge_of_type(block, cfg::EDGE_GOTO);
+        *current_state = derived.analyze_block_edge(edge, *current_state);
+      }
+    }
+  }
+
+  Domain analyze_edge(const big_blocks::GraphInterface::EdgeId& edge,
+                      const Domain& exit_state_at_source) const override {
+    const auto& derived = static_cast<const Derived&>(*this);
+    auto src = edge->src();
+    if (src == m_big_block_graph.blocks(m_big_block_graph.head(src)).back()) {
+      return derived.analyze_block_edge(edge, exit_state_at_source);
+    }
+    auto it = m_exit_states_within.find(src);
+    return it == m_exit_states_within.end()
+               ? Domain::bottom()
+               : derived.analyze_block_edge(edge, it->second);
+  }
+
+  void analyze_block(cfg::Block* block, Domain* current_state) const {
+    const auto& derived = static_cast<const Derived&>(*this);
+    for (auto& mie : ir_list::InstructionIterable(block)) {
+      derived.analyze_instruction(mie.insn, current_state);
+    }
+  }
+
+  Domain analyze_block_edge(cfg::Edge*, const Domain& state) const {
+    return state;
+  }
+
+  Domain get_entry_state_at(const NodeId& block) const {
+    if (this->budget_exceeded() || m_big_block_graph.head(block) == block) {
+      return Base::get_entry_state_at(block);
+    }
+    auto it = m_entry_states_within.find(block);
+    return it == m_entry_states_within.end() ? Domain::bottom() : it->second;
+  }
+
+  Domain get_exit_state_at(const NodeId& block) const {
+    auto head = m_big_block_graph.head(block);
+    if (this->budget_exceeded() ||
+        m_big_block_graph.blocks(head).back() == block) {
+      return Base::get_exit_state_at(head);
+    }
+    auto it = m_exit_states_within.find(block);
+    return it == m_exit_states_within.end() ? Domain::bottom() : it->second;
+  }
+
+ private:
+  mutable std::unordered_map<cfg::Block*, Domain> m_entry_states_within;
+  mutable std::unordered_map<cfg::Block*, Domain> m_exit_states_within;
+};
+
 template <typename Domain>
-class BaseBackwardsIRAnalyzer
+class BaseBigBlockIRAnalyzer
+    : public StaticBigBlockIRAnalyzer<BaseBigBlockIRAnalyzer<Domain>, Domain> {
+ public:
+  explicit BaseBigBlockIRAnalyzer(const cfg::ControlFlowGraph& cfg)
+      : StaticBigBlockIRAnalyzer<BaseBigBlockIRAnalyzer<Domain>, Domain>(cfg) {}
+
+  virtual void analyze_instruction(const IRInstruction* insn,
+                                   Domain* current_state) const = 0;
+};
+
+// Same as StaticIRAnalyzer, for
+//
+//   void analyze_instruction(IRInstruction*, Domain*) const;
+template <typename Derived, typename Domain>
+class StaticBackwardsIRAnalyzer
     : public sparta::MonotonicFixpointIterator<
           sparta::BackwardsFixpointIterationAdaptor<cfg::GraphInterface>,
           Domain> {
  public:
   using NodeId = cfg::Block*;
 
-  explicit BaseBackwardsIRAnalyzer(const cfg::ControlFlowGraph& cfg)
+  explicit StaticBackwardsIRAnalyzer(const cfg::ControlFlowGraph& cfg)
       : sparta::MonotonicFixpointIterator<
             sparta::BackwardsFixpointIterationAdaptor<cfg::GraphInterface>,
             Domain>(cfg, cfg.blocks().size()) {}
 
   void analyze_node(const NodeId& node, Domain* current_state) const override {
+    const auto& derived = static_cast<const Derived&>(*this);
     for (auto it = node->rbegin(); it != node->rend(); ++it) {
       if (it->type == MFLOW_OPCODE) {
-        analyze_instruction(it->insn, current_state);
+        derived.analyze_instruction(it->insn, current_state);
       }
     }
   }
@@ -63,6 +221,16 @@ class BaseBackwardsIRAnalyzer
                       const Domain& exit_state_at_source) const override {
     return exit_state_at_source;
   }
+};
+
+template <typename Domain>
+class BaseBackwardsIRAnalyzer
+    : public StaticBackwardsIRAnalyzer<BaseBackwardsIRAnalyzer<Domain>,
+                                       Domain> {
+ public:
+  explicit BaseBackwardsIRAnalyzer(const cfg::ControlFlowGraph& cfg)
+      : StaticBackwardsIRAnalyzer<BaseBackwardsIRAnalyzer<Domain>, Domain>(
+            cfg) {}
 
   virtual void analyze_instruction(IRInstruction* insn,
                                    Domain* current_state) const = 0;
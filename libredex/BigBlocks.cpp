@@ -135,4 +135,29 @@ std::vector<BigBlock> get_big_blocks(cfg::ControlFlowGraph& cfg) {
   return res;
 }
 
+BigBlockGraph::BigBlockGraph(const cfg::ControlFlowGraph& cfg)
+    : m_entry(cfg.entry_block()) {
+  for (auto block : cfg.blocks()) {
+    auto big_block = get_big_block(block);
+    if (!big_block) {
+      continue;
+    }
+    auto& node = m_nodes[block];
+    node.blocks = big_block->get_blocks();
+    for (size_t i = 0; i < node.blocks.size(); ++i) {
+      auto b = node.blocks[i];
+      m_heads.emplace(b, block);
+      auto next = i + 1 < node.blocks.size() ? node.blocks[i + 1] : nullptr;
+      for (auto edge : b->succs()) {
+        if (edge->target() != next) {
+          node.succs.push_back(edge);
+        }
+      }
+    }
+  }
+  if (cfg.exit_block() != nullptr) {
+    m_exit = m_heads.at(cfg.exit_block());
+  }
+}
+
 } // namespace big_blocks
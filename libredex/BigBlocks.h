@@ -13,6 +13,8 @@
  * blocks, and some instructions can indeed throw.
  */
 
+#include <unordered_map>
+
 #include "ControlFlow.h"
 #include "IRCode.h"
 
@@ -118,4 +120,62 @@ boost::optional<BigBlock> get_big_block(cfg::Block* block);
 // Each block of the original cfg appears in exactly one big block.
 std::vector<BigBlock> get_big_blocks(cfg::ControlFlowGraph& cfg);
 
+/*
+ * The graph of the big blocks of a cfg, where each big block is named by its
+ * first block. Its edges are the edges of the cfg, but for the GOTO edges
+ * within big blocks, so that an edge may leave a big block from any of its
+ * blocks, e.g. when an instruction within a try region throws.
+ */
+class BigBlockGraph {
+ public:
+  explicit BigBlockGraph(const cfg::ControlFlowGraph& cfg);
+
+  cfg::Block* entry() const { return m_entry; }
+  cfg::Block* exit() const { return m_exit; }
+
+  // The first block of the big block that contains the given block.
+  cfg::Block* head(cfg::Block* block) const { return m_heads.at(block); }
+
+  const std::vector<cfg::Block*>& blocks(cfg::Block* head) const {
+    return m_nodes.at(head).blocks;
+  }
+
+  const std::vector<cfg::Edge*>& succs(cfg::Block* head) const {
+    return m_nodes.at(head).succs;
+  }
+
+  size_t size() const { return m_nodes.size(); }
+
+ private:
+  struct Node {
+    std::vector<cfg::Block*> blocks;
+    std::vector<cfg::Edge*> succs;
+  };
+
+  cfg::Block* m_entry;
+  cfg::Block* m_exit{nullptr};
+  std::unordered_map<cfg::Block*, cfg::Block*> m_heads;
+  std::unordered_map<cfg::Block*, Node> m_nodes;
+};
+
+class GraphInterface {
+ public:
+  using Graph = BigBlockGraph;
+  using NodeId = cfg::Block*;
+  using EdgeId = cfg::Edge*;
+  static NodeId entry(const Graph& graph) { return graph.entry(); }
+  static NodeId exit(const Graph& graph) { return graph.exit(); }
+  static std::vector<EdgeId> predecessors(const Graph&, const NodeId& b) {
+    // Only the first block of a big block has preds from other big blocks.
+    return b->preds();
+  }
+  static std::vector<EdgeId> successors(const Graph& graph, const NodeId& b) {
+    return graph.succs(b);
+  }
+  static NodeId source(const Graph& graph, const EdgeId& e) {
+    return graph.head(e->src());
+  }
+  static NodeId target(const Graph&, const EdgeId& e) { return e->target(); }
+};
+
 } // namespace big_blocks
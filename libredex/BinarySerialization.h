@@ -10,6 +10,7 @@
 #include <limits>
 #include <ostream>
 #include <type_traits>
+#include <vector>
 
 #include "Debug.h"
 
@@ -38,6 +39,16 @@ void write_array(std::ostream& os, const Container& container) {
   }
 }
 
+/*
+ * Serialize the elements of an array as they are laid out in memory, without
+ * its length.
+ */
+template <class V>
+std::enable_if_t<std::is_integral<V>::value> write_elements(
+    std::ostream& os, const std::vector<V>& values) {
+  os.write((const char*)values.data(), values.size() * sizeof(V));
+}
+
 /*
  * Write a simple header. Ideally we should use a single header format across
  * all our binary files.
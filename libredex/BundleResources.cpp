@@ -22,6 +22,7 @@
 #include <string>
 
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 
 #include "Debug.h"
 #include "DexUtil.h"
@@ -129,19 +130,21 @@ std::string get_string_attribute_value(const aapt::pb::XmlElement& element,
 void traverse_element_and_children(
     const aapt::pb::XmlElement& start,
     const std::function<bool(const aapt::pb::XmlElement&)>& callback) {
-  std::queue<aapt::pb::XmlElement> q;
-  q.push(start);
+  // The elements are owned by `start`; queueing copies of them would copy
+  // every subtree once per level.
+  std::queue<const aapt::pb::XmlElement*> q;
+  q.push(&start);
   while (!q.empty()) {
-    const auto& front = q.front();
-    if (!callback(front)) {
+    const auto* front = q.front();
+    q.pop();
+    if (!callback(*front)) {
       return;
     }
-    for (const aapt::pb::XmlNode& pb_child : front.child()) {
+    for (const aapt::pb::XmlNode& pb_child : front->child()) {
       if (pb_child.node_case() == aapt::pb::XmlNode::NodeCase::kElement) {
-        q.push(pb_child.element());
+        q.push(&pb_child.element());
       }
     }
-    q.pop();
   }
 }
 
@@ -429,13 +432,179 @@ const std::vector<std::string> CLASS_XML_ATTRIBUTES = {
     "targetClass",
 };
 
+// The parts of an XmlElement that layout scanning looks at. Layouts are read
+// with a CodedInputStream one element at a time, instead of materializing the
+// whole XmlNode tree of every file.
+struct StreamedAttribute {
+  std::string namespace_uri;
+  std::string name;
+  std::string value;
+  bool has_compiled_item{false};
+};
+
+struct StreamedElement {
+  std::string name;
+  // Pairs of uri and prefix.
+  std::vector<std::pair<std::string, std::string>> namespace_declarations;
+  std::vector<StreamedAttribute> attributes;
+  // The serialized XmlNode children, as slices of the input.
+  std::vector<std::pair<const uint8_t*, int>> children;
+};
+
+using google::protobuf::internal::WireFormatLite;
+
+bool is_length_delimited(uint32_t tag) {
+  return WireFormatLite::GetTagWireType(tag) ==
+         WireFormatLite::WIRETYPE_LENGTH_DELIMITED;
+}
+
+// Reads a length-delimited submessage with `fn`, which is called with the
+// stream limited to the submessage.
+template <typename Fn>
+bool read_submessage(google::protobuf::io::CodedInputStream* input,
+                     const Fn& fn) {
+  uint32_t length;
+  if (!input->ReadVarint32(&length)) {
+    return false;
+  }
+  auto limit = input->PushLimit(static_cast<int>(length));
+  bool ok = fn() && input->ConsumedEntireMessage();
+  input->PopLimit(limit);
+  return ok;
+}
+
+bool read_namespace(google::protobuf::io::CodedInputStream* input,
+                    std::pair<std::string, std::string>* out) {
+  while (uint32_t tag = input->ReadTag()) {
+    auto field = WireFormatLite::GetTagFieldNumber(tag);
+    bool ok;
+    if (field == aapt::pb::XmlNamespace::kUriFieldNumber &&
+        is_length_delimited(tag)) {
+      ok = WireFormatLite::ReadString(input, &out->first);
+    } else if (field == aapt::pb::XmlNamespace::kPrefixFieldNumber &&
+               is_length_delimited(tag)) {
+      ok = WireFormatLite::ReadString(input, &out->second);
+    } else {
+      ok = WireFormatLite::SkipField(input, tag);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool read_attribute(google::protobuf::io::CodedInputStream* input,
+                    StreamedAttribute* out) {
+  while (uint32_t tag = input->ReadTag()) {
+    auto field = WireFormatLite::GetTagFieldNumber(tag);
+    if (field == aapt::pb::XmlAttribute::kCompiledItemFieldNumber) {
+      out->has_compiled_item = true;
+    }
+    bool ok;
+    if (field == aapt::pb::XmlAttribute::kNamespaceUriFieldNumber &&
+        is_length_delimited(tag)) {
+      ok = WireFormatLite::ReadString(input, &out->namespace_uri);
+    } else if (field == aapt::pb::XmlAttribute::kNameFieldNumber &&
+               is_length_delimited(tag)) {
+      ok = WireFormatLite::ReadString(input, &out->name);
+    } else if (field == aapt::pb::XmlAttribute::kValueFieldNumber &&
+               is_length_delimited(tag)) {
+      ok = WireFormatLite::ReadString(input, &out->value);
+    } else {
+      ok = WireFormatLite::SkipField(input, tag);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool read_element(google::protobuf::io::CodedInputStream* input,
+                  const uint8_t* base,
+                  StreamedElement* out) {
+  while (uint32_t tag = input->ReadTag()) {
+    auto field = WireFormatLite::GetTagFieldNumber(tag);
+    bool ok;
+    if (!is_length_delimited(tag)) {
+      ok = WireFormatLite::SkipField(input, tag);
+    } else if (field == aapt::pb::XmlElement::kNameFieldNumber) {
+      ok = WireFormatLite::ReadString(input, &out->name);
+    } else if (field ==
+               aapt::pb::XmlElement::kNamespaceDeclarationFieldNumber) {
+      out->namespace_declarations.emplace_back();
+      ok = read_submessage(input, [&]() {
+        return read_namespace(input, &out->namespace_declarations.back());
+      });
+    } else if (field == aapt::pb::XmlElement::kAttributeFieldNumber) {
+      out->attributes.emplace_back();
+      ok = read_submessage(input, [&]() {
+        return read_attribute(input, &out->attributes.back());
+      });
+    } else if (field == aapt::pb::XmlElement::kChildFieldNumber) {
+      // Children are only sliced out here, and read once this element is
+      // done with.
+      uint32_t length;
+      ok = input->ReadVarint32(&length);
+      if (ok) {
+        out->children.emplace_back(base + input->CurrentPosition(),
+                                   static_cast<int>(length));
+        ok = input->Skip(static_cast<int>(length));
+      }
+    } else {
+      ok = WireFormatLite::SkipField(input, tag);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the XmlNode serialized in `data`. Returns false if it could not be
+// parsed, and leaves `out` empty if the node is not an element.
+bool read_node(const uint8_t* data, int size, StreamedElement* out) {
+  google::protobuf::io::CodedInputStream input(data, size);
+  while (uint32_t tag = input.ReadTag()) {
+    auto field = WireFormatLite::GetTagFieldNumber(tag);
+    bool ok;
+    if (field == aapt::pb::XmlNode::kElementFieldNumber &&
+        is_length_delimited(tag)) {
+      // The element's submessage starts after its length, and slices of its
+      // children are taken relative to the start of `data`.
+      ok = read_submessage(&input,
+                           [&]() { return read_element(&input, data, out); });
+    } else {
+      ok = WireFormatLite::SkipField(&input, tag);
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+  return input.ConsumedEntireMessage();
+}
+
+std::string get_string_attribute_value(const StreamedElement& element,
+                                       const std::string& name) {
+  for (const auto& attr : element.attributes) {
+    if (attr.name == name) {
+      always_assert_log(!attr.has_compiled_item,
+                        "Attribute %s expected to be a string!",
+                        name.c_str());
+      return attr.value;
+    }
+  }
+  return std::string("");
+}
+
 void collect_layout_classes_and_attributes_for_element(
-    const aapt::pb::XmlElement& element,
+    const StreamedElement& element,
     const std::unordered_map<std::string, std::string>& ns_uri_to_prefix,
     const std::unordered_set<std::string>& attributes_to_read,
     std::unordered_set<std::string>* out_classes,
     std::unordered_multimap<std::string, std::string>* out_attributes) {
-  const auto& element_name = element.name();
+  const auto& element_name = element.name;
   if (NON_CLASS_ELEMENTS.count(element_name) > 0) {
     for (const auto& attr : CLASS_XML_ATTRIBUTES) {
       auto classname = get_string_attribute_value(element, attr);
@@ -458,20 +627,19 @@ void collect_layout_classes_and_attributes_for_element(
   }
 
   if (!attributes_to_read.empty()) {
-    for (const aapt::pb::XmlAttribute& pb_attr : element.attribute()) {
-      const auto& attr_name = pb_attr.name();
-      const auto& uri = pb_attr.namespace_uri();
+    for (const auto& attr : element.attributes) {
+      const auto& attr_name = attr.name;
+      const auto& uri = attr.namespace_uri;
       std::string fully_qualified =
           ns_uri_to_prefix.count(uri) == 0
               ? attr_name
               : (ns_uri_to_prefix.at(uri) + ":" + attr_name);
       if (attributes_to_read.count(fully_qualified) > 0) {
-        always_assert_log(!pb_attr.has_compiled_item(),
+        always_assert_log(!attr.has_compiled_item,
                           "Only supporting string values for attributes. "
                           "Given attribute: %s",
                           fully_qualified.c_str());
-        auto value = pb_attr.value();
-        out_attributes->emplace(fully_qualified, value);
+        out_attributes->emplace(fully_qualified, attr.value);
       }
     }
   }
@@ -490,28 +658,50 @@ void BundleResources::collect_layout_classes_and_attributes_for_file(
         9,
         "BundleResources collecting classes and attributes for file: %s",
         file_path.c_str());
-  read_protobuf_file_contents(
-      file_path,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        if (pb_node.ParseFromCodedStream(&input)) {
-          if (pb_node.has_element()) {
-            const auto& root = pb_node.element();
-            std::unordered_map<std::string, std::string> ns_uri_to_prefix;
-            for (const auto& ns_decl : root.namespace_declaration()) {
-              if (!ns_decl.uri().empty() && !ns_decl.prefix().empty()) {
-                ns_uri_to_prefix.emplace(ns_decl.uri(), ns_decl.prefix());
-              }
-            }
-            traverse_element_and_children(
-                root, [&](const aapt::pb::XmlElement& element) {
-                  collect_layout_classes_and_attributes_for_element(
-                      element, ns_uri_to_prefix, attributes_to_read,
-                      out_classes, out_attributes);
-                  return true;
-                });
+  redex::read_file_with_contents(file_path, [&](const char* data, size_t size) {
+    if (size == 0) {
+      fprintf(stderr, "Unable to read protobuf file: %s\n", file_path.c_str());
+      return;
+    }
+    std::unordered_map<std::string, std::string> ns_uri_to_prefix;
+    // Nothing is reported from a file that fails to parse.
+    std::unordered_set<std::string> classes;
+    std::unordered_multimap<std::string, std::string> attributes;
+    bool is_root = true;
+    // Elements are visited breadth-first, like
+    // traverse_element_and_children does.
+    std::queue<std::pair<const uint8_t*, int>> q;
+    q.emplace(reinterpret_cast<const uint8_t*>(data), static_cast<int>(size));
+    while (!q.empty()) {
+      auto slice = q.front();
+      q.pop();
+      StreamedElement element;
+      if (!read_node(slice.first, slice.second, &element)) {
+        TRACE(RES, 1, "Unable to parse layout %s", file_path.c_str());
+        return;
+      }
+      if (is_root) {
+        is_root = false;
+        for (const auto& ns_decl : element.namespace_declarations) {
+          if (!ns_decl.first.empty() && !ns_decl.second.empty()) {
+            ns_uri_to_prefix.emplace(ns_decl.first, ns_decl.second);
           }
         }
-      });
+      }
+      if (element.name.empty() && element.attributes.empty() &&
+          element.children.empty()) {
+        // A text node.
+        continue;
+      }
+      collect_layout_classes_and_attributes_for_element(
+          element, ns_uri_to_prefix, attributes_to_read, &classes,
+          &attributes);
+      for (const auto& child : element.children) {
+        q.push(child);
+      }
+    }
+    out_classes->merge(classes);
+    out_attributes->merge(attributes);
+  });
 }
 #endif // HAS_PROTOBUF
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ChromeTrace.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace chrome_trace {
+
+namespace detail {
+std::atomic<bool> s_enabled{false};
+} // namespace detail
+
+namespace {
+
+// Work items on the same worker that start within this long after the
+// previous one ended are merged into one event.
+constexpr auto kMergeGap = std::chrono::microseconds(50);
+
+// Timers and passes go on this thread; worker `i` goes on thread `i + 1`.
+constexpr unsigned int kMainTid = 0;
+
+struct Event {
+  std::string name;
+  const char* category;
+  clock::time_point begin;
+  clock::time_point end;
+  unsigned int tid;
+  size_t items;
+};
+
+struct State {
+  std::mutex lock;
+  std::string path;
+  clock::time_point epoch;
+  std::vector<Event> events;
+  unsigned int max_worker_tid{0};
+};
+
+// Intentionally leaked: worker threads may flush their last events while
+// static destructors run.
+State& state() {
+  static State* s_state = new State();
+  return *s_state;
+}
+
+void add_event(Event&& event) {
+  auto& s = state();
+  std::lock_guard<std::mutex> guard(s.lock);
+  if (event.tid > s.max_worker_tid) {
+    s.max_worker_tid = event.tid;
+  }
+  s.events.emplace_back(std::move(event));
+}
+
+// The work items of the current thread that have not been recorded yet. The
+// threads of the work queues are long-lived, so `finish` flushes the pending
+// work of all threads rather than relying on thread exit.
+struct PendingWork;
+
+struct PendingRegistry {
+  std::mutex lock;
+  std::unordered_set<PendingWork*> all;
+};
+
+// Intentionally leaked, like the state.
+PendingRegistry& pending_registry() {
+  static PendingRegistry* s_registry = new PendingRegistry();
+  return *s_registry;
+}
+
+struct PendingWork {
+  // Guards the fields below against a concurrent `finish`.
+  std::mutex lock;
+  bool active{false};
+  unsigned int tid{0};
+  clock::time_point begin;
+  clock::time_point end;
+  size_t items{0};
+
+  PendingWork() {
+    auto& r = pending_registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.all.insert(this);
+  }
+
+  ~PendingWork() {
+    {
+      auto& r = pending_registry();
+      std::lock_guard<std::mutex> guard(r.lock);
+      r.all.erase(this);
+    }
+    std::lock_guard<std::mutex> guard(lock);
+    flush();
+  }
+
+  // Requires `lock`.
+  void flush() {
+    if (active) {
+      add_event(Event{"work", "work_item", begin, end, tid, items});
+      active = false;
+    }
+  }
+};
+
+PendingWork& pending_work() {
+  static thread_local PendingWork s_pending;
+  return s_pending;
+}
+
+void flush_all_pending_work() {
+  auto& r = pending_registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  for (auto* pending : r.all) {
+    std::lock_guard<std::mutex> pending_guard(pending->lock);
+    pending->flush();
+  }
+}
+
+void write_escaped(std::ostream& os, const std::string& str) {
+  static const char* hex = "0123456789abcdef";
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (c < 0x20) {
+      os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      os << c;
+    }
+  }
+}
+
+uint64_t to_micros(clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+
+struct EnableFromEnv {
+  EnableFromEnv() {
+    const char* path = std::getenv("REDEX_CHROME_TRACE");
+    if (path != nullptr && *path != '\0') {
+      start(path);
+    }
+  }
+};
+EnableFromEnv s_enable_from_env;
+
+} // namespace
+
+void start(const std::string& path) {
+  auto& s = state();
+  {
+    std::lock_guard<std::mutex> guard(s.lock);
+    s.path = path;
+    s.epoch = clock::now();
+    s.events.clear();
+  }
+  detail::s_enabled = true;
+}
+
+void finish() {
+  if (!enabled()) {
+    return;
+  }
+  flush_all_pending_work();
+  detail::s_enabled = false;
+
+  auto& s = state();
+  std::lock_guard<std::mutex> guard(s.lock);
+  std::ofstream os(s.path);
+  os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << kMainTid
+     << ",\"args\":{\"name\":\"redex\"}}";
+  for (unsigned int tid = 1; tid <= s.max_worker_tid; ++tid) {
+    os << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+       << ",\"args\":{\"name\":\"worker " << (tid - 1) << "\"}}";
+  }
+  for (const auto& e : s.events) {
+    os << ",\n{\"name\":\"";
+    write_escaped(os, e.name);
+    os << "\",\"cat\":\"" << e.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+       << e.tid << ",\"ts\":" << to_micros(e.begin - s.epoch)
+       << ",\"dur\":" << to_micros(e.end - e.begin);
+    if (e.items > 0) {
+      os << ",\"args\":{\"items\":" << e.items << "}";
+    }
+    os << "}";
+  }
+  os << "\n]}\n";
+  s.events.clear();
+}
+
+void complete_event(const std::string& name,
+                    const char* category,
+                    clock::time_point begin,
+                    clock::time_point end) {
+  add_event(Event{name, category, begin, end, kMainTid, 0});
+}
+
+void work_item(unsigned int worker_id,
+               clock::time_point begin,
+               clock::time_point end) {
+  auto& pending = pending_work();
+  std::lock_guard<std::mutex> guard(pending.lock);
+  unsigned int tid = worker_id + 1;
+  if (pending.active && pending.tid == tid &&
+      begin - pending.end <= kMergeGap) {
+    pending.end = end;
+    ++pending.items;
+    return;
+  }
+  pending.flush();
+  pending.active = true;
+  pending.tid = tid;
+  pending.begin = begin;
+  pending.end = end;
+  pending.items = 1;
+}
+
+} // namespace chrome_trace
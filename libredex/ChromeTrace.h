@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/**
+ * Records a timeline of what Redex is doing and writes it out in the Chrome
+ * trace event format, which can be loaded into chrome://tracing or Perfetto.
+ *
+ * Recording is off unless the REDEX_CHROME_TRACE environment variable names
+ * an output file, or start() is called. When it is on, every Timer scope,
+ * every pass and the items processed by each work queue worker are recorded.
+ * Consecutive work items on the same worker are merged into a single event
+ * when the gap between them is negligible, which keeps traces of passes with
+ * millions of items manageable while still showing idle workers.
+ */
+namespace chrome_trace {
+
+using clock = std::chrono::steady_clock;
+
+namespace detail {
+extern std::atomic<bool> s_enabled;
+} // namespace detail
+
+inline bool enabled() {
+  return detail::s_enabled.load(std::memory_order_relaxed);
+}
+
+// Start recording; events will be written to `path` by finish().
+void start(const std::string& path);
+
+// Stop recording and write the trace file, if recording was enabled.
+void finish();
+
+// Record an event that began at `begin` and ended at `end`.
+void complete_event(const std::string& name,
+                    const char* category,
+                    clock::time_point begin,
+                    clock::time_point end);
+
+// Record that the calling thread processed one work item as worker
+// `worker_id` of a work queue.
+void work_item(unsigned int worker_id,
+               clock::time_point begin,
+               clock::time_point end);
+
+// Record the lifetime of this object as an event.
+class ScopedEvent {
+ public:
+  ScopedEvent(std::string name, const char* category)
+      : m_enabled(enabled()), m_name(std::move(name)), m_category(category) {
+    if (m_enabled) {
+      m_begin = clock::now();
+    }
+  }
+
+  ~ScopedEvent() {
+    if (m_enabled) {
+      complete_event(m_name, m_category, m_begin, clock::now());
+    }
+  }
+
+  ScopedEvent(const ScopedEvent&) = delete;
+  ScopedEvent& operator=(const ScopedEvent&) = delete;
+
+ private:
+  bool m_enabled;
+  std::string m_name;
+  const char* m_category;
+  clock::time_point m_begin;
+};
+
+// Record the lifetime of this object as a work item of worker `worker_id`.
+class ScopedWorkItem {
+ public:
+  explicit ScopedWorkItem(unsigned int worker_id)
+      : m_enabled(enabled()), m_worker_id(worker_id) {
+    if (m_enabled) {
+      m_begin = clock::now();
+    }
+  }
+
+  ~ScopedWorkItem() {
+    if (m_enabled) {
+      work_item(m_worker_id, m_begin, clock::now());
+    }
+  }
+
+  ScopedWorkItem(const ScopedWorkItem&) = delete;
+  ScopedWorkItem& operator=(const ScopedWorkItem&) = delete;
+
+ private:
+  bool m_enabled;
+  unsigned int m_worker_id;
+  clock::time_point m_begin;
+};
+
+} // namespace chrome_trace
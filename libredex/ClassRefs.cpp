@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ClassRefs.h"
+
+#include <algorithm>
+
+#include "DexUtil.h"
+#include "WorkQueue.h"
+
+namespace class_refs {
+
+Refs gather(const DexClass* cls) {
+  Refs refs;
+  auto& method_refs = refs.method_refs;
+  auto& field_refs = refs.field_refs;
+  auto& types = refs.types;
+  auto& strings = refs.strings;
+  cls->gather_methods(method_refs);
+  cls->gather_fields(field_refs);
+  cls->gather_types(types);
+  cls->gather_strings(strings);
+
+  // remove duplicates to speed up actual sorting
+  sort_unique(method_refs);
+  sort_unique(field_refs);
+  sort_unique(types);
+  sort_unique(strings);
+
+  // sort deterministically
+  std::sort(method_refs.begin(), method_refs.end(), compare_dexmethods);
+  std::sort(field_refs.begin(), field_refs.end(), compare_dexfields);
+  std::sort(types.begin(), types.end(), compare_dextypes);
+  std::sort(strings.begin(), strings.end(), compare_dexstrings);
+  return refs;
+}
+
+void Cache::prefetch(const std::vector<DexClass*>& classes) {
+  std::vector<DexClass*> missing;
+  for (auto cls : classes) {
+    if (!m_refs.count(cls)) {
+      missing.push_back(cls);
+    }
+  }
+  workqueue_run<DexClass*>(
+      [&](DexClass* cls) {
+        m_refs.emplace(cls, std::make_shared<const Refs>(gather(cls)));
+      },
+      missing);
+}
+
+std::shared_ptr<const Refs> Cache::get(const DexClass* cls) {
+  auto refs = m_refs.get(cls, nullptr);
+  if (refs) {
+    return refs;
+  }
+  refs = std::make_shared<const Refs>(gather(cls));
+  if (!m_refs.emplace(cls, refs)) {
+    // Another thread was faster.
+    return m_refs.at(cls);
+  }
+  return refs;
+}
+
+} // namespace class_refs
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+#include "DexClass.h"
+
+/*
+ * The method, field, type and string references of classes, as gathered by
+ * DexClass::gather_*. Dex layout needs them for every class, possibly several
+ * times, and gathering them means walking all of the code of the class.
+ */
+namespace class_refs {
+
+struct Refs {
+  // Each without duplicates, and sorted deterministically.
+  std::vector<DexMethodRef*> method_refs;
+  std::vector<DexFieldRef*> field_refs;
+  std::vector<DexType*> types;
+  std::vector<DexString*> strings;
+};
+
+Refs gather(const DexClass* cls);
+
+/*
+ * Memoizes gather(). It is safe to use concurrently, but it doesn't notice
+ * changes to the classes: whoever adds, removes or rewrites members of a
+ * cached class must invalidate it.
+ */
+class Cache {
+ public:
+  // Gathers, in parallel, the refs of the given classes that aren't cached.
+  void prefetch(const std::vector<DexClass*>& classes);
+
+  std::shared_ptr<const Refs> get(const DexClass* cls);
+
+  void invalidate(const DexClass* cls) { m_refs.erase(cls); }
+
+  size_t size() const { return m_refs.size(); }
+
+ private:
+  ConcurrentMap<const DexClass*, std::shared_ptr<const Refs>> m_refs;
+};
+
+} // namespace class_refs
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CompactClassHierarchy.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+CompactClassHierarchy::CompactClassHierarchy(const Scope& scope)
+    : CompactClassHierarchy(build_type_hierarchy(scope)) {}
+
+CompactClassHierarchy::CompactClassHierarchy(const ClassHierarchy& hierarchy)
+    : CompactClassHierarchy(hierarchy, build_interface_map(hierarchy)) {}
+
+CompactClassHierarchy::CompactClassHierarchy(const ClassHierarchy& hierarchy,
+                                             const InterfaceMap& interfaces) {
+  std::unordered_set<const DexType*> children;
+  for (const auto& pair : hierarchy) {
+    children.insert(pair.second.begin(), pair.second.end());
+  }
+  std::vector<const DexType*> roots;
+  for (const auto& pair : hierarchy) {
+    if (!children.count(pair.first)) {
+      roots.push_back(pair.first);
+    }
+  }
+  std::sort(roots.begin(), roots.end(), compare_dextypes);
+
+  // Number the types in preorder, without recursing, as hierarchies can be
+  // deep. A type has a single superclass; should it still be reached twice,
+  // only the first parent counts.
+  auto visit = [&](const DexType* type) {
+    m_index[type] = m_preorder.size();
+    m_preorder.push_back(type);
+    m_end.push_back(NONE);
+  };
+  struct Frame {
+    uint32_t index;
+    TypeSet::const_iterator next_child;
+    TypeSet::const_iterator end;
+  };
+  std::vector<Frame> stack;
+  for (auto root : roots) {
+    visit(root);
+    const auto& root_children = ::get_children(hierarchy, root);
+    stack.push_back({m_index.at(root), root_children.begin(),
+                     root_children.end()});
+    while (!stack.empty()) {
+      auto& frame = stack.back();
+      if (frame.next_child == frame.end) {
+        m_end[frame.index] = m_preorder.size();
+        stack.pop_back();
+        continue;
+      }
+      auto child = *frame.next_child++;
+      if (m_index.at(child) != NONE) {
+        continue;
+      }
+      visit(child);
+      const auto& grandchildren = ::get_children(hierarchy, child);
+      stack.push_back(
+          {m_index.at(child), grandchildren.begin(), grandchildren.end()});
+    }
+  }
+
+  m_children_begin.reserve(m_preorder.size() + 1);
+  for (auto type : m_preorder) {
+    m_children_begin.push_back(m_children.size());
+    for (auto child : ::get_children(hierarchy, type)) {
+      m_children.push_back(child);
+    }
+  }
+  m_children_begin.push_back(m_children.size());
+
+  std::vector<const DexType*> sorted_interfaces;
+  sorted_interfaces.reserve(interfaces.size());
+  for (const auto& pair : interfaces) {
+    sorted_interfaces.push_back(pair.first);
+  }
+  std::sort(sorted_interfaces.begin(), sorted_interfaces.end(),
+            compare_dextypes);
+  m_implementors_begin.reserve(sorted_interfaces.size() + 1);
+  for (auto intf : sorted_interfaces) {
+    m_interface_index[intf] = m_implementors_begin.size();
+    m_implementors_begin.push_back(m_implementors.size());
+    auto begin = m_implementors.size();
+    for (auto impl : interfaces.at(intf)) {
+      if (index_of(impl) != NONE) {
+        m_implementors.push_back(impl);
+      }
+    }
+    std::sort(m_implementors.begin() + begin, m_implementors.end(),
+              [this](const DexType* a, const DexType* b) {
+                return index_of(a) < index_of(b);
+              });
+  }
+  m_implementors_begin.push_back(m_implementors.size());
+}
+
+CompactClassHierarchy::TypeRange CompactClassHierarchy::get_children(
+    const DexType* type) const {
+  auto i = index_of(type);
+  if (i == NONE) {
+    return range(m_children, 0, 0);
+  }
+  return range(m_children, m_children_begin[i], m_children_begin[i + 1]);
+}
+
+CompactClassHierarchy::TypeRange CompactClassHierarchy::get_all_children(
+    const DexType* type) const {
+  auto i = index_of(type);
+  if (i == NONE) {
+    return range(m_preorder, 0, 0);
+  }
+  return range(m_preorder, i + 1, m_end[i]);
+}
+
+CompactClassHierarchy::TypeRange CompactClassHierarchy::get_all_implementors(
+    const DexType* intf) const {
+  auto i = intf == nullptr ? NONE : m_interface_index.at(intf);
+  if (i == NONE) {
+    return range(m_implementors, 0, 0);
+  }
+  return range(m_implementors, m_implementors_begin[i],
+               m_implementors_begin[i + 1]);
+}
+
+bool CompactClassHierarchy::implements(const DexType* cls,
+                                       const DexType* intf) const {
+  auto c = index_of(cls);
+  if (c == NONE) {
+    return false;
+  }
+  auto implementors = get_all_implementors(intf);
+  return std::binary_search(implementors.begin(), implementors.end(), cls,
+                            [this](const DexType* a, const DexType* b) {
+                              return index_of(a) < index_of(b);
+                            });
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/range/iterator_range.hpp>
+#include <limits>
+#include <vector>
+
+#include "ClassHierarchy.h"
+#include "DenseSideTable.h"
+
+/*
+ * An immutable, flat encoding of a ClassHierarchy and of its InterfaceMap,
+ * for passes that query them in inner loops.
+ *
+ * The types are numbered in DFS preorder over the hierarchy, so that all the
+ * subclasses of a type follow it contiguously. Subclass checks are then two
+ * comparisons, and the (direct or transitive) children of a type are ranges
+ * of arrays rather than trees of sets. Types are looked up by their dense ID.
+ *
+ * Unlike the ClassHierarchy, the ranges of children are in DFS order, not
+ * sorted by name.
+ */
+class CompactClassHierarchy {
+ public:
+  using TypeRange =
+      boost::iterator_range<std::vector<const DexType*>::const_iterator>;
+
+  explicit CompactClassHierarchy(const Scope& scope);
+
+  explicit CompactClassHierarchy(const ClassHierarchy& hierarchy);
+
+  // `interfaces` must be build_interface_map(hierarchy).
+  CompactClassHierarchy(const ClassHierarchy& hierarchy,
+                        const InterfaceMap& interfaces);
+
+  // Whether `child` is `parent` or one of its subclasses. Unlike
+  // type::is_subclass, this doesn't walk up from the `child`.
+  bool is_subclass(const DexType* parent, const DexType* child) const {
+    auto p = index_of(parent);
+    auto c = index_of(child);
+    return p != NONE && c != NONE && p <= c && c < m_end[p];
+  }
+
+  // The direct subclasses of `type`.
+  TypeRange get_children(const DexType* type) const;
+
+  // All the subclasses of `type`, excluding itself.
+  TypeRange get_all_children(const DexType* type) const;
+
+  // All the classes implementing `intf`, directly or not, as
+  // build_interface_map() computes them, in DFS order.
+  TypeRange get_all_implementors(const DexType* intf) const;
+
+  bool implements(const DexType* cls, const DexType* intf) const;
+
+  size_t size() const { return m_preorder.size(); }
+
+ private:
+  static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+  uint32_t index_of(const DexType* type) const {
+    return type == nullptr ? NONE : m_index.at(type);
+  }
+
+  TypeRange range(const std::vector<const DexType*>& types,
+                  size_t begin,
+                  size_t end) const {
+    return TypeRange(types.begin() + begin, types.begin() + end);
+  }
+
+  // The preorder index of each type, or NONE.
+  DenseSideTable<DexType, uint32_t> m_index{NONE};
+  std::vector<const DexType*> m_preorder;
+  // The preorder index following the last subclass of each type.
+  std::vector<uint32_t> m_end;
+  // The direct children of the type at preorder index i are
+  // m_children[m_children_begin[i], m_children_begin[i + 1]).
+  std::vector<uint32_t> m_children_begin;
+  std::vector<const DexType*> m_children;
+  // Likewise, the implementors of interfaces, by the DenseSideTable index
+  // m_interface_index, sorted by preorder index.
+  DenseSideTable<DexType, uint32_t> m_interface_index{NONE};
+  std::vector<uint32_t> m_implementors_begin;
+  std::vector<const DexType*> m_implementors;
+};
@@ -7,12 +7,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <boost/thread.hpp>
 
@@ -522,6 +529,326 @@ class InsertOnlyConcurrentSet final
   size_t erase(const Key& key) = delete;
 };
 
+/*
+ * A concurrent map tuned for read-mostly tables, like the interning table of
+ * protos in RedexContext. Readers (`get`, `at`, `count`) never take a lock;
+ * writers (`emplace`, `erase`) lock the slot determined by the hash of the key.
+ *
+ * Each slot is an open-addressing hash table with linear probing that stores
+ * entries inline, so there is no per-entry allocation. An entry is never
+ * modified once it has been published: erasing only marks the cell as deleted,
+ * and cells are recycled by rehashing into a fresh table. Tables that have
+ * been replaced may still be scanned by concurrent readers, so they are only
+ * freed by `clear()` and by the destructor. This makes the map a poor fit for
+ * workloads dominated by erasure; use `ConcurrentMap` for those.
+ *
+ * Keys and values must be trivially destructible (pointers, PODs) and values
+ * cannot be updated in place.
+ */
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename Equal = std::equal_to<Key>,
+          size_t n_slots = 31>
+class ReadMostlyConcurrentMap final {
+ public:
+  static_assert(n_slots > 0, "The concurrent container has no slots");
+  static_assert(std::is_trivially_destructible<Key>::value &&
+                    std::is_trivially_destructible<Value>::value,
+                "Keys and values must be trivially destructible");
+
+  using value_type = std::pair<const Key, Value>;
+
+ private:
+  enum CellState : uint8_t { EMPTY, FULL, DELETED };
+
+  struct Cell {
+    std::atomic<uint8_t> state{EMPTY};
+    typename std::aligned_storage<sizeof(value_type),
+                                  alignof(value_type)>::type storage;
+
+    const value_type& entry() const {
+      return *reinterpret_cast<const value_type*>(&storage);
+    }
+  };
+
+  struct Table {
+    explicit Table(size_t capacity)
+        : capacity(capacity), cells(new Cell[capacity]) {}
+    const size_t capacity; // Always a power of two.
+    std::unique_ptr<Cell[]> cells;
+  };
+
+  struct Slot {
+    std::atomic<Table*> table{nullptr};
+    // Number of live entries, and of cells that are either live or deleted.
+    std::atomic<size_t> size{0};
+    size_t used{0};
+    // The current table is the last element.
+    std::vector<std::unique_ptr<Table>> tables;
+    mutable boost::mutex lock;
+  };
+
+  static constexpr size_t MIN_CAPACITY = 16;
+
+  // Spread the hash bits before masking, as many hash functions (e.g. for
+  // pointers) have poor low bits.
+  static size_t home(size_t hash, const Table* table) {
+    return ((hash * 0x9E3779B97F4A7C15ull) >> 17) & (table->capacity - 1);
+  }
+
+  static const Cell* find_in(const Table* table, size_t hash, const Key& key) {
+    if (table == nullptr) {
+      return nullptr;
+    }
+    size_t mask = table->capacity - 1;
+    for (size_t i = home(hash, table);; i = (i + 1) & mask) {
+      const Cell& cell = table->cells[i];
+      auto state = cell.state.load(std::memory_order_acquire);
+      if (state == EMPTY) {
+        return nullptr;
+      }
+      if (state == FULL && Equal()(cell.entry().first, key)) {
+        return &cell;
+      }
+    }
+  }
+
+  const Cell* find_cell(size_t hash, const Key& key) const {
+    const Slot& slot = m_slots[hash % n_slots];
+    return find_in(slot.table.load(std::memory_order_acquire), hash, key);
+  }
+
+  // Must be called with the slot locked.
+  static void rehash(Slot& slot, size_t min_size) {
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < 2 * min_size) {
+      capacity *= 2;
+    }
+    auto new_table = std::make_unique<Table>(capacity);
+    Table* old_table = slot.table.load(std::memory_order_relaxed);
+    if (old_table != nullptr) {
+      for (size_t i = 0; i < old_table->capacity; ++i) {
+        const Cell& cell = old_table->cells[i];
+        if (cell.state.load(std::memory_order_relaxed) == FULL) {
+          place(new_table.get(), Hash()(cell.entry().first), cell.entry());
+        }
+      }
+    }
+    slot.used = slot.size.load(std::memory_order_relaxed);
+    slot.table.store(new_table.get(), std::memory_order_release);
+    slot.tables.push_back(std::move(new_table));
+  }
+
+  // Must be called with the slot locked, and with a free cell available.
+  static void place(Table* table, size_t hash, const value_type& entry) {
+    size_t mask = table->capacity - 1;
+    for (size_t i = home(hash, table);; i = (i + 1) & mask) {
+      Cell& cell = table->cells[i];
+      if (cell.state.load(std::memory_order_relaxed) == EMPTY) {
+        new (&cell.storage) value_type(entry);
+        cell.state.store(FULL, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+ public:
+  class const_iterator {
+   public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = ReadMostlyConcurrentMap::value_type;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+    using iterator_category = std::forward_iterator_tag;
+
+    const_iterator(const Slot* slots, size_t slot, size_t cell)
+        : m_slots(slots), m_slot(slot), m_cell(cell) {
+      skip_free_cells();
+    }
+
+    const_iterator& operator++() {
+      ++m_cell;
+      skip_free_cells();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator retval = *this;
+      ++(*this);
+      return retval;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return m_slots == other.m_slots && m_slot == other.m_slot &&
+             m_cell == other.m_cell;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+    reference operator*() const { return table()->cells[m_cell].entry(); }
+
+    pointer operator->() const { return &**this; }
+
+   private:
+    const Table* table() const {
+      return m_slots[m_slot].table.load(std::memory_order_acquire);
+    }
+
+    void skip_free_cells() {
+      while (m_slot < n_slots) {
+        auto t = table();
+        if (t != nullptr) {
+          for (; m_cell < t->capacity; ++m_cell) {
+            if (t->cells[m_cell].state.load(std::memory_order_acquire) ==
+                FULL) {
+              return;
+            }
+          }
+        }
+        ++m_slot;
+        m_cell = 0;
+      }
+    }
+
+    const Slot* m_slots;
+    size_t m_slot;
+    size_t m_cell;
+  };
+
+  ReadMostlyConcurrentMap() = default;
+
+  ReadMostlyConcurrentMap(const ReadMostlyConcurrentMap&) = delete;
+  ReadMostlyConcurrentMap& operator=(const ReadMostlyConcurrentMap&) = delete;
+
+  /*
+   * Using iterators while the map is concurrently modified will result in
+   * undefined behavior.
+   */
+  const_iterator begin() const { return const_iterator(m_slots, 0, 0); }
+
+  const_iterator end() const { return const_iterator(m_slots, n_slots, 0); }
+
+  /*
+   * This operation is always thread-safe and lock-free.
+   */
+  Value get(const Key& key, Value default_value) const {
+    auto cell = find_cell(Hash()(key), key);
+    return cell == nullptr ? default_value : cell->entry().second;
+  }
+
+  /*
+   * This operation is always thread-safe and lock-free. Throws
+   * std::out_of_range if the key is not in the map.
+   */
+  Value at(const Key& key) const {
+    auto cell = find_cell(Hash()(key), key);
+    if (cell == nullptr) {
+      throw std::out_of_range("ReadMostlyConcurrentMap::at");
+    }
+    return cell->entry().second;
+  }
+
+  /*
+   * This operation is always thread-safe and lock-free.
+   */
+  size_t count(const Key& key) const {
+    return find_cell(Hash()(key), key) == nullptr ? 0 : 1;
+  }
+
+  /*
+   * The Boolean return value denotes whether the insertion took place.
+   * This operation is always thread-safe.
+   */
+  bool emplace(const Key& key, const Value& value) {
+    size_t hash = Hash()(key);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    Table* table = slot.table.load(std::memory_order_relaxed);
+    if (find_in(table, hash, key) != nullptr) {
+      return false;
+    }
+    auto size = slot.size.load(std::memory_order_relaxed);
+    // Keep the load factor, including deleted cells, below 3/4.
+    if (table == nullptr || 4 * (slot.used + 1) > 3 * table->capacity) {
+      rehash(slot, size + 1);
+      table = slot.table.load(std::memory_order_relaxed);
+    }
+    place(table, hash, value_type(key, value));
+    slot.size.store(size + 1, std::memory_order_relaxed);
+    ++slot.used;
+    return true;
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  bool insert(const std::pair<Key, Value>& entry) {
+    return emplace(entry.first, entry.second);
+  }
+
+  /*
+   * This operation is always thread-safe.
+   */
+  size_t erase(const Key& key) {
+    size_t hash = Hash()(key);
+    Slot& slot = m_slots[hash % n_slots];
+    boost::lock_guard<boost::mutex> lock(slot.lock);
+    Table* table = slot.table.load(std::memory_order_relaxed);
+    auto cell = const_cast<Cell*>(find_in(table, hash, key));
+    if (cell == nullptr) {
+      return 0;
+    }
+    cell->state.store(DELETED, std::memory_order_release);
+    slot.size.fetch_sub(1, std::memory_order_relaxed);
+    return 1;
+  }
+
+  size_t size() const {
+    size_t s = 0;
+    for (size_t i = 0; i < n_slots; ++i) {
+      s += m_slots[i].size.load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  bool empty() const { return size() == 0; }
+
+  /*
+   * This operation is not thread-safe.
+   */
+  void reserve(size_t capacity) {
+    size_t slot_capacity = capacity / n_slots;
+    for (size_t i = 0; i < n_slots; ++i) {
+      auto& slot = m_slots[i];
+      auto table = slot.table.load(std::memory_order_relaxed);
+      if (table == nullptr || 4 * slot_capacity > 3 * table->capacity) {
+        rehash(slot, std::max(slot_capacity,
+                              slot.size.load(std::memory_order_relaxed)));
+      }
+    }
+  }
+
+  /*
+   * This operation is not thread-safe. It also releases the tables that were
+   * retired by rehashing.
+   */
+  void clear() {
+    for (size_t i = 0; i < n_slots; ++i) {
+      auto& slot = m_slots[i];
+      slot.table.store(nullptr, std::memory_order_relaxed);
+      slot.tables.clear();
+      slot.size.store(0, std::memory_order_relaxed);
+      slot.used = 0;
+    }
+  }
+
+ private:
+  Slot m_slots[n_slots];
+};
+
 namespace cc_impl {
 
 template <typename Container, size_t n_slots>
@@ -8,6 +8,7 @@
 #include "ConfigFiles.h"
 
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <json/json.h>
 #include <string>
@@ -19,6 +20,8 @@
 #include "InlinerConfig.h"
 #include "MethodProfiles.h"
 #include "ProguardMap.h"
+#include "Timer.h"
+#include "WorkQueue.h"
 
 ConfigFiles::ConfigFiles(const Json::Value& config, const std::string& outdir)
     : m_json(config),
@@ -56,7 +59,8 @@ ConfigFiles::~ConfigFiles() {
  * This function relies on the g_redex.
  */
 const std::unordered_set<DexType*>& ConfigFiles::get_no_optimizations_annos() {
-  if (m_no_optimizations_annos.empty()) {
+  if (!m_no_optimizations_annos_loaded) {
+    m_no_optimizations_annos_loaded = true;
     Json::Value no_optimizations_anno;
     m_json.get("no_optimizations_annotations", Json::nullValue,
                no_optimizations_anno);
@@ -75,7 +79,8 @@ const std::unordered_set<DexType*>& ConfigFiles::get_no_optimizations_annos() {
  * This function relies on the g_redex.
  */
 const std::unordered_set<DexMethodRef*>& ConfigFiles::get_pure_methods() {
-  if (m_pure_methods.empty()) {
+  if (!m_pure_methods_loaded) {
+    m_pure_methods_loaded = true;
     Json::Value pure_methods;
     m_json.get("pure_methods", Json::nullValue, pure_methods);
     if (!pure_methods.empty()) {
@@ -93,7 +98,8 @@ const std::unordered_set<DexMethodRef*>& ConfigFiles::get_pure_methods() {
  * This function relies on the g_redex.
  */
 const std::unordered_set<DexString*>& ConfigFiles::get_finalish_field_names() {
-  if (m_finalish_field_names.empty()) {
+  if (!m_finalish_field_names_loaded) {
+    m_finalish_field_names_loaded = true;
     Json::Value finalish_field_names;
     m_json.get("finalish_field_names", Json::nullValue, finalish_field_names);
     if (!finalish_field_names.empty()) {
@@ -236,7 +242,12 @@ void ConfigFiles::load_inliner_config(inliner::InlinerConfig* inliner_config) {
   jw.get("run_local_dce", false, shrinker_config.run_local_dce);
   jw.get("run_reg_alloc", false, shrinker_config.run_reg_alloc);
   jw.get("run_dedup_blocks", false, shrinker_config.run_dedup_blocks);
+  jw.get("const_prop_max_steps", (size_t)0,
+         shrinker_config.const_prop_max_steps);
+  jw.get("const_prop_max_ms", (size_t)0, shrinker_config.const_prop_max_ms);
   jw.get("debug", false, inliner_config->debug);
+  jw.get("profile_guided_budget", (size_t)0,
+         inliner_config->profile_guided_budget);
   jw.get("blocklist", {}, inliner_config->m_blocklist);
   jw.get("caller_blocklist", {}, inliner_config->m_caller_blocklist);
   jw.get("intradex_allowlist", {}, inliner_config->m_intradex_allowlist);
@@ -280,6 +291,32 @@ void ConfigFiles::parse_global_config() {
   m_global_config.parse_config(m_json);
 }
 
+void ConfigFiles::preload(int32_t min_sdk_api) {
+  Timer t("Preloading config files");
+  // Each task loads inputs that no other task touches. The class lists
+  // include the coldstart classes, so they are loaded together.
+  std::vector<std::function<void()>> tasks{
+      [this] {
+        get_coldstart_classes();
+        ensure_class_lists_loaded();
+      },
+      [this] { ensure_agg_method_stats_loaded(); },
+      [this] { get_inliner_config(); },
+      [this] {
+        get_no_optimizations_annos();
+        get_pure_methods();
+        get_finalish_field_names();
+      },
+  };
+  if (get_android_sdk_api_file(min_sdk_api)) {
+    tasks.emplace_back([this, min_sdk_api] {
+      get_android_sdk_api(min_sdk_api);
+    });
+  }
+  workqueue_run<std::function<void()>>(
+      [](const std::function<void()>& task) { task(); }, tasks, tasks.size());
+}
+
 void ConfigFiles::load(const Scope& scope) {
   get_inliner_config();
   m_inliner_config->populate(scope);
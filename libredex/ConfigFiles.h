@@ -46,7 +46,8 @@ struct ConfigFiles {
   ~ConfigFiles();
 
   const std::vector<std::string>& get_coldstart_classes() {
-    if (m_coldstart_classes.empty()) {
+    if (!m_load_coldstart_classes_attempted) {
+      m_load_coldstart_classes_attempted = true;
       m_coldstart_classes = load_coldstart_classes();
     }
     return m_coldstart_classes;
@@ -57,6 +58,7 @@ struct ConfigFiles {
    */
   void update_coldstart_classes(
       std::vector<std::string> new_coldstart_classes) {
+    m_load_coldstart_classes_attempted = true;
     m_coldstart_classes = std::move(new_coldstart_classes);
   }
 
@@ -144,6 +146,15 @@ struct ConfigFiles {
 
   void parse_global_config();
 
+  /**
+   * Load all the inputs that the config declares, concurrently: the class
+   * lists, the method profiles, the inliner config, the framework API of
+   * `min_sdk_api` and the global sets of refs. The accessors load on first
+   * use otherwise, which is not thread-safe; after preloading, they only read.
+   * This relies on the g_redex, so the dexes must be loaded already.
+   */
+  void preload(int32_t min_sdk_api);
+
   /**
    * Load configurations with the initial scope.
    */
@@ -162,7 +173,11 @@ struct ConfigFiles {
   void ensure_agg_method_stats_loaded();
   void load_inliner_config(inliner::InlinerConfig*);
 
+  bool m_load_coldstart_classes_attempted{false};
   bool m_load_class_lists_attempted{false};
+  bool m_no_optimizations_annos_loaded{false};
+  bool m_pure_methods_loaded{false};
+  bool m_finalish_field_names_loaded{false};
   std::unique_ptr<ProguardMap> m_proguard_map;
   std::string m_coldstart_class_filename;
   std::vector<std::string> m_coldstart_classes;
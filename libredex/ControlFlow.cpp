@@ -13,12 +13,15 @@
 #include <stack>
 #include <utility>
 
+#include "ConcurrentContainers.h"
 #include "CppUtil.h"
 #include "DexInstruction.h"
 #include "DexPosition.h"
 #include "DexUtil.h"
+#include "Dominators.h"
 #include "GraphUtil.h"
 #include "IRList.h"
+#include "MonotonicFixpointIterator.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Transform.h"
@@ -152,6 +155,21 @@ std::string show_insn(const IRInstruction* insn) { return show(insn); }
 
 } // namespace details
 
+const ThrowInfo* ThrowInfo::make(DexType* catch_type, uint32_t index) {
+  struct Hash {
+    size_t operator()(const ThrowInfo& info) const {
+      size_t seed = 0;
+      boost::hash_combine(seed, info.catch_type);
+      boost::hash_combine(seed, info.index);
+      return seed;
+    }
+  };
+  // There are only as many of them as (catch type, index) pairs, so they are
+  // never freed.
+  static auto* interned = new InsertOnlyConcurrentSet<ThrowInfo, Hash>();
+  return interned->insert(ThrowInfo(catch_type, index)).first;
+}
+
 void Block::free() {
   for (auto& mie : *this) {
     switch (mie.type) {
@@ -779,20 +797,26 @@ void ControlFlowGraph::add_catch_edges(TryEnds& try_ends,
    * sequentially-numbered blocks, which is guaranteed because catch regions
    * are contiguous in the bytecode, and we generate blocks in bytecode order.
    */
+  std::vector<std::pair<Block*, const ThrowInfo*>> handlers;
   for (auto tep : try_ends) {
     auto try_end = tep.first;
     auto tryendblock = tep.second;
+    // The handlers of the region, with the information from their catch
+    // entries, are shared by the throw edges of all its blocks.
+    handlers.clear();
+    uint32_t i = 0;
+    for (auto mie = try_end->catch_start; mie != nullptr;
+         mie = mie->centry->next) {
+      handlers.emplace_back(try_catches.at(mie->centry),
+                            ThrowInfo::make(mie->centry->catch_type, i));
+      ++i;
+    }
     size_t bid = tryendblock->id();
     while (true) {
       Block* block = m_blocks.at(bid);
       if (ends_with_may_throw(block)) {
-        uint32_t i = 0;
-        for (auto mie = try_end->catch_start; mie != nullptr;
-             mie = mie->centry->next) {
-          auto catchblock = try_catches.at(mie->centry);
-          // Create a throw edge with the information from this catch entry
-          add_edge(block, catchblock, mie->centry->catch_type, i);
-          ++i;
+        for (const auto& handler : handlers) {
+          add_edge(block, handler.first, handler.second);
         }
       }
       auto block_begin = block->begin();
@@ -911,6 +935,9 @@ void ControlFlowGraph::simplify() {
 
 // remove blocks with no predecessors
 std::pair<uint32_t, bool> ControlFlowGraph::remove_unreachable_blocks() {
+  if (m_reachability_revision == m_structure_revision) {
+    return std::make_pair(0, false);
+  }
   uint32_t num_insns_removed = 0;
   remove_unreachable_succ_edges();
   std::vector<std::unique_ptr<DexPosition>> dangling;
@@ -943,12 +970,14 @@ std::pair<uint32_t, bool> ControlFlowGraph::remove_unreachable_blocks() {
       b->free();
       delete b;
       it = m_blocks.erase(it);
+      structure_changed();
     } else {
       ++it;
     }
   }
 
   fix_dangling_parents(std::move(dangling));
+  m_reachability_revision = m_structure_revision;
 
   return std::make_pair(num_insns_removed, registers_size_possibly_reduced);
 }
@@ -1046,7 +1075,7 @@ void ControlFlowGraph::remove_empty_blocks() {
       }
 
       if (b == entry_block()) {
-        m_entry_block = succ;
+        set_entry_block(succ);
       }
 
       // Move positions if succ doesn't have any
@@ -1094,6 +1123,7 @@ void ControlFlowGraph::remove_empty_blocks() {
     b->free();
     delete b;
     it = m_blocks.erase(it);
+    structure_changed();
   }
   fix_dangling_parents(std::move(dangling));
 }
@@ -1554,6 +1584,13 @@ std::vector<Block*> ControlFlowGraph::order(
   // We must simplify first to remove any unreachable blocks
   simplify();
 
+  // Without a custom strategy, the ordering only depends on the structure of
+  // the graph, so it is reused until that changes. This makes a linearize
+  // after an `order()` of the same graph, or a second `order()`, cheap.
+  if (!custom_strategy && m_order_revision == m_structure_revision) {
+    return m_order;
+  }
+
   // This is a modified Weak Topological Ordering (WTO). We create "chains" of
   // blocks that will be kept together, then feed these chains to WTO for it to
   // choose the ordering of the chains. Then, we deconstruct the chains to get
@@ -1578,6 +1615,10 @@ std::vector<Block*> ControlFlowGraph::order(
   // The entry block must always be first.
   redex_assert(m_entry_block == result.at(0));
 
+  if (!custom_strategy) {
+    m_order = result;
+    m_order_revision = m_structure_revision;
+  }
   return result;
 }
 
@@ -1971,10 +2012,56 @@ std::vector<Block*> ControlFlowGraph::blocks_reverse_post_deprecated() const {
 
 ControlFlowGraph::~ControlFlowGraph() { free_all_blocks_and_edges(); }
 
+namespace {
+
+template <typename T, typename Fn>
+std::shared_ptr<const T> get_or_compute(
+    std::pair<std::shared_ptr<const T>, uint64_t>* cache,
+    uint64_t revision,
+    const Fn& compute) {
+  if (!cache->first || cache->second != revision) {
+    *cache = std::make_pair(compute(), revision);
+  }
+  return cache->first;
+}
+
+} // namespace
+
+std::shared_ptr<const ControlFlowGraph::Dominators>
+ControlFlowGraph::get_dominators() const {
+  return get_or_compute(&m_dominators, m_structure_revision, [this] {
+    return std::make_shared<const Dominators>(*this);
+  });
+}
+
+std::shared_ptr<const ControlFlowGraph::PostDominators>
+ControlFlowGraph::get_post_dominators() const {
+  always_assert_log(m_exit_block != nullptr,
+                    "Post-dominators need an exit block");
+  return get_or_compute(&m_post_dominators, m_structure_revision, [this] {
+    return std::make_shared<const PostDominators>(*this);
+  });
+}
+
+std::shared_ptr<const ControlFlowGraph::WTO> ControlFlowGraph::get_wto() const {
+  return get_or_compute(&m_wto, m_structure_revision, [this] {
+    return std::make_shared<const WTO>(
+        m_entry_block, [](Block* const& block) {
+          std::vector<Block*> succs;
+          succs.reserve(block->succs().size());
+          for (auto* edge : block->succs()) {
+            succs.push_back(edge->target());
+          }
+          return succs;
+        });
+  });
+}
+
 Block* ControlFlowGraph::create_block() {
   size_t id = next_block_id();
   Block* b = new Block(this, id);
   m_blocks.emplace(id, b);
+  structure_changed();
   return b;
 }
 
@@ -2173,6 +2260,14 @@ void ControlFlowGraph::clear() {
   m_exit_block = nullptr;
 
   m_editable = true;
+
+  structure_changed();
+  m_reachability_revision = boost::none;
+  m_order.clear();
+  m_order_revision = boost::none;
+  m_dominators = {};
+  m_post_dominators = {};
+  m_wto = {};
 }
 
 // After `edges` have been removed from the graph,
@@ -2191,6 +2286,7 @@ void ControlFlowGraph::cleanup_deleted_edges(const EdgeSet& edges) {
         Edge* fwd_edge = remaining_forward_edges[0];
         fwd_edge->set_type(EDGE_GOTO);
         fwd_edge->set_case_key(boost::none);
+        structure_changed();
       }
     }
   }
@@ -2298,6 +2394,7 @@ void ControlFlowGraph::merge_blocks(Block* pred, Block* succ) {
   delete_pred_edges(succ);
   delete_succ_edges(succ);
   m_blocks.erase(succ->id());
+  structure_changed();
   delete succ;
 }
 
@@ -2327,6 +2424,7 @@ void ControlFlowGraph::move_edge(Edge* edge,
 
   edge->src()->m_succs.push_back(edge);
   edge->target()->m_preds.push_back(edge);
+  structure_changed();
 }
 
 bool ControlFlowGraph::blocks_are_in_same_try(const Block* b1,
@@ -2612,6 +2710,7 @@ uint32_t ControlFlowGraph::remove_blocks(const std::vector<Block*>& blocks) {
     auto num_removed = m_blocks.erase(id);
     always_assert_log(num_removed == 1,
                       "Block %zu wasn't in CFG. Attempted double delete?", id);
+    structure_changed();
     block->m_entries.clear_and_dispose();
     delete block;
   }
@@ -2711,6 +2810,51 @@ DexPosition* ControlFlowGraph::get_dbg_pos(const cfg::InstructionIterator& it) {
   return check_prev_block(it.block());
 }
 
+size_t ControlFlowGraph::remove_redundant_positions() {
+  std::unordered_set<DexPosition*> parents;
+  for (const auto& entry : m_blocks) {
+    for (const auto& mie : *entry.second) {
+      if (mie.type == MFLOW_POSITION && mie.pos->parent != nullptr) {
+        parents.insert(mie.pos->parent);
+      }
+    }
+  }
+  size_t removed = 0;
+  for (const auto& entry : m_blocks) {
+    auto& entries = entry.second->m_entries;
+    // The position in effect for the last instruction of this block, and the
+    // position that has not been followed by any instruction yet. A trailing
+    // position may still apply to a fallthrough successor after
+    // linearization, so we only ever drop positions followed by another one.
+    DexPosition* in_effect = nullptr;
+    auto pending = entries.end();
+    for (auto it = entries.begin(); it != entries.end();) {
+      if (it->type == MFLOW_OPCODE) {
+        if (pending != entries.end()) {
+          in_effect = pending->pos.get();
+          pending = entries.end();
+        }
+      } else if (it->type == MFLOW_POSITION) {
+        if (pending != entries.end() && !parents.count(pending->pos.get())) {
+          // Shadowed by this position before any instruction.
+          entries.erase_and_dispose(pending);
+          ++removed;
+        }
+        pending = entries.end();
+        if (in_effect != nullptr && *it->pos == *in_effect &&
+            !parents.count(it->pos.get())) {
+          it = entries.erase_and_dispose(it);
+          ++removed;
+          continue;
+        }
+        pending = it;
+      }
+      ++it;
+    }
+  }
+  return removed;
+}
+
 } // namespace cfg
 
 namespace {
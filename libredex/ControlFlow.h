@@ -10,6 +10,7 @@
 #include <boost/dynamic_bitset.hpp>
 #include <boost/optional/optional.hpp>
 #include <boost/range/sub_range.hpp>
+#include <memory>
 #include <type_traits>
 #include <unordered_set>
 #include <utility>
@@ -73,6 +74,16 @@ struct BlockAccessor;
 } // namespace impl
 } // namespace source_blocks
 
+namespace dominators {
+template <class GraphInterface>
+class SimpleFastDominators;
+} // namespace dominators
+
+namespace sparta {
+template <typename GraphInterface>
+class BackwardsFixpointIterationAdaptor;
+} // namespace sparta
+
 namespace cfg {
 
 enum EdgeType : uint8_t {
@@ -91,6 +102,7 @@ enum EdgeType : uint8_t {
 class Block;
 class ControlFlowGraph;
 class CFGInliner;
+class GraphInterface;
 
 namespace details {
 
@@ -112,9 +124,14 @@ struct ThrowInfo {
   ThrowInfo(DexType* catch_type, uint32_t index)
       : catch_type(catch_type), index(index) {}
 
-  bool operator==(const ThrowInfo& other) {
+  bool operator==(const ThrowInfo& other) const {
     return catch_type == other.catch_type && index == other.index;
   }
+
+  // ThrowInfos are immutable and interned, so that all the throw edges of a
+  // try region to one of its handlers share the same one, instead of each
+  // edge allocating its own.
+  static const ThrowInfo* make(DexType* catch_type, uint32_t index);
 };
 
 class Edge final {
@@ -126,9 +143,9 @@ class Edge final {
   Block* m_src;
   Block* m_target;
   union {
-    // If `m_type` is EDGE_THROW then this union points to a ThrowInfo
-    // Edge owns this ThrowInfo and is responsible for deleting it.
-    ThrowInfo* m_throw_info;
+    // If `m_type` is EDGE_THROW then this union points to an interned
+    // ThrowInfo.
+    const ThrowInfo* m_throw_info;
     // If `m_type` is not EDGE_THROW then this union is an optional case key.
     // If this edge is a non-default outgoing edge of a OPCODE_SWITCH, then
     // this is not `boost::none`.
@@ -150,7 +167,12 @@ class Edge final {
   Edge(Block* src, Block* target, DexType* catch_type, uint32_t index)
       : m_src(src),
         m_target(target),
-        m_throw_info(new ThrowInfo(catch_type, index)),
+        m_throw_info(ThrowInfo::make(catch_type, index)),
+        m_type(EDGE_THROW) {}
+  Edge(Block* src, Block* target, const ThrowInfo* throw_info)
+      : m_src(src),
+        m_target(target),
+        m_throw_info(throw_info),
         m_type(EDGE_THROW) {}
 
   /*
@@ -159,18 +181,12 @@ class Edge final {
    */
   Edge(const Edge& e) : m_src(e.m_src), m_target(e.m_target), m_type(e.m_type) {
     if (m_type == EDGE_THROW) {
-      m_throw_info = new ThrowInfo(*e.throw_info());
+      m_throw_info = e.throw_info();
     } else {
       m_case_key = e.case_key();
     }
   }
 
-  ~Edge() {
-    if (m_type == EDGE_THROW) {
-      delete m_throw_info;
-    }
-  }
-
   bool operator==(const Edge& that) const {
     return m_src == that.m_src && m_target == that.m_target &&
            equals_ignore_source_and_target(that);
@@ -190,8 +206,8 @@ class Edge final {
     if (m_type != that.m_type) {
       return false;
     } else if (m_type == EDGE_THROW) {
-      return (throw_info() == nullptr && that.throw_info() == nullptr) ||
-             *throw_info() == *that.throw_info();
+      // ThrowInfos are interned.
+      return throw_info() == that.throw_info();
     } else {
       return case_key() == that.case_key();
     }
@@ -201,7 +217,7 @@ class Edge final {
   Block* src() const { return m_src; }
   Block* target() const { return m_target; }
   EdgeType type() const { return m_type; }
-  ThrowInfo* throw_info() const {
+  const ThrowInfo* throw_info() const {
     always_assert(m_type == EDGE_THROW);
     return m_throw_info;
   }
@@ -493,7 +509,10 @@ class ControlFlowGraph {
 
   Block* entry_block() const { return m_entry_block; }
   Block* exit_block() const { return m_exit_block; }
-  void set_entry_block(Block* b) { m_entry_block = b; }
+  void set_entry_block(Block* b) {
+    m_entry_block = b;
+    structure_changed();
+  }
   void set_exit_block(Block* b) { m_exit_block = b; }
 
   /*
@@ -528,6 +547,7 @@ class ControlFlowGraph {
     m_edges.insert(e);
     e->src()->m_succs.emplace_back(e);
     e->target()->m_preds.emplace_back(e);
+    structure_changed();
   }
 
   // copies all edges from one block to another
@@ -844,6 +864,28 @@ class ControlFlowGraph {
 
   reg_t get_registers_size() const { return m_registers_size; }
 
+  // Incremented by every change to the blocks or the edges of the graph, or
+  // to its entry block. Changes to the instructions in the blocks that leave
+  // the edges as they are do not count.
+  uint64_t structure_revision() const { return m_structure_revision; }
+
+  using Dominators = dominators::SimpleFastDominators<GraphInterface>;
+  using PostDominators = dominators::SimpleFastDominators<
+      sparta::BackwardsFixpointIterationAdaptor<GraphInterface>>;
+  using WTO = sparta::WeakTopologicalOrdering<Block*>;
+
+  /*
+   * Analyses of the structure of the graph. They are computed on the first
+   * request and shared by all later ones until the structure revision
+   * changes. A client that changes the graph while it uses one of them must
+   * hold on to the returned pointer.
+   *
+   * get_post_dominators() requires an exit block, see calculate_exit_block().
+   */
+  std::shared_ptr<const Dominators> get_dominators() const;
+  std::shared_ptr<const PostDominators> get_post_dominators() const;
+  std::shared_ptr<const WTO> get_wto() const;
+
   void set_registers_size(reg_t sz) { m_registers_size = sz; }
 
   // Find the highest register in use and set m_registers_size
@@ -889,6 +931,14 @@ class ControlFlowGraph {
    */
   DexPosition* get_dbg_pos(const cfg::InstructionIterator& it);
 
+  /*
+   * Remove the positions that do not change the position of any instruction
+   * within their block: those immediately followed by another position, and
+   * those equal to the position already in effect. Positions that are parents
+   * of other positions are kept. Returns the number of removed positions.
+   */
+  size_t remove_redundant_positions();
+
   std::size_t opcode_hash() const;
 
  private:
@@ -1028,6 +1078,9 @@ class ControlFlowGraph {
                                        }),
                         reverse_edges.end());
 
+    if (!to_remove.empty()) {
+      structure_changed();
+    }
     if (cleanup) {
       cleanup_deleted_edges(to_remove);
     }
@@ -1064,6 +1117,9 @@ class ControlFlowGraph {
           forward_edges.end());
     }
 
+    if (!to_remove.empty()) {
+      structure_changed();
+    }
     if (cleanup) {
       cleanup_deleted_edges(to_remove);
     }
@@ -1100,12 +1156,17 @@ class ControlFlowGraph {
           reverse_edges.end());
     }
 
+    if (!to_remove.empty()) {
+      structure_changed();
+    }
     if (cleanup) {
       cleanup_deleted_edges(to_remove);
     }
     return to_remove;
   }
 
+  void structure_changed() { ++m_structure_revision; }
+
   // Assumes the edge is already removed.
   void free_edge(Edge* edge);
 
@@ -1144,6 +1205,20 @@ class ControlFlowGraph {
   Block* m_exit_block{nullptr};
   reg_t m_registers_size{0};
   bool m_editable{true};
+
+  uint64_t m_structure_revision{0};
+  // The revision at which remove_unreachable_blocks last ran, which is a no-op
+  // until the structure changes again.
+  boost::optional<uint64_t> m_reachability_revision;
+  // The default ordering of the blocks, valid at m_order_revision.
+  std::vector<Block*> m_order;
+  boost::optional<uint64_t> m_order_revision;
+
+  template <typename T>
+  using CachedAnalysis = std::pair<std::shared_ptr<const T>, uint64_t>;
+  mutable CachedAnalysis<Dominators> m_dominators;
+  mutable CachedAnalysis<PostDominators> m_post_dominators;
+  mutable CachedAnalysis<WTO> m_wto;
 };
 
 // A static-method-only API for use with the monotonic fixpoint iterator.
@@ -22,6 +22,7 @@
 #include <string>
 
 #include "Macros.h"
+#include "Trace.h"
 
 #if !IS_WINDOWS
 #include <execinfo.h>
@@ -72,6 +73,8 @@ void crash_backtrace_handler(int sig) {
   size_t crashing = g_crashing.fetch_add(1);
   if (crashing == 0) {
     crash_backtrace();
+    // Best effort, for post-mortem diagnostics.
+    trace_flush();
   } else {
     sleep(60); // Sleep a minute, then go on to die if we're still alive.
   }
@@ -230,7 +233,8 @@ VmStats get_mem_stats() {
   while (std::getline(ifs, line)) {
     bool is_vm_peak = boost::starts_with(line, "VmPeak:");
     bool is_vm_hwm = boost::starts_with(line, "VmHWM:");
-    if (is_vm_peak || is_vm_hwm) {
+    bool is_vm_rss = boost::starts_with(line, "VmRSS:");
+    if (is_vm_peak || is_vm_hwm || is_vm_rss) {
       std::smatch match;
       bool matched = std::regex_match(line, match, re);
       if (!matched) {
@@ -262,10 +266,12 @@ VmStats get_mem_stats() {
 
       if (is_vm_peak) {
         res.vm_peak = val;
-      } else {
+      } else if (is_vm_hwm) {
         res.vm_hwm = val;
+      } else {
+        res.vm_rss = val;
       }
-      if (res.vm_peak != 0 && res.vm_hwm != 0) {
+      if (res.vm_peak != 0 && res.vm_hwm != 0 && res.vm_rss != 0) {
         break;
       }
     }
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "DexClass.h"
+#include "RedexContext.h"
+
+namespace dense_ids {
+
+// The number of IDs handed out so far to the objects of each kind.
+inline uint32_t count(const DexString*) { return g_redex->num_string_ids(); }
+inline uint32_t count(const DexType*) { return g_redex->num_type_ids(); }
+inline uint32_t count(const DexFieldRef*) { return g_redex->num_field_ids(); }
+inline uint32_t count(const DexMethodRef*) {
+  return g_redex->num_method_ids();
+}
+
+} // namespace dense_ids
+
+/*
+ * A map from DexStrings, DexTypes, DexFieldRefs or DexMethodRefs to values,
+ * stored in a vector indexed by the dense IDs that RedexContext hands out.
+ * For whole-program tables, this is much smaller and faster than a hash table
+ * keyed by pointers. Keys that were never set map to the default value.
+ *
+ * The table is sized for all the objects that exist when it is created. Until
+ * objects created afterwards are inserted, which may grow it, reads and
+ * writes of distinct keys are safe to do concurrently.
+ */
+template <typename Key, typename Value>
+class DenseSideTable {
+  // std::vector<bool> packs its elements, so writes to distinct keys would
+  // race.
+  static_assert(!std::is_same<Value, bool>::value,
+                "Use a byte-sized type instead of bool");
+
+ public:
+  explicit DenseSideTable(const Value& default_value = Value())
+      : m_values(dense_ids::count(static_cast<const Key*>(nullptr)),
+                 default_value),
+        m_default(default_value) {}
+
+  // Grows the table if `key` was created after it. Not thread-safe then.
+  Value& operator[](const Key* key) {
+    auto id = key->get_id();
+    if (id >= m_values.size()) {
+      m_values.resize(
+          std::max<size_t>(id + 1,
+                           dense_ids::count(static_cast<const Key*>(nullptr))),
+          m_default);
+    }
+    return m_values[id];
+  }
+
+  const Value& at(const Key* key) const {
+    auto id = key->get_id();
+    return id < m_values.size() ? m_values[id] : m_default;
+  }
+
+  // Resets all the values to the default value.
+  void clear() { std::fill(m_values.begin(), m_values.end(), m_default); }
+
+  size_t capacity() const { return m_values.size(); }
+
+ private:
+  std::vector<Value> m_values;
+  Value m_default;
+};
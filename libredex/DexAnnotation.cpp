@@ -690,7 +690,7 @@ void DexAnnotationDirectory::vencode(
   if (m_class) {
     always_assert_log(asetmap.count(m_class) != 0, "Uninitialized aset %p '%s'",
                       m_class, show(m_class).c_str());
-    classoff = asetmap[m_class];
+    classoff = asetmap.at(m_class);
   }
   if (m_field) {
     cntaf = (uint32_t)m_field->size();
@@ -716,7 +716,7 @@ void DexAnnotationDirectory::vencode(
       annodirout.push_back(dodx->fieldidx(p.first));
       always_assert_log(asetmap.count(das) != 0, "Uninitialized aset %p '%s'",
                         das, show(das).c_str());
-      annodirout.push_back(asetmap[das]);
+      annodirout.push_back(asetmap.at(das));
     }
   }
   if (m_method) {
@@ -728,7 +728,7 @@ void DexAnnotationDirectory::vencode(
       annodirout.push_back(midx);
       always_assert_log(asetmap.count(das) != 0, "Uninitialized aset %p '%s'",
                         das, show(das).c_str());
-      annodirout.push_back(asetmap[das]);
+      annodirout.push_back(asetmap.at(das));
     }
   }
   if (m_method_param) {
@@ -740,7 +740,7 @@ void DexAnnotationDirectory::vencode(
       annodirout.push_back(dodx->methodidx(p.first));
       always_assert_log(xrefmap.count(pa) != 0,
                         "Uninitialized ParamAnnotations %p", pa);
-      annodirout.push_back(xrefmap[pa]);
+      annodirout.push_back(xrefmap.at(pa));
     }
   }
 }
@@ -762,7 +762,7 @@ void DexAnnotationSet::vencode(DexOutputIdx* dodx,
                       "Uninitialized annotation %p '%s', bailing\n",
                       anno,
                       show(anno).c_str());
-    asetout.push_back(annoout[anno]);
+    asetout.push_back(annoout.at(anno));
   }
 }
 
@@ -29,6 +29,7 @@
 #include <algorithm>
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
+#include <array>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
@@ -123,11 +124,11 @@ uint32_t DexString::length() const {
   if (is_simple()) {
     return size();
   }
-  return length_of_utf8_string(c_str());
+  return length_of_utf8_string(c_str(), size());
 }
 
 int32_t DexString::java_hashcode() const {
-  return java_hashcode_of_utf8_string(c_str());
+  return java_hashcode_of_utf8_string(c_str(), size());
 }
 
 int DexTypeList::encode(DexOutputIdx* dodx, uint32_t* output) const {
@@ -278,6 +279,7 @@ DexDebugItem::DexDebugItem(DexIdx* idx, uint32_t offset)
     decode_noindexable_string(idx, encdata);
   }
   m_dbg_entries = eval_debug_instructions(this, idx, &encdata, line_start);
+  m_dbg_entries.shrink_to_fit();
   m_on_disk_size = encdata - base_encdata;
 }
 
@@ -319,15 +321,33 @@ std::unique_ptr<DexDebugItem> DexDebugItem::get_dex_debug(DexIdx* idx,
   return std::unique_ptr<DexDebugItem>(new DexDebugItem(idx, offset));
 }
 
+bool DebugOpcodeFilter::drops(DexDebugItemOpcode op) const {
+  switch (op) {
+  case DBG_START_LOCAL:
+  case DBG_START_LOCAL_EXTENDED:
+  case DBG_END_LOCAL:
+  case DBG_RESTART_LOCAL:
+    return drop_local_variables;
+  case DBG_SET_PROLOGUE_END:
+    return drop_prologue_end;
+  case DBG_SET_EPILOGUE_BEGIN:
+    return drop_epilogue_begin;
+  default:
+    return false;
+  }
+}
+
 /*
- * Convert DexDebugEntries into debug opcodes.
+ * Convert DexDebugEntries into debug opcodes, leaving out those that the
+ * filter drops.
  */
 std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
     DexDebugItem* debugitem,
     PositionMapper* pos_mapper,
     uint32_t* line_start,
     std::vector<DebugLineItem>* line_info,
-    uint32_t line_addin) {
+    uint32_t line_addin,
+    const DebugOpcodeFilter* filter) {
   std::vector<std::unique_ptr<DexDebugInstruction>> dbgops;
   uint32_t prev_addr = 0;
   boost::optional<uint32_t> prev_line;
@@ -346,11 +366,17 @@ std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
         }
         break;
       case DexDebugEntryType::Instruction:
-        insns.push_back(it->insn.get());
+        if (filter == nullptr || !filter->drops(it->insn->opcode())) {
+          insns.push_back(it->insn.get());
+        }
         break;
       }
     }
     --it;
+    if (positions.empty() && insns.empty()) {
+      // Nothing to emit here, so the address is advanced by the next entry.
+      continue;
+    }
     auto addr_delta = addr - prev_addr;
     prev_addr = addr;
 
@@ -609,6 +635,10 @@ std::string DexMethod::get_fully_deobfuscated_name() const {
 }
 
 void DexMethod::set_code(std::unique_ptr<IRCode> code) {
+  if (has_lazy_code()) {
+    m_dex_code.reset();
+    m_lazy_code.store(false, std::memory_order_release);
+  }
   m_code = std::move(code);
 }
 
@@ -616,9 +646,48 @@ void DexMethod::balloon() {
   redex_assert(m_code == nullptr);
   m_code = std::make_unique<IRCode>(this);
   m_dex_code.reset();
+  m_lazy_code.store(false, std::memory_order_release);
+}
+
+void DexMethod::set_lazy_code() {
+  redex_assert(m_code == nullptr);
+  redex_assert(m_dex_code != nullptr);
+  m_lazy_code.store(true, std::memory_order_release);
+}
+
+void DexMethod::balloon_lazy_code() {
+  // Methods share a fixed set of locks, rather than each having its own.
+  static std::array<std::mutex, 64> s_locks;
+  auto& lock = s_locks[std::hash<const DexMethod*>()(this) % s_locks.size()];
+  std::lock_guard<std::mutex> guard(lock);
+  if (m_lazy_code.load(std::memory_order_relaxed)) {
+    if (m_code) {
+      m_code->thaw();
+    } else {
+      m_code = std::make_unique<IRCode>(this);
+      m_dex_code.reset();
+    }
+    m_lazy_code.store(false, std::memory_order_release);
+  }
+}
+
+bool DexMethod::freeze_code() {
+  if (has_lazy_code() || !m_code || !m_code->freeze()) {
+    return false;
+  }
+  m_lazy_code.store(true, std::memory_order_release);
+  return true;
 }
 
 void DexMethod::sync() {
+  if (has_lazy_code() && m_code) {
+    balloon_lazy_code();
+  }
+  if (has_lazy_code()) {
+    // The DexCode it was loaded from is still up to date.
+    m_lazy_code.store(false, std::memory_order_release);
+    return;
+  }
   redex_assert(m_dex_code == nullptr);
   m_dex_code = m_code->sync(this);
   m_code.reset();
@@ -733,6 +802,7 @@ void DexClass::set_deobfuscated_name(const std::string& name) {
 }
 
 void DexClass::remove_method(const DexMethod* m) {
+  g_redex->invalidate_method_resolution();
   auto& meths = m->is_virtual() ? m_vmethods : m_dmethods;
   auto it = std::find(meths.begin(), meths.end(), m);
   DEBUG_ONLY bool erased = false;
@@ -788,6 +858,10 @@ DexMethod* DexMethodRef::make_concrete(DexAccessFlags access, bool is_virtual) {
 void DexMethod::make_non_concrete() {
   m_access = static_cast<DexAccessFlags>(0);
   m_concrete = false;
+  if (has_lazy_code()) {
+    m_dex_code.reset();
+    m_lazy_code.store(false, std::memory_order_release);
+  }
   m_code.reset();
   m_virtual = false;
   m_param_anno.clear();
@@ -805,14 +879,23 @@ void DexClass::load_class_data_item(DexIdx* idx,
                                     DexEncodedValueArray* svalues) {
   if (cdi_off == 0) return;
   const uint8_t* encd = idx->get_uleb_data(cdi_off);
-  uint32_t sfield_count = read_uleb128(&encd);
-  uint32_t ifield_count = read_uleb128(&encd);
-  uint32_t dmethod_count = read_uleb128(&encd);
-  uint32_t vmethod_count = read_uleb128(&encd);
+  const uint8_t* encd_end = idx->get_data_end();
+  uint32_t counts[4];
+  read_uleb128s(&encd, encd_end, counts, 4);
+  uint32_t sfield_count = counts[0];
+  uint32_t ifield_count = counts[1];
+  uint32_t dmethod_count = counts[2];
+  uint32_t vmethod_count = counts[3];
+  // Decode all the encoded fields and methods at once: two uleb128s per field,
+  // three per method.
+  std::vector<uint32_t> values(2 * (size_t)(sfield_count + ifield_count) +
+                               3 * (size_t)(dmethod_count + vmethod_count));
+  read_uleb128s(&encd, encd_end, values.data(), values.size());
+  const uint32_t* value = values.data();
   uint32_t ndex = 0;
   for (uint32_t i = 0; i < sfield_count; i++) {
-    ndex += read_uleb128(&encd);
-    auto access_flags = (DexAccessFlags)read_uleb128(&encd);
+    ndex += *value++;
+    auto access_flags = (DexAccessFlags)*value++;
     DexField* df = static_cast<DexField*>(idx->get_fieldidx(ndex));
     DexEncodedValue* ev = nullptr;
     if (svalues != nullptr) {
@@ -823,8 +906,8 @@ void DexClass::load_class_data_item(DexIdx* idx,
   }
   ndex = 0;
   for (uint32_t i = 0; i < ifield_count; i++) {
-    ndex += read_uleb128(&encd);
-    auto access_flags = (DexAccessFlags)read_uleb128(&encd);
+    ndex += *value++;
+    auto access_flags = (DexAccessFlags)*value++;
     DexField* df = static_cast<DexField*>(idx->get_fieldidx(ndex));
     df->make_concrete(access_flags);
     m_ifields.push_back(df);
@@ -833,11 +916,11 @@ void DexClass::load_class_data_item(DexIdx* idx,
   std::unordered_set<DexMethod*> method_pointer_cache;
   method_pointer_cache.reserve(dmethod_count + vmethod_count);
 
-  auto process_method = [this, &encd, &idx, &method_pointer_cache](
+  auto process_method = [this, &value, &idx, &method_pointer_cache](
                             uint32_t& ndex, bool is_virtual) {
-    ndex += read_uleb128(&encd);
-    auto access_flags = (DexAccessFlags)read_uleb128(&encd);
-    uint32_t code_off = read_uleb128(&encd);
+    ndex += *value++;
+    auto access_flags = (DexAccessFlags)*value++;
+    uint32_t code_off = *value++;
     // Find method in method index, returns same pointer for same method.
     DexMethod* dm = static_cast<DexMethod*>(idx->get_methodidx(ndex));
     std::unique_ptr<DexCode> dc = DexCode::get_dex_code(idx, code_off);
@@ -869,7 +952,10 @@ void DexClass::load_class_data_item(DexIdx* idx,
   }
 }
 
-std::unique_ptr<IRCode> DexMethod::release_code() { return std::move(m_code); }
+std::unique_ptr<IRCode> DexMethod::release_code() {
+  get_code(); // Balloon lazy code first.
+  return std::move(m_code);
+}
 
 std::vector<DexMethod*> DexClass::get_all_methods() const {
   std::vector<DexMethod*> all_methods(m_vmethods.begin(), m_vmethods.end());
@@ -882,6 +968,7 @@ void DexClass::add_method(DexMethod* m) {
                     "Method %s must be concrete",
                     SHOW(m));
   always_assert(m->get_class() == get_type());
+  g_redex->invalidate_method_resolution();
   if (m->is_virtual()) {
     insert_sorted(m_vmethods, m, compare_dexmethods);
   } else {
@@ -1497,7 +1584,7 @@ template <typename C>
 void DexMethod::gather_types(C& ltype) const {
   gather_types_shallow(ltype); // Handle DexMethodRef parts.
   std::vector<DexType*> type_vec; // Simplify refactor.
-  if (m_code) m_code->gather_types(type_vec);
+  if (get_code()) get_code()->gather_types(type_vec);
   if (m_anno) m_anno->gather_types(type_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1513,9 +1600,9 @@ INSTANTIATE(DexMethod::gather_types, DexType*)
 template <typename C>
 void DexMethod::gather_callsites(C& lcallsite) const {
   // We handle m_spec.cls and proto in the first-layer gather.
-  if (m_code) {
+  if (get_code()) {
     std::vector<DexCallSite*> callsite_vec; // Simplify refactor.
-    m_code->gather_callsites(callsite_vec);
+    get_code()->gather_callsites(callsite_vec);
     c_append_all(lcallsite, callsite_vec.begin(), callsite_vec.end());
   }
 }
@@ -1525,7 +1612,7 @@ template <typename C>
 void DexMethod::gather_methodhandles(C& lmethodhandle) const {
   // We handle m_spec.cls and proto in the first-layer gather.
   std::vector<DexMethodHandle*> mhandles_vec; // Simplify refactor.
-  if (m_code) m_code->gather_methodhandles(mhandles_vec);
+  if (get_code()) get_code()->gather_methodhandles(mhandles_vec);
   c_append_all(lmethodhandle, mhandles_vec.begin(), mhandles_vec.end());
 }
 INSTANTIATE(DexMethod::gather_methodhandles, DexMethodHandle*)
@@ -1533,7 +1620,7 @@ template <typename C>
 void DexMethod::gather_strings(C& lstring, bool exclude_loads) const {
   // We handle m_name and proto in the first-layer gather.
   std::vector<DexString*> strings_vec; // Simplify refactor.
-  if (m_code && !exclude_loads) m_code->gather_strings(strings_vec);
+  if (get_code() && !exclude_loads) get_code()->gather_strings(strings_vec);
   if (m_anno) m_anno->gather_strings(strings_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1548,7 +1635,7 @@ INSTANTIATE2(DexMethod::gather_strings, DexString*, bool)
 template <typename C>
 void DexMethod::gather_fields(C& lfield) const {
   std::vector<DexFieldRef*> fields_vec; // Simplify refactor.
-  if (m_code) m_code->gather_fields(fields_vec);
+  if (get_code()) get_code()->gather_fields(fields_vec);
   if (m_anno) m_anno->gather_fields(fields_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1563,9 +1650,9 @@ INSTANTIATE(DexMethod::gather_fields, DexFieldRef*)
 
 template <typename C>
 void DexMethod::gather_methods(C& lmethod) const {
-  if (m_code) {
+  if (get_code()) {
     std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-    m_code->gather_methods(method_vec);
+    get_code()->gather_methods(method_vec);
     c_append_all(lmethod, method_vec.begin(), method_vec.end());
   }
   gather_methods_from_annos(lmethod);
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -20,6 +21,7 @@
 #include "DexAnnotation.h"
 #include "DexDefs.h"
 #include "DexEncoding.h"
+#include "FastStringOps.h"
 #include "RedexContext.h"
 #include "ReferencedState.h"
 #include "Util.h"
@@ -65,15 +67,12 @@ class PositionMapper;
 
 using Scope = std::vector<DexClass*>;
 
-#if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
-extern "C" bool strcmp_less(const char* str1, const char* str2);
-#endif
-
 class DexString {
   friend struct RedexContext;
 
   std::string m_storage;
   uint32_t m_utfsize;
+  uint32_t m_id{0};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   DexString(std::string nstr, uint32_t utfsize)
@@ -82,6 +81,10 @@ class DexString {
  public:
   uint32_t size() const { return static_cast<uint32_t>(m_storage.size()); }
 
+  // A small index, unique among DexStrings, to key side tables with. See
+  // DenseSideTable.h.
+  uint32_t get_id() const { return m_id; }
+
   // UTF-aware length
   uint32_t length() const;
 
@@ -143,11 +146,7 @@ inline bool compare_dexstrings(const DexString* a, const DexString* b) {
     return false;
   }
   if (a->is_simple() && b->is_simple())
-#if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
-    return strcmp_less(a->c_str(), b->c_str());
-#else
-    return (strcmp(a->c_str(), b->c_str()) < 0);
-#endif
+    return fast_string::less(a->c_str(), b->c_str());
   /*
    * Bother, need to do code-point character-by-character
    * comparison.
@@ -186,11 +185,16 @@ class DexType {
   friend struct RedexContext;
 
   DexString* m_name;
+  uint32_t m_id{0};
 
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   explicit DexType(DexString* dstring) { m_name = dstring; }
 
  public:
+  // A small index, unique among DexTypes, to key side tables with. See
+  // DenseSideTable.h.
+  uint32_t get_id() const { return m_id; }
+
   // DexType retrieval/creation
 
   // If the DexType exists, return it, otherwise create it and return it.
@@ -278,6 +282,7 @@ class DexFieldRef {
   DexFieldSpec m_spec;
   bool m_concrete;
   bool m_external;
+  uint32_t m_id{0};
 
   ~DexFieldRef() {}
   DexFieldRef(DexType* container, DexString* name, DexType* type) {
@@ -295,6 +300,10 @@ class DexFieldRef {
   const DexField* as_def() const;
   DexField* as_def();
 
+  // A small index, unique among DexFieldRefs (including DexFields), to key
+  // side tables with. See DenseSideTable.h.
+  uint32_t get_id() const { return m_id; }
+
   DexType* get_class() const { return m_spec.cls; }
   DexString* get_name() const { return m_spec.name; }
   const char* c_str() const { return get_name()->c_str(); }
@@ -676,12 +685,28 @@ class DexDebugItem {
   void gather_strings(std::vector<DexString*>& lstring) const;
 };
 
+/*
+ * Debug opcodes that are dropped while debug items are encoded, so that they
+ * don't have to be erased from the code of every method beforehand.
+ */
+struct DebugOpcodeFilter {
+  bool drop_local_variables{false};
+  bool drop_prologue_end{false};
+  bool drop_epilogue_begin{false};
+
+  bool drops(DexDebugItemOpcode op) const;
+  bool drops_anything() const {
+    return drop_local_variables || drop_prologue_end || drop_epilogue_begin;
+  }
+};
+
 std::vector<std::unique_ptr<DexDebugInstruction>> generate_debug_instructions(
     DexDebugItem* debugitem,
     PositionMapper* pos_mapper,
     uint32_t* line_start,
     std::vector<DebugLineItem>* line_info,
-    uint32_t line_addin);
+    uint32_t line_addin,
+    const DebugOpcodeFilter* filter = nullptr);
 
 using DexCatches = std::vector<std::pair<DexType*, uint32_t>>;
 
@@ -804,6 +829,7 @@ class DexMethodRef {
   DexMethodSpec m_spec;
   bool m_concrete;
   bool m_external;
+  uint32_t m_id{0};
 
   ~DexMethodRef() {}
   DexMethodRef(DexType* type, DexString* name, DexProto* proto)
@@ -819,6 +845,10 @@ class DexMethodRef {
   const DexMethod* as_def() const;
   DexMethod* as_def();
 
+  // A small index, unique among DexMethodRefs (including DexMethods), to key
+  // side tables with. See DenseSideTable.h.
+  uint32_t get_id() const { return m_id; }
+
   DexType* get_class() const { return m_spec.cls; }
   DexString* get_name() const { return m_spec.name; }
   const char* c_str() const { return get_name()->c_str(); }
@@ -857,6 +887,9 @@ class DexMethod : public DexMethodRef {
 
   // Place these first to avoid/fill padding from DexMethodRef.
   bool m_virtual{false};
+  // Whether m_dex_code is yet to be ballooned into m_code, or m_code is yet to
+  // be thawed, see set_lazy_code() and freeze_code().
+  std::atomic<bool> m_lazy_code{false};
   DexAccessFlags m_access;
 
   DexAnnotationSet* m_anno;
@@ -876,6 +909,8 @@ class DexMethod : public DexMethodRef {
 
   std::string self_show() const; // To avoid "Show.h" in the header.
 
+  void balloon_lazy_code();
+
  public:
   // Tracks whether this method can be deleted or renamed
   ReferencedState rstate;
@@ -973,8 +1008,16 @@ class DexMethod : public DexMethodRef {
   DexAnnotationSet* get_anno_set() { return m_anno; }
   const DexCode* get_dex_code() const { return m_dex_code.get(); }
   DexCode* get_dex_code() { return m_dex_code.get(); }
-  IRCode* get_code() { return m_code.get(); }
-  const IRCode* get_code() const { return m_code.get(); }
+  IRCode* get_code() {
+    if (m_lazy_code.load(std::memory_order_acquire)) {
+      balloon_lazy_code();
+    }
+    return m_code.get();
+  }
+  const IRCode* get_code() const {
+    // Ballooning lazy code does not change what the method is.
+    return const_cast<DexMethod*>(this)->get_code();
+  }
   std::unique_ptr<IRCode> release_code();
   bool is_virtual() const { return m_virtual; }
   DexAccessFlags get_access() const {
@@ -1105,6 +1148,22 @@ class DexMethod : public DexMethodRef {
    * have to call sync().
    */
   void balloon();
+
+  /*
+   * Defer ballooning the DexCode of this method until its code is first
+   * accessed through get_code(), possibly from several threads at once. Until
+   * then, get_dex_code() still returns the DexCode.
+   */
+  void set_lazy_code();
+  /*
+   * Re-encode the IRCode of this method compactly, see IRCode::freeze(). It
+   * is thawed when the code is next accessed through get_code(), and counts
+   * as lazy code until then. Returns whether the code got frozen.
+   */
+  bool freeze_code();
+  bool has_lazy_code() const {
+    return m_lazy_code.load(std::memory_order_acquire);
+  }
   void sync();
 
   // This method frees the given `DexMethod` - different from `erase_method`,
@@ -1264,6 +1323,7 @@ class DexClass {
   void set_super_class(DexType* super_class) {
     always_assert_log(!m_external, "Unexpected external class %s\n",
                       self_show().c_str());
+    g_redex->invalidate_method_resolution();
     m_super_class = super_class;
   }
 
@@ -1281,6 +1341,7 @@ class DexClass {
   void set_interfaces(DexTypeList* intfs) {
     always_assert_log(!m_external, "Unexpected external class %s\n",
                       self_show().c_str());
+    g_redex->invalidate_method_resolution();
     m_interfaces = intfs;
   }
 
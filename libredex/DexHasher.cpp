@@ -7,7 +7,12 @@
 
 #include "DexHasher.h"
 
+#include <algorithm>
 #include <cinttypes>
+#include <cstring>
+#include <numeric>
+
+#include <boost/functional/hash.hpp>
 
 #include "DexAccess.h"
 #include "DexClass.h"
@@ -18,10 +23,84 @@
 #include "IROpcode.h"
 #include "Show.h"
 #include "Trace.h"
-#include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace hashing {
 
+namespace {
+
+constexpr uint64_t MUL1 = 0x87c37b91114253d5;
+constexpr uint64_t MUL2 = 0x4cf5ad432745937f;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t mix_word(uint64_t state, uint64_t word) {
+  word *= MUL1;
+  word = rotl(word, 31);
+  word *= MUL2;
+  state ^= word;
+  return rotl(state, 27) * 5 + 0x52dce729;
+}
+
+inline uint64_t finalize(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccd;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53;
+  h ^= h >> 33;
+  return h;
+}
+
+} // namespace
+
+void StreamHasher::consume_block(const uint8_t* block) {
+  auto state = m_state;
+  for (size_t i = 0; i < BLOCK_SIZE; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, block + i, sizeof(word));
+    state = mix_word(state, word);
+  }
+  m_state = state;
+}
+
+void StreamHasher::update(const void* data, size_t size) {
+  auto bytes = static_cast<const uint8_t*>(data);
+  m_length += size;
+  if (m_buffered > 0) {
+    auto n = std::min(size, BLOCK_SIZE - m_buffered);
+    memcpy(m_buffer + m_buffered, bytes, n);
+    m_buffered += n;
+    bytes += n;
+    size -= n;
+    if (m_buffered < BLOCK_SIZE) {
+      return;
+    }
+    consume_block(m_buffer);
+    m_buffered = 0;
+  }
+  for (; size >= BLOCK_SIZE; bytes += BLOCK_SIZE, size -= BLOCK_SIZE) {
+    consume_block(bytes);
+  }
+  memcpy(m_buffer, bytes, size);
+  m_buffered = size;
+}
+
+size_t StreamHasher::finish() const {
+  auto state = m_state;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= m_buffered; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, m_buffer + i, sizeof(word));
+    state = mix_word(state, word);
+  }
+  if (i < m_buffered) {
+    uint64_t word = 0;
+    memcpy(&word, m_buffer + i, m_buffered - i);
+    state = mix_word(state, word);
+  }
+  return static_cast<size_t>(finalize(state ^ m_length));
+}
+
 std::string hash_to_string(size_t hash) {
   std::ostringstream result;
   result << std::hex << std::setfill('0') << std::setw(sizeof(size_t) * 2)
@@ -29,60 +108,68 @@ std::string hash_to_string(size_t hash) {
   return result.str();
 }
 
+size_t hash_method(const DexMethod* method) {
+  DexClassHasher hasher(type_class(method->get_class()));
+  return hasher.run_method(method);
+}
+
 DexHash DexScopeHasher::run() {
-  std::unordered_map<DexClass*, size_t> class_indices;
-  walk::classes(m_scope, [&](DexClass* cls) {
-    class_indices.emplace(cls, class_indices.size());
-  });
-  std::vector<size_t> class_positions_hashes(class_indices.size());
-  std::vector<size_t> class_registers_hashes(class_indices.size());
-  std::vector<size_t> class_code_hashes(class_indices.size());
-  std::vector<size_t> class_signature_hashes(class_indices.size());
-  walk::parallel::classes(m_scope, [&](DexClass* cls) {
-    DexClassHasher class_hasher(cls);
-    DexHash class_hash = class_hasher.run();
-    auto index = class_indices.at(cls);
-    class_positions_hashes.at(index) = class_hash.positions_hash;
-    class_registers_hashes.at(index) = class_hash.registers_hash;
-    class_code_hashes.at(index) = class_hash.code_hash;
-    class_signature_hashes.at(index) = class_hash.signature_hash;
-  });
-
-  return DexHash{boost::hash_value(class_positions_hashes),
-                 boost::hash_value(class_registers_hashes),
-                 boost::hash_value(class_code_hashes),
-                 boost::hash_value(class_signature_hashes)};
+  // Classes are hashed in parallel, and their hashes are then combined in
+  // scope order.
+  std::vector<size_t> indices(m_scope.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  std::vector<DexHash> class_hashes(m_scope.size());
+  workqueue_run<size_t>(
+      [&](size_t index) {
+        DexClassHasher class_hasher(m_scope[index]);
+        class_hashes[index] = class_hasher.run();
+      },
+      indices);
+
+  StreamHasher positions_hasher;
+  StreamHasher registers_hasher;
+  StreamHasher code_hasher;
+  StreamHasher signature_hasher;
+  for (const auto& class_hash : class_hashes) {
+    positions_hasher.update(class_hash.positions_hash);
+    registers_hasher.update(class_hash.registers_hash);
+    code_hasher.update(class_hash.code_hash);
+    signature_hasher.update(class_hash.signature_hash);
+  }
+  return DexHash{positions_hasher.finish(), registers_hasher.finish(),
+                 code_hasher.finish(), signature_hasher.finish()};
 }
 
 void DexClassHasher::hash(const std::string& str) {
   TRACE(HASHER, 4, "[hasher] %s", str.c_str());
-  boost::hash_combine(m_hash, str);
+  m_stream->update((uint64_t)str.size());
+  m_stream->update(str.data(), str.size());
 }
 
 void DexClassHasher::hash(const DexString* s) { hash(s->str()); }
 
 void DexClassHasher::hash(bool value) {
   TRACE(HASHER, 4, "[hasher] %u", value);
-  boost::hash_combine(m_hash, value);
+  m_stream->update((uint8_t)value);
 }
 void DexClassHasher::hash(uint8_t value) {
   TRACE(HASHER, 4, "[hasher] %" PRIu8, value);
-  boost::hash_combine(m_hash, value);
+  m_stream->update(value);
 }
 
 void DexClassHasher::hash(uint16_t value) {
   TRACE(HASHER, 4, "[hasher] %" PRIu16, value);
-  boost::hash_combine(m_hash, value);
+  m_stream->update(value);
 }
 
 void DexClassHasher::hash(uint32_t value) {
   TRACE(HASHER, 4, "[hasher] %" PRIu32, value);
-  boost::hash_combine(m_hash, value);
+  m_stream->update(value);
 }
 
 void DexClassHasher::hash(uint64_t value) {
   TRACE(HASHER, 4, "[hasher] %" PRIu64, value);
-  boost::hash_combine(m_hash, value);
+  m_stream->update(value);
 }
 
 void DexClassHasher::hash(int value) {
@@ -96,14 +183,16 @@ void DexClassHasher::hash(int value) {
 void DexClassHasher::hash(const IRInstruction* insn) {
   hash((uint16_t)insn->opcode());
 
-  auto old_hash = m_hash;
-  m_hash = 0;
-  hash(insn->srcs_vec());
+  auto old_stream = m_stream;
+  m_stream = &m_registers;
+  hash((uint64_t)insn->srcs_size());
+  for (auto src : insn->srcs()) {
+    hash(src);
+  }
   if (insn->has_dest()) {
     hash(insn->dest());
   }
-  boost::hash_combine(m_registers_hash, m_hash);
-  m_hash = old_hash;
+  m_stream = old_stream;
 
   if (insn->has_literal()) {
     hash((uint64_t)insn->get_literal());
@@ -133,8 +222,8 @@ void DexClassHasher::hash(const IRCode* c) {
     return;
   }
 
-  auto old_hash = m_hash;
-  m_hash = 0;
+  auto old_stream = m_stream;
+  m_stream = &m_code;
 
   std::unordered_map<const MethodItemEntry*, uint32_t> mie_ids;
   auto get_mie_id = [&mie_ids](const MethodItemEntry* mie) {
@@ -188,15 +277,13 @@ void DexClassHasher::hash(const IRCode* c) {
       hash(mie.dbgop->uvalue());
       break;
     case MFLOW_POSITION: {
-      auto old_hash2 = m_hash;
-      m_hash = 0;
+      m_stream = &m_positions;
       hash((uint8_t)MFLOW_POSITION);
       if (mie.pos->method) hash(mie.pos->method);
       if (mie.pos->file) hash(mie.pos->file);
       hash(mie.pos->line);
       if (mie.pos->parent) hash(get_pos_id(mie.pos->parent));
-      boost::hash_combine(m_positions_hash, m_hash);
-      m_hash = old_hash2;
+      m_stream = &m_code;
       break;
     }
     case MFLOW_SOURCE_BLOCK:
@@ -226,19 +313,16 @@ void DexClassHasher::hash(const IRCode* c) {
     if (mie.type == MFLOW_POSITION) {
       auto it2 = pos_ids.find(mie.pos.get());
       if (it2 != pos_ids.end()) {
-        auto old_hash2 = m_hash;
-        m_hash = 0;
+        m_stream = &m_positions;
         hash(it2->second);
         hash(mie_index);
-        boost::hash_combine(m_positions_hash, m_hash);
-        m_hash = old_hash2;
+        m_stream = &m_code;
       }
     }
     mie_index++;
   }
 
-  boost::hash_combine(m_code_hash, m_hash);
-  m_hash = old_hash;
+  m_stream = old_stream;
 }
 
 void DexClassHasher::hash(const DexProto* p) {
@@ -383,7 +467,17 @@ DexHash DexClassHasher::run() {
   TRACE(HASHER, 3, "[hasher] === ifields: %zu", m_cls->get_ifields().size());
   hash(m_cls->get_ifields());
 
-  return DexHash{m_positions_hash, m_registers_hash, m_code_hash, m_hash};
+  return DexHash{m_positions.finish(), m_registers.finish(), m_code.finish(),
+                 m_signature.finish()};
+}
+
+size_t DexClassHasher::run_method(const DexMethod* method) {
+  TRACE(HASHER, 2, "[hasher] ==== hashing method %s", SHOW(method));
+  hash(method);
+  size_t result = m_signature.finish();
+  boost::hash_combine(result, m_registers.finish());
+  boost::hash_combine(result, m_code.finish());
+  return result;
 }
 
 } // namespace hashing
@@ -9,7 +9,8 @@
  * This hashing functionality captures all details of a scope. By running this
  * after each pass, it makes it easy to find non-determinism build-over-build.
  * Look for the ~result~hash~ info that's added to each pass metrics.
- * We use boost hashes for performance.
+ * Values are fed to a StreamHasher, which buffers them and mixes a word at a
+ * time, rather than combining each of them separately.
  *
  */
 
@@ -19,6 +20,7 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <type_traits>
 
 #include "Debug.h"
 #include "DexClass.h"
@@ -29,6 +31,39 @@ namespace hashing {
 
 std::string hash_to_string(size_t hash);
 
+// Method-local hash, see DexClassHasher::run_method().
+size_t hash_method(const DexMethod* method);
+
+/*
+ * A non-cryptographic hash of a stream of bytes. The bytes are buffered and
+ * consumed in blocks, 64-bit words at a time, so feeding a stream in many
+ * small pieces costs little more than feeding it at once, and gives the same
+ * result.
+ */
+class StreamHasher final {
+ public:
+  void update(const void* data, size_t size);
+
+  template <typename T>
+  void update(T value) {
+    static_assert(std::is_integral<T>::value, "Only integers can be hashed");
+    update(&value, sizeof(T));
+  }
+
+  // The hash of everything fed so far. Further updates may follow.
+  size_t finish() const;
+
+ private:
+  static constexpr size_t BLOCK_SIZE = 256;
+
+  void consume_block(const uint8_t* block);
+
+  uint64_t m_state{0x9e3779b97f4a7c15};
+  uint64_t m_length{0};
+  size_t m_buffered{0};
+  uint8_t m_buffer[BLOCK_SIZE];
+};
+
 struct DexHash {
   size_t positions_hash;
   size_t registers_hash;
@@ -50,6 +85,10 @@ class DexClassHasher final {
   explicit DexClassHasher(DexClass* cls) : m_cls(cls) {}
   DexHash run();
 
+  // Hash the signature, attributes, registers and code of a single method of
+  // the class, leaving out its debug positions.
+  size_t run_method(const DexMethod* method);
+
  private:
   void hash(const std::string& str);
   void hash(int value);
@@ -97,10 +136,13 @@ class DexClassHasher final {
     }
   }
   DexClass* m_cls;
-  size_t m_hash{0};
-  size_t m_code_hash{0};
-  size_t m_registers_hash{0};
-  size_t m_positions_hash{0};
+  StreamHasher m_signature;
+  StreamHasher m_code;
+  StreamHasher m_registers;
+  StreamHasher m_positions;
+  // Where the values are currently fed, m_signature unless hashing the
+  // details of some code.
+  StreamHasher* m_stream{&m_signature};
 };
 
 } // namespace hashing
@@ -66,6 +66,45 @@ DexIdx::~DexIdx() {
   }
 }
 
+uint32_t DexIdx::get_ids_size(IdKind kind) const {
+  switch (kind) {
+  case IdKind::STRING:
+    return m_string_ids_size;
+  case IdKind::TYPE:
+    return m_type_ids_size;
+  case IdKind::PROTO:
+    return m_proto_ids_size;
+  case IdKind::FIELD:
+    return m_field_ids_size;
+  case IdKind::METHOD:
+    return m_method_ids_size;
+  }
+  not_reached();
+}
+
+void DexIdx::populate_cache(IdKind kind, uint32_t begin, uint32_t end) {
+  always_assert(begin <= end && end <= get_ids_size(kind));
+  for (uint32_t i = begin; i < end; ++i) {
+    switch (kind) {
+    case IdKind::STRING:
+      get_stringidx(i);
+      break;
+    case IdKind::TYPE:
+      get_typeidx(i);
+      break;
+    case IdKind::PROTO:
+      get_protoidx(i);
+      break;
+    case IdKind::FIELD:
+      get_fieldidx(i);
+      break;
+    case IdKind::METHOD:
+      get_methodidx(i);
+      break;
+    }
+  }
+}
+
 DexCallSite* DexIdx::get_callsiteidx_fromdex(uint32_t csidx) {
   redex_assert(csidx < m_callsite_ids_size);
   // callsites are indirected through the callsite_id table, because
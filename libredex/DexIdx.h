@@ -119,6 +119,19 @@ class DexIdx {
     return m_method_cache[midx];
   }
 
+  // The kinds of ids whose caches populate_cache fills, in an order in which
+  // each kind only refers to the kinds before it.
+  enum class IdKind { STRING, TYPE, PROTO, FIELD, METHOD };
+
+  uint32_t get_ids_size(IdKind kind) const;
+
+  // Fills the cache entries of the ids of `kind` in [begin, end), as if each
+  // of them had been accessed. Once the caches of the kinds that `kind` refers
+  // to are full, disjoint ranges may be filled concurrently. Interning all ids
+  // up front this way takes the interning off the critical path of class
+  // parsing, which then only reads the caches.
+  void populate_cache(IdKind kind, uint32_t begin, uint32_t end);
+
   uint32_t get_callsite_ids_size() { return m_callsite_ids_size; }
 
   DexCallSite* get_callsiteidx(uint32_t csidx) {
@@ -172,6 +185,11 @@ class DexIdx {
     return m_dexbase + offset;
   }
 
+  // The end of the dex file, which bounds the data returned above.
+  const uint8_t* get_data_end() const {
+    return m_dexbase + ((const dex_header*)m_dexbase)->file_size;
+  }
+
   uint32_t get_checksum() const {
     return ((const dex_header*)m_dexbase)->checksum;
   }
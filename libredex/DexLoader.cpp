@@ -16,8 +16,13 @@
 #include "Walkers.h"
 #include "WorkQueue.h"
 
+#include <algorithm>
+#include <atomic>
 #include <exception>
 #include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 DexLoader::DexLoader(const char* location)
@@ -159,7 +164,7 @@ void DexLoader::gather_input_stats(dex_stats_t* stats, const dex_header* dh) {
   }
 
   const dex_map_list* map_list =
-      reinterpret_cast<const dex_map_list*>(m_file->const_data() + dh->map_off);
+      reinterpret_cast<const dex_map_list*>((const uint8_t*)dh + dh->map_off);
   bool header_seen = false;
   uint32_t header_index = 0;
   for (uint32_t i = 0; i < map_list->size; i++) {
@@ -471,47 +476,85 @@ DexClasses DexLoader::load_dex(const char* location,
   return load_dex(dh, stats);
 }
 
-DexClasses DexLoader::load_dex(const dex_header* dh, dex_stats_t* stats) {
-  if (dh->class_defs_size == 0) {
-    return DexClasses(0);
+// Run `fn` on all items in parallel, collecting exceptions thrown by the
+// workers and rethrowing them together once all items have been processed.
+template <class Input, class Fn>
+static void run_rethrowing_aggregate(const std::vector<Input>& items,
+                                     const Fn& fn) {
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<std::vector<std::exception_ptr>> exceptions_vec(num_threads);
+  workqueue_run<Input>(
+      [&exceptions_vec, &fn](sparta::SpartaWorkerState<Input>* state,
+                             const Input& item) {
+        try {
+          fn(item);
+        } catch (const std::exception& exc) {
+          TRACE(MAIN, 1, "Worker throw the exception:%s", exc.what());
+          exceptions_vec[state->worker_id()].emplace_back(
+              std::current_exception());
+        }
+      },
+      items,
+      num_threads);
+
+  std::vector<std::exception_ptr> all_exceptions;
+  for (auto& exceptions : exceptions_vec) {
+    all_exceptions.insert(all_exceptions.end(), exceptions.begin(),
+                          exceptions.end());
   }
+  if (!all_exceptions.empty()) {
+    // At least one of the workers raised an exception
+    aggregate_exception ae(all_exceptions);
+    throw ae;
+  }
+}
+
+// Interns all the string, type, proto, field and method ids of the given
+// dexes into their caches, one kind of id after the other, in parallel chunks
+// across all dexes.
+static void populate_idx_caches(const std::vector<DexIdx*>& idxs) {
+  constexpr uint32_t kChunkSize = 4096;
+  struct Chunk {
+    DexIdx* idx;
+    uint32_t begin;
+    uint32_t end;
+  };
+  for (auto kind : {DexIdx::IdKind::STRING, DexIdx::IdKind::TYPE,
+                    DexIdx::IdKind::PROTO, DexIdx::IdKind::FIELD,
+                    DexIdx::IdKind::METHOD}) {
+    std::vector<Chunk> chunks;
+    for (auto* idx : idxs) {
+      uint32_t size = idx->get_ids_size(kind);
+      for (uint32_t begin = 0; begin < size; begin += kChunkSize) {
+        chunks.push_back({idx, begin, std::min(size, begin + kChunkSize)});
+      }
+    }
+    run_rethrowing_aggregate(chunks, [kind](const Chunk& chunk) {
+      chunk.idx->populate_cache(kind, chunk.begin, chunk.end);
+    });
+  }
+}
+
+void DexLoader::prepare_dex(const dex_header* dh, DexClasses* classes) {
+  always_assert(classes->size() == dh->class_defs_size);
   m_idx = std::make_unique<DexIdx>(dh);
   auto off = (uint64_t)dh->class_defs_off;
   m_class_defs =
       reinterpret_cast<const dex_class_def*>((const uint8_t*)dh + off);
-  DexClasses classes(dh->class_defs_size);
-  m_classes = &classes;
+  m_classes = classes;
+}
 
-  {
-    auto num_threads = redex_parallel::default_num_threads();
-    std::vector<std::vector<std::exception_ptr>> exceptions_vec(num_threads);
-    std::vector<size_t> indices(dh->class_defs_size);
-    std::iota(indices.begin(), indices.end(), 0);
-    workqueue_run<size_t>(
-        [&exceptions_vec, this](sparta::SpartaWorkerState<size_t>* state,
-                                size_t num) {
-          try {
-            load_dex_class(num);
-          } catch (const std::exception& exc) {
-            TRACE(MAIN, 1, "Worker throw the exception:%s", exc.what());
-            exceptions_vec[state->worker_id()].emplace_back(
-                std::current_exception());
-          }
-        },
-        indices,
-        num_threads);
-
-    std::vector<std::exception_ptr> all_exceptions;
-    for (auto& exceptions : exceptions_vec) {
-      all_exceptions.insert(all_exceptions.end(), exceptions.begin(),
-                            exceptions.end());
-    }
-    if (!all_exceptions.empty()) {
-      // At least one of the workers raised an exception
-      aggregate_exception ae(all_exceptions);
-      throw ae;
-    }
+DexClasses DexLoader::load_dex(const dex_header* dh, dex_stats_t* stats) {
+  if (dh->class_defs_size == 0) {
+    return DexClasses(0);
   }
+  DexClasses classes(dh->class_defs_size);
+  prepare_dex(dh, &classes);
+  populate_idx_caches({m_idx.get()});
+
+  std::vector<size_t> indices(dh->class_defs_size);
+  std::iota(indices.begin(), indices.end(), 0);
+  run_rethrowing_aggregate(indices, [this](size_t num) { load_dex_class(num); });
 
   gather_input_stats(stats, dh);
 
@@ -562,6 +605,137 @@ DexClasses load_classes_from_dex(const dex_header* dh,
   return classes;
 }
 
+// Loads the dexes of `locations` together. `get_dex` returns the header and
+// size of a dex, mapping it with its loader if needed.
+template <class GetDex>
+static std::vector<DexClasses> load_classes_from_dexes_impl(
+    const std::vector<std::string>& locations,
+    const GetDex& get_dex,
+    std::vector<dex_stats_t>* stats,
+    bool balloon,
+    int support_dex_version) {
+  size_t num_dexes = locations.size();
+  std::vector<std::unique_ptr<DexLoader>> loaders;
+  std::vector<const dex_header*> headers(num_dexes);
+  std::vector<DexClasses> all_classes(num_dexes);
+  std::vector<std::vector<DexType*>> class_types(num_dexes);
+  for (const auto& location : locations) {
+    TRACE(MAIN, 1, "Loading classes from dex from %s", location.c_str());
+    loaders.emplace_back(std::make_unique<DexLoader>(location.c_str()));
+  }
+
+  std::vector<size_t> dex_indices(num_dexes);
+  std::iota(dex_indices.begin(), dex_indices.end(), 0);
+  // Map and validate all dexes.
+  run_rethrowing_aggregate(dex_indices, [&](size_t d) {
+    auto& dl = *loaders[d];
+    const dex_header* dh;
+    size_t size;
+    std::tie(dh, size) = get_dex(d, dl);
+    validate_dex_header(dh, size, support_dex_version);
+    headers[d] = dh;
+    all_classes[d].resize(dh->class_defs_size);
+    dl.prepare_dex(dh, &all_classes[d]);
+  });
+
+  std::vector<DexIdx*> idxs;
+  for (const auto& dl : loaders) {
+    idxs.push_back(dl->get_idx());
+  }
+  populate_idx_caches(idxs);
+
+  // Find out which class each def defines.
+  run_rethrowing_aggregate(dex_indices, [&](size_t d) {
+    auto& dl = *loaders[d];
+    const dex_header* dh = headers[d];
+    auto* class_defs = reinterpret_cast<const dex_class_def*>(
+        (const uint8_t*)dh + dh->class_defs_off);
+    auto& types = class_types[d];
+    types.reserve(dh->class_defs_size);
+    for (size_t num = 0; num < dh->class_defs_size; ++num) {
+      types.push_back(dl.get_idx()->get_typeidx(class_defs[num].typeidx));
+    }
+  });
+
+  // Whichever definition of a class comes first in dex order wins. Only those
+  // are loaded in parallel; the remaining ones are loaded afterwards, in
+  // order, so that duplicates are detected and reported exactly as if the
+  // dexes had been loaded one by one.
+  std::vector<std::pair<size_t, size_t>> first_defs;
+  std::vector<std::pair<size_t, size_t>> later_defs;
+  {
+    std::unordered_set<DexType*> seen;
+    for (size_t d = 0; d < num_dexes; ++d) {
+      for (size_t num = 0; num < class_types[d].size(); ++num) {
+        auto* type = class_types[d][num];
+        if (seen.insert(type).second && type_class(type) == nullptr) {
+          first_defs.emplace_back(d, num);
+        } else {
+          later_defs.emplace_back(d, num);
+        }
+      }
+    }
+  }
+  run_rethrowing_aggregate(first_defs,
+                           [&](const std::pair<size_t, size_t>& def) {
+                             loaders[def.first]->load_dex_class(def.second);
+                           });
+  for (const auto& def : later_defs) {
+    loaders[def.first]->load_dex_class(def.second);
+  }
+
+  if (stats != nullptr) {
+    stats->assign(num_dexes, dex_stats_t());
+    run_rethrowing_aggregate(dex_indices, [&](size_t d) {
+      loaders[d]->gather_input_stats(&stats->at(d), headers[d]);
+    });
+  }
+
+  Scope scope;
+  for (auto& classes : all_classes) {
+    // Remove nulls from the classes list. They may have been introduced by
+    // benign duplicate classes.
+    classes.erase(std::remove(classes.begin(), classes.end(), nullptr),
+                  classes.end());
+    scope.insert(scope.end(), classes.begin(), classes.end());
+  }
+  if (balloon) {
+    balloon_all(scope);
+  }
+  return all_classes;
+}
+
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<std::string>& locations,
+    std::vector<dex_stats_t>* stats,
+    bool balloon,
+    int support_dex_version) {
+  return load_classes_from_dexes_impl(
+      locations,
+      [&](size_t d, DexLoader& dl) {
+        const dex_header* dh = dl.get_dex_header(locations[d].c_str());
+        return std::make_pair(dh, dl.get_file_size());
+      },
+      stats, balloon, support_dex_version);
+}
+
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<DexBuffer>& dexes,
+    std::vector<dex_stats_t>* stats,
+    bool balloon,
+    int support_dex_version) {
+  std::vector<std::string> locations;
+  for (const auto& dex : dexes) {
+    locations.push_back(dex.location);
+  }
+  return load_classes_from_dexes_impl(
+      locations,
+      [&](size_t d, DexLoader&) {
+        return std::make_pair(dexes[d].dh, dexes[d].size);
+      },
+      stats, balloon, support_dex_version);
+}
+
 std::string load_dex_magic_from_dex(const char* location) {
   DexLoader dl(location);
   auto dh = dl.get_dex_header(location);
@@ -569,3 +743,22 @@ std::string load_dex_magic_from_dex(const char* location) {
 }
 
 void balloon_for_test(const Scope& scope) { balloon_all(scope); }
+
+void set_lazy_code(const Scope& scope) {
+  walk::methods(scope, [&](DexMethod* m) {
+    if (m->get_dex_code() && !m->has_lazy_code()) {
+      m->set_lazy_code();
+    }
+  });
+}
+
+size_t balloon_lazy_code(const Scope& scope) {
+  std::atomic<size_t> ballooned{0};
+  walk::parallel::methods(scope, [&](DexMethod* m) {
+    if (m->has_lazy_code()) {
+      m->get_code();
+      ++ballooned;
+    }
+  });
+  return ballooned;
+}
@@ -30,9 +30,13 @@ class DexLoader {
                       dex_stats_t* stats,
                       int support_dex_version);
   DexClasses load_dex(const dex_header* dh, dex_stats_t* stats);
+  // Set up the index for `dh` so that its classes can be loaded into
+  // `classes` (which must be sized to hold all of them) via load_dex_class.
+  void prepare_dex(const dex_header* dh, DexClasses* classes);
   void load_dex_class(int num);
   void gather_input_stats(dex_stats_t* stats, const dex_header* dh);
   DexIdx* get_idx() { return m_idx.get(); }
+  size_t get_file_size() const { return m_file->size(); }
 };
 
 DexClasses load_classes_from_dex(const char* location,
@@ -45,9 +49,41 @@ DexClasses load_classes_from_dex(const char* location,
 DexClasses load_classes_from_dex(const dex_header* dh,
                                  const char* location,
                                  bool balloon = true);
+// Load several dexes at once. Classes of all dexes are parsed concurrently,
+// but duplicate classes are resolved as if the dexes had been loaded one after
+// another, in order. Returns the classes of each dex; stats, if given, are
+// filled in per dex.
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<std::string>& locations,
+    std::vector<dex_stats_t>* stats,
+    bool balloon = true,
+    int support_dex_version = 35);
+
+// A dex that is already in memory, e.g. an entry of an APK. The classes it
+// defines are located at `location`.
+struct DexBuffer {
+  std::string location;
+  const dex_header* dh;
+  size_t size;
+};
+
+// As above, for dexes in memory. The buffers only need to live until this
+// returns.
+std::vector<DexClasses> load_classes_from_dexes(
+    const std::vector<DexBuffer>& dexes,
+    std::vector<dex_stats_t>* stats,
+    bool balloon = true,
+    int support_dex_version = 35);
 std::string load_dex_magic_from_dex(const char* location);
 void balloon_for_test(const Scope& scope);
 
+// For classes loaded with `balloon = false`: balloon the code of each method
+// only once it is accessed, see DexMethod::set_lazy_code().
+void set_lazy_code(const Scope& scope);
+// Balloon all the code left lazy, in parallel. Returns the number of methods
+// ballooned.
+size_t balloon_lazy_code(const Scope& scope);
+
 static inline const uint8_t* align_ptr(const uint8_t* const ptr,
                                        const size_t alignment) {
   const size_t alignment_error = ((size_t)ptr) % alignment;
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <exception>
 #include <fcntl.h>
 #include <fstream>
@@ -17,10 +18,17 @@
 #include <inttypes.h>
 #include <list>
 #include <memory>
+#include <numeric>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <unordered_map>
 #include <unordered_set>
 
+#if !defined(_MSC_VER) && !defined(__MINGW32__) && !defined(__MINGW64__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #ifdef _MSC_VER
 // TODO: Rewrite open/write/close with C/C++ standards. But it works for now.
 #include <io.h>
@@ -156,7 +164,7 @@ std::vector<DexMethod*> GatheredTypes::get_dexmethod_emitlist() {
 
 void GatheredTypes::sort_dexmethod_emitlist_method_ref_order(
     std::vector<DexMethod*>& lmeth) {
-  MethodSimilarityOrderer::order(lmeth);
+  MethodSimilarityOrderer::order(lmeth, m_method_similarity_minhash);
 }
 
 void GatheredTypes::sort_dexmethod_emitlist_default_order(
@@ -426,6 +434,42 @@ uint32_t get_dex_output_size(const ConfigFiles& conf) {
   return (uint32_t)output_size;
 }
 
+/*
+ * Allocates the zero-filled output buffer of a dex.
+ *
+ * With `dex_output_mmap`, the buffer is a shared mapping of the output file,
+ * grown to `size` and truncated to the actual dex size once it is written, so
+ * that the dex is never copied out of a separate buffer. Otherwise, it is
+ * calloc'ed, which for buffers this large gets untouched pages from the OS and
+ * leaves the unused tail of the buffer uncommitted.
+ */
+std::unique_ptr<uint8_t, std::function<void(uint8_t*)>> allocate_output(
+    const char* path, size_t size, bool use_mmap, int* out_fd) {
+#if !IS_WINDOWS
+  if (use_mmap) {
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0660);
+    if (fd != -1 && ftruncate(fd, size) == 0) {
+      void* data =
+          mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (data != MAP_FAILED) {
+        *out_fd = fd;
+        return std::unique_ptr<uint8_t, std::function<void(uint8_t*)>>(
+            static_cast<uint8_t*>(data),
+            [size](uint8_t* p) { munmap(p, size); });
+      }
+    }
+    TRACE(OPUT, 1, "Could not map %s, writing it from a buffer", path);
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+#endif
+  auto* data = static_cast<uint8_t*>(calloc(size, 1));
+  always_assert_log(data != nullptr, "Could not allocate the dex output");
+  return std::unique_ptr<uint8_t, std::function<void(uint8_t*)>>(
+      data, [](uint8_t* p) { free(p); });
+}
+
 } // namespace
 
 CodeItemEmit::CodeItemEmit(DexMethod* meth, DexCode* c, dex_code_item* ci)
@@ -462,14 +506,15 @@ DexOutput::DexOutput(
                          ? get_dex_output_size(config_files) * 2
                          : get_dex_output_size(config_files)) +
                     k_output_red_zone),
-      m_output(std::make_unique<uint8_t[]>(m_output_size)),
+      m_output(allocate_output(
+          path,
+          m_output_size,
+          config_files.get_json_config().get("dex_output_mmap", false),
+          &m_output_fd)),
       m_offset(0),
       m_iodi_metadata(iodi_metadata),
       m_config_files(config_files),
       m_min_sdk(min_sdk) {
-  // Ensure a clean slate.
-  memset(m_output.get(), 0, m_output_size);
-
   m_gtypes = new GatheredTypes(classes);
   dodx = m_gtypes->get_dodx(m_output.get());
 
@@ -502,6 +547,16 @@ DexOutput::DexOutput(
   m_locator_index = locator_index;
   m_normal_primary_dex = normal_primary_dex;
   m_debug_info_kind = debug_info_kind;
+  const Json::Value& strip_config =
+      config_files.get_json_config()["strip_debug_info_at_output"];
+  if (strip_config.isObject()) {
+    m_debug_opcode_filter.drop_local_variables =
+        strip_config.get("drop_local_variables", false).asBool();
+    m_debug_opcode_filter.drop_prologue_end =
+        strip_config.get("drop_prologue_end", false).asBool();
+    m_debug_opcode_filter.drop_epilogue_begin =
+        strip_config.get("drop_epilogue_begin", false).asBool();
+  }
   if (post_lowering) {
     m_detached_methods = post_lowering->get_detached_methods();
   }
@@ -510,6 +565,10 @@ DexOutput::DexOutput(
 DexOutput::~DexOutput() {
   delete m_gtypes;
   delete dodx;
+  m_output.reset();
+  if (m_output_fd != -1) {
+    close(m_output_fd);
+  }
 }
 
 void DexOutput::insert_map_item(uint16_t maptype,
@@ -916,9 +975,31 @@ void DexOutput::generate_class_data_items() {
     uint32_t offset = (uint32_t)(((uint8_t*)it.code_item) - m_output.get());
     dco[it.code] = offset;
   }
+  // The class defs must list superclasses first, but class data items can go
+  // anywhere. When the code items are sorted by profile, putting each class
+  // data item at the position where the code of its class first appears keeps
+  // what's loaded during startup on the same pages.
+  std::vector<uint32_t> order(hdr.class_defs_size);
+  std::iota(order.begin(), order.end(), 0);
+  if (m_class_data_in_code_item_order) {
+    std::unordered_map<const DexType*, uint32_t> ranks;
+    for (auto& it : m_code_item_emits) {
+      ranks.emplace(it.method->get_class(), ranks.size());
+    }
+    std::vector<uint32_t> class_ranks(hdr.class_defs_size);
+    for (uint32_t i = 0; i < hdr.class_defs_size; i++) {
+      auto rank_it = ranks.find(m_classes->at(i)->get_type());
+      class_ranks[i] = rank_it == ranks.end()
+                           ? std::numeric_limits<uint32_t>::max()
+                           : rank_it->second;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return class_ranks[a] < class_ranks[b];
+    });
+  }
   dex_class_def* cdefs = (dex_class_def*)(m_output.get() + hdr.class_defs_off);
   uint32_t count = 0;
-  for (uint32_t i = 0; i < hdr.class_defs_size; i++) {
+  for (auto i : order) {
     DexClass* clz = m_classes->at(i);
     if (!clz->has_class_data()) continue;
     /* No alignment constraints for this data */
@@ -930,8 +1011,8 @@ void DexOutput::generate_class_data_items() {
   insert_map_item(TYPE_CLASS_DATA_ITEM, count, cdi_start, m_offset - cdi_start);
 }
 
-static void sync_all(const Scope& scope) {
-  constexpr bool serial = false; // for debugging
+static void sync_all(const Scope& scope, bool parallel) {
+  const bool serial = !parallel;
   auto fn = [&](DexMethod* m, IRCode&) {
     if (serial) {
       TRACE(MTRANS, 2, "Syncing %s", SHOW(m));
@@ -946,6 +1027,42 @@ static void sync_all(const Scope& scope) {
   }
 }
 
+namespace {
+
+// An upper bound on the number of bytes DexCode::encode writes, rounded up to
+// a multiple of 4.
+size_t encoded_size_bound(DexCode* code) {
+  constexpr size_t kMaxLeb128Size = 5;
+  size_t insns_units = 0;
+  for (const auto* insn : code->get_instructions()) {
+    insns_units += insn->size();
+  }
+  // Code item header, instructions and the padding before the tries.
+  size_t bound = sizeof(dex_code_item) + (insns_units + 1) * sizeof(uint16_t);
+  const auto& tries = code->get_tries();
+  bound += tries.size() * sizeof(dex_tries_item) + kMaxLeb128Size;
+  for (const auto& dextry : tries) {
+    bound += kMaxLeb128Size * (1 + 2 * dextry->m_catches.size());
+  }
+  return (bound + sizeof(uint32_t) - 1) / sizeof(uint32_t) * sizeof(uint32_t);
+}
+
+// Calls :fn on each index below :size, concurrently if :parallel.
+template <typename Fn>
+void for_each_index(size_t size, bool parallel, const Fn& fn) {
+  if (!parallel) {
+    for (size_t i = 0; i < size; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  std::vector<size_t> indices(size);
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(fn, indices);
+}
+
+} // namespace
+
 void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
   TRACE(MAIN, 2, "generate_code_items");
   /*
@@ -953,7 +1070,7 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
    * emitlist to optimize pagecache efficiency.
    */
   uint32_t ci_start = align(m_offset);
-  sync_all(*m_classes);
+  sync_all(*m_classes, m_parallel);
 
   // Get all methods.
   std::vector<DexMethod*> lmeth = m_gtypes->get_dexmethod_emitlist();
@@ -990,21 +1107,48 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
       break;
     }
   }
+  std::vector<DexMethod*> code_meths;
+  code_meths.reserve(lmeth.size());
   for (DexMethod* meth : lmeth) {
     if (meth->get_access() & (ACC_ABSTRACT | ACC_NATIVE)) {
       // There is no code item for ABSTRACT or NATIVE methods.
       continue;
     }
-    TRACE(CUSTOMSORT, 3, "method emit %s %s", SHOW(meth->get_class()),
-          SHOW(meth));
-    DexCode* code = meth->get_dex_code();
     always_assert_log(
-        meth->is_concrete() && code != nullptr,
+        meth->is_concrete() && meth->get_dex_code() != nullptr,
         "Undefined method in generate_code_items()\n\t prototype: %s\n",
         SHOW(meth));
+    code_meths.push_back(meth);
+  }
+
+  // Encoding a code item does not depend on where it ends up in the output,
+  // so encode all of them in parallel into zeroed scratch buffers first, and
+  // then lay them out one after another.
+  struct EncodedCode {
+    std::unique_ptr<uint32_t[]> data;
+    int size{0};
+  };
+  std::vector<EncodedCode> encoded(code_meths.size());
+  for_each_index(code_meths.size(), m_parallel, [&](size_t i) {
+    DexCode* code = code_meths[i]->get_dex_code();
+    size_t bound = encoded_size_bound(code);
+    auto& enc = encoded[i];
+    enc.data = std::make_unique<uint32_t[]>(bound / sizeof(uint32_t));
+    enc.size = code->encode(dodx, enc.data.get());
+    always_assert((size_t)enc.size <= bound);
+  });
+
+  for (size_t i = 0; i < code_meths.size(); ++i) {
+    DexMethod* meth = code_meths[i];
+    TRACE(CUSTOMSORT, 3, "method emit %s %s", SHOW(meth->get_class()),
+          SHOW(meth));
+    DexCode* code = meth->get_dex_code();
     align_output();
-    int size = code->encode(dodx, (uint32_t*)(m_output.get() + m_offset));
+    int size = encoded[i].size;
     check_method_instruction_size_limit(m_config_files, size, SHOW(meth));
+    always_assert(m_offset + size < m_output_size);
+    memcpy(m_output.get() + m_offset, encoded[i].data.get(), size);
+    encoded[i].data.reset();
     m_method_bytecode_offsets.emplace_back(meth->get_name()->c_str(), m_offset);
     m_code_item_emits.emplace_back(meth, code,
                                    (dex_code_item*)(m_output.get() + m_offset));
@@ -1131,22 +1275,90 @@ static bool annotation_cmp(const DexAnnotationDirectory* a,
   return (a->viz_score() < b->viz_score());
 }
 
+namespace {
+
+/*
+ * An encoded annotation item, hashed once, so that the duplicates are found
+ * by a hash lookup rather than by ordered comparisons of the encodings.
+ */
+template <typename T>
+struct EncodedItem {
+  std::vector<T> bytes;
+  size_t hash{0};
+};
+
+template <typename T>
+struct EncodedItemHash {
+  size_t operator()(const EncodedItem<T>* item) const { return item->hash; }
+};
+
+template <typename T>
+struct EncodedItemEqual {
+  bool operator()(const EncodedItem<T>* a, const EncodedItem<T>* b) const {
+    return a->bytes == b->bytes;
+  }
+};
+
+// Maps the distinct encodings to their offsets in the output.
+template <typename T>
+using EncodedItemOffsets = std::unordered_map<const EncodedItem<T>*,
+                                              uint32_t,
+                                              EncodedItemHash<T>,
+                                              EncodedItemEqual<T>>;
+
+// The distinct items of :list that :map doesn't have an offset for yet, in the
+// order of their first occurrence.
+template <typename Item, typename Map>
+std::vector<Item*> new_items(const std::vector<Item*>& list, const Map& map) {
+  std::vector<Item*> items;
+  std::unordered_set<Item*> seen;
+  for (auto item : list) {
+    if (!map.count(item) && seen.insert(item).second) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// Encodes the items with :encode, which must only read the maps it is given.
+// The encodings do not depend on where the items end up in the output, so
+// they are computed concurrently if :parallel.
+template <typename T, typename Item, typename Encode>
+std::vector<EncodedItem<T>> encode_items(const std::vector<Item*>& items,
+                                         bool parallel,
+                                         const Encode& encode) {
+  std::vector<EncodedItem<T>> encoded(items.size());
+  for_each_index(items.size(), parallel, [&](size_t i) {
+    auto& enc = encoded[i];
+    encode(items[i], enc.bytes);
+    enc.hash = boost::hash_range(enc.bytes.begin(), enc.bytes.end());
+  });
+  return encoded;
+}
+
+} // namespace
+
 void DexOutput::unique_annotations(annomap_t& annomap,
                                    std::vector<DexAnnotation*>& annolist) {
   int annocnt = 0;
   uint32_t mentry_offset = m_offset;
-  std::map<std::vector<uint8_t>, uint32_t> annotation_byte_offsets;
-  for (auto anno : annolist) {
-    if (annomap.count(anno)) continue;
-    std::vector<uint8_t> annotation_bytes;
-    anno->vencode(dodx, annotation_bytes);
-    if (annotation_byte_offsets.count(annotation_bytes)) {
-      annomap[anno] = annotation_byte_offsets[annotation_bytes];
+  auto annos = new_items(annolist, annomap);
+  auto encoded = encode_items<uint8_t>(
+      annos, m_parallel,
+      [&](DexAnnotation* anno, std::vector<uint8_t>& annotation_bytes) {
+        anno->vencode(dodx, annotation_bytes);
+      });
+  EncodedItemOffsets<uint8_t> annotation_byte_offsets;
+  for (size_t i = 0; i < annos.size(); ++i) {
+    const auto& annotation_bytes = encoded[i].bytes;
+    auto it = annotation_byte_offsets.find(&encoded[i]);
+    if (it != annotation_byte_offsets.end()) {
+      annomap[annos[i]] = it->second;
       continue;
     }
     /* Insert new annotation in tracking structs */
-    annotation_byte_offsets[annotation_bytes] = m_offset;
-    annomap[anno] = m_offset;
+    annotation_byte_offsets.emplace(&encoded[i], m_offset);
+    annomap[annos[i]] = m_offset;
     /* Not a dupe, encode... */
     uint8_t* annoout = (uint8_t*)(m_output.get() + m_offset);
     memcpy(annoout, &annotation_bytes[0], annotation_bytes.size());
@@ -1165,19 +1377,24 @@ void DexOutput::unique_asets(annomap_t& annomap,
                              std::vector<DexAnnotationSet*>& asetlist) {
   int asetcnt = 0;
   uint32_t mentry_offset = align(m_offset);
-  std::map<std::vector<uint32_t>, uint32_t> aset_offsets;
-  for (auto aset : asetlist) {
-    if (asetmap.count(aset)) continue;
-    std::vector<uint32_t> aset_bytes;
-    aset->vencode(dodx, aset_bytes, annomap);
-    if (aset_offsets.count(aset_bytes)) {
-      asetmap[aset] = aset_offsets[aset_bytes];
+  auto asets = new_items(asetlist, asetmap);
+  auto encoded = encode_items<uint32_t>(
+      asets, m_parallel,
+      [&](DexAnnotationSet* aset, std::vector<uint32_t>& aset_bytes) {
+        aset->vencode(dodx, aset_bytes, annomap);
+      });
+  EncodedItemOffsets<uint32_t> aset_offsets;
+  for (size_t i = 0; i < asets.size(); ++i) {
+    const auto& aset_bytes = encoded[i].bytes;
+    auto it = aset_offsets.find(&encoded[i]);
+    if (it != aset_offsets.end()) {
+      asetmap[asets[i]] = it->second;
       continue;
     }
     /* Insert new aset in tracking structs */
     align_output();
-    aset_offsets[aset_bytes] = m_offset;
-    asetmap[aset] = m_offset;
+    aset_offsets.emplace(&encoded[i], m_offset);
+    asetmap[asets[i]] = m_offset;
     /* Not a dupe, encode... */
     uint8_t* asetout = (uint8_t*)(m_output.get() + m_offset);
     memcpy(asetout, &aset_bytes[0], aset_bytes.size() * sizeof(uint32_t));
@@ -1195,25 +1412,31 @@ void DexOutput::unique_xrefs(asetmap_t& asetmap,
                              std::vector<ParamAnnotations*>& xreflist) {
   int xrefcnt = 0;
   uint32_t mentry_offset = align(m_offset);
-  std::map<std::vector<uint32_t>, uint32_t> xref_offsets;
-  for (auto xref : xreflist) {
-    if (xrefmap.count(xref)) continue;
-    std::vector<uint32_t> xref_bytes;
-    xref_bytes.push_back((unsigned int)xref->size());
-    for (auto param : *xref) {
-      DexAnnotationSet* das = param.second;
-      always_assert_log(asetmap.count(das) != 0, "Uninitialized aset %p '%s'",
-                        das, SHOW(das));
-      xref_bytes.push_back(asetmap[das]);
-    }
-    if (xref_offsets.count(xref_bytes)) {
-      xrefmap[xref] = xref_offsets[xref_bytes];
+  auto xrefs = new_items(xreflist, xrefmap);
+  auto encoded = encode_items<uint32_t>(
+      xrefs, m_parallel,
+      [&](ParamAnnotations* xref, std::vector<uint32_t>& xref_bytes) {
+        xref_bytes.push_back((unsigned int)xref->size());
+        for (auto param : *xref) {
+          DexAnnotationSet* das = param.second;
+          auto it = asetmap.find(das);
+          always_assert_log(it != asetmap.end(), "Uninitialized aset %p '%s'",
+                            das, SHOW(das));
+          xref_bytes.push_back(it->second);
+        }
+      });
+  EncodedItemOffsets<uint32_t> xref_offsets;
+  for (size_t i = 0; i < xrefs.size(); ++i) {
+    const auto& xref_bytes = encoded[i].bytes;
+    auto it = xref_offsets.find(&encoded[i]);
+    if (it != xref_offsets.end()) {
+      xrefmap[xrefs[i]] = it->second;
       continue;
     }
     /* Insert new xref in tracking structs */
     align_output();
-    xref_offsets[xref_bytes] = m_offset;
-    xrefmap[xref] = m_offset;
+    xref_offsets.emplace(&encoded[i], m_offset);
+    xrefmap[xrefs[i]] = m_offset;
     /* Not a dupe, encode... */
     uint8_t* xrefout = (uint8_t*)(m_output.get() + m_offset);
     memcpy(xrefout, &xref_bytes[0], xref_bytes.size() * sizeof(uint32_t));
@@ -1232,19 +1455,24 @@ void DexOutput::unique_adirs(asetmap_t& asetmap,
                              std::vector<DexAnnotationDirectory*>& adirlist) {
   int adircnt = 0;
   uint32_t mentry_offset = align(m_offset);
-  std::map<std::vector<uint32_t>, uint32_t> adir_offsets;
-  for (auto adir : adirlist) {
-    if (adirmap.count(adir)) continue;
-    std::vector<uint32_t> adir_bytes;
-    adir->vencode(dodx, adir_bytes, xrefmap, asetmap);
-    if (adir_offsets.count(adir_bytes)) {
-      adirmap[adir] = adir_offsets[adir_bytes];
+  auto adirs = new_items(adirlist, adirmap);
+  auto encoded = encode_items<uint32_t>(
+      adirs, m_parallel,
+      [&](DexAnnotationDirectory* adir, std::vector<uint32_t>& adir_bytes) {
+        adir->vencode(dodx, adir_bytes, xrefmap, asetmap);
+      });
+  EncodedItemOffsets<uint32_t> adir_offsets;
+  for (size_t i = 0; i < adirs.size(); ++i) {
+    const auto& adir_bytes = encoded[i].bytes;
+    auto it = adir_offsets.find(&encoded[i]);
+    if (it != adir_offsets.end()) {
+      adirmap[adirs[i]] = it->second;
       continue;
     }
     /* Insert new adir in tracking structs */
     align_output();
-    adir_offsets[adir_bytes] = m_offset;
-    adirmap[adir] = m_offset;
+    adir_offsets.emplace(&encoded[i], m_offset);
+    adirmap[adirs[i]] = m_offset;
     /* Not a dupe, encode... */
     uint8_t* adirout = (uint8_t*)(m_output.get() + m_offset);
     memcpy(adirout, &adir_bytes[0], adir_bytes.size() * sizeof(uint32_t));
@@ -1327,14 +1555,16 @@ DebugMetadata calculate_debug_metadata(
     PositionMapper* pos_mapper,
     uint32_t num_params,
     std::unordered_map<DexCode*, std::vector<DebugLineItem>>* dbg_lines,
-    uint32_t line_addin) {
+    uint32_t line_addin,
+    const DebugOpcodeFilter* filter = nullptr) {
   std::vector<DebugLineItem> debug_line_info;
   DebugMetadata metadata;
   metadata.dbg = dbg;
   metadata.dci = dci;
   metadata.num_params = num_params;
   metadata.dbgops = generate_debug_instructions(
-      dbg, pos_mapper, &metadata.line_start, &debug_line_info, line_addin);
+      dbg, pos_mapper, &metadata.line_start, &debug_line_info, line_addin,
+      filter);
   if (dbg_lines != nullptr) {
     (*dbg_lines)[dc] = debug_line_info;
   }
@@ -1364,10 +1594,12 @@ int emit_debug_info(
     uint8_t* output,
     uint32_t offset,
     uint32_t num_params,
-    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* dbg_lines) {
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* dbg_lines,
+    const DebugOpcodeFilter* filter) {
   // No align requirement for debug items.
-  DebugMetadata metadata = calculate_debug_metadata(
-      dbg, dc, dci, pos_mapper, num_params, dbg_lines, /*line_addin=*/0);
+  DebugMetadata metadata =
+      calculate_debug_metadata(dbg, dc, dci, pos_mapper, num_params, dbg_lines,
+                               /*line_addin=*/0, filter);
   return emit_positions
              ? emit_debug_info_for_metadata(dodx, metadata, output, offset)
              : 0;
@@ -2258,6 +2490,9 @@ void DexOutput::generate_debug_items() {
               "[IODI] WARNING: Not using IODI because no iodi metadata file was"
               " specified.\n");
     }
+    auto filter = m_debug_opcode_filter.drops_anything()
+                      ? &m_debug_opcode_filter
+                      : nullptr;
     for (auto& it : m_code_item_emits) {
       DexCode* dc = it.code;
       dex_code_item* dci = it.code_item;
@@ -2267,7 +2502,7 @@ void DexOutput::generate_debug_items() {
       size_t num_params = it.method->get_proto()->get_args()->size();
       inc_offset(emit_debug_info(dodx, emit_positions, dbg, dc, dci,
                                  m_pos_mapper, m_output.get(), m_offset,
-                                 num_params, m_code_debug_lines));
+                                 num_params, m_code_debug_lines, filter));
     }
   }
   if (emit_positions) {
@@ -2465,14 +2700,10 @@ void compute_method_to_id_map(
   }
 }
 
-void write_method_mapping(const std::string& filename,
+void write_method_mapping(std::ostream& os,
                           const DexOutputIdx* dodx,
                           const DexClasses* classes,
                           uint8_t* dex_signature) {
-  always_assert(!filename.empty());
-  FILE* fd = fopen(filename.c_str(), "a");
-  assert_log(fd, "Can't open method mapping file %s: %s\n", filename.c_str(),
-             strerror(errno));
   std::unordered_set<DexClass*> classes_in_dex(classes->begin(),
                                                classes->end());
   for (auto& it : dodx->method_to_idx()) {
@@ -2531,19 +2762,15 @@ void write_method_mapping(const std::string& filename,
     // in little-endian (since that's faster to compute on-device).
     uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
 
-    fprintf(fd, "%u %u %s %s\n", idx, signature, deobf_method_name.c_str(),
-            deobf_class.c_str());
+    os << idx << " " << signature << " " << deobf_method_name << " "
+       << deobf_class << "\n";
   }
-  fclose(fd);
 }
 
-void write_class_mapping(const std::string& filename,
+void write_class_mapping(std::ostream& os,
                          DexClasses* classes,
                          const size_t class_defs_size,
                          uint8_t* dex_signature) {
-  always_assert(!filename.empty());
-  FILE* fd = fopen(filename.c_str(), "a");
-
   for (uint32_t idx = 0; idx < class_defs_size; idx++) {
 
     DexClass* cls = classes->at(idx);
@@ -2559,10 +2786,8 @@ void write_class_mapping(const std::string& filename,
     // See write_method_mapping above for why checksum is insufficient.
     //
     uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
-    fprintf(fd, "%u %u %s\n", idx, signature, deobf_class.c_str());
+    os << idx << " " << signature << " " << deobf_class << "\n";
   }
-
-  fclose(fd);
 }
 
 const char* deobf_primitive(char type) {
@@ -2591,12 +2816,10 @@ const char* deobf_primitive(char type) {
 }
 
 void write_pg_mapping(
-    const std::string& filename,
+    std::ostream& ofs,
     DexClasses* classes,
     const std::unordered_map<DexClass*, std::vector<DexMethod*>>*
         detached_methods) {
-  if (filename.empty()) return;
-
   auto deobf_class = [&](DexClass* cls) {
     if (cls) {
       auto deobname = cls->get_deobfuscated_name();
@@ -2700,8 +2923,6 @@ void write_pg_mapping(
     return show(field);
   };
 
-  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
-
   for (auto cls : *classes) {
     auto deobf_cls = deobf_class(cls);
     ofs << java_names::internal_to_external(deobf_cls) << " -> "
@@ -2736,10 +2957,7 @@ void write_pg_mapping(
   }
 }
 
-void write_full_mapping(const std::string& filename, DexClasses* classes) {
-  if (filename.empty()) return;
-
-  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
+void write_full_mapping(std::ostream& ofs, DexClasses* classes) {
   for (auto cls : *classes) {
     ofs << "type " << cls->get_deobfuscated_name() << " -> " << show(cls)
         << std::endl;
@@ -2763,37 +2981,61 @@ void write_full_mapping(const std::string& filename, DexClasses* classes) {
 }
 
 void write_bytecode_offset_mapping(
-    const std::string& filename,
+    std::ostream& os,
     const std::vector<std::pair<std::string, uint32_t>>& method_offsets) {
-  if (filename.empty()) {
-    return;
-  }
-
-  auto fd = fopen(filename.c_str(), "a");
-  assert_log(fd, "Can't open bytecode offset file %s: %s\n", filename.c_str(),
-             strerror(errno));
-
   for (const auto& item : method_offsets) {
-    fprintf(fd, "%u %s\n", item.second, item.first.c_str());
+    os << item.second << " " << item.first << "\n";
   }
-
-  fclose(fd);
 }
 
 } // namespace
 
-void DexOutput::write_symbol_files() {
+void DexOutput::prepare_symbol_files() {
+  always_assert(!m_symbol_files_prepared);
+  m_symbol_files_prepared = true;
+  auto render = [&](const std::string& filename, const auto& write_fn) {
+    if (filename.empty()) {
+      return;
+    }
+    std::ostringstream os;
+    write_fn(os);
+    m_symbol_files.emplace_back(filename, os.str());
+  };
   if (m_debug_info_kind != DebugInfoKind::NoCustomSymbolication) {
-    write_method_mapping(m_method_mapping_filename, dodx, m_classes,
-                         hdr.signature);
-    write_class_mapping(m_class_mapping_filename, m_classes,
-                        hdr.class_defs_size, hdr.signature);
+    always_assert(!m_method_mapping_filename.empty());
+    always_assert(!m_class_mapping_filename.empty());
+    render(m_method_mapping_filename, [&](std::ostream& os) {
+      write_method_mapping(os, dodx, m_classes, hdr.signature);
+    });
+    render(m_class_mapping_filename, [&](std::ostream& os) {
+      write_class_mapping(os, m_classes, hdr.class_defs_size, hdr.signature);
+    });
     // XXX: should write_bytecode_offset_mapping be included here too?
   }
-  write_pg_mapping(m_pg_mapping_filename, m_classes, &m_detached_methods);
-  write_full_mapping(m_full_mapping_filename, m_classes);
-  write_bytecode_offset_mapping(m_bytecode_offset_filename,
-                                m_method_bytecode_offsets);
+  render(m_pg_mapping_filename, [&](std::ostream& os) {
+    write_pg_mapping(os, m_classes, &m_detached_methods);
+  });
+  render(m_full_mapping_filename,
+         [&](std::ostream& os) { write_full_mapping(os, m_classes); });
+  render(m_bytecode_offset_filename, [&](std::ostream& os) {
+    write_bytecode_offset_mapping(os, m_method_bytecode_offsets);
+  });
+}
+
+void DexOutput::write_symbol_files() {
+  if (!m_symbol_files_prepared) {
+    prepare_symbol_files();
+  }
+  for (const auto& file : m_symbol_files) {
+    const auto& filename = file.first;
+    std::ofstream ofs(filename.c_str(), std::ofstream::out |
+                                            std::ofstream::app |
+                                            std::ofstream::binary);
+    assert_log(ofs, "Can't open symbol file %s: %s\n", filename.c_str(),
+               strerror(errno));
+    ofs << file.second;
+  }
+  m_symbol_files.clear();
 }
 
 void GatheredTypes::set_method_sorting_allowlisted_substrings(
@@ -2810,10 +3052,25 @@ void GatheredTypes::set_legacy_order(bool legacy_order) {
   m_legacy_order = legacy_order;
 }
 
+void GatheredTypes::set_method_similarity_minhash(
+    bool method_similarity_minhash) {
+  m_method_similarity_minhash = method_similarity_minhash;
+}
+
 void DexOutput::prepare(SortMode string_mode,
                         const std::vector<SortMode>& code_mode,
                         ConfigFiles& conf,
                         const std::string& dex_magic) {
+  prepare_layout(string_mode, code_mode, conf, dex_magic);
+  prepare_debug_items();
+  finalize_layout();
+  compute_method_ids();
+}
+
+void DexOutput::prepare_layout(SortMode string_mode,
+                               const std::vector<SortMode>& code_mode,
+                               ConfigFiles& conf,
+                               const std::string& dex_magic) {
 
   if (std::find(code_mode.begin(), code_mode.end(),
                 SortMode::METHOD_PROFILED_ORDER) != code_mode.end()) {
@@ -2823,6 +3080,11 @@ void DexOutput::prepare(SortMode string_mode,
     m_gtypes->set_method_sorting_allowlisted_substrings(
         &conf.get_method_sorting_allowlisted_substrings());
   }
+  m_class_data_in_code_item_order =
+      conf.get_json_config().get("class_data_in_code_item_order", false);
+  // Approximate, but sub-quadratic; see MethodSimilarityOrderer.
+  m_gtypes->set_method_similarity_minhash(
+      conf.get_json_config().get("method_similarity_order_minhash", false));
 
   fix_jumbos(m_classes, dodx);
   init_header_offsets(dex_magic);
@@ -2839,14 +3101,39 @@ void DexOutput::prepare(SortMode string_mode,
   generate_callsite_data();
   generate_methodhandle_data();
   generate_annotations();
-  generate_debug_items();
+}
+
+void DexOutput::prepare_debug_items() { generate_debug_items(); }
+
+void DexOutput::finalize_layout() {
   generate_map();
   finalize_header();
+}
+
+void DexOutput::compute_method_ids() {
   compute_method_to_id_map(dodx, m_classes, hdr.signature, m_method_to_id);
 }
 
 void DexOutput::write() {
+  write_dex_file();
+  write_symbol_files();
+}
+
+void DexOutput::write_dex_file() {
   struct stat st;
+#if !IS_WINDOWS
+  if (m_output_fd != -1) {
+    // The dex is already in the file. Nothing past it is accessed anymore.
+    if (ftruncate(m_output_fd, m_offset) != 0) {
+      perror("Error writing dex");
+      return;
+    }
+    if (0 == fstat(m_output_fd, &st)) {
+      m_stats.num_bytes = st.st_size;
+    }
+    return;
+  }
+#endif
   int fd = open(m_filename, O_CREAT | O_TRUNC | O_WRONLY | O_BINARY, 0660);
   if (fd == -1) {
     perror("Error writing dex");
@@ -2857,8 +3144,6 @@ void DexOutput::write() {
     m_stats.num_bytes = st.st_size;
   }
   close(fd);
-
-  write_symbol_files();
 }
 
 class UniqueReferences {
@@ -2943,40 +3228,30 @@ static SortMode make_sort_bytecode(const std::string& sort_bytecode) {
   }
 }
 
-dex_stats_t write_classes_to_dex(
-    const RedexOptions& redex_options,
-    const std::string& filename,
-    DexClasses* classes,
-    LocatorIndex* locator_index,
-    size_t store_number,
-    size_t dex_number,
-    ConfigFiles& conf,
-    PositionMapper* pos_mapper,
-    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
-    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
-    IODIMetadata* iodi_metadata,
-    const std::string& dex_magic,
-    PostLowering* post_lowering,
-    int min_sdk,
-    bool disable_method_similarity_order) {
+namespace {
+
+struct DexOutputConfig {
+  SortMode string_sort_mode{SortMode::DEFAULT};
+  std::vector<SortMode> code_sort_mode;
+  bool normal_primary_dex{false};
+};
+
+DexOutputConfig get_dex_output_config(const ConfigFiles& conf,
+                                      bool disable_method_similarity_order) {
   const JsonWrapper& json_cfg = conf.get_json_config();
-  bool force_single_dex = json_cfg.get("force_single_dex", false);
-  if (force_single_dex) {
-    always_assert_log(dex_number == 0, "force_single_dex requires one dex");
-  }
+  DexOutputConfig config;
   auto sort_strings = json_cfg.get("string_sort_mode", std::string());
-  SortMode string_sort_mode = SortMode::DEFAULT;
   if (sort_strings == "class_strings") {
-    string_sort_mode = SortMode::CLASS_STRINGS;
+    config.string_sort_mode = SortMode::CLASS_STRINGS;
   } else if (sort_strings == "class_order") {
-    string_sort_mode = SortMode::CLASS_ORDER;
+    config.string_sort_mode = SortMode::CLASS_ORDER;
   }
 
   auto interdex_config = json_cfg.get("InterDexPass", Json::Value());
-  auto normal_primary_dex =
+  config.normal_primary_dex =
       interdex_config.get("normal_primary_dex", false).asBool();
   auto sort_bytecode_cfg = json_cfg.get("bytecode_sort_mode", Json::Value());
-  std::vector<SortMode> code_sort_mode;
+  auto& code_sort_mode = config.code_sort_mode;
 
   if (sort_bytecode_cfg.isString()) {
     code_sort_mode.push_back(make_sort_bytecode(sort_bytecode_cfg.asString()));
@@ -2996,20 +3271,122 @@ dex_stats_t write_classes_to_dex(
   if (code_sort_mode.empty()) {
     code_sort_mode.push_back(SortMode::DEFAULT);
   }
+  return config;
+}
+
+} // namespace
+
+dex_stats_t write_classes_to_dex(
+    const RedexOptions& redex_options,
+    const std::string& filename,
+    DexClasses* classes,
+    LocatorIndex* locator_index,
+    size_t store_number,
+    size_t dex_number,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    PostLowering* post_lowering,
+    int min_sdk,
+    bool disable_method_similarity_order) {
+  bool force_single_dex = conf.get_json_config().get("force_single_dex", false);
+  if (force_single_dex) {
+    always_assert_log(dex_number == 0, "force_single_dex requires one dex");
+  }
+  auto config = get_dex_output_config(conf, disable_method_similarity_order);
 
   TRACE(OPUT, 2, "[write_classes_to_dex][filename] %s", filename.c_str());
 
-  DexOutput dout(filename.c_str(), classes, locator_index, normal_primary_dex,
-                 store_number, dex_number, redex_options.debug_info_kind,
-                 iodi_metadata, conf, pos_mapper, method_to_id,
-                 code_debug_lines, post_lowering, min_sdk);
+  DexOutput dout(filename.c_str(), classes, locator_index,
+                 config.normal_primary_dex, store_number, dex_number,
+                 redex_options.debug_info_kind, iodi_metadata, conf, pos_mapper,
+                 method_to_id, code_debug_lines, post_lowering, min_sdk);
 
-  dout.prepare(string_sort_mode, code_sort_mode, conf, dex_magic);
+  dout.prepare(config.string_sort_mode, config.code_sort_mode, conf,
+               dex_magic);
   dout.write();
   dout.metrics();
   return dout.m_stats;
 }
 
+std::vector<dex_stats_t> write_store_to_dexes(
+    const RedexOptions& redex_options,
+    const std::vector<std::string>& filenames,
+    DexClassesVector* dexen,
+    LocatorIndex* locator_index,
+    size_t store_number,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    PostLowering* post_lowering,
+    int min_sdk,
+    bool disable_method_similarity_order) {
+  always_assert(filenames.size() == dexen->size());
+  bool force_single_dex = conf.get_json_config().get("force_single_dex", false);
+  if (force_single_dex) {
+    always_assert_log(dexen->size() <= 1, "force_single_dex requires one dex");
+  }
+  auto config = get_dex_output_config(conf, disable_method_similarity_order);
+  // Make sure lazily computed configuration is initialized before it is
+  // accessed concurrently.
+  conf.get_method_profiles();
+  conf.get_method_sorting_allowlisted_substrings();
+
+  // Each DexOutput holds a full output buffer, so only work on as many dexes
+  // at a time as there are threads.
+  const size_t num_threads = redex_parallel::default_num_threads();
+  std::vector<dex_stats_t> stats;
+  for (size_t window_start = 0; window_start < dexen->size();
+       window_start += num_threads) {
+    size_t window_end = std::min(window_start + num_threads, dexen->size());
+    std::vector<size_t> indices(window_end - window_start);
+    std::iota(indices.begin(), indices.end(), window_start);
+    std::vector<std::unique_ptr<DexOutput>> douts(dexen->size());
+
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          TRACE(OPUT, 2, "[write_classes_to_dex][filename] %s",
+                filenames[i].c_str());
+          douts[i] = std::make_unique<DexOutput>(
+              filenames[i].c_str(), &dexen->at(i), locator_index,
+              config.normal_primary_dex, store_number, i,
+              redex_options.debug_info_kind, iodi_metadata, conf, pos_mapper,
+              method_to_id, code_debug_lines, post_lowering, min_sdk);
+          // A dex that is written alongside others does its own work on
+          // this thread, rather than on a work queue of its own per worker.
+          douts[i]->set_parallel(indices.size() == 1);
+          douts[i]->prepare_layout(config.string_sort_mode,
+                                   config.code_sort_mode, conf, dex_magic);
+        },
+        indices);
+    for (auto i : indices) {
+      douts[i]->prepare_debug_items();
+    }
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          douts[i]->finalize_layout();
+          douts[i]->write_dex_file();
+          douts[i]->prepare_symbol_files();
+        },
+        indices);
+    for (auto i : indices) {
+      auto& dout = *douts[i];
+      dout.compute_method_ids();
+      dout.write_symbol_files();
+      dout.metrics();
+      stats.push_back(dout.m_stats);
+      douts[i].reset();
+    }
+  }
+  return stats;
+}
+
 LocatorIndex make_locator_index(DexStoresVector& stores) {
   LocatorIndex index;
 
@@ -3048,6 +3425,90 @@ LocatorIndex make_locator_index(DexStoresVector& stores) {
   return index;
 }
 
+std::string make_locator_table(const DexStoresVector& stores) {
+  using facebook::LocatorTable;
+  struct Key {
+    const char* descriptor;
+    uint32_t hash;
+    Locator locator;
+  };
+  std::vector<Key> keys;
+  std::unordered_set<const DexString*> names;
+  for (uint32_t strnr = 0; strnr < stores.size(); strnr++) {
+    const auto& dexen = stores[strnr].get_dexen();
+    uint32_t dexnr = 1; // Zero is reserved for Android classes
+    for (auto dexit = dexen.begin(); dexit != dexen.end(); ++dexit, ++dexnr) {
+      uint32_t clsnr = 0;
+      for (auto* cls : *dexit) {
+        const auto* name = cls->get_type()->get_name();
+        always_assert_log(names.insert(name).second,
+                          "This was already inserted %s\n",
+                          cls->get_deobfuscated_name().c_str());
+        keys.push_back({name->c_str(), LocatorTable::hash(name->c_str(), 0),
+                        Locator::make(strnr, dexnr, clsnr++)});
+      }
+    }
+  }
+
+  // An average of four descriptors per bucket, and a load factor of 0.8, keep
+  // the search for seeds short.
+  LocatorTable::Header header{LocatorTable::magic, LocatorTable::version,
+                              static_cast<uint32_t>(keys.size() / 4 + 1),
+                              static_cast<uint32_t>(keys.size() * 5 / 4 + 1)};
+  std::vector<std::vector<uint32_t>> buckets(header.nbuckets);
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    buckets[keys[i].hash % header.nbuckets].push_back(i);
+  }
+  // The largest buckets are the hardest to place, so they go first, while
+  // most slots are free.
+  std::vector<uint32_t> order(header.nbuckets);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return buckets[a].size() > buckets[b].size();
+  });
+  std::vector<uint32_t> seeds(header.nbuckets, 0);
+  std::vector<LocatorTable::Entry> entries(header.nslots, {0, 0, 0, 0});
+  std::vector<uint32_t> slots;
+  for (auto b : order) {
+    const auto& bucket = buckets[b];
+    if (bucket.empty()) {
+      break;
+    }
+    for (uint32_t seed = 0;; ++seed) {
+      slots.clear();
+      for (auto i : bucket) {
+        uint32_t slot =
+            LocatorTable::hash(keys[i].descriptor, seed) % header.nslots;
+        if (entries[slot].dexnr != 0 ||
+            std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (slots.size() == bucket.size()) {
+        seeds[b] = seed;
+        break;
+      }
+    }
+    for (size_t j = 0; j < bucket.size(); ++j) {
+      const auto& key = keys[bucket[j]];
+      entries[slots[j]] = {key.hash, static_cast<uint16_t>(key.locator.strnr),
+                           static_cast<uint16_t>(key.locator.dexnr),
+                           key.locator.clsnr};
+    }
+  }
+  TRACE(LOC, 2, "Locator table: %zu classes in %u slots", keys.size(),
+        header.nslots);
+
+  std::string table;
+  table.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  table.append(reinterpret_cast<const char*>(seeds.data()),
+               seeds.size() * sizeof(uint32_t));
+  table.append(reinterpret_cast<const char*>(entries.data()),
+               entries.size() * sizeof(LocatorTable::Entry));
+  return table;
+}
+
 void DexOutput::inc_offset(uint32_t v) {
   // If this asserts hits, we already wrote out of bounds.
   always_assert(m_offset + v < m_output_size);
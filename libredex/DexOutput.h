@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <unordered_map>
 
@@ -39,6 +40,13 @@ using dexmethodhandle_to_idx = std::unordered_map<DexMethodHandle*, uint32_t>;
 using LocatorIndex = std::unordered_map<DexString*, Locator>;
 LocatorIndex make_locator_index(DexStoresVector& stores);
 
+/*
+ * Builds a facebook::LocatorTable of all the classes of the stores, with the
+ * same locators as make_locator_index, for class loaders that look classes up
+ * by descriptor rather than through locator strings.
+ */
+std::string make_locator_table(const DexStoresVector& stores);
+
 enum class SortMode {
   CLASS_ORDER,
   CLASS_STRINGS,
@@ -145,6 +153,27 @@ dex_stats_t write_classes_to_dex(
     int min_sdk = 0,
     bool disable_method_similarity_order = false);
 
+// Write all dexes of a store, `filenames[i]` receiving `(*dexen)[i]`. Dexes are
+// laid out and written concurrently, while the steps that update state shared
+// between dexes (positions, IODI metadata, method ids, symbol files, metrics)
+// run in dex order, so the output is identical to calling
+// write_classes_to_dex for each dex in turn.
+std::vector<dex_stats_t> write_store_to_dexes(
+    const RedexOptions&,
+    const std::vector<std::string>& filenames,
+    DexClassesVector* dexen,
+    LocatorIndex* locator_index /* nullable */,
+    size_t store_number,
+    ConfigFiles& conf,
+    PositionMapper* pos_mapper,
+    std::unordered_map<DexMethod*, uint64_t>* method_to_id,
+    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* code_debug_lines,
+    IODIMetadata* iodi_metadata,
+    const std::string& dex_magic,
+    PostLowering* post_lowering = nullptr,
+    int min_sdk = 0,
+    bool disable_method_similarity_order = false);
+
 using cmp_dstring = bool (*)(const DexString*, const DexString*);
 using cmp_dtype = bool (*)(const DexType*, const DexType*);
 using cmp_dproto = bool (*)(const DexProto*, const DexProto*);
@@ -228,6 +257,7 @@ class GatheredTypes {
   const std::unordered_set<std::string>*
       m_method_sorting_allowlisted_substrings{nullptr};
   bool m_legacy_order{true};
+  bool m_method_similarity_minhash{false};
 
   dexstring_to_idx* get_string_index(cmp_dstring cmp = compare_dexstrings);
   dextype_to_idx* get_type_index(cmp_dtype cmp = compare_dextypes);
@@ -269,6 +299,7 @@ class GatheredTypes {
   void set_method_profiles(
       const method_profiles::MethodProfiles* method_profiles);
   void set_legacy_order(bool legacy_order);
+  void set_method_similarity_minhash(bool method_similarity_minhash);
 
   std::unordered_set<DexString*> index_type_names();
 };
@@ -314,12 +345,18 @@ class DexOutput {
   DexOutputIdx* dodx;
   GatheredTypes* m_gtypes;
   const size_t m_output_size;
-  std::unique_ptr<uint8_t[]> m_output;
+  // The output file while it is mapped, see `dex_output_mmap`.
+  int m_output_fd{-1};
+  // Zero-filled. Either a heap buffer, or a mapping of the output file.
+  std::unique_ptr<uint8_t, std::function<void(uint8_t*)>> m_output;
   uint32_t m_offset;
   const char* m_filename;
   size_t m_store_number;
   size_t m_dex_number;
   DebugInfoKind m_debug_info_kind;
+  // Debug opcodes left out of the debug items, see
+  // `strip_debug_info_at_output`.
+  DebugOpcodeFilter m_debug_opcode_filter;
   IODIMetadata* m_iodi_metadata;
   PositionMapper* m_pos_mapper;
   std::string m_method_mapping_filename;
@@ -335,10 +372,17 @@ class DexOutput {
   std::unordered_map<DexClass*, uint32_t> m_static_values;
   std::unordered_map<DexCallSite*, uint32_t> m_call_site_items;
   std::unordered_map<DexClass*, std::vector<DexMethod*>> m_detached_methods;
+  // The contents appended to each symbol file, see prepare_symbol_files.
+  std::vector<std::pair<std::string, std::string>> m_symbol_files;
+  bool m_symbol_files_prepared{false};
   dex_header hdr;
   std::vector<dex_map_item> m_map_items;
   LocatorIndex* m_locator_index;
   bool m_normal_primary_dex;
+  // Whether to lay out the class data items in the order in which the code
+  // of their classes first appears, so that they follow the profiled code.
+  bool m_class_data_in_code_item_order{false};
+  bool m_parallel{true};
   const ConfigFiles& m_config_files;
   int m_min_sdk;
 
@@ -380,7 +424,6 @@ class DexOutput {
   void generate_map();
   void finalize_header();
   void init_header_offsets(const std::string& dex_magic);
-  void write_symbol_files();
   uint32_t align(uint32_t offset) { return (offset + 3) & ~3; }
   void align_output() { m_offset = align(m_offset); }
   void emit_locator(Locator locator);
@@ -415,6 +458,28 @@ class DexOutput {
                const std::string& dex_magic);
   void write();
   void metrics();
+
+  // The steps of prepare() and write(), in order. Only prepare_debug_items,
+  // compute_method_ids and write_symbol_files touch state shared with other
+  // dexes; the remaining steps may run concurrently for different dexes.
+  void prepare_layout(SortMode string_mode,
+                      const std::vector<SortMode>& code_mode,
+                      ConfigFiles& conf,
+                      const std::string& dex_magic);
+  void prepare_debug_items();
+  void finalize_layout();
+  void compute_method_ids();
+  void write_dex_file();
+  // Renders this dex's part of the symbol files into memory. Only reads
+  // state of this dex, so it may run concurrently for different dexes, after
+  // write_dex_file. write_symbol_files then appends the rendered parts, in
+  // dex order, and renders them first if that was not done.
+  void prepare_symbol_files();
+  void write_symbol_files();
+  // Whether the steps of this dex split their own work, like the encoding of
+  // its items, across threads. On by default; turned off when several dexes
+  // are written concurrently, which already uses all the threads.
+  void set_parallel(bool parallel) { m_parallel = parallel; }
   static void check_method_instruction_size_limit(const ConfigFiles& conf,
                                                   int size,
                                                   const char* method_name);
@@ -12,6 +12,7 @@
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "Show.h"
+#include "SlabAllocator.h"
 
 DexPosition::DexPosition(uint32_t line) : line(line) {}
 
@@ -23,6 +24,17 @@ void DexPosition::bind(DexString* method_, DexString* file_) {
   this->file = file_;
 }
 
+using DexPositionAllocator =
+    SlabAllocator<sizeof(DexPosition), alignof(DexPosition)>;
+
+void* DexPosition::operator new(size_t size) {
+  return DexPositionAllocator::allocate(size);
+}
+
+void DexPosition::operator delete(void* ptr, size_t size) {
+  DexPositionAllocator::deallocate(ptr, size);
+}
+
 bool DexPosition::operator==(const DexPosition& that) const {
   return method == that.method && file == that.file && line == that.line &&
          (parent == that.parent ||
@@ -37,6 +37,11 @@ struct DexPosition final {
 
   static std::unique_ptr<DexPosition> make_synthetic_entry_position(
       const DexMethod* method);
+
+  // Positions are allocated per instruction position and duplicated by the
+  // inliner, so they are pooled (see SlabAllocator.h).
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
 };
 inline size_t hash_value(const DexPosition& pos) {
   return (size_t)pos.method + (size_t)pos.file + pos.line +
@@ -7,13 +7,98 @@
 
 #include "DexTypeEnvironment.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
 #include <boost/optional/optional_io.hpp>
 #include <ostream>
+#include <unordered_map>
 
+#include "ConcurrentContainers.h"
+#include "RedexContext.h"
 #include "Show.h"
 
 namespace dtv_impl {
 
+namespace {
+
+struct SmallTypeSetHash {
+  size_t operator()(const SmallTypeSet& set) const { return set.hash(); }
+};
+
+ReadMostlyConcurrentMap<SmallTypeSet, const SmallTypeSet*, SmallTypeSetHash>&
+interned_sets() {
+  static auto* sets = new ReadMostlyConcurrentMap<SmallTypeSet,
+                                                  const SmallTypeSet*,
+                                                  SmallTypeSetHash>();
+  return *sets;
+}
+
+} // namespace
+
+size_t SmallTypeSet::hash() const {
+  return boost::hash_range(begin(), end());
+}
+
+const SmallTypeSet* SmallTypeSet::intern(const SmallTypeSet& set) {
+  auto& sets = interned_sets();
+  auto* interned = sets.get(set, nullptr);
+  if (interned != nullptr) {
+    return interned;
+  }
+  auto* copy = new SmallTypeSet(set);
+  if (!sets.emplace(set, copy)) {
+    // Another thread interned it first.
+    delete copy;
+    return sets.at(set);
+  }
+  return copy;
+}
+
+const SmallTypeSet* SmallTypeSet::empty() {
+  static const SmallTypeSet* empty_set = intern(SmallTypeSet());
+  return empty_set;
+}
+
+const SmallTypeSet* SmallTypeSet::singleton(const DexType* type) {
+  SmallTypeSet set;
+  set.m_types[0] = type;
+  set.m_size = 1;
+  return intern(set);
+}
+
+const SmallTypeSet* SmallTypeSet::get_union(const SmallTypeSet* a,
+                                            const SmallTypeSet* b) {
+  if (a == b || b->m_size == 0) {
+    return a;
+  }
+  if (a->m_size == 0) {
+    return b;
+  }
+  std::array<const DexType*, 2 * MAX_SET_SIZE> types;
+  auto types_end = std::set_union(a->begin(), a->end(), b->begin(), b->end(),
+                                  types.begin(), std::less<const DexType*>());
+  size_t size = types_end - types.begin();
+  if (size > MAX_SET_SIZE) {
+    return nullptr;
+  }
+  if (size == a->m_size) {
+    return a;
+  }
+  if (size == b->m_size) {
+    return b;
+  }
+  SmallTypeSet set;
+  std::copy(types.begin(), types_end, set.m_types.begin());
+  set.m_size = size;
+  return intern(set);
+}
+
+bool SmallTypeSet::is_subset_of(const SmallTypeSet& other) const {
+  return this == &other ||
+         std::includes(other.begin(), other.end(), begin(), end(),
+                       std::less<const DexType*>());
+}
+
 bool implements(const DexClass* cls, const DexType* intf) {
   if (is_interface(cls)) {
     return false;
@@ -120,6 +205,43 @@ const DexType* find_common_array_type(const DexType* l, const DexType* r) {
   return nullptr;
 }
 
+/*
+ * The common types that a thread has computed so far. Type analyses join the
+ * same pairs of types over and over, and each join walks the class
+ * hierarchy. The cache is dropped whenever the class hierarchy may have
+ * changed, which RedexContext tracks with the method resolution epoch.
+ */
+struct CommonTypeCache {
+  uint32_t epoch{0};
+  std::unordered_map<std::pair<const DexType*, const DexType*>,
+                     const DexType*,
+                     boost::hash<std::pair<const DexType*, const DexType*>>>
+      common_types;
+};
+
+// Bounds the memory held by each thread.
+constexpr size_t MAX_CACHED_COMMON_TYPES = 1 << 16;
+
+const DexType* find_common_type_cached(const DexType* l, const DexType* r) {
+  thread_local CommonTypeCache cache;
+  auto epoch = g_redex->method_resolution_epoch();
+  if (cache.epoch != epoch ||
+      cache.common_types.size() >= MAX_CACHED_COMMON_TYPES) {
+    cache.common_types.clear();
+    cache.epoch = epoch;
+  }
+  auto key = std::make_pair(l, r);
+  auto it = cache.common_types.find(key);
+  if (it != cache.common_types.end()) {
+    return it->second;
+  }
+  auto common_type = type::is_array(l) && type::is_array(r)
+                         ? find_common_array_type(l, r)
+                         : find_common_type(l, r);
+  cache.common_types.emplace(key, common_type);
+  return common_type;
+}
+
 /*
  * Partially mimicing the Dalvik bytecode structural verifier:
  * https://android.googlesource.com/platform/dalvik/+/android-cts-4.4_r4/vm/analysis/CodeVerify.cpp#2462
@@ -135,20 +257,11 @@ sparta::AbstractValueKind DexTypeValue::join_with(const DexTypeValue& other) {
     return sparta::AbstractValueKind::Value;
   }
 
-  auto l = get_dex_type();
-  auto r = other.get_dex_type();
-  if (type::is_array(l) && type::is_array(r)) {
-    auto common_array_type = find_common_array_type(l, r);
-    if (common_array_type) {
-      m_dex_type = common_array_type;
-      return sparta::AbstractValueKind::Value;
-    }
-  } else {
-    auto common_type = find_common_type(l, r);
-    if (common_type) {
-      m_dex_type = common_type;
-      return sparta::AbstractValueKind::Value;
-    }
+  auto common_type = find_common_type_cached(get_dex_type(),
+                                             other.get_dex_type());
+  if (common_type) {
+    m_dex_type = common_type;
+    return sparta::AbstractValueKind::Value;
   }
 
   // Give up. Rewrite to top.
@@ -176,17 +289,11 @@ bool SmallSetDexTypeDomain::leq(const SmallSetDexTypeDomain& other) const {
   if (is_top()) {
     return false;
   }
-  return m_types.is_subset_of(other.m_types);
+  return m_types->is_subset_of(*other.m_types);
 }
 
 bool SmallSetDexTypeDomain::equals(const SmallSetDexTypeDomain& other) const {
-  if (is_bottom()) {
-    return other.is_bottom();
-  }
-  if (is_top()) {
-    return other.is_top();
-  }
-  return m_types.equals(other.m_types);
+  return m_kind == other.m_kind && m_types == other.m_types;
 }
 
 void SmallSetDexTypeDomain::join_with(const SmallSetDexTypeDomain& other) {
@@ -202,10 +309,12 @@ void SmallSetDexTypeDomain::join_with(const SmallSetDexTypeDomain& other) {
     m_types = other.m_types;
     return;
   }
-  m_types.union_with(other.m_types);
-  if (m_types.size() > MAX_SET_SIZE) {
+  auto types = dtv_impl::SmallTypeSet::get_union(m_types, other.m_types);
+  if (types == nullptr) {
     set_to_top();
+    return;
   }
+  m_types = types;
 }
 
 void SmallSetDexTypeDomain::widen_with(const SmallSetDexTypeDomain& other) {
@@ -221,7 +330,7 @@ void SmallSetDexTypeDomain::widen_with(const SmallSetDexTypeDomain& other) {
     m_types = other.m_types;
     return;
   }
-  if (m_types.size() + other.m_types.size() > MAX_SET_SIZE) {
+  if (m_types->size() + other.m_types->size() > MAX_SET_SIZE) {
     set_to_top();
     return;
   }
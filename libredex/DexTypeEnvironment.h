@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <ostream>
 
 #include <boost/optional.hpp>
@@ -19,8 +21,51 @@
 #include "PatriciaTreeSet.h"
 #include "ReducedProductAbstractDomain.h"
 
+constexpr size_t MAX_SET_SIZE = 4;
+
 namespace dtv_impl {
 
+/*
+ * A set of at most MAX_SET_SIZE types. The sets are interned, so that equal
+ * sets are the same object: copying a set, and comparing sets for equality,
+ * is a pointer operation, and the joins of type environments, which mostly
+ * join a set with itself, find out that there is nothing to do right away.
+ *
+ * Interned sets are never freed. They only hold type pointers, and there are
+ * few distinct sets of up to MAX_SET_SIZE types in a program.
+ */
+class SmallTypeSet final {
+ public:
+  static const SmallTypeSet* empty();
+
+  static const SmallTypeSet* singleton(const DexType* type);
+
+  // The union of `a` and `b`, or nullptr if it has more than MAX_SET_SIZE
+  // types.
+  static const SmallTypeSet* get_union(const SmallTypeSet* a,
+                                       const SmallTypeSet* b);
+
+  bool is_subset_of(const SmallTypeSet& other) const;
+
+  size_t size() const { return m_size; }
+
+  const DexType* const* begin() const { return m_types.data(); }
+  const DexType* const* end() const { return m_types.data() + m_size; }
+
+  // For the interning table.
+  bool operator==(const SmallTypeSet& other) const {
+    return m_size == other.m_size && m_types == other.m_types;
+  }
+  size_t hash() const;
+
+ private:
+  static const SmallTypeSet* intern(const SmallTypeSet& set);
+
+  // Sorted, with the unused elements set to nullptr.
+  std::array<const DexType*, MAX_SET_SIZE> m_types{};
+  uint8_t m_size{0};
+};
+
 class DexTypeValue final : public sparta::AbstractValue<DexTypeValue> {
  public:
   ~DexTypeValue() override {
@@ -150,17 +195,17 @@ std::ostream& operator<<(std::ostream& output, const DexType* dex_type);
  * Small Set DexTypeDomain
  *
  */
-constexpr size_t MAX_SET_SIZE = 4;
 
 class SmallSetDexTypeDomain final
     : public sparta::AbstractDomain<SmallSetDexTypeDomain> {
  public:
-  SmallSetDexTypeDomain() : m_kind(sparta::AbstractValueKind::Value) {}
+  SmallSetDexTypeDomain()
+      : m_types(dtv_impl::SmallTypeSet::empty()),
+        m_kind(sparta::AbstractValueKind::Value) {}
 
-  explicit SmallSetDexTypeDomain(const DexType* type) {
-    m_types.insert(type);
-    m_kind = sparta::AbstractValueKind::Value;
-  }
+  explicit SmallSetDexTypeDomain(const DexType* type)
+      : m_types(dtv_impl::SmallTypeSet::singleton(type)),
+        m_kind(sparta::AbstractValueKind::Value) {}
 
   bool is_bottom() const override {
     return m_kind == sparta::AbstractValueKind::Bottom;
@@ -172,19 +217,20 @@ class SmallSetDexTypeDomain final
 
   void set_to_bottom() override {
     m_kind = sparta::AbstractValueKind::Bottom;
-    m_types.clear();
+    m_types = dtv_impl::SmallTypeSet::empty();
   }
 
   void set_to_top() override {
     m_kind = sparta::AbstractValueKind::Top;
-    m_types.clear();
+    m_types = dtv_impl::SmallTypeSet::empty();
   }
 
   sparta::AbstractValueKind kind() const { return m_kind; }
 
   sparta::PatriciaTreeSet<const DexType*> get_types() const {
     always_assert(!is_top());
-    return m_types;
+    return sparta::PatriciaTreeSet<const DexType*>(m_types->begin(),
+                                                   m_types->end());
   }
 
   bool leq(const SmallSetDexTypeDomain& other) const override;
@@ -207,7 +253,8 @@ class SmallSetDexTypeDomain final
                                   const SmallSetDexTypeDomain& x);
 
  private:
-  sparta::PatriciaTreeSet<const DexType*> m_types;
+  // Interned, so never nullptr.
+  const dtv_impl::SmallTypeSet* m_types;
   sparta::AbstractValueKind m_kind;
 };
 
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#include "Util.h"
+
+#if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
+extern "C" bool strcmp_less(const char* str1, const char* str2);
+#endif
+
+/*
+ * String comparison and hashing for the hot paths of string interning and
+ * sorting, which mostly see short, NUL-terminated strings sharing long
+ * prefixes (type and member names).
+ *
+ * vector_less() looks at 16 bytes at a time with SSE2 or NEON, and 8 bytes
+ * at a time elsewhere. Like strcmp_less.S, it may read past the terminating
+ * NUL, but never across a page boundary, so it cannot fault. Such reads are
+ * invisible to ASAN, which is why it is turned off for that function.
+ */
+namespace fast_string {
+
+namespace detail {
+
+constexpr uintptr_t PAGE_SIZE = 4096;
+
+// Whether `n` bytes can be read from both `a` and `b` without touching the
+// next page. This is conservative: or-ing the offsets is cheaper than
+// checking them separately, and can only overestimate them.
+inline bool fits_in_page(const char* a, const char* b, size_t n) {
+  auto offsets =
+      reinterpret_cast<uintptr_t>(a) | reinterpret_cast<uintptr_t>(b);
+  return (offsets & (PAGE_SIZE - 1)) <= PAGE_SIZE - n;
+}
+
+// Compares at most `n` bytes, stopping at the first difference or NUL, and
+// returns the sign of the comparison. `done` is false and the pointers are
+// advanced by `n` if the comparison was not decided.
+inline int compare_bytes(const char*& a,
+                         const char*& b,
+                         size_t n,
+                         bool* done) {
+  for (size_t i = 0; i < n; ++i, ++a, ++b) {
+    auto ca = static_cast<unsigned char>(*a);
+    auto cb = static_cast<unsigned char>(*b);
+    if (ca != cb || ca == 0) {
+      *done = true;
+      return ca < cb ? -1 : (ca > cb ? 1 : 0);
+    }
+  }
+  *done = false;
+  return 0;
+}
+
+inline uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccd;
+  h ^= h >> 33;
+  return h;
+}
+
+inline uint64_t hash_word(uint64_t h, uint64_t word) {
+#if defined(__SSE4_2__) && defined(__x86_64__)
+  return _mm_crc32_u64(h, word);
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+  return __crc32cd(static_cast<uint32_t>(h), word);
+#else
+  return mix(h ^ word) * 0xc4ceb9fe1a85ec53;
+#endif
+}
+
+} // namespace detail
+
+/*
+ * Same result as strcmp(a, b) < 0, vectorized.
+ */
+NO_SANITIZE_ADDRESS inline bool vector_less(const char* a, const char* b) {
+#if defined(__SSE2__) || (defined(__aarch64__) && defined(__ARM_NEON))
+  constexpr size_t kWidth = 16;
+#else
+  constexpr size_t kWidth = 8;
+#endif
+  while (true) {
+    if (!detail::fits_in_page(a, b, kWidth)) {
+      bool done;
+      auto res = detail::compare_bytes(a, b, kWidth, &done);
+      if (done) {
+        return res < 0;
+      }
+      continue;
+    }
+#if defined(__SSE2__)
+    auto va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    // Bytes that are both equal and not the end of `a` stay non-zero.
+    auto cont = _mm_min_epu8(_mm_cmpeq_epi8(va, vb), va);
+    auto mask = static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(cont, _mm_setzero_si128())));
+    if (mask != 0) {
+      auto i = __builtin_ctz(mask);
+      return static_cast<unsigned char>(a[i]) <
+             static_cast<unsigned char>(b[i]);
+    }
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    auto va = vld1q_u8(reinterpret_cast<const uint8_t*>(a));
+    auto vb = vld1q_u8(reinterpret_cast<const uint8_t*>(b));
+    auto stop = vorrq_u8(vmvnq_u8(vceqq_u8(va, vb)), vceqzq_u8(va));
+    // Narrow each byte to 4 bits, giving a 64-bit mask.
+    auto mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(stop), 4)), 0);
+    if (mask != 0) {
+      auto i = __builtin_ctzll(mask) >> 2;
+      return static_cast<unsigned char>(a[i]) <
+             static_cast<unsigned char>(b[i]);
+    }
+#else
+    uint64_t wa;
+    uint64_t wb;
+    memcpy(&wa, a, sizeof(wa));
+    memcpy(&wb, b, sizeof(wb));
+    constexpr uint64_t kLow = 0x0101010101010101;
+    constexpr uint64_t kHigh = 0x8080808080808080;
+    bool has_zero = ((wa - kLow) & ~wa & kHigh) != 0;
+    if (wa != wb || has_zero) {
+      bool done;
+      return detail::compare_bytes(a, b, kWidth, &done) < 0;
+    }
+#endif
+    a += kWidth;
+    b += kWidth;
+  }
+}
+
+/*
+ * Same result as strcmp(a, b) < 0. glibc dispatches strcmp to a version
+ * vectorized for the running CPU (up to AVX2), which measured faster than
+ * vector_less(), so it is used there.
+ */
+inline bool less(const char* a, const char* b) {
+#if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
+  return strcmp_less(a, b);
+#elif defined(__GLIBC__)
+  return strcmp(a, b) < 0;
+#else
+  return vector_less(a, b);
+#endif
+}
+
+/*
+ * A hash of `len` bytes, consumed 8 bytes at a time, with the CRC32
+ * instructions where available. It is only meant for in-memory tables: the
+ * value differs between platforms.
+ */
+inline size_t hash(const char* s, size_t len) {
+  uint64_t h = len;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, s + i, sizeof(word));
+    h = detail::hash_word(h, word);
+  }
+  if (i < len) {
+    uint64_t word = 0;
+    memcpy(&word, s + i, len - i);
+    h = detail::hash_word(h, word);
+  }
+  return static_cast<size_t>(detail::mix(h));
+}
+
+} // namespace fast_string
@@ -7,11 +7,40 @@
 
 #include "FrameworkApi.h"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
+#include <cstring>
 #include <fstream>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+#include "RedexMappedFile.h"
 
 namespace api {
 
+namespace {
+
+// Whether the access flags of a method or field match those of the API.
+bool access_flags_match(DexAccessFlags access_flags,
+                        DexAccessFlags api_access_flags,
+                        bool relax_access_flags_matching) {
+  // NOTE: We accept cases where the members are not declared final.
+  if (access_flags == api_access_flags ||
+      (access_flags & ~ACC_FINAL) == api_access_flags) {
+    return true;
+  }
+  // There are mismatches on the higher bits of the access flags on some
+  // members between the API file generated using dex.py and what we have in
+  // Redex, even if they are the 'same' member.
+  // In the member presence check, we relax the matching to only
+  // the last 4 bits that includes PUBLIC, PRIVATE, PROTECTED and STATIC.
+  return relax_access_flags_matching &&
+         (0xF & api_access_flags) == (0xF & access_flags);
+}
+
+} // namespace
+
 bool FrameworkAPI::has_method(const std::string& simple_deobfuscated_name,
                               DexProto* meth_proto,
                               DexAccessFlags meth_access_flags,
@@ -24,23 +53,10 @@ bool FrameworkAPI::has_method(const std::string& simple_deobfuscated_name,
     }
 
     // We also need to check the access flags.
-    // NOTE: We accept cases where the methods are not declared final.
-    if (meth_access_flags == mref_info.access_flags ||
-        (meth_access_flags & ~ACC_FINAL) == mref_info.access_flags) {
+    if (access_flags_match(meth_access_flags, mref_info.access_flags,
+                           relax_access_flags_matching)) {
       return true;
     }
-    // There are mismatches on the higher bits of the access flags on some
-    // methods between the API file generated using dex.py and what we have in
-    // Redex, even if they are the 'same' method.
-    // In the method presence check, we relax the matching to only
-    // the last 4 bits that includes PUBLIC, PRIVATE, PROTECTED and STATIC.
-    if (relax_access_flags_matching) {
-      auto masked_info_access = 0xF & mref_info.access_flags;
-      auto masked_meth_access = 0xF & meth_access_flags;
-      if (masked_info_access == masked_meth_access) {
-        return true;
-      }
-    }
   }
   return false;
 }
@@ -55,23 +71,10 @@ bool FrameworkAPI::has_field(const std::string& simple_deobfuscated_name,
     }
 
     // We also need to check the access flags.
-    // NOTE: We accept cases where the fields are not declared final.
-    if (field_access_flags == fref_info.access_flags ||
-        (field_access_flags & ~ACC_FINAL) == fref_info.access_flags) {
+    if (access_flags_match(field_access_flags, fref_info.access_flags,
+                           relax_access_flags_matching)) {
       return true;
     }
-    // There are mismatches on the higher bits of the access flags on some
-    // fields between the API file generated using dex.py and what we have in
-    // Redex, even if they are the 'same' field.
-    // In the field presence check, we relax the matching to only
-    // the last 4 bits that includes PUBLIC, PRIVATE, PROTECTED and STATIC.
-    if (relax_access_flags_matching) {
-      auto masked_info_access = 0xF & fref_info.access_flags;
-      auto masked_field_access = 0xF & field_access_flags;
-      if (masked_info_access == masked_field_access) {
-        return true;
-      }
-    }
   }
   return false;
 }
@@ -140,4 +143,400 @@ void AndroidSDK::load_framework_classes() {
   }
 }
 
+namespace {
+
+constexpr char DATABASE_MAGIC[8] = {'R', 'D', 'X', 'F', 'A', 'P', 'I', '\0'};
+constexpr uint32_t DATABASE_VERSION = 1;
+constexpr uint32_t NO_CLASS = 0xFFFFFFFF;
+// Hash and displace gives up on a bucket after that many seeds.
+constexpr uint32_t MAX_SEED = 1 << 24;
+
+uint32_t hash_name(const char* name, size_t length, uint32_t seed) {
+  // FNV-1a, followed by the finalizer of MurmurHash3.
+  uint64_t h = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+  for (size_t i = 0; i < length; ++i) {
+    h ^= (unsigned char)name[i];
+    h *= 1099511628211ull;
+  }
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+uint32_t hash_name(const std::string& name, uint32_t seed) {
+  return hash_name(name.data(), name.size(), seed);
+}
+
+std::string proto_descriptor(const DexProto* proto) {
+  std::string descriptor = "(";
+  for (const auto* arg : *proto->get_args()) {
+    descriptor += arg->str();
+  }
+  descriptor += ")";
+  descriptor += proto->get_rtype()->str();
+  return descriptor;
+}
+
+struct ParsedMember {
+  std::string name;
+  // The proto of a method, or the type of a field.
+  std::string type;
+  uint32_t access_flags;
+
+  bool operator<(const ParsedMember& that) const {
+    return std::tie(name, type) < std::tie(that.name, that.type);
+  }
+};
+
+struct ParsedClass {
+  std::string name;
+  std::string super_name;
+  uint32_t access_flags;
+  std::vector<ParsedMember> methods;
+  std::vector<ParsedMember> fields;
+};
+
+// Splits a "Lcls;.name:type" member descriptor.
+ParsedMember parse_member(const std::string& cls,
+                          const std::string& member,
+                          uint32_t access_flags) {
+  always_assert_log(boost::starts_with(member, cls + "."),
+                    "Member %s is not in %s", member.c_str(), cls.c_str());
+  auto colon = member.find(':', cls.size() + 1);
+  always_assert_log(colon != std::string::npos, "Malformed member %s",
+                    member.c_str());
+  return ParsedMember{member.substr(cls.size() + 1, colon - cls.size() - 1),
+                      member.substr(colon + 1), access_flags};
+}
+
+std::vector<ParsedClass> parse_framework_api_file(const std::string& path) {
+  std::ifstream infile(path.c_str());
+  assert_log(infile, "Failed to open framework api file: %s\n", path.c_str());
+
+  std::vector<ParsedClass> classes;
+  std::string framework_cls_str;
+  std::string super_cls_str;
+  uint32_t num_methods;
+  uint32_t num_fields;
+  uint32_t access_flags;
+  while (infile >> framework_cls_str >> access_flags >> super_cls_str >>
+         num_methods >> num_fields) {
+    ParsedClass cls{framework_cls_str, super_cls_str, access_flags, {}, {}};
+    while (num_methods-- > 0) {
+      std::string tag;
+      std::string method_str;
+      uint32_t m_access_flags;
+      infile >> tag >> method_str >> m_access_flags;
+      always_assert(tag == "M");
+      cls.methods.push_back(
+          parse_member(framework_cls_str, method_str, m_access_flags));
+    }
+    while (num_fields-- > 0) {
+      std::string tag;
+      std::string field_str;
+      uint32_t f_access_flags;
+      infile >> tag >> field_str >> f_access_flags;
+      always_assert(tag == "F");
+      cls.fields.push_back(
+          parse_member(framework_cls_str, field_str, f_access_flags));
+    }
+    std::sort(cls.methods.begin(), cls.methods.end());
+    std::sort(cls.fields.begin(), cls.fields.end());
+    classes.push_back(std::move(cls));
+  }
+  std::sort(classes.begin(), classes.end(),
+            [](const ParsedClass& a, const ParsedClass& b) {
+              return a.name < b.name;
+            });
+  for (size_t i = 1; i < classes.size(); ++i) {
+    always_assert_log(classes[i - 1].name != classes[i].name,
+                      "Duplicated class name!");
+  }
+  return classes;
+}
+
+template <typename T>
+void write_array(std::ofstream& out, const std::vector<T>& array) {
+  out.write(reinterpret_cast<const char*>(array.data()),
+            array.size() * sizeof(T));
+}
+
+} // namespace
+
+struct FrameworkApiDatabase::Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_classes;
+  uint32_t num_members;
+  uint32_t num_buckets;
+  uint32_t num_slots;
+  uint32_t strings_size;
+};
+
+struct FrameworkApiDatabase::ClassEntry {
+  uint32_t name;
+  uint32_t super_name;
+  uint32_t access_flags;
+  // The methods, followed by the fields, in the member table.
+  uint32_t first_member;
+  uint32_t num_methods;
+  uint32_t num_fields;
+};
+
+struct FrameworkApiDatabase::MemberEntry {
+  uint32_t name;
+  uint32_t type;
+  uint32_t access_flags;
+};
+
+bool FrameworkApiDatabase::is_database(const std::string& path) {
+  std::ifstream infile(path.c_str(), std::ios::binary);
+  char magic[sizeof(DATABASE_MAGIC)];
+  return infile.read(magic, sizeof(magic)) &&
+         memcmp(magic, DATABASE_MAGIC, sizeof(magic)) == 0;
+}
+
+void FrameworkApiDatabase::write(const std::string& api_file,
+                                 const std::string& db_file) {
+  auto parsed_classes = parse_framework_api_file(api_file);
+
+  std::vector<char> strings;
+  std::unordered_map<std::string, uint32_t> string_offsets;
+  auto add_string = [&](const std::string& str) {
+    auto it = string_offsets.find(str);
+    if (it != string_offsets.end()) {
+      return it->second;
+    }
+    auto offset = (uint32_t)strings.size();
+    strings.insert(strings.end(), str.begin(), str.end());
+    strings.push_back('\0');
+    string_offsets.emplace(str, offset);
+    return offset;
+  };
+
+  std::vector<ClassEntry> classes;
+  std::vector<MemberEntry> members;
+  for (const auto& cls : parsed_classes) {
+    classes.push_back(ClassEntry{add_string(cls.name),
+                                 add_string(cls.super_name), cls.access_flags,
+                                 (uint32_t)members.size(),
+                                 (uint32_t)cls.methods.size(),
+                                 (uint32_t)cls.fields.size()});
+    for (const auto* group : {&cls.methods, &cls.fields}) {
+      for (const auto& member : *group) {
+        members.push_back(MemberEntry{add_string(member.name),
+                                      add_string(member.type),
+                                      member.access_flags});
+      }
+    }
+  }
+
+  // Hash and displace: each bucket of names gets the first seed that sends
+  // all its names to free slots, starting with the biggest buckets.
+  auto num_classes = (uint32_t)classes.size();
+  uint32_t num_buckets = num_classes / 4 + 1;
+  uint32_t num_slots = num_classes + num_classes / 4 + 1;
+  std::vector<std::vector<uint32_t>> buckets(num_buckets);
+  for (uint32_t i = 0; i < num_classes; ++i) {
+    const auto& name = parsed_classes[i].name;
+    buckets[hash_name(name, 0) % num_buckets].push_back(i);
+  }
+  std::vector<uint32_t> bucket_order(num_buckets);
+  std::iota(bucket_order.begin(), bucket_order.end(), 0);
+  std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                   [&](uint32_t a, uint32_t b) {
+                     return buckets[a].size() > buckets[b].size();
+                   });
+  std::vector<uint32_t> seeds(num_buckets, 0);
+  std::vector<uint32_t> slots(num_slots, NO_CLASS);
+  std::vector<uint32_t> bucket_slots;
+  for (auto b : bucket_order) {
+    const auto& bucket = buckets[b];
+    if (bucket.empty()) {
+      break;
+    }
+    for (uint32_t seed = 1;; ++seed) {
+      always_assert_log(seed < MAX_SEED, "Failed to hash framework classes");
+      bucket_slots.clear();
+      for (auto i : bucket) {
+        auto slot = hash_name(parsed_classes[i].name, seed) % num_slots;
+        if (slots[slot] != NO_CLASS ||
+            std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                bucket_slots.end()) {
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (bucket_slots.size() == bucket.size()) {
+        for (size_t j = 0; j < bucket.size(); ++j) {
+          slots[bucket_slots[j]] = bucket[j];
+        }
+        seeds[b] = seed;
+        break;
+      }
+    }
+  }
+
+  // Keep the members and what follows them aligned.
+  while (strings.size() % sizeof(uint32_t) != 0) {
+    strings.push_back('\0');
+  }
+  Header header;
+  memcpy(header.magic, DATABASE_MAGIC, sizeof(header.magic));
+  header.version = DATABASE_VERSION;
+  header.num_classes = num_classes;
+  header.num_members = (uint32_t)members.size();
+  header.num_buckets = num_buckets;
+  header.num_slots = num_slots;
+  header.strings_size = (uint32_t)strings.size();
+
+  std::ofstream out(db_file.c_str(), std::ios::binary | std::ios::trunc);
+  assert_log(out, "Failed to open %s\n", db_file.c_str());
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  write_array(out, classes);
+  write_array(out, members);
+  write_array(out, seeds);
+  write_array(out, slots);
+  write_array(out, strings);
+  always_assert_log(out.good(), "Failed to write %s", db_file.c_str());
+}
+
+FrameworkApiDatabase::FrameworkApiDatabase(const std::string& path)
+    : m_file(std::make_unique<RedexMappedFile>(RedexMappedFile::open(path))) {
+  const char* data = m_file->const_data();
+  size_t size = m_file->size();
+  always_assert_log(size >= sizeof(Header), "Truncated framework API %s",
+                    path.c_str());
+  m_header = reinterpret_cast<const Header*>(data);
+  always_assert_log(
+      memcmp(m_header->magic, DATABASE_MAGIC, sizeof(DATABASE_MAGIC)) == 0 &&
+          m_header->version == DATABASE_VERSION,
+      "Unsupported framework API database %s", path.c_str());
+  size_t offset = sizeof(Header);
+  m_classes = reinterpret_cast<const ClassEntry*>(data + offset);
+  offset += m_header->num_classes * sizeof(ClassEntry);
+  m_members = reinterpret_cast<const MemberEntry*>(data + offset);
+  offset += m_header->num_members * sizeof(MemberEntry);
+  m_seeds = reinterpret_cast<const uint32_t*>(data + offset);
+  offset += m_header->num_buckets * sizeof(uint32_t);
+  m_slots = reinterpret_cast<const uint32_t*>(data + offset);
+  offset += m_header->num_slots * sizeof(uint32_t);
+  m_strings = data + offset;
+  offset += m_header->strings_size;
+  always_assert_log(offset == size && m_header->num_buckets > 0 &&
+                        m_header->num_slots > 0,
+                    "Corrupt framework API database %s", path.c_str());
+}
+
+FrameworkApiDatabase::~FrameworkApiDatabase() {}
+
+const FrameworkApiDatabase::ClassEntry* FrameworkApiDatabase::find_class(
+    const std::string& name) const {
+  auto seed = m_seeds[hash_name(name, 0) % m_header->num_buckets];
+  if (seed == 0) {
+    return nullptr;
+  }
+  auto index = m_slots[hash_name(name, seed) % m_header->num_slots];
+  if (index == NO_CLASS ||
+      strcmp(get_string(m_classes[index].name), name.c_str()) != 0) {
+    return nullptr;
+  }
+  return &m_classes[index];
+}
+
+bool FrameworkApiDatabase::has_type(const DexType* type) const {
+  return find_class(type->str()) != nullptr;
+}
+
+bool FrameworkApiDatabase::has_method(
+    const DexType* cls,
+    const std::string& simple_deobfuscated_name,
+    const DexProto* meth_proto,
+    DexAccessFlags meth_access_flags,
+    bool relax_access_flags_matching) const {
+  const auto* entry = find_class(cls->str());
+  if (entry == nullptr) {
+    return false;
+  }
+  auto begin = m_members + entry->first_member;
+  auto end = begin + entry->num_methods;
+  auto descriptor = proto_descriptor(meth_proto);
+  // Methods are sorted by name and proto.
+  auto it = std::lower_bound(
+      begin, end, std::tie(simple_deobfuscated_name, descriptor),
+      [this](const MemberEntry& member, const auto& key) {
+        int cmp = strcmp(get_string(member.name), std::get<0>(key).c_str());
+        return cmp < 0 ||
+               (cmp == 0 &&
+                strcmp(get_string(member.type), std::get<1>(key).c_str()) < 0);
+      });
+  return it != end &&
+         simple_deobfuscated_name == get_string(it->name) &&
+         descriptor == get_string(it->type) &&
+         access_flags_match(meth_access_flags,
+                            DexAccessFlags(it->access_flags),
+                            relax_access_flags_matching);
+}
+
+bool FrameworkApiDatabase::has_field(
+    const DexType* cls,
+    const std::string& simple_deobfuscated_name,
+    DexAccessFlags field_access_flags,
+    bool relax_access_flags_matching) const {
+  const auto* entry = find_class(cls->str());
+  if (entry == nullptr) {
+    return false;
+  }
+  auto begin = m_members + entry->first_member + entry->num_methods;
+  auto end = begin + entry->num_fields;
+  // Fields are sorted by name.
+  auto it = std::lower_bound(
+      begin, end, simple_deobfuscated_name,
+      [this](const MemberEntry& member, const std::string& name) {
+        return strcmp(get_string(member.name), name.c_str()) < 0;
+      });
+  for (; it != end && simple_deobfuscated_name == get_string(it->name); ++it) {
+    if (access_flags_match(field_access_flags,
+                           DexAccessFlags(it->access_flags),
+                           relax_access_flags_matching)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+std::unordered_map<const DexType*, FrameworkAPI>
+FrameworkApiDatabase::get_framework_classes() const {
+  std::unordered_map<const DexType*, FrameworkAPI> framework_classes;
+  for (uint32_t i = 0; i < m_header->num_classes; ++i) {
+    const auto& entry = m_classes[i];
+    std::string cls_name = get_string(entry.name);
+    FrameworkAPI framework_api;
+    framework_api.cls = DexType::make_type(cls_name.c_str());
+    framework_api.super_cls = DexType::make_type(get_string(entry.super_name));
+    framework_api.access_flags = DexAccessFlags(entry.access_flags);
+    auto make_member_str = [&](const MemberEntry& member) {
+      return cls_name + "." + get_string(member.name) + ":" +
+             get_string(member.type);
+    };
+    const auto* members = m_members + entry.first_member;
+    for (uint32_t j = 0; j < entry.num_methods; ++j) {
+      framework_api.mrefs_info.emplace_back(
+          DexMethod::make_method(make_member_str(members[j])),
+          DexAccessFlags(members[j].access_flags));
+    }
+    members += entry.num_methods;
+    for (uint32_t j = 0; j < entry.num_fields; ++j) {
+      framework_api.frefs_info.emplace_back(
+          DexField::make_field(make_member_str(members[j])),
+          DexAccessFlags(members[j].access_flags));
+    }
+    framework_classes.emplace(framework_api.cls, std::move(framework_api));
+  }
+  return framework_classes;
+}
+
 } // namespace api
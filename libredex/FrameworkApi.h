@@ -7,8 +7,15 @@
 
 #pragma once
 
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
 #include "DexClass.h"
 
+struct RedexMappedFile;
+
 namespace api {
 
 struct MRefInfo {
@@ -44,25 +51,96 @@ struct FrameworkAPI {
                  bool relax_access_flags_matching = false) const;
 };
 
+/*
+ * A compiled framework API file, which is mapped into memory instead of
+ * parsed, and only creates the refs of the whole API on demand. Compile one
+ * with `redex-tool compile-framework-api`.
+ *
+ * The file starts with a header, followed by the classes sorted by name, the
+ * methods and fields of each class sorted by name, a minimal perfect hash of
+ * the class names (hash and displace) and a pool of the NUL-terminated
+ * strings that all the entries point to. Everything is in the byte order of
+ * the host that compiled it.
+ */
+class FrameworkApiDatabase {
+ public:
+  struct Header;
+  struct ClassEntry;
+  struct MemberEntry;
+
+  explicit FrameworkApiDatabase(const std::string& path);
+  ~FrameworkApiDatabase();
+
+  // Whether `path` is a database rather than a framework API text file.
+  static bool is_database(const std::string& path);
+
+  // Compiles the framework API text file `api_file` into `db_file`.
+  static void write(const std::string& api_file, const std::string& db_file);
+
+  bool has_type(const DexType* type) const;
+
+  bool has_method(const DexType* cls,
+                  const std::string& simple_deobfuscated_name,
+                  const DexProto* meth_proto,
+                  DexAccessFlags meth_access_flags,
+                  bool relax_access_flags_matching = false) const;
+
+  bool has_field(const DexType* cls,
+                 const std::string& simple_deobfuscated_name,
+                 DexAccessFlags field_access_flags,
+                 bool relax_access_flags_matching = false) const;
+
+  // Creates the refs of all the classes and members in the database.
+  std::unordered_map<const DexType*, FrameworkAPI> get_framework_classes()
+      const;
+
+ private:
+  const ClassEntry* find_class(const std::string& name) const;
+  const char* get_string(uint32_t offset) const { return m_strings + offset; }
+
+  std::unique_ptr<RedexMappedFile> m_file;
+  const Header* m_header;
+  const ClassEntry* m_classes;
+  const MemberEntry* m_members;
+  const uint32_t* m_seeds;
+  const uint32_t* m_slots;
+  const char* m_strings;
+};
+
 class AndroidSDK {
  public:
   explicit AndroidSDK(boost::optional<std::string> sdk_api_file) {
     if (sdk_api_file) {
       m_sdk_api_file = *sdk_api_file;
-      load_framework_classes();
+      if (FrameworkApiDatabase::is_database(m_sdk_api_file)) {
+        m_database = std::make_unique<FrameworkApiDatabase>(m_sdk_api_file);
+      } else {
+        load_framework_classes();
+      }
     } else {
       // For missing api file, we initialize to an empty SDK.
       m_sdk_api_file = "";
     }
   }
 
+  // For a database, this creates the refs of the whole API on first use.
   const std::unordered_map<const DexType*, FrameworkAPI>&
   get_framework_classes() const {
+    if (m_database) {
+      std::call_once(m_framework_classes_loaded, [this] {
+        m_framework_classes = m_database->get_framework_classes();
+      });
+    }
     return m_framework_classes;
   }
 
   bool has_method(const DexMethod* meth) const {
     auto type = meth->get_class();
+    if (m_database) {
+      return m_database->has_method(type, meth->get_simple_deobfuscated_name(),
+                                    meth->get_proto(), meth->get_access(),
+                                    /* relax_access_flags_matching */ true);
+    }
     const auto& it = m_framework_classes.find(type);
     if (it == m_framework_classes.end()) {
       return false;
@@ -76,6 +154,11 @@ class AndroidSDK {
 
   bool has_field(const DexField* field) const {
     auto type = field->get_class();
+    if (m_database) {
+      return m_database->has_field(type, field->get_simple_deobfuscated_name(),
+                                   field->get_access(),
+                                   /* relax_access_flags_matching */ true);
+    }
     const auto& it = m_framework_classes.find(type);
     if (it == m_framework_classes.end()) {
       return false;
@@ -88,6 +171,9 @@ class AndroidSDK {
   }
 
   bool has_type(const DexType* type) const {
+    if (m_database) {
+      return m_database->has_type(type);
+    }
     return m_framework_classes.count(type);
   }
 
@@ -95,7 +181,9 @@ class AndroidSDK {
   void load_framework_classes();
 
   std::string m_sdk_api_file;
-  std::unordered_map<const DexType*, FrameworkAPI> m_framework_classes;
+  std::unique_ptr<FrameworkApiDatabase> m_database;
+  mutable std::once_flag m_framework_classes_loaded;
+  mutable std::unordered_map<const DexType*, FrameworkAPI> m_framework_classes;
 };
 
 } // namespace api
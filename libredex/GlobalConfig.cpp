@@ -20,6 +20,9 @@ void InlinerConfig::bind_config() {
   bind("inline_small_non_deletables", inline_small_non_deletables,
        inline_small_non_deletables);
   bind("delete_any_candidate", delete_any_candidate, delete_any_candidate);
+  bind("profile_guided_budget", profile_guided_budget, profile_guided_budget,
+       "Number of code units that may be spent on inlining the hottest calls "
+       "according to the method profiles, regardless of the cost model.");
   bind("run_const_prop", shrinker.run_const_prop, shrinker.run_const_prop);
   bind("run_cse", shrinker.run_cse, shrinker.run_cse);
   bind("run_dedup_blocks", shrinker.run_dedup_blocks,
@@ -27,6 +30,14 @@ void InlinerConfig::bind_config() {
   bind("run_copy_prop", shrinker.run_copy_prop, shrinker.run_copy_prop);
   bind("run_reg_alloc", shrinker.run_reg_alloc, shrinker.run_reg_alloc);
   bind("run_local_dce", shrinker.run_local_dce, shrinker.run_local_dce);
+  bind("const_prop_max_steps", shrinker.const_prop_max_steps,
+       shrinker.const_prop_max_steps,
+       "Number of block visits after which constant propagation gives up on "
+       "a method; 0 means no limit.");
+  bind("const_prop_max_ms", shrinker.const_prop_max_ms,
+       shrinker.const_prop_max_ms,
+       "Milliseconds after which constant propagation gives up on a method; 0 "
+       "means no limit.");
   bind("no_inline_annos", {}, m_no_inline_annos);
   bind("force_inline_annos", {}, m_force_inline_annos);
   bind("blocklist", {}, m_blocklist);
@@ -111,6 +122,7 @@ void GlobalConfig::bind_config() {
   bind("lower_with_cfg", {}, bool_param);
   bind("method_sorting_allowlisted_substrings", {}, string_vector_param);
   bind("no_optimizations_annotations", {}, string_vector_param);
+  bind("num_threads", 0u, uint32_param);
   // TODO: Remove unused profiled_methods_file option and all build system
   // references
   bind("profiled_methods_file", "", string_param);
@@ -124,6 +136,7 @@ void GlobalConfig::bind_config() {
   bind("write_cfg_each_pass", false, bool_param);
   bind("dump_cfg_classes", "", string_param);
   bind("slow_invariants_debug", false, bool_param);
+  bind("fast_teardown", false, bool_param);
 
   for (const auto& entry : m_registry) {
     m_global_configs.emplace(entry.name,
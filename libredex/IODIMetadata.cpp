@@ -8,12 +8,15 @@
 #include "IODIMetadata.h"
 
 #include <fstream>
+#include <numeric>
+#include <string_view>
 
 #include "DexOutput.h"
 #include "DexUtil.h"
 #include "Show.h"
 #include "StlUtil.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 // Returns com.foo.Bar. for the DexClass Lcom/foo/Bar;. Note the trailing
@@ -53,58 +56,82 @@ void IODIMetadata::mark_methods(DexStoresVector& scope) {
   // offsets in stack traces, then we cannot leverage proguard mappings anymore,
   // so we must disable IODI for any methods whose stack trace may be ambiguous.
   //
-  // We do this linearly for now because otherwise we need locks
-
-  std::unordered_map<std::string, DexMethod*> name_method_map;
-
-  std::unordered_map<std::string, const DexMethod*> name_map;
-  auto emplace_entry = [&](const std::string& str, DexMethod* m) {
-    {
-      const DexMethod* canonical;
-      auto it = name_map.find(str);
-      if (it == name_map.end()) {
-        canonical = m;
-        name_map.emplace(str, m);
-      } else {
-        canonical = m_canonical.at(it->second);
-      }
-      m_canonical[m] = canonical;
-      m_name_clusters[canonical].insert(m);
-    }
-
-    auto iter = name_method_map.find(str);
-    if (iter != name_method_map.end()) {
-      auto name_iter = m_method_to_name.find(iter->second);
-      if (name_iter != m_method_to_name.end()) {
-        m_method_to_name.erase(name_iter);
+  // The names are built in parallel, per class. The methods are then sharded
+  // by the hash of their name, so that each shard finds its clusters without
+  // locks. The canonical method of a cluster is its first method in scope
+  // order, so shards visit their methods in that order.
+
+  std::vector<DexClass*> classes;
+  std::vector<size_t> class_offsets;
+  std::vector<DexMethod*> methods;
+  for (auto& store : scope) {
+    for (auto& dex : store.get_dexen()) {
+      for (auto* cls : dex) {
+        classes.push_back(cls);
+        class_offsets.push_back(methods.size());
+        methods.insert(methods.end(), cls->get_dmethods().begin(),
+                       cls->get_dmethods().end());
+        methods.insert(methods.end(), cls->get_vmethods().begin(),
+                       cls->get_vmethods().end());
       }
-      iter->second = nullptr;
-    } else {
-      name_method_map.emplace(str, m);
-      m_method_to_name.emplace(m, str);
     }
-  };
-  for (auto& store : scope) {
-    for (auto& classes : store.get_dexen()) {
-      for (auto& cls : classes) {
-        auto pretty_prefix = pretty_prefix_for_cls(cls);
-        // First we need to mark all entries...
-        for (DexMethod* m : cls->get_dmethods()) {
-          emplace_entry(pretty_prefix + m->str(), m);
+  }
+  class_offsets.push_back(methods.size());
+
+  std::vector<std::string> names(methods.size());
+  std::vector<size_t> hashes(methods.size());
+  std::vector<size_t> class_indices(classes.size());
+  std::iota(class_indices.begin(), class_indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t c) {
+        auto pretty_prefix = pretty_prefix_for_cls(classes[c]);
+        for (size_t i = class_offsets[c]; i < class_offsets[c + 1]; ++i) {
+          names[i] = pretty_prefix + methods[i]->str();
+          hashes[i] = std::hash<std::string>()(names[i]);
         }
-        for (DexMethod* m : cls->get_vmethods()) {
-          emplace_entry(pretty_prefix + m->str(), m);
+      },
+      class_indices);
+
+  const size_t num_shards = redex_parallel::default_num_threads();
+  std::vector<std::vector<uint32_t>> shards(num_shards);
+  for (uint32_t i = 0; i < methods.size(); ++i) {
+    shards[hashes[i] % num_shards].push_back(i);
+  }
+  // For each method, the index of the canonical method of its cluster.
+  std::vector<uint32_t> canonical(methods.size());
+  std::vector<size_t> shard_indices(num_shards);
+  std::iota(shard_indices.begin(), shard_indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t s) {
+        std::unordered_map<std::string_view, uint32_t> first_of_name;
+        first_of_name.reserve(shards[s].size());
+        for (auto i : shards[s]) {
+          canonical[i] = first_of_name.emplace(names[i], i).first->second;
         }
-      }
-    }
+      },
+      shard_indices);
+
+  m_canonical.reserve(methods.size());
+  for (uint32_t i = 0; i < methods.size(); ++i) {
+    const DexMethod* canonical_method = methods[canonical[i]];
+    m_canonical[methods[i]] = canonical_method;
+    m_name_clusters[canonical_method].insert(methods[i]);
+  }
+  // The names are kept for set_iodi_layer.
+  m_iodi_names.reserve(methods.size());
+  for (uint32_t i = 0; i < methods.size(); ++i) {
+    m_iodi_names.emplace(methods[i], std::move(names[i]));
   }
 
   m_marked = true;
 }
 
 void IODIMetadata::set_iodi_layer(const DexMethod* method, size_t layer) {
-  m_iodi_method_layers.emplace(method,
-                               std::make_pair(get_iodi_name(method), layer));
+  auto it = m_iodi_names.find(method);
+  if (it == m_iodi_names.end()) {
+    it = m_iodi_names.emplace(method, get_iodi_name(method)).first;
+  }
+  m_iodi_method_layers.emplace(method, std::make_pair(&it->second, layer));
 }
 
 size_t IODIMetadata::get_iodi_layer(const DexMethod* method) const {
@@ -178,7 +205,7 @@ void IODIMetadata::write(
     always_assert_log(count != 0, "Too many entries found, overflowed");
 
     auto* method = p.first;
-    const auto& name = p.second.first;
+    const auto& name = *p.second.first;
     auto layer = p.second.second;
     redex_assert(layer < DexOutput::kIODILayerBound);
 
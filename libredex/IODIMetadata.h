@@ -92,11 +92,12 @@ class IODIMetadata {
       m_name_clusters;
   std::unordered_map<const DexMethod*, const DexMethod*> m_canonical;
 
-  std::unordered_map<const DexMethod*, std::pair<std::string, size_t>>
+  // The names point into m_iodi_names.
+  std::unordered_map<const DexMethod*, std::pair<const std::string*, size_t>>
       m_iodi_method_layers;
 
-  // These exists for can_safely_use_iodi
-  std::unordered_map<const DexMethod*, std::string> m_method_to_name;
+  // The stack trace names of the methods, computed once by mark_methods.
+  std::unordered_map<const DexMethod*, std::string> m_iodi_names;
   std::unordered_set<const DexMethod*> m_huge_methods;
 
   bool m_marked{false};
@@ -914,8 +914,7 @@ std::unique_ptr<IRCode> ircode_from_s_expr(const s_expr& e) {
 }
 
 std::unique_ptr<IRCode> ircode_from_string(const std::string& s) {
-  std::istringstream input(s);
-  s_expr_istream s_expr_input(input);
+  s_expr_buffer_istream s_expr_input(s.data(), s.size());
   s_expr expr;
   while (s_expr_input.good()) {
     s_expr_input >> expr;
@@ -963,8 +962,7 @@ DexMethod* method_from_s_expr(const s_expr& e) {
 }
 
 DexMethod* method_from_string(const std::string& s) {
-  std::istringstream input(s);
-  s_expr_istream s_expr_input(input);
+  s_expr_buffer_istream s_expr_input(s.data(), s.size());
   s_expr expr;
   while (s_expr_input.good()) {
     s_expr_input >> expr;
@@ -264,7 +264,8 @@ static void associate_debug_entries(IRList* ir,
     }
     ir->insert_before(ir->iterator_to(*insert_point_it->second), *mentry);
   }
-  dbg.get_entries().clear();
+  // Release the storage too, the entries are only rebuilt on sync.
+  std::vector<DexDebugEntry>().swap(dbg.get_entries());
 }
 
 // Insert MFLOW_TRYs and MFLOW_CATCHes
@@ -567,8 +568,142 @@ IRList* deep_copy_ir_list(IRList* old_ir_list) {
   return ir_list;
 }
 
+// Variable-length encoding of the frozen entries, 7 bits at a time.
+void write_varint(uint64_t v, std::vector<uint8_t>* out) {
+  while (v >= 0x80) {
+    out->push_back(static_cast<uint8_t>(v | 0x80));
+    v >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(v));
+}
+
+void write_signed_varint(int64_t v, std::vector<uint8_t>* out) {
+  // Zigzag, so that small negative values stay small.
+  write_varint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63),
+               out);
+}
+
+void write_pointer(const void* ptr, std::vector<uint8_t>* out) {
+  write_varint(reinterpret_cast<uintptr_t>(ptr), out);
+}
+
+uint64_t read_varint(const uint8_t** ptr) {
+  uint64_t v = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    byte = *(*ptr)++;
+    v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return v;
+}
+
+int64_t read_signed_varint(const uint8_t** ptr) {
+  auto v = read_varint(ptr);
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+template <typename T>
+T* read_pointer(const uint8_t** ptr) {
+  return reinterpret_cast<T*>(static_cast<uintptr_t>(read_varint(ptr)));
+}
+
+void write_insn(const IRInstruction* insn, std::vector<uint8_t>* out) {
+  write_varint(insn->opcode(), out);
+  write_varint(insn->srcs_size(), out);
+  for (auto src : insn->srcs()) {
+    write_varint(src, out);
+  }
+  if (insn->has_dest()) {
+    write_varint(insn->dest(), out);
+  }
+  switch (opcode::ref(insn->opcode())) {
+  case opcode::Ref::None:
+    break;
+  case opcode::Ref::Literal:
+    write_signed_varint(insn->get_literal(), out);
+    break;
+  case opcode::Ref::String:
+    write_pointer(insn->get_string(), out);
+    break;
+  case opcode::Ref::Type:
+    write_pointer(insn->get_type(), out);
+    break;
+  case opcode::Ref::Field:
+    write_pointer(insn->get_field(), out);
+    break;
+  case opcode::Ref::Method:
+    write_pointer(insn->get_method(), out);
+    break;
+  case opcode::Ref::CallSite:
+    write_pointer(insn->get_callsite(), out);
+    break;
+  case opcode::Ref::MethodHandle:
+    write_pointer(insn->get_methodhandle(), out);
+    break;
+  case opcode::Ref::Data:
+    write_pointer(insn->get_data(), out);
+    break;
+  }
+}
+
+IRInstruction* read_insn(const uint8_t** ptr) {
+  auto insn = new IRInstruction(static_cast<IROpcode>(read_varint(ptr)));
+  auto srcs_size = read_varint(ptr);
+  insn->set_srcs_size(srcs_size);
+  for (size_t i = 0; i < srcs_size; ++i) {
+    insn->set_src(i, read_varint(ptr));
+  }
+  if (insn->has_dest()) {
+    insn->set_dest(read_varint(ptr));
+  }
+  switch (opcode::ref(insn->opcode())) {
+  case opcode::Ref::None:
+    break;
+  case opcode::Ref::Literal:
+    insn->set_literal(read_signed_varint(ptr));
+    break;
+  case opcode::Ref::String:
+    insn->set_string(read_pointer<DexString>(ptr));
+    break;
+  case opcode::Ref::Type:
+    insn->set_type(read_pointer<DexType>(ptr));
+    break;
+  case opcode::Ref::Field:
+    insn->set_field(read_pointer<DexFieldRef>(ptr));
+    break;
+  case opcode::Ref::Method:
+    insn->set_method(read_pointer<DexMethodRef>(ptr));
+    break;
+  case opcode::Ref::CallSite:
+    insn->set_callsite(read_pointer<DexCallSite>(ptr));
+    break;
+  case opcode::Ref::MethodHandle:
+    insn->set_methodhandle(read_pointer<DexMethodHandle>(ptr));
+    break;
+  case opcode::Ref::Data:
+    insn->set_data(read_pointer<DexOpcodeData>(ptr));
+    break;
+  }
+  return insn;
+}
+
 } // namespace
 
+/*
+ * One byte of MethodItemType per entry, followed by the fields of the entry.
+ * Entries refer to each other by their index. The debug instructions,
+ * positions and source blocks are rare enough to be kept as they are.
+ */
+struct IRCode::FrozenIRList {
+  std::vector<uint8_t> bytes;
+  uint32_t num_entries{0};
+  std::vector<std::unique_ptr<DexDebugInstruction>> dbgops;
+  std::vector<std::unique_ptr<DexPosition>> positions;
+  std::vector<std::unique_ptr<SourceBlock>> src_blocks;
+};
+
 IRCode::IRCode() : m_ir_list(new IRList()) {}
 
 IRCode::~IRCode() {
@@ -590,6 +725,7 @@ IRCode::IRCode(DexMethod* method, size_t temp_regs) : m_ir_list(new IRList()) {
 }
 
 IRCode::IRCode(const IRCode& code) {
+  always_assert(!code.is_frozen());
   if (code.editable_cfg_built()) {
     m_ir_list = new IRList(); // Empty.
     m_cfg = std::make_unique<cfg::ControlFlowGraph>();
@@ -604,6 +740,127 @@ IRCode::IRCode(const IRCode& code) {
   }
 }
 
+bool IRCode::freeze() {
+  always_assert(!is_frozen());
+  if (m_cfg) {
+    return false;
+  }
+  std::unordered_map<const MethodItemEntry*, uint32_t> indices;
+  indices.reserve(m_ir_list->size());
+  for (const auto& mie : *m_ir_list) {
+    if (mie.type == MFLOW_DEX_OPCODE) {
+      return false;
+    }
+    indices.emplace(&mie, indices.size());
+  }
+
+  auto frozen = std::make_unique<FrozenIRList>();
+  frozen->num_entries = indices.size();
+  auto* out = &frozen->bytes;
+  for (auto& mie : *m_ir_list) {
+    out->push_back(static_cast<uint8_t>(mie.type));
+    switch (mie.type) {
+    case MFLOW_TRY:
+      out->push_back(static_cast<uint8_t>(mie.tentry->type));
+      write_varint(indices.at(mie.tentry->catch_start), out);
+      break;
+    case MFLOW_CATCH:
+      write_pointer(mie.centry->catch_type, out);
+      write_varint(mie.centry->next ? indices.at(mie.centry->next) + 1 : 0,
+                   out);
+      break;
+    case MFLOW_OPCODE:
+      write_insn(mie.insn, out);
+      delete mie.insn;
+      break;
+    case MFLOW_TARGET:
+      write_varint(indices.at(mie.target->src), out);
+      out->push_back(static_cast<uint8_t>(mie.target->type));
+      if (mie.target->type == BRANCH_MULTI) {
+        write_signed_varint(mie.target->case_key, out);
+      }
+      break;
+    case MFLOW_DEBUG:
+      frozen->dbgops.push_back(std::move(mie.dbgop));
+      break;
+    case MFLOW_POSITION:
+      frozen->positions.push_back(std::move(mie.pos));
+      break;
+    case MFLOW_SOURCE_BLOCK:
+      frozen->src_blocks.push_back(std::move(mie.src_block));
+      break;
+    case MFLOW_FALLTHROUGH:
+      break;
+    case MFLOW_DEX_OPCODE:
+      not_reached();
+    }
+  }
+  out->shrink_to_fit();
+  m_ir_list->clear_and_dispose();
+  m_frozen = std::move(frozen);
+  return true;
+}
+
+void IRCode::thaw() {
+  always_assert(is_frozen());
+  auto frozen = std::move(m_frozen);
+  // Entries may refer to later ones, so they are all allocated first.
+  std::vector<MethodItemEntry*> entries(frozen->num_entries);
+  for (auto& mie : entries) {
+    mie = new MethodItemEntry();
+  }
+  auto dbgop_it = frozen->dbgops.begin();
+  auto pos_it = frozen->positions.begin();
+  auto src_block_it = frozen->src_blocks.begin();
+  const uint8_t* ptr = frozen->bytes.data();
+  for (auto* mie : entries) {
+    auto type = static_cast<MethodItemType>(*ptr++);
+    switch (type) {
+    case MFLOW_TRY: {
+      auto try_type = static_cast<TryEntryType>(*ptr++);
+      mie->tentry = new TryEntry(try_type, entries.at(read_varint(&ptr)));
+      break;
+    }
+    case MFLOW_CATCH: {
+      mie->centry = new CatchEntry(read_pointer<DexType>(&ptr));
+      auto next = read_varint(&ptr);
+      if (next != 0) {
+        mie->centry->next = entries.at(next - 1);
+      }
+      break;
+    }
+    case MFLOW_OPCODE:
+      mie->insn = read_insn(&ptr);
+      break;
+    case MFLOW_TARGET: {
+      auto* src = entries.at(read_varint(&ptr));
+      auto target_type = static_cast<BranchTargetType>(*ptr++);
+      mie->target = target_type == BRANCH_MULTI
+                        ? new BranchTarget(src, read_signed_varint(&ptr))
+                        : new BranchTarget(src);
+      break;
+    }
+    case MFLOW_DEBUG:
+      new (&mie->dbgop)
+          std::unique_ptr<DexDebugInstruction>(std::move(*dbgop_it++));
+      break;
+    case MFLOW_POSITION:
+      new (&mie->pos) std::unique_ptr<DexPosition>(std::move(*pos_it++));
+      break;
+    case MFLOW_SOURCE_BLOCK:
+      new (&mie->src_block)
+          std::unique_ptr<SourceBlock>(std::move(*src_block_it++));
+      break;
+    case MFLOW_FALLTHROUGH:
+      break;
+    case MFLOW_DEX_OPCODE:
+      not_reached();
+    }
+    mie->type = type;
+    m_ir_list->push_back(*mie);
+  }
+}
+
 void IRCode::cleanup_debug() { m_ir_list->cleanup_debug(); }
 
 void IRCode::build_cfg(bool editable) {
@@ -766,6 +1023,7 @@ void gather_debug_entries(
       entries->emplace_back(entry_to_addr.at(&mie), std::move(mie.pos));
     }
   }
+  entries->shrink_to_fit();
 }
 
 } // namespace
@@ -50,6 +50,10 @@ class IRCode {
   // exposing the param names should be enough
   std::unique_ptr<DexDebugItem> m_dbg;
 
+  // The compact encoding of the IRList entries while the code is frozen.
+  struct FrozenIRList;
+  std::unique_ptr<FrozenIRList> m_frozen;
+
   IRList::iterator make_if_block(const IRList::iterator& cur,
                                  IRInstruction* insn,
                                  IRList::iterator* if_block) {
@@ -94,6 +98,17 @@ class IRCode {
 
   ~IRCode();
 
+  /*
+   * Re-encodes the IRList entries into a compact buffer, freeing the entries
+   * and their instructions; the code must be thawed before any other use.
+   * Code with a CFG or with DexInstructions is not frozen, and false is
+   * returned. See DexMethod::freeze_code().
+   */
+  bool freeze();
+  // Rebuilds the IRList of frozen code. The instructions are new objects.
+  void thaw();
+  bool is_frozen() const { return m_frozen != nullptr; }
+
   bool structural_equals(const IRCode& other) const {
     return m_ir_list->structural_equals(*other.m_ir_list,
                                         std::equal_to<const IRInstruction&>());
@@ -13,81 +13,66 @@
 #include "DexMethodHandle.h"
 #include "DexUtil.h"
 #include "Show.h"
+#include "SlabAllocator.h"
 
+#include <algorithm>
 #include <boost/range/any_range.hpp>
 #include <cstring>
 #include <iterator>
+#include <limits>
 
 IRInstruction::IRInstruction(IROpcode op) : m_opcode(op) {
   auto count = opcode_impl::min_srcs_size(op);
-  if (count <= MAX_NUM_INLINE_SRCS) {
-    m_num_inline_srcs = count;
-  } else {
-    m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-    m_srcs = new std::vector<reg_t>(count);
+  m_num_srcs = count;
+  if (!has_inline_srcs()) {
+    m_srcs = new reg_t[count]();
   }
 }
 
 IRInstruction::IRInstruction(const IRInstruction& other)
     : m_opcode(other.m_opcode),
-      m_num_inline_srcs(other.m_num_inline_srcs),
+      m_num_srcs(other.m_num_srcs),
       m_dest(other.m_dest),
       m_literal(other.m_literal) {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    for (auto i = 0; i < m_num_inline_srcs; ++i) {
+  if (has_inline_srcs()) {
+    for (auto i = 0; i < m_num_srcs; ++i) {
       m_inline_srcs[i] = other.m_inline_srcs[i];
     }
   } else {
-    m_srcs = new std::vector<reg_t>(*other.m_srcs);
+    m_srcs = new reg_t[m_num_srcs];
+    std::memcpy(m_srcs, other.m_srcs, m_num_srcs * sizeof(reg_t));
   }
 }
 
 IRInstruction::~IRInstruction() {
-  if (m_num_inline_srcs > MAX_NUM_INLINE_SRCS) {
-    delete m_srcs;
+  if (!has_inline_srcs()) {
+    delete[] m_srcs;
   }
 }
 
+using IRInstructionAllocator =
+    SlabAllocator<sizeof(IRInstruction), alignof(IRInstruction)>;
+
+void* IRInstruction::operator new(size_t size) {
+  return IRInstructionAllocator::allocate(size);
+}
+
+void IRInstruction::operator delete(void* ptr, size_t size) {
+  IRInstructionAllocator::deallocate(ptr, size);
+}
+
 // Structural equality of opcodes except branches offsets are ignored
 // because they are unknown until we sync back to DexInstructions.
 bool IRInstruction::operator==(const IRInstruction& that) const {
   bool simple_fields_match =
-      m_opcode == that.m_opcode &&
-      m_num_inline_srcs == that.m_num_inline_srcs && m_dest == that.m_dest &&
+      m_opcode == that.m_opcode && m_num_srcs == that.m_num_srcs &&
+      m_dest == that.m_dest &&
       m_literal == that.m_literal; // just test one member of the union
   if (!simple_fields_match) {
     return false;
   }
   // Check the source registers union
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    for (auto i = 0; i < m_num_inline_srcs; ++i) {
-      if (m_inline_srcs[i] != that.m_inline_srcs[i]) {
-        return false;
-      }
-    }
-    return true;
-  } else {
-    return *m_srcs == *that.m_srcs;
-  }
-}
-
-reg_t IRInstruction::src(src_index_t i) const {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    always_assert(i < m_num_inline_srcs);
-    return m_inline_srcs[i];
-  }
-  return m_srcs->at(i);
-}
-
-IRInstruction::reg_range IRInstruction::srcs() const {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    const reg_t* begin = std::begin(m_inline_srcs);
-    const reg_t* end = begin + m_num_inline_srcs;
-    return reg_range(begin, end);
-  }
-  const reg_t* begin = m_srcs->data();
-  const reg_t* end = begin + m_srcs->size();
-  return reg_range(begin, end);
+  return std::equal(src_data(), src_data() + m_num_srcs, that.src_data());
 }
 
 std::vector<reg_t> IRInstruction::srcs_vec() const {
@@ -100,54 +85,47 @@ std::vector<reg_t> IRInstruction::srcs_vec() const {
 }
 
 IRInstruction* IRInstruction::set_src(src_index_t i, reg_t reg) {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    always_assert(i < m_num_inline_srcs);
-    m_inline_srcs[i] = reg;
-  } else {
-    m_srcs->at(i) = reg;
-  }
+  always_assert(i < m_num_srcs);
+  src_data()[i] = reg;
   return this;
 }
 
-size_t IRInstruction::srcs_size() const {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    return m_num_inline_srcs;
-  }
-  return m_srcs->size();
-}
-
 IRInstruction* IRInstruction::set_srcs_size(size_t count) {
-  if (m_num_inline_srcs <= MAX_NUM_INLINE_SRCS) {
-    if (count <= MAX_NUM_INLINE_SRCS) {
-      // staying in the inline state
-      m_num_inline_srcs = count;
-    } else {
-      // inline regs -> vector
-      auto srcs = new std::vector<reg_t>();
-      srcs->reserve(count);
-      for (auto i = 0; i < m_num_inline_srcs; ++i) {
-        srcs->push_back(m_inline_srcs[i]);
-      }
-      srcs->resize(count);
-      m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-      m_srcs = srcs;
+  if (count == m_num_srcs) {
+    return this;
+  }
+  always_assert(count <= std::numeric_limits<decltype(m_num_srcs)>::max());
+  if (has_inline_srcs() && count <= MAX_NUM_INLINE_SRCS) {
+    // staying in the inline state
+    if (count > m_num_srcs) {
+      std::fill(m_inline_srcs + m_num_srcs, m_inline_srcs + count, 0);
     }
+    m_num_srcs = count;
+    return this;
+  }
+  // Any other transition goes through a fresh copy; newly added registers
+  // are zero-initialized.
+  reg_t buf[MAX_NUM_INLINE_SRCS];
+  reg_t* dst = count <= MAX_NUM_INLINE_SRCS ? buf : new reg_t[count]();
+  std::memcpy(dst, src_data(),
+              std::min<size_t>(count, m_num_srcs) * sizeof(reg_t));
+  if (!has_inline_srcs()) {
+    delete[] m_srcs;
+  }
+  m_num_srcs = count;
+  if (has_inline_srcs()) {
+    std::memcpy(m_inline_srcs, buf, count * sizeof(reg_t));
   } else {
-    if (count <= MAX_NUM_INLINE_SRCS) {
-      // vector -> inline regs
-      auto old_srcs_ptr = m_srcs;
-      m_num_inline_srcs = count;
-      always_assert(count <= old_srcs_ptr->size());
-      std::memcpy(m_inline_srcs, old_srcs_ptr->data(), count * sizeof(reg_t));
-      delete old_srcs_ptr;
-    } else {
-      // staying in the vector state
-      m_srcs->resize(count);
-    }
+    m_srcs = dst;
   }
   return this;
 }
 
+void IRInstruction::assign_srcs(const reg_t* data, size_t count) {
+  set_srcs_size(count);
+  std::memcpy(src_data(), data, count * sizeof(reg_t));
+}
+
 uint16_t IRInstruction::size() const {
   auto op = m_opcode;
   if (opcode::is_an_internal(op)) {
@@ -331,18 +309,7 @@ void IRInstruction::denormalize_registers() {
     }
 
     // update m_inline_srcs or m_srcs
-    if (m_num_inline_srcs > MAX_NUM_INLINE_SRCS) {
-      delete m_srcs;
-    }
-    if (srcs.size() <= MAX_NUM_INLINE_SRCS) {
-      m_num_inline_srcs = srcs.size();
-      for (size_t i = 0; i < srcs.size(); ++i) {
-        m_inline_srcs[i] = srcs.at(i);
-      }
-    } else {
-      m_num_inline_srcs = MAX_NUM_INLINE_SRCS + 1;
-      m_srcs = new std::vector<reg_t>(std::move(srcs));
-    }
+    assign_srcs(srcs.data(), srcs.size());
   }
 }
 
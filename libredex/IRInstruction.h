@@ -139,6 +139,11 @@ class IRInstruction final {
   IRInstruction(const IRInstruction&);
   ~IRInstruction();
 
+  // Instructions are allocated and freed in huge numbers, so they are pooled
+  // (see SlabAllocator.h).
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   /*
    * Ensures that wide registers only have their first register referenced
    * in the srcs list. This only affects invoke-* instructions.
@@ -190,7 +195,7 @@ class IRInstruction final {
    */
   bool has_dest() const { return opcode_impl::has_dest(m_opcode); }
 
-  size_t srcs_size() const;
+  size_t srcs_size() const { return m_num_srcs; }
 
   bool has_move_result_pseudo() const {
     return opcode_impl::has_move_result_pseudo(m_opcode);
@@ -240,7 +245,10 @@ class IRInstruction final {
     always_assert_log(has_dest(), "No dest for %s", show_opcode().c_str());
     return m_dest;
   }
-  reg_t src(src_index_t i) const;
+  reg_t src(src_index_t i) const {
+    always_assert(i < m_num_srcs);
+    return src_data()[i];
+  }
 
  private:
   using reg_range_super = boost::iterator_range<const reg_t*>;
@@ -252,8 +260,12 @@ class IRInstruction final {
     // inherit the constructors
     using reg_range_super::reg_range_super;
   };
-  // Provides a read-only view into the source registers
-  reg_range srcs() const;
+  // Provides a read-only view into the source registers. This does not
+  // allocate; prefer it over srcs_vec() when just iterating.
+  reg_range srcs() const {
+    const reg_t* begin = src_data();
+    return reg_range(begin, begin + m_num_srcs);
+  }
   // Provides a copy of the source registers
   std::vector<reg_t> srcs_vec() const;
 
@@ -386,10 +398,18 @@ class IRInstruction final {
  private:
   std::string show_opcode() const; // To avoid "Show.h" in the header.
 
+  bool has_inline_srcs() const { return m_num_srcs <= MAX_NUM_INLINE_SRCS; }
+  const reg_t* src_data() const {
+    return has_inline_srcs() ? m_inline_srcs : m_srcs;
+  }
+  reg_t* src_data() { return has_inline_srcs() ? m_inline_srcs : m_srcs; }
+  // Replace the source registers with `count` registers copied from `data`.
+  void assign_srcs(const reg_t* data, size_t count);
+
   // 2 is chosen because it's the maximum number of registers (32 bits each) we
   // can fit in the size of a pointer (on a 64bit system).
   // In practice, most IRInstructions have 2 or fewer source registers, so we
-  // can avoid a vector allocation most of the time.
+  // can avoid a heap allocation most of the time.
   static constexpr uint8_t MAX_NUM_INLINE_SRCS = 2;
 
   // The fields of IRInstruction are carefully selected and ordered to avoid
@@ -397,13 +417,10 @@ class IRInstruction final {
   // alignment on a 64bit system.
 
   IROpcode m_opcode; // 2 bytes
-  // m_num_inline_srcs can take a small set of possible values:
-  //   * 0, ..., MAX_NUM_INLINE_SRCS: the size of the valid section of
-  //     m_inline_srcs
-  //   * MAX_NUM_INLINE_SRCS + 1: indicates that m_srcs should be used, not
-  //     m_inline_srcs
-  uint16_t m_num_inline_srcs{0}; // 2 bytes. Could be 1 byte
-                                 // but extra byte would just be padding
+  // The number of source registers. If it is at most MAX_NUM_INLINE_SRCS,
+  // they are stored in m_inline_srcs; otherwise m_srcs points to a heap array
+  // of exactly m_num_srcs registers.
+  uint16_t m_num_srcs{0}; // 2 bytes
   reg_t m_dest{0}; // 4 bytes
   // 8 bytes so far
   union {
@@ -420,11 +437,12 @@ class IRInstruction final {
   };
   // 16 bytes so far
   union {
-    // m_num_inline_srcs indicates how to interpret the union. See comment above
+    // m_num_srcs indicates how to interpret the union. See comment above
     reg_t m_inline_srcs[MAX_NUM_INLINE_SRCS] = {0};
-    // Use a pointer here because it's 8 bytes instead of ~24.
-    // Be careful to new and delete it correctly!
-    std::vector<reg_t>* m_srcs;
+    // A bare array rather than a std::vector: one allocation instead of two,
+    // and the size already lives in m_num_srcs.
+    // Be careful to new[] and delete[] it correctly!
+    reg_t* m_srcs;
   };
   // 24 bytes total
 };
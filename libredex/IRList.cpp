@@ -17,6 +17,7 @@
 #include "DexUtil.h"
 #include "IRInstruction.h"
 #include "Show.h"
+#include "SlabAllocator.h"
 
 bool TryEntry::operator==(const TryEntry& other) const {
   return type == other.type && *catch_start == *other.catch_start;
@@ -140,6 +141,28 @@ MethodItemEntry::~MethodItemEntry() {
   }
 }
 
+using MethodItemEntryAllocator =
+    SlabAllocator<sizeof(MethodItemEntry), alignof(MethodItemEntry)>;
+
+void* MethodItemEntry::operator new(size_t size) {
+  return MethodItemEntryAllocator::allocate(size);
+}
+
+void MethodItemEntry::operator delete(void* ptr, size_t size) {
+  MethodItemEntryAllocator::deallocate(ptr, size);
+}
+
+using SourceBlockAllocator =
+    SlabAllocator<sizeof(SourceBlock), alignof(SourceBlock)>;
+
+void* SourceBlock::operator new(size_t size) {
+  return SourceBlockAllocator::allocate(size);
+}
+
+void SourceBlock::operator delete(void* ptr, size_t size) {
+  SourceBlockAllocator::deallocate(ptr, size);
+}
+
 void MethodItemEntry::gather_strings(std::vector<DexString*>& lstring) const {
   switch (type) {
   case MFLOW_TRY:
@@ -163,6 +163,10 @@ struct SourceBlock {
       return &m_val;
     }
 
+    // Unlike through `operator*`, a missing value may be scaled, and stays
+    // missing.
+    void scale(float factor) { m_val.val *= factor; }
+
    private:
     ValPair m_val;
   };
@@ -178,6 +182,10 @@ struct SourceBlock {
         id(other.id),
         vals(other.vals) {}
 
+  // Pooled, like MethodItemEntry.
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   boost::optional<float> get_val(size_t i) const {
     return vals[i] ? boost::optional<float>(vals[i]->val) : boost::none;
   }
@@ -189,6 +197,15 @@ struct SourceBlock {
     return src == other.src && id == other.id && vals == other.vals;
   }
 
+  // Multiplies the value of each interaction by its factor. Missing values
+  // are NaN and stay missing, so this needs no branches and vectorizes.
+  void scale_vals(const float* factors, size_t size) {
+    redex_assert(size <= vals.size());
+    for (size_t i = 0; i < size; ++i) {
+      vals[i].scale(factors[i]);
+    }
+  }
+
   void append(std::unique_ptr<SourceBlock> sb) {
     SourceBlock* last = this;
     while (last->next != nullptr) {
@@ -282,6 +299,11 @@ struct MethodItemEntry {
   MethodItemEntry() : type(MFLOW_FALLTHROUGH) {}
   ~MethodItemEntry();
 
+  // Entries are allocated and freed in huge numbers, so they are pooled (see
+  // SlabAllocator.h).
+  static void* operator new(size_t size);
+  static void operator delete(void* ptr, size_t size);
+
   /*
    * This should only ever be used by the instruction lowering step. Do NOT use
    * it in passes!
@@ -7,27 +7,37 @@
 
 #include "IRMetaIO.h"
 
+#include <atomic>
 #include <fstream>
 #include <iostream>
+#include <numeric>
+#include <vector>
 
 #include "Show.h"
 #include "StringBuilder.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 constexpr const char* IRMETA_FILE_NAME = "/irmeta.bin";
 
-constexpr const char* IRMETA_MAGIC_NUMBER = "rdx.\n\x14\x12\x00";
+constexpr const char* IRMETA_MAGIC_NUMBER = "rdx.\n\x14\x13\x00";
 
+/**
+ * irmeta.bin is an index: this header, followed by the size of the class data
+ * of each part, as uint32_t. The class data of part i is in irmeta_<i>.bin, so
+ * that the parts can be written and read in parallel, and moved between
+ * intermediate outputs.
+ */
 PACKED(struct ir_meta_header_t {
   char magic[8];
   uint32_t checksum; // reserved
   uint32_t file_size;
-  uint32_t classes_size;
+  uint32_t num_parts;
   uint32_t rstate_size; // size of IRMetaIO::bit_rstate_t.
 });
 
-void serialize_str(const std::string& str, std::ofstream& ostrm) {
+void serialize_str(const std::string& str, std::ostream& ostrm) {
   char data[5];
   write_uleb128((uint8_t*)data, str.length());
   ostrm.write(data, uleb128_encoding_size(str.length()));
@@ -78,7 +88,7 @@ DexMethod* find_method(const DexClass* cls, const std::string& name_and_proto) {
  * Serialize deobfuscated_name and rstate of class, method or field.
  */
 template <typename T>
-void serialize_name_and_rstate(const T* obj, std::ofstream& ostrm) {
+void serialize_name_and_rstate(const T* obj, std::ostream& ostrm) {
   if (show(obj) != obj->get_deobfuscated_name()) {
     serialize_str(obj->get_deobfuscated_name(), ostrm);
   } else {
@@ -119,7 +129,7 @@ enum BlockType : char { ClassBlock, FieldBlock, MethodBlock, EndOfBlock };
  *    ...
  *  ...
  */
-void serialize_class_data(const Scope& classes, std::ofstream& ostrm) {
+void serialize_class_data(const Scope& classes, std::ostream& ostrm) {
   walk::classes(classes, [&](const DexClass* cls) {
     // Fields
     std::vector<const DexField*> fields;
@@ -170,7 +180,7 @@ void serialize_class_data(const Scope& classes, std::ofstream& ostrm) {
   });
 }
 
-void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
+void deserialize_class_data(std::istream& istrm, uint32_t data_size) {
   auto data = std::make_unique<char[]>(data_size);
   istrm.read((char*)data.get(), data_size);
   char* ptr = data.get();
@@ -210,29 +220,28 @@ void deserialize_class_data(std::ifstream& istrm, uint32_t data_size) {
 
 namespace ir_meta_io {
 
-void dump(const Scope& classes, const std::string& output_dir) {
+std::string get_part_file(const std::string& dir, size_t part) {
+  return dir + "/irmeta_" + std::to_string(part) + ".bin";
+}
+
+void write_index(const std::string& output_dir,
+                 const std::vector<uint32_t>& part_sizes) {
   std::string output_file = output_dir + IRMETA_FILE_NAME;
   std::ofstream ostrm(output_file, std::ios::binary | std::ios::trunc);
 
   ir_meta_header_t meta_header;
   memcpy(meta_header.magic, IRMETA_MAGIC_NUMBER, 8);
   meta_header.checksum = 0;
-  meta_header.file_size = 0;
-  meta_header.classes_size = 0;
+  meta_header.file_size =
+      sizeof(meta_header) + part_sizes.size() * sizeof(uint32_t);
+  meta_header.num_parts = part_sizes.size();
   meta_header.rstate_size = sizeof(IRMetaIO::bit_rstate_t);
   ostrm.write((char*)&meta_header, sizeof(meta_header));
-
-  serialize_class_data(classes, ostrm);
-  meta_header.classes_size = (uint32_t)ostrm.tellp() - sizeof(meta_header);
-
-  // TODO(fengliu): Serialize pass related data
-
-  meta_header.file_size = ostrm.tellp();
-  ostrm.seekp(0);
-  ostrm.write((char*)&meta_header, sizeof(meta_header));
+  ostrm.write((char*)part_sizes.data(), part_sizes.size() * sizeof(uint32_t));
 }
 
-bool load(const std::string& input_dir) {
+bool read_index(const std::string& input_dir,
+                std::vector<uint32_t>* part_sizes) {
   std::string input_file = input_dir + IRMETA_FILE_NAME;
   std::ifstream istrm(input_file, std::ios::binary | std::ios::in);
   if (!istrm.is_open()) {
@@ -250,15 +259,60 @@ bool load(const std::string& input_dir) {
     std::cerr << "Could not load the outdated IR meta data\n";
     return false;
   }
-  // file size
+  part_sizes->resize(meta_header.num_parts);
+  istrm.read((char*)part_sizes->data(), part_sizes->size() * sizeof(uint32_t));
+  if (!istrm) {
+    std::cerr << "Truncated meta file " << input_file << std::endl;
+    return false;
+  }
+  return true;
+}
 
-  deserialize_class_data(istrm, meta_header.classes_size);
+void dump(const std::vector<Scope>& parts, const std::string& output_dir) {
+  std::vector<uint32_t> part_sizes(parts.size());
+  std::vector<size_t> indices(parts.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        std::ofstream ostrm(get_part_file(output_dir, i),
+                            std::ios::binary | std::ios::trunc);
+        serialize_class_data(parts[i], ostrm);
+        part_sizes[i] = (uint32_t)ostrm.tellp();
+      },
+      indices);
+  write_index(output_dir, part_sizes);
 
-  return true;
+  // TODO(fengliu): Serialize pass related data
+}
+
+bool load(const std::string& input_dir) {
+  std::vector<uint32_t> part_sizes;
+  if (!read_index(input_dir, &part_sizes)) {
+    return false;
+  }
+
+  // The parts hold the meta data of distinct classes.
+  std::vector<size_t> indices(part_sizes.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  std::atomic<bool> all_loaded{true};
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto part_file = get_part_file(input_dir, i);
+        std::ifstream part_strm(part_file, std::ios::binary | std::ios::in);
+        if (!part_strm.is_open()) {
+          std::cerr << "Can not open " << part_file << std::endl;
+          all_loaded = false;
+          return;
+        }
+        deserialize_class_data(part_strm, part_sizes[i]);
+      },
+      indices);
+
+  return all_loaded;
 }
 
 void IRMetaIO::serialize_rstate(const ReferencedState& rstate,
-                                std::ofstream& ostrm) {
+                                std::ostream& ostrm) {
   bit_rstate_t bit_rstate;
   bit_rstate.inner_struct = rstate.inner_struct;
   ostrm.write((char*)&bit_rstate, sizeof(bit_rstate));
@@ -10,17 +10,32 @@
 
 namespace ir_meta_io {
 
-void dump(const Scope& classes, const std::string& output_dir);
+/**
+ * Write the meta data of each part of the classes to its own file, in
+ * parallel, and an index of the parts.
+ */
+void dump(const std::vector<Scope>& parts, const std::string& output_dir);
 
 bool load(const std::string& input_dir);
 
+// The file that holds the meta data of part `part` of the classes.
+std::string get_part_file(const std::string& dir, size_t part);
+
+// The sizes of the parts of the meta data in `input_dir`.
+bool read_index(const std::string& input_dir,
+                std::vector<uint32_t>* part_sizes);
+
+// Index the parts of the meta data that are already in `output_dir`.
+void write_index(const std::string& output_dir,
+                 const std::vector<uint32_t>& part_sizes);
+
 class IRMetaIO {
  public:
   struct bit_rstate_t {
     ReferencedState::InnerStruct inner_struct;
   };
   static void serialize_rstate(const ReferencedState& rstate,
-                               std::ofstream& ostrm);
+                               std::ostream& ostrm);
   static void deserialize_rstate(const char** _ptr, ReferencedState& rstate);
 
   /**
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IncrementalPassCache.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+
+#include "DexHasher.h"
+#include "Trace.h"
+
+namespace incremental {
+
+namespace {
+
+// To be bumped whenever the meaning of the recorded hashes changes.
+constexpr const char* FORMAT_VERSION = "noop-cache-1";
+
+} // namespace
+
+std::string NoOpCache::get_path(const std::string& dir) const {
+  return (boost::filesystem::path(dir) / (m_pass_name + ".noop")).string();
+}
+
+std::string NoOpCache::get_header() const {
+  return std::string(FORMAT_VERSION) + " " + m_pass_name + " " +
+         hashing::hash_to_string(m_config_hash);
+}
+
+size_t NoOpCache::load(const std::string& dir) {
+  auto path = get_path(dir);
+  std::ifstream input(path);
+  if (!input) {
+    TRACE(PM, 1, "No incremental cache at %s", path.c_str());
+    return 0;
+  }
+  std::string line;
+  if (!std::getline(input, line) || line != get_header()) {
+    TRACE(PM, 1, "Ignoring stale incremental cache at %s", path.c_str());
+    return 0;
+  }
+  while (std::getline(input, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    m_loaded.insert(std::stoull(line, nullptr, 16));
+  }
+  return m_loaded.size();
+}
+
+void NoOpCache::save(const std::string& dir) const {
+  std::vector<size_t> hashes(m_noops.begin(), m_noops.end());
+  std::sort(hashes.begin(), hashes.end());
+  std::ofstream output(get_path(dir));
+  output << get_header() << "\n";
+  for (auto hash : hashes) {
+    output << hashing::hash_to_string(hash) << "\n";
+  }
+}
+
+size_t NoOpCache::get_hash(const DexMethod* method) {
+  return hashing::hash_method(method);
+}
+
+bool NoOpCache::is_noop(size_t method_hash) {
+  if (m_loaded.count(method_hash)) {
+    ++m_hits;
+    m_noops.insert(method_hash);
+    return true;
+  }
+  ++m_misses;
+  return false;
+}
+
+void NoOpCache::record_noop(size_t method_hash) {
+  m_noops.insert(method_hash);
+}
+
+} // namespace incremental
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <unordered_set>
+
+#include "ConcurrentContainers.h"
+#include "DexClass.h"
+
+namespace incremental {
+
+/*
+ * Remembers, across runs of Redex, the methods on which a method-local pass
+ * turned out to be a no-op, so that they can be skipped when they come back
+ * unchanged in a later build.
+ *
+ * Methods are identified by hashing::hash_method(), i.e. by their signature
+ * and code. Only passes whose effect on a method depends on nothing but that
+ * method may use this cache; `config_hash` must capture all the options of
+ * the pass that can change its effect. Entries recorded under a different
+ * pass name or configuration are ignored.
+ *
+ * Only the no-ops of the current run are saved, so entries for code that
+ * disappeared do not accumulate. The cache is stored in
+ * `<dir>/<pass name>.noop`, as a text file with one hash per line.
+ */
+class NoOpCache final {
+ public:
+  NoOpCache(std::string pass_name, size_t config_hash)
+      : m_pass_name(std::move(pass_name)), m_config_hash(config_hash) {}
+
+  // Returns the number of entries read.
+  size_t load(const std::string& dir);
+
+  void save(const std::string& dir) const;
+
+  /*
+   * Runs `fn` on the method, unless `fn` was found to leave this very code
+   * unchanged by a previous run. Returns true if `fn` was run.
+   */
+  template <typename Fn>
+  bool run(DexMethod* method, const Fn& fn) {
+    auto hash = get_hash(method);
+    if (is_noop(hash)) {
+      return false;
+    }
+    fn();
+    if (get_hash(method) == hash) {
+      record_noop(hash);
+    }
+    return true;
+  }
+
+  bool is_noop(size_t method_hash);
+
+  void record_noop(size_t method_hash);
+
+  size_t hits() const { return m_hits; }
+
+  size_t misses() const { return m_misses; }
+
+ private:
+  static size_t get_hash(const DexMethod* method);
+
+  std::string get_path(const std::string& dir) const;
+
+  std::string get_header() const;
+
+  std::string m_pass_name;
+  size_t m_config_hash;
+  // Read-only once loaded.
+  std::unordered_set<size_t> m_loaded;
+  ConcurrentSet<size_t> m_noops;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
+
+} // namespace incremental
@@ -7,7 +7,11 @@
 
 #include "InitCollisionFinder.h"
 
+#include <numeric>
+#include <unordered_set>
+
 #include "DexUtil.h"
+#include "WorkQueue.h"
 
 /**
  * Some optimizations want to change the prototypes of many methods. Sometimes,
@@ -28,7 +32,8 @@ namespace init_collision_finder {
  * change). In the process, this method should fill the vector argument with any
  * DexTypes that were replaced in the method's prototype.
  *
- * This function is supplied by the user of the Init Collision Finder.
+ * This function is supplied by the user of the Init Collision Finder. It is
+ * called concurrently for the <init>s of different classes.
  */
 using GetNewSpec = std::function<boost::optional<DexMethodSpec>(
     const DexMethod*, std::vector<DexType*>*)>;
@@ -36,15 +41,25 @@ using GetNewSpec = std::function<boost::optional<DexMethodSpec>(
 std::vector<DexType*> find(const Scope& scope, const GetNewSpec& get_new_spec) {
   // Compute what the new prototypes will be after we convert a method. Check
   // the prototypes against existing methods and other prototypes created by
-  // this method.
-  std::vector<DexType*> result;
-  for (const DexClass* cls : scope) {
-    std::unordered_set<DexMethodSpec> new_specs;
-    for (const DexMethod* m : cls->get_dmethods()) {
-      if (method::is_init(m)) {
-        std::vector<DexType*> unsafe_refs;
-        const auto& new_spec = get_new_spec(m, &unsafe_refs);
-        if (new_spec) {
+  // this method. The <init>s of a class are only checked against each other,
+  // so the classes are checked concurrently, and their results are gathered in
+  // the order of the scope.
+  std::vector<std::vector<DexType*>> class_results(scope.size());
+  std::vector<size_t> indices(scope.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto& class_result = class_results[i];
+        std::unordered_set<DexMethodSpec> new_specs;
+        for (const DexMethod* m : scope[i]->get_dmethods()) {
+          if (!method::is_init(m)) {
+            continue;
+          }
+          std::vector<DexType*> unsafe_refs;
+          const auto& new_spec = get_new_spec(m, &unsafe_refs);
+          if (!new_spec) {
+            continue;
+          }
           const auto& pair = new_specs.emplace(*new_spec);
           bool already_there = !pair.second;
           if (already_there || DexMethod::get_method(*new_spec)) {
@@ -52,11 +67,16 @@ std::vector<DexType*> find(const Scope& scope, const GetNewSpec& get_new_spec) {
                 !unsafe_refs.empty(),
                 "unsafe_refs should be filled with the types that will be "
                 "replaced on this <init> method's prototype");
-            result.insert(result.end(), unsafe_refs.begin(), unsafe_refs.end());
+            class_result.insert(class_result.end(), unsafe_refs.begin(),
+                                unsafe_refs.end());
           }
         }
-      }
-    }
+      },
+      indices);
+
+  std::vector<DexType*> result;
+  for (const auto& class_result : class_results) {
+    result.insert(result.end(), class_result.begin(), class_result.end());
   }
   return result;
 }
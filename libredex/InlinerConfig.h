@@ -32,6 +32,10 @@ struct InlinerConfig {
   bool shrink_other_methods{true};
   bool unique_inlined_registers{true};
   bool debug{false};
+  // Number of code units that may be spent on inlining the hottest calls
+  // according to the method profiles, regardless of the cost model. Zero
+  // turns this off.
+  size_t profile_guided_budget{0};
   std::unordered_set<DexType*> allowlist_no_method_limit;
   // We will populate the information to rstate of classes and methods.
   std::unordered_set<DexType*> m_no_inline_annos;
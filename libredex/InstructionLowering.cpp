@@ -512,14 +512,18 @@ Stats lower(DexMethod* method, bool lower_with_cfg) {
 }
 
 Stats run(DexStoresVector& stores, bool lower_with_cfg) {
-  auto scope = build_class_scope(stores);
-  return walk::parallel::methods<Stats>(scope, [lower_with_cfg](DexMethod* m) {
-    Stats stats;
-    if (m->get_code() == nullptr) {
-      return stats;
-    }
-    return lower(m, lower_with_cfg);
-  });
+  return run(build_class_scope(stores), lower_with_cfg);
+}
+
+Stats run(const Scope& scope, bool lower_with_cfg) {
+  return walk::parallel::methods_by_cost<Stats>(
+      scope, [lower_with_cfg](DexMethod* m) {
+        Stats stats;
+        if (m->get_code() == nullptr) {
+          return stats;
+        }
+        return lower(m, lower_with_cfg);
+      });
 }
 
 // Computes number of entries needed for a packed switch, accounting for any
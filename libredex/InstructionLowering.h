@@ -11,6 +11,7 @@
 #include <cstdint>
 #include <vector>
 
+class DexClass;
 class DexMethod;
 class DexStore;
 class IRInstruction;
@@ -19,6 +20,7 @@ struct MethodItemEntry;
 enum DexOpcode : uint16_t;
 
 using DexStoresVector = std::vector<DexStore>;
+using Scope = std::vector<DexClass*>;
 
 namespace instruction_lowering {
 
@@ -47,6 +49,13 @@ Stats lower(DexMethod*, bool lower_with_cfg = false);
 
 Stats run(DexStoresVector&, bool lower_with_cfg = false);
 
+/*
+ * Lowers the methods of the given classes only, so that the dexes can be
+ * lowered one at a time. The methods are lowered in parallel, the most
+ * expensive ones first.
+ */
+Stats run(const Scope& scope, bool lower_with_cfg = false);
+
 namespace impl {
 
 DexOpcode select_move_opcode(const IRInstruction* insn);
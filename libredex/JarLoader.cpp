@@ -7,7 +7,18 @@
 
 #include <boost/iostreams/device/mapped_file.hpp>
 
+#include <algorithm>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
 #include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <zlib.h>
@@ -25,9 +36,12 @@
 #include "DexClass.h"
 #include "DuplicateClasses.h"
 #include "JarLoader.h"
+#include "RedexMappedFile.h"
+#include "Sha1.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Util.h"
+#include "WorkQueue.h"
 
 /******************
  * Begin Class Loading code.
@@ -73,15 +87,27 @@ struct cp_entry {
   };
 };
 
-struct cp_field_info {
+/*
+ * The parts of a class file that we turn into an external DexClass. These can
+ * also be saved to and loaded from a jar snapshot.
+ */
+struct member_info {
   uint16_t aflags;
-  uint16_t nameNdx;
-  uint16_t descNdx;
+  std::string name;
+  std::string desc;
+  // The attributes_count of the member in the class file, or nullptr when
+  // loaded from a snapshot.
+  uint8_t* attributes{nullptr};
 };
-struct cp_method_info {
+
+struct class_info {
   uint16_t aflags;
-  uint16_t nameNdx;
-  uint16_t descNdx;
+  std::string name;
+  // Empty if the class has no superclass.
+  std::string super;
+  std::vector<std::string> interfaces;
+  std::vector<member_info> fields;
+  std::vector<member_info> methods;
 };
 } // namespace
 
@@ -164,28 +190,29 @@ static void skip_attributes(uint8_t*& buffer) {
   }
 }
 #define MAX_CLASS_NAMELEN (8 * 1024)
-static DexType* make_dextype_from_cref(std::vector<cp_entry>& cpool,
-                                       uint16_t cref) {
-  char nbuffer[MAX_CLASS_NAMELEN];
+static bool extract_class_name(std::vector<cp_entry>& cpool,
+                               uint16_t cref,
+                               std::string* out) {
   if (cpool[cref].tag != CP_CONST_CLASS) {
     fprintf(stderr, "Non-class ref in get_class_name, Bailing\n");
-    return nullptr;
+    return false;
   }
   uint16_t utf8ref = cpool[cref].s0;
   const cp_entry& utf8cpe = cpool[utf8ref];
   if (utf8cpe.tag != CP_CONST_UTF8) {
     fprintf(stderr, "Non-utf8 ref in get_utf8, Bailing\n");
-    return nullptr;
+    return false;
   }
   if (utf8cpe.len > (MAX_CLASS_NAMELEN + 3)) {
     fprintf(stderr, "classname is greater than max, bailing");
-    return nullptr;
+    return false;
   }
-  nbuffer[0] = 'L';
-  memcpy(nbuffer + 1, utf8cpe.data, utf8cpe.len);
-  nbuffer[1 + utf8cpe.len] = ';';
-  nbuffer[2 + utf8cpe.len] = '\0';
-  return DexType::make_type(nbuffer);
+  out->clear();
+  out->reserve(utf8cpe.len + 2);
+  *out += 'L';
+  out->append(reinterpret_cast<const char*>(utf8cpe.data), utf8cpe.len);
+  *out += ';';
+  return true;
 }
 
 static bool extract_utf8(std::vector<cp_entry>& cpool,
@@ -207,17 +234,26 @@ static bool extract_utf8(std::vector<cp_entry>& cpool,
   return true;
 }
 
-static DexField* make_dexfield(std::vector<cp_entry>& cpool,
-                               DexType* self,
-                               cp_field_info& finfo) {
-  char dbuffer[MAX_CLASS_NAMELEN];
-  char nbuffer[MAX_CLASS_NAMELEN];
-  if (!extract_utf8(cpool, finfo.nameNdx, nbuffer, MAX_CLASS_NAMELEN) ||
-      !extract_utf8(cpool, finfo.descNdx, dbuffer, MAX_CLASS_NAMELEN)) {
-    return nullptr;
+static bool extract_utf8(std::vector<cp_entry>& cpool,
+                         uint16_t utf8ref,
+                         std::string* out) {
+  const cp_entry& utf8cpe = cpool[utf8ref];
+  if (utf8cpe.tag != CP_CONST_UTF8) {
+    fprintf(stderr, "Non-utf8 ref in get_utf8, bailing\n");
+    return false;
+  }
+  if (utf8cpe.len > (MAX_CLASS_NAMELEN - 1)) {
+    fprintf(stderr, "Name is greater (%hu) than max (%u), bailing\n",
+            utf8cpe.len, MAX_CLASS_NAMELEN);
+    return false;
   }
-  DexString* name = DexString::make_string(nbuffer);
-  DexType* desc = DexType::make_type(dbuffer);
+  out->assign(reinterpret_cast<const char*>(utf8cpe.data), utf8cpe.len);
+  return true;
+}
+
+static DexField* make_dexfield(DexType* self, const member_info& finfo) {
+  DexString* name = DexString::make_string(finfo.name);
+  DexType* desc = DexType::make_type(finfo.desc.c_str());
   DexField* field =
       static_cast<DexField*>(DexField::make_field(self, name, desc));
   field->set_access((DexAccessFlags)finfo.aflags);
@@ -322,17 +358,9 @@ static DexTypeList* extract_arguments(const char*& buf) {
   return DexTypeList::make_type_list(std::move(args));
 }
 
-static DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
-                                 DexType* self,
-                                 cp_method_info& finfo) {
-  char dbuffer[MAX_CLASS_NAMELEN];
-  char nbuffer[MAX_CLASS_NAMELEN];
-  if (!extract_utf8(cpool, finfo.nameNdx, nbuffer, MAX_CLASS_NAMELEN) ||
-      !extract_utf8(cpool, finfo.descNdx, dbuffer, MAX_CLASS_NAMELEN)) {
-    return nullptr;
-  }
-  DexString* name = DexString::make_string(nbuffer);
-  const char* ptr = dbuffer;
+static DexMethod* make_dexmethod(DexType* self, const member_info& finfo) {
+  DexString* name = DexString::make_string(finfo.name);
+  const char* ptr = finfo.desc.c_str();
   DexTypeList* tlist = extract_arguments(ptr);
   if (tlist == nullptr) return nullptr;
   DexType* rtype = parse_type(ptr);
@@ -347,9 +375,9 @@ static DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
   }
   uint32_t access = finfo.aflags;
   bool is_virt = true;
-  if (nbuffer[0] == '<') {
+  if (finfo.name[0] == '<') {
     is_virt = false;
-    if (nbuffer[1] == 'i') {
+    if (finfo.name[1] == 'i') {
       access |= ACC_CONSTRUCTOR;
     }
   } else if (access & (ACC_PRIVATE | ACC_STATIC))
@@ -360,10 +388,14 @@ static DexMethod* make_dexmethod(std::vector<cp_entry>& cpool,
   return method;
 }
 
-bool parse_class(uint8_t* buffer,
-                 Scope* classes,
-                 attribute_hook_t attr_hook,
-                 const std::string& jar_location) {
+namespace {
+
+// Decodes the class file in :buffer. Sets :info to none for classes that are
+// deliberately ignored.
+bool decode_class(uint8_t* buffer,
+                  std::vector<cp_entry>* cpool,
+                  boost::optional<class_info>* info,
+                  const std::string& jar_location) {
   uint32_t magic = read32(buffer);
   uint16_t vminor DEBUG_ONLY = read16(buffer);
   uint16_t vmajor DEBUG_ONLY = read16(buffer);
@@ -372,13 +404,13 @@ bool parse_class(uint8_t* buffer,
     fprintf(stderr, "Bad class magic %08x, Bailing\n", magic);
     return false;
   }
-  std::vector<cp_entry> cpool;
-  cpool.resize(cp_count);
+  cpool->resize(cp_count);
   /* The zero'th entry is always empty.  Java is annoying. */
   for (int i = 1; i < cp_count; i++) {
-    if (!parse_cp_entry(buffer, cpool[i])) return false;
-    if (cpool[i].tag == CP_CONST_LONG || cpool[i].tag == CP_CONST_DOUBLE) {
-      cpool[i + 1] = cpool[i];
+    if (!parse_cp_entry(buffer, (*cpool)[i])) return false;
+    if ((*cpool)[i].tag == CP_CONST_LONG ||
+        (*cpool)[i].tag == CP_CONST_DOUBLE) {
+      (*cpool)[i + 1] = (*cpool)[i];
       i++;
     }
   }
@@ -393,10 +425,58 @@ bool parse_class(uint8_t* buffer,
     // Ignore them for now.
     TRACE(MAIN, 5, "Warning: ignoring module-info class in jar '%s'",
           jar_location.c_str());
+    *info = boost::none;
     return true;
   }
 
-  DexType* self = make_dextype_from_cref(cpool, clazz);
+  class_info ci;
+  ci.aflags = aflags;
+  if (!extract_class_name(*cpool, clazz, &ci.name)) return false;
+  if (super != 0 && !extract_class_name(*cpool, super, &ci.super)) {
+    return false;
+  }
+  for (int i = 0; i < ifcount; i++) {
+    uint16_t iface = read16(buffer);
+    ci.interfaces.emplace_back();
+    if (!extract_class_name(*cpool, iface, &ci.interfaces.back())) {
+      return false;
+    }
+  }
+  auto decode_members = [&](std::vector<member_info>* members) {
+    uint16_t count = read16(buffer);
+    for (int i = 0; i < count; i++) {
+      member_info member;
+      member.aflags = read16(buffer);
+      uint16_t name_index = read16(buffer);
+      uint16_t desc_index = read16(buffer);
+      member.attributes = buffer;
+      skip_attributes(buffer);
+      if (!extract_utf8(*cpool, name_index, &member.name) ||
+          !extract_utf8(*cpool, desc_index, &member.desc)) {
+        return false;
+      }
+      members->push_back(std::move(member));
+    }
+    return true;
+  };
+  if (!decode_members(&ci.fields) || !decode_members(&ci.methods)) {
+    return false;
+  }
+  *info = std::move(ci);
+  return true;
+}
+
+using member_hook_t =
+    std::function<void(const boost::variant<DexField*, DexMethod*>&,
+                       uint8_t* attributes)>;
+
+// Creates the external DexClass described by :info, unless a class of that
+// name already exists.
+bool make_class(const class_info& info,
+                Scope* classes,
+                const member_hook_t& member_hook,
+                const std::string& jar_location) {
+  DexType* self = DexType::make_type(info.name.c_str());
   DexClass* cls = type_class(self);
   if (cls) {
     // We are seeing duplicate classes when parsing jar file
@@ -432,69 +512,27 @@ bool parse_class(uint8_t* buffer,
 
   ClassCreator cc(self, jar_location);
   cc.set_external();
-  if (super != 0) {
-    DexType* sclazz = make_dextype_from_cref(cpool, super);
-    cc.set_super(sclazz);
+  if (!info.super.empty()) {
+    cc.set_super(DexType::make_type(info.super.c_str()));
   }
-  cc.set_access((DexAccessFlags)aflags);
-  if (ifcount) {
-    for (int i = 0; i < ifcount; i++) {
-      uint16_t iface = read16(buffer);
-      DexType* iftype = make_dextype_from_cref(cpool, iface);
-      cc.add_interface(iftype);
-    }
+  cc.set_access((DexAccessFlags)info.aflags);
+  for (const auto& iface : info.interfaces) {
+    cc.add_interface(DexType::make_type(iface.c_str()));
   }
-  uint16_t fcount = read16(buffer);
-
-  auto invoke_attr_hook =
-      [&](const boost::variant<DexField*, DexMethod*>& field_or_method,
-          uint8_t* attrPtr) {
-        if (attr_hook == nullptr) {
-          return;
-        }
-        uint16_t attributes_count = read16(attrPtr);
-        for (uint16_t j = 0; j < attributes_count; j++) {
-          uint16_t attribute_name_index = read16(attrPtr);
-          uint32_t attribute_length = read32(attrPtr);
-          char attribute_name[MAX_CLASS_NAMELEN];
-          auto extract_res = extract_utf8(cpool, attribute_name_index,
-                                          attribute_name, MAX_CLASS_NAMELEN);
-          always_assert_log(
-              extract_res,
-              "attribute hook was specified, but failed to load the attribute "
-              "name due to insufficient name buffer");
-          attr_hook(field_or_method, attribute_name, attrPtr);
-          attrPtr += attribute_length;
-        }
-      };
-
-  for (int i = 0; i < fcount; i++) {
-    cp_field_info cpfield;
-    cpfield.aflags = read16(buffer);
-    cpfield.nameNdx = read16(buffer);
-    cpfield.descNdx = read16(buffer);
-    uint8_t* attrPtr = buffer;
-    skip_attributes(buffer);
-    DexField* field = make_dexfield(cpool, self, cpfield);
+  for (const auto& finfo : info.fields) {
+    DexField* field = make_dexfield(self, finfo);
     if (field == nullptr) return false;
     cc.add_field(field);
-    invoke_attr_hook({field}, attrPtr);
+    if (member_hook) {
+      member_hook({field}, finfo.attributes);
+    }
   }
-
-  uint16_t mcount = read16(buffer);
-  if (mcount) {
-    for (int i = 0; i < mcount; i++) {
-      cp_method_info cpmethod;
-      cpmethod.aflags = read16(buffer);
-      cpmethod.nameNdx = read16(buffer);
-      cpmethod.descNdx = read16(buffer);
-
-      uint8_t* attrPtr = buffer;
-      skip_attributes(buffer);
-      DexMethod* method = make_dexmethod(cpool, self, cpmethod);
-      if (method == nullptr) return false;
-      cc.add_method(method);
-      invoke_attr_hook({method}, attrPtr);
+  for (const auto& minfo : info.methods) {
+    DexMethod* method = make_dexmethod(self, minfo);
+    if (method == nullptr) return false;
+    cc.add_method(method);
+    if (member_hook) {
+      member_hook({method}, minfo.attributes);
     }
   }
   DexClass* dc = cc.create();
@@ -533,6 +571,77 @@ bool parse_class(uint8_t* buffer,
   return true;
 }
 
+// Creates the class decoded by decode_class, and appends it to :snapshot, if
+// any. The attribute hook reads the attributes through :cpool, so the buffer
+// that the class was decoded from must still be alive if there is a hook.
+bool record_and_make_class(std::vector<cp_entry>& cpool,
+                           const boost::optional<class_info>& info,
+                           Scope* classes,
+                           const attribute_hook_t& attr_hook,
+                           const std::string& jar_location,
+                           std::vector<class_info>* snapshot) {
+  if (!info) {
+    return true;
+  }
+  if (snapshot != nullptr) {
+    snapshot->push_back(*info);
+    for (auto& member : snapshot->back().fields) {
+      member.attributes = nullptr;
+    }
+    for (auto& member : snapshot->back().methods) {
+      member.attributes = nullptr;
+    }
+  }
+
+  member_hook_t member_hook;
+  if (attr_hook != nullptr) {
+    member_hook = [&](const boost::variant<DexField*, DexMethod*>&
+                          field_or_method,
+                      uint8_t* attrPtr) {
+      uint16_t attributes_count = read16(attrPtr);
+      for (uint16_t j = 0; j < attributes_count; j++) {
+        uint16_t attribute_name_index = read16(attrPtr);
+        uint32_t attribute_length = read32(attrPtr);
+        char attribute_name[MAX_CLASS_NAMELEN];
+        auto extract_res = extract_utf8(cpool, attribute_name_index,
+                                        attribute_name, MAX_CLASS_NAMELEN);
+        always_assert_log(
+            extract_res,
+            "attribute hook was specified, but failed to load the attribute "
+            "name due to insufficient name buffer");
+        attr_hook(field_or_method, attribute_name, attrPtr);
+        attrPtr += attribute_length;
+      }
+    };
+  }
+  return make_class(*info, classes, member_hook, jar_location);
+}
+
+// Like parse_class, but also appends the decoded class to :snapshot, if any.
+bool parse_and_record_class(uint8_t* buffer,
+                            Scope* classes,
+                            const attribute_hook_t& attr_hook,
+                            const std::string& jar_location,
+                            std::vector<class_info>* snapshot) {
+  std::vector<cp_entry> cpool;
+  boost::optional<class_info> info;
+  if (!decode_class(buffer, &cpool, &info, jar_location)) {
+    return false;
+  }
+  return record_and_make_class(cpool, info, classes, attr_hook, jar_location,
+                               snapshot);
+}
+
+} // namespace
+
+bool parse_class(uint8_t* buffer,
+                 Scope* classes,
+                 attribute_hook_t attr_hook,
+                 const std::string& jar_location) {
+  return parse_and_record_class(buffer, classes, attr_hook, jar_location,
+                                /* snapshot */ nullptr);
+}
+
 bool load_class_file(const std::string& filename, Scope* classes) {
   // It's not exactly efficient to call init_basic_types repeatedly for each
   // class file that we load, but load_class_file should typically only be used
@@ -722,19 +831,14 @@ static int jar_uncompress(Bytef* dest,
   return err;
 }
 
-static bool decompress_class(jar_entry& file,
-                             const uint8_t* mapping,
-                             uint8_t* outbuffer,
-                             ssize_t bufsize) {
-  if (file.cd_entry.comp_method != kCompMethodDeflate) {
-    fprintf(stderr, "Unknown compression method %d, Bailing\n",
-            file.cd_entry.comp_method);
-    return false;
-  }
+// Validates the local file header of `file`, and returns the start of its
+// data, or nullptr.
+static const uint8_t* get_local_file_data(const jar_entry& file,
+                                          const uint8_t* mapping) {
   const uint8_t* lfile = mapping + file.cd_entry.disk_offset;
   if (memcmp(lfile, kLFile, kSignatureSize) != 0) {
     fprintf(stderr, "Invalid local file entry, bailing\n");
-    return false;
+    return nullptr;
   }
   pk_lfile pkf;
   memcpy(&pkf, lfile, sizeof(pk_lfile));
@@ -756,35 +860,63 @@ static bool decompress_class(jar_entry& file,
             pkf.fname_len, pkf.comp_size, pkf.ucomp_size, pkf.comp_method,
             file.cd_entry.fname_len, file.cd_entry.comp_size,
             file.cd_entry.ucomp_size, file.cd_entry.comp_method, pkf.extra_len);
-    return false;
+    return nullptr;
   }
   lfile += pkf.fname_len;
   lfile += pkf.extra_len;
+  return lfile;
+}
+
+static bool decompress_class(jar_entry& file,
+                             const uint8_t* mapping,
+                             uint8_t* outbuffer,
+                             ssize_t bufsize) {
+  if (file.cd_entry.comp_method != kCompMethodDeflate) {
+    fprintf(stderr, "Unknown compression method %d, Bailing\n",
+            file.cd_entry.comp_method);
+    return false;
+  }
+  const uint8_t* data = get_local_file_data(file, mapping);
+  if (data == nullptr) {
+    return false;
+  }
   uLongf dlen = bufsize;
-  int zlibrv = jar_uncompress(outbuffer, &dlen, lfile, pkf.comp_size);
+  int zlibrv = jar_uncompress(outbuffer, &dlen, data, file.cd_entry.comp_size);
   if (zlibrv != Z_OK) {
     fprintf(stderr, "uncompress failed with code %d, Bailing\n", zlibrv);
     return false;
   }
-  if (dlen != pkf.ucomp_size) {
+  if (dlen != file.cd_entry.ucomp_size) {
     fprintf(stderr, "mis-match on uncompressed size, Bailing\n");
     return false;
   }
   return true;
 }
 
-static const int kStartBufferSize = 128 * 1024;
+namespace {
+
+// A class entry of a jar, inflated and decoded on a worker thread.
+struct decoded_entry {
+  bool ok{false};
+  // Only kept alive for the attribute hook, which reads the attributes of the
+  // members from it.
+  std::unique_ptr<uint8_t[]> buffer;
+  std::vector<cp_entry> cpool;
+  boost::optional<class_info> info;
+};
+
+} // namespace
 
 static bool process_jar_entries(const char* location,
                                 std::vector<jar_entry>& files,
                                 const uint8_t* mapping,
                                 Scope* classes,
-                                const attribute_hook_t& attr_hook) {
-  ssize_t bufsize = kStartBufferSize;
-  uint8_t* outbuffer = (uint8_t*)malloc(bufsize);
+                                const attribute_hook_t& attr_hook,
+                                std::vector<class_info>* snapshot) {
   static char classEndString[] = ".class";
   static size_t classEndStringLen = strlen(classEndString);
   init_basic_types();
+  std::vector<jar_entry*> class_files;
   for (auto& file : files) {
     if (file.cd_entry.ucomp_size == 0) continue;
     if (file.cd_entry.fname_len < (classEndStringLen + 1)) continue;
@@ -793,26 +925,61 @@ static bool process_jar_entries(const char* location,
     uint8_t* endcomp =
         file.filename + (file.cd_entry.fname_len - classEndStringLen);
     if (memcmp(endcomp, classEndString, classEndStringLen) != 0) continue;
+    class_files.push_back(&file);
+  }
 
-    // Resize output if necessary.
-    if (bufsize < file.cd_entry.ucomp_size) {
-      while (bufsize < file.cd_entry.ucomp_size)
-        bufsize *= 2;
-      free(outbuffer);
-      outbuffer = (uint8_t*)malloc(bufsize);
-    }
+  // Inflating and decoding the class files only touches their own buffers, so
+  // it is done concurrently. The classes are then created in the order of the
+  // entries, which keeps the handling of duplicate classes as it was.
+  std::string jar_location(location);
+  std::vector<decoded_entry> decoded(class_files.size());
+  std::vector<size_t> indices(class_files.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto& file = *class_files[i];
+        auto& entry = decoded[i];
+        auto buffer = std::make_unique<uint8_t[]>(file.cd_entry.ucomp_size);
+        if (!decompress_class(file, mapping, buffer.get(),
+                              file.cd_entry.ucomp_size)) {
+          return;
+        }
+        entry.ok = decode_class(buffer.get(), &entry.cpool, &entry.info,
+                                jar_location);
+        if (attr_hook != nullptr) {
+          entry.buffer = std::move(buffer);
+        } else {
+          entry.cpool.clear();
+        }
+      },
+      indices);
 
-    if (!decompress_class(file, mapping, outbuffer, bufsize)) {
-      free(outbuffer);
+  for (auto& entry : decoded) {
+    if (!entry.ok ||
+        !record_and_make_class(entry.cpool, entry.info, classes, attr_hook,
+                               jar_location, snapshot)) {
       return false;
     }
+    entry = decoded_entry();
+  }
+  return true;
+}
 
-    if (!parse_class(outbuffer, classes, attr_hook, location)) {
-      free(outbuffer);
-      return false;
-    }
+static bool process_jar(const char* location,
+                        const uint8_t* mapping,
+                        ssize_t size,
+                        Scope* classes,
+                        const attribute_hook_t& attr_hook,
+                        std::vector<class_info>* snapshot) {
+  pk_cdir_end pce;
+  std::vector<jar_entry> files;
+  if (!find_central_directory(mapping, size, pce)) return false;
+  if (!validate_pce(pce, size)) return false;
+  if (!get_jar_entries(mapping, pce, files)) return false;
+  if (!process_jar_entries(location, files, mapping, classes, attr_hook,
+                           snapshot)) {
+    return false;
   }
-  free(outbuffer);
   return true;
 }
 
@@ -821,20 +988,360 @@ bool process_jar(const char* location,
                  ssize_t size,
                  Scope* classes,
                  const attribute_hook_t& attr_hook) {
+  return process_jar(location, mapping, size, classes, attr_hook,
+                     /* snapshot */ nullptr);
+}
+
+namespace {
+
+// The number of the dex at the root of a zip that `filename` names: 1 for
+// classes.dex, 2 for classes2.dex, ..., or 0.
+size_t root_dex_number(const std::string& filename) {
+  if (!boost::starts_with(filename, "classes") ||
+      !boost::ends_with(filename, ".dex")) {
+    return 0;
+  }
+  auto digits = filename.substr(strlen("classes"),
+                                filename.size() - strlen("classes.dex"));
+  if (digits.empty()) {
+    return 1;
+  }
+  if (digits[0] == '0' ||
+      !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+    return 0;
+  }
+  return std::stoul(digits);
+}
+
+} // namespace
+
+ZipDexes::ZipDexes(const std::string& location)
+    : m_file(std::make_unique<RedexMappedFile>(
+          RedexMappedFile::open(location))) {
+  auto mapping = reinterpret_cast<const uint8_t*>(m_file->const_data());
+  ssize_t size = m_file->size();
   pk_cdir_end pce;
   std::vector<jar_entry> files;
-  if (!find_central_directory(mapping, size, pce)) return false;
-  if (!validate_pce(pce, size)) return false;
-  if (!get_jar_entries(mapping, pce, files)) return false;
-  if (!process_jar_entries(location, files, mapping, classes, attr_hook)) {
+  if (!find_central_directory(mapping, size, pce) ||
+      !validate_pce(pce, size) || !get_jar_entries(mapping, pce, files)) {
+    fprintf(stderr, "error: cannot read zip file: %s\n", location.c_str());
+    exit(EXIT_FAILURE);
+  }
+
+  std::vector<std::pair<size_t, const jar_entry*>> dex_files;
+  for (const auto& file : files) {
+    auto number = root_dex_number((const char*)file.filename);
+    if (number != 0) {
+      dex_files.emplace_back(number, &file);
+    }
+  }
+  std::sort(dex_files.begin(), dex_files.end());
+
+  m_dexes.resize(dex_files.size());
+  m_buffers.resize(dex_files.size());
+  std::vector<size_t> indices(dex_files.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  // Stored entries are used in place, unless they are misaligned. The others
+  // are inflated concurrently.
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        const auto& file = *dex_files[i].second;
+        const auto& cd_entry = file.cd_entry;
+        auto filename = (const char*)file.filename;
+        const uint8_t* data = get_local_file_data(file, mapping);
+        always_assert_log(data != nullptr, "Invalid dex entry %s in %s",
+                          filename, location.c_str());
+        auto& dex = m_dexes[i];
+        dex.location = location + "/" + filename;
+        dex.size = cd_entry.ucomp_size;
+        if (cd_entry.comp_method == kCompMethodDeflate) {
+          m_buffers[i] = std::make_unique<uint8_t[]>(cd_entry.ucomp_size);
+          uLongf dlen = cd_entry.ucomp_size;
+          int zlibrv = jar_uncompress(m_buffers[i].get(), &dlen, data,
+                                      cd_entry.comp_size);
+          always_assert_log(zlibrv == Z_OK && dlen == cd_entry.ucomp_size,
+                            "Failed to inflate %s in %s", filename,
+                            location.c_str());
+          data = m_buffers[i].get();
+        } else {
+          always_assert_log(cd_entry.comp_method == 0 &&
+                                cd_entry.comp_size == cd_entry.ucomp_size,
+                            "Unknown compression method %d for %s in %s",
+                            cd_entry.comp_method, filename,
+                            location.c_str());
+          if (reinterpret_cast<uintptr_t>(data) % alignof(dex_header) != 0) {
+            m_buffers[i] = std::make_unique<uint8_t[]>(cd_entry.ucomp_size);
+            memcpy(m_buffers[i].get(), data, cd_entry.ucomp_size);
+            data = m_buffers[i].get();
+          }
+        }
+        always_assert_log(dex.size >= sizeof(dex_header),
+                          "Truncated dex %s in %s", filename,
+                          location.c_str());
+        dex.dh = reinterpret_cast<const dex_header*>(data);
+      },
+      indices);
+}
+
+ZipDexes::~ZipDexes() {}
+
+/******************
+ * Begin Jar snapshot code.
+ *
+ * A snapshot holds the decoded classes of a jar, so that loading it again
+ * skips inflating and parsing the class files. It is named after the SHA1 of
+ * the jar, and consists of native-endian uint32_t words:
+ *
+ *   magic, version, the 5 words of the SHA1 digest,
+ *   string count, then per string: its length, followed by its bytes and a
+ *     NUL terminator, padded to a multiple of 4 bytes,
+ *   class count, then per class:
+ *     access flags, name, superclass (kNoString if none),
+ *     interface count, then their names,
+ *     field count, then per field: access flags, name, descriptor,
+ *     method count, then per method: access flags, name, descriptor.
+ *
+ * Names and descriptors are indices into the strings. A snapshot is only
+ * used if it can be fully read and matches the digest of the jar, so a stale
+ * or truncated one just falls back to parsing the jar.
+ */
+
+namespace {
+
+constexpr uint32_t kSnapshotMagic = 0x4a584452; // "RDXJ"
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr uint32_t kNoString = 0xffffffff;
+constexpr size_t kDigestSize = 20;
+
+std::string snapshot_path(const std::string& snapshot_dir,
+                          const uint8_t* digest) {
+  std::ostringstream ss;
+  ss << snapshot_dir << "/";
+  for (size_t i = 0; i < kDigestSize; ++i) {
+    ss << std::hex << std::setw(2) << std::setfill('0')
+       << static_cast<unsigned>(digest[i]);
+  }
+  ss << ".jarsnapshot";
+  return ss.str();
+}
+
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const uint8_t* digest) {
+    m_header.push_back(kSnapshotMagic);
+    m_header.push_back(kSnapshotVersion);
+    uint32_t words[kDigestSize / sizeof(uint32_t)];
+    memcpy(words, digest, kDigestSize);
+    m_header.insert(m_header.end(), std::begin(words), std::end(words));
+  }
+
+  void add_class(const class_info& info) {
+    m_classes.push_back(info.aflags);
+    m_classes.push_back(string_index(info.name));
+    m_classes.push_back(info.super.empty() ? kNoString
+                                           : string_index(info.super));
+    m_classes.push_back(info.interfaces.size());
+    for (const auto& iface : info.interfaces) {
+      m_classes.push_back(string_index(iface));
+    }
+    for (const auto* members : {&info.fields, &info.methods}) {
+      m_classes.push_back(members->size());
+      for (const auto& member : *members) {
+        m_classes.push_back(member.aflags);
+        m_classes.push_back(string_index(member.name));
+        m_classes.push_back(string_index(member.desc));
+      }
+    }
+    ++m_class_count;
+  }
+
+  bool write(const std::string& path) const {
+    // Write to a temporary file first, so that concurrent builds never see a
+    // partial snapshot.
+    auto tmp_path =
+        boost::filesystem::unique_path(path + ".%%%%%%%%.tmp").string();
+    {
+      std::ofstream out(tmp_path, std::ios::binary);
+      if (!out) {
+        return false;
+      }
+      write_words(out, m_header);
+      write_word(out, m_strings.size());
+      for (const auto* str : m_strings) {
+        write_word(out, str->size());
+        out.write(str->c_str(), str->size() + 1);
+        static const char padding[sizeof(uint32_t)] = {};
+        out.write(padding, (sizeof(uint32_t) - (str->size() + 1) % 4) % 4);
+      }
+      write_word(out, m_class_count);
+      write_words(out, m_classes);
+      if (!out) {
+        return false;
+      }
+    }
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp_path, path, ec);
+    return !ec;
+  }
+
+ private:
+  uint32_t string_index(const std::string& str) {
+    auto it = m_string_indices.find(str);
+    if (it == m_string_indices.end()) {
+      it = m_string_indices.emplace(str, m_strings.size()).first;
+      m_strings.push_back(&it->first);
+    }
+    return it->second;
+  }
+
+  static void write_word(std::ofstream& out, uint32_t word) {
+    out.write(reinterpret_cast<const char*>(&word), sizeof(word));
+  }
+
+  static void write_words(std::ofstream& out,
+                          const std::vector<uint32_t>& words) {
+    out.write(reinterpret_cast<const char*>(words.data()),
+              words.size() * sizeof(uint32_t));
+  }
+
+  std::vector<uint32_t> m_header;
+  std::unordered_map<std::string, uint32_t> m_string_indices;
+  std::vector<const std::string*> m_strings;
+  uint32_t m_class_count{0};
+  std::vector<uint32_t> m_classes;
+};
+
+class SnapshotReader {
+ public:
+  SnapshotReader(const uint8_t* data, size_t size)
+      : m_cur(data), m_end(data + size) {}
+
+  bool read(const uint8_t* digest, std::vector<class_info>* classes) {
+    uint32_t magic, version;
+    if (!read_word(&magic) || magic != kSnapshotMagic ||
+        !read_word(&version) || version != kSnapshotVersion ||
+        !has(kDigestSize) || memcmp(m_cur, digest, kDigestSize) != 0) {
+      return false;
+    }
+    m_cur += kDigestSize;
+    uint32_t string_count;
+    if (!read_word(&string_count)) {
+      return false;
+    }
+    m_strings.reserve(string_count);
+    for (uint32_t i = 0; i < string_count; ++i) {
+      uint32_t length;
+      if (!read_word(&length) || !has(length + 1) || m_cur[length] != '\0') {
+        return false;
+      }
+      m_strings.emplace_back(reinterpret_cast<const char*>(m_cur), length);
+      auto padded = length + 1 + (sizeof(uint32_t) - (length + 1) % 4) % 4;
+      if (!has(padded)) {
+        return false;
+      }
+      m_cur += padded;
+    }
+    uint32_t class_count;
+    if (!read_word(&class_count)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < class_count; ++i) {
+      class_info info;
+      uint32_t aflags, super, interface_count;
+      if (!read_word(&aflags) || !read_string(&info.name) ||
+          !read_word(&super) || !read_word(&interface_count)) {
+        return false;
+      }
+      info.aflags = aflags;
+      if (super != kNoString) {
+        if (super >= m_strings.size()) {
+          return false;
+        }
+        info.super = m_strings[super].to_string();
+      }
+      for (uint32_t j = 0; j < interface_count; ++j) {
+        info.interfaces.emplace_back();
+        if (!read_string(&info.interfaces.back())) {
+          return false;
+        }
+      }
+      if (!read_members(&info.fields) || !read_members(&info.methods)) {
+        return false;
+      }
+      classes->push_back(std::move(info));
+    }
+    return m_cur == m_end;
+  }
+
+ private:
+  bool has(size_t size) const {
+    return static_cast<size_t>(m_end - m_cur) >= size;
+  }
+
+  bool read_word(uint32_t* word) {
+    if (!has(sizeof(uint32_t))) {
+      return false;
+    }
+    memcpy(word, m_cur, sizeof(uint32_t));
+    m_cur += sizeof(uint32_t);
+    return true;
+  }
+
+  bool read_string(std::string* str) {
+    uint32_t index;
+    if (!read_word(&index) || index >= m_strings.size()) {
+      return false;
+    }
+    *str = m_strings[index].to_string();
+    return true;
+  }
+
+  bool read_members(std::vector<member_info>* members) {
+    uint32_t count;
+    if (!read_word(&count)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      member_info member;
+      uint32_t aflags;
+      if (!read_word(&aflags) || !read_string(&member.name) ||
+          !read_string(&member.desc)) {
+        return false;
+      }
+      member.aflags = aflags;
+      members->push_back(std::move(member));
+    }
+    return true;
+  }
+
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+  std::vector<boost::string_view> m_strings;
+};
+
+bool read_snapshot(const std::string& path,
+                   const uint8_t* digest,
+                   std::vector<class_info>* classes) {
+  if (!boost::filesystem::exists(path)) {
     return false;
   }
-  return true;
+  boost::iostreams::mapped_file file;
+  try {
+    file.open(path, boost::iostreams::mapped_file::readonly);
+  } catch (const std::exception& e) {
+    return false;
+  }
+  SnapshotReader reader(reinterpret_cast<const uint8_t*>(file.const_data()),
+                        file.size());
+  return reader.read(digest, classes);
 }
 
+} // namespace
+
 bool load_jar_file(const char* location,
                    Scope* classes,
-                   const attribute_hook_t& attr_hook) {
+                   const attribute_hook_t& attr_hook,
+                   const std::string& snapshot_dir) {
   boost::iostreams::mapped_file file;
   try {
     file.open(location, boost::iostreams::mapped_file::readonly);
@@ -844,10 +1351,49 @@ bool load_jar_file(const char* location,
   }
 
   auto mapping = reinterpret_cast<const uint8_t*>(file.const_data());
-  if (!process_jar(location, mapping, file.size(), classes, attr_hook)) {
+  // The attribute hook needs the class files, which snapshots don't keep.
+  if (snapshot_dir.empty() || attr_hook != nullptr) {
+    if (!process_jar(location, mapping, file.size(), classes, attr_hook)) {
+      fprintf(stderr, "error: cannot process jar: %s\n", location);
+      return false;
+    }
+    return true;
+  }
+
+  uint8_t digest[kDigestSize];
+  Sha1Context context;
+  sha1_init(&context);
+  sha1_update(&context, mapping, file.size());
+  sha1_final(digest, &context);
+  auto path = snapshot_path(snapshot_dir, digest);
+
+  std::vector<class_info> snapshot;
+  if (read_snapshot(path, digest, &snapshot)) {
+    TRACE(MAIN, 2, "Loading %s from snapshot %s", location, path.c_str());
+    init_basic_types();
+    for (const auto& info : snapshot) {
+      if (!make_class(info, classes, /* member_hook */ nullptr, location)) {
+        fprintf(stderr, "error: cannot process jar snapshot: %s\n",
+                path.c_str());
+        return false;
+      }
+    }
+    return true;
+  }
+
+  snapshot.clear();
+  if (!process_jar(location, mapping, file.size(), classes, attr_hook,
+                   &snapshot)) {
     fprintf(stderr, "error: cannot process jar: %s\n", location);
     return false;
   }
+  SnapshotWriter writer(digest);
+  for (const auto& info : snapshot) {
+    writer.add_class(info);
+  }
+  if (!writer.write(path)) {
+    TRACE(MAIN, 1, "Warning: could not write jar snapshot %s", path.c_str());
+  }
   return true;
 }
 
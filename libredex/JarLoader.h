@@ -13,8 +13,14 @@ class DexMethod;
 #include "boost/variant.hpp"
 
 #include "ConfigFiles.h"
+#include "DexLoader.h"
 
 #include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct RedexMappedFile;
 
 namespace JarLoaderUtil {
 uint32_t read32(uint8_t*& buffer);
@@ -26,9 +32,16 @@ using attribute_hook_t =
                        const char* attribute_name,
                        uint8_t* attribute_pointer)>;
 
+/*
+ * If :snapshot_dir is not empty, the classes of the jar are loaded from a
+ * snapshot in that directory when there is one for a jar with the same
+ * contents, and a snapshot is saved there otherwise. Snapshots are not used
+ * when an attribute hook is given.
+ */
 bool load_jar_file(const char* location,
                    Scope* classes = nullptr,
-                   const attribute_hook_t& = nullptr);
+                   const attribute_hook_t& = nullptr,
+                   const std::string& snapshot_dir = "");
 
 bool load_class_file(const std::string& filename, Scope* classes = nullptr);
 
@@ -39,6 +52,25 @@ bool process_jar(const char* location,
                  Scope* classes,
                  const attribute_hook_t& attr_hook);
 
+/*
+ * The dexes at the root of a zip file such as an APK, classes.dex,
+ * classes2.dex, ..., in this order, read without extracting them. Stored
+ * entries are used in place in the mapping of the zip file, and deflated ones
+ * are inflated into memory owned by this object.
+ */
+class ZipDexes {
+ public:
+  explicit ZipDexes(const std::string& location);
+  ~ZipDexes();
+
+  const std::vector<DexBuffer>& get_dexes() const { return m_dexes; }
+
+ private:
+  std::unique_ptr<RedexMappedFile> m_file;
+  std::vector<std::unique_ptr<uint8_t[]>> m_buffers;
+  std::vector<DexBuffer> m_dexes;
+};
+
 bool parse_class(uint8_t* buffer,
                  Scope* classes,
                  attribute_hook_t attr_hook,
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <boost/functional/hash.hpp>
+#include <cstddef>
+#include <iterator>
 #include <ostream>
 #include <unordered_set>
 
@@ -81,4 +83,66 @@ struct ReasonPtrEqual {
 using ReasonPtrSet =
     std::unordered_set<const Reason*, ReasonPtrHash, ReasonPtrEqual>;
 
+/*
+ * A node of the list of keep reasons of a class or member. Nodes are only
+ * ever prepended to a list, and live as long as the RedexContext, so a list
+ * can be read while reasons are being added to it.
+ */
+struct ReasonNode {
+  const Reason* reason;
+  const ReasonNode* next;
+};
+
+/*
+ * A read-only view of a list of distinct, interned keep reasons.
+ */
+class ReasonList {
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = const Reason*;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    explicit iterator(const ReasonNode* node) : m_node(node) {}
+
+    reference operator*() const { return m_node->reason; }
+
+    iterator& operator++() {
+      m_node = m_node->next;
+      return *this;
+    }
+
+    bool operator==(const iterator& that) const {
+      return m_node == that.m_node;
+    }
+
+    bool operator!=(const iterator& that) const { return !(*this == that); }
+
+   private:
+    const ReasonNode* m_node;
+  };
+
+  explicit ReasonList(const ReasonNode* head) : m_head(head) {}
+
+  iterator begin() const { return iterator(m_head); }
+  iterator end() const { return iterator(nullptr); }
+  bool empty() const { return m_head == nullptr; }
+
+  // Reasons are interned, so they can be compared by address.
+  bool contains(const Reason* reason) const {
+    for (auto* node = m_head; node != nullptr; node = node->next) {
+      if (node->reason == reason) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  const ReasonNode* m_head;
+};
+
 } // namespace keep_reason
@@ -174,6 +174,19 @@ struct InconsistentDFGNodesAnalysis
 
 InstructionMatcher::~InstructionMatcher() = default;
 
+bool MatchCache::matches(LocationIx loc, const IRInstruction* insn) const {
+  auto& matches = m_matches[insn];
+  if (matches.empty()) {
+    matches.resize(m_constraints.size(), Match::unknown);
+  }
+  auto& match = matches[loc];
+  if (match == Match::unknown) {
+    match = m_constraints.at(loc).insn_matcher->matches(insn) ? Match::yes
+                                                              : Match::no;
+  }
+  return match == Match::yes;
+}
+
 const Constraint::Src& Constraint::src(src_index_t ix) const {
   if (ix < m_srcs.size()) {
     if (auto& src = m_srcs[ix]; src.loc != NO_LOC) {
@@ -209,10 +222,10 @@ void InstructionConstraintAnalysis::analyze_instruction(
   // Propagate data-flow constraints if the instruction constraint at loc
   // matches for the instruction being analyzed.
   const auto propagate = [this, insn, env, add_obligation](LocationIx loc) {
-    const auto& constraint = m_constraints.at(loc);
-    if (!constraint.insn_matcher->matches(insn)) {
+    if (!m_match_cache.matches(loc, insn)) {
       return;
     }
+    const auto& constraint = m_constraints.at(loc);
 
     for (size_t ix = 0; ix < insn->srcs_size(); ++ix) {
       if (constraint.src(ix).loc == NO_LOC) {
@@ -458,17 +471,38 @@ void DataFlowGraph::propagate_flow_constraints(
 DataFlowGraph instruction_graph(cfg::ControlFlowGraph& cfg,
                                 const std::vector<Constraint>& constraints,
                                 const std::unordered_set<LocationIx>& roots) {
+  DataFlowGraph graph;
+  MatchCache match_cache(constraints);
+
+  // Only instructions flowing into an instruction matching a root can be in
+  // the graph, so without any such instruction there is nothing to analyze.
+  bool any_root_matches = false;
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    for (auto root : roots) {
+      if (match_cache.matches(root, mie.insn)) {
+        any_root_matches = true;
+        break;
+      }
+    }
+    if (any_root_matches) {
+      break;
+    }
+  }
+  if (!any_root_matches) {
+    TRACE(MFLOW, 6, "instruction_graph: No instruction matches a root");
+    graph.calculate_entrypoints();
+    return graph;
+  }
+
   if (!cfg.exit_block()) {
     // The instruction constraint analysis runs backwards and so requires a
     // single exit block to start from.
     cfg.calculate_exit_block();
   }
 
-  InstructionConstraintAnalysis analysis{cfg, constraints, roots};
+  InstructionConstraintAnalysis analysis{cfg, constraints, match_cache, roots};
   analysis.run({});
 
-  DataFlowGraph graph;
-
   // Check whether (loc, insn) should be in the graph, and adds it if necessary.
   // Returns a boolean indicating whether the node was added or not.
   const auto test_node = [&](LocationIx loc, IRInstruction* insn) {
@@ -476,8 +510,7 @@ DataFlowGraph instruction_graph(cfg::ControlFlowGraph& cfg,
       return false;
     }
 
-    auto& constraint = constraints.at(loc);
-    if (constraint.insn_matcher->matches(insn)) {
+    if (match_cache.matches(loc, insn)) {
       TRACE(MFLOW, 6, "instruction_graph: L%zu matching %s", loc, SHOW(insn));
       graph.add_node(loc, insn);
       return true;
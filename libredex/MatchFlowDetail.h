@@ -143,6 +143,26 @@ struct Constraint {
   std::map<src_index_t, Src> m_src_ranges;
 };
 
+/**
+ * Memoizes whether instructions match the instruction constraints: the
+ * constraint analysis tests the same instructions against the same
+ * constraints at every iteration, and the graph construction tests them again.
+ */
+class MatchCache {
+ public:
+  explicit MatchCache(const std::vector<Constraint>& constraints)
+      : m_constraints(constraints) {}
+
+  bool matches(LocationIx loc, const IRInstruction* insn) const;
+
+ private:
+  enum class Match : uint8_t { unknown, no, yes };
+
+  const std::vector<Constraint>& m_constraints;
+  mutable std::unordered_map<const IRInstruction*, std::vector<Match>>
+      m_matches;
+};
+
 // Types for InstructionConstraintAnalysis' (ICA) Abstract State.
 using Obligation = std::tuple<LocationIx, IRInstruction*, src_index_t>;
 using ICADomain =
@@ -159,14 +179,19 @@ struct InstructionConstraintAnalysis
 
   InstructionConstraintAnalysis(const cfg::ControlFlowGraph& cfg,
                                 const std::vector<Constraint>& constraints,
+                                const MatchCache& match_cache,
                                 const std::unordered_set<LocationIx>& roots)
-      : Base(cfg), m_constraints(constraints), m_roots(roots) {}
+      : Base(cfg),
+        m_constraints(constraints),
+        m_match_cache(match_cache),
+        m_roots(roots) {}
 
   void analyze_instruction(IRInstruction* insn,
                            ICAPartition* env) const override;
 
  private:
   const std::vector<Constraint>& m_constraints;
+  const MatchCache& m_match_cache;
   const std::unordered_set<LocationIx>& m_roots;
 };
 
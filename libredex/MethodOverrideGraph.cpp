@@ -250,6 +250,27 @@ void Graph::add_edge(const DexMethod* overridden, const DexMethod* overriding) {
                  });
 }
 
+void Graph::remove_method(const DexMethod* method) {
+  auto it = m_nodes.find(method);
+  if (it == m_nodes.end()) {
+    return;
+  }
+  auto node = std::move(it->second);
+  m_nodes.erase(method);
+  for (const auto* parent : node.parents) {
+    m_nodes.update(parent, [&](const DexMethod*, Node& parent_node, bool) {
+      parent_node.children.erase(method);
+      parent_node.children.insert(node.children.begin(), node.children.end());
+    });
+  }
+  for (const auto* child : node.children) {
+    m_nodes.update(child, [&](const DexMethod*, Node& child_node, bool) {
+      child_node.parents.erase(method);
+      child_node.parents.insert(node.parents.begin(), node.parents.end());
+    });
+  }
+}
+
 void Graph::dump(std::ostream& os) const {
   namespace bs = binary_serialization;
   bs::write_header(os, /* version */ 1);
@@ -273,6 +294,11 @@ std::unique_ptr<const Graph> build_graph(const Scope& scope) {
   return GraphBuilder(scope).run();
 }
 
+std::unique_ptr<Graph> build_mutable_graph(const Scope& scope) {
+  Timer t("Building method override graph");
+  return GraphBuilder(scope).run();
+}
+
 std::vector<const DexMethod*> get_overriding_methods(const Graph& graph,
                                                      const DexMethod* method,
                                                      bool include_interfaces) {
@@ -25,6 +25,12 @@ class Graph;
  */
 std::unique_ptr<const Graph> build_graph(const Scope&);
 
+/*
+ * Same as build_graph, for the users that keep the graph up to date as
+ * methods get deleted (see Graph::remove_method).
+ */
+std::unique_ptr<Graph> build_mutable_graph(const Scope&);
+
 /*
  * Returns all the methods that override :method. The set does *not* include
  * :method itself.
@@ -76,6 +82,13 @@ class Graph {
 
   void add_edge(const DexMethod* overridden, const DexMethod* overriding);
 
+  /*
+   * Updates the graph for the deletion of :method. The methods it overrides
+   * become overridden by the methods that override it, so that the queries
+   * above keep their answers for all the other methods.
+   */
+  void remove_method(const DexMethod* method);
+
   void dump(std::ostream&) const;
 
  private:
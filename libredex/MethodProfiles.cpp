@@ -8,12 +8,17 @@
 #include "MethodProfiles.h"
 
 #include <boost/algorithm/string.hpp>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <numeric>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unordered_map>
 
+#include "RedexMappedFile.h"
 #include "Show.h"
+#include "WorkQueue.h"
 
 using namespace method_profiles;
 
@@ -38,6 +43,62 @@ bool parse_cells(std::string& line, const Func& parse_cell) {
   return true;
 }
 
+/*
+ * The binary profile format. All integers are little-endian, and all offsets
+ * into the string table point at NUL-terminated strings:
+ *
+ *   BinaryHeader
+ *   BinaryInteraction[num_interactions]
+ *   BinaryRecord[num_records]
+ *   char strings[strings_size]
+ */
+constexpr char kBinaryMagic[8] = {'R', 'D', 'X', 'P', 'R', 'O', 'F', '\0'};
+constexpr uint32_t kBinaryVersion = 1;
+
+struct BinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_interactions;
+  uint32_t num_records;
+  uint32_t strings_size;
+};
+
+struct BinaryInteraction {
+  uint32_t id_offset;
+  // Whether the profile had an interaction count for this interaction.
+  uint32_t has_count;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct BinaryRecord {
+  double appear_percent;
+  double call_count;
+  double order_percent;
+  uint32_t name_offset;
+  uint32_t interaction;
+  int16_t min_api_level;
+  uint16_t reserved0;
+  uint32_t reserved1;
+};
+
+static_assert(sizeof(BinaryHeader) == 24, "unexpected padding");
+static_assert(sizeof(BinaryInteraction) == 16, "unexpected padding");
+static_assert(sizeof(BinaryRecord) == 40, "unexpected padding");
+
+bool is_binary_profile(const char* data, size_t size) {
+  return size >= sizeof(BinaryHeader) &&
+         memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
+
+// Reads a T at `offset`, which need not be aligned.
+template <typename T>
+T read_at(const char* data, size_t offset) {
+  T t;
+  memcpy(&t, data + offset, sizeof(T));
+  return t;
+}
+
 } // namespace
 
 const StatsMap& MethodProfiles::method_stats(
@@ -67,6 +128,189 @@ bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
     return false;
   }
 
+  if (!read_profile_rows(csv_filename)) {
+    return false;
+  }
+  resolve_rows(std::move(m_parsed_rows));
+  m_parsed_rows.clear();
+
+  TRACE(METH_PROF, 1,
+        "MethodProfiles successfully parsed %zu rows; %zu unresolved lines",
+        size(), unresolved_size());
+  return true;
+}
+
+bool MethodProfiles::read_profile_rows(const std::string& filename) {
+  bool binary = false;
+  {
+    std::ifstream ifs(filename, std::ifstream::binary);
+    char magic[sizeof(kBinaryMagic)] = {};
+    binary = ifs.read(magic, sizeof(magic)) &&
+             is_binary_profile(magic, sizeof(BinaryHeader));
+  }
+  if (!binary) {
+    return read_csv_rows(filename);
+  }
+  auto mapped = RedexMappedFile::open(filename);
+  return read_binary_rows(mapped.const_data(), mapped.size());
+}
+
+bool MethodProfiles::read_binary_rows(const char* data, size_t size) {
+  if (!is_binary_profile(data, size)) {
+    std::cerr << "FAILED to read binary profile: bad header" << std::endl;
+    return false;
+  }
+  auto header = read_at<BinaryHeader>(data, 0);
+  if (header.version != kBinaryVersion) {
+    std::cerr << "FAILED to read binary profile: unsupported version "
+              << header.version << std::endl;
+    return false;
+  }
+  const size_t interactions_off = sizeof(BinaryHeader);
+  const size_t records_off =
+      interactions_off +
+      size_t(header.num_interactions) * sizeof(BinaryInteraction);
+  const size_t strings_off =
+      records_off + size_t(header.num_records) * sizeof(BinaryRecord);
+  if (strings_off + header.strings_size != size ||
+      (header.strings_size > 0 && data[size - 1] != '\0')) {
+    std::cerr << "FAILED to read binary profile: truncated" << std::endl;
+    return false;
+  }
+  const char* strings = data + strings_off;
+  auto get_string = [&](uint32_t offset) -> boost::optional<std::string> {
+    if (offset >= header.strings_size) {
+      return boost::none;
+    }
+    return std::string(strings + offset);
+  };
+
+  std::vector<std::string> interaction_ids;
+  interaction_ids.reserve(header.num_interactions);
+  for (uint32_t i = 0; i < header.num_interactions; ++i) {
+    auto interaction = read_at<BinaryInteraction>(
+        data, interactions_off + i * sizeof(BinaryInteraction));
+    auto id = get_string(interaction.id_offset);
+    if (!id) {
+      std::cerr << "FAILED to read binary profile: bad interaction"
+                << std::endl;
+      return false;
+    }
+    if (interaction.has_count != 0) {
+      m_interaction_counts.emplace(*id, interaction.count);
+    }
+    interaction_ids.push_back(std::move(*id));
+  }
+
+  m_parsed_rows.reserve(m_parsed_rows.size() + header.num_records);
+  for (uint32_t i = 0; i < header.num_records; ++i) {
+    auto record = read_at<BinaryRecord>(
+        data, records_off + size_t(i) * sizeof(BinaryRecord));
+    auto name = get_string(record.name_offset);
+    if (!name || record.interaction >= interaction_ids.size()) {
+      std::cerr << "FAILED to read binary profile: bad record " << i
+                << std::endl;
+      return false;
+    }
+    ProfileRow row;
+    row.interaction_id = interaction_ids[record.interaction];
+    row.method_name = std::move(*name);
+    row.stats.appear_percent = record.appear_percent;
+    row.stats.call_count = record.call_count;
+    row.stats.order_percent = record.order_percent;
+    row.stats.min_api_level = record.min_api_level;
+    m_parsed_rows.push_back(std::move(row));
+  }
+  return true;
+}
+
+bool MethodProfiles::convert_to_binary(
+    const std::vector<std::string>& filenames,
+    const std::string& binary_filename) {
+  MethodProfiles profiles;
+  for (const auto& filename : filenames) {
+    profiles.m_interaction_id = "";
+    profiles.m_mode = NONE;
+    if (!profiles.read_profile_rows(filename)) {
+      return false;
+    }
+  }
+
+  std::string strings;
+  std::unordered_map<std::string, uint32_t> string_offsets;
+  auto intern = [&](const std::string& str) {
+    auto it = string_offsets.find(str);
+    if (it != string_offsets.end()) {
+      return it->second;
+    }
+    auto offset = static_cast<uint32_t>(strings.size());
+    strings.append(str);
+    strings.push_back('\0');
+    string_offsets.emplace(str, offset);
+    return offset;
+  };
+
+  std::vector<BinaryInteraction> interactions;
+  std::unordered_map<std::string, uint32_t> interaction_indices;
+  auto get_interaction = [&](const std::string& id) {
+    auto it = interaction_indices.find(id);
+    if (it != interaction_indices.end()) {
+      return it->second;
+    }
+    BinaryInteraction interaction{};
+    interaction.id_offset = intern(id);
+    auto count = profiles.get_interaction_count(id);
+    if (count) {
+      interaction.has_count = 1;
+      interaction.count = *count;
+    }
+    auto index = static_cast<uint32_t>(interactions.size());
+    interactions.push_back(interaction);
+    interaction_indices.emplace(id, index);
+    return index;
+  };
+  // Interactions may have a count but no rows.
+  for (const auto& pair : profiles.m_interaction_counts) {
+    get_interaction(pair.first);
+  }
+
+  std::vector<BinaryRecord> records;
+  records.reserve(profiles.m_parsed_rows.size());
+  for (const auto& row : profiles.m_parsed_rows) {
+    BinaryRecord record{};
+    record.appear_percent = row.stats.appear_percent;
+    record.call_count = row.stats.call_count;
+    record.order_percent = row.stats.order_percent;
+    record.name_offset = intern(row.method_name);
+    record.interaction = get_interaction(row.interaction_id);
+    record.min_api_level = row.stats.min_api_level;
+    records.push_back(record);
+  }
+
+  BinaryHeader header{};
+  memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+  header.version = kBinaryVersion;
+  header.num_interactions = static_cast<uint32_t>(interactions.size());
+  header.num_records = static_cast<uint32_t>(records.size());
+  header.strings_size = static_cast<uint32_t>(strings.size());
+
+  std::ofstream ofs(binary_filename, std::ofstream::binary);
+  ofs.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  ofs.write(reinterpret_cast<const char*>(interactions.data()),
+            interactions.size() * sizeof(BinaryInteraction));
+  ofs.write(reinterpret_cast<const char*>(records.data()),
+            records.size() * sizeof(BinaryRecord));
+  ofs.write(strings.data(), strings.size());
+  if (!ofs.good()) {
+    std::cerr << "FAILED to write " << binary_filename << std::endl;
+    return false;
+  }
+  TRACE(METH_PROF, 1, "Wrote %zu rows of %zu interactions to %s",
+        records.size(), interactions.size(), binary_filename.c_str());
+  return true;
+}
+
+bool MethodProfiles::read_csv_rows(const std::string& csv_filename) {
   // Using C-style file reading and parsing because it's faster than the
   // iostreams equivalent and we expect to read very large csv files.
   std::ifstream ifs(csv_filename);
@@ -92,10 +336,6 @@ bool MethodProfiles::parse_stats_file(const std::string& csv_filename) {
     std::cerr << "FAILED to read a line!" << std::endl;
     return false;
   }
-
-  TRACE(METH_PROF, 1,
-        "MethodProfiles successfully parsed %zu rows; %zu unresolved lines",
-        size(), unresolved_size());
   return true;
 }
 
@@ -157,9 +397,9 @@ bool MethodProfiles::parse_metadata(std::string& line) {
 
 bool MethodProfiles::parse_main(std::string& line) {
   always_assert(m_mode == MAIN);
-  Stats stats;
-  std::string interaction_id;
-  DexMethodRef* ref = nullptr;
+  ProfileRow row;
+  auto& stats = row.stats;
+  auto& interaction_id = row.interaction_id;
   auto parse_cell = [&](char* tok, uint32_t col) -> bool {
     switch (col) {
     case INDEX:
@@ -167,10 +407,7 @@ bool MethodProfiles::parse_main(std::string& line) {
       // the file)
       return true;
     case NAME:
-      ref = DexMethod::get_method</*kCheckFormat=*/true>(tok);
-      if (ref == nullptr) {
-        TRACE(METH_PROF, 6, "failed to resolve %s", tok);
-      }
+      row.method_name = tok;
       return true;
     case APPEAR100:
       stats.appear_percent = parse_double(tok);
@@ -212,7 +449,6 @@ bool MethodProfiles::parse_main(std::string& line) {
     }
   };
 
-  std::string copy(line);
   bool success = parse_cells(line, parse_cell);
   if (!success) {
     return false;
@@ -223,18 +459,39 @@ bool MethodProfiles::parse_main(std::string& line) {
     // is the conservative approach.
     interaction_id = m_interaction_id;
   }
-  if (ref != nullptr) {
-    TRACE(METH_PROF, 6, "(%s, %s) -> {%f, %f, %f, %d}", SHOW(ref),
-          interaction_id.c_str(), stats.appear_percent, stats.call_count,
-          stats.order_percent, stats.min_api_level);
-    m_method_stats[interaction_id].emplace(ref, stats);
-  } else {
-    m_unresolved_lines[interaction_id].push_back(copy);
-    TRACE(METH_PROF, 6, "unresolved: %s", copy.c_str());
-  }
+  m_parsed_rows.push_back(std::move(row));
   return true;
 }
 
+void MethodProfiles::resolve_rows(std::vector<ProfileRow> rows) {
+  // Resolving parses each name and looks up its parts, which dominates the
+  // loading of large profiles.
+  std::vector<DexMethodRef*> refs(rows.size());
+  std::vector<size_t> indices(rows.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        refs[i] =
+            DexMethod::get_method</*kCheckFormat=*/true>(rows[i].method_name);
+      },
+      indices);
+
+  for (size_t i = 0; i < rows.size(); ++i) {
+    auto& row = rows[i];
+    auto* ref = refs[i];
+    if (ref != nullptr) {
+      TRACE(METH_PROF, 6, "(%s, %s) -> {%f, %f, %f, %d}", SHOW(ref),
+            row.interaction_id.c_str(), row.stats.appear_percent,
+            row.stats.call_count, row.stats.order_percent,
+            row.stats.min_api_level);
+      m_method_stats[row.interaction_id].emplace(ref, row.stats);
+    } else {
+      TRACE(METH_PROF, 6, "unresolved: %s", row.method_name.c_str());
+      m_unresolved_rows.push_back(std::move(row));
+    }
+  }
+}
+
 bool MethodProfiles::parse_line(std::string& line) {
   if (m_mode == MAIN) {
     return parse_main(line);
@@ -256,15 +513,9 @@ boost::optional<uint32_t> MethodProfiles::get_interaction_count(
 }
 
 void MethodProfiles::process_unresolved_lines() {
-  auto unresolved_lines = std::move(m_unresolved_lines);
-  m_unresolved_lines.clear();
-  for (auto& pair : unresolved_lines) {
-    m_interaction_id = pair.first;
-    for (auto& line : pair.second) {
-      bool success = parse_main(line);
-      always_assert(success);
-    }
-  }
+  auto unresolved_rows = std::move(m_unresolved_rows);
+  m_unresolved_rows.clear();
+  resolve_rows(std::move(unresolved_rows));
 
   size_t total_rows = 0;
   for (const auto& pair : m_method_stats) {
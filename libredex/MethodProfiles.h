@@ -55,6 +55,13 @@ using StatsMap = std::unordered_map<const DexMethodRef*, Stats>;
 using AllInteractions = std::map<std::string, StatsMap>;
 const std::string COLD_START = "ColdStart";
 
+// A row of a profile, before its method is resolved.
+struct ProfileRow {
+  std::string interaction_id;
+  std::string method_name;
+  Stats stats;
+};
+
 class MethodProfiles {
  public:
   MethodProfiles() {}
@@ -98,13 +105,7 @@ class MethodProfiles {
     return sum;
   }
 
-  size_t unresolved_size() const {
-    size_t result = 0;
-    for (const auto& pair : m_unresolved_lines) {
-      result += pair.second.size();
-    }
-    return result;
-  }
+  size_t unresolved_size() const { return m_unresolved_rows.size(); }
 
   // Get the method profiles for some interaction id.
   // If no interactions are found by that interaction id, Return an empty map.
@@ -128,12 +129,22 @@ class MethodProfiles {
   // Try to resolve previously unresolved lines
   void process_unresolved_lines();
 
+  // Writes the rows and interaction counts of the given profiles, which may
+  // be csv or binary files, into one binary profile. Binary profiles are
+  // read by initialize() like csv files, but need no parsing: they hold
+  // fixed-width records that refer to a table of strings. Methods are not
+  // resolved, so this needs no loaded dex files.
+  static bool convert_to_binary(const std::vector<std::string>& filenames,
+                                const std::string& binary_filename);
+
  private:
   AllInteractions m_method_stats;
   // Resolution may fail because of renaming or generated methods. Store the
-  // unresolved lines here (per interaction) so we can update after passes run
-  // and change the names of methods
-  std::unordered_map<std::string, std::vector<std::string>> m_unresolved_lines;
+  // unresolved rows here so we can update after passes run and change the
+  // names of methods
+  std::vector<ProfileRow> m_unresolved_rows;
+  // The rows of the file being read, resolved once it is done.
+  std::vector<ProfileRow> m_parsed_rows;
   ParsingMode m_mode{NONE};
   // A map from interaction ID to the number of times that interaction was
   // triggered. This can be used to compare relative prevalence of different
@@ -145,10 +156,19 @@ class MethodProfiles {
   std::string m_interaction_id;
   bool m_initialized{false};
 
-  // Read a "simple" csv file (no quoted commas or extra spaces) and populate
-  // m_method_stats
+  // Read a "simple" csv file (no quoted commas or extra spaces), or a binary
+  // profile, and populate m_method_stats
   bool parse_stats_file(const std::string& csv_filename);
 
+  // Read the rows of a profile into m_parsed_rows
+  bool read_profile_rows(const std::string& filename);
+  bool read_csv_rows(const std::string& csv_filename);
+  bool read_binary_rows(const char* data, size_t size);
+
+  // Resolve the methods of the rows, in parallel, and add them to
+  // m_method_stats or m_unresolved_rows, in order
+  void resolve_rows(std::vector<ProfileRow> rows);
+
   // Read a line of data (not a header)
   bool parse_line(std::string& line);
   // Read a line from the main section of the aggregated stats file and put an
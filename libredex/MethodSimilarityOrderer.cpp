@@ -7,10 +7,24 @@
 
 #include "MethodSimilarityOrderer.h"
 
+#include <algorithm>
+#include <limits>
+
 #include "DexInstruction.h"
 #include "Show.h"
 #include "Trace.h"
 
+namespace {
+
+// splitmix64 finalizer, to derive independent hash functions from seeds.
+uint64_t mix(uint64_t x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+  return x ^ (x >> 31);
+}
+
+} // namespace
+
 void MethodSimilarityOrderer::gather_code_hash_ids(
     const DexCode* code, std::unordered_set<CodeHashId>& code_hash_ids) {
   auto& instructions = code->get_instructions();
@@ -93,11 +107,127 @@ void MethodSimilarityOrderer::insert(DexMethod* method) {
     gather_code_hash_ids(code, code_hash_ids);
   }
 
+  if (m_use_minhash) {
+    for (auto code_hash_id : code_hash_ids) {
+      m_code_hash_id_counts[code_hash_id]++;
+    }
+    if (!code_hash_ids.empty()) {
+      auto buckets = get_minhash_buckets(code_hash_ids);
+      for (size_t band = 0; band < MINHASH_BANDS; band++) {
+        m_bucket_method_indices[band][buckets[band]].insert(index);
+      }
+      m_method_buckets.emplace(method, buckets);
+    }
+    return;
+  }
+
   for (auto code_hash_id : code_hash_ids) {
     m_code_hash_id_methods[code_hash_id].insert(method);
   }
 }
 
+MethodSimilarityOrderer::MinHashBuckets
+MethodSimilarityOrderer::get_minhash_buckets(
+    const std::unordered_set<CodeHashId>& code_hash_ids) {
+  std::array<uint64_t, MINHASH_BANDS * MINHASH_ROWS> signature;
+  signature.fill(std::numeric_limits<uint64_t>::max());
+  for (auto code_hash_id : code_hash_ids) {
+    for (size_t i = 0; i < signature.size(); i++) {
+      signature[i] = std::min(signature[i], mix(code_hash_id * 31 + i));
+    }
+  }
+  MinHashBuckets buckets;
+  for (size_t band = 0; band < MINHASH_BANDS; band++) {
+    uint64_t bucket{band};
+    for (size_t row = 0; row < MINHASH_ROWS; row++) {
+      bucket = mix(bucket ^ signature[band * MINHASH_ROWS + row]);
+    }
+    buckets[band] = bucket;
+  }
+  return buckets;
+}
+
+std::unordered_map<DexMethod*, size_t>
+MethodSimilarityOrderer::get_candidates() {
+  std::unordered_map<DexMethod*, size_t> candidates;
+  if (!m_use_minhash) {
+    for (auto code_hash_id : m_last_code_hash_ids) {
+      for (auto method : m_code_hash_id_methods.at(code_hash_id)) {
+        candidates[method]++;
+      }
+    }
+    return candidates;
+  }
+  if (!m_last_buckets) {
+    return candidates;
+  }
+  for (size_t band = 0; band < MINHASH_BANDS; band++) {
+    auto it = m_bucket_method_indices[band].find((*m_last_buckets)[band]);
+    if (it == m_bucket_method_indices[band].end()) {
+      continue;
+    }
+    // The earliest methods of each bucket, which are the preferred ones when
+    // scores are tied.
+    size_t considered{0};
+    for (auto index : it->second) {
+      if (considered++ == MAX_BUCKET_CANDIDATES) {
+        break;
+      }
+      candidates.emplace(m_methods.at(index), 0);
+    }
+  }
+  for (auto& p : candidates) {
+    for (auto code_hash_id : m_method_code_hash_ids.at(p.first)) {
+      p.second += m_last_code_hash_ids.count(code_hash_id);
+    }
+  }
+  return candidates;
+}
+
+void MethodSimilarityOrderer::remove(DexMethod* method) {
+  if (!m_use_minhash) {
+    for (auto it = m_last_code_hash_ids.begin();
+         it != m_last_code_hash_ids.end();) {
+      auto code_hash_id = *it;
+      auto& methods = m_code_hash_id_methods.at(code_hash_id);
+      methods.erase(method);
+      if (methods.empty()) {
+        m_code_hash_id_methods.erase(code_hash_id);
+        it = m_last_code_hash_ids.erase(it);
+      } else {
+        it++;
+      }
+    }
+    return;
+  }
+  for (auto it = m_last_code_hash_ids.begin();
+       it != m_last_code_hash_ids.end();) {
+    auto count_it = m_code_hash_id_counts.find(*it);
+    if (--count_it->second == 0) {
+      m_code_hash_id_counts.erase(count_it);
+      it = m_last_code_hash_ids.erase(it);
+    } else {
+      it++;
+    }
+  }
+  m_last_buckets = boost::none;
+  auto buckets_it = m_method_buckets.find(method);
+  if (buckets_it == m_method_buckets.end()) {
+    return;
+  }
+  auto index = m_method_indices.at(method);
+  for (size_t band = 0; band < MINHASH_BANDS; band++) {
+    auto& bucket_method_indices = m_bucket_method_indices[band];
+    auto it = bucket_method_indices.find(buckets_it->second[band]);
+    it->second.erase(index);
+    if (it->second.empty()) {
+      bucket_method_indices.erase(it);
+    }
+  }
+  m_last_buckets = buckets_it->second;
+  m_method_buckets.erase(buckets_it);
+}
+
 DexMethod* MethodSimilarityOrderer::get_next() {
   if (m_methods.empty()) {
     return nullptr;
@@ -123,10 +253,8 @@ DexMethod* MethodSimilarityOrderer::get_next() {
     std::unordered_map<DexMethod*, Score> candidate_scores;
     // To compute the score, we add up how many matching code-hash-ids we
     // have...
-    for (auto code_hash_id : m_last_code_hash_ids) {
-      for (auto method : m_code_hash_id_methods.at(code_hash_id)) {
-        candidate_scores[method].shared++;
-      }
+    for (auto& p : get_candidates()) {
+      candidate_scores[p.first].shared = p.second;
     }
     // minus penalty points for every non-matching code-hash-id
     for (auto& p : candidate_scores) {
@@ -174,17 +302,6 @@ DexMethod* MethodSimilarityOrderer::get_next() {
       std::move(m_method_code_hash_ids.at(best_candidate_method));
   m_methods.erase(*best_candidate_index);
   m_method_code_hash_ids.erase(best_candidate_method);
-  for (auto it = m_last_code_hash_ids.begin();
-       it != m_last_code_hash_ids.end();) {
-    auto code_hash_id = *it;
-    auto& methods = m_code_hash_id_methods.at(code_hash_id);
-    methods.erase(best_candidate_method);
-    if (methods.empty()) {
-      m_code_hash_id_methods.erase(code_hash_id);
-      it = m_last_code_hash_ids.erase(it);
-    } else {
-      it++;
-    }
-  }
+  remove(best_candidate_method);
   return best_candidate_method;
 }
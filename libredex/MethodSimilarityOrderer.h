@@ -7,9 +7,14 @@
 
 #pragma once
 
+#include <array>
+#include <map>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
+#include <boost/optional.hpp>
+
 #include "DexClass.h"
 
 /**
@@ -24,6 +29,13 @@
  * highly similar methods. For example, methods with a small body like "return
  * true;" would all get co-located right after the first such method, resulting
  * in better compression.
+ *
+ * Finding the most similar method exactly takes time linear in the number of
+ * remaining methods for each pick, which adds up on large dexes. With
+ * `use_minhash`, only the methods that share a locality-sensitive hash bucket
+ * with the previously chosen method are considered; the buckets are derived
+ * from MinHash signatures, so that methods whose sets of instruction
+ * sequences are similar (in terms of Jaccard similarity) tend to share one.
  */
 class MethodSimilarityOrderer {
   // Hash id for a sequence (chunk) of instructions
@@ -50,15 +62,49 @@ class MethodSimilarityOrderer {
   // Mapping from hashed code sequences to their respective hash ids
   std::unordered_map<uint64_t, CodeHashId> m_code_hash_ids;
 
+  // MinHash signatures are split into bands of rows, and each band is hashed
+  // into a bucket.
+  static constexpr size_t MINHASH_BANDS = 8;
+  static constexpr size_t MINHASH_ROWS = 4;
+  // How many methods of each bucket are considered, to bound the time spent
+  // on huge buckets, i.e. of very common code.
+  static constexpr size_t MAX_BUCKET_CANDIDATES = 32;
+
+  bool m_use_minhash;
+
+  using MinHashBuckets = std::array<uint64_t, MINHASH_BANDS>;
+
+  // With minhash, replaces m_code_hash_id_methods: the number of remaining
+  // methods containing a sequence of instructions with that hash id
+  std::unordered_map<CodeHashId, size_t> m_code_hash_id_counts;
+
+  // The buckets of each method, and the indices of the remaining methods in
+  // each bucket of each band
+  std::unordered_map<DexMethod*, MinHashBuckets> m_method_buckets;
+  std::array<std::unordered_map<uint64_t, std::set<size_t>>, MINHASH_BANDS>
+      m_bucket_method_indices;
+  boost::optional<MinHashBuckets> m_last_buckets;
+
   void insert(DexMethod* method);
 
+  static MinHashBuckets get_minhash_buckets(
+      const std::unordered_set<CodeHashId>& code_hash_ids);
+
+  // The methods that could be similar to the previously chosen method,
+  // and the respective numbers of shared hash ids
+  std::unordered_map<DexMethod*, size_t> get_candidates();
+
+  void remove(DexMethod* method);
+
   // Gather the hash ids of all instruction sequences
   // (of a certain size) inside code
   void gather_code_hash_ids(const DexCode* code,
                             std::unordered_set<CodeHashId>& code_hash_ids);
 
  public:
-  explicit MethodSimilarityOrderer(const std::vector<DexMethod*>& methods) {
+  explicit MethodSimilarityOrderer(const std::vector<DexMethod*>& methods,
+                                   bool use_minhash = false)
+      : m_use_minhash(use_minhash) {
     for (auto* method : methods) {
       insert(method);
     }
@@ -66,8 +112,9 @@ class MethodSimilarityOrderer {
 
   DexMethod* get_next();
 
-  static void order(std::vector<DexMethod*>& methods) {
-    MethodSimilarityOrderer mso(methods);
+  static void order(std::vector<DexMethod*>& methods,
+                    bool use_minhash = false) {
+    MethodSimilarityOrderer mso(methods, use_minhash);
     methods.clear();
 
     DexMethod* next_method;
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodTiming.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include "Debug.h"
+#include "DexClass.h"
+#include "IRCode.h"
+
+namespace method_timing {
+
+namespace {
+
+bool slower(const Sample& a, const Sample& b) { return a.seconds > b.seconds; }
+
+struct State {
+  std::mutex mutex;
+  size_t top_n{0};
+  // A heap of the slowest samples, whose front is the fastest of them.
+  std::vector<Sample> samples;
+  // Once the heap is full, samples that are not slower than its front are
+  // dropped without taking the lock.
+  std::atomic<double> threshold{0};
+};
+
+State& get_state() {
+  static State state;
+  return state;
+}
+
+} // namespace
+
+namespace detail {
+
+std::atomic<bool> s_enabled{false};
+
+void record(const DexMethod* method, double seconds) {
+  auto& state = get_state();
+  if (seconds <= state.threshold.load(std::memory_order_relaxed)) {
+    return;
+  }
+  auto code = method->get_code();
+  Sample sample{method, seconds, code ? code->sum_opcode_sizes() : 0};
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto& samples = state.samples;
+  samples.push_back(sample);
+  std::push_heap(samples.begin(), samples.end(), slower);
+  if (samples.size() > state.top_n) {
+    std::pop_heap(samples.begin(), samples.end(), slower);
+    samples.pop_back();
+  }
+  if (samples.size() == state.top_n) {
+    state.threshold.store(samples.front().seconds, std::memory_order_relaxed);
+  }
+}
+
+} // namespace detail
+
+Recording::Recording(size_t top_n) : m_active(top_n > 0) {
+  if (!m_active) {
+    return;
+  }
+  always_assert_log(!detail::s_enabled, "Only one Recording may be alive");
+  auto& state = get_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.top_n = top_n;
+  state.samples.clear();
+  state.threshold = 0;
+  detail::s_enabled = true;
+}
+
+Recording::~Recording() {
+  if (m_active) {
+    detail::s_enabled = false;
+  }
+}
+
+std::vector<Sample> Recording::get_slowest() const {
+  if (!m_active) {
+    return {};
+  }
+  auto& state = get_state();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto samples = state.samples;
+  std::sort(samples.begin(), samples.end(), slower);
+  return samples;
+}
+
+} // namespace method_timing
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+class DexMethod;
+
+/*
+ * Optional timing of the methods visited by the walk::parallel walkers, to
+ * tell a pass that is uniformly slow from one that spends minutes on a few
+ * methods.
+ *
+ * While a Recording is alive, the walkers time every method they visit, and
+ * the slowest ones are kept. Only one Recording may be alive at a time; the
+ * PassManager keeps one around each pass when `method_timing_top_n` is set.
+ * Otherwise, the cost is a relaxed atomic load per method.
+ */
+namespace method_timing {
+
+struct Sample {
+  const DexMethod* method;
+  double seconds;
+  // The sum of the opcode sizes of the method, after it was processed.
+  size_t code_size;
+};
+
+namespace detail {
+
+extern std::atomic<bool> s_enabled;
+
+void record(const DexMethod* method, double seconds);
+
+} // namespace detail
+
+inline bool is_enabled() {
+  return detail::s_enabled.load(std::memory_order_relaxed);
+}
+
+// Runs `fn`, timing it as work on `method` if a Recording is alive.
+template <typename Fn>
+void run(const DexMethod* method, const Fn& fn) {
+  if (!is_enabled()) {
+    fn();
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  detail::record(method, elapsed.count());
+}
+
+class Recording {
+ public:
+  // Keeps the `top_n` slowest methods. Does nothing if `top_n` is zero.
+  explicit Recording(size_t top_n);
+
+  ~Recording();
+
+  Recording(const Recording&) = delete;
+  Recording& operator=(const Recording&) = delete;
+
+  // The slowest methods so far, slowest first.
+  std::vector<Sample> get_slowest() const;
+
+ private:
+  bool m_active;
+};
+
+} // namespace method_timing
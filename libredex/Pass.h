@@ -27,6 +27,18 @@ class Pass : public Configurable {
     ANALYSIS,
   };
 
+  // The parts of the program that a pass may read or write.
+  enum ProgramParts : uint8_t {
+    NO_PARTS = 0,
+    // The classes, their members and their annotations.
+    CLASSES = 1 << 0,
+    // The code of the methods.
+    CODE = 1 << 1,
+    // The resources and the manifest of the app.
+    RESOURCES = 1 << 2,
+    ALL_PARTS = CLASSES | CODE | RESOURCES,
+  };
+
   explicit Pass(const std::string& name, Kind kind = TRANSFORMATION);
 
   const std::string& name() const { return m_name; }
@@ -58,6 +70,46 @@ class Pass : public Configurable {
 
   virtual void set_analysis_usage(AnalysisUsage& analysis_usage) const;
 
+  /**
+   * Whether this pass accepts methods whose code is already in editable CFG
+   * form, and may leave them that way. Such passes must only access code
+   * through the CFG, e.g. via `cfg::ScopedCFG`, and never through the IRList
+   * directly.
+   *
+   * When the PassManager is configured with `keep_editable_cfg`, code is kept
+   * in editable CFG form across consecutive passes that return true here,
+   * instead of being linearized and rebuilt by each of them.
+   */
+  virtual bool is_editable_cfg_friendly() const { return false; }
+
+  /**
+   * Whether this pass may look at the code of any method. When classes are
+   * loaded with `lazy_code_loading`, the PassManager balloons all the code
+   * left lazy before the first pass that returns true here. Passes that only
+   * look at a few methods can return false: the code of the methods they do
+   * access is then ballooned on demand by DexMethod::get_code().
+   */
+  virtual bool needs_all_code() const { return true; }
+
+  /**
+   * Whether the effect of this pass on the code of a method only depends on
+   * that code and the configuration of the pass. Such passes may use
+   * PassManager::run_on_changed_method() to skip the methods on which an
+   * earlier run of the pass was a no-op and that have not changed since.
+   */
+  virtual bool is_method_local() const { return false; }
+
+  /**
+   * The parts of the program that this pass reads and writes, besides its own
+   * output files and metrics. Two passes are independent when neither writes
+   * a part that the other reads or writes. With the
+   * `concurrent_independent_passes` option, the PassManager runs consecutive
+   * independent passes concurrently, which gives the same results as running
+   * them in order. Passes that keep the defaults always run on their own.
+   */
+  virtual uint8_t reads() const { return ALL_PARTS; }
+  virtual uint8_t writes() const { return ALL_PARTS; }
+
   Configurable::Reflection reflect() override;
 
  private:
@@ -8,10 +8,15 @@
 #include "PassManager.h"
 #include "DexAssessments.h"
 
+#include <atomic>
 #include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
+#include <chrono>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
+#include <ctime>
+#include <exception>
 #include <list>
 #include <thread>
 #include <typeinfo>
@@ -26,10 +31,13 @@
 #include "AnalysisUsage.h"
 #include "ApiLevelChecker.h"
 #include "AssetManager.h"
+#include "ChromeTrace.h"
 #include "CommandProfiling.h"
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
 #include "Debug.h"
 #include "DexClass.h"
+#include "DexHasher.h"
 #include "DexLoader.h"
 #include "DexOutput.h"
 #include "DexUtil.h"
@@ -39,6 +47,7 @@
 #include "InstructionLowering.h"
 #include "JemallocUtil.h"
 #include "MethodProfiles.h"
+#include "MethodTiming.h"
 #include "Native.h"
 #include "OptData.h"
 #include "Pass.h"
@@ -46,12 +55,15 @@
 #include "ProguardPrintConfiguration.h"
 #include "ProguardReporting.h"
 #include "ReachableClasses.h"
+#include "Resolver.h"
 #include "Sanitizers.h"
 #include "ScopedCFG.h"
 #include "Show.h"
 #include "SourceBlocks.h"
+#include "StatusReporter.h"
 #include "Timer.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -59,6 +71,20 @@ constexpr const char* JNI_OUTPUT_DIR = "/tmp/JNI_OUTPUT/";
 constexpr const char* REMOVABLE_NATIVES = "redex-removable-natives.txt";
 const std::string PASS_ORDER_KEY = "pass_order";
 
+// The pass and the sharded metrics of a later pass of a concurrent batch; see
+// PassManager::run_concurrently. The threads that run such a pass, including
+// the worker threads of its work queues, see it as their
+// redex_parallel::inherited_context.
+struct BatchPassContext {
+  PassManager::PassInfo* pass_info;
+  sharded_metrics::Registry* sharded_metrics;
+};
+
+const BatchPassContext* get_batch_pass_context() {
+  return static_cast<const BatchPassContext*>(
+      redex_parallel::inherited_context());
+}
+
 const Pass* get_profiled_pass(const PassManager& mgr) {
   redex_assert(getenv("PROFILE_PASS") != nullptr);
   // Resolve the pass in the constructor so that any typos / references to
@@ -75,6 +101,41 @@ std::string get_apk_dir(const Json::Value& config) {
   return apkdir;
 }
 
+/*
+ * What the type checker saw last time it passed after a pass: a hash of the
+ * class structure that the checking depends on (hierarchy, members and their
+ * access flags), and a hash of each method. Together they tell which methods
+ * need to be checked again.
+ */
+struct CheckedState {
+  size_t structure_hash{0};
+  ConcurrentMap<const DexMethod*, size_t> method_hashes;
+};
+
+size_t hash_structure(const Scope& scope) {
+  std::atomic<size_t> hash{scope.size()};
+  walk::parallel::classes(scope, [&](const DexClass* cls) {
+    size_t cls_hash = 0;
+    boost::hash_combine(cls_hash, cls);
+    boost::hash_combine(cls_hash, cls->get_access());
+    boost::hash_combine(cls_hash, cls->get_super_class());
+    boost::hash_combine(cls_hash, cls->get_interfaces());
+    for (const auto* f : cls->get_all_fields()) {
+      boost::hash_combine(cls_hash, f);
+      boost::hash_combine(cls_hash, f->get_type());
+      boost::hash_combine(cls_hash, f->get_access());
+    }
+    for (const auto* m : cls->get_all_methods()) {
+      boost::hash_combine(cls_hash, m);
+      boost::hash_combine(cls_hash, m->get_proto());
+      boost::hash_combine(cls_hash, m->get_access());
+    }
+    // The classes are combined commutatively, as their order doesn't matter.
+    hash.fetch_add(cls_hash, std::memory_order_relaxed);
+  });
+  return hash.load();
+}
+
 struct CheckerConfig {
   explicit CheckerConfig(const ConfigFiles& conf) {
     const Json::Value& type_checker_args =
@@ -90,6 +151,9 @@ struct CheckerConfig {
         type_checker_args.get("check_no_overwrite_this", false).asBool();
     check_num_of_refs =
         type_checker_args.get("check_num_of_refs", false).asBool();
+    if (type_checker_args.get("check_changed_methods_only", false).asBool()) {
+      checked_state = std::make_unique<CheckedState>();
+    }
 
     for (auto& trigger_pass : type_checker_args["run_after_passes"]) {
       type_checker_trigger_passes.insert(trigger_pass.asString());
@@ -197,16 +261,43 @@ struct CheckerConfig {
   }
 
   // TODO(fengliu): Kill the `validate_access` flag.
-  static boost::optional<std::string> run_verifier(const Scope& scope,
-                                                   bool verify_moves,
-                                                   bool check_no_overwrite_this,
-                                                   bool validate_access,
-                                                   bool exit_on_fail = true) {
+  //
+  // With a `checked_state`, methods that are unchanged since they last passed,
+  // against an unchanged class structure, are not checked again. The method
+  // hashes cover the registers, so that register-only rewrites, e.g. from
+  // copy propagation or register allocation, are still checked.
+  static boost::optional<std::string> run_verifier(
+      const Scope& scope,
+      bool verify_moves,
+      bool check_no_overwrite_this,
+      bool validate_access,
+      bool exit_on_fail = true,
+      CheckedState* checked_state = nullptr) {
     TRACE(PM, 1, "Running IRTypeChecker...");
     Timer t("IRTypeChecker");
+    if (checked_state != nullptr) {
+      auto structure_hash = hash_structure(scope);
+      if (structure_hash != checked_state->structure_hash) {
+        checked_state->method_hashes.clear();
+        checked_state->structure_hash = structure_hash;
+      }
+    }
+    std::vector<DexMethod*> methods;
+    walk::methods(scope, [&](DexMethod* m) { methods.push_back(m); });
     std::atomic<size_t> errors{0};
+    std::atomic<size_t> num_checked{0};
     boost::optional<std::string> first_error_msg;
-    walk::parallel::methods(scope, [&](DexMethod* dex_method) {
+    auto check = [&](DexMethod* dex_method) {
+      size_t method_hash = 0;
+      if (checked_state != nullptr) {
+        method_hash = hashing::hash_method(dex_method);
+        auto& hashes = checked_state->method_hashes;
+        if (hashes.count(dex_method) &&
+            hashes.at(dex_method) == method_hash) {
+          return;
+        }
+      }
+      num_checked.fetch_add(1, std::memory_order_relaxed);
       IRTypeChecker checker(dex_method, validate_access);
       if (verify_moves) {
         checker.verify_moves();
@@ -226,8 +317,20 @@ struct CheckerConfig {
               << show(dex_method->get_code());
           first_error_msg = oss.str();
         }
+      } else if (checked_state != nullptr) {
+        checked_state->method_hashes.update(
+            dex_method,
+            [&](const DexMethod*, size_t& hash, bool) { hash = method_hash; });
       }
+    };
+    // The costliest methods go first, so they don't delay the end of the
+    // check.
+    workqueue_run_by_cost<DexMethod*>(check, methods, [](DexMethod* m) {
+      auto code = m->get_code();
+      return code ? code->sum_opcode_sizes() : 0;
     });
+    TRACE(PM, 2, "Type checked %zu of %zu methods", num_checked.load(),
+          methods.size());
 
     if (errors.load() > 0 && exit_on_fail) {
       redex_assert(first_error_msg);
@@ -252,6 +355,7 @@ struct CheckerConfig {
   bool verify_moves;
   bool check_no_overwrite_this;
   bool check_num_of_refs;
+  std::unique_ptr<CheckedState> checked_state;
 };
 
 class ScopedVmHWM {
@@ -283,6 +387,40 @@ class ScopedVmHWM {
   bool m_enabled;
 };
 
+// Records wall time, process CPU time, allocations and RSS over its lifetime
+// into the given PassResources.
+class ScopedPassResources {
+ public:
+  explicit ScopedPassResources(PassManager::PassResources* resources)
+      : m_resources(resources),
+        m_wall_start(std::chrono::steady_clock::now()),
+        m_cpu_start(std::clock()),
+        m_allocated_start(jemalloc_util::get_allocated_bytes()),
+        m_rss_start(get_mem_stats().vm_rss) {}
+
+  ~ScopedPassResources() {
+    std::chrono::duration<double> wall =
+        std::chrono::steady_clock::now() - m_wall_start;
+    auto& r = *m_resources;
+    r.wall_time_s = wall.count();
+    r.cpu_time_s = (double)(std::clock() - m_cpu_start) / CLOCKS_PER_SEC;
+    auto num_threads = redex_parallel::default_num_threads();
+    r.thread_utilization =
+        r.wall_time_s > 0 ? r.cpu_time_s / (r.wall_time_s * num_threads) : 0;
+    r.allocated_bytes_delta =
+        (int64_t)jemalloc_util::get_allocated_bytes() - m_allocated_start;
+    r.vm_rss_after = get_mem_stats().vm_rss;
+    r.vm_rss_delta = (int64_t)r.vm_rss_after - m_rss_start;
+  }
+
+ private:
+  PassManager::PassResources* m_resources;
+  std::chrono::steady_clock::time_point m_wall_start;
+  std::clock_t m_cpu_start;
+  int64_t m_allocated_start;
+  int64_t m_rss_start;
+};
+
 class CheckUniqueDeobfuscatedNames {
  public:
   bool m_after_each_pass{false};
@@ -586,6 +724,8 @@ class AfterPassSizes {
     json.get("after_pass_size_queue", m_max_jobs, m_max_jobs);
   }
 
+  bool enabled() const { return m_enabled; }
+
   bool handle(PassManager::PassInfo* pass_info,
               DexStoresVector* stores,
               ConfigFiles* conf) {
@@ -874,6 +1014,8 @@ void PassManager::init(const Json::Value& config) {
     // But do not forget to initialize them.
     for (auto* pass : m_activated_passes) {
       pass->parse_config(JsonWrapper(config[pass->name()]));
+      m_activated_pass_configs.push_back(
+          config[pass->name()].toStyledString());
     }
   }
 
@@ -1025,14 +1167,139 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     }
   };
 
+  // Optionally keep code in editable CFG form between consecutive passes that
+  // can handle it, so that each of them does not have to rebuild the CFG and
+  // linearize it again. Code is linearized before any pass or per-pass check
+  // that needs the IRList, and always before the passes are done.
+  const bool keep_editable_cfg =
+      conf.get_json_config().get("keep_editable_cfg", false);
+  // Optionally report the slowest methods that each pass visited through the
+  // parallel walkers, along with their size, as metrics of the pass.
+  size_t method_timing_top_n = 0;
+  conf.get_json_config().get("method_timing_top_n", 0, method_timing_top_n);
+  const bool write_cfg_each_pass =
+      conf.get_json_config().get("write_cfg_each_pass", false);
+  // Passes after which memory is released: the editable CFGs are linearized,
+  // the preserved analyses that no later pass requires are destroyed, and the
+  // allocator returns its unused pages to the OS.
+  std::unordered_set<std::string> quiescent_points;
+  conf.get_json_config().get("quiescent_points", {}, quiescent_points);
+  // Optionally also freeze the code of all methods at the quiescent points,
+  // so that the methods which no later pass touches stay compact.
+  const bool freeze_code =
+      conf.get_json_config().get("freeze_code_at_quiescent_points", false);
+  // Let method-local passes skip the methods that their previous run left
+  // unchanged, if nothing changed them since.
+  const bool skip_unchanged_methods =
+      conf.get_json_config().get("skip_unchanged_methods", false);
+  // Share the resolution of method refs across passes.
+  auto& method_resolution_cache = g_redex->method_resolution_cache();
+  method_resolution_cache.set_enabled(
+      conf.get_json_config().get("global_method_resolution_cache", false));
+  // Upper bounds on the number of threads of the parallel work of some passes,
+  // keyed by pass name or `name#n`, e.g. for memory-bound passes.
+  std::unordered_map<std::string, size_t> pass_thread_limits;
+  {
+    auto limits = conf.get_json_config().get("pass_thread_limits",
+                                             Json::Value(Json::objectValue));
+    always_assert_log(limits.isObject(),
+                      "pass_thread_limits must be an object");
+    for (const auto& name : limits.getMemberNames()) {
+      pass_thread_limits.emplace(name, limits[name].asUInt());
+    }
+  }
+  auto get_thread_limit = [&](const Pass* pass) -> size_t {
+    auto it = pass_thread_limits.find(m_current_pass_info->name);
+    if (it == pass_thread_limits.end()) {
+      it = pass_thread_limits.find(pass->name());
+    }
+    return it == pass_thread_limits.end() ? 0 : it->second;
+  };
+  bool may_have_editable_cfgs = false;
+  // Classes may have been loaded with `lazy_code_loading`.
+  bool may_have_lazy_code = true;
+
+  auto build_editable_cfgs = [&]() {
+    Timer t("Building editable CFGs");
+    walk::parallel::code(build_class_scope(stores),
+                         [](DexMethod*, IRCode& code) {
+                           if (!code.editable_cfg_built()) {
+                             code.build_cfg(/* editable */ true);
+                           }
+                         });
+    may_have_editable_cfgs = true;
+  };
+
+  auto clear_editable_cfgs = [&]() {
+    if (!may_have_editable_cfgs) {
+      return;
+    }
+    Timer t("Linearizing editable CFGs");
+    walk::parallel::code(build_class_scope(stores),
+                         [](DexMethod*, IRCode& code) { code.clear_cfg(); });
+    may_have_editable_cfgs = false;
+  };
+
+  auto run_quiescent_point = [&](size_t i) {
+    Timer t("Quiescent point");
+    clear_editable_cfgs();
+    auto allocated_before = jemalloc_util::get_allocated_bytes();
+    size_t dropped = 0;
+    for (auto it = m_preserved_analysis_passes.begin();
+         it != m_preserved_analysis_passes.end();) {
+      if (AnalysisUsage::is_required_after(m_activated_passes, i,
+                                           it->first)) {
+        ++it;
+        continue;
+      }
+      it->second->destroy_analysis_result();
+      it = m_preserved_analysis_passes.erase(it);
+      dropped++;
+    }
+    // Preserved analyses may refer to the instructions, which get replaced.
+    if (freeze_code && m_preserved_analysis_passes.empty()) {
+      std::atomic<size_t> frozen{0};
+      walk::parallel::methods(build_class_scope(stores), [&](DexMethod* m) {
+        if (m->freeze_code()) {
+          frozen++;
+        }
+      });
+      m_current_pass_info->metrics["quiescent_point_frozen_methods"] = frozen;
+      may_have_lazy_code = true;
+    }
+    jemalloc_util::purge_arenas();
+    auto allocated_after = jemalloc_util::get_allocated_bytes();
+    auto freed =
+        allocated_before > allocated_after ? allocated_before - allocated_after
+                                           : 0;
+    m_current_pass_info->metrics["quiescent_point_dropped_analyses"] = dropped;
+    m_current_pass_info->metrics["quiescent_point_freed_bytes"] = freed;
+    TRACE(PM, 1, "Quiescent point: dropped %zu analyses, freed %s", dropped,
+          pretty_bytes(freed).c_str());
+  };
+
+  auto post_pass_checks_need_ir_list = [&](Pass* pass, size_t i,
+                                           size_t size) {
+    return run_hasher_after_each_pass || assessor_config.run_after_each_pass ||
+           (assessor_config.run_finally && i == size - 1) ||
+           checker_conf.run_after_pass(pass) ||
+           check_unique_deobfuscated.m_after_each_pass || write_cfg_each_pass;
+  };
+
   auto post_pass_verifiers = [&](Pass* pass, size_t i, size_t size) {
-    walk::parallel::code(build_class_scope(stores), [](DexMethod* m,
-                                                       IRCode& code) {
-      // Ensure that pass authors deconstructed the editable CFG at the end of
-      // their pass. Currently, passes assume the incoming code will be in
-      // IRCode form
-      always_assert_log(!code.editable_cfg_built(), "%s has a cfg!", SHOW(m));
-    });
+    if (!may_have_editable_cfgs) {
+      walk::parallel::methods(build_class_scope(stores), [](DexMethod* m) {
+        // Code that is still lazy has not been touched.
+        if (m->has_lazy_code() || m->get_code() == nullptr) {
+          return;
+        }
+        // Ensure that pass authors deconstructed the editable CFG at the end
+        // of their pass. Currently, passes assume the incoming code will be in
+        // IRCode form
+        always_assert_log(!m->get_code()->editable_cfg_built(),
+                          "%s has a cfg!", SHOW(m));
+      });
+    }
 
     bool run_hasher = run_hasher_after_each_pass;
     bool run_assessor = assessor_config.run_after_each_pass ||
@@ -1054,7 +1321,9 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         // output phase -- the register allocator can fix it up later.
         CheckerConfig::run_verifier(scope, checker_conf.verify_moves,
                                     /* check_no_overwrite_this */ false,
-                                    /* validate_access */ false);
+                                    /* validate_access */ false,
+                                    /* exit_on_fail */ true,
+                                    checker_conf.checked_state.get());
       }
       if (i >= min_pass_idx_for_dex_ref_check) {
         CheckerConfig::ref_validation(stores, pass->name());
@@ -1064,6 +1333,65 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     }
   };
 
+  // Optionally run consecutive independent passes (see Pass::reads and
+  // Pass::writes) concurrently. Only the passes whose bookkeeping by the
+  // PassManager does not observe the program in between are eligible. The
+  // batch runs as part of the first pass of the batch; the following ones
+  // then only do their bookkeeping.
+  const bool concurrent_independent_passes =
+      conf.get_json_config().get("concurrent_independent_passes", false) &&
+      !after_pass_size.enabled() && method_timing_top_n == 0;
+  auto may_run_concurrently = [&](size_t i, bool is_first) {
+    auto* pass = m_activated_passes[i];
+    if (pass->is_analysis_pass() || pass == profiler_info_pass ||
+        pass == m_malloc_profile_pass ||
+        post_pass_checks_need_ir_list(pass, i, m_activated_passes.size()) ||
+        quiescent_points.count(pass->name()) ||
+        quiescent_points.count(m_pass_info[i].name) ||
+        pass_thread_limits.count(pass->name()) ||
+        pass_thread_limits.count(m_pass_info[i].name) ||
+        (skip_unchanged_methods && pass->is_method_local()) ||
+        (keep_editable_cfg && pass->is_editable_cfg_friendly()) ||
+        (!is_first && may_have_lazy_code && pass->needs_all_code())) {
+      return false;
+    }
+    // The later passes of the batch must see the same analyses as they
+    // would after the earlier ones.
+    AnalysisUsage analysis_usage;
+    pass->set_analysis_usage(analysis_usage);
+    for (const auto& entry : m_preserved_analysis_passes) {
+      if (!analysis_usage.preserves(entry.first)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  auto are_independent = [](const Pass* a, const Pass* b) {
+    return !(a->writes() & (b->reads() | b->writes())) &&
+           !(b->writes() & a->reads());
+  };
+  auto get_batch_end = [&](size_t begin) {
+    if (!concurrent_independent_passes || !may_run_concurrently(begin, true)) {
+      return begin + 1;
+    }
+    size_t end = begin + 1;
+    for (; end < m_activated_passes.size(); ++end) {
+      if (!may_run_concurrently(end, false)) {
+        break;
+      }
+      bool independent = true;
+      for (size_t i = begin; i < end && independent; ++i) {
+        independent = are_independent(m_activated_passes[i],
+                                      m_activated_passes[end]);
+      }
+      if (!independent) {
+        break;
+      }
+    }
+    return end;
+  };
+  size_t batch_end = 0;
+
   JNINativeContextHelper jni_native_context_helper(scope);
 
   std::unordered_map<const Pass*, size_t> runs;
@@ -1079,12 +1407,38 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     analysis_usage_helper.pre_pass(pass);
 
     TRACE(PM, 1, "Running %s...", pass->name().c_str());
+    status_reporter::set_phase(pass->name());
     ScopedVmHWM vm_hwm{hwm_pass_stats, hwm_per_pass};
     Timer t(pass->name() + " " + std::to_string(pass_run) + " (run)");
     m_current_pass_info = &m_pass_info[i];
 
     pre_pass_verifiers(pass, i);
 
+    if (may_have_lazy_code && pass->needs_all_code()) {
+      Timer t2("Ballooning lazy code");
+      auto ballooned = balloon_lazy_code(build_class_scope(stores));
+      TRACE(PM, 1, "Ballooned %zu lazy methods before %s", ballooned,
+            pass->name().c_str());
+      may_have_lazy_code = false;
+    }
+
+    if (skip_unchanged_methods && pass->is_method_local()) {
+      auto& noops = m_noop_methods[pass];
+      const auto& config = m_activated_pass_configs[i];
+      if (!noops || noops->config != config) {
+        noops = std::make_unique<NoOpMethodsOfPass>();
+        noops->config = config;
+      }
+      m_current_noop_methods = &noops->methods;
+      m_unchanged_methods_skipped = 0;
+    }
+
+    if (keep_editable_cfg && pass->is_editable_cfg_friendly()) {
+      build_editable_cfgs();
+    } else {
+      clear_editable_cfgs();
+    }
+
     {
       auto scoped_command_prof = profiler_info_pass == pass
                                      ? ScopedCommandProfiling::maybe_from_info(
@@ -1093,19 +1447,72 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       auto scoped_command_all_prof = ScopedCommandProfiling::maybe_from_info(
           profiler_all_info, &pass->name());
       jemalloc_util::ScopedProfiling malloc_prof(m_malloc_profile_pass == pass);
-      pass->run_pass(stores, conf, *this);
+      ScopedPassResources pass_resources(&m_current_pass_info->resources);
+      chrome_trace::ScopedEvent trace_event(m_current_pass_info->name, "pass");
+      method_timing::Recording method_timing_recording(method_timing_top_n);
+      redex_parallel::ScopedThreadLimit thread_limit(get_thread_limit(pass));
+      if (i >= batch_end) {
+        batch_end = get_batch_end(i);
+        if (batch_end > i + 1) {
+          TRACE(PM, 1, "Running %zu passes concurrently with %s",
+                batch_end - i - 1, pass->name().c_str());
+          run_concurrently(i, batch_end, stores, conf);
+        } else {
+          pass->run_pass(stores, conf, *this);
+        }
+      }
+      m_sharded_metrics.reduce_into(&m_current_pass_info->metrics);
+      if (m_current_noop_methods != nullptr) {
+        m_current_pass_info->metrics["num_unchanged_methods_skipped"] =
+            m_unchanged_methods_skipped;
+        m_current_noop_methods = nullptr;
+      }
+      for (const auto& sample : method_timing_recording.get_slowest()) {
+        auto name = show(sample.method);
+        TRACE(PM, 1, "%s: %.3fs in %s (size %zu)", pass->name().c_str(),
+              sample.seconds, name.c_str(), sample.code_size);
+        m_current_pass_info->metrics["method_time_us:" + name] =
+            static_cast<int64_t>(sample.seconds * 1e6);
+        m_current_pass_info->metrics["method_size:" + name] =
+            sample.code_size;
+      }
     }
 
     vm_hwm.trace_log(this, pass);
 
+    if (method_resolution_cache.is_enabled()) {
+      // The pass may have edited the method lists of classes directly.
+      if (pass->writes() & Pass::CLASSES) {
+        g_redex->invalidate_method_resolution();
+      }
+      m_current_pass_info->metrics["method_resolution_cache_size"] =
+          method_resolution_cache.size();
+      method_resolution_cache.clear_stale();
+    }
+
     sanitizers::lsan_do_recoverable_leak_check();
 
+    if (may_have_editable_cfgs) {
+      bool next_is_friendly =
+          i + 1 < m_activated_passes.size() &&
+          m_activated_passes[i + 1]->is_editable_cfg_friendly();
+      if (!next_is_friendly ||
+          post_pass_checks_need_ir_list(pass, i, m_activated_passes.size())) {
+        clear_editable_cfgs();
+      }
+    }
+
     graph_visualizer.add_pass(pass, i);
 
     post_pass_verifiers(pass, i, m_activated_passes.size());
 
     analysis_usage_helper.post_pass(pass);
 
+    if (quiescent_points.count(pass->name()) ||
+        quiescent_points.count(m_current_pass_info->name)) {
+      run_quiescent_point(i);
+    }
+
     process_method_profiles(*this, conf);
 
     if (after_pass_size.handle(m_current_pass_info, &stores, &conf)) {
@@ -1120,6 +1527,8 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
     m_current_pass_info = nullptr;
   }
 
+  clear_editable_cfgs();
+
   after_pass_size.wait();
 
   // Always run the type checker before generating the optimized dex code.
@@ -1155,6 +1564,7 @@ void PassManager::activate_pass(const std::string& name,
       // Retrieving the configuration specific to this particular run
       // of the pass.
       pass->parse_config(JsonWrapper(conf[name]));
+      m_activated_pass_configs.push_back(conf[name].toStyledString());
       return;
     }
   }
@@ -1169,18 +1579,74 @@ Pass* PassManager::find_pass(const std::string& pass_name) const {
   return pass_it != m_activated_passes.end() ? *pass_it : nullptr;
 }
 
+PassManager::PassInfo* PassManager::current_pass_info() const {
+  const auto* context = get_batch_pass_context();
+  return context != nullptr ? context->pass_info : m_current_pass_info;
+}
+
+sharded_metrics::Registry& PassManager::current_sharded_metrics() {
+  const auto* context = get_batch_pass_context();
+  return context != nullptr ? *context->sharded_metrics : m_sharded_metrics;
+}
+
+void PassManager::run_concurrently(size_t begin,
+                                   size_t end,
+                                   DexStoresVector& stores,
+                                   ConfigFiles& conf) {
+  std::vector<std::unique_ptr<sharded_metrics::Registry>> sharded_metrics;
+  std::vector<std::exception_ptr> exceptions(end - begin);
+  std::vector<std::thread> threads;
+  for (size_t i = begin + 1; i < end; ++i) {
+    sharded_metrics.push_back(std::make_unique<sharded_metrics::Registry>());
+    threads.emplace_back([&, i, registry = sharded_metrics.back().get()] {
+      BatchPassContext context{&m_pass_info[i], registry};
+      redex_parallel::ScopedInheritedContext inherited_context(&context);
+      try {
+        m_activated_passes[i]->run_pass(stores, conf, *this);
+      } catch (...) {
+        exceptions[i - begin] = std::current_exception();
+      }
+    });
+  }
+  try {
+    m_activated_passes[begin]->run_pass(stores, conf, *this);
+  } catch (...) {
+    exceptions[0] = std::current_exception();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto& exception : exceptions) {
+    if (exception) {
+      std::rethrow_exception(exception);
+    }
+  }
+  for (size_t i = begin + 1; i < end; ++i) {
+    sharded_metrics[i - begin - 1]->reduce_into(&m_pass_info[i].metrics);
+  }
+  for (size_t i = begin; i < end; ++i) {
+    m_pass_info[i].metrics["concurrent_batch_size"] = end - begin;
+  }
+}
+
 void PassManager::incr_metric(const std::string& key, int64_t value) {
-  always_assert_log(m_current_pass_info != nullptr, "No current pass!");
-  (m_current_pass_info->metrics)[key] += value;
+  auto* pass_info = current_pass_info();
+  always_assert_log(pass_info != nullptr, "No current pass!");
+  std::lock_guard<std::mutex> lock(m_metrics_mutex);
+  (pass_info->metrics)[key] += value;
 }
 
 void PassManager::set_metric(const std::string& key, int64_t value) {
-  always_assert_log(m_current_pass_info != nullptr, "No current pass!");
-  (m_current_pass_info->metrics)[key] = value;
+  auto* pass_info = current_pass_info();
+  always_assert_log(pass_info != nullptr, "No current pass!");
+  std::lock_guard<std::mutex> lock(m_metrics_mutex);
+  (pass_info->metrics)[key] = value;
 }
 
 int64_t PassManager::get_metric(const std::string& key) {
-  return (m_current_pass_info->metrics)[key];
+  auto* pass_info = current_pass_info();
+  std::lock_guard<std::mutex> lock(m_metrics_mutex);
+  return (pass_info->metrics)[key];
 }
 
 const std::vector<PassManager::PassInfo>& PassManager::get_pass_info() const {
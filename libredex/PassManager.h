@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <boost/optional.hpp>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <typeinfo>
 #include <unordered_map>
@@ -17,10 +19,13 @@
 
 #include "AnalysisUsage.h"
 #include "AssetManager.h"
+#include "ConcurrentContainers.h"
 #include "DexHasher.h"
+#include "IRCode.h"
 #include "JsonWrapper.h"
 #include "ProguardConfiguration.h"
 #include "RedexOptions.h"
+#include "ShardedMetrics.h"
 #include "Timer.h"
 
 struct ConfigFiles;
@@ -50,6 +55,19 @@ class PassManager {
 
   ~PassManager();
 
+  // Resources used by a single run of a pass, measured around its run_pass.
+  struct PassResources {
+    double wall_time_s{0};
+    // CPU time of the whole process, i.e. summed over all worker threads.
+    double cpu_time_s{0};
+    // cpu_time_s / (wall_time_s * number of worker threads)
+    double thread_utilization{0};
+    // Change in bytes allocated, if jemalloc is in use.
+    int64_t allocated_bytes_delta{0};
+    uint64_t vm_rss_after{0};
+    int64_t vm_rss_delta{0};
+  };
+
   struct PassInfo {
     const Pass* pass;
     size_t order; // zero-based
@@ -59,12 +77,27 @@ class PassManager {
     std::unordered_map<std::string, int64_t> metrics;
     JsonWrapper config;
     boost::optional<hashing::DexHash> hash;
+    PassResources resources;
   };
 
   void run_passes(DexStoresVector&, ConfigFiles&);
   void incr_metric(const std::string& key, int64_t value);
   void set_metric(const std::string& key, int64_t value);
   int64_t get_metric(const std::string& key);
+
+  /*
+   * Metrics that the worker threads of the current pass can update
+   * concurrently without contention. They are added to the metrics of the
+   * pass when its run_pass returns; see sharded_metrics::Registry for how
+   * histograms are reported. Get them before going parallel.
+   */
+  sharded_metrics::Counter& sharded_counter(const std::string& key) {
+    return current_sharded_metrics().counter(key);
+  }
+  sharded_metrics::Histogram& sharded_histogram(const std::string& key) {
+    return current_sharded_metrics().histogram(key);
+  }
+
   const std::vector<PassManager::PassInfo>& get_pass_info() const;
   boost::optional<hashing::DexHash> get_initial_hash() const {
     return m_initial_hash;
@@ -86,7 +119,9 @@ class PassManager {
   // do not use ProGuard configuration keep rules.
   void set_testing_mode() { m_testing_mode = true; }
 
-  const PassInfo* get_current_pass_info() const { return m_current_pass_info; }
+  const PassInfo* get_current_pass_info() const {
+    return current_pass_info();
+  }
 
   AssetManager& asset_manager() { return m_asset_mgr; }
 
@@ -113,7 +148,45 @@ class PassManager {
 
   Pass* find_pass(const std::string& pass_name) const;
 
+  /*
+   * Runs `fn`, which applies the current pass to `method`, unless an earlier
+   * run of the same method-local pass (see Pass::is_method_local) with the
+   * same configuration was a no-op on the very code that the method has now.
+   * Methods are compared by hashing::hash_method(). This only skips anything
+   * when the `skip_unchanged_methods` option is set. Can be called
+   * concurrently for different methods. Returns true if `fn` was run.
+   */
+  template <typename Fn>
+  bool run_on_changed_method(DexMethod* method, const Fn& fn) {
+    auto* noops = m_current_noop_methods;
+    auto* code = method->get_code();
+    if (noops == nullptr || code == nullptr || code->editable_cfg_built()) {
+      fn();
+      return true;
+    }
+    auto hash = hashing::hash_method(method);
+    if (noops->get(method, boost::none) == hash) {
+      ++m_unchanged_methods_skipped;
+      return false;
+    }
+    fn();
+    if (hashing::hash_method(method) == hash) {
+      noops->insert_or_assign(std::make_pair(method, hash));
+    }
+    return true;
+  }
+
  private:
+  using NoOpMethods =
+      ConcurrentMap<const DexMethod*, boost::optional<size_t>>;
+
+  // The methods on which the runs of a method-local pass were no-ops, with
+  // the hash of their code at the time.
+  struct NoOpMethodsOfPass {
+    std::string config;
+    NoOpMethods methods;
+  };
+
   void activate_pass(const std::string& name, const Json::Value& conf);
 
   void init(const Json::Value& config);
@@ -122,14 +195,38 @@ class PassManager {
 
   void eval_passes(DexStoresVector&, ConfigFiles&);
 
+  // Runs the passes [begin, end) concurrently, the first one on this thread.
+  void run_concurrently(size_t begin,
+                        size_t end,
+                        DexStoresVector& stores,
+                        ConfigFiles& conf);
+
+  // The pass that this thread works for, which is m_current_pass_info unless
+  // it works for one of the later passes of a concurrent batch.
+  PassInfo* current_pass_info() const;
+
+  sharded_metrics::Registry& current_sharded_metrics();
+
   AssetManager m_asset_mgr;
   std::vector<Pass*> m_registered_passes;
   std::vector<Pass*> m_activated_passes;
+  // The serialized configuration of each activated pass.
+  std::vector<std::string> m_activated_pass_configs;
   std::unordered_map<AnalysisID, Pass*> m_preserved_analysis_passes;
 
   // Per-pass information and metrics
   std::vector<PassManager::PassInfo> m_pass_info;
   PassInfo* m_current_pass_info;
+  sharded_metrics::Registry m_sharded_metrics;
+  // Guards the metrics of the passes that incr_metric and set_metric update,
+  // which the worker threads of a pass, and the passes of a concurrent batch,
+  // may do concurrently.
+  std::mutex m_metrics_mutex;
+
+  std::unordered_map<const Pass*, std::unique_ptr<NoOpMethodsOfPass>>
+      m_noop_methods;
+  NoOpMethods* m_current_noop_methods{nullptr};
+  std::atomic<size_t> m_unchanged_methods_skipped{0};
 
   std::unique_ptr<keep_rules::ProguardConfiguration> m_pg_config;
   const RedexOptions m_redex_options;
@@ -9,12 +9,14 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iterator>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <ostream>
 #include <sstream>
 #include <tuple>
@@ -44,6 +46,7 @@
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace sparta;
 
@@ -1548,6 +1551,427 @@ std::ostream& operator<<(std::ostream& o, const PointsToMethodSemantics& s) {
   return o;
 }
 
+namespace pts_impl {
+
+/*
+ * The binary stub format is:
+ *
+ *   magic version
+ *   string_count (length bytes)*
+ *   method_count (record_size record)*
+ *
+ * where all integers are (S)LEB128-encoded and a record is laid out as:
+ *
+ *   method kind variable_counter action_count action*
+ *   method := class_id name_id rtype_id arg_count arg_id*
+ *   action := op_kind operand* argument_count (key variable_id)*
+ *
+ * The operands of an action depend on its kind: a string id for the string
+ * and type operations, three string ids for a field, a method for an invoke
+ * and an integer for parameters and special edges. Keys and variable ids are
+ * the only signed integers.
+ */
+class BinaryStubCodec final {
+ public:
+  static constexpr uint32_t kMagic = 0x42535450; // "PTSB"
+  static constexpr uint32_t kVersion = 1;
+
+  static bool has_magic(const std::string& data) {
+    uint32_t magic;
+    if (data.size() < sizeof(magic)) {
+      return false;
+    }
+    memcpy(&magic, data.data(), sizeof(magic));
+    return magic == kMagic;
+  }
+
+  static void write(
+      const std::vector<const PointsToMethodSemantics*>& semantics,
+      std::ostream& output) {
+    BinaryStubCodec codec;
+    std::vector<std::string> records;
+    records.reserve(semantics.size());
+    for (const PointsToMethodSemantics* s : semantics) {
+      records.emplace_back();
+      codec.write_method_semantics(*s, &records.back());
+    }
+    std::string header;
+    header.append(reinterpret_cast<const char*>(&kMagic), sizeof(kMagic));
+    write_uleb(kVersion, &header);
+    write_uleb(codec.m_strings.size(), &header);
+    for (const auto& str : codec.m_strings) {
+      write_uleb(str.size(), &header);
+      header += str;
+    }
+    write_uleb(records.size(), &header);
+    output << header;
+    for (const auto& record : records) {
+      std::string size;
+      write_uleb(record.size(), &size);
+      output << size << record;
+    }
+  }
+
+  // Returns none if `data` is not well-formed. The method records are
+  // decoded in parallel.
+  static boost::optional<std::vector<PointsToMethodSemantics>> read(
+      const std::string& data) {
+    Reader input{reinterpret_cast<const uint8_t*>(data.data()),
+                 reinterpret_cast<const uint8_t*>(data.data() + data.size())};
+    BinaryStubCodec codec;
+    uint32_t magic;
+    if (!input.read_bytes(sizeof(magic), &magic) || magic != kMagic ||
+        input.read_uleb() != kVersion) {
+      return {};
+    }
+    uint32_t string_count = input.read_uleb();
+    for (uint32_t i = 0; i < string_count && input.ok; ++i) {
+      uint32_t size = input.read_uleb();
+      const char* str = reinterpret_cast<const char*>(input.pos);
+      if (input.skip(size)) {
+        codec.m_strings.emplace_back(str, size);
+      }
+    }
+    uint32_t method_count = input.read_uleb();
+    std::vector<Reader> records;
+    for (uint32_t i = 0; i < method_count && input.ok; ++i) {
+      uint32_t size = input.read_uleb();
+      const uint8_t* record = input.pos;
+      if (input.skip(size)) {
+        records.push_back(Reader{record, record + size});
+      }
+    }
+    if (!input.ok || input.pos != input.end) {
+      return {};
+    }
+
+    std::vector<boost::optional<PointsToMethodSemantics>> decoded(
+        records.size());
+    std::vector<size_t> indices(records.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          decoded[i] = codec.read_method_semantics(&records[i]);
+        },
+        indices);
+    std::vector<PointsToMethodSemantics> semantics;
+    semantics.reserve(decoded.size());
+    for (auto& semantics_opt : decoded) {
+      if (!semantics_opt) {
+        return {};
+      }
+      semantics.push_back(std::move(*semantics_opt));
+    }
+    return semantics;
+  }
+
+ private:
+  // A bounds-checked cursor over a byte range. Any read past the end clears
+  // `ok` and returns zero.
+  struct Reader {
+    const uint8_t* pos;
+    const uint8_t* end;
+    bool ok{true};
+
+    bool skip(size_t size) {
+      if (!ok || static_cast<size_t>(end - pos) < size) {
+        ok = false;
+        return false;
+      }
+      pos += size;
+      return true;
+    }
+
+    bool read_bytes(size_t size, void* out) {
+      const uint8_t* start = pos;
+      if (!skip(size)) {
+        return false;
+      }
+      memcpy(out, start, size);
+      return true;
+    }
+
+    uint32_t read_uleb() {
+      uint32_t result = 0;
+      for (int shift = 0; ok && shift < 35; shift += 7) {
+        if (pos == end) {
+          break;
+        }
+        uint8_t byte = *pos++;
+        result |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+          return result;
+        }
+      }
+      ok = false;
+      return 0;
+    }
+
+    int32_t read_sleb() {
+      uint32_t value = read_uleb();
+      // Zigzag decoding.
+      return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+  };
+
+  static void write_uleb(uint32_t value, std::string* out) {
+    do {
+      uint8_t byte = value & 0x7f;
+      value >>= 7;
+      out->push_back(static_cast<char>(value != 0 ? byte | 0x80 : byte));
+    } while (value != 0);
+  }
+
+  static void write_sleb(int32_t value, std::string* out) {
+    // Zigzag encoding, so that small negative values stay small.
+    write_uleb((static_cast<uint32_t>(value) << 1) ^
+                   static_cast<uint32_t>(value >> 31),
+               out);
+  }
+
+  void write_string(const std::string& str, std::string* out) {
+    auto it = m_string_ids.emplace(str, m_strings.size()).first;
+    if (it->second == m_strings.size()) {
+      m_strings.push_back(str);
+    }
+    write_uleb(it->second, out);
+  }
+
+  void write_method(DexMethodRef* dex_method, std::string* out) {
+    DexProto* proto = dex_method->get_proto();
+    write_string(dex_method->get_class()->get_name()->str(), out);
+    write_string(dex_method->get_name()->str(), out);
+    write_string(proto->get_rtype()->get_name()->str(), out);
+    const auto& args = proto->get_args()->get_type_list();
+    write_uleb(args.size(), out);
+    for (DexType* arg : args) {
+      write_string(arg->get_name()->str(), out);
+    }
+  }
+
+  void write_operation(const PointsToOperation& operation, std::string* out) {
+    write_uleb(operation.kind, out);
+    switch (operation.kind) {
+    case PTS_CONST_STRING: {
+      write_string(operation.dex_string->str(), out);
+      break;
+    }
+    case PTS_CONST_CLASS:
+    case PTS_NEW_OBJECT:
+    case PTS_CHECK_CAST: {
+      write_string(operation.dex_type->get_name()->str(), out);
+      break;
+    }
+    case PTS_GET_EXCEPTION:
+    case PTS_GET_CLASS:
+    case PTS_RETURN:
+    case PTS_DISJUNCTION: {
+      break;
+    }
+    case PTS_LOAD_PARAM: {
+      write_uleb(operation.parameter, out);
+      break;
+    }
+    case PTS_IGET:
+    case PTS_SGET:
+    case PTS_IPUT:
+    case PTS_SPUT: {
+      DexFieldRef* dex_field = operation.dex_field;
+      write_string(dex_field->get_class()->get_name()->str(), out);
+      write_string(dex_field->get_name()->str(), out);
+      write_string(dex_field->get_type()->get_name()->str(), out);
+      break;
+    }
+    case PTS_IGET_SPECIAL:
+    case PTS_IPUT_SPECIAL: {
+      write_uleb(operation.special_edge, out);
+      break;
+    }
+    case PTS_INVOKE_VIRTUAL:
+    case PTS_INVOKE_SUPER:
+    case PTS_INVOKE_DIRECT:
+    case PTS_INVOKE_INTERFACE:
+    case PTS_INVOKE_STATIC: {
+      write_method(operation.dex_method, out);
+      break;
+    }
+    }
+  }
+
+  void write_method_semantics(const PointsToMethodSemantics& semantics,
+                              std::string* out) {
+    write_method(semantics.m_dex_method, out);
+    write_uleb(semantics.m_kind, out);
+    write_uleb(semantics.m_variable_counter, out);
+    write_uleb(semantics.m_points_to_actions.size(), out);
+    for (const auto& action : semantics.m_points_to_actions) {
+      write_operation(action.m_operation, out);
+      write_uleb(action.m_arguments.size(), out);
+      for (const auto& arg : action.m_arguments) {
+        write_sleb(arg.first, out);
+        write_sleb(arg.second.m_id, out);
+      }
+    }
+  }
+
+  // The decoding functions below only read the string table, which makes
+  // them safe to call concurrently.
+  boost::optional<const std::string&> read_string(Reader* input) const {
+    uint32_t id = input->read_uleb();
+    if (!input->ok || id >= m_strings.size()) {
+      input->ok = false;
+      return {};
+    }
+    return m_strings[id];
+  }
+
+  DexType* read_type(Reader* input) const {
+    auto name = read_string(input);
+    return name ? DexType::make_type(name->c_str()) : nullptr;
+  }
+
+  DexMethodRef* read_method(Reader* input) const {
+    DexType* type = read_type(input);
+    auto name = read_string(input);
+    DexType* rtype = read_type(input);
+    uint32_t arg_count = input->read_uleb();
+    std::deque<DexType*> args;
+    for (uint32_t i = 0; i < arg_count && input->ok; ++i) {
+      args.push_back(read_type(input));
+    }
+    if (!input->ok) {
+      return nullptr;
+    }
+    return DexMethod::make_method(
+        type,
+        DexString::make_string(*name),
+        DexProto::make_proto(rtype,
+                             DexTypeList::make_type_list(std::move(args))));
+  }
+
+  boost::optional<PointsToOperation> read_operation(Reader* input) const {
+    uint32_t kind = input->read_uleb();
+    if (!input->ok || kind > PTS_DISJUNCTION) {
+      return {};
+    }
+    auto op_kind = static_cast<PointsToOperationKind>(kind);
+    switch (op_kind) {
+    case PTS_CONST_STRING: {
+      auto str = read_string(input);
+      if (!str) {
+        return {};
+      }
+      return {PointsToOperation(op_kind, DexString::make_string(*str))};
+    }
+    case PTS_CONST_CLASS:
+    case PTS_NEW_OBJECT:
+    case PTS_CHECK_CAST: {
+      DexType* dex_type = read_type(input);
+      if (dex_type == nullptr) {
+        return {};
+      }
+      return {PointsToOperation(op_kind, dex_type)};
+    }
+    case PTS_GET_EXCEPTION:
+    case PTS_GET_CLASS:
+    case PTS_RETURN:
+    case PTS_DISJUNCTION: {
+      return {PointsToOperation(op_kind)};
+    }
+    case PTS_LOAD_PARAM: {
+      size_t parameter = input->read_uleb();
+      if (!input->ok) {
+        return {};
+      }
+      return {PointsToOperation(op_kind, parameter)};
+    }
+    case PTS_IGET:
+    case PTS_SGET:
+    case PTS_IPUT:
+    case PTS_SPUT: {
+      DexType* container = read_type(input);
+      auto name = read_string(input);
+      DexType* type = read_type(input);
+      if (!input->ok) {
+        return {};
+      }
+      return {PointsToOperation(
+          op_kind,
+          DexField::make_field(container, DexString::make_string(*name),
+                               type))};
+    }
+    case PTS_IGET_SPECIAL:
+    case PTS_IPUT_SPECIAL: {
+      uint32_t edge = input->read_uleb();
+      if (!input->ok || edge != PTS_ARRAY_ELEMENT) {
+        return {};
+      }
+      return {PointsToOperation(op_kind, PTS_ARRAY_ELEMENT)};
+    }
+    case PTS_INVOKE_VIRTUAL:
+    case PTS_INVOKE_SUPER:
+    case PTS_INVOKE_DIRECT:
+    case PTS_INVOKE_INTERFACE:
+    case PTS_INVOKE_STATIC: {
+      DexMethodRef* dex_method = read_method(input);
+      if (dex_method == nullptr) {
+        return {};
+      }
+      return {PointsToOperation(op_kind, dex_method)};
+    }
+    }
+    return {};
+  }
+
+  boost::optional<PointsToMethodSemantics> read_method_semantics(
+      Reader* input) const {
+    DexMethodRef* dex_method = read_method(input);
+    uint32_t kind = input->read_uleb();
+    uint32_t var_counter = input->read_uleb();
+    uint32_t action_count = input->read_uleb();
+    if (!input->ok || kind > PTS_STUB) {
+      return {};
+    }
+    // Don't trust the count for the reservation, the record is smaller than
+    // that many actions if it is truncated.
+    PointsToMethodSemantics semantics(
+        dex_method, static_cast<MethodKind>(kind), var_counter,
+        std::min<size_t>(action_count, input->end - input->pos));
+    std::vector<std::pair<int32_t, PointsToVariable>> arguments;
+    for (uint32_t i = 0; i < action_count; ++i) {
+      auto operation = read_operation(input);
+      uint32_t argument_count = input->read_uleb();
+      if (!operation || !input->ok) {
+        return {};
+      }
+      arguments.clear();
+      for (uint32_t j = 0; j < argument_count && input->ok; ++j) {
+        int32_t key = input->read_sleb();
+        int32_t var_id = input->read_sleb();
+        // The arguments are written in key order, which rules out the
+        // duplicate bindings that PointsToAction asserts against.
+        if (!arguments.empty() && key <= arguments.back().first) {
+          return {};
+        }
+        arguments.emplace_back(key, PointsToVariable(var_id));
+      }
+      if (!input->ok) {
+        return {};
+      }
+      semantics.add(PointsToAction(*operation, arguments));
+    }
+    if (input->pos != input->end) {
+      return {};
+    }
+    return semantics;
+  }
+
+  std::vector<std::string> m_strings;
+  std::unordered_map<std::string, uint32_t> m_string_ids;
+};
+
+} // namespace pts_impl
+
 PointsToSemantics::PointsToSemantics(const Scope& scope, bool generate_stubs)
     : m_generate_stubs(generate_stubs), m_type_system(scope) {
   // We size the hash table so as to fit all the methods in scope.
@@ -1577,8 +2001,28 @@ PointsToSemantics::PointsToSemantics(const Scope& scope, bool generate_stubs)
 }
 
 void PointsToSemantics::load_stubs(const std::string& file_name) {
-  std::ifstream file_input(file_name);
-  s_expr_istream s_expr_input(file_input);
+  std::ifstream file_input(file_name, std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(file_input)),
+                   std::istreambuf_iterator<char>());
+  auto add_stub = [this](const PointsToMethodSemantics& semantics) {
+    DexMethodRef* dex_method = semantics.get_method();
+    auto it = m_method_semantics.find(dex_method);
+    if (it == m_method_semantics.end()) {
+      m_method_semantics.emplace(dex_method, semantics);
+    } else {
+      TRACE(PTA, 2, "Collision with stub for method %s", SHOW(dex_method));
+    }
+  };
+  if (pts_impl::BinaryStubCodec::has_magic(data)) {
+    auto stubs_opt = pts_impl::BinaryStubCodec::read(data);
+    always_assert_log(
+        stubs_opt, "Malformed binary stub file %s\n", file_name.c_str());
+    for (const auto& semantics : *stubs_opt) {
+      add_stub(semantics);
+    }
+    return;
+  }
+  s_expr_buffer_istream s_expr_input(data.data(), data.size());
   while (s_expr_input.good()) {
     s_expr expr;
     s_expr_input >> expr;
@@ -1590,16 +2034,26 @@ void PointsToSemantics::load_stubs(const std::string& file_name) {
     auto semantics_opt = PointsToMethodSemantics::from_s_expr(expr);
     always_assert_log(
         semantics_opt, "Couldn't parse S-expression: %s\n", expr.str().c_str());
-    DexMethodRef* dex_method = semantics_opt->get_method();
-    auto it = m_method_semantics.find(dex_method);
-    if (it == m_method_semantics.end()) {
-      m_method_semantics.emplace(dex_method, *semantics_opt);
-    } else {
-      TRACE(PTA, 2, "Collision with stub for method %s", SHOW(dex_method));
-    }
+    add_stub(*semantics_opt);
   }
 }
 
+void PointsToSemantics::save_stubs(const std::string& file_name) const {
+  std::vector<const PointsToMethodSemantics*> semantics;
+  semantics.reserve(m_method_semantics.size());
+  for (const auto& entry : m_method_semantics) {
+    semantics.push_back(&entry.second);
+  }
+  std::sort(semantics.begin(), semantics.end(),
+            [](const PointsToMethodSemantics* s1,
+               const PointsToMethodSemantics* s2) {
+              return compare_dexmethods(s1->get_method(), s2->get_method());
+            });
+  std::ofstream file_output(file_name, std::ios::binary);
+  pts_impl::BinaryStubCodec::write(semantics, file_output);
+  always_assert_log(file_output, "Couldn't write %s\n", file_name.c_str());
+}
+
 boost::optional<PointsToMethodSemantics*>
 PointsToSemantics::get_method_semantics(DexMethodRef* dex_method) {
   auto entry = m_method_semantics.find(dex_method);
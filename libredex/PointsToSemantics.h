@@ -92,9 +92,13 @@
  * code.
  */
 
-// Forward declaration.
+// Forward declarations.
 class PointsToSemantics;
 
+namespace pts_impl {
+class BinaryStubCodec;
+} // namespace pts_impl
+
 /*
  * A points-to variable denotes a set of abstract object instances. It is
  * uniquely identified by a positive number.
@@ -132,6 +136,7 @@ class PointsToVariable final {
   int32_t m_id;
 
   friend class PointsToMethodSemantics;
+  friend class pts_impl::BinaryStubCodec;
   friend size_t hash_value(const PointsToVariable&);
   friend bool operator==(const PointsToVariable&, const PointsToVariable&);
   friend bool operator<(const PointsToVariable&, const PointsToVariable&);
@@ -429,6 +434,8 @@ class PointsToAction final {
   // operation (like the left-hand side of an assignment operation) have a
   // negative index.
   boost::container::flat_map<int32_t, PointsToVariable> m_arguments;
+
+  friend class pts_impl::BinaryStubCodec;
 };
 
 std::ostream& operator<<(std::ostream& o, const PointsToAction& a);
@@ -493,6 +500,7 @@ class PointsToMethodSemantics {
   size_t m_variable_counter;
   std::vector<PointsToAction> m_points_to_actions;
 
+  friend class pts_impl::BinaryStubCodec;
   friend std::ostream& operator<<(std::ostream&,
                                   const PointsToMethodSemantics&);
 };
@@ -528,12 +536,22 @@ class PointsToSemantics final {
   explicit PointsToSemantics(const Scope& scope, bool generate_stubs = false);
 
   /*
-   * The stubs are stored in the specified text file as S-expressions. In case
-   * of a collision between a method in the APK and a stub, the stub is
-   * discarded.
+   * The stubs are stored in the specified file, either as S-expressions or in
+   * the binary format written by `save_stubs`, which is detected
+   * automatically. In case of a collision between a method in the APK and a
+   * stub, the stub is discarded.
    */
   void load_stubs(const std::string& file_name);
 
+  /*
+   * Writes the semantics of all methods to the specified file in a compact
+   * binary format, which loads much faster than S-expressions: all names are
+   * stored once in a string table, and each method is a length-prefixed
+   * record of LEB128-encoded integers, so that records can be decoded in
+   * parallel. Methods are written in a deterministic order.
+   */
+  void save_stubs(const std::string& file_name) const;
+
   iterator begin() { return m_method_semantics.begin(); }
 
   iterator end() { return m_method_semantics.end(); }
@@ -123,6 +123,10 @@ class KeepSpecSet {
 
   void erase_if(const std::function<bool(const KeepSpec&)>&);
 
+  // Moves the rules of :other that are not already in this set to its end,
+  // preserving their order.
+  void merge(KeepSpecSet&& other);
+
  private:
   std::vector<KeepSpec*> m_ordered;
   std::unordered_set<std::unique_ptr<KeepSpec>,
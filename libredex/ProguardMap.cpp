@@ -7,9 +7,14 @@
 
 #include "ProguardMap.h"
 
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IRCode.h"
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -212,20 +217,98 @@ bool is_maybe_proguard_generated_member(const std::string& s) {
   }
   return false;
 }
+
+// Calls `fn` on each line in [begin, end), as std::getline would split them.
+template <typename Fn>
+void for_each_line(const char* begin, const char* end, const Fn& fn) {
+  std::string line;
+  while (begin < end) {
+    auto* eol = std::find(begin, end, '\n');
+    line.assign(begin, eol);
+    fn(begin, line);
+    begin = eol == end ? end : eol + 1;
+  }
+}
+
+bool parse_class_line(const std::string& line,
+                      std::string& cls,
+                      std::string& new_cls) {
+  std::string classname;
+  std::string newname;
+  auto p = line.c_str();
+  if (!id(p, classname)) return false;
+  if (!literal(p, " -> ")) return false;
+  if (!id(p, newname)) return false;
+  cls = convert_type(classname);
+  new_cls = convert_type(newname);
+  return true;
+}
+
+// The map is parsed in this many tasks per thread, fewer for small maps.
+constexpr size_t kTasksPerThread = 8;
+constexpr size_t kMinTaskBytes = 1 << 16;
 } // namespace
 
+struct ProguardMap::ParsedMembers {
+  LazyMap::Entries fields;
+  LazyMap::Entries obf_fields;
+  LazyMap::Entries obf_untyped_fields;
+  LazyMap::Entries methods;
+  LazyMap::Entries obf_methods;
+  LazyMap::Entries obf_untyped_methods;
+  std::vector<std::pair<std::string, std::unique_ptr<ProguardLineRange>>>
+      lines;
+  std::vector<std::string> coalesced_interfaces;
+};
+
+void ProguardMap::LazyMap::append(Entries&& entries) {
+  m_size += entries.size();
+  if (m_entries.empty()) {
+    m_entries = std::move(entries);
+  } else {
+    m_entries.insert(m_entries.end(),
+                     std::make_move_iterator(entries.begin()),
+                     std::make_move_iterator(entries.end()));
+  }
+}
+
+const std::string* ProguardMap::LazyMap::find(const std::string& key) const {
+  std::call_once(m_built, [this]() {
+    m_map.reserve(m_entries.size());
+    for (auto& entry : m_entries) {
+      m_map[std::move(entry.first)] = std::move(entry.second);
+    }
+    Entries().swap(m_entries);
+  });
+  auto it = m_map.find(key);
+  return it == m_map.end() ? nullptr : &it->second;
+}
+
+ProguardMap::ProguardMap(std::istream& is) {
+  std::string data((std::istreambuf_iterator<char>(is)),
+                   std::istreambuf_iterator<char>());
+  parse_proguard_map(data.data(), data.size());
+}
+
 ProguardMap::ProguardMap(const std::string& filename, bool use_new_rename_map) {
   if (filename.empty()) {
     return;
   }
   Timer t("Parsing proguard map");
-  std::ifstream fp(filename);
-  always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
+  {
+    std::ifstream fp(filename);
+    always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
+    // An empty file cannot be mapped.
+    if (fp.peek() == std::ifstream::traits_type::eof()) {
+      return;
+    }
+  }
+  auto file = RedexMappedFile::open(filename);
 
   if (use_new_rename_map) {
-    parse_full_map(fp);
+    parse_full_map(file.const_data(), file.size());
   } else {
-    parse_proguard_map(fp);
+    parse_proguard_map(file.const_data(), file.size());
   }
 }
 
@@ -234,11 +317,13 @@ std::string ProguardMap::translate_class(const std::string& cls) const {
 }
 
 std::string ProguardMap::translate_field(const std::string& field) const {
-  return find_or_same(field, m_fieldMap);
+  auto* translated = m_fieldMap.find(field);
+  return translated ? *translated : field;
 }
 
 std::string ProguardMap::translate_method(const std::string& method) const {
-  return find_or_same(method, m_methodMap);
+  auto* translated = m_methodMap.find(method);
+  return translated ? *translated : method;
 }
 
 std::string ProguardMap::deobfuscate_class(const std::string& cls) const {
@@ -246,12 +331,17 @@ std::string ProguardMap::deobfuscate_class(const std::string& cls) const {
 }
 
 std::string ProguardMap::deobfuscate_field(const std::string& field) const {
-  return find_or_same(find_or_same(field, m_obfFieldMap), m_obfUntypedFieldMap);
+  auto* typed = m_obfFieldMap.find(field);
+  const auto& key = typed ? *typed : field;
+  auto* untyped = m_obfUntypedFieldMap.find(key);
+  return untyped ? *untyped : key;
 }
 
 std::string ProguardMap::deobfuscate_method(const std::string& method) const {
-  return find_or_same(find_or_same(method, m_obfMethodMap),
-                      m_obfUntypedMethodMap);
+  auto* typed = m_obfMethodMap.find(method);
+  const auto& key = typed ? *typed : method;
+  auto* untyped = m_obfUntypedMethodMap.find(key);
+  return untyped ? *untyped : key;
 }
 
 std::vector<ProguardMap::Frame> ProguardMap::deobfuscate_frame(
@@ -286,53 +376,142 @@ ProguardLineRangeVector& ProguardMap::method_lines(
   return m_obfMethodLinesMap.at(pg_impl::lines_key(obfuscated_method));
 }
 
-void ProguardMap::parse_proguard_map(std::istream& fp) {
-  std::string line;
-  while (std::getline(fp, line)) {
-    parse_class(line);
-  }
-  fp.clear();
-  fp.seekg(0);
-  assert_log(!fp.fail(), "Can't use ProguardMap with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class(line)) {
-      continue;
+void ProguardMap::parse_proguard_map(const char* data, size_t size) {
+  // Members are translated with the class map, so all classes are parsed
+  // first. A class line starts the section of its members. Both passes run
+  // in parallel on chunks of whole lines, or of whole sections.
+  const char* end = data + size;
+  auto num_tasks =
+      std::max<size_t>(1, std::min(redex_parallel::default_num_threads() *
+                                       kTasksPerThread,
+                                   size / kMinTaskBytes));
+  std::vector<const char*> chunk_starts;
+  for (size_t i = 0; i < num_tasks; ++i) {
+    const char* start = data + size * i / num_tasks;
+    if (i > 0) {
+      start = std::find(start - 1, end, '\n');
+      start = start == end ? end : start + 1;
     }
-    if (parse_field(line)) {
-      continue;
-    }
-    if (parse_method(line)) {
-      continue;
+    if (chunk_starts.empty() || start > chunk_starts.back()) {
+      chunk_starts.push_back(start);
     }
-    if (comment(line)) {
-      continue;
-    }
-    not_reached_log("Bogus line encountered in proguard map: %s\n",
-                    line.c_str());
   }
-}
+  chunk_starts.push_back(end);
 
-void ProguardMap::parse_full_map(std::istream& fp) {
-  std::string line;
-  fp.seekg(0);
-  assert_log(!fp.fail(),
-             "Can't use the full rename map with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class_full_format(line)) {
-      continue;
-    }
-    if (parse_field_full_format(line)) {
-      continue;
-    }
-    if (parse_method_full_format(line)) {
-      continue;
+  struct ClassLine {
+    const char* start;
+    std::string cls;
+    std::string new_cls;
+  };
+  std::vector<std::vector<ClassLine>> chunk_classes(chunk_starts.size() - 1);
+  std::vector<size_t> chunks(chunk_classes.size());
+  std::iota(chunks.begin(), chunks.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t c) {
+        for_each_line(chunk_starts[c], chunk_starts[c + 1],
+                      [&](const char* start, const std::string& line) {
+                        ClassLine class_line{start, "", ""};
+                        if (parse_class_line(line, class_line.cls,
+                                             class_line.new_cls)) {
+                          chunk_classes[c].push_back(std::move(class_line));
+                        }
+                      });
+      },
+      chunks);
+
+  // The members before the first class, if any, belong to no class.
+  std::vector<ClassLine> sections{{data, "", ""}};
+  for (auto& classes : chunk_classes) {
+    for (auto& class_line : classes) {
+      m_classMap[class_line.cls] = class_line.new_cls;
+      m_obfClassMap[class_line.new_cls] = class_line.cls;
+      sections.push_back(std::move(class_line));
     }
-    if (comment(line)) {
-      continue;
+  }
+
+  // Group consecutive sections into tasks of about the same size.
+  std::vector<size_t> task_starts{0};
+  for (size_t i = 1; i < sections.size(); ++i) {
+    size_t task_bytes = sections[i].start - sections[task_starts.back()].start;
+    if (task_bytes * num_tasks >= size) {
+      task_starts.push_back(i);
     }
-    not_reached_log("Bogus line encountered in the full map: %s\n",
-                    line.c_str());
   }
+  task_starts.push_back(sections.size());
+
+  std::vector<ParsedMembers> parsed(task_starts.size() - 1);
+  std::vector<size_t> tasks(parsed.size());
+  std::iota(tasks.begin(), tasks.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t t) {
+        for (size_t i = task_starts[t]; i < task_starts[t + 1]; ++i) {
+          const auto& section = sections[i];
+          const char* section_end =
+              i + 1 < sections.size() ? sections[i + 1].start : end;
+          bool is_class_line = i > 0;
+          for_each_line(
+              section.start, section_end,
+              [&](const char*, const std::string& line) {
+                if (is_class_line) {
+                  is_class_line = false;
+                  return;
+                }
+                if (parse_field(line, section.cls, section.new_cls,
+                                parsed[t])) {
+                  return;
+                }
+                if (parse_method(line, section.cls, section.new_cls,
+                                 parsed[t])) {
+                  return;
+                }
+                if (comment(line)) {
+                  return;
+                }
+                not_reached_log("Bogus line encountered in proguard map: %s\n",
+                                line.c_str());
+              });
+        }
+      },
+      tasks);
+  for (auto& members : parsed) {
+    merge(std::move(members));
+  }
+}
+
+void ProguardMap::parse_full_map(const char* data, size_t size) {
+  ParsedMembers members;
+  for_each_line(
+      data, data + size, [&](const char*, const std::string& line) {
+        if (parse_class_full_format(line)) {
+          return;
+        }
+        if (parse_field_full_format(line, members)) {
+          return;
+        }
+        if (parse_method_full_format(line, members)) {
+          return;
+        }
+        if (comment(line)) {
+          return;
+        }
+        not_reached_log("Bogus line encountered in the full map: %s\n",
+                        line.c_str());
+      });
+  merge(std::move(members));
+}
+
+void ProguardMap::merge(ParsedMembers&& members) {
+  m_fieldMap.append(std::move(members.fields));
+  m_obfFieldMap.append(std::move(members.obf_fields));
+  m_obfUntypedFieldMap.append(std::move(members.obf_untyped_fields));
+  m_methodMap.append(std::move(members.methods));
+  m_obfMethodMap.append(std::move(members.obf_methods));
+  m_obfUntypedMethodMap.append(std::move(members.obf_untyped_methods));
+  for (auto& p : members.lines) {
+    m_obfMethodLinesMap[p.first].push_back(std::move(p.second));
+  }
+  m_pg_coalesced_interfaces.insert(members.coalesced_interfaces.begin(),
+                                   members.coalesced_interfaces.end());
 }
 
 bool ProguardMap::parse_class_full_format(const std::string& line) {
@@ -351,7 +530,8 @@ bool ProguardMap::parse_class_full_format(const std::string& line) {
   return true;
 }
 
-bool ProguardMap::parse_field_full_format(const std::string& line) {
+bool ProguardMap::parse_field_full_format(const std::string& line,
+                                          ParsedMembers& out) {
   std::string old_field_name;
   std::string new_field_name;
 
@@ -377,12 +557,13 @@ bool ProguardMap::parse_field_full_format(const std::string& line) {
   auto pgnew = new_field_name;
   auto pgold = old_field_name;
 
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
+  out.fields.emplace_back(pgold, pgnew);
+  out.obf_fields.emplace_back(pgnew, pgold);
   return true;
 }
 
-bool ProguardMap::parse_method_full_format(const std::string& line) {
+bool ProguardMap::parse_method_full_format(const std::string& line,
+                                           ParsedMembers& out) {
   std::string old_method_name;
   std::string new_method_name;
   auto p = line.c_str();
@@ -406,26 +587,15 @@ bool ProguardMap::parse_method_full_format(const std::string& line) {
 
   auto pgold = old_method_name;
   auto pgnew = new_method_name;
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
-  return true;
-}
-
-bool ProguardMap::parse_class(const std::string& line) {
-  std::string classname;
-  std::string newname;
-  auto p = line.c_str();
-  if (!id(p, classname)) return false;
-  if (!literal(p, " -> ")) return false;
-  if (!id(p, newname)) return false;
-  m_currClass = convert_type(classname);
-  m_currNewClass = convert_type(newname);
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
+  out.methods.emplace_back(pgold, pgnew);
+  out.obf_methods.emplace_back(pgnew, pgold);
   return true;
 }
 
-bool ProguardMap::parse_field(const std::string& line) {
+bool ProguardMap::parse_field(const std::string& line,
+                              const std::string& cls,
+                              const std::string& new_cls,
+                              ParsedMembers& out) const {
   std::string type;
   std::string fieldname;
   std::string newname;
@@ -440,27 +610,30 @@ bool ProguardMap::parse_field(const std::string& line) {
 
   auto ctype = convert_type(type);
   auto xtype = translate_type(ctype, *this);
-  auto pgnew = convert_field(m_currNewClass, xtype, newname);
-  auto pgnew_notype = convert_field(m_currNewClass, "", newname);
-  auto pgold = convert_field(m_currClass, ctype, fieldname);
+  auto pgnew = convert_field(new_cls, xtype, newname);
+  auto pgnew_notype = convert_field(new_cls, "", newname);
+  auto pgold = convert_field(cls, ctype, fieldname);
   // Record interfaces that are coalesced by Proguard.
   if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
     fprintf(stderr,
             "Type '%s' is touched by Proguard in '%s'\n",
             ctype.c_str(),
             pgold.c_str());
-    m_pg_coalesced_interfaces.insert(ctype);
+    out.coalesced_interfaces.push_back(ctype);
   }
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
-  m_obfUntypedFieldMap[pgnew_notype] = pgold;
+  out.fields.emplace_back(pgold, pgnew);
+  out.obf_fields.emplace_back(pgnew, pgold);
+  out.obf_untyped_fields.emplace_back(std::move(pgnew_notype), pgold);
   return true;
 }
 
-bool ProguardMap::parse_method(const std::string& line) {
+bool ProguardMap::parse_method(const std::string& line,
+                               const std::string& cls,
+                               const std::string& new_cls,
+                               ParsedMembers& out) const {
   std::string type;
   std::string methodname;
-  std::string classname = m_currClass;
+  std::string classname = cls;
   std::string old_args;
   std::string new_args;
   std::string newname;
@@ -501,13 +674,13 @@ bool ProguardMap::parse_method(const std::string& line) {
   auto old_rtype = convert_type(type);
   auto new_rtype = translate_type(old_rtype, *this);
   auto pgold = convert_method(classname, old_rtype, methodname, old_args);
-  auto pgnew = convert_method(m_currNewClass, new_rtype, newname, new_args);
-  auto pgnew_no_rtype = convert_method(m_currNewClass, "", newname, new_args);
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
-  m_obfUntypedMethodMap[pgnew_no_rtype] = pgold;
+  auto pgnew = convert_method(new_cls, new_rtype, newname, new_args);
+  auto pgnew_no_rtype = convert_method(new_cls, "", newname, new_args);
+  out.methods.emplace_back(pgold, pgnew);
+  out.obf_methods.emplace_back(pgnew, pgold);
+  out.obf_untyped_methods.emplace_back(std::move(pgnew_no_rtype), pgold);
   lines->original_name = pgold;
-  m_obfMethodLinesMap[pg_impl::lines_key(pgnew)].push_back(std::move(lines));
+  out.lines.emplace_back(pg_impl::lines_key(pgnew), std::move(lines));
   return true;
 }
 
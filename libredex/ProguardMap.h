@@ -9,9 +9,12 @@
 
 #include <cstddef>
 #include <fstream>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "DexClass.h"
 #include "ProguardLineRange.h"
@@ -53,7 +56,7 @@ struct ProguardMap {
   /**
    * Construct map from a given stream.
    */
-  explicit ProguardMap(std::istream& is) { parse_proguard_map(is); }
+  explicit ProguardMap(std::istream& is);
 
   /**
    * Translate un-obfuscated class name to obfuscated name.
@@ -112,41 +115,73 @@ struct ProguardMap {
   }
 
  private:
-  void parse_proguard_map(std::istream& fp);
-  void parse_full_map(std::istream& fp);
+  /**
+   * A table of the entries of one category, hashed on its first lookup, as
+   * most runs only look up a few of the categories. Later entries win, as
+   * with repeated assignment. Lookups may run concurrently with each other,
+   * but not with append.
+   */
+  class LazyMap {
+   public:
+    using Entries = std::vector<std::pair<std::string, std::string>>;
+
+    void append(Entries&& entries);
+    const std::string* find(const std::string& key) const;
+    bool empty() const { return m_size == 0; }
+
+   private:
+    mutable Entries m_entries;
+    size_t m_size{0};
+    mutable std::once_flag m_built;
+    mutable std::unordered_map<std::string, std::string> m_map;
+  };
+
+  // The parsed members of a part of the map, before they are merged.
+  struct ParsedMembers;
+
+  void parse_proguard_map(const char* data, size_t size);
+  void parse_full_map(const char* data, size_t size);
+  void merge(ParsedMembers&& members);
 
-  bool parse_class(const std::string& line);
-  bool parse_field(const std::string& line);
-  bool parse_method(const std::string& line);
+  bool parse_field(const std::string& line,
+                   const std::string& cls,
+                   const std::string& new_cls,
+                   ParsedMembers& out) const;
+  bool parse_method(const std::string& line,
+                    const std::string& cls,
+                    const std::string& new_cls,
+                    ParsedMembers& out) const;
 
   bool parse_class_full_format(const std::string& line);
-  bool parse_field_full_format(const std::string& line);
-  bool parse_method_full_format(const std::string& line);
+  bool parse_field_full_format(const std::string& line, ParsedMembers& out);
+  bool parse_method_full_format(const std::string& line, ParsedMembers& out);
 
  private:
-  // Unobfuscated to obfuscated maps
+  // Unobfuscated to obfuscated maps. Classes are needed while parsing the
+  // members, so that map is built eagerly.
   std::unordered_map<std::string, std::string> m_classMap;
-  std::unordered_map<std::string, std::string> m_fieldMap;
-  std::unordered_map<std::string, std::string> m_methodMap;
+  LazyMap m_fieldMap;
+  LazyMap m_methodMap;
 
   // Obfuscated to unobfuscated maps from proguard
   std::unordered_map<std::string, std::string> m_obfClassMap;
-  std::unordered_map<std::string, std::string> m_obfFieldMap;
-  std::unordered_map<std::string, std::string> m_obfMethodMap;
+  LazyMap m_obfFieldMap;
+  LazyMap m_obfMethodMap;
 
   // Field map for reflection analysis when type is unknown
   // Stores Lcom/facebook/Class;.field -> original name without class name
-  std::unordered_map<std::string, std::string> m_obfUntypedFieldMap;
+  LazyMap m_obfUntypedFieldMap;
 
   // Method map for reflection analysis when return type is unknown
   // Stores Lcom/facebook/Class;.method(II) -> original name without class name
-  std::unordered_map<std::string, std::string> m_obfUntypedMethodMap;
+  LazyMap m_obfUntypedMethodMap;
 
   std::unordered_map<std::string, ProguardLineRangeVector> m_obfMethodLinesMap;
 
   // Interfaces that are (most likely) coalesced by Proguard.
   std::unordered_set<std::string> m_pg_coalesced_interfaces;
 
+  // The current class while parsing the full format.
   std::string m_currClass;
   std::string m_currNewClass;
 };
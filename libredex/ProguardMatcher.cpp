@@ -9,6 +9,7 @@
 #include <boost/regex.hpp>
 #include <iostream>
 #include <mutex>
+#include <set>
 #include <sstream>
 #include <thread>
 #include <unordered_set>
@@ -231,10 +232,6 @@ class KeepRuleMatcher {
         m_keep_rule(keep_rule),
         m_regex_map(regex_map) {}
 
-  ~KeepRuleMatcher() {
-    TRACE(PGR, 3, "%s matched %lu classes and %lu members",
-          show_keep(m_keep_rule).c_str(), m_class_matches, m_member_matches);
-  }
 
   void keep_processor(DexClass*);
 
@@ -302,6 +299,10 @@ class KeepRuleMatcher {
     return m_class_matches == 0 && m_member_matches == 0;
   }
 
+  size_t class_matches() const { return m_class_matches; }
+
+  size_t member_matches() const { return m_member_matches; }
+
  private:
   void maybe_warn(const std::string& warning) {
     std::unique_lock<std::mutex> lock{m_warn_mutex};
@@ -322,6 +323,58 @@ class KeepRuleMatcher {
   std::unordered_set<std::string> m_already_warned;
 };
 
+void trace_matches(const KeepSpec& keep_rule,
+                   size_t class_matches,
+                   size_t member_matches) {
+  TRACE(PGR, 3, "%s matched %zu classes and %zu members",
+        show_keep(keep_rule).c_str(), class_matches, member_matches);
+}
+
+/*
+ * The rules that need to be matched against every class, indexed by the
+ * literal prefix of their class name pattern, so that each class is only
+ * matched against the rules whose prefix its name starts with.
+ */
+class KeepRuleIndex {
+ public:
+  explicit KeepRuleIndex(const std::vector<const KeepSpec*>& keep_rules) {
+    for (size_t i = 0; i < keep_rules.size(); ++i) {
+      auto prefix = proguard_parser::type_regex_literal_prefix(
+          proguard_parser::convert_wildcard_type(
+              keep_rules[i]->class_spec.className));
+      // Every class name starts with "L".
+      if (prefix.size() <= 1) {
+        m_unindexed.push_back(i);
+        continue;
+      }
+      m_prefix_lengths.insert(prefix.size());
+      m_by_prefix[prefix].push_back(i);
+    }
+  }
+
+  // The indices of the rules that may match a class named :name, in
+  // increasing order.
+  std::vector<size_t> candidates(const std::string& name) const {
+    std::vector<size_t> result = m_unindexed;
+    for (auto length : m_prefix_lengths) {
+      if (length > name.size()) {
+        break;
+      }
+      auto it = m_by_prefix.find(name.substr(0, length));
+      if (it != m_by_prefix.end()) {
+        result.insert(result.end(), it->second.begin(), it->second.end());
+      }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+  }
+
+ private:
+  std::unordered_map<std::string, std::vector<size_t>> m_by_prefix;
+  std::set<size_t> m_prefix_lengths;
+  std::vector<size_t> m_unindexed;
+};
+
 class ProguardMatcher {
  public:
   ProguardMatcher(const ProguardMap& pg_map,
@@ -801,27 +854,8 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
     }
   };
 
-  // We only parallelize if keep_rule needs to be applied to all classes.
-  auto wq = workqueue_foreach<const KeepSpec*>([&](const KeepSpec* keep_rule) {
-    RegexMap regex_map;
-    ClassMatcher class_match(*keep_rule);
-    KeepRuleMatcher rule_matcher(rule_type, *keep_rule, regex_map);
-
-    for (const auto& cls : m_classes) {
-      process_single_keep(class_match, rule_matcher, cls);
-    }
-    if (process_external) {
-      for (const auto& cls : m_external_classes) {
-        process_single_keep(class_match, rule_matcher, cls);
-      }
-    }
-
-    if (rule_matcher.is_unused()) {
-      m_unused_rules.insert(keep_rule);
-    }
-  });
-
   RegexMap regex_map;
+  std::vector<const KeepSpec*> slow_rules;
   for (const auto& keep_rule_ptr : keep_rules) {
     const auto& keep_rule = *keep_rule_ptr;
     ClassMatcher class_match(keep_rule);
@@ -832,6 +866,8 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
       DexClass* cls = find_single_class(className);
       KeepRuleMatcher rule_matcher(rule_type, keep_rule, regex_map);
       process_single_keep(class_match, rule_matcher, cls);
+      trace_matches(keep_rule, rule_matcher.class_matches(),
+                    rule_matcher.member_matches());
       if (rule_matcher.is_unused()) {
         m_unused_rules.insert(&keep_rule);
       }
@@ -850,6 +886,8 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
         for (auto const* type : children) {
           process_single_keep(class_match, rule_matcher, type_class(type));
         }
+        trace_matches(keep_rule, rule_matcher.class_matches(),
+                      rule_matcher.member_matches());
         if (rule_matcher.is_unused()) {
           m_unused_rules.insert(&keep_rule);
         }
@@ -858,11 +896,76 @@ void ProguardMatcher::process_keep(const KeepSpecSet& keep_rules,
     }
 
     TRACE(PGR, 2, "Slow rule: %s", show_keep(keep_rule).c_str());
-    // Otherwise, it might take a longer time. Add to the work queue.
-    wq.add_item(&keep_rule);
+    // Otherwise, it might take a longer time. It has to be matched against
+    // all classes.
+    slow_rules.push_back(&keep_rule);
+  }
+
+  if (slow_rules.empty()) {
+    return;
   }
 
+  // Matching state of the slow rules, created lazily by each worker for the
+  // rules it needs.
+  struct RuleMatchers {
+    RuleMatchers(RuleType rule_type,
+                 const KeepSpec& keep_rule,
+                 RegexMap& regex_map)
+        : class_match(keep_rule),
+          rule_matcher(rule_type, keep_rule, regex_map) {}
+    ClassMatcher class_match;
+    KeepRuleMatcher rule_matcher;
+  };
+  struct WorkerState {
+    RegexMap regex_map;
+    std::unordered_map<size_t, std::unique_ptr<RuleMatchers>> matchers;
+  };
+
+  // Each class is processed by a single worker, which applies the rules that
+  // may match it in rule order.
+  KeepRuleIndex index(slow_rules);
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<WorkerState> worker_states(num_threads);
+  auto wq = workqueue_foreach<DexClass*>(
+      [&](sparta::SpartaWorkerState<DexClass*>* worker, DexClass* cls) {
+        auto& state = worker_states.at(worker->worker_id());
+        for (auto i : index.candidates(cls->get_deobfuscated_name())) {
+          auto& matchers = state.matchers[i];
+          if (!matchers) {
+            matchers = std::make_unique<RuleMatchers>(
+                rule_type, *slow_rules[i], state.regex_map);
+          }
+          process_single_keep(matchers->class_match, matchers->rule_matcher,
+                              cls);
+        }
+      },
+      num_threads);
+  for (auto* cls : m_classes) {
+    wq.add_item(cls);
+  }
+  if (process_external) {
+    for (auto* cls : m_external_classes) {
+      wq.add_item(cls);
+    }
+  }
   wq.run_all();
+
+  // Merge the per-worker match counts.
+  for (size_t i = 0; i < slow_rules.size(); ++i) {
+    size_t class_matches = 0;
+    size_t member_matches = 0;
+    for (const auto& state : worker_states) {
+      auto it = state.matchers.find(i);
+      if (it != state.matchers.end()) {
+        class_matches += it->second->rule_matcher.class_matches();
+        member_matches += it->second->rule_matcher.member_matches();
+      }
+    }
+    trace_matches(*slow_rules[i], class_matches, member_matches);
+    if (class_matches == 0 && member_matches == 0) {
+      m_unused_rules.insert(slow_rules[i]);
+    }
+  }
 }
 
 void ProguardMatcher::process_proguard_rules(
@@ -6,7 +6,10 @@
  */
 
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "Macros.h"
@@ -15,6 +18,7 @@
 #include "ProguardParser.h"
 #include "ProguardRegex.h"
 #include "ReadMaybeMapped.h"
+#include "WorkQueue.h"
 
 namespace keep_rules {
 namespace proguard_parser {
@@ -1038,6 +1042,49 @@ void parse(const boost::string_view& config,
   }
 }
 
+template <class T>
+void append(std::vector<T>&& from, std::vector<T>* into) {
+  into->insert(into->end(),
+               std::make_move_iterator(from.begin()),
+               std::make_move_iterator(from.end()));
+}
+
+// Merges :from, the configuration of a file, into :into, as if the file had
+// been parsed into :into right after its current contents.
+void merge(ProguardConfiguration&& from, ProguardConfiguration* into) {
+  into->ok = from.ok;
+  append(std::move(from.includes), &into->includes);
+  if (!from.basedirectory.empty()) {
+    into->basedirectory = from.basedirectory;
+  }
+  append(std::move(from.injars), &into->injars);
+  append(std::move(from.outjars), &into->outjars);
+  append(std::move(from.libraryjars), &into->libraryjars);
+  append(std::move(from.printmapping), &into->printmapping);
+  append(std::move(from.printconfiguration), &into->printconfiguration);
+  append(std::move(from.printseeds), &into->printseeds);
+  append(std::move(from.printusage), &into->printusage);
+  append(std::move(from.keepdirectories), &into->keepdirectories);
+  into->shrink &= from.shrink;
+  into->optimize &= from.optimize;
+  into->allowaccessmodification |= from.allowaccessmodification;
+  into->dontobfuscate |= from.dontobfuscate;
+  into->dontusemixedcaseclassnames |= from.dontusemixedcaseclassnames;
+  into->dontpreverify |= from.dontpreverify;
+  into->verbose |= from.verbose;
+  if (!from.target_version.empty()) {
+    into->target_version = from.target_version;
+  }
+  into->keep_rules.merge(std::move(from.keep_rules));
+  into->assumenosideeffects_rules.merge(
+      std::move(from.assumenosideeffects_rules));
+  into->whyareyoukeeping_rules.merge(std::move(from.whyareyoukeeping_rules));
+  append(std::move(from.optimization_filters), &into->optimization_filters);
+  append(std::move(from.keepattributes), &into->keepattributes);
+  append(std::move(from.dontwarn), &into->dontwarn);
+  append(std::move(from.keeppackagenames), &into->keeppackagenames);
+}
+
 } // namespace
 
 void parse(std::istream& config,
@@ -1052,16 +1099,62 @@ void parse_file(const std::string& filename, ProguardConfiguration* pg_config) {
   redex::read_file_with_contents(filename, [&](const char* data, size_t s) {
     boost::string_view view(data, s);
     parse(view, pg_config, filename);
-    // Parse the included files.
-    for (const auto& included_filename : pg_config->includes) {
-      if (pg_config->already_included.find(included_filename) !=
-          pg_config->already_included.end()) {
+  });
+
+  // Parse the included files, and the ones they include in turn, one level of
+  // inclusion at a time. The files of a level are parsed concurrently, each
+  // into its own configuration.
+  std::unordered_map<std::string, std::string> contents;
+  std::unordered_map<std::string, std::unique_ptr<ProguardConfiguration>>
+      fragments;
+  std::vector<std::string> level = pg_config->includes;
+  while (!level.empty()) {
+    std::vector<std::string> filenames;
+    for (const auto& included_filename : level) {
+      if (pg_config->already_included.count(included_filename) ||
+          !fragments.emplace(included_filename, nullptr).second) {
         continue;
       }
-      pg_config->already_included.emplace(included_filename);
-      parse_file(included_filename, pg_config);
+      redex::read_file_with_contents(
+          included_filename, [&](const char* data, size_t s) {
+            contents[included_filename].assign(data, s);
+          });
+      fragments[included_filename] = std::make_unique<ProguardConfiguration>();
+      filenames.push_back(included_filename);
     }
-  });
+    workqueue_run<std::string>(
+        [&](const std::string& included_filename) {
+          parse(boost::string_view(contents.at(included_filename)),
+                fragments.at(included_filename).get(), included_filename);
+        },
+        filenames);
+    level.clear();
+    for (const auto& included_filename : filenames) {
+      const auto& includes = fragments.at(included_filename)->includes;
+      level.insert(level.end(), includes.begin(), includes.end());
+    }
+  }
+
+  // Merge them depth-first, in include order, as if each file had been parsed
+  // where it is included. Files whose contents were already merged, e.g. the
+  // same consumer rules shipped by several libraries, are skipped: they would
+  // only add duplicate rules.
+  std::unordered_set<std::string> merged_contents;
+  std::function<void(const std::vector<std::string>&)> merge_included =
+      [&](const std::vector<std::string>& includes) {
+        for (const auto& included_filename : includes) {
+          if (!pg_config->already_included.emplace(included_filename).second ||
+              !merged_contents.emplace(contents.at(included_filename))
+                   .second) {
+            continue;
+          }
+          auto& fragment = fragments.at(included_filename);
+          auto nested_includes = fragment->includes;
+          merge(std::move(*fragment), pg_config);
+          merge_included(nested_includes);
+        }
+      };
+  merge_included(std::vector<std::string>(pg_config->includes));
 }
 
 void remove_blocklisted_rules(ProguardConfiguration* pg_config) {
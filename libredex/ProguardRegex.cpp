@@ -200,5 +200,19 @@ std::string convert_wildcard_type(const std::string& typ) {
   return wildcard_descriptor;
 }
 
+// Return a prefix that every name matched by the regex formed by
+// form_type_regex(descriptor) starts with, or the empty string if there is
+// no such prefix, or if the descriptor uses regex syntax we don't model.
+// Example: "Lcom/facebook/*/Delta;" -> "Lcom/facebook/"
+std::string type_regex_literal_prefix(const std::string& descriptor) {
+  // Negations, alternations and quantifiers may change what the characters
+  // before them match.
+  if (descriptor.find_first_of("!,|+{}^\\") != std::string::npos) {
+    return "";
+  }
+  auto end = descriptor.find_first_of("*?%.");
+  return descriptor.substr(0, end);
+}
+
 } // namespace proguard_parser
 } // namespace keep_rules
@@ -16,6 +16,7 @@ std::string form_member_regex(const std::string& proguard_regex);
 std::string form_type_regex(const std::string& proguard_regex);
 bool has_special_char(const std::string& proguard_regex);
 std::string convert_wildcard_type(const std::string& typ);
+std::string type_regex_literal_prefix(const std::string& descriptor);
 
 } // namespace proguard_parser
 } // namespace keep_rules
@@ -7,6 +7,7 @@
 
 #include "Purity.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "ConfigFiles.h"
@@ -887,3 +888,92 @@ bool has_implementor(const method_override_graph::Graph* method_override_graph,
   }
   return found_implementor;
 }
+
+namespace purity {
+
+std::shared_ptr<const method_override_graph::Graph>
+AnalysisCache::get_method_override_graph(const Scope& scope) {
+  if (m_method_override_graph) {
+    ++m_hits;
+  } else {
+    m_method_override_graph = method_override_graph::build_graph(scope);
+  }
+  return m_method_override_graph;
+}
+
+AnalysisCache::Key AnalysisCache::make_key(
+    const method_override_graph::Graph* method_override_graph,
+    const std::unordered_set<DexMethodRef*>& pure_methods) {
+  std::vector<const DexMethodRef*> methods(pure_methods.begin(),
+                                           pure_methods.end());
+  std::sort(methods.begin(), methods.end());
+  return Key(method_override_graph, std::move(methods));
+}
+
+const std::unordered_map<const DexMethod*, CseUnorderedLocationSet>&
+AnalysisCache::get_conditionally_pure_methods(
+    const Scope& scope,
+    const method_override_graph::Graph* method_override_graph,
+    const std::unordered_set<DexMethodRef*>& pure_methods,
+    size_t* iterations) {
+  auto key = make_key(method_override_graph, pure_methods);
+  auto it = m_conditionally_pure_methods.find(key);
+  if (it != m_conditionally_pure_methods.end()) {
+    ++m_hits;
+  } else {
+    Entry<std::unordered_map<const DexMethod*, CseUnorderedLocationSet>> entry;
+    entry.iterations = compute_conditionally_pure_methods(
+        scope, method_override_graph, pure_methods, &entry.result);
+    it = m_conditionally_pure_methods.emplace(std::move(key), std::move(entry))
+             .first;
+  }
+  *iterations = it->second.iterations;
+  return it->second.result;
+}
+
+const std::unordered_set<const DexMethod*>&
+AnalysisCache::get_no_side_effects_methods(
+    const Scope& scope,
+    const method_override_graph::Graph* method_override_graph,
+    const std::unordered_set<DexMethodRef*>& pure_methods,
+    size_t* iterations) {
+  auto key = make_key(method_override_graph, pure_methods);
+  auto it = m_no_side_effects_methods.find(key);
+  if (it != m_no_side_effects_methods.end()) {
+    ++m_hits;
+  } else {
+    Entry<std::unordered_set<const DexMethod*>> entry;
+    entry.iterations = compute_no_side_effects_methods(
+        scope, method_override_graph, pure_methods, &entry.result);
+    it = m_no_side_effects_methods.emplace(std::move(key), std::move(entry))
+             .first;
+  }
+  *iterations = it->second.iterations;
+  return it->second.result;
+}
+
+const std::unordered_map<const DexMethod*, CseUnorderedLocationSet>&
+AnalysisCache::get_method_written_locations(
+    const Scope& scope,
+    const method_override_graph::Graph* method_override_graph,
+    const std::unordered_set<DexMethodRef*>& safe_methods,
+    std::function<boost::optional<LocationsAndDependencies>(DexMethod*)>
+        init_func,
+    size_t* iterations) {
+  auto key = make_key(method_override_graph, safe_methods);
+  auto it = m_method_written_locations.find(key);
+  if (it != m_method_written_locations.end()) {
+    ++m_hits;
+  } else {
+    Entry<std::unordered_map<const DexMethod*, CseUnorderedLocationSet>> entry;
+    entry.iterations =
+        compute_locations_closure(scope, method_override_graph,
+                                  std::move(init_func), &entry.result);
+    it = m_method_written_locations.emplace(std::move(key), std::move(entry))
+             .first;
+  }
+  *iterations = it->second.iterations;
+  return it->second.result;
+}
+
+} // namespace purity
@@ -7,6 +7,10 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
+#include <vector>
+
 #include "DexClass.h"
 #include "MethodOverrideGraph.h"
 
@@ -209,3 +213,78 @@ size_t compute_no_side_effects_methods(
 // non-null instance of the method's class can ever exist.)
 bool has_implementor(const method_override_graph::Graph* method_override_graph,
                      const DexMethod* method);
+
+namespace purity {
+
+/*
+ * Memoizes the scope-wide computations above, so that the passes that run on
+ * the same code share them instead of each redoing them. Results are keyed by
+ * the set of pure methods and the method override graph they are computed
+ * from.
+ *
+ * The cache doesn't notice when the code changes. It is made available by
+ * PurityAnalysisPass, whose result the PassManager destroys after any pass
+ * that doesn't declare to preserve it in its AnalysisUsage.
+ */
+class AnalysisCache {
+ public:
+  // Built on first use, and then shared.
+  std::shared_ptr<const method_override_graph::Graph> get_method_override_graph(
+      const Scope& scope);
+
+  // Same as compute_conditionally_pure_methods.
+  const std::unordered_map<const DexMethod*, CseUnorderedLocationSet>&
+  get_conditionally_pure_methods(
+      const Scope& scope,
+      const method_override_graph::Graph* method_override_graph,
+      const std::unordered_set<DexMethodRef*>& pure_methods,
+      size_t* iterations);
+
+  // Same as compute_no_side_effects_methods.
+  const std::unordered_set<const DexMethod*>& get_no_side_effects_methods(
+      const Scope& scope,
+      const method_override_graph::Graph* method_override_graph,
+      const std::unordered_set<DexMethodRef*>& pure_methods,
+      size_t* iterations);
+
+  // Memoizes the closure computed by compute_locations_closure over the
+  // written locations of each method, as inferred by CSE for its method
+  // barriers. The locations are determined by the code of the methods and by
+  // the set of methods deemed safe, which is the key together with the graph.
+  const std::unordered_map<const DexMethod*, CseUnorderedLocationSet>&
+  get_method_written_locations(
+      const Scope& scope,
+      const method_override_graph::Graph* method_override_graph,
+      const std::unordered_set<DexMethodRef*>& safe_methods,
+      std::function<boost::optional<LocationsAndDependencies>(DexMethod*)>
+          init_func,
+      size_t* iterations);
+
+  size_t hits() const { return m_hits; }
+
+ private:
+  using Key = std::pair<const method_override_graph::Graph*,
+                        std::vector<const DexMethodRef*>>;
+
+  static Key make_key(const method_override_graph::Graph* method_override_graph,
+                      const std::unordered_set<DexMethodRef*>& pure_methods);
+
+  template <typename Result>
+  struct Entry {
+    size_t iterations;
+    Result result;
+  };
+
+  std::shared_ptr<const method_override_graph::Graph> m_method_override_graph;
+  std::map<Key,
+           Entry<std::unordered_map<const DexMethod*, CseUnorderedLocationSet>>>
+      m_conditionally_pure_methods;
+  std::map<Key, Entry<std::unordered_set<const DexMethod*>>>
+      m_no_side_effects_methods;
+  std::map<Key,
+           Entry<std::unordered_map<const DexMethod*, CseUnorderedLocationSet>>>
+      m_method_written_locations;
+  size_t m_hits{0};
+};
+
+} // namespace purity
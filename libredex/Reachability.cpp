@@ -7,9 +7,13 @@
 
 #include "Reachability.h"
 
+#include <atomic>
+#include <limits>
+#include <numeric>
+
 #include <boost/bimap/bimap.hpp>
 #include <boost/bimap/unordered_set_of.hpp>
-#include <boost/range/adaptor/map.hpp>
+#include <boost/functional/hash.hpp>
 
 #include "BinarySerialization.h"
 #include "DexUtil.h"
@@ -289,10 +293,10 @@ void TransitiveClosureMarker::push(const Parent* parent, const DexClass* cls) {
     return;
   }
   record_reachability(parent, cls);
-  if (m_reachable_objects->marked(cls)) {
+  if (m_reachable_objects->marked(cls) ||
+      !m_reachable_objects->mark(cls)) {
     return;
   }
-  m_reachable_objects->mark(cls);
   m_worker_state->push_task(ReachableObject(cls));
 }
 
@@ -303,14 +307,14 @@ void TransitiveClosureMarker::push(const Parent* parent,
     return;
   }
   record_reachability(parent, field);
-  if (m_reachable_objects->marked(field)) {
+  if (m_reachable_objects->marked(field) ||
+      !m_reachable_objects->mark(field)) {
     return;
   }
   auto f = field->as_def();
   if (f) {
     gather_and_push(f);
   }
-  m_reachable_objects->mark(field);
   m_worker_state->push_task(ReachableObject(field));
 }
 
@@ -326,10 +330,10 @@ void TransitiveClosureMarker::push(const Parent* parent,
   }
 
   record_reachability(parent, method);
-  if (m_reachable_objects->marked(method)) {
+  if (m_reachable_objects->marked(method) ||
+      !m_reachable_objects->mark(method)) {
     return;
   }
-  m_reachable_objects->mark(method);
   m_worker_state->push_task(ReachableObject(method));
 }
 
@@ -776,65 +780,150 @@ ObjectCounts count_objects(const DexStoresVector& stores) {
   return counts;
 }
 
-// Graph serialization helpers
 namespace {
 
-void write_reachable_object(std::ostream& os, const ReachableObject& obj) {
-  bs::write<uint8_t>(os, static_cast<uint8_t>(obj.type));
-  std::ostringstream ss;
-  ss << obj;
-  const auto& s = ss.str();
-  bs::write<uint32_t>(os, s.size());
-  os << s;
+template <class Member>
+void hash_member(size_t* hash, const Member* member) {
+  boost::hash_combine(*hash, member);
+  boost::hash_combine(*hash, member->get_name());
+  boost::hash_combine(*hash, member->get_access());
+  boost::hash_combine(*hash, root(member));
+}
+
+size_t hash_class(const DexClass* cls) {
+  size_t hash = 0;
+  boost::hash_combine(hash, cls);
+  boost::hash_combine(hash, cls->get_name());
+  boost::hash_combine(hash, cls->get_access());
+  boost::hash_combine(hash, root(cls));
+  boost::hash_combine(hash, cls->get_super_class());
+  boost::hash_combine(hash, cls->get_interfaces());
+  for (const auto* f : cls->get_ifields()) {
+    hash_member(&hash, f);
+  }
+  for (const auto* f : cls->get_sfields()) {
+    hash_member(&hash, f);
+  }
+  for (const auto* m : cls->get_dmethods()) {
+    hash_member(&hash, m);
+    boost::hash_combine(hash, m->get_code());
+  }
+  for (const auto* m : cls->get_vmethods()) {
+    hash_member(&hash, m);
+    boost::hash_combine(hash, m->get_code());
+  }
+  auto refs = generic_gather(cls);
+  boost::hash_range(hash, refs.strings.begin(), refs.strings.end());
+  boost::hash_range(hash, refs.types.begin(), refs.types.end());
+  boost::hash_range(hash, refs.fields.begin(), refs.fields.end());
+  boost::hash_range(hash, refs.methods.begin(), refs.methods.end());
+  return hash;
 }
 
 } // namespace
 
+size_t compute_fingerprint(const Scope& scope) {
+  Timer t("Reachability fingerprint");
+  // The classes are combined commutatively, as their order doesn't matter.
+  std::atomic<size_t> fingerprint{scope.size()};
+  walk::parallel::classes(scope, [&](const DexClass* cls) {
+    fingerprint.fetch_add(hash_class(cls), std::memory_order_relaxed);
+  });
+  return fingerprint.load();
+}
+
 void dump_graph(std::ostream& os, const ReachableObjectGraph& retainers_of) {
-  auto compare = [](const ReachableObject& lhs, const ReachableObject& rhs) {
-    if (lhs.type != rhs.type) {
-      return lhs.type < rhs.type;
-    }
-    switch (lhs.type) {
-    case ReachableObjectType::CLASS:
-      return compare_dexclasses(lhs.cls, rhs.cls);
-    case ReachableObjectType::FIELD:
-      return compare_dexfields(lhs.field, rhs.field);
-    case ReachableObjectType::METHOD:
-      return compare_dexmethods(lhs.method, rhs.method);
-
-    case ReachableObjectType::ANNO:
-    case ReachableObjectType::SEED: {
-      // Pretty terrible, optimize.
-      std::ostringstream oss1;
-      oss1 << lhs;
-      std::ostringstream oss2;
-      oss2 << rhs;
-      return oss1.str() < oss2.str();
-    }
-    }
-    __builtin_unreachable();
+  Timer t("Dump reachability graph");
+  struct Node {
+    ReachableObject obj;
+    std::string label;
   };
-
-  bs::write_header(os, /* version */ 1);
-  bs::GraphWriter<ReachableObject, ReachableObjectHash> gw(
-      write_reachable_object,
-      [&](const ReachableObject& obj) -> std::vector<ReachableObject> {
-        if (!retainers_of.count(obj)) {
-          return {};
+  std::vector<Node> nodes;
+  {
+    std::unordered_set<ReachableObject, ReachableObjectHash> objs;
+    for (const auto& pair : retainers_of) {
+      objs.insert(pair.first);
+      objs.insert(pair.second.begin(), pair.second.end());
+    }
+    nodes.reserve(objs.size());
+    for (const auto& obj : objs) {
+      nodes.push_back({obj, {}});
+    }
+  }
+  always_assert(nodes.size() < std::numeric_limits<uint32_t>::max());
+  workqueue_run<Node*>(
+      [](Node* node) {
+        std::ostringstream ss;
+        ss << node->obj;
+        node->label = ss.str();
+      },
+      [&] {
+        std::vector<Node*> ptrs;
+        ptrs.reserve(nodes.size());
+        for (auto& node : nodes) {
+          ptrs.push_back(&node);
         }
-        const auto& preds = retainers_of.at(obj);
-        std::vector<ReachableObject> preds_vec(preds.begin(), preds.end());
-        // Gotta sort the reachables or the output is nondeterministic.
-        std::sort(preds_vec.begin(), preds_vec.end(), compare);
-        return preds_vec;
-      });
+        return ptrs;
+      }());
+  // Gotta sort the nodes or the output is nondeterministic. Sorting by label
+  // within each type also lets readers look nodes up by binary search.
+  std::sort(nodes.begin(), nodes.end(), [](const Node& lhs, const Node& rhs) {
+    if (lhs.obj.type != rhs.obj.type) {
+      return lhs.obj.type < rhs.obj.type;
+    }
+    return lhs.label < rhs.label;
+  });
 
-  // Gotta sort the keys or the output is nondeterministic.
-  auto key_adaptor = boost::adaptors::keys(retainers_of);
-  std::vector<ReachableObject> keys(key_adaptor.begin(), key_adaptor.end());
-  std::sort(keys.begin(), keys.end(), compare);
-  gw.write(os, keys);
+  std::unordered_map<ReachableObject, uint32_t, ReachableObjectHash> ids;
+  ids.reserve(nodes.size());
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    ids.emplace(nodes[i].obj, i);
+  }
+  std::vector<std::vector<uint32_t>> retainer_ids(nodes.size());
+  std::vector<uint32_t> node_ids(nodes.size());
+  std::iota(node_ids.begin(), node_ids.end(), 0);
+  workqueue_run<uint32_t>(
+      [&](uint32_t id) {
+        auto it = retainers_of.find(nodes[id].obj);
+        if (it == retainers_of.end()) {
+          return;
+        }
+        auto& retainers = retainer_ids[id];
+        retainers.reserve(it->second.size());
+        for (const auto& retainer : it->second) {
+          retainers.push_back(ids.at(retainer));
+        }
+        std::sort(retainers.begin(), retainers.end());
+      },
+      node_ids);
+
+  std::vector<uint64_t> label_offsets;
+  std::vector<uint32_t> edge_offsets;
+  std::vector<uint32_t> edges;
+  std::vector<uint8_t> types;
+  label_offsets.reserve(nodes.size() + 1);
+  edge_offsets.reserve(nodes.size() + 1);
+  types.reserve(nodes.size());
+  label_offsets.push_back(0);
+  edge_offsets.push_back(0);
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    label_offsets.push_back(label_offsets.back() + nodes[i].label.size());
+    edges.insert(edges.end(), retainer_ids[i].begin(), retainer_ids[i].end());
+    always_assert(edges.size() <= std::numeric_limits<uint32_t>::max());
+    edge_offsets.push_back(edges.size());
+    types.push_back(static_cast<uint8_t>(nodes[i].obj.type));
+  }
+
+  bs::write_header(os, GRAPH_FORMAT_VERSION);
+  bs::write<uint32_t>(os, nodes.size());
+  bs::write<uint32_t>(os, edges.size());
+  bs::write_elements(os, label_offsets);
+  bs::write_elements(os, edge_offsets);
+  bs::write_elements(os, edges);
+  bs::write_elements(os, types);
+  for (const auto& node : nodes) {
+    os << node.label;
+  }
 }
 
 template void TransitiveClosureMarker::push<DexClass>(const DexClass* parent,
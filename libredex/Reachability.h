@@ -94,11 +94,17 @@ class ReachableObjects {
  public:
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
 
-  void mark(const DexClass* cls) { m_marked_classes.insert(cls); }
+  // Each returns whether the object was newly marked, so that concurrent
+  // markers agree on which of them gets to visit it.
+  bool mark(const DexClass* cls) { return m_marked_classes.emplace(cls, true); }
 
-  void mark(const DexMethodRef* method) { m_marked_methods.insert(method); }
+  bool mark(const DexMethodRef* method) {
+    return m_marked_methods.emplace(method, true);
+  }
 
-  void mark(const DexFieldRef* field) { m_marked_fields.insert(field); }
+  bool mark(const DexFieldRef* field) {
+    return m_marked_fields.emplace(field, true);
+  }
 
   bool marked(const DexClass* cls) const { return m_marked_classes.count(cls); }
 
@@ -110,17 +116,14 @@ class ReachableObjects {
     return m_marked_fields.count(field);
   }
 
-  bool marked_unsafe(const DexClass* cls) const {
-    return m_marked_classes.count_unsafe(cls);
-  }
+  // Lookups never take a lock anymore; these remain for existing callers.
+  bool marked_unsafe(const DexClass* cls) const { return marked(cls); }
 
   bool marked_unsafe(const DexMethodRef* method) const {
-    return m_marked_methods.count_unsafe(method);
+    return marked(method);
   }
 
-  bool marked_unsafe(const DexFieldRef* field) const {
-    return m_marked_fields.count_unsafe(field);
-  }
+  bool marked_unsafe(const DexFieldRef* field) const { return marked(field); }
 
   size_t num_marked_classes() const { return m_marked_classes.size(); }
 
@@ -142,9 +145,16 @@ class ReachableObjects {
 
   void record_reachability(const DexMethodRef* member, const DexClass* cls);
 
-  ConcurrentSet<const DexClass*> m_marked_classes;
-  ConcurrentSet<const DexFieldRef*> m_marked_fields;
-  ConcurrentSet<const DexMethodRef*> m_marked_methods;
+  // Marks are looked up far more often than they are added, and lookups in a
+  // ReadMostlyConcurrentMap are lock-free. Its entries are stored inline, so
+  // large scopes don't cost a node allocation per marked object either. The
+  // mapped values are unused.
+  template <class T>
+  using MarkSet = ReadMostlyConcurrentMap<const T*, bool>;
+
+  MarkSet<DexClass> m_marked_classes;
+  MarkSet<DexFieldRef> m_marked_fields;
+  MarkSet<DexMethodRef> m_marked_methods;
   ReachableObjectGraph m_retainers_of;
 
   friend class RootSetMarker;
@@ -395,6 +405,32 @@ struct ObjectCounts {
  */
 ObjectCounts count_objects(const DexStoresVector& stores);
 
+/*
+ * A hash of everything in the scope that marking depends on: the classes and
+ * their members, with their names, access flags and keep rules, and
+ * everything they reference from their code, annotations and static values.
+ * Scopes with the same fingerprint have the same reachable objects, barring
+ * hash collisions.
+ */
+size_t compute_fingerprint(const Scope& scope);
+
+constexpr uint32_t GRAPH_FORMAT_VERSION = 2;
+
+/*
+ * Writes the retainers graph in a compact form that readers can map into
+ * memory and use without parsing. After the header and the node and edge
+ * counts, as u32s, come the arrays, in this order:
+ *
+ *   u64 label_offsets[nodes + 1]
+ *   u32 retainer_offsets[nodes + 1]
+ *   u32 retainers[edges]
+ *   u8 types[nodes]
+ *   char labels[label_offsets[nodes]]
+ *
+ * The retainers of node i are retainers[retainer_offsets[i]] up to
+ * retainers[retainer_offsets[i + 1]], and its label is likewise a slice of
+ * labels. The nodes are sorted by type, then by label.
+ */
 void dump_graph(std::ostream& os, const ReachableObjectGraph& retainers_of);
 
 } // namespace reachability
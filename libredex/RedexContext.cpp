@@ -11,6 +11,7 @@
 #include <iostream>
 #include <mutex>
 #include <regex>
+#include <thread>
 #include <unordered_set>
 
 #include "Debug.h"
@@ -19,19 +20,21 @@
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
 #include "ProguardConfiguration.h"
+#include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
 
 RedexContext* g_redex;
 
 RedexContext::RedexContext(bool allow_class_duplicates)
-    : m_allow_class_duplicates(allow_class_duplicates) {}
+    : m_allow_class_duplicates(allow_class_duplicates),
+      m_method_resolution_cache(std::make_unique<MethodResolutionCache>()) {}
 
 RedexContext::~RedexContext() {
-  // Delete DexStrings.
+  // Destroy DexStrings. Their memory belongs to the arenas of s_string_map.
   for (auto& segment : s_string_map) {
     for (auto const& p : segment) {
-      delete p.second;
+      p.second->~DexString();
     }
   }
   // Delete DexTypes.  NB: This table intentionally contains aliases (multiple
@@ -100,10 +103,57 @@ static StoredValue* try_insert(Key key,
   return container->at(key);
 }
 
+/*
+ * Like try_insert, but also gives the inserted value the next ID of its kind.
+ * The ID is taken under the lock of the map, so that only the values that get
+ * stored use up IDs, and so that their ID is set by the time other threads can
+ * find them.
+ */
+template <class InsertValue,
+          class StoredValue = InsertValue,
+          class Deleter = std::default_delete<InsertValue>,
+          class Key,
+          class Container>
+static StoredValue* try_insert_with_id(Key key,
+                                       InsertValue* value,
+                                       uint32_t* id,
+                                       std::atomic<uint32_t>* next_id,
+                                       Container* container) {
+  std::unique_ptr<InsertValue, Deleter> to_insert(value);
+  StoredValue* rv = nullptr;
+  container->update(key, [&](const auto&, StoredValue*& stored, bool exists) {
+    if (!exists) {
+      *id = (*next_id)++;
+      stored = to_insert.release();
+    }
+    rv = stored;
+  });
+  return rv;
+}
+
+namespace {
+
+// Arena-allocated objects are only to be destroyed.
+template <class T>
+struct DestroyOnly {
+  void operator()(T* value) const { value->~T(); }
+};
+
+} // namespace
+
+keep_reason::ReasonNode* RedexContext::make_keep_reason_node(
+    const keep_reason::Reason* reason, const keep_reason::ReasonNode* next) {
+  auto index = std::hash<std::thread::id>()(std::this_thread::get_id()) %
+               KEEP_REASON_ARENAS;
+  return g_redex->m_keep_reason_arenas[index].make<keep_reason::ReasonNode>(
+      keep_reason::ReasonNode{reason, next});
+}
+
 DexString* RedexContext::make_string(const char* nstr, uint32_t utfsize) {
   always_assert(nstr != nullptr);
   auto p = std::make_pair(nstr, utfsize);
-  auto& segment = s_string_map.at(p);
+  auto index = s_string_map.segment_index(p);
+  auto& segment = s_string_map.map[index];
 
   auto rv = segment.get(p, nullptr);
   if (rv != nullptr) {
@@ -113,9 +163,11 @@ DexString* RedexContext::make_string(const char* nstr, uint32_t utfsize) {
   // std::string. The c_str is valid until a the string is destroyed, or until a
   // non-const function is called on the string (but note the std::string itself
   // is const)
-  auto dexstring = new DexString(nstr, utfsize);
+  auto dexstring = new (s_string_map.arenas[index].allocate(
+      sizeof(DexString), alignof(DexString))) DexString(nstr, utfsize);
   auto p2 = std::make_pair(dexstring->c_str(), utfsize);
-  return try_insert(p2, dexstring, &segment);
+  return try_insert_with_id<DexString, DexString, DestroyOnly<DexString>>(
+      p2, dexstring, &dexstring->m_id, &s_next_string_id, &segment);
 }
 
 DexString* RedexContext::get_string(const char* nstr, uint32_t utfsize) {
@@ -133,8 +185,9 @@ DexType* RedexContext::make_type(const DexString* dstring) {
   if (rv != nullptr) {
     return rv;
   }
-  return try_insert(dstring, new DexType(const_cast<DexString*>(dstring)),
-                    &s_type_map);
+  auto type = new DexType(const_cast<DexString*>(dstring));
+  return try_insert_with_id(dstring, type, &type->m_id, &s_next_type_id,
+                            &s_type_map);
 }
 
 DexType* RedexContext::get_type(const DexString* dstring) {
@@ -173,7 +226,8 @@ DexFieldRef* RedexContext::make_field(const DexType* container,
   auto field = new DexField(const_cast<DexType*>(container),
                             const_cast<DexString*>(name),
                             const_cast<DexType*>(type));
-  return try_insert<DexField, DexFieldRef>(r, field, &s_field_map);
+  return try_insert_with_id<DexField, DexFieldRef>(
+      r, field, &field->m_id, &s_next_field_id, &s_field_map);
 }
 
 DexFieldRef* RedexContext::get_field(const DexType* container,
@@ -203,16 +257,16 @@ void RedexContext::mutate_field(DexFieldRef* field,
   r.type = ref.type != nullptr ? ref.type : field->m_spec.type;
   field->m_spec = r;
 
-  if (rename_on_collision && s_field_map.find(r) != s_field_map.end()) {
+  if (rename_on_collision && s_field_map.count(r)) {
     uint32_t i = 0;
     while (true) {
       r.name = DexString::make_string(("f$" + std::to_string(i++)).c_str());
-      if (s_field_map.find(r) == s_field_map.end()) {
+      if (!s_field_map.count(r)) {
         break;
       }
     }
   }
-  always_assert_log(s_field_map.find(r) == s_field_map.end(),
+  always_assert_log(!s_field_map.count(r),
                     "Another field with the same signature already exists %s",
                     SHOW(s_field_map.at(r)));
   s_field_map.emplace(r, field);
@@ -270,8 +324,9 @@ DexMethodRef* RedexContext::make_method(const DexType* type_,
   if (rv != nullptr) {
     return rv;
   }
-  return try_insert<DexMethod, DexMethodRef, DexMethod::Deleter>(
-      r, new DexMethod(type, name, proto), &s_method_map);
+  auto method = new DexMethod(type, name, proto);
+  return try_insert_with_id<DexMethod, DexMethodRef, DexMethod::Deleter>(
+      r, method, &method->m_id, &s_next_method_id, &s_method_map);
 }
 
 DexMethodRef* RedexContext::get_method(const DexType* type,
@@ -286,6 +341,7 @@ DexMethodRef* RedexContext::get_method(const DexType* type,
 }
 
 void RedexContext::erase_method(DexMethodRef* method) {
+  invalidate_method_resolution();
   s_method_map.erase(method->m_spec);
 }
 
@@ -294,6 +350,7 @@ void RedexContext::mutate_method(DexMethodRef* method,
                                  const DexMethodSpec& new_spec,
                                  bool rename_on_collision) {
   std::lock_guard<std::mutex> lock(s_method_lock);
+  invalidate_method_resolution();
   DexMethodSpec old_spec = method->m_spec;
   s_method_map.erase(method->m_spec);
 
@@ -419,6 +476,7 @@ bool RedexContext::class_already_loaded(DexClass* cls) {
 
 void RedexContext::publish_class(DexClass* cls) {
   std::lock_guard<std::mutex> l(m_type_system_mutex);
+  invalidate_method_resolution();
   const DexType* type = cls->get_type();
   const auto& pair = m_type_to_class.emplace(type, cls);
   bool insertion_took_place = pair.second;
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <array>
+#include <atomic>
 #include <boost/functional/hash.hpp>
 #include <cstring>
 #include <deque>
@@ -15,14 +16,17 @@
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
 
+#include "Arena.h"
 #include "ConcurrentContainers.h"
 #include "Debug.h"
 #include "DexMemberRefs.h"
+#include "FastStringOps.h"
 #include "FrequentlyUsedPointersCache.h"
 #include "KeepReason.h"
 
@@ -31,6 +35,7 @@ class DexDebugInstruction;
 class DexString;
 class DexType;
 class DexFieldRef;
+class MethodResolutionCache;
 class DexTypeList;
 class DexProto;
 class DexMethodRef;
@@ -48,10 +53,6 @@ struct AssumeReturnValue;
 
 extern RedexContext* g_redex;
 
-#if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
-extern "C" bool strcmp_less(const char* str1, const char* str2);
-#endif
-
 struct RedexContext {
   explicit RedexContext(bool allow_class_duplicates = false);
   ~RedexContext();
@@ -112,6 +113,14 @@ struct RedexContext {
 
   PositionPatternSwitchManager* get_position_pattern_switch_manager();
 
+  // The number of IDs handed out so far; see DenseSideTable.h. An ID is only
+  // taken by an object that gets interned, so the IDs have no holes, but
+  // erased objects keep their IDs.
+  uint32_t num_string_ids() const { return s_next_string_id.load(); }
+  uint32_t num_type_ids() const { return s_next_type_id.load(); }
+  uint32_t num_field_ids() const { return s_next_field_id.load(); }
+  uint32_t num_method_ids() const { return s_next_method_id.load(); }
+
   // Return false on unique classes
   // Return true on benign duplicate classes
   // Throw RedexException on problematic duplicate classes
@@ -119,6 +128,22 @@ struct RedexContext {
 
   void publish_class(DexClass* cls);
 
+  /*
+   * The cache of method resolution that all passes share; see
+   * MethodResolutionCache in Resolver.h. Changes to the class hierarchy and
+   * to the methods of classes bump the epoch, which makes all the cached
+   * resolutions stale.
+   */
+  MethodResolutionCache& method_resolution_cache() {
+    return *m_method_resolution_cache;
+  }
+  uint32_t method_resolution_epoch() const {
+    return m_method_resolution_epoch.load(std::memory_order_acquire);
+  }
+  void invalidate_method_resolution() {
+    m_method_resolution_epoch.fetch_add(1, std::memory_order_acq_rel);
+  }
+
   DexClass* type_class(const DexType* t);
   template <class TypeClassWalkerFn = void(const DexType*, const DexClass*)>
   void walk_type_class(TypeClassWalkerFn walker) {
@@ -150,6 +175,11 @@ struct RedexContext {
     return g_redex->s_keep_reasons.at(to_insert.get());
   }
 
+  // Allocates a node of the keep reason list of a class or member, which
+  // lives as long as this context.
+  static keep_reason::ReasonNode* make_keep_reason_node(
+      const keep_reason::Reason* reason, const keep_reason::ReasonNode* next);
+
   // Add a lambda to be called when RedexContext is destructed. This is
   // especially useful for resetting caches/singletons in tests.
   using Task = std::function<void(void)>;
@@ -221,6 +251,10 @@ struct RedexContext {
   //
   // The two layers give infrastructure overhead, however, the base size
   // of a `std::map` and `ConcurrentContainer` is quite small.
+  //
+  // The DexStrings themselves are allocated in one `Arena` per first-layer
+  // segment, so that strings hashing to the same segment are close in
+  // memory, without contention across segments.
 
   using StringMapKey = std::pair<const char*, uint32_t>;
   struct StringMapKeyHash {
@@ -244,10 +278,14 @@ struct RedexContext {
     using AType = std::array<ConcurrentProjectedStringMap<n_slots>, m_slots>;
 
     AType map;
+    std::array<Arena, m_slots> arenas;
+
+    static size_t segment_index(const StringMapKey& k) {
+      return TruncatedStringHash()(k.first) % m_slots;
+    }
 
     ConcurrentProjectedStringMap<n_slots>& at(const StringMapKey& k) {
-      size_t hashed = TruncatedStringHash()(k.first) % m_slots;
-      return map[hashed];
+      return map[segment_index(k)];
     }
 
     typename AType::iterator begin() { return map.begin(); }
@@ -256,11 +294,7 @@ struct RedexContext {
 
   struct Strcmp {
     bool operator()(const char* a, const char* b) const {
-#if defined(__SSE4_2__) && defined(__linux__) && defined(__STRCMP_LESS__)
-      return strcmp_less(a, b);
-#else
-      return strcmp(a, b) < 0;
-#endif
+      return fast_string::less(a, b);
     }
   };
 
@@ -279,13 +313,17 @@ struct RedexContext {
       constexpr size_t offset = 32;
       size_t len = strnlen(s, offset + hash_prefix_len);
       size_t start = std::max<int64_t>(0, int64_t(len - hash_prefix_len));
-      return boost::hash_range(s + start, s + len);
+      return fast_string::hash(s + start, len - start);
     }
   };
 
   // DexString
   LargeStringMap<31, 127> s_string_map;
 
+  // The maps of types, fields and methods see erasures when their elements
+  // are renamed or removed, so they are not ReadMostlyConcurrentMaps: those
+  // keep the tables they retire, and would grow with every rename.
+
   // DexType
   ConcurrentMap<const DexString*, DexType*> s_type_map;
 
@@ -301,12 +339,18 @@ struct RedexContext {
 
   // DexProto
   using ProtoKey = std::pair<const DexType*, const DexTypeList*>;
-  ConcurrentMap<ProtoKey, DexProto*, boost::hash<ProtoKey>> s_proto_map;
+  ReadMostlyConcurrentMap<ProtoKey, DexProto*, boost::hash<ProtoKey>>
+      s_proto_map;
 
   // DexMethod
   ConcurrentMap<DexMethodSpec, DexMethodRef*> s_method_map;
   std::mutex s_method_lock;
 
+  std::atomic<uint32_t> s_next_string_id{0};
+  std::atomic<uint32_t> s_next_type_id{0};
+  std::atomic<uint32_t> s_next_field_id{0};
+  std::atomic<uint32_t> s_next_method_id{0};
+
   // DexPositionSwitch and DexPositionPattern
   PositionPatternSwitchManager* m_position_pattern_switch_manager{nullptr};
 
@@ -322,6 +366,10 @@ struct RedexContext {
                 keep_reason::ReasonPtrHash,
                 keep_reason::ReasonPtrEqual>
       s_keep_reasons;
+  // The nodes of the keep reason lists. Each thread allocates from one of
+  // these, so that threads rarely contend on the lock of an arena.
+  static constexpr size_t KEEP_REASON_ARENAS = 16;
+  std::array<Arena, KEEP_REASON_ARENAS> m_keep_reason_arenas;
 
   // These functions will be called when ~RedexContext() is called
   std::mutex m_destruction_tasks_lock;
@@ -333,6 +381,9 @@ struct RedexContext {
   bool m_allow_class_duplicates;
 
   bool m_pointers_cache_loaded{false};
+
+  std::unique_ptr<MethodResolutionCache> m_method_resolution_cache;
+  std::atomic<uint32_t> m_method_resolution_epoch{0};
   FrequentlyUsedPointers m_pointers_cache;
 
   // Field values map specified by Proguard assume value
@@ -18,9 +18,11 @@
 
 #include "ApkResources.h"
 #include "BundleResources.h"
+#include "ConcurrentContainers.h"
 #include "Debug.h"
 #include "DetectBundle.h"
 #include "DexUtil.h"
+#include "FastStringOps.h"
 #include "IOUtil.h"
 #include "Macros.h"
 #include "ReadMaybeMapped.h"
@@ -206,6 +208,30 @@ void find_resource_xml_files(const std::string& dir,
     }
   }
 }
+
+struct LayoutScan {
+  size_t content_hash;
+  std::unordered_set<std::string> attributes_to_read;
+  std::unordered_set<std::string> classes;
+  std::unordered_multimap<std::string, std::string> attributes;
+};
+
+// What was found in each layout file the last time it was scanned. Layouts are
+// scanned at startup and again by passes that recompute reachability, and
+// most of them are unchanged in between; a file whose contents hash the same
+// is not parsed again.
+ConcurrentMap<std::string, LayoutScan>& get_layout_scan_cache() {
+  static ConcurrentMap<std::string, LayoutScan> cache;
+  return cache;
+}
+
+size_t hash_file_contents(const std::string& file_path) {
+  size_t hash = 0;
+  redex::read_file_with_contents(file_path, [&](const char* data, size_t size) {
+    hash = fast_string::hash(data, size);
+  });
+  return hash;
+}
 } // namespace
 
 void AndroidResources::collect_layout_classes_and_attributes(
@@ -233,19 +259,26 @@ void AndroidResources::collect_layout_classes_and_attributes(
             return;
           }
 
-          std::unordered_set<std::string> local_out_classes;
-          std::unordered_multimap<std::string, std::string>
-              local_out_attributes;
-          collect_layout_classes_and_attributes_for_file(
-              input, attributes_to_read, &local_out_classes,
-              &local_out_attributes);
-          if (!local_out_classes.empty() || !local_out_attributes.empty()) {
+          auto& cache = get_layout_scan_cache();
+          auto content_hash = hash_file_contents(input);
+          auto scan = cache.get(input, LayoutScan{});
+          if (scan.content_hash != content_hash ||
+              scan.attributes_to_read != attributes_to_read) {
+            scan.content_hash = content_hash;
+            scan.attributes_to_read = attributes_to_read;
+            scan.classes.clear();
+            scan.attributes.clear();
+            collect_layout_classes_and_attributes_for_file(
+                input, attributes_to_read, &scan.classes, &scan.attributes);
+            cache.update(input, [&](const std::string&, LayoutScan& cached,
+                                    bool) { cached = scan; });
+          } else {
+            TRACE(RES, 9, "Reusing the scan of unchanged %s", input.c_str());
+          }
+          if (!scan.classes.empty() || !scan.attributes.empty()) {
             std::unique_lock<std::mutex> lock(out_mutex);
-            // C++17: use merge to avoid copies.
-            out_classes->insert(local_out_classes.begin(),
-                                local_out_classes.end());
-            out_attributes->insert(local_out_attributes.begin(),
-                                   local_out_attributes.end());
+            out_classes->merge(scan.classes);
+            out_attributes->merge(scan.attributes);
           }
         },
         std::vector<std::string>{""},
@@ -9,8 +9,68 @@
 #include "EditableCfgAdapter.h"
 #include "Resolver.h"
 #include "TypeUtil.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+RefChecker::RefChecker(XStoreRefs* xstores,
+                       size_t store_idx,
+                       const api::AndroidSDK* min_sdk_api,
+                       const Scope& scope)
+    : RefChecker(xstores, store_idx, min_sdk_api) {
+  ConcurrentSet<const DexType*> types;
+  ConcurrentSet<const DexMethod*> methods;
+  ConcurrentSet<const DexField*> fields;
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    std::vector<DexType*> type_refs;
+    cls->gather_types(type_refs);
+    for (auto* type : type_refs) {
+      types.insert(type);
+    }
+    // The resolved refs of instructions are definitions, which are what
+    // clients check.
+    std::vector<DexMethodRef*> method_refs;
+    cls->gather_methods(method_refs);
+    for (auto* mref : method_refs) {
+      if (mref->is_def()) {
+        methods.insert(mref->as_def());
+      }
+    }
+    std::vector<DexFieldRef*> field_refs;
+    cls->gather_fields(field_refs);
+    for (auto* fref : field_refs) {
+      if (fref->is_def()) {
+        fields.insert(fref->as_def());
+      }
+    }
+  });
+
+  // Each task only writes the entry of its own ref. The checks it does along
+  // the way go through the caches, until the tables are complete.
+  workqueue_run<const DexType*>(
+      [&](const DexType* type) {
+        m_type_validity[type] = check_type(type) ? VALID : INVALID;
+      },
+      types);
+  workqueue_run<const DexMethod*>(
+      [&](const DexMethod* method) {
+        m_method_validity[method] = check_method(method) ? VALID : INVALID;
+      },
+      methods);
+  workqueue_run<const DexField*>(
+      [&](const DexField* field) {
+        m_field_validity[field] = check_field(field) ? VALID : INVALID;
+      },
+      fields);
+  m_precomputed = true;
+}
 
 bool RefChecker::check_type(const DexType* type) const {
+  if (m_precomputed) {
+    auto validity = m_type_validity.at(type);
+    if (validity != UNKNOWN) {
+      return validity == VALID;
+    }
+  }
   auto res = m_type_cache.get(type, boost::none);
   if (res == boost::none) {
     res = check_type_internal(type);
@@ -24,6 +84,12 @@ bool RefChecker::check_type(const DexType* type) const {
 }
 
 bool RefChecker::check_method(const DexMethod* method) const {
+  if (m_precomputed) {
+    auto validity = m_method_validity.at(method);
+    if (validity != UNKNOWN) {
+      return validity == VALID;
+    }
+  }
   auto res = m_method_cache.get(method, boost::none);
   if (res == boost::none) {
     res = check_method_internal(method);
@@ -38,6 +104,12 @@ bool RefChecker::check_method(const DexMethod* method) const {
 }
 
 bool RefChecker::check_field(const DexField* field) const {
+  if (m_precomputed) {
+    auto validity = m_field_validity.at(field);
+    if (validity != UNKNOWN) {
+      return validity == VALID;
+    }
+  }
   auto res = m_field_cache.get(field, boost::none);
   if (res == boost::none) {
     res = check_field_internal(field);
@@ -10,6 +10,7 @@
 #include <boost/optional.hpp>
 
 #include "ConcurrentContainers.h"
+#include "DenseSideTable.h"
 #include "DexClass.h"
 #include "DexStore.h"
 #include "FrameworkApi.h"
@@ -24,6 +25,10 @@
 // interface types, return types, argument types, field types are valid for the
 // given min-sdk.
 //
+// When given a scope, the checker precomputes the validity of all the types,
+// methods and fields that the scope defines or references, so that checking
+// them is a table lookup. Other refs are checked, and cached, on demand.
+//
 // All functions are thread-safe.
 class RefChecker {
  public:
@@ -37,6 +42,11 @@ class RefChecker {
         m_store_idx(store_idx),
         m_min_sdk_api(min_sdk_api) {}
 
+  RefChecker(XStoreRefs* xstores,
+             size_t store_idx,
+             const api::AndroidSDK* min_sdk_api,
+             const Scope& scope);
+
   bool check_type(const DexType* type) const;
 
   bool check_method(const DexMethod* method) const;
@@ -63,6 +73,14 @@ class RefChecker {
   size_t m_store_idx;
   const api::AndroidSDK* m_min_sdk_api;
 
+  enum Validity : uint8_t { UNKNOWN, VALID, INVALID };
+
+  // Filled at construction, and only read afterwards.
+  bool m_precomputed{false};
+  DenseSideTable<DexType, Validity> m_type_validity;
+  DenseSideTable<DexMethodRef, Validity> m_method_validity;
+  DenseSideTable<DexFieldRef, Validity> m_field_validity;
+
   mutable ConcurrentMap<const DexType*, boost::optional<bool>> m_type_cache;
   mutable ConcurrentMap<const DexMethod*, boost::optional<bool>> m_method_cache;
   mutable ConcurrentMap<const DexField*, boost::optional<bool>> m_field_cache;
@@ -10,7 +10,6 @@
 #include <atomic>
 #include <boost/optional.hpp>
 #include <limits>
-#include <mutex>
 #include <string>
 
 #include "Debug.h"
@@ -128,18 +127,14 @@ class ReferencedState {
       std::numeric_limits<InterdexSubgroupIdx>::max();
   InterdexSubgroupIdx m_interdex_subgroup{kNoSubgroup};
 
-  // Going through hoops here to reduce the size of ReferencedState while
-  // keeping memory requirements still small in non-default case.
-  struct KeepReasons {
-    std::mutex m_keep_reasons_mtx;
-    keep_reason::ReasonPtrSet m_keep_reasons;
-  };
-  mutable std::atomic<KeepReasons*> m_keep_reasons{nullptr};
+  // The keep reasons, only recorded if RedexContext::record_keep_reasons().
+  // This is a single pointer to a list that lives in the RedexContext, which
+  // takes one small node per reason, and no lock to add to.
+  std::atomic<const keep_reason::ReasonNode*> m_keep_reasons{nullptr};
 
  public:
   ReferencedState() = default;
   ReferencedState(const ReferencedState&) = delete;
-  ~ReferencedState() { delete m_keep_reasons.load(); }
 
   ReferencedState& operator=(const ReferencedState& other) {
     if (this != &other) {
@@ -295,14 +290,9 @@ class ReferencedState {
     inner_struct.m_unset_allowobfuscation = false;
   }
 
-  const keep_reason::ReasonPtrSet& keep_reasons() const {
-    if (!RedexContext::record_keep_reasons()) {
-      // We really should not allow this.
-      static keep_reason::ReasonPtrSet SINGLETON;
-      return SINGLETON;
-    }
-    auto& keep_reasons = ensure_keep_reasons();
-    return keep_reasons.m_keep_reasons;
+  // Empty unless RedexContext::record_keep_reasons().
+  keep_reason::ReasonList keep_reasons() const {
+    return keep_reason::ReasonList(m_keep_reasons.load());
   }
 
   template <class... Args>
@@ -412,27 +402,22 @@ class ReferencedState {
     inner_struct.m_unset_allowobfuscation = true;
   }
 
-  KeepReasons& ensure_keep_reasons() const {
+  void add_keep_reason(const keep_reason::Reason* reason) {
     always_assert(RedexContext::record_keep_reasons());
-    // First see whether it's already done to avoid allocating.
-    auto attempt = m_keep_reasons.load();
-    if (attempt != nullptr) {
-      return *attempt;
+    auto* head = m_keep_reasons.load();
+    if (keep_reason::ReasonList(head).contains(reason)) {
+      return;
     }
-    // OK, allocate and CAS.
-    auto keep_reasons = std::make_unique<KeepReasons>();
-    KeepReasons* expected = nullptr;
-    if (m_keep_reasons.compare_exchange_strong(expected, keep_reasons.get())) {
-      return *keep_reasons.release();
+    auto* node = RedexContext::make_keep_reason_node(reason, head);
+    while (!m_keep_reasons.compare_exchange_weak(head, node)) {
+      // Only the nodes added since the last attempt need to be checked.
+      for (auto* added = head; added != node->next; added = added->next) {
+        if (added->reason == reason) {
+          return;
+        }
+      }
+      node->next = head;
     }
-    return *expected;
-  }
-
-  void add_keep_reason(const keep_reason::Reason* reason) {
-    always_assert(RedexContext::record_keep_reasons());
-    auto& keep_reasons = ensure_keep_reasons();
-    std::lock_guard<std::mutex> lock(keep_reasons.m_keep_reasons_mtx);
-    keep_reasons.m_keep_reasons.emplace(reason);
   }
 
   friend class keep_rules::impl::KeepState;
@@ -440,3 +425,7 @@ class ReferencedState {
   // IR serialization class
   friend class ir_meta_io::IRMetaIO;
 };
+
+// Every class, method and field has one, so it should stay small whether or
+// not keep reasons are recorded.
+static_assert(sizeof(ReferencedState) <= 16, "ReferencedState grew");
@@ -76,6 +76,79 @@ using MethodRefCache =
 using ConcurrentMethodRefCache =
     ConcurrentMap<MethodRefCacheKey, DexMethod*, MethodRefCacheKeyHash>;
 
+/**
+ * The methods that method refs resolved to, shared by all the passes and
+ * owned by RedexContext, so that resolution does not repeat the same walks
+ * up the hierarchy pass after pass. Lookups are lock-free.
+ *
+ * Entries are tagged with the method resolution epoch of RedexContext, which
+ * adding, removing or renaming methods and changing super classes or
+ * interfaces bump, so no entry of an earlier epoch is returned. Edits of the
+ * method lists of a class through get_vmethods() and get_dmethods() are not
+ * seen; the PassManager bumps the epoch after each pass that may write the
+ * classes, and drops the stale entries then.
+ *
+ * The cache is only used once enabled, with the
+ * `global_method_resolution_cache` option of the PassManager.
+ */
+class MethodResolutionCache {
+ public:
+  bool is_enabled() const { return m_enabled; }
+
+  // Not thread-safe.
+  void set_enabled(bool enabled) { m_enabled = enabled; }
+
+  template <typename ResolveFn>
+  DexMethod* get_or_resolve(DexMethodRef* method,
+                            MethodSearch search,
+                            const ResolveFn& resolve) {
+    Key key{method, search, g_redex->method_resolution_epoch()};
+    auto def = m_entries.get(key, nullptr);
+    if (def == nullptr) {
+      def = resolve();
+      if (def != nullptr) {
+        m_entries.emplace(key, def);
+      }
+    }
+    return def;
+  }
+
+  // Drops all entries if any of them may be stale. Not thread-safe.
+  void clear_stale() {
+    auto epoch = g_redex->method_resolution_epoch();
+    if (epoch != m_cleared_epoch) {
+      m_entries.clear();
+      m_cleared_epoch = epoch;
+    }
+  }
+
+  size_t size() const { return m_entries.size(); }
+
+ private:
+  struct Key {
+    DexMethodRef* method;
+    MethodSearch search;
+    uint32_t epoch;
+
+    bool operator==(const Key& other) const {
+      return method == other.method && search == other.search &&
+             epoch == other.epoch;
+    }
+  };
+
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const {
+      std::size_t seed = MethodRefCacheKeyHash()({key.method, key.search});
+      boost::hash_combine(seed, key.epoch);
+      return seed;
+    }
+  };
+
+  ReadMostlyConcurrentMap<Key, DexMethod*, KeyHash> m_entries;
+  uint32_t m_cleared_epoch{0};
+  bool m_enabled{false};
+};
+
 /**
  * Helper to map an opcode to a MethodSearch rule.
  */
@@ -216,8 +289,15 @@ inline DexMethod* resolve_method(DexMethodRef* method,
   }
   auto cls = type_class(method->get_class());
   if (cls == nullptr) return nullptr;
-  return resolve_method_ref(cls, method->get_name(), method->get_proto(),
-                            search);
+  auto& cache = g_redex->method_resolution_cache();
+  if (!cache.is_enabled()) {
+    return resolve_method_ref(cls, method->get_name(), method->get_proto(),
+                              search);
+  }
+  return cache.get_or_resolve(method, search, [&] {
+    return resolve_method_ref(cls, method->get_name(), method->get_proto(),
+                              search);
+  });
 }
 
 /**
@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ShardedMetrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sharded_metrics {
+
+size_t current_shard() {
+  static std::atomic<size_t> s_next_shard{0};
+  // Threads are numbered in creation order, so the worker threads of a work
+  // queue get distinct shards.
+  static thread_local size_t s_shard = s_next_shard++ % kNumShards;
+  return s_shard;
+}
+
+int64_t Counter::sum() const {
+  int64_t sum = 0;
+  for (const auto& shard : m_shards) {
+    sum += shard.value.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void Counter::reset() {
+  for (auto& shard : m_shards) {
+    shard.value.store(0, std::memory_order_relaxed);
+  }
+}
+
+uint64_t Histogram::Summary::percentile(double p) const {
+  if (count == 0) {
+    return 0;
+  }
+  auto rank = static_cast<uint64_t>(std::ceil(p / 100 * count));
+  rank = std::max<uint64_t>(rank, 1);
+  uint64_t seen = 0;
+  for (size_t b = 0; b < kNumBuckets; ++b) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      if (b == 0) {
+        return 0;
+      }
+      // The upper bound of the bucket, but never more than the maximum.
+      auto upper = b == 64 ? UINT64_MAX : (uint64_t(1) << b) - 1;
+      return std::min(upper, max);
+    }
+  }
+  return max;
+}
+
+Histogram::Summary Histogram::summarize() const {
+  Summary summary;
+  for (const auto& shard : m_shards) {
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      auto n = shard.buckets[b].load(std::memory_order_relaxed);
+      summary.buckets[b] += n;
+      summary.count += n;
+    }
+    summary.sum += shard.sum.load(std::memory_order_relaxed);
+    summary.max =
+        std::max(summary.max, shard.max.load(std::memory_order_relaxed));
+  }
+  return summary;
+}
+
+void Histogram::reset() {
+  for (auto& shard : m_shards) {
+    for (auto& bucket : shard.buckets) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    shard.sum.store(0, std::memory_order_relaxed);
+    shard.max.store(0, std::memory_order_relaxed);
+  }
+}
+
+Counter& Registry::counter(const std::string& name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& counter = m_counters[name];
+  if (!counter) {
+    counter = std::make_unique<Counter>();
+  }
+  return *counter;
+}
+
+Histogram& Registry::histogram(const std::string& name) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& histogram = m_histograms[name];
+  if (!histogram) {
+    histogram = std::make_unique<Histogram>();
+  }
+  return *histogram;
+}
+
+void Registry::reduce_into(std::unordered_map<std::string, int64_t>* metrics) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& p : m_counters) {
+    (*metrics)[p.first] += p.second->sum();
+  }
+  for (const auto& p : m_histograms) {
+    auto summary = p.second->summarize();
+    if (summary.count == 0) {
+      continue;
+    }
+    (*metrics)[p.first + ".count"] += summary.count;
+    (*metrics)[p.first + ".sum"] += summary.sum;
+    (*metrics)[p.first + ".max"] = summary.max;
+    (*metrics)[p.first + ".p50"] = summary.percentile(50);
+    (*metrics)[p.first + ".p90"] = summary.percentile(90);
+    (*metrics)[p.first + ".p99"] = summary.percentile(99);
+  }
+  m_counters.clear();
+  m_histograms.clear();
+}
+
+} // namespace sharded_metrics
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/*
+ * Counters and histograms that many threads can update at once without
+ * contention: every thread updates its own shard, on its own cache line, with
+ * relaxed atomics, and the shards are only combined when the values are read.
+ */
+namespace sharded_metrics {
+
+constexpr size_t kNumShards = 32;
+
+// The shard of the calling thread.
+size_t current_shard();
+
+class Counter {
+ public:
+  void add(int64_t value = 1) {
+    m_shards[current_shard()].value.fetch_add(value,
+                                              std::memory_order_relaxed);
+  }
+
+  int64_t sum() const;
+
+  void reset();
+
+ private:
+  struct alignas(64) Shard {
+    std::atomic<int64_t> value{0};
+  };
+  std::array<Shard, kNumShards> m_shards;
+};
+
+/*
+ * A histogram of non-negative values, e.g. latencies in microseconds, in
+ * power-of-two buckets: bucket 0 holds 0, and bucket b > 0 holds the values
+ * in [2^(b-1), 2^b). Percentiles are reported as the upper bound of their
+ * bucket, so they are exact up to a factor of 2.
+ */
+class Histogram {
+ public:
+  static constexpr size_t kNumBuckets = 65;
+
+  static size_t bucket(uint64_t value) {
+    return value == 0 ? 0 : 64 - __builtin_clzll(value);
+  }
+
+  void add(uint64_t value) {
+    auto& shard = m_shards[current_shard()];
+    shard.buckets[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+    auto max = shard.max.load(std::memory_order_relaxed);
+    while (value > max && !shard.max.compare_exchange_weak(
+                              max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  struct Summary {
+    uint64_t count{0};
+    uint64_t sum{0};
+    uint64_t max{0};
+    std::array<uint64_t, kNumBuckets> buckets{};
+
+    // The upper bound of the bucket of the given percentile, in [0, 100].
+    uint64_t percentile(double p) const;
+  };
+
+  Summary summarize() const;
+
+  void reset();
+
+ private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets{};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+  };
+  std::array<Shard, kNumShards> m_shards;
+};
+
+/*
+ * Named counters and histograms. Looking one up takes a lock, so get them
+ * before going parallel and keep the references.
+ */
+class Registry {
+ public:
+  Counter& counter(const std::string& name);
+  Histogram& histogram(const std::string& name);
+
+  /*
+   * Add the counters to `metrics` under their names, and the histograms as
+   * `<name>.count`, `<name>.sum`, `<name>.max`, `<name>.p50`, `<name>.p90`
+   * and `<name>.p99`, then remove all of them.
+   */
+  void reduce_into(std::unordered_map<std::string, int64_t>* metrics);
+
+ private:
+  std::mutex m_mutex;
+  std::map<std::string, std::unique_ptr<Counter>> m_counters;
+  std::map<std::string, std::unique_ptr<Histogram>> m_histograms;
+};
+
+} // namespace sharded_metrics
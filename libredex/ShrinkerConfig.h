@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 namespace shrinker {
@@ -22,6 +23,12 @@ struct ShrinkerConfig {
   bool run_reg_alloc{false};
   bool run_dedup_blocks{false};
 
+  // Bounds on the constant propagation fixpoint iteration over a single
+  // method; a method that exceeds them is not transformed by constant
+  // propagation. Zero means no bound.
+  size_t const_prop_max_steps{0};
+  size_t const_prop_max_ms{0};
+
   // Internally used option that decides whether to compute pure methods with a
   // relatively expensive analysis over the scope
   bool compute_pure_methods{true};
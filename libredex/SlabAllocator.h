@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "Sanitizers.h"
+
+/**
+ * A pooling allocator for small, fixed-size objects that are allocated and
+ * freed in very large numbers, like IRInstructions and MethodItemEntries.
+ * Classes opt in by forwarding their `operator new` / `operator delete` to
+ * `SlabAllocator<sizeof(T), alignof(T)>`.
+ *
+ * Blocks are carved out of large chunks and recycled through free lists
+ * instead of going back to malloc. Each thread keeps its own free list, so the
+ * common path takes no lock; batches of blocks are exchanged with a global free
+ * list when a thread's list runs empty or grows too long, and whatever a
+ * thread still holds when it exits is handed back. Chunks are never returned
+ * to the system, which suits types whose population stays roughly stable over
+ * a run.
+ *
+ * Under ASAN, allocations go straight to the global `operator new` so that
+ * use-after-free and leak detection keep working.
+ */
+template <size_t kObjectSize, size_t kAlignment>
+class SlabAllocator {
+ private:
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  static constexpr size_t align_up(size_t n, size_t a) {
+    return (n + a - 1) / a * a;
+  }
+
+  static constexpr size_t ALIGNMENT =
+      kAlignment > alignof(FreeBlock) ? kAlignment : alignof(FreeBlock);
+  static constexpr size_t BLOCK_SIZE =
+      align_up(kObjectSize > sizeof(FreeBlock) ? kObjectSize
+                                               : sizeof(FreeBlock),
+               ALIGNMENT);
+  // Number of blocks moved between a thread and the global free list at once.
+  static constexpr size_t BATCH_SIZE = 512;
+  // Number of blocks per chunk requested from the system.
+  static constexpr size_t CHUNK_BLOCKS = 8 * BATCH_SIZE;
+
+  struct FreeList {
+    FreeBlock* head{nullptr};
+    size_t count{0};
+
+    void push(FreeBlock* block) {
+      block->next = head;
+      head = block;
+      ++count;
+    }
+
+    FreeBlock* pop() {
+      FreeBlock* block = head;
+      head = block->next;
+      --count;
+      return block;
+    }
+
+    // Detach the first `n` blocks into a separate list.
+    FreeList split(size_t n) {
+      FreeList front;
+      front.head = head;
+      front.count = n;
+      FreeBlock* last = head;
+      for (size_t i = 1; i < n; ++i) {
+        last = last->next;
+      }
+      head = last->next;
+      last->next = nullptr;
+      count -= n;
+      return front;
+    }
+  };
+
+  struct Global {
+    std::mutex lock;
+    std::vector<FreeList> batches;
+  };
+
+  // Intentionally leaked: objects may be freed during static destruction.
+  static Global& global() {
+    static Global* s_global = new Global();
+    return *s_global;
+  }
+
+  // Hands the thread's remaining free blocks back when the thread exits. The
+  // list itself is trivially destructible, so frees that happen after this
+  // runs still have somewhere to go (they are merely not shared any more).
+  struct ThreadCache {
+    ~ThreadCache() {
+      auto& list = local();
+      if (list.count > 0) {
+        auto& g = global();
+        std::lock_guard<std::mutex> lock(g.lock);
+        g.batches.push_back(std::exchange(list, FreeList()));
+      }
+    }
+    bool registered{false};
+  };
+
+  static FreeList& local() {
+    static thread_local FreeList s_list;
+    return s_list;
+  }
+
+  // Called by every thread that gets blocks into its list, whether it
+  // allocates or only frees, so that its blocks are handed back on exit.
+  static void register_thread() {
+    static thread_local ThreadCache s_cache;
+    s_cache.registered = true;
+  }
+
+  static void refill(FreeList& list) {
+    register_thread();
+    {
+      auto& g = global();
+      std::lock_guard<std::mutex> lock(g.lock);
+      if (!g.batches.empty()) {
+        list = g.batches.back();
+        g.batches.pop_back();
+        return;
+      }
+    }
+    auto chunk = static_cast<char*>(::operator new(
+        CHUNK_BLOCKS * BLOCK_SIZE, std::align_val_t(ALIGNMENT)));
+    for (size_t i = CHUNK_BLOCKS; i > 0; --i) {
+      list.push(reinterpret_cast<FreeBlock*>(chunk + (i - 1) * BLOCK_SIZE));
+    }
+  }
+
+ public:
+  static void* allocate(size_t size) {
+    if (sanitizers::kIsAsan || size != kObjectSize) {
+      return ::operator new(size);
+    }
+    auto& list = local();
+    if (list.head == nullptr) {
+      refill(list);
+    }
+    return list.pop();
+  }
+
+  static void deallocate(void* ptr, size_t size) {
+    if (ptr == nullptr) {
+      return;
+    }
+    if (sanitizers::kIsAsan || size != kObjectSize) {
+      ::operator delete(ptr);
+      return;
+    }
+    auto& list = local();
+    if (list.head == nullptr) {
+      register_thread();
+    }
+    list.push(static_cast<FreeBlock*>(ptr));
+    if (list.count >= 2 * BATCH_SIZE) {
+      auto batch = list.split(BATCH_SIZE);
+      auto& g = global();
+      std::lock_guard<std::mutex> lock(g.lock);
+      g.batches.push_back(batch);
+    }
+  }
+};
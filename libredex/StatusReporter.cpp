@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "StatusReporter.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#include "Debug.h"
+#include "SpartaWorkQueue.h"
+#include "WorkQueue.h"
+
+namespace status_reporter {
+
+namespace {
+
+using clock = std::chrono::steady_clock;
+
+constexpr auto kDefaultInterval = std::chrono::milliseconds(1000);
+
+struct State {
+  std::mutex lock;
+  std::condition_variable cv;
+  bool running{false};
+  std::thread thread;
+  std::string path;
+  std::chrono::milliseconds interval{kDefaultInterval};
+  std::string phase;
+  clock::time_point start;
+  // As of the previous report, for the CPU utilization since then.
+  clock::time_point last_wall;
+  std::clock_t last_cpu{0};
+};
+
+// Intentionally leaked, like the state of chrome_trace.
+State& state() {
+  static State* s_state = new State();
+  return *s_state;
+}
+
+void write_escaped(std::ostream& os, const std::string& str) {
+  static const char* hex = "0123456789abcdef";
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (c < 0x20) {
+      os << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    } else {
+      os << c;
+    }
+  }
+}
+
+// Requires the lock of `s`. The report is written next to the status file and
+// then renamed over it, so that readers never see a partial report.
+void write_report(State& s, bool done) {
+  auto now = clock::now();
+  auto cpu = std::clock();
+  std::chrono::duration<double> wall = now - s.last_wall;
+  double cpu_s = (double)(cpu - s.last_cpu) / CLOCKS_PER_SEC;
+  auto num_threads = redex_parallel::default_num_threads();
+  double utilization =
+      wall.count() > 0 ? cpu_s / (wall.count() * num_threads) : 0;
+  s.last_wall = now;
+  s.last_cpu = cpu;
+
+  auto tmp_path = s.path + ".tmp";
+  {
+    std::ofstream os(tmp_path);
+    std::chrono::duration<double> elapsed = now - s.start;
+    os << "{\"elapsed_s\":" << elapsed.count() << ",\"phase\":\"";
+    write_escaped(os, s.phase);
+    os << "\",\"done\":" << (done ? "true" : "false") << ",\"work_queues\":[";
+    bool first = true;
+    for (const auto& progress :
+         sparta::workqueue_impl::ProgressRegistry::get().snapshot()) {
+      os << (first ? "" : ",") << "{\"done\":" << progress.done
+         << ",\"total\":" << progress.total << "}";
+      first = false;
+    }
+    os << "],\"vm_rss\":" << get_mem_stats().vm_rss
+       << ",\"cpu_utilization\":" << utilization
+       << ",\"num_threads\":" << num_threads << "}\n";
+  }
+  std::rename(tmp_path.c_str(), s.path.c_str());
+}
+
+void report_until_finished() {
+  auto& s = state();
+  std::unique_lock<std::mutex> lock(s.lock);
+  while (s.running) {
+    write_report(s, /* done */ false);
+    s.cv.wait_for(lock, s.interval, [&s] { return !s.running; });
+  }
+}
+
+} // namespace
+
+void start(const std::string& path, std::chrono::milliseconds interval) {
+  finish();
+  auto& s = state();
+  std::lock_guard<std::mutex> guard(s.lock);
+  s.path = path;
+  s.interval = interval;
+  s.start = s.last_wall = clock::now();
+  s.last_cpu = std::clock();
+  s.running = true;
+  s.thread = std::thread(report_until_finished);
+}
+
+void start_from_env() {
+  const char* path = std::getenv("REDEX_STATUS_FILE");
+  if (path == nullptr || *path == '\0') {
+    return;
+  }
+  auto interval = kDefaultInterval;
+  const char* interval_ms = std::getenv("REDEX_STATUS_INTERVAL_MS");
+  if (interval_ms != nullptr && std::atoi(interval_ms) > 0) {
+    interval = std::chrono::milliseconds(std::atoi(interval_ms));
+  }
+  start(path, interval);
+}
+
+void finish() {
+  auto& s = state();
+  {
+    std::lock_guard<std::mutex> guard(s.lock);
+    if (!s.running) {
+      return;
+    }
+    s.running = false;
+  }
+  s.cv.notify_all();
+  s.thread.join();
+  std::lock_guard<std::mutex> guard(s.lock);
+  write_report(s, /* done */ true);
+}
+
+void set_phase(const std::string& phase) {
+  auto& s = state();
+  std::lock_guard<std::mutex> guard(s.lock);
+  s.phase = phase;
+}
+
+} // namespace status_reporter
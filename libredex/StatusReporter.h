@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+
+/**
+ * Periodically writes what Redex is doing to a status file, so that whatever
+ * runs Redex can notice a stall or a runaway build while it happens, rather
+ * than from the stats at the end.
+ *
+ * Reporting is off unless start() is called. redex-all calls
+ * start_from_env(), which starts it when the REDEX_STATUS_FILE environment
+ * variable names the status file, every REDEX_STATUS_INTERVAL_MS milliseconds
+ * or every second.
+ *
+ * Each report replaces the file with a single JSON object: the seconds since
+ * the start, the current phase (e.g. the pass that runs), the done and total
+ * tasks of each running work queue, the RSS, and the CPU time since the
+ * previous report as a fraction of the wall time of all the threads.
+ */
+namespace status_reporter {
+
+// Start reporting to `path` every `interval`, from a background thread.
+void start(const std::string& path, std::chrono::milliseconds interval);
+
+// Start reporting if the environment asks for it, see above.
+void start_from_env();
+
+// Write a last report, and stop reporting.
+void finish();
+
+// Name what Redex is doing from now on, for the reports.
+void set_phase(const std::string& phase);
+
+} // namespace status_reporter
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SuffixArray.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "Debug.h"
+
+namespace suffix_array {
+
+std::vector<uint32_t> build(const Text& text) {
+  const size_t n = text.size();
+  std::vector<uint32_t> sa(n);
+  std::iota(sa.begin(), sa.end(), 0);
+  if (n == 0) {
+    return sa;
+  }
+
+  // Initial ranks are the dense ranks of the symbols.
+  std::sort(sa.begin(), sa.end(), [&text](uint32_t a, uint32_t b) {
+    return text[a] < text[b];
+  });
+  std::vector<uint32_t> rank(n);
+  rank[sa[0]] = 0;
+  for (size_t i = 1; i < n; i++) {
+    rank[sa[i]] = rank[sa[i - 1]] + (text[sa[i]] != text[sa[i - 1]]);
+  }
+
+  std::vector<uint32_t> by_second(n);
+  std::vector<uint32_t> new_rank(n);
+  std::vector<uint32_t> counts;
+  for (size_t k = 1; rank[sa[n - 1]] + 1 < n; k <<= 1) {
+    // Order by the rank of the second half: suffixes that have none come
+    // first, then the others in the order of their second halves.
+    size_t j = 0;
+    for (size_t i = n - k; i < n; i++) {
+      by_second[j++] = i;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (sa[i] >= k) {
+        by_second[j++] = sa[i] - k;
+      }
+    }
+    // Then stably by the rank of the first half.
+    counts.assign(rank[sa[n - 1]] + 1, 0);
+    for (size_t i = 0; i < n; i++) {
+      counts[rank[i]]++;
+    }
+    std::partial_sum(counts.begin(), counts.end(), counts.begin());
+    for (size_t i = n; i-- > 0;) {
+      sa[--counts[rank[by_second[i]]]] = by_second[i];
+    }
+
+    auto second = [&](uint32_t i) -> int64_t {
+      return i + k < n ? rank[i + k] : -1;
+    };
+    new_rank[sa[0]] = 0;
+    for (size_t i = 1; i < n; i++) {
+      auto a = sa[i - 1];
+      auto b = sa[i];
+      bool differs = rank[a] != rank[b] || second(a) != second(b);
+      new_rank[b] = new_rank[a] + differs;
+    }
+    rank.swap(new_rank);
+  }
+  return sa;
+}
+
+std::vector<uint32_t> build_lcp(const Text& text,
+                                const std::vector<uint32_t>& sa) {
+  const size_t n = text.size();
+  always_assert(sa.size() == n);
+  std::vector<uint32_t> rank(n);
+  for (size_t i = 0; i < n; i++) {
+    rank[sa[i]] = i;
+  }
+  std::vector<uint32_t> lcp(n, 0);
+  size_t h = 0;
+  for (size_t i = 0; i < n; i++) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    size_t j = sa[rank[i] - 1];
+    while (i + h < n && j + h < n && text[i + h] == text[j + h]) {
+      h++;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+  return lcp;
+}
+
+std::vector<uint32_t> longest_repeated_prefixes(const Text& text) {
+  const size_t n = text.size();
+  auto sa = build(text);
+  auto lcp = build_lcp(text, sa);
+  // The longest match of a suffix is with one of its neighbors in the suffix
+  // array.
+  std::vector<uint32_t> res(n);
+  for (size_t i = 0; i < n; i++) {
+    res[sa[i]] = std::max(lcp[i], i + 1 < n ? lcp[i + 1] : 0);
+  }
+  return res;
+}
+
+} // namespace suffix_array
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Suffix arrays over texts of integer symbols, e.g. interned instructions,
+ * to find all repeated subsequences in O(n log n) time.
+ */
+namespace suffix_array {
+
+using Text = std::vector<uint32_t>;
+
+/*
+ * The starting positions of all suffixes of the text, in lexicographic order.
+ * Built by prefix doubling with radix sorts.
+ */
+std::vector<uint32_t> build(const Text& text);
+
+/*
+ * The length of the longest common prefix of the suffixes at sa[i - 1] and
+ * sa[i], for each i > 0; element 0 is 0. Kasai's algorithm, in linear time.
+ */
+std::vector<uint32_t> build_lcp(const Text& text,
+                                const std::vector<uint32_t>& sa);
+
+/*
+ * For each position of the text, the length of the longest subsequence
+ * starting there that also starts at some other position.
+ *
+ * To keep repeats within segments of a concatenated text, separate the
+ * segments with symbols that occur nowhere else.
+ */
+std::vector<uint32_t> longest_repeated_prefixes(const Text& text);
+
+} // namespace suffix_array
@@ -7,6 +7,7 @@
 
 #include "Timer.h"
 
+#include "ChromeTrace.h"
 #include "Trace.h"
 
 unsigned Timer::s_indent = 0;
@@ -24,6 +25,13 @@ Timer::~Timer() {
   auto duration_s = std::chrono::duration<double>(end - m_start).count();
   TRACE(TIME, 1, "%*s%s completed in %.1lf seconds", 4 * s_indent, "",
         m_msg.c_str(), duration_s);
+  if (chrome_trace::enabled()) {
+    auto trace_end = chrome_trace::clock::now();
+    auto trace_begin =
+        trace_end - std::chrono::duration_cast<chrome_trace::clock::duration>(
+                        end - m_start);
+    chrome_trace::complete_event(m_msg, "timer", trace_begin, trace_end);
+  }
 
   Timer::add_timer(std::move(m_msg), duration_s);
 }
@@ -8,6 +8,9 @@
 #include "Trace.h"
 
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
@@ -16,8 +19,10 @@
 #include <iostream>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "Debug.h"
 #include "Macros.h"
@@ -31,6 +36,57 @@ struct TraceContextAccess {
 
 namespace {
 
+using Clock = std::chrono::system_clock;
+
+// A trace line, formatted but not yet written out.
+struct TraceRecord {
+  Clock::time_point time;
+  uint32_t thread;
+  uint16_t module;
+  uint8_t level;
+  bool suppress_newline;
+  std::string text;
+};
+
+uint32_t current_trace_thread() {
+  static std::atomic<uint32_t> s_next{0};
+  static thread_local uint32_t s_thread = s_next++;
+  return s_thread;
+}
+
+// Format into a per-thread buffer, so that the formatting needs no lock.
+std::string format_trace(const char* fmt, va_list ap) {
+  static thread_local std::vector<char> s_buffer(256);
+  va_list backup;
+  va_copy(backup, ap);
+  auto size = vsnprintf(s_buffer.data(), s_buffer.size(), fmt, ap);
+  if (size >= 0 && static_cast<size_t>(size) >= s_buffer.size()) {
+    s_buffer.resize(size + 1);
+    vsnprintf(s_buffer.data(), s_buffer.size(), fmt, backup);
+  }
+  va_end(backup);
+  return std::string(s_buffer.data(), size < 0 ? 0 : size);
+}
+
+/*
+ * With TRACE_FORMAT=binary, the trace file starts with the magic "RDXTRACE",
+ * a uint32 version and the module names, as a uint32 count followed by, for
+ * each module id, a uint8 length and the name. Each record is then a uint64
+ * timestamp in nanoseconds since the epoch, a uint32 thread number, a uint16
+ * module id, a uint8 level, a uint8 of flags (1: no newline), a uint32 length
+ * and the text. All integers are little-endian.
+ */
+constexpr uint32_t kBinaryTraceVersion = 1;
+
+template <typename T>
+void write_le(FILE* file, T value) {
+  std::array<uint8_t, sizeof(T)> bytes;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    bytes[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8 * i));
+  }
+  fwrite(bytes.data(), 1, bytes.size(), file);
+}
+
 struct Tracer {
 
   bool m_show_timestamps{false};
@@ -75,9 +131,33 @@ struct Tracer {
 #define TM(x) m_module_id_name_map[static_cast<int>(x)] = #x;
     TMS
 #undef TM
+
+    const char* format = getenv("TRACE_FORMAT");
+    if (format != nullptr && strcmp(format, "binary") == 0) {
+      m_binary = true;
+      write_binary_header();
+    }
+    // Write the traces from a background thread, so that the traced threads
+    // only pay for formatting.
+    const char* async = getenv("TRACE_ASYNC");
+    if (async != nullptr && strcmp(async, "0") != 0) {
+      m_writer = std::thread([this] { run_writer(); });
+    }
+    std::cerr << "TRACE_FORMAT=" << (m_binary ? "binary" : "text")
+              << std::endl;
+    std::cerr << "TRACE_ASYNC=" << (m_writer.joinable() ? "1" : "0")
+              << std::endl;
   }
 
   ~Tracer() {
+    if (m_writer.joinable()) {
+      {
+        std::lock_guard<std::mutex> guard(m_queue_mutex);
+        m_stop = true;
+      }
+      m_queue_cv.notify_one();
+      m_writer.join();
+    }
     if (m_file != nullptr && m_file != stderr) {
       fclose(m_file);
     }
@@ -114,9 +194,83 @@ struct Tracer {
              va_list ap) {
     // Assume that `trace` is never called without `traceEnabled`, so we
     // do not need to check anything (including context) here.
+    TraceRecord record{Clock::now(),
+                       current_trace_thread(),
+                       static_cast<uint16_t>(module),
+                       static_cast<uint8_t>(level),
+                       suppress_newline,
+                       format_trace(fmt, ap)};
+    if (m_writer.joinable()) {
+      bool was_empty;
+      {
+        std::lock_guard<std::mutex> guard(m_queue_mutex);
+        was_empty = m_queue.empty();
+        m_queue.push_back(std::move(record));
+      }
+      if (was_empty) {
+        m_queue_cv.notify_one();
+      }
+      return;
+    }
     std::lock_guard<std::mutex> guard(m_trace_mutex);
+    write(record);
+    fflush(m_file);
+  }
+
+  void flush() {
+    if (!m_writer.joinable()) {
+      return;
+    }
+    std::unique_lock<std::mutex> trace_lock(m_trace_mutex, std::try_to_lock);
+    std::unique_lock<std::mutex> queue_lock(m_queue_mutex, std::try_to_lock);
+    if (!trace_lock.owns_lock() || !queue_lock.owns_lock()) {
+      return;
+    }
+    for (const auto& record : m_queue) {
+      write(record);
+    }
+    m_queue.clear();
+    fflush(m_file);
+  }
+
+ private:
+  void run_writer() {
+    std::vector<TraceRecord> records;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(m_queue_mutex);
+        m_queue_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty()) {
+          return;
+        }
+        records.swap(m_queue);
+      }
+      std::lock_guard<std::mutex> guard(m_trace_mutex);
+      for (const auto& record : records) {
+        write(record);
+      }
+      fflush(m_file);
+      records.clear();
+    }
+  }
+
+  // Requires m_trace_mutex.
+  void write(const TraceRecord& record) {
+    if (m_binary) {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    record.time.time_since_epoch())
+                    .count();
+      write_le<uint64_t>(m_file, ns);
+      write_le<uint32_t>(m_file, record.thread);
+      write_le<uint16_t>(m_file, record.module);
+      write_le<uint8_t>(m_file, record.level);
+      write_le<uint8_t>(m_file, record.suppress_newline ? 1 : 0);
+      write_le<uint32_t>(m_file, record.text.size());
+      fwrite(record.text.data(), 1, record.text.size(), m_file);
+      return;
+    }
     if (m_show_timestamps) {
-      auto t = std::time(nullptr);
+      auto t = Clock::to_time_t(record.time);
       struct tm local_tm;
 #if IS_WINDOWS
       localtime_s(&local_tm, &t);
@@ -131,12 +285,24 @@ struct Tracer {
       }
     }
     if (m_show_tracemodule) {
-      fprintf(m_file, "[%s:%d] ", m_module_id_name_map[module].c_str(), level);
+      fprintf(m_file, "[%s:%d] ", m_module_id_name_map[record.module].c_str(),
+              record.level);
     }
-    vfprintf(m_file, fmt, ap);
-    if (!suppress_newline) {
+    fwrite(record.text.data(), 1, record.text.size(), m_file);
+    if (!record.suppress_newline) {
       fprintf(m_file, "\n");
     }
+  }
+
+  void write_binary_header() {
+    fwrite("RDXTRACE", 1, 8, m_file);
+    write_le<uint32_t>(m_file, kBinaryTraceVersion);
+    write_le<uint32_t>(m_file, N_TRACE_MODULES);
+    for (int module = 0; module < N_TRACE_MODULES; ++module) {
+      const auto& name = m_module_id_name_map[module];
+      write_le<uint8_t>(m_file, name.size());
+      fwrite(name.data(), 1, name.size(), m_file);
+    }
     fflush(m_file);
   }
 
@@ -201,18 +367,31 @@ struct Tracer {
   long m_level{0};
   std::array<long, N_TRACE_MODULES> m_traces;
 
+  bool m_binary{false};
+
+  // Guards the writes to m_file.
   std::mutex m_trace_mutex;
+
+  // The records that the writer thread has yet to write, if tracing is
+  // asynchronous.
+  std::thread m_writer;
+  std::mutex m_queue_mutex;
+  std::condition_variable m_queue_cv;
+  std::vector<TraceRecord> m_queue;
+  bool m_stop{false};
 };
 
 static Tracer tracer;
 } // namespace
 
-#ifndef NDEBUG
-bool traceEnabled(TraceModule module, int level) {
+#if REDEX_TRACE_MAX_LEVEL > 0
+bool traceEnabledAtRuntime(TraceModule module, int level) {
   return tracer.traceEnabled(module, level);
 }
 #endif
 
+void trace_flush() { tracer.flush(); }
+
 void trace(TraceModule module,
            int level,
            bool suppress_newline,
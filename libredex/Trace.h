@@ -37,6 +37,7 @@ class DexType;
   TM(CHECKRECURSION)  \
   TM(CIC)             \
   TM(CLA)             \
+  TM(CLINIT)          \
   TM(CLMG)            \
   TM(CLP_LITHO)       \
   TM(CONSTP)          \
@@ -61,6 +62,7 @@ class DexType;
   TM(GETTER)          \
   TM(GQL)             \
   TM(HASHER)          \
+  TM(HCS)             \
   TM(ICONSTP)         \
   TM(IDEX)            \
   TM(IFCS_ANALYSIS)   \
@@ -74,6 +76,7 @@ class DexType;
   TM(ISO)             \
   TM(LCR_PASS)        \
   TM(LIB)             \
+  TM(LICM)            \
   TM(LOC)             \
   TM(LOCKS)           \
   TM(LOOP)            \
@@ -108,6 +111,7 @@ class DexType;
   TM(QUICK)           \
   TM(RABBIT)          \
   TM(RAL)             \
+  TM(RANGE_CHECK)     \
   TM(RBB)             \
   TM(REACH)           \
   TM(REFL)            \
@@ -124,6 +128,7 @@ class DexType;
   TM(RMUF)            \
   TM(RMUNINST)        \
   TM(RP)              \
+  TM(SCALAR_REPL)     \
   TM(SDIS)            \
   TM(SHORTEN)         \
   TM(SPLIT_RES)       \
@@ -135,6 +140,7 @@ class DexType;
   TM(SW)              \
   TM(SWIN)            \
   TM(SWITCH_EQUIV)    \
+  TM(SWITCH_PEEL)     \
   TM(SYNT)            \
   TM(TIME)            \
   TM(TP)              \
@@ -160,14 +166,33 @@ enum TraceModule : int {
       N_TRACE_MODULES,
 };
 
+// Traces of a level above REDEX_TRACE_MAX_LEVEL are compiled out. By default
+// NDEBUG builds have no tracing at all; define e.g. REDEX_TRACE_MAX_LEVEL=2 to
+// keep moderate tracing in optimized builds for post-mortem diagnostics.
+#ifndef REDEX_TRACE_MAX_LEVEL
+#ifdef NDEBUG
+#define REDEX_TRACE_MAX_LEVEL 0
+#else
+#define REDEX_TRACE_MAX_LEVEL 100
+#endif
+#endif
+
 // To avoid "-Wunused" warnings, keep the TRACE macros in common so that the
 // compiler sees a "use." However, ensure that it is optimized away through
-// a constexpr condition in NDEBUG mode.
-#ifdef NDEBUG
+// a constexpr condition when tracing is compiled out.
+#if REDEX_TRACE_MAX_LEVEL <= 0
 constexpr bool traceEnabled(TraceModule, int) { return false; }
 #else
-bool traceEnabled(TraceModule module, int level);
-#endif // NDEBUG
+bool traceEnabledAtRuntime(TraceModule module, int level);
+// The level is almost always a literal, so the first check folds away.
+inline bool traceEnabled(TraceModule module, int level) {
+  return level <= REDEX_TRACE_MAX_LEVEL && traceEnabledAtRuntime(module, level);
+}
+#endif
+
+// Write out the traces that are still buffered, e.g. before crashing. Does
+// nothing if another thread is writing traces.
+void trace_flush();
 
 void trace(TraceModule module,
            int level,
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "ClassHierarchy.h"
+#include "CompactClassHierarchy.h"
 #include "DexClass.h"
 #include "VirtualScope.h"
 
@@ -35,6 +36,9 @@ class TypeSystem {
   static const TypeVector empty_vec;
 
   ClassScopes m_class_scopes;
+  // The class hierarchy and interface map of m_class_scopes, encoded for
+  // constant-time subtype checks.
+  CompactClassHierarchy m_compact_hierarchy;
   ClassHierarchy m_intf_children;
   InstanceOfTable m_instanceof_table;
   TypeToTypeSet m_interfaces;
@@ -106,16 +110,7 @@ class TypeSystem {
    * The type must be a class (not an interface).
    */
   bool is_subtype(const DexType* parent, const DexType* child) const {
-    const auto& parent_it = m_instanceof_table.find(parent);
-    const auto& child_it = m_instanceof_table.find(child);
-    if (parent_it == m_instanceof_table.end() ||
-        child_it == m_instanceof_table.end()) {
-      return false;
-    }
-    const auto& p_chain = parent_it->second;
-    const auto& c_chain = child_it->second;
-    if (p_chain.size() > c_chain.size()) return false;
-    return c_chain.at(p_chain.size() - 1) == parent;
+    return m_compact_hierarchy.is_subclass(parent, child);
   }
 
   /**
@@ -124,9 +119,7 @@ class TypeSystem {
    * or an interface DAG.
    */
   bool implements(const DexType* cls, const DexType* intf) const {
-    const auto& implementors = m_class_scopes.get_interface_map().find(intf);
-    if (implementors == m_class_scopes.get_interface_map().end()) return false;
-    return implementors->second.count(cls) > 0;
+    return m_compact_hierarchy.implements(cls, intf);
   }
 
   /**
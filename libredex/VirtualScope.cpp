@@ -13,8 +13,10 @@
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 #include <map>
+#include <numeric>
 #include <set>
 
 namespace {
@@ -198,7 +200,7 @@ BaseSigs load_base_sigs(SignatureMap& sig_map) {
 /**
  * VirtualScope merge functions.
  */
-void merge(VirtualScope& scope, const VirtualScope& another) {
+void merge(VirtualScope& scope, VirtualScope&& another) {
   TRACE(VIRT,
         4,
         "merge scopes %s, %s - %s, %s",
@@ -206,10 +208,14 @@ void merge(VirtualScope& scope, const VirtualScope& another) {
         SHOW(scope.methods[0].first),
         SHOW(another.type),
         SHOW(another.methods[0].first));
-  for (const auto& meth : another.methods) {
-    scope.methods.push_back(meth);
+  scope.methods.insert(scope.methods.end(), another.methods.begin(),
+                       another.methods.end());
+  if (scope.interfaces.empty()) {
+    scope.interfaces = std::move(another.interfaces);
+  } else {
+    scope.interfaces.insert(another.interfaces.begin(),
+                            another.interfaces.end());
   }
-  scope.interfaces.insert(another.interfaces.begin(), another.interfaces.end());
 }
 
 /**
@@ -320,7 +326,7 @@ void build_interface_scope(const DexType* type,
 }
 
 /**
- * Merge 2 signatures map. The map from derived_sig_map is copied in
+ * Merge 2 signatures map. The map from derived_sig_map is moved in
  * base_sig_map.
  * Interface methods in base don't have an entry yet, that will be build later
  * because it's a straight copy of the class virtual scope.
@@ -328,7 +334,7 @@ void build_interface_scope(const DexType* type,
 void merge(const BaseSigs& base_sigs,
            const BaseIntfSigs& base_intf_sig_map,
            SignatureMap& base_sig_map,
-           const SignatureMap& derived_sig_map) {
+           SignatureMap&& derived_sig_map) {
 
   // Helpers
 
@@ -357,11 +363,19 @@ void merge(const BaseSigs& base_sigs,
       };
 
   // walk all derived signatures
-  for (const auto& derived_sig_entry : derived_sig_map) {
+  for (auto& derived_sig_entry : derived_sig_map) {
     const auto name = derived_sig_entry.first;
-    auto& name_map = base_sig_map[name];
     auto& derived_protos_map = derived_sig_entry.second;
-    for (const auto& derived_scopes_it : derived_protos_map) {
+    // a name that neither base nor the previous children know of moves over
+    // with all its protos at once
+    auto name_it = base_sig_map.lower_bound(name);
+    if (name_it == base_sig_map.end() || name_it->first != name) {
+      TRACE(VIRT, 4, "- no scope (%s) in base, move over", SHOW(name));
+      base_sig_map.emplace_hint(name_it, name, std::move(derived_protos_map));
+      continue;
+    }
+    auto& name_map = name_it->second;
+    for (auto& derived_scopes_it : derived_protos_map) {
       const auto proto = derived_scopes_it.first;
       auto& virt_scopes = name_map[proto];
       // the signature in derived does not exists in base
@@ -371,9 +385,8 @@ void merge(const BaseSigs& base_sigs,
               "- no scope (%s:%s) in base, copy over",
               SHOW(name),
               SHOW(proto));
-        // not a known signature in original base, copy over
-        const auto& scopes = derived_scopes_it.second;
-        virt_scopes.insert(virt_scopes.end(), scopes.begin(), scopes.end());
+        // not a known signature in original base, move over
+        auto& scopes = derived_scopes_it.second;
         if (traceEnabled(VIRT, 4)) {
           for (const auto& scope : scopes) {
             TRACE(VIRT,
@@ -386,6 +399,13 @@ void merge(const BaseSigs& base_sigs,
                   SHOW(scope.methods[0].first));
           }
         }
+        if (virt_scopes.empty()) {
+          virt_scopes = std::move(scopes);
+        } else {
+          virt_scopes.insert(virt_scopes.end(),
+                             std::make_move_iterator(scopes.begin()),
+                             std::make_move_iterator(scopes.end()));
+        }
         continue;
       }
 
@@ -407,7 +427,7 @@ void merge(const BaseSigs& base_sigs,
                     !is_interface(type_class(virt_scopes[0].type)));
       // walk every scope in derived that we have to merge
       TRACE(VIRT, 4, "-- walking scopes");
-      for (const auto& scope : derived_scopes_it.second) {
+      for (auto& scope : derived_scopes_it.second) {
         // if the scope was for a class (!interface) we merge
         // with that of base which is now the top definition
         TRACE(VIRT,
@@ -429,7 +449,7 @@ void merge(const BaseSigs& base_sigs,
                 SHOW(virt_scopes[0].type),
                 virt_scopes[0].methods.size(),
                 SHOW(virt_scopes[0].methods[0].first));
-          merge(virt_scopes[0], scope);
+          merge(virt_scopes[0], std::move(scope));
           continue;
         }
         // interface case. If derived was for an interface in base
@@ -442,7 +462,7 @@ void merge(const BaseSigs& base_sigs,
                 SHOW(proto),
                 SHOW(scope.type),
                 SHOW(scope.methods[0].first));
-          virt_scopes.push_back(scope);
+          virt_scopes.push_back(std::move(scope));
           continue;
         }
         TRACE(VIRT,
@@ -666,16 +686,42 @@ bool build_signature_map(const ClassHierarchy& hierarchy,
   // recurse through every child to collect all methods
   // and interface methods under type
   bool escape_up = false;
-  for (const auto& child : children) {
-    SignatureMap child_sig_map;
-    escape_up =
-        build_signature_map(hierarchy, child, child_sig_map) || escape_up;
-    TRACE(VIRT,
-          3,
-          "* Merging sig map of %s with child %s",
-          SHOW(type),
-          SHOW(child));
-    merge(base_sigs, intf_sig_map, sig_map, child_sig_map);
+  if (type == type::java_lang_Object() && children.size() > 1) {
+    // The subtrees of the children of java.lang.Object make up most of the
+    // hierarchy and don't depend on one another, so they are built in
+    // parallel, then merged in order.
+    std::vector<const DexType*> children_vec(children.begin(), children.end());
+    std::vector<SignatureMap> child_sig_maps(children_vec.size());
+    std::vector<uint8_t> child_escapes(children_vec.size(), 0);
+    std::vector<size_t> indices(children_vec.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          child_escapes[i] = build_signature_map(hierarchy, children_vec[i],
+                                                 child_sig_maps[i]);
+        },
+        indices);
+    for (size_t i = 0; i < children_vec.size(); ++i) {
+      escape_up = child_escapes[i] || escape_up;
+      TRACE(VIRT,
+            3,
+            "* Merging sig map of %s with child %s",
+            SHOW(type),
+            SHOW(children_vec[i]));
+      merge(base_sigs, intf_sig_map, sig_map, std::move(child_sig_maps[i]));
+    }
+  } else {
+    for (const auto& child : children) {
+      SignatureMap child_sig_map;
+      escape_up =
+          build_signature_map(hierarchy, child, child_sig_map) || escape_up;
+      TRACE(VIRT,
+            3,
+            "* Merging sig map of %s with child %s",
+            SHOW(type),
+            SHOW(child));
+      merge(base_sigs, intf_sig_map, sig_map, std::move(child_sig_map));
+    }
   }
 
   TRACE(VIRT, 3, "* Marking methods at %s", SHOW(type));
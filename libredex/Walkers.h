@@ -18,6 +18,7 @@
 #include "EditableCfgAdapter.h"
 #include "IRCode.h"
 #include "Match.h"
+#include "MethodTiming.h"
 #include "Thread.h"
 #include "Trace.h"
 #include "VirtualScope.h"
@@ -400,12 +401,56 @@ class walk {
     }
   };
 
+  // A group of methods that is scheduled as a single work item by the
+  // cost-ordered parallel walkers. `cost` is the sum of the opcode sizes.
+  struct MethodBatch {
+    std::vector<DexMethod*> methods;
+    size_t cost{0};
+  };
+
+  // Methods whose code is at least this big get their own work item; smaller
+  // methods are batched until the batch reaches that size, to amortize the
+  // queueing overhead.
+  static constexpr size_t MIN_METHOD_BATCH_COST = 512;
+
+  template <class Classes, typename FilterFn>
+  static std::vector<MethodBatch> batch_methods_by_cost(
+      const Classes& classes, const FilterFn& filter) {
+    std::vector<MethodBatch> batches;
+    MethodBatch small;
+    for (const auto& cls : classes) {
+      iterate_methods(cls, [&](DexMethod* m) {
+        if (!filter(m)) {
+          return;
+        }
+        auto code = m->get_code();
+        size_t cost = code ? code->sum_opcode_sizes() : 0;
+        if (cost >= MIN_METHOD_BATCH_COST) {
+          batches.push_back(MethodBatch{{m}, cost});
+          return;
+        }
+        small.methods.push_back(m);
+        small.cost += cost;
+        if (small.cost >= MIN_METHOD_BATCH_COST) {
+          batches.push_back(std::move(small));
+          small = MethodBatch();
+        }
+      });
+    }
+    if (!small.methods.empty()) {
+      batches.push_back(std::move(small));
+    }
+    return batches;
+  }
+
  public:
   /**
    * The parallel:: methods have very similar signatures (and names) to their
    * sequential counterparts.
    * The unit of parallelization is a DexClass. The reason is that we don't want
    * to create too many tasks on the WorkQueue, paying the overhead for each.
+   * The *_by_cost variants instead parallelize over methods, batching small
+   * ones together, and schedule the biggest methods first.
    */
   class parallel {
    public:
@@ -437,7 +482,11 @@ class walk {
         const WalkerFn& walker,
         size_t num_threads = redex_parallel::default_num_threads()) {
       workqueue_run<DexClass*>(
-          [&walker](DexClass* cls) { walk::iterate_methods(cls, walker); },
+          [&walker](DexClass* cls) {
+            walk::iterate_methods(cls, [&walker](DexMethod* method) {
+              method_timing::run(method, [&] { walker(method); });
+            });
+          },
           classes,
           num_threads);
     }
@@ -467,11 +516,11 @@ class walk {
             Accumulator& acc = acc_vec[state->worker_id()];
             for (auto dmethod : cls->get_dmethods()) {
               TraceContext context(dmethod);
-              walker(dmethod, &acc);
+              method_timing::run(dmethod, [&] { walker(dmethod, &acc); });
             }
             for (auto vmethod : cls->get_vmethods()) {
               TraceContext context(vmethod);
-              walker(vmethod, &acc);
+              method_timing::run(vmethod, [&] { walker(vmethod, &acc); });
             }
           },
           classes,
@@ -512,6 +561,88 @@ class walk {
           init);
     }
 
+    // Like `methods()`, but the unit of parallelization is a single method
+    // (or a batch of small methods) instead of a class, and the work is
+    // scheduled in order of decreasing code size. Use this when a few huge
+    // methods would otherwise dominate the run time of the pass.
+    //   WalkerFn should accept a `DexMethod*`.
+    template <class Classes, typename WalkerFn>
+    static void methods_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      auto batches = batch_methods_by_cost(classes, all_methods);
+      workqueue_run_by_cost<const MethodBatch*>(
+          [&walker](const MethodBatch* batch) {
+            for (auto method : batch->methods) {
+              TraceContext context(method);
+              method_timing::run(method, [&] { walker(method); });
+            }
+          },
+          batch_ptrs(batches),
+          [](const MethodBatch* batch) { return batch->cost; },
+          num_threads);
+    }
+
+    // Cost-ordered counterpart of the Accumulator-based `methods()`.
+    //   WalkerFn should accept `(DexMethod*, Accumulator&)`.
+    template <
+        class Accumulator,
+        class Reduce = plus_assign<Accumulator>,
+        class Classes,
+        typename WalkerFn,
+        typename std::enable_if<Arity<WalkerFn>::value == 2, int>::type = 0>
+    static Accumulator methods_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads(),
+        Accumulator init = Accumulator()) {
+      std::vector<CacheAligned<Accumulator>> acc_vec(num_threads, init);
+
+      auto batches = batch_methods_by_cost(classes, all_methods);
+      workqueue_run_by_cost<const MethodBatch*>(
+          [&](sparta::SpartaWorkerState<const MethodBatch*>* state,
+              const MethodBatch* batch) {
+            Accumulator& acc = acc_vec[state->worker_id()];
+            for (auto method : batch->methods) {
+              TraceContext context(method);
+              method_timing::run(method, [&] { walker(method, &acc); });
+            }
+          },
+          batch_ptrs(batches),
+          [](const MethodBatch* batch) { return batch->cost; },
+          num_threads);
+
+      auto reduce = Reduce();
+      for (Accumulator& acc : acc_vec) {
+        reduce(acc, &init);
+      }
+      return init;
+    }
+
+    // Cost-ordered counterpart of the Accumulator-returning `methods()`.
+    //   WalkerFn should accept a `DexMethod*` and return `Accumulator`.
+    template <
+        class Accumulator,
+        class Reduce = plus_assign<Accumulator>,
+        class Classes,
+        typename WalkerFn,
+        typename std::enable_if<Arity<WalkerFn>::value == 1, int>::type = 0>
+    static Accumulator methods_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads(),
+        Accumulator init = Accumulator()) {
+      auto reduce = Reduce();
+      return methods_by_cost<Accumulator, Reduce, Classes>(
+          classes,
+          [&](DexMethod* method, Accumulator* acc) {
+            reduce(walker(method), acc);
+          },
+          num_threads,
+          init);
+    }
+
     //
     // Call `walker` on all fields in `classes` in parallel.
     //   WalkerFn should accept a `DexField*`.
@@ -538,7 +669,10 @@ class walk {
         size_t num_threads = redex_parallel::default_num_threads()) {
       workqueue_run<DexClass*>(
           [&filter, &walker](DexClass* cls) {
-            walk::iterate_code(cls, filter, walker);
+            walk::iterate_code(
+                cls, filter, [&walker](DexMethod* method, IRCode& code) {
+                  method_timing::run(method, [&] { walker(method, code); });
+                });
           },
           classes,
           num_threads);
@@ -553,6 +687,42 @@ class walk {
       walk::parallel::code(classes, all_methods, walker, num_threads);
     }
 
+    // Like `code()`, but parallelized at method granularity and scheduled in
+    // order of decreasing code size; see `methods_by_cost()`.
+    //   FilterFn should accept a `DexMethod*` and return a bool.
+    //   WalkerFn should accept `(DexMethod*, IRCode&)`.
+    template <class Classes, typename FilterFn, typename WalkerFn>
+    static void code_by_cost(
+        const Classes& classes,
+        const FilterFn& filter,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      auto batches = batch_methods_by_cost(classes, filter);
+      workqueue_run_by_cost<const MethodBatch*>(
+          [&walker](const MethodBatch* batch) {
+            for (auto method : batch->methods) {
+              auto code = method->get_code();
+              if (code) {
+                TraceContext context(method);
+                method_timing::run(method, [&] { walker(method, *code); });
+              }
+            }
+          },
+          batch_ptrs(batches),
+          [](const MethodBatch* batch) { return batch->cost; },
+          num_threads);
+    }
+
+    // Same as `code_by_cost()` but with a filter function that accepts all
+    // methods
+    template <class Classes, typename WalkerFn>
+    static void code_by_cost(
+        const Classes& classes,
+        const WalkerFn& walker,
+        size_t num_threads = redex_parallel::default_num_threads()) {
+      walk::parallel::code_by_cost(classes, all_methods, walker, num_threads);
+    }
+
     // Call `walker` on all opcodes (of methods approved by `filter`) in
     // `classes` in parallel.
     //   FilterFn should accept a `DexMethod*` and return a bool.
@@ -646,5 +816,16 @@ class walk {
         size_t num_threads = redex_parallel::default_num_threads()) {
       workqueue_run<const VirtualScope*>(walker, virtual_scopes, num_threads);
     }
+
+   private:
+    static std::vector<const MethodBatch*> batch_ptrs(
+        const std::vector<MethodBatch>& batches) {
+      std::vector<const MethodBatch*> ptrs;
+      ptrs.reserve(batches.size());
+      for (const auto& batch : batches) {
+        ptrs.push_back(&batch);
+      }
+      return ptrs;
+    }
   };
 };
@@ -7,7 +7,14 @@
 
 #include "WorkQueue.h"
 
+#include <atomic>
+#include <fstream>
 #include <iostream>
+#include <string>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 #include "Debug.h"
 
@@ -18,3 +25,105 @@ void redex_queue_exception_handler(std::exception& e) {
 }
 
 } // namespace redex_workqueue_impl
+
+namespace redex_parallel {
+
+namespace {
+
+// 0 means the hardware concurrency.
+std::atomic<size_t> s_default_num_threads{0};
+
+thread_local const void* t_inherited_context = nullptr;
+
+#ifdef __linux__
+// Parses a kernel CPU list like "0-11,24-35".
+bool parse_cpu_list(const std::string& list, cpu_set_t* cpus) {
+  CPU_ZERO(cpus);
+  size_t count = 0;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    auto end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    auto range = list.substr(pos, end - pos);
+    pos = end + 1;
+    if (range.empty()) {
+      continue;
+    }
+    auto dash = range.find('-');
+    unsigned long first, last;
+    try {
+      first = std::stoul(range.substr(0, dash));
+      last = dash == std::string::npos ? first
+                                       : std::stoul(range.substr(dash + 1));
+    } catch (const std::exception&) {
+      return false;
+    }
+    for (auto cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, cpus);
+      ++count;
+    }
+  }
+  return count > 0;
+}
+#endif
+
+} // namespace
+
+size_t default_num_threads() {
+  auto num_threads = s_default_num_threads.load();
+  if (num_threads != 0) {
+    return num_threads;
+  }
+  // We prefer boost over std. Use hardware over physical concurrency
+  // to take advantage of SMT.
+  return std::max(1u, boost::thread::hardware_concurrency());
+}
+
+void set_default_num_threads(size_t num_threads) {
+  s_default_num_threads = num_threads;
+}
+
+ScopedThreadLimit::ScopedThreadLimit(size_t limit)
+    : m_previous(s_default_num_threads.load()) {
+  if (limit != 0 && limit < default_num_threads()) {
+    set_default_num_threads(limit);
+  }
+}
+
+ScopedThreadLimit::~ScopedThreadLimit() { set_default_num_threads(m_previous); }
+
+const void* inherited_context() { return t_inherited_context; }
+
+ScopedInheritedContext::ScopedInheritedContext(const void* context)
+    : m_previous(t_inherited_context) {
+  t_inherited_context = context;
+}
+
+ScopedInheritedContext::~ScopedInheritedContext() {
+  t_inherited_context = m_previous;
+}
+
+bool bind_to_numa_node(unsigned int node) {
+#ifdef __linux__
+  std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                   "/cpulist");
+  std::string list;
+  if (!std::getline(in, list)) {
+    return false;
+  }
+  cpu_set_t cpus;
+  if (!parse_cpu_list(list, &cpus) ||
+      sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+    return false;
+  }
+  set_default_num_threads(CPU_COUNT(&cpus));
+  return true;
+#else
+  (void)node;
+  return false;
+#endif
+}
+
+} // namespace redex_parallel
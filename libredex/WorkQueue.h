@@ -10,8 +10,34 @@
 #include <boost/thread/thread.hpp>
 #include <exception>
 
+#include "ChromeTrace.h"
 #include "SpartaWorkQueue.h"
 
+namespace redex_parallel {
+
+/*
+ * An opaque pointer of the calling thread that the worker threads of the work
+ * queues it creates see while they run the items of these queues, and so do
+ * the queues they create in turn. The PassManager uses it to tell which pass
+ * a worker thread works for. Unset by default.
+ */
+const void* inherited_context();
+
+// Set `inherited_context` for the lifetime of this object.
+class ScopedInheritedContext {
+ public:
+  explicit ScopedInheritedContext(const void* context);
+  ~ScopedInheritedContext();
+
+  ScopedInheritedContext(const ScopedInheritedContext&) = delete;
+  ScopedInheritedContext& operator=(const ScopedInheritedContext&) = delete;
+
+ private:
+  const void* m_previous;
+};
+
+} // namespace redex_parallel
+
 namespace redex_workqueue_impl {
 
 void redex_queue_exception_handler(std::exception& e);
@@ -20,7 +46,10 @@ void redex_queue_exception_handler(std::exception& e);
 template <typename Input, typename Fn>
 struct NoStateWorkQueueHelper {
   Fn fn;
-  void operator()(sparta::SpartaWorkerState<Input>*, Input a) {
+  const void* context{redex_parallel::inherited_context()};
+  void operator()(sparta::SpartaWorkerState<Input>* state, Input a) {
+    redex_parallel::ScopedInheritedContext inherited_context(context);
+    chrome_trace::ScopedWorkItem trace_item(state->worker_id());
     try {
       fn(a);
     } catch (std::exception& e) {
@@ -33,7 +62,10 @@ struct NoStateWorkQueueHelper {
 template <typename Input, typename Fn>
 struct WithStateWorkQueueHelper {
   Fn fn;
+  const void* context{redex_parallel::inherited_context()};
   void operator()(sparta::SpartaWorkerState<Input>* state, Input a) {
+    redex_parallel::ScopedInheritedContext inherited_context(context);
+    chrome_trace::ScopedWorkItem trace_item(state->worker_id());
     try {
       fn(state, a);
     } catch (std::exception& e) {
@@ -46,11 +78,41 @@ struct WithStateWorkQueueHelper {
 } // namespace redex_workqueue_impl
 
 namespace redex_parallel {
-inline size_t default_num_threads() {
-  // We prefer boost over std. Use hardware over physical concurrency
-  // to take advantage of SMT.
-  return std::max(1u, boost::thread::hardware_concurrency());
-}
+
+/*
+ * The number of threads of the work queues and parallel walkers that don't ask
+ * for a specific number. This is the hardware concurrency, unless overridden
+ * with `set_default_num_threads`.
+ */
+size_t default_num_threads();
+
+// Override `default_num_threads`, or reset it with 0.
+void set_default_num_threads(size_t num_threads);
+
+/*
+ * Limit `default_num_threads` to at most `limit` threads for the lifetime of
+ * this object, e.g. for the duration of a memory-bound pass. A limit of 0
+ * leaves it unchanged.
+ */
+class ScopedThreadLimit {
+ public:
+  explicit ScopedThreadLimit(size_t limit);
+  ~ScopedThreadLimit();
+
+  ScopedThreadLimit(const ScopedThreadLimit&) = delete;
+  ScopedThreadLimit& operator=(const ScopedThreadLimit&) = delete;
+
+ private:
+  size_t m_previous;
+};
+
+/*
+ * Restrict the calling thread, and so all the threads it creates afterwards,
+ * to the CPUs of the given NUMA node, and use as many threads by default.
+ * Only supported on Linux; returns false if the node could not be bound.
+ */
+bool bind_to_numa_node(unsigned int node);
+
 } // namespace redex_parallel
 
 // These functions are the most convenient way to create a SpartaWorkQueue
@@ -168,3 +230,44 @@ void workqueue_run(
   }
   wq.run_all();
 }
+
+// Like workqueue_run, but schedules the items by decreasing cost, as given by
+// `cost_fn(item)`, balancing the accumulated cost across the worker threads.
+// Use this when a few items are expected to dominate the total run time, e.g.
+// huge methods.
+template <class Input,
+          typename Fn,
+          typename Items,
+          typename CostFn,
+          typename std::enable_if<sparta::Arity<Fn>::value == 1, int>::type = 0>
+void workqueue_run_by_cost(
+    const Fn& fn,
+    const Items& items,
+    const CostFn& cost_fn,
+    unsigned int num_threads = redex_parallel::default_num_threads()) {
+  auto wq = sparta::SpartaWorkQueue<
+      Input,
+      redex_workqueue_impl::NoStateWorkQueueHelper<Input, Fn>>(
+      redex_workqueue_impl::NoStateWorkQueueHelper<Input, Fn>{fn},
+      num_threads);
+  wq.add_items_by_cost(items, cost_fn);
+  wq.run_all();
+}
+template <class Input,
+          typename Fn,
+          typename Items,
+          typename CostFn,
+          typename std::enable_if<sparta::Arity<Fn>::value == 2, int>::type = 0>
+void workqueue_run_by_cost(
+    const Fn& fn,
+    const Items& items,
+    const CostFn& cost_fn,
+    unsigned int num_threads = redex_parallel::default_num_threads()) {
+  auto wq = sparta::SpartaWorkQueue<
+      Input,
+      redex_workqueue_impl::WithStateWorkQueueHelper<Input, Fn>>(
+      redex_workqueue_impl::WithStateWorkQueueHelper<Input, Fn>{fn},
+      num_threads);
+  wq.add_items_by_cost(items, cost_fn);
+  wq.run_all();
+}
@@ -7053,8 +7053,8 @@ void ResTable::deleteResource(uint32_t resID)
 
 static uint32_t getRemappedEntry(
     uint32_t reference,
-    SortedVector<uint32_t> originalIds,
-    Vector<uint32_t> newIds)
+    const SortedVector<uint32_t>& originalIds,
+    const Vector<uint32_t>& newIds)
 {
     ssize_t index = originalIds.indexOf(reference);
     if (index < 0) {
@@ -7070,8 +7070,8 @@ static uint32_t getRemappedEntry(
 // align based on index.
 void ResTable::remapReferenceValuesForResource(
     uint32_t resID,
-    SortedVector<uint32_t> originalIds,
-    Vector<uint32_t> newIds)
+    const SortedVector<uint32_t>& originalIds,
+    const Vector<uint32_t>& newIds)
 {
     resource_name resName;
     if (!this->getResourceName(resID, /* allowUtf8 */ true, &resName)) {
@@ -7391,8 +7391,8 @@ void ResTable::defineNewType(
 
 void ResTable::inlineReferenceValuesForResource(
     uint32_t resID,
-    SortedVector<uint32_t> inlineable_ids,
-    Vector<Res_value> inline_values)
+    const SortedVector<uint32_t>& inlineable_ids,
+    const Vector<Res_value>& inline_values)
 {
     resource_name resName;
     if (!this->getResourceName(resID, true, &resName)) {
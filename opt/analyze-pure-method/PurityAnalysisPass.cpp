@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PurityAnalysisPass.h"
+
+void PurityAnalysisPass::run_pass(DexStoresVector&,
+                                  ConfigFiles&,
+                                  PassManager&) {
+  m_result = std::make_shared<purity::AnalysisCache>();
+}
+
+static PurityAnalysisPass s_pass;
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "Pass.h"
+#include "Purity.h"
+
+/*
+ * An analysis pass that makes a purity::AnalysisCache available to the passes
+ * that follow it, via PassManager::get_preserved_analysis. It doesn't compute
+ * anything itself; the cache is filled by the first pass that needs a result.
+ *
+ * Passes that only remove or simplify code never turn a pure method into an
+ * impure one, so they can declare to preserve this analysis and let the
+ * following passes reuse its (then possibly conservative) results.
+ */
+class PurityAnalysisPass : public Pass {
+ public:
+  PurityAnalysisPass() : Pass("PurityAnalysisPass", Pass::ANALYSIS) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<purity::AnalysisCache> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+ private:
+  std::shared_ptr<purity::AnalysisCache> m_result = nullptr;
+};
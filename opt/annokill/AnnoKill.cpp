@@ -17,6 +17,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 constexpr const char* METRIC_ANNO_KILLED = "num_anno_killed";
 constexpr const char* METRIC_ANNO_TOTAL = "num_anno_total";
@@ -352,31 +353,49 @@ AnnoKill::AnnoSet AnnoKill::get_removable_annotation_instances() {
   return bannotations;
 }
 
-void AnnoKill::count_annotation(const DexAnnotation* da) {
+void AnnoKill::count_annotation(const DexAnnotation* da, WorkerStats* ws) {
   std::string annoName(da->type()->get_name()->c_str());
   if (da->system_visible()) {
-    m_system_anno_map[annoName]++;
-    m_stats.visibility_system_count++;
+    ws->system_anno_map[annoName]++;
+    ws->stats.visibility_system_count++;
   } else if (da->runtime_visible()) {
-    m_runtime_anno_map[annoName]++;
-    m_stats.visibility_runtime_count++;
+    ws->runtime_anno_map[annoName]++;
+    ws->stats.visibility_runtime_count++;
   } else if (da->build_visible()) {
-    m_build_anno_map[annoName]++;
-    m_stats.visibility_build_count++;
+    ws->build_anno_map[annoName]++;
+    ws->stats.visibility_build_count++;
+  }
+}
+
+void AnnoKill::build_anno_type_flags(const AnnoSet& referenced_annos) {
+  m_anno_type_flags.clear();
+  for (auto type : referenced_annos) {
+    m_anno_type_flags[type] |= REFERENCED;
+  }
+  for (auto type : m_keep) {
+    m_anno_type_flags[type] |= KEEP;
+  }
+  for (auto type : m_kill) {
+    m_anno_type_flags[type] |= KILL;
+  }
+  for (auto type : m_force_kill) {
+    m_anno_type_flags[type] |= FORCE_KILL;
   }
 }
 
 void AnnoKill::cleanup_aset(
     DexAnnotationSet* aset,
-    const AnnoKill::AnnoSet& referenced_annos,
-    const std::unordered_set<const DexType*>& keep_annos) {
-  m_stats.annotations += aset->size();
+    const std::unordered_set<const DexType*>& keep_annos,
+    WorkerStats* ws) {
+  ws->stats.annotations += aset->size();
   auto& annos = aset->get_annotations();
   auto fn = [&](DexAnnotation* da) {
     auto anno_type = da->type();
-    count_annotation(da);
+    count_annotation(da, ws);
+    auto flags_it = m_anno_type_flags.find(anno_type);
+    uint8_t flags = flags_it == m_anno_type_flags.end() ? 0 : flags_it->second;
 
-    if (referenced_annos.count(anno_type) > 0) {
+    if (flags & REFERENCED) {
       TRACE(ANNO,
             3,
             "Annotation type %s with type referenced in "
@@ -391,7 +410,7 @@ void AnnoKill::cleanup_aset(
       return false;
     }
 
-    if (m_keep.count(anno_type) > 0) {
+    if (flags & KEEP) {
       TRACE(ANNO,
             3,
             "Exclude annotation type %s, "
@@ -401,40 +420,40 @@ void AnnoKill::cleanup_aset(
       return false;
     }
 
-    if (m_kill.count(anno_type) > 0) {
+    if (flags & KILL) {
       TRACE(ANNO,
             3,
             "Annotation instance (type: %s) marked for removal, "
             "annotation: %s",
             SHOW(anno_type),
             SHOW(da));
-      m_stats.annotations_killed++;
+      ws->stats.annotations_killed++;
       delete da;
       return true;
     }
 
-    if (m_force_kill.count(anno_type) > 0) {
+    if (flags & FORCE_KILL) {
       TRACE(ANNO,
             3,
             "Annotation instance (type: %s) marked for forced removal, "
             "annotation: %s",
             SHOW(anno_type),
             SHOW(da));
-      m_stats.annotations_killed++;
+      ws->stats.annotations_killed++;
       delete da;
       return true;
     }
 
     if (!m_only_force_kill && !da->system_visible()) {
       TRACE(ANNO, 3, "Killing annotation instance %s", SHOW(da));
-      m_stats.annotations_killed++;
+      ws->stats.annotations_killed++;
       delete da;
       return true;
     }
 
     if (anno_type == DexType::get_type("Ldalvik/annotation/Signature;")) {
       if (should_kill_bad_signature(da)) {
-        m_stats.signatures_killed++;
+        ws->stats.signatures_killed++;
         delete da;
         return true;
       }
@@ -495,17 +514,9 @@ bool AnnoKill::should_kill_bad_signature(DexAnnotation* da) {
           if (!sigcls) {
             sigtype = nullptr;
           } else if (!sigcls->is_external()) {
-            bool found = false;
-            for (auto cls : m_scope) {
-              if (cls == sigcls) {
-                // Valid class, we're good, go to element in array
-                found = true;
-                continue;
-              }
-            }
             // Could not find the (non-external) class in Scope, so set signal
             // to kill
-            if (!found) {
+            if (!m_scope_classes.count(sigcls)) {
               sigtype = nullptr;
             }
           }
@@ -524,44 +535,41 @@ std::unordered_set<const DexType*> AnnoKill::build_anno_keep(
     DexAnnotationSet* aset) {
   std::unordered_set<const DexType*> keep_list;
   for (const auto& anno : aset->get_annotations()) {
-    auto& keeps = m_annotated_keep_annos[anno->type()];
-    keep_list.insert(keeps.begin(), keeps.end());
+    auto it = m_annotated_keep_annos.find(anno->type());
+    if (it != m_annotated_keep_annos.end()) {
+      keep_list.insert(it->second.begin(), it->second.end());
+    }
   }
   return keep_list;
 }
 
-bool AnnoKill::kill_annotations() {
-  const auto& referenced_annos = get_referenced_annos();
-  if (!m_only_force_kill) {
-    m_kill = get_removable_annotation_instances();
-  }
-
-  for (auto clazz : m_scope) {
-    DexAnnotationSet* aset = clazz->get_anno_set();
-    if (!aset) {
-      continue;
-    }
+void AnnoKill::cleanup_class(DexClass* clazz, WorkerStats* ws) {
+  DexAnnotationSet* aset = clazz->get_anno_set();
+  if (aset) {
     auto keep_list = build_anno_keep(aset);
-    auto& class_hier_keep_list = m_anno_class_hierarchy_keep[clazz->get_type()];
-    keep_list.insert(class_hier_keep_list.begin(), class_hier_keep_list.end());
+    auto class_hier_keep = m_anno_class_hierarchy_keep.find(clazz->get_type());
+    if (class_hier_keep != m_anno_class_hierarchy_keep.end()) {
+      keep_list.insert(class_hier_keep->second.begin(),
+                       class_hier_keep->second.end());
+    }
 
-    m_stats.class_asets++;
-    cleanup_aset(aset, referenced_annos, keep_list);
+    ws->stats.class_asets++;
+    cleanup_aset(aset, keep_list, ws);
     if (aset->size() == 0) {
       TRACE(
           ANNO, 3, "Clearing annotation for class %s", SHOW(clazz->get_type()));
       clazz->clear_annotations();
-      m_stats.class_asets_cleared++;
+      ws->stats.class_asets_cleared++;
     }
   }
 
-  walk::methods(m_scope, [&](DexMethod* method) {
+  for (auto* method : clazz->get_all_methods()) {
     // Method annotations
     auto method_aset = method->get_anno_set();
     if (method_aset) {
-      m_stats.method_asets++;
+      ws->stats.method_asets++;
       auto keep_list = build_anno_keep(method_aset);
-      cleanup_aset(method_aset, referenced_annos, keep_list);
+      cleanup_aset(method_aset, keep_list, ws);
       if (method_aset->size() == 0) {
         TRACE(ANNO,
               3,
@@ -570,14 +578,14 @@ bool AnnoKill::kill_annotations() {
               SHOW(method->get_name()),
               SHOW(method->get_proto()));
         method->clear_annotations();
-        m_stats.method_asets_cleared++;
+        ws->stats.method_asets_cleared++;
       }
     }
 
     // Parameter annotations.
     auto param_annos = method->get_param_anno();
     if (param_annos) {
-      m_stats.method_param_asets += param_annos->size();
+      ws->stats.method_param_asets += param_annos->size();
       bool clear_pas = true;
       for (auto pa : *param_annos) {
         auto param_aset = pa.second;
@@ -585,7 +593,7 @@ bool AnnoKill::kill_annotations() {
           continue;
         }
         auto keep_list = build_anno_keep(param_aset);
-        cleanup_aset(param_aset, referenced_annos, keep_list);
+        cleanup_aset(param_aset, keep_list, ws);
         if (param_aset->size() == 0) {
           continue;
         }
@@ -598,24 +606,24 @@ bool AnnoKill::kill_annotations() {
               SHOW(method->get_class()),
               SHOW(method->get_name()),
               SHOW(method->get_proto()));
-        m_stats.method_param_asets_cleared += param_annos->size();
+        ws->stats.method_param_asets_cleared += param_annos->size();
         for (auto pa : *param_annos) {
           delete pa.second;
         }
         param_annos->clear();
       }
     }
-  });
+  }
 
-  walk::fields(m_scope, [&](DexField* field) {
-    DexAnnotationSet* aset = field->get_anno_set();
-    if (!aset) {
-      return;
+  for (auto* field : clazz->get_all_fields()) {
+    DexAnnotationSet* field_aset = field->get_anno_set();
+    if (!field_aset) {
+      continue;
     }
-    m_stats.field_asets++;
-    auto keep_list = build_anno_keep(aset);
-    cleanup_aset(aset, referenced_annos, keep_list);
-    if (aset->size() == 0) {
+    ws->stats.field_asets++;
+    auto keep_list = build_anno_keep(field_aset);
+    cleanup_aset(field_aset, keep_list, ws);
+    if (field_aset->size() == 0) {
       TRACE(ANNO,
             3,
             "Clearing annotations for field %s.%s:%s",
@@ -623,9 +631,43 @@ bool AnnoKill::kill_annotations() {
             SHOW(field->get_name()),
             SHOW(field->get_type()));
       field->clear_annotations();
-      m_stats.field_asets_cleared++;
+      ws->stats.field_asets_cleared++;
     }
-  });
+  }
+}
+
+bool AnnoKill::kill_annotations() {
+  const auto& referenced_annos = get_referenced_annos();
+  if (!m_only_force_kill) {
+    m_kill = get_removable_annotation_instances();
+  }
+  build_anno_type_flags(referenced_annos);
+  if (m_kill_bad_signatures) {
+    m_scope_classes.insert(m_scope.begin(), m_scope.end());
+  }
+
+  // The annotations of a class and of its members are only reachable from
+  // that class, so the classes are cleaned up concurrently; everything else
+  // is only read.
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<WorkerStats> worker_stats(num_threads);
+  workqueue_run<DexClass*>(
+      [&](sparta::SpartaWorkerState<DexClass*>* state, DexClass* clazz) {
+        cleanup_class(clazz, &worker_stats[state->worker_id()]);
+      },
+      m_scope, num_threads);
+  for (const auto& ws : worker_stats) {
+    m_stats += ws.stats;
+    for (const auto& p : ws.build_anno_map) {
+      m_build_anno_map[p.first] += p.second;
+    }
+    for (const auto& p : ws.runtime_anno_map) {
+      m_runtime_anno_map[p.first] += p.second;
+    }
+    for (const auto& p : ws.system_anno_map) {
+      m_system_anno_map[p.first] += p.second;
+    }
+  }
 
   bool classes_removed = false;
   // We're done removing annotation instances, go ahead and remove annotation
@@ -11,6 +11,7 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -36,6 +37,24 @@ class AnnoKill {
     size_t signatures_killed;
 
     AnnoKillStats() { memset(this, 0, sizeof(AnnoKillStats)); }
+
+    AnnoKillStats& operator+=(const AnnoKillStats& that) {
+      annotations += that.annotations;
+      annotations_killed += that.annotations_killed;
+      class_asets += that.class_asets;
+      class_asets_cleared += that.class_asets_cleared;
+      method_asets += that.method_asets;
+      method_asets_cleared += that.method_asets_cleared;
+      method_param_asets += that.method_param_asets;
+      method_param_asets_cleared += that.method_param_asets_cleared;
+      field_asets += that.field_asets;
+      field_asets_cleared += that.field_asets_cleared;
+      visibility_build_count += that.visibility_build_count;
+      visibility_runtime_count += that.visibility_runtime_count;
+      visibility_system_count += that.visibility_system_count;
+      signatures_killed += that.signatures_killed;
+      return *this;
+    }
   };
 
   AnnoKill(Scope& scope,
@@ -64,11 +83,34 @@ class AnnoKill {
   // of annotation types to be removed.
   AnnoSet get_removable_annotation_instances();
 
+  // What the cleanup of the classes accumulates on each worker thread.
+  struct WorkerStats {
+    AnnoKillStats stats;
+    std::map<std::string, size_t> build_anno_map;
+    std::map<std::string, size_t> runtime_anno_map;
+    std::map<std::string, size_t> system_anno_map;
+  };
+
+  // The ways an annotation type is singled out, as bits of
+  // m_anno_type_flags, so that cleanup_aset classifies an annotation with a
+  // single lookup.
+  enum AnnoTypeFlags : uint8_t {
+    REFERENCED = 1 << 0,
+    KEEP = 1 << 1,
+    KILL = 1 << 2,
+    FORCE_KILL = 1 << 3,
+  };
+
+  void build_anno_type_flags(const AnnoSet& referenced_annos);
+
+  // Removes the annotations of the class, of its methods, of their
+  // parameters and of its fields.
+  void cleanup_class(DexClass* cls, WorkerStats* ws);
+
   void cleanup_aset(DexAnnotationSet* aset,
-                    const AnnoSet& referenced_annos,
-                    const std::unordered_set<const DexType*>& keep_annos =
-                        std::unordered_set<const DexType*>{});
-  void count_annotation(const DexAnnotation* da);
+                    const std::unordered_set<const DexType*>& keep_annos,
+                    WorkerStats* ws);
+  void count_annotation(const DexAnnotation* da, WorkerStats* ws);
 
   Scope& m_scope;
   const bool m_only_force_kill;
@@ -76,6 +118,9 @@ class AnnoKill {
   AnnoSet m_kill;
   AnnoSet m_force_kill;
   AnnoSet m_keep;
+  std::unordered_map<const DexType*, uint8_t> m_anno_type_flags;
+  // The classes of the scope, for should_kill_bad_signature.
+  std::unordered_set<const DexClass*> m_scope_classes;
   AnnoKillStats m_stats;
 
   std::map<std::string, size_t> m_build_anno_map;
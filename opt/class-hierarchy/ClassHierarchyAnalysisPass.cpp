@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ClassHierarchyAnalysisPass.h"
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+void ClassHierarchyAnalysisPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles&,
+                                          PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  m_result = std::make_shared<const CompactClassHierarchy>(scope);
+  mgr.set_metric("num_types", m_result->size());
+}
+
+std::shared_ptr<const CompactClassHierarchy>
+ClassHierarchyAnalysisPass::get_preserved(const PassManager& mgr) {
+  auto analysis = mgr.get_preserved_analysis<ClassHierarchyAnalysisPass>();
+  if (analysis == nullptr || analysis->get_result() == nullptr) {
+    return nullptr;
+  }
+  TRACE(PM, 2, "Reusing the preserved class hierarchy");
+  return analysis->get_result();
+}
+
+std::shared_ptr<const CompactClassHierarchy>
+ClassHierarchyAnalysisPass::get_or_build(const PassManager& mgr,
+                                         const Scope& scope) {
+  auto hierarchy = get_preserved(mgr);
+  if (hierarchy) {
+    return hierarchy;
+  }
+  return std::make_shared<const CompactClassHierarchy>(scope);
+}
+
+static ClassHierarchyAnalysisPass s_pass;
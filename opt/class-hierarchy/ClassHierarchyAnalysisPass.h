@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "CompactClassHierarchy.h"
+#include "Pass.h"
+
+class PassManager;
+
+/*
+ * An analysis pass that builds a CompactClassHierarchy once, so that the
+ * passes that follow it can share it via get_or_build() instead of each
+ * building their own ClassHierarchy.
+ *
+ * The hierarchy only depends on the classes and on their superclasses and
+ * interfaces. Passes that only change code or members can declare to
+ * preserve it in their AnalysisUsage; passes that add, remove or rewire
+ * classes cannot.
+ */
+class ClassHierarchyAnalysisPass : public Pass {
+ public:
+  ClassHierarchyAnalysisPass()
+      : Pass("ClassHierarchyAnalysisPass", Pass::ANALYSIS) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<const CompactClassHierarchy> get_result() {
+    return m_result;
+  }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns nullptr when there is no preserved hierarchy.
+  static std::shared_ptr<const CompactClassHierarchy> get_preserved(
+      const PassManager& mgr);
+
+  /*
+   * Returns the preserved hierarchy when there is one, and builds a new one
+   * for :scope otherwise.
+   */
+  static std::shared_ptr<const CompactClassHierarchy> get_or_build(
+      const PassManager& mgr, const Scope& scope);
+
+ private:
+  std::shared_ptr<const CompactClassHierarchy> m_result = nullptr;
+};
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ClassScopesAnalysisPass.h"
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+void ClassScopesAnalysisPass::run_pass(DexStoresVector& stores,
+                                       ConfigFiles&,
+                                       PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  m_result = std::make_shared<const ClassScopes>(scope);
+  mgr.set_metric("num_signatures", m_result->get_signature_map().size());
+}
+
+std::shared_ptr<const ClassScopes> ClassScopesAnalysisPass::get_preserved(
+    const PassManager& mgr) {
+  auto analysis = mgr.get_preserved_analysis<ClassScopesAnalysisPass>();
+  if (analysis == nullptr || analysis->get_result() == nullptr) {
+    return nullptr;
+  }
+  TRACE(PM, 2, "Reusing the preserved class scopes");
+  return analysis->get_result();
+}
+
+std::shared_ptr<const ClassScopes> ClassScopesAnalysisPass::get_or_build(
+    const PassManager& mgr, const Scope& scope) {
+  auto class_scopes = get_preserved(mgr);
+  if (class_scopes) {
+    return class_scopes;
+  }
+  return std::make_shared<const ClassScopes>(scope);
+}
+
+static ClassScopesAnalysisPass s_pass;
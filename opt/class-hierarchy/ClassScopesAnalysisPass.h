@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "Pass.h"
+#include "VirtualScope.h"
+
+class PassManager;
+
+/*
+ * An analysis pass that builds the ClassScopes once, so that the passes that
+ * follow it can share them via get_or_build() instead of each building their
+ * own signature map.
+ *
+ * The scopes depend on the class hierarchy and on the names and protos of the
+ * virtual methods. Passes that leave those alone can declare to preserve them
+ * in their AnalysisUsage.
+ */
+class ClassScopesAnalysisPass : public Pass {
+ public:
+  ClassScopesAnalysisPass() : Pass("ClassScopesAnalysisPass", Pass::ANALYSIS) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<const ClassScopes> get_result() { return m_result; }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns nullptr when there are no preserved scopes.
+  static std::shared_ptr<const ClassScopes> get_preserved(
+      const PassManager& mgr);
+
+  /*
+   * Returns the preserved scopes when there are some, and builds new ones
+   * for :scope otherwise.
+   */
+  static std::shared_ptr<const ClassScopes> get_or_build(
+      const PassManager& mgr, const Scope& scope);
+
+ private:
+  std::shared_ptr<const ClassScopes> m_result = nullptr;
+};
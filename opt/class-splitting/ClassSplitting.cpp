@@ -26,6 +26,9 @@
 
 #include <algorithm>
 #include <boost/functional/hash.hpp>
+#include <boost/optional.hpp>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "ApiLevelChecker.h"
@@ -68,9 +71,80 @@ constexpr const char* METRIC_POPULAR_METHODS =
 constexpr const char* METRIC_RELOCATED_METHODS =
     "num_class_splitting_relocated_methods";
 constexpr const char* METRIC_TRAMPOLINES = "num_class_splitting_trampolines";
+constexpr const char* METRIC_HOT_BYTES = "num_class_splitting_hot_bytes";
+constexpr const char* METRIC_HOT_PAGES_BEFORE =
+    "num_class_splitting_hot_pages_before";
+constexpr const char* METRIC_HOT_PAGES_AFTER =
+    "num_class_splitting_hot_pages_after";
+constexpr const char* METRIC_HOT_BYTES_PER_PAGE_BEFORE =
+    "class_splitting_hot_bytes_per_page_before";
+constexpr const char* METRIC_HOT_BYTES_PER_PAGE_AFTER =
+    "class_splitting_hot_bytes_per_page_after";
 
 constexpr const char* RELOCATED_SUFFIX = "$relocated;";
 
+constexpr size_t kPageSize = 4096;
+
+// An estimate of the size of the code item of a method: the header, two bytes
+// per code unit, and the alignment.
+size_t estimate_code_item_size(const DexMethod* method) {
+  auto code = method->get_code();
+  if (code == nullptr) {
+    return 0;
+  }
+  return (16 + 2 * code->sum_opcode_sizes() + 3) & ~size_t(3);
+}
+
+/*
+ * How densely the code of the popular methods is packed, assuming that code
+ * items are laid out in the order of the methods of the classes of a dex.
+ * That is the order of the dex output before any code reordering, so this is
+ * meant to track changes, not to predict the final layout.
+ */
+struct PageDensity {
+  size_t hot_bytes{0};
+  // Pages that hold some code of a popular method.
+  size_t hot_pages{0};
+
+  size_t hot_bytes_per_page() const {
+    return hot_pages == 0 ? 0 : hot_bytes / hot_pages;
+  }
+};
+
+template <typename IsHot>
+class PageDensityBuilder {
+ public:
+  explicit PageDensityBuilder(const IsHot& is_hot) : m_is_hot(is_hot) {}
+
+  void add(const DexMethod* method) {
+    auto size = estimate_code_item_size(method);
+    if (size == 0) {
+      return;
+    }
+    if (m_is_hot(method)) {
+      m_density.hot_bytes += size;
+      auto first_page = m_offset / kPageSize;
+      auto last_page = (m_offset + size - 1) / kPageSize;
+      if (m_last_hot_page && *m_last_hot_page == first_page) {
+        ++first_page;
+      }
+      if (first_page <= last_page) {
+        m_density.hot_pages += last_page - first_page + 1;
+        m_last_hot_page = last_page;
+      }
+    }
+    m_offset += size;
+  }
+
+  const PageDensity& get() const { return m_density; }
+
+ private:
+  const IsHot& m_is_hot;
+  size_t m_offset{0};
+  boost::optional<size_t> m_last_hot_page;
+  PageDensity m_density;
+};
+
 struct ClassSplittingStats {
   size_t relocation_classes{0};
   size_t relocated_static_methods{0};
@@ -79,6 +153,8 @@ struct ClassSplittingStats {
   size_t relocated_true_virtual_methods{0};
   size_t non_relocated_methods{0};
   size_t popular_methods{0};
+  PageDensity density_before;
+  PageDensity density_after;
 };
 
 class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
@@ -99,6 +175,8 @@ class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
         if (it == method_stats.end()) {
           return;
         }
+        auto& appear_percent = m_appear_percents[method];
+        appear_percent = std::max(appear_percent, it->second.appear_percent);
         if (it->second.appear_percent >=
             m_config.method_profiles_appear_percent_threshold) {
           m_sufficiently_popular_methods.insert(method);
@@ -277,6 +355,8 @@ class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
 
     DexClasses target_classes;
     std::unordered_set<const DexClass*> target_classes_set;
+    std::unordered_map<const DexClass*, std::vector<DexMethod*>>
+        relocated_by_target;
     size_t relocated_methods = 0;
     // We iterate over the actually added set of classes.
     for (DexClass* cls : classes) {
@@ -379,6 +459,7 @@ class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
         TRACE(CS, 3, "[class splitting] Method {%s} relocated to {%s}",
               SHOW(method), SHOW(method_info.target_cls));
 
+        relocated_by_target[method_info.target_cls].push_back(method);
         if (target_classes_set.insert(method_info.target_cls).second) {
           target_classes.push_back(method_info.target_cls);
         }
@@ -390,11 +471,79 @@ class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
           "in this dex.",
           relocated_methods, target_classes.size());
 
+    // The target classes go at the end of the dex. Ordering them by the
+    // popularity of their warmest method keeps the methods that made some
+    // traces, though too few to stay, on as few pages as possible.
+    auto warmest = [&](const DexClass* target_cls) {
+      double res = 0;
+      for (auto* method : relocated_by_target[target_cls]) {
+        res = std::max(res, get_appear_percent(method));
+      }
+      return res;
+    };
+    std::unordered_map<const DexClass*, double> target_warmth;
+    for (auto* target_cls : target_classes) {
+      target_warmth.emplace(target_cls, warmest(target_cls));
+    }
+    std::stable_sort(target_classes.begin(), target_classes.end(),
+                     [&](const DexClass* a, const DexClass* b) {
+                       return target_warmth.at(a) > target_warmth.at(b);
+                     });
+
+    update_page_density(classes, target_classes, relocated_by_target);
+
     m_target_classes_by_api_level.clear();
     m_split_classes.clear();
     return target_classes;
   }
 
+  double get_appear_percent(const DexMethod* method) const {
+    auto it = m_appear_percents.find(method);
+    return it == m_appear_percents.end() ? 0 : it->second;
+  }
+
+  // Accounts for the page density of the code of `classes` before and after
+  // the relocation into `target_classes`.
+  void update_page_density(
+      const DexClasses& classes,
+      const DexClasses& target_classes,
+      std::unordered_map<const DexClass*, std::vector<DexMethod*>>&
+          relocated_by_target) {
+    std::unordered_set<const DexMethod*> relocated;
+    for (auto& p : relocated_by_target) {
+      relocated.insert(p.second.begin(), p.second.end());
+    }
+    auto is_hot = [&](const DexMethod* method) {
+      return m_sufficiently_popular_methods.count(
+                 const_cast<DexMethod*>(method)) != 0;
+    };
+    PageDensityBuilder<decltype(is_hot)> before(is_hot);
+    PageDensityBuilder<decltype(is_hot)> after(is_hot);
+    for (auto* cls : classes) {
+      for (auto* methods : {&cls->get_dmethods(), &cls->get_vmethods()}) {
+        for (auto* method : *methods) {
+          before.add(method);
+          if (!relocated.count(method)) {
+            after.add(method);
+          }
+        }
+      }
+    }
+    for (auto* target_cls : target_classes) {
+      for (auto* method : relocated_by_target[target_cls]) {
+        after.add(method);
+      }
+    }
+    TRACE(CS, 2,
+          "[class splitting] Hot bytes per page in this dex: {%zu} before, "
+          "{%zu} after.",
+          before.get().hot_bytes_per_page(), after.get().hot_bytes_per_page());
+    m_stats.density_before.hot_bytes += before.get().hot_bytes;
+    m_stats.density_before.hot_pages += before.get().hot_pages;
+    m_stats.density_after.hot_bytes += after.get().hot_bytes;
+    m_stats.density_after.hot_pages += after.get().hot_pages;
+  }
+
   void materialize_trampoline_code(DexMethod* source, DexMethod* target) {
     // "source" is the original method, still in its original place.
     // "target" is the new trampoline target method, somewhere far away
@@ -545,6 +694,14 @@ class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
     m_mgr.incr_metric(METRIC_POPULAR_METHODS, m_stats.popular_methods);
     m_mgr.incr_metric(METRIC_RELOCATED_METHODS, m_methods_to_relocate.size());
     m_mgr.incr_metric(METRIC_TRAMPOLINES, m_methods_to_trampoline.size());
+    m_mgr.incr_metric(METRIC_HOT_BYTES, m_stats.density_before.hot_bytes);
+    m_mgr.incr_metric(METRIC_HOT_PAGES_BEFORE,
+                      m_stats.density_before.hot_pages);
+    m_mgr.incr_metric(METRIC_HOT_PAGES_AFTER, m_stats.density_after.hot_pages);
+    m_mgr.set_metric(METRIC_HOT_BYTES_PER_PAGE_BEFORE,
+                     m_stats.density_before.hot_bytes_per_page());
+    m_mgr.set_metric(METRIC_HOT_BYTES_PER_PAGE_AFTER,
+                     m_stats.density_after.hot_bytes_per_page());
 
     TRACE(CS, 2,
           "[class splitting] Relocated {%zu} methods and created {%zu} "
@@ -568,6 +725,8 @@ class ClassSplittingInterDexPlugin : public interdex::InterDexPassPlugin {
   // Methods that appear in the profiles and whose frequency does not exceed
   // the threashold.
   std::unordered_set<DexMethod*> m_insufficiently_popular_methods;
+  // The largest appear percent of each profiled method.
+  std::unordered_map<const DexMethod*, double> m_appear_percents;
 
   struct RelocatableMethodInfo {
     DexClass* target_cls;
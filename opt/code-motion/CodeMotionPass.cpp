@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CodeMotionPass.h"
+
+#include "BranchPrefixHoisting.h"
+#include "ConstantUses.h"
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "PassManager.h"
+#include "Show.h"
+#include "Trace.h"
+#include "TypeInference.h"
+#include "UpCodeMotion.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* METRIC_THROWS_INSERTED = "num_throws_inserted";
+constexpr const char* METRIC_UNREACHABLE_INSTRUCTIONS =
+    "num_unreachable_instructions";
+constexpr const char* METRIC_NO_RETURN_METHODS = "num_no_return_methods";
+constexpr const char* METRIC_ITERATIONS = "num_iterations";
+constexpr const char* METRIC_INSTRUCTIONS_HOISTED = "num_instructions_hoisted";
+constexpr const char* METRIC_INSTRUCTIONS_MOVED = "num_instructions_moved";
+constexpr const char* METRIC_BRANCHES_MOVED_OVER = "num_branches_moved_over";
+constexpr const char* METRIC_INVERTED_CONDITIONAL_BRANCHES =
+    "num_inverted_conditional_branches";
+constexpr const char* METRIC_CLOBBERED_REGISTERS = "num_clobbered_registers";
+
+struct Stats {
+  size_t insns_hoisted{0};
+  UpCodeMotionPass::Stats up_code_motion;
+
+  Stats& operator+=(const Stats& that) {
+    insns_hoisted += that.insns_hoisted;
+    up_code_motion += that.up_code_motion;
+    return *this;
+  }
+};
+
+} // namespace
+
+void CodeMotionPass::bind_config() {
+  bind("throw_propagation", true, m_config.throw_propagation);
+  bind("branch_prefix_hoisting", true, m_config.branch_prefix_hoisting);
+  bind("up_code_motion", true, m_config.up_code_motion);
+  bind("throw_propagation_blocklist",
+       {},
+       m_config.throw_propagation_config.blocklist,
+       "List of classes that will not be analyzed to determine which methods "
+       "have no return.");
+}
+
+void CodeMotionPass::run_pass(DexStoresVector& stores,
+                              ConfigFiles&,
+                              PassManager& mgr) {
+  Scope scope = build_class_scope(stores);
+  walk::parallel::code(scope, [](const DexMethod*, IRCode& code) {
+    code.build_cfg(/* editable */ true);
+  });
+
+  // Throw propagation is interprocedural, so it runs to its fixpoint over all
+  // the CFGs before the local transforms.
+  if (m_config.throw_propagation) {
+    auto override_graph =
+        MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
+    auto result = ThrowPropagationPass::run_to_fixpoint(
+        m_config.throw_propagation_config, scope, *override_graph);
+    mgr.incr_metric(METRIC_THROWS_INSERTED, result.stats.throws_inserted);
+    mgr.incr_metric(METRIC_UNREACHABLE_INSTRUCTIONS,
+                    result.stats.unreachable_instruction_count);
+    mgr.incr_metric(METRIC_NO_RETURN_METHODS, result.no_return_methods);
+    mgr.incr_metric(METRIC_ITERATIONS, result.iterations);
+  }
+
+  Stats stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    Stats stats;
+    auto code = method->get_code();
+    if (!code) {
+      return stats;
+    }
+    TraceContext context{method};
+    auto& cfg = code->cfg();
+    if (m_config.branch_prefix_hoisting) {
+      type_inference::TypeInference type_inference(cfg);
+      type_inference.run(method);
+      constant_uses::ConstantUses constant_uses(cfg, method);
+      stats.insns_hoisted = BranchPrefixHoistingPass::process_cfg(
+          cfg, type_inference, constant_uses);
+    }
+    if (m_config.up_code_motion) {
+      // The type inference of the hoisting is stale by now, so up code motion
+      // runs its own, when it needs one.
+      stats.up_code_motion = UpCodeMotionPass::process_cfg(
+          is_static(method), method->get_class(),
+          method->get_proto()->get_args(), cfg);
+    }
+    code->clear_cfg();
+    if (stats.insns_hoisted || stats.up_code_motion.instructions_moved) {
+      TRACE(UCM, 3,
+            "[code motion] Hoisted %zu instructions and moved %zu instructions "
+            "in {%s}",
+            stats.insns_hoisted, stats.up_code_motion.instructions_moved,
+            SHOW(method));
+    }
+    return stats;
+  });
+
+  mgr.incr_metric(METRIC_INSTRUCTIONS_HOISTED, stats.insns_hoisted);
+  mgr.incr_metric(METRIC_INSTRUCTIONS_MOVED,
+                  stats.up_code_motion.instructions_moved);
+  mgr.incr_metric(METRIC_BRANCHES_MOVED_OVER,
+                  stats.up_code_motion.branches_moved_over);
+  mgr.incr_metric(METRIC_INVERTED_CONDITIONAL_BRANCHES,
+                  stats.up_code_motion.inverted_conditional_branches);
+  mgr.incr_metric(METRIC_CLOBBERED_REGISTERS,
+                  stats.up_code_motion.clobbered_registers);
+}
+
+static CodeMotionPass s_pass;
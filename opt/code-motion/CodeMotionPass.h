@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "AnalysisUsage.h"
+#include "ClassHierarchyAnalysisPass.h"
+#include "MethodOverrideGraphAnalysisPass.h"
+#include "Pass.h"
+#include "ThrowPropagationPass.h"
+
+/*
+ * This pass runs ThrowPropagationPass, BranchPrefixHoistingPass and
+ * UpCodeMotionPass, in that order, within a single editable CFG session per
+ * method, instead of building and linearizing the CFGs once per pass. Each of
+ * the transforms can be turned off.
+ */
+class CodeMotionPass : public Pass {
+ public:
+  struct Config {
+    bool throw_propagation{true};
+    bool branch_prefix_hoisting{true};
+    bool up_code_motion{true};
+    ThrowPropagationPass::Config throw_propagation_config;
+  };
+
+  CodeMotionPass() : Pass("CodeMotionPass") {}
+
+  void bind_config() override;
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // Only the code of the methods changes.
+    au.add_preserve_specific<ClassHierarchyAnalysisPass>();
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  Config m_config;
+};
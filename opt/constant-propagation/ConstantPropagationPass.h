@@ -21,6 +21,12 @@ class ConstantPropagationPass : public Pass {
          true,
          m_config.transform.replace_moves_with_consts);
     bind("remove_dead_switch", true, m_config.transform.remove_dead_switch);
+    bind("max_steps_per_method", 0, m_config.max_steps_per_method,
+         "Number of block visits after which the analysis of a method gives "
+         "up and leaves the method alone; 0 means no limit.");
+    bind("max_ms_per_method", 0, m_config.max_ms_per_method,
+         "Milliseconds after which the analysis of a method gives up and "
+         "leaves the method alone; 0 means no limit.");
   }
 
   void run_pass(DexStoresVector& stores,
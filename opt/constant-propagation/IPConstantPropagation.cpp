@@ -7,11 +7,15 @@
 
 #include "IPConstantPropagation.h"
 
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+
 #include "ConfigFiles.h"
 #include "ConstantEnvironment.h"
 #include "ConstantPropagationAnalysis.h"
 #include "ConstructorParams.h"
 #include "IPConstantPropagationAnalysis.h"
+#include "IPConstantPropagationSummaryCache.h"
 #include "MethodOverrideGraph.h"
 #include "PassManager.h"
 #include "ScopedMetrics.h"
@@ -25,6 +29,27 @@ namespace constant_propagation {
 
 namespace interprocedural {
 
+// Bump this whenever the intraprocedural analysis changes in a way that
+// invalidates the summaries cached by earlier versions.
+constexpr size_t SUMMARY_CACHE_VERSION = 1;
+
+// The cached summaries are only valid for the options they were computed
+// with, so the cache is keyed on the options that affect the analysis.
+size_t summary_cache_config_hash(const PassImpl::Config& config) {
+  size_t hash = SUMMARY_CACHE_VERSION;
+  boost::hash_combine(hash, config.include_virtuals);
+  boost::hash_combine(hash, config.use_multiple_callee_callgraph);
+  boost::hash_combine(hash, config.max_heap_analysis_iterations);
+  boost::hash_combine(hash, config.big_override_threshold);
+  std::vector<std::string> blocklist;
+  for (const auto* type : config.field_blocklist) {
+    blocklist.push_back(type->str());
+  }
+  std::sort(blocklist.begin(), blocklist.end());
+  boost::hash_range(hash, blocklist.begin(), blocklist.end());
+  return hash;
+}
+
 using CombinedAnalyzer =
     InstructionAnalyzerCombiner<ClinitFieldAnalyzer,
                                 ImmutableAttributeAnalyzer,
@@ -101,7 +126,10 @@ class AnalyzerGenerator {
 std::unique_ptr<FixpointIterator> PassImpl::analyze(
     const Scope& scope,
     const ImmutableAttributeAnalyzerState* immut_analyzer_state) {
-  auto method_override_graph = mog::build_graph(scope);
+  auto method_override_graph = m_method_override_graph
+                                   ? m_method_override_graph
+                                   : std::shared_ptr<const mog::Graph>(
+                                         mog::build_graph(scope));
   call_graph::Graph cg =
       m_config.use_multiple_callee_callgraph
           ? call_graph::multiple_callee_graph(*method_override_graph, scope,
@@ -113,6 +141,13 @@ std::unique_ptr<FixpointIterator> PassImpl::analyze(
   m_stats.callgraph_callsites = cg_stats.num_callsites;
   auto fp_iter = std::make_unique<FixpointIterator>(
       cg, AnalyzerGenerator(immut_analyzer_state));
+  std::unique_ptr<SummaryCache> summary_cache;
+  if (!m_config.summary_cache_path.empty()) {
+    summary_cache = std::make_unique<SummaryCache>(summary_cache_config_hash(m_config));
+    auto loaded = summary_cache->load(m_config.summary_cache_path);
+    TRACE(ICONSTP, 1, "Loaded the summaries of %zu methods", loaded);
+    fp_iter->set_summary_cache(summary_cache.get());
+  }
   // Run the bootstrap. All field value and method return values are
   // represented by Top.
   fp_iter->run({{CURRENT_PARTITION_LABEL, ArgumentDomain()}});
@@ -137,6 +172,12 @@ std::unique_ptr<FixpointIterator> PassImpl::analyze(
     fp_iter->run({{CURRENT_PARTITION_LABEL, ArgumentDomain()}});
   }
   compute_analysis_stats(fp_iter->get_whole_program_state());
+  if (summary_cache) {
+    fp_iter->set_summary_cache(nullptr);
+    summary_cache->save(m_config.summary_cache_path);
+    m_stats.summary_cache_hits = summary_cache->hits();
+    m_stats.summary_cache_misses = summary_cache->misses();
+  }
 
   return fp_iter;
 }
@@ -237,7 +278,10 @@ void PassImpl::run_pass(DexStoresVector& stores,
         RuntimeAssertTransform::Config(config.get_proguard_map());
   }
 
+  auto analysis = mgr.get_preserved_analysis<MethodOverrideGraphAnalysisPass>();
+  m_method_override_graph = analysis ? analysis->get_result() : nullptr;
   run(stores);
+  m_method_override_graph = nullptr;
 
   ScopedMetrics sm(mgr);
   m_transform_stats.log_metrics(sm, /* with_scope= */ false);
@@ -247,6 +291,8 @@ void PassImpl::run_pass(DexStoresVector& stores,
   mgr.incr_metric("callgraph_edges", m_stats.callgraph_edges);
   mgr.incr_metric("callgraph_nodes", m_stats.callgraph_nodes);
   mgr.incr_metric("callgraph_callsites", m_stats.callgraph_callsites);
+  mgr.incr_metric("summary_cache_hits", m_stats.summary_cache_hits);
+  mgr.incr_metric("summary_cache_misses", m_stats.summary_cache_misses);
 }
 
 static PassImpl s_pass;
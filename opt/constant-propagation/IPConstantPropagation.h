@@ -7,11 +7,15 @@
 
 #pragma once
 
+#include <memory>
 #include <utility>
 
+#include "AnalysisUsage.h"
+#include "ClassHierarchyAnalysisPass.h"
 #include "ConstantPropagationRuntimeAssert.h"
 #include "ConstantPropagationTransform.h"
 #include "ConstantPropagationWholeProgramState.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 namespace constant_propagation {
@@ -30,6 +34,10 @@ class PassImpl : public Pass {
     uint64_t max_heap_analysis_iterations{0};
     uint32_t big_override_threshold{5};
     std::unordered_set<const DexType*> field_blocklist;
+    // When non-empty, the method summaries are read from and written back to
+    // this file, so that the next runs only analyze the methods whose inputs
+    // have changed.
+    std::string summary_cache_path;
 
     Transform::Config transform;
     RuntimeAssertTransform::Config runtime_assert;
@@ -60,6 +68,17 @@ class PassImpl : public Pass {
          {},
          m_config.field_blocklist,
          "List of types whose fields that this optimization will omit.");
+    bind("summary_cache_path",
+         "",
+         m_config.summary_cache_path,
+         "File caching the method summaries across runs. It must be discarded "
+         "whenever the Redex binary changes.");
+  }
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // Only the code of the methods changes.
+    au.add_preserve_specific<ClassHierarchyAnalysisPass>();
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
   }
 
   void run_pass(DexStoresVector& stores,
@@ -79,6 +98,8 @@ class PassImpl : public Pass {
   std::unique_ptr<FixpointIterator> analyze(
       const Scope&, const ImmutableAttributeAnalyzerState*);
 
+  size_t summary_cache_hits() const { return m_stats.summary_cache_hits; }
+
  private:
   void compute_analysis_stats(const WholeProgramState&);
 
@@ -93,9 +114,14 @@ class PassImpl : public Pass {
     size_t callgraph_nodes{0};
     size_t callgraph_edges{0};
     size_t callgraph_callsites{0};
+    size_t summary_cache_hits{0};
+    size_t summary_cache_misses{0};
   } m_stats;
   Transform::Stats m_transform_stats;
   Config m_config;
+  // Set by run_pass() when a preserved graph is available; analyze() builds
+  // its own otherwise.
+  std::shared_ptr<const method_override_graph::Graph> m_method_override_graph;
 };
 
 } // namespace interprocedural
@@ -65,7 +65,9 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
 
   auto shared_state =
       SharedState(pure_methods, conf.get_finalish_field_names());
-  shared_state.init_scope(scope);
+  auto purity_analysis = mgr.get_preserved_analysis<PurityAnalysisPass>();
+  auto purity_cache = purity_analysis ? purity_analysis->get_result() : nullptr;
+  shared_state.init_scope(scope, purity_cache.get());
 
   // The following default 'features' of copy propagation would only
   // interfere with what CSE is trying to do.
@@ -7,8 +7,12 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
+#include "ClassHierarchyAnalysisPass.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 #include "PassManager.h"
+#include "PurityAnalysisPass.h"
 
 class CommonSubexpressionEliminationPass : public Pass {
  public:
@@ -16,6 +20,14 @@ class CommonSubexpressionEliminationPass : public Pass {
       : Pass("CommonSubexpressionEliminationPass") {}
 
   void bind_config() override;
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // CSE only removes redundant reads and computations, which doesn't add
+    // any side effects.
+    au.add_preserve_specific<ClassHierarchyAnalysisPass>();
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+    au.add_preserve_specific<PurityAnalysisPass>();
+  }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
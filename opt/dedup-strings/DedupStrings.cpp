@@ -7,6 +7,9 @@
 
 #include "DedupStrings.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <vector>
 
 #include "ABExperimentContext.h"
@@ -49,6 +52,12 @@ constexpr const char* METRIC_EXCLUDED_DUPLICATE_NON_LOAD_STRINGS =
 constexpr const char* METRIC_FACTORY_METHODS = "num_factory_methods";
 constexpr const char* METRIC_EXCLUDED_OUT_OF_FACTORY_METHODS_STRINGS =
     "num_excluded_out_of_factory_methods_strings";
+constexpr const char* METRIC_REWRITTEN_STRING_LOADS =
+    "num_rewritten_string_loads";
+constexpr const char* METRIC_COLD_START_REWRITTEN_STRING_LOADS =
+    "num_cold_start_rewritten_string_loads";
+constexpr const char* METRIC_ESTIMATED_COLD_START_LOOKUPS =
+    "estimated_cold_start_lookups";
 } // namespace
 
 void DedupStrings::run(
@@ -68,21 +77,12 @@ void DedupStrings::run(
   std::unordered_set<const DexMethod*> perf_sensitive_methods =
       get_perf_sensitive_methods(dexen);
 
-  // Compute set of non-load strings in each dex
+  // Compute set of non-load strings in each dex, and for each string, figure
+  // out how many times it's loaded per dex
   std::unordered_set<const DexString*> non_load_strings[dexen.size()];
-  std::vector<size_t> indices(dexen.size());
-  std::iota(indices.begin(), indices.end(), 0);
-  workqueue_run<size_t>(
-      [&](size_t i) {
-        auto& strings = non_load_strings[i];
-        gather_non_load_strings(dexen[i], &strings);
-      },
-      indices);
-
-  // For each string, figure out how many times it's loaded per dex
-  ConcurrentMap<DexString*, std::unordered_map<size_t, size_t>> occurrences =
-      get_occurrences(scope, methods_to_dex, perf_sensitive_methods,
-                      non_load_strings);
+  std::unordered_map<DexString*, std::unordered_map<size_t, size_t>>
+      occurrences =
+          get_occurrences(dexen, perf_sensitive_methods, non_load_strings);
 
   // Use heuristics to determine which strings to dedup,
   // and figure out factory method details
@@ -251,50 +251,61 @@ void DedupStrings::gather_non_load_strings(
   strings->insert(lstring.begin(), lstring.end());
 }
 
-ConcurrentMap<DexString*, std::unordered_map<size_t, size_t>>
+std::unordered_map<DexString*, std::unordered_map<size_t, size_t>>
 DedupStrings::get_occurrences(
-    const Scope& scope,
-    const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
+    DexClassesVector& dexen,
     const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
     std::unordered_set<const DexString*> non_load_strings[]) {
-  // For each string, figure out how many times it's loaded per dex
-  ConcurrentMap<DexString*, std::unordered_map<size_t, size_t>> occurrences;
-  ConcurrentMap<DexString*, std::unordered_set<size_t>> perf_sensitive_strings;
-  walk::parallel::code(
-      scope, [&occurrences, &perf_sensitive_strings, &methods_to_dex,
-              &perf_sensitive_methods](DexMethod* method, IRCode& code) {
-        const auto dexnr = methods_to_dex.at(method);
-        const auto perf_sensitive = perf_sensitive_methods.count(method) != 0;
-        for (auto& mie : InstructionIterable(code)) {
-          const auto insn = mie.insn;
-          if (insn->opcode() == OPCODE_CONST_STRING) {
+  // A single parallel pass over the dexes gathers the non-load strings of
+  // each dex and counts its string loads, in tables that no other dex writes
+  // to.
+  std::vector<std::unordered_map<DexString*, size_t>> loads_per_dex(
+      dexen.size());
+  std::vector<std::unordered_set<const DexString*>>
+      perf_sensitive_strings_per_dex(dexen.size());
+  std::vector<size_t> indices(dexen.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t dexnr) {
+        auto& strings = non_load_strings[dexnr];
+        gather_non_load_strings(dexen[dexnr], &strings);
+        auto& loads = loads_per_dex[dexnr];
+        auto& perf_sensitive_strings = perf_sensitive_strings_per_dex[dexnr];
+        walk::code(dexen[dexnr], [&](DexMethod* method, IRCode& code) {
+          const auto perf_sensitive = perf_sensitive_methods.count(method) != 0;
+          for (auto& mie : InstructionIterable(code)) {
+            const auto insn = mie.insn;
+            if (insn->opcode() != OPCODE_CONST_STRING) {
+              continue;
+            }
             const auto str = insn->get_string();
             if (perf_sensitive) {
-              perf_sensitive_strings.update(
-                  str,
-                  [dexnr](const DexString*,
-                          std::unordered_set<size_t>& s,
-                          bool /* exists */) { s.emplace(dexnr); });
+              perf_sensitive_strings.emplace(str);
             } else {
-              occurrences.update(str,
-                                 [dexnr](const DexString*,
-                                         std::unordered_map<size_t, size_t>& m,
-                                         bool /* exists */) { ++m[dexnr]; });
+              ++loads[str];
             }
           }
-        }
-      });
-
-  // Also, add all the strings that occurred in perf-sensitive methods
-  // to the non_load_strings datastructure, as we won't attempt to dedup them.
-  for (const auto& it : perf_sensitive_strings) {
-    const auto str = it.first;
-    TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
+        });
+        // Also, add all the strings that occurred in perf-sensitive methods
+        // to the non_load_strings datastructure, as we won't attempt to
+        // dedup them.
+        strings.insert(perf_sensitive_strings.begin(),
+                       perf_sensitive_strings.end());
+      },
+      indices);
 
-    const auto& dexes = it.second;
-    for (const auto dexnr : dexes) {
-      auto& strings = non_load_strings[dexnr];
-      strings.emplace(str);
+  // For each string, figure out how many times it's loaded per dex
+  std::unordered_map<DexString*, std::unordered_map<size_t, size_t>>
+      occurrences;
+  std::unordered_set<const DexString*> perf_sensitive_strings;
+  for (size_t dexnr = 0; dexnr < dexen.size(); ++dexnr) {
+    for (const auto& p : loads_per_dex[dexnr]) {
+      occurrences[p.first].emplace(dexnr, p.second);
+    }
+    for (const auto str : perf_sensitive_strings_per_dex[dexnr]) {
+      if (perf_sensitive_strings.insert(str).second) {
+        TRACE(DS, 3, "[dedup strings] perf sensitive string: {%s}", SHOW(str));
+      }
     }
   }
 
@@ -306,7 +317,7 @@ DedupStrings::get_occurrences(
 std::unordered_map<DexString*, DedupStrings::DedupStringInfo>
 DedupStrings::get_strings_to_dedup(
     DexClassesVector& dexen,
-    const ConcurrentMap<DexString*, std::unordered_map<size_t, size_t>>&
+    const std::unordered_map<DexString*, std::unordered_map<size_t, size_t>>&
         occurrences,
     std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
     std::unordered_set<const DexMethod*>& perf_sensitive_methods,
@@ -333,7 +344,7 @@ DedupStrings::get_strings_to_dedup(
   std::sort(ordered_strings.begin(), ordered_strings.end(), compare_dexstrings);
   for (DexString* s : ordered_strings) {
     // We are going to look at the situation of a particular string here
-    const auto& m = occurrences.at_unsafe(s);
+    const auto& m = occurrences.at(s);
     always_assert(m.size() > 1);
     const auto entry_size = s->get_entry_size();
     const auto get_size_reduction = [entry_size, non_load_strings](
@@ -536,10 +547,11 @@ void DedupStrings::rewrite_const_string_instructions(
     const std::unordered_map<DexString*, DedupStrings::DedupStringInfo>&
         strings_to_dedup,
     std::unique_ptr<ab_test::ABExperimentContext>& ab_experiment_context) {
-
+  std::atomic<size_t> rewritten_string_loads{0};
+  std::atomic<size_t> cold_start_rewritten_string_loads{0};
+  std::atomic<size_t> estimated_cold_start_lookups{0};
   walk::parallel::code(
-      scope, [&methods_to_dex, &strings_to_dedup, &perf_sensitive_methods,
-              &ab_experiment_context](DexMethod* method, IRCode& code) {
+      scope, [&](DexMethod* method, IRCode& code) {
         if (perf_sensitive_methods.count(method) != 0) {
           // We don't rewrite methods in the primary dex or other perf-sensitive
           // methods.
@@ -548,6 +560,30 @@ void DedupStrings::rewrite_const_string_instructions(
 
         const auto dexnr = methods_to_dex.at(method);
 
+        // Do we rewrite this particular instruction?
+        auto get_dedup_string_info =
+            [&](const IRInstruction* insn) -> const DedupStringInfo* {
+          if (insn->opcode() != OPCODE_CONST_STRING) {
+            return nullptr;
+          }
+          const auto it = strings_to_dedup.find(insn->get_string());
+          if (it == strings_to_dedup.end() ||
+              it->second.dexes_to_dedup.count(dexnr) == 0) {
+            return nullptr;
+          }
+          return &it->second;
+        };
+
+        // Most methods don't load any of the deduped strings; don't build
+        // their CFG.
+        auto code_ii = InstructionIterable(code);
+        if (std::none_of(code_ii.begin(), code_ii.end(),
+                         [&](const MethodItemEntry& mie) {
+                           return get_dedup_string_info(mie.insn) != nullptr;
+                         })) {
+          return;
+        }
+
         // First, we collect all const-string instructions that we want to
         // rewrite
         cfg::ScopedCFG cfg(&code);
@@ -555,28 +591,23 @@ void DedupStrings::rewrite_const_string_instructions(
         std::vector<std::pair<cfg::InstructionIterator, const DedupStringInfo*>>
             const_strings;
         for (auto it = ii.begin(); it != ii.end(); it++) {
-          // Do we have a const-string instruction?
-          const auto insn = it->insn;
-          if (insn->opcode() != OPCODE_CONST_STRING) {
-            continue;
-          }
-
-          // We we rewrite this particular instruction?
-          const auto it2 = strings_to_dedup.find(insn->get_string());
-          if (it2 == strings_to_dedup.end()) {
-            continue;
-          }
-
-          const auto& info = it2->second;
-          if (info.dexes_to_dedup.count(dexnr) == 0) {
-            continue;
+          const auto info = get_dedup_string_info(it->insn);
+          if (info != nullptr) {
+            const_strings.emplace_back(it, info);
           }
-
-          const_strings.emplace_back(it, &info);
         }
-
-        if (const_strings.empty()) {
-          return;
+        always_assert(!const_strings.empty());
+
+        // Each rewritten load becomes an invocation of the factory method,
+        // which matters most in the methods that run during cold start.
+        rewritten_string_loads += const_strings.size();
+        const auto stat =
+            m_method_profiles.get_method_stat(method_profiles::COLD_START,
+                                              method);
+        if (stat) {
+          cold_start_rewritten_string_loads += const_strings.size();
+          estimated_cold_start_lookups += (size_t)std::lround(
+              std::max(stat->call_count, 1.0) * const_strings.size());
         }
 
         ab_experiment_context->try_register_method(method);
@@ -627,6 +658,10 @@ void DedupStrings::rewrite_const_string_instructions(
         }
         cfg_mut.flush();
       });
+  m_stats.rewritten_string_loads = rewritten_string_loads;
+  m_stats.cold_start_rewritten_string_loads =
+      cold_start_rewritten_string_loads;
+  m_stats.estimated_cold_start_lookups = estimated_cold_start_lookups;
 }
 
 // In each dex, we might introduce as many new method refs and type refs as we
@@ -716,6 +751,11 @@ void DedupStringsPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric(METRIC_FACTORY_METHODS, stats.factory_methods);
   mgr.incr_metric(METRIC_EXCLUDED_OUT_OF_FACTORY_METHODS_STRINGS,
                   stats.excluded_out_of_factory_methods_strings);
+  mgr.incr_metric(METRIC_REWRITTEN_STRING_LOADS, stats.rewritten_string_loads);
+  mgr.incr_metric(METRIC_COLD_START_REWRITTEN_STRING_LOADS,
+                  stats.cold_start_rewritten_string_loads);
+  mgr.incr_metric(METRIC_ESTIMATED_COLD_START_LOOKUPS,
+                  stats.estimated_cold_start_lookups);
   TRACE(DS, 1,
         "[dedup strings] duplicate strings: %zu, size: %zu, loads: %zu; "
         "expected size reduction: %zu; "
@@ -726,6 +766,11 @@ void DedupStringsPass::run_pass(DexStoresVector& stores,
         stats.duplicate_string_loads, stats.expected_size_reduction,
         stats.dexes_without_host_cls, stats.excluded_duplicate_non_load_strings,
         stats.factory_methods, stats.excluded_out_of_factory_methods_strings);
+  TRACE(DS, 1,
+        "[dedup strings] rewritten string loads: %zu, in cold start methods: "
+        "%zu; estimated cold start lookups: %zu",
+        stats.rewritten_string_loads, stats.cold_start_rewritten_string_loads,
+        stats.estimated_cold_start_lookups);
   ab_experiment_context->flush();
 }
 
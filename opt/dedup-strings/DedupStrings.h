@@ -31,6 +31,12 @@ class DedupStrings {
     size_t dexes_without_host_cls{0};
     size_t factory_methods{0};
     size_t excluded_out_of_factory_methods_strings{0};
+    size_t rewritten_string_loads{0};
+    // The rewritten loads in methods of the cold start profile, and an
+    // estimate of how many factory method invocations they add during cold
+    // start, by the average number of calls of those methods.
+    size_t cold_start_rewritten_string_loads{0};
+    size_t estimated_cold_start_lookups{0};
   };
 
   DedupStrings(size_t max_factory_methods,
@@ -64,14 +70,14 @@ class DedupStrings {
       DexClasses& dex, size_t dex_id, const std::vector<DexString*>& strings);
   void gather_non_load_strings(DexClasses& classes,
                                std::unordered_set<const DexString*>* strings);
-  ConcurrentMap<DexString*, std::unordered_map<size_t, size_t>> get_occurrences(
-      const Scope& scope,
-      const std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
+  std::unordered_map<DexString*, std::unordered_map<size_t, size_t>>
+  get_occurrences(
+      DexClassesVector& dexen,
       const std::unordered_set<const DexMethod*>& perf_sensitive_methods,
       std::unordered_set<const DexString*> non_load_strings[]);
   std::unordered_map<DexString*, DedupStringInfo> get_strings_to_dedup(
       DexClassesVector& dexen,
-      const ConcurrentMap<DexString*, std::unordered_map<size_t, size_t>>&
+      const std::unordered_map<DexString*, std::unordered_map<size_t, size_t>>&
           occurrences,
       std::unordered_map<const DexMethod*, size_t>& methods_to_dex,
       std::unordered_set<const DexMethod*>& perf_sensitive_methods,
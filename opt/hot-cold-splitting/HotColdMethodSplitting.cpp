@@ -0,0 +1,556 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "HotColdMethodSplitting.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ConcurrentContainers.h"
+#include "ConfigFiles.h"
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "Dominators.h"
+#include "GraphUtil.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Liveness.h"
+#include "MethodProfiles.h"
+#include "MethodUtil.h"
+#include "PassManager.h"
+#include "ReachingDefinitions.h"
+#include "ScopedCFG.h"
+#include "Show.h"
+#include "SourceBlocks.h"
+#include "Trace.h"
+#include "TypeInference.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
+
+namespace hot_cold_splitting {
+
+namespace {
+
+struct Region {
+  cfg::Block* head;
+  std::unordered_set<cfg::Block*> blocks;
+  // The registers that are live into the region, and their types.
+  std::vector<reg_t> params;
+  std::deque<DexType*> param_types;
+};
+
+bool is_cold(const cfg::Block* block, float threshold) {
+  bool has_vals = false;
+  bool hot = false;
+  source_blocks::foreach_source_block(block, [&](const auto* sb) {
+    for (size_t i = 0; i < sb->vals.size(); ++i) {
+      auto val = sb->get_val(i);
+      if (!val) {
+        continue;
+      }
+      has_vals = true;
+      if (*val > threshold) {
+        hot = true;
+      }
+    }
+  });
+  return has_vals && !hot;
+}
+
+// Whether the instruction means the same in a static method of the same class.
+bool can_move_insn(const IRInstruction* insn) {
+  switch (insn->opcode()) {
+  // Structured locking only holds within a method.
+  case OPCODE_MONITOR_ENTER:
+  case OPCODE_MONITOR_EXIT:
+  case OPCODE_INVOKE_SUPER:
+  case OPCODE_MOVE_EXCEPTION:
+    return false;
+  default:
+    return !opcode::is_a_load_param(insn->opcode());
+  }
+}
+
+/*
+ * Finds the maximal cold regions: cold blocks with all the blocks they
+ * dominate, which are all cold, which are only entered through the head and
+ * only left by returning or throwing, and which are not covered by a
+ * try-region.
+ */
+std::vector<Region> find_regions(const Config& config,
+                                 cfg::ControlFlowGraph& cfg,
+                                 Stats* stats) {
+  std::unordered_map<const cfg::Block*, bool> cold;
+  bool any_cold = false;
+  for (auto* block : cfg.blocks()) {
+    bool block_cold = is_cold(block, config.block_profiles_hits);
+    cold.emplace(block, block_cold);
+    any_cold |= block_cold;
+  }
+  if (!any_cold) {
+    return {};
+  }
+
+  auto rpo = graph::postorder_sort<cfg::GraphInterface>(cfg);
+  std::reverse(rpo.begin(), rpo.end());
+  auto doms = cfg.get_dominators();
+  std::unordered_map<cfg::Block*, std::vector<cfg::Block*>> dom_children;
+  for (auto* block : rpo) {
+    if (block != cfg.entry_block()) {
+      dom_children[doms->get_idom(block)].push_back(block);
+    }
+  }
+
+  std::vector<Region> regions;
+  std::unordered_set<cfg::Block*> claimed;
+  for (auto* head : rpo) {
+    if (head == cfg.entry_block() || !cold.at(head) || claimed.count(head)) {
+      continue;
+    }
+    auto first_it = head->get_first_insn();
+    if (first_it != head->end() &&
+        opcode::is_move_result_any(first_it->insn->opcode())) {
+      continue;
+    }
+    bool closed = true;
+    for (auto* e : head->preds()) {
+      if (e->type() == cfg::EDGE_THROW) {
+        closed = false;
+      }
+    }
+
+    Region region{head, {}, {}, {}};
+    std::vector<cfg::Block*> stack{head};
+    while (closed && !stack.empty()) {
+      auto* block = stack.back();
+      stack.pop_back();
+      if (!cold.at(block)) {
+        closed = false;
+        break;
+      }
+      region.blocks.insert(block);
+      const auto& children = dom_children[block];
+      stack.insert(stack.end(), children.begin(), children.end());
+    }
+
+    bool movable = true;
+    size_t insns = 0;
+    for (auto* block : region.blocks) {
+      if (!closed) {
+        break;
+      }
+      for (auto* e : block->succs()) {
+        if (e->type() == cfg::EDGE_GHOST) {
+          continue;
+        }
+        if (e->type() == cfg::EDGE_THROW || !region.blocks.count(e->target())) {
+          closed = false;
+          break;
+        }
+      }
+      for (const auto& mie : InstructionIterable(block)) {
+        movable &= can_move_insn(mie.insn);
+        ++insns;
+      }
+    }
+    if (!closed) {
+      continue;
+    }
+
+    stats->cold_regions++;
+    if (!movable) {
+      stats->rejected_insns++;
+      continue;
+    }
+    if (insns < config.min_insns_size) {
+      // The regions of the blocks it dominates are only smaller.
+      stats->rejected_small++;
+      claimed.insert(region.blocks.begin(), region.blocks.end());
+      continue;
+    }
+    claimed.insert(region.blocks.begin(), region.blocks.end());
+    regions.push_back(std::move(region));
+  }
+  return regions;
+}
+
+// The exact type the verifier gives to an integer defined by `def`, or
+// nullptr if it is not known. Declaring a wider parameter type than that
+// would break narrower uses in the region, e.g. passing a boolean.
+const DexType* get_int_def_type(
+    const IRInstruction* def,
+    const std::unordered_map<const IRInstruction*, DexType*>& load_params) {
+  if (opcode::is_a_load_param(def->opcode())) {
+    return load_params.at(def);
+  }
+  if (def->has_method()) {
+    return def->get_method()->get_proto()->get_rtype();
+  }
+  if (def->has_field()) {
+    return def->get_field()->get_type();
+  }
+  switch (def->opcode()) {
+  case OPCODE_AGET_BOOLEAN:
+  case OPCODE_INSTANCE_OF:
+    return type::_boolean();
+  case OPCODE_AGET_BYTE:
+  case OPCODE_INT_TO_BYTE:
+    return type::_byte();
+  case OPCODE_AGET_CHAR:
+  case OPCODE_INT_TO_CHAR:
+    return type::_char();
+  case OPCODE_AGET_SHORT:
+  case OPCODE_INT_TO_SHORT:
+    return type::_short();
+  case OPCODE_AGET:
+  case OPCODE_ARRAY_LENGTH:
+  case OPCODE_LONG_TO_INT:
+  case OPCODE_FLOAT_TO_INT:
+  case OPCODE_DOUBLE_TO_INT:
+  case OPCODE_NEG_INT:
+  case OPCODE_NOT_INT:
+  case OPCODE_ADD_INT:
+  case OPCODE_SUB_INT:
+  case OPCODE_MUL_INT:
+  case OPCODE_DIV_INT:
+  case OPCODE_REM_INT:
+  case OPCODE_SHL_INT:
+  case OPCODE_SHR_INT:
+  case OPCODE_USHR_INT:
+  case OPCODE_ADD_INT_LIT16:
+  case OPCODE_RSUB_INT:
+  case OPCODE_MUL_INT_LIT16:
+  case OPCODE_DIV_INT_LIT16:
+  case OPCODE_REM_INT_LIT16:
+  case OPCODE_ADD_INT_LIT8:
+  case OPCODE_RSUB_INT_LIT8:
+  case OPCODE_MUL_INT_LIT8:
+  case OPCODE_DIV_INT_LIT8:
+  case OPCODE_REM_INT_LIT8:
+  case OPCODE_SHL_INT_LIT8:
+  case OPCODE_SHR_INT_LIT8:
+  case OPCODE_USHR_INT_LIT8:
+    return type::_int();
+  default:
+    // Constants and the bitwise operations of booleans are typed by their
+    // use.
+    return nullptr;
+  }
+}
+
+// Determines the parameters of the region, or returns false if one of the
+// live-in registers cannot be typed precisely.
+bool compute_params(
+    const Config& config,
+    const LivenessFixpointIterator& liveness,
+    const type_inference::TypeInference& inference,
+    const reaching_defs::MoveAwareFixpointIterator& rdefs,
+    const std::unordered_map<const IRInstruction*, DexType*>& load_params,
+    Region* region) {
+  const auto& types = inference.get_entry_state_at(region->head);
+  auto defs_env = rdefs.get_entry_state_at(region->head);
+  auto live_ins = liveness.get_live_in_vars_at(region->head).elements();
+  std::vector<reg_t> regs(live_ins.begin(), live_ins.end());
+  std::sort(regs.begin(), regs.end());
+
+  size_t words = 0;
+  for (auto reg : regs) {
+    const auto& defs = defs_env.get(reg);
+    if (defs.is_top() || defs.is_bottom()) {
+      return false;
+    }
+    const DexType* type = nullptr;
+    switch (types.get_type(reg).element()) {
+    case REFERENCE: {
+      auto dex_type = types.get_dex_type(reg);
+      if (!dex_type || *dex_type == nullptr) {
+        return false;
+      }
+      for (auto* def : defs.elements()) {
+        // An uninitialized object cannot be passed.
+        if (def->opcode() == OPCODE_NEW_INSTANCE) {
+          return false;
+        }
+      }
+      type = *dex_type;
+      break;
+    }
+    case INT:
+      for (auto* def : defs.elements()) {
+        auto def_type = get_int_def_type(def, load_params);
+        if (def_type == nullptr || (type != nullptr && type != def_type)) {
+          return false;
+        }
+        type = def_type;
+      }
+      break;
+    case FLOAT:
+      type = type::_float();
+      break;
+    case LONG1:
+      type = type::_long();
+      break;
+    case DOUBLE1:
+      type = type::_double();
+      break;
+    default:
+      return false;
+    }
+    words += type::is_wide_type(type) ? 2 : 1;
+    if (words > config.max_live_in_words) {
+      return false;
+    }
+    region->params.push_back(reg);
+    region->param_types.push_back(const_cast<DexType*>(type));
+  }
+  return true;
+}
+
+// Guards the naming of the new methods.
+std::mutex s_cold_methods_mutex;
+
+DexMethod* make_cold_method(DexMethod* method,
+                            const IRCode& code,
+                            const Region& region) {
+  auto cold_code = std::make_unique<IRCode>(code);
+  {
+    auto& cold_cfg = cold_code->cfg();
+    auto* entry = cold_cfg.create_block();
+    std::vector<IRInstruction*> load_params;
+    for (size_t i = 0; i < region.params.size(); ++i) {
+      load_params.push_back(
+          (new IRInstruction(opcode::load_opcode(region.param_types[i])))
+              ->set_dest(region.params[i]));
+    }
+    cold_cfg.push_back(entry, load_params);
+    cold_cfg.add_edge(entry, cold_cfg.get_block(region.head->id()),
+                      cfg::EDGE_GOTO);
+    cold_cfg.set_entry_block(entry);
+    cold_cfg.remove_unreachable_blocks();
+  }
+  cold_code->clear_cfg();
+
+  auto param_types = region.param_types;
+  auto* proto =
+      DexProto::make_proto(method->get_proto()->get_rtype(),
+                           DexTypeList::make_type_list(std::move(param_types)));
+
+  std::lock_guard<std::mutex> lock(s_cold_methods_mutex);
+  auto* name = DexMethod::get_unique_name(
+      method->get_class(), DexString::make_string(method->str() + "$cold"),
+      proto);
+  auto* cold_method =
+      DexMethod::make_method(method->get_class(), name, proto)
+          ->make_concrete(ACC_PUBLIC | ACC_STATIC, std::move(cold_code),
+                          /* is_virtual */ false);
+  cold_method->set_deobfuscated_name(show_deobfuscated(cold_method));
+  cold_method->rstate.set_api_level(method->rstate.get_api_level());
+  // Don't undo our work.
+  cold_method->rstate.set_dont_inline();
+  return cold_method;
+}
+
+// Makes the entries into the region call `cold_method` instead. The region
+// becomes unreachable.
+void replace_region(cfg::ControlFlowGraph& cfg,
+                    const Region& region,
+                    DexMethod* cold_method) {
+  auto* invoke = (new IRInstruction(OPCODE_INVOKE_STATIC))
+                     ->set_method(cold_method)
+                     ->set_srcs_size(region.params.size());
+  for (size_t i = 0; i < region.params.size(); ++i) {
+    invoke->set_src(i, region.params[i]);
+  }
+  std::vector<IRInstruction*> insns{invoke};
+  auto* rtype = cold_method->get_proto()->get_rtype();
+  if (type::is_void(rtype)) {
+    insns.push_back(new IRInstruction(OPCODE_RETURN_VOID));
+  } else {
+    auto reg = type::is_wide_type(rtype) ? cfg.allocate_wide_temp()
+                                         : cfg.allocate_temp();
+    insns.push_back(
+        (new IRInstruction(opcode::move_result_for_invoke(cold_method)))
+            ->set_dest(reg));
+    insns.push_back(
+        (new IRInstruction(opcode::return_opcode(rtype)))->set_src(0, reg));
+  }
+  auto* call_block = cfg.create_block();
+  cfg.push_back(call_block, insns);
+
+  // Keep the profile of the region at its call.
+  auto* head_sb = source_blocks::get_first_source_block(region.head);
+  if (head_sb != nullptr) {
+    auto sb = std::make_unique<SourceBlock>(*head_sb);
+    sb->next.reset();
+    cfg.insert_before(
+        call_block->to_cfg_instruction_iterator(call_block->get_first_insn()),
+        std::move(sb));
+  }
+
+  std::vector<cfg::Edge*> entries;
+  for (auto* e : region.head->preds()) {
+    if (!region.blocks.count(e->src())) {
+      entries.push_back(e);
+    }
+  }
+  for (auto* e : entries) {
+    cfg.set_edge_target(e, call_block);
+  }
+}
+
+} // namespace
+
+Stats& Stats::operator+=(const Stats& that) {
+  hot_methods += that.hot_methods;
+  split_methods += that.split_methods;
+  cold_regions += that.cold_regions;
+  split_regions += that.split_regions;
+  split_insns += that.split_insns;
+  rejected_small += that.rejected_small;
+  rejected_live_ins += that.rejected_live_ins;
+  rejected_insns += that.rejected_insns;
+  return *this;
+}
+
+Stats split_method(const Config& config,
+                   DexMethod* method,
+                   std::vector<DexMethod*>* cold_methods) {
+  Stats stats;
+  auto* code = method->get_code();
+  if (code == nullptr || method::is_any_init(method)) {
+    return stats;
+  }
+  stats.hot_methods = 1;
+
+  cfg::ScopedCFG scoped_cfg(code);
+  auto& cfg = *scoped_cfg;
+  auto regions = find_regions(config, cfg, &stats);
+  if (regions.empty()) {
+    return stats;
+  }
+
+  LivenessFixpointIterator liveness(cfg);
+  liveness.run(LivenessDomain());
+  type_inference::TypeInference inference(cfg);
+  inference.run(method);
+  reaching_defs::MoveAwareFixpointIterator rdefs(cfg);
+  rdefs.run(reaching_defs::Environment());
+
+  std::unordered_map<const IRInstruction*, DexType*> load_params;
+  {
+    auto* args = method->get_proto()->get_args();
+    auto arg_it = args->begin();
+    bool is_this = !is_static(method);
+    for (const auto& mie : InstructionIterable(cfg.get_param_instructions())) {
+      if (is_this) {
+        load_params.emplace(mie.insn, method->get_class());
+        is_this = false;
+      } else {
+        load_params.emplace(mie.insn, *arg_it++);
+      }
+    }
+  }
+
+  for (auto& region : regions) {
+    if (!compute_params(config, liveness, inference, rdefs, load_params,
+                        &region)) {
+      stats.rejected_live_ins++;
+      continue;
+    }
+    size_t insns = 0;
+    for (auto* block : region.blocks) {
+      insns += block->num_opcodes();
+    }
+    auto* cold_method = make_cold_method(method, *code, region);
+    replace_region(cfg, region, cold_method);
+    cold_methods->push_back(cold_method);
+    TRACE(HCS, 3, "Moved %zu instructions of %s into %s", insns, SHOW(method),
+          SHOW(cold_method));
+    stats.split_regions++;
+    stats.split_insns += insns;
+  }
+  if (stats.split_regions > 0) {
+    cfg.remove_unreachable_blocks();
+    stats.split_methods = 1;
+  }
+  return stats;
+}
+
+} // namespace hot_cold_splitting
+
+void HotColdMethodSplittingPass::bind_config() {
+  bind("method_profiles_appear_percent",
+       m_config.method_profiles_appear_percent,
+       m_config.method_profiles_appear_percent,
+       "Minimum appear percent in some interaction for a method to be hot");
+  bind("block_profiles_hits", m_config.block_profiles_hits,
+       m_config.block_profiles_hits,
+       "Maximum source block value for a block to be cold");
+  bind("min_insns_size", m_config.min_insns_size, m_config.min_insns_size,
+       "Minimum number of instructions of a cold region to split");
+  bind("max_live_in_words", m_config.max_live_in_words,
+       m_config.max_live_in_words,
+       "Maximum number of registers live into a cold region to split");
+}
+
+void HotColdMethodSplittingPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles& conf,
+                                          PassManager& mgr) {
+  // Don't run under instrumentation.
+  if (mgr.get_redex_options().instrument_pass_enabled) {
+    return;
+  }
+
+  const auto& method_profiles = conf.get_method_profiles();
+  if (!method_profiles.has_stats()) {
+    mgr.set_metric("no_method_profiles", 1);
+    return;
+  }
+  std::unordered_set<const DexMethodRef*> hot_methods;
+  for (const auto& pair : method_profiles.all_interactions()) {
+    for (const auto& method_stats : pair.second) {
+      if (method_stats.second.appear_percent >=
+          m_config.method_profiles_appear_percent) {
+        hot_methods.insert(method_stats.first);
+      }
+    }
+  }
+
+  auto scope = build_class_scope(stores);
+  ConcurrentSet<DexMethod*> cold_methods;
+  auto stats = walk::parallel::methods<hot_cold_splitting::Stats>(
+      scope, [&](DexMethod* method) {
+        if (!hot_methods.count(method)) {
+          return hot_cold_splitting::Stats{};
+        }
+        std::vector<DexMethod*> method_cold_methods;
+        auto method_stats = hot_cold_splitting::split_method(
+            m_config, method, &method_cold_methods);
+        for (auto* cold_method : method_cold_methods) {
+          cold_methods.insert(cold_method);
+        }
+        return method_stats;
+      });
+  // The walk iterates over the methods of the classes, so the new methods
+  // can only be added once it is done.
+  for (auto* cold_method : cold_methods) {
+    type_class(cold_method->get_class())->add_method(cold_method);
+  }
+
+  mgr.set_metric("hot_methods", stats.hot_methods);
+  mgr.set_metric("split_methods", stats.split_methods);
+  mgr.set_metric("cold_regions", stats.cold_regions);
+  mgr.set_metric("split_regions", stats.split_regions);
+  mgr.set_metric("split_insns", stats.split_insns);
+  mgr.set_metric("rejected_small", stats.rejected_small);
+  mgr.set_metric("rejected_live_ins", stats.rejected_live_ins);
+  mgr.set_metric("rejected_insns", stats.rejected_insns);
+}
+
+static HotColdMethodSplittingPass s_pass;
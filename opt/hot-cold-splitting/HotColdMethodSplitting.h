@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Pass.h"
+
+class DexMethod;
+
+namespace hot_cold_splitting {
+
+struct Config {
+  // A method is hot if it appears in at least this percentage of the traces
+  // of some interaction.
+  float method_profiles_appear_percent{1};
+  // A block is cold if none of its source blocks has a value above this in
+  // any interaction.
+  float block_profiles_hits{0};
+  // Cold regions smaller than this are not worth a call.
+  uint32_t min_insns_size{16};
+  // Cold regions with more live-in register words are left in place.
+  uint32_t max_live_in_words{16};
+};
+
+struct Stats {
+  size_t hot_methods{0};
+  size_t split_methods{0};
+  size_t cold_regions{0};
+  size_t split_regions{0};
+  size_t split_insns{0};
+  size_t rejected_small{0};
+  size_t rejected_live_ins{0};
+  size_t rejected_insns{0};
+
+  Stats& operator+=(const Stats& that);
+};
+
+/*
+ * Moves the cold regions of `method` into new static methods, which are
+ * appended to `cold_methods`. They are not added to the class of `method`:
+ * the caller does that, since it is not safe while the methods of the class
+ * may be walked. This does not check that `method` is hot. It is safe to call
+ * concurrently for different methods.
+ */
+Stats split_method(const Config& config,
+                   DexMethod* method,
+                   std::vector<DexMethod*>* cold_methods);
+
+} // namespace hot_cold_splitting
+
+/*
+ * Splits the cold code of hot methods into separate methods, so that the hot
+ * code is denser.
+ *
+ * A block is cold if its source blocks were never (or barely) hit. A cold
+ * region is a cold block together with all the blocks it dominates, as long
+ * as they are all cold, and the region only exits the method, by returning or
+ * throwing. Such a region is moved into a new static method of the same
+ * class, taking the registers that are live into the region as parameters,
+ * and is replaced by a call to it.
+ *
+ * The new methods are not part of the method profiles, so ClassSplittingPass
+ * relocates them out of the cold-start dexes when it runs after this pass.
+ */
+class HotColdMethodSplittingPass : public Pass {
+ public:
+  HotColdMethodSplittingPass() : Pass("HotColdMethodSplittingPass") {}
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  hot_cold_splitting::Config m_config;
+};
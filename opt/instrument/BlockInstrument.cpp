@@ -19,6 +19,7 @@
 #include "Walkers.h"
 
 #include <boost/algorithm/string/join.hpp>
+#include <boost/optional.hpp>
 #include <fstream>
 #include <map>
 #include <string>
@@ -47,6 +48,8 @@ enum class BlockType {
   Catch = 1 << 4,
   MoveException = 1 << 5,
   NoSourceBlock = 1 << 6,
+  // Shares the bit of its only predecessor, see `merge_linear_blocks`.
+  Merged = 1 << 7,
 };
 
 enum class InstrumentedType {
@@ -101,6 +104,9 @@ struct MethodInfo {
   size_t num_catches = 0;
   size_t num_instrumented_catches = 0;
   size_t num_instrumented_blocks = 0;
+  size_t num_merged_blocks = 0;
+  // The number of instructions added to the method.
+  size_t num_overhead_insns = 0;
 
   std::vector<cfg::BlockId> bit_id_2_block_id;
   std::vector<std::vector<SourceBlock*>> bit_id_2_source_blocks;
@@ -536,7 +542,26 @@ auto get_blocks_to_instrument(const cfg::ControlFlowGraph& cfg,
       &cfg, block_start_fn, [](cfg::Block*, const cfg::Edge*) {},
       [](cfg::Block*) {});
 
-  // Future work: Pick minimal instrumentation candidates.
+  // With `merge_linear_blocks`, a block that is only entered from a block that
+  // cannot leave it any other way, not even by throwing, runs exactly when
+  // that block does. It needs no bit of its own. As `blocks` is in DFS
+  // order, the predecessor's bit is assigned by the time the block is seen.
+  std::unordered_map<const cfg::Block*, BitId> block_to_bit;
+  auto find_merge_target = [&](const cfg::Block* b) -> boost::optional<BitId> {
+    if (!options.merge_linear_blocks || b->preds().size() != 1) {
+      return boost::none;
+    }
+    const auto* edge = b->preds().front();
+    if (edge->type() != cfg::EDGE_GOTO || edge->src()->succs().size() != 1) {
+      return boost::none;
+    }
+    auto it = block_to_bit.find(edge->src());
+    if (it == block_to_bit.end()) {
+      return boost::none;
+    }
+    return it->second;
+  };
+
   std::vector<BlockInfo> block_info_list;
   block_info_list.reserve(blocks.size());
   BitId id = 0;
@@ -544,12 +569,23 @@ auto get_blocks_to_instrument(const cfg::ControlFlowGraph& cfg,
     block_info_list.emplace_back(create_block_info(b, options));
     auto& info = block_info_list.back();
     if ((info.type & BlockType::Instrumentable) == BlockType::Instrumentable) {
+      auto merge_target = find_merge_target(b);
+      if (merge_target) {
+        info.type = BlockType::Merged |
+                    static_cast<BlockType>(
+                        static_cast<int>(info.type) &
+                        ~static_cast<int>(BlockType::Instrumentable));
+        info.bit_id = *merge_target;
+        block_to_bit.emplace(b, *merge_target);
+        continue;
+      }
       if (id >= max_num_blocks) {
         // This is effectively rejecting all blocks.
         return std::make_tuple(std::vector<BlockInfo>{}, BitId(0),
                                true /* too many block */);
       }
       info.bit_id = id++;
+      block_to_bit.emplace(b, info.bit_id);
     }
   }
   return std::make_tuple(block_info_list, id, false);
@@ -654,8 +690,19 @@ MethodInfo instrument_basic_blocks(IRCode& code,
   info.num_instrumented_catches =
       count(BlockType::Catch | BlockType::Instrumentable);
   info.num_instrumented_blocks = num_to_instrument;
+  info.num_merged_blocks = count(BlockType::Merged);
   always_assert(count(BlockType::Instrumentable) == num_to_instrument);
 
+  // The prologue sets up the vectors and calls onMethodBegin, each block sets
+  // one bit, and each exit reports the vectors in one or more calls.
+  const size_t num_exit_invokes =
+      num_vectors == 0 ? 0
+                       : std::max(size_t(1), (num_vectors + max_vector_arity -
+                                              1) / max_vector_arity);
+  info.num_overhead_insns =
+      num_vectors + 2 + num_to_instrument +
+      num_exit_calls * (num_exit_invokes == 0 ? 0 : 2 * num_exit_invokes - 1);
+
   info.bit_id_2_block_id.reserve(num_to_instrument);
   info.bit_id_2_source_blocks.reserve(num_to_instrument);
   for (const auto& i : blocks) {
@@ -667,10 +714,19 @@ MethodInfo instrument_basic_blocks(IRCode& code,
       info.rejected_blocks[i.block->id()] = i.type;
     }
   }
+  // The source blocks of a merged block are covered by the bit it shares.
+  for (const auto& i : blocks) {
+    if ((i.type & BlockType::Merged) == BlockType::Merged) {
+      auto& sbs = info.bit_id_2_source_blocks.at(i.bit_id);
+      auto merged_sbs = source_blocks::gather_source_blocks(i.block);
+      sbs.insert(sbs.end(), merged_sbs.begin(), merged_sbs.end());
+    }
+  }
 
   const size_t num_rejected_blocks =
       info.num_empty_blocks + info.num_useless_blocks +
       info.num_no_source_blocks + info.num_blocks_too_large +
+      info.num_merged_blocks +
       (info.num_catches - info.num_instrumented_catches);
   always_assert(info.num_non_entry_blocks ==
                 info.num_instrumented_blocks + num_rejected_blocks);
@@ -798,6 +854,24 @@ void print_stats(ScopedMetrics& sm,
     scope_total_avg("bit_vectors", total_bit_vectors, total_block_instrumented);
   }
 
+  // ----- Instruction overhead stats
+  {
+    size_t total_overhead = 0;
+    size_t max_overhead = 0;
+    for (const auto& i : instrumented_methods) {
+      TRACE(INSTRUMENT, 9, "Overhead of %zu instructions: %s",
+            i.num_overhead_insns, show_deobfuscated(i.method).c_str());
+      total_overhead += i.num_overhead_insns;
+      max_overhead = std::max(max_overhead, i.num_overhead_insns);
+    }
+    TRACE(INSTRUMENT, 4, "Total/average/max added instructions: %zu, %s, %zu",
+          total_overhead, SHOW(divide(total_overhead, total_instrumented)),
+          max_overhead);
+    auto overhead_scope =
+        scope_total_avg("overhead_insns", total_overhead, total_instrumented);
+    sm.set_metric("max", max_overhead);
+  }
+
   // ----- Instrumented block stats
   TRACE(INSTRUMENT, 4, "Instrumented / actual non-entry block stats:");
   size_t total_instrumented_blocks = 0;
@@ -892,6 +966,12 @@ void print_stats(ScopedMetrics& sm,
       TRACE(INSTRUMENT, 4, "- Skipped useless blocks: %s",
             SHOW(print_ratio(useless_blocks)));
       metric_ratio("useless_blocks", useless_blocks);
+      auto merged_blocks = std::accumulate(
+          instrumented_methods.begin(), instrumented_methods.end(), size_t(0),
+          [](size_t a, auto&& i) { return a + i.num_merged_blocks; });
+      TRACE(INSTRUMENT, 4, "- Merged into their predecessor: %s",
+            SHOW(print_ratio(merged_blocks)));
+      metric_ratio("merged_blocks", merged_blocks);
     }
   }
 
@@ -14,6 +14,7 @@
 #include "InterDexPass.h"
 #include "InterDexPassPlugin.h"
 #include "Match.h"
+#include "MethodProfiles.h"
 #include "MethodReference.h"
 #include "PassManager.h"
 #include "Show.h"
@@ -111,9 +112,71 @@ bool match_class_name(std::string cls_name,
   return false;
 }
 
+// Inserts, before `insert_point`, code that only lets every `period`-th
+// invocation through to the code that follows it up to the returned position:
+//
+//   v_count = sample_counters[sample_slot] - 1
+//   sample_counters[sample_slot] = v_count
+//   if (v_count > 0) goto skip
+//   sample_counters[sample_slot] = period
+//   <code inserted before the returned position>
+// skip:
+//
+// The counters are shared by all threads. Racing updates can only shift which
+// invocation gets recorded, which is fine for sampling.
+IRList::iterator insert_sampling_check(IRCode* code,
+                                       const IRList::iterator& insert_point,
+                                       DexFieldRef* sample_counters,
+                                       size_t sample_slot,
+                                       int64_t period) {
+  const auto reg_array = code->allocate_temp();
+  const auto reg_slot = code->allocate_temp();
+  const auto reg_count = code->allocate_temp();
+
+  std::vector<IRInstruction*> check;
+  check.push_back(
+      (new IRInstruction(OPCODE_SGET_OBJECT))->set_field(sample_counters));
+  check.push_back(
+      (new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT))
+          ->set_dest(reg_array));
+  check.push_back((new IRInstruction(OPCODE_CONST))
+                      ->set_literal(sample_slot)
+                      ->set_dest(reg_slot));
+  check.push_back((new IRInstruction(OPCODE_AGET))
+                      ->set_src(0, reg_array)
+                      ->set_src(1, reg_slot));
+  check.push_back(
+      (new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO))->set_dest(reg_count));
+  check.push_back((new IRInstruction(OPCODE_ADD_INT_LIT8))
+                      ->set_literal(-1)
+                      ->set_src(0, reg_count)
+                      ->set_dest(reg_count));
+  check.push_back((new IRInstruction(OPCODE_APUT))
+                      ->set_src(0, reg_count)
+                      ->set_src(1, reg_array)
+                      ->set_src(2, reg_slot));
+  for (auto* insn : check) {
+    code->insert_before(insert_point, insn);
+  }
+  auto if_it = code->insert_before(
+      insert_point,
+      (new IRInstruction(OPCODE_IF_GTZ))->set_src(0, reg_count));
+  code->insert_before(insert_point, (new IRInstruction(OPCODE_CONST))
+                                        ->set_literal(period)
+                                        ->set_dest(reg_count));
+  code->insert_before(insert_point, (new IRInstruction(OPCODE_APUT))
+                                        ->set_src(0, reg_count)
+                                        ->set_src(1, reg_array)
+                                        ->set_src(2, reg_slot));
+  return code->insert_before(insert_point, new BranchTarget(&*if_it));
+}
+
 void instrument_onMethodBegin(DexMethod* method,
                               int index,
-                              DexMethod* method_onMethodBegin) {
+                              DexMethod* method_onMethodBegin,
+                              DexFieldRef* sample_counters = nullptr,
+                              size_t sample_slot = 0,
+                              int64_t sample_period = 1) {
   IRCode* code = method->get_code();
   assert(code != nullptr);
 
@@ -155,7 +218,12 @@ void instrument_onMethodBegin(DexMethod* method,
     // Otherwise, insert_point can be used directly.
   }
 
-  code->insert_before(code->insert_before(insert_point, invoke_inst),
+  auto record_point = insert_point;
+  if (sample_counters != nullptr && sample_period > 1) {
+    record_point = insert_sampling_check(code, insert_point, sample_counters,
+                                         sample_slot, sample_period);
+  }
+  code->insert_before(code->insert_before(record_point, invoke_inst),
                       const_inst);
 
   if (instr_debug) {
@@ -346,12 +414,52 @@ void do_simple_method_tracing(DexClass* analysis_cls,
   const size_t kTotalSize = to_instrument.size();
   TRACE(INSTRUMENT, 2, "%zu methods to be instrumented; shard size: %zu (+1)",
         kTotalSize, kTotalSize / NUM_SHARDS);
+
+  // With sampling, each method counts down its own slot of
+  // `sSampleCountdowns` and only every N-th call is recorded. N is larger for
+  // methods that the given method profiles show to be hot. The periods are
+  // written to the metadata as `S,<method id>,<period>` lines, so that the
+  // recorded counts can be scaled back.
+  const bool sampling = options.sampling_period > 1 ||
+                        options.hot_method_sampling_period > 1;
+  DexFieldRef* sample_counters = nullptr;
+  if (sampling) {
+    sample_counters = analysis_cls->find_field_from_simple_deobfuscated_name(
+        "sSampleCountdowns");
+    always_assert_log(sample_counters != nullptr,
+                      "[InstrumentPass] error: sampling requires an int[] "
+                      "sSampleCountdowns field in %s",
+                      SHOW(analysis_cls));
+    InstrumentPass::patch_array_size(
+        analysis_cls, sample_counters->get_name()->str(), kTotalSize);
+  }
+  const auto& method_profiles = cfg.get_method_profiles();
+  auto get_sample_period = [&](const DexMethod* method) -> int64_t {
+    if (options.hot_method_sampling_period > 0) {
+      for (const auto& interaction : method_profiles.all_interactions()) {
+        auto it = interaction.second.find(method);
+        if (it != interaction.second.end() &&
+            it->second.call_count >= options.hot_method_call_count) {
+          return options.hot_method_sampling_period;
+        }
+      }
+    }
+    return std::max(options.sampling_period, int64_t(1));
+  };
+
+  size_t sampled = 0;
   for (size_t i = 0; i < kTotalSize; ++i) {
     TRACE(INSTRUMENT, 6, "Sharded %zu => [%zu][%zu] %s", i, (i % NUM_SHARDS),
           (i / NUM_SHARDS), SHOW(to_instrument[i]));
+    int64_t period = sampling ? get_sample_period(to_instrument[i]) : 1;
+    if (period > 1) {
+      ofs << "S," << i << "," << period << "\n";
+      ++sampled;
+    }
     instrument_onMethodBegin(to_instrument[i],
                              (i / NUM_SHARDS) * options.num_stats_per_method,
-                             analysis_method_map.at((i % NUM_SHARDS) + 1));
+                             analysis_method_map.at((i % NUM_SHARDS) + 1),
+                             sample_counters, i, period);
   }
 
   TRACE(INSTRUMENT,
@@ -389,6 +497,7 @@ void do_simple_method_tracing(DexClass* analysis_cls,
 
   pm.incr_metric("Instrumented", method_id);
   pm.incr_metric("Excluded", excluded);
+  pm.incr_metric("Sampled", sampled);
 }
 
 std::unordered_set<std::string> load_blocklist_file(
@@ -574,6 +683,15 @@ void InstrumentPass::bind_config() {
        m_options.instrument_blocks_without_source_block);
   bind("instrument_only_root_store", false,
        m_options.instrument_only_root_store);
+  // Blocks that always run together with their only predecessor share its
+  // bit, which saves an instruction per such block.
+  bind("merge_linear_blocks", false, m_options.merge_linear_blocks);
+  // Simple method tracing only: record every N-th call of each method. Hot
+  // methods, i.e. those called at least `hot_method_call_count` times on
+  // average in any interaction of the method profiles, use their own period.
+  bind("sampling_period", 0, m_options.sampling_period);
+  bind("hot_method_sampling_period", 0, m_options.hot_method_sampling_period);
+  bind("hot_method_call_count", 1000.0f, m_options.hot_method_call_count);
 
   size_t max_analysis_methods;
   if (m_options.instrumentation_strategy == SIMPLE_METHOD_TRACING) {
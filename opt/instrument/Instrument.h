@@ -76,6 +76,10 @@ class InstrumentPass : public Pass {
     bool instrument_catches;
     bool instrument_blocks_without_source_block;
     bool instrument_only_root_store;
+    bool merge_linear_blocks;
+    int64_t sampling_period;
+    int64_t hot_method_sampling_period;
+    float hot_method_call_count;
   };
 
  private:
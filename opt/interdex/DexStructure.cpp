@@ -82,16 +82,16 @@ unsigned estimate_linear_alloc(const DexClass* clazz) {
 }
 
 /**
- * Removes the elements of b from a. Runs in O(size(a)), so it works best if
- * size(a) << size(b).
+ * Counts the elements of a that are not in b. Runs in O(size(a)), without
+ * allocating, so it works best if size(a) << size(b).
  */
 template <typename T>
-std::unordered_set<T> set_difference(const std::unordered_set<T>& a,
-                                     const std::unordered_set<T>& b) {
-  std::unordered_set<T> result;
+size_t count_difference(const std::unordered_set<T>& a,
+                        const std::unordered_set<T>& b) {
+  size_t result{0};
   for (auto& v : a) {
     if (!b.count(v)) {
-      result.emplace(v);
+      result++;
     }
   }
   return result;
@@ -109,9 +109,7 @@ bool DexesStructure::add_class_to_current_dex(const MethodRefs& clazz_mrefs,
                     "Can't emit the same class twice! %s", SHOW(clazz));
 
   if (m_current_dex.add_class_if_fits(
-          clazz_mrefs, clazz_frefs, clazz_trefs, m_linear_alloc_limit,
-          MAX_FIELD_REFS - m_reserve_frefs, MAX_METHOD_REFS - m_reserve_mrefs,
-          MAX_TYPE_REFS(m_min_sdk) - m_reserve_trefs, clazz)) {
+          clazz_mrefs, clazz_frefs, clazz_trefs, get_limits(), clazz)) {
     update_stats(clazz_mrefs, clazz_frefs, clazz);
     m_classes.emplace(clazz);
     return true;
@@ -134,6 +132,15 @@ void DexesStructure::add_class_no_checks(const MethodRefs& clazz_mrefs,
   update_stats(clazz_mrefs, clazz_frefs, clazz);
 }
 
+DexStructure::Limits DexesStructure::get_limits() const {
+  DexStructure::Limits limits;
+  limits.linear_alloc = m_linear_alloc_limit;
+  limits.field_refs = MAX_FIELD_REFS - m_reserve_frefs;
+  limits.method_refs = MAX_METHOD_REFS - m_reserve_mrefs;
+  limits.type_refs = MAX_TYPE_REFS(m_min_sdk) - m_reserve_trefs;
+  return limits;
+}
+
 DexClasses DexesStructure::end_dex(DexInfo dex_info) {
   m_info.num_dexes++;
 
@@ -178,14 +185,23 @@ void DexesStructure::update_stats(const MethodRefs& clazz_mrefs,
 bool DexStructure::add_class_if_fits(const MethodRefs& clazz_mrefs,
                                      const FieldRefs& clazz_frefs,
                                      const TypeRefs& clazz_trefs,
-                                     size_t linear_alloc_limit,
-                                     size_t field_refs_limit,
-                                     size_t method_refs_limit,
-                                     size_t type_refs_limit,
+                                     const Limits& limits,
                                      DexClass* clazz) {
-
   unsigned laclazz = estimate_linear_alloc(clazz);
-  if (m_linear_alloc_size + laclazz > linear_alloc_limit) {
+  if (!fits(clazz_mrefs, clazz_frefs, clazz_trefs, limits, laclazz, clazz)) {
+    return false;
+  }
+  add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs, laclazz, clazz);
+  return true;
+}
+
+bool DexStructure::fits(const MethodRefs& clazz_mrefs,
+                        const FieldRefs& clazz_frefs,
+                        const TypeRefs& clazz_trefs,
+                        const Limits& limits,
+                        unsigned laclazz,
+                        DexClass* clazz) const {
+  if (m_linear_alloc_size + laclazz > limits.linear_alloc) {
     TRACE(IDEX, 6,
           "[warning]: Class won't fit current dex since it will go "
           "over the linear alloc limit: %s",
@@ -193,35 +209,33 @@ bool DexStructure::add_class_if_fits(const MethodRefs& clazz_mrefs,
     return false;
   }
 
-  auto extra_mrefs = set_difference(clazz_mrefs, m_mrefs);
-  auto extra_frefs = set_difference(clazz_frefs, m_frefs);
-  auto extra_trefs = set_difference(clazz_trefs, m_trefs);
-
-  if (m_mrefs.size() + extra_mrefs.size() >= method_refs_limit) {
+  auto mrefs_size = m_mrefs.size() + count_difference(clazz_mrefs, m_mrefs);
+  if (mrefs_size >= limits.method_refs) {
     TRACE(IDEX, 6,
           "[warning]: Class won't fit current dex since it will go "
           "over the method refs limit: %zu >= %zu: %s",
-          m_mrefs.size() + extra_mrefs.size(), method_refs_limit, SHOW(clazz));
+          mrefs_size, limits.method_refs, SHOW(clazz));
     return false;
   }
 
-  if (m_frefs.size() + extra_frefs.size() >= field_refs_limit) {
+  auto frefs_size = m_frefs.size() + count_difference(clazz_frefs, m_frefs);
+  if (frefs_size >= limits.field_refs) {
     TRACE(IDEX, 6,
           "[warning]: Class won't fit current dex since it will go "
           "over the field refs limit: %zu >= %zu: %s",
-          m_frefs.size() + extra_frefs.size(), field_refs_limit, SHOW(clazz));
+          frefs_size, limits.field_refs, SHOW(clazz));
     return false;
   }
 
-  if (m_trefs.size() + extra_trefs.size() >= type_refs_limit) {
+  auto trefs_size = m_trefs.size() + count_difference(clazz_trefs, m_trefs);
+  if (trefs_size >= limits.type_refs) {
     TRACE(IDEX, 6,
           "[warning]: Class won't fit current dex since it will go "
           "over the type refs limit: %zu >= %zu: %s",
-          m_trefs.size() + extra_trefs.size(), type_refs_limit, SHOW(clazz));
+          trefs_size, limits.type_refs, SHOW(clazz));
     return false;
   }
 
-  add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs, laclazz, clazz);
   return true;
 }
 
@@ -45,18 +45,34 @@ class DexStructure {
    */
   DexClasses take_all_classes() { return std::move(m_classes); }
 
+  struct Limits {
+    size_t linear_alloc;
+    size_t field_refs;
+    size_t method_refs;
+    size_t type_refs;
+  };
+
   /**
    * Tries to add the specified class. Returns false if it doesn't fit.
    */
   bool add_class_if_fits(const MethodRefs& clazz_mrefs,
                          const FieldRefs& clazz_frefs,
                          const TypeRefs& clazz_trefs,
-                         size_t linear_alloc_limit,
-                         size_t field_refs_limit,
-                         size_t method_refs_limit,
-                         size_t type_refs_limit,
+                         const Limits& limits,
                          DexClass* clazz);
 
+  /**
+   * Whether the specified class would fit, in O(refs of the class) and
+   * without changing anything, so that several candidate classes can be
+   * evaluated concurrently.
+   */
+  bool fits(const MethodRefs& clazz_mrefs,
+            const FieldRefs& clazz_frefs,
+            const TypeRefs& clazz_trefs,
+            const Limits& limits,
+            unsigned laclazz,
+            DexClass* clazz) const;
+
   void add_class_no_checks(const MethodRefs& clazz_mrefs,
                            const FieldRefs& clazz_frefs,
                            const TypeRefs& clazz_trefs,
@@ -161,6 +177,8 @@ class DexesStructure {
   bool has_class(DexClass* clazz) const { return m_classes.count(clazz); }
 
  private:
+  DexStructure::Limits get_limits() const;
+
   void update_stats(const MethodRefs& clazz_mrefs,
                     const FieldRefs& clazz_frefs,
                     DexClass* clazz);
@@ -11,6 +11,7 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <map>
 #include <string>
 #include <unordered_set>
 #include <vector>
@@ -132,6 +133,7 @@ std::unordered_set<DexClass*> find_unrefenced_coldstart_classes(
 
 void gather_refs(
     const std::vector<std::unique_ptr<interdex::InterDexPassPlugin>>& plugins,
+    class_refs::Cache* class_refs,
     const interdex::DexInfo& dex_info,
     const DexClass* cls,
     interdex::MethodRefs* mrefs,
@@ -139,12 +141,11 @@ void gather_refs(
     interdex::TypeRefs* trefs,
     std::vector<DexClass*>* erased_classes,
     bool should_not_relocate_methods_of_class) {
-  std::vector<DexMethodRef*> method_refs;
-  std::vector<DexFieldRef*> field_refs;
-  std::vector<DexType*> type_refs;
-  cls->gather_methods(method_refs);
-  cls->gather_fields(field_refs);
-  cls->gather_types(type_refs);
+  auto refs = class_refs->get(cls);
+  // Plugins may add to these.
+  auto method_refs = refs->method_refs;
+  auto field_refs = refs->field_refs;
+  auto type_refs = refs->types;
 
   for (const auto& plugin : plugins) {
     plugin->gather_refs(dex_info, cls, method_refs, field_refs, type_refs,
@@ -339,8 +340,8 @@ bool InterDex::emit_class(DexInfo& dex_info,
   MethodRefs clazz_mrefs;
   FieldRefs clazz_frefs;
   TypeRefs clazz_trefs;
-  gather_refs(m_plugins, dex_info, clazz, &clazz_mrefs, &clazz_frefs,
-              &clazz_trefs, erased_classes,
+  gather_refs(m_plugins, &m_class_refs, dex_info, clazz, &clazz_mrefs,
+              &clazz_frefs, &clazz_trefs, erased_classes,
               should_not_relocate_methods_of_class(clazz));
 
   bool fits_current_dex = m_dexes_structure.add_class_to_current_dex(
@@ -356,8 +357,8 @@ bool InterDex::emit_class(DexInfo& dex_info,
     clazz_frefs.clear();
     clazz_trefs.clear();
     if (erased_classes) erased_classes->clear();
-    gather_refs(m_plugins, dex_info, clazz, &clazz_mrefs, &clazz_frefs,
-                &clazz_trefs, erased_classes,
+    gather_refs(m_plugins, &m_class_refs, dex_info, clazz, &clazz_mrefs,
+                &clazz_frefs, &clazz_trefs, erased_classes,
                 should_not_relocate_methods_of_class(clazz));
 
     m_dexes_structure.add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs,
@@ -712,6 +713,7 @@ void InterDex::init_cross_dex_ref_minimizer_and_relocate_methods() {
         !should_not_relocate_methods_of_class(cls)) {
       std::vector<DexClass*> relocated_classes;
       m_cross_dex_relocator->relocate_methods(cls, relocated_classes);
+      m_class_refs.invalidate(cls);
       for (DexClass* relocated_cls : relocated_classes) {
         // Tell all plugins that the new class is now effectively part of the
         // scope.
@@ -740,15 +742,11 @@ void InterDex::init_cross_dex_ref_minimizer_and_relocate_methods() {
   }
 
   // Initialize ref frequency counts
-  for (DexClass* cls : classes_to_insert) {
-    m_cross_dex_ref_minimizer.sample(cls);
-  }
+  m_cross_dex_ref_minimizer.sample(classes_to_insert);
 
   // Emit classes using some algorithm to group together classes which
   // tend to share the same refs.
-  for (DexClass* cls : classes_to_insert) {
-    m_cross_dex_ref_minimizer.insert(cls);
-  }
+  m_cross_dex_ref_minimizer.insert(classes_to_insert);
 
   // A few classes might have already been emitted to the current dex which we
   // are about to fill up. Make it so that the minimizer knows that all the refs
@@ -765,6 +763,12 @@ void InterDex::emit_remaining_classes(DexInfo& dex_info) {
   m_current_classes_when_emitting_remaining =
       m_dexes_structure.get_current_dex_classes().size();
 
+  if (m_previous_assignment != nullptr) {
+    // Reproducing the previous dexes takes precedence over reordering.
+    emit_remaining_classes_as_previously_assigned(dex_info);
+    return;
+  }
+
   if (!m_minimize_cross_dex_refs) {
     for (DexClass* cls : m_scope) {
       emit_class(dex_info, cls, /* check_if_skip */ true,
@@ -830,6 +834,70 @@ void InterDex::emit_remaining_classes(DexInfo& dex_info) {
   }
 }
 
+void InterDex::emit_remaining_classes_as_previously_assigned(
+    DexInfo& dex_info) {
+  std::map<size_t, std::vector<DexClass*>> previous_dexes;
+  std::vector<DexClass*> unassigned;
+  for (DexClass* cls : m_scope) {
+    if (m_dexes_structure.has_class(cls) || is_canary(cls)) {
+      continue;
+    }
+    auto it = m_previous_assignment->find(cls->get_type());
+    if (it == m_previous_assignment->end()) {
+      unassigned.push_back(cls);
+    } else {
+      previous_dexes[it->second].push_back(cls);
+    }
+  }
+  m_classes_not_in_previous_assignment = unassigned.size();
+  TRACE(IDEX, 2,
+        "IDEX: Emitting remaining classes into %zu previous dexes, with %zu "
+        "unassigned classes",
+        previous_dexes.size(), unassigned.size());
+
+  auto next_unassigned = unassigned.begin();
+  for (auto& p : previous_dexes) {
+    for (DexClass* cls : p.second) {
+      emit_class(dex_info, cls, /* check_if_skip */ true,
+                 /* perf_sensitive */ false);
+    }
+    // Plugins keep state about the refs they gathered for the current dex,
+    // which a class that doesn't fit would leave behind, so the unassigned
+    // classes only fill up the dexes when there are no plugins. The first
+    // one that doesn't fit ends the dex.
+    if (m_plugins.empty()) {
+      while (next_unassigned != unassigned.end() &&
+             emit_class_if_fits(dex_info, *next_unassigned)) {
+        ++next_unassigned;
+      }
+    }
+    if (!m_dexes_structure.get_current_dex_classes().empty()) {
+      flush_out_dex(dex_info);
+    }
+  }
+
+  for (; next_unassigned != unassigned.end(); ++next_unassigned) {
+    emit_class(dex_info, *next_unassigned, /* check_if_skip */ true,
+               /* perf_sensitive */ false);
+  }
+}
+
+bool InterDex::emit_class_if_fits(DexInfo& dex_info, DexClass* clazz) {
+  if (m_dexes_structure.has_class(clazz) ||
+      should_skip_class_due_to_plugin(clazz)) {
+    // There is nothing left to emit.
+    return true;
+  }
+  MethodRefs clazz_mrefs;
+  FieldRefs clazz_frefs;
+  TypeRefs clazz_trefs;
+  gather_refs(m_plugins, &m_class_refs, dex_info, clazz, &clazz_mrefs,
+              &clazz_frefs, &clazz_trefs, /* erased_classes */ nullptr,
+              should_not_relocate_methods_of_class(clazz));
+  return m_dexes_structure.add_class_to_current_dex(clazz_mrefs, clazz_frefs,
+                                                    clazz_trefs, clazz);
+}
+
 void InterDex::cleanup(const Scope& final_scope) {
   if (m_cross_dex_relocator != nullptr) {
     m_cross_dex_relocator->cleanup(final_scope);
@@ -859,8 +927,8 @@ void InterDex::run_in_force_single_dex_mode() {
     TypeRefs clazz_trefs;
     std::vector<DexClass*> erased_classes;
 
-    gather_refs(m_plugins, dex_info, cls, &clazz_mrefs, &clazz_frefs,
-                &clazz_trefs, &erased_classes,
+    gather_refs(m_plugins, &m_class_refs, dex_info, cls, &clazz_mrefs,
+                &clazz_frefs, &clazz_trefs, &erased_classes,
                 should_not_relocate_methods_of_class(cls));
 
     m_dexes_structure.add_class_no_checks(clazz_mrefs, clazz_frefs, clazz_trefs,
@@ -879,6 +947,8 @@ void InterDex::run_in_force_single_dex_mode() {
 
 void InterDex::run() {
   TRACE(IDEX, 2, "IDEX: Running on root store");
+  // Every class gets emitted, so its refs will be needed.
+  m_class_refs.prefetch(m_scope);
   if (m_force_single_dex) {
     run_in_force_single_dex_mode();
     return;
@@ -954,6 +1024,7 @@ void InterDex::run() {
 
 void InterDex::run_on_nonroot_store() {
   TRACE(IDEX, 2, "IDEX: Running on non-root store");
+  m_class_refs.prefetch(m_scope);
   for (DexClass* cls : m_scope) {
     emit_class(EMPTY_DEX_INFO, cls, /* check_if_skip */ false,
                /* perf_sensitive */ false);
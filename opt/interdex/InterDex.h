@@ -7,9 +7,11 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <unordered_set>
 
 #include "AssetManager.h"
+#include "ClassRefs.h"
 #include "CrossDexRefMinimizer.h"
 #include "CrossDexRelocator.h"
 #include "DexClass.h"
@@ -23,6 +25,9 @@ namespace interdex {
 
 bool is_canary(DexClass* clazz);
 
+// The ordinal of the dex of the root store that each class was emitted into.
+using DexAssignment = std::unordered_map<const DexType*, size_t>;
+
 class InterDex {
  public:
   InterDex(const Scope& original_scope,
@@ -45,7 +50,8 @@ class InterDex {
            size_t reserve_mrefs,
            const XStoreRefs* xstore_refs,
            int min_sdk,
-           bool sort_remaining_classes)
+           bool sort_remaining_classes,
+           const DexAssignment* previous_assignment)
       : m_dexen(dexen),
         m_asset_manager(asset_manager),
         m_conf(conf),
@@ -60,12 +66,13 @@ class InterDex {
         m_emitting_bg_set(false),
         m_emitted_bg_set(false),
         m_emitting_extended(false),
-        m_cross_dex_ref_minimizer(cross_dex_refs_config),
+        m_cross_dex_ref_minimizer(cross_dex_refs_config, &m_class_refs),
         m_cross_dex_relocator_config(cross_dex_relocator_config),
         m_original_scope(original_scope),
         m_scope(build_class_scope(m_dexen)),
         m_xstore_refs(xstore_refs),
-        m_sort_remaining_classes(sort_remaining_classes) {
+        m_sort_remaining_classes(sort_remaining_classes),
+        m_previous_assignment(previous_assignment) {
     m_dexes_structure.set_linear_alloc_limit(linear_alloc_limit);
     m_dexes_structure.set_reserve_frefs(reserve_frefs);
     m_dexes_structure.set_reserve_trefs(reserve_trefs);
@@ -117,6 +124,10 @@ class InterDex {
     return m_current_classes_when_emitting_remaining;
   }
 
+  size_t get_classes_not_in_previous_assignment() const {
+    return m_classes_not_in_previous_assignment;
+  }
+
  private:
   void run_in_force_single_dex_mode();
   bool should_not_relocate_methods_of_class(const DexClass* clazz);
@@ -137,6 +148,15 @@ class InterDex {
       const std::unordered_set<DexClass*>& unreferenced_classes);
   void init_cross_dex_ref_minimizer_and_relocate_methods();
   void emit_remaining_classes(DexInfo& dex_info);
+
+  /**
+   * Emits the remaining classes into the dexes they were in according to the
+   * previous assignment, so that the dexes whose classes didn't change come
+   * out the same. The classes that weren't assigned are added to the first
+   * dexes that still have room for them, and after the last dex otherwise.
+   */
+  void emit_remaining_classes_as_previously_assigned(DexInfo& dex_info);
+  bool emit_class_if_fits(DexInfo& dex_info, DexClass* clazz);
   void flush_out_dex(DexInfo& dex_info);
 
   /**
@@ -178,6 +198,9 @@ class InterDex {
   std::vector<DexType*> m_end_markers;
   std::vector<DexType*> m_scroll_markers;
 
+  // The refs of the classes to emit, shared by the dex structure checks and
+  // the cross-dex-ref minimizer.
+  class_refs::Cache m_class_refs;
   cross_dex_ref_minimizer::CrossDexRefMinimizer m_cross_dex_ref_minimizer;
   const CrossDexRelocatorConfig m_cross_dex_relocator_config;
   const Scope& m_original_scope;
@@ -187,6 +210,8 @@ class InterDex {
   const XStoreRefs* m_xstore_refs;
   bool m_sort_remaining_classes;
   size_t m_current_classes_when_emitting_remaining{0};
+  const DexAssignment* m_previous_assignment;
+  size_t m_classes_not_in_previous_assignment{0};
 };
 
 } // namespace interdex
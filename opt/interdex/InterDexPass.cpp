@@ -7,6 +7,9 @@
 
 #include "InterDexPass.h"
 
+#include <fstream>
+#include <sstream>
+
 #include "ConfigFiles.h"
 #include "DexClass.h"
 #include "DexUtil.h"
@@ -33,6 +36,38 @@ void treat_generated_stores(DexStoresVector& stores,
   });
 }
 
+interdex::DexAssignment read_dex_assignment(const std::string& path) {
+  std::ifstream input(path);
+  always_assert_log(input, "Can't open previous dex assignment %s",
+                    path.c_str());
+  interdex::DexAssignment assignment;
+  std::string line;
+  while (std::getline(input, line)) {
+    std::istringstream fields(line);
+    size_t dexnum;
+    std::string name;
+    if (!(fields >> dexnum >> name)) {
+      continue;
+    }
+    // The classes that are gone don't matter.
+    auto type = DexType::get_type(name);
+    if (type != nullptr) {
+      assignment.emplace(type, dexnum);
+    }
+  }
+  return assignment;
+}
+
+void write_dex_assignment(const std::string& path,
+                          const DexClassesVector& dexen) {
+  std::ofstream ofs(path);
+  for (size_t dexnum = 0; dexnum < dexen.size(); ++dexnum) {
+    for (const auto* cls : dexen[dexnum]) {
+      ofs << dexnum << " " << show(cls) << "\n";
+    }
+  }
+}
+
 } // namespace
 
 namespace interdex {
@@ -105,6 +140,11 @@ void InterDexPass::bind_config() {
   bind("sort_remaining_classes", false, m_sort_remaining_classes,
        "Whether to sort classes in non-primary, non-perf-sensitive dexes "
        "according to their inheritance hierarchies");
+  bind("previous_assignment", "", m_previous_assignment,
+       "Path to the interdex-assignment.txt of a previous build. The classes "
+       "that aren't ordered by the betamap are then emitted into the dexes "
+       "they were in, so that the dexes whose classes didn't change come out "
+       "the same, and the new classes fill up the dexes that have room left");
 
   trait(Traits::Pass::unique, true);
 }
@@ -123,13 +163,19 @@ void InterDexPass::run_pass(
   mgr.set_metric(METRIC_RESERVED_MREFS, refs_info.mrefs);
 
   bool force_single_dex = conf.get_json_config().get("force_single_dex", false);
+  std::unique_ptr<DexAssignment> previous_assignment;
+  if (!m_previous_assignment.empty()) {
+    previous_assignment = std::make_unique<DexAssignment>(
+        read_dex_assignment(m_previous_assignment));
+  }
   InterDex interdex(original_scope, dexen, mgr.asset_manager(), conf, plugins,
                     m_linear_alloc_limit, m_static_prune, m_normal_primary_dex,
                     m_keep_primary_order, force_single_dex, m_emit_canaries,
                     m_minimize_cross_dex_refs, m_minimize_cross_dex_refs_config,
                     m_cross_dex_relocator_config, refs_info.frefs,
                     refs_info.trefs, refs_info.mrefs, &xstore_refs,
-                    mgr.get_redex_options().min_sdk, m_sort_remaining_classes);
+                    mgr.get_redex_options().min_sdk, m_sort_remaining_classes,
+                    previous_assignment.get());
 
   if (m_expect_order_list) {
     always_assert_log(
@@ -140,6 +186,7 @@ void InterDexPass::run_pass(
   interdex.run();
   treat_generated_stores(stores, &interdex);
   dexen = interdex.take_outdex();
+  write_dex_assignment(conf.metafile(DEX_ASSIGNMENT_FILENAME), dexen);
 
   auto final_scope = build_class_scope(stores);
   interdex.cleanup(final_scope);
@@ -186,6 +233,8 @@ void InterDexPass::run_pass(
 
   mgr.set_metric(METRIC_CURRENT_CLASSES_WHEN_EMITTING_REMAINING,
                  interdex.get_current_classes_when_emitting_remaining());
+  mgr.set_metric(METRIC_CLASSES_NOT_IN_PREVIOUS_ASSIGNMENT,
+                 interdex.get_classes_not_in_previous_assignment());
 }
 
 void InterDexPass::run_pass_on_nonroot_store(const Scope& original_scope,
@@ -212,7 +261,8 @@ void InterDexPass::run_pass_on_nonroot_store(const Scope& original_scope,
                     false /* minimize_cross_dex_refs */, cross_dex_refs_config,
                     cross_dex_relocator_config, refs_info.frefs,
                     refs_info.trefs, refs_info.mrefs, &xstore_refs,
-                    mgr.get_redex_options().min_sdk, m_sort_remaining_classes);
+                    mgr.get_redex_options().min_sdk, m_sort_remaining_classes,
+                    /* previous_assignment */ nullptr);
 
   interdex.run_on_nonroot_store();
 
@@ -17,6 +17,9 @@ namespace interdex {
 
 constexpr const char* INTERDEX_PASS_NAME = "InterDexPass";
 constexpr const char* INTERDEX_PLUGIN = "InterDexPlugin";
+// The dex of the root store that each class is emitted into, one
+// "<dex ordinal> <class>" line per class.
+constexpr const char* DEX_ASSIGNMENT_FILENAME = "interdex-assignment.txt";
 constexpr const char* METRIC_COLD_START_SET_DEX_COUNT =
     "cold_start_set_dex_count";
 constexpr const char* METRIC_SCROLL_SET_DEX_COUNT = "scroll_set_dex_count";
@@ -43,6 +46,8 @@ constexpr const char* METRIC_RELOCATED_VIRTUAL_METHODS =
     "num_relocated_virtual_methods";
 constexpr const char* METRIC_CURRENT_CLASSES_WHEN_EMITTING_REMAINING =
     "num_current_classes_when_emitting_remaining";
+constexpr const char* METRIC_CLASSES_NOT_IN_PREVIOUS_ASSIGNMENT =
+    "num_classes_not_in_previous_assignment";
 
 constexpr const char* METRIC_RESERVED_FREFS = "reserved_frefs";
 constexpr const char* METRIC_RESERVED_TREFS = "reserved_trefs";
@@ -95,6 +100,7 @@ class InterDexPass : public Pass {
   CrossDexRelocatorConfig m_cross_dex_relocator_config;
   bool m_expect_order_list;
   bool m_sort_remaining_classes;
+  std::string m_previous_assignment;
 
   size_t m_run{0}; // Which iteration of `run_pass`.
   size_t m_eval{0}; // How many `eval_pass` iterations.
@@ -12,10 +12,15 @@
 #include "LocalPointersAnalysis.h"
 #include "PassManager.h"
 #include "ScopedCFG.h"
+#include "Show.h"
 #include "SideEffectSummary.h"
 #include "SummarySerialization.h"
 
 namespace {
+
+constexpr const char* METRIC_LAMBDA_ALLOCATIONS_REMOVED =
+    "kotlin_lambda_allocations_removed::";
+
 bool check_inits_has_side_effects(
     IRCode* code, const std::unordered_set<DexMethodRef*>& safe_base_invoke) {
   cfg::ScopedCFG cfg(code);
@@ -102,6 +107,25 @@ void RewriteKotlinSingletonInstance::run_pass(DexStoresVector& stores,
       scope, concurrentLambdaMap, do_not_consider_type);
   stats += rewriter.remove_escaping_instance(scope, concurrentLambdaMap);
   stats += rewriter.transform(concurrentLambdaMap);
+
+  if (m_share_lambda_instances) {
+    // The single uses of INSTANCE that were just turned into allocations are
+    // meant to be inlined away by later passes, so they are kept.
+    std::unordered_set<const DexType*> single_use_types;
+    for (const auto& p : concurrentLambdaMap) {
+      if (p.second.size() == 1) {
+        single_use_types.insert(p.first->get_class());
+      }
+    }
+    std::map<const DexType*, size_t, dextypes_comparator> removed_allocations;
+    stats += rewriter.share_lambda_instances(
+        scope, do_not_consider_type, single_use_types, &removed_allocations);
+    for (const auto& p : removed_allocations) {
+      mgr.incr_metric(std::string(METRIC_LAMBDA_ALLOCATIONS_REMOVED) +
+                          SHOW(p.first),
+                      p.second);
+    }
+  }
   stats.report(mgr);
 }
 
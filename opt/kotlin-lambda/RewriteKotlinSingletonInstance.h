@@ -33,10 +33,24 @@
 // Here the object stored in INSTANCE is not semantically relevant and can be
 // moved.
 //
+// With `share_lambda_instances`, the pass also goes the other way for the
+// noncapturing Lambdas that are allocated at their call sites: the
+// allocations get replaced with reads of an INSTANCE field, which gets created
+// if needed, so that they stop allocating. The eliminated allocations are
+// reported per Lambda in the metrics.
+//
 class RewriteKotlinSingletonInstance : public Pass {
 
  public:
   RewriteKotlinSingletonInstance()
       : Pass("RewriteKotlinSingletonInstancePass") {}
+
+  void bind_config() override {
+    bind("share_lambda_instances", false, m_share_lambda_instances);
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  bool m_share_lambda_instances{false};
 };
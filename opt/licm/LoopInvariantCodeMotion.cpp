@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "LoopInvariantCodeMotion.h"
+
+#include <unordered_map>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Liveness.h"
+#include "LoopInfo.h"
+#include "MethodUtil.h"
+#include "PassManager.h"
+#include "Purity.h"
+#include "Resolver.h"
+#include "ScopedCFG.h"
+#include "Show.h"
+#include "SourceBlocks.h"
+#include "Trace.h"
+#include "TypeUtil.h"
+#include "Walkers.h"
+
+namespace licm {
+
+namespace {
+
+bool is_cold(const cfg::Block* block, float threshold) {
+  bool has_vals = false;
+  bool hot = false;
+  source_blocks::foreach_source_block(block, [&](const auto* sb) {
+    for (size_t i = 0; i < sb->vals.size(); ++i) {
+      auto val = sb->get_val(i);
+      if (!val) {
+        continue;
+      }
+      has_vals = true;
+      if (*val > threshold) {
+        hot = true;
+      }
+    }
+  });
+  return has_vals && !hot;
+}
+
+enum class Placement {
+  // Not invariant, whatever its inputs.
+  NONE,
+  // Can't throw nor write anything, so it can be executed when the loop
+  // wouldn't have executed it.
+  ANYWHERE,
+  // May throw, so it can only be executed early if it would have been executed
+  // first thing in the loop anyway.
+  HEADER_ONLY,
+};
+
+// Whether the instruction neither throws nor writes anything but its
+// destination.
+bool is_side_effect_free(IROpcode op) {
+  if (opcode::is_a_literal_const(op) || opcode::is_a_move(op) ||
+      opcode::is_move_result_any(op) || opcode::is_a_cmp(op)) {
+    return true;
+  }
+  // The unary and binary arithmetic operations.
+  return op >= OPCODE_NEG_INT && op <= OPCODE_USHR_INT_LIT8 &&
+         !opcode::may_throw(op);
+}
+
+Placement get_placement(const std::unordered_set<DexMethodRef*>& pure_methods,
+                        const DexMethod* method,
+                        const IRInstruction* insn) {
+  auto op = insn->opcode();
+  if (opcode::is_move_result_any(op)) {
+    return Placement::NONE;
+  }
+  if (is_side_effect_free(op)) {
+    return Placement::ANYWHERE;
+  }
+  switch (op) {
+  case OPCODE_CONST_STRING:
+    // Only throws when running out of memory.
+    return Placement::ANYWHERE;
+  case OPCODE_ARRAY_LENGTH:
+  case OPCODE_DIV_INT:
+  case OPCODE_REM_INT:
+  case OPCODE_DIV_LONG:
+  case OPCODE_REM_LONG:
+  case OPCODE_DIV_INT_LIT16:
+  case OPCODE_REM_INT_LIT16:
+  case OPCODE_DIV_INT_LIT8:
+  case OPCODE_REM_INT_LIT8:
+    return Placement::HEADER_ONLY;
+  case OPCODE_INVOKE_STATIC:
+  case OPCODE_INVOKE_DIRECT:
+  case OPCODE_INVOKE_VIRTUAL:
+  case OPCODE_INVOKE_INTERFACE: {
+    // Hoisting an invoke returning an object would share the object between
+    // the iterations.
+    auto callee = insn->get_method();
+    if (!pure_methods.count(callee) ||
+        !type::is_primitive(callee->get_proto()->get_rtype()) ||
+        type::is_void(callee->get_proto()->get_rtype())) {
+      return Placement::NONE;
+    }
+    return Placement::HEADER_ONLY;
+  }
+  default:
+    break;
+  }
+  if (opcode::is_an_sget(op)) {
+    auto field = resolve_field(insn->get_field(), FieldSearch::Static);
+    if (!field || !is_final(field)) {
+      return Placement::NONE;
+    }
+    // The final fields of the method's class are initialized by the time the
+    // method runs, so reading them doesn't trigger the initialization.
+    if (field->get_class() == method->get_class() &&
+        !method::is_clinit(method)) {
+      return Placement::ANYWHERE;
+    }
+    return Placement::HEADER_ONLY;
+  }
+  return Placement::NONE;
+}
+
+// The instruction, followed by its move-result(-pseudo) if any.
+std::vector<IRInstruction*> get_insns(cfg::ControlFlowGraph& cfg,
+                                      const cfg::InstructionIterator& it) {
+  std::vector<IRInstruction*> insns{it->insn};
+  if (it->insn->has_move_result_any()) {
+    auto move_result_it = cfg.move_result_of(it);
+    if (!move_result_it.is_end()) {
+      insns.push_back(move_result_it->insn);
+    }
+  }
+  return insns;
+}
+
+void add_defs(const IRInstruction* insn,
+              int delta,
+              std::unordered_map<reg_t, int>* defs) {
+  if (!insn->has_dest()) {
+    return;
+  }
+  (*defs)[insn->dest()] += delta;
+  if (insn->dest_is_wide()) {
+    (*defs)[insn->dest() + 1] += delta;
+  }
+}
+
+bool throws_to_handler(const cfg::Block* block) {
+  for (auto* e : block->succs()) {
+    if (e->type() == cfg::EDGE_THROW) {
+      return true;
+    }
+  }
+  return false;
+}
+
+class LoopHoister {
+ public:
+  LoopHoister(const Config& config,
+              const std::unordered_set<DexMethodRef*>& pure_methods,
+              const DexMethod* method,
+              cfg::ControlFlowGraph& cfg,
+              const LivenessFixpointIterator& liveness,
+              const std::unordered_set<reg_t>& wide_srcs)
+      : m_config(config),
+        m_pure_methods(pure_methods),
+        m_method(method),
+        m_cfg(cfg),
+        m_liveness(liveness),
+        m_wide_srcs(wide_srcs) {}
+
+  // Returns the number of instructions hoisted out of the loop, whose blocks,
+  // including the preheaders of its inner loops, are `region`.
+  size_t hoist(loop_impl::Loop* loop,
+               const std::vector<cfg::Block*>& region) {
+    auto* header = loop->get_header();
+    auto* preheader = loop->get_preheader();
+    m_live_ins = m_liveness.get_live_in_vars_at(header);
+    m_defs.clear();
+    for (auto* block : region) {
+      for (auto& mie : InstructionIterable(block)) {
+        add_defs(mie.insn, 1, &m_defs);
+      }
+    }
+
+    size_t hoisted = 0;
+    bool changed = true;
+    while (changed && hoisted < m_config.max_hoisted_insns_per_loop) {
+      changed = false;
+      std::vector<cfg::InstructionIterator> to_remove;
+      for (auto* block : region) {
+        // Whether everything before the current instruction in the header has
+        // been hoisted or has no effect.
+        bool clean_prefix = block == header && !throws_to_handler(header);
+        auto ii = InstructionIterable(block);
+        for (auto it = ii.begin(); it != ii.end(); ++it) {
+          if (hoisted == m_config.max_hoisted_insns_per_loop) {
+            break;
+          }
+          auto* insn = it->insn;
+          auto placement = get_placement(m_pure_methods, m_method, insn);
+          bool can_hoist =
+              placement == Placement::ANYWHERE ||
+              (placement == Placement::HEADER_ONLY && clean_prefix);
+          auto cfg_it = block->to_cfg_instruction_iterator(it);
+          std::vector<IRInstruction*> insns;
+          if (can_hoist) {
+            insns = get_insns(m_cfg, cfg_it);
+            can_hoist = is_invariant(insns);
+          }
+          if (!can_hoist) {
+            clean_prefix &= opcode::is_move_result_any(insn->opcode()) ||
+                            is_side_effect_free(insn->opcode());
+            continue;
+          }
+          std::vector<IRInstruction*> copies;
+          for (auto* orig : insns) {
+            add_defs(orig, -1, &m_defs);
+            copies.push_back(new IRInstruction(*orig));
+          }
+          TRACE(LICM, 5, "Hoisting %s out of the loop at B%zu of %s",
+                SHOW(insn), header->id(), SHOW(m_method));
+          m_cfg.push_back(preheader, copies);
+          to_remove.push_back(cfg_it);
+          hoisted++;
+          changed = true;
+        }
+      }
+      for (auto& it : to_remove) {
+        m_cfg.remove_insn(it);
+      }
+    }
+    return hoisted;
+  }
+
+ private:
+  // Whether the instruction computes the same value in every iteration, and
+  // whether its destination can hold that value throughout the loop.
+  bool is_invariant(const std::vector<IRInstruction*>& insns) const {
+    auto* insn = insns.front();
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      auto src = insn->src(i);
+      if (def_count(src) != 0 ||
+          (insn->src_is_wide(i) && def_count(src + 1) != 0)) {
+        return false;
+      }
+    }
+    auto* def = insns.back();
+    if (!def->has_dest()) {
+      return false;
+    }
+    auto dest = def->dest();
+    if (!can_clobber(dest)) {
+      return false;
+    }
+    if (def->dest_is_wide() && !can_clobber(dest + 1)) {
+      return false;
+    }
+    // The liveness only tracks the first register of a wide pair, so writing
+    // the second register of a live pair needs to be caught here.
+    return dest == 0 || !m_wide_srcs.count(dest - 1) ||
+           !m_live_ins.contains(dest - 1);
+  }
+
+  bool can_clobber(reg_t reg) const {
+    return def_count(reg) == 1 && !m_live_ins.contains(reg);
+  }
+
+  int def_count(reg_t reg) const {
+    auto it = m_defs.find(reg);
+    return it == m_defs.end() ? 0 : it->second;
+  }
+
+  const Config& m_config;
+  const std::unordered_set<DexMethodRef*>& m_pure_methods;
+  const DexMethod* m_method;
+  cfg::ControlFlowGraph& m_cfg;
+  const LivenessFixpointIterator& m_liveness;
+  const std::unordered_set<reg_t>& m_wide_srcs;
+  LivenessDomain m_live_ins;
+  std::unordered_map<reg_t, int> m_defs;
+};
+
+} // namespace
+
+Stats& Stats::operator+=(const Stats& that) {
+  loops += that.loops;
+  cold_loops += that.cold_loops;
+  hoisted_insns += that.hoisted_insns;
+  methods_changed += that.methods_changed;
+  return *this;
+}
+
+Stats hoist_invariants(const Config& config,
+                       const std::unordered_set<DexMethodRef*>& pure_methods,
+                       DexMethod* method) {
+  Stats stats;
+  auto code = method->get_code();
+  if (!code || method->rstate.no_optimizations()) {
+    return stats;
+  }
+  cfg::ScopedCFG scoped_cfg(code);
+  auto& cfg = *scoped_cfg;
+  {
+    // Building the loops on the editable CFG adds the preheaders. When a loop
+    // is entered by an exception its preheader can't hold any code, so we
+    // check for those loops first, without touching the CFG.
+    const auto& const_cfg = cfg;
+    loop_impl::LoopInfo loops(const_cfg);
+    if (loops.num_loops() == 0) {
+      return stats;
+    }
+    for (auto* loop : loops) {
+      for (auto* e : loop->get_header()->preds()) {
+        if (e->type() == cfg::EDGE_THROW) {
+          return stats;
+        }
+      }
+    }
+  }
+
+  loop_impl::LoopInfo loops(cfg);
+  LivenessFixpointIterator liveness(cfg);
+  liveness.run(LivenessDomain());
+  std::unordered_set<reg_t> wide_srcs;
+  for (auto& mie : InstructionIterable(cfg)) {
+    for (size_t i = 0; i < mie.insn->srcs_size(); ++i) {
+      if (mie.insn->src_is_wide(i)) {
+        wide_srcs.insert(mie.insn->src(i));
+      }
+    }
+  }
+
+  LoopHoister hoister(config, pure_methods, method, cfg, liveness, wide_srcs);
+  // Inner loops first, so that what they hoist can be hoisted further out.
+  for (auto it = loops.rbegin(); it != loops.rend(); ++it) {
+    auto* loop = *it;
+    stats.loops++;
+    if (is_cold(loop->get_header(), config.cold_loop_hits)) {
+      stats.cold_loops++;
+      continue;
+    }
+    auto region = loop->get_blocks();
+    for (auto* inner : loops) {
+      if (inner != loop && loop->contains(inner->get_header())) {
+        region.push_back(inner->get_preheader());
+      }
+    }
+    stats.hoisted_insns += hoister.hoist(loop, region);
+  }
+  // Drop the preheaders that ended up with nothing in them, so that the loops
+  // we couldn't hoist anything out of are left as they were.
+  std::vector<std::pair<cfg::Block*, cfg::Block*>> unused_preheaders;
+  for (auto* loop : loops) {
+    auto* preheader = loop->get_preheader();
+    if (preheader->num_opcodes() == 0) {
+      unused_preheaders.emplace_back(preheader, loop->get_header());
+    }
+  }
+  if (!unused_preheaders.empty()) {
+    cfg.replace_blocks(unused_preheaders);
+  }
+  if (stats.hoisted_insns > 0) {
+    stats.methods_changed = 1;
+  }
+  return stats;
+}
+
+} // namespace licm
+
+void LoopInvariantCodeMotionPass::bind_config() {
+  bind("cold_loop_hits", m_config.cold_loop_hits, m_config.cold_loop_hits,
+       "Maximum source block value of a loop header for the loop to be cold, "
+       "and left alone");
+  bind("max_hoisted_insns_per_loop", m_config.max_hoisted_insns_per_loop,
+       m_config.max_hoisted_insns_per_loop,
+       "Maximum number of instructions hoisted out of a single loop");
+}
+
+void LoopInvariantCodeMotionPass::run_pass(DexStoresVector& stores,
+                                           ConfigFiles& /* conf */,
+                                           PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto pure_methods = get_pure_methods();
+  auto stats =
+      walk::parallel::methods<licm::Stats>(scope, [&](DexMethod* method) {
+        return licm::hoist_invariants(m_config, pure_methods, method);
+      });
+
+  mgr.set_metric("loops", stats.loops);
+  mgr.set_metric("cold_loops", stats.cold_loops);
+  mgr.set_metric("hoisted_insns", stats.hoisted_insns);
+  mgr.set_metric("methods_changed", stats.methods_changed);
+}
+
+static LoopInvariantCodeMotionPass s_pass;
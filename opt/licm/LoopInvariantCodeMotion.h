@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_set>
+
+#include "Pass.h"
+
+class DexMethod;
+class DexMethodRef;
+
+namespace licm {
+
+struct Config {
+  // A loop is cold, and left alone, if its header has source blocks and none
+  // of them has a value above this in any interaction.
+  float cold_loop_hits{0};
+  // Each hoisted value is live throughout its loop, so we bound how many get
+  // hoisted out of a single loop.
+  uint32_t max_hoisted_insns_per_loop{16};
+};
+
+struct Stats {
+  size_t loops{0};
+  size_t cold_loops{0};
+  size_t hoisted_insns{0};
+  size_t methods_changed{0};
+
+  Stats& operator+=(const Stats& that);
+};
+
+/*
+ * Hoists the invariant computations out of the loops of `method`, and into
+ * their preheaders. It is safe to call concurrently for different methods.
+ */
+Stats hoist_invariants(const Config& config,
+                       const std::unordered_set<DexMethodRef*>& pure_methods,
+                       DexMethod* method);
+
+} // namespace licm
+
+/*
+ * Loop-invariant code motion: moves the computations whose inputs don't
+ * change within a loop to the loop's preheader, so they are done once per
+ * loop rather than once per iteration. This mostly helps the code that runs
+ * interpreted or in a cold JIT state, since ART's optimizing compiler does
+ * the same for hot code.
+ *
+ * An instruction can be hoisted when the registers it reads are not written
+ * in the loop, when it is the only write to its destination in the loop, and
+ * when the value of its destination before the loop is not read in or after
+ * the loop. Constants, const-strings, arithmetic that can't throw and reads of
+ * the final static fields of the method's own class are hoisted from anywhere
+ * in the loop. The instructions that may throw, like array-length, sgets of
+ * other classes (which may initialize them) and invokes of pure methods, are
+ * only hoisted from the loop header, and only if nothing before them in the
+ * header may throw or have side effects, so that they would have been
+ * executed first anyway.
+ */
+class LoopInvariantCodeMotionPass : public Pass {
+ public:
+  LoopInvariantCodeMotionPass() : Pass("LoopInvariantCodeMotionPass") {}
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  licm::Config m_config;
+};
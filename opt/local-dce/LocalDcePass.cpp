@@ -58,15 +58,27 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
                       configured_pure_methods.end());
   auto immutable_getters = get_immutable_getters(scope);
   pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
-  std::unique_ptr<const method_override_graph::Graph> override_graph;
+  std::shared_ptr<const method_override_graph::Graph> override_graph;
   std::unordered_set<const DexMethod*> computed_no_side_effects_methods;
   size_t computed_no_side_effects_methods_iterations = 0;
   if (!mgr.unreliable_virtual_scopes()) {
-    override_graph = method_override_graph::build_graph(scope);
-    computed_no_side_effects_methods_iterations =
-        compute_no_side_effects_methods(scope, override_graph.get(),
-                                        pure_methods,
-                                        &computed_no_side_effects_methods);
+    auto purity_analysis = mgr.get_preserved_analysis<PurityAnalysisPass>();
+    auto purity_cache =
+        purity_analysis ? purity_analysis->get_result() : nullptr;
+    if (purity_cache) {
+      override_graph = purity_cache->get_method_override_graph(scope);
+      computed_no_side_effects_methods =
+          purity_cache->get_no_side_effects_methods(
+              scope, override_graph.get(), pure_methods,
+              &computed_no_side_effects_methods_iterations);
+    } else {
+      override_graph =
+          MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
+      computed_no_side_effects_methods_iterations =
+          compute_no_side_effects_methods(scope, override_graph.get(),
+                                          pure_methods,
+                                          &computed_no_side_effects_methods);
+    }
     for (auto m : computed_no_side_effects_methods) {
       pure_methods.insert(const_cast<DexMethod*>(m));
     }
@@ -83,15 +95,16 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
     });
   }
 
-  auto stats =
-      walk::parallel::methods<LocalDce::Stats>(scope, [&](DexMethod* m) {
+  auto pure_method_ids = LocalDce::make_pure_method_ids(pure_methods);
+  auto stats = walk::parallel::methods_by_cost<LocalDce::Stats>(
+      scope, [&](DexMethod* m) {
         auto* code = m->get_code();
         if (code == nullptr || m->rstate.no_optimizations()) {
           return LocalDce::Stats();
         }
 
         LocalDce ldce(pure_methods, override_graph.get(),
-                      may_allocate_registers);
+                      may_allocate_registers, &pure_method_ids);
         ldce.dce(code);
         return ldce.get_stats();
       });
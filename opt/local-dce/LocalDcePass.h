@@ -7,12 +7,23 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
 #include "LocalDce.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
+#include "PurityAnalysisPass.h"
 
 class LocalDcePass : public Pass {
  public:
   LocalDcePass() : Pass("LocalDcePass") {}
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // Removing dead code doesn't add any side effects.
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+    au.add_preserve_specific<PurityAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  uint8_t writes() const override { return CODE; }
 };
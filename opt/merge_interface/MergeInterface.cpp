@@ -14,6 +14,7 @@
 #include "DexUtil.h"
 #include "IROpcode.h"
 #include "PassManager.h"
+#include "RefRewriter.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "Trace.h"
@@ -442,72 +443,41 @@ std::unordered_map<const DexType*, DexType*> merge_interfaces(
   return intf_merge_map;
 }
 
-void update_reference_for_code(
-    const Scope& scope,
+/**
+ * Method refs that call a method of a super interface through a merged
+ * interface need to refer to the target interface instead. For example if we
+ * have a mergeable interface A, it's super interface B has a method
+ * do_something(), the code could invoke this method through A.do_something().
+ * When merge interface A into another interface (let's say C), we need to
+ * change this MethodRef to C.do_something().
+ * TODO(suree404): if C has a super interface D that also have function named
+ * do_something, rename one of the do_something if they have code, ignore for
+ * abstract (no code) cases.
+ */
+void update_super_interface_method_ref(
     const std::unordered_map<const DexType*, DexType*>& intf_merge_map,
-    const std::unordered_map<DexMethodRef*, DexMethodRef*>& old_to_new_method) {
-  auto patcher = [&old_to_new_method, &intf_merge_map](DexMethod*,
-                                                       IRCode& code) {
-    auto ii = InstructionIterable(code);
-    for (auto it = ii.begin(); it != ii.end(); ++it) {
-      IRInstruction* insn = it->insn;
-      // Change method refs of merged interface method to corresponding method
-      // in target interface.
-      if (insn->has_method()) {
-        DexMethodRef* meth_ref = insn->get_method();
-        if (meth_ref == nullptr) {
-          continue;
-        }
-        auto find_existed = old_to_new_method.find(meth_ref);
-        if (find_existed != old_to_new_method.end()) {
-          DexMethodRef* new_method_ref = find_existed->second;
-          insn->set_method(new_method_ref);
-        } else {
-          // Handle method ref calling method in super interfaces.
-          // For example if we have a mergeable interface A, it's super
-          // interface B has a method do_something(), the code could
-          // invoke this method through A.do_something(). When merge interface
-          // A into another interface (let's say C), we need to change this
-          // MethodRef to C.do_something().
-          // TODO(suree404): if C has a super interface D that also have
-          // function named do_something, rename one of the do_something if
-          // they have code, ignore for abstract (no code) cases.
-          auto find_method_class = intf_merge_map.find(meth_ref->get_class());
-          if (find_method_class == intf_merge_map.end()) {
-            continue;
-          }
-          DexType* target_type = find_method_class->second;
-          DexMethodRef* methodref_in_context = DexMethod::get_method(
-              target_type, meth_ref->get_name(), meth_ref->get_proto());
-          if (methodref_in_context != nullptr) {
-            insn->set_method(methodref_in_context);
-          } else {
-            DexMethodSpec spec;
-            spec.cls = target_type;
-            meth_ref->change(spec, false /* rename on collision */);
-          }
-        }
-        continue;
-      }
-      // Update simple type refs
-      if (!insn->has_type() || insn->get_type() == nullptr) {
-        continue;
-      }
-      DexType* ref_type = insn->get_type();
-      const DexType* type = type::get_element_type_if_array(ref_type);
-      if (intf_merge_map.count(type) == 0) {
-        continue;
-      }
-      always_assert(type_class(type));
-      DexType* merger_type = intf_merge_map.at(type);
-      if (type::is_array(ref_type)) {
-        insn->set_type(type::make_array_type(merger_type));
-      } else {
-        insn->set_type(merger_type);
-      }
-    }
-  };
-  walk::parallel::code(scope, patcher);
+    IRInstruction* insn) {
+  if (!insn->has_method()) {
+    return;
+  }
+  DexMethodRef* meth_ref = insn->get_method();
+  if (meth_ref == nullptr) {
+    return;
+  }
+  auto find_method_class = intf_merge_map.find(meth_ref->get_class());
+  if (find_method_class == intf_merge_map.end()) {
+    return;
+  }
+  DexType* target_type = find_method_class->second;
+  DexMethodRef* methodref_in_context = DexMethod::get_method(
+      target_type, meth_ref->get_name(), meth_ref->get_proto());
+  if (methodref_in_context != nullptr) {
+    insn->set_method(methodref_in_context);
+  } else {
+    DexMethodSpec spec;
+    spec.cls = target_type;
+    meth_ref->change(spec, false /* rename on collision */);
+  }
 }
 
 void remove_implements(
@@ -559,10 +529,18 @@ void update_after_merge(
     const std::unordered_map<const DexType*, DexType*>& intf_merge_map,
     const std::unordered_map<DexMethodRef*, DexMethodRef*>& old_to_new_method,
     const ClassHierarchy& ch) {
-  type_reference::update_method_signature_type_references(scope, intf_merge_map,
-                                                          ch);
-  type_reference::update_field_type_references(scope, intf_merge_map);
-  update_reference_for_code(scope, intf_merge_map, old_to_new_method);
+  // Update the signatures and field types, and then, in one walk, the code:
+  // the method refs of merged interface methods go to the corresponding
+  // methods of the target interface, and type refs to the target interface.
+  ref_rewriter::RefMaps maps;
+  maps.types = intf_merge_map;
+  maps.methods = old_to_new_method;
+  ref_rewriter::Options options;
+  options.signatures_hierarchy = &ch;
+  options.insn_hook = [&intf_merge_map](DexMethod*, IRInstruction* insn) {
+    update_super_interface_method_ref(intf_merge_map, insn);
+  };
+  ref_rewriter::rewrite_refs(scope, maps, options);
   remove_implements(scope, intf_merge_map);
 }
 
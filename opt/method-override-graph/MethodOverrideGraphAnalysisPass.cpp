@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodOverrideGraphAnalysisPass.h"
+
+#include "DexUtil.h"
+#include "PassManager.h"
+#include "Trace.h"
+
+void MethodOverrideGraphAnalysisPass::run_pass(DexStoresVector& stores,
+                                               ConfigFiles&,
+                                               PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  m_result = method_override_graph::build_mutable_graph(scope);
+  mgr.set_metric("num_nodes", m_result->nodes().size());
+}
+
+std::shared_ptr<const method_override_graph::Graph>
+MethodOverrideGraphAnalysisPass::get_preserved(const PassManager& mgr) {
+  auto analysis = mgr.get_preserved_analysis<MethodOverrideGraphAnalysisPass>();
+  if (analysis == nullptr || analysis->get_result() == nullptr) {
+    return nullptr;
+  }
+  TRACE(PM, 2, "Reusing the preserved method override graph");
+  return analysis->get_result();
+}
+
+std::shared_ptr<const method_override_graph::Graph>
+MethodOverrideGraphAnalysisPass::get_or_build(const PassManager& mgr,
+                                              const Scope& scope) {
+  auto graph = get_preserved(mgr);
+  if (graph) {
+    return graph;
+  }
+  return method_override_graph::build_graph(scope);
+}
+
+static MethodOverrideGraphAnalysisPass s_pass;
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "MethodOverrideGraph.h"
+#include "Pass.h"
+
+class PassManager;
+
+/*
+ * An analysis pass that builds the method override graph once, so that the
+ * passes that follow it can share it via get_or_build() instead of each
+ * building their own.
+ *
+ * The graph only depends on the class hierarchy and on the virtual methods.
+ * Passes that only change code (e.g. LocalDce, CSE, IPCP) can declare to
+ * preserve it in their AnalysisUsage. Passes that delete virtual methods can
+ * still preserve it, as long as they call remove_method() for each of them.
+ * Renaming methods is fine as long as it is consistent across each virtual
+ * scope, which is what the renamers do.
+ *
+ * Call graphs are not shared the same way: their edges point into the
+ * IRLists of the callers, which don't survive the code changes and the CFG
+ * rebuilds that happen between passes. Passes that build call graphs can
+ * build them on top of the shared override graph, though.
+ */
+class MethodOverrideGraphAnalysisPass : public Pass {
+ public:
+  MethodOverrideGraphAnalysisPass()
+      : Pass("MethodOverrideGraphAnalysisPass", Pass::ANALYSIS) {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  std::shared_ptr<const method_override_graph::Graph> get_result() {
+    return m_result;
+  }
+
+  void remove_method(const DexMethod* method) {
+    if (m_result) {
+      m_result->remove_method(method);
+    }
+  }
+
+  void destroy_analysis_result() override { m_result = nullptr; }
+
+  // Returns nullptr when there is no preserved graph.
+  static std::shared_ptr<const method_override_graph::Graph> get_preserved(
+      const PassManager& mgr);
+
+  /*
+   * Returns the preserved graph when there is one, and builds a new one for
+   * :scope otherwise.
+   */
+  static std::shared_ptr<const method_override_graph::Graph> get_or_build(
+      const PassManager& mgr, const Scope& scope);
+
+ private:
+  std::shared_ptr<method_override_graph::Graph> m_result = nullptr;
+};
@@ -8,11 +8,16 @@
 #include "IntraDexInlinePass.h"
 
 #include "MethodInliner.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 
 void IntraDexInlinePass::run_pass(DexStoresVector& stores,
                                   ConfigFiles& conf,
                                   PassManager& mgr) {
-  inliner::run_inliner(stores, mgr, conf, /* intra_dex */ true);
+  auto method_override_graph =
+      MethodOverrideGraphAnalysisPass::get_preserved(mgr);
+  inliner::run_inliner(stores, mgr, conf, /* intra_dex */ true,
+                       /* inline_for_speed */ nullptr,
+                       method_override_graph.get());
 }
 
 static IntraDexInlinePass s_pass;
@@ -8,11 +8,19 @@
 #include "MethodInlinePass.h"
 
 #include "MethodInliner.h"
+#include "MethodOverrideGraphAnalysisPass.h"
+#include "PurityAnalysisPass.h"
 
 void MethodInlinePass::run_pass(DexStoresVector& stores,
                                 ConfigFiles& conf,
                                 PassManager& mgr) {
-  inliner::run_inliner(stores, mgr, conf);
+  auto method_override_graph =
+      MethodOverrideGraphAnalysisPass::get_preserved(mgr);
+  auto purity_analysis = mgr.get_preserved_analysis<PurityAnalysisPass>();
+  auto purity_cache = purity_analysis ? purity_analysis->get_result() : nullptr;
+  inliner::run_inliner(stores, mgr, conf, /* intra_dex */ false,
+                       /* inline_for_speed */ nullptr,
+                       method_override_graph.get(), purity_cache.get());
 }
 
 static MethodInlinePass s_pass;
@@ -20,8 +20,10 @@
 #include "InlineForSpeed.h"
 #include "Macros.h"
 #include "MethodInliner.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "MethodProfiles.h"
 #include "PGIForest.h"
+#include "PurityAnalysisPass.h"
 #include "RedexContext.h"
 #include "Resolver.h"
 #include "Show.h"
@@ -672,8 +674,13 @@ void PerfMethodInlinePass::run_pass(DexStoresVector& stores,
                                            m_config->dec_trees_config);
   }()};
 
+  auto method_override_graph =
+      MethodOverrideGraphAnalysisPass::get_preserved(mgr);
+  auto purity_analysis = mgr.get_preserved_analysis<PurityAnalysisPass>();
+  auto purity_cache = purity_analysis ? purity_analysis->get_result() : nullptr;
   inliner::run_inliner(stores, mgr, conf, /* intra_dex */ true,
-                       /* inline_for_speed= */ ifs.get());
+                       /* inline_for_speed= */ ifs.get(),
+                       method_override_graph.get(), purity_cache.get());
 
   TRACE(METH_PROF, 1, "Accepted %zu out of %zu choices.",
         ifs->get_num_accepted(), ifs->get_num_choices());
@@ -8,6 +8,8 @@
 #include <list>
 
 #include "ClassHierarchy.h"
+#include "ClassScopesAnalysisPass.h"
+#include "ConcurrentContainers.h"
 #include "DexClass.h"
 #include "DexUtil.h"
 #include "IRCode.h"
@@ -79,26 +81,29 @@ template <typename DexMember,
           typename K>
 DexMember* find_renamable_ref(
     DexMemberRef* ref,
-    std::unordered_map<DexMemberRef*, DexMember*>& ref_def_cache,
-    DexElemManager<DexMember*, DexMemberRef*, DexMemberSpec, K>& name_mapping) {
+    ConcurrentMap<DexMemberRef*, DexMember*>& ref_def_cache,
+    const DexElemManager<DexMember*, DexMemberRef*, DexMemberSpec, K>&
+        name_mapping) {
   TRACE(OBFUSCATE, 4, "Found a ref opcode");
   DexMember* def = nullptr;
-  auto member_itr = ref_def_cache.find(ref);
-  if (member_itr != ref_def_cache.end()) {
-    def = member_itr->second;
-  } else {
-    def = name_mapping.def_of_ref(ref);
-  }
-  ref_def_cache[ref] = def;
+  ref_def_cache.update(ref,
+                       [&](DexMemberRef*, DexMember*& cached, bool exists) {
+                         if (!exists) {
+                           cached = name_mapping.def_of_ref(ref);
+                         }
+                         def = cached;
+                       });
   return def;
 }
 
+// All the new names are picked by now, so the name mappings are only read,
+// and each instruction is rewritten independently of the others.
 void update_refs(Scope& scope,
-                 DexFieldManager& field_name_mapping,
-                 DexMethodManager& method_name_mapping) {
-  std::unordered_map<DexFieldRef*, DexField*> f_ref_def_cache;
-  std::unordered_map<DexMethodRef*, DexMethod*> m_ref_def_cache;
-  walk::opcodes(scope, [&](DexMethod*, IRInstruction* instr) {
+                 const DexFieldManager& field_name_mapping,
+                 const DexMethodManager& method_name_mapping) {
+  ConcurrentMap<DexFieldRef*, DexField*> f_ref_def_cache;
+  ConcurrentMap<DexMethodRef*, DexMethod*> m_ref_def_cache;
+  walk::parallel::opcodes(scope, [&](DexMethod*, IRInstruction* instr) {
     auto op = instr->opcode();
     if (instr->has_field()) {
       DexFieldRef* field_ref = instr->get_field();
@@ -142,7 +147,8 @@ void get_totals(Scope& scope, RenameStats& stats) {
 
 void obfuscate(Scope& scope,
                RenameStats& stats,
-               bool avoid_colliding_debug_name) {
+               bool avoid_colliding_debug_name,
+               const ClassScopes* class_scopes) {
   get_totals(scope, stats);
   ClassHierarchy ch = build_type_hierarchy(scope);
 
@@ -228,7 +234,8 @@ void obfuscate(Scope& scope,
   stats.dmethods_renamed = method_name_manager.commit_renamings_to_dex();
 
   stats.vmethods_renamed =
-      rename_virtuals(scope, avoid_colliding_debug_name, next_dmethod_seeds);
+      rename_virtuals(scope, avoid_colliding_debug_name, next_dmethod_seeds,
+                      class_scopes);
 
   debug_logging(scope);
 
@@ -254,7 +261,9 @@ void ObfuscatePass::run_pass(DexStoresVector& stores,
   auto scope = build_class_scope(stores);
   RenameStats stats;
   auto debug_info_kind = mgr.get_redex_options().debug_info_kind;
-  obfuscate(scope, stats, is_iodi(debug_info_kind));
+  // The scopes only depend on the virtual methods, which are renamed last.
+  auto class_scopes = ClassScopesAnalysisPass::get_preserved(mgr);
+  obfuscate(scope, stats, is_iodi(debug_info_kind), class_scopes.get());
   mgr.incr_metric(METRIC_FIELD_TOTAL, static_cast<int>(stats.fields_total));
   mgr.incr_metric(METRIC_FIELD_RENAMED, static_cast<int>(stats.fields_renamed));
   mgr.incr_metric(METRIC_DMETHODS_TOTAL,
@@ -595,21 +595,25 @@ class DexElemManager {
   }
 
  private:
-  // Returns the def for that class and ref if it exists, nullptr otherwise
-  T find_def(R ref, DexType* cls) {
+  // Returns the def for that class and ref if it exists, nullptr otherwise.
+  // Only uses lookups that don't insert, so that concurrent calls are safe.
+  T find_def(R ref, DexType* cls) const {
     if (cls == nullptr) return nullptr;
-    if (contains_elem(cls, sig_getter_fn(ref), ref->get_name())) {
-      DexNameWrapper<T>* wrap =
-          elements[cls][sig_getter_fn(ref)][ref->get_name()].get();
-      if (wrap->is_modified()) return wrap->get();
-    }
+    auto class_it = elements.find(cls);
+    if (class_it == elements.end()) return nullptr;
+    auto sig_it = class_it->second.find(sig_getter_fn(ref));
+    if (sig_it == class_it->second.end()) return nullptr;
+    auto name_it = sig_it->second.find(ref->get_name());
+    if (name_it == sig_it->second.end()) return nullptr;
+    DexNameWrapper<T>* wrap = name_it->second.get();
+    if (wrap->is_modified()) return wrap->get();
     return nullptr;
   }
 
   /**
    * Look up in the class and all its interfaces.
    */
-  T find_def_in_class_and_intf(R ref, DexClass* cls) {
+  T find_def_in_class_and_intf(R ref, DexClass* cls) const {
     if (cls == nullptr) return nullptr;
     auto found_def = find_def(ref, cls->get_type());
     if (found_def != nullptr) return found_def;
@@ -624,7 +628,8 @@ class DexElemManager {
   // Does a lookup over the fields we renamed in the dex to see what the
   // reference should be reset with. Returns nullptr if there is no mapping.
   // Note: we also have to look in superclasses in the case that this is a ref
-  T def_of_ref(R ref) {
+  // Once all the new names are picked, this can be called concurrently.
+  T def_of_ref(R ref) const {
     DexClass* cls = type_class(ref->get_class());
     while (cls && !cls->is_external()) {
       auto found = find_def_in_class_and_intf(ref, cls);
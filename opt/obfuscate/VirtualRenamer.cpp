@@ -6,6 +6,7 @@
  */
 
 #include "VirtualRenamer.h"
+#include "ConcurrentContainers.h"
 #include "DexAccess.h"
 #include "DexClass.h"
 #include "DexUtil.h"
@@ -17,6 +18,7 @@
 #include "Walkers.h"
 
 #include <map>
+#include <memory>
 #include <set>
 
 namespace {
@@ -464,7 +466,8 @@ int VirtualRenamer::rename_virtual_scopes(const DexType* type, int& seed) {
  * Collect all method refs to concrete methods (definitions).
  */
 void collect_refs(Scope& scope, RefsMap& def_refs) {
-  walk::opcodes(
+  ConcurrentMap<DexMethod*, RefsMap::mapped_type> concurrent_def_refs;
+  walk::parallel::opcodes(
       scope, [](DexMethod*) { return true; },
       [&](DexMethod*, IRInstruction* insn) {
         if (!insn->has_method()) return;
@@ -491,8 +494,14 @@ void collect_refs(Scope& scope, RefsMap& def_refs) {
         redex_assert(type_class(top->get_class()) != nullptr);
         if (type_class(top->get_class())->is_external()) return;
         // it's a top definition on an internal class, save it
-        def_refs[top].insert(callee);
+        concurrent_def_refs.update(
+            top, [callee](DexMethod*, RefsMap::mapped_type& refs, bool) {
+              refs.insert(callee);
+            });
       });
+  for (auto& pair : concurrent_def_refs) {
+    def_refs.emplace(pair.first, std::move(pair.second));
+  }
 }
 
 } // namespace
@@ -503,9 +512,15 @@ void collect_refs(Scope& scope, RefsMap& def_refs) {
 size_t rename_virtuals(
     Scope& scope,
     bool avoid_stack_trace_collision,
-    const std::unordered_map<const DexClass*, int>& next_dmethod_seeds) {
+    const std::unordered_map<const DexClass*, int>& next_dmethod_seeds,
+    const ClassScopes* given_class_scopes) {
   // build a ClassScope a RefsMap and a VirtualRenamer
-  ClassScopes class_scopes(scope);
+  std::unique_ptr<ClassScopes> built_class_scopes;
+  if (given_class_scopes == nullptr) {
+    built_class_scopes = std::make_unique<ClassScopes>(scope);
+  }
+  const ClassScopes& class_scopes =
+      given_class_scopes ? *given_class_scopes : *built_class_scopes;
   scope_info(class_scopes);
   RefsMap def_refs;
   collect_refs(scope, def_refs);
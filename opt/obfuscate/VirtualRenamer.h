@@ -9,10 +9,14 @@
 
 #include "Obfuscate.h"
 
+class ClassScopes;
+
 // Renames virtual methods avoiding conflicts up the class hierarchy and
 // avoiding collisions of methods printed in a stack trace when
-// avoid_stack_trace_collision is true
+// avoid_stack_trace_collision is true. The class scopes of the scope are
+// built unless they are given.
 size_t rename_virtuals(
     Scope& scope,
     bool avoid_stack_trace_collision = false,
-    const std::unordered_map<const DexClass*, int>& next_dmethod_seeds = {});
+    const std::unordered_map<const DexClass*, int>& next_dmethod_seeds = {},
+    const ClassScopes* class_scopes = nullptr);
@@ -9,9 +9,13 @@
 
 #include <boost/optional.hpp>
 
+#include "AnalysisUsage.h"
 #include "CallGraph.h"
+#include "ClassHierarchyAnalysisPass.h"
 #include "LocalPointersAnalysis.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
+#include "PurityAnalysisPass.h"
 #include "SideEffectSummary.h"
 #include "Trace.h"
 #include "UsedVarsAnalysis.h"
@@ -36,6 +40,13 @@ class ObjectSensitiveDcePass final : public Pass {
     }
   }
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // Removing dead code doesn't add any side effects.
+    au.add_preserve_specific<ClassHierarchyAnalysisPass>();
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+    au.add_preserve_specific<PurityAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
@@ -7,6 +7,8 @@
 
 #include "OptimizeEnums.h"
 
+#include <cmath>
+
 #include "ClassAssemblingUtils.h"
 #include "ConfigFiles.h"
 #include "EnumAnalyzeGeneratedMethods.h"
@@ -16,6 +18,7 @@
 #include "EnumUpcastAnalysis.h"
 #include "IRCode.h"
 #include "MatchFlow.h"
+#include "MethodProfiles.h"
 #include "OptimizeEnumsAnalysis.h"
 #include "PassManager.h"
 #include "ProguardMap.h"
@@ -78,6 +81,20 @@ constexpr const char* METRIC_NUM_CANDIDATE_GENERATED_METHODS =
     "num_candidate_generated_enum_methods";
 constexpr const char* METRIC_NUM_REMOVED_GENERATED_METHODS =
     "num_removed_generated_enum_methods";
+constexpr const char* METRIC_NUM_LOOKUP_SWITCHES_REPLACED =
+    "num_lookup_switches_replaced";
+constexpr const char* METRIC_NUM_HOT_LOOKUP_SWITCHES_REPLACED =
+    "num_hot_lookup_switches_replaced";
+constexpr const char* METRIC_EST_LOOKUPS_REMOVED =
+    "estimated_cold_start_lookups_removed";
+constexpr const char* METRIC_EST_ALLOCATIONS_REMOVED =
+    "estimated_allocations_removed";
+constexpr const char* METRIC_EST_INVOCATIONS_REMOVED =
+    "estimated_invocations_removed";
+constexpr const char* METRIC_EST_STARTUP_ALLOCATIONS_REMOVED =
+    "estimated_cold_start_allocations_removed";
+constexpr const char* METRIC_EST_STARTUP_INVOCATIONS_REMOVED =
+    "estimated_cold_start_invocations_removed";
 
 /**
  * Simple analysis to determine which of the enums ctor argument
@@ -305,8 +322,13 @@ DexMethod* get_java_enum_ctor() {
 
 class OptimizeEnums {
  public:
-  OptimizeEnums(DexStoresVector& stores, ConfigFiles& conf)
-      : m_stores(stores), m_pg_map(conf.get_proguard_map()) {
+  OptimizeEnums(DexStoresVector& stores,
+                ConfigFiles& conf,
+                float hot_method_appear_percent)
+      : m_stores(stores),
+        m_pg_map(conf.get_proguard_map()),
+        m_method_profiles(conf.get_method_profiles()),
+        m_hot_method_appear_percent(hot_method_appear_percent) {
     m_scope = build_class_scope(stores);
     m_java_enum_ctor = get_java_enum_ctor();
   }
@@ -338,6 +360,33 @@ class OptimizeEnums {
 
     remove_generated_classes_usage(lookup_table_to_enum, enum_field_to_ordinal,
                                    generated_switch_cases);
+
+    for (const auto& generated_cls : generated_classes) {
+      const auto& sfields = generated_cls->get_sfields();
+      if (!std::all_of(sfields.begin(), sfields.end(), [&](DexField* f) {
+            return m_lookup_tables_replaced.count(f) != 0;
+          })) {
+        continue;
+      }
+      // Nothing reads the lookup tables anymore, so the <clinit> that builds
+      // them won't run. For each table, it calls `values()`, which clones the
+      // values array, allocates the table, and calls `ordinal()` per case.
+      size_t allocations = 2 * sfields.size();
+      size_t invocations = sfields.size();
+      for (auto* f : sfields) {
+        auto it = generated_switch_cases.find(f);
+        if (it != generated_switch_cases.end()) {
+          invocations += it->second.size();
+        }
+      }
+      m_stats.estimated_allocations_removed += allocations;
+      m_stats.estimated_invocations_removed += invocations;
+      if (m_method_profiles.get_method_stat(method_profiles::COLD_START,
+                                            generated_cls->get_clinit())) {
+        m_stats.estimated_startup_allocations_removed += allocations;
+        m_stats.estimated_startup_invocations_removed += invocations;
+      }
+    }
   }
 
   void stats(PassManager& mgr) {
@@ -357,6 +406,19 @@ class OptimizeEnums {
            m_stats.num_candidate_generated_methods);
     report(METRIC_NUM_REMOVED_GENERATED_METHODS,
            m_stats.num_removed_generated_methods);
+    report(METRIC_NUM_LOOKUP_SWITCHES_REPLACED,
+           m_stats.num_lookup_switches_replaced);
+    report(METRIC_NUM_HOT_LOOKUP_SWITCHES_REPLACED,
+           m_stats.num_hot_lookup_switches_replaced);
+    report(METRIC_EST_LOOKUPS_REMOVED, m_stats.estimated_lookups_removed);
+    report(METRIC_EST_ALLOCATIONS_REMOVED,
+           m_stats.estimated_allocations_removed);
+    report(METRIC_EST_INVOCATIONS_REMOVED,
+           m_stats.estimated_invocations_removed);
+    report(METRIC_EST_STARTUP_ALLOCATIONS_REMOVED,
+           m_stats.estimated_startup_allocations_removed);
+    report(METRIC_EST_STARTUP_INVOCATIONS_REMOVED,
+           m_stats.estimated_startup_invocations_removed);
   }
 
   /**
@@ -426,6 +488,10 @@ class OptimizeEnums {
     }
     m_stats.num_enum_objs = optimize_enums::transform_enums(
         config, &m_stores, &m_stats.num_int_objs);
+    // Each erased enum object was allocated and constructed, through the
+    // constructor of java.lang.Enum, by its <clinit>.
+    m_stats.estimated_allocations_removed += m_stats.num_enum_objs;
+    m_stats.estimated_invocations_removed += 2 * m_stats.num_enum_objs;
     m_stats.num_enum_classes = config.candidate_enums.size();
   }
 
@@ -684,7 +750,11 @@ class OptimizeEnums {
       const GeneratedSwitchCases& generated_switch_cases) {
 
     namespace cp = constant_propagation;
-    walk::parallel::code(m_scope, [&](DexMethod*, IRCode& code) {
+    walk::parallel::code(m_scope, [&](DexMethod* method, IRCode& code) {
+      // Replacing a lookup saves an sget and an aget every time it runs.
+      auto stat = m_method_profiles.get_method_stat(method_profiles::COLD_START,
+                                                    method);
+      bool hot = stat && stat->appear_percent >= m_hot_method_appear_percent;
       cfg::ScopedCFG cfg(&code);
       cfg->calculate_exit_block();
 
@@ -703,8 +773,16 @@ class OptimizeEnums {
                                       generated_switch_cases, info)) {
           continue;
         }
-        remove_lookup_table_usage(enum_field_to_ordinal, generated_switch_cases,
-                                  info);
+        if (!remove_lookup_table_usage(enum_field_to_ordinal,
+                                       generated_switch_cases, info)) {
+          continue;
+        }
+        m_stats.num_lookup_switches_replaced++;
+        if (hot) {
+          m_stats.num_hot_lookup_switches_replaced++;
+          m_stats.estimated_lookups_removed +=
+              (size_t)std::llround(stat->call_count);
+        }
       }
     });
   }
@@ -764,7 +842,7 @@ class OptimizeEnums {
    *       if it isn't used afterwards (which is expected), but we are
    *       being conservative.
    */
-  void remove_lookup_table_usage(
+  bool remove_lookup_table_usage(
       const EnumFieldToOrdinal& enum_field_to_ordinal,
       const GeneratedSwitchCases& generated_switch_cases,
       const optimize_enums::Info& info) {
@@ -777,7 +855,7 @@ class OptimizeEnums {
                              50 /* leaf_duplication_threshold */);
     if (!finder.success()) {
       ++m_stats.num_switch_equiv_finder_failures;
-      return;
+      return false;
     }
 
     // Remove the switch statement so we can rebuild it with the correct case
@@ -845,7 +923,7 @@ class OptimizeEnums {
     //       LDCE the array access.
     auto move_ordinal_it = cfg.move_result_of(*info.invoke);
     if (move_ordinal_it.is_end()) {
-      return;
+      return false;
     }
 
     auto move_ordinal = move_ordinal_it->insn;
@@ -892,6 +970,7 @@ class OptimizeEnums {
     }
 
     m_lookup_tables_replaced.emplace(info.array_field);
+    return true;
   }
 
   /**
@@ -968,12 +1047,21 @@ class OptimizeEnums {
     std::atomic<size_t> num_switch_equiv_finder_failures{0};
     size_t num_candidate_generated_methods{0};
     size_t num_removed_generated_methods{0};
+    std::atomic<size_t> num_lookup_switches_replaced{0};
+    std::atomic<size_t> num_hot_lookup_switches_replaced{0};
+    std::atomic<size_t> estimated_lookups_removed{0};
+    size_t estimated_allocations_removed{0};
+    size_t estimated_invocations_removed{0};
+    size_t estimated_startup_allocations_removed{0};
+    size_t estimated_startup_invocations_removed{0};
   };
   Stats m_stats;
 
   ConcurrentSet<DexField*> m_lookup_tables_replaced;
   const DexMethod* m_java_enum_ctor;
   const ProguardMap& m_pg_map;
+  const method_profiles::MethodProfiles& m_method_profiles;
+  float m_hot_method_appear_percent;
 };
 
 } // namespace
@@ -988,12 +1076,15 @@ void OptimizeEnumsPass::bind_config() {
        "A allowlist of enum classes that may have more than `max_enum_size` "
        "enum fields, try to erase them without considering reference equality "
        "of the enum objects. Do not add enums to the allowlist!");
+  bind("hot_method_appear_percent", 10.0f, m_hot_method_appear_percent,
+       "Minimum cold start appear percent of a method for its replaced lookup "
+       "switches to count as hot in the metrics");
 }
 
 void OptimizeEnumsPass::run_pass(DexStoresVector& stores,
                                  ConfigFiles& conf,
                                  PassManager& mgr) {
-  OptimizeEnums opt_enums(stores, conf);
+  OptimizeEnums opt_enums(stores, conf, m_hot_method_appear_percent);
   opt_enums.remove_redundant_generated_classes();
   opt_enums.replace_enum_with_int(m_max_enum_size, m_enum_to_integer_allowlist);
   opt_enums.remove_enum_generated_methods();
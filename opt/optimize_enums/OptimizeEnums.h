@@ -20,6 +20,7 @@ class OptimizeEnumsPass : public Pass {
 
  private:
   int m_max_enum_size;
+  float m_hot_method_appear_percent;
   std::vector<DexType*> m_enum_to_integer_allowlist;
 };
 
@@ -19,6 +19,8 @@ class OriginalNamePass : public Pass {
     trait(Traits::Pass::unique, true);
   }
 
+  bool needs_all_code() const override { return false; }
+
   void run_pass(DexStoresVector& stores,
                 ConfigFiles& conf,
                 PassManager& mgr) override;
@@ -14,7 +14,9 @@
  * instructions in a block occurs sufficiently often. The average complexity is
  * held down by filtering out instruction sequences where adjacent sequences of
  * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
+ * in the scope. Optionally (suffix_array_pruning), a suffix array over the
+ * cores of all outlinable instructions also bounds the length of each linear
+ * sequence by the longest one starting there that occurs elsewhere as well.
  *
  * When reaching a conditional branch or switch instruction, different control-
  * paths are explored as well, as long as they eventually all arrive at a common
@@ -65,14 +67,18 @@
 #include "InstructionSequenceOutliner.h"
 
 #include <algorithm>
+#include <fstream>
 #include <list>
 #include <map>
 #include <memory>
+#include <numeric>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include <boost/filesystem.hpp>
 #include <boost/format.hpp>
 
 #include "ABExperimentContext.h"
@@ -82,6 +88,7 @@
 #include "ConfigFiles.h"
 #include "Creators.h"
 #include "Debug.h"
+#include "DedupBlocks.h"
 #include "DexClass.h"
 #include "DexInstruction.h"
 #include "DexLimits.h"
@@ -106,8 +113,10 @@
 #include "Show.h"
 #include "SourceBlocks.h"
 #include "StlUtil.h"
+#include "SuffixArray.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 using namespace instruction_sequence_outliner;
 
@@ -355,6 +364,21 @@ using CandidateInstructionCoresSet =
     std::unordered_set<CandidateInstructionCores,
                        CandidateInstructionCoresHasher>;
 
+// What is known about the recurring instruction sequences of a scope.
+struct RecurringCores {
+  // All recurring sequences of MIN_INSNS_SIZE many cores.
+  CandidateInstructionCoresSet cores;
+  // With suffix-array pruning, for (almost) every outlinable instruction, the
+  // number of instructions of the longest sequence of cores starting there
+  // that also starts somewhere else.
+  std::unordered_map<const IRInstruction*, uint32_t> max_repeat_lengths;
+  // For the first instruction of every block that recurs across methods, as
+  // found by cross-method block deduplication, the number of instructions of
+  // the block. Candidates starting there may be that long, even if that
+  // exceeds max_insns_size.
+  std::unordered_map<const IRInstruction*, uint32_t> duplicate_block_lengths;
+};
+
 // The cores builder efficiently keeps track of the last MIN_INSNS_SIZE many
 // instructions.
 class CandidateInstructionCoresBuilder {
@@ -659,7 +683,7 @@ class CanOutlineBlockDecider {
   mutable std::unique_ptr<LazyUnorderedMap<cfg::Block*, bool>> m_is_in_loop;
   mutable std::unique_ptr<LazyUnorderedMap<cfg::Block*, boost::optional<float>>>
       m_max_vals;
-  mutable std::unique_ptr<dominators::SimpleFastDominators<cfg::GraphInterface>>
+  mutable std::shared_ptr<const cfg::ControlFlowGraph::Dominators>
       m_dominators;
 
  public:
@@ -761,8 +785,7 @@ class CanOutlineBlockDecider {
     auto entry_block = cfg.entry_block();
     if (block != entry_block && (!min_val || *min_val != 0)) {
       if (!m_dominators) {
-        m_dominators.reset(
-            new dominators::SimpleFastDominators<cfg::GraphInterface>(cfg));
+        m_dominators = cfg.get_dominators();
       }
       do {
         block = m_dominators->get_idom(block);
@@ -943,7 +966,7 @@ static bool explore_candidates_from(
         reaching_initialized_init_first_param,
     const Config& config,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringCores& recurring_cores,
     PartialCandidate* pc,
     PartialCandidateNode* pcn,
     big_blocks::InstructionIterator it,
@@ -953,8 +976,31 @@ static bool explore_candidates_from(
   CandidateInstructionCoresBuilder cores_builder;
   auto first_block = it.block();
   auto& cfg = first_block->cfg();
+  // Any candidate starting here must have recurring linear prefix.
+  boost::optional<size_t> max_repeat_length;
+  size_t max_insns_size = config.max_insns_size;
+  if (pcn == &pc->root && it != end) {
+    auto max_repeat_length_it =
+        recurring_cores.max_repeat_lengths.find(it->insn);
+    if (max_repeat_length_it != recurring_cores.max_repeat_lengths.end()) {
+      max_repeat_length = max_repeat_length_it->second;
+    }
+    auto duplicate_block_length_it =
+        recurring_cores.duplicate_block_lengths.find(it->insn);
+    if (duplicate_block_length_it !=
+        recurring_cores.duplicate_block_lengths.end()) {
+      size_t length = duplicate_block_length_it->second;
+      max_insns_size = std::max(max_insns_size, length);
+      if (max_repeat_length) {
+        max_repeat_length = std::max(*max_repeat_length, length);
+      }
+    }
+  }
   for (; it != end; prev_opcode = it->insn->opcode(), it++) {
-    if (pc->insns_size >= config.max_insns_size) {
+    if (pc->insns_size >= max_insns_size) {
+      return false;
+    }
+    if (max_repeat_length && pcn->insns.size() >= *max_repeat_length) {
       return false;
     }
     auto insn = it->insn;
@@ -965,7 +1011,7 @@ static bool explore_candidates_from(
     }
     cores_builder.push_back(insn);
     if (cores_builder.has_value() &&
-        !recurring_cores.count(cores_builder.get_value())) {
+        !recurring_cores.cores.count(cores_builder.get_value())) {
       return false;
     }
     if (!append_to_partial_candidate(reaching_initialized_new_instances, insn,
@@ -1080,7 +1126,7 @@ static MethodCandidates find_method_candidates(
     const CanOutlineBlockDecider& block_decider,
     DexMethod* method,
     cfg::ControlFlowGraph& cfg,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringCores& recurring_cores,
     FindCandidatesStats* stats) {
   MethodCandidates candidates;
   Lazy<LivenessFixpointIterator> liveness_fp_iter([&cfg] {
@@ -1341,14 +1387,18 @@ static void get_recurring_cores(
     const std::unordered_set<DexMethod*>& sufficiently_warm_methods,
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
-    CandidateInstructionCoresSet* recurring_cores,
+    RecurringCores* recurring_cores,
     ConcurrentMap<DexMethod*, CanOutlineBlockDecider>* block_deciders) {
   ConcurrentMap<CandidateInstructionCores, size_t,
                 CandidateInstructionCoresHasher>
       concurrent_cores;
+  // Maximal runs of adjacent outlinable instructions, for the suffix array.
+  using Segments = std::vector<std::vector<IRInstruction*>>;
+  ConcurrentMap<DexMethod*, Segments> concurrent_segments;
   walk::parallel::code(
       scope, [&config, &ref_checker, &sufficiently_warm_methods,
               &sufficiently_hot_methods, &concurrent_cores,
+              &concurrent_segments,
               block_deciders](DexMethod* method, IRCode& code) {
         if (!can_outline_from_method(method)) {
           return;
@@ -1366,6 +1416,16 @@ static void get_recurring_cores(
               reaching_initializeds::get_reaching_initializeds(
                   cfg, reaching_initializeds::Mode::FirstLoadParam);
         }
+        Segments segments;
+        auto end_segment = [&segments]() {
+          // Shorter segments cannot contain any recurring cores at all.
+          if (!segments.empty() && segments.back().size() < MIN_INSNS_SIZE) {
+            segments.back().clear();
+          } else {
+            segments.emplace_back();
+          }
+        };
+        segments.emplace_back();
         for (auto& big_block : big_blocks::get_big_blocks(cfg)) {
           if (block_decider.can_outline_from_big_block(big_block) !=
               CanOutlineBlockDecider::Result::CanOutline) {
@@ -1377,8 +1437,12 @@ static void get_recurring_cores(
             if (!can_outline_insn(
                     ref_checker, reaching_initialized_init_first_param, insn)) {
               cores_builder.clear();
+              end_segment();
               continue;
             }
+            if (config.suffix_array_pruning) {
+              segments.back().push_back(insn);
+            }
             cores_builder.push_back(insn);
             if (cores_builder.has_value()) {
               concurrent_cores.update(cores_builder.get_value(),
@@ -1387,6 +1451,14 @@ static void get_recurring_cores(
                                          bool /* exists */) { occurrences++; });
             }
           }
+          end_segment();
+        }
+        if (config.suffix_array_pruning) {
+          end_segment();
+          segments.pop_back();
+          if (!segments.empty()) {
+            concurrent_segments.emplace(method, std::move(segments));
+          }
         }
         block_deciders->emplace(method, std::move(block_decider));
       });
@@ -1394,17 +1466,95 @@ static void get_recurring_cores(
   for (auto& p : concurrent_cores) {
     always_assert(p.second > 0);
     if (p.second > 1) {
-      recurring_cores->insert(p.first);
+      recurring_cores->cores.insert(p.first);
     } else {
       singleton_cores++;
     }
   }
   mgr.incr_metric("num_singleton_cores", singleton_cores);
-  mgr.incr_metric("num_recurring_cores", recurring_cores->size());
+  mgr.incr_metric("num_recurring_cores", recurring_cores->cores.size());
   TRACE(ISO, 2,
         "[invoke sequence outliner] %zu singleton cores, %zu recurring "
         "cores",
-        singleton_cores, recurring_cores->size());
+        singleton_cores, recurring_cores->cores.size());
+
+  if (config.duplicate_blocks_max_insns_size > config.max_insns_size) {
+    std::vector<DexMethod*> methods;
+    for (auto& p : *block_deciders) {
+      methods.push_back(p.first);
+    }
+    auto duplicate_blocks =
+        dedup_blocks_impl::find_duplicate_blocks_across_methods(
+            methods, config.max_insns_size + 1);
+    size_t num_duplicate_blocks{0};
+    for (auto& locations : duplicate_blocks) {
+      for (auto& loc : locations) {
+        auto ii = InstructionIterable(loc.block);
+        auto length = std::min<size_t>(std::distance(ii.begin(), ii.end()),
+                                       config.duplicate_blocks_max_insns_size);
+        recurring_cores->duplicate_block_lengths.emplace(ii.begin()->insn,
+                                                         length);
+      }
+      num_duplicate_blocks += locations.size();
+    }
+    mgr.incr_metric("num_duplicate_block_groups", duplicate_blocks.size());
+    mgr.incr_metric("num_duplicate_blocks", num_duplicate_blocks);
+    TRACE(ISO, 2,
+          "[invoke sequence outliner] %zu blocks in %zu groups recur across "
+          "methods",
+          num_duplicate_blocks, duplicate_blocks.size());
+  }
+
+  if (!config.suffix_array_pruning) {
+    return;
+  }
+  // Concatenate all segments, in a deterministic order, and with unique
+  // separators, so that repeats never extend beyond a segment.
+  std::vector<const Segments*> ordered_segments;
+  walk::methods(scope, [&](DexMethod* method) {
+    auto it = concurrent_segments.find(method);
+    if (it != concurrent_segments.end()) {
+      ordered_segments.push_back(&it->second);
+    }
+  });
+  std::unordered_map<CandidateInstructionCore, uint32_t,
+                     CandidateInstructionCoreHasher>
+      core_ids;
+  size_t num_segments{0};
+  size_t num_insns{0};
+  for (auto* segments : ordered_segments) {
+    for (auto& segment : *segments) {
+      for (auto insn : segment) {
+        core_ids.emplace(to_core(insn), core_ids.size());
+      }
+      num_insns += segment.size();
+      num_segments++;
+    }
+  }
+  suffix_array::Text text;
+  std::vector<const IRInstruction*> insns;
+  text.reserve(num_insns + num_segments);
+  insns.reserve(num_insns + num_segments);
+  uint32_t separator = core_ids.size();
+  for (auto* segments : ordered_segments) {
+    for (auto& segment : *segments) {
+      for (auto insn : segment) {
+        text.push_back(core_ids.at(to_core(insn)));
+        insns.push_back(insn);
+      }
+      text.push_back(separator++);
+      insns.push_back(nullptr);
+    }
+  }
+  auto lengths = suffix_array::longest_repeated_prefixes(text);
+  auto& max_repeat_lengths = recurring_cores->max_repeat_lengths;
+  max_repeat_lengths.reserve(num_insns);
+  for (size_t i = 0; i < insns.size(); i++) {
+    if (insns[i] != nullptr) {
+      max_repeat_lengths.emplace(insns[i], lengths[i]);
+    }
+  }
+  mgr.incr_metric("num_suffix_array_insns", num_insns);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1613,7 +1763,7 @@ static void get_beneficial_candidates(
     PassManager& mgr,
     const Scope& scope,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringCores& recurring_cores,
     const ConcurrentMap<DexMethod*, CanOutlineBlockDecider>& block_deciders,
     const ReusableOutlinedMethods* outlined_methods,
     std::vector<CandidateWithInfo>* candidates_with_infos,
@@ -1647,9 +1797,26 @@ static void get_beneficial_candidates(
   using CandidateSet = std::unordered_set<Candidate, CandidateHasher>;
   std::map<DexMethod*, CandidateSet, dexmethods_comparator>
       candidates_by_methods;
-  size_t beneficial_count{0}, maleficial_count{0};
+  // Compute all savings in parallel; aggregating them doesn't depend on the
+  // order.
+  std::vector<const std::pair<const Candidate, CandidateInfo>*> entries;
+  entries.reserve(concurrent_candidates.size());
   for (auto& p : concurrent_candidates) {
-    if (get_savings(config, p.first, p.second, *outlined_methods) > 0) {
+    entries.push_back(&p);
+  }
+  std::vector<size_t> savings(entries.size());
+  std::vector<size_t> indices(entries.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        savings[i] = get_savings(config, entries[i]->first, entries[i]->second,
+                                 *outlined_methods);
+      },
+      indices);
+  size_t beneficial_count{0}, maleficial_count{0};
+  for (size_t i = 0; i < entries.size(); i++) {
+    auto& p = *entries[i];
+    if (savings[i] > 0) {
       beneficial_count += p.second.count;
       for (auto& q : p.second.methods) {
         candidates_by_methods[q.first].insert(p.first);
@@ -2392,9 +2559,23 @@ using NewlyOutlinedMethods =
     std::unordered_map<DexMethod*, std::vector<DexMethod*>>;
 
 // Outlining all occurrences of a particular candidate.
+// A selected call site, to be rewritten once all candidates have been
+// selected.
+struct PendingRewrite {
+  DexMethod* outlined_method;
+  const Candidate* candidate;
+  CandidateMethodLocation cml;
+};
+
+// Rewrites are recorded per method, in the order in which the candidates were
+// selected.
+using PendingRewrites =
+    std::unordered_map<DexMethod*, std::vector<PendingRewrite>>;
+
 bool outline_candidate(
     const Candidate& c,
     const CandidateInfo& ci,
+    PendingRewrites* pending_rewrites,
     ReusableOutlinedMethods* outlined_methods,
     NewlyOutlinedMethods* newly_outlined_methods,
     DexState* dex_state,
@@ -2484,22 +2665,40 @@ bool outline_candidate(
   dex_state->insert_type_refs(type_refs_to_insert);
   for (auto& p : ci.methods) {
     auto method = p.first;
-    auto& cfg = method->get_code()->cfg();
-
     ab_experiment_context->try_register_method(method);
-
-    TRACE(ISO, 7, "[invoke sequence outliner] before outlined %s from %s\n%s",
-          SHOW(outlined_method), SHOW(method), SHOW(cfg));
+    auto& method_rewrites = (*pending_rewrites)[method];
     for (auto& cml : p.second) {
-      rewrite_at_location(outlined_method, call_site_pattern_ids, method, cfg,
-                          c, cml);
+      method_rewrites.push_back({outlined_method, &c, cml});
     }
-    TRACE(ISO, 6, "[invoke sequence outliner] after outlined %s from %s\n%s",
-          SHOW(outlined_method), SHOW(method), SHOW(cfg));
   }
   return true;
 }
 
+// Rewrite all selected call sites. Different methods are independent, so they
+// are processed in parallel, while the call sites within a method are
+// rewritten in the order in which they were selected.
+static void rewrite_pending(const CallSitePatternIds* call_site_pattern_ids,
+                            const PendingRewrites& pending_rewrites) {
+  std::vector<DexMethod*> methods;
+  methods.reserve(pending_rewrites.size());
+  for (auto& p : pending_rewrites) {
+    methods.push_back(p.first);
+  }
+  workqueue_run<DexMethod*>(
+      [&](DexMethod* method) {
+        auto& cfg = method->get_code()->cfg();
+        TRACE(ISO, 7, "[invoke sequence outliner] before outlining from %s\n%s",
+              SHOW(method), SHOW(cfg));
+        for (auto& pr : pending_rewrites.at(method)) {
+          rewrite_at_location(pr.outlined_method, call_site_pattern_ids,
+                              method, cfg, *pr.candidate, pr.cml);
+        }
+        TRACE(ISO, 6, "[invoke sequence outliner] after outlining from %s\n%s",
+              SHOW(method), SHOW(cfg));
+      },
+      methods);
+}
+
 // Perform outlining of most beneficial candidates, while staying within
 // reference limits.
 static NewlyOutlinedMethods outline(
@@ -2513,7 +2712,9 @@ static NewlyOutlinedMethods outline(
     ReusableOutlinedMethods* outlined_methods,
     size_t iteration,
     std::unique_ptr<ab_test::ABExperimentContext>& ab_experiment_context,
-    size_t* num_reused_methods) {
+    size_t* num_reused_methods,
+    const std::unordered_set<StableHash>& previously_outlined,
+    std::set<StableHash>* outlined_stable_hashes) {
   MethodNameGenerator method_name_generator(mgr, iteration);
   OutlinedMethodCreator outlined_method_creator(config, mgr,
                                                 method_name_generator);
@@ -2526,14 +2727,28 @@ static NewlyOutlinedMethods outline(
   // impacted candidates, until there is no more beneficial candidate left.
   using Priority = uint64_t;
   MutablePriorityQueue<CandidateId, Priority> pq;
-  auto get_priority = [&config, &candidates_with_infos,
+  // Candidates that were outlined by a previous build are preferred, so that
+  // the same outlined methods tend to come back. That's only known after
+  // computing the stable hashes, which is done alongside the initial
+  // priorities.
+  std::vector<uint8_t> was_outlined_before(candidates_with_infos->size());
+  auto get_priority = [&config, &candidates_with_infos, &was_outlined_before,
                        outlined_methods](CandidateId id) {
     auto& cwi = candidates_with_infos->at(id);
     Priority primary_priority =
         get_savings(config, cwi.candidate, cwi.info, *outlined_methods) *
         cwi.candidate.size;
-    // clip primary_priority to 32-bit
-    if (primary_priority >= (1UL << 32)) {
+    if (config.persist_outlined_sequences) {
+      // clip primary_priority to 31-bit, the top bit ranks the candidates that
+      // were outlined before first
+      if (primary_priority >= (1UL << 31)) {
+        primary_priority = (1UL << 31) - 1;
+      }
+      if (was_outlined_before[id]) {
+        primary_priority |= 1UL << 31;
+      }
+    } else if (primary_priority >= (1UL << 32)) {
+      // clip primary_priority to 32-bit
       primary_priority = (1UL << 32) - 1;
     }
     // make unique via candidate id
@@ -2548,14 +2763,30 @@ static NewlyOutlinedMethods outline(
     cwi.info.methods.clear();
     cwi.info.count = 0;
   };
+  // Computing the initial priorities is independent for each candidate.
+  std::vector<CandidateId> ids(candidates_with_infos->size());
+  std::iota(ids.begin(), ids.end(), 0);
+  std::vector<Priority> priorities(ids.size());
+  workqueue_run<CandidateId>(
+      [&](CandidateId id) {
+        if (!previously_outlined.empty()) {
+          auto stable_hash =
+              stable_hash_value(candidates_with_infos->at(id).candidate);
+          was_outlined_before[id] = previously_outlined.count(stable_hash);
+        }
+        priorities[id] = get_priority(id);
+      },
+      ids);
   for (CandidateId id = 0; id < candidates_with_infos->size(); id++) {
-    pq.insert(id, get_priority(id));
+    pq.insert(id, priorities[id]);
   }
   size_t total_savings{0};
   size_t outlined_count{0};
   size_t outlined_sequences_count{0};
   size_t not_outlined_count{0};
+  size_t outlined_again_count{0};
   NewlyOutlinedMethods newly_outlined_methods;
+  PendingRewrites pending_rewrites;
   while (!pq.empty()) {
     // Make sure beforehand that there's a method ref left for us
     if (!dex_state.can_insert_method_ref()) {
@@ -2575,12 +2806,17 @@ static NewlyOutlinedMethods outline(
           "[invoke sequence outliner] %4zx(%3zu) [%zu]: %zu byte savings",
           cwi.info.count, cwi.info.methods.size(), cwi.candidate.size,
           2 * savings);
-    if (outline_candidate(cwi.candidate, cwi.info, outlined_methods,
+    if (outline_candidate(cwi.candidate, cwi.info, &pending_rewrites,
+                          outlined_methods,
                           &newly_outlined_methods, &dex_state,
                           &host_class_selector, &outlined_method_creator,
                           ab_experiment_context, num_reused_methods,
                           config.reuse_outlined_methods_across_dexes)) {
       dex_state.insert_method_ref();
+      outlined_stable_hashes->insert(stable_hash_value(cwi.candidate));
+      if (was_outlined_before[id]) {
+        outlined_again_count++;
+      }
     } else {
       TRACE(ISO, 3, "[invoke sequence outliner] could not ouline");
       not_outlined_count++;
@@ -2613,6 +2849,7 @@ static NewlyOutlinedMethods outline(
     }
     erase(id, cwi);
     // Update priorities of affected candidates
+    std::vector<std::pair<CandidateId, Priority>> updates;
     for (auto other_id : other_candidate_ids_with_changes) {
       auto& other_cwi = candidates_with_infos->at(other_id);
       auto other_savings = get_savings(config, other_cwi.candidate,
@@ -2620,12 +2857,17 @@ static NewlyOutlinedMethods outline(
       if (other_savings == 0) {
         erase(other_id, other_cwi);
       } else {
-        pq.update_priority(other_id, get_priority(other_id));
+        updates.emplace_back(other_id, get_priority(other_id));
       }
     }
+    pq.update_priorities(updates);
   }
 
+  rewrite_pending(outlined_method_creator.get_call_site_pattern_ids(),
+                  pending_rewrites);
+
   mgr.incr_metric("num_not_outlined", not_outlined_count);
+  mgr.incr_metric("num_outlined_again", outlined_again_count);
   TRACE(ISO, 2, "[invoke sequence outliner] %zu not outlined",
         not_outlined_count);
 
@@ -2639,6 +2881,54 @@ static NewlyOutlinedMethods outline(
   return newly_outlined_methods;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Persisting outlined sequences across Redex runs
+////////////////////////////////////////////////////////////////////////////////
+
+// To be bumped whenever the computation of stable hashes changes.
+constexpr const char* OUTLINED_SEQUENCES_FORMAT_VERSION =
+    "outlined-sequences-1";
+
+static std::string get_outlined_sequences_path(const std::string& dir) {
+  return (boost::filesystem::path(dir) / "InstructionSequenceOutliner.outlined")
+      .string();
+}
+
+// Reads the stable hashes of the sequences outlined by a previous run.
+static std::unordered_set<StableHash> load_outlined_sequences(
+    const std::string& dir) {
+  std::unordered_set<StableHash> stable_hashes;
+  auto path = get_outlined_sequences_path(dir);
+  std::ifstream input(path);
+  if (!input) {
+    TRACE(ISO, 1, "[invoke sequence outliner] no outlined sequences at %s",
+          path.c_str());
+    return stable_hashes;
+  }
+  std::string line;
+  if (!std::getline(input, line) || line != OUTLINED_SEQUENCES_FORMAT_VERSION) {
+    TRACE(ISO, 1,
+          "[invoke sequence outliner] ignoring stale outlined sequences at %s",
+          path.c_str());
+    return stable_hashes;
+  }
+  while (std::getline(input, line)) {
+    if (!line.empty()) {
+      stable_hashes.insert(std::stoull(line, nullptr, 16));
+    }
+  }
+  return stable_hashes;
+}
+
+static void save_outlined_sequences(
+    const std::string& dir, const std::set<StableHash>& stable_hashes) {
+  std::ofstream output(get_outlined_sequences_path(dir));
+  output << OUTLINED_SEQUENCES_FORMAT_VERSION << "\n";
+  for (auto stable_hash : stable_hashes) {
+    output << (boost::format("%016x") % stable_hash).str() << "\n";
+  }
+}
+
 size_t count_affected_methods(
     const NewlyOutlinedMethods& newly_outlined_methods) {
   std::unordered_set<DexMethod*> methods;
@@ -3201,6 +3491,23 @@ void InstructionSequenceOutliner::bind_config() {
   bind("outline_from_primary_dex", m_config.outline_from_primary_dex,
        m_config.outline_from_primary_dex,
        "Whether to outline from primary dex");
+  bind("suffix_array_pruning", m_config.suffix_array_pruning,
+       m_config.suffix_array_pruning,
+       "Whether to bound the length of candidates by the longest recurring "
+       "instruction sequences, as found with a suffix array; this makes "
+       "larger max_insns_size values affordable");
+  bind("duplicate_blocks_max_insns_size",
+       m_config.duplicate_blocks_max_insns_size,
+       m_config.duplicate_blocks_max_insns_size,
+       "When larger than max_insns_size, blocks longer than max_insns_size "
+       "that recur in several methods, as found by cross-method block "
+       "deduplication, are explored as candidates of up to this many "
+       "instructions");
+  bind("persist_outlined_sequences", m_config.persist_outlined_sequences,
+       m_config.persist_outlined_sequences,
+       "Whether to record the outlined sequences in the incremental_cache_dir, "
+       "and to prefer outlining those sequences again in later runs, so that "
+       "the outlined methods stay consistent across builds");
   bind("full_dbg_positions", m_config.full_dbg_positions,
        m_config.full_dbg_positions,
        "Whether to encode all possible outlined positions");
@@ -3263,6 +3570,17 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
       ISO, 2,
       "[invoke sequence outliner] found %zu reserved trefs, %zu reserved mrefs",
       reserved_trefs, reserved_mrefs);
+  std::string cache_dir;
+  if (m_config.persist_outlined_sequences) {
+    config.get_json_config().get("incremental_cache_dir", "", cache_dir);
+  }
+  std::unordered_set<StableHash> previously_outlined;
+  if (!cache_dir.empty()) {
+    previously_outlined = load_outlined_sequences(cache_dir);
+    mgr.incr_metric("num_previously_outlined_sequences",
+                    previously_outlined.size());
+  }
+  std::set<StableHash> outlined_stable_hashes;
   ReusableOutlinedMethods outlined_methods;
   OutlinedMethodBodySetter outlined_method_body_setter(m_config, mgr);
   // keep track of the outlined methods and scope for reordering later
@@ -3303,8 +3621,8 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
         outlined_methods.order.clear();
       }
       last_store_idx = store_idx;
-      RefChecker ref_checker{&xstores, store_idx, min_sdk_api};
-      CandidateInstructionCoresSet recurring_cores;
+      RefChecker ref_checker{&xstores, store_idx, min_sdk_api, dex};
+      RecurringCores recurring_cores;
       ConcurrentMap<DexMethod*, CanOutlineBlockDecider> block_deciders;
       get_recurring_cores(m_config, mgr, dex, sufficiently_warm_methods,
                           sufficiently_hot_methods, ref_checker,
@@ -3322,7 +3640,8 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
       auto newly_outlined_methods =
           outline(m_config, mgr, dex_state, min_sdk, &candidates_with_infos,
                   &candidate_ids_by_methods, &outlined_methods, iteration,
-                  ab_experiment_context, &num_reused_methods);
+                  ab_experiment_context, &num_reused_methods,
+                  previously_outlined, &outlined_stable_hashes);
       outlined_methods_to_reorder.push_back({&dex, newly_outlined_methods});
       auto affected_methods = count_affected_methods(newly_outlined_methods);
       auto total_methods = clear_cfgs(dex);
@@ -3342,6 +3661,9 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
 
   ab_experiment_context->flush();
   mgr.incr_metric("num_reused_methods", num_reused_methods);
+  if (!cache_dir.empty()) {
+    save_outlined_sequences(cache_dir, outlined_stable_hashes);
+  }
 }
 
 static InstructionSequenceOutliner s_pass;
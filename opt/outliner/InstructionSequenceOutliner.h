@@ -40,6 +40,9 @@ struct Config {
   size_t max_outlined_methods_per_class{100};
   size_t savings_threshold{10};
   bool outline_from_primary_dex{false};
+  bool suffix_array_pruning{false};
+  size_t duplicate_blocks_max_insns_size{0};
+  bool persist_outlined_sequences{false};
   bool full_dbg_positions{false};
   bool debug_make_crashing{false};
 };
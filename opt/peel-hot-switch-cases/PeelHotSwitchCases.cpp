@@ -0,0 +1,318 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PeelHotSwitchCases.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "PassManager.h"
+#include "ScopedCFG.h"
+#include "Show.h"
+#include "SourceBlocks.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace switch_peeling {
+
+namespace {
+
+// A const and an if-eq. An if-eqz is enough for a zero key.
+constexpr double kCompareCost = 2;
+// A bounds check and a table lookup.
+constexpr double kPackedSwitchCost = 2;
+
+double compare_cost(int32_t key) { return key == 0 ? 1 : kCompareCost; }
+
+// The cost of the switch that instruction lowering would emit for the
+// (sorted) keys.
+double switch_cost(const std::vector<int32_t>& keys) {
+  if (keys.empty()) {
+    return 0;
+  }
+  uint64_t size = (uint64_t)((int64_t)keys.back() - keys.front() + 1);
+  bool sparse =
+      size > std::numeric_limits<uint16_t>::max() || size / 2 > keys.size();
+  if (!sparse) {
+    return kPackedSwitchCost;
+  }
+  return kPackedSwitchCost + std::ceil(std::log2(keys.size()));
+}
+
+// The sum of the values of the first source block of `block` over all the
+// interactions, if it has any.
+boost::optional<float> get_hits(const cfg::Block* block) {
+  const auto* sb = source_blocks::get_first_source_block(block);
+  if (sb == nullptr) {
+    return boost::none;
+  }
+  boost::optional<float> hits;
+  for (size_t i = 0; i < sb->vals.size(); ++i) {
+    auto val = sb->get_val(i);
+    if (val) {
+      hits = hits.value_or(0) + *val;
+    }
+  }
+  return hits;
+}
+
+struct Candidate {
+  cfg::Edge* edge;
+  float ratio;
+};
+
+// The hottest cases of the switch at the end of `block` that are worth
+// peeling, hottest first.
+std::vector<Candidate> choose_cases(const Config& config, cfg::Block* block) {
+  auto& cfg = block->cfg();
+  auto cases = cfg.get_succ_edges_of_type(block, cfg::EDGE_BRANCH);
+  if (cases.size() < config.min_cases) {
+    return {};
+  }
+  auto switch_hits = get_hits(block);
+  if (!switch_hits || *switch_hits <= 0) {
+    return {};
+  }
+
+  std::vector<Candidate> candidates;
+  for (auto* e : cases) {
+    auto* target = e->target();
+    // The hotness of a target that is reached some other way does not tell
+    // how often this case is taken.
+    if (target == block || target->preds().size() != 1) {
+      continue;
+    }
+    auto hits = get_hits(target);
+    if (!hits) {
+      continue;
+    }
+    float ratio = std::min(1.0f, *hits / *switch_hits);
+    if (ratio >= config.min_case_ratio) {
+      candidates.push_back(Candidate{e, ratio});
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.ratio > b.ratio;
+                   });
+  if (candidates.size() > config.max_peeled_cases) {
+    candidates.resize(config.max_peeled_cases);
+  }
+
+  // Find the number of peeled cases with the lowest expected cost.
+  std::vector<int32_t> keys;
+  keys.reserve(cases.size());
+  for (auto* e : cases) {
+    keys.push_back(*e->case_key());
+  }
+  std::sort(keys.begin(), keys.end());
+  double best_cost = switch_cost(keys);
+  size_t best_num = 0;
+  double peeled_cost = 0;
+  double compares = 0;
+  double remaining = 1;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    int32_t key = *candidates[i].edge->case_key();
+    compares += compare_cost(key);
+    peeled_cost += candidates[i].ratio * compares;
+    remaining = std::max(0.0, remaining - candidates[i].ratio);
+    keys.erase(std::lower_bound(keys.begin(), keys.end(), key));
+    double cost = peeled_cost + remaining * (compares + switch_cost(keys));
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_num = i + 1;
+    }
+  }
+  candidates.resize(best_num);
+  return candidates;
+}
+
+// Gives `block` a copy of `sb` whose values are scaled by `share`, the part of
+// the executions of the switch that reach the block.
+void add_source_block(cfg::ControlFlowGraph& cfg,
+                      cfg::Block* block,
+                      const SourceBlock* sb,
+                      float share) {
+  if (sb == nullptr) {
+    return;
+  }
+  auto copy = std::make_unique<SourceBlock>(*sb);
+  for (auto& val : copy->vals) {
+    val.scale(share);
+  }
+  cfg.insert_before(block->to_cfg_instruction_iterator(block->get_first_insn()),
+                    std::move(copy));
+}
+
+void peel(cfg::ControlFlowGraph& cfg,
+          cfg::Block* block,
+          const std::vector<Candidate>& candidates) {
+  auto switch_it = block->get_last_insn();
+  auto* switch_insn = switch_it->insn;
+  auto key_reg = switch_insn->src(0);
+  // The values of the switch before they get scaled below.
+  std::unique_ptr<SourceBlock> switch_sb;
+  if (const auto* sb = source_blocks::get_first_source_block(block)) {
+    switch_sb = std::make_unique<SourceBlock>(*sb);
+    switch_sb->next.reset();
+  }
+
+  // The part of the executions of the switch that get past each compare.
+  std::vector<float> shares;
+  float share = 1;
+  for (const auto& candidate : candidates) {
+    shares.push_back(share);
+    share = std::max(0.0f, share - candidate.ratio);
+  }
+
+  // Isolate the switch in its own block, so that all the paths to it go
+  // through the compares first.
+  cfg::Block* switch_block = block;
+  if (block->get_first_insn()->insn != switch_insn) {
+    switch_block = cfg.split_block(block, std::prev(switch_it));
+  }
+  if (switch_block != block) {
+    add_source_block(cfg, switch_block, switch_sb.get(), share);
+  } else {
+    // Only the executions that get past the compares reach the switch now.
+    source_blocks::foreach_source_block(switch_block, [&](auto* sb) {
+      for (auto& val : sb->vals) {
+        val.scale(share);
+      }
+    });
+  }
+  auto preds = switch_block->preds();
+
+  // Build the chain from its end, so that each compare can fall through to
+  // the next one.
+  boost::optional<reg_t> temp;
+  cfg::Block* next = switch_block;
+  for (auto it = candidates.rbegin(); it != candidates.rend(); ++it) {
+    auto* edge = it->edge;
+    int32_t key = *edge->case_key();
+    auto* target = edge->target();
+    cfg.delete_edge(edge);
+
+    auto* compare = cfg.create_block();
+    IRInstruction* branch;
+    if (key == 0) {
+      branch = (new IRInstruction(OPCODE_IF_EQZ))->set_src(0, key_reg);
+    } else {
+      if (!temp) {
+        temp = cfg.allocate_temp();
+      }
+      compare->push_back(
+          (new IRInstruction(OPCODE_CONST))->set_literal(key)->set_dest(*temp));
+      branch = (new IRInstruction(OPCODE_IF_EQ))
+                   ->set_src(0, key_reg)
+                   ->set_src(1, *temp);
+    }
+    cfg.create_branch(compare, branch, next, target);
+    add_source_block(cfg, compare, switch_sb.get(),
+                     shares[candidates.rend() - it - 1]);
+    TRACE(SWITCH_PEEL, 5, "Peeled case %d (%.2f) of %s", key, it->ratio,
+          SHOW(switch_insn));
+    next = compare;
+  }
+  for (auto* e : preds) {
+    cfg.set_edge_target(e, next);
+  }
+}
+
+bool has_switch(IRCode* code) {
+  for (const auto& mie : InstructionIterable(*code)) {
+    if (opcode::is_switch(mie.insn->opcode())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+Stats& Stats::operator+=(const Stats& that) {
+  switches += that.switches;
+  switches_with_profile += that.switches_with_profile;
+  switches_peeled += that.switches_peeled;
+  peeled_cases += that.peeled_cases;
+  return *this;
+}
+
+Stats peel_hot_cases(const Config& config, DexMethod* method) {
+  Stats stats;
+  auto code = method->get_code();
+  if (!code || method->rstate.no_optimizations() || !has_switch(code)) {
+    return stats;
+  }
+  cfg::ScopedCFG cfg(code);
+  std::vector<cfg::Block*> switch_blocks;
+  for (auto* block : cfg->blocks()) {
+    auto last = block->get_last_insn();
+    if (last != block->end() && opcode::is_switch(last->insn->opcode())) {
+      switch_blocks.push_back(block);
+    }
+  }
+  for (auto* block : switch_blocks) {
+    stats.switches++;
+    if (get_hits(block).value_or(0) > 0) {
+      stats.switches_with_profile++;
+    }
+    // Nothing can go ahead of a switch that starts the entry block. It would
+    // not have a key to switch on anyway.
+    if (block == cfg->entry_block() &&
+        block->get_first_insn()->insn == block->get_last_insn()->insn) {
+      continue;
+    }
+    auto candidates = choose_cases(config, block);
+    if (candidates.empty()) {
+      continue;
+    }
+    peel(*cfg, block, candidates);
+    stats.switches_peeled++;
+    stats.peeled_cases += candidates.size();
+  }
+  return stats;
+}
+
+} // namespace switch_peeling
+
+void PeelHotSwitchCasesPass::bind_config() {
+  bind("min_cases", m_config.min_cases, m_config.min_cases,
+       "Minimum number of cases of a switch for its cases to be peeled");
+  bind("max_peeled_cases", m_config.max_peeled_cases,
+       m_config.max_peeled_cases,
+       "Maximum number of cases peeled out of a single switch");
+  bind("min_case_ratio", m_config.min_case_ratio, m_config.min_case_ratio,
+       "Minimum fraction of the executions of a switch that a case needs to "
+       "take to be peeled");
+}
+
+void PeelHotSwitchCasesPass::run_pass(DexStoresVector& stores,
+                                      ConfigFiles& /* conf */,
+                                      PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = walk::parallel::methods<switch_peeling::Stats>(
+      scope, [&](DexMethod* method) {
+        return switch_peeling::peel_hot_cases(m_config, method);
+      });
+
+  mgr.set_metric("switches", stats.switches);
+  mgr.set_metric("switches_with_profile", stats.switches_with_profile);
+  mgr.set_metric("switches_peeled", stats.switches_peeled);
+  mgr.set_metric("peeled_cases", stats.peeled_cases);
+}
+
+static PeelHotSwitchCasesPass s_pass;
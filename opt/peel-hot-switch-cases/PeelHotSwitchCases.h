@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "Pass.h"
+
+class DexMethod;
+
+namespace switch_peeling {
+
+struct Config {
+  // Smaller switches are cheap enough to dispatch as they are.
+  uint32_t min_cases{8};
+  // Each peeled case costs a compare and a branch to every other case.
+  uint32_t max_peeled_cases{3};
+  // The fraction of the executions of a switch that a case needs to take to
+  // be considered for peeling.
+  float min_case_ratio{0.2f};
+};
+
+struct Stats {
+  size_t switches{0};
+  size_t switches_with_profile{0};
+  size_t switches_peeled{0};
+  size_t peeled_cases{0};
+
+  Stats& operator+=(const Stats& that);
+};
+
+/*
+ * Moves the hottest cases of the switches of `method` into a chain of
+ * compares ahead of the switch, according to the source block profile and a
+ * cost model of the dispatch. It is safe to call concurrently for different
+ * methods.
+ */
+Stats peel_hot_cases(const Config& config, DexMethod* method);
+
+} // namespace switch_peeling
+
+/*
+ * The interpreter dispatches a packed switch with a bounds check and a table
+ * lookup, and a sparse switch with a binary search over its keys. When one or
+ * two cases of a big switch take most of its executions, as in generated
+ * routers, testing them first with an if-chain is cheaper on average.
+ *
+ * For every switch with at least `min_cases` cases and a profile, the cases
+ * whose target is only reached from the switch are ordered by the hotness of
+ * that target. Up to `max_peeled_cases` of the hottest ones are peeled, as
+ * many as minimize the expected cost of the dispatch:
+ *
+ *   sum over the peeled cases i of p_i * (cost of the compares up to i)
+ *     + (1 - sum of the p_i) * (cost of all compares + cost of the switch)
+ *
+ * where p_i is the hotness of the case relative to the switch block, a
+ * compare with a non-zero key costs a const and an if-eq, and a sparse
+ * switch costs one more step per halving of its keys than a packed one. The
+ * remaining switch is still lowered to a packed or sparse table by density.
+ */
+class PeelHotSwitchCasesPass : public Pass {
+ public:
+  PeelHotSwitchCasesPass() : Pass("PeelHotSwitchCasesPass") {}
+
+  void bind_config() override;
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+ private:
+  switch_peeling::Config m_config;
+};
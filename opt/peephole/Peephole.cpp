@@ -8,6 +8,7 @@
 #include "Peephole.h"
 
 #include <algorithm>
+#include <bitset>
 #include <cinttypes>
 #include <cmath>
 #include <iostream>
@@ -17,12 +18,16 @@
 #include <utility>
 #include <vector>
 
+#include <boost/functional/hash.hpp>
+
 #include "CFGMutation.h"
+#include "ConfigFiles.h"
 #include "ControlFlow.h"
 #include "DexClass.h"
 #include "DexInstruction.h"
 #include "DexUtil.h"
 #include "IRInstruction.h"
+#include "IncrementalPassCache.h"
 #include "PassManager.h"
 #include "RedundantCheckCastRemover.h"
 #include "Show.h"
@@ -1685,11 +1690,40 @@ bool contains(const std::vector<T>& vec, const T& value) {
   return std::find(vec.begin(), vec.end(), value) != vec.end();
 }
 
+constexpr size_t kNumIROpcodes = 0
+#define OP(...) +1
+#define IOP(...) +1
+#define OPRANGE(...)
+#include "IROpcodes.def"
+    ;
+
+using OpcodeSet = std::bitset<kNumIROpcodes>;
+
+OpcodeSet to_opcode_set(const std::unordered_set<uint16_t>& opcodes) {
+  OpcodeSet set;
+  for (auto op : opcodes) {
+    set.set(op);
+  }
+  return set;
+}
+
+OpcodeSet opcodes_of(const cfg::ControlFlowGraph& cfg) {
+  OpcodeSet set;
+  for (const auto& mie : cfg::ConstInstructionIterable(cfg)) {
+    set.set(mie.insn->opcode());
+  }
+  return set;
+}
+
 // Each thread will have its own instance of PeepholeOptimizer, so align it in
 // order to avoid false sharing.
 class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
  private:
   std::vector<Matcher> m_matchers;
+  // For each matcher, the opcodes accepted by each instruction of its match.
+  // A pattern can only apply to a method that has an instruction for every
+  // one of them, which rules out most patterns without running the matcher.
+  std::vector<std::vector<OpcodeSet>> m_match_opcodes;
   std::vector<size_t> m_stats;
   PassManager& m_mgr;
   int m_stats_removed = 0;
@@ -1715,6 +1749,11 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
       for (const Pattern& pattern : pattern_list) {
         if (!contains(disabled_peepholes, pattern.name)) {
           m_matchers.emplace_back(pattern);
+          std::vector<OpcodeSet> match_opcodes;
+          for (const auto& dex_pattern : pattern.match) {
+            match_opcodes.push_back(to_opcode_set(dex_pattern.opcodes));
+          }
+          m_match_opcodes.push_back(std::move(match_opcodes));
         } else {
           TRACE(PEEPHOLE,
                 2,
@@ -1734,10 +1773,23 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
     code->build_cfg(/* editable */ true);
     auto& cfg = code->cfg();
 
+    // The replacements may introduce new opcodes, so this is recomputed after
+    // every pattern that changed the method.
+    auto method_opcodes = opcodes_of(cfg);
+
     // do optimizations one at a time
     // so they can match on the same pattern without interfering
     for (size_t i = 0; i < m_matchers.size(); ++i) {
+      const auto& match_opcodes = m_match_opcodes[i];
+      if (std::any_of(match_opcodes.begin(), match_opcodes.end(),
+                      [&](const OpcodeSet& opcodes) {
+                        return (opcodes & method_opcodes).none();
+                      })) {
+        continue;
+      }
       auto& matcher = m_matchers[i];
+      const auto& first_opcodes = match_opcodes[0];
+      bool changed = false;
 
       const auto& blocks = cfg.blocks();
       cfg::CFGMutation mutator(cfg);
@@ -1752,6 +1804,11 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
         std::unordered_set<IRInstruction*> removed_insns;
 
         for (auto& mie : InstructionIterable(block)) {
+          // Nothing is matched yet, so only the first opcode can start a match.
+          if (matcher.match_index == 0 &&
+              !first_opcodes.test(mie.insn->opcode())) {
+            continue;
+          }
           if (!matcher.try_match(mie.insn)) {
             continue;
           }
@@ -1789,11 +1846,15 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
                                matcher.matched_instructions.end());
           m_stats_removed += matcher.match_index;
           matcher.reset();
+          changed = true;
         }
       }
 
       // Apply the mutator.
       mutator.flush();
+      if (changed) {
+        method_opcodes = opcodes_of(cfg);
+      }
     }
 
     code->clear_cfg();
@@ -1838,7 +1899,7 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
 } // namespace
 
 void PeepholePass::run_pass(DexStoresVector& stores,
-                            ConfigFiles& /*cfg*/,
+                            ConfigFiles& conf,
                             PassManager& mgr) {
   auto scope = build_class_scope(stores);
   auto num_threads = redex_parallel::default_num_threads();
@@ -1849,25 +1910,46 @@ void PeepholePass::run_pass(DexStoresVector& stores,
         mgr, pats, config.disabled_peepholes));
   }
 
-  workqueue_run<DexClass*>(
-      [&peephole_optimizers](sparta::SpartaWorkerState<DexClass*>* state,
-                             DexClass* cls) {
+  // The patterns only look at the instructions of the method they rewrite.
+  // RedundantCheckCastRemover below is not, and is always run.
+  std::string cache_dir;
+  conf.get_json_config().get("incremental_cache_dir", "", cache_dir);
+  std::unique_ptr<incremental::NoOpCache> cache;
+  if (!cache_dir.empty()) {
+    auto disabled = config.disabled_peepholes;
+    std::sort(disabled.begin(), disabled.end());
+    cache = std::make_unique<incremental::NoOpCache>(
+        name(), boost::hash_value(disabled));
+    cache->load(cache_dir);
+  }
+
+  // Run over the methods rather than the classes, and schedule the biggest
+  // methods first, so that a few huge methods do not end up last on a thread.
+  std::vector<DexMethod*> methods;
+  walk::code(scope, [&](DexMethod* m, IRCode&) { methods.push_back(m); });
+  workqueue_run_by_cost<DexMethod*>(
+      [&](sparta::SpartaWorkerState<DexMethod*>* state, DexMethod* m) {
         auto& ph = peephole_optimizers[state->worker_id()];
-        for (const auto& m : cls->get_dmethods()) {
-          TraceContext context(m);
-          ph->run_method(m);
-        }
-        for (const auto& m : cls->get_vmethods()) {
-          TraceContext context(m);
-          ph->run_method(m);
-        }
+        TraceContext context(m);
+        mgr.run_on_changed_method(m, [&] {
+          if (cache) {
+            cache->run(m, [&] { ph->run_method(m); });
+          } else {
+            ph->run_method(m);
+          }
+        });
       },
-      scope,
+      methods,
+      [](DexMethod* m) { return m->get_code()->sum_opcode_sizes(); },
       num_threads);
 
   for (size_t i = 0; i < num_threads; ++i) {
     peephole_optimizers[i]->incr_all_metrics();
   }
+  if (cache) {
+    mgr.incr_metric("num_incremental_cache_hits", cache->hits());
+    cache->save(cache_dir);
+  }
 
   if (!contains<std::string>(config.disabled_peepholes,
                              RedundantCheckCastRemover::get_name())) {
@@ -16,6 +16,10 @@ class PeepholePass : public Pass {
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
+  bool is_method_local() const override { return true; }
+
+  uint8_t writes() const override { return CODE; }
+
   void bind_config() override {
     bind("disabled_peepholes", {}, config.disabled_peepholes);
   }
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
 #include "DexClass.h"
 #include "DexUtil.h"
 #include "Pass.h"
@@ -52,6 +53,11 @@ class PrintKotlinStats : public Pass {
   void setup();
   void eval_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.set_preserve_all();
+  }
+  uint8_t reads() const override { return CLASSES | CODE; }
+  uint8_t writes() const override { return NO_PARTS; }
   Stats handle_method(DexMethod* method);
   Stats handle_class(DexClass* cls);
   Stats get_stats() { return m_stats; }
@@ -14,6 +14,7 @@
 #include "CFGMutation.h"
 #include "ConstantAbstractDomain.h"
 #include "ControlFlow.h"
+#include "DexInstruction.h"
 #include "HashedSetAbstractDomain.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
@@ -35,6 +36,10 @@ constexpr const char* METRIC_FILLED_ARRAYS = "num_filled_arrays";
 constexpr const char* METRIC_FILLED_ARRAY_ELEMENTS =
     "num_filled_array_elements";
 constexpr const char* METRIC_FILLED_ARRAY_CHUNKS = "num_filled_array_chunks";
+constexpr const char* METRIC_FILLED_ARRAY_DATA_ARRAYS =
+    "num_filled_array_data_arrays";
+constexpr const char* METRIC_FILLED_ARRAY_DATA_ELEMENTS =
+    "num_filled_array_data_elements";
 constexpr const char* METRIC_REMAINING_WIDE_ARRAYS =
     "num_remaining_wide_arrays";
 constexpr const char* METRIC_REMAINING_WIDE_ARRAY_ELEMENTS =
@@ -49,7 +54,7 @@ constexpr const char* METRIC_REMAINING_BUGGY_ARRAY_ELEMENTS =
     "num_remaining_buggy_array_elements";
 
 /* A tracked value is...
- * - a 32-bit literal,
+ * - a 32-bit or 64-bit literal,
  * - or a new-array instruction that was reached with a well-known array length,
  *   and has been followed by a number of aput instructions that initialized the
  *   individual array elements in order, or
@@ -61,7 +66,7 @@ enum TrackedValueKind : uint32_t { Other, Literal, NewArray };
 struct TrackedValue {
   TrackedValueKind kind;
   union {
-    int32_t literal; // for kind == Literal
+    int64_t literal; // for kind == Literal
     uint32_t length; // for kind == NewArray
   };
   // The following are only used for kind == NewArray
@@ -109,16 +114,19 @@ TrackedValue make_other() {
 }
 
 TrackedValue make_literal(const IRInstruction* instr) {
-  always_assert(instr->opcode() == OPCODE_CONST);
+  always_assert(instr->opcode() == OPCODE_CONST ||
+                instr->opcode() == OPCODE_CONST_WIDE);
   always_assert(instr->has_literal());
   return (TrackedValue){
-      TrackedValueKind::Literal, {(int32_t)instr->get_literal()}, nullptr};
+      TrackedValueKind::Literal, {instr->get_literal()}, nullptr};
 }
 
 TrackedValue make_array(int32_t length, const IRInstruction* instr) {
   always_assert(length >= 0);
   always_assert(instr->opcode() == OPCODE_NEW_ARRAY);
-  return (TrackedValue){TrackedValueKind::NewArray, {length}, instr};
+  TrackedValue tv{TrackedValueKind::NewArray, {0}, instr};
+  tv.length = length;
+  return tv;
 }
 
 bool is_new_array(const TrackedValue& tv) {
@@ -177,6 +185,7 @@ using TrackedDomain =
     sparta::HashedSetAbstractDomain<TrackedValue, TrackedValueHasher>;
 using EscapedArrayDomain =
     sparta::ConstantAbstractDomain<std::vector<const IRInstruction*>>;
+using AputLiteralDomain = sparta::ConstantAbstractDomain<int64_t>;
 
 /**
  * For each register that holds a relevant value, keep track of it.
@@ -257,6 +266,11 @@ class Analyzer final : public BaseIRAnalyzer<TrackedDomainEnvironment> {
                            TrackedDomain(make_literal(insn)));
       break;
 
+    case OPCODE_CONST_WIDE:
+      set_current_state_at(insn->dest(), true /* is_wide */,
+                           TrackedDomain(make_literal(insn)));
+      break;
+
     case OPCODE_NEW_ARRAY: {
       TRACE(RAL, 4, "[RAL]   new array of type %s", SHOW(insn->get_type()));
       const auto length = get_singleton(current_state->get(insn->src(0)));
@@ -288,6 +302,18 @@ class Analyzer final : public BaseIRAnalyzer<TrackedDomainEnvironment> {
     case OPCODE_APUT_OBJECT:
     case OPCODE_APUT_BOOLEAN: {
       escape_new_arrays(insn->src(0));
+      // remember the stored value, in case the array can be filled from a
+      // fill-array-data payload
+      const auto value = get_singleton(current_state->get(insn->src(0)));
+      auto aput_literal = value && is_literal(*value)
+                              ? AputLiteralDomain(get_literal(*value))
+                              : AputLiteralDomain::top();
+      auto literal_it = m_aput_literals.find(insn);
+      if (literal_it == m_aput_literals.end()) {
+        m_aput_literals.emplace(insn, aput_literal);
+      } else {
+        literal_it->second.join_with(aput_literal);
+      }
       const auto array = get_singleton(current_state->get(insn->src(1)));
       const auto index = get_singleton(current_state->get(insn->src(2)));
       TRACE(RAL, 4, "[RAL]   aput: %d %d", array && is_new_array(*array),
@@ -311,10 +337,11 @@ class Analyzer final : public BaseIRAnalyzer<TrackedDomainEnvironment> {
       break;
     }
 
-    case OPCODE_MOVE: {
+    case OPCODE_MOVE:
+    case OPCODE_MOVE_WIDE: {
       const auto value = get_singleton(current_state->get(insn->src(0)));
       if (value && is_literal(*value)) {
-        set_current_state_at(insn->dest(), false /* is_wide */,
+        set_current_state_at(insn->dest(), insn->dest_is_wide(),
                              TrackedDomain(*value));
         break;
       }
@@ -343,21 +370,47 @@ class Analyzer final : public BaseIRAnalyzer<TrackedDomainEnvironment> {
     return result;
   }
 
+  std::unordered_map<const IRInstruction*, int64_t> get_aput_literals() {
+    std::unordered_map<const IRInstruction*, int64_t> result;
+    for (auto& p : m_aput_literals) {
+      auto constant = p.second.get_constant();
+      if (constant) {
+        result.emplace(p.first, *constant);
+      }
+    }
+    return result;
+  }
+
  private:
   mutable std::unordered_map<const IRInstruction*, EscapedArrayDomain>
       m_escaped_arrays;
+  mutable std::unordered_map<const IRInstruction*, AputLiteralDomain>
+      m_aput_literals;
 };
 
+template <typename IntType>
+DexOpcodeData* encode_literals(const std::vector<int64_t>& literals) {
+  std::vector<IntType> values;
+  values.reserve(literals.size());
+  for (auto literal : literals) {
+    values.push_back((IntType)literal);
+  }
+  return encode_fill_array_data_payload(values);
+}
+
 } // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
 
-ReduceArrayLiterals::ReduceArrayLiterals(cfg::ControlFlowGraph& cfg,
-                                         size_t max_filled_elements,
-                                         int32_t min_sdk,
-                                         Architecture arch)
+ReduceArrayLiterals::ReduceArrayLiterals(
+    cfg::ControlFlowGraph& cfg,
+    size_t max_filled_elements,
+    size_t min_fill_array_data_elements,
+    int32_t min_sdk,
+    Architecture arch)
     : m_cfg(cfg),
       m_max_filled_elements(max_filled_elements),
+      m_min_fill_array_data_elements(min_fill_array_data_elements),
       m_min_sdk(min_sdk),
       m_arch(arch) {
 
@@ -383,6 +436,7 @@ ReduceArrayLiterals::ReduceArrayLiterals(cfg::ControlFlowGraph& cfg,
     }
   }
   always_assert(array_literals.size() == m_array_literals.size());
+  m_aput_literals = analyzer.get_aput_literals();
 }
 
 void ReduceArrayLiterals::patch() {
@@ -397,6 +451,17 @@ void ReduceArrayLiterals::patch() {
     auto type = new_array_insn->get_type();
     auto element_type = type::get_array_component_type(type);
 
+    // fill-array-data works for all primitive arrays, including wide ones, on
+    // all Android versions, and its payload takes less space than the
+    // individual aput instructions once there are enough elements.
+    if (type::is_primitive(element_type) &&
+        aput_insns.size() >= m_min_fill_array_data_elements &&
+        patch_fill_array_data(new_array_insn, aput_insns)) {
+      m_stats.filled_array_data_arrays++;
+      m_stats.filled_array_data_elements += aput_insns.size();
+      continue;
+    }
+
     if (m_min_sdk < 24) {
       // See T45708995.
       //
@@ -468,6 +533,59 @@ void ReduceArrayLiterals::patch() {
   }
 }
 
+bool ReduceArrayLiterals::patch_fill_array_data(
+    const IRInstruction* new_array_insn,
+    const std::vector<const IRInstruction*>& aput_insns) {
+  std::vector<int64_t> literals;
+  literals.reserve(aput_insns.size());
+  for (const IRInstruction* aput_insn : aput_insns) {
+    auto it = m_aput_literals.find(aput_insn);
+    if (it == m_aput_literals.end()) {
+      return false;
+    }
+    literals.push_back(it->second);
+  }
+
+  auto element_type =
+      type::get_array_component_type(new_array_insn->get_type());
+  DexOpcodeData* data;
+  if (element_type == type::_boolean() || element_type == type::_byte()) {
+    data = encode_literals<int8_t>(literals);
+  } else if (element_type == type::_char() || element_type == type::_short()) {
+    data = encode_literals<int16_t>(literals);
+  } else if (element_type == type::_int() || element_type == type::_float()) {
+    data = encode_literals<int32_t>(literals);
+  } else {
+    always_assert(type::is_wide_type(element_type));
+    data = encode_literals<int64_t>(literals);
+  }
+
+  // replace the last aput instruction with the fill-array-data instruction,
+  // and remove all other aput instructions; the array does not escape before
+  // the last aput, so the order of the stores is unobservable, and any
+  // unrelated instructions in between can stay where they are
+  auto* last_aput_insn = const_cast<IRInstruction*>(aput_insns.back());
+  IRInstruction* fill_array_data_insn =
+      new IRInstruction(OPCODE_FILL_ARRAY_DATA);
+  fill_array_data_insn->set_src(0, last_aput_insn->src(1));
+  fill_array_data_insn->set_data(data);
+
+  cfg::CFGMutation mutation(m_cfg);
+  std::unordered_set<const IRInstruction*> aput_insns_set(aput_insns.begin(),
+                                                          aput_insns.end());
+  auto iterable = cfg::InstructionIterable(m_cfg);
+  for (auto it = iterable.begin(); it != iterable.end(); ++it) {
+    auto* insn = it->insn;
+    if (insn == last_aput_insn) {
+      mutation.replace(it, {fill_array_data_insn});
+    } else if (aput_insns_set.count(insn)) {
+      mutation.remove(it);
+    }
+  }
+  mutation.flush();
+  return true;
+}
+
 void ReduceArrayLiterals::patch_new_array(
     const IRInstruction* new_array_insn,
     const std::vector<const IRInstruction*>& aput_insns) {
@@ -653,6 +771,11 @@ void ReduceArrayLiteralsPass::bind_config() {
   // runtime, while also being reasonably large so that this optimization still
   // results in a significant win in terms of instructions count.
   bind("max_filled_elements", 27, m_max_filled_elements);
+  // A fill-array-data payload has a fixed overhead of 7 code units, while each
+  // element initialized with a const and an aput takes at least 3; from about
+  // 8 elements on, the payload is smaller for all element types but wide ones,
+  // and it is always much faster to execute.
+  bind("min_fill_array_data_elements", 8, m_min_fill_array_data_elements);
   after_configuration([this] {
     always_assert(m_max_filled_elements < 0xff);
     interdex::InterDexRegistry* registry =
@@ -685,8 +808,8 @@ void ReduceArrayLiteralsPass::run_pass(DexStoresVector& stores,
         }
 
         code->build_cfg(/* editable */ true);
-        ReduceArrayLiterals ral(code->cfg(), m_max_filled_elements, min_sdk,
-                                arch);
+        ReduceArrayLiterals ral(code->cfg(), m_max_filled_elements,
+                                m_min_fill_array_data_elements, min_sdk, arch);
         ral.patch();
         code->clear_cfg();
         return ral.get_stats();
@@ -695,6 +818,10 @@ void ReduceArrayLiteralsPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric(METRIC_FILLED_ARRAYS, stats.filled_arrays);
   mgr.incr_metric(METRIC_FILLED_ARRAY_ELEMENTS, stats.filled_array_elements);
   mgr.incr_metric(METRIC_FILLED_ARRAY_CHUNKS, stats.filled_array_chunks);
+  mgr.incr_metric(METRIC_FILLED_ARRAY_DATA_ARRAYS,
+                  stats.filled_array_data_arrays);
+  mgr.incr_metric(METRIC_FILLED_ARRAY_DATA_ELEMENTS,
+                  stats.filled_array_data_elements);
   mgr.incr_metric(METRIC_REMAINING_WIDE_ARRAYS, stats.remaining_wide_arrays);
   mgr.incr_metric(METRIC_REMAINING_WIDE_ARRAY_ELEMENTS,
                   stats.remaining_wide_array_elements);
@@ -712,6 +839,8 @@ ReduceArrayLiterals::Stats& ReduceArrayLiterals::Stats::operator+=(
   filled_arrays += that.filled_arrays;
   filled_array_elements += that.filled_array_elements;
   filled_array_chunks += that.filled_array_chunks;
+  filled_array_data_arrays += that.filled_array_data_arrays;
+  filled_array_data_elements += that.filled_array_data_elements;
   remaining_wide_arrays += that.remaining_wide_arrays;
   remaining_wide_array_elements += that.remaining_wide_array_elements;
   remaining_unimplemented_arrays += that.remaining_unimplemented_arrays;
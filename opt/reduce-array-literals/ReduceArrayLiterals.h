@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
 #include "IRInstruction.h" // For reg_t.
@@ -25,6 +26,8 @@ class ReduceArrayLiterals {
     size_t filled_arrays{0};
     size_t filled_array_chunks{0};
     size_t filled_array_elements{0};
+    size_t filled_array_data_arrays{0};
+    size_t filled_array_data_elements{0};
     size_t remaining_wide_arrays{0};
     size_t remaining_wide_array_elements{0};
     size_t remaining_unimplemented_arrays{0};
@@ -35,8 +38,13 @@ class ReduceArrayLiterals {
     Stats& operator+=(const Stats&);
   };
 
+  /*
+   * Primitive arrays of at least `min_fill_array_data_elements` literal
+   * elements are filled from a fill-array-data payload instead.
+   */
   ReduceArrayLiterals(cfg::ControlFlowGraph&,
                       size_t max_filled_elements,
+                      size_t min_fill_array_data_elements,
                       int32_t min_sdk,
                       Architecture arch);
 
@@ -48,6 +56,9 @@ class ReduceArrayLiterals {
   void patch();
 
  private:
+  bool patch_fill_array_data(
+      const IRInstruction* new_array_insn,
+      const std::vector<const IRInstruction*>& aput_insns);
   void patch_new_array(const IRInstruction* new_array_insn,
                        const std::vector<const IRInstruction*>& aput_insns);
   size_t patch_new_array_chunk(
@@ -59,12 +70,14 @@ class ReduceArrayLiterals {
       std::vector<reg_t>* temp_regs);
   cfg::ControlFlowGraph& m_cfg;
   size_t m_max_filled_elements;
+  size_t m_min_fill_array_data_elements;
   int32_t m_min_sdk;
   std::vector<reg_t> m_local_temp_regs;
   Stats m_stats;
   std::vector<
       std::pair<const IRInstruction*, std::vector<const IRInstruction*>>>
       m_array_literals;
+  std::unordered_map<const IRInstruction*, int64_t> m_aput_literals;
   Architecture m_arch;
 };
 
@@ -77,5 +90,6 @@ class ReduceArrayLiteralsPass : public Pass {
 
  private:
   size_t m_max_filled_elements;
+  size_t m_min_fill_array_data_elements;
   bool m_debug;
 };
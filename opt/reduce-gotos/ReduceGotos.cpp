@@ -26,12 +26,14 @@
 
 #include <vector>
 
+#include "ConfigFiles.h"
 #include "ControlFlow.h"
 #include "DexClass.h"
 #include "DexUtil.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "IROpcode.h"
+#include "IncrementalPassCache.h"
 #include "Liveness.h"
 #include "PassManager.h"
 #include "Show.h"
@@ -61,6 +63,8 @@ constexpr const char* METRIC_INVERTED_CONDITIONAL_BRANCHES =
     "num_inverted_conditional_branches";
 constexpr const char* METRIC_NUM_GOTOS_REPLACED_WITH_THROWS =
     "num_gotos_replaced_with_throws";
+constexpr const char* METRIC_INCREMENTAL_CACHE_HITS =
+    "num_incremental_cache_hits";
 
 } // namespace
 
@@ -492,17 +496,35 @@ ReduceGotosPass::Stats ReduceGotosPass::process_code(IRCode* code) {
 }
 
 void ReduceGotosPass::run_pass(DexStoresVector& stores,
-                               ConfigFiles& /* unused */,
+                               ConfigFiles& conf,
                                PassManager& mgr) {
   auto scope = build_class_scope(stores);
 
-  Stats stats = walk::parallel::methods<Stats>(scope, [](DexMethod* method) {
+  // The pass has no options, and only looks at the code of each method.
+  std::string cache_dir;
+  conf.get_json_config().get("incremental_cache_dir", "", cache_dir);
+  std::unique_ptr<incremental::NoOpCache> cache;
+  if (!cache_dir.empty()) {
+    cache = std::make_unique<incremental::NoOpCache>(name(),
+                                                     /* config_hash */ 0);
+    cache->load(cache_dir);
+  }
+
+  Stats stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
     const auto code = method->get_code();
     if (!code) {
       return Stats{};
     }
 
-    Stats stats = ReduceGotosPass::process_code(code);
+    Stats stats;
+    mgr.run_on_changed_method(method, [&] {
+      if (cache) {
+        cache->run(method,
+                   [&] { stats = ReduceGotosPass::process_code(code); });
+      } else {
+        stats = ReduceGotosPass::process_code(code);
+      }
+    });
     if (stats.replaced_gotos_with_returns ||
         stats.inverted_conditional_branches) {
       TRACE(RG, 3,
@@ -535,6 +557,10 @@ void ReduceGotosPass::run_pass(DexStoresVector& stores,
                   stats.inverted_conditional_branches);
   mgr.incr_metric(METRIC_NUM_GOTOS_REPLACED_WITH_THROWS,
                   stats.replaced_gotos_with_throws);
+  if (cache) {
+    mgr.incr_metric(METRIC_INCREMENTAL_CACHE_HITS, cache->hits());
+    cache->save(cache_dir);
+  }
   TRACE(RG, 1,
         "[reduce gotos] Replaced %zu gotos with returns, inverted %zu "
         "conditional brnaches in total",
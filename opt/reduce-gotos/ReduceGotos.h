@@ -34,6 +34,10 @@ class ReduceGotosPass : public Pass {
 
   ReduceGotosPass() : Pass("ReduceGotosPass") {}
 
+  bool is_method_local() const override { return true; }
+
+  uint8_t writes() const override { return CODE; }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   static Stats process_code(IRCode*);
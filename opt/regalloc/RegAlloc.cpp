@@ -29,11 +29,14 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   graph_coloring::Allocator::Config allocator_config;
   const auto& jw = mgr.get_current_pass_info()->config;
   jw.get("live_range_splitting", false, allocator_config.use_splitting);
+  jw.get("linear_scan_threshold", 0, allocator_config.linear_scan_threshold);
+  jw.get("prefer_small_encodings", true,
+         allocator_config.prefer_small_encodings);
   allocator_config.no_overwrite_this =
       mgr.get_redex_options().no_overwrite_this();
 
   auto scope = build_class_scope(stores);
-  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
+  auto stats = walk::parallel::methods_by_cost<Stats>(scope, [&](DexMethod* m) {
     return graph_coloring::allocate(allocator_config, m);
   });
 
@@ -46,12 +49,20 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   TRACE(REG, 1, "  Total splits: %lu", stats.split_moves);
   TRACE(REG, 1, "Total coalesce count: %lu", stats.moves_coalesced);
   TRACE(REG, 1, "Total net moves: %ld", stats.net_moves());
+  TRACE(REG, 1, "Linear scan methods: %lu", stats.linear_scan_methods);
+  TRACE(REG, 1, "  Linear scan moves: %lu", stats.linear_scan_moves);
+  TRACE(REG, 1, "Large register code units: %lu",
+        stats.large_register_code_units);
 
   mgr.incr_metric("param spilled too early", stats.params_spill_early);
   mgr.incr_metric("reiteration_count", stats.reiteration_count);
   mgr.incr_metric("spill_count", stats.moves_inserted());
   mgr.incr_metric("coalesce_count", stats.moves_coalesced);
   mgr.incr_metric("net_moves", stats.net_moves());
+  mgr.incr_metric("linear_scan_methods", stats.linear_scan_methods);
+  mgr.incr_metric("linear_scan_moves", stats.linear_scan_moves);
+  mgr.incr_metric("large_register_code_units",
+                  stats.large_register_code_units);
 
   ++m_run;
   // For the last invocation, record that final register allocation has been
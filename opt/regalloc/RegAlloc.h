@@ -21,6 +21,8 @@ class RegAllocPass : public Pass {
   void bind_config() override {
     bool unused;
     bind("live_range_splitting", false, unused);
+    size_t unused_threshold;
+    bind("linear_scan_threshold", 0, unused_threshold);
     trait(Traits::Pass::atleast, 1);
   }
 
@@ -18,6 +18,8 @@ class RemoveApiLevelChecksPass : public Pass {
  public:
   RemoveApiLevelChecksPass() : Pass("RemoveApiLevelChecksPass") {}
 
+  bool is_editable_cfg_friendly() const override { return true; }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
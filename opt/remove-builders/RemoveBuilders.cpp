@@ -10,6 +10,7 @@
 #include <boost/regex.hpp>
 #include <tuple>
 
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
 #include "Dataflow.h"
 #include "DexUtil.h"
@@ -215,7 +216,10 @@ bool RemoveBuildersPass::escapes_stack(DexType* builder, DexMethod* method) {
   always_assert(method != nullptr);
 
   auto code = method->get_code();
-  code->build_cfg(/* editable */ false);
+  // The CFG is shared by the checks of all the builders the method creates.
+  if (!code->cfg_built()) {
+    code->build_cfg(/* editable */ false);
+  }
   const auto& blocks = code->cfg().blocks_reverse_post_deprecated();
   auto regs_size = method->get_code()->get_registers_size();
   auto taint_map = get_tainted_regs(regs_size, blocks, builder);
@@ -250,24 +254,31 @@ void RemoveBuildersPass::run_pass(DexStoresVector& stores,
     }
   }
 
-  std::unordered_set<DexType*> escaped_builders;
-  walk::methods(scope, [&](DexMethod* m) {
+  // A builder that is known to escape in some method doesn't need to be
+  // checked in the other ones.
+  ConcurrentSet<DexType*> escaped_builders;
+  walk::parallel::methods(scope, [&](DexMethod* m) {
     auto builders = created_builders(m);
+    std::unordered_set<DexType*> checked;
     for (DexType* builder : builders) {
+      if (!checked.emplace(builder).second ||
+          escaped_builders.count(builder)) {
+        continue;
+      }
       if (escapes_stack(builder, m)) {
         TRACE(BUILDERS,
               3,
               "%s escapes in %s",
               SHOW(builder),
               m->get_deobfuscated_name().c_str());
-        escaped_builders.emplace(builder);
+        escaped_builders.insert(builder);
       }
     }
   });
 
   std::unordered_set<DexType*> stack_only_builders;
   for (DexType* builder : m_builders) {
-    if (escaped_builders.find(builder) == escaped_builders.end()) {
+    if (!escaped_builders.count(builder)) {
       stack_only_builders.emplace(builder);
     }
   }
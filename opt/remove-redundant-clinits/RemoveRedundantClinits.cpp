@@ -0,0 +1,374 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RemoveRedundantClinits.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <boost/optional.hpp>
+
+#include "ConfigFiles.h"
+#include "DexUtil.h"
+#include "FieldOpTracker.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "MethodOverrideGraphAnalysisPass.h"
+#include "MethodProfiles.h"
+#include "PassManager.h"
+#include "Purity.h"
+#include "PurityAnalysisPass.h"
+#include "ReachableClasses.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr const char* CLINIT_COST_FILENAME = "redex-clinit-cost.csv";
+
+} // namespace
+
+namespace clinit_elimination {
+
+namespace {
+
+// The registers that only ever hold an array that the method allocated
+// itself. Writes to such arrays are not visible to anybody else until the
+// array escapes.
+std::unordered_set<reg_t> get_fresh_array_regs(IRCode* code) {
+  std::unordered_set<reg_t> fresh;
+  std::unordered_set<reg_t> clobbered;
+  IRInstruction* prev = nullptr;
+  for (const auto& mie : InstructionIterable(code)) {
+    auto* insn = mie.insn;
+    if (insn->has_dest()) {
+      auto op = insn->opcode();
+      bool is_new_array =
+          prev != nullptr &&
+          ((op == IOPCODE_MOVE_RESULT_PSEUDO_OBJECT &&
+            prev->opcode() == OPCODE_NEW_ARRAY) ||
+           (op == OPCODE_MOVE_RESULT_OBJECT &&
+            prev->opcode() == OPCODE_FILLED_NEW_ARRAY));
+      if (is_new_array) {
+        fresh.insert(insn->dest());
+      } else {
+        clobbered.insert(insn->dest());
+        if (insn->dest_is_wide()) {
+          clobbered.insert(insn->dest() + 1);
+        }
+      }
+    }
+    prev = insn;
+  }
+  for (auto reg : clobbered) {
+    fresh.erase(reg);
+  }
+  return fresh;
+}
+
+// The internal class whose initialization accessing a member of `type`
+// triggers, if any.
+const DexClass* get_internal_class(const DexType* type) {
+  auto* cls = type_class(type);
+  return cls != nullptr && !cls->is_external() ? cls : nullptr;
+}
+
+} // namespace
+
+ClinitSideEffectsAnalysis::ClinitSideEffectsAnalysis(
+    const Scope& scope,
+    const std::unordered_set<DexMethodRef*>& no_side_effects_methods) {
+  auto is_no_side_effects_method = [&](DexMethodRef* ref,
+                                       const DexMethod* callee) {
+    return no_side_effects_methods.count(ref) ||
+           (callee != nullptr &&
+            no_side_effects_methods.count(const_cast<DexMethod*>(callee)));
+  };
+
+  // Summarize the body of each <clinit>, and drop the ones that have side
+  // effects of their own.
+  std::unordered_set<const DexClass*> candidates;
+  for (auto* cls : scope) {
+    candidates.insert(cls);
+    auto* clinit = cls->get_clinit();
+    if (clinit == nullptr) {
+      continue;
+    }
+    auto* code = clinit->get_code();
+    if (code == nullptr) {
+      candidates.erase(cls);
+      continue;
+    }
+    auto fresh_arrays = get_fresh_array_regs(code);
+    ClinitSummary summary;
+    auto add_dependency = [&](const DexType* type) {
+      if (type != cls->get_type()) {
+        summary.dependencies.insert(type);
+      }
+    };
+    bool side_effect_free = true;
+    for (const auto& mie : InstructionIterable(code)) {
+      auto* insn = mie.insn;
+      auto op = insn->opcode();
+      if (opcode::is_an_sfield_op(op)) {
+        auto* field = resolve_field(insn->get_field(), FieldSearch::Static);
+        if (field == nullptr) {
+          side_effect_free = false;
+          break;
+        }
+        if (opcode::is_an_sput(op)) {
+          if (field->get_class() != cls->get_type()) {
+            side_effect_free = false;
+            break;
+          }
+          summary.written_fields.insert(field);
+        } else if (get_internal_class(field->get_class()) != nullptr) {
+          summary.read_fields[field]++;
+          add_dependency(field->get_class());
+        } else if (!is_final(field)) {
+          // The initialization of a system class doesn't concern us, but
+          // the value of a mutable system field might.
+          side_effect_free = false;
+          break;
+        }
+      } else if (opcode::is_an_invoke(op)) {
+        auto* ref = insn->get_method();
+        auto* callee = resolve_method(ref, opcode_to_search(insn));
+        if (!is_no_side_effects_method(ref, callee)) {
+          side_effect_free = false;
+          break;
+        }
+        if (op == OPCODE_INVOKE_STATIC && callee != nullptr &&
+            get_internal_class(callee->get_class()) != nullptr) {
+          add_dependency(callee->get_class());
+        }
+      } else if (opcode::is_an_aput(op) || op == OPCODE_FILL_ARRAY_DATA) {
+        auto array = opcode::is_an_aput(op) ? insn->src(1) : insn->src(0);
+        if (!fresh_arrays.count(array)) {
+          side_effect_free = false;
+          break;
+        }
+      } else if (opcode::is_div_int_lit(op) || opcode::is_rem_int_lit(op)) {
+        if (insn->get_literal() == 0) {
+          side_effect_free = false;
+          break;
+        }
+      } else if (opcode::is_div_int_or_long(op) ||
+                 opcode::is_rem_int_or_long(op) || opcode::is_throw(op) ||
+                 opcode::is_a_monitor(op) || opcode::is_new_instance(op) ||
+                 opcode::is_check_cast(op) || opcode::is_an_ifield_op(op)) {
+        side_effect_free = false;
+        break;
+      }
+    }
+    if (!side_effect_free) {
+      candidates.erase(cls);
+      continue;
+    }
+    m_clinits.emplace(cls, std::move(summary));
+  }
+
+  // Then drop the classes that initialize other classes with side effects,
+  // until none is left to drop.
+  auto is_candidate = [&](const DexType* type) {
+    if (type == type::java_lang_Object()) {
+      return true;
+    }
+    auto* cls = get_internal_class(type);
+    return cls != nullptr && candidates.count(cls);
+  };
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto it = candidates.begin(); it != candidates.end();) {
+      const auto* cls = *it;
+      bool drop = cls->get_super_class() != nullptr &&
+                  !is_candidate(cls->get_super_class());
+      auto summary_it = m_clinits.find(cls);
+      if (!drop && summary_it != m_clinits.end()) {
+        const auto& deps = summary_it->second.dependencies;
+        drop = std::any_of(deps.begin(), deps.end(), [&](const DexType* dep) {
+          return !is_candidate(dep);
+        });
+      }
+      if (drop) {
+        it = candidates.erase(it);
+        changed = true;
+      } else {
+        ++it;
+      }
+    }
+  }
+  for (const auto* cls : candidates) {
+    m_side_effect_free_types.insert(cls->get_type());
+  }
+}
+
+bool ClinitSideEffectsAnalysis::is_side_effect_free(
+    const DexType* type) const {
+  return type == type::java_lang_Object() ||
+         m_side_effect_free_types.count(type);
+}
+
+bool ClinitSideEffectsAnalysis::is_clinit_side_effect_free(
+    const DexClass* cls) const {
+  auto it = m_clinits.find(cls);
+  if (it == m_clinits.end()) {
+    return false;
+  }
+  const auto& deps = it->second.dependencies;
+  return std::all_of(deps.begin(), deps.end(), [&](const DexType* dep) {
+    return is_side_effect_free(dep);
+  });
+}
+
+const std::unordered_set<DexField*>&
+ClinitSideEffectsAnalysis::get_written_fields(const DexClass* cls) const {
+  return m_clinits.at(cls).written_fields;
+}
+
+const std::unordered_map<DexField*, size_t>&
+ClinitSideEffectsAnalysis::get_read_fields(const DexClass* cls) const {
+  return m_clinits.at(cls).read_fields;
+}
+
+std::vector<DexClass*> find_redundant_clinits(
+    const Scope& scope, const ClinitSideEffectsAnalysis& analysis) {
+  auto field_stats = field_op_tracker::analyze(scope);
+  auto reads_of = [&](DexField* field) {
+    auto it = field_stats.find(field);
+    return it == field_stats.end() ? 0 : it->second.reads;
+  };
+
+  std::vector<DexClass*> redundant;
+  for (auto* cls : scope) {
+    auto* clinit = cls->get_clinit();
+    if (clinit == nullptr || !can_delete(clinit) ||
+        clinit->rstate.no_optimizations() ||
+        !analysis.is_clinit_side_effect_free(cls)) {
+      continue;
+    }
+    const auto& own_reads = analysis.get_read_fields(cls);
+    const auto& written = analysis.get_written_fields(cls);
+    bool unobservable =
+        std::all_of(written.begin(), written.end(), [&](DexField* field) {
+          auto it = own_reads.find(field);
+          size_t own = it == own_reads.end() ? 0 : it->second;
+          return can_delete(field) && reads_of(field) == own;
+        });
+    if (unobservable) {
+      TRACE(CLINIT, 2, "Redundant clinit: %s", SHOW(clinit));
+      redundant.push_back(cls);
+    }
+  }
+  return redundant;
+}
+
+} // namespace clinit_elimination
+
+void RemoveRedundantClinitsPass::run_pass(DexStoresVector& stores,
+                                          ConfigFiles& conf,
+                                          PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto pure_methods = get_pure_methods();
+  auto configured_pure_methods = conf.get_pure_methods();
+  pure_methods.insert(configured_pure_methods.begin(),
+                      configured_pure_methods.end());
+  if (!mgr.unreliable_virtual_scopes()) {
+    auto purity_analysis = mgr.get_preserved_analysis<PurityAnalysisPass>();
+    auto purity_cache =
+        purity_analysis ? purity_analysis->get_result() : nullptr;
+    std::unordered_set<const DexMethod*> no_side_effects_methods;
+    size_t iterations = 0;
+    if (purity_cache) {
+      auto override_graph = purity_cache->get_method_override_graph(scope);
+      no_side_effects_methods = purity_cache->get_no_side_effects_methods(
+          scope, override_graph.get(), pure_methods, &iterations);
+    } else {
+      auto override_graph =
+          MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
+      compute_no_side_effects_methods(scope, override_graph.get(),
+                                      pure_methods, &no_side_effects_methods);
+    }
+    for (auto* m : no_side_effects_methods) {
+      pure_methods.insert(const_cast<DexMethod*>(m));
+    }
+  }
+
+  clinit_elimination::ClinitSideEffectsAnalysis analysis(scope, pure_methods);
+  auto redundant = clinit_elimination::find_redundant_clinits(scope, analysis);
+  std::unordered_set<const DexClass*> redundant_set(redundant.begin(),
+                                                    redundant.end());
+
+  // Report the cost of the <clinit>s that run during cold start, before
+  // removing any of them.
+  struct ClinitCost {
+    const DexClass* cls;
+    size_t code_units;
+    double appear_percent;
+    bool side_effect_free;
+    bool removed;
+  };
+  std::vector<ClinitCost> costs;
+  size_t num_clinits = 0;
+  size_t num_side_effect_free = 0;
+  const auto& method_profiles = conf.get_method_profiles();
+  for (auto* cls : scope) {
+    auto* clinit = cls->get_clinit();
+    if (clinit == nullptr || clinit->get_code() == nullptr) {
+      continue;
+    }
+    num_clinits++;
+    bool side_effect_free = analysis.is_clinit_side_effect_free(cls);
+    if (side_effect_free) {
+      num_side_effect_free++;
+    }
+    auto stat =
+        method_profiles.get_method_stat(method_profiles::COLD_START, clinit);
+    if (stat) {
+      costs.push_back(ClinitCost{cls, clinit->get_code()->sum_opcode_sizes(),
+                                 stat->appear_percent, side_effect_free,
+                                 redundant_set.count(cls) != 0});
+    }
+  }
+  std::stable_sort(costs.begin(), costs.end(),
+                   [](const ClinitCost& a, const ClinitCost& b) {
+                     return a.appear_percent > b.appear_percent;
+                   });
+  size_t cold_start_code_units = 0;
+  size_t removed_cold_start = 0;
+  std::ofstream ofs(conf.metafile(CLINIT_COST_FILENAME));
+  ofs << "class,code_units,appear_percent,side_effect_free,removed\n";
+  for (const auto& cost : costs) {
+    cold_start_code_units += cost.code_units;
+    if (cost.removed) {
+      removed_cold_start++;
+    }
+    ofs << show(cost.cls) << "," << cost.code_units << ","
+        << cost.appear_percent << "," << cost.side_effect_free << ","
+        << cost.removed << "\n";
+  }
+
+  for (auto* cls : redundant) {
+    cls->remove_method(cls->get_clinit());
+  }
+
+  mgr.set_metric("clinits", num_clinits);
+  mgr.set_metric("side_effect_free_clinits", num_side_effect_free);
+  mgr.set_metric("removed_clinits", redundant.size());
+  mgr.set_metric("cold_start_clinits", costs.size());
+  mgr.set_metric("cold_start_clinit_code_units", cold_start_code_units);
+  mgr.set_metric("removed_cold_start_clinits", removed_cold_start);
+  TRACE(CLINIT, 1,
+        "%zu of %zu clinits are free of side effects, removed %zu; %zu run in "
+        "cold start",
+        num_side_effect_free, num_clinits, redundant.size(), costs.size());
+}
+
+static RemoveRedundantClinitsPass s_pass;
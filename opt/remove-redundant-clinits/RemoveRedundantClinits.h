@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "DexClass.h"
+#include "Pass.h"
+
+namespace clinit_elimination {
+
+/*
+ * Determines, for the whole program, which classes can be initialized without
+ * side effects. The initialization of a class has no side effects when its
+ * super class' initialization has none, and its <clinit> only
+ * - writes static fields of its own class and arrays it allocated itself,
+ * - invokes methods that are known to be pure or free of side effects,
+ * - reads static fields of, or invokes static methods of, classes whose
+ *   initialization has no side effects, and
+ * - neither throws, synchronizes, nor creates instances.
+ *
+ * Classes that depend on each other in a cycle are free of side effects if
+ * the whole cycle is. As for dead code elimination, the exceptions that array
+ * accesses or allocations may throw are not considered side effects.
+ */
+class ClinitSideEffectsAnalysis {
+ public:
+  ClinitSideEffectsAnalysis(
+      const Scope& scope,
+      const std::unordered_set<DexMethodRef*>& no_side_effects_methods);
+
+  // Whether initializing `type` can't have any effect besides writing the
+  // static fields of the classes that it initializes. This is false for
+  // external types, except for java.lang.Object.
+  bool is_side_effect_free(const DexType* type) const;
+
+  // Whether the body of the <clinit> of `cls` only has effects on the static
+  // fields of `cls`, not taking the initialization of the super class into
+  // account, which happens without the <clinit> too.
+  bool is_clinit_side_effect_free(const DexClass* cls) const;
+
+  // The static fields that the <clinit> of `cls` writes, if its body is free
+  // of side effects.
+  const std::unordered_set<DexField*>& get_written_fields(
+      const DexClass* cls) const;
+
+  // The number of times the <clinit> of `cls` reads each static field, if its
+  // body is free of side effects.
+  const std::unordered_map<DexField*, size_t>& get_read_fields(
+      const DexClass* cls) const;
+
+ private:
+  struct ClinitSummary {
+    // The classes that the <clinit> initializes.
+    std::unordered_set<const DexType*> dependencies;
+    std::unordered_set<DexField*> written_fields;
+    std::unordered_map<DexField*, size_t> read_fields;
+  };
+
+  std::unordered_map<const DexClass*, ClinitSummary> m_clinits;
+  std::unordered_set<const DexType*> m_side_effect_free_types;
+};
+
+/*
+ * Finds the classes whose <clinit> can be removed: its body is free of side
+ * effects according to the analysis above, and the static fields it writes
+ * can be deleted and aren't read anywhere else. Changing when the written
+ * fields get their values is then unobservable, and so is skipping the
+ * initialization of the classes that the <clinit> depends on.
+ */
+std::vector<DexClass*> find_redundant_clinits(
+    const Scope& scope, const ClinitSideEffectsAnalysis& analysis);
+
+} // namespace clinit_elimination
+
+/*
+ * Many startup costs are chains of class initializers. FinalInlinePassV2
+ * encodes the static values that are constant, and deletes the <clinit>s that
+ * become empty; this pass deletes the remaining ones that have no observable
+ * effect, such as those that compute the values of fields that are no longer
+ * read.
+ *
+ * It also writes redex-clinit-cost.csv, which lists the <clinit>s in the cold
+ * start profile, with their size and whether they are free of side effects,
+ * hottest first.
+ */
+class RemoveRedundantClinitsPass : public Pass {
+ public:
+  RemoveRedundantClinitsPass() : Pass("RemoveRedundantClinitsPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+};
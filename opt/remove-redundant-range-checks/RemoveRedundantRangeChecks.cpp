@@ -0,0 +1,509 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RemoveRedundantRangeChecks.h"
+
+#include <limits>
+
+#include "DexClass.h"
+#include "IRCode.h"
+#include "IROpcode.h"
+#include "PassManager.h"
+#include "ScopedCFG.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace range_checks {
+
+namespace {
+
+constexpr int64_t MIN = DifferenceDomain::MIN;
+constexpr int64_t MAX = DifferenceDomain::MAX;
+constexpr int64_t INT_MIN_VALUE = std::numeric_limits<int32_t>::min();
+constexpr int64_t INT_MAX_VALUE = std::numeric_limits<int32_t>::max();
+
+DifferenceDomain make_bounds(int64_t lb, int64_t ub) {
+  if (lb > ub) {
+    return DifferenceDomain::bottom();
+  }
+  if (lb == MIN) {
+    return ub == MAX ? DifferenceDomain::top()
+                     : DifferenceDomain::bounded_above(ub);
+  }
+  if (ub == MAX) {
+    return DifferenceDomain::bounded_below(lb);
+  }
+  return DifferenceDomain::finite(lb, ub);
+}
+
+DifferenceDomain negate(const DifferenceDomain& d) {
+  if (d.is_bottom()) {
+    return d;
+  }
+  return make_bounds(d.upper_bound() == MAX ? MIN : -d.upper_bound(),
+                     d.lower_bound() == MIN ? MAX : -d.lower_bound());
+}
+
+// The pair (a, b) with a < b holds the bounds of a - b.
+uint64_t make_key(reg_t a, reg_t b) { return (uint64_t)a << 32 | b; }
+
+reg_t first(uint64_t key) { return (reg_t)(key >> 32); }
+
+reg_t second(uint64_t key) { return (reg_t)key; }
+
+// Whether adding `lit` to any int in `value` can't overflow.
+bool can_add_without_overflow(const DifferenceDomain& value, int64_t lit) {
+  if (value.is_bottom()) {
+    return false;
+  }
+  return lit >= 0 ? value.upper_bound() <= INT_MAX_VALUE - lit
+                  : value.lower_bound() >= INT_MIN_VALUE - lit;
+}
+
+// dest := src
+void assign(Environment* env, reg_t dest, reg_t src) {
+  if (dest == src) {
+    return;
+  }
+  auto differences = env->get_differences(src);
+  auto array = env->get_array(src);
+  env->forget(dest);
+  for (const auto& p : differences) {
+    if (p.first != dest) {
+      env->meet_difference(dest, p.first, p.second);
+    }
+  }
+  if (src != RESULT_REGISTER) {
+    env->meet_difference(dest, src, DifferenceDomain::finite(0, 0));
+  }
+  if (array) {
+    env->set_array(dest, *array);
+  }
+}
+
+// dest := src + lit, as long as it does not overflow.
+void assign_sum(Environment* env, reg_t dest, reg_t src, int64_t lit) {
+  auto value = env->get_value(src);
+  if (!can_add_without_overflow(value, lit)) {
+    env->forget(dest);
+    return;
+  }
+  auto sum = value + DifferenceDomain::finite(lit, lit);
+  auto differences = env->get_differences(src);
+  env->forget(dest);
+  for (const auto& p : differences) {
+    if (p.first != dest) {
+      env->meet_difference(
+          dest, p.first, p.second + DifferenceDomain::finite(lit, lit));
+    }
+  }
+  if (dest != src) {
+    env->meet_difference(dest, src, DifferenceDomain::finite(lit, lit));
+  }
+  env->meet_difference(dest, ZERO, sum);
+}
+
+boost::optional<int64_t> get_constant(const Environment& env, reg_t reg) {
+  auto value = env.get_value(reg);
+  if (value.is_bottom() || value.lower_bound() != value.upper_bound()) {
+    return boost::none;
+  }
+  return value.lower_bound();
+}
+
+// The array and index registers of an array access.
+boost::optional<std::pair<reg_t, reg_t>> get_array_access(
+    const IRInstruction* insn) {
+  auto op = insn->opcode();
+  if (opcode::is_an_aget(op)) {
+    return std::make_pair(insn->src(0), insn->src(1));
+  }
+  if (opcode::is_an_aput(op)) {
+    return std::make_pair(insn->src(1), insn->src(2));
+  }
+  return boost::none;
+}
+
+// The bounds of src(0) - src(1), or of src(0) for a compare with zero, on the
+// edge of `op` that is taken if `taken`.
+boost::optional<DifferenceDomain> get_branch_bounds(IROpcode op, bool taken) {
+  if (!taken) {
+    op = opcode::invert_conditional_branch(op);
+  }
+  switch (op) {
+  case OPCODE_IF_EQ:
+  case OPCODE_IF_EQZ:
+    return DifferenceDomain::finite(0, 0);
+  case OPCODE_IF_LT:
+  case OPCODE_IF_LTZ:
+    return DifferenceDomain::bounded_above(-1);
+  case OPCODE_IF_GE:
+  case OPCODE_IF_GEZ:
+    return DifferenceDomain::bounded_below(0);
+  case OPCODE_IF_GT:
+  case OPCODE_IF_GTZ:
+    return DifferenceDomain::bounded_below(1);
+  case OPCODE_IF_LE:
+  case OPCODE_IF_LEZ:
+    return DifferenceDomain::bounded_above(0);
+  default:
+    // Disequalities can't be represented by intervals.
+    return boost::none;
+  }
+}
+
+bool has_conditional_branch(IRCode* code) {
+  for (const auto& mie : InstructionIterable(*code)) {
+    if (opcode::is_a_conditional_branch(mie.insn->opcode())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+DifferenceDomain Environment::get_direct_difference(reg_t a, reg_t b) const {
+  if (a == b) {
+    return DifferenceDomain::finite(0, 0);
+  }
+  if (a < b) {
+    return get<0>().get(make_key(a, b));
+  }
+  return negate(get<0>().get(make_key(b, a)));
+}
+
+DifferenceDomain Environment::get_difference(reg_t a, reg_t b) const {
+  if (is_bottom()) {
+    return DifferenceDomain::bottom();
+  }
+  auto result = get_direct_difference(a, b);
+  if (a == b) {
+    return result;
+  }
+  for (const auto& p : get_differences(a)) {
+    if (p.first == b) {
+      continue;
+    }
+    auto rest = get_direct_difference(p.first, b);
+    if (!rest.is_top()) {
+      result.meet_with(p.second + rest);
+    }
+  }
+  return result;
+}
+
+void Environment::meet_difference(reg_t a,
+                                  reg_t b,
+                                  const DifferenceDomain& bounds) {
+  always_assert(a != b);
+  auto key = a < b ? make_key(a, b) : make_key(b, a);
+  auto oriented = a < b ? bounds : negate(bounds);
+  apply<0>([&](DifferenceEnvironment* env) {
+    env->update(key, [&](const DifferenceDomain& d) {
+      return d.meet(oriented);
+    });
+  });
+  if (get<0>().is_bottom()) {
+    set_to_bottom();
+  }
+}
+
+void Environment::forget(reg_t reg) {
+  if (is_bottom()) {
+    return;
+  }
+  std::vector<uint64_t> keys;
+  for (const auto& p : get<0>().bindings()) {
+    if (first(p.first) == reg || second(p.first) == reg) {
+      keys.push_back(p.first);
+    }
+  }
+  std::vector<reg_t> lengths = get_lengths(reg);
+  apply<0>([&](DifferenceEnvironment* env) {
+    for (auto key : keys) {
+      env->set(key, DifferenceDomain::top());
+    }
+  });
+  apply<1>([&](ArrayLengthEnvironment* env) {
+    env->set(reg, sparta::ConstantAbstractDomain<reg_t>::top());
+    for (auto length : lengths) {
+      env->set(length, sparta::ConstantAbstractDomain<reg_t>::top());
+    }
+  });
+}
+
+std::vector<reg_t> Environment::get_lengths(reg_t array) const {
+  std::vector<reg_t> lengths;
+  if (is_bottom()) {
+    return lengths;
+  }
+  for (const auto& p : get<1>().bindings()) {
+    if (p.second.get_constant() == array) {
+      lengths.push_back(p.first);
+    }
+  }
+  return lengths;
+}
+
+boost::optional<reg_t> Environment::get_array(reg_t length) const {
+  if (is_bottom()) {
+    return boost::none;
+  }
+  return get<1>().get(length).get_constant();
+}
+
+void Environment::set_array(reg_t length, reg_t array) {
+  apply<1>([&](ArrayLengthEnvironment* env) {
+    env->set(length, sparta::ConstantAbstractDomain<reg_t>(array));
+  });
+}
+
+std::vector<std::pair<reg_t, DifferenceDomain>> Environment::get_differences(
+    reg_t reg) const {
+  std::vector<std::pair<reg_t, DifferenceDomain>> differences;
+  if (is_bottom()) {
+    return differences;
+  }
+  for (const auto& p : get<0>().bindings()) {
+    if (first(p.first) == reg) {
+      differences.emplace_back(second(p.first), p.second);
+    } else if (second(p.first) == reg) {
+      differences.emplace_back(first(p.first), negate(p.second));
+    }
+  }
+  return differences;
+}
+
+void FixpointIterator::analyze_node(const NodeId& block,
+                                    Environment* env) const {
+  auto last_insn = block->get_last_insn();
+  for (auto& mie : InstructionIterable(block)) {
+    auto insn = mie.insn;
+    analyze_instruction(insn, env, insn == last_insn->insn);
+  }
+}
+
+void FixpointIterator::analyze_instruction(const IRInstruction* insn,
+                                           Environment* env,
+                                           bool is_last) const {
+  if (env->is_bottom()) {
+    return;
+  }
+  switch (insn->opcode()) {
+  case OPCODE_CONST:
+    env->forget(insn->dest());
+    env->meet_difference(
+        insn->dest(), ZERO,
+        DifferenceDomain::finite(insn->get_literal(), insn->get_literal()));
+    break;
+  case OPCODE_MOVE:
+  case OPCODE_MOVE_OBJECT:
+    assign(env, insn->dest(), insn->src(0));
+    break;
+  case OPCODE_MOVE_RESULT:
+  case IOPCODE_MOVE_RESULT_PSEUDO:
+    assign(env, insn->dest(), RESULT_REGISTER);
+    break;
+  case OPCODE_ADD_INT_LIT8:
+  case OPCODE_ADD_INT_LIT16:
+    assign_sum(env, insn->dest(), insn->src(0), insn->get_literal());
+    break;
+  case OPCODE_ADD_INT:
+  case OPCODE_SUB_INT: {
+    auto lit = get_constant(*env, insn->src(1));
+    if (lit) {
+      assign_sum(env, insn->dest(), insn->src(0),
+                 insn->opcode() == OPCODE_ADD_INT ? *lit : -*lit);
+    } else if (insn->opcode() == OPCODE_ADD_INT &&
+               (lit = get_constant(*env, insn->src(0)))) {
+      assign_sum(env, insn->dest(), insn->src(1), *lit);
+    } else {
+      env->forget(insn->dest());
+    }
+    break;
+  }
+  case OPCODE_ARRAY_LENGTH:
+    env->forget(RESULT_REGISTER);
+    env->meet_difference(RESULT_REGISTER, ZERO,
+                         DifferenceDomain::finite(0, INT_MAX_VALUE));
+    env->set_array(RESULT_REGISTER, insn->src(0));
+    break;
+  default:
+    if (insn->has_dest()) {
+      env->forget(insn->dest());
+      if (insn->dest_is_wide()) {
+        env->forget(insn->dest() + 1);
+      }
+    } else if (insn->has_move_result_any()) {
+      env->forget(RESULT_REGISTER);
+      env->forget(RESULT_REGISTER + 1);
+    }
+    break;
+  }
+
+  auto access = get_array_access(insn);
+  if (!access || is_last || env->is_bottom()) {
+    return;
+  }
+  auto array = access->first;
+  auto index = access->second;
+  if (array == index) {
+    return;
+  }
+  env->meet_difference(index, ZERO, DifferenceDomain::bounded_below(0));
+  for (auto length : env->get_lengths(array)) {
+    if (length != index) {
+      env->meet_difference(index, length, DifferenceDomain::bounded_above(-1));
+    }
+  }
+}
+
+Environment FixpointIterator::analyze_edge(
+    const EdgeId& edge, const Environment& exit_state) const {
+  auto env = exit_state;
+  auto last_insn_it = edge->src()->get_last_insn();
+  if (env.is_bottom() || last_insn_it == edge->src()->end()) {
+    return env;
+  }
+  auto* insn = last_insn_it->insn;
+  auto op = insn->opcode();
+  if (!opcode::is_a_conditional_branch(op) ||
+      (edge->type() != cfg::EDGE_BRANCH && edge->type() != cfg::EDGE_GOTO)) {
+    return env;
+  }
+  auto a = insn->src(0);
+  auto b = insn->srcs_size() == 2 ? insn->src(1) : ZERO;
+  auto taken = edge->type() == cfg::EDGE_BRANCH;
+  auto difference = env.get_difference(a, b);
+  auto bounds = get_branch_bounds(op, taken);
+  if (!bounds) {
+    // The edge on which the registers differ is dead if they are equal.
+    if (!difference.is_bottom() && difference.lower_bound() == 0 &&
+        difference.upper_bound() == 0) {
+      env.set_to_bottom();
+    }
+    return env;
+  }
+  difference.meet_with(*bounds);
+  if (difference.is_bottom()) {
+    env.set_to_bottom();
+  } else if (a != b) {
+    env.meet_difference(a, b, difference);
+  }
+  return env;
+}
+
+bool is_in_bounds(const Environment& env, const IRInstruction* insn) {
+  auto access = get_array_access(insn);
+  if (!access || env.is_bottom()) {
+    return false;
+  }
+  auto index = env.get_value(access->second);
+  if (index.is_bottom() || index.lower_bound() < 0) {
+    return false;
+  }
+  for (auto length : env.get_lengths(access->first)) {
+    auto difference = env.get_difference(access->second, length);
+    if (!difference.is_bottom() && difference.upper_bound() < 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Stats& Stats::operator+=(const Stats& that) {
+  branches_removed += that.branches_removed;
+  array_accesses += that.array_accesses;
+  array_accesses_in_bounds += that.array_accesses_in_bounds;
+  return *this;
+}
+
+Stats remove_redundant_range_checks(cfg::ControlFlowGraph& cfg) {
+  always_assert(cfg.editable());
+  FixpointIterator fp_iter(cfg);
+  fp_iter.run(Environment());
+
+  Stats stats;
+  std::vector<cfg::Edge*> dead_edges;
+  for (auto* block : cfg.blocks()) {
+    auto env = fp_iter.get_entry_state_at(block);
+    if (env.is_bottom()) {
+      continue;
+    }
+    auto last_insn_it = block->get_last_insn();
+    for (auto& mie : InstructionIterable(block)) {
+      auto insn = mie.insn;
+      if (opcode::is_an_aget(insn->opcode()) ||
+          opcode::is_an_aput(insn->opcode())) {
+        stats.array_accesses++;
+        if (is_in_bounds(env, insn)) {
+          stats.array_accesses_in_bounds++;
+        }
+      }
+      fp_iter.analyze_instruction(insn, &env, insn == last_insn_it->insn);
+    }
+    if (last_insn_it == block->end() ||
+        !opcode::is_a_conditional_branch(last_insn_it->insn->opcode())) {
+      continue;
+    }
+    for (auto* edge : block->succs()) {
+      if ((edge->type() == cfg::EDGE_BRANCH ||
+           edge->type() == cfg::EDGE_GOTO) &&
+          fp_iter.analyze_edge(edge, env).is_bottom()) {
+        dead_edges.push_back(edge);
+        break;
+      }
+    }
+  }
+
+  for (auto* edge : dead_edges) {
+    auto* block = edge->src();
+    auto it = block->to_cfg_instruction_iterator(block->get_last_insn());
+    TRACE(RANGE_CHECK, 5, "Removing %s, which is always %s", SHOW(it->insn),
+          edge->type() == cfg::EDGE_GOTO ? "taken" : "not taken");
+    if (edge->type() == cfg::EDGE_BRANCH) {
+      cfg.remove_insn(it);
+    } else {
+      auto* target =
+          cfg.get_succ_edge_of_type(block, cfg::EDGE_BRANCH)->target();
+      cfg.remove_insn(it);
+      cfg.set_edge_target(cfg.get_succ_edge_of_type(block, cfg::EDGE_GOTO),
+                          target);
+    }
+    stats.branches_removed++;
+  }
+  if (!dead_edges.empty()) {
+    cfg.remove_unreachable_blocks();
+  }
+  return stats;
+}
+
+} // namespace range_checks
+
+void RemoveRedundantRangeChecksPass::run_pass(DexStoresVector& stores,
+                                              ConfigFiles& /* conf */,
+                                              PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto stats = walk::parallel::methods<range_checks::Stats>(
+      scope, [](DexMethod* method) {
+        auto code = method->get_code();
+        if (!code || method->rstate.no_optimizations() ||
+            !range_checks::has_conditional_branch(code)) {
+          return range_checks::Stats();
+        }
+        cfg::ScopedCFG cfg(code);
+        return range_checks::remove_redundant_range_checks(*cfg);
+      });
+
+  mgr.set_metric("branches_removed", stats.branches_removed);
+  mgr.set_metric("array_accesses", stats.array_accesses);
+  mgr.set_metric("array_accesses_in_bounds", stats.array_accesses_in_bounds);
+}
+
+static RemoveRedundantRangeChecksPass s_pass;
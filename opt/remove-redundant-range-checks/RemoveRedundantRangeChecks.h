@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "BaseIRAnalyzer.h"
+#include "ConstantAbstractDomain.h"
+#include "ControlFlow.h"
+#include "IRInstruction.h"
+#include "IntervalDomain.h"
+#include "Pass.h"
+#include "PatriciaTreeMapAbstractEnvironment.h"
+#include "ReducedProductAbstractDomain.h"
+
+namespace range_checks {
+
+// A pseudo-register that always holds zero. The difference between a
+// register and ZERO is the value of that register.
+constexpr reg_t ZERO = RESULT_REGISTER - 1;
+
+// The integers that the difference of two 32-bit registers may be.
+using DifferenceDomain = sparta::IntervalDomain<int64_t>;
+
+// Bounds of the differences of pairs of registers, keyed by the pair.
+using DifferenceEnvironment =
+    sparta::PatriciaTreeMapAbstractEnvironment<uint64_t, DifferenceDomain>;
+
+// Maps the registers that hold the length of an array to the register that
+// holds the array.
+using ArrayLengthEnvironment = sparta::PatriciaTreeMapAbstractEnvironment<
+    reg_t,
+    sparta::ConstantAbstractDomain<reg_t>>;
+
+/*
+ * A weakly relational domain in the spirit of difference-bound matrices: for
+ * some pairs of registers a, b it keeps an interval that a - b lies in, which
+ * includes the intervals of the registers themselves as their difference with
+ * ZERO. The transitive closure is not maintained; queries combine the known
+ * bounds through one intermediate register instead, which is enough for the
+ * usual guards of loops over arrays, e.g.
+ *
+ *   0 <= i, i < a.length  ==>  i <= a.length - 1
+ */
+class Environment final
+    : public sparta::ReducedProductAbstractDomain<Environment,
+                                                  DifferenceEnvironment,
+                                                  ArrayLengthEnvironment> {
+ public:
+  using ReducedProductAbstractDomain::ReducedProductAbstractDomain;
+
+  // Some older compilers complain that the class is not default
+  // constructible. We intended to use the default constructors of the base
+  // class (via the `using` declaration above), but some compilers fail to
+  // catch this. So we insert a redundant '= default'.
+  Environment() = default;
+
+  static void reduce_product(
+      std::tuple<DifferenceEnvironment, ArrayLengthEnvironment>&) {}
+
+  // The bounds of a - b.
+  DifferenceDomain get_difference(reg_t a, reg_t b) const;
+
+  DifferenceDomain get_value(reg_t reg) const {
+    return get_difference(reg, ZERO);
+  }
+
+  // Restricts a - b to `bounds`.
+  void meet_difference(reg_t a, reg_t b, const DifferenceDomain& bounds);
+
+  // Forgets everything about the value of `reg`.
+  void forget(reg_t reg);
+
+  // The registers known to hold the length of the array in `array`.
+  std::vector<reg_t> get_lengths(reg_t array) const;
+
+  boost::optional<reg_t> get_array(reg_t length) const;
+
+  void set_array(reg_t length, reg_t array);
+
+  // The registers with known bounds for their difference with `reg`, with
+  // the bounds of reg - other.
+  std::vector<std::pair<reg_t, DifferenceDomain>> get_differences(
+      reg_t reg) const;
+
+ private:
+  DifferenceDomain get_direct_difference(reg_t a, reg_t b) const;
+};
+
+class FixpointIterator final
+    : public ir_analyzer::StaticIRAnalyzer<FixpointIterator, Environment> {
+ public:
+  using StaticIRAnalyzer::StaticIRAnalyzer;
+
+  void analyze_node(const NodeId& block, Environment* env) const override;
+
+  // When `insn` completes normally, its array index was in bounds. That is
+  // only known for the last instruction of a block on its successor edges.
+  void analyze_instruction(const IRInstruction* insn,
+                           Environment* env,
+                           bool is_last = false) const;
+
+  Environment analyze_edge(const EdgeId& edge,
+                           const Environment& exit_state) const override;
+};
+
+// Whether the array access `insn` is proven to be in bounds in `env`.
+bool is_in_bounds(const Environment& env, const IRInstruction* insn);
+
+struct Stats {
+  size_t branches_removed{0};
+  size_t array_accesses{0};
+  size_t array_accesses_in_bounds{0};
+
+  Stats& operator+=(const Stats& that);
+};
+
+/*
+ * Removes the conditional branches of `cfg` that always go the same way given
+ * the bounds of the differences of the registers they compare. The cfg must
+ * be editable.
+ */
+Stats remove_redundant_range_checks(cfg::ControlFlowGraph& cfg);
+
+} // namespace range_checks
+
+/*
+ * Range checks on array indices and loop counters that the dex code repeats,
+ * e.g. from inlined accessors like Kotlin's getOrNull() inside a loop that
+ * already stays within the bounds of the array, cost a compare and a branch
+ * per iteration in the interpreter. This pass proves them redundant with a
+ * relational analysis of integer registers, which also takes into account
+ * that an array access that completes normally had its index in bounds.
+ *
+ * Null checks, including the Kotlin null check intrinsics, are left to
+ * ConstantPropagationPass, which already knows that a register is not null
+ * after it was dereferenced.
+ */
+class RemoveRedundantRangeChecksPass : public Pass {
+ public:
+  RemoveRedundantRangeChecksPass() : Pass("RemoveRedundantRangeChecksPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+};
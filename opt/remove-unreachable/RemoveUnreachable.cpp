@@ -165,6 +165,31 @@ void write_out_removed_symbols_references(
   }
 }
 
+// Asserts that a sweep would not remove anything.
+void check_all_marked(const DexStoresVector& stores,
+                      const reachability::ReachableObjects& reachables) {
+  auto check = [&](const auto* obj) {
+    always_assert_log(reachables.marked_unsafe(obj),
+                      "Incremental reachability missed unreachable %s",
+                      SHOW(obj));
+  };
+  walk::parallel::classes(build_class_scope(stores), [&](const DexClass* cls) {
+    check(cls);
+    for (auto* f : cls->get_ifields()) {
+      check(f);
+    }
+    for (auto* f : cls->get_sfields()) {
+      check(f);
+    }
+    for (auto* m : cls->get_dmethods()) {
+      check(m);
+    }
+    for (auto* m : cls->get_vmethods()) {
+      check(m);
+    }
+  });
+}
+
 } // namespace
 
 namespace mog = method_override_graph;
@@ -196,6 +221,19 @@ void RemoveUnreachablePassBase::run_pass(DexStoresVector& stores,
   TRACE(RMU, 2, "RMU: remove_no_argument_constructors %d",
         m_remove_no_argument_constructors);
   int num_ignore_check_strings = 0;
+  if (m_incremental && !emit_graph_this_run && m_last_fingerprint &&
+      *m_last_fingerprint ==
+          reachability::compute_fingerprint(build_class_scope(stores))) {
+    TRACE(RMU, 1, "RMU: nothing changed since the last sweep");
+    pm.set_metric("incremental_reused", 1);
+    if (m_incremental_cross_check) {
+      auto reachables = this->compute_reachable_objects(
+          stores, pm, &num_ignore_check_strings, emit_graph_this_run,
+          m_remove_no_argument_constructors);
+      check_all_marked(stores, *reachables);
+    }
+    return;
+  }
   auto reachables = this->compute_reachable_objects(
       stores, pm, &num_ignore_check_strings, emit_graph_this_run,
       m_remove_no_argument_constructors);
@@ -218,6 +256,10 @@ void RemoveUnreachablePassBase::run_pass(DexStoresVector& stores,
   }
   reachability::sweep(stores, *reachables,
                       output_unreachable_symbols ? &removed_symbols : nullptr);
+  if (m_incremental) {
+    m_last_fingerprint =
+        reachability::compute_fingerprint(build_class_scope(stores));
+  }
 
   reachability::ObjectCounts after = reachability::count_objects(stores);
   TRACE(RMU, 1, "after: %lu classes, %lu fields, %lu methods",
@@ -28,6 +28,11 @@ class RemoveUnreachablePassBase : public Pass {
     bind("remove_no_argument_constructors",
          false,
          m_remove_no_argument_constructors);
+    // When nothing that marking depends on changed since the previous sweep
+    // of this pass, everything left is reachable and the marking is skipped.
+    // The cross-check runs it anyway and asserts that nothing is unreachable.
+    bind("incremental", false, m_incremental);
+    bind("incremental_cross_check", false, m_incremental_cross_check);
     after_configuration([this] {
       // To keep the backward compatability of this code, ensure that the
       // "MemberClasses" annotation is always in system_annos.
@@ -55,6 +60,12 @@ class RemoveUnreachablePassBase : public Pass {
   boost::optional<uint32_t> m_emit_graph_on_run;
   bool m_always_emit_unreachable_symbols = false;
   bool m_emit_removed_symbols_references = false;
+  bool m_incremental = false;
+  bool m_incremental_cross_check = false;
+
+ private:
+  // The fingerprint of the scope right after the previous sweep, if any.
+  boost::optional<size_t> m_last_fingerprint;
 };
 
 class RemoveUnreachablePass : public RemoveUnreachablePassBase {
@@ -47,6 +47,7 @@ constexpr const char* METRIC_DEAD_INSTRUCTION_COUNT =
 constexpr const char* METRIC_UNREACHABLE_INSTRUCTION_COUNT =
     "num_local_dce_unreachable_instruction_count";
 constexpr const char* METRIC_ITERATIONS = "iterations";
+constexpr const char* METRIC_LIVE_ARGS_CACHE_HITS = "live_args_cache_hits";
 
 static LocalDce::Stats add_dce_stats(LocalDce::Stats a, LocalDce::Stats b) {
   return {a.dead_instruction_count + b.dead_instruction_count,
@@ -73,6 +74,7 @@ RemoveArgs::PassStats RemoveArgs::run() {
   pass_stats.method_protos_reordered_count =
       method_stats.method_protos_reordered_count;
   pass_stats.local_dce_stats = method_stats.local_dce_stats;
+  pass_stats.live_args_cache_hits = m_live_args_cache_hits;
   return pass_stats;
 }
 
@@ -293,6 +295,35 @@ std::deque<uint16_t> compute_live_args(
   return live_arg_idxs;
 }
 
+/**
+ * Like compute_live_args, but reuses the result of an earlier iteration when
+ * the method did not change since.
+ */
+std::deque<uint16_t> RemoveArgs::get_live_args(
+    DexMethod* method,
+    size_t num_args,
+    std::vector<IRInstruction*>* dead_insns) {
+  if (m_live_args_cache) {
+    auto it = m_live_args_cache->find(method);
+    if (it != m_live_args_cache->end()) {
+      m_live_args_cache_hits++;
+      *dead_insns = it->second.dead_insns;
+      return it->second.live_arg_idxs;
+    }
+  }
+  auto live_arg_idxs = compute_live_args(method, num_args, dead_insns);
+  if (m_live_args_cache) {
+    m_live_args_cache->emplace(method, LiveArgs{live_arg_idxs, *dead_insns});
+  }
+  return live_arg_idxs;
+}
+
+void RemoveArgs::invalidate_live_args(const DexMethod* method) {
+  if (m_live_args_cache) {
+    m_live_args_cache->erase(method);
+  }
+}
+
 /**
  * Returns an updated argument type list for the given method with the given
  * live argument indices.
@@ -419,10 +450,12 @@ bool RemoveArgs::update_method_signature(
   return true;
 }
 
+template <typename GetLiveArgsFn>
 static void compute_dead_insns_and_remove_result(
     DexMethod* method,
     const mog::Graph& override_graph,
     const ConcurrentSet<DexMethod*>& results_used,
+    const GetLiveArgsFn& get_live_args,
     std::deque<uint16_t>* live_arg_idxs,
     std::vector<IRInstruction*>* dead_insns,
     bool* remove_result) {
@@ -456,7 +489,7 @@ static void compute_dead_insns_and_remove_result(
     return;
   }
 
-  *live_arg_idxs = compute_live_args(method, num_args, dead_insns);
+  *live_arg_idxs = get_live_args(method, num_args, dead_insns);
 }
 
 // When reordering a method's proto, we need to update the method's load-param
@@ -539,9 +572,13 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
       reordered_proto = it->second;
     } else {
       // Only if there's no reordering, we'll look at dead args and results
-      compute_dead_insns_and_remove_result(method, override_graph,
-                                           m_result_used, &live_arg_idxs,
-                                           &dead_insns, &remove_result);
+      compute_dead_insns_and_remove_result(
+          method, override_graph, m_result_used,
+          [this](DexMethod* m, size_t num_args,
+                 std::vector<IRInstruction*>* dead) {
+            return get_live_args(m, num_args, dead);
+          },
+          &live_arg_idxs, &dead_insns, &remove_result);
       if (dead_insns.empty() && !remove_result) {
         return;
       }
@@ -596,6 +633,7 @@ RemoveArgs::MethodStats RemoveArgs::update_method_protos(
     for (auto& p : class_entries.at(cls)) {
       DexMethod* method = p.first;
       const Entry& entry = p.second;
+      invalidate_live_args(method);
 
       if (!entry.dead_insns.empty()) {
         // We update the method signature, so we must remove unused
@@ -686,6 +724,8 @@ size_t RemoveArgs::update_callsites() {
           if (opcode::is_an_invoke(insn->opcode())) {
             size_t insn_args_removed = update_callsite(insn);
             if (insn_args_removed > 0) {
+              // Arguments of the caller may have become dead.
+              invalidate_live_args(method);
               log_opt(CALLSITE_ARGS_REMOVED, method, insn);
               callsite_args_removed += insn_args_removed;
             }
@@ -706,11 +746,15 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
   size_t num_method_results_removed_count = 0;
   size_t num_method_protos_reordered_count = 0;
   size_t num_iterations = 0;
+  size_t num_live_args_cache_hits = 0;
   LocalDce::Stats local_dce_stats{0, 0};
+  LiveArgsCache live_args_cache;
   while (true) {
     num_iterations++;
-    RemoveArgs rm_args(scope, m_blocklist, m_total_iterations++);
+    RemoveArgs rm_args(scope, m_blocklist, m_total_iterations++,
+                       &live_args_cache);
     auto pass_stats = rm_args.run();
+    num_live_args_cache_hits += pass_stats.live_args_cache_hits;
     if (pass_stats.methods_updated_count == 0) {
       break;
     }
@@ -755,6 +799,7 @@ void RemoveUnusedArgsPass::run_pass(DexStoresVector& stores,
   mgr.set_metric(METRIC_UNREACHABLE_INSTRUCTION_COUNT,
                  local_dce_stats.unreachable_instruction_count);
   mgr.set_metric(METRIC_ITERATIONS, num_iterations);
+  mgr.set_metric(METRIC_LIVE_ARGS_CACHE_HITS, num_live_args_cache_hits);
 }
 
 static RemoveUnusedArgsPass s_pass;
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <mutex>
 
 #include "ConcurrentContainers.h"
@@ -22,6 +23,17 @@ std::deque<uint16_t> compute_live_args(DexMethod* method,
                                        size_t num_args,
                                        std::vector<IRInstruction*>* dead_insns);
 
+// The result of compute_live_args for a method.
+struct LiveArgs {
+  std::deque<uint16_t> live_arg_idxs;
+  std::vector<IRInstruction*> dead_insns;
+};
+
+// The live args of the methods whose code and proto did not change since they
+// were computed. Shared across the iterations of RemoveUnusedArgsPass, as most
+// methods are left alone by an iteration.
+using LiveArgsCache = ConcurrentMap<const DexMethod*, LiveArgs>;
+
 class RemoveArgs {
  public:
   struct MethodStats {
@@ -38,12 +50,17 @@ class RemoveArgs {
     size_t method_results_removed_count{0};
     size_t method_protos_reordered_count{0};
     LocalDce::Stats local_dce_stats{0, 0};
+    size_t live_args_cache_hits{0};
   };
 
   RemoveArgs(const Scope& scope,
              const std::vector<std::string>& blocklist,
-             size_t iteration = 0)
-      : m_scope(scope), m_blocklist(blocklist), m_iteration(iteration){};
+             size_t iteration = 0,
+             LiveArgsCache* live_args_cache = nullptr)
+      : m_scope(scope),
+        m_blocklist(blocklist),
+        m_iteration(iteration),
+        m_live_args_cache(live_args_cache){};
   RemoveArgs::PassStats run();
 
  private:
@@ -62,6 +79,8 @@ class RemoveArgs {
   std::unordered_map<DexProto*, DexProto*> m_reordered_protos;
   const std::vector<std::string>& m_blocklist;
   size_t m_iteration;
+  LiveArgsCache* m_live_args_cache;
+  std::atomic<size_t> m_live_args_cache_hits{0};
 
   std::deque<DexType*> get_live_arg_type_list(
       DexMethod* method, const std::deque<uint16_t>& live_arg_idxs);
@@ -74,6 +93,10 @@ class RemoveArgs {
   size_t update_callsites();
   void gather_results_used();
   void compute_reordered_protos(const mog::Graph& override_graph);
+  std::deque<uint16_t> get_live_args(DexMethod* method,
+                                     size_t num_args,
+                                     std::vector<IRInstruction*>* dead_insns);
+  void invalidate_live_args(const DexMethod* method);
 };
 
 class RemoveUnusedArgsPass : public Pass {
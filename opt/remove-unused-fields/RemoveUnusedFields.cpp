@@ -13,6 +13,7 @@
 
 #include "CFGMutation.h"
 #include "ConfigFiles.h"
+#include "DenseSideTable.h"
 #include "DexClass.h"
 #include "FieldOpTracker.h"
 #include "IRCode.h"
@@ -37,6 +38,14 @@ bool has_non_zero_static_value(DexField* field) {
   return ev != nullptr && !ev->is_zero();
 }
 
+// What transform() does with the accesses of a field.
+enum class FieldKind : uint8_t {
+  NONE,
+  UNREAD,
+  UNWRITTEN,
+  ZERO_WRITTEN,
+};
+
 class RemoveUnusedFields final {
  public:
   RemoveUnusedFields(const Config& config, const Scope& scope)
@@ -130,6 +139,7 @@ class RemoveUnusedFields final {
           is_allowlisted(field)) {
         if (m_config.remove_unread_fields && stats.reads == 0) {
           m_unread_fields.emplace(field);
+          m_field_kinds[field] = FieldKind::UNREAD;
           if (m_config.remove_vestigial_objects_written_fields &&
               !field_writes->non_vestigial_objects_written_fields.count(
                   field)) {
@@ -138,10 +148,12 @@ class RemoveUnusedFields final {
         } else if (m_config.remove_unwritten_fields && stats.writes == 0 &&
                    !has_non_zero_static_value(field)) {
           m_unwritten_fields.emplace(field);
+          m_field_kinds[field] = FieldKind::UNWRITTEN;
         } else if (m_config.remove_zero_written_fields &&
                    !field_writes->non_zero_written_fields.count(field) &&
                    !has_non_zero_static_value(field)) {
           m_zero_written_fields.emplace(field);
+          m_field_kinds[field] = FieldKind::ZERO_WRITTEN;
         }
       }
     }
@@ -155,11 +167,21 @@ class RemoveUnusedFields final {
   }
 
   void transform() {
+    if (m_unread_fields.empty() && m_unwritten_fields.empty() &&
+        m_zero_written_fields.empty()) {
+      walk::parallel::code(m_scope, [&](const DexMethod*, IRCode& code) {
+        code.clear_cfg();
+      });
+      return;
+    }
     // Replace reads to unwritten fields with appropriate const-0 instructions,
-    // and remove the writes to unread fields.
+    // and remove the writes to unread fields. The kinds of the fields are
+    // looked up in a dense table, as this is done for every field access of
+    // the program.
     walk::parallel::code(m_scope, [&](const DexMethod*, IRCode& code) {
       auto& cfg = code.cfg();
       cfg::CFGMutation m(cfg);
+      size_t unremovable_unread_field_puts{0};
       auto iterable = cfg::InstructionIterable(cfg);
       for (auto insn_it = iterable.begin(); insn_it != iterable.end();
            ++insn_it) {
@@ -168,23 +190,31 @@ class RemoveUnusedFields final {
           continue;
         }
         auto field = resolve_field(insn->get_field());
+        if (field == nullptr) {
+          continue;
+        }
         bool replace_insn = false;
         bool remove_insn = false;
-        if (m_unread_fields.count(field)) {
+        switch (m_field_kinds.at(field)) {
+        case FieldKind::NONE:
+          break;
+        case FieldKind::UNREAD:
           if (can_remove_unread_field_put(field)) {
             always_assert(opcode::is_an_iput(insn->opcode()) ||
                           opcode::is_an_sput(insn->opcode()));
             TRACE(RMUF, 5, "Removing %s", SHOW(insn));
             remove_insn = true;
           } else {
-            m_unremovable_unread_field_puts++;
+            unremovable_unread_field_puts++;
           }
-        } else if (m_unwritten_fields.count(field)) {
+          break;
+        case FieldKind::UNWRITTEN:
           always_assert(opcode::is_an_iget(insn->opcode()) ||
                         opcode::is_an_sget(insn->opcode()));
           TRACE(RMUF, 5, "Replacing %s with const 0", SHOW(insn));
           replace_insn = true;
-        } else if (m_zero_written_fields.count(field)) {
+          break;
+        case FieldKind::ZERO_WRITTEN:
           if (opcode::is_an_iput(insn->opcode()) ||
               opcode::is_an_sput(insn->opcode())) {
             TRACE(RMUF, 5, "Removing %s", SHOW(insn));
@@ -195,6 +225,7 @@ class RemoveUnusedFields final {
             TRACE(RMUF, 5, "Replacing %s with const 0", SHOW(insn));
             replace_insn = true;
           }
+          break;
         }
         if (replace_insn) {
           auto move_result = cfg.move_result_of(insn_it);
@@ -212,6 +243,9 @@ class RemoveUnusedFields final {
       }
       m.flush();
       code.clear_cfg();
+      if (unremovable_unread_field_puts) {
+        m_unremovable_unread_field_puts += unremovable_unread_field_puts;
+      }
     });
   }
 
@@ -221,6 +255,7 @@ class RemoveUnusedFields final {
   std::unordered_set<const DexField*> m_unwritten_fields;
   std::unordered_set<const DexField*> m_zero_written_fields;
   std::unordered_set<const DexField*> m_vestigial_objects_written_fields;
+  DenseSideTable<DexFieldRef, FieldKind> m_field_kinds{FieldKind::NONE};
   field_op_tracker::TypeLifetimes m_type_lifetimes;
   std::atomic<size_t> m_unremovable_unread_field_puts{0};
 };
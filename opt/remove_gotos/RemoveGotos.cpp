@@ -158,11 +158,14 @@ void RemoveGotosPass::run_pass(DexStoresVector& stores,
   auto scope = build_class_scope(stores);
 
   size_t total_gotos_removed =
-      walk::parallel::methods<size_t>(scope, [](DexMethod* m) -> size_t {
+      walk::parallel::methods<size_t>(scope, [&](DexMethod* m) -> size_t {
         if (!m->get_code()) {
           return 0;
         }
-        return RemoveGotos::process_method(m);
+        size_t gotos_removed = 0;
+        mgr.run_on_changed_method(
+            m, [&] { gotos_removed = RemoveGotos::process_method(m); });
+        return gotos_removed;
       });
 
   mgr.incr_metric(METRIC_GOTO_REMOVED, total_gotos_removed);
@@ -15,5 +15,9 @@ class RemoveGotosPass : public Pass {
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
+  bool is_method_local() const override { return true; }
+
+  uint8_t writes() const override { return CODE; }
+
   size_t run(DexMethod*);
 };
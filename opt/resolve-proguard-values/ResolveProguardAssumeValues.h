@@ -54,6 +54,9 @@ class ResolveProguardAssumeValuesPass : public Pass {
   //
   ResolveProguardAssumeValuesPass() : Pass("ResolveProguardAssumeValuesPass") {}
   static ResolveProguardAssumeValuesPass::Stats process_for_code(IRCode* code);
+
+  bool is_editable_cfg_friendly() const override { return true; }
+
   void run_pass(DexStoresVector& stores,
                 ConfigFiles&,
                 PassManager& mgr) override;
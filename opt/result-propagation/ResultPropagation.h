@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
 #include "MethodOverrideGraph.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 #include "Resolver.h"
 
@@ -142,6 +144,11 @@ class ResultPropagationPass : public Pass {
  public:
   ResultPropagationPass() : Pass("ResultPropagationPass") {}
 
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // Only the code of the methods changes.
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ScalarReplacement.h"
+
+#include <boost/optional.hpp>
+
+#include "BlamingAnalysis.h"
+#include "CFGMutation.h"
+#include "ControlFlow.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "PassManager.h"
+#include "Resolver.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Walkers.h"
+
+namespace ptrs = local_pointers;
+namespace blaming = local_pointers::blaming;
+
+namespace {
+
+using FieldAssignments = ScalarReplacementPass::FieldAssignments;
+using ScalarizableClasses = ScalarReplacementPass::ScalarizableClasses;
+using Stats = ScalarReplacementPass::Stats;
+
+bool is_scalarizable(const DexClass* cls) {
+  if (cls->is_external() || is_interface(cls) || is_abstract(cls) ||
+      cls->get_super_class() != type::java_lang_Object() ||
+      cls->get_clinit() != nullptr) {
+    return false;
+  }
+  // Removing the allocation would skip the finalizer.
+  for (auto* method : cls->get_vmethods()) {
+    if (method->get_name()->str() == "finalize" &&
+        method->get_proto()->get_args()->size() == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Returns the assignments made by `ctor` if all it does is call
+ * Object.<init>() and assign some of its arguments to fields of its class.
+ */
+boost::optional<FieldAssignments> get_trivial_assignments(
+    const DexMethod* ctor) {
+  auto* code = ctor->get_code();
+  if (code == nullptr) {
+    return boost::none;
+  }
+  auto* object_init = DexMethod::get_method("Ljava/lang/Object;.<init>:()V");
+  std::unordered_map<reg_t, uint16_t> param_indices;
+  boost::optional<reg_t> this_reg;
+  size_t init_calls{0};
+  FieldAssignments assignments;
+  for (const auto& mie : InstructionIterable(code)) {
+    auto* insn = mie.insn;
+    auto op = insn->opcode();
+    if (opcode::is_a_load_param(op)) {
+      if (!this_reg) {
+        this_reg = insn->dest();
+      }
+      param_indices.emplace(insn->dest(), param_indices.size());
+    } else if (op == OPCODE_INVOKE_DIRECT) {
+      if (insn->get_method() != object_init || insn->src(0) != *this_reg) {
+        return boost::none;
+      }
+      ++init_calls;
+    } else if (opcode::is_an_iput(op)) {
+      auto it = param_indices.find(insn->src(0));
+      if (insn->src(1) != *this_reg || insn->src(0) == *this_reg ||
+          it == param_indices.end()) {
+        return boost::none;
+      }
+      auto* field = resolve_field(insn->get_field(), FieldSearch::Instance);
+      if (field == nullptr || field->get_class() != ctor->get_class()) {
+        return boost::none;
+      }
+      assignments.emplace_back(it->second, field);
+    } else if (op != OPCODE_RETURN_VOID) {
+      return boost::none;
+    }
+  }
+  if (init_calls != 1) {
+    return boost::none;
+  }
+  return assignments;
+}
+
+DexField* resolve_own_field(const IRInstruction* insn, const DexType* type) {
+  auto* field = resolve_field(insn->get_field(), FieldSearch::Instance);
+  return field != nullptr && field->get_class() == type ? field : nullptr;
+}
+
+/*
+ * Whether `insn`, which reads a pointer to the object allocated by `alloc`
+ * (and nothing else) in its `src_idx`-th source, can be rewritten to work on
+ * the fields of the object instead. A move-result reads the result register
+ * as its 0th source.
+ */
+bool is_replaceable_use(const ScalarizableClasses& classes,
+                        const IRInstruction* insn,
+                        size_t src_idx,
+                        const IRInstruction* alloc) {
+  auto op = insn->opcode();
+  auto* type = alloc->get_type();
+  if (op == IOPCODE_MOVE_RESULT_PSEUDO_OBJECT || op == OPCODE_MOVE_OBJECT) {
+    return true;
+  } else if (opcode::is_an_iget(op)) {
+    return src_idx == 0 && resolve_own_field(insn, type) != nullptr;
+  } else if (opcode::is_an_iput(op)) {
+    return src_idx == 1 && resolve_own_field(insn, type) != nullptr;
+  } else if (op == OPCODE_INVOKE_DIRECT) {
+    auto* method = insn->get_method();
+    return src_idx == 0 && method->get_class() == type &&
+           classes.constructors.count(method) != 0;
+  }
+  return false;
+}
+
+IRInstruction* make_move(const DexType* type, reg_t dest, reg_t src) {
+  auto* insn = new IRInstruction(opcode::move_opcode(type));
+  insn->set_dest(dest);
+  insn->set_src(0, src);
+  return insn;
+}
+
+} // namespace
+
+ScalarizableClasses ScalarReplacementPass::find_scalarizable_classes(
+    const Scope& scope) {
+  ScalarizableClasses classes;
+  for (const auto* cls : scope) {
+    if (!is_scalarizable(cls)) {
+      continue;
+    }
+    for (const auto* method : cls->get_dmethods()) {
+      if (!method::is_init(method)) {
+        continue;
+      }
+      auto assignments = get_trivial_assignments(method);
+      if (assignments) {
+        classes.constructors.emplace(method, std::move(*assignments));
+        classes.types.insert(cls->get_type());
+      }
+    }
+  }
+  return classes;
+}
+
+Stats ScalarReplacementPass::replace_allocations(
+    const ScalarizableClasses& classes, cfg::ControlFlowGraph& cfg) {
+  // The allocations of candidates, in order so that the temporaries we
+  // allocate are deterministic.
+  std::vector<const IRInstruction*> allocs;
+  std::unordered_set<DexMethodRef*> safe_method_refs;
+  for (const auto& mie : InstructionIterable(cfg)) {
+    auto* insn = mie.insn;
+    auto op = insn->opcode();
+    if (op == OPCODE_NEW_INSTANCE && classes.types.count(insn->get_type())) {
+      allocs.push_back(insn);
+    } else if (op == OPCODE_INVOKE_DIRECT &&
+               classes.constructors.count(insn->get_method())) {
+      safe_method_refs.insert(insn->get_method());
+    }
+  }
+  if (allocs.empty()) {
+    return Stats();
+  }
+
+  // The trivial constructors don't let anything escape, so the instances that
+  // have no one to blame for escaping are only used locally.
+  if (!cfg.exit_block()) {
+    cfg.calculate_exit_block();
+  }
+  std::unordered_set<const IRInstruction*> allocators(allocs.begin(),
+                                                      allocs.end());
+  blaming::BlameStore::Domain store;
+  for (const auto* alloc : allocs) {
+    store.set(alloc, blaming::BlameStore::unallocated());
+  }
+  blaming::FixpointIterator fp_iter(cfg, allocators,
+                                    std::move(safe_method_refs), {});
+  fp_iter.run({ptrs::PointerEnvironment(), std::move(store)});
+  blaming::BlameMap blame_map(
+      fp_iter.get_exit_state_at(cfg.exit_block()).get_store());
+  std::unordered_set<const IRInstruction*> candidates;
+  for (const auto* alloc : allocs) {
+    auto blame = blame_map.get(alloc);
+    if (blame.allocated() && blame.to_blame().is_value() &&
+        blame.to_blame().size() == 0) {
+      candidates.insert(alloc);
+    }
+  }
+  if (candidates.empty()) {
+    return Stats();
+  }
+
+  // Not escaping is not enough: every instruction that reads a candidate must
+  // be one we know how to rewrite, and must not be able to see any other
+  // value.
+  std::unordered_set<const IRInstruction*> rejected;
+  std::unordered_map<const IRInstruction*,
+                     std::vector<cfg::InstructionIterator>>
+      uses;
+  std::unordered_map<const IRInstruction*, cfg::InstructionIterator> alloc_its;
+  // Non-pointer values are Top, and so are the registers where a pointer got
+  // joined with one. The reads of such registers are not tracked below, so a
+  // candidate that may be held by a register that is Top at the start of a
+  // block has to stay, e.g. for `v0 = c ? new Foo : 1; iget v0`.
+  for (auto* block : cfg.blocks()) {
+    auto entry_env = fp_iter.get_entry_state_at(block);
+    if (entry_env.is_bottom()) {
+      continue;
+    }
+    for (auto* e : block->preds()) {
+      auto pred_env = fp_iter.get_exit_state_at(e->src());
+      if (pred_env.is_bottom()) {
+        continue;
+      }
+      const auto& pred_penv = pred_env.get_pointer_environment();
+      if (!pred_penv.is_value()) {
+        continue;
+      }
+      for (const auto& pair : pred_penv.bindings()) {
+        if (!pair.second.is_value() ||
+            !entry_env.get_pointers(pair.first).is_top()) {
+          continue;
+        }
+        for (const auto* pointer : pair.second.elements()) {
+          if (candidates.count(pointer)) {
+            rejected.insert(pointer);
+          }
+        }
+      }
+    }
+  }
+  for (auto* block : cfg.blocks()) {
+    auto env = fp_iter.get_entry_state_at(block);
+    if (env.is_bottom()) {
+      if (block->begin() != block->end()) {
+        // We know nothing about the values in unreachable code.
+        return Stats();
+      }
+      continue;
+    }
+    for (auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      auto it = block->to_cfg_instruction_iterator(mie);
+      auto check_read = [&](const ptrs::PointerSet& pointers, size_t src_idx) {
+        if (!pointers.is_value()) {
+          // Not a candidate, see above.
+          return;
+        }
+        for (const auto* pointer : pointers.elements()) {
+          if (candidates.count(pointer) == 0) {
+            continue;
+          }
+          if (pointers.size() == 1 &&
+              is_replaceable_use(classes, insn, src_idx, pointer)) {
+            uses[pointer].push_back(it);
+          } else {
+            rejected.insert(pointer);
+          }
+        }
+      };
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        check_read(env.get_pointers(insn->src(i)), i);
+      }
+      if (opcode::is_move_result_any(insn->opcode())) {
+        check_read(env.get_pointers(RESULT_REGISTER), 0);
+      }
+      if (candidates.count(insn)) {
+        alloc_its.emplace(insn, it);
+        // The fields of an instance live in a single set of registers, so a
+        // previous instance from the same allocation must not be reachable
+        // anymore when a new one gets allocated, e.g. in a loop.
+        const auto& penv = env.get_pointer_environment();
+        if (penv.is_value()) {
+          for (const auto& pair : penv.bindings()) {
+            if (pair.second.is_value() && pair.second.contains(insn)) {
+              rejected.insert(insn);
+            }
+          }
+        }
+      }
+      fp_iter.analyze_instruction(insn, &env);
+    }
+  }
+
+  Stats stats;
+  cfg::CFGMutation mutation(cfg);
+  for (const auto* alloc : allocs) {
+    if (candidates.count(alloc) == 0 || rejected.count(alloc) ||
+        alloc_its.count(alloc) == 0) {
+      continue;
+    }
+    std::vector<const DexField*> fields;
+    std::unordered_map<const DexField*, reg_t> field_regs;
+    auto get_field_reg = [&](const DexField* field) {
+      auto it = field_regs.find(field);
+      if (it != field_regs.end()) {
+        return it->second;
+      }
+      auto reg = type::is_wide_type(field->get_type())
+                     ? cfg.allocate_wide_temp()
+                     : cfg.allocate_temp();
+      fields.push_back(field);
+      field_regs.emplace(field, reg);
+      return reg;
+    };
+    for (const auto& it : uses[alloc]) {
+      auto* insn = it->insn;
+      auto op = insn->opcode();
+      if (op == IOPCODE_MOVE_RESULT_PSEUDO_OBJECT) {
+        // Removed along with the allocation.
+        continue;
+      } else if (op == OPCODE_MOVE_OBJECT) {
+        mutation.remove(it);
+      } else if (opcode::is_an_iget(op)) {
+        auto* field = resolve_own_field(insn, alloc->get_type());
+        auto dest = cfg.move_result_of(it)->insn->dest();
+        mutation.replace(it, {make_move(field->get_type(), dest,
+                                        get_field_reg(field))});
+      } else if (opcode::is_an_iput(op)) {
+        auto* field = resolve_own_field(insn, alloc->get_type());
+        mutation.replace(it, {make_move(field->get_type(),
+                                        get_field_reg(field), insn->src(0))});
+      } else {
+        always_assert(op == OPCODE_INVOKE_DIRECT);
+        std::vector<IRInstruction*> moves;
+        for (const auto& assignment :
+             classes.constructors.at(insn->get_method())) {
+          auto* field = assignment.second;
+          moves.push_back(make_move(field->get_type(), get_field_reg(field),
+                                    insn->src(assignment.first)));
+        }
+        mutation.replace(it, std::move(moves));
+      }
+    }
+    // A new instance has all its fields set to zero.
+    std::vector<IRInstruction*> zeroes;
+    for (const auto* field : fields) {
+      auto* insn = new IRInstruction(type::is_wide_type(field->get_type())
+                                         ? OPCODE_CONST_WIDE
+                                         : OPCODE_CONST);
+      insn->set_dest(field_regs.at(field))->set_literal(0);
+      zeroes.push_back(insn);
+    }
+    mutation.replace(alloc_its.at(alloc), std::move(zeroes));
+    TRACE(SCALAR_REPL, 3, "Scalarized %s with %zu fields", SHOW(alloc),
+          fields.size());
+    ++stats.allocations_removed;
+    stats.fields_scalarized += fields.size();
+  }
+  mutation.flush();
+  if (stats.allocations_removed > 0) {
+    stats.methods_changed = 1;
+  }
+  return stats;
+}
+
+void ScalarReplacementPass::run_pass(DexStoresVector& stores,
+                                     ConfigFiles&,
+                                     PassManager& mgr) {
+  auto scope = build_class_scope(stores);
+  auto classes = find_scalarizable_classes(scope);
+  TRACE(SCALAR_REPL, 1, "%zu scalarizable classes with %zu constructors",
+        classes.types.size(), classes.constructors.size());
+
+  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr || method->rstate.no_optimizations()) {
+      return Stats();
+    }
+    bool has_candidate = false;
+    for (const auto& mie : InstructionIterable(code)) {
+      auto* insn = mie.insn;
+      if (insn->opcode() == OPCODE_NEW_INSTANCE &&
+          classes.types.count(insn->get_type())) {
+        has_candidate = true;
+        break;
+      }
+    }
+    if (!has_candidate) {
+      return Stats();
+    }
+    code->build_cfg(/* editable */ true);
+    auto method_stats = replace_allocations(classes, code->cfg());
+    code->clear_cfg();
+    return method_stats;
+  });
+
+  mgr.set_metric("num_allocations_removed", stats.allocations_removed);
+  mgr.set_metric("num_fields_scalarized", stats.fields_scalarized);
+  mgr.set_metric("num_methods_changed", stats.methods_changed);
+}
+
+static ScalarReplacementPass s_pass;
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "DexClass.h"
+#include "Pass.h"
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+/*
+ * This pass replaces the objects that are allocated in a method and never
+ * escape it by their fields, which then live in registers:
+ *
+ *   new-instance LBox;
+ *   move-result-pseudo-object v0
+ *   invoke-direct (v0 v1) LBox;.<init>:(I)V
+ *   iget v0 LBox;.value:I
+ *   move-result-pseudo v2
+ *
+ * becomes
+ *
+ *   const v3 0
+ *   move v3 v1
+ *   move v2 v3
+ *
+ * which saves the allocation, and the pressure it puts on the GC.
+ *
+ * Only the instances of classes that directly extend java.lang.Object, have
+ * no static initializer and no finalizer, and are built by a constructor that
+ * does nothing but assign its arguments to fields are candidates. An instance
+ * is replaced if every use of it is a field access or its construction, which
+ * is established with the blaming escape analysis.
+ */
+class ScalarReplacementPass : public Pass {
+ public:
+  // The (parameter index, field) assignments a trivial constructor makes to
+  // its `this` argument, in order.
+  using FieldAssignments = std::vector<std::pair<uint16_t, DexField*>>;
+
+  struct ScalarizableClasses {
+    std::unordered_set<const DexType*> types;
+    std::unordered_map<const DexMethodRef*, FieldAssignments> constructors;
+  };
+
+  struct Stats {
+    size_t allocations_removed{0};
+    size_t fields_scalarized{0};
+    size_t methods_changed{0};
+
+    Stats& operator+=(const Stats& that) {
+      allocations_removed += that.allocations_removed;
+      fields_scalarized += that.fields_scalarized;
+      methods_changed += that.methods_changed;
+      return *this;
+    }
+  };
+
+  ScalarReplacementPass() : Pass("ScalarReplacementPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+
+  static ScalarizableClasses find_scalarizable_classes(const Scope& scope);
+
+  // Exposed for testing. The cfg must be editable.
+  static Stats replace_allocations(const ScalarizableClasses& classes,
+                                   cfg::ControlFlowGraph& cfg);
+};
@@ -8,6 +8,7 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -24,6 +25,53 @@
 #include "StlUtil.h"
 #include "Trace.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+/**
+ * The references to the single impl interfaces that one worker found, by
+ * interface, to be added to the SingleImplData once all workers are done.
+ */
+struct InterfaceRefs {
+  std::vector<DexMethod*> methoddefs;
+  std::vector<std::tuple<DexMethod*, IRInstruction*, IRList::iterator>>
+      referencing_insns;
+  OpcodeList typerefs;
+  std::vector<std::pair<DexFieldRef*, IRInstruction*>> fieldrefs;
+  std::vector<std::pair<DexMethodRef*, IRInstruction*>> intf_methodrefs;
+  std::vector<std::pair<DexMethodRef*, IRInstruction*>> methodrefs;
+};
+
+template <class T>
+void append(std::vector<T>& from, std::vector<T>* to) {
+  if (to->empty()) {
+    to->swap(from);
+  } else {
+    to->insert(to->end(), std::make_move_iterator(from.begin()),
+               std::make_move_iterator(from.end()));
+  }
+}
+
+using RefsByInterface = std::unordered_map<DexType*, InterfaceRefs>;
+
+// Moves the references of a worker into the accumulated ones.
+struct MergeRefs {
+  void operator()(RefsByInterface& from, RefsByInterface* to) const {
+    for (auto& p : from) {
+      auto& from_refs = p.second;
+      auto& to_refs = (*to)[p.first];
+      append(from_refs.methoddefs, &to_refs.methoddefs);
+      append(from_refs.referencing_insns, &to_refs.referencing_insns);
+      append(from_refs.typerefs, &to_refs.typerefs);
+      append(from_refs.fieldrefs, &to_refs.fieldrefs);
+      append(from_refs.intf_methodrefs, &to_refs.intf_methodrefs);
+      append(from_refs.methodrefs, &to_refs.methodrefs);
+    }
+  }
+};
+
+} // namespace
 
 struct AnalysisImpl : SingleImplAnalysis {
   AnalysisImpl(const Scope& scope,
@@ -41,6 +89,7 @@ struct AnalysisImpl : SingleImplAnalysis {
   void remove_escaped();
 
  private:
+  void add_refs(RefsByInterface& refs_by_intf);
   DexType* get_and_check_single_impl(DexType* type);
   void collect_children(const TypeSet& intfs);
   void check_impl_hierarchy();
@@ -332,6 +381,41 @@ void AnalysisImpl::collect_field_defs() {
   });
 }
 
+/**
+ * Add the references that the workers found to the data of their interface.
+ * Each interface only touches its own data, so this runs in parallel over the
+ * interfaces, without taking the locks of the data.
+ */
+void AnalysisImpl::add_refs(RefsByInterface& refs_by_intf) {
+  std::vector<std::pair<DexType*, InterfaceRefs*>> work;
+  work.reserve(refs_by_intf.size());
+  for (auto& p : refs_by_intf) {
+    work.emplace_back(p.first, &p.second);
+  }
+  workqueue_run<std::pair<DexType*, InterfaceRefs*>>(
+      [&](const std::pair<DexType*, InterfaceRefs*>& p) {
+        auto& si = single_impls.at(p.first);
+        auto& refs = *p.second;
+        si.methoddefs.insert(refs.methoddefs.begin(), refs.methoddefs.end());
+        for (auto& t : refs.referencing_insns) {
+          si.referencing_methods[std::get<0>(t)][std::get<1>(t)] =
+              std::get<2>(t);
+        }
+        si.typerefs.insert(si.typerefs.end(), refs.typerefs.begin(),
+                           refs.typerefs.end());
+        for (auto& q : refs.fieldrefs) {
+          si.fieldrefs[q.first].push_back(q.second);
+        }
+        for (auto& q : refs.intf_methodrefs) {
+          si.intf_methodrefs[q.first].insert(q.second);
+        }
+        for (auto& q : refs.methodrefs) {
+          si.methodrefs[q.first].insert(q.second);
+        }
+      },
+      work);
+}
+
 /**
  * Find all methods with a single impl interface in their signature.
  * Also if a method with the interface in the signature is native mark the
@@ -339,29 +423,35 @@ void AnalysisImpl::collect_field_defs() {
  */
 void AnalysisImpl::collect_method_defs() {
 
-  auto check_method_arg = [&](DexType* type, DexMethod* method, bool native) {
+  auto check_method_arg = [&](DexType* type, DexMethod* method, bool native,
+                              RefsByInterface* refs) {
     auto intf = get_and_check_single_impl(type);
     if (!intf) return;
     if (native) {
       escape_interface(intf, NATIVE_METHOD);
     }
-    single_impls[intf].methoddefs.insert(method);
+    (*refs)[intf].methoddefs.push_back(method);
   };
 
-  walk::methods(scope, [&](DexMethod* method) {
-    auto proto = method->get_proto();
-    bool native = is_native(method);
-    check_method_arg(proto->get_rtype(), method, native);
-    auto args = proto->get_args();
-    for (const auto it : args->get_type_list()) {
-      check_method_arg(it, method, native);
-    }
-  });
+  auto refs_by_intf = walk::parallel::methods<RefsByInterface, MergeRefs>(
+      scope, [&](DexMethod* method, RefsByInterface* refs) {
+        auto proto = method->get_proto();
+        bool native = is_native(method);
+        check_method_arg(proto->get_rtype(), method, native, refs);
+        auto args = proto->get_args();
+        for (const auto it : args->get_type_list()) {
+          check_method_arg(it, method, native, refs);
+        }
+      });
+  add_refs(refs_by_intf);
 }
 
 /**
  * Find all opcodes that reference a single implemented interface in a typeref,
  * fieldref or methodref.
+ * Each worker collects the references into its own buffers, which are merged
+ * by interface at the end, instead of locking the data of the interface for
+ * every reference.
  */
 void AnalysisImpl::analyze_opcodes() {
 
@@ -369,33 +459,35 @@ void AnalysisImpl::analyze_opcodes() {
                        const IRList::iterator& insn_it,
                        DexType* type,
                        DexMethodRef* meth,
-                       IRInstruction* insn) {
+                       IRInstruction* insn,
+                       RefsByInterface* refs) {
     auto intf = get_and_check_single_impl(type);
     if (intf) {
-      auto& si = single_impls.at(intf);
-      std::lock_guard<std::mutex> lock(si.mutex);
-      si.referencing_methods[referrer][insn] = insn_it;
-      si.methodrefs[meth].insert(insn);
+      auto& intf_refs = (*refs)[intf];
+      intf_refs.referencing_insns.emplace_back(referrer, insn, insn_it);
+      intf_refs.methodrefs.emplace_back(meth, insn);
     }
   };
 
   auto check_sig = [&](DexMethod* referrer,
                        const IRList::iterator& insn_it,
                        DexMethodRef* meth,
-                       IRInstruction* insn) {
+                       IRInstruction* insn,
+                       RefsByInterface* refs) {
     // check the sig for single implemented interface
     const auto proto = meth->get_proto();
-    check_arg(referrer, insn_it, proto->get_rtype(), meth, insn);
+    check_arg(referrer, insn_it, proto->get_rtype(), meth, insn, refs);
     const auto args = proto->get_args();
     for (const auto arg : args->get_type_list()) {
-      check_arg(referrer, insn_it, arg, meth, insn);
+      check_arg(referrer, insn_it, arg, meth, insn, refs);
     }
   };
 
   auto check_field = [&](DexMethod* referrer,
                          const IRList::iterator& insn_it,
                          DexFieldRef* field,
-                         IRInstruction* insn) {
+                         IRInstruction* insn,
+                         RefsByInterface* refs) {
     auto cls = field->get_class();
     cls = get_and_check_single_impl(cls);
     if (cls) {
@@ -404,102 +496,107 @@ void AnalysisImpl::analyze_opcodes() {
     const auto type = field->get_type();
     auto intf = get_and_check_single_impl(type);
     if (intf) {
-      auto& si = single_impls.at(intf);
-      std::lock_guard<std::mutex> lock(si.mutex);
-      si.referencing_methods[referrer][insn] = insn_it;
-      si.fieldrefs[field].push_back(insn);
+      auto& intf_refs = (*refs)[intf];
+      intf_refs.referencing_insns.emplace_back(referrer, insn, insn_it);
+      intf_refs.fieldrefs.emplace_back(field, insn);
     }
   };
 
-  walk::parallel::code(scope, [&](DexMethod* method, IRCode& code) {
-    redex_assert(!code.editable_cfg_built()); // Need *one* way to
-    auto ii = ir_list::InstructionIterable(code);
-    const auto& end = ii.end();
-    for (auto it = ii.begin(); it != end; ++it) {
-      auto insn = it->insn;
-      auto op = insn->opcode();
-      switch (op) {
-      // type ref
-      case OPCODE_CONST_CLASS:
-      case OPCODE_CHECK_CAST:
-      case OPCODE_INSTANCE_OF:
-      case OPCODE_NEW_INSTANCE:
-      case OPCODE_NEW_ARRAY:
-      case OPCODE_FILLED_NEW_ARRAY: {
-        auto intf = get_and_check_single_impl(insn->get_type());
-        if (intf) {
-          auto& si = single_impls.at(intf);
-          std::lock_guard<std::mutex> lock(si.mutex);
-          si.referencing_methods[method][insn] = it.unwrap();
-          si.typerefs.push_back(insn);
-        }
-        break;
-      }
-      // field ref
-      case OPCODE_IGET:
-      case OPCODE_IGET_WIDE:
-      case OPCODE_IGET_OBJECT:
-      case OPCODE_IPUT:
-      case OPCODE_IPUT_WIDE:
-      case OPCODE_IPUT_OBJECT: {
-        DexFieldRef* field =
-            resolve_field(insn->get_field(), FieldSearch::Instance);
-        if (field == nullptr) {
-          field = insn->get_field();
+  auto refs_by_intf = walk::parallel::methods<RefsByInterface, MergeRefs>(
+      scope, [&](DexMethod* method, RefsByInterface* refs) {
+        auto code = method->get_code();
+        if (code == nullptr) {
+          return;
         }
-        check_field(method, it.unwrap(), field, insn);
-        break;
-      }
-      case OPCODE_SGET:
-      case OPCODE_SGET_WIDE:
-      case OPCODE_SGET_OBJECT:
-      case OPCODE_SPUT:
-      case OPCODE_SPUT_WIDE:
-      case OPCODE_SPUT_OBJECT: {
-        DexFieldRef* field =
-            resolve_field(insn->get_field(), FieldSearch::Static);
-        if (field == nullptr) {
-          field = insn->get_field();
-        }
-        check_field(method, it.unwrap(), field, insn);
-        break;
-      }
-      // method ref
-      case OPCODE_INVOKE_INTERFACE: {
-        // if it is an invoke on the interface method, collect it as such
-        const auto meth = insn->get_method();
-        const auto owner = meth->get_class();
-        const auto intf = get_and_check_single_impl(owner);
-        if (intf) {
-          // if the method ref is not defined on the interface
-          // itself drop the optimization
-          const auto& meths = type_class(intf)->get_vmethods();
-          if (std::find(meths.begin(), meths.end(), meth) == meths.end()) {
-            escape_interface(intf, UNKNOWN_MREF);
-          } else {
-            auto& si = single_impls.at(intf);
-            std::lock_guard<std::mutex> lock(si.mutex);
-            si.referencing_methods[method][insn] = it.unwrap();
-            si.intf_methodrefs[meth].insert(insn);
+        redex_assert(!code->editable_cfg_built()); // Need *one* way to
+        auto ii = ir_list::InstructionIterable(*code);
+        const auto& end = ii.end();
+        for (auto it = ii.begin(); it != end; ++it) {
+          auto insn = it->insn;
+          auto op = insn->opcode();
+          switch (op) {
+          // type ref
+          case OPCODE_CONST_CLASS:
+          case OPCODE_CHECK_CAST:
+          case OPCODE_INSTANCE_OF:
+          case OPCODE_NEW_INSTANCE:
+          case OPCODE_NEW_ARRAY:
+          case OPCODE_FILLED_NEW_ARRAY: {
+            auto intf = get_and_check_single_impl(insn->get_type());
+            if (intf) {
+              auto& intf_refs = (*refs)[intf];
+              intf_refs.referencing_insns.emplace_back(method, insn,
+                                                       it.unwrap());
+              intf_refs.typerefs.push_back(insn);
+            }
+            break;
+          }
+          // field ref
+          case OPCODE_IGET:
+          case OPCODE_IGET_WIDE:
+          case OPCODE_IGET_OBJECT:
+          case OPCODE_IPUT:
+          case OPCODE_IPUT_WIDE:
+          case OPCODE_IPUT_OBJECT: {
+            DexFieldRef* field =
+                resolve_field(insn->get_field(), FieldSearch::Instance);
+            if (field == nullptr) {
+              field = insn->get_field();
+            }
+            check_field(method, it.unwrap(), field, insn, refs);
+            break;
+          }
+          case OPCODE_SGET:
+          case OPCODE_SGET_WIDE:
+          case OPCODE_SGET_OBJECT:
+          case OPCODE_SPUT:
+          case OPCODE_SPUT_WIDE:
+          case OPCODE_SPUT_OBJECT: {
+            DexFieldRef* field =
+                resolve_field(insn->get_field(), FieldSearch::Static);
+            if (field == nullptr) {
+              field = insn->get_field();
+            }
+            check_field(method, it.unwrap(), field, insn, refs);
+            break;
+          }
+          // method ref
+          case OPCODE_INVOKE_INTERFACE: {
+            // if it is an invoke on the interface method, collect it as such
+            const auto meth = insn->get_method();
+            const auto owner = meth->get_class();
+            const auto intf = get_and_check_single_impl(owner);
+            if (intf) {
+              // if the method ref is not defined on the interface
+              // itself drop the optimization
+              const auto& meths = type_class(intf)->get_vmethods();
+              if (std::find(meths.begin(), meths.end(), meth) == meths.end()) {
+                escape_interface(intf, UNKNOWN_MREF);
+              } else {
+                auto& intf_refs = (*refs)[intf];
+                intf_refs.referencing_insns.emplace_back(method, insn,
+                                                         it.unwrap());
+                intf_refs.intf_methodrefs.emplace_back(meth, insn);
+              }
+            }
+            check_sig(method, it.unwrap(), meth, insn, refs);
+            break;
           }
-        }
-        check_sig(method, it.unwrap(), meth, insn);
-        break;
-      }
 
-      case OPCODE_INVOKE_DIRECT:
-      case OPCODE_INVOKE_STATIC:
-      case OPCODE_INVOKE_VIRTUAL:
-      case OPCODE_INVOKE_SUPER: {
-        const auto meth = insn->get_method();
-        check_sig(method, it.unwrap(), meth, insn);
-        break;
-      }
-      default:
-        break;
-      }
-    }
-  });
+          case OPCODE_INVOKE_DIRECT:
+          case OPCODE_INVOKE_STATIC:
+          case OPCODE_INVOKE_VIRTUAL:
+          case OPCODE_INVOKE_SUPER: {
+            const auto meth = insn->get_method();
+            check_sig(method, it.unwrap(), meth, insn, refs);
+            break;
+          }
+          default:
+            break;
+          }
+        }
+      });
+  add_refs(refs_by_intf);
 }
 
 /**
@@ -11,9 +11,11 @@
 #include <unordered_set>
 
 #include "ConcurrentContainers.h"
+#include "ConfigFiles.h"
 #include "Creators.h"
 #include "DexAsm.h"
 #include "DexClass.h"
+#include "MethodProfiles.h"
 #include "PassManager.h"
 #include "Show.h"
 #include "Trace.h"
@@ -21,6 +23,34 @@
 
 using namespace stringbuilder_outliner;
 
+namespace {
+
+// The capacity that a StringBuilder gets by default.
+constexpr uint32_t DEFAULT_CAPACITY = 16;
+
+/*
+ * The number of chars that appending a value of the given type usually takes.
+ * Strings that aren't constant are assumed to take the default capacity.
+ */
+uint32_t estimated_length(const DexType* ty) {
+  if (ty == type::_boolean()) {
+    return 5;
+  } else if (ty == type::_char()) {
+    return 1;
+  } else if (ty == type::_int()) {
+    return 11;
+  } else if (ty == type::_long()) {
+    return 20;
+  } else if (ty == type::_float()) {
+    return 15;
+  } else if (ty == type::_double()) {
+    return 24;
+  }
+  return DEFAULT_CAPACITY;
+}
+
+} // namespace
+
 FixpointIterator::FixpointIterator(const cfg::ControlFlowGraph& cfg)
     : ir_analyzer::BaseIRAnalyzer<Environment>(cfg),
       m_stringbuilder(DexType::get_type("Ljava/lang/StringBuilder;")),
@@ -171,6 +201,89 @@ BuilderStateMap Outliner::gather_builder_states(
   return tostring_instruction_to_state;
 }
 
+/*
+ * Compute the capacities for the StringBuilder() constructions whose
+ * StringBuilders we can model up to their toString() calls. Constant strings
+ * are only recognized when they get loaded in the block of their append().
+ */
+PresizedInits Outliner::gather_presized_inits(
+    const cfg::ControlFlowGraph& cfg,
+    const InstructionSet& tostring_instructions) const {
+  // new-instance -> StringBuilder() constructor instruction
+  std::unordered_map<const IRInstruction*, const IRInstruction*> inits;
+  // append instruction -> length of its constant string argument
+  std::unordered_map<const IRInstruction*, uint32_t> constant_lengths;
+  std::vector<std::pair<const IRInstruction*, BuilderState>> builder_states;
+  FixpointIterator fp_iter(cfg);
+  fp_iter.run(Environment());
+  for (auto* block : cfg.blocks()) {
+    auto env = fp_iter.get_entry_state_at(block);
+    std::unordered_map<reg_t, uint32_t> string_lengths;
+    boost::optional<uint32_t> pending_length;
+    for (auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      auto op = insn->opcode();
+      if (op == OPCODE_INVOKE_DIRECT || op == OPCODE_INVOKE_VIRTUAL) {
+        const auto& pointers = env.get_pointers(insn->src(0));
+        auto method = insn->get_method();
+        if (!pointers.is_value() || pointers.elements().size() != 1) {
+          // Not a StringBuilder that we can follow.
+        } else if (method == m_stringbuilder_default_ctor) {
+          inits.emplace(*pointers.elements().begin(), insn);
+        } else if (tostring_instructions.count(insn)) {
+          const auto& state_opt =
+              env.get_store().get(*pointers.elements().begin()).state();
+          if (state_opt) {
+            builder_states.emplace_back(*pointers.elements().begin(),
+                                        *state_opt);
+          }
+        } else if (method->get_class() == m_stringbuilder &&
+                   method->get_name() == m_append_str &&
+                   insn->srcs_size() == 2 &&
+                   string_lengths.count(insn->src(1))) {
+          constant_lengths.emplace(insn, string_lengths.at(insn->src(1)));
+        }
+      }
+      if (op == OPCODE_CONST_STRING) {
+        pending_length = insn->get_string()->length();
+      } else if (op == IOPCODE_MOVE_RESULT_PSEUDO_OBJECT && pending_length) {
+        string_lengths[insn->dest()] = *pending_length;
+        pending_length = boost::none;
+      } else if (insn->has_dest()) {
+        string_lengths.erase(insn->dest());
+        if (insn->dest_is_wide()) {
+          string_lengths.erase(insn->dest() + 1);
+        }
+      }
+      fp_iter.analyze_instruction(insn, &env);
+    }
+  }
+
+  // A StringBuilder may reach several toString() calls, in which case it gets
+  // the largest of their capacities.
+  PresizedInits presized_inits;
+  for (const auto& p : builder_states) {
+    auto it = inits.find(p.first);
+    if (it == inits.end()) {
+      continue;
+    }
+    uint32_t capacity{0};
+    for (auto* insn : p.second) {
+      auto length_it = constant_lengths.find(insn);
+      capacity += length_it != constant_lengths.end()
+                      ? length_it->second
+                      : estimated_length(
+                            insn->get_method()->get_proto()->get_args()->at(0));
+    }
+    if (capacity <= DEFAULT_CAPACITY) {
+      continue;
+    }
+    auto& presized = presized_inits[it->second];
+    presized = std::max(presized, capacity);
+  }
+  return presized_inits;
+}
+
 /*
  * Gather the types of the values that the StringBuilder instance is
  * concatenating.
@@ -196,7 +309,7 @@ void Outliner::gather_outline_candidate_typelists(
   }
 }
 
-void Outliner::analyze(IRCode& code) {
+void Outliner::analyze(IRCode& code, bool presize) {
   code.build_cfg(/* editable */ false); // Not editable because of T42743620
   auto& cfg = code.cfg();
   cfg.calculate_exit_block();
@@ -209,6 +322,14 @@ void Outliner::analyze(IRCode& code) {
     return;
   }
 
+  if (presize) {
+    auto presized_inits = gather_presized_inits(cfg, tostring_instructions);
+    if (!presized_inits.empty()) {
+      m_presized_inits.emplace(&code, std::move(presized_inits));
+    }
+    return;
+  }
+
   auto tostring_instruction_to_state =
       gather_builder_states(cfg, tostring_instructions);
 
@@ -232,6 +353,10 @@ void Outliner::create_outline_helpers(DexStoresVector* stores) {
 
   ClassCreator cc(outline_helper_cls);
   cc.set_super(type::java_lang_Object());
+  for (const auto& p : m_presized_inits) {
+    m_stats.stringbuilders_presized += p.second.size();
+  }
+
   bool did_create_helper{false};
   for (const auto& p : m_outline_typelists) {
     const auto* typelist = p.first;
@@ -360,6 +485,10 @@ static IROpcode invoke_for_method(const DexMethod* method) {
  * during register allocation.
  */
 void Outliner::transform(IRCode* code) {
+  if (m_presized_inits.count(code) != 0) {
+    presize(code);
+    return;
+  }
   if (m_builder_state_maps.count(code) == 0) {
     return;
   }
@@ -407,6 +536,35 @@ void Outliner::transform(IRCode* code) {
   apply_changes(insns_to_insert, insns_to_replace, code);
 }
 
+/*
+ * Convert
+ *
+ *   invoke-direct {v0} StringBuilder.<init>()
+ *
+ * into
+ *
+ *   const vN, <capacity>
+ *   invoke-direct {v0, vN} StringBuilder.<init>(int)
+ */
+void Outliner::presize(IRCode* code) {
+  std::unordered_map<const IRInstruction*, IRInstruction*> insns_to_insert;
+  std::unordered_map<const IRInstruction*, IRInstruction*> insns_to_replace;
+  for (const auto& p : m_presized_inits.at(code)) {
+    const auto* init_insn = p.first;
+    auto reg = code->allocate_temp();
+    insns_to_insert.emplace(init_insn, (new IRInstruction(OPCODE_CONST))
+                                           ->set_literal(p.second)
+                                           ->set_dest(reg));
+    insns_to_replace.emplace(init_insn,
+                             (new IRInstruction(OPCODE_INVOKE_DIRECT))
+                                 ->set_method(m_stringbuilder_capacity_ctor)
+                                 ->set_srcs_size(2)
+                                 ->set_src(0, init_insn->src(0))
+                                 ->set_src(1, reg));
+  }
+  apply_changes(insns_to_insert, insns_to_replace, code);
+}
+
 /*
  * The StringBuilder analysis tracks and describes transformations in terms of
  * IRInstructions, but efficient insertion / removal of IRInstructions requires
@@ -445,13 +603,26 @@ void Outliner::apply_changes(
 }
 
 void StringBuilderOutlinerPass::run_pass(DexStoresVector& stores,
-                                         ConfigFiles&,
+                                         ConfigFiles& conf,
                                          PassManager& mgr) {
   auto scope = build_class_scope(stores);
+  std::unordered_set<const DexMethodRef*> hot_methods;
+  if (m_config.presize_hot_builders) {
+    const auto& method_profiles = conf.get_method_profiles();
+    for (const auto& interaction : method_profiles.all_interactions()) {
+      for (const auto& p : interaction.second) {
+        if (p.second.appear_percent >=
+            m_config.hot_method_appear_percent_threshold) {
+          hot_methods.insert(p.first);
+        }
+      }
+    }
+  }
   Outliner outliner(m_config);
-  // 1) Determine which methods have candidates for outlining.
+  // 1) Determine which methods have candidates for outlining, or, for the hot
+  // ones, for presizing.
   walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
-    outliner.analyze(code);
+    outliner.analyze(code, hot_methods.count(method) != 0);
   });
   // 2) Determine which candidates occur frequently enough to be worth
   // outlining. Build the corresponding outline helper functions.
@@ -467,6 +638,8 @@ void StringBuilderOutlinerPass::run_pass(DexStoresVector& stores,
                   outliner.get_stats().operations_removed);
   mgr.incr_metric("helper_methods_created",
                   outliner.get_stats().helper_methods_created);
+  mgr.incr_metric("stringbuilders_presized",
+                  outliner.get_stats().stringbuilders_presized);
 }
 
 static StringBuilderOutlinerPass s_pass;
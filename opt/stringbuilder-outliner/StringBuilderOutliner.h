@@ -64,6 +64,12 @@
  * the outline helper functions and assume that in most cases the StringBuilder
  * instance and the append operations on them are going to be removable by
  * OSDCE. This is generally true in practice.
+ *
+ * Outlining trades speed for size, so with `presize_hot_builders`, the methods
+ * that the method profiles show to be hot are not outlined. Instead, their
+ * StringBuilders get constructed with a capacity that fits what gets appended
+ * to them -- the lengths of the constant strings, plus an estimate for the
+ * other values -- so that appending doesn't have to grow their buffers.
  */
 
 namespace stringbuilder_outliner {
@@ -192,15 +198,21 @@ using InstructionSet = std::unordered_set<const IRInstruction*>;
 using BuilderStateMap =
     std::vector<std::pair<const IRInstruction*, BuilderState>>;
 
+// StringBuilder() constructor instruction -> capacity to construct it with.
+using PresizedInits = std::unordered_map<const IRInstruction*, uint32_t>;
+
 struct Config {
   size_t max_outline_length{9};
   size_t min_outline_count{10};
+  bool presize_hot_builders{false};
+  float hot_method_appear_percent_threshold{50.0f};
 };
 
 struct Stats {
   size_t stringbuilders_removed{0};
   size_t operations_removed{0};
   size_t helper_methods_created{0};
+  size_t stringbuilders_presized{0};
 };
 
 class Outliner {
@@ -211,7 +223,9 @@ class Outliner {
 
   const Stats& get_stats() const { return m_stats; }
 
-  void analyze(IRCode& code);
+  // With :presize, the StringBuilders of the code are presized instead of
+  // outlined.
+  void analyze(IRCode& code, bool presize = false);
 
   void create_outline_helpers(DexStoresVector* stores);
 
@@ -225,6 +239,10 @@ class Outliner {
       const cfg::ControlFlowGraph& cfg,
       const InstructionSet& eligible_tostring_instructions) const;
 
+  PresizedInits gather_presized_inits(
+      const cfg::ControlFlowGraph& cfg,
+      const InstructionSet& tostring_instructions) const;
+
   const DexTypeList* typelist_from_state(const BuilderState& state) const;
 
   void gather_outline_candidate_typelists(
@@ -232,6 +250,8 @@ class Outliner {
 
   std::unique_ptr<IRCode> create_outline_helper_code(DexMethod*) const;
 
+  void presize(IRCode* code);
+
   static void apply_changes(
       const std::unordered_map<const IRInstruction*, IRInstruction*>&
           insns_to_insert,
@@ -256,6 +276,7 @@ class Outliner {
   std::unordered_map<const DexTypeList*, DexMethod*> m_outline_helpers;
 
   ConcurrentMap<const IRCode*, BuilderStateMap> m_builder_state_maps;
+  ConcurrentMap<const IRCode*, PresizedInits> m_presized_inits;
 };
 
 class StringBuilderOutlinerPass : public Pass {
@@ -267,6 +288,11 @@ class StringBuilderOutlinerPass : public Pass {
          m_config.max_outline_length);
     bind("min_outline_count", m_config.min_outline_count,
          m_config.min_outline_count);
+    bind("presize_hot_builders", m_config.presize_hot_builders,
+         m_config.presize_hot_builders);
+    bind("hot_method_appear_percent_threshold",
+         m_config.hot_method_appear_percent_threshold,
+         m_config.hot_method_appear_percent_threshold);
   }
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
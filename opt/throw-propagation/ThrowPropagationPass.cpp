@@ -304,32 +304,24 @@ ThrowPropagationPass::Stats ThrowPropagationPass::run(
   return stats;
 }
 
-void ThrowPropagationPass::run_pass(DexStoresVector& stores,
-                                    ConfigFiles&,
-                                    PassManager& mgr) {
-  Scope scope = build_class_scope(stores);
-  walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
-    if (!method->rstate.no_optimizations()) {
-      code.build_cfg(/* editable */ true);
-    }
-  });
-  auto override_graph = method_override_graph::build_graph(scope);
-  size_t last_no_return_methods{0};
-  int iterations = 0;
-  Stats stats;
+ThrowPropagationPass::FixpointResult ThrowPropagationPass::run_to_fixpoint(
+    const Config& config,
+    const Scope& scope,
+    const method_override_graph::Graph& graph) {
+  FixpointResult result;
   while (true) {
-    iterations++;
+    result.iterations++;
     std::unordered_set<DexMethod*> no_return_methods =
-        get_no_return_methods(m_config, scope);
+        get_no_return_methods(config, scope);
     TRACE(TP,
           2,
           "iteration %d, no_return_methods: %zu",
-          iterations,
+          result.iterations,
           no_return_methods.size());
-    if (no_return_methods.size() == last_no_return_methods) {
+    if (no_return_methods.size() == result.no_return_methods) {
       break;
     }
-    last_no_return_methods = no_return_methods.size();
+    result.no_return_methods = no_return_methods.size();
     auto last_stats =
         walk::parallel::methods<Stats>(scope, [&](DexMethod* method) -> Stats {
           auto code = method->get_code();
@@ -337,13 +329,28 @@ void ThrowPropagationPass::run_pass(DexStoresVector& stores,
             return {};
           }
 
-          return run(m_config, no_return_methods, *override_graph, code);
+          return run(config, no_return_methods, graph, code);
         });
     if (last_stats.throws_inserted == 0) {
       break;
     }
-    stats += last_stats;
+    result.stats += last_stats;
   }
+  return result;
+}
+
+void ThrowPropagationPass::run_pass(DexStoresVector& stores,
+                                    ConfigFiles&,
+                                    PassManager& mgr) {
+  Scope scope = build_class_scope(stores);
+  walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
+    if (!method->rstate.no_optimizations()) {
+      code.build_cfg(/* editable */ true);
+    }
+  });
+  auto override_graph =
+      MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope);
+  auto result = run_to_fixpoint(m_config, scope, *override_graph);
 
   walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
     if (!method->rstate.no_optimizations()) {
@@ -351,11 +358,11 @@ void ThrowPropagationPass::run_pass(DexStoresVector& stores,
     }
   });
 
-  mgr.incr_metric(METRIC_THROWS_INSERTED, stats.throws_inserted);
+  mgr.incr_metric(METRIC_THROWS_INSERTED, result.stats.throws_inserted);
   mgr.incr_metric(METRIC_UNREACHABLE_INSTRUCTIONS,
-                  stats.unreachable_instruction_count);
-  mgr.incr_metric(METRIC_NO_RETURN_METHODS, last_no_return_methods);
-  mgr.incr_metric(METRIC_ITERATIONS, iterations);
+                  result.stats.unreachable_instruction_count);
+  mgr.incr_metric(METRIC_NO_RETURN_METHODS, result.no_return_methods);
+  mgr.incr_metric(METRIC_ITERATIONS, result.iterations);
 }
 
 ThrowPropagationPass::Stats& ThrowPropagationPass::Stats::operator+=(
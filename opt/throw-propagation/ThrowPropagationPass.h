@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include "AnalysisUsage.h"
+#include "ClassHierarchyAnalysisPass.h"
 #include "DexStore.h"
 #include "MethodOverrideGraph.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Pass.h"
 
 class ThrowPropagationPass : public Pass {
@@ -25,6 +28,12 @@ class ThrowPropagationPass : public Pass {
     Stats& operator+=(const Stats&);
   };
 
+  struct FixpointResult {
+    Stats stats;
+    size_t no_return_methods{0};
+    int iterations{0};
+  };
+
  private:
   Config m_config;
 
@@ -40,5 +49,20 @@ class ThrowPropagationPass : public Pass {
                    const std::unordered_set<DexMethod*>& no_return_methods,
                    const method_override_graph::Graph& graph,
                    IRCode* code);
+
+  // Runs the propagation over the scope until no more throws get inserted.
+  // The code of the methods that can be optimized must already have editable
+  // CFGs, which are left in place.
+  static FixpointResult run_to_fixpoint(
+      const Config& config,
+      const Scope& scope,
+      const method_override_graph::Graph& graph);
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    // Only the code of the methods changes.
+    au.add_preserve_specific<ClassHierarchyAnalysisPass>();
+    au.add_preserve_specific<MethodOverrideGraphAnalysisPass>();
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 };
@@ -11,6 +11,7 @@
 #include "DexUtil.h"
 #include "GlobalTypeAnalyzer.h"
 #include "KotlinNullCheckMethods.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Show.h"
 #include "Trace.h"
 #include "TypeAnalysisTransform.h"
@@ -128,8 +129,12 @@ void GlobalTypeAnalysisPass::run_pass(DexStoresVector& stores,
       kotlin_nullcheck_wrapper::get_kotlin_null_assertions();
   Scope scope = build_class_scope(stores);
   global::GlobalTypeAnalysis analysis(m_config.max_global_analysis_iteration);
-  auto gta = analysis.analyze(scope);
-  optimize(scope, *gta, null_assertion_set, mgr);
+  auto method_override_graph =
+      m_config.transform.refine_virtual_callsites
+          ? MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope)
+          : MethodOverrideGraphAnalysisPass::get_preserved(mgr);
+  auto gta = analysis.analyze(scope, method_override_graph.get());
+  optimize(scope, *gta, null_assertion_set, mgr, method_override_graph.get());
   m_result = std::move(gta);
 }
 
@@ -137,7 +142,8 @@ void GlobalTypeAnalysisPass::optimize(
     const Scope& scope,
     const type_analyzer::global::GlobalTypeAnalyzer& gta,
     const type_analyzer::Transform::NullAssertionSet& null_assertion_set,
-    PassManager& mgr) {
+    PassManager& mgr,
+    const method_override_graph::Graph* method_override_graph) {
   auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* method) {
     if (method->get_code() == nullptr) {
       return Stats();
@@ -157,7 +163,7 @@ void GlobalTypeAnalysisPass::optimize(
       return ra_stats;
     }
 
-    Transform tf(m_config.transform);
+    Transform tf(m_config.transform, method_override_graph);
     Stats tr_stats;
     tr_stats.transform_stats = tf.apply(
         *lta, gta.get_whole_program_state(), method, null_assertion_set);
@@ -55,6 +55,10 @@ class GlobalTypeAnalysisPass : public Pass {
          "Maximum number of global iterations the analysis runs");
     bind("insert_runtime_asserts", false, m_config.insert_runtime_asserts);
     bind("trace_global_local_diff", false, m_config.trace_global_local_diff);
+    bind("refine_virtual_callsites", false,
+         m_config.transform.refine_virtual_callsites,
+         "Refine invoke-virtual and invoke-interface to the method that the "
+         "inferred receiver type dispatches to");
   }
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
@@ -62,7 +66,8 @@ class GlobalTypeAnalysisPass : public Pass {
       const Scope& scope,
       const type_analyzer::global::GlobalTypeAnalyzer& gta,
       const type_analyzer::Transform::NullAssertionSet& null_assertion_set,
-      PassManager& mgr);
+      PassManager& mgr,
+      const method_override_graph::Graph* method_override_graph = nullptr);
 
   std::shared_ptr<type_analyzer::global::GlobalTypeAnalyzer> get_result() {
     return m_result;
@@ -9,6 +9,7 @@
 
 #include "DexUtil.h"
 #include "MethodOverrideGraph.h"
+#include "MethodOverrideGraphAnalysisPass.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -150,8 +151,8 @@ void TypeAnalysisCallGraphGenerationPass::run_pass(DexStoresVector& stores,
   always_assert(gta);
 
   Scope scope = build_class_scope(stores);
-  m_result = std::make_shared<call_graph::Graph>(
-      TypeAnalysisBasedStrategy(*mog::build_graph(scope), scope, gta));
+  m_result = std::make_shared<call_graph::Graph>(TypeAnalysisBasedStrategy(
+      *MethodOverrideGraphAnalysisPass::get_or_build(mgr, scope), scope, gta));
   always_assert(m_result);
   report_stats(*m_result, mgr);
 }
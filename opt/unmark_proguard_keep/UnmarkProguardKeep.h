@@ -19,7 +19,7 @@
  * in "package_list".
  * This pass should be put at beginning of passes list.
  */
-class UnmarkProguardKeepPass : Pass {
+class UnmarkProguardKeepPass : public Pass {
  public:
   UnmarkProguardKeepPass() : Pass("UnmarkProguardKeepPass") {}
 
@@ -28,6 +28,8 @@ class UnmarkProguardKeepPass : Pass {
     bind("package_list", {}, m_package_list);
   }
 
+  bool needs_all_code() const override { return false; }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
  private:
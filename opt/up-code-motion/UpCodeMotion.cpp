@@ -207,10 +207,18 @@ UpCodeMotionPass::Stats UpCodeMotionPass::process_code(bool is_static,
                                                        DexType* declaring_type,
                                                        DexTypeList* args,
                                                        IRCode* code) {
-  Stats stats;
-
   code->build_cfg(/* editable = true*/);
-  auto& cfg = code->cfg();
+  Stats stats = process_cfg(is_static, declaring_type, args, code->cfg());
+  code->clear_cfg();
+  return stats;
+}
+
+UpCodeMotionPass::Stats UpCodeMotionPass::process_cfg(
+    bool is_static,
+    DexType* declaring_type,
+    DexTypeList* args,
+    cfg::ControlFlowGraph& cfg) {
+  Stats stats;
 
   std::unique_ptr<type_inference::TypeInference> type_inference;
   std::unordered_set<cfg::Block*> blocks_to_remove_set;
@@ -331,8 +339,6 @@ UpCodeMotionPass::Stats UpCodeMotionPass::process_code(bool is_static,
   }
 
   cfg.remove_blocks(blocks_to_remove);
-
-  code->clear_cfg();
   return stats;
 }
 
@@ -37,6 +37,11 @@ class UpCodeMotionPass : public Pass {
                             DexTypeList* args,
                             IRCode*);
 
+  static Stats process_cfg(bool is_static,
+                           DexType* declaring_type,
+                           DexTypeList* args,
+                           cfg::ControlFlowGraph& cfg);
+
  private:
   static bool gather_movable_instructions(
       cfg::Block* b, std::vector<IRInstruction*>* instructions);
@@ -8,6 +8,7 @@
 #include "VerticalMerging.h"
 
 #include "ClassHierarchy.h"
+#include "ClassHierarchyAnalysisPass.h"
 #include "DexAnnotation.h"
 #include "DexClass.h"
 #include "DexUtil.h"
@@ -261,26 +262,29 @@ void handle_invoke_init(
  */
 ClassMap collect_can_merge(
     const Scope& scope,
+    const CompactClassHierarchy& ch,
     const XStoreRefs& xstores,
     const std::unordered_map<const DexType*, DontMergeState>& dont_merge_status,
     size_t* num_single_extend_pairs) {
   ClassMap mergeable_to_merger;
-  ClassHierarchy ch = build_type_hierarchy(scope);
-  auto throwables = get_all_children(ch, type::java_lang_Throwable());
+  auto throwable = type::java_lang_Throwable();
+  auto is_throwable = [&](const DexType* type) {
+    return type != throwable && ch.is_subclass(throwable, type);
+  };
   *num_single_extend_pairs = 0;
   for (DexClass* cls : scope) {
     if (cls && !cls->is_external() && !is_interface(cls) && can_delete(cls) &&
-        can_rename(cls) && !throwables.count(cls->get_type())) {
+        can_rename(cls) && !is_throwable(cls->get_type())) {
       DexType* cls_type = cls->get_type();
-      const auto& children_types = get_children(ch, cls_type);
+      auto children_types = ch.get_children(cls_type);
       if (children_types.size() != 1) {
         continue;
       }
-      const DexType* child_type = *children_types.begin();
-      if (throwables.count(child_type)) {
+      const DexType* child_type = children_types.front();
+      if (is_throwable(child_type)) {
         continue;
       }
-      if (!get_children(ch, child_type).empty()) {
+      if (!ch.get_children(child_type).empty()) {
         // TODO(suree404): we are skipping pairs that child class still have
         // their subclasses, but we might still be able to optimize this case.
         continue;
@@ -800,8 +804,11 @@ void VerticalMergingPass::run_pass(DexStoresVector& stores,
   record_referenced(scope, &dont_merge_status, m_blocklist);
   XStoreRefs xstores(stores);
   size_t num_single_extend;
-  auto mergeable_to_merger =
-      collect_can_merge(scope, xstores, dont_merge_status, &num_single_extend);
+  auto ch = ClassHierarchyAnalysisPass::get_or_build(mgr, scope);
+  auto mergeable_to_merger = collect_can_merge(scope, *ch, xstores,
+                                               dont_merge_status,
+                                               &num_single_extend);
+  ch.reset();
 
   remove_both_have_clinit(&mergeable_to_merger);
 
@@ -42,6 +42,8 @@
 
 #include "VirtualMerging.h"
 
+#include <numeric>
+
 #include "ConfigFiles.h"
 #include "ControlFlow.h"
 #include "CppUtil.h"
@@ -54,6 +56,7 @@
 #include "Resolver.h"
 #include "TypeSystem.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -85,6 +88,16 @@ constexpr const char* METRIC_HUGE_METHODS = "num_huge_methods";
 constexpr const char* METRIC_REMOVED_VIRTUAL_METHODS =
     "num_removed_virtual_methods";
 
+// What merging the pairs of one virtual scope did, to be applied to the shared
+// state once all scopes are merged.
+struct ScopeMergeResult {
+  // The (overridden, overriding) pairs that were merged, in order.
+  std::vector<std::pair<DexMethod*, DexMethod*>> merged;
+  size_t unabstracted_methods{0};
+  size_t uninlinable_methods{0};
+  size_t huge_methods{0};
+};
+
 } // namespace
 
 VirtualMerging::VirtualMerging(DexStoresVector& stores,
@@ -489,10 +502,24 @@ void VirtualMerging::compute_mergeable_pairs_by_virtual_scopes(
 //         is for some reason not possible, e.g. because of code size
 //         constraints. Record set of methods in each class which can be
 //         removed.
+//         Virtual scopes don't share methods, so they are merged in parallel.
+//         The visibility changes, which touch members outside of the scope,
+//         and the bookkeeping are applied afterwards, in scope order, to keep
+//         the outcome deterministic.
 void VirtualMerging::merge_methods() {
+  std::vector<const VirtualScope*> virtual_scopes;
+  virtual_scopes.reserve(m_mergeable_pairs_by_virtual_scopes.size());
   for (auto& p : m_mergeable_pairs_by_virtual_scopes) {
-    auto virtual_scope = p.first;
-    const auto& mergeable_pairs = p.second;
+    virtual_scopes.push_back(p.first);
+  }
+  std::vector<ScopeMergeResult> results(virtual_scopes.size());
+  std::vector<size_t> indices(virtual_scopes.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  auto merge_scope = [&](size_t index) {
+    auto virtual_scope = virtual_scopes[index];
+    const auto& mergeable_pairs =
+        m_mergeable_pairs_by_virtual_scopes.at(virtual_scope);
+    auto& result = results[index];
     for (auto& q : mergeable_pairs) {
       auto overridden_method = const_cast<DexMethod*>(q.first);
       auto overriding_method = const_cast<DexMethod*>(q.second);
@@ -504,7 +531,7 @@ void VirtualMerging::merge_methods() {
               "[VM] %s is too large to be merged into %s",
               SHOW(overriding_method),
               SHOW(overridden_method));
-        m_stats.huge_methods++;
+        result.huge_methods++;
         continue;
       }
       size_t estimated_insn_size =
@@ -520,7 +547,7 @@ void VirtualMerging::merge_methods() {
               "[VM] Cannot inline %s into %s",
               SHOW(overriding_method),
               SHOW(overridden_method));
-        m_stats.uninlinable_methods++;
+        result.uninlinable_methods++;
         continue;
       }
       m_inliner->make_static_inlinable(make_static);
@@ -538,16 +565,12 @@ void VirtualMerging::merge_methods() {
       std::function<uint32_t()> allocate_wide_temp;
       std::function<void()> cleanup;
       IRCode* overridden_code;
-      // We make the method public to avoid visibility issues. We could be more
-      // conservative (i.e. taking the strongest visibility control that
-      // encompasses the original pair) but I'm not sure it's worth the effort.
-      set_public(overridden_method);
       if (is_abstract(overridden_method)) {
         // We'll make the abstract method be not abstract, and give it a new
         // method body.
         // It starts out with just load-param instructions as needed, and then
         // we'll add an invoke-virtual instruction that will get inlined.
-        m_stats.unabstracted_methods++;
+        result.unabstracted_methods++;
         overridden_method->make_concrete(
             (DexAccessFlags)(overridden_method->get_access() & ~ACC_ABSTRACT),
             std::make_unique<IRCode>(),
@@ -697,7 +720,6 @@ void VirtualMerging::merge_methods() {
       inliner::inline_with_cfg(
           overridden_method, overriding_method, invoke_virtual_insn,
           overridden_method->get_code()->cfg().get_registers_size());
-      change_visibility(overriding_method, overridden_method->get_class());
       overriding_method->get_code()->clear_cfg();
 
       // Check if everything was inlined.
@@ -707,12 +729,29 @@ void VirtualMerging::merge_methods() {
 
       overridden_code->clear_cfg();
 
+      always_assert(overriding_method != virtual_scope->methods.front().first);
+      result.merged.emplace_back(overridden_method, overriding_method);
+    }
+  };
+  workqueue_run<size_t>(merge_scope, indices);
+
+  for (size_t i = 0; i < virtual_scopes.size(); ++i) {
+    auto virtual_scope_root = virtual_scopes[i]->methods.front().first;
+    auto& result = results[i];
+    m_stats.unabstracted_methods += result.unabstracted_methods;
+    m_stats.uninlinable_methods += result.uninlinable_methods;
+    m_stats.huge_methods += result.huge_methods;
+    for (auto& q : result.merged) {
+      auto overridden_method = q.first;
+      auto overriding_method = q.second;
+      // We make the method public to avoid visibility issues. We could be more
+      // conservative (i.e. taking the strongest visibility control that
+      // encompasses the original pair) but I'm not sure it's worth the effort.
+      set_public(overridden_method);
+      change_visibility(overriding_method, overridden_method->get_class());
       m_virtual_methods_to_remove[type_class(overriding_method->get_class())]
           .push_back(overriding_method);
-      auto virtual_scope_root = virtual_scope->methods.front();
-      always_assert(overriding_method != virtual_scope_root.first);
-      m_virtual_methods_to_remap.emplace(overriding_method,
-                                         virtual_scope_root.first);
+      m_virtual_methods_to_remap.emplace(overriding_method, virtual_scope_root);
       m_stats.removed_virtual_methods++;
     }
   }
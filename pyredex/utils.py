@@ -5,6 +5,7 @@
 # LICENSE file in the root directory of this source tree.
 
 import argparse
+import copy
 import distutils.version
 import fnmatch
 import glob
@@ -14,10 +15,13 @@ import mmap
 import os
 import re
 import shutil
+import struct
 import subprocess
 import sys
 import tempfile
 import zipfile
+import zlib
+from multiprocessing.pool import ThreadPool
 from os.path import basename, dirname, isfile, join
 
 import pyredex.unpacker
@@ -375,10 +379,63 @@ def get_file_ext(file_name):
     return os.path.splitext(file_name)[1]
 
 
+def _read_compressed_entry(fp, info):
+    """
+    Returns the bytes of a zip entry as they are stored in the archive.
+    """
+    fp.seek(info.header_offset)
+    header = fp.read(zipfile.sizeFileHeader)
+    name_length, extra_length = struct.unpack("<HH", header[26:30])
+    fp.seek(name_length + extra_length, os.SEEK_CUR)
+    return fp.read(info.compress_size)
+
+
+def _write_compressed_entry(zf, info, data):
+    """
+    Appends an entry whose CRC, sizes and compressed bytes are already known
+    to a zip file opened for writing, without recompressing it.
+    """
+    with zf._lock:
+        zf._writecheck(info)
+        zf._didModify = True
+        info.header_offset = zf.fp.tell()
+        zf.fp.write(info.FileHeader())
+        zf.fp.write(data)
+        zf.filelist.append(info)
+        zf.NameToInfo[info.filename] = info
+        zf.start_dir = zf.fp.tell()
+
+
+def _compress_file(filepath, archivepath, compress_type):
+    """
+    Compresses a file the way ZipFile.write would, so that this can run in a
+    thread pool: zlib releases the GIL. Returns None for the compression
+    methods that are left to ZipFile.write.
+    """
+    if compress_type not in (zipfile.ZIP_STORED, zipfile.ZIP_DEFLATED):
+        return None
+    info = zipfile.ZipInfo.from_file(filepath, archivepath)
+    info.compress_type = compress_type
+    with open(filepath, "rb") as f:
+        data = f.read()
+    info.file_size = len(data)
+    info.CRC = zlib.crc32(data)
+    if compress_type == zipfile.ZIP_DEFLATED:
+        compressor = zlib.compressobj(
+            zlib.Z_DEFAULT_COMPRESSION, zlib.DEFLATED, -zlib.MAX_WBITS
+        )
+        data = compressor.compress(data) + compressor.flush()
+    info.compress_size = len(data)
+    return info, data
+
+
 class ZipManager:
     """
     __enter__: Unzips input_apk into extracted_apk_dir
     __exit__: Zips extracted_apk_dir into output_apk
+
+    Entries that are left untouched in extracted_apk_dir are copied from
+    input_apk as they are stored, and the others are compressed in parallel.
     """
 
     per_file_compression = {}
@@ -387,13 +444,40 @@ class ZipManager:
         self.input_apk = input_apk
         self.extracted_apk_dir = extracted_apk_dir
         self.output_apk = output_apk
+        self.input_infos = {}
+        self.extracted_stats = {}
 
     def __enter__(self):
         log("Extracting apk...")
         with zipfile.ZipFile(self.input_apk) as z:
             for info in z.infolist():
                 self.per_file_compression[info.filename] = info.compress_type
+                self.input_infos[info.filename] = info
             z.extractall(self.extracted_apk_dir)
+        # Remember the extracted files, to tell later which ones changed.
+        for name, info in self.input_infos.items():
+            path = join(self.extracted_apk_dir, name)
+            if not info.is_dir() and isfile(path):
+                stat = os.stat(path)
+                self.extracted_stats[name] = (stat.st_size, stat.st_mtime_ns)
+
+    def _is_unchanged(self, filepath, archivepath):
+        info = self.input_infos.get(archivepath)
+        if info is None or info.flag_bits & 0x1:
+            # New or encrypted.
+            return False
+        stat = os.stat(filepath)
+        return self.extracted_stats.get(archivepath) == (
+            stat.st_size,
+            stat.st_mtime_ns,
+        )
+
+    def _prepare_entry(self, entry):
+        filepath, archivepath = entry
+        if self._is_unchanged(filepath, archivepath):
+            return None
+        compress = self.per_file_compression.get(archivepath, zipfile.ZIP_DEFLATED)
+        return _compress_file(filepath, archivepath, compress)
 
     def __exit__(self, *args):
         remove_signature_files(self.extracted_apk_dir)
@@ -401,20 +485,36 @@ class ZipManager:
             os.remove(self.output_apk)
 
         log("Creating output apk")
-        with zipfile.ZipFile(self.output_apk, "w") as new_apk:
-            # Need sorted output for deterministic zip file. Sorting `dirnames` will
-            # ensure the tree walk order. Sorting `filenames` will ensure the files
-            # inside the tree.
-            # This scheme uses less memory than collecting all files first.
-            for dirpath, dirnames, filenames in os.walk(self.extracted_apk_dir):
-                dirnames.sort()
-                for filename in sorted(filenames):
-                    filepath = join(dirpath, filename)
-                    archivepath = filepath[len(self.extracted_apk_dir) + 1 :]
-                    try:
-                        compress = self.per_file_compression[archivepath]
-                    except KeyError:
-                        compress = zipfile.ZIP_DEFLATED
+        # Need sorted output for deterministic zip file. Sorting `dirnames` will
+        # ensure the tree walk order. Sorting `filenames` will ensure the files
+        # inside the tree.
+        entries = []
+        for dirpath, dirnames, filenames in os.walk(self.extracted_apk_dir):
+            dirnames.sort()
+            for filename in sorted(filenames):
+                filepath = join(dirpath, filename)
+                archivepath = filepath[len(self.extracted_apk_dir) + 1 :]
+                entries.append((filepath, archivepath))
+
+        with zipfile.ZipFile(self.output_apk, "w") as new_apk, open(
+            self.input_apk, "rb"
+        ) as old_apk, ThreadPool() as pool:
+            # The entries are compressed ahead, and written in order.
+            for entry, prepared in zip(
+                entries, pool.imap(self._prepare_entry, entries)
+            ):
+                filepath, archivepath = entry
+                if prepared is not None:
+                    info, data = prepared
+                    _write_compressed_entry(new_apk, info, data)
+                elif self._is_unchanged(filepath, archivepath):
+                    info = copy.copy(self.input_infos[archivepath])
+                    data = _read_compressed_entry(old_apk, info)
+                    # The CRC and sizes go in the local header.
+                    info.flag_bits &= ~0x08
+                    _write_compressed_entry(new_apk, info, data)
+                else:
+                    compress = self.per_file_compression[archivepath]
                     new_apk.write(filepath, archivepath, compress_type=compress)
 
 
@@ -803,6 +803,11 @@ Given an APK, produce a better APK!
         default="",
         help="Stop before a pass and dump intermediate dex and IR meta data to a directory",
     )
+    parser.add_argument(
+        "--stop-after-pass",
+        default="",
+        help="Stop after a pass and dump intermediate dex and IR meta data to a directory. redex-opt --resume runs the remaining passes",
+    )
     parser.add_argument(
         "--output-ir",
         default="",
@@ -1120,9 +1125,14 @@ def prepare_redex(args):
 
     # stop_pass_idx >= 0 means need stop before a pass and dump intermediate result
     stop_pass_idx = -1
-    if args.stop_pass:
+    if args.stop_pass and args.stop_after_pass:
+        sys.exit("--stop-pass and --stop-after-pass are exclusive")
+    if args.stop_pass or args.stop_after_pass:
         passes_list = config_dict.get("redex", {}).get("passes", [])
-        stop_pass_idx = get_stop_pass_idx(passes_list, args.stop_pass)
+        if args.stop_pass:
+            stop_pass_idx = get_stop_pass_idx(passes_list, args.stop_pass)
+        else:
+            stop_pass_idx = get_stop_pass_idx(passes_list, args.stop_after_pass) + 1
         if not args.output_ir or isfile(args.output_ir):
             print("Error: output_ir should be a directory")
             sys.exit(1)
@@ -1353,7 +1363,7 @@ def run_redex(args, exception_formatter=None, output_line_handler=None):
         exception_formatter = ExceptionMessageFormatter()
     run_redex_binary(state, exception_formatter, output_line_handler)
 
-    if args.stop_pass:
+    if stop_pass_idx != -1:
         # Do not remove temp dirs
         sys.exit()
 
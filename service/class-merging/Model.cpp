@@ -445,6 +445,11 @@ void Model::shape_model() {
               return compare_dextypes(first->type, second->type);
             });
 
+  if (is_merge_per_interdex_set_enabled() && s_num_interdex_groups > 1) {
+    // One walk over the scope serves all the groups to split.
+    compute_interdex_groups_of_usages();
+  }
+
   for (auto merger : mergers) {
     TRACE(CLMG, 6, "Build shapes from %s", SHOW(merger->type));
     MergerType::ShapeCollector shapes;
@@ -582,8 +587,6 @@ void Model::break_by_interface(const MergerType& merger,
 
 namespace {
 
-using TypeHashSet = std::unordered_set<DexType*>;
-
 DexType* check_current_instance(const ConstTypeHashSet& types,
                                 IRInstruction* insn) {
   DexType* type = nullptr;
@@ -602,15 +605,25 @@ DexType* check_current_instance(const ConstTypeHashSet& types,
   return type;
 }
 
-ConcurrentMap<DexType*, TypeHashSet> get_type_usages(
-    const ConstTypeHashSet& types, const Scope& scope) {
-  ConcurrentMap<DexType*, TypeHashSet> res;
+// For each of the given types that is used at all, the first interdex group
+// of the classes using it. Only that is kept, rather than the sets of such
+// classes, which take a lot of memory for large models.
+ConcurrentMap<const DexType*, size_t> get_interdex_groups_of_usages(
+    const ConstTypeHashSet& types,
+    const Scope& scope,
+    const std::unordered_map<DexType*, size_t>& cls_to_interdex_groups,
+    size_t interdex_groups) {
+  ConcurrentMap<const DexType*, size_t> res;
 
   walk::parallel::opcodes(scope, [&](DexMethod* method, IRInstruction* insn) {
-    auto cls = method->get_class();
-    const auto& updater =
-        [&cls](DexType* /* key */, std::unordered_set<DexType*>& set,
-               bool /* already_exists */) { set.emplace(cls); };
+    // By default, we consider the class in the last group.
+    auto it = cls_to_interdex_groups.find(method->get_class());
+    size_t group = it == cls_to_interdex_groups.end() ? interdex_groups - 1
+                                                      : it->second;
+    const auto& updater = [group](const DexType* /* key */,
+                                  size_t& min_group, bool already_exists) {
+      min_group = already_exists ? std::min(min_group, group) : group;
+    };
 
     auto current_instance = check_current_instance(types, insn);
     if (current_instance) {
@@ -640,32 +653,34 @@ ConcurrentMap<DexType*, TypeHashSet> get_type_usages(
   return res;
 }
 
-size_t get_interdex_group(
-    const TypeHashSet& types,
-    const std::unordered_map<DexType*, size_t>& cls_to_interdex_groups,
-    size_t interdex_groups) {
-  // By default, we consider the class in the last group.
-  size_t group = interdex_groups - 1;
-  for (DexType* type : types) {
-    if (cls_to_interdex_groups.count(type)) {
-      group = std::min(group, cls_to_interdex_groups.at(type));
-    }
-  }
-
-  return group;
-}
-
 } // namespace
 
 namespace class_merging {
 
+void Model::compute_interdex_groups_of_usages() {
+  // All types that can end up in a shape are leaves of the hierarchy.
+  ConstTypeHashSet types;
+  for (const auto& pair : m_hierarchy) {
+    for (const auto& child : pair.second) {
+      if (!m_hierarchy.count(child)) {
+        types.insert(child);
+      }
+    }
+  }
+  auto groups = get_interdex_groups_of_usages(
+      types, m_scope, s_cls_to_interdex_group, s_num_interdex_groups);
+  m_interdex_groups_of_usages.insert(groups.begin(), groups.end());
+}
+
 std::vector<TypeSet> Model::group_per_interdex_set(const TypeSet& types) {
-  ConstTypeHashSet type_hash_set{types.begin(), types.end()};
-  const auto& type_to_usages = get_type_usages(type_hash_set, m_scope);
   std::vector<TypeSet> new_groups(s_num_interdex_groups);
-  for (const auto& pair : type_to_usages) {
-    auto index = get_interdex_group(pair.second, s_cls_to_interdex_group,
-                                    s_num_interdex_groups);
+  for (const auto* type : types) {
+    auto it = m_interdex_groups_of_usages.find(type);
+    if (it == m_interdex_groups_of_usages.end()) {
+      // Unused types are dropped.
+      continue;
+    }
+    auto index = it->second;
     if (m_spec.merge_per_interdex_set == InterDexGroupingType::NON_HOT_SET) {
       if (index == 0) {
         // Drop mergeables that are in the hot set.
@@ -679,7 +694,7 @@ std::vector<TypeSet> Model::group_per_interdex_set(const TypeSet& types) {
         continue;
       }
     }
-    new_groups[index].emplace(pair.first);
+    new_groups[index].emplace(type);
   }
 
   return new_groups;
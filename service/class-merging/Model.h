@@ -327,6 +327,9 @@ class Model {
   std::unordered_map<const DexType*, MergerType> m_mergers;
   // Types excluded by the ModelSpec.exclude_types
   TypeSet m_excluded;
+  // With interdex grouping, the first interdex group of the classes using each
+  // used candidate type.
+  std::unordered_map<const DexType*, size_t> m_interdex_groups_of_usages;
   // The set of non mergeables types. Those are types that are not
   // erasable for whatever reason
   TypeSet m_non_mergeables;
@@ -398,6 +401,7 @@ class Model {
                           MergerType::ShapeHierarchy& hier);
   void flatten_shapes(const MergerType& merger,
                       MergerType::ShapeCollector& shapes);
+  void compute_interdex_groups_of_usages();
   std::vector<TypeSet> group_per_interdex_set(const TypeSet& types);
   void map_fields(MergerType& merger,
                   const std::vector<const DexType*>& classes);
@@ -7,6 +7,8 @@
 
 #include "ConstantPropagation.h"
 
+#include <chrono>
+
 #include "ConstantPropagationAnalysis.h"
 #include "ConstantPropagationTransform.h"
 
@@ -29,7 +31,15 @@ Transform::Stats ConstantPropagation::run(DexMethod* method,
   {
     intraprocedural::FixpointIterator fp_iter(code->cfg(),
                                               ConstantPrimitiveAnalyzer());
+    fp_iter.set_budget(m_config.max_steps_per_method,
+                       std::chrono::milliseconds(m_config.max_ms_per_method));
     fp_iter.run({});
+    if (fp_iter.budget_exceeded()) {
+      TRACE(CONSTP, 1, "Over budget: %s", SHOW(method));
+      code->clear_cfg();
+      local_stats.methods_over_budget = 1;
+      return local_stats;
+    }
     constant_propagation::Transform tf(m_config.transform);
     local_stats = tf.apply_on_uneditable_cfg(
         fp_iter, WholeProgramState(), code, xstores, method->get_class());
@@ -41,9 +51,17 @@ Transform::Stats ConstantPropagation::run(DexMethod* method,
     {
       intraprocedural::FixpointIterator fp_iter(code->cfg(),
                                                 ConstantPrimitiveAnalyzer());
+      fp_iter.set_budget(
+          m_config.max_steps_per_method,
+          std::chrono::milliseconds(m_config.max_ms_per_method));
       fp_iter.run({});
-      constant_propagation::Transform tf(m_config.transform);
-      local_stats += tf.apply(fp_iter, code->cfg(), method, xstores);
+      if (fp_iter.budget_exceeded()) {
+        TRACE(CONSTP, 1, "Over budget: %s", SHOW(method));
+        local_stats.methods_over_budget = 1;
+      } else {
+        constant_propagation::Transform tf(m_config.transform);
+        local_stats += tf.apply(fp_iter, code->cfg(), method, xstores);
+      }
     }
     code->clear_cfg();
   }
@@ -14,6 +14,10 @@ namespace constant_propagation {
 
 struct Config {
   Transform::Config transform;
+  // Bounds on the fixpoint iteration over a single method; a method that
+  // exceeds them is left as it is. Zero means no bound.
+  size_t max_steps_per_method{0};
+  size_t max_ms_per_method{0};
 };
 
 class ConstantPropagation final {
@@ -756,6 +756,7 @@ void Transform::Stats::log_metrics(ScopedMetrics& sm, bool with_scope) const {
   TRACE(CONSTP, 3, "Null checks removed: %zu(%zu)", null_checks,
         null_checks_method_calls);
   sm.set_metric("added_param_const", added_param_const);
+  sm.set_metric("methods_over_budget", methods_over_budget);
 }
 
 } // namespace constant_propagation
@@ -46,6 +46,8 @@ class Transform final {
     size_t throws{0};
     size_t null_checks{0};
     size_t null_checks_method_calls{0};
+    // Methods whose analysis exceeded its budget, and were left alone.
+    size_t methods_over_budget{0};
 
     Stats& operator+=(const Stats& that) {
       branches_removed += that.branches_removed;
@@ -55,6 +57,7 @@ class Transform final {
       throws += that.throws;
       null_checks += that.null_checks;
       null_checks_method_calls += that.null_checks_method_calls;
+      methods_over_budget += that.methods_over_budget;
       return *this;
     }
 
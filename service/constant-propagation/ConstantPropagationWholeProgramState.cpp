@@ -73,17 +73,51 @@ void analyze_clinits(const Scope& scope,
   }
 }
 
-bool analyze_gets_helper(const WholeProgramState* whole_program_state,
-                         const IRInstruction* insn,
-                         ConstantEnvironment* env) {
-  if (whole_program_state == nullptr) {
-    return false;
-  }
+ConstantValue get_field_value(const WholeProgramState* whole_program_state,
+                              const IRInstruction* insn) {
   auto field = resolve_field(insn->get_field());
   if (field == nullptr) {
+    return ConstantValue::top();
+  }
+  return whole_program_state->get_field_value(field);
+}
+
+ConstantValue get_return_value(const WholeProgramState* whole_program_state,
+                               const IRInstruction* insn) {
+  if (whole_program_state->has_call_graph()) {
+    auto method = resolve_method(insn->get_method(), opcode_to_search(insn));
+    if (method == nullptr && opcode_to_search(insn) == MethodSearch::Virtual) {
+      method =
+          resolve_method(insn->get_method(), MethodSearch::InterfaceVirtual);
+    }
+    if (method == nullptr) {
+      return ConstantValue::top();
+    }
+    if (whole_program_state->method_is_dynamic(method)) {
+      return ConstantValue::top();
+    }
+    return whole_program_state->get_return_value_from_cg(insn);
+  }
+  auto op = insn->opcode();
+  if (op != OPCODE_INVOKE_DIRECT && op != OPCODE_INVOKE_STATIC &&
+      op != OPCODE_INVOKE_VIRTUAL) {
+    return ConstantValue::top();
+  }
+  auto method = resolve_method(insn->get_method(), opcode_to_search(insn));
+  if (method == nullptr) {
+    return ConstantValue::top();
+  }
+  return whole_program_state->get_return_value(method);
+}
+
+bool analyze_whole_program_value(const WholeProgramState* whole_program_state,
+                                 const IRInstruction* insn,
+                                 ConstantEnvironment* env) {
+  if (whole_program_state == nullptr) {
     return false;
   }
-  auto value = whole_program_state->get_field_value(field);
+  auto value = WholeProgramAwareAnalyzer::get_whole_program_value(
+      whole_program_state, insn);
   if (value.is_top()) {
     return false;
   }
@@ -315,61 +349,36 @@ void WholeProgramState::collect_instance_finals(
                           &m_field_partition);
 }
 
+ConstantValue WholeProgramAwareAnalyzer::get_whole_program_value(
+    const WholeProgramState* whole_program_state, const IRInstruction* insn) {
+  if (opcode::is_an_sget(insn->opcode()) || opcode::is_an_iget(insn->opcode())) {
+    return get_field_value(whole_program_state, insn);
+  }
+  if (opcode::is_an_invoke(insn->opcode())) {
+    return get_return_value(whole_program_state, insn);
+  }
+  return ConstantValue::top();
+}
+
 bool WholeProgramAwareAnalyzer::analyze_sget(
     const WholeProgramState* whole_program_state,
     const IRInstruction* insn,
     ConstantEnvironment* env) {
-  return analyze_gets_helper(whole_program_state, insn, env);
+  return analyze_whole_program_value(whole_program_state, insn, env);
 }
 
 bool WholeProgramAwareAnalyzer::analyze_iget(
     const WholeProgramState* whole_program_state,
     const IRInstruction* insn,
     ConstantEnvironment* env) {
-  return analyze_gets_helper(whole_program_state, insn, env);
+  return analyze_whole_program_value(whole_program_state, insn, env);
 }
 
 bool WholeProgramAwareAnalyzer::analyze_invoke(
     const WholeProgramState* whole_program_state,
     const IRInstruction* insn,
     ConstantEnvironment* env) {
-  if (whole_program_state == nullptr) {
-    return false;
-  }
-  if (whole_program_state->has_call_graph()) {
-    auto method = resolve_method(insn->get_method(), opcode_to_search(insn));
-    if (method == nullptr && opcode_to_search(insn) == MethodSearch::Virtual) {
-      method =
-          resolve_method(insn->get_method(), MethodSearch::InterfaceVirtual);
-    }
-    if (method == nullptr) {
-      return false;
-    }
-    if (whole_program_state->method_is_dynamic(method)) {
-      return false;
-    }
-    auto value = whole_program_state->get_return_value_from_cg(insn);
-    if (value.is_top()) {
-      return false;
-    }
-    env->set(RESULT_REGISTER, value);
-    return true;
-  }
-  auto op = insn->opcode();
-  if (op != OPCODE_INVOKE_DIRECT && op != OPCODE_INVOKE_STATIC &&
-      op != OPCODE_INVOKE_VIRTUAL) {
-    return false;
-  }
-  auto method = resolve_method(insn->get_method(), opcode_to_search(insn));
-  if (method == nullptr) {
-    return false;
-  }
-  auto value = whole_program_state->get_return_value(method);
-  if (value.is_top()) {
-    return false;
-  }
-  env->set(RESULT_REGISTER, value);
-  return true;
+  return analyze_whole_program_value(whole_program_state, insn, env);
 }
 
 } // namespace constant_propagation
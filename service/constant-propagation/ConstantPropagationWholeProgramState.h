@@ -210,6 +210,13 @@ class WholeProgramAwareAnalyzer final
   static bool analyze_invoke(const WholeProgramState* whole_program_state,
                              const IRInstruction* insn,
                              ConstantEnvironment* env);
+
+  /*
+   * Returns the value that the field read or invoke :insn obtains from the
+   * whole program state, or Top if it does not learn anything from it.
+   */
+  static ConstantValue get_whole_program_value(
+      const WholeProgramState* whole_program_state, const IRInstruction* insn);
 };
 
 } // namespace constant_propagation
@@ -7,6 +7,8 @@
 
 #include "IPConstantPropagationAnalysis.h"
 
+#include "IPConstantPropagationSummaryCache.h"
+
 namespace constant_propagation {
 
 namespace interprocedural {
@@ -52,7 +54,6 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
     return;
   }
   auto& cfg = code->cfg();
-  auto intra_cp = get_intraprocedural_analysis(method);
   const auto outgoing_edges =
       call_graph::GraphInterface::successors(m_call_graph, node);
   std::unordered_set<IRInstruction*> outgoing_insns;
@@ -62,23 +63,64 @@ void FixpointIterator::analyze_node(call_graph::NodeId const& node,
     }
     outgoing_insns.emplace(edge->invoke_iterator()->insn);
   }
+
+  boost::optional<SummaryCache::Key> cache_key;
+  if (m_summary_cache != nullptr) {
+    cache_key =
+        m_summary_cache->make_key(method, get_entry_args(method), *m_wps);
+  }
+  if (cache_key) {
+    auto summary = m_summary_cache->lookup(method, *cache_key);
+    if (summary) {
+      std::unordered_map<uint32_t, const ArgumentDomain*> args_at;
+      for (const auto& pair : *summary) {
+        args_at.emplace(pair.first, &pair.second);
+      }
+      uint32_t index = 0;
+      for (auto* block : cfg.blocks()) {
+        for (auto& mie : InstructionIterable(block)) {
+          auto it = args_at.find(index++);
+          if (it != args_at.end() && outgoing_insns.count(mie.insn)) {
+            current_state->set(mie.insn, *it->second);
+          }
+        }
+      }
+      return;
+    }
+  }
+
+  auto intra_cp = get_intraprocedural_analysis(method);
+  // When caching, the arguments of all the invokes are kept, since the call
+  // graph may differ in the runs that reuse the summary.
+  SummaryCache::Summary summary;
+  uint32_t index = 0;
   for (auto* block : cfg.blocks()) {
     auto state = intra_cp->get_entry_state_at(block);
     auto last_insn = block->get_last_insn();
     for (auto& mie : InstructionIterable(block)) {
       auto* insn = mie.insn;
       if (insn->has_method()) {
-        if (outgoing_insns.count(insn)) {
+        bool is_outgoing = outgoing_insns.count(insn);
+        if (is_outgoing || cache_key) {
           ArgumentDomain out_args;
           for (size_t i = 0; i < insn->srcs_size(); ++i) {
             out_args.set(i, state.get(insn->src(i)));
           }
-          current_state->set(insn, out_args);
+          if (is_outgoing) {
+            current_state->set(insn, out_args);
+          }
+          if (cache_key) {
+            summary.emplace_back(index, out_args);
+          }
         }
       }
       intra_cp->analyze_instruction(insn, &state, insn == last_insn->insn);
+      ++index;
     }
   }
+  if (cache_key) {
+    m_summary_cache->record(method, *cache_key, summary);
+  }
 }
 
 Domain FixpointIterator::analyze_edge(
@@ -96,17 +138,21 @@ Domain FixpointIterator::analyze_edge(
   return entry_state_at_dest;
 }
 
-std::unique_ptr<intraprocedural::FixpointIterator>
-FixpointIterator::get_intraprocedural_analysis(const DexMethod* method) const {
+ArgumentDomain FixpointIterator::get_entry_args(
+    const DexMethod* method) const {
   auto args = Domain::bottom();
 
   if (m_call_graph.has_node(method)) {
     args = this->get_entry_state_at(m_call_graph.node(method));
   }
 
-  return m_proc_analysis_factory(method,
-                                 this->get_whole_program_state(),
-                                 args.get(CURRENT_PARTITION_LABEL));
+  return args.get(CURRENT_PARTITION_LABEL);
+}
+
+std::unique_ptr<intraprocedural::FixpointIterator>
+FixpointIterator::get_intraprocedural_analysis(const DexMethod* method) const {
+  return m_proc_analysis_factory(
+      method, this->get_whole_program_state(), get_entry_args(method));
 }
 
 } // namespace interprocedural
@@ -54,6 +54,8 @@ ConstantEnvironment env_with_params(bool is_static,
                                     const IRCode* code,
                                     const ArgumentDomain& args);
 
+class SummaryCache;
+
 using ProcedureAnalysisFactory =
     std::function<std::unique_ptr<intraprocedural::FixpointIterator>(
         const DexMethod*, const WholeProgramState&, ArgumentDomain)>;
@@ -95,10 +97,19 @@ class FixpointIterator : public sparta::ParallelMonotonicFixpointIterator<
 
   const call_graph::Graph& get_call_graph() { return m_call_graph; }
 
+  /*
+   * Reuse the summaries of previous runs from :cache, and record the new ones
+   * into it. The cache must outlive the runs of this iterator.
+   */
+  void set_summary_cache(SummaryCache* cache) { m_summary_cache = cache; }
+
  private:
+  ArgumentDomain get_entry_args(const DexMethod* method) const;
+
   std::unique_ptr<const WholeProgramState> m_wps;
   ProcedureAnalysisFactory m_proc_analysis_factory;
   call_graph::Graph m_call_graph;
+  SummaryCache* m_summary_cache{nullptr};
 };
 
 } // namespace interprocedural
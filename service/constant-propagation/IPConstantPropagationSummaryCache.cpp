@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IPConstantPropagationSummaryCache.h"
+
+#include <fstream>
+#include <map>
+
+#include <boost/functional/hash.hpp>
+
+#include "DexHasher.h"
+#include "Resolver.h"
+#include "SummarySerialization.h"
+#include "Trace.h"
+
+using namespace sparta;
+
+namespace constant_propagation {
+
+namespace interprocedural {
+
+namespace {
+
+// Entries beyond this number are dropped, oldest first.
+constexpr size_t MAX_ENTRIES_PER_METHOD = 4;
+
+boost::optional<s_expr> value_to_s_expr(const ConstantValue& value) {
+  if (value.is_top()) {
+    return s_expr("top");
+  }
+  if (value.is_bottom()) {
+    return s_expr("bottom");
+  }
+  auto scd = value.maybe_get<SignedConstantDomain>();
+  if (!scd) {
+    return boost::none;
+  }
+  auto cst = scd->get_constant();
+  if (cst) {
+    return s_expr({s_expr("constant"), s_expr(std::to_string(*cst))});
+  }
+  return s_expr({s_expr("interval"),
+                 s_expr(static_cast<int32_t>(scd->interval()))});
+}
+
+ConstantValue value_from_s_expr(const s_expr& expr) {
+  if (expr.is_string()) {
+    if (expr.get_string() == "top") {
+      return ConstantValue::top();
+    }
+    always_assert_log(expr.get_string() == "bottom", "Unexpected value %s",
+                      expr.str().c_str());
+    return ConstantValue::bottom();
+  }
+  always_assert_log(expr.is_list() && expr.size() == 2, "Unexpected value %s",
+                    expr.str().c_str());
+  if (expr[0].get_string() == "constant") {
+    return SignedConstantDomain(std::stoll(expr[1].get_string()));
+  }
+  always_assert_log(expr[0].get_string() == "interval",
+                    "Unexpected value %s", expr.str().c_str());
+  auto interval = expr[1].get_int32();
+  always_assert(interval >= 0 &&
+                interval < static_cast<int32_t>(sign_domain::Interval::SIZE));
+  return SignedConstantDomain(static_cast<sign_domain::Interval>(interval));
+}
+
+boost::optional<s_expr> args_to_s_expr(const ArgumentDomain& args) {
+  if (args.is_top()) {
+    return s_expr("top");
+  }
+  if (args.is_bottom()) {
+    return s_expr("bottom");
+  }
+  // The bindings are iterated in an unspecified order.
+  std::map<param_index_t, s_expr> ordered;
+  for (const auto& pair : args.bindings()) {
+    auto value = value_to_s_expr(pair.second);
+    if (!value) {
+      return boost::none;
+    }
+    ordered.emplace(pair.first, *value);
+  }
+  std::vector<s_expr> bindings;
+  for (const auto& pair : ordered) {
+    bindings.emplace_back(
+        s_expr({s_expr(static_cast<int32_t>(pair.first)), pair.second}));
+  }
+  return s_expr(bindings);
+}
+
+ArgumentDomain args_from_s_expr(const s_expr& expr) {
+  if (expr.is_string()) {
+    return expr.get_string() == "top" ? ArgumentDomain::top()
+                                      : ArgumentDomain::bottom();
+  }
+  ArgumentDomain args;
+  for (size_t i = 0; i < expr.size(); ++i) {
+    args.set(static_cast<param_index_t>(expr[i][0].get_int32()),
+             value_from_s_expr(expr[i][1]));
+  }
+  return args;
+}
+
+boost::optional<s_expr> summary_to_s_expr(
+    const SummaryCache::Summary& summary) {
+  std::vector<s_expr> exprs;
+  for (const auto& pair : summary) {
+    auto args = args_to_s_expr(pair.second);
+    if (!args) {
+      return boost::none;
+    }
+    exprs.emplace_back(
+        s_expr({s_expr(static_cast<int32_t>(pair.first)), *args}));
+  }
+  return s_expr(exprs);
+}
+
+SummaryCache::Summary summary_from_s_expr(const s_expr& expr) {
+  SummaryCache::Summary summary;
+  for (size_t i = 0; i < expr.size(); ++i) {
+    summary.emplace_back(static_cast<uint32_t>(expr[i][0].get_int32()),
+                         args_from_s_expr(expr[i][1]));
+  }
+  return summary;
+}
+
+} // namespace
+
+SummaryCache::MethodEntries SummaryCache::MethodEntries::from_s_expr(
+    const s_expr& expr) {
+  MethodEntries result;
+  for (size_t i = 0; i < expr.size(); ++i) {
+    result.entries.push_back(Entry{expr[i][0], expr[i][1]});
+  }
+  return result;
+}
+
+s_expr to_s_expr(const SummaryCache::MethodEntries& method_entries) {
+  std::vector<s_expr> exprs;
+  for (const auto& entry : method_entries.entries) {
+    exprs.emplace_back(s_expr({entry.inputs, entry.summary}));
+  }
+  return s_expr(exprs);
+}
+
+size_t SummaryCache::load(const std::string& path) {
+  std::ifstream input(path);
+  if (!input) {
+    TRACE(ICONSTP, 1, "No summary cache at %s", path.c_str());
+    return 0;
+  }
+  std::lock_guard<std::mutex> guard(m_lock);
+  return summary_serialization::read(input, &m_entries,
+                                     /* no_load_external */ false);
+}
+
+void SummaryCache::save(const std::string& path) const {
+  std::lock_guard<std::mutex> guard(m_lock);
+  std::map<const DexMethodRef*, MethodEntries, dexmethods_comparator> ordered(
+      m_entries.begin(), m_entries.end());
+  std::ofstream output(path);
+  summary_serialization::print(output, ordered);
+}
+
+size_t SummaryCache::get_method_hash(const DexMethod* method) {
+  auto it = m_method_hashes.find(method);
+  if (it != m_method_hashes.end()) {
+    return it->second;
+  }
+  auto hash = hashing::hash_method(method);
+  m_method_hashes.emplace(method, hash);
+  return hash;
+}
+
+size_t SummaryCache::get_dependencies_hash(const DexMethod* method) {
+  auto it = m_dependencies_hashes.find(method);
+  if (it != m_dependencies_hashes.end()) {
+    return it->second;
+  }
+  size_t hash = m_config_hash;
+  boost::hash_combine(hash, get_method_hash(method));
+  for (auto& mie : InstructionIterable(method->get_code())) {
+    auto insn = mie.insn;
+    if (!opcode::is_an_invoke(insn->opcode())) {
+      continue;
+    }
+    auto callee = resolve_method(insn->get_method(), opcode_to_search(insn));
+    if (callee == nullptr) {
+      boost::hash_combine(hash, show(insn->get_method()));
+    } else {
+      boost::hash_combine(hash, get_method_hash(callee));
+    }
+  }
+  if (method::is_clinit(method)) {
+    // The analysis of a class initializer starts from the encoded values of
+    // the static fields.
+    for (auto* sfield : type_class(method->get_class())->get_sfields()) {
+      auto value = sfield->get_static_value();
+      boost::hash_combine(hash, value == nullptr ? std::string("null")
+                                                 : value->show());
+    }
+  }
+  m_dependencies_hashes.emplace(method, hash);
+  return hash;
+}
+
+boost::optional<SummaryCache::Key> SummaryCache::make_key(
+    const DexMethod* method,
+    const ArgumentDomain& args,
+    const WholeProgramState& wps) {
+  auto args_expr = args_to_s_expr(args);
+  if (!args_expr) {
+    return boost::none;
+  }
+  std::vector<s_expr> reads;
+  for (auto* block : method->get_code()->cfg().blocks()) {
+    for (auto& mie : InstructionIterable(block)) {
+      auto insn = mie.insn;
+      auto op = insn->opcode();
+      if (!opcode::is_an_sget(op) && !opcode::is_an_iget(op) &&
+          !opcode::is_an_invoke(op)) {
+        continue;
+      }
+      auto value = value_to_s_expr(
+          WholeProgramAwareAnalyzer::get_whole_program_value(&wps, insn));
+      if (!value) {
+        return boost::none;
+      }
+      reads.push_back(*value);
+    }
+  }
+  return Key{s_expr({s_expr(hashing::hash_to_string(
+                         get_dependencies_hash(method))),
+                     *args_expr, s_expr(reads)})};
+}
+
+boost::optional<SummaryCache::Summary> SummaryCache::lookup(
+    const DexMethod* method, const Key& key) {
+  std::lock_guard<std::mutex> guard(m_lock);
+  auto it = m_entries.find(method);
+  if (it != m_entries.end()) {
+    for (const auto& entry : it->second.entries) {
+      if (entry.inputs == key.inputs) {
+        ++m_hits;
+        return summary_from_s_expr(entry.summary);
+      }
+    }
+  }
+  ++m_misses;
+  return boost::none;
+}
+
+void SummaryCache::record(const DexMethod* method,
+                          const Key& key,
+                          const Summary& summary) {
+  auto summary_expr = summary_to_s_expr(summary);
+  if (!summary_expr) {
+    return;
+  }
+  std::lock_guard<std::mutex> guard(m_lock);
+  auto& entries = m_entries[method].entries;
+  for (const auto& entry : entries) {
+    if (entry.inputs == key.inputs) {
+      return;
+    }
+  }
+  if (entries.size() == MAX_ENTRIES_PER_METHOD) {
+    entries.erase(entries.begin());
+  }
+  entries.push_back(Entry{key.inputs, *summary_expr});
+}
+
+} // namespace interprocedural
+
+} // namespace constant_propagation
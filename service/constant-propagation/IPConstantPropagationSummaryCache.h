@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/optional.hpp>
+
+#include "ConcurrentContainers.h"
+#include "IPConstantPropagationAnalysis.h"
+#include "S_Expression.h"
+
+namespace constant_propagation {
+
+namespace interprocedural {
+
+/*
+ * A persistent cache of the summaries computed by
+ * FixpointIterator::analyze_node(), i.e. the arguments that a method passes
+ * at each of its invoke instructions.
+ *
+ * A summary is reused only when everything the intraprocedural analysis
+ * depends on is unchanged:
+ *  - the code of the method and of the methods it directly invokes (which
+ *    covers the constructors and getters used by the immutable attribute
+ *    analysis), as computed by hashing::hash_method();
+ *  - the arguments the method is called with;
+ *  - the field values and return values it reads from the whole program
+ *    state.
+ *
+ * Only summaries whose values are numeric constants or intervals can be
+ * serialized; methods that pass or read other kinds of values are simply
+ * not cached.
+ *
+ * The cache is stored as a text file of s-expressions, one line per method,
+ * using summary_serialization.
+ */
+class SummaryCache final {
+ public:
+  // The arguments passed at each invoke instruction, identified by its index
+  // among the instructions of the method.
+  using Summary = std::vector<std::pair<uint32_t, ArgumentDomain>>;
+
+  /*
+   * The inputs of the analysis of a method. Apart from the code, which is
+   * identified by its hash, they are kept in full rather than hashed.
+   */
+  struct Key {
+    sparta::s_expr inputs;
+  };
+
+  /*
+   * A method may be analyzed with different inputs during a single run, e.g.
+   * once per refinement of the whole program state. We keep the last few.
+   */
+  struct Entry {
+    sparta::s_expr inputs;
+    sparta::s_expr summary;
+  };
+
+  struct MethodEntries {
+    std::vector<Entry> entries;
+
+    static MethodEntries from_s_expr(const sparta::s_expr& expr);
+  };
+
+  /*
+   * Entries computed under a different `config_hash` are never reused. It
+   * should capture the options that affect the intraprocedural analysis.
+   */
+  explicit SummaryCache(size_t config_hash = 0) : m_config_hash(config_hash) {}
+
+  // Returns the number of methods read.
+  size_t load(const std::string& path);
+
+  void save(const std::string& path) const;
+
+  /*
+   * Returns boost::none if the method cannot be cached, because some of its
+   * inputs cannot be serialized.
+   */
+  boost::optional<Key> make_key(const DexMethod* method,
+                                const ArgumentDomain& args,
+                                const WholeProgramState& wps);
+
+  boost::optional<Summary> lookup(const DexMethod* method, const Key& key);
+
+  void record(const DexMethod* method,
+              const Key& key,
+              const Summary& summary);
+
+  size_t hits() const { return m_hits; }
+
+  size_t misses() const { return m_misses; }
+
+ private:
+  size_t get_dependencies_hash(const DexMethod* method);
+
+  size_t get_method_hash(const DexMethod* method);
+
+  size_t m_config_hash;
+  mutable std::mutex m_lock;
+  std::unordered_map<const DexMethodRef*, MethodEntries> m_entries;
+  ConcurrentMap<const DexMethod*, size_t> m_method_hashes;
+  ConcurrentMap<const DexMethod*, size_t> m_dependencies_hashes;
+  std::atomic<size_t> m_hits{0};
+  std::atomic<size_t> m_misses{0};
+};
+
+sparta::s_expr to_s_expr(const SummaryCache::MethodEntries& entries);
+
+} // namespace interprocedural
+
+} // namespace constant_propagation
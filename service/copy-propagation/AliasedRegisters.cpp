@@ -299,16 +299,17 @@ reg_t AliasedRegisters::get_representative(
 
 // if `r` is in the graph, return the vertex holding it.
 // if not, return boost::none.
-// WARNING: this operation is expensive on large graphs. It's an O(n) search of
-// all the nodes.
 boost::optional<vertex_t> AliasedRegisters::find(const Value& r) const {
-  const auto& iters = boost::vertices(m_graph);
-  const auto& begin = iters.first;
-  const auto& end = iters.second;
-  for (auto it = begin; it != end; ++it) {
-    if (m_graph[*it] == r) {
-      return *it;
+  if (r.is_register()) {
+    reg_t reg = r.reg();
+    if (reg < m_reg_vertices.size() && m_reg_vertices[reg] != NO_VERTEX) {
+      return m_reg_vertices[reg];
     }
+    return boost::none;
+  }
+  auto it = m_other_vertices.find(r);
+  if (it != m_other_vertices.end()) {
+    return it->second;
   }
   return boost::none;
 }
@@ -341,6 +342,15 @@ vertex_t AliasedRegisters::find_or_create(const Value& r) {
     return *it;
   } else {
     vertex_t v = boost::add_vertex(r, m_graph);
+    if (r.is_register()) {
+      reg_t reg = r.reg();
+      if (reg >= m_reg_vertices.size()) {
+        m_reg_vertices.resize(reg + 1, NO_VERTEX);
+      }
+      m_reg_vertices[reg] = v;
+    } else {
+      m_other_vertices.emplace(r, v);
+    }
     return v;
   }
 }
@@ -388,6 +398,8 @@ bool AliasedRegisters::has_outgoing(vertex_t v) {
 void AliasedRegisters::clear() {
   m_graph.clear();
   m_insert_order.clear();
+  m_reg_vertices.clear();
+  m_other_vertices.clear();
 }
 
 AbstractValueKind AliasedRegisters::kind() const {
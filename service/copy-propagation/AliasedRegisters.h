@@ -18,6 +18,8 @@
 #include <boost/optional.hpp>
 #include <boost/range/iterator_range.hpp>
 #include <limits>
+#include <map>
+#include <vector>
 
 #include "AbstractDomain.h"
 #include "ConstantUses.h"
@@ -184,6 +186,14 @@ class AliasedRegisters final : public sparta::AbstractValue<AliasedRegisters> {
   using InsertionOrder = std::unordered_map<vertex_t, size_t>;
   InsertionOrder m_insert_order;
 
+  // The vertices of the Values in the graph, so that `find` doesn't need to
+  // scan all vertices. Registers are indexed densely by register number, with
+  // NO_VERTEX for the registers that are not in the graph; the few other
+  // Values are kept in a map.
+  static constexpr vertex_t NO_VERTEX = std::numeric_limits<vertex_t>::max();
+  std::vector<vertex_t> m_reg_vertices;
+  std::map<Value, vertex_t> m_other_vertices;
+
   boost::optional<vertex_t> find(const Value& r) const;
   boost::optional<vertex_t> find_in_tree(const Value& r,
                                          vertex_t in_this_tree) const;
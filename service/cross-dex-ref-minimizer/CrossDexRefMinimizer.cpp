@@ -13,9 +13,18 @@
 #include "DexUtil.h"
 #include "Show.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace cross_dex_ref_minimizer {
 
+namespace {
+
+// Recomputing a priority is cheap; only when there are many of them, it's
+// worth doing in parallel.
+constexpr size_t MIN_PARALLEL_PRIORITIES = 4096;
+
+} // namespace
+
 template <class Value, size_t N>
 std::string format_infrequent_refs_array(const std::array<Value, N>& array) {
   std::ostringstream ss;
@@ -75,20 +84,49 @@ void CrossDexRefMinimizer::reprioritize(
         affected_classes) {
   TRACE(IDEX, 4, "[dex ordering] Reprioritizing %zu classes",
         affected_classes.size());
-  for (auto p : affected_classes) {
-    ++m_stats.reprioritizations;
-    DexClass* affected_class = p.first;
-    CrossDexRefMinimizer::ClassInfoDelta& delta = p.second;
-    CrossDexRefMinimizer::ClassInfo& affected_class_info =
-        m_class_infos.at(affected_class);
-    affected_class_info.applied_refs_weight += delta.applied_refs_weight;
+  struct Reprioritization {
+    DexClass* cls;
+    const CrossDexRefMinimizer::ClassInfoDelta* delta;
+    CrossDexRefMinimizer::ClassInfo* info;
+    uint64_t priority;
+  };
+  std::vector<Reprioritization> reprioritizations;
+  reprioritizations.reserve(affected_classes.size());
+  for (auto& p : affected_classes) {
+    reprioritizations.push_back(
+        {p.first, &p.second, &m_class_infos.at(p.first), 0});
+  }
+  // Each affected class is distinct, so the deltas can be applied and the
+  // priorities recomputed independently.
+  auto apply = [](Reprioritization& r) {
+    r.info->applied_refs_weight += r.delta->applied_refs_weight;
     for (size_t i = 0; i < INFREQUENT_REFS_COUNT; ++i) {
-      affected_class_info.infrequent_refs_weight[i] +=
-          delta.infrequent_refs_weight[i];
+      r.info->infrequent_refs_weight[i] += r.delta->infrequent_refs_weight[i];
     }
-
-    const auto priority = affected_class_info.get_priority();
-    m_prioritized_classes.update_priority(affected_class, priority);
+    r.priority = r.info->get_priority();
+  };
+  if (reprioritizations.size() >= MIN_PARALLEL_PRIORITIES) {
+    std::vector<Reprioritization*> items;
+    items.reserve(reprioritizations.size());
+    for (auto& r : reprioritizations) {
+      items.push_back(&r);
+    }
+    workqueue_run<Reprioritization*>(
+        [&apply](Reprioritization* r) { apply(*r); }, items);
+  } else {
+    for (auto& r : reprioritizations) {
+      apply(r);
+    }
+  }
+  std::vector<std::pair<DexClass*, uint64_t>> updates;
+  updates.reserve(reprioritizations.size());
+  for (auto& r : reprioritizations) {
+    ++m_stats.reprioritizations;
+    DexClass* affected_class = r.cls;
+    const CrossDexRefMinimizer::ClassInfoDelta& delta = *r.delta;
+    const CrossDexRefMinimizer::ClassInfo& affected_class_info = *r.info;
+    const auto priority = r.priority;
+    updates.emplace_back(affected_class, priority);
     TRACE(
         IDEX, 5,
         "[dex ordering] Reprioritized class {%s} with priority %016" PRIu64
@@ -102,29 +140,31 @@ void CrossDexRefMinimizer::reprioritize(
         format_infrequent_refs_array(delta.infrequent_refs_weight).c_str(),
         affected_class_info.refs.size());
   }
+  m_prioritized_classes.update_priorities(updates);
 }
 
-void CrossDexRefMinimizer::gather_refs(DexClass* cls,
-                                       std::vector<DexMethodRef*>& method_refs,
-                                       std::vector<DexFieldRef*>& field_refs,
-                                       std::vector<DexType*>& types,
-                                       std::vector<DexString*>& strings) {
-  cls->gather_methods(method_refs);
-  cls->gather_fields(field_refs);
-  cls->gather_types(types);
-  cls->gather_strings(strings);
-
-  // remove duplicates to speed up actual sorting
-  sort_unique(method_refs);
-  sort_unique(field_refs);
-  sort_unique(types);
-  sort_unique(strings);
-
-  // sort deterministically
-  std::sort(method_refs.begin(), method_refs.end(), compare_dexmethods);
-  std::sort(field_refs.begin(), field_refs.end(), compare_dexfields);
-  std::sort(types.begin(), types.end(), compare_dextypes);
-  std::sort(strings.begin(), strings.end(), compare_dexstrings);
+CrossDexRefMinimizer::Refs CrossDexRefMinimizer::gather_refs(DexClass* cls) {
+  if (m_class_refs) {
+    return *m_class_refs->get(cls);
+  }
+  return class_refs::gather(cls);
+}
+
+std::vector<CrossDexRefMinimizer::Refs> CrossDexRefMinimizer::gather_refs(
+    const std::vector<DexClass*>& classes) {
+  std::vector<Refs> refs(classes.size());
+  if (m_class_refs) {
+    m_class_refs->prefetch(classes);
+    for (size_t i = 0; i < classes.size(); ++i) {
+      refs[i] = *m_class_refs->get(classes[i]);
+    }
+    return refs;
+  }
+  std::vector<size_t> indices(classes.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) { refs[i] = class_refs::gather(classes[i]); }, indices);
+  return refs;
 }
 
 void CrossDexRefMinimizer::ignore(DexClass* cls) {
@@ -134,12 +174,17 @@ void CrossDexRefMinimizer::ignore(DexClass* cls) {
   m_ref_counts[cls->get_type()] = std::numeric_limits<size_t>::max();
 }
 
-void CrossDexRefMinimizer::sample(DexClass* cls) {
-  std::vector<DexMethodRef*> method_refs;
-  std::vector<DexFieldRef*> field_refs;
-  std::vector<DexType*> types;
-  std::vector<DexString*> strings;
-  gather_refs(cls, method_refs, field_refs, types, strings);
+void CrossDexRefMinimizer::sample(DexClass* cls) { sample(gather_refs(cls)); }
+
+void CrossDexRefMinimizer::sample(const std::vector<DexClass*>& classes) {
+  auto refs = gather_refs(classes);
+  for (size_t i = 0; i < classes.size(); ++i) {
+    sample(refs[i]);
+    m_sampled_refs[classes[i]] = std::move(refs[i]);
+  }
+}
+
+void CrossDexRefMinimizer::sample(const Refs& refs) {
   auto increment = [&ref_counts = m_ref_counts,
                     &max_ref_count = m_max_ref_count](void* ref) {
     size_t& count = ref_counts[ref];
@@ -147,21 +192,48 @@ void CrossDexRefMinimizer::sample(DexClass* cls) {
       max_ref_count = count;
     }
   };
-  for (auto ref : method_refs) {
+  for (auto ref : refs.method_refs) {
     increment(ref);
   }
-  for (auto ref : field_refs) {
+  for (auto ref : refs.field_refs) {
     increment(ref);
   }
-  for (auto ref : types) {
+  for (auto ref : refs.types) {
     increment(ref);
   }
-  for (auto ref : strings) {
+  for (auto ref : refs.strings) {
     increment(ref);
   }
 }
 
 void CrossDexRefMinimizer::insert(DexClass* cls) {
+  auto it = m_sampled_refs.find(cls);
+  if (it == m_sampled_refs.end()) {
+    insert(cls, gather_refs(cls));
+    return;
+  }
+  auto refs = std::move(it->second);
+  m_sampled_refs.erase(it);
+  insert(cls, refs);
+}
+
+void CrossDexRefMinimizer::insert(const std::vector<DexClass*>& classes) {
+  std::vector<DexClass*> unsampled_classes;
+  for (auto cls : classes) {
+    if (!m_sampled_refs.count(cls)) {
+      unsampled_classes.push_back(cls);
+    }
+  }
+  auto unsampled_refs = gather_refs(unsampled_classes);
+  for (size_t i = 0; i < unsampled_classes.size(); ++i) {
+    m_sampled_refs[unsampled_classes[i]] = std::move(unsampled_refs[i]);
+  }
+  for (auto cls : classes) {
+    insert(cls);
+  }
+}
+
+void CrossDexRefMinimizer::insert(DexClass* cls, const Refs& gathered_refs) {
   always_assert(m_class_infos.count(cls) == 0);
   ++m_stats.classes;
   CrossDexRefMinimizer::ClassInfo& class_info =
@@ -173,11 +245,10 @@ void CrossDexRefMinimizer::insert(DexClass* cls) {
   // entries.
   // We don't bother with protos and type_lists, as they are directly related
   // to method refs (I tried, didn't help).
-  std::vector<DexMethodRef*> method_refs;
-  std::vector<DexFieldRef*> field_refs;
-  std::vector<DexType*> types;
-  std::vector<DexString*> strings;
-  gather_refs(cls, method_refs, field_refs, types, strings);
+  const auto& method_refs = gathered_refs.method_refs;
+  const auto& field_refs = gathered_refs.field_refs;
+  const auto& types = gathered_refs.types;
+  const auto& strings = gathered_refs.strings;
 
   auto& refs = class_info.refs;
   refs.reserve(method_refs.size() + field_refs.size() + types.size() +
@@ -403,13 +474,26 @@ void CrossDexRefMinimizer::erase(DexClass* cls, bool emitted, bool reset) {
 
   if (reset) {
     m_prioritized_classes.clear();
+    std::vector<std::pair<DexClass*, CrossDexRefMinimizer::ClassInfo*>>
+        reset_classes;
+    reset_classes.reserve(m_class_infos.size());
     for (auto it = m_class_infos.begin(); it != m_class_infos.end(); ++it) {
-      DexClass* reset_class = it->first;
-      CrossDexRefMinimizer::ClassInfo& reset_class_info = it->second;
-      reset_class_info.applied_refs_weight = 0;
-      const auto priority = reset_class_info.get_priority();
-      m_prioritized_classes.insert(reset_class, priority);
-      always_assert(reset_class_info.applied_refs_weight == 0);
+      reset_classes.emplace_back(it->first, &it->second);
+    }
+    std::vector<uint64_t> priorities(reset_classes.size());
+    std::vector<size_t> indices(reset_classes.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    workqueue_run<size_t>(
+        [&](size_t i) {
+          CrossDexRefMinimizer::ClassInfo& reset_class_info =
+              *reset_classes[i].second;
+          reset_class_info.applied_refs_weight = 0;
+          priorities[i] = reset_class_info.get_priority();
+        },
+        indices);
+    for (size_t i = 0; i < reset_classes.size(); ++i) {
+      m_prioritized_classes.insert(reset_classes[i].first, priorities[i]);
+      always_assert(reset_classes[i].second->applied_refs_weight == 0);
     }
   }
   if (emitted) {
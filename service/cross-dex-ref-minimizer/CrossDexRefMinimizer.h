@@ -11,6 +11,7 @@
 #include <unordered_set>
 #include <vector>
 
+#include "ClassRefs.h"
 #include "DexClass.h"
 #include "MutablePriorityQueue.h"
 
@@ -114,21 +115,34 @@ class CrossDexRefMinimizer {
   std::unordered_map<void*, size_t> m_ref_counts;
   size_t m_max_ref_count{0};
 
-  void gather_refs(DexClass* cls,
-                   std::vector<DexMethodRef*>& method_refs,
-                   std::vector<DexFieldRef*>& field_refs,
-                   std::vector<DexType*>& types,
-                   std::vector<DexString*>& strings);
+  using Refs = class_refs::Refs;
+  // Refs gathered by sampling a batch of classes, to be consumed when
+  // inserting them.
+  std::unordered_map<DexClass*, Refs> m_sampled_refs;
+  // When given, refs are taken from (and added to) this cache.
+  class_refs::Cache* m_class_refs;
+
+  Refs gather_refs(DexClass* cls);
+  // Gathers the refs of many classes in parallel.
+  std::vector<Refs> gather_refs(const std::vector<DexClass*>& classes);
+  void sample(const Refs& refs);
+  void insert(DexClass* cls, const Refs& refs);
 
  public:
-  explicit CrossDexRefMinimizer(const CrossDexRefMinimizerConfig& config)
-      : m_config(config) {}
+  explicit CrossDexRefMinimizer(const CrossDexRefMinimizerConfig& config,
+                                class_refs::Cache* class_refs = nullptr)
+      : m_config(config), m_class_refs(class_refs) {}
   // Gather frequency counts; must be called for relevant classes before
   // inserting them
   void sample(DexClass* cls);
+  // Same as sampling each class in turn, but faster.
+  void sample(const std::vector<DexClass*>& classes);
   // Ignore a class reference when computing weights
   void ignore(DexClass* cls);
   void insert(DexClass* cls);
+  // Same as inserting each class in turn, but faster, in particular after
+  // sampling the same classes as a batch.
+  void insert(const std::vector<DexClass*>& classes);
   bool empty() const;
   DexClass* front() const;
   // "Worst" in the sense of having highest seed weight.
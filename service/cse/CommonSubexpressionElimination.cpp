@@ -903,59 +903,68 @@ const method_override_graph::Graph* SharedState::get_method_override_graph()
   return m_method_override_graph.get();
 }
 
-void SharedState::init_method_barriers(const Scope& scope) {
+void SharedState::init_method_barriers(const Scope& scope,
+                                       purity::AnalysisCache* purity_cache) {
   Timer t("init_method_barriers");
-  auto iterations = compute_locations_closure(
-      scope, m_method_override_graph.get(),
-      [&](DexMethod* method) -> boost::optional<LocationsAndDependencies> {
-        auto action = get_base_or_overriding_method_action(
-            method, &m_safe_method_defs,
-            /* ignore_methods_with_assumenosideeffects */ true);
-        if (action == MethodOverrideAction::UNKNOWN) {
-          return boost::none;
-        }
-        LocationsAndDependencies lads;
-        if (action == MethodOverrideAction::EXCLUDE) {
-          return lads;
+  auto init_func = [&](DexMethod* method)
+      -> boost::optional<LocationsAndDependencies> {
+    auto action = get_base_or_overriding_method_action(
+        method, &m_safe_method_defs,
+        /* ignore_methods_with_assumenosideeffects */ true);
+    if (action == MethodOverrideAction::UNKNOWN) {
+      return boost::none;
+    }
+    LocationsAndDependencies lads;
+    if (action == MethodOverrideAction::EXCLUDE) {
+      return lads;
+    }
+    auto code = method->get_code();
+    for (const auto& mie : cfg::InstructionIterable(code->cfg())) {
+      auto* insn = mie.insn;
+      if (may_be_barrier(insn, nullptr /* exact_virtual_scope */)) {
+        auto barrier = make_barrier(insn);
+        if (!opcode::is_an_invoke(barrier.opcode)) {
+          auto location = get_written_location(barrier);
+          if (location ==
+              CseLocation(CseSpecialLocations::GENERAL_MEMORY_BARRIER)) {
+            return boost::none;
+          }
+          lads.locations.insert(location);
+          continue;
         }
-        auto code = method->get_code();
-        for (const auto& mie : cfg::InstructionIterable(code->cfg())) {
-          auto* insn = mie.insn;
-          if (may_be_barrier(insn, nullptr /* exact_virtual_scope */)) {
-            auto barrier = make_barrier(insn);
-            if (!opcode::is_an_invoke(barrier.opcode)) {
-              auto location = get_written_location(barrier);
-              if (location ==
-                  CseLocation(CseSpecialLocations::GENERAL_MEMORY_BARRIER)) {
-                return boost::none;
-              }
-              lads.locations.insert(location);
-              continue;
-            }
 
-            if (barrier.opcode == OPCODE_INVOKE_SUPER) {
-              // TODO: Implement
-              return boost::none;
-            }
+        if (barrier.opcode == OPCODE_INVOKE_SUPER) {
+          // TODO: Implement
+          return boost::none;
+        }
 
-            if (!process_base_and_overriding_methods(
-                    m_method_override_graph.get(), barrier.method,
-                    &m_safe_method_defs,
-                    /* ignore_methods_with_assumenosideeffects */ true,
-                    [&](DexMethod* other_method) {
-                      if (other_method != method) {
-                        lads.dependencies.insert(other_method);
-                      }
-                      return true;
-                    })) {
-              return boost::none;
-            }
-          }
+        if (!process_base_and_overriding_methods(
+                m_method_override_graph.get(), barrier.method,
+                &m_safe_method_defs,
+                /* ignore_methods_with_assumenosideeffects */ true,
+                [&](DexMethod* other_method) {
+                  if (other_method != method) {
+                    lads.dependencies.insert(other_method);
+                  }
+                  return true;
+                })) {
+          return boost::none;
         }
+      }
+    }
 
-        return lads;
-      },
-      &m_method_written_locations);
+    return lads;
+  };
+  size_t iterations;
+  if (purity_cache) {
+    m_method_written_locations = purity_cache->get_method_written_locations(
+        scope, m_method_override_graph.get(), m_safe_methods, init_func,
+        &iterations);
+  } else {
+    iterations =
+        compute_locations_closure(scope, m_method_override_graph.get(),
+                                  init_func, &m_method_written_locations);
+  }
   m_stats.method_barriers_iterations = iterations;
   m_stats.method_barriers = m_method_written_locations.size();
 
@@ -985,13 +994,20 @@ void SharedState::init_finalizable_fields(const Scope& scope) {
   m_stats.finalizable_fields = m_finalizable_fields.size();
 }
 
-void SharedState::init_scope(const Scope& scope) {
+void SharedState::init_scope(const Scope& scope,
+                             purity::AnalysisCache* purity_cache) {
   always_assert(!m_method_override_graph);
-  m_method_override_graph = method_override_graph::build_graph(scope);
-
-  auto iterations = compute_conditionally_pure_methods(
-      scope, m_method_override_graph.get(), m_pure_methods,
-      &m_conditionally_pure_methods);
+  size_t iterations;
+  if (purity_cache) {
+    m_method_override_graph = purity_cache->get_method_override_graph(scope);
+    m_conditionally_pure_methods = purity_cache->get_conditionally_pure_methods(
+        scope, m_method_override_graph.get(), m_pure_methods, &iterations);
+  } else {
+    m_method_override_graph = method_override_graph::build_graph(scope);
+    iterations = compute_conditionally_pure_methods(
+        scope, m_method_override_graph.get(), m_pure_methods,
+        &m_conditionally_pure_methods);
+  }
   m_stats.conditionally_pure_methods = m_conditionally_pure_methods.size();
   m_stats.conditionally_pure_methods_iterations = iterations;
   for (const auto& p : m_conditionally_pure_methods) {
@@ -1005,7 +1021,7 @@ void SharedState::init_scope(const Scope& scope) {
     }
   }
 
-  init_method_barriers(scope);
+  init_method_barriers(scope, purity_cache);
   init_finalizable_fields(scope);
 }
 
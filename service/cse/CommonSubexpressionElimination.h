@@ -72,7 +72,10 @@ class SharedState {
   explicit SharedState(
       const std::unordered_set<DexMethodRef*>& pure_methods,
       const std::unordered_set<DexString*>& finalish_field_names);
-  void init_scope(const Scope&);
+  // When given, the method override graph, the conditionally pure methods and
+  // the method barriers are taken from (and added to) :purity_cache.
+  void init_scope(const Scope&,
+                  purity::AnalysisCache* purity_cache = nullptr);
   CseUnorderedLocationSet get_relevant_written_locations(
       const IRInstruction* insn,
       DexType* exact_virtual_scope,
@@ -94,7 +97,8 @@ class SharedState {
   }
 
  private:
-  void init_method_barriers(const Scope& scope);
+  void init_method_barriers(const Scope& scope,
+                            purity::AnalysisCache* purity_cache);
   void init_finalizable_fields(const Scope& scope);
   bool may_be_barrier(const IRInstruction* insn, DexType* exact_virtual_scope);
   bool is_invoke_safe(const IRInstruction* insn, DexType* exact_virtual_scope);
@@ -113,7 +117,7 @@ class SharedState {
       m_method_written_locations;
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       m_conditionally_pure_methods;
-  std::unique_ptr<const method_override_graph::Graph> m_method_override_graph;
+  std::shared_ptr<const method_override_graph::Graph> m_method_override_graph;
   SharedStateStats m_stats;
 };
 
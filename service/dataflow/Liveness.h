@@ -8,24 +8,28 @@
 #pragma once
 
 #include "BaseIRAnalyzer.h"
+#include "BitVectorSetAbstractDomain.h"
 #include "ControlFlow.h"
-#include "PatriciaTreeSetAbstractDomain.h"
 
-using LivenessDomain = sparta::PatriciaTreeSetAbstractDomain<reg_t>;
+// Registers are small, densely allocated integers, so bit vectors make for
+// much cheaper joins and comparisons than Patricia trees.
+using LivenessDomain = sparta::BitVectorSetAbstractDomain<reg_t>;
 
 class LivenessFixpointIterator final
-    : public ir_analyzer::BaseBackwardsIRAnalyzer<LivenessDomain> {
+    : public ir_analyzer::StaticBackwardsIRAnalyzer<LivenessFixpointIterator,
+                                                     LivenessDomain> {
  public:
   explicit LivenessFixpointIterator(const cfg::ControlFlowGraph& cfg)
-      : ir_analyzer::BaseBackwardsIRAnalyzer<LivenessDomain>(cfg) {}
+      : ir_analyzer::StaticBackwardsIRAnalyzer<LivenessFixpointIterator,
+                                               LivenessDomain>(cfg) {}
 
   void analyze_instruction(IRInstruction* insn,
-                           LivenessDomain* current_state) const override {
+                           LivenessDomain* current_state) const {
     if (insn->has_dest()) {
       current_state->remove(insn->dest());
     }
-    for (size_t i = 0; i < insn->srcs_size(); ++i) {
-      current_state->add(insn->src(i));
+    for (auto src : insn->srcs()) {
+      current_state->add(src);
     }
   }
 
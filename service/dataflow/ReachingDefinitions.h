@@ -21,13 +21,14 @@ using Domain = sparta::PatriciaTreeSetAbstractDomain<IRInstruction*>;
 
 using Environment = sparta::PatriciaTreeMapAbstractEnvironment<reg_t, Domain>;
 
-class FixpointIterator final : public ir_analyzer::BaseIRAnalyzer<Environment> {
+class FixpointIterator final
+    : public ir_analyzer::StaticIRAnalyzer<FixpointIterator, Environment> {
  public:
   explicit FixpointIterator(const cfg::ControlFlowGraph& cfg)
-      : ir_analyzer::BaseIRAnalyzer<Environment>(cfg) {}
+      : ir_analyzer::StaticIRAnalyzer<FixpointIterator, Environment>(cfg) {}
 
   void analyze_instruction(const IRInstruction* insn,
-                           Environment* current_state) const override {
+                           Environment* current_state) const {
     if (insn->has_dest()) {
       current_state->set(insn->dest(),
                          Domain(const_cast<IRInstruction*>(insn)));
@@ -36,13 +37,15 @@ class FixpointIterator final : public ir_analyzer::BaseIRAnalyzer<Environment> {
 };
 
 class MoveAwareFixpointIterator final
-    : public ir_analyzer::BaseIRAnalyzer<Environment> {
+    : public ir_analyzer::StaticIRAnalyzer<MoveAwareFixpointIterator,
+                                           Environment> {
  public:
   explicit MoveAwareFixpointIterator(const cfg::ControlFlowGraph& cfg)
-      : ir_analyzer::BaseIRAnalyzer<Environment>(cfg) {}
+      : ir_analyzer::StaticIRAnalyzer<MoveAwareFixpointIterator,
+                                      Environment>(cfg) {}
 
   void analyze_instruction(const IRInstruction* insn,
-                           Environment* current_state) const override {
+                           Environment* current_state) const {
     if (opcode::is_a_move(insn->opcode())) {
       current_state->set(insn->dest(), current_state->get(insn->src(0)));
     } else if (opcode::is_move_result_any(insn->opcode())) {
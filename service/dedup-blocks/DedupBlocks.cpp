@@ -46,6 +46,7 @@
  */
 
 #include "DedupBlocks.h"
+#include "ConcurrentContainers.h"
 #include "DedupBlockValueNumbering.h"
 
 #include "DexPosition.h"
@@ -56,6 +57,7 @@
 #include "StlUtil.h"
 #include "Trace.h"
 #include "TypeInference.h"
+#include "WorkQueue.h"
 #include <boost/functional/hash.hpp>
 
 namespace {
@@ -991,4 +993,59 @@ Stats& Stats::operator+=(const Stats& that) {
   return *this;
 }
 
+DuplicateBlocks find_duplicate_blocks_across_methods(
+    const std::vector<DexMethod*>& methods, size_t min_insns) {
+  using BlockValue = DedupBlkValueNumbering::BlockValue;
+  ConcurrentMap<BlockValue, std::vector<BlockLocation>,
+                DedupBlkValueNumbering::BlockValueHasher>
+      buckets;
+  workqueue_run<DexMethod*>(
+      [&](DexMethod* method) {
+        auto& cfg = method->get_code()->cfg();
+        LivenessFixpointIterator liveness_fixpoint_iter(cfg);
+        liveness_fixpoint_iter.run({});
+        for (auto block : cfg.blocks()) {
+          if (block->num_opcodes() < min_insns) {
+            continue;
+          }
+          // Value numbers are handed out in order of first use, so they only
+          // agree between methods if each block is numbered on its own.
+          DedupBlkValueNumbering::BlockValues block_values(
+              liveness_fixpoint_iter);
+          buckets.update(*block_values.get_block_value(block),
+                         [&](const BlockValue&,
+                             std::vector<BlockLocation>& locations,
+                             bool /* exists */) {
+                           locations.push_back({method, block});
+                         });
+        }
+      },
+      methods);
+
+  auto less = [](const BlockLocation& a, const BlockLocation& b) {
+    if (a.method != b.method) {
+      return compare_dexmethods(a.method, b.method);
+    }
+    return a.block->id() < b.block->id();
+  };
+  DuplicateBlocks res;
+  for (auto& p : buckets) {
+    auto& locations = p.second;
+    if (locations.size() < 2) {
+      continue;
+    }
+    bool across_methods = std::any_of(
+        locations.begin(), locations.end(),
+        [&](auto& loc) { return loc.method != locations.front().method; });
+    if (!across_methods) {
+      continue;
+    }
+    std::sort(locations.begin(), locations.end(), less);
+    res.push_back(std::move(locations));
+  }
+  std::sort(res.begin(), res.end(),
+            [&](auto& a, auto& b) { return less(a.front(), b.front()); });
+  return res;
+}
+
 } // namespace dedup_blocks_impl
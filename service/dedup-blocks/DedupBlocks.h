@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include "ControlFlow.h"
 #include "DexClass.h"
 
 namespace dedup_blocks_impl {
@@ -46,4 +47,22 @@ class DedupBlocks {
   Stats m_stats;
 };
 
+struct BlockLocation {
+  DexMethod* method;
+  cfg::Block* block;
+};
+
+// Blocks of different methods with the same value, i.e. the same operations
+// on the same live-in and live-out registers, up to the naming of the
+// registers that are internal to the blocks.
+using DuplicateBlocks = std::vector<std::vector<BlockLocation>>;
+
+// Finds, in parallel, the blocks of at least `min_insns` instructions whose
+// values recur in more than one of the given methods. Blocks can't be merged
+// across methods, but such groups are ready-made candidates for outlining.
+// The methods must have editable CFGs with exit blocks. The result is sorted
+// deterministically.
+DuplicateBlocks find_duplicate_blocks_across_methods(
+    const std::vector<DexMethod*>& methods, size_t min_insns);
+
 } // namespace dedup_blocks_impl
@@ -7,6 +7,8 @@
 
 #include "LocalPointersAnalysis.h"
 
+#include <boost/functional/hash.hpp>
+
 #include "DexUtil.h"
 #include "PatriciaTreeSet.h"
 #include "Resolver.h"
@@ -381,12 +383,71 @@ void FixpointIteratorMapDeleter::operator()(FixpointIteratorMap* map) {
   wq.run_all();
 }
 
+static size_t hash_summary(const EscapeSummary& summary) {
+  std::vector<uint16_t> escaping_parameters(summary.escaping_parameters.begin(),
+                                            summary.escaping_parameters.end());
+  std::sort(escaping_parameters.begin(), escaping_parameters.end());
+  size_t seed = boost::hash_range(escaping_parameters.begin(),
+                                  escaping_parameters.end());
+  const auto& returned_parameters = summary.returned_parameters;
+  boost::hash_combine(seed, static_cast<int>(returned_parameters.kind()));
+  if (returned_parameters.is_value()) {
+    // The elements of a Patricia tree set are iterated in a canonical order.
+    for (auto idx : returned_parameters.elements()) {
+      boost::hash_combine(seed, idx);
+    }
+  }
+  return seed;
+}
+
+uint64_t summary_cache_key(const cfg::ControlFlowGraph& cfg,
+                           const InvokeToSummaryMap& invoke_to_summary_map) {
+  size_t seed = 0;
+  for (const auto& mie : InstructionIterable(cfg)) {
+    auto insn = mie.insn;
+    boost::hash_combine(seed, insn->hash());
+    if (opcode::is_an_invoke(insn->opcode())) {
+      auto it = invoke_to_summary_map.find(insn);
+      // Distinguish the invokes without a summary, which may escape all their
+      // arguments, from those with an empty one.
+      boost::hash_combine(seed, it != invoke_to_summary_map.end());
+      if (it != invoke_to_summary_map.end()) {
+        boost::hash_combine(seed, hash_summary(it->second));
+      }
+    }
+  }
+  return seed;
+}
+
+boost::optional<EscapeSummary> SummaryCache::get(const DexMethodRef* method,
+                                                 uint64_t key) const {
+  auto it = m_entries.find(method);
+  if (it == m_entries.end() || it->second.first != key) {
+    ++m_misses;
+    return boost::none;
+  }
+  ++m_hits;
+  return it->second.second;
+}
+
+void SummaryCache::put(const DexMethodRef* method,
+                       uint64_t key,
+                       EscapeSummary summary) {
+  m_entries.update(method,
+                   [&](const DexMethodRef*,
+                       std::pair<uint64_t, EscapeSummary>& entry,
+                       bool /* exists */) {
+                     entry = std::make_pair(key, std::move(summary));
+                   });
+}
+
 static void analyze_method_recursive(
     const DexMethod* method,
     const call_graph::Graph& call_graph,
     sparta::PatriciaTreeSet<const DexMethodRef*> visiting,
     FixpointIteratorMap* fp_iter_map,
-    SummaryCMap* summary_map) {
+    SummaryCMap* summary_map,
+    SummaryCache* cache) {
   if (!method || summary_map->count(method) != 0 || visiting.contains(method) ||
       method->get_code() == nullptr) {
     return;
@@ -399,7 +460,7 @@ static void analyze_method_recursive(
     for (const auto& edge : callee_edges) {
       auto* callee = edge->callee()->method();
       analyze_method_recursive(callee, call_graph, visiting, fp_iter_map,
-                               summary_map);
+                               summary_map, cache);
       if (summary_map->count(callee) != 0) {
         invoke_to_summary_map.emplace(edge->invoke_iterator()->insn,
                                       summary_map->at(callee));
@@ -409,6 +470,17 @@ static void analyze_method_recursive(
 
   auto* code = method->get_code();
   auto& cfg = code->cfg();
+  uint64_t key{0};
+  if (cache != nullptr) {
+    key = summary_cache_key(cfg, invoke_to_summary_map);
+    auto cached = cache->get(method, key);
+    if (cached) {
+      summary_map->update(method, [&](auto, EscapeSummary& v, bool) {
+        v = std::move(*cached);
+      });
+      return;
+    }
+  }
   auto fp_iter = new FixpointIterator(cfg, std::move(invoke_to_summary_map));
   fp_iter->run(Environment());
 
@@ -423,13 +495,17 @@ static void analyze_method_recursive(
                                });
     summary_map->update(method, [&](auto, EscapeSummary& v, bool) {
       v = get_escape_summary(*fp_iter, *code);
+      if (cache != nullptr) {
+        cache->put(method, key, v);
+      }
     });
   }
 }
 
 FixpointIteratorMapPtr analyze_scope(const Scope& scope,
                                      const call_graph::Graph& call_graph,
-                                     SummaryCMap* summary_map_ptr) {
+                                     SummaryCMap* summary_map_ptr,
+                                     SummaryCache* cache) {
   FixpointIteratorMapPtr fp_iter_map(new FixpointIteratorMap());
   SummaryCMap summary_map;
   if (summary_map_ptr == nullptr) {
@@ -441,7 +517,7 @@ FixpointIteratorMapPtr analyze_scope(const Scope& scope,
   walk::parallel::code(scope, [&](const DexMethod* method, IRCode& code) {
     sparta::PatriciaTreeSet<const DexMethodRef*> visiting;
     analyze_method_recursive(method, call_graph, visiting, fp_iter_map.get(),
-                             summary_map_ptr);
+                             summary_map_ptr, cache);
   });
   return fp_iter_map;
 }
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <boost/optional.hpp>
 #include <ostream>
 #include <utility>
 
@@ -31,6 +33,11 @@
  * Note that we do not model instance fields or array elements, so any values
  * written to them will be treated as escaping, even if the containing object
  * does not escape the method.
+ *
+ * The store is sparse in the allocation sites: it only records the pointers
+ * created by allocations, invokes (see may_alloc()) and parameter loads that
+ * may have escaped. The pointers created by any other instruction are always
+ * escaping, so they are never added to it.
  */
 
 namespace local_pointers {
@@ -305,16 +312,58 @@ using SummaryMap = std::unordered_map<const DexMethodRef*, EscapeSummary>;
 
 using SummaryCMap = ConcurrentMap<const DexMethodRef*, EscapeSummary>;
 
+/*
+ * The escape summary of a method only depends on its code and on the
+ * summaries of the methods it invokes. This returns a hash of both, which
+ * identifies the summary computed by a FixpointIterator over `cfg` using
+ * `invoke_to_summary_map`.
+ */
+uint64_t summary_cache_key(const cfg::ControlFlowGraph& cfg,
+                           const InvokeToSummaryMap& invoke_to_summary_map);
+
+/*
+ * A thread-safe cache of escape summaries, keyed by summary_cache_key(). It
+ * is meant to outlive a single call to analyze_scope(), e.g. by being a
+ * member of a pass that runs several times, so that the methods which did not
+ * change in between, and whose callees did not change either, don't have to
+ * be analyzed again.
+ */
+class SummaryCache {
+ public:
+  // Returns the summary of `method` if it was stored under `key`.
+  boost::optional<EscapeSummary> get(const DexMethodRef* method,
+                                     uint64_t key) const;
+
+  void put(const DexMethodRef* method, uint64_t key, EscapeSummary summary);
+
+  size_t hits() const { return m_hits; }
+
+  size_t misses() const { return m_misses; }
+
+ private:
+  ConcurrentMap<const DexMethodRef*, std::pair<uint64_t, EscapeSummary>>
+      m_entries;
+  mutable std::atomic<size_t> m_hits{0};
+  mutable std::atomic<size_t> m_misses{0};
+};
+
 /*
  * Analyze all methods in scope, making sure to analyze the callees before
  * their callers.
  *
  * If a non-null SummaryCMap pointer is passed in, it will get populated
  * with the escape summaries of the methods in scope.
+ *
+ * If a non-null SummaryCache pointer is passed in, the summaries it holds are
+ * reused, and the newly computed ones are added to it. The methods whose
+ * summary was found in the cache are not analyzed again, so they have no
+ * FixpointIterator in the returned map; clients that need the state at every
+ * instruction of every method should not pass a cache.
  */
 FixpointIteratorMapPtr analyze_scope(const Scope&,
                                      const call_graph::Graph&,
-                                     SummaryCMap* = nullptr);
+                                     SummaryCMap* = nullptr,
+                                     SummaryCache* = nullptr);
 
 /*
  * Join over all possible returned and thrown values.
@@ -11,6 +11,7 @@
 #include "ConcurrentContainers.h"
 #include "ConstantAbstractDomain.h"
 #include "ControlFlow.h"
+#include "DenseSideTable.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "Lazy.h"
@@ -20,6 +21,7 @@
 #include "ScopedCFG.h"
 #include "TypeInference.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -351,6 +353,80 @@ class WritesAnalyzer {
   }
 };
 
+// The field stats that a worker accumulated, indexed by the dense field IDs,
+// so that counting needs neither locks nor hashing.
+struct WorkerFieldStats {
+  DenseSideTable<DexFieldRef, field_op_tracker::FieldStats> stats;
+  // The fields with any non-zero stats, in the order they were first seen.
+  std::vector<DexField*> fields;
+
+  field_op_tracker::FieldStats& operator[](DexField* field) {
+    auto& fs = stats[field];
+    if (fs.reads == 0 && fs.writes == 0 && fs.init_writes == 0) {
+      fields.push_back(field);
+    }
+    return fs;
+  }
+};
+
+void analyze_method(DexMethod* method, WorkerFieldStats& field_stats) {
+  if (method::is_init(method)) {
+    // compute init_writes by checking receiver of each iput
+    cfg::ScopedCFG cfg(method->get_code());
+    reaching_defs::MoveAwareFixpointIterator reaching_definitions(*cfg);
+    reaching_definitions.run(reaching_defs::Environment());
+    auto first_load_param = cfg->get_param_instructions().begin()->insn;
+    always_assert(first_load_param->opcode() == IOPCODE_LOAD_PARAM_OBJECT);
+    for (cfg::Block* block : cfg->blocks()) {
+      auto env = reaching_definitions.get_entry_state_at(block);
+      auto insns = InstructionIterable(block);
+      for (auto it = insns.begin(); it != insns.end();
+           reaching_definitions.analyze_instruction(it++->insn, &env)) {
+        IRInstruction* insn = it->insn;
+        if (!opcode::is_an_iput(insn->opcode())) {
+          continue;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr || field->get_class() != method->get_class()) {
+          continue;
+        }
+        // We only consider for init_writes those iputs where the obj is the
+        // receiver. I cannot see where the JVM spec this would be enforced,
+        // we'll be conservative to be safe.
+        auto obj_defs = env.get(insn->src(1));
+        if (!obj_defs.is_top() && !obj_defs.is_bottom() &&
+            obj_defs.elements().size() == 1 &&
+            *obj_defs.elements().begin() == first_load_param) {
+          ++field_stats[field].init_writes;
+        }
+      }
+    }
+  }
+  bool is_clinit = method::is_clinit(method);
+  editable_cfg_adapter::iterate(
+      method->get_code(), [&](const MethodItemEntry& mie) {
+        auto insn = mie.insn;
+        auto op = insn->opcode();
+        if (!insn->has_field()) {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+        auto field = resolve_field(insn->get_field());
+        if (field == nullptr) {
+          return editable_cfg_adapter::LOOP_CONTINUE;
+        }
+        if (opcode::is_an_sget(op) || opcode::is_an_iget(op)) {
+          ++field_stats[field].reads;
+        } else if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
+          ++field_stats[field].writes;
+          if (is_clinit && is_static(field) &&
+              field->get_class() == method->get_class()) {
+            ++field_stats[field].init_writes;
+          }
+        }
+        return editable_cfg_adapter::LOOP_CONTINUE;
+      });
+}
+
 } // namespace
 
 namespace field_op_tracker {
@@ -400,76 +476,38 @@ FieldWrites analyze_writes(const Scope& scope,
 };
 
 FieldStatsMap analyze(const Scope& scope) {
-  ConcurrentMap<DexField*, FieldStats> concurrent_field_stats;
+  std::vector<DexMethod*> methods;
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    methods.push_back(method);
+  });
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<std::unique_ptr<WorkerFieldStats>> worker_stats(num_threads);
   // Gather the read/write counts from instructions.
-  walk::parallel::methods(scope, [&](DexMethod* method) {
-    if (!method->get_code()) {
-      return;
-    }
-    std::unordered_map<DexField*, FieldStats> field_stats;
-    if (method::is_init(method)) {
-      // compute init_writes by checking receiver of each iput
-      cfg::ScopedCFG cfg(method->get_code());
-      reaching_defs::MoveAwareFixpointIterator reaching_definitions(*cfg);
-      reaching_definitions.run(reaching_defs::Environment());
-      auto first_load_param = cfg->get_param_instructions().begin()->insn;
-      always_assert(first_load_param->opcode() == IOPCODE_LOAD_PARAM_OBJECT);
-      for (cfg::Block* block : cfg->blocks()) {
-        auto env = reaching_definitions.get_entry_state_at(block);
-        auto insns = InstructionIterable(block);
-        for (auto it = insns.begin(); it != insns.end();
-             reaching_definitions.analyze_instruction(it++->insn, &env)) {
-          IRInstruction* insn = it->insn;
-          if (!opcode::is_an_iput(insn->opcode())) {
-            continue;
-          }
-          auto field = resolve_field(insn->get_field());
-          if (field == nullptr || field->get_class() != method->get_class()) {
-            continue;
-          }
-          // We only consider for init_writes those iputs where the obj is the
-          // receiver. I cannot see where the JVM spec this would be enforced,
-          // we'll be conservative to be safe.
-          auto obj_defs = env.get(insn->src(1));
-          if (!obj_defs.is_top() && !obj_defs.is_bottom() &&
-              obj_defs.elements().size() == 1 &&
-              *obj_defs.elements().begin() == first_load_param) {
-            ++field_stats[field].init_writes;
-          }
+  workqueue_run<DexMethod*>(
+      [&](sparta::SpartaWorkerState<DexMethod*>* state, DexMethod* method) {
+        auto& field_stats = worker_stats[state->worker_id()];
+        if (!field_stats) {
+          field_stats = std::make_unique<WorkerFieldStats>();
         }
-      }
+        analyze_method(method, *field_stats);
+      },
+      methods, num_threads);
+
+  // Merge the tables of the workers, once.
+  WorkerFieldStats merged;
+  for (const auto& ws : worker_stats) {
+    if (!ws) {
+      continue;
     }
-    bool is_clinit = method::is_clinit(method);
-    editable_cfg_adapter::iterate(
-        method->get_code(), [&](const MethodItemEntry& mie) {
-          auto insn = mie.insn;
-          auto op = insn->opcode();
-          if (!insn->has_field()) {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-          auto field = resolve_field(insn->get_field());
-          if (field == nullptr) {
-            return editable_cfg_adapter::LOOP_CONTINUE;
-          }
-          if (opcode::is_an_sget(op) || opcode::is_an_iget(op)) {
-            ++field_stats[field].reads;
-          } else if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
-            ++field_stats[field].writes;
-            if (is_clinit && is_static(field) &&
-                field->get_class() == method->get_class()) {
-              ++field_stats[field].init_writes;
-            }
-          }
-          return editable_cfg_adapter::LOOP_CONTINUE;
-        });
-    for (auto& p : field_stats) {
-      concurrent_field_stats.update(
-          p.first, [&](DexField*, FieldStats& fs, bool) { fs += p.second; });
+    for (auto* field : ws->fields) {
+      merged[field] += ws->stats.at(field);
     }
-  });
-
-  FieldStatsMap field_stats(concurrent_field_stats.begin(),
-                            concurrent_field_stats.end());
+  }
+  FieldStatsMap field_stats;
+  field_stats.reserve(merged.fields.size());
+  for (auto* field : merged.fields) {
+    field_stats.emplace(field, merged.stats.at(field));
+  }
 
   // Gather field reads from annotations.
   walk::annotations(scope, [&](DexAnnotation* anno) {
@@ -6,7 +6,11 @@
  */
 
 #include "KotlinInstanceRewriter.h"
+
+#include <boost/optional.hpp>
+
 #include "CFGMutation.h"
+#include "IRCode.h"
 #include "PassManager.h"
 #include "ScopedCFG.h"
 #include "Show.h"
@@ -22,6 +26,55 @@ DexField* has_instance_field(DexClass* cls, DexString* instance) {
   return nullptr;
 }
 
+// Returns the invocation of \p init that follows \p it, a new-instance and its
+// move-result-pseudo, in \p block, when the new object isn't used before it.
+boost::optional<ir_list::InstructionIterator> find_init_in_block(
+    cfg::Block* block,
+    const ir_list::InstructionIterator& it,
+    const DexMethodRef* init) {
+  auto ii = ir_list::InstructionIterable(block);
+  auto move_result_it = std::next(it);
+  if (move_result_it == ii.end() ||
+      move_result_it->insn->opcode() != IOPCODE_MOVE_RESULT_PSEUDO_OBJECT) {
+    return boost::none;
+  }
+  auto reg = move_result_it->insn->dest();
+  for (auto insn_it = std::next(move_result_it); insn_it != ii.end();
+       ++insn_it) {
+    auto insn = insn_it->insn;
+    if (insn->opcode() == OPCODE_INVOKE_DIRECT && insn->get_method() == init &&
+        insn->src(0) == reg) {
+      return insn_it;
+    }
+    for (auto src : insn->srcs()) {
+      if (src == reg) {
+        return boost::none;
+      }
+    }
+    if (insn->has_dest() &&
+        (insn->dest() == reg ||
+         (insn->dest_is_wide() && insn->dest() + 1 == reg))) {
+      return boost::none;
+    }
+  }
+  return boost::none;
+}
+
+// The instructions that initialize \p field with a new instance of its class.
+std::vector<IRInstruction*> make_instance_init(DexFieldRef* field,
+                                               DexMethodRef* init,
+                                               reg_t reg) {
+  auto* new_insn = new IRInstruction(OPCODE_NEW_INSTANCE);
+  new_insn->set_type(field->get_class());
+  auto* move_result = new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
+  move_result->set_dest(reg);
+  auto* init_insn = new IRInstruction(OPCODE_INVOKE_DIRECT);
+  init_insn->set_method(init)->set_srcs_size(1)->set_src(0, reg);
+  auto* sput = new IRInstruction(OPCODE_SPUT_OBJECT);
+  sput->set_field(field)->set_src(0, reg);
+  return {new_insn, move_result, init_insn, sput};
+}
+
 } // namespace
 
 KotlinInstanceRewriter::Stats KotlinInstanceRewriter::collect_instance_usage(
@@ -199,6 +252,142 @@ KotlinInstanceRewriter::Stats KotlinInstanceRewriter::transform(
   return stats;
 }
 
+KotlinInstanceRewriter::Stats KotlinInstanceRewriter::share_lambda_instances(
+    const Scope& scope,
+    std::function<bool(DexClass*)> do_not_consider_type,
+    const std::unordered_set<const DexType*>& ignored_types,
+    std::map<const DexType*, size_t, dextypes_comparator>*
+        removed_allocations) {
+  KotlinInstanceRewriter::Stats stats{};
+  auto lambda_type = DexType::get_type("Lkotlin/jvm/internal/Lambda;");
+  if (!lambda_type) {
+    return stats;
+  }
+  auto init_str = DexString::make_string("<init>");
+  auto void_proto =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+
+  // The Lambdas whose instances can be shared, and their constructors.
+  ConcurrentMap<const DexType*, DexMethodRef*> lambda_inits;
+  walk::parallel::classes(scope, [&](DexClass* cls) {
+    if (cls->get_super_class() != lambda_type || !can_rename(cls) ||
+        !can_delete(cls) || ignored_types.count(cls->get_type())) {
+      return;
+    }
+    auto instance = has_instance_field(cls, m_instance);
+    if (instance && !is_final(instance)) {
+      return;
+    }
+    if (do_not_consider_type(cls)) {
+      return;
+    }
+    auto init = DexMethod::get_method(cls->get_type(), init_str, void_proto);
+    if (!init) {
+      return;
+    }
+    lambda_inits.emplace(cls->get_type(), init);
+  });
+  if (lambda_inits.size() == 0) {
+    return stats;
+  }
+
+  // Replace
+  //   new-instance v0, LFoo$bar$1;
+  //   invoke-direct {v0}, LFoo$bar$1;.<init>:()V
+  // with
+  //   sget-object v0, LFoo$bar$1;.INSTANCE:LFoo$bar$1;
+  ConcurrentMap<const DexType*, size_t> allocations;
+  walk::parallel::methods(scope, [&](DexMethod* method) {
+    auto code = method->get_code();
+    if (!code || (method::is_clinit(method) &&
+                  lambda_inits.count(method->get_class()))) {
+      return;
+    }
+    bool has_allocation{false};
+    for (const auto& mie : InstructionIterable(code)) {
+      if (mie.insn->opcode() == OPCODE_NEW_INSTANCE &&
+          lambda_inits.count(mie.insn->get_type())) {
+        has_allocation = true;
+        break;
+      }
+    }
+    if (!has_allocation) {
+      return;
+    }
+
+    cfg::ScopedCFG cfg(code);
+    cfg::CFGMutation m(*cfg);
+    for (auto* block : cfg->blocks()) {
+      auto ii = ir_list::InstructionIterable(block);
+      for (auto it = ii.begin(); it != ii.end(); ++it) {
+        auto insn = it->insn;
+        if (insn->opcode() != OPCODE_NEW_INSTANCE) {
+          continue;
+        }
+        auto type = insn->get_type();
+        auto init = lambda_inits.get(type, nullptr);
+        if (!init) {
+          continue;
+        }
+        auto init_it = find_init_in_block(block, it, init);
+        if (!init_it) {
+          continue;
+        }
+        auto move_result_it = std::next(it);
+        auto* sget = new IRInstruction(OPCODE_SGET_OBJECT);
+        sget->set_field(DexField::make_field(type, m_instance, type));
+        auto* move_result =
+            new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT);
+        move_result->set_dest(move_result_it->insn->dest());
+        m.replace(block->to_cfg_instruction_iterator(it),
+                  {sget, move_result});
+        m.remove(block->to_cfg_instruction_iterator(move_result_it));
+        m.remove(block->to_cfg_instruction_iterator(*init_it));
+        allocations.update(type, [](const DexType*, size_t& n, bool) { ++n; });
+      }
+    }
+    m.flush();
+  });
+
+  removed_allocations->insert(allocations.begin(), allocations.end());
+  for (const auto& p : *removed_allocations) {
+    auto type = const_cast<DexType*>(p.first);
+    stats.kotlin_lambda_allocations_removed += p.second;
+    auto* cls = type_class(type);
+    auto instance = has_instance_field(cls, m_instance);
+    if (instance) {
+      set_public(instance);
+      continue;
+    }
+    auto field = DexField::make_field(type, m_instance, type)
+                     ->make_concrete(ACC_PUBLIC | ACC_STATIC | ACC_FINAL);
+    cls->add_field(field);
+    field->set_deobfuscated_name(show_deobfuscated(field));
+    auto init = lambda_inits.get(type, nullptr);
+    auto clinit = cls->get_clinit();
+    if (clinit) {
+      cfg::ScopedCFG cfg(clinit->get_code());
+      cfg->entry_block()->push_front(
+          make_instance_init(field, init, cfg->allocate_temp()));
+    } else {
+      clinit = DexMethod::make_method(type, DexString::make_string("<clinit>"),
+                                      void_proto)
+                   ->make_concrete(ACC_STATIC | ACC_CONSTRUCTOR, false);
+      auto code = std::make_unique<IRCode>();
+      for (auto* insn : make_instance_init(field, init, 0)) {
+        code->push_back(insn);
+      }
+      code->push_back(new IRInstruction(OPCODE_RETURN_VOID));
+      code->set_registers_size(1);
+      clinit->set_code(std::move(code));
+      cls->add_method(clinit);
+      clinit->set_deobfuscated_name(show_deobfuscated(clinit));
+    }
+    stats.kotlin_instance_fields_created++;
+  }
+  return stats;
+}
+
 void KotlinInstanceRewriter::Stats::report(PassManager& mgr) const {
   mgr.incr_metric("kotlin_new_instance", kotlin_new_instance);
   mgr.incr_metric("kotlin_new_instance_which_escapes",
@@ -208,6 +397,10 @@ void KotlinInstanceRewriter::Stats::report(PassManager& mgr) const {
   mgr.incr_metric("kotlin_instance_fields_removed",
                   kotlin_instance_fields_removed);
   mgr.incr_metric("kotlin_new_inserted", kotlin_new_inserted);
+  mgr.incr_metric("kotlin_lambda_allocations_removed",
+                  kotlin_lambda_allocations_removed);
+  mgr.incr_metric("kotlin_instance_fields_created",
+                  kotlin_instance_fields_created);
 
   TRACE(KOTLIN_INSTANCE, 1, "kotlin_new_instance = %zu", kotlin_new_instance);
   TRACE(KOTLIN_INSTANCE, 1, "kotlin_new_instance_which_escapes = %zu",
@@ -217,4 +410,8 @@ void KotlinInstanceRewriter::Stats::report(PassManager& mgr) const {
   TRACE(KOTLIN_INSTANCE, 1, "kotlin_instance_fields_removed = %zu",
         kotlin_instance_fields_removed);
   TRACE(KOTLIN_INSTANCE, 1, "kotlin_new_inserted = %zu", kotlin_new_inserted);
+  TRACE(KOTLIN_INSTANCE, 1, "kotlin_lambda_allocations_removed = %zu",
+        kotlin_lambda_allocations_removed);
+  TRACE(KOTLIN_INSTANCE, 1, "kotlin_instance_fields_created = %zu",
+        kotlin_instance_fields_created);
 }
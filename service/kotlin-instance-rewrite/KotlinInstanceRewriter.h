@@ -18,6 +18,8 @@ class KotlinInstanceRewriter {
     size_t kotlin_instances_with_single_use{0};
     size_t kotlin_instance_fields_removed{0};
     size_t kotlin_new_inserted{0};
+    size_t kotlin_lambda_allocations_removed{0};
+    size_t kotlin_instance_fields_created{0};
     Stats& operator+=(const Stats& that) {
       kotlin_new_instance += that.kotlin_new_instance;
       kotlin_new_instance_which_escapes +=
@@ -25,6 +27,9 @@ class KotlinInstanceRewriter {
       kotlin_instances_with_single_use += that.kotlin_instances_with_single_use;
       kotlin_instance_fields_removed += that.kotlin_instance_fields_removed;
       kotlin_new_inserted += that.kotlin_new_inserted;
+      kotlin_lambda_allocations_removed +=
+          that.kotlin_lambda_allocations_removed;
+      kotlin_instance_fields_created += that.kotlin_instance_fields_created;
       return *this;
     }
     // Updates metrics tracked by \p mgr corresponding to these statistics.
@@ -63,6 +68,18 @@ class KotlinInstanceRewriter {
                     std::set<std::pair<IRInstruction*, DexMethod*>>>&
           concurrent_instance_map);
 
+  // Replace the allocations of the Kotlin noncapturing Lambdas, outside of
+  // their <clinit>, with reads of their INSTANCE field, which gets created
+  // (and initialized in <clinit>) for the Lambdas that don't have one. The
+  // types in \p ignored_types are left alone. \p removed_allocations gets the
+  // number of allocations that were replaced, per Lambda.
+  Stats share_lambda_instances(
+      const Scope& scope,
+      std::function<bool(DexClass*)> do_not_consider_type,
+      const std::unordered_set<const DexType*>& ignored_types,
+      std::map<const DexType*, size_t, dextypes_comparator>*
+          removed_allocations);
+
  private:
   const size_t max_no_of_instance = 1;
   DexString* m_instance = nullptr;
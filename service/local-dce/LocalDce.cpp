@@ -23,6 +23,7 @@
 #include "NullPointerExceptionUtil.h"
 #include "Purity.h"
 #include "ReachingDefinitions.h"
+#include "RedexContext.h"
 #include "Resolver.h"
 #include "ScopedCFG.h"
 #include "Show.h"
@@ -257,9 +258,22 @@ bool LocalDce::assumenosideeffects(DexMethodRef* ref, DexMethod* meth) {
   if (::assumenosideeffects(meth)) {
     return true;
   }
+  if (m_pure_method_ids != nullptr) {
+    auto id = ref->get_id();
+    return id < m_pure_method_ids->size() && m_pure_method_ids->test(id);
+  }
   return m_pure_methods.find(ref) != m_pure_methods.end();
 }
 
+boost::dynamic_bitset<> LocalDce::make_pure_method_ids(
+    const std::unordered_set<DexMethodRef*>& pure_methods) {
+  boost::dynamic_bitset<> pure_method_ids(g_redex->num_method_ids());
+  for (auto* ref : pure_methods) {
+    pure_method_ids.set(ref->get_id());
+  }
+  return pure_method_ids;
+}
+
 void LocalDce::normalize_new_instances(cfg::ControlFlowGraph& cfg) {
   // TODO: This normalization optimization doesn't really belong to local-dce,
   // but it combines nicely as local-dce will clean-up redundant new-instance
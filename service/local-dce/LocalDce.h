@@ -66,14 +66,26 @@ class LocalDce {
    *   potentially-excepting instructions can jump to a catch.)
    */
 
+  /*
+   * When given, `pure_method_ids` must be make_pure_method_ids(pure_methods),
+   * and is used instead of `pure_methods`. Checking an invoke is then a bit
+   * test instead of a hash lookup, for the drivers that run LocalDce over many
+   * methods with the same pure methods.
+   */
   explicit LocalDce(
       const std::unordered_set<DexMethodRef*>& pure_methods,
       const method_override_graph::Graph* method_override_graph = nullptr,
-      bool may_allocate_registers = false)
+      bool may_allocate_registers = false,
+      const boost::dynamic_bitset<>* pure_method_ids = nullptr)
       : m_pure_methods(pure_methods),
+        m_pure_method_ids(pure_method_ids),
         m_method_override_graph(method_override_graph),
         m_may_allocate_registers(may_allocate_registers) {}
 
+  // A bitmap of the pure methods, indexed by the dense IDs of the method refs.
+  static boost::dynamic_bitset<> make_pure_method_ids(
+      const std::unordered_set<DexMethodRef*>& pure_methods);
+
   const Stats& get_stats() const { return m_stats; }
 
   void dce(IRCode*);
@@ -88,6 +100,7 @@ class LocalDce {
 
  private:
   const std::unordered_set<DexMethodRef*>& m_pure_methods;
+  const boost::dynamic_bitset<>* m_pure_method_ids;
   const method_override_graph::Graph* m_method_override_graph;
   const bool m_may_allocate_registers;
   Stats m_stats;
@@ -140,18 +140,13 @@ LoopInfo::~LoopInfo() {
 
 template <typename T, typename Fn>
 void LoopInfo::init(T& cfg, Fn preheader_fn) {
-  sparta::WeakTopologicalOrdering<cfg::Block*> wto(
-      cfg.entry_block(), [&](const cfg::Block* block) {
-        std::vector<cfg::Block*> blocks;
-        for (auto edge : block->succs()) {
-          blocks.emplace_back(edge->target());
-        }
-        return blocks;
-      });
+  // Shared with the other users of the ordering of this CFG. Holding on to it
+  // keeps it alive while the preheaders are added.
+  auto wto = cfg.get_wto();
 
   // construct a level order traversal of a weak topological ordering
   std::vector<ComponentWrapper<cfg::Block*>> level_order;
-  construct_level_order_traversal<cfg::Block*>(level_order, wto);
+  construct_level_order_traversal<cfg::Block*>(level_order, *wto);
 
   // Mapping from all blocks that are loop headers and their respective Loop
   // object
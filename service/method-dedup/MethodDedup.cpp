@@ -7,11 +7,15 @@
 
 #include "MethodDedup.h"
 
+#include <boost/functional/hash.hpp>
+#include <numeric>
+
 #include "DexOpcode.h"
 #include "IRCode.h"
 #include "MethodReference.h"
 #include "Show.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -45,6 +49,38 @@ struct CodeHasher {
   }
 };
 
+// Unlike CodeHasher, which only has to spread the methods of a bucket, this
+// takes the order of the instructions into account, so that it tells apart
+// most methods that only differ in the order of the same instructions. Like
+// the equality, it ignores debug info and positions.
+uint64_t ordered_code_hash(const IRCode* code) {
+  size_t result = 0;
+  for (auto& mie : InstructionIterable(code)) {
+    boost::hash_combine(result, mie.insn->hash());
+  }
+  return result;
+}
+
+// What must be the same for methods to possibly be identical.
+using BucketKey = std::tuple<const DexProto*, size_t, uint64_t>;
+
+// Many callers group just a handful of methods, e.g. the virtual methods of
+// a merged class, which are not worth starting threads for.
+constexpr size_t MIN_PARALLEL_ITEMS = 64;
+
+template <typename Fn>
+void for_each_index(size_t n, const Fn& fn) {
+  if (n < MIN_PARALLEL_ITEMS) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+  std::vector<size_t> indices(n);
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(fn, indices);
+}
+
 using DuplicateMethods =
     std::unordered_map<CodeAsKey, MethodOrderedSet, CodeHasher>;
 
@@ -100,17 +136,50 @@ std::vector<MethodOrderedSet> group_similar_methods(
 
 std::vector<MethodOrderedSet> group_identical_methods(
     const std::vector<DexMethod*>& methods, bool dedup_throw_blocks) {
+  // Hashing is linear in the size of the code, so it is done in parallel.
+  // Then, only methods with the same proto, size and hash are compared, in
+  // parallel across such buckets.
+  std::vector<BucketKey> keys(methods.size());
+  for_each_index(methods.size(), [&](size_t i) {
+    auto method = methods[i];
+    auto code = method->get_code();
+    always_assert(code);
+    keys[i] = BucketKey(method->get_proto(), code->sum_opcode_sizes(),
+                        ordered_code_hash(code));
+  });
+
+  std::unordered_map<BucketKey, MethodOrderedSet, boost::hash<BucketKey>>
+      buckets_by_key;
+  for (size_t i = 0; i < methods.size(); i++) {
+    buckets_by_key[keys[i]].emplace(methods[i]);
+  }
+
   std::vector<MethodOrderedSet> result;
-  std::vector<MethodOrderedSet> same_protos = group_similar_methods(methods);
+  std::vector<const MethodOrderedSet*> buckets;
+  for (auto& p : buckets_by_key) {
+    if (p.second.size() == 1) {
+      result.push_back(std::move(p.second));
+    } else {
+      buckets.push_back(&p.second);
+    }
+  }
 
   // Find actual duplicates.
-  for (const auto& same_proto : same_protos) {
-    std::vector<MethodOrderedSet> duplicates =
-        get_duplicate_methods_simple(same_proto, dedup_throw_blocks);
-
-    result.insert(result.end(), duplicates.begin(), duplicates.end());
+  std::vector<std::vector<MethodOrderedSet>> duplicates(buckets.size());
+  for_each_index(buckets.size(), [&](size_t i) {
+    duplicates[i] =
+        get_duplicate_methods_simple(*buckets[i], dedup_throw_blocks);
+  });
+  for (auto& groups : duplicates) {
+    for (auto& group : groups) {
+      result.push_back(std::move(group));
+    }
   }
 
+  std::sort(result.begin(), result.end(),
+            [](const MethodOrderedSet& a, const MethodOrderedSet& b) {
+              return compare_dexmethods(*a.begin(), *b.begin());
+            });
   return result;
 }
 
@@ -57,58 +57,57 @@ size_t num_interactions(const InstructionIterator& inline_site,
   return 0;
 }
 
-boost::optional<float> get_source_blocks_factor(
+// The factors by which to scale the values of the callee's source blocks, one
+// per interaction, to normalize them to the value at the callsite. Empty if
+// no values need to change.
+std::vector<float> get_source_blocks_factors(
     const InstructionIterator& inline_site,
     const ControlFlowGraph& callee_cfg,
-    size_t idx) {
-  auto caller_block = inline_site.block();
-  float caller_val;
-  {
-    auto* sb = source_blocks::get_first_source_block(caller_block);
-    if (sb == nullptr) {
-      return boost::none;
-    }
-    auto val = sb->get_val(idx);
-    if (!val) {
-      return boost::none;
-    }
-    caller_val = *val;
-  }
-  if (caller_val == 0) {
-    return 0.0f;
+    size_t num) {
+  const auto* caller_sb =
+      source_blocks::get_first_source_block(inline_site.block());
+  if (caller_sb == nullptr) {
+    return {};
   }
-
   // Assume that integrity is guaranteed, so that val at entry is
   // dominating all blocks.
-  float callee_val;
-  {
-    auto sb = source_blocks::get_first_source_block(callee_cfg.entry_block());
-    if (sb == nullptr) {
-      return boost::none;
+  const auto* callee_sb =
+      source_blocks::get_first_source_block(callee_cfg.entry_block());
+
+  std::vector<float> factors(num, 1.0f);
+  bool changed = false;
+  for (size_t idx = 0; idx < num; ++idx) {
+    auto caller_val = caller_sb->get_val(idx);
+    if (!caller_val) {
+      continue;
     }
-    auto val = sb->get_val(idx);
-    if (!val) {
-      return boost::none;
+    if (*caller_val == 0) {
+      factors[idx] = 0.0f;
+      changed = true;
+      continue;
+    }
+    auto callee_val =
+        callee_sb == nullptr ? boost::none : callee_sb->get_val(idx);
+    if (!callee_val) {
+      continue;
     }
-    callee_val = *val;
+    // Expectation would be that callee_val >= caller_val. But tracking might
+    // not be complete.
+    factors[idx] = *callee_val == 0 ? 0.0f : *caller_val / *callee_val;
+    changed = true;
   }
-  if (callee_val == 0) {
-    return 0.0f;
+  if (!changed) {
+    return {};
   }
-
-  // Expectation would be that callee_val >= caller_val. But tracking might
-  // not be complete.
-
-  // This will normalize to the value at the callsite.
-  return caller_val / callee_val;
+  return factors;
 }
 
-void normalize_source_blocks(ControlFlowGraph& cfg, float factor, size_t idx) {
+void normalize_source_blocks(ControlFlowGraph& cfg,
+                             const std::vector<float>& factors) {
   for (auto* b : cfg.blocks()) {
     source_blocks::foreach_source_block(b, [&](auto* sb) {
-      if (sb->vals[idx]) {
-        sb->vals[idx]->val *= factor;
-      }
+      sb->scale_vals(factors.data(),
+                     std::min(factors.size(), sb->vals.size()));
     });
   }
 }
@@ -179,16 +178,17 @@ void CFGInliner::inline_cfg(
 
   {
     auto num = num_interactions(inline_site, callee_orig);
-    for (size_t i = 0; i < num; ++i) {
-      auto sb_factor = get_source_blocks_factor(inline_site, callee_orig, i);
-      if (sb_factor) {
-        normalize_source_blocks(callee, *sb_factor, i);
-      }
+    auto factors = get_source_blocks_factors(inline_site, callee_orig, num);
+    if (!factors.empty()) {
+      normalize_source_blocks(callee, factors);
     }
   }
 
   remove_ghost_exit_block(&callee);
   cleanup_callee_debug(&callee);
+  // Every inlined copy of the callee gets its own positions, so don't carry
+  // over the redundant ones.
+  callee.remove_redundant_positions();
 
   TRACE(CFG, 3, "caller %s", SHOW(*caller));
   TRACE(CFG, 3, "callee %s", SHOW(callee));
@@ -99,7 +99,8 @@ MultiMethodInliner::MultiMethodInliner(
         same_method_implementations,
     bool analyze_and_prune_inits,
     const std::unordered_set<DexMethodRef*>& configured_pure_methods,
-    const std::unordered_set<DexString*>& configured_finalish_field_names)
+    const std::unordered_set<DexString*>& configured_finalish_field_names,
+    purity::AnalysisCache* purity_cache)
     : m_concurrent_resolver(std::move(concurrent_resolve_fn)),
       m_scope(scope),
       m_config(config),
@@ -111,7 +112,8 @@ MultiMethodInliner::MultiMethodInliner(
                  scope,
                  config.shrinker,
                  configured_pure_methods,
-                 configured_finalish_field_names) {
+                 configured_finalish_field_names,
+                 purity_cache) {
   Timer t("MultiMethodInliner construction");
   for (const auto& callee_callers : true_virtual_callers) {
     for (const auto& caller_insns : callee_callers.second) {
@@ -323,7 +325,7 @@ void MultiMethodInliner::compute_callee_constant_arguments() {
                 ci.constant_arguments.emplace(key, constant_arguments);
                 ++ci.occurrences[key];
               });
-          m_call_constant_arguments.emplace(insn, constant_arguments);
+          m_call_constant_arguments_keys.emplace(insn, key);
         }
         info.constant_invoke_callers_analyzed++;
         info.constant_invoke_callers_unreachable_blocks += res->dead_blocks;
@@ -447,6 +449,32 @@ void MultiMethodInliner::inline_methods() {
     callee_priority = (callee_priority << 16) + callers.size();
   }
 
+  // The cfg inliner needs editable cfgs for callers and callees. Building them
+  // on the fly, as part of inlining into a caller, cannot be done concurrently
+  // with the other callers of the same callees. So build them all upfront, in
+  // parallel, and tear down at the end only those that we built.
+  std::vector<IRCode*> need_deconstruct;
+  if (m_config.use_cfg_inliner) {
+    Timer t("build_cfgs");
+    std::unordered_set<IRCode*> codes;
+    auto add_code = [&](const DexMethod* method) {
+      auto code = const_cast<DexMethod*>(method)->get_code();
+      if (code != nullptr && !code->editable_cfg_built()) {
+        codes.insert(code);
+      }
+    };
+    for (auto& p : m_async_caller_callees) {
+      add_code(p.first);
+    }
+    for (auto& p : m_async_callee_callers) {
+      add_code(p.first);
+    }
+    need_deconstruct.assign(codes.begin(), codes.end());
+    workqueue_run<IRCode*>(
+        [](IRCode* code) { code->build_cfg(/* editable */ true); },
+        need_deconstruct);
+  }
+
   // Kick off (shrinking and) pre-computing the should-inline cache.
   // Once all callees of a caller have been processed, then postprocessing
   // will in turn kick off processing of the caller.
@@ -471,6 +499,8 @@ void MultiMethodInliner::inline_methods() {
   }
 
   m_async_method_executor.join();
+  workqueue_run<IRCode*>([](IRCode* code) { code->clear_cfg(); },
+                         need_deconstruct);
   delayed_change_visibilities();
   info.waited_seconds = m_async_method_executor.get_waited_seconds();
 }
@@ -545,6 +575,88 @@ size_t MultiMethodInliner::compute_caller_nonrecursive_callees_by_stack_depth(
   return stack_depth;
 }
 
+void MultiMethodInliner::allocate_profile_guided_budget(
+    const method_profiles::MethodProfiles& method_profiles, size_t budget) {
+  always_assert(!for_speed());
+  Timer t("allocate_profile_guided_budget");
+  // Like InlineForSpeed, only consider methods that show up in most samples.
+  constexpr double MIN_APPEAR_PERCENT = 80.0;
+  auto get_frequency = [&](const DexMethod* caller, const DexMethod* callee) {
+    double frequency = 0;
+    for (const auto& p : method_profiles.all_interactions()) {
+      const auto& method_stats = p.second;
+      auto caller_it = method_stats.find(caller);
+      if (caller_it == method_stats.end() ||
+          caller_it->second.appear_percent < MIN_APPEAR_PERCENT) {
+        continue;
+      }
+      auto callee_it = method_stats.find(callee);
+      if (callee_it == method_stats.end() ||
+          callee_it->second.appear_percent < MIN_APPEAR_PERCENT) {
+        continue;
+      }
+      frequency = std::max(frequency, std::min(caller_it->second.call_count,
+                                               callee_it->second.call_count));
+    }
+    return frequency;
+  };
+
+  struct HotCall {
+    DexMethod* caller;
+    DexMethod* callee;
+    double frequency;
+    size_t cost;
+  };
+  std::vector<HotCall> hot_calls;
+  for (auto& p : caller_callee) {
+    auto caller = p.first;
+    std::unordered_map<DexMethod*, size_t> call_sites;
+    for (auto callee : p.second) {
+      call_sites[callee]++;
+    }
+    for (auto& q : call_sites) {
+      auto callee = q.first;
+      auto frequency = get_frequency(caller, callee);
+      if (frequency > 0) {
+        auto cost = get_callee_insn_size(callee) * q.second;
+        hot_calls.push_back({caller, callee, frequency, cost});
+      }
+    }
+  }
+  std::sort(hot_calls.begin(), hot_calls.end(),
+            [](const HotCall& a, const HotCall& b) {
+              if (a.frequency != b.frequency) {
+                return a.frequency > b.frequency;
+              }
+              if (a.caller != b.caller) {
+                return compare_dexmethods(a.caller, b.caller);
+              }
+              return compare_dexmethods(a.callee, b.callee);
+            });
+
+  // Greedily, so that calls that do not fit anymore may leave room for
+  // smaller, slightly colder ones.
+  size_t used{0};
+  for (auto& hot_call : hot_calls) {
+    if (used + hot_call.cost > budget) {
+      continue;
+    }
+    used += hot_call.cost;
+    m_hot_callees[hot_call.caller].insert(hot_call.callee);
+    info.hot_calls++;
+    TRACE(MMINL, 4, "hot call %s -> %s: frequency %f, cost %zu",
+          SHOW(hot_call.caller), SHOW(hot_call.callee), hot_call.frequency,
+          hot_call.cost);
+  }
+  info.hot_calls_budget_used = used;
+}
+
+bool MultiMethodInliner::is_hot_call(const DexMethod* caller,
+                                     const DexMethod* callee) const {
+  auto it = m_hot_callees.find(caller);
+  return it != m_hot_callees.end() && it->second.count(callee);
+}
+
 void MultiMethodInliner::caller_inline(
     DexMethod* caller, const std::vector<DexMethod*>& nonrecursive_callees) {
   TraceContext context(caller);
@@ -553,7 +665,7 @@ void MultiMethodInliner::caller_inline(
   std::vector<DexMethod*> optional_selected_callees;
   selected_callees.reserve(nonrecursive_callees.size());
   for (auto callee : nonrecursive_callees) {
-    if (should_inline(callee)) {
+    if (should_inline(callee) || is_hot_call(caller, callee)) {
       selected_callees.push_back(callee);
     } else {
       optional_selected_callees.push_back(callee);
@@ -1043,6 +1155,8 @@ void MultiMethodInliner::inline_inlinables(
       }
       m_inlined.insert(callee_method);
     }
+    // Costs of the caller that may have been computed before are now stale.
+    invalidate_inlined_cost(caller_method);
   }
 
   for (IRCode* code : need_deconstruct) {
@@ -1141,6 +1255,8 @@ void MultiMethodInliner::decrement_caller_wait_counts(
         });
     if (caller_ready) {
       if (inline_inlinables_need_deconstruct(caller)) {
+        // inline_methods() builds all cfgs upfront, so this is only reached
+        // if the cfg of the caller was torn down in the meantime.
         // TODO: Support parallel execution without pre-deconstructed cfgs.
         auto& callees = m_async_caller_callees.at(caller);
         caller_inline(caller, callees);
@@ -1686,11 +1802,35 @@ static InlinedCost get_inlined_cost(
 }
 
 InlinedCost MultiMethodInliner::get_inlined_cost(const DexMethod* callee) {
-  auto opt_inlined_cost = m_inlined_costs.get(callee, boost::none);
-  if (opt_inlined_cost) {
-    return *opt_inlined_cost;
+  auto entry = m_inlined_costs.get(callee, nullptr);
+  if (!entry) {
+    m_inlined_costs.update(callee,
+                           [&](const DexMethod*,
+                               std::shared_ptr<InlinedCostEntry>& value,
+                               bool /* exists */) {
+                             if (!value) {
+                               value = std::make_shared<InlinedCostEntry>();
+                             }
+                             entry = value;
+                           });
+  }
+  // Callees with many callers are typically asked for by many of them at
+  // once; all but the first one wait for the result instead of redoing the
+  // constant-propagation of the callee for all its constant arguments.
+  std::call_once(entry->computed,
+                 [&]() { entry->cost = compute_inlined_cost(callee); });
+  return entry->cost;
+}
+
+void MultiMethodInliner::invalidate_inlined_cost(const DexMethod* method) {
+  m_inlined_costs.erase(method);
+  m_inlined_costs_keyed.erase(method);
+  if (m_callee_insn_sizes) {
+    m_callee_insn_sizes->erase(method);
   }
+}
 
+InlinedCost MultiMethodInliner::compute_inlined_cost(const DexMethod* callee) {
   std::mutex mutex;
   size_t callees_analyzed{0};
   size_t callees_unreachable_blocks{0};
@@ -1707,6 +1847,7 @@ InlinedCost MultiMethodInliner::get_inlined_cost(const DexMethod* callee) {
       TraceContext context(callee);
       const auto& constant_arguments = cao.first;
       const auto count = cao.second;
+      auto key = get_key(constant_arguments);
       TRACE(INLINE, 5, "[too_many_callers] get_inlined_cost %s", SHOW(callee));
       auto res = ::get_inlined_cost(is_static(callee), callee->get_code(),
                                     &constant_arguments,
@@ -1717,7 +1858,7 @@ InlinedCost MultiMethodInliner::get_inlined_cost(const DexMethod* callee) {
             "params %s @ %s: cost %zu, method refs %zu, other refs %zu (dead "
             "blocks: %zu), %s, insn_size %zu",
             constant_arguments.is_top() ? 0 : constant_arguments.size(),
-            get_key(constant_arguments).c_str(), SHOW(callee), res.code,
+            key.c_str(), SHOW(callee), res.code,
             res.method_refs, res.other_refs, res.dead_blocks.size(),
             res.no_return ? "no_return" : "return", res.insn_size);
       std::lock_guard<std::mutex> lock_guard(mutex);
@@ -1734,7 +1875,7 @@ InlinedCost MultiMethodInliner::get_inlined_cost(const DexMethod* callee) {
         inlined_cost.insn_size = res.insn_size;
       }
       callees_analyzed += count;
-      inlined_costs_keyed.emplace(get_key(constant_arguments), std::move(res));
+      inlined_costs_keyed.emplace(std::move(key), std::move(res));
     };
 
     if (callee_constant_arguments.size() > 1 &&
@@ -1774,27 +1915,12 @@ InlinedCost MultiMethodInliner::get_inlined_cost(const DexMethod* callee) {
       SHOW(callee), inlined_cost.code, inlined_cost.method_refs,
       inlined_cost.other_refs, inlined_cost.no_return ? "no_return" : "return",
       inlined_cost.insn_size);
-  m_inlined_costs.update(
-      callee,
-      [&](const DexMethod*, boost::optional<InlinedCost>& value, bool exists) {
-        if (exists) {
-          // We wasted some work, and some other thread beat us. Oh well...
-          always_assert(value->code == inlined_cost.code);
-          always_assert(value->method_refs == inlined_cost.method_refs);
-          always_assert(value->other_refs == inlined_cost.other_refs);
-          always_assert(value->no_return == inlined_cost.no_return);
-          always_assert(value->insn_size == inlined_cost.insn_size);
-          return;
-        }
-        value = inlined_cost;
-        if (callees_analyzed == 0) {
-          return;
-        }
-        info.constant_invoke_callees_analyzed += callees_analyzed;
-        info.constant_invoke_callees_unreachable_blocks +=
-            callees_unreachable_blocks;
-        info.constant_invoke_callees_no_return += callees_no_return;
-      });
+  if (callees_analyzed != 0) {
+    info.constant_invoke_callees_analyzed += callees_analyzed;
+    info.constant_invoke_callees_unreachable_blocks +=
+        callees_unreachable_blocks;
+    info.constant_invoke_callees_no_return += callees_no_return;
+  }
   return inlined_cost;
 }
 
@@ -1948,16 +2074,15 @@ bool MultiMethodInliner::should_inline_optional(
     const std::unordered_set<cfg::Block*>** dead_blocks,
     size_t* insn_size) {
   *no_return = false;
-  if (!m_call_constant_arguments.count_unsafe(invoke_insn)) {
+  if (!m_call_constant_arguments_keys.count_unsafe(invoke_insn)) {
     return false;
   }
-  auto& constant_arguments = m_call_constant_arguments.at_unsafe(invoke_insn);
+  const auto& key = m_call_constant_arguments_keys.at_unsafe(invoke_insn);
   auto opt_inlined_costs_keyed = m_inlined_costs_keyed.get(
       callee, std::shared_ptr<std::unordered_map<std::string, InlinedCost>>());
   if (!opt_inlined_costs_keyed) {
     return false;
   }
-  auto key = get_key(constant_arguments);
   auto it = opt_inlined_costs_keyed->find(key);
   if (it == opt_inlined_costs_keyed->end()) {
     return false;
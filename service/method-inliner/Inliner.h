@@ -9,6 +9,8 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "DexClass.h"
@@ -156,7 +158,8 @@ class MultiMethodInliner {
       bool analyze_and_prune_inits = false,
       const std::unordered_set<DexMethodRef*>& configured_pure_methods = {},
       const std::unordered_set<DexString*>& configured_finalish_field_names =
-          {});
+          {},
+      purity::AnalysisCache* purity_cache = nullptr);
 
   ~MultiMethodInliner() { delayed_invoke_direct_to_static(); }
 
@@ -165,6 +168,16 @@ class MultiMethodInliner {
    */
   void inline_methods();
 
+  /**
+   * Spend up to `budget` code units on inlining the hottest calls according
+   * to the method profiles, even where the usual cost model would decline.
+   * Calls are ranked by how often they may run, i.e. the lower of the call
+   * counts of caller and callee, and cost the size of the callee for each
+   * call site. Must be called before inline_methods().
+   */
+  void allocate_profile_guided_budget(
+      const method_profiles::MethodProfiles& method_profiles, size_t budget);
+
   /**
    * Return the set of unique inlined methods.
    */
@@ -213,6 +226,12 @@ class MultiMethodInliner {
   void caller_inline(DexMethod* caller,
                      const std::vector<DexMethod*>& nonrecursive_callees);
 
+  /**
+   * Whether the calls from caller to callee were selected by
+   * allocate_profile_guided_budget().
+   */
+  bool is_hot_call(const DexMethod* caller, const DexMethod* callee) const;
+
   using CallerNonrecursiveCalleesByStackDepth = std::unordered_map<
       size_t,
       std::vector<std::pair<DexMethod*, std::vector<DexMethod*>>>>;
@@ -384,10 +403,20 @@ class MultiMethodInliner {
   bool too_many_callers(const DexMethod* callee);
 
   /**
-   * Estimate inlined cost for a single invocation of a method.
+   * Estimate inlined cost for a single invocation of a method. This is only
+   * computed once per callee, even when asked for by many callers at the same
+   * time, until invalidate_inlined_cost() is called.
    */
   InlinedCost get_inlined_cost(const DexMethod* callee);
 
+  InlinedCost compute_inlined_cost(const DexMethod* callee);
+
+  /**
+   * Drops what was cached about the costs of inlining a method whose code
+   * has changed.
+   */
+  void invalidate_inlined_cost(const DexMethod* method);
+
   /**
    * Change visibilities of methods, assuming that`m_change_visibility` is
    * non-null.
@@ -492,9 +521,14 @@ class MultiMethodInliner {
   std::unordered_map<DexMethod*, std::unordered_map<IRInstruction*, DexMethod*>>
       caller_virtual_callee;
 
+  struct InlinedCostEntry {
+    std::once_flag computed;
+    InlinedCost cost;
+  };
+
   // Cache of the inlined costs of each method after all its eligible callsites
   // have been inlined.
-  mutable ConcurrentMap<const DexMethod*, boost::optional<InlinedCost>>
+  mutable ConcurrentMap<const DexMethod*, std::shared_ptr<InlinedCostEntry>>
       m_inlined_costs;
 
   // Cache of the inlined costs of each method and each constant-arguments key
@@ -512,10 +546,11 @@ class MultiMethodInliner {
       m_callee_constant_arguments;
 
   /**
-   * For all (reachable) invoke instructions, constant arguments
+   * For all (reachable) invoke instructions, the key of their constant
+   * arguments
    */
-  mutable ConcurrentMap<const IRInstruction*, ConstantArguments>
-      m_call_constant_arguments;
+  mutable ConcurrentMap<const IRInstruction*, std::string>
+      m_call_constant_arguments_keys;
 
   // Priority thread pool to handle parallel processing of methods, either
   // shrinking initially / after inlining into them, or even to inline in
@@ -570,6 +605,11 @@ class MultiMethodInliner {
   std::unique_ptr<ConcurrentMap<const DexMethod*, CalleeCallerRefs>>
       m_callee_caller_refs;
 
+  // Callees selected by allocate_profile_guided_budget(), by caller.
+  // Read-only once inlining starts.
+  std::unordered_map<const DexMethod*, std::unordered_set<const DexMethod*>>
+      m_hot_callees;
+
   // Cache of whether a constructor can be unconditionally inlined.
   mutable ConcurrentMap<const DexMethod*, boost::optional<bool>>
       m_can_inline_init;
@@ -584,6 +624,8 @@ class MultiMethodInliner {
     size_t max_call_stack_depth{0};
     size_t waited_seconds{0};
     int critical_path_length{0};
+    size_t hot_calls{0};
+    size_t hot_calls_budget_used{0};
 
     // statistics that may be incremented concurrently
     std::atomic<size_t> calls_inlined{0};
@@ -304,7 +304,9 @@ void run_inliner(DexStoresVector& stores,
                  PassManager& mgr,
                  ConfigFiles& conf,
                  bool intra_dex /* false */,
-                 InlineForSpeed* inline_for_speed) {
+                 InlineForSpeed* inline_for_speed,
+                 const mog::Graph* preserved_method_override_graph,
+                 purity::AnalysisCache* purity_cache) {
   if (mgr.no_proguard_rules()) {
     TRACE(INLINE, 1,
           "MethodInlinePass not run because no ProGuard configuration was "
@@ -325,13 +327,16 @@ void run_inliner(DexStoresVector& stores,
 
   inliner_config.unique_inlined_registers = false;
 
-  std::unique_ptr<const mog::Graph> method_override_graph;
-  if (inliner_config.virtual_inline) {
-    method_override_graph = mog::build_graph(scope);
+  std::unique_ptr<const mog::Graph> owned_method_override_graph;
+  const mog::Graph* method_override_graph = preserved_method_override_graph;
+  if (inliner_config.virtual_inline && method_override_graph == nullptr) {
+    owned_method_override_graph = mog::build_graph(scope);
+    method_override_graph = owned_method_override_graph.get();
   }
 
-  auto candidates =
-      gather_non_virtual_methods(scope, method_override_graph.get());
+  auto candidates = gather_non_virtual_methods(
+      scope,
+      inliner_config.virtual_inline ? method_override_graph : nullptr);
 
   // The candidates list computed above includes all constructors, regardless of
   // whether it's safe to inline them or not. We'll let the inliner decide
@@ -363,7 +368,15 @@ void run_inliner(DexStoresVector& stores,
                              inliner_config, intra_dex ? IntraDex : InterDex,
                              true_virtual_callers, inline_for_speed,
                              &same_method_implementations,
-                             analyze_and_prune_inits, conf.get_pure_methods());
+                             analyze_and_prune_inits, conf.get_pure_methods(),
+                             /* configured_finalish_field_names */ {},
+                             purity_cache);
+  const auto& method_profiles = conf.get_method_profiles();
+  if (inliner_config.profile_guided_budget > 0 && inline_for_speed == nullptr &&
+      method_profiles.has_stats()) {
+    inliner.allocate_profile_guided_budget(
+        method_profiles, inliner_config.profile_guided_budget);
+  }
   inliner.inline_methods();
 
   if (inliner_config.use_cfg_inliner) {
@@ -442,6 +455,9 @@ void run_inliner(DexStoresVector& stores,
   mgr.incr_metric("max_call_stack_depth",
                   inliner.get_info().max_call_stack_depth);
   mgr.incr_metric("caller_too_large", inliner.get_info().caller_too_large);
+  mgr.incr_metric("hot_calls", inliner.get_info().hot_calls);
+  mgr.incr_metric("hot_calls_budget_used",
+                  inliner.get_info().hot_calls_budget_used);
   mgr.incr_metric("inlined_init_count", inlined_init_count);
   mgr.incr_metric("calls_inlined", inliner.get_info().calls_inlined);
   mgr.incr_metric("calls_not_inlinable",
@@ -10,6 +10,14 @@
 
 class InlineForSpeed;
 
+namespace method_override_graph {
+class Graph;
+} // namespace method_override_graph
+
+namespace purity {
+class AnalysisCache;
+} // namespace purity
+
 namespace inliner {
 /**
  * Before InterDexPass, we can run inliner with "intra_dex=false" to do global
@@ -20,5 +28,8 @@ void run_inliner(DexStoresVector& stores,
                  PassManager& mgr,
                  ConfigFiles& conf,
                  bool intra_dex = false,
-                 InlineForSpeed* inline_for_speed = nullptr);
+                 InlineForSpeed* inline_for_speed = nullptr,
+                 const method_override_graph::Graph* method_override_graph =
+                     nullptr,
+                 purity::AnalysisCache* purity_cache = nullptr);
 } // namespace inliner
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "RefRewriter.h"
+
+#include <boost/optional.hpp>
+
+#include "DexAnnotation.h"
+#include "IRCode.h"
+#include "IRInstruction.h"
+#include "Show.h"
+#include "Trace.h"
+#include "TypeReference.h"
+#include "Walkers.h"
+#include "WorkQueue.h"
+
+namespace {
+
+class Rewriter {
+ public:
+  Rewriter(const ref_rewriter::RefMaps& maps, bool check_signatures)
+      : m_maps(maps), m_check_signatures(check_signatures) {
+    for (auto& pair : maps.types) {
+      m_old_types.insert(pair.first);
+    }
+  }
+
+  ref_rewriter::Stats rewrite_class(
+      DexClass* cls,
+      const std::function<void(DexMethod*, IRInstruction*)>& insn_hook) {
+    ref_rewriter::Stats stats;
+    rewrite_anno_set(cls->get_anno_set(), &stats);
+    for (auto* field : cls->get_all_fields()) {
+      rewrite_anno_set(field->get_anno_set(), &stats);
+      rewrite_encoded_value(field->get_static_value(), &stats);
+    }
+    for (auto* method : cls->get_all_methods()) {
+      rewrite_anno_set(method->get_anno_set(), &stats);
+      if (auto* param_anno = method->get_param_anno()) {
+        for (auto& pair : *param_anno) {
+          rewrite_anno_set(pair.second, &stats);
+        }
+      }
+      auto* code = method->get_code();
+      if (code == nullptr) {
+        continue;
+      }
+      editable_cfg_adapter::iterate(code, [&](MethodItemEntry& mie) {
+        auto* insn = mie.insn;
+        if (rewrite_insn(insn)) {
+          TRACE(REFU, 9, "Rewrote refs of %s in %s", SHOW(insn),
+                SHOW(method));
+          stats.insns++;
+        }
+        if (insn_hook) {
+          insn_hook(method, insn);
+        }
+        if (m_check_signatures) {
+          check_insn(insn);
+        }
+        return editable_cfg_adapter::LOOP_CONTINUE;
+      });
+    }
+    return stats;
+  }
+
+ private:
+  DexType* convert(DexType* type) const {
+    if (m_maps.types.empty()) {
+      return nullptr;
+    }
+    auto level = type::get_array_level(type);
+    auto it = m_maps.types.find(type::get_element_type_if_array(type));
+    if (it == m_maps.types.end()) {
+      return nullptr;
+    }
+    return level ? type::make_array_type(it->second, level) : it->second;
+  }
+
+  DexMethodRef* convert(DexMethodRef* method) const {
+    auto it = m_maps.methods.find(method);
+    return it == m_maps.methods.end() ? nullptr : it->second;
+  }
+
+  DexFieldRef* convert(DexFieldRef* field) const {
+    auto it = m_maps.fields.find(field);
+    return it == m_maps.fields.end() ? nullptr : it->second;
+  }
+
+  bool rewrite_insn(IRInstruction* insn) const {
+    if (insn->has_type()) {
+      if (auto* new_type = convert(insn->get_type())) {
+        insn->set_type(new_type);
+        return true;
+      }
+    } else if (insn->has_method()) {
+      if (auto* new_method = convert(insn->get_method())) {
+        insn->set_method(new_method);
+        return true;
+      }
+    } else if (insn->has_field()) {
+      if (auto* new_field = convert(insn->get_field())) {
+        insn->set_field(new_field);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void check_insn(const IRInstruction* insn) const {
+    if (insn->has_method()) {
+      always_assert_log(!type_reference::proto_has_reference_to(
+                            insn->get_method()->get_proto(), m_old_types),
+                        "Find old type in method reference %s, please make "
+                        "sure that ReBindRefsPass is enabled before the "
+                        "crashed pass.\n",
+                        SHOW(insn));
+    } else if (insn->has_field()) {
+      always_assert_log(
+          !m_old_types.count(
+              type::get_element_type_if_array(insn->get_field()->get_type())),
+          "Find old type in field reference %s, please make sure that "
+          "ReBindRefsPass is enabled before the crashed pass.\n",
+          SHOW(insn));
+    }
+  }
+
+  void rewrite_anno_set(DexAnnotationSet* anno_set,
+                        ref_rewriter::Stats* stats) const {
+    if (anno_set == nullptr) {
+      return;
+    }
+    for (auto* anno : anno_set->get_annotations()) {
+      if (auto* new_type = convert(anno->type())) {
+        anno->set_type(new_type);
+        stats->encoded_values++;
+      }
+      for (auto& elem : anno->anno_elems()) {
+        rewrite_encoded_value(elem.encoded_value, stats);
+      }
+    }
+  }
+
+  void rewrite_encoded_value(DexEncodedValue* ev,
+                             ref_rewriter::Stats* stats) const {
+    if (ev == nullptr) {
+      return;
+    }
+    switch (ev->evtype()) {
+    case DEVT_TYPE: {
+      auto* type_ev = static_cast<DexEncodedValueType*>(ev);
+      if (auto* new_type = convert(type_ev->type())) {
+        type_ev->set_type(new_type);
+        stats->encoded_values++;
+      }
+      break;
+    }
+    case DEVT_FIELD:
+    case DEVT_ENUM: {
+      auto* field_ev = static_cast<DexEncodedValueField*>(ev);
+      if (auto* new_field = convert(field_ev->field())) {
+        field_ev->set_field(new_field);
+        stats->encoded_values++;
+      }
+      break;
+    }
+    case DEVT_METHOD: {
+      auto* method_ev = static_cast<DexEncodedValueMethod*>(ev);
+      if (auto* new_method = convert(method_ev->method())) {
+        method_ev->set_method(new_method);
+        stats->encoded_values++;
+      }
+      break;
+    }
+    case DEVT_ARRAY: {
+      auto* array_ev = static_cast<DexEncodedValueArray*>(ev);
+      for (auto* elem_ev : *array_ev->evalues()) {
+        rewrite_encoded_value(elem_ev, stats);
+      }
+      break;
+    }
+    case DEVT_ANNOTATION: {
+      auto* anno_ev = static_cast<DexEncodedValueAnnotation*>(ev);
+      if (auto* new_type = convert(anno_ev->type())) {
+        anno_ev->set_type(new_type);
+        stats->encoded_values++;
+      }
+      for (auto& elem : *anno_ev->annotations()) {
+        rewrite_encoded_value(elem.encoded_value, stats);
+      }
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  const ref_rewriter::RefMaps& m_maps;
+  bool m_check_signatures;
+  std::unordered_set<const DexType*> m_old_types;
+};
+
+} // namespace
+
+namespace ref_rewriter {
+
+Stats rewrite_refs(const Scope& scope,
+                   const RefMaps& maps,
+                   const Options& options) {
+  if (options.signatures_hierarchy != nullptr && !maps.types.empty()) {
+    boost::optional<std::unordered_map<DexMethod*, std::string>&>
+        method_debug_map;
+    if (options.method_debug_map != nullptr) {
+      method_debug_map = *options.method_debug_map;
+    }
+    type_reference::update_method_signature_type_references_unchecked(
+        scope, maps.types, *options.signatures_hierarchy, method_debug_map);
+    type_reference::update_field_type_references_unchecked(scope, maps.types);
+  }
+
+  Rewriter rewriter(maps, options.signatures_hierarchy != nullptr &&
+                              !maps.types.empty());
+  auto num_threads = redex_parallel::default_num_threads();
+  std::vector<Stats> worker_stats(num_threads);
+  workqueue_run<DexClass*>(
+      [&](sparta::SpartaWorkerState<DexClass*>* state, DexClass* cls) {
+        worker_stats[state->worker_id()] +=
+            rewriter.rewrite_class(cls, options.insn_hook);
+      },
+      scope, num_threads);
+  Stats stats;
+  for (const auto& ws : worker_stats) {
+    stats += ws;
+  }
+  TRACE(REFU, 2, "Rewrote the refs of %zu insns and %zu encoded values",
+        stats.insns, stats.encoded_values);
+  return stats;
+}
+
+} // namespace ref_rewriter
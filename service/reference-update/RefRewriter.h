@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+#include "ClassHierarchy.h"
+#include "DexClass.h"
+
+class IRInstruction;
+
+namespace ref_rewriter {
+
+/**
+ * The references to rewrite. A type is also rewritten as the element type of
+ * an array type, e.g. [LOld; => [LNew;
+ */
+struct RefMaps {
+  std::unordered_map<const DexType*, DexType*> types;
+  std::unordered_map<DexMethodRef*, DexMethodRef*> methods;
+  std::unordered_map<DexFieldRef*, DexFieldRef*> fields;
+};
+
+struct Options {
+  /**
+   * When set, the signatures of the methods and the types of the fields of the
+   * scope that refer to the old types are updated first, like
+   * type_reference::update_method_signature_type_references and
+   * type_reference::update_field_type_references do, and the walk checks that
+   * no method or field reference in the code still refers to an old type.
+   */
+  const ClassHierarchy* signatures_hierarchy{nullptr};
+  std::unordered_map<DexMethod*, std::string>* method_debug_map{nullptr};
+  /**
+   * Called on each instruction once its references have been rewritten, for
+   * the changes that the maps cannot express.
+   */
+  std::function<void(DexMethod*, IRInstruction*)> insn_hook;
+};
+
+struct Stats {
+  size_t insns{0};
+  size_t encoded_values{0};
+
+  Stats& operator+=(const Stats& that) {
+    insns += that.insns;
+    encoded_values += that.encoded_values;
+    return *this;
+  }
+};
+
+/**
+ * Rewrites the references in `maps`, in a single parallel walk over the scope,
+ * in the type, method and field operands of all instructions, and in the
+ * annotations and static values of all classes, fields and methods. This
+ * saves the passes that update many references at once a walk over all the
+ * code per kind of reference.
+ */
+Stats rewrite_refs(const Scope& scope,
+                   const RefMaps& maps,
+                   const Options& options = Options());
+
+} // namespace ref_rewriter
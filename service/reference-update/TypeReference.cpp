@@ -541,7 +541,7 @@ DexTypeList* drop_and_make(const DexTypeList* list, size_t num_types_to_drop) {
   return DexTypeList::make_type_list(std::move(dropped));
 }
 
-void update_method_signature_type_references(
+void update_method_signature_type_references_unchecked(
     const Scope& scope,
     const std::unordered_map<const DexType*, DexType*>& old_to_new,
     const ClassHierarchy& ch,
@@ -606,7 +606,21 @@ void update_method_signature_type_references(
     auto& group = key_and_group.second;
     update_vmethods_group_one_type_ref(group, ch);
   }
+}
+
+void update_method_signature_type_references(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new,
+    const ClassHierarchy& ch,
+    boost::optional<std::unordered_map<DexMethod*, std::string>&>
+        method_debug_map) {
+  update_method_signature_type_references_unchecked(scope, old_to_new, ch,
+                                                    method_debug_map);
 
+  UnorderedTypeSet old_types;
+  for (auto& pair : old_to_new) {
+    old_types.insert(pair.first);
+  }
   // Ensure that no method references left that still refer old types.
   walk::parallel::code(scope, [&old_types](DexMethod*, IRCode& code) {
     for (auto& mie : InstructionIterable(code)) {
@@ -623,7 +637,7 @@ void update_method_signature_type_references(
   });
 }
 
-void update_field_type_references(
+void update_field_type_references_unchecked(
     const Scope& scope,
     const std::unordered_map<const DexType*, DexType*>& old_to_new) {
   TRACE(REFU, 4, " updating field refs");
@@ -642,6 +656,12 @@ void update_field_type_references(
     TRACE(REFU, 9, " updating field ref to %s", SHOW(type));
   };
   walk::parallel::fields(scope, update_field);
+}
+
+void update_field_type_references(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new) {
+  update_field_type_references_unchecked(scope, old_to_new);
 
   walk::parallel::code(scope, [&old_to_new](DexMethod*, IRCode& code) {
     for (auto& mie : InstructionIterable(code)) {
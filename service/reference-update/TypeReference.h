@@ -123,4 +123,20 @@ void update_field_type_references(
     const Scope& scope,
     const std::unordered_map<const DexType*, DexType*>& old_to_new);
 
+/**
+ * Like the above, but without the walk over all the code that checks that no
+ * method or field reference still refers to an old type. For callers that do
+ * that check as part of their own walk, like ref_rewriter::rewrite_refs.
+ */
+void update_method_signature_type_references_unchecked(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new,
+    const ClassHierarchy& ch,
+    boost::optional<std::unordered_map<DexMethod*, std::string>&>
+        method_debug_map = boost::none);
+
+void update_field_type_references_unchecked(
+    const Scope& scope,
+    const std::unordered_map<const DexType*, DexType*>& old_to_new);
+
 } // namespace type_reference
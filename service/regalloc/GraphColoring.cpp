@@ -316,6 +316,9 @@ Allocator::Stats& Allocator::Stats::operator+=(const Allocator::Stats& that) {
   split_moves += that.split_moves;
   moves_coalesced += that.moves_coalesced;
   params_spill_early += that.params_spill_early;
+  linear_scan_methods += that.linear_scan_methods;
+  linear_scan_moves += that.linear_scan_moves;
+  large_register_code_units += that.large_register_code_units;
   return *this;
 }
 
@@ -435,7 +438,22 @@ void Allocator::simplify(interference::Graph* ig,
   // Nodes of low weight that we know are colorable. Note that even if all
   // the nodes in `low` have a max_vreg of 15, we can still have more than 16
   // of them here since some of them can have zero weight.
-  std::set<reg_t> low;
+  //
+  // Any of them can be removed first. When preferring small encodings, the
+  // ones that benefit least from a low register go first, which puts them
+  // deeper in the select stack; select() then colors the nodes that benefit
+  // most while the lowest registers are still free.
+  auto low_order = [ig, this](reg_t a, reg_t b) {
+    if (m_config.prefer_small_encodings) {
+      auto benefit_a = ig->get_node(a).encoding_benefit();
+      auto benefit_b = ig->get_node(b).encoding_benefit();
+      if (benefit_a != benefit_b) {
+        return benefit_a < benefit_b;
+      }
+    }
+    return a < b;
+  };
+  std::set<reg_t, decltype(low_order)> low(low_order);
   // Nodes that may not be colorable
   std::set<reg_t> high;
 
@@ -851,7 +869,7 @@ std::unordered_map<reg_t, IRList::iterator> Allocator::find_param_splits(
 
   auto& cfg = code->cfg();
   cfg::Block* start_block = cfg.entry_block();
-  auto doms = dominators::SimpleFastDominators<cfg::GraphInterface>(cfg);
+  auto doms = cfg.get_dominators();
   for (auto param : params) {
     auto block_uses = find_first_uses(param, start_block);
     // Since this function only gets called for param regs that need to be
@@ -863,7 +881,7 @@ std::unordered_map<reg_t, IRList::iterator> Allocator::find_param_splits(
       // insert a load at its end.
       cfg::Block* idom = block_uses[0];
       for (size_t index = 1; index < block_uses.size(); ++index) {
-        idom = doms.intersect(idom, block_uses[index]);
+        idom = doms->intersect(idom, block_uses[index]);
       }
       TRACE(REG, 5, "Inserting param load of v%u in B%zu", param, idom->id());
       // We need to check insn before end of block to make sure we didn't
@@ -1028,7 +1046,7 @@ void Allocator::spill(const interference::Graph& ig,
  *   :true-label
  *   return-object v0
  */
-static void dedicate_this_register(DexMethod* method) {
+void dedicate_this_register(DexMethod* method) {
   always_assert(!is_static(method));
   IRCode* code = method->get_code();
   auto param_insns = code->get_param_instructions();
@@ -1069,6 +1087,35 @@ static void dedicate_this_register(DexMethod* method) {
  *     account for. These are handled in select_ranges and select_params
  *     respectively.
  */
+/*
+ * Counts the code units that instruction lowering will spend on the
+ * instructions whose registers are too high for their shortest encoding.
+ */
+static size_t count_large_register_code_units(const IRCode* code) {
+  size_t units = 0;
+  for (const auto& mie : InstructionIterable(code)) {
+    const auto* insn = mie.insn;
+    auto op = insn->opcode();
+    if (opcode::is_a_move(op)) {
+      if (insn->dest() > 0xff) {
+        units += 2;
+      } else if (insn->dest() > 0xf || insn->src(0) > 0xf) {
+        units += 1;
+      }
+    } else if (op == OPCODE_CONST && insn->get_literal() >= -8 &&
+               insn->get_literal() <= 7) {
+      units += insn->dest() > 0xf;
+    } else if (has_2addr_form(op)) {
+      if (insn->dest() == insn->src(0)) {
+        units += insn->dest() > 0xf || insn->src(1) > 0xf;
+      } else if (opcode::is_commutative(op) && insn->dest() == insn->src(1)) {
+        units += insn->dest() > 0xf || insn->src(0) > 0xf;
+      }
+    }
+  }
+  return units;
+}
+
 void Allocator::allocate(DexMethod* method) {
   IRCode* code = method->get_code();
 
@@ -1169,6 +1216,8 @@ void Allocator::allocate(DexMethod* method) {
     } else {
       transform::remap_registers(code, reg_transform.map);
       code->set_registers_size(reg_transform.size);
+      m_stats.large_register_code_units +=
+          count_large_register_code_units(code);
       break;
     }
   }
@@ -1182,6 +1231,8 @@ void Allocator::allocate(DexMethod* method) {
   TRACE(REG, 3, "Coalesce count: %lu", m_stats.moves_coalesced);
   TRACE(REG, 3, "Params spilled too early: %lu", m_stats.params_spill_early);
   TRACE(REG, 3, "Net moves: %ld", m_stats.net_moves());
+  TRACE(REG, 3, "Large register code units: %zu",
+        m_stats.large_register_code_units);
 }
 
 } // namespace graph_coloring
@@ -83,6 +83,13 @@ class Allocator {
   struct Config {
     bool no_overwrite_this{false};
     bool use_splitting{false};
+    // Methods with at least this many instructions are allocated by
+    // linear_scan::allocate instead. Zero disables that.
+    size_t linear_scan_threshold{0};
+    // Whether simplify() orders the nodes it knows to be colorable by their
+    // encoding benefit, so that select() hands the lowest registers to the
+    // nodes that make the code smallest in them.
+    bool prefer_small_encodings{false};
   };
 
   struct Stats {
@@ -93,9 +100,14 @@ class Allocator {
     size_t split_moves{0};
     size_t moves_coalesced{0};
     size_t params_spill_early{0};
+    size_t linear_scan_methods{0};
+    size_t linear_scan_moves{0};
+    // The code units that instructions take only because their registers are
+    // too high for their shortest encoding.
+    size_t large_register_code_units{0};
     size_t moves_inserted() const {
       return param_spill_moves + range_spill_moves + global_spill_moves +
-             split_moves;
+             split_moves + linear_scan_moves;
     }
     size_t net_moves() const { return moves_inserted() - moves_coalesced; }
     Stats& operator+=(const Stats&);
@@ -160,6 +172,12 @@ class Allocator {
   Stats m_stats;
 };
 
+/*
+ * Split the `this` param from any other def of its symreg, so that it can be
+ * kept in a register of its own.
+ */
+void dedicate_this_register(DexMethod* method);
+
 } // namespace graph_coloring
 
 } // namespace regalloc
@@ -50,6 +50,127 @@ uint32_t edge_weight_helper(uint8_t u_width, uint8_t v_width) {
   return ((v_width - 1) >> (u_width - 1)) + 1;
 }
 
+void PairSet::set_size(reg_t regs) {
+  m_regs = regs;
+  m_is_matrix = regs <= MAX_MATRIX_REGS;
+  if (m_is_matrix) {
+    auto pairs = m_symmetric ? static_cast<size_t>(regs) * regs / 2
+                             : static_cast<size_t>(regs) * regs;
+    m_present.assign(pairs, false);
+    m_flags.assign(pairs, false);
+  } else {
+    m_lists.resize(regs);
+    m_compacted_sizes.resize(regs);
+  }
+}
+
+std::vector<uint32_t>* PairSet::find_list(reg_t* u, reg_t* v) {
+  if (m_symmetric && *u > *v) {
+    std::swap(*u, *v);
+  }
+  always_assert(*v < (1u << 31));
+  if (*u >= m_lists.size()) {
+    m_lists.resize(*u + 1);
+    m_compacted_sizes.resize(*u + 1);
+  }
+  return &m_lists[*u];
+}
+
+bool PairSet::contains(reg_t u, reg_t v) const {
+  always_assert(!m_bulk);
+  if (m_is_matrix) {
+    return u != v && m_present[index(u, v)];
+  }
+  if (m_symmetric && u > v) {
+    std::swap(u, v);
+  }
+  if (u >= m_lists.size()) {
+    return false;
+  }
+  auto& list = m_lists[u];
+  auto it = std::lower_bound(list.begin(), list.end(), v << 1);
+  return it != list.end() && (*it >> 1) == v;
+}
+
+bool PairSet::get_flag(reg_t u, reg_t v) const {
+  always_assert(!m_bulk);
+  if (m_is_matrix) {
+    return u != v && m_flags[index(u, v)];
+  }
+  if (m_symmetric && u > v) {
+    std::swap(u, v);
+  }
+  if (u >= m_lists.size()) {
+    return false;
+  }
+  auto& list = m_lists[u];
+  auto it = std::lower_bound(list.begin(), list.end(), v << 1);
+  return it != list.end() && *it == ((v << 1) | 1);
+}
+
+bool PairSet::insert(reg_t u, reg_t v, bool flag) {
+  always_assert(!m_bulk);
+  if (m_is_matrix) {
+    always_assert(u < m_regs && v < m_regs);
+    auto idx = index(u, v);
+    bool is_new = !m_present[idx];
+    m_present[idx] = true;
+    if (flag) {
+      m_flags[idx] = true;
+    }
+    return is_new;
+  }
+  auto* list = find_list(&u, &v);
+  auto it = std::lower_bound(list->begin(), list->end(), v << 1);
+  if (it != list->end() && (*it >> 1) == v) {
+    *it |= flag;
+    return false;
+  }
+  list->insert(it, (v << 1) | flag);
+  return true;
+}
+
+void PairSet::append(reg_t u, reg_t v, bool flag) {
+  always_assert(m_bulk);
+  auto* list = find_list(&u, &v);
+  list->push_back((v << 1) | flag);
+  // Merging duplicates whenever a list doubles keeps the lists within twice
+  // their final size, at an amortized logarithmic cost per entry.
+  if (list->size() >= 2 * m_compacted_sizes[u] + 16) {
+    compact(u);
+  }
+}
+
+void PairSet::compact(reg_t u) {
+  auto& list = m_lists[u];
+  std::sort(list.begin(), list.end());
+  // Entries for the same register are adjacent, and the flagged one comes
+  // last, so keeping the last of each run merges the flags.
+  size_t out = 0;
+  for (size_t i = 0; i < list.size(); ++i) {
+    if (out > 0 && (list[out - 1] >> 1) == (list[i] >> 1)) {
+      list[out - 1] = list[i];
+    } else {
+      list[out++] = list[i];
+    }
+  }
+  list.resize(out);
+  list.shrink_to_fit();
+  m_compacted_sizes[u] = out;
+}
+
+void PairSet::end_bulk() {
+  if (!m_bulk) {
+    return;
+  }
+  for (reg_t u = 0; u < m_lists.size(); ++u) {
+    if (m_lists[u].size() != m_compacted_sizes[u]) {
+      compact(u);
+    }
+  }
+  m_bulk = false;
+}
+
 } // namespace impl
 
 using namespace impl;
@@ -68,18 +189,19 @@ uint32_t Graph::edge_weight(const Node& u_node, const Node& v_node) const {
                         : 0;
 }
 
+void Graph::link(reg_t u, reg_t v) {
+  auto& u_node = m_nodes.at(u);
+  auto& v_node = m_nodes.at(v);
+  u_node.m_adjacent.push_back(v);
+  v_node.m_adjacent.push_back(u);
+  u_node.m_weight += edge_weight(u_node, v_node);
+  v_node.m_weight += edge_weight(v_node, u_node);
+}
+
 void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
   if (u == v) {
     return;
   }
-  if (!is_adjacent(u, v)) {
-    auto& u_node = m_nodes.at(u);
-    auto& v_node = m_nodes.at(v);
-    u_node.m_adjacent.push_back(v);
-    v_node.m_adjacent.push_back(u);
-    u_node.m_weight += edge_weight(u_node, v_node);
-    v_node.m_weight += edge_weight(v_node, u_node);
-  }
   // If we have one instruction that creates a coalesceable edge between two
   // nodes s0 and s1, and another that creates a non-coalesceable edge, those
   // edges combined must be non-coalesceable. For example, if we have
@@ -89,8 +211,14 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
   //
   // then the final state of the edge between s0 and s1 must be
   // non-coalesceable.
-  m_adj_matrix[build_edge(u, v)] =
-      m_adj_matrix[build_edge(u, v)] || !can_coalesce;
+  if (m_adj_matrix.in_bulk()) {
+    // The nodes get linked once all the edges are known.
+    m_adj_matrix.append(u, v, !can_coalesce);
+    return;
+  }
+  if (m_adj_matrix.insert(u, v, !can_coalesce)) {
+    link(u, v);
+  }
 }
 
 uint32_t Node::colorable_limit() const {
@@ -119,6 +247,7 @@ void Graph::combine(reg_t u, reg_t v) {
     }
   }
   u_node.m_max_vreg = std::min(u_node.m_max_vreg, v_node.m_max_vreg);
+  u_node.m_encoding_benefit += v_node.m_encoding_benefit;
   u_node.m_type_domain.meet_with(v_node.m_type_domain);
   u_node.m_props |= v_node.m_props;
   v_node.m_props.reset(Node::ACTIVE);
@@ -185,11 +314,38 @@ vreg_t max_value_for_src(const IRInstruction* insn,
   return max_value;
 }
 
+// Whether any interaction of the profiles executed the source block.
+static bool is_hot(const SourceBlock* sb) {
+  for (size_t i = 0; i < sb->vals.size(); ++i) {
+    auto val = sb->get_val(i);
+    if (val && *val > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void GraphBuilder::update_node_constraints(const IRList::iterator& it,
                                            const RangeSet& range_set,
+                                           uint32_t encoding_weight,
                                            Graph* graph) {
   auto insn = it->insn;
   auto op = insn->opcode();
+  // A move takes one code unit if both of its registers are below 16, and two
+  // or three otherwise. A const of a 4-bit literal fits in a const/4 if its
+  // dest is below 16. A binop whose dest is its first src takes its /2addr
+  // form, one code unit shorter, if its registers are below 16.
+  if (opcode::is_a_move(op)) {
+    graph->m_nodes[insn->dest()].m_encoding_benefit += encoding_weight;
+    graph->m_nodes[insn->src(0)].m_encoding_benefit += encoding_weight;
+  } else if (op == OPCODE_CONST && insn->get_literal() >= -8 &&
+             insn->get_literal() <= 7) {
+    graph->m_nodes[insn->dest()].m_encoding_benefit += encoding_weight;
+  } else if (op >= OPCODE_ADD_INT && op <= OPCODE_REM_DOUBLE &&
+             insn->dest() == insn->src(0)) {
+    graph->m_nodes[insn->dest()].m_encoding_benefit += encoding_weight;
+    graph->m_nodes[insn->src(1)].m_encoding_benefit += encoding_weight;
+  }
   if (insn->has_dest()) {
     auto dest = insn->dest();
     auto& node = graph->m_nodes[dest];
@@ -272,9 +428,19 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
                           reg_t initial_regs,
                           const RangeSet& range_set) {
   Graph graph;
-  auto ii = InstructionIterable(code);
-  for (auto it = ii.begin(); it != ii.end(); ++it) {
-    GraphBuilder::update_node_constraints(it.unwrap(), range_set, &graph);
+  graph.m_adj_matrix.set_size(code->get_registers_size());
+  graph.m_containment_graph.set_size(code->get_registers_size());
+  graph.m_adj_matrix.begin_bulk();
+  graph.m_containment_graph.begin_bulk();
+  uint32_t encoding_weight = 1;
+  for (auto it = code->begin(); it != code->end(); ++it) {
+    if (it->type == MFLOW_SOURCE_BLOCK) {
+      encoding_weight =
+          is_hot(it->src_block.get()) ? Node::HOT_ENCODING_WEIGHT : 1;
+    } else if (it->type == MFLOW_OPCODE) {
+      GraphBuilder::update_node_constraints(it, range_set, encoding_weight,
+                                            &graph);
+    }
   }
 
   auto& cfg = code->cfg();
@@ -335,6 +501,12 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
       }
     }
   }
+  if (graph.m_adj_matrix.in_bulk()) {
+    graph.m_adj_matrix.end_bulk();
+    graph.m_adj_matrix.for_each(
+        [&graph](reg_t u, reg_t v) { graph.link(u, v); });
+  }
+  graph.m_containment_graph.end_bulk();
   for (auto& pair : graph.nodes()) {
     auto reg = pair.first;
     auto& node = pair.second;
@@ -365,11 +537,8 @@ std::ostream& Graph::write_dot_format(std::ostream& o) const {
   o << "}\n";
 
   o << "containment graph {\n";
-  for (const auto& pair : m_containment_graph) {
-    reg_t reg1 = static_cast<reg_t>((pair & 0xFFFFFFFF00000000) >> 32);
-    reg_t reg2 = static_cast<reg_t>(pair & 0x00000000FFFFFFFF);
-    o << reg1 << " -- " << reg2 << "\n";
-  }
+  m_containment_graph.for_each(
+      [&o](reg_t reg1, reg_t reg2) { o << reg1 << " -- " << reg2 << "\n"; });
   o << "}\n";
   return o;
 }
@@ -20,7 +20,6 @@
 namespace regalloc {
 
 using vreg_t = uint16_t;
-using reg_pair_t = uint64_t;
 
 inline vreg_t max_unsigned_value(bit_width_t bits) { return (1 << bits) - 1; }
 
@@ -73,20 +72,92 @@ namespace impl {
 
 class GraphBuilder;
 
-inline reg_pair_t build_containment_edge(reg_t u, reg_t v) {
-  reg_pair_t hi = static_cast<reg_pair_t>(u);
-  reg_pair_t lo = static_cast<reg_pair_t>(v);
-  return (hi << (sizeof(reg_t) * 8)) | lo;
-}
+/*
+ * A set of pairs of registers, each carrying a flag that can only go from
+ * false to true. If the set is symmetric, (u, v) and (v, u) are the same pair.
+ *
+ * Sets over at most MAX_MATRIX_REGS registers are bit-matrices (triangular
+ * ones if symmetric). Larger or unsized ones keep, for each register u, a
+ * sorted vector of the registers v it is paired with -- only those greater
+ * than u if symmetric -- with the flag in the lowest bit of each entry.
+ *
+ * While in bulk mode, the vectors are appended to without looking for
+ * duplicates, which are only merged when a vector has doubled in size and at
+ * the end. Lookups are only allowed outside of bulk mode. Bit-matrices ignore
+ * bulk mode.
+ */
+class PairSet {
+ public:
+  static constexpr reg_t MAX_MATRIX_REGS = 2048;
+
+  explicit PairSet(bool symmetric) : m_symmetric(symmetric) {}
+
+  // Must be called while the set is empty.
+  void set_size(reg_t regs);
+
+  bool contains(reg_t u, reg_t v) const;
+
+  // The flag of a pair that is in the set, or false if it is not.
+  bool get_flag(reg_t u, reg_t v) const;
+
+  // Returns whether the pair was new.
+  bool insert(reg_t u, reg_t v, bool flag);
+
+  bool in_bulk() const { return m_bulk; }
+
+  void begin_bulk() { m_bulk = !m_is_matrix; }
+
+  // Only allowed in bulk mode.
+  void append(reg_t u, reg_t v, bool flag);
+
+  void end_bulk();
+
+  template <typename Fn>
+  void for_each(const Fn& fn) const {
+    always_assert(!m_bulk);
+    if (m_is_matrix) {
+      for (reg_t u = 0; u < m_regs; ++u) {
+        for (reg_t v = m_symmetric ? u + 1 : 0; v < m_regs; ++v) {
+          if (m_present[index(u, v)]) {
+            fn(u, v);
+          }
+        }
+      }
+      return;
+    }
+    for (reg_t u = 0; u < m_lists.size(); ++u) {
+      for (auto entry : m_lists[u]) {
+        fn(u, entry >> 1);
+      }
+    }
+  }
 
-inline reg_pair_t build_edge(reg_t u, reg_t v) {
-  reg_pair_t hi = static_cast<reg_pair_t>(u);
-  reg_pair_t lo = static_cast<reg_pair_t>(v);
-  if (u > v) {
-    std::swap(hi, lo);
+ private:
+  size_t index(reg_t u, reg_t v) const {
+    if (!m_symmetric) {
+      return static_cast<size_t>(u) * m_regs + v;
+    }
+    if (u > v) {
+      std::swap(u, v);
+    }
+    return static_cast<size_t>(v) * (v - 1) / 2 + u;
   }
-  return (hi << (sizeof(reg_t) * 8)) | lo;
-}
+
+  // The list that holds the pair, and the entry of `v` in it, flag aside.
+  std::vector<uint32_t>* find_list(reg_t* u, reg_t* v);
+
+  void compact(reg_t u);
+
+  bool m_symmetric;
+  bool m_is_matrix{false};
+  bool m_bulk{false};
+  reg_t m_regs{0};
+  std::vector<bool> m_present;
+  std::vector<bool> m_flags;
+  std::vector<std::vector<uint32_t>> m_lists;
+  // The size of each list when it was last compacted.
+  std::vector<uint32_t> m_compacted_sizes;
+};
 
 } // namespace impl
 
@@ -127,6 +198,17 @@ class Node {
    */
   uint32_t spill_cost() const { return m_spill_cost; }
 
+  /*
+   * The code units that mapping this node to a register below 16 saves, in
+   * the instructions whose encoding grows with the registers they use: moves,
+   * consts of 4-bit literals and binops that can take their /2addr form. Uses
+   * in blocks that the source block profiles show as executed count
+   * HOT_ENCODING_WEIGHT times.
+   */
+  uint32_t encoding_benefit() const { return m_encoding_benefit; }
+
+  static constexpr uint32_t HOT_ENCODING_WEIGHT = 4;
+
   /*
    * The maximum vreg this node can be mapped to without spilling. Since
    * different opcodes have different maximums, this ends up being a per-node
@@ -158,6 +240,7 @@ class Node {
  private:
   uint32_t m_weight{0};
   uint32_t m_spill_cost{0};
+  uint32_t m_encoding_benefit{0};
   vreg_t m_max_vreg{max_unsigned_value(16)};
   // While the width is implicit in the register type, looking up the type to
   // determine the width is a little more expensive than storing the width
@@ -191,16 +274,15 @@ class Graph {
   }
 
   bool is_adjacent(reg_t u, reg_t v) const {
-    return m_adj_matrix.find(impl::build_edge(u, v)) != m_adj_matrix.end();
+    return m_adj_matrix.contains(u, v);
   }
 
   bool is_coalesceable(reg_t u, reg_t v) const {
-    return !is_adjacent(u, v) || !m_adj_matrix.at(impl::build_edge(u, v));
+    return !m_adj_matrix.get_flag(u, v);
   }
 
   bool has_containment_edge(reg_t u, reg_t v) const {
-    return m_containment_graph.find(impl::build_containment_edge(u, v)) !=
-           m_containment_graph.end();
+    return m_containment_graph.contains(u, v);
   }
 
   /*
@@ -233,13 +315,20 @@ class Graph {
     if (u == v) {
       return;
     }
-    m_containment_graph.emplace(impl::build_containment_edge(u, v));
+    if (m_containment_graph.in_bulk()) {
+      m_containment_graph.append(u, v, false);
+    } else {
+      m_containment_graph.insert(u, v, false);
+    }
   }
 
  private:
+  void link(reg_t u, reg_t v);
+
   std::unordered_map<reg_t, Node> m_nodes;
-  std::unordered_map<reg_pair_t, bool> m_adj_matrix;
-  std::unordered_set<reg_pair_t> m_containment_graph;
+  // The flag of an edge tells whether it is not coalesceable.
+  impl::PairSet m_adj_matrix{/* symmetric */ true};
+  impl::PairSet m_containment_graph{/* symmetric */ false};
   // This map contains the LivenessDomains for all instructions which could
   // potentialy take on the /range format.
   std::unordered_map<IRInstruction*, LivenessDomain> m_range_liveness;
@@ -274,6 +363,7 @@ inline uint32_t div_ceil(uint32_t a, uint32_t b) { return (a + b - 1) / b; }
 class GraphBuilder {
   static void update_node_constraints(const IRList::iterator&,
                                       const RangeSet&,
+                                      uint32_t encoding_weight,
                                       Graph*);
 
  public:
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "LinearScan.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include "ControlFlow.h"
+#include "Debug.h"
+#include "DexClass.h"
+#include "DexOpcode.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "Interference.h"
+#include "Liveness.h"
+#include "RegisterType.h"
+#include "Show.h"
+#include "Trace.h"
+#include "Transform.h"
+
+namespace regalloc {
+namespace linear_scan {
+
+using Stats = graph_coloring::Allocator::Stats;
+
+namespace {
+
+// No instruction other than the range-form ones reads more than four words
+// or writes more than two, and all of these must be addressable with four
+// bits.
+constexpr vreg_t SCRATCH_SRCS_SIZE = 4;
+constexpr vreg_t SCRATCH_SIZE = 6;
+
+constexpr size_t NO_POSITION = std::numeric_limits<size_t>::max();
+
+vreg_t width_of(bool is_wide) { return is_wide ? 2 : 1; }
+
+struct Intervals {
+  std::vector<size_t> starts;
+  std::vector<size_t> ends;
+};
+
+/*
+ * Each instruction gets a position in the order of the blocks, which for a
+ * non-editable CFG is the order of the instructions. A move-result-pseudo
+ * shares the position of its primary instruction, so that its dest overlaps
+ * everything that is live across the latter; this is what lowering a
+ * check-cast needs. (See the comment above GraphBuilder::build in
+ * Interference.cpp.)
+ *
+ * The interval of a symreg spans its defs and uses, and the start and end of
+ * the blocks it is live into and out of.
+ */
+Intervals build_intervals(IRCode* code) {
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+
+  auto regs = code->get_registers_size();
+  Intervals intervals;
+  intervals.starts.assign(regs, NO_POSITION);
+  intervals.ends.assign(regs, 0);
+  auto extend = [&intervals](reg_t reg, size_t pos) {
+    intervals.starts[reg] = std::min(intervals.starts[reg], pos);
+    intervals.ends[reg] = std::max(intervals.ends[reg], pos);
+  };
+
+  size_t next_pos = 0;
+  for (cfg::Block* block : cfg.blocks()) {
+    auto block_start = NO_POSITION;
+    auto pos = next_pos;
+    for (auto& mie : InstructionIterable(block)) {
+      auto insn = mie.insn;
+      if (opcode::is_a_move_result_pseudo(insn->opcode())) {
+        always_assert(next_pos > 0);
+        pos = next_pos - 1;
+      } else {
+        pos = next_pos++;
+      }
+      if (block_start == NO_POSITION) {
+        block_start = pos;
+      }
+      if (insn->has_dest()) {
+        extend(insn->dest(), pos);
+      }
+      for (auto src : insn->srcs()) {
+        extend(src, pos);
+      }
+    }
+    if (block_start == NO_POSITION) {
+      block_start = pos;
+    }
+    for (auto reg : fixpoint_iter.get_live_in_vars_at(block).elements()) {
+      extend(reg, block_start);
+    }
+    for (auto reg : fixpoint_iter.get_live_out_vars_at(block).elements()) {
+      extend(reg, pos);
+    }
+  }
+  return intervals;
+}
+
+// Whether the srcs of a range-form instruction can be encoded as they are,
+// either in the non-range form or in the range form.
+template <typename VRegOf>
+bool fits_range_form(const IRInstruction* insn, const VRegOf& vreg_of) {
+  if (insn->srcs_size() <= 1) {
+    return true;
+  }
+  size_t words{0};
+  bool fits_non_range{true};
+  bool contiguous{true};
+  auto next = vreg_of(insn->src(0));
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    auto is_wide = insn->src_is_wide(i);
+    auto vreg = vreg_of(insn->src(i));
+    words += width_of(is_wide);
+    fits_non_range =
+        fits_non_range && vreg <= max_value_for_src(insn, i, is_wide);
+    contiguous = contiguous && vreg == next;
+    next = vreg + width_of(is_wide);
+  }
+  return (fits_non_range && words <= dex_opcode::NON_RANGE_MAX) || contiguous;
+}
+
+vreg_t src_words(const IRInstruction* insn) {
+  vreg_t words{0};
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    words += width_of(insn->src_is_wide(i));
+  }
+  return words;
+}
+
+// Whether some operand of a non-range-form instruction is assigned a register
+// that the instruction cannot address.
+template <typename VRegOf>
+bool needs_scratch(const IRList::iterator& it, const VRegOf& vreg_of) {
+  auto insn = it->insn;
+  if (insn->has_dest() &&
+      vreg_of(insn->dest()) > max_unsigned_value(dest_bit_width(it))) {
+    return true;
+  }
+  if (opcode::is_an_internal(insn->opcode())) {
+    return false;
+  }
+  for (size_t i = 0; i < insn->srcs_size(); ++i) {
+    if (vreg_of(insn->src(i)) >
+        max_value_for_src(insn, i, insn->src_is_wide(i))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+Stats allocate(const graph_coloring::Allocator::Config& config,
+               DexMethod* method) {
+  Stats stats;
+  stats.linear_scan_methods = 1;
+  IRCode* code = method->get_code();
+  if (config.no_overwrite_this && !is_static(method)) {
+    graph_coloring::dedicate_this_register(method);
+  }
+
+  auto regs = code->get_registers_size();
+  std::vector<RegisterTypeDomain> types(
+      regs, RegisterTypeDomain(RegisterType::UNKNOWN));
+  std::vector<bool> is_wide(regs, false);
+  for (const auto& mie : InstructionIterable(code)) {
+    auto insn = mie.insn;
+    if (insn->has_dest()) {
+      types[insn->dest()].meet_with(RegisterTypeDomain(dest_reg_type(insn)));
+      if (insn->dest_is_wide()) {
+        is_wide[insn->dest()] = true;
+      }
+    }
+    for (size_t i = 0; i < insn->srcs_size(); ++i) {
+      types[insn->src(i)].meet_with(
+          RegisterTypeDomain(src_reg_type(insn, i)));
+    }
+  }
+
+  // The params stay in their own registers at the end of the frame. Their
+  // offsets are relative to the start of the params.
+  std::vector<bool> is_param(regs, false);
+  std::vector<vreg_t> assigned(regs, 0);
+  vreg_t params_size{0};
+  for (const auto& mie : InstructionIterable(code->get_param_instructions())) {
+    auto dest = mie.insn->dest();
+    is_param[dest] = true;
+    assigned[dest] = params_size;
+    params_size += width_of(mie.insn->dest_is_wide());
+  }
+
+  auto intervals = build_intervals(code);
+  std::vector<reg_t> order;
+  for (reg_t reg = 0; reg < regs; ++reg) {
+    if (intervals.starts[reg] != NO_POSITION && !is_param[reg]) {
+      order.push_back(reg);
+    }
+  }
+  std::sort(order.begin(), order.end(), [&intervals](reg_t a, reg_t b) {
+    auto start_a = intervals.starts[a];
+    auto start_b = intervals.starts[b];
+    return start_a != start_b ? start_a < start_b : a < b;
+  });
+
+  // Assign the intervals to the lowest free register(s), freeing the
+  // registers of the intervals that ended before the current one starts.
+  using Active = std::pair<size_t, reg_t>;
+  std::priority_queue<Active, std::vector<Active>, std::greater<Active>>
+      active;
+  std::vector<bool> used;
+  auto is_free = [&used](vreg_t vreg) {
+    return vreg >= used.size() || !used[vreg];
+  };
+  vreg_t general_size{0};
+  for (auto reg : order) {
+    auto width = width_of(is_wide[reg]);
+    while (!active.empty() && active.top().first < intervals.starts[reg]) {
+      auto expired = active.top().second;
+      active.pop();
+      for (vreg_t i = 0; i < width_of(is_wide[expired]); ++i) {
+        used[assigned[expired] + i] = false;
+      }
+    }
+    vreg_t vreg{0};
+    while (!is_free(vreg) || (width == 2 && !is_free(vreg + 1))) {
+      ++vreg;
+    }
+    if (used.size() < size_t(vreg + width)) {
+      used.resize(vreg + width, false);
+    }
+    for (vreg_t i = 0; i < width; ++i) {
+      used[vreg + i] = true;
+    }
+    assigned[reg] = vreg;
+    general_size = std::max<vreg_t>(general_size, vreg + width);
+    active.emplace(intervals.ends[reg], reg);
+  }
+
+  // The frame is laid out as scratch registers, general registers, the
+  // region for range-form srcs, and the params. Growing the first and third
+  // parts moves the other registers up and may make more instructions need
+  // them, so iterate until neither needs to grow.
+  vreg_t scratch_size{0};
+  vreg_t range_size{0};
+  auto vreg_of = [&](reg_t reg) -> vreg_t {
+    return is_param[reg]
+               ? scratch_size + general_size + range_size + assigned[reg]
+               : scratch_size + assigned[reg];
+  };
+  auto ii = InstructionIterable(code);
+  while (true) {
+    vreg_t range_needed{0};
+    bool scratch_needed{false};
+    for (auto it = ii.begin(); it != ii.end(); ++it) {
+      auto insn = it->insn;
+      if (opcode::has_range_form(insn->opcode())) {
+        if (!fits_range_form(insn, vreg_of)) {
+          range_needed = std::max(range_needed, src_words(insn));
+        }
+      } else if (needs_scratch(it.unwrap(), vreg_of)) {
+        scratch_needed = true;
+      }
+    }
+    bool changed{false};
+    if (range_needed > range_size) {
+      range_size = range_needed;
+      changed = true;
+    }
+    if (scratch_needed && scratch_size == 0) {
+      scratch_size = SCRATCH_SIZE;
+      changed = true;
+    }
+    if (!changed) {
+      break;
+    }
+  }
+
+  transform::RegMap reg_map;
+  for (reg_t reg = 0; reg < regs; ++reg) {
+    if (intervals.starts[reg] != NO_POSITION || is_param[reg]) {
+      reg_map.emplace(reg, vreg_of(reg));
+    }
+  }
+  auto range_base = scratch_size + general_size;
+  auto identity = [](reg_t reg) { return reg; };
+  std::vector<RegisterType> src_types;
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto insn = it->insn;
+    src_types.clear();
+    for (auto src : insn->srcs()) {
+      src_types.push_back(types[src].element());
+    }
+    auto dest_type =
+        insn->has_dest() ? types[insn->dest()].element() : RegisterType::SIZE;
+    transform::remap_registers(insn, reg_map);
+
+    if (opcode::has_range_form(insn->opcode())) {
+      if (fits_range_form(insn, identity)) {
+        continue;
+      }
+      vreg_t offset = range_base;
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        code->insert_before(it.unwrap(),
+                            gen_move(src_types[i], offset, insn->src(i)));
+        insn->set_src(i, offset);
+        offset += width_of(insn->src_is_wide(i));
+        ++stats.linear_scan_moves;
+      }
+      continue;
+    }
+
+    if (!opcode::is_an_internal(insn->opcode())) {
+      vreg_t offset{0};
+      for (size_t i = 0; i < insn->srcs_size(); ++i) {
+        auto is_wide_src = insn->src_is_wide(i);
+        if (insn->src(i) <= max_value_for_src(insn, i, is_wide_src)) {
+          continue;
+        }
+        always_assert(offset + width_of(is_wide_src) <= SCRATCH_SRCS_SIZE);
+        code->insert_before(it.unwrap(),
+                            gen_move(src_types[i], offset, insn->src(i)));
+        insn->set_src(i, offset);
+        offset += width_of(is_wide_src);
+        ++stats.linear_scan_moves;
+      }
+    }
+    if (insn->has_dest() &&
+        insn->dest() > max_unsigned_value(dest_bit_width(it.unwrap()))) {
+      auto dest = insn->dest();
+      insn->set_dest(SCRATCH_SRCS_SIZE);
+      it.reset(code->insert_after(
+          it.unwrap(), gen_move(dest_type, dest, SCRATCH_SRCS_SIZE)));
+      ++stats.linear_scan_moves;
+    }
+  }
+  code->set_registers_size(scratch_size + general_size + range_size +
+                           params_size);
+
+  TRACE(REG, 3, "Linear scan: %u scratch, %u general, %u range, %u params",
+        scratch_size, general_size, range_size, params_size);
+  TRACE(REG, 3, "Linear scan moves: %lu", stats.linear_scan_moves);
+  return stats;
+}
+
+} // namespace linear_scan
+} // namespace regalloc
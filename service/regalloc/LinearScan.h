@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include "GraphColoring.h"
+
+class DexMethod;
+
+namespace regalloc {
+namespace linear_scan {
+
+/*
+ * A linear-scan allocator for methods that are too large for the graph
+ * coloring allocator to finish in reasonable time. It trades register
+ * pressure and move count for speed:
+ *
+ *   * Every symreg gets a single live interval, the hull of the positions at
+ *     which it is live in the linear order of the instructions. Symregs whose
+ *     intervals overlap never share a register.
+ *
+ *   * The intervals are assigned greedily, in order of their start, to the
+ *     lowest free register(s). Nothing is ever spilled or split; instead,
+ *     operands that end up in registers their instruction cannot address are
+ *     copied to and from a few scratch registers at the bottom of the frame,
+ *     and the srcs of invoke and filled-new-array instructions that fit
+ *     neither the non-range nor the range encoding are copied to a dedicated
+ *     region just below the params.
+ *
+ * The params are dedicated to the registers at the end of the frame.
+ *
+ * Like graph_coloring::Allocator::allocate, this expects the registers to be
+ * renumbered and a non-editable CFG to be built.
+ */
+graph_coloring::Allocator::Stats allocate(
+    const graph_coloring::Allocator::Config&, DexMethod*);
+
+} // namespace linear_scan
+} // namespace regalloc
@@ -16,6 +16,7 @@
 #include "GraphColoring.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
+#include "LinearScan.h"
 #include "LiveRange.h"
 #include "PassManager.h"
 #include "Show.h"
@@ -41,6 +42,13 @@ Stats allocate(const Config& allocator_config, DexMethod* m) {
     // The transformations below all require a CFG. Build it once
     // here instead of requiring each transform to build it.
     code.build_cfg(/* editable */ false);
+    if (allocator_config.linear_scan_threshold != 0 &&
+        code.count_opcodes() >= allocator_config.linear_scan_threshold) {
+      auto stats = linear_scan::allocate(allocator_config, m);
+      TRACE(REG, 5, "After linear scan: regs:%d code:\n%s",
+            code.get_registers_size(), SHOW(&code));
+      return stats;
+    }
     Allocator allocator(allocator_config);
     allocator.allocate(m);
     TRACE(REG, 5, "After alloc: regs:%d code:\n%s", code.get_registers_size(),
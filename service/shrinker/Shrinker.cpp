@@ -7,11 +7,14 @@
 
 #include "Shrinker.h"
 
+#include <chrono>
+
 #include "ConstructorParams.h"
 #include "RandomForest.h"
 #include "RegisterAllocation.h"
 #include "ScopedMetrics.h"
 #include "Trace.h"
+#include "WorkQueue.h"
 
 namespace shrinker {
 
@@ -74,7 +77,8 @@ Shrinker::Shrinker(
     const Scope& scope,
     const ShrinkerConfig& config,
     const std::unordered_set<DexMethodRef*>& configured_pure_methods,
-    const std::unordered_set<DexString*>& configured_finalish_field_names)
+    const std::unordered_set<DexString*>& configured_finalish_field_names,
+    purity::AnalysisCache* purity_cache)
     : m_forest(load(config.reg_alloc_random_forest)),
       m_xstores(stores),
       m_config(config),
@@ -93,24 +97,38 @@ Shrinker::Shrinker(
     if (config.run_cse) {
       m_cse_shared_state = std::make_unique<cse_impl::SharedState>(
           m_pure_methods, m_finalish_field_names);
+      m_cse_shared_state->init_scope(scope, purity_cache);
     }
     if (config.run_local_dce && config.compute_pure_methods) {
-      std::unique_ptr<const method_override_graph::Graph> owned_override_graph;
+      std::shared_ptr<const method_override_graph::Graph> owned_override_graph;
       const method_override_graph::Graph* override_graph;
       if (config.run_cse) {
         override_graph = m_cse_shared_state->get_method_override_graph();
+      } else if (purity_cache) {
+        owned_override_graph = purity_cache->get_method_override_graph(scope);
+        override_graph = owned_override_graph.get();
       } else {
         owned_override_graph = method_override_graph::build_graph(scope);
         override_graph = owned_override_graph.get();
       }
       std::unordered_set<const DexMethod*> computed_no_side_effects_methods;
-      /* Returns computed_no_side_effects_methods_iterations */
-      compute_no_side_effects_methods(scope, override_graph, m_pure_methods,
-                                      &computed_no_side_effects_methods);
+      if (purity_cache) {
+        size_t iterations;
+        computed_no_side_effects_methods =
+            purity_cache->get_no_side_effects_methods(
+                scope, override_graph, m_pure_methods, &iterations);
+      } else {
+        /* Returns computed_no_side_effects_methods_iterations */
+        compute_no_side_effects_methods(scope, override_graph, m_pure_methods,
+                                        &computed_no_side_effects_methods);
+      }
       for (auto m : computed_no_side_effects_methods) {
         m_pure_methods.insert(const_cast<DexMethod*>(m));
       }
     }
+    if (config.run_local_dce) {
+      m_pure_method_ids = LocalDce::make_pure_method_ids(m_pure_methods);
+    }
   }
   if (config.run_const_prop && config.analyze_constructors) {
     constant_propagation::immutable_state::analyze_constructors(
@@ -128,6 +146,11 @@ void Shrinker::shrink_method(DexMethod* method) {
   LocalDce::Stats local_dce_stats;
   dedup_blocks_impl::Stats dedup_blocks_stats;
 
+  // The editable CFG of the caller is not reused throughout: the main
+  // constant-propagation transform and the register allocator only work on
+  // the non-editable CFG, so the editable one is dropped before each of them
+  // and rebuilt for what follows. CSE, copy propagation and local DCE share
+  // the one built after constant propagation.
   if (m_config.run_const_prop) {
     auto timer = m_const_prop_timer.scope();
     if (editable_cfg_built) {
@@ -143,27 +166,41 @@ void Shrinker::shrink_method(DexMethod* method) {
               &m_immut_analyzer_state, &m_immut_analyzer_state,
               constant_propagation::EnumFieldAnalyzerState::get(),
               constant_propagation::BoxedBooleanAnalyzerState::get(), nullptr));
+      fp_iter.set_budget(m_config.const_prop_max_steps,
+                         std::chrono::milliseconds(m_config.const_prop_max_ms));
       fp_iter.run({});
-      constant_propagation::Transform::Config config;
-      constant_propagation::Transform tf(config);
-      const_prop_stats = tf.apply_on_uneditable_cfg(
-          fp_iter, constant_propagation::WholeProgramState(), code, &m_xstores,
-          method->get_class());
+      if (fp_iter.budget_exceeded()) {
+        TRACE(MMINL, 2, "Constant propagation over budget: %s", SHOW(method));
+        const_prop_stats.methods_over_budget = 1;
+      } else {
+        constant_propagation::Transform::Config config;
+        constant_propagation::Transform tf(config);
+        const_prop_stats = tf.apply_on_uneditable_cfg(
+            fp_iter, constant_propagation::WholeProgramState(), code,
+            &m_xstores, method->get_class());
+      }
     }
     always_assert(!code->editable_cfg_built());
     code->build_cfg(/* editable */ true);
     code->cfg().calculate_exit_block();
-    {
+    if (const_prop_stats.methods_over_budget == 0) {
       constant_propagation::intraprocedural::FixpointIterator fp_iter(
           code->cfg(),
           constant_propagation::ConstantPrimitiveAndBoxedAnalyzer(
               &m_immut_analyzer_state, &m_immut_analyzer_state,
               constant_propagation::EnumFieldAnalyzerState::get(),
               constant_propagation::BoxedBooleanAnalyzerState::get(), nullptr));
+      fp_iter.set_budget(m_config.const_prop_max_steps,
+                         std::chrono::milliseconds(m_config.const_prop_max_ms));
       fp_iter.run({});
-      constant_propagation::Transform::Config config;
-      constant_propagation::Transform tf(config);
-      const_prop_stats += tf.apply(fp_iter, code->cfg(), method, &m_xstores);
+      if (fp_iter.budget_exceeded()) {
+        TRACE(MMINL, 2, "Constant propagation over budget: %s", SHOW(method));
+        const_prop_stats.methods_over_budget = 1;
+      } else {
+        constant_propagation::Transform::Config config;
+        constant_propagation::Transform tf(config);
+        const_prop_stats += tf.apply(fp_iter, code->cfg(), method, &m_xstores);
+      }
     }
   }
 
@@ -191,7 +228,9 @@ void Shrinker::shrink_method(DexMethod* method) {
   if (m_config.run_local_dce) {
     auto timer = m_local_dce_timer.scope();
     // LocalDce doesn't care if editable_cfg_built
-    auto local_dce = LocalDce(m_pure_methods);
+    auto local_dce =
+        LocalDce(m_pure_methods, /* method_override_graph */ nullptr,
+                 /* may_allocate_registers */ false, &m_pure_method_ids);
     local_dce.dce(code);
     local_dce_stats = local_dce.get_stats();
   }
@@ -283,6 +322,21 @@ void Shrinker::shrink_method(DexMethod* method) {
   m_methods_reg_alloced += reg_alloc_inc;
 }
 
+void Shrinker::shrink_methods(const std::vector<DexMethod*>& methods) {
+  workqueue_run_by_cost<DexMethod*>(
+      [this](DexMethod* method) {
+        if (method->get_code() != nullptr) {
+          TraceContext context(method);
+          shrink_method(method);
+        }
+      },
+      methods,
+      [](DexMethod* method) {
+        auto code = method->get_code();
+        return code ? code->sum_opcode_sizes() : 0;
+      });
+}
+
 void Shrinker::log_metrics(ScopedMetrics& sm) const {
   auto scope = sm.scope("shrinker");
   m_const_prop_stats.log_metrics(sm);
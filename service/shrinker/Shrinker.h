@@ -27,14 +27,21 @@ namespace shrinker {
 
 class Shrinker {
  public:
+  // When given, the scope-wide analyses that CSE and local DCE need are taken
+  // from (and added to) :purity_cache.
   Shrinker(
       DexStoresVector& stores,
       const Scope& scope,
       const ShrinkerConfig& config,
       const std::unordered_set<DexMethodRef*>& configured_pure_methods = {},
       const std::unordered_set<DexString*>& configured_finalish_field_names =
-          {});
+          {},
+      purity::AnalysisCache* purity_cache = nullptr);
   void shrink_method(DexMethod* method);
+
+  // Shrinks the given methods in parallel, biggest first, so that a few huge
+  // methods do not end up being processed last.
+  void shrink_methods(const std::vector<DexMethod*>& methods);
   const constant_propagation::Transform::Stats& get_const_prop_stats() const {
     return m_const_prop_stats;
   }
@@ -105,6 +112,8 @@ class Shrinker {
   std::unique_ptr<cse_impl::SharedState> m_cse_shared_state;
 
   std::unordered_set<DexMethodRef*> m_pure_methods;
+  // The pure methods as LocalDce wants them, for when it runs.
+  boost::dynamic_bitset<> m_pure_method_ids;
   std::unordered_set<DexString*> m_finalish_field_names;
 
   constant_propagation::ImmutableAttributeAnalyzerState m_immut_analyzer_state;
@@ -19,6 +19,10 @@ using namespace type_analyzer;
 
 namespace {
 
+bool returns_reference(const DexMethod* method) {
+  return type::is_object(method->get_proto()->get_rtype());
+}
+
 void trace_whole_program_state(WholeProgramState& wps) {
   if (traceEnabled(TYPE, 10)) {
     std::ostringstream out;
@@ -137,30 +141,10 @@ void GlobalTypeAnalyzer::analyze_node(
   if (code == nullptr) {
     return;
   }
-  auto& cfg = code->cfg();
-  auto intra_ta = get_local_analysis(method);
-  const auto outgoing_edges =
-      call_graph::GraphInterface::successors(m_call_graph, node);
-  std::unordered_set<IRInstruction*> outgoing_insns;
-  for (const auto& edge : outgoing_edges) {
-    if (edge->callee() == m_call_graph.exit()) {
-      continue; // ghost edge to the ghost exit node
-    }
-    outgoing_insns.emplace(edge->invoke_iterator()->insn);
-  }
-  for (auto* block : cfg.blocks()) {
-    auto state = intra_ta->get_entry_state_at(block);
-    for (auto& mie : InstructionIterable(block)) {
-      auto* insn = mie.insn;
-      if (insn->has_method() && outgoing_insns.count(insn)) {
-        ArgumentTypeEnvironment out_args;
-        for (size_t i = 0; i < insn->srcs_size(); ++i) {
-          out_args.set(i, state.get(insn->src(i)));
-        }
-        current_partition->set(insn, out_args);
-      }
-      intra_ta->analyze_instruction(insn, &state);
-    }
+  const auto& args = current_partition->get(CURRENT_PARTITION_LABEL);
+  auto summary = get_method_summary(method, args);
+  for (const auto& pair : summary->invoke_args) {
+    current_partition->set(pair.first, pair.second);
   }
 }
 
@@ -192,6 +176,123 @@ GlobalTypeAnalyzer::get_local_analysis(const DexMethod* method) const {
                         args.get(CURRENT_PARTITION_LABEL));
 }
 
+std::shared_ptr<const MethodSummary> GlobalTypeAnalyzer::get_method_summary(
+    const DexMethod* method) const {
+  auto args = ArgumentTypePartition::bottom();
+
+  if (m_call_graph.has_node(method)) {
+    args = this->get_entry_state_at(m_call_graph.node(method));
+  }
+  return get_method_summary(method, args.get(CURRENT_PARTITION_LABEL));
+}
+
+std::shared_ptr<const MethodSummary> GlobalTypeAnalyzer::get_method_summary(
+    const DexMethod* method, ArgumentTypeEnvironment args) const {
+  // Same as in analyze_method().
+  if (args.is_bottom()) {
+    args.set_to_top();
+  }
+  auto summary = m_summaries.get(method, nullptr);
+  if (summary != nullptr && summary->args.equals(args)) {
+    m_reused_summaries++;
+    return summary;
+  }
+  summary = summarize_method(method, args);
+  m_summaries.insert_or_assign(std::make_pair(method, summary));
+  m_computed_summaries++;
+  return summary;
+}
+
+std::shared_ptr<const MethodSummary> GlobalTypeAnalyzer::summarize_method(
+    const DexMethod* method, const ArgumentTypeEnvironment& args) const {
+  auto summary = std::make_shared<MethodSummary>();
+  summary->args = args;
+  auto& cfg = method->get_code()->cfg();
+  auto intra_ta = analyze_method(method, *m_wps, args);
+  std::unordered_set<const IRInstruction*> outgoing_insns;
+  if (m_call_graph.has_node(method)) {
+    const auto outgoing_edges = call_graph::GraphInterface::successors(
+        m_call_graph, m_call_graph.node(method));
+    for (const auto& edge : outgoing_edges) {
+      if (edge->callee() == m_call_graph.exit()) {
+        continue; // ghost edge to the ghost exit node
+      }
+      outgoing_insns.emplace(edge->invoke_iterator()->insn);
+    }
+  }
+  bool returns_ref = returns_reference(method);
+  for (auto* block : cfg.blocks()) {
+    auto state = intra_ta->get_entry_state_at(block);
+    for (auto& mie : InstructionIterable(block)) {
+      auto* insn = mie.insn;
+      auto op = insn->opcode();
+      if (insn->has_method() && outgoing_insns.count(insn)) {
+        ArgumentTypeEnvironment out_args;
+        for (size_t i = 0; i < insn->srcs_size(); ++i) {
+          out_args.set(i, state.get(insn->src(i)));
+        }
+        summary->invoke_args.emplace_back(insn, std::move(out_args));
+      }
+      intra_ta->analyze_instruction(insn, &state);
+
+      if (insn->has_field()) {
+        auto field = resolve_field(insn->get_field());
+        if (field != nullptr && type::is_object(field->get_type())) {
+          if (opcode::is_an_sput(op) || opcode::is_an_iput(op)) {
+            summary->field_types.emplace_back(field, state.get(insn->src(0)));
+          } else {
+            summary->read_fields.push_back(field);
+          }
+        }
+      } else if (opcode::is_an_invoke(op)) {
+        if (!m_wps->get_type_for_method_with_known_type(insn->get_method())) {
+          auto callee =
+              resolve_method(insn->get_method(), opcode_to_search(insn));
+          if (callee != nullptr && returns_reference(callee)) {
+            summary->read_returns.push_back(callee);
+          }
+        }
+      } else if (opcode::is_a_return(op)) {
+        // A void method is still recorded as returning Top, which tells that
+        // the code following its invocations is reachable.
+        summary->return_types.push_back(
+            returns_ref ? state.get(insn->src(0)) : DexTypeDomain::top());
+      }
+    }
+  }
+  if (method::is_any_init(method)) {
+    summary->exit_env = intra_ta->get_exit_state_at(cfg.exit_block());
+  }
+  return summary;
+}
+
+void GlobalTypeAnalyzer::set_whole_program_state(
+    std::unique_ptr<WholeProgramState> wps) {
+  std::vector<const DexMethod*> stale;
+  for (const auto& pair : m_summaries) {
+    const auto& summary = *pair.second;
+    auto field_changed = [&](const DexField* field) {
+      return !m_wps->get_field_type(field).equals(wps->get_field_type(field));
+    };
+    auto return_changed = [&](const DexMethod* callee) {
+      return !m_wps->get_return_type(callee).equals(
+          wps->get_return_type(callee));
+    };
+    if (std::any_of(summary.read_fields.begin(), summary.read_fields.end(),
+                    field_changed) ||
+        std::any_of(summary.read_returns.begin(), summary.read_returns.end(),
+                    return_changed)) {
+      stale.push_back(pair.first);
+    }
+  }
+  for (auto* method : stale) {
+    m_summaries.erase(method);
+  }
+  TRACE(TYPE, 2, "[global] %zu of %zu method summaries are stale",
+        stale.size(), m_summaries.size() + stale.size());
+  m_wps = std::move(wps);
+}
+
 bool GlobalTypeAnalyzer::is_reachable(const DexMethod* method) const {
   auto args = ArgumentTypePartition::bottom();
 
@@ -396,8 +497,12 @@ void GlobalTypeAnalysis::find_any_init_reachables(
 }
 
 std::unique_ptr<GlobalTypeAnalyzer> GlobalTypeAnalysis::analyze(
-    const Scope& scope) {
-  auto method_override_graph = mog::build_graph(scope);
+    const Scope& scope, const mog::Graph* method_override_graph) {
+  std::unique_ptr<const mog::Graph> owned_method_override_graph;
+  if (method_override_graph == nullptr) {
+    owned_method_override_graph = mog::build_graph(scope);
+    method_override_graph = owned_method_override_graph.get();
+  }
   call_graph::Graph cg =
       call_graph::single_callee_graph(*method_override_graph, scope);
   // Rebuild all CFGs here -- this should be more efficient than doing them
@@ -445,6 +550,8 @@ std::unique_ptr<GlobalTypeAnalyzer> GlobalTypeAnalysis::analyze(
         "[global] Finished in %zu global iterations (max %zu)",
         iteration_cnt,
         m_max_global_analysis_iteration);
+  TRACE(TYPE, 1, "[global] Computed %zu method summaries, reused %zu",
+        gta->get_num_computed_summaries(), gta->get_num_reused_summaries());
   return gta;
 }
 
@@ -7,7 +7,12 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "CallGraph.h"
+#include "ConcurrentContainers.h"
 #include "DexTypeEnvironment.h"
 #include "HashedAbstractPartition.h"
 #include "LocalTypeAnalyzer.h"
@@ -57,6 +62,31 @@ constexpr const IRInstruction* CURRENT_PARTITION_LABEL = nullptr;
 DexTypeEnvironment env_with_params(const IRCode* code,
                                    const ArgumentTypeEnvironment& args);
 
+/*
+ * What the local analysis of a method under a given WholeProgramState
+ * contributes to the global analysis. Methods whose arguments and whose read
+ * parts of the WholeProgramState don't change between global iterations keep
+ * their summary instead of being analyzed again.
+ */
+struct MethodSummary {
+  // The arguments that the method was analyzed with. Never Bottom.
+  ArgumentTypeEnvironment args;
+  // The arguments passed at the invocations that are edges of the call graph.
+  std::vector<std::pair<const IRInstruction*, ArgumentTypeEnvironment>>
+      invoke_args;
+  // The types written to fields and returned, as collected by the
+  // WholeProgramState.
+  std::vector<std::pair<const DexField*, DexTypeDomain>> field_types;
+  std::vector<DexTypeDomain> return_types;
+  // The exit state of <clinit>s and <init>s, which tells which fields they
+  // initialize.
+  DexTypeEnvironment exit_env;
+  // The fields and the method returns that the analysis read from the
+  // WholeProgramState.
+  std::vector<const DexField*> read_fields;
+  std::vector<const DexMethod*> read_returns;
+};
+
 /*
  * Performs interprocedural DexType analysis of stack / register values.
  * The intraprocedural propagation logic is delegated to the LocalTypeAnalyzer.
@@ -87,11 +117,23 @@ class GlobalTypeAnalyzer : public sparta::ParallelMonotonicFixpointIterator<
   std::unique_ptr<local::LocalTypeAnalyzer> get_local_analysis(
       const DexMethod*) const;
 
+  /*
+   * The summary of the given method under the current WholeProgramState, for
+   * its arguments from the last run.
+   */
+  std::shared_ptr<const MethodSummary> get_method_summary(
+      const DexMethod*) const;
+
   const WholeProgramState& get_whole_program_state() const { return *m_wps; }
 
-  void set_whole_program_state(std::unique_ptr<WholeProgramState> wps) {
-    m_wps = std::move(wps);
-  }
+  /*
+   * Also drops the summaries that read parts of the WholeProgramState that
+   * changed.
+   */
+  void set_whole_program_state(std::unique_ptr<WholeProgramState> wps);
+
+  size_t get_num_computed_summaries() const { return m_computed_summaries; }
+  size_t get_num_reused_summaries() const { return m_reused_summaries; }
 
   const call_graph::Graph& get_call_graph() { return m_call_graph; }
 
@@ -105,6 +147,17 @@ class GlobalTypeAnalyzer : public sparta::ParallelMonotonicFixpointIterator<
       const DexMethod* method,
       const WholeProgramState& wps,
       ArgumentTypeEnvironment args) const;
+
+  std::shared_ptr<const MethodSummary> get_method_summary(
+      const DexMethod* method, ArgumentTypeEnvironment args) const;
+
+  std::shared_ptr<const MethodSummary> summarize_method(
+      const DexMethod* method, const ArgumentTypeEnvironment& args) const;
+
+  mutable ConcurrentMap<const DexMethod*, std::shared_ptr<const MethodSummary>>
+      m_summaries;
+  mutable std::atomic<size_t> m_computed_summaries{0};
+  mutable std::atomic<size_t> m_reused_summaries{0};
 };
 
 class GlobalTypeAnalysis {
@@ -115,7 +168,10 @@ class GlobalTypeAnalysis {
 
   void run(Scope& scope) { analyze(scope); }
 
-  std::unique_ptr<GlobalTypeAnalyzer> analyze(const Scope&);
+  // Builds its own method override graph when none is given.
+  std::unique_ptr<GlobalTypeAnalyzer> analyze(
+      const Scope&,
+      const method_override_graph::Graph* method_override_graph = nullptr);
 
  private:
   size_t m_max_global_analysis_iteration;
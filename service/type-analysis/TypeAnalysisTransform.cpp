@@ -9,6 +9,8 @@
 
 #include "DexInstruction.h"
 #include "KotlinNullCheckMethods.h"
+#include "MethodOverrideGraph.h"
+#include "Resolver.h"
 #include "Show.h"
 
 using namespace kotlin_nullcheck_wrapper;
@@ -137,6 +139,75 @@ void Transform::remove_redundant_type_checks(const DexTypeEnvironment& env,
   }
 }
 
+void Transform::refine_virtual_callsite(const DexTypeEnvironment& env,
+                                        DexMethod* caller,
+                                        const IRList::iterator& it,
+                                        Stats& stats) {
+  auto insn = it->insn;
+  auto val = env.get(insn->src(0));
+  if (val.is_top() || val.is_bottom() || val.is_null()) {
+    return;
+  }
+  auto val_type = val.get_dex_type();
+  if (!val_type) {
+    return;
+  }
+  auto receiver_cls = type_class(*val_type);
+  if (!receiver_cls || receiver_cls->is_external() ||
+      is_interface(receiver_cls)) {
+    return;
+  }
+  auto mref = insn->get_method();
+  auto callee = resolve_method(receiver_cls, mref->get_name(),
+                               mref->get_proto(), MethodSearch::Virtual);
+  if (!callee || callee == mref || is_abstract(callee)) {
+    return;
+  }
+  auto callee_cls = type_class(callee->get_class());
+  if (!callee_cls || callee_cls->is_external() || is_interface(callee_cls)) {
+    return;
+  }
+  // The caller must be able to reference the callee directly.
+  if ((!is_public(callee) || !is_public(callee_cls)) &&
+      !type::same_package(caller->get_class(), callee->get_class())) {
+    return;
+  }
+  // Any subclass of the receiver type could dispatch elsewhere.
+  for (auto overriding :
+       method_override_graph::get_overriding_methods(*m_method_override_graph,
+                                                     callee)) {
+    if (type::check_cast(overriding->get_class(), *val_type)) {
+      return;
+    }
+  }
+
+  // The verifier only knows the receiver type that local inference finds,
+  // which may be less precise than the global one.
+  if (!m_type_inference) {
+    m_type_inference = std::make_unique<type_inference::TypeInference>(
+        caller->get_code()->cfg());
+    m_type_inference->run(caller);
+  }
+  auto& envs = m_type_inference->get_type_environments();
+  auto local_type = envs.at(insn).get_dex_type(insn->src(0));
+  if (!local_type || !type::check_cast(*local_type, callee->get_class())) {
+    auto cast = new IRInstruction(OPCODE_CHECK_CAST);
+    cast->set_src(0, insn->src(0))->set_type(callee->get_class());
+    insn->set_src(0, caller->get_code()->allocate_temp());
+    m_casts.emplace_back(it, cast);
+    stats.refined_callsite_casts++;
+  }
+
+  TRACE(TYPE_TRANSFORM, 5, "Refining %s to %s", SHOW(insn), SHOW(callee));
+  if (opcode::is_invoke_interface(insn->opcode())) {
+    insn->set_opcode(OPCODE_INVOKE_VIRTUAL);
+    stats.interface_callsite_refined++;
+  } else {
+    stats.virtual_callsite_refined++;
+  }
+  insn->set_method(callee);
+}
+
 Transform::Stats Transform::apply(
     const type_analyzer::local::LocalTypeAnalyzer& lta,
     const WholeProgramState& wps,
@@ -169,6 +240,11 @@ Transform::Stats Transform::apply(
           stats.kotlin_null_check_removed++;
         }
       }
+      if (m_config.refine_virtual_callsites && m_method_override_graph &&
+          (insn->opcode() == OPCODE_INVOKE_VIRTUAL ||
+           insn->opcode() == OPCODE_INVOKE_INTERFACE)) {
+        refine_virtual_callsite(env, method, it, stats);
+      }
       if (m_config.remove_redundant_type_checks && can_use_nullness_results &&
           insn->opcode() == OPCODE_INSTANCE_OF) {
         remove_redundant_type_checks(env, it, stats);
@@ -192,6 +268,14 @@ void Transform::apply_changes(DexMethod* method) {
       code->replace_opcode(old_op, p.second);
     }
   }
+  for (const auto& p : m_casts) {
+    auto* invoke = p.first->insn;
+    code->insert_before(p.first, p.second);
+    code->insert_before(
+        p.first,
+        (new IRInstruction(IOPCODE_MOVE_RESULT_PSEUDO_OBJECT))
+            ->set_dest(invoke->src(0)));
+  }
   for (const auto& it : m_deletes) {
     TRACE(TYPE_TRANSFORM, 9, "Removing instruction %s", SHOW(it->insn));
     code->remove_opcode(it);
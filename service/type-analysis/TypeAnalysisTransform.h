@@ -12,14 +12,22 @@
 #include "LocalTypeAnalyzer.h"
 #include "PassManager.h"
 #include "Trace.h"
+#include "TypeInference.h"
 #include "WholeProgramState.h"
 
+namespace method_override_graph {
+class Graph;
+} // namespace method_override_graph
+
 namespace type_analyzer {
 
 /**
  * Optimize the given code by:
  *   - removing dead nonnull assertions generated by Kotlin
  * (checkParameterIsNotNull/checkExpressionValueIsNotNull)
+ *   - refining invoke-virtual and invoke-interface to the method that the
+ * receiver type dispatches to, when no subclass of it can override that
+ * method. This needs the method override graph.
  */
 class Transform final {
  public:
@@ -28,6 +36,7 @@ class Transform final {
     bool remove_redundant_null_checks{true};
     bool remove_kotlin_null_check_assertions{true};
     bool remove_redundant_type_checks{true};
+    bool refine_virtual_callsites{false};
     Config() {}
   };
 
@@ -37,6 +46,9 @@ class Transform final {
     size_t kotlin_null_check_removed{0};
     size_t type_check_removed{0};
     size_t null_check_only_type_checks{0};
+    size_t virtual_callsite_refined{0};
+    size_t interface_callsite_refined{0};
+    size_t refined_callsite_casts{0};
 
     Stats& operator+=(const Stats& that) {
       null_check_removed += that.null_check_removed;
@@ -44,12 +56,16 @@ class Transform final {
       kotlin_null_check_removed += that.kotlin_null_check_removed;
       type_check_removed += that.type_check_removed;
       null_check_only_type_checks += that.null_check_only_type_checks;
+      virtual_callsite_refined += that.virtual_callsite_refined;
+      interface_callsite_refined += that.interface_callsite_refined;
+      refined_callsite_casts += that.refined_callsite_casts;
       return *this;
     }
 
     bool is_empty() {
       return null_check_removed == 0 && kotlin_null_check_removed == 0 &&
-             type_check_removed == 0;
+             type_check_removed == 0 && virtual_callsite_refined == 0 &&
+             interface_callsite_refined == 0;
     }
 
     void report(PassManager& mgr) const {
@@ -59,6 +75,9 @@ class Transform final {
       mgr.incr_metric("type_check_removed", type_check_removed);
       mgr.incr_metric("null_check_only_type_checks",
                       null_check_only_type_checks);
+      mgr.incr_metric("virtual_callsite_refined", virtual_callsite_refined);
+      mgr.incr_metric("interface_callsite_refined", interface_callsite_refined);
+      mgr.incr_metric("refined_callsite_casts", refined_callsite_casts);
       TRACE(TYPE_TRANSFORM, 2, "TypeAnalysisTransform Stats:");
       TRACE(
           TYPE_TRANSFORM, 2, " null checks removed = %zu", null_check_removed);
@@ -73,10 +92,21 @@ class Transform final {
             2,
             " null check only type checks = %zu",
             null_check_only_type_checks);
+      TRACE(TYPE_TRANSFORM,
+            2,
+            " virtual callsites refined = %zu",
+            virtual_callsite_refined);
+      TRACE(TYPE_TRANSFORM,
+            2,
+            " interface callsites refined = %zu",
+            interface_callsite_refined);
     }
   };
 
-  explicit Transform(Config config = Config()) : m_config(config) {}
+  explicit Transform(
+      Config config = Config(),
+      const method_override_graph::Graph* method_override_graph = nullptr)
+      : m_config(config), m_method_override_graph(method_override_graph) {}
   Stats apply(const type_analyzer::local::LocalTypeAnalyzer& lta,
               const WholeProgramState& wps,
               DexMethod* method,
@@ -91,12 +121,22 @@ class Transform final {
   void remove_redundant_type_checks(const DexTypeEnvironment& env,
                                     IRList::iterator& it,
                                     Stats& stats);
+  void refine_virtual_callsite(const DexTypeEnvironment& env,
+                               DexMethod* caller,
+                               const IRList::iterator& it,
+                               Stats& stats);
 
   const Config m_config;
+  const method_override_graph::Graph* m_method_override_graph;
   // A set of methods excluded from null check removal
   ConcurrentSet<DexMethod*> m_excluded_for_null_check_removal;
   std::vector<std::pair<IRInstruction*, IRInstruction*>> m_replacements;
   std::vector<IRList::iterator> m_deletes;
+  // The check-casts to insert before refined invocations. Their
+  // move-result-pseudo is the new receiver register of the invocation.
+  std::vector<std::pair<IRList::iterator, IRInstruction*>> m_casts;
+  // Built on first use by refine_virtual_callsite.
+  std::unique_ptr<type_inference::TypeInference> m_type_inference;
 };
 
 } // namespace type_analyzer
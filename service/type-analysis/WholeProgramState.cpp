@@ -203,11 +203,8 @@ void WholeProgramState::analyze_clinits_and_ctors(
   for (DexClass* cls : scope) {
     auto clinit = cls->get_clinit();
     if (clinit) {
-      IRCode* code = clinit->get_code();
-      auto& cfg = code->cfg();
-      auto lta = gta.get_local_analysis(clinit);
-      auto env = lta->get_exit_state_at(cfg.exit_block());
-      set_sfields_in_partition(cls, env, field_partition);
+      auto summary = gta.get_method_summary(clinit);
+      set_sfields_in_partition(cls, summary->exit_env, field_partition);
     } else {
       set_sfields_in_partition(cls, DexTypeEnvironment::top(), field_partition);
     }
@@ -217,11 +214,8 @@ void WholeProgramState::analyze_clinits_and_ctors(
       if (!is_reachable(gta, ctor)) {
         continue;
       }
-      IRCode* code = ctor->get_code();
-      auto& cfg = code->cfg();
-      auto lta = gta.get_local_analysis(ctor);
-      auto env = lta->get_exit_state_at(cfg.exit_block());
-      set_ifields_in_partition(cls, env, field_partition);
+      auto summary = gta.get_method_summary(ctor);
+      set_ifields_in_partition(cls, summary->exit_env, field_partition);
     }
   }
 }
@@ -239,16 +233,21 @@ void WholeProgramState::collect(const Scope& scope,
     if (!is_reachable(gta, method)) {
       return;
     }
-    auto& cfg = code->cfg();
-    auto lta = gta.get_local_analysis(method);
-    for (cfg::Block* b : cfg.blocks()) {
-      auto env = lta->get_entry_state_at(b);
-      for (auto& mie : InstructionIterable(b)) {
-        auto* insn = mie.insn;
-        lta->analyze_instruction(insn, &env);
-        collect_field_types(insn, env, &fields_tmp);
-        collect_return_types(insn, env, method, &methods_tmp);
-      }
+    auto summary = gta.get_method_summary(method);
+    for (const auto& pair : summary->field_types) {
+      fields_tmp.update(pair.first,
+                        [&](const DexField*,
+                            std::vector<DexTypeDomain>& s,
+                            bool /* exists */) { s.push_back(pair.second); });
+    }
+    if (!summary->return_types.empty()) {
+      methods_tmp.update(method,
+                         [&](const DexMethod*,
+                             std::vector<DexTypeDomain>& s,
+                             bool /* exists */) {
+                           s.insert(s.end(), summary->return_types.begin(),
+                                    summary->return_types.end());
+                         });
     }
   });
   for (const auto& pair : fields_tmp) {
@@ -267,58 +266,6 @@ void WholeProgramState::collect(const Scope& scope,
   }
 }
 
-void WholeProgramState::collect_field_types(
-    const IRInstruction* insn,
-    const DexTypeEnvironment& env,
-    ConcurrentMap<const DexField*, std::vector<DexTypeDomain>>* field_tmp) {
-  if (!opcode::is_an_sput(insn->opcode()) &&
-      !opcode::is_an_iput(insn->opcode())) {
-    return;
-  }
-  auto field = resolve_field(insn->get_field());
-  if (!field || !type::is_object(field->get_type())) {
-    return;
-  }
-  auto type = env.get(insn->src(0));
-  if (traceEnabled(TYPE, 5)) {
-    std::ostringstream ss;
-    ss << type;
-    TRACE(TYPE, 5, "collecting field %s -> %s", SHOW(field), ss.str().c_str());
-  }
-  field_tmp->update(field,
-                    [type](const DexField*,
-                           std::vector<DexTypeDomain>& s,
-                           bool /* exists */) { s.emplace_back(type); });
-}
-
-void WholeProgramState::collect_return_types(
-    const IRInstruction* insn,
-    const DexTypeEnvironment& env,
-    const DexMethod* method,
-    ConcurrentMap<const DexMethod*, std::vector<DexTypeDomain>>* method_tmp) {
-  auto op = insn->opcode();
-  if (!opcode::is_a_return(op)) {
-    return;
-  }
-  if (!returns_reference(method)) {
-    // We must set the binding to Top here to record the fact that this method
-    // does indeed return -- even though `void` is not actually a return type,
-    // this tells us that the code following any invoke of this method is
-    // reachable.
-    method_tmp->update(
-        method,
-        [](const DexMethod*, std::vector<DexTypeDomain>& s, bool /* exists */) {
-          s.emplace_back(DexTypeDomain::top());
-        });
-    return;
-  }
-  auto type = env.get(insn->src(0));
-  method_tmp->update(method,
-                     [type](const DexMethod*,
-                            std::vector<DexTypeDomain>& s,
-                            bool /* exists */) { s.emplace_back(type); });
-}
-
 bool WholeProgramState::is_reachable(const global::GlobalTypeAnalyzer& gta,
                                      const DexMethod* method) const {
   return !m_known_methods.count(method) || gta.is_reachable(method);
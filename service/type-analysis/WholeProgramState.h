@@ -150,17 +150,6 @@ class WholeProgramState {
 
   void collect(const Scope& scope, const global::GlobalTypeAnalyzer&);
 
-  void collect_field_types(
-      const IRInstruction* insn,
-      const DexTypeEnvironment& env,
-      ConcurrentMap<const DexField*, std::vector<DexTypeDomain>>* field_tmp);
-
-  void collect_return_types(
-      const IRInstruction* insn,
-      const DexTypeEnvironment& env,
-      const DexMethod* method,
-      ConcurrentMap<const DexMethod*, std::vector<DexTypeDomain>>* method_tmp);
-
   bool is_reachable(const global::GlobalTypeAnalyzer&, const DexMethod*) const;
 
   // To avoid "Show.h" in the header.
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 #include <string>
 
 namespace dex_encoding {
@@ -64,6 +65,43 @@ inline uint32_t read_uleb128(const uint8_t** _ptr) {
   return result;
 }
 
+/* read_uleb128s:
+ * Reads `count` consecutive uleb128s into `out`, like as many calls to
+ * read_uleb128, and advances the pointer past them. `end` bounds the readable
+ * memory, and is only used to decide when 8 bytes can be loaded at once.
+ *
+ * Most values in class data and debug info fit in one byte, so the bytes are
+ * looked at a word at a time: all single-byte values that start a word are
+ * copied without further decoding, and only the multi-byte ones go through
+ * read_uleb128.
+ */
+inline void read_uleb128s(const uint8_t** _ptr,
+                          const uint8_t* end,
+                          uint32_t* out,
+                          size_t count) {
+  constexpr uint64_t kContinuationBits = 0x8080808080808080;
+  const uint8_t* ptr = *_ptr;
+  uint32_t* out_end = out + count;
+  while (out_end - out >= 8 && end - ptr >= 8) {
+    uint64_t word;
+    memcpy(&word, ptr, sizeof(word));
+    uint64_t mask = word & kContinuationBits;
+    // Dex files are little-endian, so the lowest bytes come first.
+    size_t singles = mask == 0 ? 8 : __builtin_ctzll(mask) / 8;
+    for (size_t i = 0; i < singles; ++i) {
+      *out++ = ptr[i];
+    }
+    ptr += singles;
+    if (singles < 8) {
+      *out++ = read_uleb128(&ptr);
+    }
+  }
+  while (out != out_end) {
+    *out++ = read_uleb128(&ptr);
+  }
+  *_ptr = ptr;
+}
+
 inline uint32_t read_uleb128p1(const uint8_t** _ptr) {
   int v = read_uleb128(_ptr);
   return (v - 1);
@@ -187,34 +225,78 @@ inline uint32_t mutf8_next_code_point(const char*& s) {
   dex_encoding::details::throw_invalid("Invalid size encoding mutf8 string");
 }
 
-inline uint32_t length_of_utf8_string(const char* s) {
-  if (s == nullptr) {
-    return 0;
+namespace dex_encoding {
+namespace details {
+
+// Returns the length of the prefix of the `size` bytes at `s` that is only
+// made of ASCII characters, looking at 8 bytes at a time.
+inline size_t ascii_prefix_size(const char* s, size_t size) {
+  constexpr uint64_t kHighBits = 0x8080808080808080;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, s + i, sizeof(word));
+    if ((word & kHighBits) != 0) {
+      break;
+    }
+  }
+  while (i < size && !(static_cast<uint8_t>(s[i]) & 0x80)) {
+    ++i;
   }
-  uint32_t len = 0;
-  while (*s != '\0') {
+  return i;
+}
+
+} // namespace details
+} // namespace dex_encoding
+
+/*
+ * The number of UTF-16 code units of the MUTF-8 string of `size` bytes at
+ * `s`. ASCII characters, which make up most strings in practice, are counted
+ * without being decoded.
+ */
+inline uint32_t length_of_utf8_string(const char* s, size_t size) {
+  const char* end = s + size;
+  size_t ascii = dex_encoding::details::ascii_prefix_size(s, size);
+  uint32_t len = ascii;
+  s += ascii;
+  while (s < end) {
     ++len;
     mutf8_next_code_point(s);
   }
   return len;
 }
 
-// https://docs.oracle.com/javase/8/docs/api/java/lang/String.html#hashCode--
-inline int32_t java_hashcode_of_utf8_string(const char* s) {
+/*
+ * The hash code of the MUTF-8 string of `size` bytes at `s` as a Java string.
+ * The ASCII prefix of the string is hashed without being decoded.
+ */
+inline int32_t java_hashcode_of_utf8_string(const char* s, size_t size) {
+  const char* end = s + size;
+  size_t ascii = dex_encoding::details::ascii_prefix_size(s, size);
+  uint32_t hash = 0;
+  for (size_t i = 0; i < ascii; ++i) {
+    hash = hash * 31 + static_cast<uint8_t>(s[i]);
+  }
+  s += ascii;
+  while (s < end) {
+    hash = hash * 31 + mutf8_next_code_point(s);
+  }
+  return static_cast<int32_t>(hash);
+}
+
+inline uint32_t length_of_utf8_string(const char* s) {
   if (s == nullptr) {
     return 0;
   }
+  return length_of_utf8_string(s, strlen(s));
+}
 
-  union {
-    int32_t hash;
-    int64_t wide;
-  } ret;
-
-  ret.wide = 0;
-  while (*s != '\0') {
-    ret.wide = (ret.wide * 31 + mutf8_next_code_point(s)) & 0xFFFFFFFFll;
+// https://docs.oracle.com/javase/8/docs/api/java/lang/String.html#hashCode--
+inline int32_t java_hashcode_of_utf8_string(const char* s) {
+  if (s == nullptr) {
+    return 0;
   }
-  return ret.hash;
+  return java_hashcode_of_utf8_string(s, strlen(s));
 }
 
 inline uint32_t size_of_utf8_char(const int32_t ival) {
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+namespace sparta {
+
+template <typename Element>
+class BitVectorSet;
+
+namespace bvs_impl {
+
+using Word = uint64_t;
+
+constexpr size_t kBitsPerWord = std::numeric_limits<Word>::digits;
+
+/*
+ * Iterates over the elements of a BitVectorSet in increasing order.
+ */
+template <typename Element>
+class BitVectorSetIterator final {
+ public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = Element;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const Element*;
+  using reference = Element;
+
+  BitVectorSetIterator() = default;
+
+  reference operator*() const {
+    return static_cast<Element>(m_index * kBitsPerWord +
+                                __builtin_ctzll(m_bits));
+  }
+
+  BitVectorSetIterator& operator++() {
+    // Clear the lowest set bit.
+    m_bits &= m_bits - 1;
+    skip_empty_words();
+    return *this;
+  }
+
+  BitVectorSetIterator operator++(int) {
+    BitVectorSetIterator retval = *this;
+    ++(*this);
+    return retval;
+  }
+
+  bool operator==(const BitVectorSetIterator& other) const {
+    return m_index == other.m_index && m_bits == other.m_bits;
+  }
+
+  bool operator!=(const BitVectorSetIterator& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  BitVectorSetIterator(const std::vector<Word>* words, size_t index)
+      : m_words(words), m_index(index) {
+    if (m_index < m_words->size()) {
+      m_bits = (*m_words)[m_index];
+      skip_empty_words();
+    }
+  }
+
+  void skip_empty_words() {
+    while (m_bits == 0 && ++m_index < m_words->size()) {
+      m_bits = (*m_words)[m_index];
+    }
+    if (m_bits == 0) {
+      m_index = m_words->size();
+    }
+  }
+
+  const std::vector<Word>* m_words{nullptr};
+  size_t m_index{0};
+  Word m_bits{0};
+
+  template <typename T>
+  friend class sparta::BitVectorSet;
+};
+
+} // namespace bvs_impl
+
+/*
+ * A set of small unsigned integers, such as register numbers, represented as
+ * a dense bit vector. Unlike Patricia trees, copies don't share any structure,
+ * but all operations are simple loops over machine words that the compiler
+ * can vectorize. This makes it a better fit when the universe is small and
+ * the sets are dense, e.g., for liveness analysis.
+ *
+ * The memory taken by a set is proportional to its largest element, so this
+ * should not be used with sparse or arbitrarily large keys.
+ */
+template <typename Element>
+class BitVectorSet final {
+  static_assert(std::is_unsigned<Element>::value,
+                "BitVectorSet elements must be unsigned integers");
+
+  using Word = bvs_impl::Word;
+  static constexpr size_t kBitsPerWord = bvs_impl::kBitsPerWord;
+
+ public:
+  // C++ container concept member types
+  using iterator = bvs_impl::BitVectorSetIterator<Element>;
+  using const_iterator = iterator;
+  using value_type = Element;
+  using difference_type = std::ptrdiff_t;
+  using size_type = size_t;
+  using const_reference = const Element&;
+  using const_pointer = const Element*;
+
+  BitVectorSet() = default;
+
+  explicit BitVectorSet(std::initializer_list<Element> l) {
+    for (Element x : l) {
+      insert(x);
+    }
+  }
+
+  template <typename InputIterator>
+  BitVectorSet(InputIterator first, InputIterator last) {
+    for (auto it = first; it != last; ++it) {
+      insert(*it);
+    }
+  }
+
+  bool empty() const {
+    Word any = 0;
+    for (Word w : m_words) {
+      any |= w;
+    }
+    return any == 0;
+  }
+
+  size_t size() const {
+    size_t s = 0;
+    for (Word w : m_words) {
+      s += __builtin_popcountll(w);
+    }
+    return s;
+  }
+
+  size_t max_size() const { return std::numeric_limits<Element>::max(); }
+
+  iterator begin() const { return iterator(&m_words, 0); }
+
+  iterator end() const { return iterator(&m_words, m_words.size()); }
+
+  bool contains(Element key) const {
+    size_t index = key / kBitsPerWord;
+    return index < m_words.size() &&
+           ((m_words[index] >> (key % kBitsPerWord)) & 1) != 0;
+  }
+
+  bool is_subset_of(const BitVectorSet& other) const {
+    size_t common = std::min(m_words.size(), other.m_words.size());
+    const Word* a = m_words.data();
+    const Word* b = other.m_words.data();
+    Word extra = 0;
+    for (size_t i = 0; i < common; ++i) {
+      extra |= a[i] & ~b[i];
+    }
+    for (size_t i = common; i < m_words.size(); ++i) {
+      extra |= a[i];
+    }
+    return extra == 0;
+  }
+
+  bool equals(const BitVectorSet& other) const {
+    const auto& shorter =
+        m_words.size() <= other.m_words.size() ? m_words : other.m_words;
+    const auto& longer =
+        m_words.size() <= other.m_words.size() ? other.m_words : m_words;
+    Word diff = 0;
+    for (size_t i = 0; i < shorter.size(); ++i) {
+      diff |= shorter[i] ^ longer[i];
+    }
+    for (size_t i = shorter.size(); i < longer.size(); ++i) {
+      diff |= longer[i];
+    }
+    return diff == 0;
+  }
+
+  friend bool operator==(const BitVectorSet& s1, const BitVectorSet& s2) {
+    return s1.equals(s2);
+  }
+
+  friend bool operator!=(const BitVectorSet& s1, const BitVectorSet& s2) {
+    return !s1.equals(s2);
+  }
+
+  BitVectorSet& insert(Element key) {
+    size_t index = key / kBitsPerWord;
+    if (index >= m_words.size()) {
+      m_words.resize(index + 1, 0);
+    }
+    m_words[index] |= Word(1) << (key % kBitsPerWord);
+    return *this;
+  }
+
+  BitVectorSet& remove(Element key) {
+    size_t index = key / kBitsPerWord;
+    if (index < m_words.size()) {
+      m_words[index] &= ~(Word(1) << (key % kBitsPerWord));
+    }
+    return *this;
+  }
+
+  BitVectorSet& union_with(const BitVectorSet& other) {
+    if (other.m_words.size() > m_words.size()) {
+      m_words.resize(other.m_words.size(), 0);
+    }
+    Word* a = m_words.data();
+    const Word* b = other.m_words.data();
+    for (size_t i = 0, n = other.m_words.size(); i < n; ++i) {
+      a[i] |= b[i];
+    }
+    return *this;
+  }
+
+  BitVectorSet& intersection_with(const BitVectorSet& other) {
+    if (other.m_words.size() < m_words.size()) {
+      m_words.resize(other.m_words.size());
+    }
+    Word* a = m_words.data();
+    const Word* b = other.m_words.data();
+    for (size_t i = 0, n = m_words.size(); i < n; ++i) {
+      a[i] &= b[i];
+    }
+    return *this;
+  }
+
+  BitVectorSet& difference_with(const BitVectorSet& other) {
+    Word* a = m_words.data();
+    const Word* b = other.m_words.data();
+    for (size_t i = 0, n = std::min(m_words.size(), other.m_words.size());
+         i < n;
+         ++i) {
+      a[i] &= ~b[i];
+    }
+    return *this;
+  }
+
+  BitVectorSet get_union_with(const BitVectorSet& other) const {
+    auto result = *this;
+    result.union_with(other);
+    return result;
+  }
+
+  BitVectorSet get_intersection_with(const BitVectorSet& other) const {
+    auto result = *this;
+    result.intersection_with(other);
+    return result;
+  }
+
+  BitVectorSet get_difference_with(const BitVectorSet& other) const {
+    auto result = *this;
+    result.difference_with(other);
+    return result;
+  }
+
+  void clear() { m_words.clear(); }
+
+  friend std::ostream& operator<<(std::ostream& o, const BitVectorSet& s) {
+    o << "{";
+    for (auto it = s.begin(); it != s.end(); ++it) {
+      o << *it;
+      if (std::next(it) != s.end()) {
+        o << ", ";
+      }
+    }
+    o << "}";
+    return o;
+  }
+
+ private:
+  // Bit `i % 64` of word `i / 64` is set iff `i` is in the set. There may be
+  // trailing zero words.
+  std::vector<Word> m_words;
+};
+
+} // namespace sparta
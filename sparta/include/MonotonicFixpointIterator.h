@@ -8,8 +8,10 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>
 #include <cstddef>
 #include <functional>
+#include <queue>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -142,10 +144,32 @@ class MonotonicFixpointIteratorBase
     }
   }
 
+  /*
+   * Bounds the work of the next runs of a sequential fixpoint iterator: once
+   * the nodes have been analyzed `max_steps` times overall, or the run has
+   * lasted `max_time`, the iteration stops and all the invariants are Top,
+   * which is sound but tells nothing. A zero bound is no bound. The parallel
+   * fixpoint iterator doesn't honor the budget.
+   */
+  void set_budget(size_t max_steps,
+                  std::chrono::milliseconds max_time =
+                      std::chrono::milliseconds::zero()) {
+    m_max_steps = max_steps;
+    m_max_time = max_time;
+  }
+
+  /*
+   * Returns whether the last run stopped because it exceeded its budget.
+   */
+  bool budget_exceeded() const { return m_budget_exceeded; }
+
   /*
    * Returns the invariant computed by the fixpoint iterator at a node entry.
    */
   Domain get_entry_state_at(const NodeId& node) const {
+    if (m_budget_exceeded) {
+      return Domain::top();
+    }
     auto it = m_entry_states.find(node);
     return (it == m_entry_states.end()) ? Domain::bottom() : it->second;
   }
@@ -154,6 +178,9 @@ class MonotonicFixpointIteratorBase
    * Returns the invariant computed by the fixpoint iterator at a node exit.
    */
   Domain get_exit_state_at(const NodeId& node) const {
+    if (m_budget_exceeded) {
+      return Domain::top();
+    }
     auto it = m_exit_states.find(node);
     // It's impossible to get rid of this condition by initializing all exit
     // states to _|_ prior to starting the fixpoint iteration. The reason is
@@ -215,9 +242,39 @@ class MonotonicFixpointIteratorBase
     this->analyze_node(node, &exit_state);
   }
 
+  void start_budget() {
+    m_steps = 0;
+    m_budget_exceeded = false;
+    if (m_max_time.count() != 0) {
+      m_deadline = std::chrono::steady_clock::now() + m_max_time;
+    }
+  }
+
+  /*
+   * Accounts for the analysis of a node. Returns false, and from then on
+   * reports the budget as exceeded, when the node must not be analyzed.
+   */
+  bool charge_step() {
+    if (m_budget_exceeded) {
+      return false;
+    }
+    ++m_steps;
+    // Reading the clock is not free, so it's only done every few steps.
+    m_budget_exceeded =
+        (m_max_steps != 0 && m_steps > m_max_steps) ||
+        (m_max_time.count() != 0 && m_steps % 16 == 0 &&
+         std::chrono::steady_clock::now() > m_deadline);
+    return !m_budget_exceeded;
+  }
+
   const Graph& m_graph;
   std::unordered_map<NodeId, Domain, NodeHash> m_entry_states;
   std::unordered_map<NodeId, Domain, NodeHash> m_exit_states;
+  size_t m_max_steps{0};
+  std::chrono::milliseconds m_max_time{0};
+  size_t m_steps{0};
+  std::chrono::steady_clock::time_point m_deadline;
+  bool m_budget_exceeded{false};
 };
 
 } // namespace fp_impl
@@ -269,6 +326,7 @@ class WTOMonotonicFixpointIterator
    */
   void run(const Domain& init) {
     this->clear();
+    this->start_budget();
     Context context(init);
     for (const WtoComponent<NodeId>& component : m_wto) {
       analyze_component(&context, component);
@@ -279,7 +337,9 @@ class WTOMonotonicFixpointIterator
   void analyze_component(Context* context,
                          const WtoComponent<NodeId>& component) {
     if (component.is_vertex()) {
-      this->analyze_vertex(context, component.head_node());
+      if (this->charge_step()) {
+        this->analyze_vertex(context, component.head_node());
+      }
     } else {
       analyze_scc(context, component);
     }
@@ -288,7 +348,8 @@ class WTOMonotonicFixpointIterator
   void analyze_scc(Context* context, const WtoComponent<NodeId>& scc) {
     NodeId head = scc.head_node();
     bool iterate = true;
-    for (context->reset_local_iteration_count_for(head); iterate;
+    for (context->reset_local_iteration_count_for(head);
+         iterate && this->charge_step();
          context->increase_iteration_count_for(head)) {
       this->analyze_vertex(context, head);
       for (const auto& component : scc) {
@@ -329,6 +390,12 @@ class WTOMonotonicFixpointIterator
  *
  *   https://dl.acm.org/ft_gateway.cfm?id=3371082
  *
+ * Workers steal ready nodes from each other regardless of which component
+ * they belong to. By default, each worker runs the most deeply nested ready
+ * node first: finishing inner components early unblocks their exits, and
+ * hence the rest of the enclosing component, sooner. On graphs with large
+ * strongly connected components this keeps many more workers busy than
+ * plain FIFO scheduling.
  */
 template <typename GraphInterface,
           typename Domain,
@@ -342,10 +409,24 @@ class ParallelMonotonicFixpointIterator
   using EdgeId = typename GraphInterface::EdgeId;
   using Context =
       fp_impl::MonotonicFixpointIteratorContext<NodeId, Domain, NodeHash>;
-  using WPOWorkerState = SpartaWorkerState<uint32_t>;
+
+  // A ready WPO node. Tasks compare by nesting depth first; among nodes of
+  // the same depth, the ones that come first in the WPO (i.e., have a larger
+  // index) are preferred.
+  struct WPOTask {
+    uint32_t depth;
+    uint32_t wpo_idx;
+
+    bool operator<(const WPOTask& other) const {
+      return depth != other.depth ? depth < other.depth
+                                  : wpo_idx < other.wpo_idx;
+    }
+  };
 
   ParallelMonotonicFixpointIterator(
-      const Graph& graph, size_t num_thread = parallel::default_num_threads())
+      const Graph& graph,
+      size_t num_thread = parallel::default_num_threads(),
+      bool prioritize_by_depth = true)
       : fp_impl::
             MonotonicFixpointIteratorBase<GraphInterface, Domain, NodeHash>(
                 graph, /*cfg_size_hint*/ 4),
@@ -372,7 +453,8 @@ class ParallelMonotonicFixpointIterator
               return succ_nodes;
             },
             false),
-        m_num_thread(num_thread) {
+        m_num_thread(num_thread),
+        m_prioritize_by_depth(prioritize_by_depth) {
     // Gathering all reachable nodes in graph.
     std::stack<NodeId> node_queue;
     node_queue.push(GraphInterface::entry(graph));
@@ -404,95 +486,109 @@ class ParallelMonotonicFixpointIterator
     std::fill_n(wpo_counter.get(), m_wpo.size(), 0);
     auto entry_idx = m_wpo.get_entry();
     assert(m_wpo.get_num_preds(entry_idx) == 0);
-    // Prepare work queue.
-    auto wq = sparta::work_queue<uint32_t>(
-        [&context, &entry_idx, &wpo_counter, this](WPOWorkerState* worker_state,
-                                                   uint32_t wpo_idx) {
-          std::atomic<uint32_t>& current_counter = wpo_counter[wpo_idx];
-          assert(current_counter == m_wpo.get_num_preds(wpo_idx));
-          current_counter = 0;
-          // NonExit node
-          if (!m_wpo.is_exit(wpo_idx)) {
-            this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
-            for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-              std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
-              // Increase succ node's counter, push succ nodes in work queue if
-              // their counter number matches their NumSchedPreds.
-              if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
-                worker_state->push_task(succ_idx);
-              }
-            }
-            return nullptr;
+    auto make_task = [this](uint32_t wpo_idx) {
+      return WPOTask{m_wpo.get_depth(wpo_idx), wpo_idx};
+    };
+    auto process = [&context, &entry_idx, &wpo_counter, &make_task, this](
+                       auto* worker_state, WPOTask task) {
+      auto wpo_idx = task.wpo_idx;
+      std::atomic<uint32_t>& current_counter = wpo_counter[wpo_idx];
+      assert(current_counter == m_wpo.get_num_preds(wpo_idx));
+      current_counter = 0;
+      // NonExit node
+      if (!m_wpo.is_exit(wpo_idx)) {
+        this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
+        for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
+          std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
+          // Increase succ node's counter, push succ nodes in work queue if
+          // their counter number matches their NumSchedPreds.
+          if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
+            worker_state->push_task(make_task(succ_idx));
           }
-          // Exit node
-          // Check if component of the exit node has stabilized.
-          auto head_idx = m_wpo.get_head_of_exit(wpo_idx);
-          NodeId head = m_wpo.get_node(head_idx);
-          Domain* current_state = &this->m_entry_states[head];
-          Domain new_state = Domain::bottom();
-          this->compute_entry_state(&context, head, &new_state);
-          if (new_state.leq(*current_state)) {
-            // Component stabilized.
-            context.reset_local_iteration_count_for(head);
-            *current_state = std::move(new_state);
-            for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-              std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
-              // Increase succ node's counter, push succ nodes in work queue if
-              // their counter number matches their NumSchedPreds.
-              if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
-                worker_state->push_task(succ_idx);
-              }
-            }
-          } else {
-            // Component didn't stabilize.
-            this->extrapolate(context, head, current_state, new_state);
-            context.increase_iteration_count_for(head);
-            // Set component nodes v's counter to their
-            // NumOuterSchedPreds(v, wpo_idx)
-            for (auto pred_pair : m_wpo.get_num_outer_preds(wpo_idx)) {
-              auto component_idx = pred_pair.first;
-              assert(component_idx != entry_idx);
-              std::atomic<uint32_t>& component_counter =
-                  wpo_counter[component_idx];
-              // Push component nodes in work queue if their counter number
-              // matches their NumSchedPreds.
-
-              // Note: On page 10, https://dl.acm.org/ft_gateway.cfm?id=3371082
-              // suggests to set the counter to be *equal* to the number of
-              // predecessors not in our component. However, that is only
-              // correct when all counter updates of a scheduling step are done
-              // together as a single atomic update. Instead, we choose to
-              // update point-wise, in which case we have to *add* the number of
-              // predecessors, and update our own counter to 0 before updating
-              // any other dependent counters.
-              if ((component_counter += pred_pair.second) ==
-                  m_wpo.get_num_preds(component_idx)) {
-                worker_state->push_task(component_idx);
-              }
-            }
-            if (head_idx == entry_idx) {
-              // Handle special case when there is a loop on entry node.
-              // Because entry node have num_preds = 0, and for
-              // get_num_outer_preds the nodes with num_outer_preds are ignored.
-              // So we need to manually add entry node back to work queue if
-              // the component didn't stabilize.
-              worker_state->push_task(head_idx);
-            }
+        }
+        return nullptr;
+      }
+      // Exit node
+      // Check if component of the exit node has stabilized.
+      auto head_idx = m_wpo.get_head_of_exit(wpo_idx);
+      NodeId head = m_wpo.get_node(head_idx);
+      Domain* current_state = &this->m_entry_states[head];
+      Domain new_state = Domain::bottom();
+      this->compute_entry_state(&context, head, &new_state);
+      if (new_state.leq(*current_state)) {
+        // Component stabilized.
+        context.reset_local_iteration_count_for(head);
+        *current_state = std::move(new_state);
+        for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
+          std::atomic<uint32_t>& succ_counter = wpo_counter[succ_idx];
+          // Increase succ node's counter, push succ nodes in work queue if
+          // their counter number matches their NumSchedPreds.
+          if (++succ_counter == m_wpo.get_num_preds(succ_idx)) {
+            worker_state->push_task(make_task(succ_idx));
           }
-          return nullptr;
-        },
-        m_num_thread,
-        /*push_tasks_while_running=*/true);
-    wq.add_item(m_wpo.get_entry());
-    wq.run_all();
+        }
+      } else {
+        // Component didn't stabilize.
+        this->extrapolate(context, head, current_state, new_state);
+        context.increase_iteration_count_for(head);
+        // Set component nodes v's counter to their
+        // NumOuterSchedPreds(v, wpo_idx)
+        for (auto pred_pair : m_wpo.get_num_outer_preds(wpo_idx)) {
+          auto component_idx = pred_pair.first;
+          assert(component_idx != entry_idx);
+          std::atomic<uint32_t>& component_counter =
+              wpo_counter[component_idx];
+          // Push component nodes in work queue if their counter number
+          // matches their NumSchedPreds.
+
+          // Note: On page 10, https://dl.acm.org/ft_gateway.cfm?id=3371082
+          // suggests to set the counter to be *equal* to the number of
+          // predecessors not in our component. However, that is only
+          // correct when all counter updates of a scheduling step are done
+          // together as a single atomic update. Instead, we choose to
+          // update point-wise, in which case we have to *add* the number of
+          // predecessors, and update our own counter to 0 before updating
+          // any other dependent counters.
+          if ((component_counter += pred_pair.second) ==
+              m_wpo.get_num_preds(component_idx)) {
+            worker_state->push_task(make_task(component_idx));
+          }
+        }
+        if (head_idx == entry_idx) {
+          // Handle special case when there is a loop on entry node.
+          // Because entry node have num_preds = 0, and for
+          // get_num_outer_preds the nodes with num_outer_preds are ignored.
+          // So we need to manually add entry node back to work queue if
+          // the component didn't stabilize.
+          worker_state->push_task(make_task(head_idx));
+        }
+      }
+      return nullptr;
+    };
+    if (m_prioritize_by_depth) {
+      run_work_queue<std::priority_queue<WPOTask>>(process,
+                                                   make_task(entry_idx));
+    } else {
+      run_work_queue<std::queue<WPOTask>>(process, make_task(entry_idx));
+    }
     for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
       assert(wpo_counter[idx] == 0);
     }
   }
 
  private:
+  template <class Queue, typename Fn>
+  void run_work_queue(const Fn& fn, WPOTask entry) {
+    using Helper = workqueue_impl::WithStateWorkQueueHelper<WPOTask, Fn, Queue>;
+    SpartaWorkQueue<WPOTask, Helper, Queue> wq(
+        Helper{fn}, m_num_thread, /*push_tasks_while_running=*/true);
+    wq.add_item(entry);
+    wq.run_all();
+  }
+
   WeakPartialOrdering<NodeId, NodeHash> m_wpo;
   size_t m_num_thread;
+  bool m_prioritize_by_depth;
   std::unordered_set<NodeId> m_all_nodes;
 };
 
@@ -550,27 +646,98 @@ class MonotonicFixpointIterator
    */
   void run(const Domain& init) {
     this->clear();
+    this->start_budget();
     Context context(init);
+    iterate(&context, /* affected */ nullptr);
+  }
+
+  /*
+   * Recomputes the fixpoint after the semantics of the given nodes have
+   * changed, e.g., because some instructions in those blocks were edited. The
+   * invariants computed by the previous call to run() (or run_incremental())
+   * with the same initial value are kept for all the nodes that are not
+   * reachable from a dirty node. Only the nodes reachable from a dirty node
+   * are analyzed again, starting from bottom, so the result is the same as
+   * the one of a full run().
+   *
+   * The shape of the graph must not have changed since this fixpoint iterator
+   * was constructed: the weak partial ordering is not recomputed.
+   */
+  template <typename Nodes>
+  void run_incremental(const Domain& init, const Nodes& dirty_nodes) {
+    std::unordered_set<NodeId, NodeHash> affected_nodes;
+    std::vector<NodeId> worklist;
+    for (const NodeId& node : dirty_nodes) {
+      if (affected_nodes.insert(node).second) {
+        worklist.push_back(node);
+      }
+    }
+    while (!worklist.empty()) {
+      NodeId node = worklist.back();
+      worklist.pop_back();
+      for (const EdgeId& edge :
+           GraphInterface::successors(this->m_graph, node)) {
+        NodeId target = GraphInterface::target(this->m_graph, edge);
+        if (affected_nodes.insert(target).second) {
+          worklist.push_back(target);
+        }
+      }
+    }
+    // Affected nodes are reanalyzed from scratch, as in a full run.
+    for (const NodeId& node : affected_nodes) {
+      this->m_entry_states.erase(node);
+      this->m_exit_states.erase(node);
+    }
+    // The exit of a component stands for its head.
+    std::vector<bool> affected(m_wpo.size());
+    for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
+      affected[idx] = affected_nodes.count(m_wpo.get_node(idx)) != 0;
+    }
+    this->start_budget();
+    Context context(init);
+    iterate(&context, &affected);
+  }
+
+ private:
+  /*
+   * Runs the fixpoint iteration over the WPO. When `affected` is set, the
+   * nodes that are not affected keep their current invariants: they are only
+   * visited to schedule their successors, and their components are considered
+   * stable.
+   */
+  void iterate(Context* context_ptr, const std::vector<bool>* affected) {
+    Context& context = *context_ptr;
     std::unique_ptr<std::atomic<uint32_t>[]> wpo_counter(
         new std::atomic<uint32_t>[m_wpo.size()]);
     std::fill_n(wpo_counter.get(), m_wpo.size(), 0);
     std::queue<uint32_t> work_queue;
     auto entry_idx = m_wpo.get_entry();
     assert(m_wpo.get_num_preds(entry_idx) == 0);
+    auto schedule_successors = [&](uint32_t wpo_idx) {
+      for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
+        // Increase succ node's counter, push succ nodes in work queue if
+        // their counter number matches their NumSchedPreds.
+        if (++wpo_counter[succ_idx] == m_wpo.get_num_preds(succ_idx)) {
+          work_queue.emplace(succ_idx);
+        }
+      }
+    };
     // Prepare work queue.
     auto process_node = [&](uint32_t wpo_idx) {
       assert(wpo_counter[wpo_idx] == m_wpo.get_num_preds(wpo_idx));
       wpo_counter[wpo_idx] = 0;
+      if (affected != nullptr && !(*affected)[wpo_idx]) {
+        // Unaffected node, or stable component.
+        schedule_successors(wpo_idx);
+        return nullptr;
+      }
       // NonExit node
       if (!m_wpo.is_exit(wpo_idx)) {
-        this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
-        for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-          // Increase succ node's counter, push succ nodes in work queue if
-          // their counter number matches their NumSchedPreds.
-          if (++wpo_counter[succ_idx] == m_wpo.get_num_preds(succ_idx)) {
-            work_queue.emplace(succ_idx);
-          }
+        if (!this->charge_step()) {
+          return nullptr;
         }
+        this->analyze_vertex(&context, m_wpo.get_node(wpo_idx));
+        schedule_successors(wpo_idx);
         return nullptr;
       }
       // Exit node
@@ -584,13 +751,7 @@ class MonotonicFixpointIterator
         // Component stabilized.
         context.reset_local_iteration_count_for(head);
         *current_state = std::move(new_state);
-        for (auto succ_idx : m_wpo.get_successors(wpo_idx)) {
-          // Increase succ node's counter, push succ nodes in work queue if
-          // their counter number matches their NumSchedPreds.
-          if (++wpo_counter[succ_idx] == m_wpo.get_num_preds(succ_idx)) {
-            work_queue.emplace(succ_idx);
-          }
-        }
+        schedule_successors(wpo_idx);
       } else {
         // Component didn't stabilize.
         this->extrapolate(context, head, current_state, new_state);
@@ -620,17 +781,19 @@ class MonotonicFixpointIterator
     };
     // Start from wpo entry node.
     work_queue.emplace(entry_idx);
-    while (!work_queue.empty()) {
+    while (!work_queue.empty() && !this->budget_exceeded()) {
       auto item = work_queue.front();
       work_queue.pop();
       process_node(item);
     }
+    if (this->budget_exceeded()) {
+      return;
+    }
     for (uint32_t idx = 0; idx < m_wpo.size(); ++idx) {
       assert(wpo_counter[idx] == 0);
     }
   }
 
- private:
   WeakPartialOrdering<NodeId, NodeHash> m_wpo;
 };
 
@@ -21,6 +21,7 @@
 #include <boost/intrusive_ptr.hpp>
 
 #include "AbstractDomain.h"
+#include "PatriciaTreeNodePool.h"
 #include "PatriciaTreeUtil.h"
 
 // Forward declarations
@@ -459,6 +460,16 @@ class PatriciaTree {
 
   bool is_branch() const { return !is_leaf(); }
 
+  // Nodes are allocated from a per-thread pool. Since the destructor is
+  // virtual, the size passed on deletion is the one of the actual node.
+  static void* operator new(size_t size) {
+    return PatriciaTreeNodePool::allocate(size);
+  }
+
+  static void operator delete(void* p, size_t size) {
+    PatriciaTreeNodePool::deallocate(p, size);
+  }
+
   friend void intrusive_ptr_add_ref(const PatriciaTree<IntegerType, Value>* p) {
     p->m_reference_count.fetch_add(1, std::memory_order_relaxed);
   }
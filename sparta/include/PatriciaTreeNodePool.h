@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace sparta {
+
+/*
+ * A per-thread cache of memory blocks for Patricia-tree nodes.
+ *
+ * Abstract interpreters create and destroy tree nodes at a very high rate, on
+ * every thread of a parallel fixpoint iteration. Freed nodes are kept on a
+ * free list of the thread that released them, one for each size class, and
+ * reused by the next allocations of that thread without going through the
+ * global allocator. Blocks may freely migrate between threads, since they are
+ * individually obtained from `::operator new`: the caches are bounded and are
+ * returned to the global allocator when their thread exits.
+ */
+class PatriciaTreeNodePool final {
+ public:
+  static void* allocate(size_t size) {
+    if (size > kMaxBlockSize) {
+      return ::operator new(size);
+    }
+    auto& list = local_cache().lists[size_class(size)];
+    if (list.head == nullptr) {
+      return ::operator new(block_size(size_class(size)));
+    }
+    FreeBlock* block = list.head;
+    list.head = block->next;
+    --list.count;
+    return block;
+  }
+
+  static void deallocate(void* p, size_t size) {
+    if (size > kMaxBlockSize) {
+      ::operator delete(p);
+      return;
+    }
+    auto& cache = local_cache();
+    auto& list = cache.lists[size_class(size)];
+    if (cache.retired || list.count >= kMaxCachedBlocks) {
+      ::operator delete(p);
+      return;
+    }
+    if (!cache.registered) {
+      register_thread_exit();
+      cache.registered = true;
+    }
+    auto* block = static_cast<FreeBlock*>(p);
+    block->next = list.head;
+    list.head = block;
+    ++list.count;
+  }
+
+  // The number of cached blocks on the current thread, for testing purposes.
+  static size_t cached_blocks() {
+    size_t count = 0;
+    for (const auto& list : local_cache().lists) {
+      count += list.count;
+    }
+    return count;
+  }
+
+  // Releases the blocks cached by the current thread.
+  static void trim() {
+    for (auto& list : local_cache().lists) {
+      while (list.head != nullptr) {
+        FreeBlock* block = list.head;
+        list.head = block->next;
+        ::operator delete(block);
+      }
+      list.count = 0;
+    }
+  }
+
+ private:
+  static constexpr size_t kGranularity = 16;
+  static constexpr size_t kMaxBlockSize = 256;
+  static constexpr size_t kNumSizeClasses = kMaxBlockSize / kGranularity;
+  // Up to 16K blocks per size class, i.e., at most a few megabytes per thread.
+  static constexpr size_t kMaxCachedBlocks = 1 << 14;
+
+  struct FreeBlock {
+    FreeBlock* next;
+  };
+
+  struct FreeList {
+    FreeBlock* head;
+    size_t count;
+  };
+
+  // This has to be trivially destructible, so that it remains usable while
+  // the other thread-local objects holding trees are being destroyed.
+  struct Cache {
+    FreeList lists[kNumSizeClasses];
+    bool registered;
+    bool retired;
+  };
+
+  // Drains the cache when the thread exits. Nodes released afterwards go
+  // straight back to the global allocator.
+  struct ThreadExit {
+    ~ThreadExit() {
+      trim();
+      local_cache().retired = true;
+    }
+  };
+
+  static size_t size_class(size_t size) {
+    return (size + kGranularity - 1) / kGranularity - 1;
+  }
+
+  static size_t block_size(size_t size_class) {
+    return (size_class + 1) * kGranularity;
+  }
+
+  static Cache& local_cache() {
+    static thread_local Cache s_cache{};
+    return s_cache;
+  }
+
+  static void register_thread_exit() { static thread_local ThreadExit s_exit; }
+};
+
+} // namespace sparta
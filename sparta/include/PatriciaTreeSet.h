@@ -23,6 +23,7 @@
 #include <boost/intrusive_ptr.hpp>
 
 #include "Exceptions.h"
+#include "PatriciaTreeNodePool.h"
 #include "PatriciaTreeUtil.h"
 
 namespace sparta {
@@ -335,6 +336,16 @@ class PatriciaTree {
 
   bool is_branch() const { return !is_leaf(); }
 
+  // Nodes are allocated from a per-thread pool. Since the destructor is
+  // virtual, the size passed on deletion is the one of the actual node.
+  static void* operator new(size_t size) {
+    return PatriciaTreeNodePool::allocate(size);
+  }
+
+  static void operator delete(void* p, size_t size) {
+    PatriciaTreeNodePool::deallocate(p, size);
+  }
+
   size_t hash() const { return m_hash; }
 
   void set_hash(size_t h) { m_hash = h; }
@@ -15,6 +15,7 @@
 #include <iomanip>
 #include <istream>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <ostream>
 #include <sstream>
@@ -91,6 +92,8 @@ class s_expr final {
    */
   explicit s_expr(const std::string& s);
 
+  explicit s_expr(std::string&& s);
+
   /*
    * Various constructors for a list. The empty list (nil) can be constructed
    * with `s_expr({})`.
@@ -161,9 +164,17 @@ class s_expr final {
 
   /*
    * Outputs a standard representation of the S-expression on the given stream.
+   * The representation is built in a buffer and written in one go.
    */
   void print(std::ostream& output) const;
 
+  /*
+   * Appends a standard representation of the S-expression to the given
+   * string. This is much cheaper than printing on a stream when dumping large
+   * S-expressions.
+   */
+  void print(std::string& output) const;
+
   /*
    * Returns a standard representation of the S-expression as a string.
    */
@@ -267,6 +278,77 @@ class s_expr_istream final {
   std::string m_what;
 };
 
+/*
+ * This is the counterpart of s_expr_istream for parsing S-expressions directly
+ * from a character buffer, e.g., a memory-mapped file. The buffer is scanned in
+ * place instead of character by character through the stream API, and the
+ * partial lists are built in scratch vectors that are reused across lists,
+ * so that each list is allocated only once, with its final size. The buffer
+ * must outlive the parser, but not the S-expressions that are read.
+ *
+ * Example usage:
+ *   std::string str = "(a b) (c);";
+ *   s_expr_buffer_istream si(str.data(), str.size());
+ *   s_expr e1, e2;
+ *   si >> e1 >> e2;
+ *   // e1 = (a b) and e2 = (c)
+ */
+class s_expr_buffer_istream final {
+ public:
+  s_expr_buffer_istream() = delete;
+
+  s_expr_buffer_istream(const s_expr_buffer_istream&) = delete;
+
+  s_expr_buffer_istream& operator=(const s_expr_buffer_istream&) = delete;
+
+  s_expr_buffer_istream(const char* data, size_t size)
+      : m_cur(data),
+        m_end(data + size),
+        m_depth(0),
+        m_line_number(1),
+        m_status(Status::Good),
+        m_what("OK") {}
+
+  s_expr_buffer_istream& operator>>(s_expr& expr);
+
+  /*
+   * The status functions have the same meaning as for s_expr_istream.
+   */
+
+  bool good() const { return m_status == Status::Good; }
+
+  bool fail() const { return m_status != Status::Good; }
+
+  bool eoi() const { return m_status == Status::EOI; }
+
+  const std::string& what() const { return m_what; }
+
+ private:
+  enum class Status { EOI, Good, Fail };
+
+  void skip_white_spaces();
+
+  bool parse_int32(int32_t* n);
+
+  bool parse_string(std::string* s);
+
+  // Adds an element to the innermost list being parsed. If there is no such
+  // list, the element is a complete S-expression, which is moved to `expr`.
+  bool add_element(s_expr&& element, s_expr* expr);
+
+  void set_status(Status status, const std::string& what_arg);
+
+  const char* m_cur;
+  const char* m_end;
+  // The elements of the lists being parsed. Only the first m_depth entries are
+  // in use; the others are kept around for their capacity.
+  std::vector<std::vector<s_expr>> m_stack;
+  size_t m_depth;
+  size_t m_line_number;
+  Status m_status;
+  std::string m_what;
+};
+
 /*
  * S-expressions are primarily intended to be used as a serialization format for
  * complex data structures. When deserializing an S-expression, it would be very
@@ -390,7 +472,7 @@ class Component {
 
   virtual size_t hash_value() const = 0;
 
-  virtual void print(std::ostream& o) const = 0;
+  virtual void print(std::string& o) const = 0;
 
  protected:
   ComponentKind m_kind;
@@ -421,7 +503,10 @@ class Int32Atom final : public Component {
     return hasher(m_value);
   }
 
-  void print(std::ostream& output) const { output << "#" << m_value; }
+  void print(std::string& output) const {
+    output += '#';
+    output += std::to_string(m_value);
+  }
 
  private:
   int32_t m_value;
@@ -429,8 +514,8 @@ class Int32Atom final : public Component {
 
 class StringAtom final : public Component {
  public:
-  explicit StringAtom(const std::string& s)
-      : Component(ComponentKind::StringAtom), m_string(s) {}
+  explicit StringAtom(std::string s)
+      : Component(ComponentKind::StringAtom), m_string(std::move(s)) {}
 
   const std::string& get_string() const { return m_string; }
 
@@ -452,10 +537,10 @@ class StringAtom final : public Component {
     return hasher(m_string);
   }
 
-  void print(std::ostream& output) const {
+  void print(std::string& output) const {
     if (m_string.empty()) {
       // The empty string needs to be explicitly represented.
-      output << "\"\"";
+      output += "\"\"";
       return;
     }
     if (std::find_if(m_string.begin(), m_string.end(), [](char c) {
@@ -463,11 +548,18 @@ class StringAtom final : public Component {
         }) == m_string.end()) {
       // If the string only contains alphanumeric characters and underscores, we
       // display it without quotes.
-      output << m_string;
+      output += m_string;
     } else {
       // The string is quoted and special characters are displayed using escape
-      // sequences.
-      output << std::quoted(m_string);
+      // sequences, like std::quoted does.
+      output += '"';
+      for (char c : m_string) {
+        if (c == '"' || c == '\\') {
+          output += '\\';
+        }
+        output += c;
+      }
+      output += '"';
     }
   }
 
@@ -530,15 +622,15 @@ class List final : public Component {
     return boost::hash_range(m_list.begin(), m_list.end());
   }
 
-  void print(std::ostream& output) const {
-    output << "(";
+  void print(std::string& output) const {
+    output += '(';
     for (auto it = m_list.begin(); it != m_list.end(); ++it) {
       it->print(output);
       if (std::next(it) != m_list.end()) {
-        output << " ";
+        output += ' ';
       }
     }
-    output << ")";
+    output += ')';
   }
 
  private:
@@ -658,6 +750,9 @@ inline s_expr::s_expr(int32_t n)
 inline s_expr::s_expr(const std::string& s)
     : m_component(std::make_shared<s_expr_impl::StringAtom>(s)) {}
 
+inline s_expr::s_expr(std::string&& s)
+    : m_component(std::make_shared<s_expr_impl::StringAtom>(std::move(s))) {}
+
 inline s_expr::s_expr(std::initializer_list<s_expr> l)
     : m_component(std::make_shared<s_expr_impl::List>(l.begin(), l.end())) {}
 
@@ -724,13 +819,19 @@ inline bool s_expr::equals(const s_expr& other) const {
 inline size_t s_expr::hash_value() const { return m_component->hash_value(); }
 
 inline void s_expr::print(std::ostream& output) const {
+  std::string buffer;
+  print(buffer);
+  output.write(buffer.data(), buffer.size());
+}
+
+inline void s_expr::print(std::string& output) const {
   m_component->print(output);
 }
 
 inline std::string s_expr::str() const {
-  std::ostringstream out;
+  std::string out;
   print(out);
-  return out.str();
+  return out;
 }
 
 inline void s_expr::add_element(const s_expr& element) {
@@ -857,6 +958,172 @@ inline void s_expr_istream::set_status(Status status,
   m_what = ss.str();
 }
 
+inline s_expr_buffer_istream& s_expr_buffer_istream::operator>>(
+    s_expr& expr) {
+  for (;;) {
+    skip_white_spaces();
+    if (m_cur == m_end) {
+      if (m_depth > 0) {
+        set_status(Status::Fail, "Incomplete S-expression");
+      } else {
+        set_status(Status::EOI, "End of input");
+      }
+      return *this;
+    }
+    char next_char = *m_cur;
+    switch (next_char) {
+    case '(': {
+      ++m_cur;
+      if (m_depth == m_stack.size()) {
+        m_stack.emplace_back();
+      }
+      m_stack[m_depth++].clear();
+      break;
+    }
+    case ')': {
+      if (m_depth == 0) {
+        set_status(Status::Fail, "Extra ')' encountered");
+        return *this;
+      }
+      ++m_cur;
+      auto& elements = m_stack[--m_depth];
+      s_expr list(std::make_move_iterator(elements.begin()),
+                  std::make_move_iterator(elements.end()));
+      elements.clear();
+      if (add_element(std::move(list), &expr)) {
+        return *this;
+      }
+      break;
+    }
+    case '#': {
+      ++m_cur;
+      int32_t n;
+      if (!parse_int32(&n)) {
+        set_status(Status::Fail, "Error parsing int32_t literal");
+        return *this;
+      }
+      if (add_element(s_expr(n), &expr)) {
+        return *this;
+      }
+      break;
+    }
+    case '"': {
+      std::string s;
+      if (!parse_string(&s)) {
+        set_status(Status::Fail, "Error parsing string literal");
+        return *this;
+      }
+      if (add_element(s_expr(std::move(s)), &expr)) {
+        return *this;
+      }
+      break;
+    }
+    case ';': {
+      m_cur = std::find(m_cur, m_end, '\n');
+      if (m_cur != m_end) {
+        ++m_cur;
+      }
+      ++m_line_number;
+      break;
+    }
+    default: {
+      // The next S-expression is necessary a symbol, i.e., an unquoted string.
+      if (!s_expr_impl::is_symbol_char(next_char)) {
+        std::ostringstream out;
+        out << "Unexpected character encountered: '" << next_char << "'";
+        set_status(Status::Fail, out.str());
+        return *this;
+      }
+      const char* start = m_cur;
+      while (m_cur != m_end && s_expr_impl::is_symbol_char(*m_cur)) {
+        ++m_cur;
+      }
+      if (add_element(s_expr(std::string(start, m_cur)), &expr)) {
+        return *this;
+      }
+    }
+    }
+  }
+}
+
+inline void s_expr_buffer_istream::skip_white_spaces() {
+  for (; m_cur != m_end && std::isspace(*m_cur); ++m_cur) {
+    if (*m_cur == '\n') {
+      ++m_line_number;
+    }
+  }
+}
+
+inline bool s_expr_buffer_istream::parse_int32(int32_t* n) {
+  // Like reading an int32_t from a stream, this skips leading white spaces.
+  while (m_cur != m_end && std::isspace(*m_cur)) {
+    ++m_cur;
+  }
+  bool negative = false;
+  if (m_cur != m_end && (*m_cur == '-' || *m_cur == '+')) {
+    negative = *m_cur == '-';
+    ++m_cur;
+  }
+  if (m_cur == m_end || !std::isdigit(*m_cur)) {
+    return false;
+  }
+  int64_t value = 0;
+  for (; m_cur != m_end && std::isdigit(*m_cur); ++m_cur) {
+    value = value * 10 + (*m_cur - '0');
+    if (value > int64_t(std::numeric_limits<int32_t>::max()) + 1) {
+      return false;
+    }
+  }
+  value = negative ? -value : value;
+  if (value > std::numeric_limits<int32_t>::max()) {
+    return false;
+  }
+  *n = static_cast<int32_t>(value);
+  return true;
+}
+
+inline bool s_expr_buffer_istream::parse_string(std::string* s) {
+  // Like std::quoted, a backslash escapes the next character.
+  ++m_cur;
+  const char* start = m_cur;
+  while (m_cur != m_end && *m_cur != '"' && *m_cur != '\\') {
+    ++m_cur;
+  }
+  s->assign(start, m_cur);
+  while (m_cur != m_end) {
+    char c = *m_cur++;
+    if (c == '"') {
+      return true;
+    }
+    if (c == '\\') {
+      if (m_cur == m_end) {
+        return false;
+      }
+      c = *m_cur++;
+    }
+    s->push_back(c);
+  }
+  return false;
+}
+
+inline bool s_expr_buffer_istream::add_element(s_expr&& element,
+                                               s_expr* expr) {
+  if (m_depth == 0) {
+    *expr = std::move(element);
+    return true;
+  }
+  m_stack[m_depth - 1].push_back(std::move(element));
+  return false;
+}
+
+inline void s_expr_buffer_istream::set_status(Status status,
+                                              const std::string& what_arg) {
+  m_status = status;
+  std::ostringstream ss;
+  ss << "On line " << m_line_number << ": " << what_arg;
+  m_what = ss.str();
+}
+
 inline s_patn::s_patn()
     : m_pattern(std::make_shared<s_expr_impl::WildcardPattern>()) {}
 
@@ -14,11 +14,14 @@
 #include <cassert>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <numeric>
 #include <queue>
 #include <random>
 #include <utility>
+#include <vector>
 
 #include "Arity.h"
 
@@ -57,6 +60,40 @@ inline std::vector<unsigned int> create_permutation(unsigned int num,
   return attempts;
 }
 
+/**
+ * Longest-processing-time-first scheduling. Given a cost estimate per item,
+ * returns (item index, worker id) pairs, ordered by decreasing cost, where each
+ * item goes to the worker with the smallest accumulated cost so far. Ties are
+ * broken by item index and worker id, so the assignment is deterministic.
+ */
+inline std::vector<std::pair<size_t, unsigned int>> schedule_by_cost(
+    const std::vector<size_t>& costs, unsigned int num_workers) {
+  std::vector<size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) {
+    return costs[a] > costs[b];
+  });
+
+  using Load = std::pair<size_t, unsigned int>;
+  std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+  for (unsigned int i = 0; i < num_workers; ++i) {
+    loads.emplace(0, i);
+  }
+
+  std::vector<std::pair<size_t, unsigned int>> schedule;
+  schedule.reserve(order.size());
+  for (auto idx : order) {
+    auto load = loads.top();
+    loads.pop();
+    schedule.emplace_back(idx, load.second);
+    // Account for a fixed per-item overhead so that zero-cost items still get
+    // spread across workers.
+    load.first += costs[idx] + 1;
+    loads.push(load);
+  }
+  return schedule;
+}
+
 class Semaphore {
  public:
   explicit Semaphore(size_t initial = 0u) : m_count(initial) {}
@@ -94,6 +131,8 @@ struct StateCounters {
   std::atomic_uint num_non_empty;
   std::atomic_uint num_running;
   const unsigned int num_all;
+  // The tasks of the current run, including the ones pushed while running.
+  std::atomic<size_t> num_tasks;
   // Mutexes aren't move-able.
   std::unique_ptr<Semaphore> waiter;
 
@@ -101,20 +140,218 @@ struct StateCounters {
       : num_non_empty(0),
         num_running(0),
         num_all(num),
+        num_tasks(0),
         waiter(new Semaphore(0)) {}
   StateCounters(StateCounters&& other)
       : num_non_empty(other.num_non_empty.load()),
         num_running(other.num_running.load()),
         num_all(other.num_all),
+        num_tasks(other.num_tasks.load()),
         waiter(std::move(other.waiter)) {}
 };
 
+/*
+ * The work queues that are in the middle of a run, so that another thread can
+ * report how far along they are, e.g. to notice a stall.
+ */
+class ProgressRegistry {
+ public:
+  struct Progress {
+    size_t done;
+    size_t total;
+  };
+
+  static ProgressRegistry& get() {
+    static ProgressRegistry* s_registry = new ProgressRegistry();
+    return *s_registry;
+  }
+
+  // Lists the queue that `progress` reports on until `remove(id)`.
+  uint64_t add(std::function<Progress()> progress) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_queues.emplace_back(m_next_id, std::move(progress));
+    return m_next_id++;
+  }
+
+  void remove(uint64_t id) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_queues.erase(std::remove_if(m_queues.begin(), m_queues.end(),
+                                  [id](const auto& p) {
+                                    return p.first == id;
+                                  }),
+                   m_queues.end());
+  }
+
+  // The progress of the running queues, in the order they started. The
+  // queues can't finish while they are being read.
+  std::vector<Progress> snapshot() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::vector<Progress> res;
+    res.reserve(m_queues.size());
+    for (const auto& p : m_queues) {
+      res.push_back(p.second());
+    }
+    return res;
+  }
+
+ private:
+  ProgressRegistry() = default;
+
+  std::mutex m_mtx;
+  uint64_t m_next_id{0};
+  std::vector<std::pair<uint64_t, std::function<Progress()>>> m_queues;
+};
+
+// Lists a queue in the ProgressRegistry over its lifetime.
+class ScopedProgress {
+ public:
+  explicit ScopedProgress(std::function<ProgressRegistry::Progress()> progress)
+      : m_id(ProgressRegistry::get().add(std::move(progress))) {}
+  ~ScopedProgress() { ProgressRegistry::get().remove(m_id); }
+
+  ScopedProgress(const ScopedProgress&) = delete;
+  ScopedProgress& operator=(const ScopedProgress&) = delete;
+
+ private:
+  uint64_t m_id;
+};
+
+/*
+ * The next task to run from a worker queue: the oldest one for a std::queue,
+ * the greatest one for a std::priority_queue.
+ */
+template <class Input>
+Input& next_task(std::queue<Input>& queue) {
+  return queue.front();
+}
+
+template <class Input, class Container, class Compare>
+Input next_task(std::priority_queue<Input, Container, Compare>& queue) {
+  return queue.top();
+}
+
+/*
+ * The long-lived threads that run the workers of all the work queues, so that
+ * running many small queues doesn't pay for creating and joining threads, and
+ * the threads keep their warm caches and thread-local state.
+ *
+ * A batch never waits for a thread to become idle: if there are not enough
+ * idle threads, e.g. because a work queue is run from the worker of another
+ * one, new threads are added to the pool. The pool is never destroyed. Its
+ * threads block while idle and go away with the process.
+ */
+class ThreadPool {
+ public:
+  static ThreadPool& get() {
+    static ThreadPool* s_pool = new ThreadPool();
+    return *s_pool;
+  }
+
+  /*
+   * Calls `fn(i)` for every `i` in `[0, num_tasks)`, each on its own thread of
+   * the pool, and returns once all of them are done. An exception escaping
+   * `fn` terminates the program, like for any other thread.
+   */
+  void run(size_t num_tasks, const std::function<void(size_t)>& fn) {
+    Batch batch(num_tasks);
+    for (size_t i = 0; i < num_tasks; ++i) {
+      auto* worker = acquire();
+      std::lock_guard<std::mutex> lock(worker->mtx);
+      worker->fn = &fn;
+      worker->index = i;
+      worker->batch = &batch;
+      worker->cv.notify_one();
+    }
+    std::unique_lock<std::mutex> lock(batch.mtx);
+    batch.cv.wait(lock, [&batch] { return batch.remaining == 0; });
+  }
+
+  // The number of threads created so far.
+  size_t size() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_workers.size();
+  }
+
+ private:
+  struct Batch {
+    explicit Batch(size_t num_tasks) : remaining(num_tasks) {}
+    std::mutex mtx;
+    std::condition_variable cv;
+    size_t remaining;
+  };
+
+  struct Worker {
+    std::mutex mtx;
+    std::condition_variable cv;
+    // The current task, set while the worker is not idle.
+    const std::function<void(size_t)>* fn{nullptr};
+    size_t index{0};
+    Batch* batch{nullptr};
+    boost::thread thread;
+  };
+
+  ThreadPool() = default;
+
+  Worker* acquire() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (!m_idle.empty()) {
+      auto* worker = m_idle.back();
+      m_idle.pop_back();
+      return worker;
+    }
+    m_workers.emplace_back(std::make_unique<Worker>());
+    auto* worker = m_workers.back().get();
+    boost::thread::attributes attrs;
+    attrs.set_stack_size(8 * 1024 * 1024);
+    worker->thread = boost::thread(attrs, [this, worker] { loop(worker); });
+    return worker;
+  }
+
+  void loop(Worker* worker) {
+    while (true) {
+      const std::function<void(size_t)>* fn;
+      size_t index;
+      Batch* batch;
+      {
+        std::unique_lock<std::mutex> lock(worker->mtx);
+        worker->cv.wait(lock, [worker] { return worker->fn != nullptr; });
+        fn = worker->fn;
+        index = worker->index;
+        batch = worker->batch;
+        worker->fn = nullptr;
+      }
+      (*fn)(index);
+      // Become idle before the batch is done, so that a batch run right after
+      // this one can reuse this thread.
+      {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_idle.push_back(worker);
+      }
+      std::lock_guard<std::mutex> lock(batch->mtx);
+      if (--batch->remaining == 0) {
+        batch->cv.notify_all();
+      }
+    }
+  }
+
+  std::mutex m_mtx;
+  std::vector<std::unique_ptr<Worker>> m_workers;
+  std::vector<Worker*> m_idle;
+};
+
 } // namespace workqueue_impl
 
-template <class Input, typename Executor>
+/*
+ * By default every worker runs its tasks in FIFO order. With a
+ * std::priority_queue as `Queue`, a worker always runs the greatest task (per
+ * the queue's comparator) of whichever queue it is taking from.
+ */
+template <class Input,
+          typename Executor,
+          class Queue = std::queue<Input>>
 class SpartaWorkQueue;
 
-template <class Input>
+template <class Input, class Queue = std::queue<Input>>
 class SpartaWorkerState final {
  public:
   SpartaWorkerState(size_t id, workqueue_impl::StateCounters* sc, bool can_push)
@@ -134,6 +371,7 @@ class SpartaWorkerState final {
     if (m_state_counters->num_running < m_state_counters->num_all) {
       m_state_counters->waiter->give(1u); // May consider waking all.
     }
+    m_state_counters->num_tasks.fetch_add(1, std::memory_order_relaxed);
     m_queue.push(task);
   }
 
@@ -150,7 +388,7 @@ class SpartaWorkerState final {
   };
 
  private:
-  boost::optional<Input> pop_task(SpartaWorkerState<Input>* other) {
+  boost::optional<Input> pop_task(SpartaWorkerState* other) {
     std::lock_guard<std::mutex> guard(m_queue_mtx);
     if (!m_queue.empty()) {
       other->set_running(true);
@@ -158,7 +396,7 @@ class SpartaWorkerState final {
         assert(m_state_counters->num_non_empty > 0);
         --m_state_counters->num_non_empty;
       }
-      auto task = std::move(m_queue.front());
+      auto task = std::move(workqueue_impl::next_task(m_queue));
       m_queue.pop();
       return task;
     }
@@ -167,29 +405,35 @@ class SpartaWorkerState final {
 
   size_t m_id;
   bool m_running{false};
-  std::queue<Input> m_queue;
+  // Only written by the worker of this state, so it isn't contended.
+  std::atomic<size_t> m_num_done{0};
+  Queue m_queue;
   std::mutex m_queue_mtx;
   workqueue_impl::StateCounters* m_state_counters;
   const bool m_can_push_task{false};
 
-  template <class, typename>
+  template <class, typename, class>
   friend class SpartaWorkQueue;
 };
 
-template <class Input, typename Executor>
+template <class Input, typename Executor, class Queue>
 class SpartaWorkQueue {
+ public:
+  using WorkerState = SpartaWorkerState<Input, Queue>;
+
  private:
   // Using templates for Executor to avoid the performance overhead of
   // std::function
   Executor m_executor;
-  std::vector<std::unique_ptr<SpartaWorkerState<Input>>> m_states;
+  std::vector<std::unique_ptr<WorkerState>> m_states;
   const size_t m_num_threads{1};
   size_t m_insert_idx{0};
   workqueue_impl::StateCounters m_state_counters;
   const bool m_can_push_task{false};
 
-  void consume(SpartaWorkerState<Input>* state, Input task) {
+  void consume(WorkerState* state, Input task) {
     m_executor(state, task);
+    state->m_num_done.fetch_add(1, std::memory_order_relaxed);
   }
 
  public:
@@ -214,53 +458,78 @@ class SpartaWorkQueue {
   /* Add an item on the queue of the given worker. */
   void add_item(Input task, size_t worker_id);
 
+  /*
+   * Add all items, using `cost_fn(item)` as an estimate of the work each item
+   * represents (e.g. an instruction count). The most expensive items are
+   * queued first, and items are spread so that the accumulated cost per worker
+   * is balanced. Idle workers still steal from the other queues, so the
+   * estimates only need to be roughly right.
+   */
+  template <class Items, typename CostFn>
+  void add_items_by_cost(const Items& items, const CostFn& cost_fn);
+
   /**
-   * Spawn threads and evaluate function.  This method blocks.
+   * Evaluate function on the threads of the shared pool.  This method blocks.
    */
   void run_all();
 
-  template <class>
+  template <class, class>
   friend class SpartaWorkerState;
 };
 
-template <class Input, typename Executor>
-SpartaWorkQueue<Input, Executor>::SpartaWorkQueue(Executor executor,
-                                                  unsigned int num_threads,
-                                                  bool push_tasks_while_running)
+template <class Input, typename Executor, class Queue>
+SpartaWorkQueue<Input, Executor, Queue>::SpartaWorkQueue(
+    Executor executor, unsigned int num_threads, bool push_tasks_while_running)
     : m_executor(executor),
       m_num_threads(num_threads),
       m_state_counters(num_threads),
       m_can_push_task(push_tasks_while_running) {
   assert(num_threads >= 1);
   for (unsigned int i = 0; i < m_num_threads; ++i) {
-    m_states.emplace_back(std::make_unique<SpartaWorkerState<Input>>(
-        i, &m_state_counters, m_can_push_task));
+    m_states.emplace_back(
+        std::make_unique<WorkerState>(i, &m_state_counters, m_can_push_task));
   }
 }
 
-template <class Input, typename Executor>
-void SpartaWorkQueue<Input, Executor>::add_item(Input task) {
+template <class Input, typename Executor, class Queue>
+void SpartaWorkQueue<Input, Executor, Queue>::add_item(Input task) {
   m_insert_idx = (m_insert_idx + 1) % m_num_threads;
   assert(m_insert_idx < m_states.size());
   m_states[m_insert_idx]->m_queue.push(task);
 }
 
-template <class Input, typename Executor>
-void SpartaWorkQueue<Input, Executor>::add_item(Input task, size_t worker_id) {
+template <class Input, typename Executor, class Queue>
+void SpartaWorkQueue<Input, Executor, Queue>::add_item(Input task,
+                                                       size_t worker_id) {
   assert(worker_id < m_states.size());
   m_states[worker_id]->m_queue.push(task);
 }
 
+template <class Input, typename Executor, class Queue>
+template <class Items, typename CostFn>
+void SpartaWorkQueue<Input, Executor, Queue>::add_items_by_cost(
+    const Items& items, const CostFn& cost_fn) {
+  std::vector<Input> tasks;
+  std::vector<size_t> costs;
+  for (const auto& item : items) {
+    tasks.emplace_back(item);
+    costs.push_back(cost_fn(tasks.back()));
+  }
+  for (const auto& p : workqueue_impl::schedule_by_cost(costs, m_num_threads)) {
+    add_item(std::move(tasks[p.first]), p.second);
+  }
+}
+
 /*
  * Each worker thread pulls from its own queue first, and then once finished
  * looks randomly at other queues to try and steal work.
  */
-template <class Input, typename Executor>
-void SpartaWorkQueue<Input, Executor>::run_all() {
+template <class Input, typename Executor, class Queue>
+void SpartaWorkQueue<Input, Executor, Queue>::run_all() {
   m_state_counters.num_non_empty = 0;
   m_state_counters.num_running = 0;
   m_state_counters.waiter->take_all();
-  auto worker = [&](SpartaWorkerState<Input>* state, size_t state_idx) {
+  auto worker = [&](WorkerState* state, size_t state_idx) {
     auto attempts =
         workqueue_impl::create_permutation(m_num_threads, state_idx);
     while (true) {
@@ -298,24 +567,26 @@ void SpartaWorkQueue<Input, Executor>::run_all() {
     }
   };
 
+  size_t num_tasks = 0;
   for (size_t i = 0; i < m_num_threads; ++i) {
     if (!m_states[i]->m_queue.empty()) {
       ++m_state_counters.num_non_empty;
     }
+    num_tasks += m_states[i]->m_queue.size();
+    m_states[i]->m_num_done = 0;
   }
+  m_state_counters.num_tasks = num_tasks;
+  workqueue_impl::ScopedProgress progress([this]() {
+    size_t done = 0;
+    for (const auto& state : m_states) {
+      done += state->m_num_done.load(std::memory_order_relaxed);
+    }
+    return workqueue_impl::ProgressRegistry::Progress{
+        done, m_state_counters.num_tasks.load(std::memory_order_relaxed)};
+  });
 
-  std::vector<boost::thread> all_threads;
-  all_threads.reserve(m_num_threads);
-  for (size_t i = 0; i < m_num_threads; ++i) {
-    boost::thread::attributes attrs;
-    attrs.set_stack_size(8 * 1024 * 1024);
-    all_threads.emplace_back(attrs,
-                             std::bind<void>(worker, m_states[i].get(), i));
-  }
-
-  for (auto& thread : all_threads) {
-    thread.join();
-  }
+  workqueue_impl::ThreadPool::get().run(
+      m_num_threads, [&](size_t i) { worker(m_states[i].get(), i); });
 
   for (size_t i = 0; i < m_num_threads; ++i) {
     assert(m_states[i]->m_queue.empty());
@@ -324,15 +595,17 @@ void SpartaWorkQueue<Input, Executor>::run_all() {
 
 namespace workqueue_impl {
 // Helper classes so the type of Executor can be inferred
-template <typename Input, typename Fn>
+template <typename Input, typename Fn, class Queue = std::queue<Input>>
 struct NoStateWorkQueueHelper {
   Fn fn;
-  void operator()(SpartaWorkerState<Input>*, Input a) { fn(a); }
+  void operator()(SpartaWorkerState<Input, Queue>*, Input a) { fn(a); }
 };
-template <typename Input, typename Fn>
+template <typename Input, typename Fn, class Queue = std::queue<Input>>
 struct WithStateWorkQueueHelper {
   Fn fn;
-  void operator()(SpartaWorkerState<Input>* state, Input a) { fn(state, a); }
+  void operator()(SpartaWorkerState<Input, Queue>* state, Input a) {
+    fn(state, a);
+  }
 };
 } // namespace workqueue_impl
 
@@ -75,6 +75,9 @@ class WpoNode final {
   std::set<WpoIdx> m_predecessors;
   // Number of outer predecessors w.r.t. the component (for exits only).
   std::unordered_map<WpoIdx, uint32_t> m_num_outer_preds;
+  // Number of components that contain this node. A head and its exit belong
+  // to their own component.
+  uint32_t m_depth{0};
 
  public:
   WpoNode(const NodeId& node, Type type, uint32_t size)
@@ -107,6 +110,9 @@ class WpoNode final {
   // Get size of the SCC.
   uint32_t get_size() const { return m_size; }
 
+  // Get the nesting depth of this node in the component hierarchy.
+  uint32_t get_depth() const { return m_depth; }
+
  private:
   // Add successor.
   void add_successor(WpoIdx idx) { m_successors.insert(idx); }
@@ -224,6 +230,10 @@ class WeakPartialOrdering final {
   // Exit of the head node.
   WpoIdx get_exit_of_head(WpoIdx head) const { return head - 1; }
 
+  // Number of components that contain the node. Nodes outside of any
+  // component have depth 0.
+  uint32_t get_depth(WpoIdx idx) const { return m_nodes[idx].get_depth(); }
+
   // NodeId for the node.
   const NodeId& get_node(WpoIdx idx) const { return m_nodes[idx].get_node(); }
 
@@ -289,6 +299,19 @@ class WpoBuilder final {
       }
       m_wpo_space[x].inc_num_outer_preds(v);
     }
+    // Compute the nesting depths. A component's head is always placed after
+    // the nodes it contains, and an exit right before its head, so visiting
+    // the nodes in reverse order sees every head before its members.
+    for (WpoIdx idx = m_wpo_space.size(); idx-- > 0;) {
+      auto& node = m_wpo_space[idx];
+      if (node.is_exit()) {
+        node.m_depth = m_wpo_space[idx + 1].m_depth;
+        continue;
+      }
+      auto parent = m_parent.at(idx);
+      uint32_t outer_depth = parent == idx ? 0 : m_wpo_space[parent].m_depth;
+      node.m_depth = node.is_head() ? outer_depth + 1 : outer_depth;
+    }
   }
 
  private:
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "BitVectorSetAbstractDomain.h"
+
+#include <algorithm>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "BitVectorSet.h"
+
+using namespace sparta;
+
+using Domain = BitVectorSetAbstractDomain<uint32_t>;
+
+namespace {
+
+// Spread over several words, including word boundaries.
+constexpr uint32_t a = 1;
+constexpr uint32_t b = 63;
+constexpr uint32_t c = 64;
+constexpr uint32_t d = 200;
+constexpr uint32_t e = 1000;
+
+std::vector<uint32_t> to_vector(const BitVectorSet<uint32_t>& s) {
+  return std::vector<uint32_t>(s.begin(), s.end());
+}
+
+} // namespace
+
+TEST(BitVectorSetAbstractDomainTest, latticeOperations) {
+  Domain e1(a);
+  Domain e2({a, b, c});
+  Domain e3({b, c, d});
+
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a));
+  EXPECT_THAT(to_vector(e2.elements()), ::testing::ElementsAre(a, b, c));
+  EXPECT_THAT(to_vector(e3.elements()), ::testing::ElementsAre(b, c, d));
+  EXPECT_EQ(3, e3.size());
+
+  EXPECT_TRUE(Domain::bottom().leq(Domain::top()));
+  EXPECT_FALSE(Domain::top().leq(Domain::bottom()));
+  EXPECT_FALSE(e2.is_top());
+  EXPECT_FALSE(e2.is_bottom());
+
+  EXPECT_TRUE(e1.leq(e2));
+  EXPECT_FALSE(e1.leq(e3));
+  EXPECT_FALSE(e3.leq(e2));
+  EXPECT_TRUE(e2.equals(Domain({b, c, a})));
+  EXPECT_FALSE(e2.equals(e3));
+
+  EXPECT_THAT(to_vector(e2.join(e3).elements()),
+              ::testing::ElementsAre(a, b, c, d));
+  EXPECT_TRUE(e1.join(e2).equals(e2));
+  EXPECT_TRUE(e2.join(Domain::bottom()).equals(e2));
+  EXPECT_TRUE(e2.join(Domain::top()).is_top());
+  EXPECT_TRUE(e1.widening(e2).equals(e2));
+
+  EXPECT_THAT(to_vector(e2.meet(e3).elements()), ::testing::ElementsAre(b, c));
+  EXPECT_TRUE(e1.meet(e2).equals(e1));
+  EXPECT_TRUE(e2.meet(Domain::bottom()).is_bottom());
+  EXPECT_TRUE(e2.meet(Domain::top()).equals(e2));
+  EXPECT_FALSE(e1.meet(e3).is_bottom());
+  EXPECT_TRUE(e1.meet(e3).elements().empty());
+  EXPECT_TRUE(e1.narrowing(e2).equals(e1));
+
+  EXPECT_TRUE(e2.contains(a));
+  EXPECT_FALSE(e3.contains(a));
+  EXPECT_FALSE(e3.contains(e));
+
+  // Making sure no side effect took place.
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a));
+  EXPECT_THAT(to_vector(e2.elements()), ::testing::ElementsAre(a, b, c));
+  EXPECT_THAT(to_vector(e3.elements()), ::testing::ElementsAre(b, c, d));
+}
+
+TEST(BitVectorSetAbstractDomainTest, destructiveOperations) {
+  Domain e1(a);
+  Domain e2({a, b, c});
+  Domain e3({b, c, d});
+
+  e1.add(b);
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a, b));
+  e1.add({a, c});
+  EXPECT_TRUE(e1.equals(e2));
+
+  e1.remove(b);
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a, c));
+  e1.remove(e);
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a, c));
+  e1.remove({a, c});
+  EXPECT_TRUE(e1.elements().empty());
+
+  // Sets that only differ by trailing empty words are equal.
+  e1.add(e);
+  e1.remove(e);
+  EXPECT_TRUE(e1.equals(Domain(BitVectorSet<uint32_t>())));
+  EXPECT_TRUE(Domain(BitVectorSet<uint32_t>()).equals(e1));
+
+  e1.join_with(e2);
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a, b, c));
+  e1.join_with(Domain::bottom());
+  EXPECT_TRUE(e1.equals(e2));
+  e1.join_with(Domain::top());
+  EXPECT_TRUE(e1.is_top());
+
+  e1 = Domain(a);
+  e2.meet_with(e3);
+  EXPECT_THAT(to_vector(e2.elements()), ::testing::ElementsAre(b, c));
+  e1.meet_with(e2);
+  EXPECT_TRUE(e1.elements().empty());
+  e1.meet_with(Domain::bottom());
+  EXPECT_TRUE(e1.is_bottom());
+
+  e1 = Domain({a, b, c, e});
+  e1.difference_with(Domain({b, d}));
+  EXPECT_THAT(to_vector(e1.elements()), ::testing::ElementsAre(a, c, e));
+  e1.difference_with(Domain::top());
+  EXPECT_TRUE(e1.is_bottom());
+}
+
+TEST(BitVectorSetAbstractDomainTest, agreesWithStdSet) {
+  std::mt19937 rng(0);
+  std::uniform_int_distribution<uint32_t> element(0, 300);
+  auto random_set = [&](std::set<uint32_t>* reference) {
+    BitVectorSet<uint32_t> s;
+    for (size_t i = 0, n = element(rng) % 40; i < n; ++i) {
+      auto x = element(rng);
+      s.insert(x);
+      reference->insert(x);
+    }
+    return s;
+  };
+  for (size_t round = 0; round < 200; ++round) {
+    std::set<uint32_t> r1, r2;
+    auto s1 = random_set(&r1);
+    auto s2 = random_set(&r2);
+
+    std::vector<uint32_t> expected;
+    std::set_union(r1.begin(), r1.end(), r2.begin(), r2.end(),
+                   std::back_inserter(expected));
+    EXPECT_THAT(to_vector(s1.get_union_with(s2)),
+                ::testing::ElementsAreArray(expected));
+
+    expected.clear();
+    std::set_intersection(r1.begin(), r1.end(), r2.begin(), r2.end(),
+                          std::back_inserter(expected));
+    EXPECT_THAT(to_vector(s1.get_intersection_with(s2)),
+                ::testing::ElementsAreArray(expected));
+
+    expected.clear();
+    std::set_difference(r1.begin(), r1.end(), r2.begin(), r2.end(),
+                        std::back_inserter(expected));
+    EXPECT_THAT(to_vector(s1.get_difference_with(s2)),
+                ::testing::ElementsAreArray(expected));
+
+    EXPECT_EQ(std::includes(r2.begin(), r2.end(), r1.begin(), r1.end()),
+              s1.is_subset_of(s2));
+    EXPECT_EQ(r1 == r2, s1.equals(s2));
+    EXPECT_EQ(r1.size(), s1.size());
+    EXPECT_EQ(r1.empty(), s1.empty());
+  }
+}
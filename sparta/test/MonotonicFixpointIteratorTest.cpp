@@ -463,6 +463,95 @@ TYPED_TEST(MonotonicFixpointIteratorLivenessTest, program3) {
               ::testing::UnorderedElementsAre("z", "c", "b", "y"));
 }
 
+using WpoLivenessTest = MonotonicFixpointIteratorLivenessTest<
+    liveness::FixpointEngine<sparta::MonotonicFixpointIterator>>;
+
+/*
+ * After editing some statements, an incremental run must give the same
+ * invariants as a full run over the edited program.
+ */
+TEST_F(WpoLivenessTest, incrementalRun) {
+  using namespace liveness;
+  using Engine = FixpointEngine<sparta::MonotonicFixpointIterator>;
+  Engine fp(m_program3);
+  fp.run(LivenessDomain());
+
+  auto expect_same_as_full_run = [&](Engine& incremental) {
+    Engine full(m_program3);
+    full.run(LivenessDomain());
+    for (uint32_t node = 1; node <= 8; ++node) {
+      EXPECT_TRUE(incremental.get_live_in_vars_at(node).equals(
+          full.get_live_in_vars_at(node)))
+          << node;
+      EXPECT_TRUE(incremental.get_live_out_vars_at(node).equals(
+          full.get_live_out_vars_at(node)))
+          << node;
+    }
+  };
+
+  // Inside the nested loops.
+  m_program3.add(5, Statement(/* use: */ {"c", "e"}, /* def: */ {"a", "b"}));
+  fp.run_incremental(LivenessDomain(), std::vector<uint32_t>{5});
+  expect_same_as_full_run(fp);
+  EXPECT_THAT(fp.get_live_in_vars_at(1).elements(),
+              ::testing::UnorderedElementsAre("a", "b", "e", "z"));
+
+  // Outside of any loop; nothing else changes.
+  m_program3.add(7, Statement(/* use: */ {"z", "w"}, /* def: */ {}));
+  m_program3.add(8, Statement(/* use: */ {"a"}, /* def: */ {"c", "d"}));
+  fp.run_incremental(LivenessDomain(), std::vector<uint32_t>{7, 8});
+  expect_same_as_full_run(fp);
+
+  // No edits.
+  fp.run_incremental(LivenessDomain(), std::vector<uint32_t>{});
+  expect_same_as_full_run(fp);
+}
+
+/*
+ * Once a run exceeds its budget, all the invariants are Top. A budget that is
+ * large enough gives the same invariants as no budget.
+ */
+template <typename Engine>
+void check_budget(const liveness::Program& program,
+                  const std::vector<uint32_t>& nodes) {
+  using namespace liveness;
+  Engine fp(program);
+  fp.set_budget(/* max_steps */ 3);
+  fp.run(LivenessDomain());
+  EXPECT_TRUE(fp.budget_exceeded());
+  for (auto node : nodes) {
+    EXPECT_TRUE(fp.get_live_in_vars_at(node).is_top()) << node;
+    EXPECT_TRUE(fp.get_live_out_vars_at(node).is_top()) << node;
+  }
+
+  Engine full(program);
+  full.run(LivenessDomain());
+  fp.set_budget(/* max_steps */ 1000);
+  fp.run(LivenessDomain());
+  EXPECT_FALSE(fp.budget_exceeded());
+  for (auto node : nodes) {
+    EXPECT_TRUE(
+        fp.get_live_in_vars_at(node).equals(full.get_live_in_vars_at(node)))
+        << node;
+    EXPECT_TRUE(
+        fp.get_live_out_vars_at(node).equals(full.get_live_out_vars_at(node)))
+        << node;
+  }
+}
+
+TEST_F(WpoLivenessTest, budget) {
+  check_budget<liveness::FixpointEngine<sparta::MonotonicFixpointIterator>>(
+      m_program3, {1, 2, 3, 4, 5, 6, 7, 8});
+}
+
+using WtoLivenessTest = MonotonicFixpointIteratorLivenessTest<
+    liveness::FixpointEngine<sparta::WTOMonotonicFixpointIterator>>;
+
+TEST_F(WtoLivenessTest, budget) {
+  check_budget<liveness::FixpointEngine<sparta::WTOMonotonicFixpointIterator>>(
+      m_program3, {1, 2, 3, 4, 5, 6, 7, 8});
+}
+
 namespace numerical {
 
 using namespace sparta;
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PatriciaTreeNodePool.h"
+
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "PatriciaTreeMap.h"
+#include "PatriciaTreeSet.h"
+
+using namespace sparta;
+
+namespace {
+
+constexpr size_t kNumThreads = 8;
+constexpr size_t kBlocksPerRound = 1000;
+constexpr size_t kNumRounds = 20;
+
+size_t churn_block_size(size_t i) { return i % 2 == 0 ? 32 : 48; }
+
+} // namespace
+
+TEST(PatriciaTreeNodePoolTest, blocksAreReused) {
+  PatriciaTreeNodePool::trim();
+  void* p = PatriciaTreeNodePool::allocate(40);
+  PatriciaTreeNodePool::deallocate(p, 40);
+  EXPECT_EQ(1, PatriciaTreeNodePool::cached_blocks());
+  // Sizes in the same size class share their blocks.
+  EXPECT_EQ(p, PatriciaTreeNodePool::allocate(48));
+  EXPECT_EQ(0, PatriciaTreeNodePool::cached_blocks());
+  PatriciaTreeNodePool::deallocate(p, 48);
+
+  // Large blocks are not cached.
+  void* q = PatriciaTreeNodePool::allocate(1000);
+  PatriciaTreeNodePool::deallocate(q, 1000);
+  EXPECT_EQ(1, PatriciaTreeNodePool::cached_blocks());
+
+  PatriciaTreeNodePool::trim();
+  EXPECT_EQ(0, PatriciaTreeNodePool::cached_blocks());
+}
+
+TEST(PatriciaTreeNodePoolTest, treesReleaseNodesToThePool) {
+  PatriciaTreeNodePool::trim();
+  {
+    PatriciaTreeSet<uint32_t> s{1, 2, 3, 4};
+    PatriciaTreeMap<uint32_t, uint32_t> m;
+    m.insert_or_assign(1, 10);
+    m.insert_or_assign(2, 20);
+  }
+  // At least 4 leaves and 3 branches for the set, 2 leaves and 1 branch for
+  // the map, plus the intermediate nodes created by the insertions.
+  EXPECT_LE(10, PatriciaTreeNodePool::cached_blocks());
+  PatriciaTreeNodePool::trim();
+}
+
+TEST(PatriciaTreeNodePoolTest, nodesMigrateAcrossThreads) {
+  std::vector<PatriciaTreeSet<uint32_t>> sets(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&sets, t]() {
+      for (uint32_t i = 0; i < 100; ++i) {
+        sets[t].insert(t * 1000 + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  PatriciaTreeSet<uint32_t> all;
+  for (const auto& s : sets) {
+    all.union_with(s);
+  }
+  EXPECT_EQ(100 * kNumThreads, all.size());
+  // Nodes created by the exited threads are released on this one.
+  sets.clear();
+  all.clear();
+  PatriciaTreeNodePool::trim();
+}
+
+// Allocating and freeing in rounds, the way a fixpoint iteration creates and
+// drops environments, only goes to the global allocator in the first round.
+TEST(PatriciaTreeNodePoolTest, churnIsServedFromTheCache) {
+  std::vector<size_t> misses(kNumThreads);
+  std::vector<size_t> cached(kNumThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&misses, &cached, t]() {
+      std::vector<void*> blocks(kBlocksPerRound);
+      std::unordered_set<void*> freed;
+      for (size_t round = 0; round < kNumRounds; ++round) {
+        for (size_t i = 0; i < kBlocksPerRound; ++i) {
+          blocks[i] = PatriciaTreeNodePool::allocate(churn_block_size(i));
+          if (round > 0 && !freed.count(blocks[i])) {
+            ++misses[t];
+          }
+        }
+        freed = std::unordered_set<void*>(blocks.begin(), blocks.end());
+        for (size_t i = 0; i < kBlocksPerRound; ++i) {
+          PatriciaTreeNodePool::deallocate(blocks[i], churn_block_size(i));
+        }
+      }
+      cached[t] = PatriciaTreeNodePool::cached_blocks();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    EXPECT_EQ(0, misses[t]);
+    EXPECT_EQ(kBlocksPerRound, cached[t]);
+  }
+}
@@ -13,6 +13,7 @@
 #include <sstream>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include <boost/functional/hash.hpp>
 
@@ -200,6 +201,60 @@ TEST(S_ExpressionTest, basicOperations) {
   EXPECT_EQ("On line 2: Unexpected character encountered: ','", error);
 }
 
+// Parses all the S-expressions of the string with both parsers, and checks
+// that they agree. Returns the S-expressions, or the error message.
+std::vector<s_expr> parse_all(const std::string& str, std::string& what) {
+  std::istringstream str_input(str);
+  s_expr_istream input(str_input);
+  s_expr_buffer_istream buffer_input(str.data(), str.size());
+  std::vector<s_expr> exprs;
+  for (;;) {
+    s_expr e1, e2;
+    input >> e1;
+    buffer_input >> e2;
+    EXPECT_EQ(input.eoi(), buffer_input.eoi());
+    EXPECT_EQ(input.fail(), buffer_input.fail());
+    EXPECT_EQ(input.what(), buffer_input.what());
+    if (!input.good()) {
+      what = input.eoi() ? "" : input.what();
+      return exprs;
+    }
+    EXPECT_EQ(e1, e2);
+    exprs.push_back(e2);
+  }
+}
+
+TEST(S_ExpressionTest, bufferParsing) {
+  std::string what;
+  auto e = s_expr(
+      {s_expr("const-string"), s_expr("a \"quoted\"\n\\string"),
+       s_expr({s_expr(-2147483647 - 1), s_expr(2147483647), s_expr()}),
+       s_expr("")});
+  auto exprs = parse_all(e.str() + " " + e.str(), what);
+  EXPECT_EQ("", what);
+  EXPECT_THAT(exprs, ::testing::ElementsAre(e, e));
+
+  exprs = parse_all("(123#123()abc\"def\"\"gh()i\") ; comment\n sym", what);
+  EXPECT_EQ("", what);
+  ASSERT_EQ(2, exprs.size());
+  EXPECT_EQ("(123 #123 () abc def \"gh()i\")", exprs[0].str());
+  EXPECT_EQ("sym", exprs[1].str());
+
+  for (const char* input : {"((a) b ()",
+                            "(\n(a)\nb\n()\n",
+                            "((a) b c))",
+                            "(a b #9999999999999)",
+                            "(a b #-2147483649)",
+                            "(a b #-)",
+                            "(a b \"abcdef)",
+                            "(a b \"abcdef\\",
+                            "123, (a b c)",
+                            ";comment\n\n(123, (a b c)"}) {
+    parse_all(input, what);
+    EXPECT_NE("", what) << input;
+  }
+}
+
 TEST(S_ExpressionTest, patternMatching) {
   auto e1 = parse("((a #1) (b #2))");
 
@@ -99,3 +99,100 @@ TEST(SpartaWorkQueueTest, preciseScheduling) {
     ASSERT_EQ(1, array[idx]);
   }
 }
+
+TEST(SpartaWorkQueueTest, scheduleByCost) {
+  std::vector<size_t> costs = {1, 10, 3, 10, 0, 7};
+  auto schedule = sparta::workqueue_impl::schedule_by_cost(costs, 2);
+  ASSERT_EQ(costs.size(), schedule.size());
+
+  // Most expensive items first; ties keep their original order.
+  std::vector<size_t> order;
+  std::vector<size_t> loads(2, 0);
+  for (const auto& p : schedule) {
+    order.push_back(p.first);
+    loads[p.second] += costs[p.first];
+  }
+  EXPECT_EQ(std::vector<size_t>({1, 3, 5, 2, 0, 4}), order);
+  EXPECT_EQ(0, schedule[0].second);
+  EXPECT_EQ(1, schedule[1].second);
+  EXPECT_EQ(17, loads[0]);
+  EXPECT_EQ(14, loads[1]);
+}
+
+TEST(SpartaWorkQueueTest, addItemsByCost) {
+  std::array<int, NUM_INTS> array = {0};
+  std::vector<int*> items;
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    items.push_back(&array[idx]);
+  }
+
+  auto wq = sparta::work_queue<int*>([](int* a) { (*a)++; });
+  wq.add_items_by_cost(items, [&array](int* a) { return a - &array[0]; });
+  wq.run_all();
+  for (int idx = 0; idx < NUM_INTS; ++idx) {
+    ASSERT_EQ(1, array[idx]);
+  }
+}
+
+TEST(SpartaWorkQueueTest, reusesThreads) {
+  std::atomic<int> sum{0};
+  auto run_queue = [&sum]() {
+    auto wq = sparta::work_queue<int>([&sum](int a) { sum += a; }, 4);
+    for (int i = 1; i <= 10; ++i) {
+      wq.add_item(i);
+    }
+    wq.run_all();
+  };
+  auto& pool = sparta::workqueue_impl::ThreadPool::get();
+  auto initial_size = pool.size();
+  for (int i = 0; i < 100; ++i) {
+    run_queue();
+  }
+  EXPECT_EQ(100 * 55, sum);
+  // The queues never need more than 4 threads at a time.
+  EXPECT_LE(pool.size(), initial_size + 4);
+}
+
+TEST(SpartaWorkQueueTest, nestedQueues) {
+  std::atomic<int> sum{0};
+  auto outer = sparta::work_queue<int>(
+      [&sum](int a) {
+        auto inner = sparta::work_queue<int>([&sum](int b) { sum += b; }, 2);
+        for (int i = 0; i < a; ++i) {
+          inner.add_item(1);
+        }
+        inner.run_all();
+      },
+      2);
+  for (int i = 1; i <= 10; ++i) {
+    outer.add_item(i);
+  }
+  outer.run_all();
+  EXPECT_EQ(55, sum);
+}
+
+TEST(SpartaWorkQueueTest, reportsProgress) {
+  auto& registry = sparta::workqueue_impl::ProgressRegistry::get();
+  std::vector<size_t> done;
+  std::vector<size_t> total;
+  auto wq = sparta::work_queue<int>(
+      [&](sparta::SpartaWorkerState<int>* state, int a) {
+        if (a > 0) {
+          state->push_task(a - 1);
+        }
+        auto snapshot = registry.snapshot();
+        ASSERT_EQ(1, snapshot.size());
+        done.push_back(snapshot[0].done);
+        total.push_back(snapshot[0].total);
+      },
+      1,
+      /* push_tasks_while_running */ true);
+  wq.add_item(2);
+  wq.add_item(0);
+  wq.run_all();
+  // The task that is running is not done yet, and each pushed task adds to
+  // the total as soon as it is pushed.
+  EXPECT_EQ(std::vector<size_t>({0, 1, 2, 3}), done);
+  EXPECT_EQ(std::vector<size_t>({3, 3, 4, 4}), total);
+  EXPECT_TRUE(registry.snapshot().empty());
+}
@@ -167,6 +167,42 @@ TEST(WeakPartialOrderingTest, exampleFromWtoPaper) {
   EXPECT_EQ(wto.str(), "1 2 (3 4 (5 6) 7) 8");
 }
 
+/*
+ * The nesting depth of every node of "1 2 (3 4 (5 6) 7) 8", where heads and
+ * exits count as members of their own component.
+ */
+TEST(WeakPartialOrderingTest, nestingDepth) {
+  SimpleGraph2 g;
+  g.add_edge("1", "2");
+  g.add_edge("2", "3");
+  g.add_edge("3", "4");
+  g.add_edge("4", "5");
+  g.add_edge("5", "6");
+  g.add_edge("6", "7");
+  g.add_edge("7", "8");
+  g.add_edge("2", "8");
+  g.add_edge("4", "7");
+  g.add_edge("6", "5");
+  g.add_edge("7", "3");
+
+  WeakPartialOrdering<std::string> wpo(
+      "1", [&g](const std::string& n) { return g.successors(n); }, false);
+
+  std::unordered_map<std::string, uint32_t> expected_depth = {
+      {"1", 0}, {"2", 0}, {"3", 1}, {"4", 1},
+      {"5", 2}, {"6", 2}, {"7", 1}, {"8", 0},
+  };
+  for (WpoIdx v = 0; v < wpo.size(); ++v) {
+    EXPECT_EQ(expected_depth.at(wpo.get_node(v)), wpo.get_depth(v))
+        << wpo.get_node(v);
+  }
+
+  WeakPartialOrdering<std::string> single(
+      "1", [](const std::string&) { return std::vector<std::string>(); },
+      false);
+  EXPECT_EQ(0, single.get_depth(single.get_entry()));
+}
+
 /*
  * Check that we correctly handle the edge cases where we have a single-node
  * SCC as the last element of the top-level list of components, or as the last
@@ -20,6 +20,8 @@ public class InstrumentAnalysis {
   @DoNotStrip private static short[][] sMethodStatsArray = new short[][] {};
   @DoNotStrip private static int sNumStaticallyInstrumented = 0;
   @DoNotStrip private static int sProfileType = 0;
+  // Only used when sampling is on.
+  @DoNotStrip private static int[] sSampleCountdowns = new int[0];
 
   @DoNotStrip
   public static void onMethodBegin(int index) {
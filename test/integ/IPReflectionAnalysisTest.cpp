@@ -146,4 +146,12 @@ TEST_F(IPReflectionAnalysisTest, test_results) {
         << "Expected " << entry.second << " entries for method "
         << show(entry.first) << " but " << actual << " were found.";
   }
+
+  // Methods that can't deal with reflection objects are not analyzed.
+  DexMethod* no_reflection =
+      DexMethod::get_method(
+          "Lcom/facebook/redextest/IPReflectionAnalysisTest;.noReflection:(I)I")
+          ->as_def();
+  ASSERT_NE(nullptr, no_reflection);
+  EXPECT_EQ(0, results->count(no_reflection));
 }
@@ -62,6 +62,10 @@ public class IPReflectionAnalysisTest {
   static Class reflClassWithCallGetClassName() throws Exception {
     return Class.forName(getClassName());
   }
+
+  static int noReflection(int x) {
+    return x * 2 + 1;
+  }
 }
 
 class Base {
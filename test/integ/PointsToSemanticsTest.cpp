@@ -18,6 +18,7 @@
 #include "IRAssembler.h"
 #include "JarLoader.h"
 #include "RedexTest.h"
+#include "RedexTestUtils.h"
 
 using namespace sparta;
 
@@ -361,4 +362,20 @@ TEST_F(PointsToSemanticsTest, semanticActionGeneration) {
     deserialization.insert(out.str());
   }
   EXPECT_THAT(deserialization, ::testing::ContainerEq(method_semantics));
+
+  // Testing the binary serialization. The stubs are loaded in a fresh
+  // instance, so that none of them collides with a method in scope.
+  auto tmpdir = redex::make_tmp_dir("points_to_semantics_test_%%%%%%%%");
+  std::string stub_file = tmpdir.path + "/stubs.bin";
+  pt_semantics.save_stubs(stub_file);
+  PointsToSemantics loaded_semantics(Scope{});
+  loaded_semantics.load_stubs(stub_file);
+  std::set<std::string> binary_deserialization;
+  for (const auto& pt_entry : loaded_semantics) {
+    std::ostringstream out;
+    out << pt_entry.second;
+    binary_deserialization.insert(out.str());
+  }
+  EXPECT_THAT(binary_deserialization,
+              ::testing::ContainerEq(method_semantics));
 }
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ConcurrentContainers.h"
+#include "ConstantPropagationAnalysis.h"
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "InstructionLowering.h"
+#include "Liveness.h"
+#include "PatriciaTreeSet.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+namespace cp = constant_propagation;
+
+//==========
+// Benchmarks of the core IR operations. Each one prints the average time of
+// an iteration, so that the numbers can be compared across revisions.
+//==========
+
+namespace {
+
+template <typename Fn>
+void measure(const char* name, size_t iterations, const Fn& fn) {
+  fn(); // Warm up.
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double us =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start)
+          .count();
+  printf("%s: %.2f us/iter\n", name, us / iterations);
+}
+
+// A method with `num_blocks` diamonds of constants and arithmetic, which is
+// the shape that makes the fixpoint iterators and the CFG do real work.
+std::string large_method_body(size_t num_blocks) {
+  std::string body = "((load-param v0) (const v2 0)";
+  for (size_t i = 0; i < num_blocks; ++i) {
+    auto label = ":L" + std::to_string(i);
+    body += " (const v1 " + std::to_string(i) + ")";
+    body += " (add-int v2 v2 v1)";
+    body += " (if-eqz v0 " + label + ")";
+    body += " (add-int/lit8 v2 v2 1)";
+    body += " (" + label + ")";
+  }
+  body += " (return v2))";
+  return body;
+}
+
+constexpr size_t kNumBlocks = 2000;
+
+} // namespace
+
+class IRPerfTest : public RedexTest {};
+
+TEST_F(IRPerfTest, CFGBuildAndLinearize) {
+  auto code = assembler::ircode_from_string(large_method_body(kNumBlocks));
+  measure("editable cfg build + linearize", 20, [&]() {
+    code->build_cfg(/* editable */ true);
+    code->clear_cfg();
+  });
+  measure("non-editable cfg build", 20, [&]() {
+    code->build_cfg(/* editable */ false);
+    code->clear_cfg();
+  });
+}
+
+TEST_F(IRPerfTest, IRCodeClone) {
+  auto code = assembler::ircode_from_string(large_method_body(kNumBlocks));
+  measure("IRCode copy", 20, [&]() { IRCode copy(*code); });
+}
+
+TEST_F(IRPerfTest, DexStringInterning) {
+  constexpr size_t kNumStrings = 100000;
+  std::vector<std::string> strs;
+  strs.reserve(kNumStrings);
+  for (size_t i = 0; i < kNumStrings; ++i) {
+    strs.push_back("Lcom/facebook/perf/Class" + std::to_string(i) + ";");
+  }
+  measure("DexString::make_string x100k", 5, [&]() {
+    for (const auto& s : strs) {
+      DexString::make_string(s);
+    }
+  });
+  const std::vector<size_t> threads{0, 1, 2, 3, 4, 5, 6, 7};
+  measure("DexString::make_string x100k, parallel", 5, [&]() {
+    workqueue_run<size_t>(
+        [&](size_t t) {
+          for (size_t i = t; i < strs.size(); i += threads.size()) {
+            DexString::make_string(strs[i]);
+          }
+        },
+        threads);
+  });
+}
+
+TEST_F(IRPerfTest, ConcurrentMapContention) {
+  constexpr uint32_t kNumKeys = 100000;
+  const size_t num_threads = redex_parallel::default_num_threads();
+  std::vector<size_t> threads(num_threads);
+  for (size_t t = 0; t < num_threads; ++t) {
+    threads[t] = t;
+  }
+  measure("ConcurrentMap insert + update, all threads", 5, [&]() {
+    ConcurrentMap<uint32_t, size_t> map;
+    workqueue_run<size_t>(
+        [&](size_t t) {
+          for (uint32_t i = 0; i < kNumKeys; ++i) {
+            // Half of the keys are shared by all threads.
+            uint32_t key = i % 2 == 0 ? i : i * num_threads + t;
+            map.update(key, [](uint32_t, size_t& v, bool) { ++v; });
+          }
+        },
+        threads);
+  });
+  ConcurrentMap<uint32_t, size_t> map;
+  for (uint32_t i = 0; i < kNumKeys; ++i) {
+    map.emplace(i, i);
+  }
+  measure("ConcurrentMap lookup, all threads", 5, [&]() {
+    std::atomic<size_t> found{0};
+    workqueue_run<size_t>(
+        [&](size_t) {
+          size_t local = 0;
+          for (uint32_t i = 0; i < kNumKeys; ++i) {
+            local += map.count(i);
+          }
+          found += local;
+        },
+        threads);
+    EXPECT_EQ(found, kNumKeys * num_threads);
+  });
+}
+
+TEST_F(IRPerfTest, PatriciaTreeJoinMeet) {
+  using Set = sparta::PatriciaTreeSet<uint32_t>;
+  constexpr uint32_t kNumElements = 100000;
+  Set evens, threes;
+  for (uint32_t i = 0; i < kNumElements; ++i) {
+    if (i % 2 == 0) {
+      evens.insert(i);
+    }
+    if (i % 3 == 0) {
+      threes.insert(i);
+    }
+  }
+  measure("PatriciaTreeSet union", 20, [&]() {
+    auto s = evens;
+    s.union_with(threes);
+  });
+  measure("PatriciaTreeSet intersection", 20, [&]() {
+    auto s = evens;
+    s.intersection_with(threes);
+  });
+}
+
+TEST_F(IRPerfTest, DexCodeEncoding) {
+  auto method = assembler::method_from_string(
+      "(method (public static) \"LPerf;.big:(I)I\" " +
+      large_method_body(kNumBlocks) + ")");
+  auto code = std::make_unique<IRCode>(*method->get_code());
+  measure("instruction lowering + sync", 10, [&]() {
+    method->set_code(std::make_unique<IRCode>(*code));
+    instruction_lowering::lower(method);
+    method->sync();
+  });
+}
+
+TEST_F(IRPerfTest, LivenessAndConstantPropagation) {
+  auto code = assembler::ircode_from_string(large_method_body(kNumBlocks));
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  measure("liveness", 10, [&]() {
+    LivenessFixpointIterator fixpoint_iter(cfg);
+    fixpoint_iter.run(LivenessDomain());
+  });
+  measure("intraprocedural constant propagation", 10, [&]() {
+    cp::intraprocedural::FixpointIterator intra_cp(
+        cfg, cp::ConstantPrimitiveAnalyzer());
+    intra_cp.run(ConstantEnvironment());
+  });
+}
@@ -11,6 +11,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -156,8 +157,11 @@ class ParallelFixpointEngine final
           BackwardsFixpointIterationAdaptor<ProgramInterface>,
           LivenessDomain> {
  public:
-  explicit ParallelFixpointEngine(const Program& program, uint32_t num_core)
-      : ParallelMonotonicFixpointIterator(program, num_core),
+  ParallelFixpointEngine(const Program& program,
+                         uint32_t num_core,
+                         bool prioritize_by_depth)
+      : ParallelMonotonicFixpointIterator(
+            program, num_core, prioritize_by_depth),
         m_program(program) {}
 
   void analyze_node(const uint32_t& node,
@@ -182,11 +186,15 @@ class ParallelFixpointEngine final
 
 class MonotonicFixpointIteratorTest {
  public:
-  MonotonicFixpointIteratorTest() : m_program1(1) {}
+  MonotonicFixpointIteratorTest() : m_program1(1), m_program2(1) {}
 
-  void SetUp() { build_program1(); }
+  void SetUp() {
+    build_program1();
+    build_program2();
+  }
 
   Program m_program1;
+  Program m_program2;
 
  private:
   /*
@@ -210,12 +218,60 @@ class MonotonicFixpointIteratorTest {
     }
     m_program1.set_exit(2001);
   }
+
+  static constexpr uint32_t kNumInnerLoops = 40;
+  static constexpr uint32_t kInnerLoopLength = 10;
+
+  /*
+   * One big loop containing many independent inner loops, which is what call
+   * graphs with large SCCs look like to the fixpoint iterator:
+   *
+   *  1: a = 0;
+   *  2: <outer loop head> Switch to the inner loops
+   *     loop k: head_k -> body_k_1 -> ... -> body_k_n -> head_k
+   *                                                  |
+   *                                                  +-> join
+   *  join: Goto 2 or exit
+   *  exit: return;
+   *
+   * Each inner loop body uses the variable defined by the previous statement,
+   * so liveness has to go around every loop more than once.
+   */
+  void build_program2() {
+    uint32_t join = 3;
+    uint32_t exit = 4;
+    m_program2.add(1, Statement(/* use: */ {}, /* def: */ {0}));
+    m_program2.add(2, Statement(/* use: */ {0}, /* def: */ {}));
+    m_program2.add(join, Statement(/* use: */ {}, /* def: */ {}));
+    m_program2.add(exit, Statement(/* use: */ {0}, /* def: */ {}));
+    m_program2.add_edge(1, 2);
+    m_program2.add_edge(join, 2);
+    m_program2.add_edge(join, exit);
+    uint32_t next_node = exit + 1;
+    for (uint32_t k = 0; k < kNumInnerLoops; ++k) {
+      uint32_t head = next_node++;
+      m_program2.add(head, Statement(/* use: */ {head + kInnerLoopLength},
+                                     /* def: */ {head}));
+      m_program2.add_edge(2, head);
+      uint32_t prev = head;
+      for (uint32_t i = 0; i < kInnerLoopLength; ++i) {
+        uint32_t node = next_node++;
+        m_program2.add(node, Statement(/* use: */ {prev}, /* def: */ {node}));
+        m_program2.add_edge(prev, node);
+        prev = node;
+      }
+      m_program2.add_edge(prev, head);
+      m_program2.add_edge(prev, join);
+    }
+    m_program2.set_exit(exit);
+  }
 };
 
-double calculate_speedup(const MonotonicFixpointIteratorTest& test,
-                         uint32_t num_core) {
+double calculate_speedup(const Program& program,
+                         uint32_t num_core,
+                         bool prioritize_by_depth) {
   using namespace std::placeholders;
-  ParallelFixpointEngine para_fp(test.m_program1, num_core);
+  ParallelFixpointEngine para_fp(program, num_core, prioritize_by_depth);
   auto para_start = std::chrono::high_resolution_clock::now();
   para_fp.run(LivenessDomain());
   auto para_end = std::chrono::high_resolution_clock::now();
@@ -226,18 +282,30 @@ double calculate_speedup(const MonotonicFixpointIteratorTest& test,
   return duration2;
 }
 
-int main() {
-  printf("Begin!\n");
-  MonotonicFixpointIteratorTest test;
-  test.SetUp();
-  FixpointEngine fp(test.m_program1);
+/*
+ * Prints the speedup over the sequential iterator for each number of threads,
+ * with FIFO scheduling and with scheduling by nesting depth.
+ */
+void report_speedups(const char* name, const Program& program) {
+  FixpointEngine fp(program);
   auto single_start = std::chrono::high_resolution_clock::now();
   fp.run(LivenessDomain());
   auto single_end = std::chrono::high_resolution_clock::now();
   double duration1 = std::chrono::duration_cast<std::chrono::microseconds>(
                          single_end - single_start)
                          .count();
+  printf("%s\nthreads fifo by-depth\n", name);
   for (uint32_t i = 1; i <= redex_parallel::default_num_threads(); ++i) {
-    printf("%u %lf\n", i, duration1 / calculate_speedup(test, i));
+    double fifo = duration1 / calculate_speedup(program, i, false);
+    double by_depth = duration1 / calculate_speedup(program, i, true);
+    printf("%u %lf %lf\n", i, fifo, by_depth);
   }
 }
+
+int main() {
+  printf("Begin!\n");
+  MonotonicFixpointIteratorTest test;
+  test.SetUp();
+  report_speedups("switch", test.m_program1);
+  report_speedups("nested loops", test.m_program2);
+}
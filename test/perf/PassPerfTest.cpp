@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "CommonSubexpressionElimination.h"
+#include "ConfigFiles.h"
+#include "ControlFlow.h"
+#include "DexClass.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "InstructionSequenceOutliner.h"
+#include "MethodUtil.h"
+#include "PassManager.h"
+#include "Purity.h"
+#include "RedexTest.h"
+#include "RegisterAllocation.h"
+#include "Shrinker.h"
+
+//==========
+// Benchmarks of individual services on large generated methods, to catch
+// algorithmic blowups. Each one prints, per shape of method, the average time
+// and number of allocations of an iteration, so that the numbers can be
+// compared across revisions.
+//==========
+
+namespace {
+
+std::atomic<size_t> s_allocations{0};
+
+} // namespace
+
+// Counts the allocations of the whole binary, which only runs benchmarks.
+void* operator new(size_t size) {
+  ++s_allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// Runs `setup` and then `fn` for each iteration, and only measures `fn`.
+template <typename Setup, typename Fn>
+void measure(const std::string& name,
+             size_t iterations,
+             const Setup& setup,
+             const Fn& fn) {
+  std::chrono::steady_clock::duration elapsed{0};
+  size_t allocations = 0;
+  for (size_t i = 0; i < iterations; ++i) {
+    setup();
+    size_t allocations_before = s_allocations;
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    elapsed += std::chrono::steady_clock::now() - start;
+    allocations += s_allocations - allocations_before;
+  }
+  double us =
+      std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  printf("%s: %.2f us/iter, %zu allocations/iter\n", name.c_str(),
+         us / iterations, allocations / iterations);
+}
+
+// `num_blocks` diamonds of constants and arithmetic.
+std::string diamonds(size_t num_blocks) {
+  std::string body = "((load-param v0) (const v2 0)";
+  for (size_t i = 0; i < num_blocks; ++i) {
+    auto label = ":L" + std::to_string(i);
+    body += " (const v1 " + std::to_string(i) + ")";
+    body += " (add-int v2 v2 v1)";
+    body += " (if-eqz v0 " + label + ")";
+    body += " (add-int/lit8 v2 v2 1)";
+    body += " (" + label + ")";
+  }
+  body += " (return v2))";
+  return body;
+}
+
+// `depth` nested loops, which each define another register.
+std::string nested_loops(size_t depth) {
+  std::string body = "((load-param v0) (const v1 0)";
+  for (size_t i = 0; i < depth; ++i) {
+    auto reg = "v" + std::to_string(2 + i % 32);
+    body += " (:H" + std::to_string(i) + ")";
+    body += " (add-int/lit8 v1 v1 1)";
+    body += " (if-gez v1 :E" + std::to_string(i) + ")";
+    body += " (mul-int " + reg + " v1 v0)";
+  }
+  for (size_t i = depth; i-- > 0;) {
+    auto reg = "v" + std::to_string(2 + i % 32);
+    body += " (add-int v1 v1 " + reg + ")";
+    body += " (goto :H" + std::to_string(i) + ")";
+    body += " (:E" + std::to_string(i) + ")";
+  }
+  body += " (return v1))";
+  return body;
+}
+
+// A switch with `num_cases` cases, which all compute the result differently.
+std::string huge_switch(size_t num_cases) {
+  std::string labels;
+  std::string cases;
+  for (size_t i = 0; i < num_cases; ++i) {
+    auto label = ":C" + std::to_string(i);
+    labels += " " + label;
+    cases += " (" + label + " " + std::to_string(i) + ")";
+    cases += " (const v1 " + std::to_string(i) + ")";
+    cases += " (mul-int v2 v1 v0)";
+    cases += " (goto :end)";
+  }
+  return "((load-param v0) (switch v0 (" + labels + "))" + cases +
+         " (:end) (return v2))";
+}
+
+struct Shape {
+  std::string name;
+  std::string body;
+};
+
+std::vector<Shape> shapes() {
+  return {{"2000 diamonds", diamonds(2000)},
+          {"200 nested loops", nested_loops(200)},
+          {"2000 switch cases", huge_switch(2000)}};
+}
+
+class PassPerfTest : public RedexTest {
+ public:
+  // Makes a static method, in a class of its own, for each shape.
+  void SetUp() override {
+    for (const auto& shape : shapes()) {
+      auto cls_name = "LPerf" + std::to_string(m_methods.size()) + ";";
+      auto method = assembler::method_from_string(
+          "(method (public static) \"" + cls_name + ".run:(I)I\" " +
+          shape.body + ")");
+      m_names.push_back(shape.name);
+      m_bodies.push_back(std::make_unique<IRCode>(*method->get_code()));
+      m_methods.push_back(method);
+      m_scope.push_back(assembler::class_with_methods(cls_name, {method}));
+    }
+  }
+
+  // Measures `fn` on each of the methods, which are reset before each
+  // iteration.
+  template <typename Fn>
+  void measure_shapes(const std::string& name,
+                      size_t iterations,
+                      const Fn& fn) {
+    for (size_t i = 0; i < m_methods.size(); ++i) {
+      auto method = m_methods[i];
+      measure(
+          name + ", " + m_names[i],
+          iterations,
+          [&]() { method->set_code(std::make_unique<IRCode>(*m_bodies[i])); },
+          [&]() { fn(method); });
+    }
+  }
+
+  static DexStoresVector make_stores(const Scope& scope) {
+    DexMetadata dm;
+    dm.set_id("classes");
+    DexStore store(dm);
+    // primary dex
+    store.add_classes({});
+    // secondary dex
+    store.add_classes(scope);
+    DexStoresVector stores;
+    stores.emplace_back(std::move(store));
+    return stores;
+  }
+
+  std::vector<std::string> m_names;
+  std::vector<std::unique_ptr<IRCode>> m_bodies;
+  std::vector<DexMethod*> m_methods;
+  Scope m_scope;
+};
+
+} // namespace
+
+TEST_F(PassPerfTest, RegisterAllocation) {
+  measure_shapes("graph coloring register allocation", 5,
+                 [](DexMethod* method) {
+                   regalloc::graph_coloring::allocate(
+                       regalloc::graph_coloring::Allocator::Config(), method);
+                 });
+}
+
+TEST_F(PassPerfTest, CommonSubexpressionElimination) {
+  auto pure_methods = get_pure_methods();
+  std::unordered_set<DexString*> finalish_field_names;
+  cse_impl::SharedState shared_state(pure_methods, finalish_field_names);
+  shared_state.init_scope(m_scope);
+  measure_shapes("common subexpression elimination", 5, [&](DexMethod* method) {
+    auto code = method->get_code();
+    code->build_cfg(/* editable */ true);
+    cse_impl::CommonSubexpressionElimination cse(
+        &shared_state, code->cfg(), is_static(method),
+        method::is_init(method) || method::is_clinit(method),
+        method->get_class(), method->get_proto()->get_args());
+    cse.patch();
+    code->clear_cfg();
+  });
+}
+
+TEST_F(PassPerfTest, Shrinker) {
+  auto stores = make_stores(m_scope);
+  shrinker::ShrinkerConfig config;
+  config.run_const_prop = true;
+  config.run_cse = true;
+  config.run_copy_prop = true;
+  config.run_local_dce = true;
+  config.run_dedup_blocks = true;
+  shrinker::Shrinker shrinker(stores, m_scope, config);
+  measure_shapes("shrinker", 5, [&](DexMethod* method) {
+    shrinker.shrink_method(method);
+  });
+}
+
+TEST_F(PassPerfTest, InstructionSequenceOutliner) {
+  measure_shapes("instruction sequence outliner", 1, [&](DexMethod* method) {
+    auto stores = make_stores({type_class(method->get_class())});
+    PassManager manager({new InstructionSequenceOutliner()});
+    manager.set_testing_mode();
+    Json::Value conf_obj = Json::nullValue;
+    ConfigFiles dummy_config(conf_obj);
+    manager.run_passes(stores, dummy_config);
+  });
+}
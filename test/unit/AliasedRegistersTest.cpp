@@ -366,3 +366,26 @@ TEST(AliasedRegistersTest, CopyOnWriteDomain) {
     EXPECT_FALSE(a.are_aliases(zero, one));
   });
 }
+
+TEST(AliasedRegistersTest, SparseRegistersAndConstants) {
+  Value high = Value::create_register(1000);
+  Value int_two_lit = Value::create_literal(2, constant_uses::TypeDemand::Int);
+  AliasedRegisters a;
+
+  a.move(high, int_one_lit);
+  a.move(zero, high);
+  a.move(two, int_two_lit);
+  EXPECT_TRUE(a.are_aliases(zero, int_one_lit));
+  EXPECT_TRUE(a.are_aliases(high, zero));
+  EXPECT_FALSE(a.are_aliases(high, two));
+  EXPECT_EQ(a.get_representative(zero), 1000u);
+
+  a.break_alias(high);
+  EXPECT_TRUE(a.are_aliases(zero, int_one_lit));
+  EXPECT_FALSE(a.are_aliases(high, int_one_lit));
+  EXPECT_EQ(a.get_representative(zero), 0u);
+
+  a.clear();
+  EXPECT_FALSE(a.are_aliases(zero, int_one_lit));
+  EXPECT_FALSE(a.are_aliases(two, int_two_lit));
+}
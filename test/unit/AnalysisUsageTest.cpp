@@ -220,3 +220,23 @@ TEST_F(AnalysisUsageTest, testDependencyChecking) {
     EXPECT_TRUE(exception_caught);
   }
 }
+
+TEST_F(AnalysisUsageTest, testRequiredAfter) {
+  auto id = get_analysis_id_by_pass<MyAnalysisPass>();
+  std::vector<Pass*> sequence{
+      new MyAnalysisPass(),
+      new ConsumeAnalysisAndPreservePass(),
+      new ConsumeAnalysisAndInvalidatePass(),
+      new ConsumeAnalysis2Pass(),
+      new MyAnalysisPass(),
+      new ConsumeAnalysisAndPreserveOnePass(),
+  };
+  EXPECT_TRUE(AnalysisUsage::is_required_after(sequence, 0, id));
+  EXPECT_TRUE(AnalysisUsage::is_required_after(sequence, 1, id));
+  // Invalidated by the pass requiring MyAnalysisPass2.
+  EXPECT_FALSE(AnalysisUsage::is_required_after(sequence, 2, id));
+  // Run again before being required.
+  EXPECT_FALSE(AnalysisUsage::is_required_after(sequence, 3, id));
+  EXPECT_TRUE(AnalysisUsage::is_required_after(sequence, 4, id));
+  EXPECT_FALSE(AnalysisUsage::is_required_after(sequence, 5, id));
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Arena.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(ArenaTest, alignment) {
+  Arena arena;
+  for (size_t alignment : {1, 2, 4, 8, 16, 64}) {
+    for (size_t size : {1, 3, 17}) {
+      auto p = arena.allocate(size, alignment);
+      EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+    }
+  }
+}
+
+TEST(ArenaTest, large_allocations) {
+  Arena arena;
+  auto small = static_cast<char*>(arena.allocate(10));
+  auto large = static_cast<char*>(arena.allocate(10 * 1024 * 1024));
+  memset(large, 1, 10 * 1024 * 1024);
+  memset(small, 2, 10);
+  EXPECT_EQ(large[0], 1);
+  EXPECT_EQ(large[10 * 1024 * 1024 - 1], 1);
+  EXPECT_GE(arena.reserved_bytes(), 10 * 1024 * 1024);
+}
+
+TEST(ArenaTest, concurrent_allocations) {
+  Arena arena;
+  constexpr size_t kThreads = 4;
+  constexpr size_t kObjects = 10000;
+  std::vector<std::vector<std::string*>> objects(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (size_t i = 0; i < kObjects; ++i) {
+        objects[t].push_back(
+            arena.make<std::string>(std::to_string(t * kObjects + i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 0; t < kThreads; ++t) {
+    for (size_t i = 0; i < kObjects; ++i) {
+      EXPECT_EQ(*objects[t][i], std::to_string(t * kObjects + i));
+      objects[t][i]->~basic_string();
+    }
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "BaseIRAnalyzer.h"
+#include "BigBlocks.h"
+#include "IRAssembler.h"
+#include "ReachingDefinitions.h"
+#include "RedexTest.h"
+
+namespace {
+
+class BigBlockReachingDefs final
+    : public ir_analyzer::StaticBigBlockIRAnalyzer<BigBlockReachingDefs,
+                                                   reaching_defs::Environment> {
+ public:
+  explicit BigBlockReachingDefs(const cfg::ControlFlowGraph& cfg)
+      : ir_analyzer::StaticBigBlockIRAnalyzer<BigBlockReachingDefs,
+                                              reaching_defs::Environment>(
+            cfg) {}
+
+  void analyze_instruction(const IRInstruction* insn,
+                           reaching_defs::Environment* current_state) const {
+    if (insn->has_dest()) {
+      current_state->set(
+          insn->dest(),
+          reaching_defs::Domain(const_cast<IRInstruction*>(insn)));
+    }
+  }
+};
+
+class BigBlockIRAnalyzerTest : public RedexTest {};
+
+TEST_F(BigBlockIRAnalyzerTest, SameStatesAsBlockAnalysis) {
+  auto code = assembler::ircode_from_string(R"((
+    (const v0 0)
+    (.try_start a)
+    (invoke-static () "LFoo;.bar:()V")
+    (const v0 1)
+    (invoke-static () "LFoo;.bar:()V")
+    (const v0 2)
+    (invoke-static () "LFoo;.bar:()V")
+    (.try_end a)
+    (return v0)
+
+    (.catch (a))
+    (return v0)
+  ))");
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+
+  reaching_defs::FixpointIterator block_iter(cfg);
+  block_iter.run({});
+  BigBlockReachingDefs big_block_iter(cfg);
+  big_block_iter.run({});
+
+  big_blocks::BigBlockGraph graph(cfg);
+  EXPECT_LT(graph.size(), cfg.num_blocks());
+
+  for (auto block : cfg.blocks()) {
+    EXPECT_TRUE(block_iter.get_entry_state_at(block).equals(
+        big_block_iter.get_entry_state_at(block)));
+    EXPECT_TRUE(block_iter.get_exit_state_at(block).equals(
+        big_block_iter.get_exit_state_at(block)));
+  }
+
+  // The handler is reached from within the big block of the try region, with
+  // each of the definitions of v0.
+  cfg::Block* handler = nullptr;
+  for (auto block : cfg.blocks()) {
+    if (block->is_catch()) {
+      handler = block;
+    }
+  }
+  ASSERT_NE(handler, nullptr);
+  auto defs = big_block_iter.get_entry_state_at(handler).get(0);
+  ASSERT_FALSE(defs.is_top());
+  EXPECT_EQ(3, defs.size());
+
+  code->clear_cfg();
+}
+
+} // namespace
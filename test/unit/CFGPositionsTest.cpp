@@ -167,3 +167,47 @@ TEST_F(CFGMutationTest, RetainParentsWhenRemovingBlock) {
 }
 
 } // namespace
+
+TEST_F(CFGMutationTest, RemoveRedundantPositions) {
+  EXPECT_MUTATION(
+      [](ControlFlowGraph& cfg) {
+        EXPECT_EQ(cfg.remove_redundant_positions(), 2);
+      },
+      /* ACTUAL */ R"((
+        (.pos:dbg_0 method_name RedexGenerated 0)
+        (const v0 0)
+        (.pos:dbg_1 method_name RedexGenerated 1)
+        (.pos:dbg_2 method_name RedexGenerated 2)
+        (const v1 0)
+        (.pos:dbg_3 method_name RedexGenerated 2)
+        (const v2 0)
+        (return-void)
+      ))",
+      /* EXPECTED */ R"((
+        (.pos:dbg_0 method_name RedexGenerated 0)
+        (const v0 0)
+        (.pos:dbg_2 method_name RedexGenerated 2)
+        (const v1 0)
+        (const v2 0)
+        (return-void)
+      ))");
+}
+
+TEST_F(CFGMutationTest, RemoveRedundantPositionsRetainsParents) {
+  EXPECT_MUTATION(
+      [](ControlFlowGraph& cfg) {
+        EXPECT_EQ(cfg.remove_redundant_positions(), 0);
+      },
+      /* ACTUAL */ R"((
+        (.pos:dbg_parent method_name RedexGenerated 0)
+        (.pos:dbg_child method_name RedexGenerated 1 dbg_parent)
+        (const v0 0)
+        (return-void)
+      ))",
+      /* EXPECTED */ R"((
+        (.pos:dbg_parent method_name RedexGenerated 0)
+        (.pos:dbg_child method_name RedexGenerated 1 dbg_parent)
+        (const v0 0)
+        (return-void)
+      ))");
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ClassRefs.h"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class ClassRefsTest : public RedexTest {};
+
+namespace {
+
+DexClass* create_class(const char* name, const char* method) {
+  ClassCreator creator(DexType::make_type(name));
+  creator.set_super(type::java_lang_Object());
+  creator.add_method(assembler::method_from_string(method));
+  return creator.create();
+}
+
+} // namespace
+
+TEST_F(ClassRefsTest, caches_until_invalidated) {
+  auto cls = create_class("LFoo;", R"(
+    (method (public static) "LFoo;.foo:()V"
+      (
+        (const-string "hello")
+        (move-result-pseudo-object v0)
+        (invoke-static (v0) "LBar;.bar:(Ljava/lang/String;)V")
+        (invoke-static (v0) "LBar;.bar:(Ljava/lang/String;)V")
+        (return-void)
+      )
+    )
+  )");
+
+  auto refs = class_refs::gather(cls);
+  auto bar = DexMethod::get_method("LBar;.bar:(Ljava/lang/String;)V");
+  ASSERT_NE(bar, nullptr);
+  EXPECT_EQ(std::count(refs.method_refs.begin(), refs.method_refs.end(), bar),
+            1);
+  EXPECT_EQ(std::count(refs.strings.begin(), refs.strings.end(),
+                       DexString::get_string("hello")),
+            1);
+
+  class_refs::Cache cache;
+  cache.prefetch({cls});
+  EXPECT_EQ(cache.size(), 1);
+  auto cached = cache.get(cls);
+  EXPECT_EQ(cached, cache.get(cls));
+  EXPECT_EQ(cached->method_refs, refs.method_refs);
+  EXPECT_EQ(cached->strings, refs.strings);
+
+  cache.invalidate(cls);
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_NE(cached, cache.get(cls));
+  EXPECT_EQ(cache.size(), 1);
+}
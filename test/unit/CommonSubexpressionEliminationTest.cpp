@@ -1823,3 +1823,49 @@ TEST_F(CommonSubexpressionEliminationTest, finalizable) {
        expected_str,
        1);
 }
+
+TEST_F(CommonSubexpressionEliminationTest, method_barriers_are_cached) {
+  ClassCreator creator(DexType::make_type("LTest1;"));
+  creator.set_super(type::java_lang_Object());
+
+  DexField::make_field("LTest1;.f:I")->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  auto method = DexMethod::make_method("LTest1;.write:()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  method->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (sput v0 "LTest1;.f:I")
+      (return-void)
+    )
+  )"));
+  creator.add_method(method);
+  Scope scope{type_class(type::java_lang_Object()), creator.create()};
+  walk::code(scope, [&](DexMethod*, IRCode& code) {
+    code.build_cfg(/* editable */ true);
+  });
+
+  auto pure_methods = get_pure_methods();
+  std::unordered_set<DexString*> finalish_field_names;
+  purity::AnalysisCache cache;
+
+  cse_impl::SharedState uncached(pure_methods, finalish_field_names);
+  uncached.init_scope(scope);
+  cse_impl::SharedState first(pure_methods, finalish_field_names);
+  first.init_scope(scope, &cache);
+  auto hits = cache.hits();
+  cse_impl::SharedState second(pure_methods, finalish_field_names);
+  second.init_scope(scope, &cache);
+  // The override graph, the conditionally pure methods and the method
+  // barriers are all reused.
+  EXPECT_EQ(hits + 3, cache.hits());
+
+  EXPECT_GT(uncached.get_stats().method_barriers, 0);
+  EXPECT_EQ(uncached.get_stats().method_barriers,
+            first.get_stats().method_barriers);
+  EXPECT_EQ(first.get_stats().method_barriers,
+            second.get_stats().method_barriers);
+  EXPECT_EQ(first.get_stats().method_barriers_iterations,
+            second.get_stats().method_barriers_iterations);
+
+  walk::code(scope, [&](DexMethod*, IRCode& code) { code.clear_cfg(); });
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "CompactClassHierarchy.h"
+
+#include <gtest/gtest.h>
+
+#include "RedexTest.h"
+#include "Show.h"
+#include "SimpleClassHierarchy.h"
+
+class CompactClassHierarchyTest : public RedexTest {};
+
+namespace {
+
+TypeSet to_set(const CompactClassHierarchy::TypeRange& range) {
+  return TypeSet(range.begin(), range.end());
+}
+
+} // namespace
+
+TEST_F(CompactClassHierarchyTest, matches_class_hierarchy) {
+  redex::test::SimpleClassHierarchy classes;
+  Scope scope{classes.foo,  classes.bar,   classes.baz,
+              classes.qux,  classes.xyzzy, classes.iquux,
+              classes.quuz};
+  auto hierarchy = build_type_hierarchy(scope);
+  CompactClassHierarchy compact(hierarchy);
+
+  auto interfaces = build_interface_map(hierarchy);
+  std::vector<const DexType*> types{type::java_lang_Object(),
+                                    type::java_lang_Throwable()};
+  for (auto cls : scope) {
+    types.push_back(cls->get_type());
+  }
+  for (auto parent : types) {
+    EXPECT_EQ(to_set(compact.get_children(parent)),
+              get_children(hierarchy, parent))
+        << SHOW(parent);
+    auto all_children = get_all_children(hierarchy, parent);
+    EXPECT_EQ(to_set(compact.get_all_children(parent)), all_children)
+        << SHOW(parent);
+    EXPECT_EQ(to_set(compact.get_all_implementors(parent)),
+              get_all_implementors(interfaces, parent))
+        << SHOW(parent);
+    for (auto child : types) {
+      if (child != parent) {
+        EXPECT_EQ(compact.is_subclass(parent, child), all_children.count(child))
+            << SHOW(parent) << " " << SHOW(child);
+      }
+      EXPECT_EQ(compact.implements(child, parent),
+                implements(interfaces, child, parent))
+          << SHOW(child) << " " << SHOW(parent);
+    }
+  }
+
+  EXPECT_TRUE(compact.is_subclass(classes.foo->get_type(),
+                                  classes.foo->get_type()));
+  EXPECT_TRUE(compact.is_subclass(type::java_lang_Throwable(),
+                                  classes.qux->get_type()));
+  EXPECT_FALSE(compact.is_subclass(classes.qux->get_type(),
+                                   type::java_lang_Throwable()));
+  EXPECT_TRUE(
+      compact.implements(classes.quuz->get_type(), classes.iquux->get_type()));
+  EXPECT_FALSE(
+      compact.implements(classes.qux->get_type(), classes.iquux->get_type()));
+
+  // Types created afterwards are unknown.
+  auto unknown = DexType::make_type("LUnknown;");
+  EXPECT_FALSE(compact.is_subclass(type::java_lang_Object(), unknown));
+  EXPECT_TRUE(compact.get_all_children(unknown).empty());
+}
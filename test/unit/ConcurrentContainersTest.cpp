@@ -311,3 +311,58 @@ TEST_F(ConcurrentContainersTest, concurrentMapTest) {
   map.clear();
   EXPECT_EQ(0, map.size());
 }
+
+TEST_F(ConcurrentContainersTest, readMostlyConcurrentMapTest) {
+  ReadMostlyConcurrentMap<uint32_t, uint64_t> map;
+
+  run_on_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.emplace(sample[i], uint64_t(sample[i]) * 2);
+      EXPECT_EQ(1, map.count(sample[i]));
+      EXPECT_EQ(uint64_t(sample[i]) * 2, map.get(sample[i], 0));
+    }
+  });
+  EXPECT_EQ(m_data_set.size(), map.size());
+  for (uint32_t x : m_data) {
+    EXPECT_EQ(1, map.count(x));
+    EXPECT_EQ(uint64_t(x) * 2, map.at(x));
+    EXPECT_FALSE(map.emplace(x, 0));
+  }
+  EXPECT_THROW(map.at(1000000001), std::out_of_range);
+
+  std::unordered_set<uint32_t> seen;
+  for (const auto& p : map) {
+    EXPECT_EQ(uint64_t(p.first) * 2, p.second);
+    EXPECT_TRUE(seen.insert(p.first).second);
+  }
+  EXPECT_EQ(m_data_set.size(), seen.size());
+
+  run_on_subset_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.erase(sample[i]);
+    }
+  });
+  for (uint32_t x : m_subset_data) {
+    EXPECT_EQ(0, map.count(x));
+    EXPECT_EQ(7, map.get(x, 7));
+  }
+  for (uint32_t x : m_data) {
+    EXPECT_EQ(m_subset_data_set.count(x) ? 0 : 1, map.count(x));
+  }
+  EXPECT_EQ(m_data_set.size() - m_subset_data_set.size(), map.size());
+
+  // Erased keys can be inserted again.
+  run_on_subset_samples([&map](const std::vector<uint32_t>& sample) {
+    for (size_t i = 0; i < sample.size(); ++i) {
+      map.emplace(sample[i], 1);
+    }
+  });
+  for (uint32_t x : m_subset_data) {
+    EXPECT_EQ(1, map.at(x));
+  }
+  EXPECT_EQ(m_data_set.size(), map.size());
+
+  map.clear();
+  EXPECT_EQ(0, map.size());
+  EXPECT_EQ(map.end(), map.begin());
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+#include <thread>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+namespace {
+
+// Counts the classes, and remembers the thread it ran on.
+class CountClassesPass : public Pass {
+ public:
+  explicit CountClassesPass(const std::string& name) : Pass(name) {}
+
+  void set_analysis_usage(AnalysisUsage& au) const override {
+    au.set_preserve_all();
+  }
+  uint8_t reads() const override { return CLASSES; }
+  uint8_t writes() const override { return NO_PARTS; }
+
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& /* conf */,
+                PassManager& mgr) override {
+    thread_id = std::this_thread::get_id();
+    auto scope = build_class_scope(stores);
+    mgr.incr_metric("classes", scope.size());
+    mgr.sharded_counter("sharded_classes").add(scope.size());
+  }
+
+  std::thread::id thread_id;
+};
+
+// Counts the classes from the worker threads of a work queue.
+class CountClassesInWorkersPass : public CountClassesPass {
+ public:
+  explicit CountClassesInWorkersPass(const std::string& name)
+      : CountClassesPass(name) {}
+
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& /* conf */,
+                PassManager& mgr) override {
+    thread_id = std::this_thread::get_id();
+    auto scope = build_class_scope(stores);
+    auto& sharded_classes = mgr.sharded_counter("sharded_classes");
+    workqueue_run<DexClass*>(
+        [&](DexClass*) {
+          mgr.incr_metric("classes", 1);
+          sharded_classes.add(1);
+        },
+        scope,
+        /* num_threads */ 2);
+  }
+};
+
+// Keeps the defaults, and so may read and write anything.
+class OpaquePass : public Pass {
+ public:
+  OpaquePass() : Pass("OpaquePass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {}
+};
+
+} // namespace
+
+class ConcurrentPassesTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    DexStore store("classes");
+    DexClasses classes;
+    for (const char* name : {"LFoo;", "LBar;"}) {
+      ClassCreator creator(DexType::make_type(name));
+      creator.set_super(type::java_lang_Object());
+      classes.push_back(creator.create());
+    }
+    store.add_classes(std::move(classes));
+    m_stores.emplace_back(std::move(store));
+  }
+
+  // Runs the given passes, in order. Returns the metrics of each pass.
+  std::vector<std::unordered_map<std::string, int64_t>> run_passes(
+      const std::vector<Pass*>& passes, bool concurrent_independent_passes) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (const auto* pass : passes) {
+      config["redex"]["passes"].append(pass->name());
+    }
+    config["concurrent_independent_passes"] = concurrent_independent_passes;
+    ConfigFiles conf(config);
+    PassManager manager(passes, config);
+    manager.set_testing_mode();
+    manager.run_passes(m_stores, conf);
+    std::vector<std::unordered_map<std::string, int64_t>> metrics;
+    for (const auto& pass_info : manager.get_pass_info()) {
+      metrics.push_back(pass_info.metrics);
+    }
+    return metrics;
+  }
+
+  DexStoresVector m_stores;
+};
+
+TEST_F(ConcurrentPassesTest, independentPassesRunConcurrently) {
+  CountClassesPass first("FirstCountClassesPass");
+  CountClassesPass second("SecondCountClassesPass");
+  auto metrics = run_passes({&first, &second}, true);
+  EXPECT_NE(first.thread_id, second.thread_id);
+  for (const auto& pass_metrics : metrics) {
+    EXPECT_EQ(pass_metrics.at("concurrent_batch_size"), 2);
+    EXPECT_EQ(pass_metrics.at("classes"), 2);
+    EXPECT_EQ(pass_metrics.at("sharded_classes"), 2);
+  }
+}
+
+TEST_F(ConcurrentPassesTest, workersRecordMetricsOfTheirPass) {
+  CountClassesInWorkersPass first("FirstCountClassesInWorkersPass");
+  CountClassesInWorkersPass second("SecondCountClassesInWorkersPass");
+  auto metrics = run_passes({&first, &second}, true);
+  EXPECT_NE(first.thread_id, second.thread_id);
+  for (const auto& pass_metrics : metrics) {
+    EXPECT_EQ(pass_metrics.at("concurrent_batch_size"), 2);
+    EXPECT_EQ(pass_metrics.at("classes"), 2);
+    EXPECT_EQ(pass_metrics.at("sharded_classes"), 2);
+  }
+}
+
+TEST_F(ConcurrentPassesTest, passesThatMayWriteRunOnTheirOwn) {
+  CountClassesPass first("FirstCountClassesPass");
+  OpaquePass opaque;
+  CountClassesPass second("SecondCountClassesPass");
+  auto metrics = run_passes({&first, &opaque, &second}, true);
+  EXPECT_EQ(first.thread_id, second.thread_id);
+  for (const auto& pass_metrics : metrics) {
+    EXPECT_FALSE(pass_metrics.count("concurrent_batch_size"));
+  }
+  EXPECT_EQ(metrics[2].at("classes"), 2);
+}
+
+TEST_F(ConcurrentPassesTest, passesRunInOrderByDefault) {
+  CountClassesPass first("FirstCountClassesPass");
+  CountClassesPass second("SecondCountClassesPass");
+  auto metrics = run_passes({&first, &second}, false);
+  EXPECT_EQ(first.thread_id, second.thread_id);
+  EXPECT_FALSE(metrics[1].count("concurrent_batch_size"));
+}
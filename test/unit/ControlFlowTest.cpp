@@ -11,6 +11,7 @@
 
 #include "ControlFlow.h"
 #include "DexAsm.h"
+#include "Dominators.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 #include "RedexTest.h"
@@ -2515,3 +2516,111 @@ OPCODE: ADD_INT_LIT8 v0, v0, 1
 OPCODE: GOTO
 )");
 }
+
+TEST_F(ControlFlowTest, structure_revision) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :true)
+      (const v1 1)
+      (return v1)
+
+      (:true)
+      (const v1 2)
+      (return v1)
+    )
+  )");
+
+  ScopedCFG cfg(code.get());
+  auto order = cfg->order();
+  auto revision = cfg->structure_revision();
+  // Changing the instructions only leaves the structure as it is.
+  auto it = cfg->find_insn(order.back()->get_first_insn()->insn);
+  cfg->insert_before(it, {dasm(OPCODE_CONST, {1_v, 3_L})});
+  EXPECT_EQ(cfg->structure_revision(), revision);
+  EXPECT_EQ(cfg->remove_unreachable_blocks().first, 0u);
+  EXPECT_EQ(cfg->order(), order);
+
+  // A block that nothing branches to is removed by the next simplification.
+  auto unreachable = cfg->create_block();
+  unreachable->push_back(dasm(OPCODE_RETURN_VOID));
+  EXPECT_NE(cfg->structure_revision(), revision);
+  EXPECT_EQ(cfg->remove_unreachable_blocks().first, 1u);
+  EXPECT_EQ(cfg->order().size(), order.size());
+}
+
+TEST_F(ControlFlowTest, cached_structure_analyses) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (if-eqz v0 :true)
+      (const v1 1)
+      (goto :exit)
+
+      (:true)
+      (const v1 2)
+
+      (:exit)
+      (return v1)
+    )
+  )");
+
+  ScopedCFG cfg(code.get());
+  auto doms = cfg->get_dominators();
+  EXPECT_EQ(cfg->get_dominators(), doms);
+  auto wto = cfg->get_wto();
+  EXPECT_EQ(cfg->get_wto(), wto);
+  auto entry = cfg->entry_block();
+  for (auto* b : cfg->blocks()) {
+    EXPECT_EQ(doms->get_idom(b), entry);
+  }
+
+  // Splitting the entry block changes the structure, and the dominators.
+  auto new_block =
+      cfg->split_block(cfg->find_insn(entry->get_first_insn()->insn));
+  auto new_doms = cfg->get_dominators();
+  EXPECT_NE(new_doms, doms);
+  EXPECT_NE(cfg->get_wto(), wto);
+  EXPECT_EQ(new_doms->get_idom(new_block), entry);
+}
+
+TEST_F(ControlFlowTest, shared_throw_infos) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param-object v0)
+
+      (.try_start foo)
+      (invoke-static () "LFoo;.bar:()V")
+      (invoke-static () "LFoo;.bar:()V")
+      (invoke-static () "LFoo;.bar:()V")
+      (.try_end foo)
+      (return-void)
+
+      (.catch (foo))
+      (throw v0)
+    )
+  )");
+  code->build_cfg(/* editable */ true);
+  auto& cfg = code->cfg();
+  std::vector<cfg::Edge*> throws;
+  for (auto block : cfg.blocks()) {
+    auto edges = cfg.get_succ_edges_of_type(block, cfg::EDGE_THROW);
+    throws.insert(throws.end(), edges.begin(), edges.end());
+  }
+  ASSERT_EQ(throws.size(), 3);
+  for (auto edge : throws) {
+    EXPECT_EQ(edge->throw_info(), throws.front()->throw_info());
+  }
+  EXPECT_EQ(throws.front()->throw_info()->catch_type, nullptr);
+  EXPECT_EQ(throws.front()->throw_info()->index, 0);
+
+  // Copies of the cfg share them too.
+  cfg::ControlFlowGraph copy;
+  cfg.deep_copy(&copy);
+  for (auto block : copy.blocks()) {
+    for (auto edge : copy.get_succ_edges_of_type(block, cfg::EDGE_THROW)) {
+      EXPECT_EQ(edge->throw_info(), throws.front()->throw_info());
+    }
+  }
+  code->clear_cfg();
+}
@@ -7,6 +7,8 @@
 
 #include <gtest/gtest.h>
 
+#include "DexDebugInstruction.h"
+#include "DexPosition.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 #include "InstructionLowering.h"
@@ -75,3 +77,49 @@ TEST_F(DexPositionTest, consecutiveIdenticalPositions) {
 
   EXPECT_CODE_EQ(method->get_code(), expected_code.get());
 }
+
+TEST_F(DexPositionTest, filteredDebugOpcodesKeepAddresses) {
+  auto method = DexMethod::make_method("LFoo;.bar:()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (.pos "LFoo;.bar:()V" "Foo.java" 10)
+      (const v0 0)
+      (.dbg DBG_SET_PROLOGUE_END)
+      (const v1 0)
+      (.pos "LFoo;.bar:()V" "Foo.java" 20)
+      (return-void)
+    )
+  )");
+  code->set_debug_item(std::make_unique<DexDebugItem>());
+  method->set_code(std::move(code));
+
+  instruction_lowering::lower(method);
+  method->sync();
+  auto dbg = method->get_dex_code()->get_debug_item();
+  ASSERT_NE(dbg, nullptr);
+
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(""));
+  uint32_t line_start = 0;
+  std::vector<DebugLineItem> line_info;
+  auto unfiltered = generate_debug_instructions(
+      dbg, pos_mapper.get(), &line_start, &line_info, /* line_addin */ 0);
+  DebugOpcodeFilter filter;
+  filter.drop_prologue_end = true;
+  auto filtered =
+      generate_debug_instructions(dbg, pos_mapper.get(), &line_start,
+                                  &line_info, /* line_addin */ 0, &filter);
+
+  // The prologue end, and the advance of the address to it, are gone.
+  EXPECT_EQ(unfiltered.size(), 4);
+  ASSERT_EQ(filtered.size(), 2);
+  for (const auto& op : filtered) {
+    EXPECT_NE(op->opcode(), DBG_SET_PROLOGUE_END);
+  }
+  // The second position still advances the address by both instructions.
+  EXPECT_EQ(filtered[1]->opcode(),
+            static_cast<DexDebugItemOpcode>((10 - DBG_LINE_BASE) +
+                                            2 * DBG_LINE_RANGE +
+                                            DBG_FIRST_SPECIAL));
+}
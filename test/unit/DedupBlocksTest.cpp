@@ -1234,3 +1234,63 @@ TEST_F(DedupBlocksTest, retainPositionWhenMayThrow) {
   auto expected_code = assembler::ircode_from_string(expected_str);
   EXPECT_CODE_EQ(expected_code.get(), method->get_code());
 }
+
+TEST_F(DedupBlocksTest, duplicateBlocksAcrossMethods) {
+  auto make_method = [&](const std::string& name, const std::string& str) {
+    DexMethod* method = get_fresh_method(name);
+    method->set_code(assembler::ircode_from_string(str));
+    auto& code = *method->get_code();
+    code.build_cfg(/* editable */ true);
+    code.cfg().calculate_exit_block();
+    return method;
+  };
+  // The same tail, with different internal registers.
+  auto a = make_method("a", R"(
+    (
+      (const v0 0)
+      (if-eqz v0 :tail)
+      (return-void)
+      (:tail)
+      (sget "LFoo;.bar:I")
+      (move-result-pseudo v1)
+      (add-int v1 v1 v1)
+      (sput v1 "LFoo;.baz:I")
+      (return-void)
+    )
+  )");
+  auto b = make_method("b", R"(
+    (
+      (sget "LFoo;.bar:I")
+      (move-result-pseudo v2)
+      (add-int v2 v2 v2)
+      (sput v2 "LFoo;.baz:I")
+      (return-void)
+    )
+  )");
+  // Another tail.
+  auto c = make_method("c", R"(
+    (
+      (sget "LFoo;.bar:I")
+      (move-result-pseudo v1)
+      (sput v1 "LFoo;.baz:I")
+      (return-void)
+    )
+  )");
+
+  auto duplicates = dedup_blocks_impl::find_duplicate_blocks_across_methods(
+      {a, b, c}, /* min_insns */ 3);
+  ASSERT_EQ(1, duplicates.size());
+  auto& locations = duplicates.front();
+  ASSERT_EQ(2, locations.size());
+  EXPECT_EQ(a, locations[0].method);
+  EXPECT_EQ(b, locations[1].method);
+
+  // Short blocks are not considered.
+  EXPECT_TRUE(dedup_blocks_impl::find_duplicate_blocks_across_methods(
+                  {a, b, c}, /* min_insns */ 6)
+                  .empty());
+
+  for (auto method : {a, b, c}) {
+    method->get_code()->clear_cfg();
+  }
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DenseSideTable.h"
+
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "RedexTest.h"
+
+class DenseSideTableTest : public RedexTest {};
+
+TEST_F(DenseSideTableTest, ids_are_unique_and_dense) {
+  auto before = g_redex->num_type_ids();
+  std::unordered_set<uint32_t> ids;
+  for (int i = 0; i < 100; ++i) {
+    auto type = DexType::make_type(
+        DexString::make_string("LDense" + std::to_string(i) + ";"));
+    EXPECT_GE(type->get_id(), before);
+    EXPECT_LT(type->get_id(), g_redex->num_type_ids());
+    ids.insert(type->get_id());
+  }
+  EXPECT_EQ(ids.size(), 100);
+  EXPECT_EQ(g_redex->num_type_ids(), before + 100);
+
+  // Interning the same type again does not take a new ID.
+  auto type = DexType::make_type("LDense0;");
+  EXPECT_EQ(DexType::make_type("LDense0;")->get_id(), type->get_id());
+  EXPECT_EQ(g_redex->num_type_ids(), before + 100);
+}
+
+TEST_F(DenseSideTableTest, racing_creations_take_one_id) {
+  auto before = g_redex->num_type_ids();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([] {
+      for (int i = 0; i < 100; ++i) {
+        DexType::make_type(
+            DexString::make_string("LRace" + std::to_string(i) + ";"));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(g_redex->num_type_ids(), before + 100);
+}
+
+TEST_F(DenseSideTableTest, lookups_and_growth) {
+  auto foo = DexType::make_type("LFoo;");
+  DenseSideTable<DexType, int> table(-1);
+  EXPECT_EQ(table.at(foo), -1);
+  table[foo] = 3;
+  EXPECT_EQ(table.at(foo), 3);
+
+  auto bar = DexType::make_type("LBar;");
+  EXPECT_GE(bar->get_id(), table.capacity());
+  EXPECT_EQ(table.at(bar), -1);
+  table[bar] = 4;
+  EXPECT_EQ(table.at(bar), 4);
+  EXPECT_EQ(table.at(foo), 3);
+
+  table.clear();
+  EXPECT_EQ(table.at(foo), -1);
+  EXPECT_EQ(table.at(bar), -1);
+
+  auto method = DexMethod::make_method("LFoo;.m:()V");
+  DenseSideTable<DexMethodRef, uint8_t> marks;
+  EXPECT_EQ(marks.at(method), 0);
+  marks[method] = 1;
+  EXPECT_EQ(marks.at(method), 1);
+}
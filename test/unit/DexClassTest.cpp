@@ -10,6 +10,7 @@
 #include <boost/optional.hpp>
 
 #include "IRAssembler.h"
+#include "InstructionLowering.h"
 #include "RedexTest.h"
 #include "SimpleClassHierarchy.h"
 
@@ -172,3 +173,71 @@ TEST_F(DexClassTest, testObfuscatedNames) {
   EXPECT_EQ(field->get_deobfuscated_name(), "Lbaz;.bar:I");
   EXPECT_EQ(field->get_simple_deobfuscated_name(), "bar");
 }
+
+TEST_F(DexClassTest, testLazyCode) {
+  auto method = assembler::class_with_method("LFoo;",
+                                             R"(
+      (method (public static) "LFoo;.bar:()I"
+       (
+        (const v0 1)
+        (return v0)
+       )
+      )
+    )");
+  instruction_lowering::lower(method);
+  method->sync();
+  method->set_lazy_code();
+  EXPECT_TRUE(method->has_lazy_code());
+  EXPECT_NE(method->get_dex_code(), nullptr);
+
+  auto code = method->get_code();
+  ASSERT_NE(code, nullptr);
+  EXPECT_EQ(code->count_opcodes(), 2);
+  EXPECT_FALSE(method->has_lazy_code());
+  EXPECT_EQ(method->get_dex_code(), nullptr);
+  EXPECT_EQ(method->get_code(), code);
+}
+
+TEST_F(DexClassTest, testFrozenCode) {
+  auto method = assembler::class_with_method("LFoo;",
+                                             R"(
+      (method (public static) "LFoo;.bar:(I)J"
+       (
+        (load-param v0)
+        (.pos:dbg_0 "LFoo;.bar:(I)J" "Foo.java" 42)
+        (.src_block "LFoo;.bar:(I)J" 0 (1.0 0.5))
+        (switch v0 (:a :b))
+        (const-wide v1 -5)
+        (return-wide v1)
+
+        (:a 0)
+        (.try_start t)
+        (const-string "foo")
+        (move-result-pseudo-object v3)
+        (invoke-static (v3) "LFoo;.baz:(Ljava/lang/String;)J")
+        (move-result-wide v1)
+        (.try_end t)
+        (return-wide v1)
+
+        (:b 7)
+        (const-wide v1 7)
+        (return-wide v1)
+
+        (.catch (t) "Ljava/lang/Exception;")
+        (const-wide v1 123456789012)
+        (return-wide v1)
+       )
+      )
+    )");
+  auto expected = assembler::to_string(method->get_code());
+
+  EXPECT_TRUE(method->freeze_code());
+  EXPECT_TRUE(method->has_lazy_code());
+  EXPECT_FALSE(method->freeze_code());
+
+  auto code = method->get_code();
+  ASSERT_NE(code, nullptr);
+  EXPECT_FALSE(code->is_frozen());
+  EXPECT_FALSE(method->has_lazy_code());
+  EXPECT_EQ(assembler::to_string(code), expected);
+}
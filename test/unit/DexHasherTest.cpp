@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexHasher.h"
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexUtil.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class DexHasherTest : public RedexTest {};
+
+TEST(StreamHasherTest, independent_of_chunking) {
+  std::string data;
+  for (size_t i = 0; i < 1000; ++i) {
+    data.push_back(static_cast<char>(i * 7 + 3));
+  }
+
+  hashing::StreamHasher whole;
+  whole.update(data.data(), data.size());
+
+  for (size_t chunk : {1, 3, 8, 100, 256, 257}) {
+    hashing::StreamHasher pieces;
+    for (size_t i = 0; i < data.size(); i += chunk) {
+      pieces.update(data.data() + i, std::min(chunk, data.size() - i));
+    }
+    EXPECT_EQ(whole.finish(), pieces.finish()) << chunk;
+  }
+}
+
+TEST(StreamHasherTest, sensitive_to_contents) {
+  hashing::StreamHasher a;
+  a.update((uint32_t)1);
+  a.update((uint32_t)2);
+  hashing::StreamHasher b;
+  b.update((uint32_t)2);
+  b.update((uint32_t)1);
+  EXPECT_NE(a.finish(), b.finish());
+
+  // Trailing zeros still count.
+  hashing::StreamHasher c;
+  c.update((uint32_t)1);
+  c.update((uint32_t)2);
+  c.update((uint8_t)0);
+  EXPECT_NE(a.finish(), c.finish());
+
+  hashing::StreamHasher empty;
+  hashing::StreamHasher zero;
+  zero.update((uint8_t)0);
+  EXPECT_NE(empty.finish(), zero.finish());
+}
+
+TEST_F(DexHasherTest, scope_hash) {
+  auto make_class = [](const char* name, const char* code) {
+    ClassCreator creator(DexType::make_type(name));
+    creator.set_super(type::java_lang_Object());
+    auto method = assembler::method_from_string(code);
+    creator.add_method(method);
+    return creator.create();
+  };
+  auto foo = make_class("LFoo;", R"(
+    (method (public static) "LFoo;.foo:()I"
+      (
+        (const v0 1)
+        (const v1 1)
+        (return v0)
+      )
+    )
+  )");
+  auto bar = make_class("LBar;", R"(
+    (method (public static) "LBar;.bar:()V"
+      (
+        (return-void)
+      )
+    )
+  )");
+
+  Scope scope{foo, bar};
+  auto hash = hashing::DexScopeHasher(scope).run();
+  auto again = hashing::DexScopeHasher(scope).run();
+  EXPECT_EQ(hash.code_hash, again.code_hash);
+  EXPECT_EQ(hash.signature_hash, again.signature_hash);
+  EXPECT_EQ(hash.registers_hash, again.registers_hash);
+  EXPECT_EQ(hash.positions_hash, again.positions_hash);
+
+  // Only the registers change.
+  auto foo_method = foo->get_dmethods().at(0);
+  foo_method->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v1 1)
+      (const v0 1)
+      (return v1)
+    )
+  )"));
+  auto renamed = hashing::DexScopeHasher(scope).run();
+  EXPECT_EQ(hash.code_hash, renamed.code_hash);
+  EXPECT_EQ(hash.signature_hash, renamed.signature_hash);
+  EXPECT_NE(hash.registers_hash, renamed.registers_hash);
+
+  // The order of the classes matters.
+  Scope reversed{bar, foo};
+  auto reversed_hash = hashing::DexScopeHasher(reversed).run();
+  EXPECT_NE(renamed.signature_hash, reversed_hash.signature_hash);
+}
+
+TEST_F(DexHasherTest, method_hash_covers_registers) {
+  ClassCreator creator(DexType::make_type("LFoo;"));
+  creator.set_super(type::java_lang_Object());
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.foo:()V"
+      (
+        (const v0 1)
+        (const v1 2)
+        (invoke-static (v0) "LFoo;.bar:(I)V")
+        (return-void)
+      )
+    )
+  )");
+  creator.add_method(method);
+  creator.create();
+  auto hash = hashing::hash_method(method);
+  EXPECT_EQ(hash, hashing::hash_method(method));
+
+  // Only the register of the argument changes.
+  method->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v0 1)
+      (const v1 2)
+      (invoke-static (v1) "LFoo;.bar:(I)V")
+      (return-void)
+    )
+  )"));
+  EXPECT_NE(hash, hashing::hash_method(method));
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "FastStringOps.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+void check_less(const std::string& a, const std::string& b) {
+  EXPECT_EQ(strcmp(a.c_str(), b.c_str()) < 0,
+            fast_string::less(a.c_str(), b.c_str()))
+      << a << " < " << b;
+  EXPECT_EQ(strcmp(a.c_str(), b.c_str()) < 0,
+            fast_string::vector_less(a.c_str(), b.c_str()))
+      << a << " < " << b;
+}
+
+} // namespace
+
+TEST(FastStringOpsTest, less) {
+  std::vector<std::string> strs = {
+      "",
+      "A",
+      "A/",
+      "A/x",
+      "Lcom/some/class/name;",
+      "Lcom/some/class/name:methodnam",
+      "Lcom/some/class/name:methodname",
+      "Lcom/some/class/name:methodnamf",
+      "this string is very long very long very long very lon",
+      "this string is very long very long very long very long",
+      "0123456789abcdef",
+      "0123456789abcdef0",
+      "0123456789abcdeg",
+      "\xc3\xa9t\xc3\xa9",
+      "\xc3\xa9t",
+      "et\xc3\xa9"};
+  for (const auto& a : strs) {
+    for (const auto& b : strs) {
+      check_less(a, b);
+    }
+  }
+}
+
+#ifndef _WIN32
+TEST(FastStringOpsTest, less_at_page_end) {
+  // Put strings right before an unreadable page, at every alignment. Reading
+  // past their end would fault.
+  size_t page = sysconf(_SC_PAGESIZE);
+  auto buffer = static_cast<char*>(mmap(nullptr, 2 * page,
+                                        PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  ASSERT_NE(buffer, MAP_FAILED);
+  ASSERT_EQ(mprotect(buffer + page, page, PROT_NONE), 0);
+  const std::string str = "Lcom/facebook/Foo;";
+  const std::string other = "Lcom/facebook/Fop;";
+  for (size_t len = 0; len <= str.size(); ++len) {
+    auto a = buffer + page - len - 1;
+    memcpy(a, str.c_str(), len);
+    a[len] = '\0';
+    auto prefix = str.substr(0, len);
+    EXPECT_FALSE(fast_string::vector_less(a, prefix.c_str()));
+    EXPECT_FALSE(fast_string::vector_less(prefix.c_str(), a));
+    EXPECT_TRUE(fast_string::vector_less(a, other.c_str()));
+    EXPECT_FALSE(fast_string::vector_less(other.c_str(), a));
+    EXPECT_EQ(len < str.size(), fast_string::vector_less(a, str.c_str()));
+  }
+  munmap(buffer, 2 * page);
+}
+#endif
+
+TEST(FastStringOpsTest, hash) {
+  const std::string str = "Lcom/facebook/redex/SomeClass$Inner;";
+  EXPECT_EQ(fast_string::hash(str.c_str(), str.size()),
+            fast_string::hash(std::string(str).c_str(), str.size()));
+  // Every length, including the ones that are not a multiple of a word,
+  // must take all the bytes into account.
+  for (size_t len = 1; len <= str.size(); ++len) {
+    auto changed = str;
+    changed[len - 1] ^= 1;
+    EXPECT_NE(fast_string::hash(str.c_str(), len),
+              fast_string::hash(changed.c_str(), len))
+        << len;
+  }
+  EXPECT_NE(fast_string::hash("", 0), fast_string::hash("\0", 1));
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "FrameworkApi.h"
+
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+#include "Show.h"
+
+class FrameworkApiTest : public RedexTest {};
+
+namespace {
+
+constexpr const char* API_FILE = R"(
+Landroid/util/ArrayMap; 1 Ljava/lang/Object; 2 1
+  M Landroid/util/ArrayMap;.indexOfKey:(Ljava/lang/Object;)I 1
+  M Landroid/util/ArrayMap;.indexOfValue:(Ljava/lang/Object;)I 1
+  F Landroid/util/ArrayMap;.EMPTY:[Ljava/lang/Object; 25
+Landroid/util/ArraySet; 1 Ljava/lang/Object; 2 0
+  M Landroid/util/ArraySet;.removeIf:(Ljava/util/function/Predicate;)Z 1
+  M Landroid/util/ArraySet;.<init>:(Ljava/util/Collection;)V 1
+Landroid/util/LongSparseArray; 1 Landroid/util/ArrayMap; 0 0
+Landroid/app/FragmentContainer; 1025 Ljava/lang/Object; 0 0
+Landroid/view/View; 1 Ljava/lang/Object; 1 0
+  M Landroid/view/View;.clearFocus:()V 1
+Ljava/lang/Object; 1 None 0 0
+)";
+
+DexMethod* make_method(const std::string& descriptor, DexAccessFlags access) {
+  return DexMethod::make_method(descriptor)->make_concrete(
+      access, /* is_virtual */ false);
+}
+
+} // namespace
+
+TEST_F(FrameworkApiTest, database_answers_like_the_text_file) {
+  auto tmp_dir = redex::make_tmp_dir("FrameworkApiTest%%%%%%%%");
+  auto api_file = tmp_dir.path + "/framework_api.txt";
+  auto db_file = tmp_dir.path + "/framework_api.bin";
+  {
+    std::ofstream out(api_file);
+    out << API_FILE;
+  }
+  api::FrameworkApiDatabase::write(api_file, db_file);
+  EXPECT_FALSE(api::FrameworkApiDatabase::is_database(api_file));
+  EXPECT_TRUE(api::FrameworkApiDatabase::is_database(db_file));
+
+  api::AndroidSDK text_sdk(api_file);
+  api::AndroidSDK db_sdk(db_file);
+
+  for (const char* name :
+       {"Landroid/util/ArrayMap;", "Landroid/util/ArraySet;",
+        "Landroid/view/View;", "Ljava/lang/Object;", "Landroid/view/Window;",
+        "Landroid/util/ArrayMa;"}) {
+    auto type = DexType::make_type(name);
+    EXPECT_EQ(text_sdk.has_type(type), db_sdk.has_type(type)) << name;
+  }
+  EXPECT_TRUE(db_sdk.has_type(DexType::make_type("Landroid/view/View;")));
+  EXPECT_FALSE(db_sdk.has_type(DexType::make_type("Landroid/view/Window;")));
+
+  std::vector<DexMethod*> methods{
+      make_method("Landroid/util/ArrayMap;.indexOfKey:(Ljava/lang/Object;)I",
+                  ACC_PUBLIC),
+      make_method("Landroid/util/ArraySet;.<init>:(Ljava/util/Collection;)V",
+                  ACC_PUBLIC | ACC_FINAL),
+      // Wrong proto.
+      make_method("Landroid/util/ArrayMap;.indexOfKey:(I)I", ACC_PUBLIC),
+      // Wrong access.
+      make_method("Landroid/view/View;.clearFocus:()V", ACC_PRIVATE),
+      make_method("Landroid/view/View;.requestFocus:()Z", ACC_PUBLIC),
+  };
+  for (auto* method : methods) {
+    EXPECT_EQ(text_sdk.has_method(method), db_sdk.has_method(method))
+        << show(method);
+  }
+  EXPECT_TRUE(db_sdk.has_method(methods[0]));
+  EXPECT_TRUE(db_sdk.has_method(methods[1]));
+  EXPECT_FALSE(db_sdk.has_method(methods[2]));
+  EXPECT_FALSE(db_sdk.has_method(methods[3]));
+  EXPECT_FALSE(db_sdk.has_method(methods[4]));
+
+  auto field = static_cast<DexField*>(DexField::make_field(
+      "Landroid/util/ArrayMap;.EMPTY:[Ljava/lang/Object;"));
+  field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+  auto other_field =
+      static_cast<DexField*>(DexField::make_field("Landroid/view/View;.f:I"));
+  other_field->make_concrete(ACC_PUBLIC);
+  EXPECT_TRUE(text_sdk.has_field(field));
+  EXPECT_TRUE(db_sdk.has_field(field));
+  EXPECT_FALSE(text_sdk.has_field(other_field));
+  EXPECT_FALSE(db_sdk.has_field(other_field));
+
+  const auto& text_classes = text_sdk.get_framework_classes();
+  const auto& db_classes = db_sdk.get_framework_classes();
+  EXPECT_EQ(text_classes.size(), db_classes.size());
+  for (const auto& pair : text_classes) {
+    auto it = db_classes.find(pair.first);
+    ASSERT_NE(it, db_classes.end()) << show(pair.first);
+    EXPECT_EQ(it->second.super_cls, pair.second.super_cls);
+    EXPECT_EQ(it->second.access_flags, pair.second.access_flags);
+    EXPECT_EQ(it->second.mrefs_info.size(), pair.second.mrefs_info.size());
+    EXPECT_EQ(it->second.frefs_info.size(), pair.second.frefs_info.size());
+  }
+}
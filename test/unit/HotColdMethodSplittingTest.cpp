@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "HotColdMethodSplitting.h"
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+namespace {
+
+DexMethod* create(const std::string& sig, const std::string& code_str) {
+  ClassCreator cc{DexType::make_type("LFoo;")};
+  cc.set_super(type::java_lang_Object());
+  auto m = DexMethod::make_method("LFoo;.bar:" + sig)
+               ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                               assembler::ircode_from_string(code_str), false);
+  cc.add_method(m);
+  cc.create();
+  return m;
+}
+
+bool has_opcode(const DexMethod* m, IROpcode op) {
+  for (const auto& mie : InstructionIterable(m->get_code())) {
+    if (mie.insn->opcode() == op) {
+      return true;
+    }
+  }
+  return false;
+}
+
+hot_cold_splitting::Config make_config() {
+  hot_cold_splitting::Config config;
+  config.min_insns_size = 1;
+  return config;
+}
+
+} // namespace
+
+class HotColdMethodSplittingTest : public RedexTest {};
+
+TEST_F(HotColdMethodSplittingTest, SplitsColdThrow) {
+  auto m = create("(Z)I", R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(Z)I" 0 (1.0 1.0))
+      (if-eqz v0 :cold)
+      (.src_block "LFoo;.bar:(Z)I" 1 (1.0 1.0))
+      (const v1 1)
+      (return v1)
+      (:cold)
+      (.src_block "LFoo;.bar:(Z)I" 2 (0.0 0.0))
+      (new-instance "Ljava/lang/RuntimeException;")
+      (move-result-pseudo-object v2)
+      (invoke-static (v0) "LBaz;.check:(Z)V")
+      (invoke-direct (v2) "Ljava/lang/RuntimeException;.<init>:()V")
+      (throw v2)
+    )
+  )");
+  std::vector<DexMethod*> cold_methods;
+  auto stats =
+      hot_cold_splitting::split_method(make_config(), m, &cold_methods);
+  EXPECT_EQ(stats.split_regions, 1);
+  EXPECT_FALSE(has_opcode(m, OPCODE_NEW_INSTANCE));
+  EXPECT_TRUE(has_opcode(m, OPCODE_INVOKE_STATIC));
+
+  auto cold = DexMethod::get_method("LFoo;.bar$cold:(Z)I");
+  ASSERT_NE(cold, nullptr);
+  EXPECT_EQ(cold_methods, std::vector<DexMethod*>{cold->as_def()});
+  ASSERT_TRUE(cold->is_def());
+  EXPECT_TRUE(has_opcode(cold->as_def(), OPCODE_NEW_INSTANCE));
+  EXPECT_TRUE(has_opcode(cold->as_def(), IOPCODE_LOAD_PARAM));
+}
+
+TEST_F(HotColdMethodSplittingTest, KeepsHotCode) {
+  auto m = create("(Z)I", R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(Z)I" 0 (1.0 1.0))
+      (if-eqz v0 :other)
+      (.src_block "LFoo;.bar:(Z)I" 1 (1.0 1.0))
+      (const v1 1)
+      (return v1)
+      (:other)
+      (.src_block "LFoo;.bar:(Z)I" 2 (0.5 1.0))
+      (const v1 2)
+      (return v1)
+    )
+  )");
+  std::vector<DexMethod*> cold_methods;
+  auto stats =
+      hot_cold_splitting::split_method(make_config(), m, &cold_methods);
+  EXPECT_EQ(stats.cold_regions, 0);
+  EXPECT_EQ(stats.split_regions, 0);
+}
+
+TEST_F(HotColdMethodSplittingTest, KeepsColdCodeThatRejoins) {
+  auto m = create("(Z)I", R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(Z)I" 0 (1.0 1.0))
+      (const v1 1)
+      (if-eqz v0 :join)
+      (.src_block "LFoo;.bar:(Z)I" 1 (0.0 0.0))
+      (const v1 2)
+      (:join)
+      (.src_block "LFoo;.bar:(Z)I" 2 (1.0 1.0))
+      (return v1)
+    )
+  )");
+  std::vector<DexMethod*> cold_methods;
+  auto stats =
+      hot_cold_splitting::split_method(make_config(), m, &cold_methods);
+  EXPECT_EQ(stats.cold_regions, 0);
+  EXPECT_EQ(stats.split_regions, 0);
+}
+
+TEST_F(HotColdMethodSplittingTest, KeepsAmbiguousLiveIns) {
+  auto m = create("()I", R"(
+    (
+      (.src_block "LFoo;.bar:()I" 0 (1.0 1.0))
+      (const v0 0)
+      (sget "LBaz;.flag:Z")
+      (move-result-pseudo v1)
+      (if-eqz v1 :cold)
+      (.src_block "LFoo;.bar:()I" 1 (1.0 1.0))
+      (return v0)
+      (:cold)
+      (.src_block "LFoo;.bar:()I" 2 (0.0 0.0))
+      (invoke-static (v0) "LBaz;.check:(Z)V")
+      (return v0)
+    )
+  )");
+  std::vector<DexMethod*> cold_methods;
+  auto stats =
+      hot_cold_splitting::split_method(make_config(), m, &cold_methods);
+  EXPECT_EQ(stats.cold_regions, 1);
+  EXPECT_EQ(stats.rejected_live_ins, 1);
+  EXPECT_EQ(stats.split_regions, 0);
+}
@@ -391,3 +391,26 @@ TEST_F(IRInstructionTest, InvokeSourceIsWideComplex2) {
   EXPECT_FALSE(insn->invoke_src_is_wide(3));
   EXPECT_TRUE(insn->invoke_src_is_wide(4));
 }
+
+TEST_F(IRInstructionTest, ResizeSrcs) {
+  IRInstruction insn(OPCODE_INVOKE_STATIC);
+  insn.set_srcs_size(2);
+  insn.set_src(0, 7);
+  insn.set_src(1, 8);
+  // inline -> out-of-line preserves existing registers and zero-fills
+  insn.set_srcs_size(4);
+  EXPECT_EQ(insn.srcs_vec(), std::vector<reg_t>({7, 8, 0, 0}));
+  insn.set_src(3, 9);
+
+  IRInstruction copy(insn);
+  EXPECT_EQ(copy, insn);
+  copy.set_src(2, 1);
+  EXPECT_NE(copy, insn);
+
+  // out-of-line -> inline
+  insn.set_srcs_size(1);
+  EXPECT_EQ(insn.srcs_size(), 1);
+  EXPECT_EQ(insn.src(0), 7);
+  insn.set_srcs_size(0);
+  EXPECT_TRUE(insn.srcs().empty());
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "IncrementalPassCache.h"
+
+#include <gtest/gtest.h>
+
+#include "IRAssembler.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+#include "ReduceGotos.h"
+
+class IncrementalPassCacheTest : public RedexTest {};
+
+namespace {
+
+// Runs ReduceGotos on the method through the cache, and returns whether it
+// actually had to be run.
+bool reduce_gotos(incremental::NoOpCache* cache, DexMethod* method) {
+  return cache->run(method, [&] {
+    ReduceGotosPass::process_code(method->get_code());
+  });
+}
+
+} // namespace
+
+TEST_F(IncrementalPassCacheTest, noops_are_skipped_in_later_runs) {
+  auto tmp_dir = redex::make_tmp_dir("IncrementalPassCache%%%%%%%%");
+
+  auto optimized = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.optimized:()V"
+      (
+        (return-void)
+      )
+    )
+  )");
+  auto reducible = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.reducible:(I)V"
+      (
+        (load-param v0)
+        (if-eqz v0 :a)
+        (goto :b)
+        (:a)
+        (const v0 0)
+        (:b)
+        (return-void)
+      )
+    )
+  )");
+
+  {
+    incremental::NoOpCache cache("ReduceGotosPass", 0);
+    EXPECT_EQ(cache.load(tmp_dir.path), 0);
+    EXPECT_TRUE(reduce_gotos(&cache, optimized));
+    EXPECT_TRUE(reduce_gotos(&cache, reducible));
+    EXPECT_EQ(cache.hits(), 0);
+    cache.save(tmp_dir.path);
+  }
+
+  {
+    // Only the method that was left unchanged can be skipped; the other one
+    // is a no-op now that it has been optimized.
+    incremental::NoOpCache cache("ReduceGotosPass", 0);
+    EXPECT_EQ(cache.load(tmp_dir.path), 1);
+    EXPECT_FALSE(reduce_gotos(&cache, optimized));
+    EXPECT_TRUE(reduce_gotos(&cache, reducible));
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(cache.misses(), 1);
+    cache.save(tmp_dir.path);
+  }
+
+  {
+    incremental::NoOpCache cache("ReduceGotosPass", 0);
+    EXPECT_EQ(cache.load(tmp_dir.path), 2);
+    EXPECT_FALSE(reduce_gotos(&cache, optimized));
+    EXPECT_FALSE(reduce_gotos(&cache, reducible));
+  }
+
+  {
+    // A different configuration invalidates everything.
+    incremental::NoOpCache cache("ReduceGotosPass", 1);
+    EXPECT_EQ(cache.load(tmp_dir.path), 0);
+    EXPECT_TRUE(reduce_gotos(&cache, optimized));
+  }
+}
+
+TEST_F(IncrementalPassCacheTest, changed_code_is_not_skipped) {
+  auto tmp_dir = redex::make_tmp_dir("IncrementalPassCache%%%%%%%%");
+
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()V"
+      (
+        (return-void)
+      )
+    )
+  )");
+
+  {
+    incremental::NoOpCache cache("ReduceGotosPass", 0);
+    EXPECT_TRUE(reduce_gotos(&cache, method));
+    cache.save(tmp_dir.path);
+  }
+
+  method->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (return-void)
+    )
+  )"));
+
+  incremental::NoOpCache cache("ReduceGotosPass", 0);
+  EXPECT_EQ(cache.load(tmp_dir.path), 1);
+  EXPECT_TRUE(reduce_gotos(&cache, method));
+}
+
+TEST_F(IncrementalPassCacheTest, register_changes_are_not_skipped) {
+  auto tmp_dir = redex::make_tmp_dir("IncrementalPassCache%%%%%%%%");
+
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.baz:()V"
+      (
+        (const v0 0)
+        (return-void)
+      )
+    )
+  )");
+
+  {
+    incremental::NoOpCache cache("ReduceGotosPass", 0);
+    EXPECT_TRUE(reduce_gotos(&cache, method));
+    cache.save(tmp_dir.path);
+  }
+
+  // Only the register differs from the code that was found to be a no-op.
+  method->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v1 0)
+      (return-void)
+    )
+  )"));
+
+  incremental::NoOpCache cache("ReduceGotosPass", 0);
+  EXPECT_EQ(cache.load(tmp_dir.path), 1);
+  EXPECT_TRUE(reduce_gotos(&cache, method));
+}
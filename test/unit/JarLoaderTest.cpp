@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <boost/filesystem.hpp>
+#include <gtest/gtest.h>
+
+#include "DexClass.h"
+#include "JarLoader.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+#include "Show.h"
+
+namespace {
+
+// The android.jar of the SDK given by the environment, or an empty string if
+// the environment does not give one.
+std::string get_sdk_jar() {
+  const char* android_sdk = std::getenv("sdk_path");
+  const char* android_target = std::getenv("android_target");
+  if (android_sdk == nullptr || android_target == nullptr) {
+    return "";
+  }
+  return std::string(android_sdk) + "/platforms/" + android_target +
+         "/android.jar";
+}
+
+// A printout of everything we load from a jar.
+std::vector<std::string> describe(const Scope& classes) {
+  std::vector<std::string> result;
+  for (const auto* cls : classes) {
+    result.push_back(show(cls) + " " + show(cls->get_access()) + " " +
+                     show(cls->get_super_class()) + " " +
+                     show(cls->get_interfaces()));
+    for (const auto* field : cls->get_all_fields()) {
+      result.push_back(show(field) + " " + show(field->get_access()));
+    }
+    for (const auto* method : cls->get_all_methods()) {
+      result.push_back(show(method) + " " + show(method->get_access()) +
+                       (method->is_virtual() ? " virtual" : ""));
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+class JarLoaderTest : public RedexTest {};
+
+TEST_F(JarLoaderTest, snapshot) {
+  auto sdk_jar = get_sdk_jar();
+  ASSERT_FALSE(sdk_jar.empty()) << "sdk_path and android_target must be set";
+  auto tmp_dir = redex::make_tmp_dir("JarLoaderTest%%%%%%%%");
+
+  Scope parsed;
+  ASSERT_TRUE(load_jar_file(sdk_jar.c_str(), &parsed));
+  auto expected = describe(parsed);
+  ASSERT_FALSE(expected.empty());
+
+  // The first load with a snapshot directory parses the jar and saves a
+  // snapshot.
+  delete g_redex;
+  g_redex = new RedexContext();
+  Scope first;
+  ASSERT_TRUE(load_jar_file(sdk_jar.c_str(), &first, nullptr, tmp_dir.path));
+  EXPECT_EQ(expected, describe(first));
+  size_t snapshots = 0;
+  for (const auto& entry :
+       boost::filesystem::directory_iterator(tmp_dir.path)) {
+    EXPECT_EQ(".jarsnapshot", entry.path().extension().string());
+    ++snapshots;
+  }
+  EXPECT_EQ(1, snapshots);
+
+  // The second one loads the same classes from the snapshot.
+  delete g_redex;
+  g_redex = new RedexContext();
+  Scope second;
+  ASSERT_TRUE(load_jar_file(sdk_jar.c_str(), &second, nullptr, tmp_dir.path));
+  EXPECT_EQ(expected, describe(second));
+}
+
+TEST_F(JarLoaderTest, corruptSnapshotIsIgnored) {
+  auto sdk_jar = get_sdk_jar();
+  ASSERT_FALSE(sdk_jar.empty()) << "sdk_path and android_target must be set";
+  auto tmp_dir = redex::make_tmp_dir("JarLoaderTest%%%%%%%%");
+
+  Scope first;
+  ASSERT_TRUE(load_jar_file(sdk_jar.c_str(), &first, nullptr, tmp_dir.path));
+  auto expected = describe(first);
+  for (const auto& entry :
+       boost::filesystem::directory_iterator(tmp_dir.path)) {
+    boost::filesystem::resize_file(entry.path(),
+                                   boost::filesystem::file_size(entry) / 2);
+  }
+
+  delete g_redex;
+  g_redex = new RedexContext();
+  Scope second;
+  ASSERT_TRUE(load_jar_file(sdk_jar.c_str(), &second, nullptr, tmp_dir.path));
+  EXPECT_EQ(expected, describe(second));
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "KeepReason.h"
+#include "RedexContext.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+class KeepReasonTest : public RedexTest {
+ protected:
+  DexClass* make_class(const char* name) {
+    ClassCreator creator(DexType::make_type(name));
+    creator.set_super(type::java_lang_Object());
+    return creator.create();
+  }
+};
+
+TEST_F(KeepReasonTest, reasonsAreOnlyRecordedWhenRequested) {
+  auto* cls = make_class("LFoo;");
+  cls->rstate.set_root();
+  EXPECT_FALSE(cls->rstate.can_delete());
+  EXPECT_TRUE(cls->rstate.keep_reasons().empty());
+}
+
+TEST_F(KeepReasonTest, reasonsAreDeduplicated) {
+  RedexContext::set_record_keep_reasons(true);
+  auto* cls = make_class("LFoo;");
+  cls->rstate.set_root(keep_reason::UNKNOWN);
+  cls->rstate.set_referenced_by_resource_xml();
+  cls->rstate.set_root(keep_reason::UNKNOWN);
+  cls->rstate.set_referenced_by_resource_xml();
+
+  std::vector<keep_reason::KeepReasonType> types;
+  for (const auto* reason : cls->rstate.keep_reasons()) {
+    types.push_back(reason->type);
+  }
+  EXPECT_EQ(types, std::vector<keep_reason::KeepReasonType>(
+                       {keep_reason::XML, keep_reason::UNKNOWN}));
+}
+
+TEST_F(KeepReasonTest, reasonsCanBeAddedConcurrently) {
+  RedexContext::set_record_keep_reasons(true);
+  auto* cls = make_class("LFoo;");
+  std::vector<keep_reason::KeepReasonType> all_types{
+      keep_reason::REDEX_CONFIG, keep_reason::MANIFEST, keep_reason::XML,
+      keep_reason::ANNO,         keep_reason::SERIALIZABLE,
+      keep_reason::NATIVE,       keep_reason::UNKNOWN};
+  std::vector<keep_reason::KeepReasonType> work;
+  for (size_t i = 0; i < 100; ++i) {
+    work.insert(work.end(), all_types.begin(), all_types.end());
+  }
+  workqueue_run<keep_reason::KeepReasonType>(
+      [&](keep_reason::KeepReasonType type) { cls->rstate.set_root(type); },
+      work);
+
+  std::vector<keep_reason::KeepReasonType> types;
+  for (const auto* reason : cls->rstate.keep_reasons()) {
+    types.push_back(reason->type);
+  }
+  std::sort(types.begin(), types.end());
+  EXPECT_EQ(types, all_types);
+}
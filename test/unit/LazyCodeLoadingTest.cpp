@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "InstructionLowering.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "UnmarkProguardKeep.h"
+
+namespace {
+
+// Remembers whether the code of `target` was still lazy when it ran.
+class ObserveLazyCodePass : public Pass {
+ public:
+  ObserveLazyCodePass(const std::string& name, bool needs_all_code)
+      : Pass(name), m_needs_all_code(needs_all_code) {}
+
+  bool needs_all_code() const override { return m_needs_all_code; }
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    saw_lazy_code = target->has_lazy_code();
+  }
+
+  DexMethod* target{nullptr};
+  bool saw_lazy_code{false};
+
+ private:
+  bool m_needs_all_code;
+};
+
+} // namespace
+
+class LazyCodeLoadingTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    ClassCreator creator(DexType::make_type("LFoo;"));
+    creator.set_super(type::java_lang_Object());
+    m_method = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.bar:()I"
+        ((const v0 1) (return v0))
+      )
+    )");
+    creator.add_method(m_method);
+    DexStore store("classes");
+    store.add_classes({creator.create()});
+    m_stores.emplace_back(std::move(store));
+
+    // As if the class had been loaded with `lazy_code_loading`.
+    instruction_lowering::lower(m_method);
+    m_method->sync();
+    m_method->set_lazy_code();
+  }
+
+  void run_passes(const std::vector<Pass*>& passes) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (const auto* pass : passes) {
+      config["redex"]["passes"].append(pass->name());
+    }
+    // The type checker looks at all the code.
+    config["ir_type_checker"]["run_on_input"] = false;
+    config["ir_type_checker"]["run_after_each_pass"] = false;
+    ConfigFiles conf(config);
+    PassManager manager(passes, config);
+    manager.set_testing_mode();
+    manager.run_passes(m_stores, conf);
+  }
+
+  DexStoresVector m_stores;
+  DexMethod* m_method;
+};
+
+TEST_F(LazyCodeLoadingTest, codeStaysLazyUntilAPassNeedsAllOfIt) {
+  UnmarkProguardKeepPass unmark;
+  ObserveLazyCodePass first("FirstObserveLazyCodePass",
+                            /* needs_all_code */ false);
+  ObserveLazyCodePass second("SecondObserveLazyCodePass",
+                             /* needs_all_code */ true);
+  first.target = m_method;
+  second.target = m_method;
+  run_passes({&unmark, &first, &second});
+  EXPECT_TRUE(first.saw_lazy_code);
+  EXPECT_FALSE(second.saw_lazy_code);
+  // The final type check looks at all the code.
+  EXPECT_FALSE(m_method->has_lazy_code());
+  EXPECT_EQ(m_method->get_code()->count_opcodes(), 2);
+}
@@ -48,3 +48,48 @@ TEST_F(LebTest, Sleb128) {
   check(-(64 << 14), {0x80, 0x80, 0x40});
   check(-(64 << 14) - 1, {0xFF, 0xFF, 0xBF, 0x7F});
 }
+
+TEST_F(LebTest, Uleb128s) {
+  std::vector<uint32_t> values;
+  for (uint32_t i = 0; i < 100; ++i) {
+    // Mostly single-byte values, with some longer ones in between.
+    values.push_back(i % 7 == 0 ? (i << 20) : i % 5 == 0 ? 300 : i);
+  }
+  std::vector<uint8_t> bytes(values.size() * 5);
+  uint8_t* out = bytes.data();
+  for (auto v : values) {
+    out = write_uleb128(out, v);
+  }
+  size_t size = out - bytes.data();
+
+  std::vector<uint32_t> decoded(values.size());
+  const uint8_t* ptr = bytes.data();
+  read_uleb128s(&ptr, bytes.data() + size, decoded.data(), decoded.size());
+  EXPECT_EQ(decoded, values);
+  EXPECT_EQ(ptr, bytes.data() + size);
+
+  // Without readable bytes past the end, the words are decoded one at a time.
+  std::fill(decoded.begin(), decoded.end(), 0);
+  ptr = bytes.data();
+  read_uleb128s(&ptr, ptr, decoded.data(), decoded.size());
+  EXPECT_EQ(decoded, values);
+  EXPECT_EQ(ptr, bytes.data() + size);
+}
+
+TEST_F(LebTest, Mutf8LengthAndHashcode) {
+  auto check = [](const std::string& s,
+                  uint32_t expected_length,
+                  int32_t expected_hash) {
+    EXPECT_EQ(length_of_utf8_string(s.c_str()), expected_length);
+    EXPECT_EQ(length_of_utf8_string(s.c_str(), s.size()), expected_length);
+    EXPECT_EQ(java_hashcode_of_utf8_string(s.c_str()), expected_hash);
+    EXPECT_EQ(java_hashcode_of_utf8_string(s.c_str(), s.size()),
+              expected_hash);
+  };
+  check("", 0, 0);
+  check("a", 1, 97);
+  // "Ljava/lang/Object;".hashCode()
+  check("Ljava/lang/Object;", 18, 1601768860);
+  // "Ljava/lang/Object;é中".hashCode()
+  check("Ljava/lang/Object;\xc3\xa9\xe4\xb8\xad", 20, 1701609728);
+}
@@ -629,3 +629,86 @@ TEST_F(LocalDceTryTest, normalize_new_instances_no_aliases) {
   ldce.dce(ircode);
   EXPECT_CODE_EQ(ircode, expected_code.get());
 }
+
+TEST_F(LocalDceEnhanceTest, PurityAnalysisCacheTest) {
+  Scope scope = create_empty_scope();
+  auto void_t = type::_void();
+  auto void_void =
+      DexProto::make_proto(void_t, DexTypeList::make_type_list({}));
+
+  DexType* a_type = DexType::make_type("LA;");
+  DexClass* a_cls = create_internal_class(a_type, type::java_lang_Object(), {},
+                                          ACC_PUBLIC | ACC_ABSTRACT);
+  create_abstract_method(a_cls, "m", void_void);
+
+  DexType* b_type = DexType::make_type("LB;");
+  DexClass* b_cls = create_internal_class(b_type, a_type, {});
+  create_empty_method(b_cls, "m", void_void);
+
+  scope.push_back(a_cls);
+  scope.push_back(b_cls);
+
+  purity::AnalysisCache cache;
+  auto override_graph = cache.get_method_override_graph(scope);
+  EXPECT_EQ(override_graph, cache.get_method_override_graph(scope));
+  EXPECT_EQ(1, cache.hits());
+
+  std::unordered_set<DexMethodRef*> pure_methods;
+  std::unordered_set<const DexMethod*> expected;
+  compute_no_side_effects_methods(scope, override_graph.get(), pure_methods,
+                                  &expected);
+  EXPECT_FALSE(expected.empty());
+
+  size_t iterations = 0;
+  EXPECT_EQ(expected,
+            cache.get_no_side_effects_methods(scope, override_graph.get(),
+                                              pure_methods, &iterations));
+  EXPECT_EQ(1, cache.hits());
+  EXPECT_EQ(expected,
+            cache.get_no_side_effects_methods(scope, override_graph.get(),
+                                              pure_methods, &iterations));
+  EXPECT_EQ(2, cache.hits());
+
+  // A different set of pure methods is a different entry.
+  pure_methods.insert(DexMethod::get_method("LA;.m:()V"));
+  cache.get_no_side_effects_methods(scope, override_graph.get(), pure_methods,
+                                    &iterations);
+  EXPECT_EQ(2, cache.hits());
+}
+
+TEST_F(LocalDceEnhanceTest, PureMethodIdsTest) {
+  Scope scope = create_empty_scope();
+  auto void_t = type::_void();
+  auto void_void =
+      DexProto::make_proto(void_t, DexTypeList::make_type_list({}));
+
+  DexType* a_type = DexType::make_type("LA;");
+  DexClass* a_cls = create_internal_class(a_type, type::java_lang_Object(), {});
+  create_empty_method(a_cls, "pure", void_void, ACC_PUBLIC | ACC_STATIC);
+  scope.push_back(a_cls);
+
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (invoke-static () "LA;.pure:()V")
+      (invoke-static () "LA;.other:()V")
+      (return-void)
+    )
+  )");
+
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+      (invoke-static () "LA;.other:()V")
+      (return-void)
+    )
+  )");
+  std::unordered_set<DexMethodRef*> pure_methods{
+      DexMethod::get_method("LA;.pure:()V")};
+  auto pure_method_ids = LocalDce::make_pure_method_ids(pure_methods);
+  // Method refs created after the bitmap are not pure.
+  DexMethod::make_method("LA;.later:()V");
+  LocalDce ldce(pure_methods, /* method_override_graph */ nullptr,
+                /* may_allocate_registers */ false, &pure_method_ids);
+  IRCode* ircode = code.get();
+  ldce.dce(ircode);
+  EXPECT_CODE_EQ(ircode, expected_code.get());
+}
@@ -398,3 +398,38 @@ TEST_F(LocalPointersTest, returnEscapedValue) {
     EXPECT_TRUE(exit_env.may_have_escaped(invoke_insn));
   }
 }
+
+TEST_F(LocalPointersTest, summaryCache) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (new-instance "LFoo;")
+     (move-result-pseudo-object v0)
+     (invoke-direct (v0) "LFoo;.<init>:()V")
+     (return-object v0)
+    )
+  )");
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+
+  auto invoke_to_summary_map = mark_all_invokes_as_non_escaping(*code);
+  auto key = ptrs::summary_cache_key(cfg, invoke_to_summary_map);
+  EXPECT_EQ(key, ptrs::summary_cache_key(cfg, invoke_to_summary_map));
+  // The key depends on the summaries of the callees.
+  EXPECT_NE(key, ptrs::summary_cache_key(cfg, ptrs::InvokeToSummaryMap()));
+  for (auto& pair : invoke_to_summary_map) {
+    pair.second.escaping_parameters.emplace(0);
+  }
+  auto escaping_key = ptrs::summary_cache_key(cfg, invoke_to_summary_map);
+  EXPECT_NE(key, escaping_key);
+
+  auto method = DexMethod::make_method("LFoo;.newInstance:()LFoo;");
+  ptrs::SummaryCache cache;
+  EXPECT_FALSE(cache.get(method, key));
+  cache.put(method, key, ptrs::EscapeSummary(ptrs::ParamSet::top(), {}));
+  auto summary = cache.get(method, key);
+  ASSERT_TRUE(summary);
+  EXPECT_EQ(summary->returned_parameters, ptrs::ParamSet::top());
+  EXPECT_FALSE(cache.get(method, escaping_key));
+  EXPECT_EQ(cache.hits(), 1);
+  EXPECT_EQ(cache.misses(), 2);
+}
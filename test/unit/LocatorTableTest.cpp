@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "DexOutput.h"
+#include "DexStore.h"
+#include "RedexTest.h"
+
+using facebook::LocatorTable;
+
+class LocatorTableTest : public RedexTest {
+ protected:
+  DexClass* make_class(const std::string& name) {
+    ClassCreator creator(DexType::make_type(name.c_str()));
+    creator.set_super(type::java_lang_Object());
+    return creator.create();
+  }
+};
+
+TEST_F(LocatorTableTest, findsEveryClass) {
+  DexStoresVector stores;
+  for (size_t strnr = 0; strnr < 2; ++strnr) {
+    DexStore store(strnr == 0 ? "classes" : "module");
+    for (size_t dexnr = 0; dexnr < 3; ++dexnr) {
+      DexClasses classes;
+      for (size_t clsnr = 0; clsnr < 100; ++clsnr) {
+        classes.push_back(make_class("Lcom/foo/S" + std::to_string(strnr) +
+                                     "D" + std::to_string(dexnr) + "C" +
+                                     std::to_string(clsnr) + ";"));
+      }
+      store.add_classes(std::move(classes));
+    }
+    stores.emplace_back(std::move(store));
+  }
+
+  auto table = make_locator_table(stores);
+  ASSERT_TRUE(LocatorTable::isValid(table.data(), table.size()));
+  EXPECT_FALSE(LocatorTable::isValid(table.data(), table.size() - 1));
+
+  for (uint32_t strnr = 0; strnr < stores.size(); ++strnr) {
+    const auto& dexen = stores[strnr].get_dexen();
+    for (uint32_t dexnr = 0; dexnr < dexen.size(); ++dexnr) {
+      for (uint32_t clsnr = 0; clsnr < dexen[dexnr].size(); ++clsnr) {
+        auto locator = LocatorTable::find(
+            table.data(), dexen[dexnr][clsnr]->get_name()->c_str());
+        EXPECT_EQ(locator.strnr, strnr);
+        // Dex numbers are biased by one, like in locator strings.
+        EXPECT_EQ(locator.dexnr, dexnr + 1);
+        EXPECT_EQ(locator.clsnr, clsnr);
+      }
+    }
+  }
+
+  auto missing = LocatorTable::find(table.data(), "Lcom/foo/Missing;");
+  EXPECT_EQ(missing.dexnr, 0);
+}
+
+TEST_F(LocatorTableTest, emptyStores) {
+  DexStoresVector stores;
+  auto table = make_locator_table(stores);
+  ASSERT_TRUE(LocatorTable::isValid(table.data(), table.size()));
+  EXPECT_EQ(LocatorTable::find(table.data(), "LFoo;").dexnr, 0);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "LoopInvariantCodeMotion.h"
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+namespace {
+
+DexMethod* create(const std::string& sig, const std::string& code_str) {
+  ClassCreator cc{DexType::make_type("LFoo;")};
+  cc.set_super(type::java_lang_Object());
+  cc.add_field(DexField::make_field("LFoo;.K:I")
+                   ->make_concrete(ACC_PUBLIC | ACC_STATIC | ACC_FINAL));
+  auto m = DexMethod::make_method("LFoo;.bar:" + sig)
+               ->make_concrete(ACC_PUBLIC | ACC_STATIC,
+                               assembler::ircode_from_string(code_str), false);
+  cc.add_method(m);
+  cc.create();
+  return m;
+}
+
+size_t count_opcode(const DexMethod* m, IROpcode op) {
+  size_t count = 0;
+  for (const auto& mie : InstructionIterable(m->get_code())) {
+    if (mie.insn->opcode() == op) {
+      count++;
+    }
+  }
+  return count;
+}
+
+licm::Stats run(DexMethod* m) {
+  return licm::hoist_invariants(licm::Config(), {}, m);
+}
+
+} // namespace
+
+class LoopInvariantCodeMotionTest : public RedexTest {};
+
+TEST_F(LoopInvariantCodeMotionTest, HoistsConstStringAndFinalSget) {
+  auto m = create("(I)I", R"(
+    (
+      (load-param v0)
+      (const v1 0)
+      (:loop)
+      (const-string "a")
+      (move-result-pseudo-object v2)
+      (sget "LFoo;.K:I")
+      (move-result-pseudo v3)
+      (add-int v1 v1 v3)
+      (invoke-static (v2) "LBaz;.use:(Ljava/lang/String;)V")
+      (if-lt v1 v0 :loop)
+      (return v1)
+    )
+  )");
+  auto stats = run(m);
+  EXPECT_EQ(stats.loops, 1);
+  EXPECT_EQ(stats.hoisted_insns, 2);
+  EXPECT_EQ(stats.methods_changed, 1);
+  EXPECT_EQ(count_opcode(m, OPCODE_CONST_STRING), 1);
+  EXPECT_EQ(count_opcode(m, OPCODE_SGET), 1);
+  EXPECT_EQ(count_opcode(m, OPCODE_ADD_INT), 1);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, HoistsArrayLengthFromHeaderOnly) {
+  // The second array-length would throw after the first call.
+  auto m = create("([II)V", R"(
+    (
+      (load-param-object v0)
+      (load-param v1)
+      (:loop)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (invoke-static (v2) "LBaz;.use:(I)V")
+      (array-length v0)
+      (move-result-pseudo v3)
+      (invoke-static (v3) "LBaz;.use:(I)V")
+      (add-int/lit8 v1 v1 -1)
+      (if-nez v1 :loop)
+      (return-void)
+    )
+  )");
+  auto stats = run(m);
+  EXPECT_EQ(stats.hoisted_insns, 1);
+  EXPECT_EQ(count_opcode(m, OPCODE_ARRAY_LENGTH), 2);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, KeepsArrayLengthOfModifiedArray) {
+  auto m = create("([I)[I", R"(
+    (
+      (load-param-object v0)
+      (:loop)
+      (array-length v0)
+      (move-result-pseudo v1)
+      (invoke-static (v0) "LBaz;.next:([I)[I")
+      (move-result-object v0)
+      (if-nez v1 :loop)
+      (return-object v0)
+    )
+  )");
+  auto stats = run(m);
+  EXPECT_EQ(stats.loops, 1);
+  EXPECT_EQ(stats.hoisted_insns, 0);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, KeepsConstOverwritingLiveValue) {
+  // The first iteration reads the value of v1 from before the loop.
+  auto m = create("(I)V", R"(
+    (
+      (load-param v0)
+      (const v1 0)
+      (:loop)
+      (invoke-static (v1) "LBaz;.use:(I)V")
+      (const v1 5)
+      (add-int/lit8 v0 v0 -1)
+      (if-nez v0 :loop)
+      (return-void)
+    )
+  )");
+  auto stats = run(m);
+  EXPECT_EQ(stats.hoisted_insns, 0);
+}
+
+TEST_F(LoopInvariantCodeMotionTest, LeavesLoopWithoutInvariantsAlone) {
+  const auto* code_str = R"(
+    (
+      (load-param v0)
+      (:loop)
+      (invoke-static (v0) "LBaz;.use:(I)V")
+      (add-int/lit8 v0 v0 -1)
+      (if-nez v0 :loop)
+      (return-void)
+    )
+  )";
+  auto m = create("(I)V", code_str);
+  auto stats = run(m);
+  EXPECT_EQ(stats.loops, 1);
+  EXPECT_EQ(stats.hoisted_insns, 0);
+
+  // No preheader is left behind.
+  auto expected = assembler::ircode_from_string(code_str);
+  expected->build_cfg();
+  expected->clear_cfg();
+  EXPECT_CODE_EQ(m->get_code(), expected.get());
+}
+
+TEST_F(LoopInvariantCodeMotionTest, SkipsColdLoop) {
+  auto m = create("(I)V", R"(
+    (
+      (load-param v0)
+      (.src_block "LFoo;.bar:(I)V" 0 (1.0))
+      (:loop)
+      (.src_block "LFoo;.bar:(I)V" 1 (0.0))
+      (const-string "a")
+      (move-result-pseudo-object v1)
+      (invoke-static (v1) "LBaz;.use:(Ljava/lang/String;)V")
+      (add-int/lit8 v0 v0 -1)
+      (if-nez v0 :loop)
+      (return-void)
+    )
+  )");
+  auto stats = run(m);
+  EXPECT_EQ(stats.loops, 1);
+  EXPECT_EQ(stats.cold_loops, 1);
+  EXPECT_EQ(stats.hoisted_insns, 0);
+}
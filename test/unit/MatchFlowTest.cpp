@@ -936,5 +936,30 @@ TEST_F(MatchFlowTest, InstructionGraphTransitiveFailure) {
   EXPECT_EQ(locs.at(2), nullptr);
 }
 
+TEST_F(MatchFlowTest, InstructionGraphNoRootMatch) {
+  auto code = assembler::ircode_from_string(R"((
+    (const v0 0)
+    (const v1 1)
+    (sub-int v0 v1 v0)
+  ))");
+
+  cfg::ScopedCFG cfg{code.get()};
+
+  using namespace detail;
+  std::vector<Constraint> constraints;
+
+  constraints.emplace_back(insn_matcher(m::add_int_()));
+  constraints[0].add_src(0, 1, AliasFlag::dest, QuantFlag::exists);
+
+  constraints.emplace_back(insn_matcher(m::const_()));
+
+  // Without an add-int, the constraints aren't even analyzed.
+  auto graph = instruction_graph(*cfg, constraints, {0});
+  EXPECT_EQ(graph.size(), 0);
+  EXPECT_EQ(cfg->exit_block(), nullptr);
+
+  EXPECT_TRUE(graph.locations({0}).empty());
+}
+
 } // namespace
 } // namespace mf
@@ -15,6 +15,7 @@
 #include "IRCode.h"
 #include "Inliner.h"
 #include "InlinerConfig.h"
+#include "MethodProfiles.h"
 #include "RedexTest.h"
 
 struct MethodInlineTest : public RedexTest {
@@ -1277,3 +1278,69 @@ TEST_F(MethodInlineTest, visibility_change_static_invoke) {
       assembler::ircode_from_string(nested_callee_expected_str);
   EXPECT_CODE_EQ(nested_callee_actual, nested_callee_expected.get());
 }
+
+TEST_F(MethodInlineTest, profile_guided_budget) {
+  ConcurrentMethodRefCache concurrent_resolve_cache;
+  auto concurrent_resolver = [&concurrent_resolve_cache](DexMethodRef* method,
+                                                         MethodSearch search) {
+    return resolve_method(method, search, concurrent_resolve_cache);
+  };
+
+  DexStoresVector stores;
+  auto foo_cls = create_a_class("Lfoo;");
+  {
+    DexStore store("root");
+    store.add_classes({foo_cls});
+    stores.push_back(std::move(store));
+  }
+  // Too large to be inlined into more than one caller by the cost model.
+  auto callee = assembler::method_from_string(R"(
+    (method (public static) "Lfoo;.callee:()V"
+      (
+        (const v0 0)
+        (const v1 1)
+        (const v2 2)
+        (const v3 3)
+        (const v4 4)
+        (const v5 5)
+        (const v6 6)
+        (const v7 7)
+        (const v8 8)
+        (const v9 9)
+        (return-void)
+      )
+    )
+  )");
+  foo_cls->add_method(callee);
+  auto hot_caller = make_a_method_calls_others(foo_cls, "hot", {callee});
+  auto cold_caller = make_a_method_calls_others(foo_cls, "cold", {callee});
+  std::unordered_set<DexMethod*> candidates{callee};
+
+  auto scope = build_class_scope(stores);
+  api::LevelChecker::init(0, scope);
+
+  auto method_profiles = method_profiles::MethodProfiles::initialize(
+      method_profiles::COLD_START,
+      {{hot_caller, {100.0, 1000.0, 0.0, 0}},
+       {callee, {100.0, 2000.0, 0.0, 0}},
+       {cold_caller, {10.0, 1.0, 0.0, 0}}});
+
+  inliner::InlinerConfig inliner_config;
+  inliner_config.populate(scope);
+  MultiMethodInliner inliner(scope, stores, candidates, concurrent_resolver,
+                             inliner_config, InterDex);
+  inliner.allocate_profile_guided_budget(method_profiles,
+                                         /* budget */ 100);
+  inliner.inline_methods();
+
+  EXPECT_EQ(inliner.get_info().hot_calls, 1);
+  auto invokes = [](DexMethod* method) {
+    size_t count{0};
+    for (auto& mie : InstructionIterable(method->get_code())) {
+      count += opcode::is_an_invoke(mie.insn->opcode());
+    }
+    return count;
+  };
+  EXPECT_EQ(invokes(hot_caller), 0);
+  EXPECT_EQ(invokes(cold_caller), 1);
+}
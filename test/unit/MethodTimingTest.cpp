@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodTiming.h"
+
+#include <chrono>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class MethodTimingTest : public RedexTest {};
+
+TEST_F(MethodTimingTest, keeps_the_slowest_methods) {
+  auto fast = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.fast:()V"
+      (
+        (return-void)
+      )
+    )
+  )");
+  auto slow = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.slow:()V"
+      (
+        (const v0 0)
+        (return-void)
+      )
+    )
+  )");
+  auto slowest = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.slowest:()V"
+      (
+        (return-void)
+      )
+    )
+  )");
+  auto sleep_ms = [](int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  };
+
+  {
+    method_timing::Recording recording(2);
+    EXPECT_TRUE(method_timing::is_enabled());
+    method_timing::run(slow, [&] { sleep_ms(20); });
+    method_timing::run(fast, [] {});
+    method_timing::run(slowest, [&] { sleep_ms(40); });
+
+    auto samples = recording.get_slowest();
+    ASSERT_EQ(samples.size(), 2);
+    EXPECT_EQ(samples[0].method, slowest);
+    EXPECT_EQ(samples[1].method, slow);
+    EXPECT_GE(samples[1].seconds, 0.02);
+    EXPECT_EQ(samples[1].code_size, slow->get_code()->sum_opcode_sizes());
+  }
+  EXPECT_FALSE(method_timing::is_enabled());
+
+  // Nothing gets recorded without a top-N.
+  method_timing::Recording recording(0);
+  EXPECT_FALSE(method_timing::is_enabled());
+  method_timing::run(slow, [&] { sleep_ms(1); });
+  EXPECT_TRUE(recording.get_slowest().empty());
+}
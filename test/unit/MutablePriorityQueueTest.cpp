@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <map>
+#include <random>
+#include <unordered_map>
+
+#include "Debug.h"
+#include "MutablePriorityQueue.h"
+
+namespace {
+
+// Checks the queue against a sorted map, drained in order of priority.
+void expect_drains_like(MutablePriorityQueue<uint32_t, uint64_t>& queue,
+                        std::map<uint64_t, uint32_t> expected) {
+  while (!expected.empty()) {
+    ASSERT_FALSE(queue.empty());
+    EXPECT_EQ(queue.size(), expected.size());
+    auto it = std::prev(expected.end());
+    EXPECT_EQ(queue.front(), it->second);
+    queue.erase(it->second);
+    expected.erase(it);
+  }
+  EXPECT_TRUE(queue.empty());
+}
+
+} // namespace
+
+TEST(MutablePriorityQueueTest, basic) {
+  MutablePriorityQueue<uint32_t, uint64_t> queue;
+  EXPECT_TRUE(queue.empty());
+  queue.insert(1, 10);
+  queue.insert(2, 30);
+  queue.insert(3, 20);
+  EXPECT_EQ(queue.front(), 2u);
+  queue.update_priority(1, 40);
+  EXPECT_EQ(queue.front(), 1u);
+  queue.erase(1);
+  EXPECT_EQ(queue.front(), 2u);
+  queue.clear();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(MutablePriorityQueueTest, randomUpdates) {
+  std::mt19937 gen(0);
+  MutablePriorityQueue<uint32_t, uint64_t> queue;
+  std::map<uint64_t, uint32_t> expected;
+  std::unordered_map<uint32_t, uint64_t> priorities;
+  // Unique priorities: the low bits are the value.
+  auto make_priority = [&](uint32_t value) {
+    return (uint64_t(gen() % 1000) << 32) | value;
+  };
+  const uint32_t size = 1000;
+  for (uint32_t value = 0; value < size; ++value) {
+    auto priority = make_priority(value);
+    queue.insert(value, priority);
+    expected.emplace(priority, value);
+    priorities.emplace(value, priority);
+  }
+  // Small batches are applied one by one, large ones with a single heapify.
+  for (uint32_t batch_size : {1u, 10u, 100u, 500u, size}) {
+    std::vector<std::pair<uint32_t, uint64_t>> updates;
+    for (uint32_t value = 0; value < batch_size; ++value) {
+      auto priority = make_priority(value);
+      expected.erase(priorities.at(value));
+      expected.emplace(priority, value);
+      priorities[value] = priority;
+      updates.emplace_back(value, priority);
+    }
+    queue.update_priorities(updates);
+    EXPECT_EQ(queue.front(), std::prev(expected.end())->second);
+  }
+  expect_drains_like(queue, expected);
+}
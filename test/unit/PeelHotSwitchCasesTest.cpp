@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+#include "PeelHotSwitchCases.h"
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+#include "ScopedCFG.h"
+#include "SourceBlocks.h"
+
+namespace {
+
+constexpr const char* kMethod = "LFoo;.bar:(I)I";
+
+// A method that switches over `keys`, with the given hotness for the switch
+// block and for each case, or without source blocks if `hits` is empty.
+DexMethod* create(const std::vector<int32_t>& keys,
+                  float switch_hits,
+                  const std::vector<float>& hits) {
+  auto src_block = [&](size_t id, float val) {
+    if (hits.empty()) {
+      return std::string();
+    }
+    return "(.src_block \"" + std::string(kMethod) + "\" " +
+           std::to_string(id) + " (" + std::to_string(val) + "))";
+  };
+  std::string labels;
+  std::string cases;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto label = ":L" + std::to_string(i);
+    labels += " " + label;
+    cases += "(" + label + " " + std::to_string(keys[i]) + ")" +
+             src_block(i + 2, hits.empty() ? 0 : hits[i]) + "(const v1 " +
+             std::to_string(i) + ")(return v1)";
+  }
+  auto body = "((load-param v0)" + src_block(0, switch_hits) +
+              "(invoke-static () \"LBaz;.effect:()V\")" + src_block(1, 1) +
+              "(switch v0 (" + labels + "))(const v1 -1)(return v1)" + cases +
+              ")";
+
+  ClassCreator cc{DexType::make_type("LFoo;")};
+  cc.set_super(type::java_lang_Object());
+  auto m = DexMethod::make_method(kMethod)->make_concrete(
+      ACC_PUBLIC | ACC_STATIC, assembler::ircode_from_string(body), false);
+  cc.add_method(m);
+  cc.create();
+  return m;
+}
+
+size_t count_opcode(const DexMethod* m, IROpcode op) {
+  size_t count = 0;
+  for (const auto& mie : InstructionIterable(m->get_code())) {
+    if (mie.insn->opcode() == op) {
+      count++;
+    }
+  }
+  return count;
+}
+
+std::vector<int32_t> sparse_keys(size_t n) {
+  std::vector<int32_t> keys;
+  for (size_t i = 0; i < n; ++i) {
+    keys.push_back((int32_t)(i * 1000 + 1));
+  }
+  return keys;
+}
+
+} // namespace
+
+class PeelHotSwitchCasesTest : public RedexTest {};
+
+TEST_F(PeelHotSwitchCasesTest, PeelsDominantCaseOfSparseSwitch) {
+  std::vector<float> hits(16, 0.01f);
+  hits[9] = 0.8f;
+  auto m = create(sparse_keys(16), 1, hits);
+  auto stats = switch_peeling::peel_hot_cases(switch_peeling::Config(), m);
+  EXPECT_EQ(stats.switches, 1);
+  EXPECT_EQ(stats.switches_peeled, 1);
+  EXPECT_EQ(stats.peeled_cases, 1);
+  EXPECT_EQ(count_opcode(m, OPCODE_IF_EQ), 1);
+  EXPECT_EQ(count_opcode(m, OPCODE_SWITCH), 1);
+}
+
+TEST_F(PeelHotSwitchCasesTest, PeelsTwoDominantCases) {
+  std::vector<float> hits(16, 0.01f);
+  hits[3] = 0.45f;
+  hits[12] = 0.45f;
+  auto m = create(sparse_keys(16), 1, hits);
+  auto stats = switch_peeling::peel_hot_cases(switch_peeling::Config(), m);
+  EXPECT_EQ(stats.peeled_cases, 2);
+  EXPECT_EQ(count_opcode(m, OPCODE_IF_EQ), 2);
+
+  // Each compare, and the switch, are profiled by the part of the executions
+  // that reach them.
+  cfg::ScopedCFG cfg(m->get_code());
+  std::vector<float> vals;
+  for (auto* block : cfg->blocks()) {
+    auto last = block->get_last_insn();
+    if (last == block->end() || (last->insn->opcode() != OPCODE_IF_EQ &&
+                                 last->insn->opcode() != OPCODE_SWITCH)) {
+      continue;
+    }
+    const auto* sb = source_blocks::get_first_source_block(block);
+    ASSERT_NE(sb, nullptr);
+    vals.push_back(*sb->get_val(0));
+  }
+  std::sort(vals.begin(), vals.end());
+  ASSERT_EQ(vals.size(), 3);
+  EXPECT_NEAR(vals[0], 0.1, 1e-4);
+  EXPECT_NEAR(vals[1], 0.55, 1e-4);
+  EXPECT_NEAR(vals[2], 1, 1e-4);
+}
+
+TEST_F(PeelHotSwitchCasesTest, KeepsPackedSwitch) {
+  // A packed switch costs about as much as a single compare.
+  std::vector<int32_t> keys;
+  for (int32_t i = 1; i <= 16; ++i) {
+    keys.push_back(i);
+  }
+  std::vector<float> hits(16, 0.01f);
+  hits[9] = 0.8f;
+  auto m = create(keys, 1, hits);
+  auto stats = switch_peeling::peel_hot_cases(switch_peeling::Config(), m);
+  EXPECT_EQ(stats.switches_peeled, 0);
+  EXPECT_EQ(count_opcode(m, OPCODE_IF_EQ), 0);
+}
+
+TEST_F(PeelHotSwitchCasesTest, KeepsFlatProfile) {
+  std::vector<float> hits(16, 1.0f / 16);
+  auto m = create(sparse_keys(16), 1, hits);
+  auto stats = switch_peeling::peel_hot_cases(switch_peeling::Config(), m);
+  EXPECT_EQ(stats.switches_with_profile, 1);
+  EXPECT_EQ(stats.switches_peeled, 0);
+}
+
+TEST_F(PeelHotSwitchCasesTest, KeepsSwitchWithoutProfile) {
+  auto m = create(sparse_keys(16), 1, {});
+  auto stats = switch_peeling::peel_hot_cases(switch_peeling::Config(), m);
+  EXPECT_EQ(stats.switches, 1);
+  EXPECT_EQ(stats.switches_with_profile, 0);
+  EXPECT_EQ(stats.switches_peeled, 0);
+}
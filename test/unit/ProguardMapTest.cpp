@@ -89,6 +89,43 @@ TEST_F(ProguardMapTest, HandlesGeneratedComments) {
   EXPECT_EQ("LA;.a:I", pm.translate_field("Lcom/foo/bar;.do1:I"));
 }
 
+TEST_F(ProguardMapTest, LargeMap) {
+  // Large enough to be parsed in several parts. The classes refer to classes
+  // defined further down, and the last field repeats its key.
+  const size_t kNumClasses = 20000;
+  std::ostringstream os;
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    size_t next = (i + 1) % kNumClasses;
+    os << "com.foo.C" << i << " -> X" << i << ":\n"
+       << "    com.foo.C" << next << " f -> a\n"
+       << "    1:2:void m(com.foo.C" << next << ") -> b\n";
+  }
+  os << "    com.foo.C0 f -> c\n";
+  std::stringstream ss(os.str());
+  ProguardMap pm(ss);
+  for (size_t i : {size_t(0), size_t(1), kNumClasses / 2, kNumClasses - 1}) {
+    auto cls = "Lcom/foo/C" + std::to_string(i) + ";";
+    auto obf = "LX" + std::to_string(i) + ";";
+    auto next = std::to_string((i + 1) % kNumClasses);
+    auto obf_next = "LX" + next + ";";
+    EXPECT_EQ(obf, pm.translate_class(cls));
+    EXPECT_EQ(cls, pm.deobfuscate_class(obf));
+    EXPECT_EQ(obf + ".b:(" + obf_next + ")V",
+              pm.translate_method(cls + ".m:(Lcom/foo/C" + next + ";)V"));
+    EXPECT_EQ(cls + ".m:(Lcom/foo/C" + next + ";)V",
+              pm.deobfuscate_method(obf + ".b:(" + obf_next + ")V"));
+    if (i != kNumClasses - 1) {
+      EXPECT_EQ(obf + ".a:" + obf_next,
+                pm.translate_field(cls + ".f:Lcom/foo/C" + next + ";"));
+    }
+  }
+  auto last = std::to_string(kNumClasses - 1);
+  EXPECT_EQ("LX" + last + ";.c:LX0;",
+            pm.translate_field("Lcom/foo/C" + last + ";.f:Lcom/foo/C0;"));
+  EXPECT_EQ("Lcom/foo/C" + last + ";.f:Lcom/foo/C0;",
+            pm.deobfuscate_field("LX" + last + ";.a:LX0;"));
+}
+
 TEST_F(ProguardMapTest, LineNumbers) {
   std::stringstream ss(
       "com.foo.bar -> A:\n"
@@ -7,11 +7,13 @@
 
 #include <gtest/gtest.h>
 
+#include <fstream>
 #include <istream>
 #include <vector>
 
 #include "ProguardConfiguration.h"
 #include "ProguardParser.h"
+#include "RedexTestUtils.h"
 
 using namespace keep_rules;
 
@@ -886,3 +888,33 @@ TEST(ProguardParserTest, assumenosideeffects_with_field_value) {
               keep_rules::AssumeReturnValue::ValueNone);
   }
 }
+
+TEST(ProguardParserTest, includes) {
+  auto tmp_dir = redex::make_tmp_dir("ProguardParserTest%%%%%%%%");
+  auto write_file = [&](const std::string& name, const std::string& contents) {
+    auto path = tmp_dir.path + "/" + name;
+    std::ofstream out(path);
+    out << contents;
+    return path;
+  };
+  auto c = write_file("c.pro", "-keep class C\n-dontshrink\n");
+  auto a = write_file("a.pro", "-keep class A\n-include " + c + "\n");
+  // The same contents as a.pro, under another name.
+  auto a_copy = write_file("a_copy.pro", "-keep class A\n-include " + c + "\n");
+  auto b = write_file("b.pro", "-keep class B\n-include " + a + "\n");
+  auto root = write_file("root.pro",
+                         "-include " + a + "\n-include " + b + "\n-include " +
+                             a_copy + "\n-keep class Root\n");
+
+  ProguardConfiguration config;
+  proguard_parser::parse_file(root, &config);
+  ASSERT_TRUE(config.ok);
+  EXPECT_FALSE(config.shrink);
+  std::vector<std::string> class_names;
+  for (const auto* keep : config.keep_rules) {
+    class_names.push_back(keep->class_spec.className);
+  }
+  // Depth-first, as if each file were parsed where it is included.
+  EXPECT_EQ(class_names,
+            std::vector<std::string>({"Root", "A", "C", "B"}));
+}
@@ -270,3 +270,24 @@ TEST(ProguardRegexTest, types) {
     EXPECT_EQ("Lalpha/**/beta;", descriptor);
   }
 }
+
+TEST(ProguardRegexTest, type_regex_literal_prefix) {
+  auto prefix = [](const std::string& proguard_regex) {
+    return proguard_parser::type_regex_literal_prefix(
+        proguard_parser::convert_wildcard_type(proguard_regex));
+  };
+  EXPECT_EQ("Lcom/facebook/redex/Delta;", prefix("com.facebook.redex.Delta"));
+  EXPECT_EQ("Lcom/facebook/", prefix("com.facebook.*.Delta"));
+  EXPECT_EQ("Lcom/facebook/", prefix("com.facebook.**"));
+  EXPECT_EQ("Lcom/facebook/Delta", prefix("com.facebook.Delta?"));
+  EXPECT_EQ("Lcom/facebook/Delta$", prefix("com.facebook.Delta$*"));
+  EXPECT_EQ("L", prefix("**"));
+  EXPECT_EQ("", prefix("!com.facebook.**"));
+  EXPECT_EQ("", prefix("com.facebook.A,com.facebook.B"));
+
+  // Every name the regex matches starts with the prefix.
+  auto descriptor = proguard_parser::convert_wildcard_type("alpha.*.beta*");
+  boost::regex matcher(proguard_parser::form_type_regex(descriptor));
+  EXPECT_EQ("Lalpha/", proguard_parser::type_regex_literal_prefix(descriptor));
+  EXPECT_TRUE(boost::regex_match("Lalpha/gamma/betas;", matcher));
+}
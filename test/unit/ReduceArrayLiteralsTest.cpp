@@ -8,6 +8,7 @@
 #include <gtest/gtest.h>
 
 #include "ControlFlow.h"
+#include "DexInstruction.h"
 #include "IRAssembler.h"
 #include "IRCode.h"
 #include "RedexTest.h"
@@ -26,7 +27,8 @@ void test(const std::string& code_str,
   auto expected = assembler::ircode_from_string(expected_str);
 
   code->build_cfg(/* editable */ true);
-  ReduceArrayLiterals ral(code->cfg(), max_filled_elements, min_sdk, arch);
+  ReduceArrayLiterals ral(code->cfg(), max_filled_elements,
+                          /* min_fill_array_data_elements */ 8, min_sdk, arch);
   ral.patch();
   code->clear_cfg();
   auto stats = ral.get_stats();
@@ -344,3 +346,113 @@ TEST_F(ReduceArrayLiteralsTest, conditional_escape) {
   const auto& expected_str = code_str;
   test(code_str, expected_str, 0, 0);
 }
+
+// Returns the payload of the only fill-array-data instruction, after checking
+// that no aput instructions remain.
+const DexOpcodeData* fill_array_data(const std::string& code_str,
+                                     size_t expected_filled_arrays,
+                                     size_t expected_filled_array_elements) {
+  auto code = assembler::ircode_from_string(code_str);
+  code->build_cfg(/* editable */ true);
+  ReduceArrayLiterals ral(code->cfg(), /* max_filled_elements */ 222,
+                          /* min_fill_array_data_elements */ 3,
+                          /* min_sdk */ 21, Architecture::UNKNOWN);
+  ral.patch();
+  code->clear_cfg();
+  auto stats = ral.get_stats();
+  EXPECT_EQ(expected_filled_arrays, stats.filled_array_data_arrays);
+  EXPECT_EQ(expected_filled_array_elements, stats.filled_array_data_elements);
+
+  const DexOpcodeData* data = nullptr;
+  for (auto& mie : InstructionIterable(code.get())) {
+    auto* insn = mie.insn;
+    EXPECT_FALSE(expected_filled_arrays && opcode::is_an_aput(insn->opcode()));
+    if (insn->opcode() == OPCODE_FILL_ARRAY_DATA) {
+      EXPECT_EQ(data, nullptr);
+      EXPECT_EQ(insn->src(0), 1u);
+      data = insn->get_data();
+    }
+  }
+  return data;
+}
+
+TEST_F(ReduceArrayLiteralsTest, wide_array_fill_array_data) {
+  // the stores may be interleaved with unrelated instructions
+  auto code_str = R"(
+    (
+      (const v0 3)
+      (new-array v0 "[J")
+      (move-result-pseudo-object v1)
+      (const v0 0)
+      (const-wide v2 1)
+      (aput-wide v2 v1 v0)
+      (const-string "hello")
+      (move-result-pseudo-object v4)
+      (const v0 1)
+      (const-wide v2 -2)
+      (aput-wide v2 v1 v0)
+      (const v0 2)
+      (const-wide v2 4294967296)
+      (move-wide v6 v2)
+      (aput-wide v6 v1 v0)
+      (return-object v1)
+    )
+  )";
+  auto data = fill_array_data(code_str, 1, 3);
+  ASSERT_NE(data, nullptr);
+  // element width, then the 32-bit element count, then the elements
+  ASSERT_EQ(data->data_size(), 3u + 3 * 4);
+  EXPECT_EQ(data->data()[0], 8);
+  EXPECT_EQ(*(const uint32_t*)(data->data() + 1), 3u);
+  auto elements = (const int64_t*)(data->data() + 3);
+  EXPECT_EQ(elements[0], 1);
+  EXPECT_EQ(elements[1], -2);
+  EXPECT_EQ(elements[2], 4294967296);
+}
+
+TEST_F(ReduceArrayLiteralsTest, byte_array_fill_array_data) {
+  auto code_str = R"(
+    (
+      (const v0 3)
+      (new-array v0 "[B")
+      (move-result-pseudo-object v1)
+      (const v0 0)
+      (const v2 -1)
+      (aput-byte v2 v1 v0)
+      (const v0 1)
+      (aput-byte v2 v1 v0)
+      (const v0 2)
+      (const v2 127)
+      (aput-byte v2 v1 v0)
+      (return-object v1)
+    )
+  )";
+  auto data = fill_array_data(code_str, 1, 3);
+  ASSERT_NE(data, nullptr);
+  ASSERT_EQ(data->data_size(), 3u + 2);
+  EXPECT_EQ(data->data()[0], 1);
+  auto elements = (const int8_t*)(data->data() + 3);
+  EXPECT_EQ(elements[0], -1);
+  EXPECT_EQ(elements[1], -1);
+  EXPECT_EQ(elements[2], 127);
+}
+
+TEST_F(ReduceArrayLiteralsTest, non_literal_element_no_fill_array_data) {
+  auto code_str = R"(
+    (
+      (load-param-wide v4)
+      (const v0 3)
+      (new-array v0 "[J")
+      (move-result-pseudo-object v1)
+      (const v0 0)
+      (const-wide v2 1)
+      (aput-wide v2 v1 v0)
+      (const v0 1)
+      (aput-wide v4 v1 v0)
+      (const v0 2)
+      (aput-wide v2 v1 v0)
+      (return-object v1)
+    )
+  )";
+  EXPECT_EQ(fill_array_data(code_str, 0, 0), nullptr);
+}
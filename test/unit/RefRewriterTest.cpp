@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "RefRewriter.h"
+
+#include "Creators.h"
+#include "DexAnnotation.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+struct RefRewriterTest : public RedexTest {
+  DexType* m_old_type{DexType::make_type("LOld;")};
+  DexType* m_new_type{DexType::make_type("LNew;")};
+
+  DexClass* make_class(DexType* type) {
+    ClassCreator creator(type);
+    creator.set_super(type::java_lang_Object());
+    return creator.create();
+  }
+};
+
+TEST_F(RefRewriterTest, rewritesCodeAndAnnotations) {
+  auto* old_cls = make_class(m_old_type);
+  auto* new_cls = make_class(m_new_type);
+  auto* user_cls = make_class(DexType::make_type("LUser;"));
+  auto* method = assembler::method_from_string(R"(
+    (method (public static) "LUser;.use:()V"
+      (
+        (const v0 1)
+        (new-array v0 "[[LOld;")
+        (move-result-pseudo-object v1)
+        (invoke-static () "LOld;.foo:()V")
+        (sget "LOld;.f:I")
+        (move-result-pseudo v2)
+        (check-cast v1 "LUnrelated;")
+        (move-result-pseudo-object v1)
+        (return-void)
+      )
+    )
+  )");
+  user_cls->add_method(method);
+  auto* anno = new DexAnnotation(DexType::make_type("LAnno;"), DAV_RUNTIME);
+  anno->add_element("value", new DexEncodedValueType(m_old_type));
+  auto* anno_set = new DexAnnotationSet();
+  anno_set->add_annotation(anno);
+  user_cls->attach_annotation_set(anno_set);
+
+  ref_rewriter::RefMaps maps;
+  maps.types.emplace(m_old_type, m_new_type);
+  maps.methods.emplace(DexMethod::make_method("LOld;.foo:()V"),
+                       DexMethod::make_method("LNew;.foo:()V"));
+  maps.fields.emplace(DexField::make_field("LOld;.f:I"),
+                      DexField::make_field("LNew;.f:I"));
+  auto stats =
+      ref_rewriter::rewrite_refs(Scope{old_cls, new_cls, user_cls}, maps);
+  EXPECT_EQ(stats.insns, 3u);
+  EXPECT_EQ(stats.encoded_values, 1u);
+
+  auto expected = assembler::ircode_from_string(R"(
+    (
+      (const v0 1)
+      (new-array v0 "[[LNew;")
+      (move-result-pseudo-object v1)
+      (invoke-static () "LNew;.foo:()V")
+      (sget "LNew;.f:I")
+      (move-result-pseudo v2)
+      (check-cast v1 "LUnrelated;")
+      (move-result-pseudo-object v1)
+      (return-void)
+    )
+  )");
+  EXPECT_CODE_EQ(method->get_code(), expected.get());
+  auto* type_ev = static_cast<DexEncodedValueType*>(
+      anno->anno_elems().front().encoded_value);
+  EXPECT_EQ(type_ev->type(), m_new_type);
+}
+
+TEST_F(RefRewriterTest, hookSeesRewrittenInsns) {
+  auto* user_cls = make_class(DexType::make_type("LUser;"));
+  auto* method = assembler::method_from_string(R"(
+    (method (public static) "LUser;.use:()V"
+      (
+        (invoke-static () "LOld;.foo:()V")
+        (return-void)
+      )
+    )
+  )");
+  user_cls->add_method(method);
+
+  ref_rewriter::RefMaps maps;
+  maps.types.emplace(m_old_type, m_new_type);
+  std::vector<DexMethodRef*> seen;
+  ref_rewriter::Options options;
+  options.insn_hook = [&](DexMethod*, IRInstruction* insn) {
+    if (insn->has_method()) {
+      seen.push_back(insn->get_method());
+    }
+  };
+  auto stats = ref_rewriter::rewrite_refs(Scope{user_cls}, maps, options);
+  // Method refs are only rewritten through the methods map.
+  EXPECT_EQ(stats.insns, 0u);
+  EXPECT_EQ(seen,
+            std::vector<DexMethodRef*>{DexMethod::make_method(
+                "LOld;.foo:()V")});
+}
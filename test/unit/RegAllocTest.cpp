@@ -150,6 +150,49 @@ TEST_F(RegAllocTest, InterferenceWeights) {
   EXPECT_EQ(fp_div_ceil(2, 2), edge_weight_helper(2, 2));
 }
 
+TEST_F(RegAllocTest, PairSetRepresentations) {
+  using interference::impl::PairSet;
+  auto check = [](PairSet* set, bool bulk) {
+    if (bulk) {
+      set->begin_bulk();
+    }
+    for (reg_t i = 0; i < 100; ++i) {
+      if (set->in_bulk()) {
+        set->append(i + 1, i, false);
+        set->append(i, i + 1, i % 2 == 0);
+      } else {
+        set->insert(i + 1, i, false);
+        set->insert(i, i + 1, i % 2 == 0);
+      }
+    }
+    set->end_bulk();
+    for (reg_t i = 0; i < 100; ++i) {
+      EXPECT_TRUE(set->contains(i, i + 1));
+      EXPECT_TRUE(set->contains(i + 1, i));
+      EXPECT_FALSE(set->contains(i, i + 2));
+      EXPECT_EQ(set->get_flag(i + 1, i), i % 2 == 0);
+    }
+    size_t count = 0;
+    set->for_each([&count](reg_t, reg_t) { ++count; });
+    EXPECT_EQ(count, 100);
+    EXPECT_FALSE(set->insert(50, 51, true));
+    EXPECT_TRUE(set->insert(50, 52, false));
+  };
+
+  for (bool bulk : {false, true}) {
+    PairSet matrix(/* symmetric */ true);
+    matrix.set_size(200);
+    check(&matrix, bulk);
+
+    PairSet lists(/* symmetric */ true);
+    lists.set_size(PairSet::MAX_MATRIX_REGS + 1);
+    check(&lists, bulk);
+
+    PairSet unsized(/* symmetric */ true);
+    check(&unsized, bulk);
+  }
+}
+
 TEST_F(RegAllocTest, BuildInterferenceGraph) {
   auto code = assembler::ircode_from_string(R"(
     (
@@ -446,6 +489,47 @@ TEST_F(RegAllocTest, Simplify) {
   EXPECT_EQ(selected, std::vector<reg_t>({1, 0, 2}));
 }
 
+TEST_F(RegAllocTest, SimplifyPrefersSmallEncodings) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+     (const v0 100)
+     (const v1 1)
+     (move v2 v1)
+     (add-int v3 v0 v2)
+     (return v3)
+    )
+)");
+  code->set_registers_size(4);
+  code->build_cfg(/* editable */ false);
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+  LivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(LivenessDomain());
+
+  auto simplify = [&](bool prefer_small_encodings) {
+    RangeSet range_set;
+    auto ig = interference::build_graph(
+        fixpoint_iter, code.get(), code->get_registers_size(), range_set);
+    // The const/4 and the move get shorter with registers below 16; the
+    // const/16 and the add-int do not.
+    EXPECT_EQ(ig.get_node(0).encoding_benefit(), 0);
+    EXPECT_EQ(ig.get_node(1).encoding_benefit(), 2);
+    EXPECT_EQ(ig.get_node(2).encoding_benefit(), 1);
+    EXPECT_EQ(ig.get_node(3).encoding_benefit(), 0);
+
+    graph_coloring::Allocator::Config config;
+    config.prefer_small_encodings = prefer_small_encodings;
+    graph_coloring::Allocator allocator(config);
+    std::stack<reg_t> select_stack;
+    std::stack<reg_t> spilled_select_stack;
+    allocator.simplify(&ig, &select_stack, &spilled_select_stack);
+    return stack_to_vec(select_stack);
+  };
+  EXPECT_EQ(simplify(false), std::vector<reg_t>({3, 2, 1, 0}));
+  // The nodes that benefit most are selected first.
+  EXPECT_EQ(simplify(true), std::vector<reg_t>({1, 2, 3, 0}));
+}
+
 TEST_F(RegAllocTest, SelectRange) {
   auto code = assembler::ircode_from_string(R"(
     (
@@ -906,3 +990,140 @@ TEST_F(RegAllocTest, NoOverwriteThis) {
 )");
   EXPECT_CODE_EQ(expected_code.get(), method->get_code());
 }
+
+TEST_F(RegAllocTest, LinearScanNoOverlapWideSrcs) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()Z"
+     (
+      (const-wide v0 0)
+      (const-wide v2 0)
+      (cmp-long v1 v0 v2)
+      (return v1)
+     )
+    )
+)");
+  method->get_code()->set_registers_size(4);
+
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_threshold = 1;
+  auto stats = graph_coloring::allocate(config, method);
+  EXPECT_EQ(stats.linear_scan_methods, 1);
+
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+     (const-wide v0 0)
+     (const-wide v2 0)
+     (cmp-long v4 v0 v2)
+     (return v4)
+    )
+)");
+  EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+}
+
+TEST_F(RegAllocTest, LinearScanRangeRegion) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()V"
+     (
+      (const v0 1)
+      (const v1 2)
+      (const v2 3)
+      (const v3 4)
+      (const v4 5)
+      (const v5 6)
+      (invoke-static (v5 v4 v3 v2 v1 v0) "LFoo;.baz:(IIIIII)V")
+      (return-void)
+     )
+    )
+)");
+  method->get_code()->set_registers_size(6);
+
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_threshold = 1;
+  auto stats = graph_coloring::allocate(config, method);
+  EXPECT_EQ(stats.linear_scan_moves, 6);
+
+  // The srcs are neither contiguous nor few enough for the non-range form,
+  // so they get copied to the range region.
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+     (const v0 1)
+     (const v1 2)
+     (const v2 3)
+     (const v3 4)
+     (const v4 5)
+     (const v5 6)
+     (move v6 v5)
+     (move v7 v4)
+     (move v8 v3)
+     (move v9 v2)
+     (move v10 v1)
+     (move v11 v0)
+     (invoke-static (v6 v7 v8 v9 v10 v11) "LFoo;.baz:(IIIIII)V")
+     (return-void)
+    )
+)");
+  EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+  EXPECT_EQ(method->get_code()->get_registers_size(), 12);
+}
+
+TEST_F(RegAllocTest, LinearScanScratch) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()V"
+     (
+      (const v0 1)
+      (const v1 2)
+      (const v2 3)
+      (const v3 4)
+      (const v4 5)
+      (const v5 6)
+      (const v6 7)
+      (const v7 8)
+      (const v8 9)
+      (const v9 10)
+      (const v10 11)
+      (const v11 12)
+      (const v12 13)
+      (const v13 14)
+      (const v14 15)
+      (const v15 16)
+      (neg-int v16 v0)
+      (invoke-static (v0 v1 v2 v3 v4 v5 v6 v7 v8 v9 v10 v11 v12 v13 v14 v15 v16) "LFoo;.baz:(IIIIIIIIIIIIIIIII)V")
+      (return-void)
+     )
+    )
+)");
+  method->get_code()->set_registers_size(17);
+
+  graph_coloring::Allocator::Config config;
+  config.linear_scan_threshold = 1;
+  graph_coloring::allocate(config, method);
+
+  // neg-int can only address 4-bit registers, so its dest goes through a
+  // scratch register.
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+     (const v6 1)
+     (const v7 2)
+     (const v8 3)
+     (const v9 4)
+     (const v10 5)
+     (const v11 6)
+     (const v12 7)
+     (const v13 8)
+     (const v14 9)
+     (const v15 10)
+     (const v16 11)
+     (const v17 12)
+     (const v18 13)
+     (const v19 14)
+     (const v20 15)
+     (const v21 16)
+     (neg-int v4 v6)
+     (move v22 v4)
+     (invoke-static (v6 v7 v8 v9 v10 v11 v12 v13 v14 v15 v16 v17 v18 v19 v20 v21 v22) "LFoo;.baz:(IIIIIIIIIIIIIIIII)V")
+     (return-void)
+    )
+)");
+  EXPECT_CODE_EQ(expected_code.get(), method->get_code());
+  EXPECT_EQ(method->get_code()->get_registers_size(), 23);
+}
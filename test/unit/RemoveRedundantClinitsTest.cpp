@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "IRAssembler.h"
+#include "Purity.h"
+#include "RedexTest.h"
+#include "RemoveRedundantClinits.h"
+
+using namespace clinit_elimination;
+
+class RemoveRedundantClinitsTest : public RedexTest {
+ protected:
+  DexClass* create_class(const std::string& name,
+                         const std::vector<std::string>& fields,
+                         const std::string& clinit_body) {
+    ClassCreator cc(DexType::make_type(name.c_str()));
+    cc.set_super(type::java_lang_Object());
+    for (const auto& f : fields) {
+      auto field = static_cast<DexField*>(DexField::make_field(name + "." + f));
+      field->make_concrete(ACC_PUBLIC | ACC_STATIC);
+      cc.add_field(field);
+    }
+    if (!clinit_body.empty()) {
+      cc.add_method(assembler::method_from_string(
+          "(method (public static constructor) \"" + name +
+          ".<clinit>:()V\" " + clinit_body + ")"));
+    }
+    return cc.create();
+  }
+
+  std::unordered_set<DexMethodRef*> m_pure_methods{get_pure_methods()};
+};
+
+TEST_F(RemoveRedundantClinitsTest, unreadFieldsMakeClinitRedundant) {
+  auto cls = create_class("LFoo;", {"f:I", "g:[I"}, R"(
+    (
+      (const v0 -3)
+      (invoke-static (v0) "Ljava/lang/Math;.abs:(I)I")
+      (move-result v0)
+      (sput v0 "LFoo;.f:I")
+      (new-array v0 "[I")
+      (move-result-pseudo-object v1)
+      (const v2 0)
+      (aput v0 v1 v2)
+      (sput-object v1 "LFoo;.g:[I")
+      (return-void)
+    )
+  )");
+  Scope scope{cls};
+
+  ClinitSideEffectsAnalysis analysis(scope, m_pure_methods);
+  EXPECT_TRUE(analysis.is_side_effect_free(cls->get_type()));
+  EXPECT_TRUE(analysis.is_clinit_side_effect_free(cls));
+  EXPECT_EQ(analysis.get_written_fields(cls).size(), 2u);
+  EXPECT_EQ(find_redundant_clinits(scope, analysis),
+            std::vector<DexClass*>{cls});
+}
+
+TEST_F(RemoveRedundantClinitsTest, readFieldsKeepClinit) {
+  auto foo = create_class("LFoo;", {"f:I"}, R"(
+    (
+      (const v0 1)
+      (sput v0 "LFoo;.f:I")
+      (return-void)
+    )
+  )");
+  auto bar = create_class("LBar;", {}, "");
+  bar->add_method(assembler::method_from_string(R"(
+    (method (public static) "LBar;.get:()I"
+      (
+        (sget "LFoo;.f:I")
+        (move-result-pseudo v0)
+        (return v0)
+      )
+    )
+  )"));
+  Scope scope{foo, bar};
+
+  ClinitSideEffectsAnalysis analysis(scope, m_pure_methods);
+  EXPECT_TRUE(analysis.is_clinit_side_effect_free(foo));
+  EXPECT_TRUE(find_redundant_clinits(scope, analysis).empty());
+}
+
+TEST_F(RemoveRedundantClinitsTest, unknownCalleeHasSideEffects) {
+  auto cls = create_class("LFoo;", {"f:I"}, R"(
+    (
+      (invoke-static () "LUnknown;.compute:()I")
+      (move-result v0)
+      (sput v0 "LFoo;.f:I")
+      (return-void)
+    )
+  )");
+  Scope scope{cls};
+
+  ClinitSideEffectsAnalysis analysis(scope, m_pure_methods);
+  EXPECT_FALSE(analysis.is_side_effect_free(cls->get_type()));
+  EXPECT_FALSE(analysis.is_clinit_side_effect_free(cls));
+  EXPECT_TRUE(find_redundant_clinits(scope, analysis).empty());
+}
+
+TEST_F(RemoveRedundantClinitsTest, writesToOtherClassesHaveSideEffects) {
+  auto bar = create_class("LBar;", {"f:I"}, "");
+  auto foo = create_class("LFoo;", {}, R"(
+    (
+      (const v0 1)
+      (sput v0 "LBar;.f:I")
+      (return-void)
+    )
+  )");
+  Scope scope{bar, foo};
+
+  ClinitSideEffectsAnalysis analysis(scope, m_pure_methods);
+  EXPECT_TRUE(analysis.is_side_effect_free(bar->get_type()));
+  EXPECT_FALSE(analysis.is_clinit_side_effect_free(foo));
+}
+
+TEST_F(RemoveRedundantClinitsTest, sideEffectsOfInitializedClasses) {
+  auto bar = create_class("LBar;", {"f:I"}, R"(
+    (
+      (invoke-static () "LUnknown;.compute:()I")
+      (move-result v0)
+      (sput v0 "LBar;.f:I")
+      (return-void)
+    )
+  )");
+  auto baz = create_class("LBaz;", {"f:I"}, R"(
+    (
+      (sget "LFoo;.f:I")
+      (move-result-pseudo v0)
+      (sput v0 "LBaz;.f:I")
+      (return-void)
+    )
+  )");
+  // Foo and Baz initialize each other, which is fine as long as the cycle
+  // has no side effects.
+  auto foo = create_class("LFoo;", {"f:I", "g:I"}, R"(
+    (
+      (sget "LBaz;.f:I")
+      (move-result-pseudo v0)
+      (sput v0 "LFoo;.f:I")
+      (return-void)
+    )
+  )");
+  auto qux = create_class("LQux;", {"f:I"}, R"(
+    (
+      (sget "LBar;.f:I")
+      (move-result-pseudo v0)
+      (sput v0 "LQux;.f:I")
+      (return-void)
+    )
+  )");
+  Scope scope{bar, baz, foo, qux};
+
+  ClinitSideEffectsAnalysis analysis(scope, m_pure_methods);
+  EXPECT_FALSE(analysis.is_side_effect_free(bar->get_type()));
+  EXPECT_TRUE(analysis.is_side_effect_free(baz->get_type()));
+  EXPECT_TRUE(analysis.is_side_effect_free(foo->get_type()));
+  EXPECT_FALSE(analysis.is_side_effect_free(qux->get_type()));
+  EXPECT_FALSE(analysis.is_clinit_side_effect_free(qux));
+}
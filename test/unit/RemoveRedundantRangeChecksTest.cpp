@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include "RemoveRedundantRangeChecks.h"
+
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "RedexTest.h"
+
+namespace {
+
+size_t count_opcode(IRCode* code, IROpcode op) {
+  size_t count = 0;
+  for (const auto& mie : InstructionIterable(code)) {
+    if (mie.insn->opcode() == op) {
+      count++;
+    }
+  }
+  return count;
+}
+
+range_checks::Stats run(IRCode* code) {
+  code->build_cfg(/* editable */ true);
+  auto stats = range_checks::remove_redundant_range_checks(code->cfg());
+  code->clear_cfg();
+  return stats;
+}
+
+} // namespace
+
+class RemoveRedundantRangeChecksTest : public RedexTest {};
+
+TEST_F(RemoveRedundantRangeChecksTest, guardsInsideLoopOverArray) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param-object v0)
+      (const v1 0)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (:loop)
+      (if-ge v1 v2 :end)
+      (if-ltz v1 :next)
+      (add-int/lit8 v3 v2 -1)
+      (if-gt v1 v3 :next)
+      (aget v0 v1)
+      (move-result-pseudo v4)
+      (:next)
+      (add-int/lit8 v1 v1 1)
+      (goto :loop)
+      (:end)
+      (return-void)
+    )
+  )");
+  auto stats = run(code.get());
+
+  EXPECT_EQ(stats.branches_removed, 2u);
+  EXPECT_EQ(stats.array_accesses, 1u);
+  EXPECT_EQ(stats.array_accesses_in_bounds, 1u);
+  // The loop condition itself is still needed.
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GE), 1u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_LTZ), 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GT), 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_AGET), 1u);
+}
+
+TEST_F(RemoveRedundantRangeChecksTest, indexInBoundsAfterArrayAccess) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param-object v0)
+      (load-param v1)
+      (array-length v0)
+      (move-result-pseudo v2)
+      (aget v0 v1)
+      (move-result-pseudo v3)
+      (if-ge v1 v2 :out_of_bounds)
+      (if-gez v1 :done)
+      (:out_of_bounds)
+      (const v3 -1)
+      (:done)
+      (return v3)
+    )
+  )");
+  auto stats = run(code.get());
+
+  EXPECT_EQ(stats.branches_removed, 2u);
+  EXPECT_EQ(stats.array_accesses_in_bounds, 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GE), 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GEZ), 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_CONST), 0u);
+}
+
+TEST_F(RemoveRedundantRangeChecksTest, incrementMayOverflow) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (add-int/lit8 v1 v0 1)
+      (if-gt v1 v0 :greater)
+      (const v0 0)
+      (return v0)
+      (:greater)
+      (const v0 1)
+      (return v0)
+    )
+  )");
+  auto stats = run(code.get());
+
+  EXPECT_EQ(stats.branches_removed, 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GT), 1u);
+}
+
+TEST_F(RemoveRedundantRangeChecksTest, incrementWithinBounds) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (const v1 100)
+      (if-ge v0 v1 :done)
+      (add-int/lit8 v2 v0 1)
+      (if-gt v2 v1 :unreachable)
+      (return v2)
+      (:unreachable)
+      (const v2 -1)
+      (:done)
+      (return v0)
+    )
+  )");
+  auto stats = run(code.get());
+
+  EXPECT_EQ(stats.branches_removed, 1u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GT), 0u);
+  EXPECT_EQ(count_opcode(code.get(), OPCODE_IF_GE), 1u);
+}
@@ -245,3 +245,58 @@ TEST_F(RemoveUnusedArgsTest, multipleBlocksMixedArgs) {
   EXPECT_THAT(live_arg_idxs, ::testing::ElementsAre(0, 1, 2, 3));
   EXPECT_THAT(dead_insns.size(), 0);
 }
+
+// Checks that later iterations reuse the live args of unchanged methods
+TEST_F(RemoveUnusedArgsTest, liveArgsCacheKeepsUnchangedMethods) {
+  ClassCreator creator(DexType::make_type("LBar;"));
+  creator.set_super(type::java_lang_Object());
+  auto callee = assembler::method_from_string(R"(
+    (method (public static) "LBar;.callee:(I)V"
+      (
+        (load-param v0)
+        (return-void)
+      )
+    )
+  )");
+  auto caller = assembler::method_from_string(R"(
+    (method (public static) "LBar;.caller:(I)V"
+      (
+        (load-param v0)
+        (invoke-static (v0) "LBar;.callee:(I)V")
+        (return-void)
+      )
+    )
+  )");
+  auto unchanged = assembler::method_from_string(R"(
+    (method (public static) "LBar;.unchanged:(I)V"
+      (
+        (load-param v0)
+        (if-eqz v0 :end)
+        (:end)
+        (return-void)
+      )
+    )
+  )");
+  creator.add_method(callee);
+  creator.add_method(caller);
+  creator.add_method(unchanged);
+  Scope scope{creator.create()};
+
+  remove_unused_args::LiveArgsCache live_args_cache;
+  std::vector<std::pair<size_t, size_t>> updated_and_hits;
+  for (size_t iteration = 0; iteration < 3; iteration++) {
+    remove_unused_args::RemoveArgs rm_args(scope, m_blocklist, iteration,
+                                           &live_args_cache);
+    auto stats = rm_args.run();
+    updated_and_hits.emplace_back(stats.methods_updated_count,
+                                  stats.live_args_cache_hits);
+  }
+  // The caller only loses its arg once the callsite lost it, and the
+  // unchanged method is only analyzed in the first iteration.
+  EXPECT_THAT(updated_and_hits,
+              ::testing::ElementsAre(std::make_pair(1, 0),
+                                     std::make_pair(1, 1),
+                                     std::make_pair(0, 2)));
+  EXPECT_EQ(caller->get_proto()->get_args()->size(), 0u);
+  EXPECT_EQ(unchanged->get_proto()->get_args()->size(), 1u);
+}
@@ -408,3 +408,26 @@ TEST_F(ResolverTest, ResolveMethod) {
   EXPECT_TRUE(resolve_method(g_method, MethodSearch::InterfaceVirtual) ==
               e_method);
 }
+
+TEST_F(ResolverTest, ResolveMethodWithSharedCache) {
+  create_method_scope();
+  auto& cache = g_redex->method_resolution_cache();
+  cache.set_enabled(true);
+
+  auto b_method = DexMethod::get_method("B.method:()V");
+  auto c_method = DexMethod::get_method("C.method:()V");
+  EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual), b_method);
+  EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual), b_method);
+  EXPECT_EQ(cache.size(), 1u);
+
+  // Changing the hierarchy makes the cached resolution stale.
+  auto cls_c = type_class(DexType::get_type("C"));
+  cls_c->set_super_class(type::java_lang_Object());
+  EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual), nullptr);
+  cls_c->set_super_class(DexType::get_type("B"));
+  EXPECT_EQ(resolve_method(c_method, MethodSearch::Virtual), b_method);
+
+  cache.clear_stale();
+  EXPECT_EQ(cache.size(), 0u);
+  cache.set_enabled(false);
+}
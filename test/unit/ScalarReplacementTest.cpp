@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ScalarReplacement.h"
+
+#include <gtest/gtest.h>
+
+#include "ControlFlow.h"
+#include "IRAssembler.h"
+#include "RedexTest.h"
+
+class ScalarReplacementTest : public RedexTest {
+ public:
+  void SetUp() override {
+    auto ctor = assembler::method_from_string(R"(
+      (method (public constructor) "LBox;.<init>:(I)V"
+        (
+          (load-param-object v0)
+          (load-param v1)
+          (invoke-direct (v0) "Ljava/lang/Object;.<init>:()V")
+          (iput v1 v0 "LBox;.value:I")
+          (return-void)
+        )
+      ))");
+    auto cls = assembler::class_with_methods("LBox;", {ctor});
+    cls->add_field(
+        DexField::make_field("LBox;.value:I")->make_concrete(ACC_PUBLIC));
+    m_classes = ScalarReplacementPass::find_scalarizable_classes({cls});
+  }
+
+  ScalarReplacementPass::Stats run(IRCode* code) {
+    code->build_cfg(/* editable */ true);
+    auto stats =
+        ScalarReplacementPass::replace_allocations(m_classes, code->cfg());
+    code->clear_cfg();
+    return stats;
+  }
+
+ private:
+  ScalarReplacementPass::ScalarizableClasses m_classes;
+};
+
+TEST_F(ScalarReplacementTest, replaceLocalBox) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (const v1 42)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (const v1 1)
+      (iput v1 v0 "LBox;.value:I")
+      (iget v0 "LBox;.value:I")
+      (move-result-pseudo v2)
+      (return v2)
+    )
+  )");
+  auto stats = run(code.get());
+  EXPECT_EQ(stats.allocations_removed, 1);
+  EXPECT_EQ(stats.fields_scalarized, 1);
+
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+      (const v1 42)
+      (const v3 0)
+      (move v3 v1)
+      (const v1 1)
+      (move v3 v1)
+      (move v2 v3)
+      (return v2)
+    )
+  )");
+  EXPECT_CODE_EQ(code.get(), expected_code.get());
+}
+
+TEST_F(ScalarReplacementTest, keepEscapingBox) {
+  auto original = R"(
+    (
+      (const v1 42)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (return-object v0)
+    )
+  )";
+  auto code = assembler::ircode_from_string(original);
+  auto stats = run(code.get());
+  EXPECT_EQ(stats.allocations_removed, 0);
+  EXPECT_CODE_EQ(code.get(), assembler::ircode_from_string(original).get());
+}
+
+TEST_F(ScalarReplacementTest, keepBoxComparedToNull) {
+  auto original = R"(
+    (
+      (const v1 42)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (if-eqz v0 :null)
+      (return v1)
+      (:null)
+      (const v1 0)
+      (return v1)
+    )
+  )";
+  auto code = assembler::ircode_from_string(original);
+  auto stats = run(code.get());
+  EXPECT_EQ(stats.allocations_removed, 0);
+}
+
+TEST_F(ScalarReplacementTest, keepBoxAliveAcrossAllocations) {
+  // The box read in the loop is the one from the previous iteration.
+  auto original = R"(
+    (
+      (const v1 0)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (:loop)
+      (move-object v2 v0)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (iget v2 "LBox;.value:I")
+      (move-result-pseudo v1)
+      (if-eqz v1 :loop)
+      (return v1)
+    )
+  )";
+  auto code = assembler::ircode_from_string(original);
+  auto stats = run(code.get());
+  EXPECT_EQ(stats.allocations_removed, 0);
+}
+
+TEST_F(ScalarReplacementTest, keepBoxJoinedWithNull) {
+  auto original = R"(
+    (
+      (load-param v1)
+      (if-eqz v1 :null)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (goto :join)
+      (:null)
+      (const v0 0)
+      (:join)
+      (if-eqz v0 :end)
+      (iget v0 "LBox;.value:I")
+      (move-result-pseudo v1)
+      (:end)
+      (return v1)
+    )
+  )";
+  auto code = assembler::ircode_from_string(original);
+  auto stats = run(code.get());
+  EXPECT_EQ(stats.allocations_removed, 0);
+  EXPECT_CODE_EQ(code.get(), assembler::ircode_from_string(original).get());
+}
+
+TEST_F(ScalarReplacementTest, keepBoxJoinedWithNonPointer) {
+  // v0 is Top after the join, which hides its reads from the analysis.
+  auto original = R"(
+    (
+      (load-param v1)
+      (if-eqz v1 :other)
+      (new-instance "LBox;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0 v1) "LBox;.<init>:(I)V")
+      (goto :join)
+      (:other)
+      (const v0 1)
+      (:join)
+      (if-eqz v1 :end)
+      (iget v0 "LBox;.value:I")
+      (move-result-pseudo v1)
+      (:end)
+      (return v1)
+    )
+  )";
+  auto code = assembler::ircode_from_string(original);
+  auto stats = run(code.get());
+  EXPECT_EQ(stats.allocations_removed, 0);
+  EXPECT_CODE_EQ(code.get(), assembler::ircode_from_string(original).get());
+}
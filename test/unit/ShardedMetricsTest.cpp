@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ShardedMetrics.h"
+
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+
+#include "WorkQueue.h"
+
+using namespace sharded_metrics;
+
+TEST(ShardedMetricsTest, counterFromManyThreads) {
+  Counter counter;
+  std::vector<int> items(1000);
+  std::iota(items.begin(), items.end(), 0);
+  workqueue_run<int>([&](int i) { counter.add(i); }, items, 8);
+  EXPECT_EQ(counter.sum(), 999 * 1000 / 2);
+  counter.reset();
+  EXPECT_EQ(counter.sum(), 0);
+}
+
+TEST(ShardedMetricsTest, histogramBuckets) {
+  EXPECT_EQ(Histogram::bucket(0), 0);
+  EXPECT_EQ(Histogram::bucket(1), 1);
+  EXPECT_EQ(Histogram::bucket(2), 2);
+  EXPECT_EQ(Histogram::bucket(3), 2);
+  EXPECT_EQ(Histogram::bucket(4), 3);
+  EXPECT_EQ(Histogram::bucket(UINT64_MAX), 64);
+}
+
+TEST(ShardedMetricsTest, histogramSummary) {
+  Histogram histogram;
+  std::vector<uint64_t> items(100);
+  std::iota(items.begin(), items.end(), 1);
+  workqueue_run<uint64_t>([&](uint64_t v) { histogram.add(v); }, items, 8);
+  auto summary = histogram.summarize();
+  EXPECT_EQ(summary.count, 100);
+  EXPECT_EQ(summary.sum, 5050);
+  EXPECT_EQ(summary.max, 100);
+  // 50 is in [32, 64), 90 and 99 in [64, 128) which is capped by the max.
+  EXPECT_EQ(summary.percentile(50), 63);
+  EXPECT_EQ(summary.percentile(90), 100);
+  EXPECT_EQ(summary.percentile(99), 100);
+}
+
+TEST(ShardedMetricsTest, registryReduce) {
+  Registry registry;
+  registry.counter("c").add(3);
+  registry.counter("c").add(4);
+  registry.histogram("h").add(10);
+  registry.histogram("empty");
+  std::unordered_map<std::string, int64_t> metrics{{"c", 1}};
+  registry.reduce_into(&metrics);
+  EXPECT_EQ(metrics.at("c"), 8);
+  EXPECT_EQ(metrics.at("h.count"), 1);
+  EXPECT_EQ(metrics.at("h.sum"), 10);
+  EXPECT_EQ(metrics.at("h.max"), 10);
+  EXPECT_EQ(metrics.at("h.p50"), 10);
+  EXPECT_EQ(metrics.count("empty.count"), 0);
+
+  // The registry is empty once reduced.
+  std::unordered_map<std::string, int64_t> more;
+  registry.reduce_into(&more);
+  EXPECT_TRUE(more.empty());
+}
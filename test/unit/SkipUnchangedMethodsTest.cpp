@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "Walkers.h"
+
+namespace {
+
+// Removes the first nop of each method, and remembers the methods it ran on.
+class RemoveOneNopPass : public Pass {
+ public:
+  RemoveOneNopPass() : Pass("RemoveOneNopPass") {}
+
+  bool is_method_local() const override { return true; }
+
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& /* conf */,
+                PassManager& mgr) override {
+    visited.clear();
+    walk::code(build_class_scope(stores), [&](DexMethod* method,
+                                              IRCode& code) {
+      mgr.run_on_changed_method(method, [&] {
+        visited.push_back(method);
+        for (auto it = code.begin(); it != code.end(); ++it) {
+          if (it->type == MFLOW_OPCODE && it->insn->opcode() == OPCODE_NOP) {
+            code.remove_opcode(it);
+            break;
+          }
+        }
+      });
+    });
+  }
+
+  std::vector<DexMethod*> visited;
+};
+
+// Adds a nop to the start of the method `target`.
+class AddNopPass : public Pass {
+ public:
+  AddNopPass() : Pass("AddNopPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    auto* code = target->get_code();
+    code->insert_before(code->begin(), new IRInstruction(OPCODE_NOP));
+  }
+
+  DexMethod* target{nullptr};
+};
+
+// Moves the first destination register of the method `target` up by one.
+class RenameRegisterPass : public Pass {
+ public:
+  RenameRegisterPass() : Pass("RenameRegisterPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    auto* code = target->get_code();
+    for (auto& mie : InstructionIterable(*code)) {
+      if (mie.insn->has_dest()) {
+        mie.insn->set_dest(mie.insn->dest() + 1);
+        code->set_registers_size(code->get_registers_size() + 1);
+        break;
+      }
+    }
+  }
+
+  DexMethod* target{nullptr};
+};
+
+} // namespace
+
+class SkipUnchangedMethodsTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    ClassCreator creator(DexType::make_type("LFoo;"));
+    creator.set_super(type::java_lang_Object());
+    m_with_nop = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.withNop:()V"
+        ((nop) (return-void))
+      )
+    )");
+    m_without_nop = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.withoutNop:()V"
+        ((return-void))
+      )
+    )");
+    creator.add_method(m_with_nop);
+    creator.add_method(m_without_nop);
+    DexStore store("classes");
+    store.add_classes({creator.create()});
+    m_stores.emplace_back(std::move(store));
+  }
+
+  // Runs the given passes, tracking the no-ops when asked to. Returns the
+  // metrics of each pass.
+  std::vector<std::unordered_map<std::string, int64_t>> run_passes(
+      const std::vector<std::string>& names,
+      const std::vector<Pass*>& passes,
+      bool skip_unchanged_methods) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (const auto& name : names) {
+      config["redex"]["passes"].append(name);
+    }
+    config["skip_unchanged_methods"] = skip_unchanged_methods;
+    ConfigFiles conf(config);
+    PassManager manager(passes, config);
+    manager.set_testing_mode();
+    manager.run_passes(m_stores, conf);
+    std::vector<std::unordered_map<std::string, int64_t>> metrics;
+    for (const auto& pass_info : manager.get_pass_info()) {
+      metrics.push_back(pass_info.metrics);
+    }
+    return metrics;
+  }
+
+  DexStoresVector m_stores;
+  DexMethod* m_with_nop;
+  DexMethod* m_without_nop;
+};
+
+TEST_F(SkipUnchangedMethodsTest, skipsTheNoOpsOfThePreviousRun) {
+  RemoveOneNopPass pass;
+  auto metrics =
+      run_passes({"RemoveOneNopPass", "RemoveOneNopPass#2"}, {&pass}, true);
+  // The first run removed the nop of `withNop`, so only the second run on
+  // `withNop` found nothing to do.
+  EXPECT_EQ(pass.visited, std::vector<DexMethod*>{m_with_nop});
+  EXPECT_EQ(metrics[0].at("num_unchanged_methods_skipped"), 0);
+  EXPECT_EQ(metrics[1].at("num_unchanged_methods_skipped"), 1);
+
+  run_passes({"RemoveOneNopPass"}, {&pass}, true);
+  // The PassManager state does not outlive the PassManager.
+  EXPECT_EQ(pass.visited.size(), 2u);
+}
+
+TEST_F(SkipUnchangedMethodsTest, revisitsChangedMethods) {
+  RemoveOneNopPass pass;
+  AddNopPass add_nop;
+  add_nop.target = m_without_nop;
+  auto metrics = run_passes({"RemoveOneNopPass", "RemoveOneNopPass#2",
+                               "AddNopPass", "RemoveOneNopPass#3"},
+                              {&pass, &add_nop}, true);
+  EXPECT_EQ(pass.visited, std::vector<DexMethod*>{m_without_nop});
+  EXPECT_EQ(metrics[3].at("num_unchanged_methods_skipped"), 1);
+}
+
+TEST_F(SkipUnchangedMethodsTest, revisitsMethodsWithRenamedRegisters) {
+  m_without_nop->set_code(assembler::ircode_from_string(R"(
+    (
+      (const v0 0)
+      (return-void)
+    )
+  )"));
+  RemoveOneNopPass pass;
+  RenameRegisterPass rename;
+  rename.target = m_without_nop;
+  auto metrics = run_passes({"RemoveOneNopPass", "RemoveOneNopPass#2",
+                             "RenameRegisterPass", "RemoveOneNopPass#3"},
+                            {&pass, &rename}, true);
+  // Only a register of `withoutNop` changed, which still makes it changed.
+  EXPECT_EQ(pass.visited, std::vector<DexMethod*>{m_without_nop});
+  EXPECT_EQ(metrics[3].at("num_unchanged_methods_skipped"), 1);
+}
+
+TEST_F(SkipUnchangedMethodsTest, visitsAllMethodsByDefault) {
+  RemoveOneNopPass pass;
+  auto metrics =
+      run_passes({"RemoveOneNopPass", "RemoveOneNopPass#2"}, {&pass}, false);
+  EXPECT_EQ(pass.visited.size(), 2u);
+  EXPECT_FALSE(metrics[1].count("num_unchanged_methods_skipped"));
+}
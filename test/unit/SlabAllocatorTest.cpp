@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SlabAllocator.h"
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <unordered_set>
+
+#include "IRInstruction.h"
+#include "RedexTest.h"
+#include "WorkQueue.h"
+
+namespace {
+
+struct Pooled {
+  uint64_t payload[3];
+};
+
+using PooledAllocator = SlabAllocator<sizeof(Pooled), alignof(Pooled)>;
+
+// Only used by freeOnlyThreadHandsBlocksBack, which needs an empty pool.
+struct alignas(32) OtherPooled {
+  char payload[96];
+};
+
+using OtherPooledAllocator =
+    SlabAllocator<sizeof(OtherPooled), alignof(OtherPooled)>;
+
+} // namespace
+
+TEST(SlabAllocatorTest, distinctBlocks) {
+  std::unordered_set<void*> blocks;
+  for (size_t i = 0; i < 10000; ++i) {
+    auto p = PooledAllocator::allocate(sizeof(Pooled));
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(p) % alignof(Pooled));
+    EXPECT_TRUE(blocks.insert(p).second);
+  }
+  for (auto p : blocks) {
+    PooledAllocator::deallocate(p, sizeof(Pooled));
+  }
+  // Freed blocks are recycled.
+  auto p = PooledAllocator::allocate(sizeof(Pooled));
+  EXPECT_EQ(1, blocks.count(p));
+  PooledAllocator::deallocate(p, sizeof(Pooled));
+}
+
+TEST(SlabAllocatorTest, crossThreadFrees) {
+  // Allocate on one set of threads, free on another.
+  std::vector<std::vector<Pooled*>> batches(8);
+  workqueue_run<std::vector<Pooled*>*>(
+      [](std::vector<Pooled*>* batch) {
+        for (size_t i = 0; i < 5000; ++i) {
+          auto p = static_cast<Pooled*>(
+              PooledAllocator::allocate(sizeof(Pooled)));
+          p->payload[0] = i;
+          batch->push_back(p);
+        }
+      },
+      [&batches]() {
+        std::vector<std::vector<Pooled*>*> ptrs;
+        for (auto& b : batches) {
+          ptrs.push_back(&b);
+        }
+        return ptrs;
+      }(),
+      4);
+  std::unordered_set<Pooled*> all;
+  for (auto& batch : batches) {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      EXPECT_EQ(i, batch[i]->payload[0]);
+      EXPECT_TRUE(all.insert(batch[i]).second);
+    }
+  }
+  workqueue_run<std::vector<Pooled*>*>(
+      [](std::vector<Pooled*>* batch) {
+        for (auto p : *batch) {
+          PooledAllocator::deallocate(p, sizeof(Pooled));
+        }
+      },
+      [&batches]() {
+        std::vector<std::vector<Pooled*>*> ptrs;
+        for (auto& b : batches) {
+          ptrs.push_back(&b);
+        }
+        return ptrs;
+      }(),
+      3);
+}
+
+TEST(SlabAllocatorTest, freeOnlyThreadHandsBlocksBack) {
+  std::unordered_set<void*> blocks;
+  for (size_t i = 0; i < 100; ++i) {
+    blocks.insert(OtherPooledAllocator::allocate(sizeof(OtherPooled)));
+  }
+  std::thread([&blocks]() {
+    for (auto p : blocks) {
+      OtherPooledAllocator::deallocate(p, sizeof(OtherPooled));
+    }
+  }).join();
+  // The freeing thread handed its blocks back on exit, so another thread gets
+  // them instead of a new chunk.
+  void* p = nullptr;
+  std::thread([&p]() {
+    p = OtherPooledAllocator::allocate(sizeof(OtherPooled));
+  }).join();
+  EXPECT_EQ(1, blocks.count(p));
+  OtherPooledAllocator::deallocate(p, sizeof(OtherPooled));
+}
+
+class SlabAllocatorIRTest : public RedexTest {};
+
+TEST_F(SlabAllocatorIRTest, instructions) {
+  std::vector<IRInstruction*> insns;
+  for (size_t i = 0; i < 1000; ++i) {
+    auto insn = new IRInstruction(OPCODE_CONST);
+    insn->set_dest(i)->set_literal(i);
+    insns.push_back(insn);
+  }
+  for (size_t i = 0; i < insns.size(); ++i) {
+    EXPECT_EQ(i, insns[i]->dest());
+    EXPECT_EQ(i, insns[i]->get_literal());
+    delete insns[i];
+  }
+}
@@ -759,3 +759,50 @@ TEST_F(StringBuilderOutlinerTest, maxLength) {
   )");
   EXPECT_CODE_EQ(expected_code.get(), code.get());
 }
+
+/*
+ * Check that the StringBuilders of hot code get presized instead of outlined.
+ */
+TEST_F(StringBuilderOutlinerTest, presizeHotBuilder) {
+  auto code = assembler::ircode_from_string(R"(
+    (
+      (new-instance "Ljava/lang/StringBuilder;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0) "Ljava/lang/StringBuilder;.<init>:()V")
+      (const-string "0123456789")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (const-wide v2 1)
+      (invoke-virtual (v0 v2) "Ljava/lang/StringBuilder;.append:(J)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v0) "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;")
+      (move-result-object v0)
+      (return-object v0)
+    )
+  )");
+
+  Outliner outliner(m_config);
+  outliner.analyze(*code, /* presize */ true);
+  outliner.create_outline_helpers(&m_stores);
+  outliner.transform(code.get());
+  EXPECT_EQ(outliner.get_stats().stringbuilders_presized, 1);
+  EXPECT_EQ(outliner.get_stats().helper_methods_created, 0);
+
+  // The constant string takes 10 chars, and a long is estimated at 20.
+  auto expected_code = assembler::ircode_from_string(R"(
+    (
+      (new-instance "Ljava/lang/StringBuilder;")
+      (move-result-pseudo-object v0)
+      (const v4 30)
+      (invoke-direct (v0 v4) "Ljava/lang/StringBuilder;.<init>:(I)V")
+      (const-string "0123456789")
+      (move-result-pseudo-object v1)
+      (invoke-virtual (v0 v1) "Ljava/lang/StringBuilder;.append:(Ljava/lang/String;)Ljava/lang/StringBuilder;")
+      (const-wide v2 1)
+      (invoke-virtual (v0 v2) "Ljava/lang/StringBuilder;.append:(J)Ljava/lang/StringBuilder;")
+      (invoke-virtual (v0) "Ljava/lang/StringBuilder;.toString:()Ljava/lang/String;")
+      (move-result-object v0)
+      (return-object v0)
+    )
+  )");
+  EXPECT_CODE_EQ(expected_code.get(), code.get());
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SuffixArray.h"
+
+#include <gtest/gtest.h>
+#include <random>
+
+namespace {
+
+suffix_array::Text to_text(const std::string& s) {
+  return suffix_array::Text(s.begin(), s.end());
+}
+
+// Quadratic reference implementation.
+std::vector<uint32_t> naive_longest_repeated_prefixes(
+    const suffix_array::Text& text) {
+  std::vector<uint32_t> res(text.size(), 0);
+  for (size_t i = 0; i < text.size(); i++) {
+    for (size_t j = 0; j < text.size(); j++) {
+      if (i == j) {
+        continue;
+      }
+      uint32_t len = 0;
+      while (i + len < text.size() && j + len < text.size() &&
+             text[i + len] == text[j + len]) {
+        len++;
+      }
+      res[i] = std::max(res[i], len);
+    }
+  }
+  return res;
+}
+
+} // namespace
+
+TEST(SuffixArrayTest, banana) {
+  auto text = to_text("banana");
+  EXPECT_EQ(suffix_array::build(text),
+            (std::vector<uint32_t>{5, 3, 1, 0, 4, 2}));
+  auto sa = suffix_array::build(text);
+  EXPECT_EQ(suffix_array::build_lcp(text, sa),
+            (std::vector<uint32_t>{0, 1, 3, 0, 0, 2}));
+  EXPECT_EQ(suffix_array::longest_repeated_prefixes(text),
+            (std::vector<uint32_t>{0, 3, 2, 3, 2, 1}));
+}
+
+TEST(SuffixArrayTest, empty_and_single) {
+  EXPECT_TRUE(suffix_array::build({}).empty());
+  EXPECT_TRUE(suffix_array::longest_repeated_prefixes({}).empty());
+  EXPECT_EQ(suffix_array::longest_repeated_prefixes({7}),
+            (std::vector<uint32_t>{0}));
+}
+
+TEST(SuffixArrayTest, unique_separators_bound_repeats) {
+  // "abc" twice, separated by symbols that occur only once.
+  suffix_array::Text text{1, 2, 3, 100, 1, 2, 3, 101};
+  EXPECT_EQ(suffix_array::longest_repeated_prefixes(text),
+            (std::vector<uint32_t>{3, 2, 1, 0, 3, 2, 1, 0}));
+}
+
+TEST(SuffixArrayTest, matches_naive) {
+  std::mt19937 gen(42);
+  for (size_t size : {2, 10, 100, 300}) {
+    for (uint32_t alphabet : {1, 2, 4, 50}) {
+      std::uniform_int_distribution<uint32_t> dist(0, alphabet - 1);
+      suffix_array::Text text(size);
+      for (auto& c : text) {
+        c = dist(gen);
+      }
+      EXPECT_EQ(suffix_array::longest_repeated_prefixes(text),
+                naive_longest_repeated_prefixes(text))
+          << "size " << size << ", alphabet " << alphabet;
+    }
+  }
+}
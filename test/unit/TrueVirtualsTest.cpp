@@ -507,3 +507,32 @@ TEST_F(DevirtualizerTest, GenericRichHierarchy) {
                   "LA;.final1:()V", "LABA;.final2:()V", "LAA;.final1:(I)V",
                   "LAAB;.final2:()V", "LAAA;.final2:()V"));
 }
+
+TEST_F(DevirtualizerTest, RemoveMethodFromGraph) {
+  std::vector<DexClass*> scope = create_empty_scope();
+  auto void_void =
+      DexProto::make_proto(type::_void(), DexTypeList::make_type_list({}));
+  auto a_cls = create_internal_class(DexType::make_type("LA;"),
+                                     type::java_lang_Object(), {});
+  auto a_m = create_empty_method(a_cls, "m", void_void);
+  auto b_cls =
+      create_internal_class(DexType::make_type("LB;"), a_cls->get_type(), {});
+  auto b_m = create_empty_method(b_cls, "m", void_void);
+  auto c_cls =
+      create_internal_class(DexType::make_type("LC;"), b_cls->get_type(), {});
+  auto c_m = create_empty_method(c_cls, "m", void_void);
+  scope.push_back(a_cls);
+  scope.push_back(b_cls);
+  scope.push_back(c_cls);
+
+  auto graph = mog::build_mutable_graph(scope);
+  EXPECT_THAT(mog::get_overriding_methods(*graph, a_m),
+              ::testing::UnorderedElementsAre(b_m, c_m));
+
+  graph->remove_method(b_m);
+  EXPECT_THAT(mog::get_overriding_methods(*graph, a_m),
+              ::testing::UnorderedElementsAre(c_m));
+  EXPECT_THAT(mog::get_overridden_methods(*graph, c_m),
+              ::testing::UnorderedElementsAre(a_m));
+  EXPECT_TRUE(mog::get_overriding_methods(*graph, b_m).empty());
+}
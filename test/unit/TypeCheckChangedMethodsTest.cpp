@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/value.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "IRAssembler.h"
+#include "IRCode.h"
+#include "Pass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+
+namespace {
+
+class NothingPass : public Pass {
+ public:
+  NothingPass() : Pass("NothingPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {}
+};
+
+// Makes `target` return v1 instead of v0. Nothing else changes, so only the
+// registers of the method tell the change apart.
+class RenameRegisterPass : public Pass {
+ public:
+  RenameRegisterPass() : Pass("RenameRegisterPass") {}
+
+  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    auto* code = target->get_code();
+    code->set_registers_size(2);
+    for (auto& mie : InstructionIterable(*code)) {
+      if (mie.insn->opcode() == OPCODE_RETURN) {
+        mie.insn->set_src(0, 1);
+      }
+    }
+  }
+
+  DexMethod* target{nullptr};
+};
+
+} // namespace
+
+class TypeCheckChangedMethodsTest : public RedexTest {
+ protected:
+  void SetUp() override {
+    ClassCreator creator(DexType::make_type("LFoo;"));
+    creator.set_super(type::java_lang_Object());
+    m_method = assembler::method_from_string(R"(
+      (method (public static) "LFoo;.foo:()I"
+        ((const v0 0) (return v0))
+      )
+    )");
+    creator.add_method(m_method);
+    DexStore store("classes");
+    store.add_classes({creator.create()});
+    m_stores.emplace_back(std::move(store));
+  }
+
+  void run_passes(const std::vector<std::string>& names,
+                  const std::vector<Pass*>& passes) {
+    Json::Value config(Json::objectValue);
+    config["redex"]["passes"] = Json::arrayValue;
+    for (const auto& name : names) {
+      config["redex"]["passes"].append(name);
+    }
+    config["ir_type_checker"]["run_after_each_pass"] = true;
+    config["ir_type_checker"]["check_changed_methods_only"] = true;
+    ConfigFiles conf(config);
+    PassManager manager(passes, config);
+    manager.set_testing_mode();
+    manager.run_passes(m_stores, conf);
+  }
+
+  DexStoresVector m_stores;
+  DexMethod* m_method;
+};
+
+TEST_F(TypeCheckChangedMethodsTest, unchangedMethodsPass) {
+  NothingPass nothing;
+  run_passes({"NothingPass", "NothingPass#2"}, {&nothing});
+}
+
+TEST_F(TypeCheckChangedMethodsTest, registerRenamesAreChecked) {
+  NothingPass nothing;
+  RenameRegisterPass rename;
+  rename.target = m_method;
+  // The method passed the check after NothingPass. Returning the undefined
+  // v1 must still be caught after RenameRegisterPass.
+  EXPECT_EXIT(run_passes({"NothingPass", "RenameRegisterPass"},
+                         {&nothing, &rename}),
+              ::testing::ExitedWithCode(EXIT_FAILURE),
+              "Inconsistency found in Dex code for LFoo;.foo:\\(\\)I");
+}
@@ -37,3 +37,38 @@ TEST_F(WalkersTest, accumlate) {
       ::testing::UnorderedElementsAre(
           "LFoo;.bar:()V", "LFoo;.baz:()V", "LFoo;.qux:()V", "LFoo;.quux:()V"));
 }
+
+TEST_F(WalkersTest, methods_by_cost) {
+  ClassCreator cc(DexType::make_type("LFoo;"));
+  cc.set_super(type::java_lang_Object());
+  for (const auto& name : {"bar", "baz", "qux", "quux"}) {
+    auto method = DexMethod::make_method(std::string("LFoo;.") + name + ":()V")
+                      ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+    method->set_code(std::make_unique<IRCode>(method, 1));
+    method->get_code()->push_back(new IRInstruction(OPCODE_RETURN_VOID));
+    cc.add_method(method);
+  }
+
+  using StringSet = std::unordered_set<std::string>;
+  constexpr size_t num_threads = 2;
+  Scope scope{cc.create()};
+  auto strings =
+      walk::parallel::methods_by_cost<StringSet, MergeContainers<StringSet>>(
+          scope, [&](DexMethod* m) { return StringSet{show(m)}; },
+          num_threads);
+  EXPECT_THAT(
+      strings,
+      ::testing::UnorderedElementsAre(
+          "LFoo;.bar:()V", "LFoo;.baz:()V", "LFoo;.qux:()V", "LFoo;.quux:()V"));
+
+  std::atomic<size_t> visited{0};
+  walk::parallel::code_by_cost(
+      scope,
+      [](DexMethod* m) { return m->get_name()->str() != "bar"; },
+      [&](DexMethod*, IRCode& code) {
+        EXPECT_EQ(1, code.count_opcodes());
+        ++visited;
+      },
+      num_threads);
+  EXPECT_EQ(3, visited.load());
+}
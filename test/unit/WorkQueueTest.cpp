@@ -86,6 +86,22 @@ TEST(WorkQueueTest, singleThreadTest) {
   }
 }
 
+TEST(WorkQueueTest, RunByCostTest) {
+  std::array<int, NUM_INTS> array{};
+
+  std::vector<int*> items;
+  items.reserve(NUM_INTS);
+  std::transform(array.begin(), array.end(), std::back_inserter(items),
+                 [](auto& i) { return &i; });
+
+  workqueue_run_by_cost<int*>([](int* a) { (*a)++; }, items,
+                              [&array](int* a) { return a - array.data(); });
+
+  for (const auto& e : array) {
+    EXPECT_EQ(1, e);
+  }
+}
+
 // Check that we can dynamically adding work items during execution.
 TEST(WorkQueueTest, checkDynamicallyAddingTasks) {
   constexpr size_t num_threads{3};
@@ -110,3 +126,20 @@ TEST(WorkQueueTest, checkDynamicallyAddingTasks) {
   // 10 + 9 + ... + 1 + 0 = 55
   EXPECT_EQ(55, result);
 }
+
+TEST(WorkQueueTest, scopedThreadLimitTest) {
+  redex_parallel::set_default_num_threads(8);
+  {
+    redex_parallel::ScopedThreadLimit limit(2);
+    EXPECT_EQ(2, redex_parallel::default_num_threads());
+    {
+      // A limit never raises the number of threads.
+      redex_parallel::ScopedThreadLimit no_limit(4);
+      EXPECT_EQ(2, redex_parallel::default_num_threads());
+    }
+    EXPECT_EQ(2, redex_parallel::default_num_threads());
+  }
+  EXPECT_EQ(8, redex_parallel::default_num_threads());
+  redex_parallel::set_default_num_threads(0);
+  EXPECT_LE(1, redex_parallel::default_num_threads());
+}
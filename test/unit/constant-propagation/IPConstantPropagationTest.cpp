@@ -19,6 +19,7 @@
 #include "IRAssembler.h"
 #include "MethodOverrideGraph.h"
 #include "RedexTest.h"
+#include "RedexTestUtils.h"
 #include "Walkers.h"
 
 using namespace constant_propagation;
@@ -1674,3 +1675,85 @@ TEST_F(InterproceduralConstantPropagationTest, whiteBoxReturnValues) {
             SignedConstantDomain::bottom());
   EXPECT_EQ(wps.get_return_value(returns_constant), SignedConstantDomain(1));
 }
+
+TEST_F(InterproceduralConstantPropagationTest, summaryCache) {
+  auto cls_ty = DexType::make_type("LFoo;");
+  ClassCreator creator(cls_ty);
+  creator.set_super(type::java_lang_Object());
+
+  auto m1 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:()V"
+     (
+      (const v0 1)
+      (invoke-static (v0) "LFoo;.baz:(I)V")
+      (return-void)
+     )
+    )
+  )");
+  m1->rstate.set_root();
+  creator.add_method(m1);
+
+  auto m2 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.baz:(I)V"
+     (
+      (load-param v0)
+      (invoke-static (v0) "LFoo;.qux:(I)V")
+      (return-void)
+     )
+    )
+  )");
+  creator.add_method(m2);
+
+  auto m3 = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.qux:(I)V"
+     (
+      (load-param v0)
+      (return-void)
+     )
+    )
+  )");
+  creator.add_method(m3);
+
+  Scope scope{creator.create()};
+  walk::code(scope, [](DexMethod*, IRCode& code) {
+    code.build_cfg(/* editable */ false);
+  });
+
+  auto tmp_dir = redex::make_tmp_dir("IPCPSummaryCache%%%%%%%%");
+  InterproceduralConstantPropagationPass::Config config;
+  config.max_heap_analysis_iterations = 1;
+  config.summary_cache_path = tmp_dir.path + "/summaries";
+
+  auto get_qux_args = [&](FixpointIterator& fp_iter) {
+    const auto& graph = fp_iter.get_call_graph();
+    return fp_iter.get_entry_state_at(graph.node(m3)).get(
+        CURRENT_PARTITION_LABEL);
+  };
+
+  InterproceduralConstantPropagationPass first_pass(config);
+  auto fp_iter = first_pass.analyze(scope, &m_immut_analyzer_state);
+  EXPECT_EQ(first_pass.summary_cache_hits(), 0);
+  const auto expected = ArgumentDomain({{0, SignedConstantDomain(1)}});
+  EXPECT_EQ(get_qux_args(*fp_iter), expected);
+
+  // Nothing changed: all the summaries are reused, with the same results.
+  InterproceduralConstantPropagationPass second_pass(config);
+  fp_iter = second_pass.analyze(scope, &m_immut_analyzer_state);
+  EXPECT_GT(second_pass.summary_cache_hits(), 0);
+  EXPECT_EQ(get_qux_args(*fp_iter), expected);
+
+  // Changing the caller invalidates its summary.
+  m1->get_code()->clear_cfg();
+  m1->set_code(assembler::ircode_from_string(R"(
+    (
+     (const v0 2)
+     (invoke-static (v0) "LFoo;.baz:(I)V")
+     (return-void)
+    )
+  )"));
+  m1->get_code()->build_cfg(/* editable */ false);
+  InterproceduralConstantPropagationPass third_pass(config);
+  fp_iter = third_pass.analyze(scope, &m_immut_analyzer_state);
+  EXPECT_EQ(get_qux_args(*fp_iter),
+            ArgumentDomain({{0, SignedConstantDomain(2)}}));
+}
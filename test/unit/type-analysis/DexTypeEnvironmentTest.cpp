@@ -809,3 +809,27 @@ TEST_F(DexTypeEnvironmentTest, ArrayConstNullnessDomain) {
       DexTypeDomain(m_string_array, 3).get_array_nullness().is_bottom());
   EXPECT_TRUE(DexTypeDomain(m_string_array).get_array_nullness().is_top());
 }
+
+TEST_F(DexTypeEnvironmentTest, SmallTypeSetInterningTest) {
+  using dtv_impl::SmallTypeSet;
+  auto a1 = SmallTypeSet::singleton(m_type_a1);
+  auto a2 = SmallTypeSet::singleton(m_type_a2);
+  EXPECT_EQ(a1, SmallTypeSet::singleton(m_type_a1));
+  EXPECT_EQ(SmallTypeSet::get_union(a1, a1), a1);
+  EXPECT_EQ(SmallTypeSet::get_union(a1, SmallTypeSet::empty()), a1);
+
+  // Equal sets are the same object, whichever way they were built.
+  auto a1_a2 = SmallTypeSet::get_union(a1, a2);
+  EXPECT_EQ(a1_a2, SmallTypeSet::get_union(a2, a1));
+  EXPECT_EQ(a1_a2->size(), 2u);
+  EXPECT_TRUE(a1->is_subset_of(*a1_a2));
+  EXPECT_FALSE(a1_a2->is_subset_of(*a2));
+
+  auto set = a1_a2;
+  for (auto type : {m_type_a21, m_type_a211}) {
+    set = SmallTypeSet::get_union(set, SmallTypeSet::singleton(type));
+  }
+  EXPECT_EQ(set->size(), MAX_SET_SIZE);
+  EXPECT_EQ(SmallTypeSet::get_union(set, SmallTypeSet::singleton(m_type_a)),
+            nullptr);
+}
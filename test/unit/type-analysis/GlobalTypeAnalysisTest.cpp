@@ -220,6 +220,60 @@ TEST_F(GlobalTypeAnalysisTest, ReturnTypeTest) {
   EXPECT_EQ(bar_exit_env.get_reg_environment().get(0), get_type_domain("LO;"));
 }
 
+TEST_F(GlobalTypeAnalysisTest, MethodSummaryTest) {
+  Scope scope;
+  prepare_scope(scope);
+
+  auto cls_a = DexType::make_type("LA;");
+  ClassCreator creator(cls_a);
+  creator.set_super(type::java_lang_Object());
+
+  auto meth_bar = assembler::method_from_string(R"(
+    (method (public static) "LA;.bar:()LO;"
+     (
+      (new-instance "LO;")
+      (move-result-pseudo-object v1)
+      (invoke-direct (v1) "LO;.<init>:()V")
+      (return-object v1)
+     )
+    )
+  )");
+  creator.add_method(meth_bar);
+
+  auto meth_foo = assembler::method_from_string(R"(
+    (method (public static) "LA;.foo:()V"
+     (
+      (invoke-static () "LA;.bar:()LO;")
+      (move-result-object v0)
+      (return-void)
+     )
+    )
+  )");
+  meth_foo->rstate.set_root();
+  creator.add_method(meth_foo);
+  scope.push_back(creator.create());
+
+  walk::code(scope, [](DexMethod*, IRCode& code) {
+    code.build_cfg(/* editable */ false);
+  });
+
+  GlobalTypeAnalysis analysis;
+  auto gta = analysis.analyze(scope);
+
+  auto bar_summary = gta->get_method_summary(meth_bar);
+  ASSERT_EQ(bar_summary->return_types.size(), 1u);
+  EXPECT_EQ(bar_summary->return_types[0], get_type_domain("LO;"));
+  EXPECT_TRUE(bar_summary->read_returns.empty());
+
+  auto foo_summary = gta->get_method_summary(meth_foo);
+  EXPECT_EQ(foo_summary->read_returns,
+            std::vector<const DexMethod*>{meth_bar});
+
+  // Nothing that bar reads depends on the whole program state, so the later
+  // global iterations don't need to analyze it again.
+  EXPECT_GT(gta->get_num_reused_summaries(), 0u);
+}
+
 TEST_F(GlobalTypeAnalysisTest, SimpleFieldTypeTest) {
   Scope scope;
   prepare_scope(scope);
@@ -12,6 +12,7 @@
 #include "Creators.h"
 #include "IRAssembler.h"
 #include "KotlinNullCheckMethods.h"
+#include "MethodOverrideGraph.h"
 #include "RedexTest.h"
 #include "Walkers.h"
 
@@ -60,12 +61,14 @@ struct TypeAnalysisTransformTest : public RedexTest {
     scope.push_back(m_cls_o);
   }
 
-  void run_opt(Scope& scope) {
+  void run_opt(Scope& scope, bool refine_virtual_callsites = false) {
     global::GlobalTypeAnalysis analysis(10);
+    auto method_override_graph = method_override_graph::build_graph(scope);
     auto gta = analysis.analyze(scope);
     auto wps = gta->get_whole_program_state();
     type_analyzer::Transform::Config config;
     config.remove_kotlin_null_check_assertions = true;
+    config.refine_virtual_callsites = refine_virtual_callsites;
     type_analyzer::Transform::Stats transform_stats;
 
     transform_stats = walk::parallel::methods<type_analyzer::Transform::Stats>(
@@ -78,7 +81,7 @@ struct TypeAnalysisTransformTest : public RedexTest {
               kotlin_nullcheck_wrapper::get_kotlin_null_assertions();
           auto lta = gta->get_local_analysis(method);
           auto& code = *method->get_code();
-          Transform tf(config);
+          Transform tf(config, method_override_graph.get());
           return tf.apply(*lta, wps, method, null_assertion_set);
         });
   }
@@ -228,3 +231,104 @@ TEST_F(TypeAnalysisTransformTest, MultiArgumentPassingTest) {
 
   EXPECT_CODE_EQ(m_method_call->get_code(), expected_code.get());
 }
+
+TEST_F(TypeAnalysisTransformTest, RefineVirtualCallsitesTest) {
+  Scope scope;
+  prepare_scope(scope);
+
+  auto type_i = DexType::make_type("LI;");
+  ClassCreator creator_i(type_i);
+  creator_i.set_access(ACC_PUBLIC | ACC_INTERFACE | ACC_ABSTRACT);
+  creator_i.set_super(type::java_lang_Object());
+  auto meth_i = DexMethod::make_method("LI;.m:()I")
+                    ->make_concrete(ACC_PUBLIC | ACC_ABSTRACT,
+                                    /* is_virtual */ true);
+  creator_i.add_method(meth_i);
+  scope.push_back(creator_i.create());
+
+  auto type_impl = DexType::make_type("LImpl;");
+  ClassCreator creator_impl(type_impl);
+  creator_impl.set_access(ACC_PUBLIC);
+  creator_impl.set_super(type::java_lang_Object());
+  creator_impl.add_interface(type_i);
+  creator_impl.add_method(assembler::method_from_string(R"(
+    (method (public constructor) "LImpl;.<init>:()V"
+     (
+      (load-param-object v0)
+      (invoke-direct (v0) "Ljava/lang/Object;.<init>:()V")
+      (return-void)
+     )
+    )
+  )"));
+  creator_impl.add_method(assembler::method_from_string(R"(
+    (method (public) "LImpl;.m:()I"
+     (
+      (load-param-object v0)
+      (const v1 1)
+      (return v1)
+     )
+    )
+  )"));
+  scope.push_back(creator_impl.create());
+
+  auto type_a = DexType::make_type("LA;");
+  ClassCreator creator(type_a);
+  creator.set_super(type::java_lang_Object());
+  // The verifier only knows that the parameter is an LI;, so the refined
+  // invocation needs a cast.
+  auto meth_bar = assembler::method_from_string(R"(
+    (method (public static) "LA;.bar:(LI;)I"
+     (
+      (load-param-object v0)
+      (invoke-interface (v0) "LI;.m:()I")
+      (move-result v1)
+      (return v1)
+     )
+    )
+  )");
+  creator.add_method(meth_bar);
+  auto meth_foo = assembler::method_from_string(R"(
+    (method (public static) "LA;.foo:()I"
+     (
+      (new-instance "LImpl;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0) "LImpl;.<init>:()V")
+      (invoke-interface (v0) "LI;.m:()I")
+      (move-result v1)
+      (invoke-static (v0) "LA;.bar:(LI;)I")
+      (move-result v1)
+      (return v1)
+     )
+    )
+  )");
+  meth_foo->rstate.set_root();
+  creator.add_method(meth_foo);
+  scope.push_back(creator.create());
+  run_opt(scope, /* refine_virtual_callsites */ true);
+
+  auto expected_foo = assembler::ircode_from_string(R"(
+     (
+      (new-instance "LImpl;")
+      (move-result-pseudo-object v0)
+      (invoke-direct (v0) "LImpl;.<init>:()V")
+      (invoke-virtual (v0) "LImpl;.m:()I")
+      (move-result v1)
+      (invoke-static (v0) "LA;.bar:(LI;)I")
+      (move-result v1)
+      (return v1)
+     )
+  )");
+  EXPECT_CODE_EQ(meth_foo->get_code(), expected_foo.get());
+
+  auto expected_bar = assembler::ircode_from_string(R"(
+     (
+      (load-param-object v0)
+      (check-cast v0 "LImpl;")
+      (move-result-pseudo-object v2)
+      (invoke-virtual (v2) "LImpl;.m:()I")
+      (move-result v1)
+      (return v1)
+     )
+  )");
+  EXPECT_CODE_EQ(meth_bar->get_code(), expected_bar.get());
+}
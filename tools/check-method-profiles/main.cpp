@@ -6,27 +6,97 @@
  */
 
 #include <iostream>
+#include <unordered_set>
 
+#include "DexClass.h"
+#include "DexLoader.h"
 #include "MethodProfiles.h"
 #include "RedexContext.h"
 
+namespace {
+
+void print_usage() {
+  std::cerr << "Usage: check-method-profiles [--dex DEX-FILE]... PROF-FILE "
+               "[PROF-FILE...]"
+            << std::endl
+            << "With dexes, which are loaded without their code, also prints "
+               "the coverage"
+            << std::endl
+            << "of their methods by the profiles." << std::endl;
+}
+
+// Prints, per interaction, how many of its methods are defined in the dexes,
+// and how many of the methods of the dexes any interaction covers.
+void print_coverage(const method_profiles::MethodProfiles& profiles,
+                    const std::vector<DexClasses>& dexes) {
+  std::unordered_set<const DexMethodRef*> dex_methods;
+  for (const auto& classes : dexes) {
+    for (const auto* cls : classes) {
+      for (const auto* method : cls->get_all_methods()) {
+        dex_methods.insert(method);
+      }
+    }
+  }
+  std::unordered_set<const DexMethodRef*> covered;
+  for (const auto& interaction : profiles.all_interactions()) {
+    size_t defined = 0;
+    for (const auto& entry : interaction.second) {
+      if (dex_methods.count(entry.first)) {
+        ++defined;
+        covered.insert(entry.first);
+      }
+    }
+    std::cout << interaction.first << ": " << interaction.second.size()
+              << " methods, " << defined << " defined in the dexes"
+              << std::endl;
+  }
+  std::cout << profiles.unresolved_size() << " unresolved rows" << std::endl;
+  std::cout << covered.size() << " of the " << dex_methods.size()
+            << " methods of the dexes are profiled" << std::endl;
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
   if (argc == 1 || std::string("--help") == argv[1] ||
       std::string("-h") == argv[1]) {
     // No args (or help), print usage.
-    std::cerr << "Usage: check-method-profiles PROF-FILE [PROF-FILE...]"
-              << std::endl;
+    print_usage();
     return argc == 1 ? 1 : 0;
   }
 
+  std::vector<std::string> dex_files;
   std::vector<std::string> files;
   for (int i = 1; i < argc; ++i) {
-    files.push_back(argv[i]);
+    if (std::string("--dex") == argv[i]) {
+      if (++i == argc) {
+        print_usage();
+        return 1;
+      }
+      dex_files.push_back(argv[i]);
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty()) {
+    print_usage();
+    return 1;
   }
 
   RedexContext rc;
   g_redex = &rc;
+  // The profiles resolve their methods against the method refs that exist, so
+  // the dexes are loaded first. Their code isn't needed, so it isn't
+  // ballooned.
+  std::vector<DexClasses> dexes;
+  if (!dex_files.empty()) {
+    dexes = load_classes_from_dexes(dex_files, /* stats */ nullptr,
+                                    /* balloon */ false);
+  }
   method_profiles::MethodProfiles m;
   m.initialize(files);
+  if (!dex_files.empty()) {
+    print_coverage(m, dexes);
+  }
   g_redex = nullptr;
 }
@@ -28,6 +28,7 @@
 #include "InstructionLowering.h"
 #include "JarLoader.h"
 #include "Macros.h"
+#include "RedexMappedFile.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Walkers.h"
@@ -82,8 +83,17 @@ void init_ir_meta(DexStoresVector& stores) {
  */
 void write_ir_meta(const std::string& output_ir_dir, DexStoresVector& stores) {
   Timer t("Dumping IR meta");
-  Scope classes = build_class_scope(stores);
-  ir_meta_io::dump(classes, output_ir_dir);
+  // One part per dex that write_intermediate_dex writes, in the same order,
+  // so that they are written in parallel and can be split by dex.
+  std::vector<Scope> parts;
+  for (auto& store : stores) {
+    for (auto& dex : store.get_dexen()) {
+      if (!dex.empty()) {
+        parts.emplace_back(dex.begin(), dex.end());
+      }
+    }
+  }
+  ir_meta_io::dump(parts, output_ir_dir);
 }
 
 /**
@@ -141,19 +151,23 @@ void load_intermediate_dex(const std::string& input_ir_dir,
                            const Json::Value& dex_files,
                            DexStoresVector& stores) {
   Timer t("Load intermediate dex");
-  dex_stats_t dex_stats;
+  // All the dexes are loaded together, and then added to their stores.
+  std::vector<std::string> locations;
+  std::vector<size_t> location_stores;
   for (const Json::Value& store_files : dex_files) {
     DexStore store(store_files["name"].asString());
     stores.emplace_back(std::move(store));
     for (const Json::Value& file_name : store_files["list"]) {
       auto location = boost::filesystem::path(input_ir_dir);
       location /= file_name.asString();
-      // `string().c_str()` to get guaranteed `const char*`.
-      DexClasses classes =
-          load_classes_from_dex(location.string().c_str(), &dex_stats);
-      stores.back().add_classes(std::move(classes));
+      locations.push_back(location.string());
+      location_stores.push_back(stores.size() - 1);
     }
   }
+  auto dexes_classes = load_classes_from_dexes(locations, /* stats */ nullptr);
+  for (size_t i = 0; i < locations.size(); ++i) {
+    stores[location_stores[i]].add_classes(std::move(dexes_classes[i]));
+  }
 }
 
 /**
@@ -164,6 +178,36 @@ bool load_ir_meta(const std::string& input_ir_dir) {
   return ir_meta_io::load(input_ir_dir);
 }
 
+/**
+ * The dexes of an intermediate output, in the order of the dex list, which is
+ * also the order of the parts of the IR meta data.
+ */
+struct IntermediateDex {
+  size_t store;
+  std::string file_name;
+};
+
+std::vector<IntermediateDex> get_intermediate_dexes(
+    const Json::Value& dex_files) {
+  std::vector<IntermediateDex> dexes;
+  for (Json::ArrayIndex store = 0; store < dex_files.size(); ++store) {
+    for (const Json::Value& file_name : dex_files[store]["list"]) {
+      dexes.push_back(IntermediateDex{store, file_name.asString()});
+    }
+  }
+  return dexes;
+}
+
+void link_or_copy_file(const boost::filesystem::path& from,
+                       const boost::filesystem::path& to) {
+  boost::system::error_code ec;
+  boost::filesystem::remove(to);
+  boost::filesystem::create_hard_link(from, to, ec);
+  if (ec) {
+    boost::filesystem::copy_file(from, to);
+  }
+}
+
 static void assert_dex_magic_consistency(const std::string& source,
                                          const std::string& target) {
   always_assert_log(source.compare(target) == 0,
@@ -256,54 +300,208 @@ void load_all_intermediate(const std::string& input_ir_dir,
   }
 }
 
+std::string load_dex_magic(const std::string& filename) {
+  if (is_zip(filename)) {
+    ZipDexes zip_dexes(filename);
+    const auto& dexes = zip_dexes.get_dexes();
+    always_assert_log(!dexes.empty(), "%s contains no dex file\n",
+                      filename.c_str());
+    return dexes.front().dh->magic;
+  }
+  return load_dex_magic_from_dex(filename.c_str());
+}
+
 /**
  * Helper to load classes from a list of input dex files into a DexStoresVector.
- * Processes dex (.dex) files as well as DexMetadata files (.json)
+ * Processes dex (.dex) files, the dexes of zip files such as APKs, which are
+ * read in memory, as well as DexMetadata files (.json)
+ * Without `balloon`, the code of the methods is left lazy, see
+ * DexMethod::set_lazy_code().
  */
 void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
     DexStoresVector& stores,
     dex_stats_t& input_totals,
-    std::vector<dex_stats_t>& input_dexes_stats) {
+    std::vector<dex_stats_t>& input_dexes_stats,
+    bool balloon) {
   always_assert_log(!stores.empty(),
                     "Cannot load classes into empty DexStoresVector");
+  // Collect all dex files first, remembering which store each one belongs
+  // to, so that they can be loaded together.
+  std::vector<RedexMappedFile> mapped_files;
+  std::vector<std::unique_ptr<ZipDexes>> zips;
+  std::vector<DexBuffer> dexes;
+  // Index into `new_stores`, or -1 for the root store.
+  std::vector<int> dex_store_idx;
+  std::vector<DexStore> new_stores;
+  auto add_dex_file = [&](const std::string& path, int store_idx) {
+    mapped_files.push_back(RedexMappedFile::open(path));
+    const auto& file = mapped_files.back();
+    dexes.push_back(DexBuffer{
+        path, reinterpret_cast<const dex_header*>(file.const_data()),
+        file.size()});
+    assert_dex_magic_consistency(stores[0].get_dex_magic(),
+                                 dexes.back().dh->magic);
+    dex_store_idx.push_back(store_idx);
+  };
   for (const auto& filename : dex_files) {
     if (filename.size() >= 5 &&
         filename.compare(filename.size() - 4, 4, ".dex") == 0) {
-      assert_dex_magic_consistency(stores[0].get_dex_magic(),
-                                   load_dex_magic_from_dex(filename.c_str()));
-      dex_stats_t dex_stats;
-      DexClasses classes = load_classes_from_dex(filename.c_str(), &dex_stats);
-      input_totals += dex_stats;
-      input_dexes_stats.push_back(dex_stats);
-      stores[0].add_classes(std::move(classes));
+      add_dex_file(filename, -1);
     } else if (is_zip(filename)) {
-      std::cerr << "error: Input files are expected to be DEX (with filename "
-                   "ending in "
-                   ".dex), or a JSON metadata file. However, \""
-                << filename
-                << "\" is a ZIP. If this is an APK, please extract "
-                   "the DEX files from it and pass those as the inputs.";
-      exit(EXIT_FAILURE);
+      // The dexes of an APK go into the root store, in order.
+      zips.push_back(std::make_unique<ZipDexes>(filename));
+      for (const auto& dex : zips.back()->get_dexes()) {
+        assert_dex_magic_consistency(stores[0].get_dex_magic(), dex.dh->magic);
+        dexes.push_back(dex);
+        dex_store_idx.push_back(-1);
+      }
     } else {
       DexMetadata store_metadata;
       store_metadata.parse(filename);
-      DexStore store(store_metadata);
       for (const auto& file_path : store_metadata.get_files()) {
-        assert_dex_magic_consistency(
-            stores[0].get_dex_magic(),
-            load_dex_magic_from_dex(file_path.c_str()));
-        dex_stats_t dex_stats;
-        DexClasses classes =
-            load_classes_from_dex(file_path.c_str(), &dex_stats);
-
-        input_totals += dex_stats;
-        input_dexes_stats.push_back(dex_stats);
-        store.add_classes(std::move(classes));
+        add_dex_file(file_path, new_stores.size());
       }
-      stores.emplace_back(std::move(store));
+      new_stores.emplace_back(store_metadata);
+    }
+  }
+
+  std::vector<dex_stats_t> dexes_stats;
+  auto dexes_classes = load_classes_from_dexes(dexes, &dexes_stats, balloon);
+  if (!balloon) {
+    for (const auto& classes : dexes_classes) {
+      set_lazy_code(classes);
     }
   }
+  for (size_t i = 0; i < dexes.size(); ++i) {
+    input_totals += dexes_stats[i];
+    input_dexes_stats.push_back(dexes_stats[i]);
+    auto& store =
+        dex_store_idx[i] < 0 ? stores[0] : new_stores[dex_store_idx[i]];
+    store.add_classes(std::move(dexes_classes[i]));
+  }
+  for (auto& store : new_stores) {
+    stores.emplace_back(std::move(store));
+  }
+}
+
+/**
+ * Split the intermediate output of `input_ir_dir` by dex into `num_shards`
+ * intermediate outputs, `output_dir`/shard_<i>. Each shard gets a contiguous
+ * range of the dexes, balanced by size. All shards list all the stores, some
+ * of which may have no dexes, so that the root store stays first. The files
+ * are hard-linked when possible.
+ */
+void split_intermediate(const std::string& input_ir_dir,
+                        size_t num_shards,
+                        const std::string& output_dir) {
+  Timer t("Splitting intermediate output");
+  always_assert(num_shards > 0);
+  Json::Value entry_data;
+  load_entry_file(input_ir_dir, &entry_data);
+  const auto& dex_files = entry_data["dex_list"];
+  auto dexes = get_intermediate_dexes(dex_files);
+  std::vector<uint32_t> part_sizes;
+  always_assert_log(ir_meta_io::read_index(input_ir_dir, &part_sizes) &&
+                        part_sizes.size() == dexes.size(),
+                    "The IR meta data of %s is not split by dex",
+                    input_ir_dir.c_str());
+
+  std::vector<uintmax_t> dex_sizes;
+  uintmax_t total_size = 0;
+  for (const auto& dex : dexes) {
+    dex_sizes.push_back(boost::filesystem::file_size(
+        boost::filesystem::path(input_ir_dir) / dex.file_name));
+    total_size += dex_sizes.back();
+  }
+
+  size_t next_dex = 0;
+  uintmax_t assigned_size = 0;
+  for (size_t shard = 0; shard < num_shards; ++shard) {
+    // Take dexes until this shard's share of the total size is reached.
+    uintmax_t target_size = total_size * (shard + 1) / num_shards;
+    size_t end_dex = next_dex;
+    while (end_dex < dexes.size() &&
+           (shard + 1 == num_shards || assigned_size < target_size)) {
+      assigned_size += dex_sizes[end_dex++];
+    }
+
+    auto shard_dir = boost::filesystem::path(output_dir) /
+                     ("shard_" + std::to_string(shard));
+    boost::filesystem::create_directories(shard_dir / "meta");
+    Json::Value shard_entry_data = entry_data;
+    auto& shard_dex_files = shard_entry_data["dex_list"];
+    for (auto& store_files : shard_dex_files) {
+      store_files["list"] = Json::arrayValue;
+    }
+    std::vector<uint32_t> shard_part_sizes;
+    for (size_t d = next_dex; d < end_dex; ++d) {
+      const auto& dex = dexes[d];
+      shard_dex_files[(Json::ArrayIndex)dex.store]["list"].append(
+          dex.file_name);
+      link_or_copy_file(boost::filesystem::path(input_ir_dir) / dex.file_name,
+                        shard_dir / dex.file_name);
+      link_or_copy_file(
+          ir_meta_io::get_part_file(input_ir_dir, d),
+          ir_meta_io::get_part_file(shard_dir.string(),
+                                    shard_part_sizes.size()));
+      shard_part_sizes.push_back(part_sizes[d]);
+    }
+    ir_meta_io::write_index(shard_dir.string(), shard_part_sizes);
+    write_entry_file(shard_dir.string(), shard_entry_data);
+    next_dex = end_dex;
+  }
+}
+
+/**
+ * Merge the intermediate outputs of the shards of split_intermediate, after
+ * redex-opt ran on each of them, into `output_ir_dir`. The dexes of each
+ * store are concatenated in shard order, and renamed after their new
+ * position in the store.
+ */
+void merge_intermediate(const std::vector<std::string>& input_ir_dirs,
+                        const std::string& output_ir_dir) {
+  Timer t("Merging intermediate outputs");
+  always_assert(!input_ir_dirs.empty());
+  boost::filesystem::create_directories(
+      boost::filesystem::path(output_ir_dir) / "meta");
+  Json::Value entry_data;
+  load_entry_file(input_ir_dirs.front(), &entry_data);
+  auto& dex_files = entry_data["dex_list"];
+  for (auto& store_files : dex_files) {
+    store_files["list"] = Json::arrayValue;
+  }
+
+  std::vector<uint32_t> part_sizes;
+  for (const auto& input_ir_dir : input_ir_dirs) {
+    Json::Value shard_entry_data;
+    load_entry_file(input_ir_dir, &shard_entry_data);
+    const auto& shard_dex_files = shard_entry_data["dex_list"];
+    always_assert_log(shard_dex_files.size() == dex_files.size(),
+                      "%s does not have the stores of %s",
+                      input_ir_dir.c_str(), input_ir_dirs.front().c_str());
+    auto dexes = get_intermediate_dexes(shard_dex_files);
+    std::vector<uint32_t> shard_part_sizes;
+    always_assert_log(
+        ir_meta_io::read_index(input_ir_dir, &shard_part_sizes) &&
+            shard_part_sizes.size() == dexes.size(),
+        "The IR meta data of %s is not split by dex", input_ir_dir.c_str());
+    for (size_t d = 0; d < dexes.size(); ++d) {
+      const auto& dex = dexes[d];
+      auto& store_files = dex_files[(Json::ArrayIndex)dex.store];
+      DexStore store(store_files["name"].asString());
+      auto file_name = dex_name(store, store_files["list"].size());
+      store_files["list"].append(file_name);
+      link_or_copy_file(boost::filesystem::path(input_ir_dir) / dex.file_name,
+                        boost::filesystem::path(output_ir_dir) / file_name);
+      link_or_copy_file(
+          ir_meta_io::get_part_file(input_ir_dir, d),
+          ir_meta_io::get_part_file(output_ir_dir, part_sizes.size()));
+      part_sizes.push_back(shard_part_sizes[d]);
+    }
+  }
+  ir_meta_io::write_index(output_ir_dir, part_sizes);
+  write_entry_file(output_ir_dir, entry_data);
 }
 
 /**
@@ -26,11 +26,23 @@ void load_all_intermediate(const std::string& input_ir_dir,
                            DexStoresVector& stores,
                            Json::Value* entry_data);
 
+void split_intermediate(const std::string& input_ir_dir,
+                        size_t num_shards,
+                        const std::string& output_dir);
+
+void merge_intermediate(const std::vector<std::string>& input_ir_dirs,
+                        const std::string& output_ir_dir);
+
+// The dex magic of a dex file, or of the first dex of a zip file such as an
+// APK.
+std::string load_dex_magic(const std::string& filename);
+
 void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
     DexStoresVector& stores,
     dex_stats_t& input_totals,
-    std::vector<dex_stats_t>& input_dexes_stats);
+    std::vector<dex_stats_t>& input_dexes_stats,
+    bool balloon = true);
 
 std::string get_dex_output_name(const std::string& output_dir,
                                 const DexStore& store,
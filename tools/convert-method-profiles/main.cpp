@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iostream>
+
+#include "MethodProfiles.h"
+#include "RedexContext.h"
+
+int main(int argc, char* argv[]) {
+  if (argc < 3 || std::string("--help") == argv[1] ||
+      std::string("-h") == argv[1]) {
+    // Too few args (or help), print usage.
+    std::cerr << "Usage: convert-method-profiles OUT PROF-FILE [PROF-FILE...]"
+              << std::endl;
+    return argc < 3 ? 1 : 0;
+  }
+
+  std::vector<std::string> files;
+  for (int i = 2; i < argc; ++i) {
+    files.push_back(argv[i]);
+  }
+
+  RedexContext rc;
+  g_redex = &rc;
+  bool success =
+      method_profiles::MethodProfiles::convert_to_binary(files, argv[1]);
+  g_redex = nullptr;
+  return success ? 0 : 1;
+}
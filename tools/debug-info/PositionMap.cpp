@@ -6,15 +6,23 @@
  */
 
 #include <boost/scope_exit.hpp>
+#include <cstring>
 #include <fcntl.h>
 #include <iostream>
 #include <memory>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "PositionMap.h"
 
+PositionMap::~PositionMap() {
+  if (mapping != nullptr) {
+    munmap(mapping, mapping_size);
+  }
+}
+
 std::unique_ptr<PositionMap> read_map(const char* filename) {
   int fd = open(filename, O_RDONLY);
   if (fd == -1) {
@@ -22,60 +30,101 @@ std::unique_ptr<PositionMap> read_map(const char* filename) {
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
+  // The mapping stays valid after the file is closed.
+  BOOST_SCOPE_EXIT_ALL(=) { close(fd); };
   struct stat buf;
   if (fstat(fd, &buf)) {
     std::cerr << "Cannot fstat file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
-  uint8_t* mapping = (uint8_t*)mmap(
-      nullptr, buf.st_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
-  uint32_t magic = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  if (mapping == MAP_FAILED) {
+  size_t size = buf.st_size;
+  void* base = mmap(nullptr, size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
     std::cerr << "mmap failed for file (" << filename
               << ") with error: " << strerror(errno) << std::endl;
     return nullptr;
   }
-  BOOST_SCOPE_EXIT_ALL(=, &buf) { munmap(mapping, buf.st_size); };
+  std::unique_ptr<PositionMap> map(new PositionMap());
+  map->mapping = base;
+  map->mapping_size = size;
+
+  const uint8_t* mapping = (const uint8_t*)base;
+  const uint8_t* end = mapping + size;
+  auto read_u32 = [&](uint32_t* out) {
+    if (end - mapping < (ptrdiff_t)sizeof(uint32_t)) {
+      return false;
+    }
+    memcpy(out, mapping, sizeof(uint32_t));
+    mapping += sizeof(uint32_t);
+    return true;
+  };
+  auto truncated = [&]() {
+    std::cerr << "Truncated line map (" << filename << ")\n";
+    return nullptr;
+  };
+
+  uint32_t magic;
+  if (!read_u32(&magic)) {
+    return truncated();
+  }
   if (magic != 0xfaceb000) {
     std::cerr << "Magic number mismatch\n";
     return nullptr;
   }
-  uint32_t version = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  uint32_t version;
+  if (!read_u32(&version)) {
+    return truncated();
+  }
   if (version != 2) {
     std::cerr << "Version mismatch\n";
     return nullptr;
   }
 
-  std::unique_ptr<PositionMap> map(new PositionMap());
-  std::vector<std::string> string_pool;
-  uint32_t spool_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
+  uint32_t spool_count;
+  if (!read_u32(&spool_count)) {
+    return truncated();
+  }
+  map->string_pool.reserve(spool_count);
   for (uint32_t i = 0; i < spool_count; ++i) {
-    uint32_t ssize = *(uint32_t*)mapping;
-    mapping += sizeof(uint32_t);
+    uint32_t ssize;
+    if (!read_u32(&ssize) || end - mapping < (ptrdiff_t)ssize) {
+      return truncated();
+    }
     map->string_pool.emplace_back((const char*)mapping, ssize);
     mapping += ssize;
   }
-  uint32_t pos_count = *(uint32_t*)mapping;
-  mapping += sizeof(uint32_t);
-  map->positions.reset(new PositionItem[pos_count]);
+  uint32_t pos_count;
+  if (!read_u32(&pos_count) ||
+      (size_t)(end - mapping) < pos_count * sizeof(PositionItem)) {
+    return truncated();
+  }
+  map->positions = (const PositionItem*)mapping;
   map->positions_size = pos_count;
-  memcpy(map->positions.get(), mapping, pos_count * sizeof(PositionItem));
+  for (size_t i = 0; i < map->positions_size; ++i) {
+    const auto& pi = map->positions[i];
+    if (pi.class_id >= spool_count || pi.method_id >= spool_count ||
+        pi.file_id >= spool_count) {
+      std::cerr << "Invalid string id in line map (" << filename << ")\n";
+      return nullptr;
+    }
+  }
   return map;
 }
 
 std::vector<Position> get_stack(const PositionMap& map, int64_t idx) {
   std::vector<Position> stack;
   while (idx >= 0 && (size_t)idx < map.positions_size) {
-    auto pi = map.positions[idx];
-    stack.push_back(Position(map.string_pool[pi.class_id],
-                             map.string_pool[pi.method_id],
-                             map.string_pool[pi.file_id],
+    const auto& pi = map.positions[idx];
+    stack.push_back(Position(std::string(map.string_pool[pi.class_id]),
+                             std::string(map.string_pool[pi.method_id]),
+                             std::string(map.string_pool[pi.file_id]),
                              pi.line));
-    idx = (int64_t)pi.parent - 1;
+    auto parent = (int64_t)pi.parent - 1;
+    if (parent == idx) {
+      break;
+    }
+    idx = parent;
   }
   return stack;
 }
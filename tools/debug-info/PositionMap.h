@@ -5,8 +5,13 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 struct __attribute__((packed)) PositionItem {
@@ -29,10 +34,24 @@ struct Position {
       : cls(cls), method(method), filename(filename), line(line) {}
 };
 
+/*
+ * A line map, as written by RealPositionMapper. The file stays mapped for the
+ * lifetime of the PositionMap: the strings and positions point into it, so
+ * loading a map only scans its string pool, and the map can be shared by any
+ * number of threads.
+ */
 struct PositionMap {
-  std::vector<std::string> string_pool;
-  std::unique_ptr<PositionItem[]> positions;
-  size_t positions_size;
+  std::vector<std::string_view> string_pool;
+  const PositionItem* positions{nullptr};
+  size_t positions_size{0};
+
+  PositionMap() = default;
+  PositionMap(const PositionMap&) = delete;
+  PositionMap& operator=(const PositionMap&) = delete;
+  ~PositionMap();
+
+  void* mapping{nullptr};
+  size_t mapping_size{0};
 };
 
 std::unique_ptr<PositionMap> read_map(const char* filename);
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Symbolicator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/regex.hpp>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+// A frame whose line number is an index into the line map, e.g.
+// "\tat X.A01.a(:123)".
+const boost::regex s_line_map_frame_regex(
+    R"/(((\s+at\s+)[^(]*)\(:(\d+)\)\s?)/");
+
+// Any frame, e.g. "\tat X.A01.a(Unknown Source)".
+const boost::regex s_frame_regex(R"/((\s+at\s+)([^(\s]+)\.([^.(\s]+)(\(.*))/");
+
+// Lines are handed out to the threads in chunks of this many.
+constexpr size_t kChunkSize = 64;
+
+std::string trim(const std::string& s) {
+  auto begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos) {
+    return "";
+  }
+  auto end = s.find_last_not_of(" \t\r");
+  return s.substr(begin, end - begin + 1);
+}
+
+} // namespace
+
+std::unique_ptr<Symbolicator> Symbolicator::load(
+    const std::string& line_map_file, const std::string& pg_map_file) {
+  std::unique_ptr<Symbolicator> symbolicator(new Symbolicator());
+  symbolicator->m_line_map = read_map(line_map_file.c_str());
+  if (!symbolicator->m_line_map) {
+    return nullptr;
+  }
+  if (!pg_map_file.empty() && !symbolicator->read_pg_map(pg_map_file)) {
+    return nullptr;
+  }
+  return symbolicator;
+}
+
+bool Symbolicator::read_pg_map(const std::string& pg_map_file) {
+  std::ifstream in(pg_map_file);
+  if (!in) {
+    std::cerr << "Cannot open ProGuard mapping (" << pg_map_file << ")\n";
+    return false;
+  }
+  ClassMapping* current = nullptr;
+  for (std::string line; std::getline(in, line);) {
+    auto arrow = line.find(" -> ");
+    if (arrow == std::string::npos) {
+      continue;
+    }
+    auto original = trim(line.substr(0, arrow));
+    auto obfuscated = trim(line.substr(arrow + 4));
+    if (line[0] != ' ') {
+      // "com.foo.Bar -> X.A01:"
+      if (!obfuscated.empty() && obfuscated.back() == ':') {
+        obfuscated.pop_back();
+      }
+      current = &m_classes[obfuscated];
+      current->original_name = original;
+      continue;
+    }
+    // Methods look like "[1:2:]void bar(int) -> a"; fields have no "(".
+    if (current == nullptr || original.empty() || original.back() != ')') {
+      continue;
+    }
+    auto paren = original.find('(');
+    if (paren == std::string::npos) {
+      continue;
+    }
+    auto name_start = original.rfind(' ', paren);
+    name_start = name_start == std::string::npos ? 0 : name_start + 1;
+    current->methods.emplace(obfuscated,
+                             original.substr(name_start, paren - name_start));
+  }
+  return true;
+}
+
+std::string Symbolicator::deobfuscate_frame(const std::string& frame) const {
+  boost::smatch matches;
+  if (m_classes.empty() || !boost::regex_match(frame, matches, s_frame_regex)) {
+    return frame + "\n";
+  }
+  auto it = m_classes.find(matches[2]);
+  if (it == m_classes.end()) {
+    return frame + "\n";
+  }
+  const auto& cls = it->second;
+  auto method_it = cls.methods.find(matches[3]);
+  const std::string& method =
+      method_it == cls.methods.end() ? matches[3].str() : method_it->second;
+  return matches[1] + cls.original_name + "." + method + matches[4] + "\n";
+}
+
+std::string Symbolicator::symbolicate_line(const std::string& line) const {
+  boost::smatch matches;
+  if (!boost::regex_match(line, matches, s_line_map_frame_regex)) {
+    return deobfuscate_frame(line);
+  }
+  auto idx = std::stoll(matches[3]) - 1;
+  auto stack = get_stack(*m_line_map, idx);
+  if (stack.empty()) {
+    return deobfuscate_frame(line);
+  }
+  std::string result;
+  for (const auto& pos : stack) {
+    result += matches[2];
+    result += pos.cls;
+    result += ".";
+    result += pos.method;
+    result += "(";
+    result += pos.filename;
+    result += ":";
+    result += std::to_string(pos.line);
+    result += ")\n";
+  }
+  return result;
+}
+
+std::vector<std::string> Symbolicator::symbolicate_lines(
+    const std::vector<std::string>& lines, size_t num_threads) const {
+  std::vector<std::string> results(lines.size());
+  std::atomic<size_t> next_chunk{0};
+  auto work = [&]() {
+    for (;;) {
+      size_t begin = next_chunk.fetch_add(kChunkSize);
+      if (begin >= lines.size()) {
+        return;
+      }
+      size_t end = std::min(begin + kChunkSize, lines.size());
+      for (size_t i = begin; i < end; ++i) {
+        results[i] = symbolicate_line(lines[i]);
+      }
+    }
+  };
+  num_threads = std::min(num_threads,
+                         (lines.size() + kChunkSize - 1) / kChunkSize);
+  if (num_threads <= 1) {
+    work();
+    return results;
+  }
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "PositionMap.h"
+
+/*
+ * Symbolicates stack traces against one build's symbol files, loaded once.
+ *
+ * Frames whose line number is an index into the line map are expanded into
+ * their (possibly inlined) original frames. Other frames get their class and
+ * method names deobfuscated through a hash table built from the ProGuard
+ * mapping, when one is given.
+ *
+ * A Symbolicator is immutable once loaded, so it can serve any number of
+ * threads, e.g. in a long-running symbolication service.
+ */
+class Symbolicator {
+ public:
+  // Returns nullptr if the line map cannot be read. The ProGuard mapping is
+  // optional; pass an empty string to go without.
+  static std::unique_ptr<Symbolicator> load(const std::string& line_map_file,
+                                            const std::string& pg_map_file);
+
+  // Symbolicates a single trace line, without its line terminator. The
+  // result holds one line per frame, each terminated by a newline.
+  std::string symbolicate_line(const std::string& line) const;
+
+  // Symbolicates `lines` on up to `num_threads` threads. The i-th result is
+  // the symbolication of the i-th line.
+  std::vector<std::string> symbolicate_lines(
+      const std::vector<std::string>& lines, size_t num_threads) const;
+
+ private:
+  struct ClassMapping {
+    std::string original_name;
+    // Obfuscated method name to original method name. Overloads that were
+    // renamed to the same name map to the first original name.
+    std::unordered_map<std::string, std::string> methods;
+  };
+
+  Symbolicator() = default;
+  bool read_pg_map(const std::string& pg_map_file);
+  std::string deobfuscate_frame(const std::string& frame) const;
+
+  std::unique_ptr<PositionMap> m_line_map;
+  // Keyed by obfuscated external class name, e.g. "X.A01".
+  std::unordered_map<std::string, ClassMapping> m_classes;
+};
@@ -5,31 +5,73 @@
  * LICENSE file in the root directory of this source tree.
  */
 
-#include <boost/regex.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
 
-#include "PositionMap.h"
+#include "Symbolicator.h"
 
-boost::regex trace_regex(R"/(((\s+at\s+)[^(]*)\(:(\d+)\)\s?)/");
+namespace {
 
+void print_usage() {
+  std::cerr << "Usage: cat trace | remap [-j threads] [-b batch-lines] "
+               "[-p proguard-mapping] mapping_file\n";
+}
+
+} // namespace
+
+/*
+ * Reads trace lines from stdin until EOF, and writes their symbolication to
+ * stdout, in order. The symbol files are loaded once, so many traces can be
+ * piped through a single invocation; lines are symbolicated in batches, on
+ * several threads.
+ */
 int main(int argc, char** argv) {
-  if (argc < 2) {
-    std::cerr << "Usage: cat trace | remap mapping_file\n";
+  size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t batch_lines = 1 << 16;
+  std::string pg_map_file;
+  int arg = 1;
+  for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+    if (strcmp(argv[arg], "-j") == 0) {
+      num_threads = std::max(1L, atol(argv[arg + 1]));
+    } else if (strcmp(argv[arg], "-b") == 0) {
+      batch_lines = std::max(1L, atol(argv[arg + 1]));
+    } else if (strcmp(argv[arg], "-p") == 0) {
+      pg_map_file = argv[arg + 1];
+    } else {
+      print_usage();
+      abort();
+    }
+  }
+  if (arg + 1 != argc) {
+    print_usage();
     abort();
   }
-  auto map = read_map(argv[1]);
+  auto symbolicator = Symbolicator::load(argv[arg], pg_map_file);
+  if (!symbolicator) {
+    return 1;
+  }
+
+  std::ios::sync_with_stdio(false);
+  std::vector<std::string> lines;
+  lines.reserve(batch_lines);
+  auto flush = [&]() {
+    for (const auto& result :
+         symbolicator->symbolicate_lines(lines, num_threads)) {
+      std::cout << result;
+    }
+    lines.clear();
+  };
   for (std::string line; std::getline(std::cin, line);) {
-    boost::smatch matches;
-    if (boost::regex_match(line, matches, trace_regex)) {
-      auto idx = std::stoi(matches[3]) - 1;
-      auto stack = get_stack(*map, idx);
-      for (const auto& pos : stack) {
-        std::cout << matches[2] << pos.cls << "." << pos.method << "("
-                  << pos.filename << ":" << pos.line << ")" << std::endl;
-      }
-    } else {
-      std::cout << line << std::endl;
+    lines.push_back(std::move(line));
+    if (lines.size() == batch_lines) {
+      flush();
     }
   }
+  flush();
+  std::cout.flush();
 }
@@ -5,28 +5,210 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <getopt.h>
 #include <regex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "DexCommon.h"
+#include "DexIndex.h"
+
+namespace {
 
 void print_usage() {
-  fprintf(stderr, "Usage: dexgrep <classname> <dexfile 1> <dexfile 2> ...\n");
+  fprintf(stderr,
+          "Usage: dexgrep [-l] [-F] [-j jobs] [-s|-t|-m] <pattern> "
+          "<dexfile 1> <dexfile 2> ...\n"
+          "       dexgrep [-l] [-F] [-s|-t|-m] --index=<index> <pattern>\n"
+          "       dexgrep [-j jobs] --build-index=<index> "
+          "<dexfile 1> <dexfile 2> ...\n"
+          "\n"
+          "Without -s, -t or -m, lists the classes whose name matches "
+          "<pattern>.\n"
+          "  -s, --string   list the classes referring to a matching string\n"
+          "  -t, --type     list the classes referring to a matching type\n"
+          "  -m, --method   list the classes referring to a matching method,\n"
+          "                 named like Lcls;.name:(args)rtype\n"
+          "  -F, --fixed-strings  match <pattern> exactly, not as a regex\n"
+          "  -l, --files-without-match  only print the dex file names\n"
+          "  -j, --jobs     number of dex files scanned at once\n"
+          "  --build-index  write an index of the dex files, to be queried "
+          "with --index\n");
+}
+
+// The kind of reference being searched for; NUM_REF_KINDS stands for the
+// class names themselves.
+constexpr RefKind kClassNames = NUM_REF_KINDS;
+
+struct Pattern {
+  bool fixed;
+  std::string text;
+  std::regex re;
+
+  bool matches(const std::string& s) const {
+    return fixed ? s == text : std::regex_search(s, re);
+  }
+};
+
+void print_match(bool files_only,
+                 const std::string& dexfile,
+                 const std::string& name,
+                 std::string* out) {
+  *out += dexfile;
+  if (!files_only) {
+    *out += ": ";
+    *out += name;
+  }
+  *out += "\n";
+}
+
+// Scans one dex file, and returns what should be printed for it.
+std::string grep_dex(const std::string& dexfile,
+                     RefKind kind,
+                     const Pattern& pattern,
+                     bool files_only) {
+  ddump_data rd;
+  open_dex_file(dexfile.c_str(), &rd);
+  // Match every entry of the table once, rather than once per reference.
+  std::vector<bool> matched;
+  if (kind != kClassNames) {
+    matched.resize(ref_table_size(&rd, kind));
+    for (uint32_t idx = 0; idx < matched.size(); idx++) {
+      matched[idx] = pattern.matches(ref_name(&rd, kind, idx));
+    }
+  }
+  std::string out;
+  for (uint32_t j = 0; j < rd.dexh->class_defs_size; j++) {
+    const dex_class_def* cls = rd.dex_class_defs + j;
+    std::string name = dex_string_by_type_idx(&rd, cls->typeidx);
+    bool found = false;
+    if (kind == kClassNames) {
+      found = pattern.matches(name);
+    } else {
+      for_each_class_ref(&rd, cls, [&](RefKind ref_kind, uint32_t idx) {
+        found |= ref_kind == kind && idx < matched.size() && matched[idx];
+      });
+    }
+    if (found) {
+      print_match(files_only, dexfile, name, &out);
+    }
+  }
+  return out;
+}
+
+void grep_dexes(const std::vector<std::string>& dexfiles,
+                size_t num_jobs,
+                RefKind kind,
+                const Pattern& pattern,
+                bool files_only) {
+  // Dex files are scanned by windows of num_jobs, and printed in order.
+  for (size_t begin = 0; begin < dexfiles.size(); begin += num_jobs) {
+    size_t end = std::min(begin + num_jobs, dexfiles.size());
+    std::vector<std::string> outputs(end - begin);
+    parallel_for(outputs.size(), num_jobs, [&](size_t i) {
+      outputs[i] = grep_dex(dexfiles[begin + i], kind, pattern, files_only);
+    });
+    for (const auto& out : outputs) {
+      fputs(out.c_str(), stdout);
+    }
+  }
+}
+
+void grep_index(const DexIndex& index,
+                RefKind kind,
+                const Pattern& pattern,
+                bool files_only) {
+  std::vector<uint32_t> ids;
+  if (kind == kClassNames) {
+    for (uint32_t id = 0; id < index.classes.size(); id++) {
+      if (pattern.matches(index.classes[id].name)) {
+        ids.push_back(id);
+      }
+    }
+  } else {
+    const auto& refs = index.refs[kind];
+    auto add = [&](const DexIndex::Postings& postings) {
+      ids.insert(ids.end(), postings.begin(), postings.end());
+    };
+    if (pattern.fixed) {
+      auto it = std::lower_bound(
+          refs.begin(), refs.end(), pattern.text,
+          [](const auto& ref, const std::string& s) { return ref.first < s; });
+      if (it != refs.end() && it->first == pattern.text) {
+        add(it->second);
+      }
+    } else {
+      for (const auto& ref : refs) {
+        if (pattern.matches(ref.first)) {
+          add(ref.second);
+        }
+      }
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+  }
+  std::string out;
+  for (auto id : ids) {
+    const auto& cls = index.classes[id];
+    print_match(files_only, index.dex_files[cls.dex], cls.name, &out);
+  }
+  fputs(out.c_str(), stdout);
 }
 
+} // namespace
+
 int main(int argc, char* argv[]) {
   bool files_only = false;
-  char c;
+  bool fixed = false;
+  RefKind kind = kClassNames;
+  size_t num_jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string index_file;
+  std::string build_index_file;
+  int c;
+  enum { INDEX = 256, BUILD_INDEX };
   static const struct option options[] = {
       {"files-without-match", no_argument, nullptr, 'l'},
+      {"fixed-strings", no_argument, nullptr, 'F'},
+      {"string", no_argument, nullptr, 's'},
+      {"type", no_argument, nullptr, 't'},
+      {"method", no_argument, nullptr, 'm'},
+      {"jobs", required_argument, nullptr, 'j'},
+      {"index", required_argument, nullptr, INDEX},
+      {"build-index", required_argument, nullptr, BUILD_INDEX},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
   };
-  while ((c = getopt_long(argc, argv, "hl", &options[0], nullptr)) != -1) {
+  while ((c = getopt_long(argc, argv, "hlFstmj:", &options[0], nullptr)) !=
+         -1) {
     switch (c) {
     case 'l':
       files_only = true;
       break;
+    case 'F':
+      fixed = true;
+      break;
+    case 's':
+      kind = REF_STRING;
+      break;
+    case 't':
+      kind = REF_TYPE;
+      break;
+    case 'm':
+      kind = REF_METHOD;
+      break;
+    case 'j':
+      num_jobs = std::max(1L, atol(optarg));
+      break;
+    case INDEX:
+      index_file = optarg;
+      break;
+    case BUILD_INDEX:
+      build_index_file = optarg;
+      break;
     case 'h':
       print_usage();
       return 0;
@@ -36,31 +218,44 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (!build_index_file.empty()) {
+    if (optind == argc) {
+      fprintf(stderr, "%s: no dex files given\n", argv[0]);
+      print_usage();
+      return 1;
+    }
+    std::vector<std::string> dexfiles(argv + optind, argv + argc);
+    return DexIndex::build(dexfiles, num_jobs).write(build_index_file) ? 0 : 1;
+  }
+
   if (optind == argc) {
-    fprintf(stderr, "%s: no dex files given\n", argv[0]);
+    fprintf(stderr, "%s: no pattern given\n", argv[0]);
     print_usage();
     return 1;
   }
+  Pattern pattern{fixed, argv[optind], std::regex()};
+  if (!fixed) {
+    pattern.re = std::regex(pattern.text);
+  }
 
-  const char* search_str = argv[optind];
-  std::regex re(search_str);
-
-  for (int i = optind + 1; i < argc; ++i) {
-    const char* dexfile = argv[i];
-    ddump_data rd;
-    open_dex_file(dexfile, &rd);
-
-    auto size = rd.dexh->class_defs_size;
-    for (uint32_t j = 0; j < size; j++) {
-      dex_class_def* cls_def = rd.dex_class_defs + j;
-      char* name = dex_string_by_type_idx(&rd, cls_def->typeidx);
-      if (std::regex_search(name, re)) {
-        if (files_only) {
-          printf("%s\n", dexfile);
-        } else {
-          printf("%s: %s\n", dexfile, name);
-        }
-      }
+  if (!index_file.empty()) {
+    if (optind + 1 != argc) {
+      fprintf(stderr, "%s: dex files cannot be given with --index\n", argv[0]);
+      return 1;
     }
+    DexIndex index;
+    if (!index.read(index_file)) {
+      return 1;
+    }
+    grep_index(index, kind, pattern, files_only);
+    return 0;
+  }
+
+  if (optind + 1 == argc) {
+    fprintf(stderr, "%s: no dex files given\n", argv[0]);
+    print_usage();
+    return 1;
   }
+  std::vector<std::string> dexfiles(argv + optind + 1, argv + argc);
+  grep_dexes(dexfiles, num_jobs, kind, pattern, files_only);
 }
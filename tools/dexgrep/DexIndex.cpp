@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+
+#include "DexEncoding.h"
+#include "DexOpcodeDefs.h"
+
+namespace {
+
+constexpr uint32_t kIndexMagic = 0x49475844; // "DXGI"
+constexpr uint32_t kIndexVersion = 1;
+
+size_t format_units(OpcodeFormat fmt) {
+  switch (fmt) {
+  case FMT_f10x:
+  case FMT_f12x:
+  case FMT_f12x_2:
+  case FMT_f11n:
+  case FMT_f11x_d:
+  case FMT_f11x_s:
+  case FMT_f10t:
+    return 1;
+  case FMT_f20t:
+  case FMT_f20bc:
+  case FMT_f22x:
+  case FMT_f21t:
+  case FMT_f21s:
+  case FMT_f21h:
+  case FMT_f21c_d:
+  case FMT_f21c_s:
+  case FMT_f23x_d:
+  case FMT_f23x_s:
+  case FMT_f22b:
+  case FMT_f22t:
+  case FMT_f22s:
+  case FMT_f22c_d:
+  case FMT_f22c_s:
+  case FMT_f22cs:
+    return 2;
+  case FMT_f30t:
+  case FMT_f32x:
+  case FMT_f31i:
+  case FMT_f31t:
+  case FMT_f31c:
+  case FMT_f35c:
+  case FMT_f35ms:
+  case FMT_f35mi:
+  case FMT_f3rc:
+  case FMT_f3rms:
+  case FMT_f3rmi:
+    return 3;
+  case FMT_f45cc:
+  case FMT_f4rcc:
+    return 4;
+  case FMT_f51l:
+    return 5;
+  default:
+    return 0;
+  }
+}
+
+// Returns the number of code units taken by the instruction or payload at
+// `insns`, or 0 if it is malformed or runs past `end`.
+size_t insn_units(const uint16_t* insns, const uint16_t* end) {
+  size_t avail = end - insns;
+  size_t units = 0;
+  switch (*insns) {
+  case FOPCODE_PACKED_SWITCH:
+    units = avail < 2 ? 0 : 4 + (size_t)insns[1] * 2;
+    break;
+  case FOPCODE_SPARSE_SWITCH:
+    units = avail < 2 ? 0 : 2 + (size_t)insns[1] * 4;
+    break;
+  case FOPCODE_FILLED_ARRAY:
+    if (avail >= 4) {
+      uint64_t size = insns[2] | (uint32_t)insns[3] << 16;
+      units = 4 + (size * insns[1] + 1) / 2;
+    }
+    break;
+  default:
+    switch (*insns & 0xff) {
+#define OP(op, code, fmt, ...)         \
+  case code:                           \
+    units = format_units(FMT_##fmt); \
+    break;
+      DOPS QDOPS
+#undef OP
+    }
+  }
+  return units <= avail ? units : 0;
+}
+
+void for_each_code_ref(const dex_code_item* code,
+                       const std::function<void(RefKind, uint32_t)>& fn) {
+  auto insns = (const uint16_t*)(code + 1);
+  auto end = insns + code->insns_size;
+  while (insns < end) {
+    size_t units = insn_units(insns, end);
+    if (units == 0) {
+      return;
+    }
+    switch (*insns & 0xff) {
+      SWITCH_FORMAT_CONST_STRING {
+        fn(REF_STRING, insns[1]);
+        break;
+      }
+      SWITCH_FORMAT_CONST_STRING_JUMBO {
+        fn(REF_STRING, insns[1] | (uint32_t)insns[2] << 16);
+        break;
+      }
+      SWITCH_FORMAT_TYPE_REF
+      SWITCH_FORMAT_FILL_ARRAY {
+        fn(REF_TYPE, insns[1]);
+        break;
+      }
+    // Not SWITCH_FORMAT_REGULAR_METHOD_REF: invoke-custom refers to a call
+    // site, not a method.
+    case DOPCODE_INVOKE_VIRTUAL:
+    case DOPCODE_INVOKE_SUPER:
+    case DOPCODE_INVOKE_DIRECT:
+    case DOPCODE_INVOKE_STATIC:
+    case DOPCODE_INVOKE_INTERFACE:
+    case DOPCODE_INVOKE_POLYMORPHIC:
+    case DOPCODE_INVOKE_VIRTUAL_RANGE:
+    case DOPCODE_INVOKE_SUPER_RANGE:
+    case DOPCODE_INVOKE_DIRECT_RANGE:
+    case DOPCODE_INVOKE_STATIC_RANGE:
+    case DOPCODE_INVOKE_INTERFACE_RANGE:
+    case DOPCODE_INVOKE_POLYMORPHIC_RANGE:
+      fn(REF_METHOD, insns[1]);
+      break;
+    default:
+      break;
+    }
+    insns += units;
+  }
+}
+
+uint32_t read_u32(std::istream& in) {
+  uint32_t v = 0;
+  in.read((char*)&v, sizeof(v));
+  return v;
+}
+
+std::string read_str(std::istream& in) {
+  uint32_t size = read_u32(in);
+  if (!in) {
+    return "";
+  }
+  std::string s(size, '\0');
+  in.read(&s[0], size);
+  return s;
+}
+
+void write_u32(std::ostream& out, uint32_t v) {
+  out.write((const char*)&v, sizeof(v));
+}
+
+void write_str(std::ostream& out, const std::string& s) {
+  write_u32(out, s.size());
+  out.write(s.data(), s.size());
+}
+
+} // namespace
+
+void for_each_class_ref(ddump_data* rd,
+                        const dex_class_def* cls,
+                        const std::function<void(RefKind, uint32_t)>& fn) {
+  if (cls->super_idx != DEX_NO_INDEX) {
+    fn(REF_TYPE, cls->super_idx);
+  }
+  if (cls->interfaces_off) {
+    auto tl = (const uint32_t*)(rd->dexmmap + cls->interfaces_off);
+    auto types = (const dex_type_item*)(tl + 1);
+    for (uint32_t i = 0; i < *tl; i++) {
+      fn(REF_TYPE, types[i].type_idx);
+    }
+  }
+  if (!cls->class_data_offset) {
+    return;
+  }
+  auto data = (const uint8_t*)(rd->dexmmap + cls->class_data_offset);
+  uint32_t num_fields = read_uleb128(&data);
+  num_fields += read_uleb128(&data);
+  uint32_t num_methods = read_uleb128(&data);
+  num_methods += read_uleb128(&data);
+  for (uint32_t i = 0; i < num_fields; i++) {
+    read_uleb128(&data); // field_idx_diff
+    read_uleb128(&data); // access_flags
+  }
+  for (uint32_t i = 0; i < num_methods; i++) {
+    read_uleb128(&data); // method_idx_diff
+    read_uleb128(&data); // access_flags
+    uint32_t code_off = read_uleb128(&data);
+    if (code_off) {
+      for_each_code_ref((const dex_code_item*)(rd->dexmmap + code_off), fn);
+    }
+  }
+}
+
+std::string ref_name(ddump_data* rd, RefKind kind, uint32_t idx) {
+  switch (kind) {
+  case REF_STRING:
+    return dex_string_by_idx(rd, idx);
+  case REF_TYPE:
+    return dex_string_by_type_idx(rd, idx);
+  default:
+    break;
+  }
+  const dex_method_id* method = rd->dex_method_ids + idx;
+  const dex_proto_id* proto = rd->dex_proto_ids + method->protoidx;
+  std::string name = dex_string_by_type_idx(rd, method->classidx);
+  name += ".";
+  name += dex_string_by_idx(rd, method->nameidx);
+  name += ":(";
+  if (proto->param_off) {
+    auto tl = (const uint32_t*)(rd->dexmmap + proto->param_off);
+    auto types = (const dex_type_item*)(tl + 1);
+    for (uint32_t i = 0; i < *tl; i++) {
+      name += dex_string_by_type_idx(rd, types[i].type_idx);
+    }
+  }
+  name += ")";
+  name += dex_string_by_type_idx(rd, proto->rtypeidx);
+  return name;
+}
+
+uint32_t ref_table_size(const ddump_data* rd, RefKind kind) {
+  switch (kind) {
+  case REF_STRING:
+    return rd->dexh->string_ids_size;
+  case REF_TYPE:
+    return rd->dexh->type_ids_size;
+  case REF_METHOD:
+    return rd->dexh->method_ids_size;
+  default:
+    return 0;
+  }
+}
+
+void parallel_for(size_t size,
+                  size_t num_threads,
+                  const std::function<void(size_t)>& fn) {
+  std::atomic<size_t> next{0};
+  auto work = [&]() {
+    for (size_t i = next++; i < size; i = next++) {
+      fn(i);
+    }
+  };
+  num_threads = std::min(num_threads, size);
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < num_threads; t++) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+DexIndex DexIndex::build(const std::vector<std::string>& dex_files,
+                         size_t num_threads) {
+  // Each dex is indexed on its own, with dex-local class ids, and the
+  // results are merged in dex order, so that every posting list comes out
+  // sorted.
+  struct DexRefs {
+    std::vector<ClassEntry> classes;
+    std::vector<std::pair<std::string, Postings>> refs[NUM_REF_KINDS];
+  };
+  std::vector<DexRefs> dex_refs(dex_files.size());
+  parallel_for(dex_files.size(), num_threads, [&](size_t d) {
+    ddump_data rd;
+    open_dex_file(dex_files[d].c_str(), &rd);
+    auto& result = dex_refs[d];
+    std::vector<Postings> by_idx[NUM_REF_KINDS];
+    for (int k = 0; k < NUM_REF_KINDS; k++) {
+      by_idx[k].resize(ref_table_size(&rd, (RefKind)k));
+    }
+    uint32_t num_classes = rd.dexh->class_defs_size;
+    result.classes.reserve(num_classes);
+    for (uint32_t j = 0; j < num_classes; j++) {
+      const dex_class_def* cls = rd.dex_class_defs + j;
+      result.classes.push_back(
+          {(uint32_t)d, dex_string_by_type_idx(&rd, cls->typeidx)});
+      for_each_class_ref(&rd, cls, [&](RefKind kind, uint32_t idx) {
+        auto& table = by_idx[kind];
+        if (idx < table.size() &&
+            (table[idx].empty() || table[idx].back() != j)) {
+          table[idx].push_back(j);
+        }
+      });
+    }
+    for (int k = 0; k < NUM_REF_KINDS; k++) {
+      for (uint32_t idx = 0; idx < by_idx[k].size(); idx++) {
+        if (!by_idx[k][idx].empty()) {
+          result.refs[k].emplace_back(ref_name(&rd, (RefKind)k, idx),
+                                      std::move(by_idx[k][idx]));
+        }
+      }
+    }
+  });
+
+  DexIndex index;
+  index.dex_files = dex_files;
+  std::unordered_map<std::string, Postings> merged[NUM_REF_KINDS];
+  for (auto& dex : dex_refs) {
+    uint32_t base = index.classes.size();
+    std::move(dex.classes.begin(), dex.classes.end(),
+              std::back_inserter(index.classes));
+    for (int k = 0; k < NUM_REF_KINDS; k++) {
+      for (auto& ref : dex.refs[k]) {
+        auto& postings = merged[k][ref.first];
+        for (auto id : ref.second) {
+          postings.push_back(base + id);
+        }
+      }
+    }
+    dex = DexRefs();
+  }
+  for (int k = 0; k < NUM_REF_KINDS; k++) {
+    auto& refs = index.refs[k];
+    refs.reserve(merged[k].size());
+    for (auto& ref : merged[k]) {
+      refs.emplace_back(ref.first, std::move(ref.second));
+    }
+    std::sort(refs.begin(), refs.end(), [](const auto& a, const auto& b) {
+      return a.first < b.first;
+    });
+  }
+  return index;
+}
+
+bool DexIndex::write(const std::string& filename) const {
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    fprintf(stderr, "Cannot open %s for writing\n", filename.c_str());
+    return false;
+  }
+  write_u32(out, kIndexMagic);
+  write_u32(out, kIndexVersion);
+  write_u32(out, dex_files.size());
+  for (const auto& dex : dex_files) {
+    write_str(out, dex);
+  }
+  write_u32(out, classes.size());
+  for (const auto& cls : classes) {
+    write_u32(out, cls.dex);
+    write_str(out, cls.name);
+  }
+  for (const auto& table : refs) {
+    write_u32(out, table.size());
+    for (const auto& ref : table) {
+      write_str(out, ref.first);
+      write_u32(out, ref.second.size());
+      out.write((const char*)ref.second.data(),
+                ref.second.size() * sizeof(uint32_t));
+    }
+  }
+  out.close();
+  if (!out) {
+    fprintf(stderr, "Failed to write index %s\n", filename.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool DexIndex::read(const std::string& filename) {
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    fprintf(stderr, "Cannot open index %s\n", filename.c_str());
+    return false;
+  }
+  if (read_u32(in) != kIndexMagic || read_u32(in) != kIndexVersion) {
+    fprintf(stderr, "%s is not a dexgrep index of version %u\n",
+            filename.c_str(), kIndexVersion);
+    return false;
+  }
+  dex_files.resize(read_u32(in));
+  for (auto& dex : dex_files) {
+    dex = read_str(in);
+  }
+  classes.resize(in ? read_u32(in) : 0);
+  for (auto& cls : classes) {
+    cls.dex = read_u32(in);
+    cls.name = read_str(in);
+    if (cls.dex >= dex_files.size()) {
+      in.setstate(std::ios::failbit);
+    }
+    if (!in) {
+      break;
+    }
+  }
+  for (auto& table : refs) {
+    table.resize(in ? read_u32(in) : 0);
+    for (auto& ref : table) {
+      ref.first = read_str(in);
+      ref.second.resize(in ? read_u32(in) : 0);
+      in.read((char*)ref.second.data(), ref.second.size() * sizeof(uint32_t));
+      for (auto id : ref.second) {
+        if (id >= classes.size()) {
+          in.setstate(std::ios::failbit);
+        }
+      }
+      if (!in) {
+        break;
+      }
+    }
+  }
+  if (!in) {
+    fprintf(stderr, "Truncated or corrupt index %s\n", filename.c_str());
+    return false;
+  }
+  return true;
+}
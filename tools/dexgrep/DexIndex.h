@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DexCommon.h"
+
+/*
+ * The kinds of references dexgrep can search for. A class refers to a
+ * string through const-string, to a type through its superclass, its
+ * interfaces or a type-taking instruction, and to a method through an
+ * invoke.
+ */
+enum RefKind : uint8_t {
+  REF_STRING,
+  REF_TYPE,
+  REF_METHOD,
+  NUM_REF_KINDS,
+};
+
+/*
+ * Calls `fn` with the kind and the dex table index of every reference made
+ * by `cls` and the code of its methods. A reference may be reported more
+ * than once.
+ */
+void for_each_class_ref(ddump_data* rd,
+                        const dex_class_def* cls,
+                        const std::function<void(RefKind, uint32_t)>& fn);
+
+/*
+ * The name under which a reference is indexed and matched: the string
+ * itself, the type descriptor, or "Lcls;.name:(args)rtype" for a method.
+ */
+std::string ref_name(ddump_data* rd, RefKind kind, uint32_t idx);
+
+/*
+ * Number of entries in the dex table `kind` refers to.
+ */
+uint32_t ref_table_size(const ddump_data* rd, RefKind kind);
+
+/*
+ * Runs fn(i) for every i in [0, size) on up to `num_threads` threads.
+ */
+void parallel_for(size_t size,
+                  size_t num_threads,
+                  const std::function<void(size_t)>& fn);
+
+/*
+ * An inverted index over a set of dex files (typically all the dexes of one
+ * APK): for each kind of reference, the sorted names of everything that is
+ * referred to, each with the ids of the classes that refer to it. A class id
+ * is the position of the class in `classes`, which lists the class defs of
+ * every dex, in order.
+ */
+struct DexIndex {
+  struct ClassEntry {
+    uint32_t dex;
+    std::string name;
+  };
+  using Postings = std::vector<uint32_t>;
+
+  std::vector<std::string> dex_files;
+  std::vector<ClassEntry> classes;
+  std::vector<std::pair<std::string, Postings>> refs[NUM_REF_KINDS];
+
+  // Scans `dex_files` on up to `num_threads` threads.
+  static DexIndex build(const std::vector<std::string>& dex_files,
+                        size_t num_threads);
+
+  // Both return false, after printing the reason, on I/O errors or when the
+  // file is not an index of the expected version.
+  bool write(const std::string& filename) const;
+  bool read(const std::string& filename);
+};
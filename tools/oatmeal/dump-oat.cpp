@@ -1980,17 +1980,21 @@ class OatFile_064 : public OatFile {
   static std::unique_ptr<OatFile> parse(bool dex_files_only,
                                         ConstBuffer buf,
                                         size_t oat_offset) {
+    set_memory_section("oat_header");
     auto header = OatHeader::parse(buf);
+    set_memory_section("key_value_store");
     auto key_value_store = KeyValueStore(
         buf.slice(header.size()).truncate(header.key_value_store_size));
 
     auto rest = buf.slice(header.size() + header.key_value_store_size);
+    set_memory_section("dex_file_listing");
     DexFileListing_064 dfl(dex_files_only,
                            static_cast<OatVersion>(header.common.version),
                            header.dex_file_count,
                            rest,
                            buf);
 
+    set_memory_section("dex_files");
     DexFiles dex_files(dfl, buf);
 
     return std::unique_ptr<OatFile>(new OatFile_064(header,
@@ -2096,13 +2100,17 @@ class OatFile_079 : public OatFile {
   static std::unique_ptr<OatFile> parse(bool dex_files_only,
                                         ConstBuffer buf,
                                         size_t oat_offset) {
+    set_memory_section("oat_header");
     auto header = OatHeader::parse(buf);
+    set_memory_section("key_value_store");
     auto key_value_store = KeyValueStore(
         buf.slice(header.size()).truncate(header.key_value_store_size));
     auto rest = buf.slice(header.size() + header.key_value_store_size);
 
+    set_memory_section("dex_file_listing");
     DexFileListing_079 dfl(header.dex_file_count, rest);
 
+    set_memory_section("dex_files");
     DexFiles dex_files(dfl, buf);
 
     if (dex_files_only) {
@@ -2113,8 +2121,10 @@ class OatFile_079 : public OatFile {
                                                       oat_offset));
     }
 
+    set_memory_section("lookup_tables");
     LookupTables lookup_tables(dfl, dex_files, buf);
 
+    set_memory_section("oat_classes");
     OatClasses_079 oat_classes(dfl, dex_files, buf);
 
     return std::unique_ptr<OatFile>(new OatFile_079(header,
@@ -2252,11 +2262,14 @@ class OatFile_124 : public OatFile {
       return nullptr;
     }
 
+    set_memory_section("oat_header");
     auto header = OatHeader::parse(buf);
+    set_memory_section("key_value_store");
     auto key_value_store = KeyValueStore(
         buf.slice(header.size()).truncate(header.key_value_store_size));
 
     auto rest = buf.slice(header.size() + header.key_value_store_size);
+    set_memory_section("dex_file_listing");
     DexFileListingType dfl(header.dex_file_count, rest);
 
     auto dex_file_name = dexes[0].filename;
@@ -2286,6 +2299,7 @@ class OatFile_124 : public OatFile {
 
     ConstBuffer dex_file_buf{dex_file_contents.get(), dex_file_size};
     cur_ma()->addBuffer(dex_file_buf);
+    set_memory_section("dex_files");
     DexFiles dex_files(dfl, dex_file_buf);
 
     if (dex_files_only) {
@@ -2296,7 +2310,9 @@ class OatFile_124 : public OatFile {
                                                       oat_offset));
     }
 
+    set_memory_section("lookup_tables");
     LookupTables lookup_tables(dfl, dex_files, buf);
+    set_memory_section("oat_classes");
     OatClasses_124 oat_classes(dfl, dex_files, buf, dex_file_buf);
 
     return std::unique_ptr<OatFile>(new OatFileType(header,
@@ -2652,6 +2668,7 @@ static std::unique_ptr<OatFile> parse_oatfile_impl(
     return nullptr;
   }
 
+  set_memory_section("oat_header");
   auto header = OatHeader_Common::parse(oatfile_buffer);
 
   // TODO: do we need to handle endian-ness? I think all platforms we
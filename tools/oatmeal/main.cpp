@@ -16,6 +16,8 @@
 #include <wordexp.h>
 #endif
 
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
 #include <cstdio>
 #include <cstdlib>
@@ -23,6 +25,7 @@
 #include <memory>
 
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -51,6 +54,11 @@ struct Arguments {
 
   bool print_unverified_classes = false;
 
+  // If set, every -o file is parsed, in parallel, and its memory accounting
+  // is written to this file ("-" for stdout) as JSON, instead of the dump.
+  std::string memory_report_json;
+  size_t jobs = std::max(1u, std::thread::hardware_concurrency());
+
   std::string arch;
 
   std::string art_image_location;
@@ -101,6 +109,8 @@ Arguments parse_args(int argc, char* argv[]) {
       {"samsung-oatformat", no_argument, nullptr, 2},
       {"one-oat-per-dex", no_argument, nullptr, 3},
       {"quickening-data", required_argument, nullptr, 'q'},
+      {"memory-report-json", required_argument, nullptr, 4},
+      {"jobs", required_argument, nullptr, 'j'},
       {nullptr, 0, nullptr, 0}};
 
   Arguments ret;
@@ -109,7 +119,7 @@ Arguments parse_args(int argc, char* argv[]) {
 
   int c;
   while ((c = getopt_long(
-              argc, argv, "cetmpdbx:l:o:v:a:", &options[0], nullptr)) != -1) {
+              argc, argv, "cetmpdbx:l:o:v:a:j:", &options[0], nullptr)) != -1) {
     switch (c) {
     case 'd':
       if (ret.action != Action::DUMP && ret.action != Action::NONE) {
@@ -191,6 +201,14 @@ Arguments parse_args(int argc, char* argv[]) {
       ret.quick_data_location = expand(optarg);
       break;
 
+    case 4:
+      ret.memory_report_json = optarg;
+      break;
+
+    case 'j':
+      ret.jobs = std::max(1, atoi(optarg));
+      break;
+
     case ':':
       fprintf(stderr, "ERROR: %s requires an argument\n", argv[optind - 1]);
       exit(1);
@@ -203,6 +221,11 @@ Arguments parse_args(int argc, char* argv[]) {
     }
   }
 
+  if (ret.action != Action::DUMP && !ret.memory_report_json.empty()) {
+    fprintf(stderr, "--memory-report-json can only be used with -d/--dump\n");
+    exit(1);
+  }
+
   if (ret.action != Action::DUMP && ret.print_unverified_classes) {
     fprintf(stderr,
             "-p/--print-unverified-classes can only be used with -d/--dump\n");
@@ -231,34 +254,41 @@ Arguments parse_args(int argc, char* argv[]) {
   return ret;
 }
 
-int dump(const Arguments& args) {
-  if (args.oat_files.size() != 1) {
-    fprintf(stderr, "-o/--oat required (exactly once)\n");
-    return 1;
-  }
-
-  auto const& oat_file_name = args.oat_files[0];
-  auto oat_file = FileHandle(fopen(oat_file_name.c_str(), "r"));
-  if (oat_file.get() == nullptr) {
+// Reads a whole file. We don't run dumping during install on device, so it is
+// allowed to consume lots of memory.
+std::unique_ptr<char[]> read_file(const std::string& file_name, size_t* size) {
+  auto file = FileHandle(fopen(file_name.c_str(), "r"));
+  if (file.get() == nullptr) {
     fprintf(stderr,
             "failed to open file %s %s\n",
-            oat_file_name.c_str(),
+            file_name.c_str(),
             std::strerror(errno));
-    return 1;
+    return nullptr;
   }
 
-  auto oat_file_size = get_filesize(oat_file);
-
-  // We don't run dumping during install on device, so it is allowed to consume
-  // lots of memory.
-  auto oat_file_contents = std::make_unique<char[]>(oat_file_size);
-  auto oatFileBytesRead =
-      fread(oat_file_contents.get(), 1, oat_file_size, oat_file.get());
-  if (oatFileBytesRead != oat_file_size) {
+  *size = get_filesize(file);
+  auto contents = std::make_unique<char[]>(*size);
+  auto bytesRead = fread(contents.get(), 1, *size, file.get());
+  if (bytesRead != *size) {
     fprintf(stderr,
             "Failed to read file %s (%zd)\n",
             std::strerror(errno),
-            oatFileBytesRead);
+            bytesRead);
+    return nullptr;
+  }
+  return contents;
+}
+
+int dump(const Arguments& args) {
+  if (args.oat_files.size() != 1) {
+    fprintf(stderr, "-o/--oat required (exactly once)\n");
+    return 1;
+  }
+
+  auto const& oat_file_name = args.oat_files[0];
+  size_t oat_file_size = 0;
+  auto oat_file_contents = read_file(oat_file_name, &oat_file_size);
+  if (!oat_file_contents) {
     return 1;
   }
 
@@ -294,6 +324,135 @@ int dump(const Arguments& args) {
   return oatfile->status() == OatFile::Status::PARSE_SUCCESS ? 0 : 1;
 }
 
+std::string json_string(const std::string& s) {
+  std::string ret = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      ret += '\\';
+      ret += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", c);
+      ret += buf;
+    } else {
+      ret += c;
+    }
+  }
+  return ret + "\"";
+}
+
+// Parses one oat or vdex file, and returns its memory accounting as a JSON
+// object. Sets *ok to false if the file cannot be parsed.
+std::string memory_report(const std::string& file_name,
+                          const std::vector<DexInput>& dexes,
+                          bool* ok) {
+  std::string ret = "{\"file\": " + json_string(file_name);
+  size_t size = 0;
+  auto contents = read_file(file_name, &size);
+  if (!contents || size <= 4) {
+    *ok = false;
+    return ret + ", \"status\": \"IO_ERROR\"}";
+  }
+
+  ConstBuffer buffer{contents.get(), size};
+  auto ma_scope = MemoryAccounter::NewScope(buffer);
+  std::unique_ptr<OatFile> oatfile;
+  if (*(reinterpret_cast<const uint32_t*>(buffer.ptr)) == kVdexMagicNum) {
+    VdexFile::parse(buffer);
+    ret += ", \"kind\": \"vdex\"";
+  } else {
+    oatfile = OatFile::parse(buffer, dexes, false);
+    if (!oatfile) {
+      *ok = false;
+      return ret + ", \"status\": \"PARSE_FAILURE\"}";
+    }
+    ret += ", \"kind\": \"oat\", \"version\": " +
+           json_string(oatfile->version_string());
+    if (oatfile->status() != OatFile::Status::PARSE_SUCCESS) {
+      *ok = false;
+      return ret + ", \"status\": \"PARSE_FAILURE\"}";
+    }
+  }
+
+  auto attribution = cur_ma()->attribution();
+  ret += ", \"status\": \"PARSE_SUCCESS\"";
+  ret += ", \"size\": " + std::to_string(attribution.total);
+  ret += ", \"unconsumed\": " + std::to_string(attribution.unconsumed);
+  ret += ", \"double_consumed\": " +
+         std::to_string(attribution.double_consumed);
+  ret += ", \"sections\": {";
+  bool first = true;
+  for (const auto& section : attribution.sections) {
+    if (!first) {
+      ret += ", ";
+    }
+    first = false;
+    ret += json_string(section.first) + ": " + std::to_string(section.second);
+  }
+  return ret + "}}";
+}
+
+// Writes the memory accounting of every -o file as a JSON array, in the
+// order the files were given. When there are as many -x files as -o files,
+// the i-th dex (or vdex) file goes with the i-th oat file; otherwise every
+// oat file gets all of them.
+int dump_memory_reports(const Arguments& args) {
+  if (args.oat_files.empty()) {
+    fprintf(stderr, "-o/--oat required (at least once)\n");
+    return 1;
+  }
+
+  bool paired = args.dex_files.size() == args.oat_files.size();
+  std::vector<std::string> reports(args.oat_files.size());
+  std::atomic<size_t> next{0};
+  std::atomic<bool> all_ok{true};
+  auto work = [&]() {
+    for (size_t i = next++; i < reports.size(); i = next++) {
+      std::vector<DexInput> dexes;
+      if (paired) {
+        dexes.push_back(args.dex_files[i]);
+      } else {
+        dexes = args.dex_files;
+      }
+      bool ok = true;
+      reports[i] = memory_report(args.oat_files[i], dexes, &ok);
+      if (!ok) {
+        all_ok = false;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < std::min(args.jobs, reports.size()); ++t) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const auto& out_name = args.memory_report_json;
+  FILE* out = out_name == "-" ? stdout : fopen(out_name.c_str(), "w");
+  if (out == nullptr) {
+    fprintf(stderr,
+            "failed to open file %s %s\n",
+            out_name.c_str(),
+            std::strerror(errno));
+    return 1;
+  }
+  fprintf(out, "[\n");
+  for (size_t i = 0; i < reports.size(); ++i) {
+    fprintf(out,
+            "  %s%s\n",
+            reports[i].c_str(),
+            i + 1 < reports.size() ? "," : "");
+  }
+  fprintf(out, "]\n");
+  if (out != stdout) {
+    fclose(out);
+  }
+  return all_ok ? 0 : 1;
+}
+
 int build(const Arguments& args) {
 
   if (args.dex_files.empty()) {
@@ -342,7 +501,8 @@ int main(int argc, char* argv[]) {
   case Action::BUILD:
     return build(args);
   case Action::DUMP:
-    return dump(args);
+    return args.memory_report_json.empty() ? dump(args)
+                                           : dump_memory_reports(args);
   case Action::NONE:
     fprintf(stderr, "Please specify --dump or --build\n");
     return 1;
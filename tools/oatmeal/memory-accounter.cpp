@@ -14,6 +14,10 @@
 
 namespace {
 
+constexpr const char* kDefaultSection = "other";
+
+thread_local const char* t_section = kDefaultSection;
+
 // This class is a bit of a wart - the oat parsing code was initially written
 // only for exploratory purposes, and MemoryAccounter exists so that we can
 // make sure we've parsed and therefore understood all the bytes in an oat file.
@@ -27,6 +31,7 @@ namespace {
 class NilMemoryAccounterImpl : public MemoryAccounter {
  public:
   void print() override {}
+  MemoryAttribution attribution() override { return MemoryAttribution(); }
   void memcpyAndMark(void* dest, const char* src, size_t count) override {
     memcpy(dest, src, count);
   }
@@ -48,7 +53,7 @@ class MemoryAccounterImpl : public MemoryAccounter {
 
   explicit MemoryAccounterImpl(ConstBuffer buf) : buf_(buf) {
     // mark end to avoid special case in print.
-    consumed_ranges_.emplace_back(buf_.len, buf_.len);
+    consumed_ranges_.emplace_back(buf_.len, buf_.len, nullptr);
   }
 
   void print() override {
@@ -57,7 +62,7 @@ class MemoryAccounterImpl : public MemoryAccounter {
               consumed_ranges_.end(),
               [](const Range& a, const Range& b) { return a.begin < b.begin; });
 
-    Range prev{0, 0};
+    Range prev{0, 0, nullptr};
     printf("Memory accounting:\n");
     if (consumed_ranges_.empty()) {
       printf("  no unconsumed memory found\n");
@@ -78,6 +83,28 @@ class MemoryAccounterImpl : public MemoryAccounter {
     }
   }
 
+  MemoryAttribution attribution() override {
+    std::sort(consumed_ranges_.begin(),
+              consumed_ranges_.end(),
+              [](const Range& a, const Range& b) { return a.begin < b.begin; });
+
+    MemoryAttribution ret;
+    ret.total = buf_.len;
+    uint32_t covered_end = 0;
+    for (const auto& cur : consumed_ranges_) {
+      if (covered_end < cur.begin) {
+        ret.unconsumed += cur.begin - covered_end;
+      } else {
+        ret.double_consumed += std::min(covered_end, cur.end) - cur.begin;
+      }
+      covered_end = std::max(covered_end, cur.end);
+      if (cur.section != nullptr) {
+        ret.sections[cur.section] += cur.end - cur.begin;
+      }
+    }
+    return ret;
+  }
+
   void addBuffer(ConstBuffer) override {
     CHECK(false, "Shouldn't do this here");
   }
@@ -115,21 +142,23 @@ class MemoryAccounterImpl : public MemoryAccounter {
 
  private:
   struct Range {
-    Range(size_t b, size_t e) : begin(b), end(e) {}
+    Range(size_t b, size_t e, const char* s) : begin(b), end(e), section(s) {}
     uint32_t begin;
     uint32_t end;
+    const char* section;
   };
 
   ConstBuffer buf_;
   std::vector<Range> consumed_ranges_;
 
   static NilMemoryAccounterImpl nil_accounter_;
-  static std::vector<std::unique_ptr<MemoryAccounter>> accounter_stack_;
+  static thread_local std::vector<std::unique_ptr<MemoryAccounter>>
+      accounter_stack_;
 
   void markRangeImpl(uint32_t begin, uint32_t end) {
     CHECK(begin <= end);
     CHECK(end <= buf_.len);
-    consumed_ranges_.emplace_back(begin, end);
+    consumed_ranges_.emplace_back(begin, end, t_section);
   }
 };
 
@@ -144,6 +173,7 @@ class MultiBufferMemoryAccounter : public MemoryAccounter {
   }
 
   void print() override;
+  MemoryAttribution attribution() override;
 
   void memcpyAndMark(void* dest, const char* src, size_t count) override;
 
@@ -161,9 +191,8 @@ void MultiBufferMemoryAccounter::memcpyAndMark(void* dest,
                                                const char* src,
                                                size_t count) {
   for (auto& a : accounters_) {
-    auto ptr = a.buf_.ptr;
-    char* dst_ptr = reinterpret_cast<char*>(dest);
-    if (ptr <= dest && dest <= dst_ptr + count) {
+    auto base_ptr = a.buf_.ptr;
+    if (base_ptr <= src && src + count <= base_ptr + a.buf_.len) {
       a.memcpyAndMark(dest, src, count);
       return;
     }
@@ -206,6 +235,20 @@ void MultiBufferMemoryAccounter::print() {
   }
 }
 
+MemoryAttribution MultiBufferMemoryAccounter::attribution() {
+  MemoryAttribution ret;
+  for (auto& a : accounters_) {
+    auto attribution = a.attribution();
+    ret.total += attribution.total;
+    ret.unconsumed += attribution.unconsumed;
+    ret.double_consumed += attribution.double_consumed;
+    for (const auto& section : attribution.sections) {
+      ret.sections[section.first] += section.second;
+    }
+  }
+  return ret;
+}
+
 void MultiBufferMemoryAccounter::addBuffer(ConstBuffer buf) {
   // Make sure this is no-ones sub-buffer in the currently accounted set.
   for (const auto& a : accounters_) {
@@ -218,7 +261,7 @@ void MultiBufferMemoryAccounter::addBuffer(ConstBuffer buf) {
 }
 
 NilMemoryAccounterImpl MemoryAccounterImpl::nil_accounter_;
-std::vector<std::unique_ptr<MemoryAccounter>>
+thread_local std::vector<std::unique_ptr<MemoryAccounter>>
     MemoryAccounterImpl::accounter_stack_;
 } // namespace
 
@@ -230,7 +273,10 @@ MemoryAccounterScope MemoryAccounter::NewScope(ConstBuffer buf) {
 
 MemoryAccounter* MemoryAccounter::Cur() { return MemoryAccounterImpl::Cur(); }
 
+void set_memory_section(const char* section) { t_section = section; }
+
 MemoryAccounterScope::MemoryAccounterScope(ConstBuffer buf) {
+  t_section = kDefaultSection;
   MemoryAccounterImpl::accounter_stack_.push_back(
       std::unique_ptr<MultiBufferMemoryAccounter>(
           new MultiBufferMemoryAccounter(buf)));
@@ -9,13 +9,33 @@
 
 #include "OatmealUtil.h"
 
+#include <map>
 #include <memory>
+#include <string>
 
 class MemoryAccounter;
 
+// Byte counts of how the tracked buffers were consumed.
+struct MemoryAttribution {
+  size_t total = 0;
+  size_t unconsumed = 0;
+  size_t double_consumed = 0;
+  // Bytes marked consumed in each section; see set_memory_section().
+  std::map<std::string, size_t> sections;
+};
+
 class MemoryAccounterScope {
   friend class MemoryAccounter;
 
+// Byte counts of how the tracked buffers were consumed.
+struct MemoryAttribution {
+  size_t total = 0;
+  size_t unconsumed = 0;
+  size_t double_consumed = 0;
+  // Bytes marked consumed in each section; see set_memory_section().
+  std::map<std::string, size_t> sections;
+};
+
  public:
   UNCOPYABLE(MemoryAccounterScope);
   MOVABLE(MemoryAccounterScope);
@@ -29,6 +49,9 @@ class MemoryAccounterScope {
 // Tracks which ranges of memory have been consumed during parsing,
 // so that we can easily identify sections that may have data we don't
 // yet understand.
+//
+// Scopes are per thread, so several files can be parsed and accounted for
+// at once, one per thread.
 class MemoryAccounter {
  public:
   MemoryAccounter() = default;
@@ -44,6 +67,9 @@ class MemoryAccounter {
   // been consumed, or has been consumed more than once.
   virtual void print() = 0;
 
+  // The same accounting as print(), as numbers.
+  virtual MemoryAttribution attribution() = 0;
+
   // Accounting functions - use these to mark portions of the tracked
   // buffer consumed.
 
@@ -58,3 +84,8 @@ class MemoryAccounter {
 };
 
 inline MemoryAccounter* cur_ma() { return MemoryAccounter::Cur(); }
+
+// Attributes the ranges this thread marks consumed from now on to `section`,
+// which must outlive the scope (e.g. a string literal). A new scope starts
+// in the "other" section.
+void set_memory_section(const char* section);
@@ -16,6 +16,7 @@ size_t size_of_checksums_section(const VdexFileHeader& header) {
 } // namespace
 
 VdexFile::VdexFile(VdexFileHeader& header, ConstBuffer buf) : header_(header) {
+  set_memory_section("dex_files");
   auto remaining_dexes_buf =
       buf.slice(sizeof(VdexFileHeader) + size_of_checksums_section(header));
   for (size_t dex_index = 0; dex_index < header.number_of_dex_files_;
@@ -26,7 +27,6 @@ VdexFile::VdexFile(VdexFileHeader& header, ConstBuffer buf) : header_(header) {
       fprintf(stderr, "Bad dex magic\n");
       return;
     }
-    printf("Version %s\n", reinterpret_cast<char*>(&(dex_header.version)));
 
     auto dex_buf = remaining_dexes_buf.truncate(dex_header.file_size);
     dexes_.push_back(dex_buf);
@@ -35,8 +35,8 @@ VdexFile::VdexFile(VdexFileHeader& header, ConstBuffer buf) : header_(header) {
 }
 
 std::unique_ptr<VdexFile> VdexFile::parse(ConstBuffer buf) {
+  set_memory_section("vdex_header");
   auto header = VdexFileHeader::parse(buf);
-  header.print();
 
   return std::unique_ptr<VdexFile>(new VdexFile(header, buf));
 }
@@ -44,6 +44,7 @@ std::unique_ptr<VdexFile> VdexFile::parse(ConstBuffer buf) {
 void VdexFile::print() const {
   header_.print();
   for (const auto& e : dex_headers_) {
+    printf("Version %s\n", reinterpret_cast<const char*>(&(e.version)));
     printf(
         "DexFile: { \
     file_size: 0x%08x(%u), \
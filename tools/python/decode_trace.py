@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Print a binary trace, as written with TRACE_FORMAT=binary, as text. See
+libredex/Trace.cpp for the format.
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+
+def read_exact(f, n):
+    data = f.read(n)
+    if len(data) != n:
+        raise EOFError()
+    return data
+
+
+def decode(f, out, module_filter, show_thread):
+    if read_exact(f, 8) != b"RDXTRACE":
+        raise ValueError("Not a binary Redex trace")
+    (version, num_modules) = struct.unpack("<II", read_exact(f, 8))
+    if version != 1:
+        raise ValueError(f"Unsupported trace version {version}")
+    modules = []
+    for _ in range(num_modules):
+        (length,) = struct.unpack("<B", read_exact(f, 1))
+        modules.append(read_exact(f, length).decode())
+    while True:
+        try:
+            header = read_exact(f, 20)
+        except EOFError:
+            return
+        ns, thread, module, level, flags, length = struct.unpack("<QIHBBI", header)
+        text = read_exact(f, length).decode(errors="replace")
+        name = modules[module] if module < len(modules) else str(module)
+        if module_filter and name not in module_filter:
+            continue
+        time = datetime.datetime.fromtimestamp(ns / 1e9).isoformat()
+        prefix = f"[{time}] [{name}:{level}] "
+        if show_thread:
+            prefix += f"[t{thread}] "
+        out.write(prefix + text + ("" if flags & 1 else "\n"))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("trace", help="The binary trace file")
+    parser.add_argument("--module", action="append", help="Only these modules")
+    parser.add_argument("--threads", action="store_true", help="Show threads")
+    args = parser.parse_args()
+    with open(args.trace, "rb") as f:
+        decode(f, sys.stdout, set(args.module or []), args.threads)
+
+
+if __name__ == "__main__":
+    main()
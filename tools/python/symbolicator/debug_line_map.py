@@ -5,6 +5,7 @@
 
 from __future__ import absolute_import, division, print_function
 
+import bisect
 import logging
 import mmap
 import struct
@@ -14,10 +15,90 @@ from collections import namedtuple
 OffsetLine = namedtuple("OffsetLine", "offset line")
 
 
+def read_uleb128(mapping, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = mapping[pos]
+        pos += 1
+        result |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return result, pos
+
+
+def read_sleb128(mapping, pos):
+    result, new_pos = read_uleb128(mapping, pos)
+    bits = 7 * (new_pos - pos)
+    if result & (1 << (bits - 1)):
+        result -= 1 << bits
+    return result, new_pos
+
+
+class CompactMethodIdMap(object):
+    """
+    The methods of a version 2 map, whose index is sorted by method id. The
+    entries of a method are only decoded when it is looked up.
+    """
+
+    def __init__(self, mapping, method_count):
+        index_struct = struct.Struct("<QLL")
+        self.mapping = mapping
+        self.method_ids = []
+        self.index = []
+        for i in range(method_count):
+            method_id, offset, count = index_struct.unpack_from(mapping, 12 + 16 * i)
+            self.method_ids.append(method_id)
+            self.index.append((offset, count))
+        self.entries_start = 12 + 16 * method_count
+        self.cache = {}
+
+    def __len__(self):
+        return len(self.method_ids)
+
+    def _find(self, method_id):
+        i = bisect.bisect_left(self.method_ids, method_id)
+        if i < len(self.method_ids) and self.method_ids[i] == method_id:
+            return i
+        return None
+
+    def __contains__(self, method_id):
+        return self._find(method_id) is not None
+
+    def __getitem__(self, method_id):
+        if method_id in self.cache:
+            return self.cache[method_id]
+        i = self._find(method_id)
+        if i is None:
+            raise KeyError(method_id)
+        offset, count = self.index[i]
+        pos = self.entries_start + offset
+        pc = 0
+        line = 0
+        line_mappings = []
+        for _ in range(count):
+            pc_delta, pos = read_uleb128(self.mapping, pos)
+            line_delta, pos = read_sleb128(self.mapping, pos)
+            pc += pc_delta
+            line += line_delta
+            line_mappings.append(OffsetLine(pc, line))
+        self.cache[method_id] = line_mappings
+        return line_mappings
+
+
 class DebugLineMap(object):
     def __init__(self, method_id_map):
         self.method_id_map = method_id_map
 
+    @staticmethod
+    def read_compact(mapping):
+        method_count = struct.unpack_from("<L", mapping, 8)[0]
+        method_id_map = CompactMethodIdMap(mapping, method_count)
+        logging.info(
+            "Indexed " + str(len(method_id_map)) + " methods from debug line map"
+        )
+        return DebugLineMap(method_id_map)
+
     @staticmethod
     def read_from(filename):
         with open(filename) as f:
@@ -26,6 +107,8 @@ class DebugLineMap(object):
             if magic != 0xFACEB000:
                 raise Exception("Magic number mismatch")
             version = struct.unpack("<L", mapping.read(4))[0]
+            if version == 2:
+                return DebugLineMap.read_compact(mapping)
             if version != 1:
                 raise Exception("Version mismatch")
             method_count = struct.unpack("<L", mapping.read(4))[0]
@@ -62,16 +145,15 @@ class DebugLineMap(object):
         line = int(line)
         if method_id in self.method_id_map:
             mappings = self.method_id_map[method_id]
-            result = None
-            for pc, mapped_line in mappings:
-                if pc <= line:
-                    result = mapped_line
-                else:
-                    if result is None:
-                        # Better to give a rough line number than fail epicly
-                        result = mapped_line
-                    break
-            return result
+            if not mappings:
+                return None
+            # The mappings are sorted by pc, so take the last one at or before
+            # the given pc.
+            i = bisect.bisect_right(mappings, (line, float("inf")))
+            if i == 0:
+                # Better to give a rough line number than fail epicly
+                return mappings[0].line
+            return mappings[i - 1].line
         return None
 
     def get_mappings(self, method_id):
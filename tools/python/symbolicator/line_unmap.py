@@ -37,20 +37,12 @@ class PositionMap(object):
                 pmap.string_pool.append(mapping.read(ssize).decode("ascii"))
             logging.info("Unpacked %d strings from line map", spool_count)
             pos_count = struct.unpack("<L", mapping.read(4))[0]
-            # this is pretty slow; it would be much faster in C++ with memcpy
-            # and arrays of structs, but I don't know how to call C/C++ from
-            # Python under our build system
-            for _ in range(0, pos_count):
-                if version == 1:
-                    pmap.positions.append(
-                        MapEntry._make(
-                            (None, None) + struct.unpack("<LLL", mapping.read(12))
-                        )
-                    )
-                else:
-                    pmap.positions.append(
-                        MapEntry._make(struct.unpack("<LLLLL", mapping.read(20)))
-                    )
+            if version == 1:
+                entries = struct.iter_unpack("<LLL", mapping.read(12 * pos_count))
+                pmap.positions = [MapEntry(None, None, *e) for e in entries]
+            else:
+                entries = struct.iter_unpack("<LLLLL", mapping.read(20 * pos_count))
+                pmap.positions = [MapEntry._make(e) for e in entries]
             logging.info("Unpacked %d map entries from line map", pos_count)
             return pmap
 
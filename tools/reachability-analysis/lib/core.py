@@ -171,15 +171,41 @@ class AbstractGraph(object):
 
 
 class ReachabilityGraph(AbstractGraph):
+    """
+    This contains the deserialization counterpart to reachability::dump_graph,
+    which writes the graph as arrays rather than as an adjacency list.
+    """
+
     @staticmethod
     def expected_version():
-        return 1
+        return 2
 
-    def read_node(self, mapping):
-        node_type = struct.unpack("<B", mapping.read(1))[0]
-        node_name_size = struct.unpack("<L", mapping.read(4))[0]
-        node_name = mapping.read(node_name_size).decode("ascii")
-        return ReachableObject(node_type, node_name)
+    def load(self, fn):
+        with open(fn) as f:
+            mapping = mmap.mmap(f.fileno(), 0, prot=mmap.PROT_READ)
+            self.read_header(mapping)
+            nodes_count, edges_count = struct.unpack("<LL", mapping.read(8))
+
+            def read_array(typecode, size):
+                a = array.array(typecode)
+                a.frombytes(mapping.read(a.itemsize * size))
+                return a
+
+            label_offsets = read_array("Q", nodes_count + 1)
+            retainer_offsets = read_array("I", nodes_count + 1)
+            retainers = read_array("I", edges_count)
+            types = read_array("B", nodes_count)
+            labels = mapping.read(label_offsets[nodes_count])
+
+            nodes = [None] * nodes_count
+            for i in range(nodes_count):
+                name = labels[label_offsets[i] : label_offsets[i + 1]]
+                nodes[i] = ReachableObject(types[i], name.decode("ascii"))
+                self.add_node(nodes[i])
+
+            for i in range(nodes_count):
+                for j in range(retainer_offsets[i], retainer_offsets[i + 1]):
+                    self.add_edge(nodes[i], nodes[retainers[j]])
 
     def add_node(self, node):
         self.nodes[(node.type, node.name)] = node
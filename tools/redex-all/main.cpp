@@ -5,13 +5,16 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <boost/thread/thread.hpp>
 #include <cinttypes>
 #include <cstring>
 #include <ctime>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <regex>
 #include <set>
 #include <streambuf>
@@ -35,11 +38,13 @@
 #include <json/json.h>
 
 #include "ABExperimentContext.h"
+#include "ChromeTrace.h"
 #include "CommandProfiling.h"
 #include "CommentFilter.h"
 #include "ControlFlow.h" // To set DEBUG.
 #include "Debug.h"
 #include "DexClass.h"
+#include "DexEncoding.h"
 #include "DexHasher.h"
 #include "DexLoader.h"
 #include "DexOutput.h"
@@ -63,8 +68,10 @@
 #include "ReachableClasses.h"
 #include "RedexContext.h"
 #include "RedexResources.h"
+#include "Sanitizers.h"
 #include "SanitizersConfig.h"
 #include "Show.h"
+#include "StatusReporter.h"
 #include "Timer.h"
 #include "ToolsCommon.h"
 #include "Walkers.h"
@@ -100,6 +107,30 @@ struct Arguments {
   RedexOptions redex_options;
 };
 
+/*
+ * The index of the pass called :name in :passes_list. As with redex.py
+ * --stop-pass, "Name#n" designates the occurrence of index n of the pass.
+ */
+boost::optional<size_t> find_pass_index(const Json::Value& passes_list,
+                                        const std::string& name) {
+  auto pos = name.find('#');
+  auto pass_name = name.substr(0, pos);
+  size_t occurrence = 0;
+  if (pos != std::string::npos) {
+    try {
+      occurrence = std::stoul(name.substr(pos + 1));
+    } catch (const std::exception&) {
+      return boost::none;
+    }
+  }
+  for (Json::ArrayIndex i = 0; i < passes_list.size(); ++i) {
+    if (passes_list[i].asString() == pass_name && occurrence-- == 0) {
+      return i;
+    }
+  }
+  return boost::none;
+}
+
 UNUSED void dump_args(const Arguments& args) {
   std::cout << "out_dir: " << args.out_dir << std::endl;
   std::cout << "verify_none_mode: " << args.redex_options.verify_none_enabled
@@ -324,14 +355,19 @@ Arguments parse_args(int argc, char* argv[]) {
       "be quoted.");
   od.add_options()("show-passes", "show registered passes");
   od.add_options()("dex-files", po::value<std::vector<std::string>>(),
-                   "dex files");
+                   "dex files, or a zip file such as an APK to read the dex "
+                   "files of");
 
   // Development usage only, and Python script will generate the following
   // arguments.
   od.add_options()("stop-pass", po::value<int>(),
                    "Stop before pass n and output IR to file");
+  od.add_options()("stop-after-pass", po::value<std::string>(),
+                   "Stop after the named pass and output IR to file. "
+                   "Name#n designates the occurrence of index n of the pass");
   od.add_options()("output-ir", po::value<std::string>(),
-                   "IR output directory, used with --stop-pass");
+                   "IR output directory, used with --stop-pass or "
+                   "--stop-after-pass");
 
   po::positional_options_description pod;
   pod.add("dex-files", -1);
@@ -487,6 +523,20 @@ Arguments parse_args(int argc, char* argv[]) {
     args.stop_pass_idx = vm["stop-pass"].as<int>();
   }
 
+  if (vm.count("stop-after-pass")) {
+    if (args.stop_pass_idx) {
+      std::cerr << "--stop-pass and --stop-after-pass are exclusive\n";
+      exit(EXIT_FAILURE);
+    }
+    auto name = vm["stop-after-pass"].as<std::string>();
+    auto idx = find_pass_index(args.config["redex"]["passes"], name);
+    if (!idx) {
+      std::cerr << "Pass " << name << " is not in the passes list\n";
+      exit(EXIT_FAILURE);
+    }
+    args.stop_pass_idx = *idx + 1;
+  }
+
   if (vm.count("output-ir")) {
     // The out_dir is for final apk only or intermediate results only.
     always_assert(args.stop_pass_idx);
@@ -508,6 +558,8 @@ Arguments parse_args(int argc, char* argv[]) {
     // Append the two passes when `--stop-pass` is enabled.
     passes_list.append("MakePublicPass");
     passes_list.append("RegAllocPass");
+    // Lets redex-opt --resume run the rest of the passes.
+    args.entry_data["stop_pass_idx"] = idx;
     if (args.out_dir.empty() || !redex::dir_is_writable(args.out_dir)) {
       std::cerr << "output-ir is empty or not writable" << std::endl;
       exit(EXIT_FAILURE);
@@ -633,6 +685,23 @@ Json::Value get_pass_stats(const PassManager& mgr) {
   return all;
 }
 
+Json::Value get_pass_resources(const PassManager& mgr) {
+  Json::Value all(Json::ValueType::arrayValue);
+  for (const auto& pass_info : mgr.get_pass_info()) {
+    const auto& r = pass_info.resources;
+    Json::Value pass;
+    pass["name"] = pass_info.name;
+    pass["wall_time_s"] = r.wall_time_s;
+    pass["cpu_time_s"] = r.cpu_time_s;
+    pass["thread_utilization"] = r.thread_utilization;
+    pass["allocated_bytes_delta"] = (Json::Int64)r.allocated_bytes_delta;
+    pass["vm_rss_after"] = (Json::UInt64)r.vm_rss_after;
+    pass["vm_rss_delta"] = (Json::Int64)r.vm_rss_delta;
+    all.append(pass);
+  }
+  return all;
+}
+
 Json::Value get_pass_hashes(const PassManager& mgr) {
   Json::Value all(Json::ValueType::objectValue);
   auto initial_hash = mgr.get_initial_hash();
@@ -803,11 +872,114 @@ void write_debug_line_mapping(
   ofs << line_out.str();
 }
 
+void write_compact_debug_line_mapping(
+    const std::string& debug_line_map_filename,
+    const std::unordered_map<DexMethod*, uint64_t>& method_to_id,
+    const std::unordered_map<DexCode*, std::vector<DebugLineItem>>&
+        code_debug_lines,
+    DexStoresVector& stores,
+    const std::vector<DexMethod*>& needs_debug_line_mapping) {
+  /*
+   * Binary file format, for symbolication services that look up a few
+   * (method-id, pc) pairs in a large map:
+   * magic number 0xfaceb000 (4 byte)
+   * version number 2 (4 byte)
+   * number (m) of methods that has debug line info (4 byte)
+   * a list (m elements) of, sorted by method-id:
+   *   [ encoded method-id (8 byte), byte offset of the method's entries from
+   *     the start of the entries (4 byte), number of entries (4 byte) ]
+   * the entries of all methods, each as:
+   *   [ uleb128 delta of the memory offset, sleb128 delta of the line ]
+   *   where the deltas are to the previous entry of the same method, or to
+   *   zero for its first entry. Entries are sorted by memory offset.
+   *
+   * So a lookup is a binary search over the fixed-size index, followed by
+   * decoding the entries of a single method.
+   */
+  struct MethodLines {
+    uint64_t method_id;
+    const std::vector<DebugLineItem>* lines;
+    std::string encoded;
+  };
+  std::vector<MethodLines> methods;
+  auto scope = build_class_scope(stores);
+  auto add_method = [&](DexMethod* method) {
+    auto dex_code = method->get_dex_code();
+    if (dex_code == nullptr) {
+      return;
+    }
+    auto it = code_debug_lines.find(dex_code);
+    if (it == code_debug_lines.end()) {
+      return;
+    }
+    methods.push_back({method_to_id.at(method), &it->second, ""});
+  };
+  for (auto* method : needs_debug_line_mapping) {
+    add_method(method);
+  }
+  walk::methods(scope, add_method);
+  std::sort(methods.begin(), methods.end(),
+            [](const MethodLines& a, const MethodLines& b) {
+              return a.method_id < b.method_id;
+            });
+  methods.erase(std::unique(methods.begin(), methods.end(),
+                            [](const MethodLines& a, const MethodLines& b) {
+                              return a.method_id == b.method_id;
+                            }),
+                methods.end());
+
+  std::vector<size_t> indices(methods.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto& m = methods[i];
+        auto lines = *m.lines;
+        std::stable_sort(lines.begin(), lines.end(),
+                         [](const DebugLineItem& a, const DebugLineItem& b) {
+                           return a.offset < b.offset;
+                         });
+        // At most 5 bytes per uleb128 or sleb128.
+        std::vector<uint8_t> buffer(lines.size() * 10);
+        auto* ptr = buffer.data();
+        uint32_t last_offset = 0;
+        uint32_t last_line = 0;
+        for (const auto& item : lines) {
+          ptr = write_uleb128(ptr, item.offset - last_offset);
+          ptr = write_sleb128(ptr, (int32_t)(item.line - last_line));
+          last_offset = item.offset;
+          last_line = item.line;
+        }
+        m.encoded.assign((const char*)buffer.data(), ptr - buffer.data());
+      },
+      indices);
+
+  std::ofstream ofs(debug_line_map_filename.c_str(),
+                    std::ofstream::out | std::ofstream::trunc |
+                        std::ofstream::binary);
+  uint32_t magic = 0xfaceb000; // serves as endianess check
+  ofs.write((const char*)&magic, sizeof(magic));
+  uint32_t version = 2;
+  ofs.write((const char*)&version, sizeof(version));
+  uint32_t num_method = methods.size();
+  ofs.write((const char*)&num_method, sizeof(num_method));
+  uint32_t offset = 0;
+  for (const auto& m : methods) {
+    uint32_t count = m.lines->size();
+    ofs.write((const char*)&m.method_id, sizeof(m.method_id));
+    ofs.write((const char*)&offset, sizeof(offset));
+    ofs.write((const char*)&count, sizeof(count));
+    offset += m.encoded.size();
+  }
+  for (const auto& m : methods) {
+    ofs << m.encoded;
+  }
+}
+
 std::string get_dex_magic(std::vector<std::string>& dex_files) {
   always_assert_log(!dex_files.empty(), "APK contains no dex file\n");
   // Get dex magic from the first dex file since all dex magic
   // should be consistent within one APK.
-  return load_dex_magic_from_dex(dex_files[0].c_str());
+  return redex::load_dex_magic(dex_files[0]);
 }
 
 void dump_keep_reasons(const ConfigFiles& conf,
@@ -872,6 +1044,7 @@ void redex_frontend(ConfigFiles& conf, /* input */
                     DexStoresVector& stores,
                     Json::Value& stats) {
   Timer redex_frontend_timer("Redex_frontend");
+  status_reporter::set_phase("frontend");
 
   g_redex->load_pointers_cache();
 
@@ -916,8 +1089,12 @@ void redex_frontend(ConfigFiles& conf, /* input */
     Timer t("Load classes from dexes");
     dex_stats_t input_totals;
     std::vector<dex_stats_t> input_dexes_stats;
+    // With lazy_code_loading, code is only ballooned into IR when first
+    // accessed, or before the first pass that needs all of it.
+    bool lazy_code_loading = json_config.get("lazy_code_loading", false);
     redex::load_classes_from_dexes_and_metadata(
-        args.dex_files, stores, input_totals, input_dexes_stats);
+        args.dex_files, stores, input_totals, input_dexes_stats,
+        /* balloon */ !lazy_code_loading);
     stats["input_stats"] = get_input_stats(input_totals, input_dexes_stats);
   });
 
@@ -925,13 +1102,22 @@ void redex_frontend(ConfigFiles& conf, /* input */
   args.entry_data["jars"] = Json::arrayValue;
   if (!library_jars.empty()) {
     Timer t("Load library jars");
+    // The classes of each jar are saved to this directory, and loaded from it
+    // in later runs, as long as the jar doesn't change.
+    auto jar_snapshot_dir =
+        json_config.get("library_jar_snapshot_dir", std::string());
+    if (!jar_snapshot_dir.empty()) {
+      boost::filesystem::create_directories(jar_snapshot_dir);
+    }
 
     for (const auto& library_jar : library_jars) {
       TRACE(MAIN, 1, "LIBRARY JAR: %s", library_jar.c_str());
-      if (!load_jar_file(library_jar.c_str(), &external_classes)) {
+      if (!load_jar_file(library_jar.c_str(), &external_classes, nullptr,
+                         jar_snapshot_dir)) {
         // Try again with the basedir
         std::string basedir_path = pg_config.basedirectory + "/" + library_jar;
-        if (!load_jar_file(basedir_path.c_str())) {
+        if (!load_jar_file(basedir_path.c_str(), nullptr, nullptr,
+                           jar_snapshot_dir)) {
           std::cerr << "error: library jar could not be loaded: " << library_jar
                     << std::endl;
           exit(EXIT_FAILURE);
@@ -1012,18 +1198,10 @@ void redex_backend(ConfigFiles& conf,
                    DexStoresVector& stores,
                    Json::Value& stats) {
   Timer redex_backend_timer("Redex_backend");
+  status_reporter::set_phase("backend");
   const RedexOptions& redex_options = manager.get_redex_options();
   const auto& output_dir = conf.get_outdir();
 
-  instruction_lowering::Stats instruction_lowering_stats;
-  {
-    bool lower_with_cfg = true;
-    conf.get_json_config().get("lower_with_cfg", true, lower_with_cfg);
-    Timer t("Instruction lowering");
-    instruction_lowering_stats =
-        instruction_lowering::run(stores, lower_with_cfg);
-  }
-
   TRACE(MAIN, 1, "Writing out new DexClasses...");
   const JsonWrapper& json_config = conf.get_json_config();
 
@@ -1034,6 +1212,13 @@ void redex_backend(ConfigFiles& conf,
     locator_index = new LocatorIndex(make_locator_index(stores));
   }
 
+  auto locator_table = json_config.get("locator_table", std::string());
+  if (!locator_table.empty()) {
+    Timer t("Writing locator table");
+    std::ofstream out(output_dir + "/" + locator_table, std::ios::binary);
+    out << make_locator_table(stores);
+  }
+
   auto disable_method_similarity_order =
       json_config.get("disable_method_similarity_order", false);
 
@@ -1065,6 +1250,58 @@ void redex_backend(ConfigFiles& conf,
   conf.get_json_config().get("symbolicate_detached_methods", false,
                              symbolicate_detached_methods);
 
+  bool write_dexes_in_parallel =
+      json_config.get("write_dexes_in_parallel", false);
+  bool lower_with_cfg = true;
+  json_config.get("lower_with_cfg", true, lower_with_cfg);
+  // Each dex is lowered while the previous one is being written, or each
+  // store when all the dexes of a store are written at once. PostLowering
+  // syncs before any dex is written, and so needs all the code lowered first.
+  bool overlap_lowering_with_writing =
+      post_lowering == nullptr &&
+      json_config.get("overlap_lowering_with_writing", true);
+  std::vector<Scope> lowering_groups;
+  if (overlap_lowering_with_writing) {
+    for (auto& store : stores) {
+      if (write_dexes_in_parallel) {
+        lowering_groups.push_back(build_class_scope(store.get_dexen()));
+        continue;
+      }
+      for (auto& dex : store.get_dexen()) {
+        lowering_groups.push_back(dex);
+      }
+    }
+  } else {
+    lowering_groups.push_back(build_class_scope(stores));
+  }
+
+  instruction_lowering::Stats instruction_lowering_stats;
+  AccumulatingTimer lowering_timer;
+  std::future<instruction_lowering::Stats> lowering;
+  size_t next_lowering_group = 0;
+  auto start_lowering = [&]() {
+    if (next_lowering_group == lowering_groups.size()) {
+      return;
+    }
+    const auto& group = lowering_groups[next_lowering_group++];
+    lowering = std::async(std::launch::async, [&group, &lowering_timer,
+                                               lower_with_cfg]() {
+      auto timer_scope = lowering_timer.scope();
+      return instruction_lowering::run(group, lower_with_cfg);
+    });
+  };
+  // Waits for the current group to be lowered, and starts on the next one.
+  auto finish_lowering = [&]() {
+    if (lowering.valid()) {
+      instruction_lowering_stats += lowering.get();
+    }
+    start_lowering();
+  };
+  start_lowering();
+  if (!overlap_lowering_with_writing) {
+    finish_lowering();
+  }
+
   if (post_lowering) {
     post_lowering->sync();
   }
@@ -1076,7 +1313,41 @@ void redex_backend(ConfigFiles& conf,
   for (size_t store_number = 0; store_number < stores.size(); ++store_number) {
     auto& store = stores[store_number];
     Timer t("Writing optimized dexes");
+    if (write_dexes_in_parallel) {
+      if (overlap_lowering_with_writing) {
+        finish_lowering();
+      }
+      std::vector<std::string> filenames;
+      for (size_t i = 0; i < store.get_dexen().size(); i++) {
+        filenames.push_back(redex::get_dex_output_name(output_dir, store, i));
+      }
+      auto store_dexes_stats = write_store_to_dexes(
+          redex_options,
+          filenames,
+          &store.get_dexen(),
+          locator_index,
+          store_number,
+          conf,
+          pos_mapper.get(),
+          needs_addresses ? &method_to_id : nullptr,
+          needs_addresses ? &code_debug_lines : nullptr,
+          is_iodi(dik) ? &iodi_metadata : nullptr,
+          stores[0].get_dex_magic(),
+          symbolicate_detached_methods ? post_lowering.get() : nullptr,
+          manager.get_redex_options().min_sdk,
+          disable_method_similarity_order);
+      for (auto& this_dex_stats : store_dexes_stats) {
+        output_totals += this_dex_stats;
+        output_dexes_stats.push_back(this_dex_stats);
+        signatures.insert(
+            *reinterpret_cast<uint32_t*>(this_dex_stats.signature));
+      }
+      continue;
+    }
     for (size_t i = 0; i < store.get_dexen().size(); i++) {
+      if (overlap_lowering_with_writing) {
+        finish_lowering();
+      }
       auto this_dex_stats = write_classes_to_dex(
           redex_options,
           redex::get_dex_output_name(output_dir, store, i),
@@ -1100,6 +1371,8 @@ void redex_backend(ConfigFiles& conf,
     }
   }
 
+  Timer::add_timer("Instruction lowering", lowering_timer.get_seconds());
+
   std::vector<DexMethod*> needs_debug_line_mapping;
   if (post_lowering) {
     if (symbolicate_detached_methods) {
@@ -1134,14 +1407,25 @@ void redex_backend(ConfigFiles& conf,
     auto method_move_map =
         conf.metafile(json_config.get("method_move_map", std::string()));
     if (needs_addresses) {
-      write_debug_line_mapping(debug_line_map_filename, method_to_id,
-                               code_debug_lines, stores,
-                               needs_debug_line_mapping);
+      if (json_config.get("compact_debug_line_map", false)) {
+        write_compact_debug_line_mapping(debug_line_map_filename,
+                                         method_to_id, code_debug_lines,
+                                         stores, needs_debug_line_mapping);
+      } else {
+        write_debug_line_mapping(debug_line_map_filename, method_to_id,
+                                 code_debug_lines, stores,
+                                 needs_debug_line_mapping);
+      }
     }
     if (is_iodi(dik)) {
       iodi_metadata.write(iodi_metadata_filename, method_to_id);
     }
     pos_mapper->write_map();
+    {
+      std::ofstream out(conf.metafile(json_config.get(
+          "pass_resources_output", std::string("redex-pass-resources.json"))));
+      out << get_pass_resources(manager);
+    }
     stats["output_stats"] =
         get_output_stats(output_totals, output_dexes_stats, manager,
                          instruction_lowering_stats, pos_mapper.get());
@@ -1236,6 +1520,7 @@ int main(int argc, char* argv[]) {
   double cpu_time_s;
   {
     Timer redex_all_main_timer("redex-all main()");
+    status_reporter::start_from_env();
 
     g_redex = new RedexContext();
 
@@ -1254,6 +1539,18 @@ int main(int argc, char* argv[]) {
     RedexContext::set_record_keep_reasons(
         args.config.get("record_keep_reasons", false).asBool());
 
+    // Before anything runs in parallel: optionally keep all the threads on
+    // the CPUs of one NUMA node, and/or use a fixed number of threads.
+    if (args.config.isMember("numa_node")) {
+      auto node = args.config["numa_node"].asUInt();
+      if (!redex_parallel::bind_to_numa_node(node)) {
+        std::cerr << "Could not bind to NUMA node " << node << std::endl;
+      }
+    }
+    if (auto num_threads = args.config.get("num_threads", 0).asUInt()) {
+      redex_parallel::set_default_num_threads(num_threads);
+    }
+
     slow_invariants_debug =
         args.config.get("slow_invariants_debug", false).asBool();
     cfg::ControlFlowGraph::DEBUG =
@@ -1280,6 +1577,7 @@ int main(int argc, char* argv[]) {
           ScopedCommandProfiling::maybe_from_env("FRONTEND_", "frontend");
       redex_frontend(conf, args, *pg_config, stores, stats);
       conf.parse_global_config();
+      conf.preload(args.redex_options.min_sdk);
     }
 
     // Initialize purity defaults, if set.
@@ -1316,7 +1614,14 @@ int main(int argc, char* argv[]) {
     stats_output_path = conf.metafile(
         args.config.get("stats_output", "redex-stats.txt").asString());
 
-    {
+    // Freeing every interned object takes a while on big apps, and all
+    // outputs are written by now, so with fast_teardown the memory is left
+    // for the OS to reclaim. Leak-checking builds always free it.
+    if (!sanitizers::kIsAsan &&
+        args.config.get("fast_teardown", false).asBool()) {
+      TRACE(MAIN, 1, "Skipping freeing global memory");
+    } else {
+      status_reporter::set_phase("teardown");
       Timer t("Freeing global memory");
       delete g_redex;
     }
@@ -1337,6 +1642,9 @@ int main(int argc, char* argv[]) {
     out << stats;
   }
 
+  chrome_trace::finish();
+  status_reporter::finish();
+
   TRACE(MAIN, 1, "Done.");
   if (traceEnabled(MAIN, 1) || traceEnabled(STATS, 1)) {
     TRACE(STATS, 0, "Memory stats: VmPeak=%s VmHWM=%s",
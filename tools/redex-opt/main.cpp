@@ -22,6 +22,9 @@ struct Arguments {
   std::string input_ir_dir;
   std::string output_ir_dir;
   std::vector<std::string> pass_names;
+  bool resume{false};
+  size_t num_shards{0};
+  std::vector<std::string> merge_ir_dirs;
   RedexOptions redex_options;
   std::string config_file;
   std::vector<std::string> s_args;
@@ -40,6 +43,18 @@ Arguments parse_args(int argc, char* argv[]) {
                      "output dex and IR meta directory");
   desc.add_options()("pass-name,p", po::value<std::vector<std::string>>(),
                      "pass name");
+  desc.add_options()("resume,r",
+                     "run the passes of the config that follow the one "
+                     "redex-all stopped at, instead of --pass-name");
+  desc.add_options()("shards",
+                     po::value<size_t>(),
+                     "split {input-ir} by dex into the given number of "
+                     "intermediate outputs {output-ir}/shard_<i>, for "
+                     "separate runs of class-local passes, and exit");
+  desc.add_options()("merge",
+                     po::value<std::vector<std::string>>(), // Accumulation
+                     "merge the outputs of the runs on the shards of "
+                     "--shards, in shard order, into {output-ir} and exit");
   desc.add_options()("config,c",
                      po::value<std::string>(),
                      "A JSON-formatted config file to replace the one from "
@@ -101,6 +116,30 @@ Arguments parse_args(int argc, char* argv[]) {
     args.pass_names = vm["pass-name"].as<std::vector<std::string>>();
   }
 
+  if (vm.count("resume")) {
+    if (!args.pass_names.empty()) {
+      std::cerr << "--resume and --pass-name are exclusive\n";
+      exit(EXIT_FAILURE);
+    }
+    args.resume = true;
+  }
+
+  if (vm.count("shards")) {
+    args.num_shards = vm["shards"].as<size_t>();
+    if (args.num_shards == 0 || args.input_ir_dir.empty()) {
+      std::cerr << "--shards needs a positive count and an input-ir\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if (vm.count("merge")) {
+    if (args.num_shards != 0) {
+      std::cerr << "--shards and --merge are exclusive\n";
+      exit(EXIT_FAILURE);
+    }
+    args.merge_ir_dirs = vm["merge"].as<std::vector<std::string>>();
+  }
+
   if (vm.count("config")) {
     args.config_file = vm["config"].as<std::string>();
   }
@@ -162,15 +201,28 @@ bool add_value_to_config(Json::Value& config,
  * - redex_options
  * - config
  * - jars
+ * - stop_pass_idx (if written by redex-all --stop-pass/--stop-after-pass)
  */
 Json::Value process_entry_data(const Json::Value& entry_data,
                                const Arguments& args) {
   Json::Value config_data =
       redex::parse_config(entry_data["config"].asString());
+  std::vector<std::string> pass_names = args.pass_names;
+  if (args.resume) {
+    if (!entry_data.isMember("stop_pass_idx")) {
+      std::cerr << "The input IR was not written by redex-all --stop-pass\n";
+      exit(EXIT_FAILURE);
+    }
+    const auto& config_passes = config_data["redex"]["passes"];
+    for (auto i = entry_data["stop_pass_idx"].asUInt();
+         i < config_passes.size(); ++i) {
+      pass_names.push_back(config_passes[i].asString());
+    }
+  }
   // Change passes list in config data.
   config_data["redex"]["passes"] = Json::arrayValue;
   Json::Value& passes_list = config_data["redex"]["passes"];
-  for (const std::string& pass_name : args.pass_names) {
+  for (const std::string& pass_name : pass_names) {
     passes_list.append(pass_name);
   }
   int len = config_data["redex"]["passes"].size();
@@ -203,6 +255,16 @@ int main(int argc, char* argv[]) {
   Timer opt_timer("Redex-opt");
   Arguments args = parse_args(argc, argv);
 
+  if (args.num_shards != 0) {
+    redex::split_intermediate(args.input_ir_dir, args.num_shards,
+                              args.output_ir_dir);
+    return 0;
+  }
+  if (!args.merge_ir_dirs.empty()) {
+    redex::merge_intermediate(args.merge_ir_dirs, args.output_ir_dir);
+    return 0;
+  }
+
   g_redex = new RedexContext();
 
   Json::Value entry_data;
@@ -211,11 +273,15 @@ int main(int argc, char* argv[]) {
 
   redex::load_all_intermediate(args.input_ir_dir, stores, &entry_data);
 
-  // Set input dex magic to the first DexStore from the first dex file
-  if (!stores.empty()) {
-    auto first_dex_path = boost::filesystem::path(args.input_ir_dir) /
-                          entry_data["dex_list"][0]["list"][0].asString();
-    stores[0].set_dex_magic(load_dex_magic_from_dex(first_dex_path.c_str()));
+  // Set input dex magic to the first DexStore from the first dex file, which
+  // may be in a later store for a shard.
+  for (const auto& store_files : entry_data["dex_list"]) {
+    if (!stores.empty() && !store_files["list"].empty()) {
+      auto first_dex_path = boost::filesystem::path(args.input_ir_dir) /
+                            store_files["list"][0].asString();
+      stores[0].set_dex_magic(load_dex_magic_from_dex(first_dex_path.c_str()));
+      break;
+    }
   }
 
   if (!args.config_file.empty()) {
@@ -225,6 +291,10 @@ int main(int argc, char* argv[]) {
   args.redex_options.deserialize(entry_data);
 
   Json::Value config_data = process_entry_data(entry_data, args);
+  if (args.resume) {
+    // All the passes have run on the output.
+    entry_data.removeMember("stop_pass_idx");
+  }
   ConfigFiles conf(config_data, args.output_ir_dir);
 
   const auto& passes = PassRegistry::get().get_passes();
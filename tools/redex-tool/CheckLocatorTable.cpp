@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iostream>
+
+#include <locator.h>
+
+#include "DexClass.h"
+#include "DexLoader.h"
+#include "ReadMaybeMapped.h"
+#include "Tool.h"
+
+/*
+ * This tool checks a locator table written by redex-all with the
+ * `locator_table` option against the dexes of a store: every class of the
+ * dexes must be found in the table, at its store, dex and class index.
+ *
+ *   redex-tool check-locator-table -t locators.bin -s 0 \
+ *       --dex classes.dex classes2.dex ...
+ *
+ * The dexes must be given in the order of the store.
+ */
+namespace {
+
+using facebook::Locator;
+using facebook::LocatorTable;
+
+class CheckLocatorTable : public Tool {
+ public:
+  CheckLocatorTable()
+      : Tool("check-locator-table",
+             "check a locator table against the dexes of a store") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "table,t",
+        po::value<std::string>()->value_name("locators.bin")->required(),
+        "path to the locator table")(
+        "store,s",
+        po::value<uint32_t>()->value_name("0")->default_value(0),
+        "number of the store that the dexes make up")(
+        "dex",
+        po::value<std::vector<std::string>>()->multitoken()->required(),
+        "the dexes of the store, in order");
+  }
+
+  void run(const po::variables_map& options) override {
+    auto strnr = options["store"].as<uint32_t>();
+    const auto& dexes = options["dex"].as<std::vector<std::string>>();
+    size_t checked = 0;
+    size_t mismatches = 0;
+    redex::read_file_with_contents(
+        options["table"].as<std::string>(),
+        [&](const char* data, size_t size) {
+          if (!LocatorTable::isValid(data, size)) {
+            std::cerr << "Not a locator table" << std::endl;
+            exit(EXIT_FAILURE);
+          }
+          for (uint32_t i = 0; i < dexes.size(); ++i) {
+            // Zero is reserved for Android classes
+            uint32_t dexnr = i + 1;
+            auto classes = load_classes_from_dex(dexes[i].c_str(),
+                                                 /* balloon */ false);
+            for (uint32_t clsnr = 0; clsnr < classes.size(); ++clsnr) {
+              const auto* descriptor = classes[clsnr]->get_name()->c_str();
+              Locator locator = LocatorTable::find(data, descriptor);
+              ++checked;
+              if (locator.strnr != strnr || locator.dexnr != dexnr ||
+                  locator.clsnr != clsnr) {
+                std::cerr << descriptor << ": expected (" << strnr << ", "
+                          << dexnr << ", " << clsnr << "), found ("
+                          << locator.strnr << ", " << locator.dexnr << ", "
+                          << locator.clsnr << ")" << std::endl;
+                ++mismatches;
+              }
+            }
+          }
+        });
+    std::cout << "Checked " << checked << " classes, " << mismatches
+              << " mismatch(es)" << std::endl;
+    if (mismatches != 0) {
+      exit(EXIT_FAILURE);
+    }
+  }
+};
+
+static CheckLocatorTable s_tool;
+
+} // namespace
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iostream>
+
+#include "FrameworkApi.h"
+#include "Tool.h"
+
+/*
+ * This tool compiles a framework API file, as generated by
+ * gen_packed_apilevels.py, into the binary database that AndroidSDK maps
+ * instead of parsing the text on every build.
+ */
+namespace {
+
+class CompileFrameworkApi : public Tool {
+ public:
+  CompileFrameworkApi()
+      : Tool("compile-framework-api",
+             "compile a framework API file into a binary database") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "input,i",
+        po::value<std::string>()->value_name("framework_api_25.txt"),
+        "path to the framework API file")(
+        "output,o",
+        po::value<std::string>()->value_name("framework_api_25.bin"),
+        "path to the database to write");
+  }
+
+  void run(const po::variables_map& options) override {
+    if (!options.count("input") || !options.count("output")) {
+      std::cerr << "Both --input and --output are required" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    api::FrameworkApiDatabase::write(options["input"].as<std::string>(),
+                                     options["output"].as<std::string>());
+  }
+};
+
+static CompileFrameworkApi s_tool;
+
+} // namespace
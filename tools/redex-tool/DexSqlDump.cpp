@@ -19,9 +19,21 @@ $ sqlite3 dex.db "SELECT COUNT(*) FROM dex;"   # verify sane-looking value
 $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 <..enter queries..>
 
+For large apps, dump to CSV instead; sqlite imports it much faster than
+the INSERT statements:
+
+$ buck run  //native/redex:redex-tool -- dex-sql-dump  \
+     --apkdir <APKDIR> --dexendir <DEXEN_DIR> \
+     --jars <ANDROID_JAR> --proguard-map <RENAME_MAP> \
+     --format csv --output <DUMP_DIR>
+$ (cd <DUMP_DIR> && sqlite3 ../dex.db < import.sql)
+
 */
 
-#include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem.hpp>
+#include <functional>
+#include <initializer_list>
+#include <numeric>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -34,6 +46,7 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 #include "Show.h"
 #include "Tool.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -42,138 +55,219 @@ static std::unordered_map<DexMethod*, int> method_ids;
 static std::unordered_map<DexField*, int> field_ids;
 static std::unordered_map<DexString*, int> string_ids;
 
-void dump_field_refs(FILE* fdout,
-                     const char* prefix,
-                     DexField* field,
-                     int field_id) {
-  static int next_string_ref = 0;
+enum class DumpFormat {
+  // A script of INSERT statements, to be piped into sqlite3.
+  SQL,
+  // One CSV file per table, plus an import.sql script that creates the
+  // tables and loads the files with sqlite3's .import.
+  CSV,
+};
+
+// The tables of the dump, grouped in the order their rows are written.
+enum Table {
+  STRINGS,
+  CLASSES,
+  FIELDS,
+  METHODS,
+  METHOD_STRING_REFS,
+  METHOD_CLASS_REFS,
+  METHOD_FIELD_REFS,
+  METHOD_METHOD_REFS,
+  FIELD_STRING_REFS,
+  IS_A,
+  NUM_TABLES,
+};
+
+constexpr int FIRST_REF_TABLE = METHOD_STRING_REFS;
+constexpr int NUM_REF_TABLES = IS_A - FIRST_REF_TABLE;
+
+const char* const s_table_names[NUM_TABLES] = {
+    "strings",
+    "classes",
+    "fields",
+    "methods",
+    "method_string_refs",
+    "method_class_refs",
+    "method_field_refs",
+    "method_method_refs",
+    "field_string_refs",
+    "is_a",
+};
+
+struct Value {
+  /* implicit */ Value(int64_t num) : num(num) {}
+  /* implicit */ Value(const char* text) : text(text) {}
+
+  int64_t num{0};
+  const char* text{nullptr};
+};
+
+struct DumpContext {
+  DumpFormat format;
+  std::string table_names[NUM_TABLES];
+
+  DumpContext(DumpFormat format, const std::string& prefix) : format(format) {
+    for (int t = 0; t < NUM_TABLES; ++t) {
+      table_names[t] = prefix + s_table_names[t];
+    }
+  }
+
+  // Appends one row of `table` to `out`. Text is quoted, with embedded
+  // quotes doubled, which is the escaping both SQL and sqlite's CSV import
+  // expect.
+  void row(Table table,
+           std::initializer_list<Value> values,
+           std::string* out) const {
+    char quote = '"';
+    if (format == DumpFormat::SQL) {
+      quote = '\'';
+      *out += "INSERT INTO ";
+      *out += table_names[table];
+      *out += " VALUES (";
+    }
+    bool first = true;
+    for (const auto& value : values) {
+      if (!first) {
+        *out += ',';
+      }
+      first = false;
+      if (value.text == nullptr) {
+        *out += std::to_string(value.num);
+        continue;
+      }
+      *out += quote;
+      for (const char* c = value.text; *c; ++c) {
+        if (*c == quote) {
+          *out += quote;
+        }
+        *out += *c;
+      }
+      *out += quote;
+    }
+    *out += format == DumpFormat::SQL ? ");\n" : "\n";
+  }
+};
+
+// A row of one of the *_refs tables, before its id is known.
+struct RefRow {
+  int owner_id;
+  int ref_id;
+  int opcode;
+};
+
+// Everything dumped for one dex. Ids are assigned serially, in dex order;
+// rows are gathered and formatted for all dexes in parallel.
+struct DexDump {
+  DexClasses* classes;
+  std::string dex_id; // "<store>/<dex_idx>"
+  std::vector<DexString*> strings;
+
+  int first_string_id{0};
+  int first_class_id{0};
+  int first_field_id{0};
+  int first_method_id{0};
+
+  std::vector<RefRow> refs[NUM_REF_TABLES];
+  int first_ref_id[NUM_REF_TABLES] = {};
+
+  std::string rows[NUM_TABLES];
+};
+
+// Returns the part of a deobfuscated member name that follows the class,
+// e.g. ";.foo:()V".
+const char* member_name(const std::string& deobfuscated_name) {
+  auto name = strchr(deobfuscated_name.c_str(), ';');
+  return name ? name : deobfuscated_name.c_str();
+}
+
+void gather_field_refs(DexField* field, int field_id, DexDump* dump) {
   auto* static_value = field->get_static_value();
   if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
   auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
-  auto string_id = string_ids[static_string_value->string()];
-  fprintf(fdout,
-          "INSERT INTO %sfield_string_refs VALUES (%d, %d, %d);\n",
-          prefix,
-          next_string_ref++,
-          field_id,
-          string_id);
+  auto it = string_ids.find(static_string_value->string());
+  if (it == string_ids.end()) return;
+  dump->refs[FIELD_STRING_REFS - FIRST_REF_TABLE].push_back(
+      {field_id, it->second, 0});
 }
 
-void dump_method_refs(FILE* fdout,
-                      const char* prefix,
-                      DexMethod* method,
-                      int method_id) {
+void gather_method_refs(DexMethod* method, int method_id, DexDump* dump) {
   auto code = method->get_code();
   if (!code) return;
 
-  static int next_string_ref = 0;
-  static int next_class_ref = 0;
-  static int next_field_ref = 0;
-  static int next_method_ref = 0;
-
+  auto add = [&](Table table, int ref_id, IROpcode opcode) {
+    dump->refs[table - FIRST_REF_TABLE].push_back({method_id, ref_id, opcode});
+  };
   for (auto& mie : InstructionIterable(code)) {
     auto insn = mie.insn;
     if (insn->has_string()) {
-      if (string_ids.count(insn->get_string())) {
-        auto string_id = string_ids[insn->get_string()];
-        fprintf(fdout,
-                "INSERT INTO %smethod_string_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_string_ref++,
-                method_id,
-                string_id,
-                insn->opcode());
+      auto it = string_ids.find(insn->get_string());
+      if (it != string_ids.end()) {
+        add(METHOD_STRING_REFS, it->second, insn->opcode());
       }
     }
     if (insn->has_type()) {
       auto cls = type_class(insn->get_type());
-      if (cls && class_ids.count(cls)) {
-        auto class_id = class_ids[cls];
-        fprintf(fdout,
-                "INSERT INTO %smethod_class_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_class_ref++,
-                method_id,
-                class_id,
-                insn->opcode());
+      auto it = cls ? class_ids.find(cls) : class_ids.end();
+      if (it != class_ids.end()) {
+        add(METHOD_CLASS_REFS, it->second, insn->opcode());
       }
     }
     if (insn->has_field()) {
       auto field = resolve_field(insn->get_field());
-      if (field != nullptr && field_ids.count(field)) {
-        auto field_id = field_ids[field];
-        fprintf(fdout,
-                "INSERT INTO %smethod_field_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_field_ref++,
-                method_id,
-                field_id,
-                insn->opcode());
+      auto it = field ? field_ids.find(field) : field_ids.end();
+      if (it != field_ids.end()) {
+        add(METHOD_FIELD_REFS, it->second, insn->opcode());
       }
     }
     if (insn->has_method()) {
       auto meth =
           resolve_method(insn->get_method(), opcode_to_search(insn), method);
-      if (meth != nullptr && method_ids.count(meth)) {
-        auto method_ref_id = method_ids[meth];
-        fprintf(fdout,
-                "INSERT INTO %smethod_method_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_method_ref++,
-                method_id,
-                method_ref_id,
-                insn->opcode());
+      auto it = meth ? method_ids.find(meth) : method_ids.end();
+      if (it != method_ids.end()) {
+        add(METHOD_METHOD_REFS, it->second, insn->opcode());
       }
     }
   }
 }
 
-void dump_class(FILE* fdout,
-                const char* prefix,
-                const char* dex_id,
-                DexClass* cls,
-                int class_id) {
-  // TODO: annotations?
-  // TODO: inheritance?
-  // TODO: string usage
-  // TODO: size estimate
-  const auto& deobfuscated_name = cls->get_deobfuscated_name();
-  fprintf(fdout,
-          "INSERT INTO %sclasses VALUES (%d,'%s','%s','%s',%u);\n",
-          prefix,
-          class_id,
-          dex_id,
-          deobfuscated_name.c_str(),
-          cls->get_name()->c_str(),
-          cls->get_access());
+void gather_refs(DexDump* dump) {
+  for (const auto& cls : *dump->classes) {
+    for (const auto& meth : cls->get_dmethods()) {
+      gather_method_refs(meth, method_ids.at(meth), dump);
+    }
+    for (auto& meth : cls->get_vmethods()) {
+      gather_method_refs(meth, method_ids.at(meth), dump);
+    }
+    for (const auto& field : cls->get_sfields()) {
+      gather_field_refs(field, field_ids.at(field), dump);
+    }
+    for (const auto& field : cls->get_ifields()) {
+      gather_field_refs(field, field_ids.at(field), dump);
+    }
+  }
 }
 
-void dump_field(FILE* fdout,
-                const char* prefix,
+void dump_field(const DumpContext& ctx,
                 int class_id,
                 DexField* field,
-                int field_id) {
+                int field_id,
+                std::string* out) {
   // TODO: more fixup here on this crapped up name/signature
   // TODO: break down signature
   // TODO: annotations?
   // TODO: string usage (encoded_value for static fields)
   const auto& deobfuscated_name = field->get_deobfuscated_name();
-  auto field_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %sfields VALUES(%d, %d, '%s', '%s', %u);\n",
-          prefix,
-          field_id,
-          class_id,
-          field_name,
-          field->get_name()->c_str(),
-          field->get_access());
+  ctx.row(FIELDS,
+          {field_id, class_id, member_name(deobfuscated_name),
+           field->get_name()->c_str(), field->get_access()},
+          out);
 }
 
-void dump_method(FILE* fdout,
-                 const char* prefix,
+void dump_method(const DumpContext& ctx,
                  int class_id,
                  DexMethod* method,
-                 int method_id) {
+                 int method_id,
+                 std::string* out) {
   // TODO: more fixup here on this crapped up name/signature
   // TODO: break down signature
   // TODO: throws?
@@ -181,22 +275,92 @@ void dump_method(FILE* fdout,
   // TODO: string usage
   // TODO: size estimate
   auto deobfuscated_name = method->get_deobfuscated_name();
-  auto method_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %smethods VALUES (%d,%d,'%s','%s',%d,%lu);\n",
-          prefix,
-          method_id,
-          class_id,
-          method_name,
-          method->get_name()->c_str(),
-          method->get_access(),
-          method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
+  int64_t code_size =
+      method->get_code() ? method->get_code()->sum_opcode_sizes() : 0;
+  ctx.row(METHODS,
+          {method_id, class_id, member_name(deobfuscated_name),
+           method->get_name()->c_str(), method->get_access(), code_size},
+          out);
 }
 
-void dump_sql(FILE* fdout,
-              DexStoresVector& stores,
-              ProguardMap& pg_map,
-              const char* prefix) {
+void dump_dex(const DumpContext& ctx, DexDump* dump) {
+  int string_id = dump->first_string_id;
+  for (auto dexstr : dump->strings) {
+    ctx.row(STRINGS, {string_id++, dexstr->c_str()}, &dump->rows[STRINGS]);
+  }
+  int class_id = dump->first_class_id;
+  int field_id = dump->first_field_id;
+  int method_id = dump->first_method_id;
+  for (const auto& cls : *dump->classes) {
+    // TODO: annotations?
+    // TODO: inheritance?
+    // TODO: string usage
+    // TODO: size estimate
+    const auto& deobfuscated_name = cls->get_deobfuscated_name();
+    ctx.row(CLASSES,
+            {class_id, dump->dex_id.c_str(), deobfuscated_name.c_str(),
+             cls->get_name()->c_str(), cls->get_access()},
+            &dump->rows[CLASSES]);
+    for (auto field : cls->get_ifields()) {
+      dump_field(ctx, class_id, field, field_id++, &dump->rows[FIELDS]);
+    }
+    for (auto field : cls->get_sfields()) {
+      dump_field(ctx, class_id, field, field_id++, &dump->rows[FIELDS]);
+    }
+    for (const auto& meth : cls->get_dmethods()) {
+      dump_method(ctx, class_id, meth, method_id++, &dump->rows[METHODS]);
+    }
+    for (auto& meth : cls->get_vmethods()) {
+      dump_method(ctx, class_id, meth, method_id++, &dump->rows[METHODS]);
+    }
+    ++class_id;
+  }
+  for (int r = 0; r < NUM_REF_TABLES; ++r) {
+    auto table = (Table)(FIRST_REF_TABLE + r);
+    int ref_id = dump->first_ref_id[r];
+    for (const auto& ref : dump->refs[r]) {
+      if (table == FIELD_STRING_REFS) {
+        ctx.row(table, {ref_id++, ref.owner_id, ref.ref_id},
+                &dump->rows[table]);
+      } else {
+        ctx.row(table, {ref_id++, ref.owner_id, ref.ref_id, ref.opcode},
+                &dump->rows[table]);
+      }
+    }
+    std::vector<RefRow>().swap(dump->refs[r]);
+  }
+}
+
+std::string dump_is_a(const DumpContext& ctx, DexStoresVector& stores) {
+  auto scope = build_class_scope(stores);
+  ClassHierarchy ch = build_type_hierarchy(scope);
+  std::vector<std::vector<std::pair<int, int>>> pairs(scope.size());
+  std::vector<size_t> indices(scope.size());
+  std::iota(indices.begin(), indices.end(), 0);
+  workqueue_run<size_t>(
+      [&](size_t i) {
+        auto cls = scope[i];
+        TypeSet results;
+        get_all_children_or_implementors(ch, scope, cls, results);
+        for (auto type : results) {
+          auto type_cls = type_class(type);
+          if (type_cls) {
+            pairs[i].emplace_back(class_ids.at(type_cls), class_ids.at(cls));
+          }
+        }
+      },
+      indices);
+  std::string out;
+  int next_is_a_id = 0;
+  for (const auto& class_pairs : pairs) {
+    for (const auto& pair : class_pairs) {
+      ctx.row(IS_A, {next_is_a_id++, pair.first, pair.second}, &out);
+    }
+  }
+  return out;
+}
+
+void write_schema(FILE* fdout, const char* prefix) {
   fprintf(fdout,
           R"___(
 DROP TABLE IF EXISTS %1$sfield_string_refs;
@@ -271,113 +435,134 @@ CREATE TABLE %1$smethod_string_refs (
 );
 )___",
           prefix);
-  int next_class_id = 0;
-  int next_method_id = 0;
-  int next_field_id = 0;
-  int next_string_id = 0;
+}
+
+void dump_sql(DumpFormat format,
+              const std::string& output,
+              DexStoresVector& stores,
+              ProguardMap& pg_map,
+              const char* prefix) {
+  DumpContext ctx(format, prefix);
 
-  // Dump all dex items
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  std::vector<DexDump> dumps;
   for (auto& store : stores) {
     auto store_name = store.get_name();
     auto& dexen = store.get_dexen();
     apply_deobfuscated_names(dexen, pg_map);
     for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      GatheredTypes gtypes(&dex);
-      auto strings = gtypes.get_cls_order_dexstring_emitlist();
-      for (auto dexstr : strings) {
-        int id = next_string_id++;
-        string_ids[dexstr] = id;
-        // Escape string before inserting. ' -> ''
-        std::string esc(dexstr->c_str());
-        boost::replace_all(esc, "'", "''");
-        fprintf(fdout,
-                "INSERT INTO %sstrings VALUES(%d, '%s');\n",
-                prefix,
-                id,
-                esc.c_str());
+      DexDump dump;
+      dump.classes = &dexen[dex_idx];
+      dump.dex_id = store_name + "/" + std::to_string(dex_idx);
+      dumps.push_back(std::move(dump));
+    }
+  }
+  auto for_each_dump = [&](const std::function<void(DexDump*)>& fn) {
+    std::vector<DexDump*> items;
+    for (auto& dump : dumps) {
+      items.push_back(&dump);
+    }
+    workqueue_run<DexDump*>(fn, items);
+  };
+
+  for_each_dump([](DexDump* dump) {
+    GatheredTypes gtypes(dump->classes);
+    dump->strings = gtypes.get_cls_order_dexstring_emitlist();
+  });
+
+  // Ids are dense and follow the dex order, as the tables are laid out.
+  int next_class_id = 0;
+  int next_method_id = 0;
+  int next_field_id = 0;
+  int next_string_id = 0;
+  for (auto& dump : dumps) {
+    dump.first_string_id = next_string_id;
+    for (auto dexstr : dump.strings) {
+      string_ids[dexstr] = next_string_id++;
+    }
+    dump.first_class_id = next_class_id;
+    dump.first_field_id = next_field_id;
+    dump.first_method_id = next_method_id;
+    for (const auto& cls : *dump.classes) {
+      class_ids[cls] = next_class_id++;
+      for (auto field : cls->get_ifields()) {
+        field_ids[field] = next_field_id++;
       }
-      std::string dex_id_str(store_name + "/" + std::to_string(dex_idx));
-      const char* dex_id = dex_id_str.c_str();
-      for (const auto& cls : dex) {
-        int class_id = next_class_id++;
-        dump_class(fdout, prefix, dex_id, cls, class_id);
-        class_ids[cls] = class_id;
-        for (auto field : cls->get_ifields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (auto field : cls->get_sfields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
+      for (auto field : cls->get_sfields()) {
+        field_ids[field] = next_field_id++;
+      }
+      for (const auto& meth : cls->get_dmethods()) {
+        method_ids[meth] = next_method_id++;
+      }
+      for (auto& meth : cls->get_vmethods()) {
+        method_ids[meth] = next_method_id++;
       }
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
 
-  // Dump references
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& store : stores) {
-    auto& dexen = store.get_dexen();
-    for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      for (const auto& cls : dex) {
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (const auto& field : cls->get_sfields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
-        for (const auto& field : cls->get_ifields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
-      }
+  for_each_dump(gather_refs);
+  int next_ref_id[NUM_REF_TABLES] = {};
+  for (auto& dump : dumps) {
+    for (int r = 0; r < NUM_REF_TABLES; ++r) {
+      dump.first_ref_id[r] = next_ref_id[r];
+      next_ref_id[r] += dump.refs[r].size();
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+  for_each_dump([&](DexDump* dump) { dump_dex(ctx, dump); });
+  auto is_a_rows = dump_is_a(ctx, stores);
 
-  // Dump hierarchy
-  auto scope = build_class_scope(stores);
-  ClassHierarchy ch = build_type_hierarchy(scope);
-  int next_is_a_id = 0;
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& cls : scope) {
-    TypeSet results;
-    get_all_children_or_implementors(ch, scope, cls, results);
-    for (auto type : results) {
-      auto type_cls = type_class(type);
-      if (type_cls) {
-        fprintf(fdout,
-                "INSERT INTO %sis_a VALUES(%d, %d, %d);\n",
-                prefix,
-                next_is_a_id++,
-                class_ids[type_cls],
-                class_ids[cls]);
+  auto open = [](const std::string& filename) {
+    FILE* fdout = fopen(filename.c_str(), "w");
+    if (!fdout) {
+      fprintf(stderr,
+              "Could not open %s for writing; terminating\n",
+              filename.c_str());
+      exit(EXIT_FAILURE);
+    }
+    return fdout;
+  };
+  auto write_table = [&](FILE* fdout, int table) {
+    if (table == IS_A) {
+      fwrite(is_a_rows.data(), 1, is_a_rows.size(), fdout);
+      return;
+    }
+    for (const auto& dump : dumps) {
+      fwrite(dump.rows[table].data(), 1, dump.rows[table].size(), fdout);
+    }
+  };
+
+  if (format == DumpFormat::SQL) {
+    FILE* fdout = output.empty() ? stdout : open(output);
+    write_schema(fdout, prefix);
+    // Dump all dex items, then the references, then the hierarchy, each in
+    // one transaction.
+    for (auto group : {std::make_pair(0, FIRST_REF_TABLE),
+                       std::make_pair(FIRST_REF_TABLE, (int)IS_A),
+                       std::make_pair((int)IS_A, (int)NUM_TABLES)}) {
+      fprintf(fdout, "BEGIN TRANSACTION;\n");
+      for (int t = group.first; t < group.second; ++t) {
+        write_table(fdout, t);
       }
+      fprintf(fdout, "END TRANSACTION;\n");
     }
+    if (fdout != stdout) {
+      fclose(fdout);
+    }
+    return;
+  }
+
+  boost::filesystem::create_directories(output);
+  FILE* script = open(output + "/import.sql");
+  write_schema(script, prefix);
+  fprintf(script, ".mode csv\n");
+  for (int t = 0; t < NUM_TABLES; ++t) {
+    auto csv = std::string(s_table_names[t]) + ".csv";
+    fprintf(script, ".import %s %s\n", csv.c_str(),
+            ctx.table_names[t].c_str());
+    FILE* fdout = open(output + "/" + csv);
+    write_table(fdout, t);
+    fclose(fdout);
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+  fclose(script);
 }
 
 class DexSqlDump : public Tool {
@@ -394,33 +579,41 @@ class DexSqlDump : public Tool {
         "output,o",
         po::value<std::string>()->value_name("dex.sql"),
         "path to output sql dump file (defaults to "
-        "stdout)")("table-prefix,t",
-                   po::value<std::string>()->value_name("pre_"),
-                   "prefix to use on all table names");
+        "stdout), or output directory with --format csv")(
+        "table-prefix,t",
+        po::value<std::string>()->value_name("pre_"),
+        "prefix to use on all table names")(
+        "format,f",
+        po::value<std::string>()->value_name("sql|csv")->default_value("sql"),
+        "sql writes a script of INSERT statements; csv writes a CSV file "
+        "per table and an import.sql script that loads them with sqlite3's "
+        ".import, which is much faster to import");
   }
 
   void run(const po::variables_map& options) override {
+    const auto& format_name = options["format"].as<std::string>();
+    if (format_name != "sql" && format_name != "csv") {
+      fprintf(stderr, "Unknown format %s; terminating\n", format_name.c_str());
+      exit(EXIT_FAILURE);
+    }
+    auto format = format_name == "sql" ? DumpFormat::SQL : DumpFormat::CSV;
+    std::string output = options.count("output")
+                             ? options["output"].as<std::string>()
+                             : "";
+    if (format == DumpFormat::CSV && output.empty()) {
+      fprintf(stderr, "--format csv needs an --output directory\n");
+      exit(EXIT_FAILURE);
+    }
     auto stores = init(options["jars"].as<std::string>(),
                        options["apkdir"].as<std::string>(),
                        options["dexendir"].as<std::string>());
     ProguardMap pgmap(options.count("proguard-map")
                           ? options["proguard-map"].as<std::string>()
                           : "/dev/null");
-    const std::string& filename = options["output"].as<std::string>();
-    FILE* fdout =
-        options.count("output") ? fopen(filename.c_str(), "w") : stdout;
     std::string prefix = options.count("table-prefix")
                              ? options["table-prefix"].as<std::string>()
                              : "";
-    if (!fdout) {
-      fprintf(stderr,
-              "Could not open %s for writing; terminating\n",
-              filename.c_str());
-      exit(EXIT_FAILURE);
-    }
-    auto* pfx_cstr = prefix.c_str();
-    dump_sql(fdout, stores, pgmap, pfx_cstr);
-    fclose(fdout);
+    dump_sql(format, output, stores, pgmap, prefix.c_str());
   }
 };
 
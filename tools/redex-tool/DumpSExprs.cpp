@@ -27,22 +27,21 @@ void dump_method(const DexMethod* m) {
   std::cout << "(method (" << vshow((uint32_t)m->get_access(), true) << " \""
             << show(m) << "\"";
   if (code == nullptr) {
-    std::cout << " NO CODE" << std::endl;
+    std::cout << " NO CODE\n";
     return;
   }
 
-  std::cout << std::endl
-            << assembler::to_string(code) << std::endl
-            << ")" << std::endl;
+  // Avoid flushing after each line, which dominates the dump of a large app.
+  std::cout << '\n' << assembler::to_string(code) << "\n)\n";
 }
 
 void dump_s_exprs(DexStoresVector& stores) {
   auto scope = build_class_scope(stores);
   for (auto* cls : scope) {
-    std::cout << std::endl << "=== " << show(cls) << " ===" << std::endl;
+    std::cout << "\n=== " << show(cls) << " ===\n";
     auto dump_methods = [](const auto& c) {
       for (auto* m : c) {
-        std::cout << std::endl;
+        std::cout << '\n';
         dump_method(m);
       }
     };
@@ -65,6 +64,7 @@ class DumpSExprs : public Tool {
                        options["apkdir"].as<std::string>(),
                        options["dexendir"].as<std::string>());
     dump_s_exprs(stores);
+    std::cout.flush();
   }
 };
 
@@ -0,0 +1,424 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Debug.h"
+#include "ReadMaybeMapped.h"
+#include "Tool.h"
+
+/*
+ * This tool lists the classes loaded in an Android heap dump, like
+ * tools/hprof/dump_classes_from_hprof.py does, without building a Python
+ * object per heap object: the dump is mapped, and read in a single pass that
+ * skips over the records and the parts of the heap objects it doesn't need.
+ *
+ *   redex-tool hprof-classes --hprof app.hprof > classes.txt
+ *
+ * The classes are printed in load order, one per line, as e.g.
+ *
+ *   com/foo/Bar.class
+ *
+ * With --instances, the tool prints a tab-separated line per class instead,
+ * with the number of its instances (or arrays) in the dump and the bytes of
+ * their fields (or elements), by decreasing size:
+ *
+ *   com/foo/Bar  1234  49360
+ */
+namespace {
+
+// Top-level record tags.
+constexpr uint8_t HPROF_STRING = 0x01;
+constexpr uint8_t HPROF_LOAD_CLASS = 0x02;
+constexpr uint8_t HPROF_HEAP_DUMP = 0x0c;
+constexpr uint8_t HPROF_HEAP_DUMP_SEGMENT = 0x1c;
+
+// Heap dump sub-record tags.
+constexpr uint8_t ROOT_JNI_GLOBAL = 0x01;
+constexpr uint8_t ROOT_JNI_LOCAL = 0x02;
+constexpr uint8_t ROOT_JAVA_FRAME = 0x03;
+constexpr uint8_t ROOT_NATIVE_STACK = 0x04;
+constexpr uint8_t ROOT_STICKY_CLASS = 0x05;
+constexpr uint8_t ROOT_THREAD_BLOCK = 0x06;
+constexpr uint8_t ROOT_MONITOR_USED = 0x07;
+constexpr uint8_t ROOT_THREAD_OBJECT = 0x08;
+constexpr uint8_t CLASS_DUMP = 0x20;
+constexpr uint8_t INSTANCE_DUMP = 0x21;
+constexpr uint8_t OBJECT_ARRAY_DUMP = 0x22;
+constexpr uint8_t PRIMITIVE_ARRAY_DUMP = 0x23;
+constexpr uint8_t ROOT_INTERNED_STRING = 0x89;
+constexpr uint8_t ROOT_FINALIZING = 0x8a;
+constexpr uint8_t ROOT_DEBUGGER = 0x8b;
+constexpr uint8_t ROOT_REFERENCE_CLEANUP = 0x8c;
+constexpr uint8_t ROOT_VM_INTERNAL = 0x8d;
+constexpr uint8_t ROOT_JNI_MONITOR = 0x8e;
+constexpr uint8_t UNREACHABLE = 0x90;
+constexpr uint8_t PRIMITIVE_ARRAY_NODATA_DUMP = 0xc3;
+constexpr uint8_t HEAP_DUMP_INFO = 0xfe;
+constexpr uint8_t ROOT_UNKNOWN = 0xff;
+
+// Basic types of fields and array elements.
+constexpr uint8_t BASIC_OBJECT = 2;
+
+const char* basic_type_name(uint8_t type) {
+  switch (type) {
+  case 4:
+    return "boolean";
+  case 5:
+    return "char";
+  case 6:
+    return "float";
+  case 7:
+    return "double";
+  case 8:
+    return "byte";
+  case 9:
+    return "short";
+  case 10:
+    return "int";
+  case 11:
+    return "long";
+  default:
+    not_reached_log("Unknown basic type %u", type);
+  }
+}
+
+struct InstanceStats {
+  size_t count{0};
+  size_t bytes{0};
+};
+
+class HprofReader {
+ public:
+  HprofReader(const char* data, size_t size)
+      : m_cur(reinterpret_cast<const uint8_t*>(data)),
+        m_end(reinterpret_cast<const uint8_t*>(data) + size) {
+    const auto* nul = static_cast<const uint8_t*>(memchr(m_cur, 0, size));
+    always_assert_log(nul != nullptr, "Truncated hprof header");
+    m_cur = nul + 1;
+    m_id_size = u4();
+    always_assert_log(m_id_size == 4 || m_id_size == 8,
+                      "Unsupported id size %u", m_id_size);
+    skip(8); // timestamp
+  }
+
+  void run() {
+    while (m_cur != m_end) {
+      uint8_t tag = u1();
+      skip(4); // time offset
+      uint32_t length = u4();
+      const uint8_t* record_end = m_cur + length;
+      always_assert_log(record_end <= m_end, "Truncated record");
+      switch (tag) {
+      case HPROF_STRING: {
+        uint64_t string_id = id();
+        m_strings.emplace(string_id,
+                          std::string_view(reinterpret_cast<const char*>(m_cur),
+                                           record_end - m_cur));
+        break;
+      }
+      case HPROF_LOAD_CLASS: {
+        uint32_t serial = u4();
+        uint64_t class_id = id();
+        skip(4); // stack trace serial
+        uint64_t name_id = id();
+        m_load_classes.emplace(class_id, LoadClass{serial, name_id});
+        break;
+      }
+      case HPROF_HEAP_DUMP:
+      case HPROF_HEAP_DUMP_SEGMENT:
+        read_heap_dump(record_end);
+        break;
+      default:
+        break;
+      }
+      m_cur = record_end;
+    }
+  }
+
+  // The dumped classes, in load order.
+  std::vector<std::string> class_list() const {
+    std::vector<std::pair<uint32_t, std::string_view>> classes;
+    for (const auto& entry : m_load_classes) {
+      if (m_dumped_classes.count(entry.first)) {
+        classes.emplace_back(entry.second.serial,
+                             string_at(entry.second.name_id));
+      }
+    }
+    std::sort(classes.begin(), classes.end());
+    std::vector<std::string> names;
+    std::unordered_set<std::string_view> seen;
+    for (const auto& entry : classes) {
+      auto name = entry.second;
+      if (name.size() > 2 && name.substr(name.size() - 2) == "[]") {
+        continue;
+      }
+      if (seen.insert(name).second) {
+        names.push_back(internal_name(name) + ".class");
+      }
+    }
+    return names;
+  }
+
+  std::vector<std::pair<std::string, InstanceStats>> instance_stats() const {
+    std::unordered_map<std::string, InstanceStats> by_name;
+    auto add = [&](const std::string& name, const InstanceStats& stats) {
+      auto& total = by_name[name];
+      total.count += stats.count;
+      total.bytes += stats.bytes;
+    };
+    for (const auto& entry : m_instances) {
+      auto it = m_load_classes.find(entry.first);
+      if (it == m_load_classes.end()) {
+        add("<unknown>", entry.second);
+      } else {
+        add(internal_name(string_at(it->second.name_id)), entry.second);
+      }
+    }
+    for (const auto& entry : m_primitive_arrays) {
+      add(std::string(basic_type_name(entry.first)) + "[]", entry.second);
+    }
+    std::vector<std::pair<std::string, InstanceStats>> result(by_name.begin(),
+                                                              by_name.end());
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+      if (a.second.bytes != b.second.bytes) {
+        return a.second.bytes > b.second.bytes;
+      }
+      return a.first < b.first;
+    });
+    return result;
+  }
+
+ private:
+  struct LoadClass {
+    uint32_t serial;
+    uint64_t name_id;
+  };
+
+  void need(size_t n) const {
+    always_assert_log(static_cast<size_t>(m_end - m_cur) >= n,
+                      "Truncated hprof");
+  }
+
+  void skip(size_t n) {
+    need(n);
+    m_cur += n;
+  }
+
+  uint8_t u1() {
+    need(1);
+    return *m_cur++;
+  }
+
+  uint16_t u2() {
+    need(2);
+    uint16_t v = (m_cur[0] << 8) | m_cur[1];
+    m_cur += 2;
+    return v;
+  }
+
+  uint32_t u4() {
+    need(4);
+    uint32_t v = (uint32_t(m_cur[0]) << 24) | (uint32_t(m_cur[1]) << 16) |
+                 (uint32_t(m_cur[2]) << 8) | uint32_t(m_cur[3]);
+    m_cur += 4;
+    return v;
+  }
+
+  uint64_t id() {
+    if (m_id_size == 4) {
+      return u4();
+    }
+    uint64_t high = u4();
+    return (high << 32) | u4();
+  }
+
+  size_t basic_type_size(uint8_t type) const {
+    switch (type) {
+    case BASIC_OBJECT:
+      return m_id_size;
+    case 4: // boolean
+    case 8: // byte
+      return 1;
+    case 5: // char
+    case 9: // short
+      return 2;
+    case 6: // float
+    case 10: // int
+      return 4;
+    case 7: // double
+    case 11: // long
+      return 8;
+    default:
+      not_reached_log("Unknown basic type %u", type);
+    }
+  }
+
+  std::string_view string_at(uint64_t string_id) const {
+    auto it = m_strings.find(string_id);
+    always_assert_log(it != m_strings.end(), "No string for id %llx",
+                      (unsigned long long)string_id);
+    return it->second;
+  }
+
+  static std::string internal_name(std::string_view name) {
+    std::string result(name);
+    std::replace(result.begin(), result.end(), '.', '/');
+    return result;
+  }
+
+  void read_heap_dump(const uint8_t* end) {
+    while (m_cur < end) {
+      uint8_t tag = u1();
+      switch (tag) {
+      case ROOT_UNKNOWN:
+      case ROOT_STICKY_CLASS:
+      case ROOT_MONITOR_USED:
+      case ROOT_INTERNED_STRING:
+      case ROOT_FINALIZING:
+      case ROOT_DEBUGGER:
+      case ROOT_REFERENCE_CLEANUP:
+      case ROOT_VM_INTERNAL:
+      case UNREACHABLE:
+        skip(m_id_size);
+        break;
+      case ROOT_JNI_GLOBAL:
+        skip(2 * m_id_size);
+        break;
+      case ROOT_JNI_LOCAL:
+      case ROOT_JNI_MONITOR:
+      case ROOT_JAVA_FRAME:
+      case ROOT_THREAD_OBJECT:
+        skip(m_id_size + 8);
+        break;
+      case ROOT_NATIVE_STACK:
+      case ROOT_THREAD_BLOCK:
+        skip(m_id_size + 4);
+        break;
+      case HEAP_DUMP_INFO:
+        skip(4 + m_id_size);
+        break;
+      case CLASS_DUMP:
+        read_class_dump();
+        break;
+      case INSTANCE_DUMP: {
+        skip(m_id_size + 4);
+        uint64_t class_id = id();
+        uint32_t size = u4();
+        skip(size);
+        auto& stats = m_instances[class_id];
+        stats.count++;
+        stats.bytes += size;
+        break;
+      }
+      case OBJECT_ARRAY_DUMP: {
+        skip(m_id_size + 4);
+        uint32_t length = u4();
+        uint64_t class_id = id();
+        skip(size_t(length) * m_id_size);
+        auto& stats = m_instances[class_id];
+        stats.count++;
+        stats.bytes += size_t(length) * m_id_size;
+        break;
+      }
+      case PRIMITIVE_ARRAY_DUMP:
+      case PRIMITIVE_ARRAY_NODATA_DUMP: {
+        skip(m_id_size + 4);
+        uint32_t length = u4();
+        uint8_t type = u1();
+        size_t bytes = size_t(length) * basic_type_size(type);
+        if (tag == PRIMITIVE_ARRAY_DUMP) {
+          skip(bytes);
+        }
+        auto& stats = m_primitive_arrays[type];
+        stats.count++;
+        stats.bytes += bytes;
+        break;
+      }
+      default:
+        not_reached_log("Unknown heap dump tag 0x%x", tag);
+      }
+    }
+  }
+
+  void read_class_dump() {
+    uint64_t class_id = id();
+    // Stack trace serial, then the superclass, class loader, signers,
+    // protection domain and two reserved ids, then the instance size.
+    skip(4 + 6 * m_id_size + 4);
+    uint16_t const_pool_count = u2();
+    for (uint16_t i = 0; i < const_pool_count; ++i) {
+      skip(2);
+      skip(basic_type_size(u1()));
+    }
+    uint16_t static_field_count = u2();
+    for (uint16_t i = 0; i < static_field_count; ++i) {
+      skip(m_id_size);
+      skip(basic_type_size(u1()));
+    }
+    uint16_t instance_field_count = u2();
+    skip(size_t(instance_field_count) * (m_id_size + 1));
+    m_dumped_classes.insert(class_id);
+  }
+
+  const uint8_t* m_cur;
+  const uint8_t* m_end;
+  uint32_t m_id_size;
+  std::unordered_map<uint64_t, std::string_view> m_strings;
+  std::unordered_map<uint64_t, LoadClass> m_load_classes;
+  std::unordered_set<uint64_t> m_dumped_classes;
+  // Keyed by the id of the class of the instances or object arrays.
+  std::unordered_map<uint64_t, InstanceStats> m_instances;
+  // Keyed by the basic type of the elements.
+  std::unordered_map<uint8_t, InstanceStats> m_primitive_arrays;
+};
+
+class HprofClasses : public Tool {
+ public:
+  HprofClasses()
+      : Tool("hprof-classes", "list the classes loaded in a heap dump") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "hprof",
+        po::value<std::string>()->value_name("app.hprof")->required(),
+        "path to the heap dump")(
+        "instances",
+        po::bool_switch(),
+        "print the instance count and bytes of each class instead");
+  }
+
+  void run(const po::variables_map& options) override {
+    redex::read_file_with_contents(
+        options["hprof"].as<std::string>(),
+        [&](const char* data, size_t size) {
+          HprofReader reader(data, size);
+          reader.run();
+          if (options["instances"].as<bool>()) {
+            for (const auto& entry : reader.instance_stats()) {
+              std::cout << entry.first << "\t" << entry.second.count << "\t"
+                        << entry.second.bytes << "\n";
+            }
+          } else {
+            for (const auto& name : reader.class_list()) {
+              std::cout << name << "\n";
+            }
+          }
+        });
+  }
+};
+
+static HprofClasses s_tool;
+
+} // namespace
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+#include "Debug.h"
+#include "Reachability.h"
+#include "ReadMaybeMapped.h"
+#include "Tool.h"
+
+/*
+ * This tool answers questions about the reachability graph that
+ * RemoveUnreachablePass writes when `emit_graph_on_run` is set, straight from
+ * the mapped file, without loading the app or building per-node objects:
+ *
+ *   --why NAME     a shortest chain of retainers from a seed to NAME
+ *   --free NAME    the nodes that would no longer be reachable without NAME
+ *   --search TEXT  the nodes whose name contains TEXT
+ *
+ * Each node is printed on its own line as its type and its name, e.g.
+ *
+ *   METHOD Lcom/foo/Bar;.baz:()V
+ */
+namespace {
+
+using reachability::ReachableObjectType;
+
+const char* type_name(uint8_t type) {
+  switch (static_cast<ReachableObjectType>(type)) {
+  case ReachableObjectType::ANNO:
+    return "ANNO";
+  case ReachableObjectType::CLASS:
+    return "CLASS";
+  case ReachableObjectType::FIELD:
+    return "FIELD";
+  case ReachableObjectType::METHOD:
+    return "METHOD";
+  case ReachableObjectType::SEED:
+    return "SEED";
+  }
+  return "UNKNOWN";
+}
+
+/*
+ * A view of the arrays written by reachability::dump_graph, plus the reverse
+ * of the retainers relation, which the --free query walks.
+ */
+class GraphView {
+ public:
+  GraphView(const char* data, size_t size) : m_cur(data), m_end(data + size) {
+    const auto* header = take<uint32_t>(4);
+    always_assert_log(header[0] == 0xfaceb000, "Magic number mismatch");
+    always_assert_log(header[1] == reachability::GRAPH_FORMAT_VERSION,
+                      "Version mismatch: expected %u, got %u",
+                      reachability::GRAPH_FORMAT_VERSION, header[1]);
+    m_nodes = header[2];
+    uint32_t edges = header[3];
+    m_label_offsets = take<uint64_t>(m_nodes + 1);
+    m_retainer_offsets = take<uint32_t>(m_nodes + 1);
+    m_retainers = take<uint32_t>(edges);
+    m_types = take<uint8_t>(m_nodes);
+    m_labels = take<char>(m_label_offsets[m_nodes]);
+
+    m_retained_offsets.assign(m_nodes + 1, 0);
+    for (uint32_t e = 0; e < edges; ++e) {
+      ++m_retained_offsets[m_retainers[e] + 1];
+    }
+    for (uint32_t i = 0; i < m_nodes; ++i) {
+      m_retained_offsets[i + 1] += m_retained_offsets[i];
+    }
+    m_retained.resize(edges);
+    auto next = m_retained_offsets;
+    for (uint32_t i = 0; i < m_nodes; ++i) {
+      for (const auto* r = retainers_begin(i); r != retainers_end(i); ++r) {
+        m_retained[next[*r]++] = i;
+      }
+    }
+  }
+
+  uint32_t size() const { return m_nodes; }
+
+  uint8_t type(uint32_t node) const { return m_types[node]; }
+
+  std::string_view label(uint32_t node) const {
+    return std::string_view(m_labels + m_label_offsets[node],
+                            m_label_offsets[node + 1] - m_label_offsets[node]);
+  }
+
+  const uint32_t* retainers_begin(uint32_t node) const {
+    return m_retainers + m_retainer_offsets[node];
+  }
+  const uint32_t* retainers_end(uint32_t node) const {
+    return m_retainers + m_retainer_offsets[node + 1];
+  }
+
+  const uint32_t* retained_begin(uint32_t node) const {
+    return m_retained.data() + m_retained_offsets[node];
+  }
+  const uint32_t* retained_end(uint32_t node) const {
+    return m_retained.data() + m_retained_offsets[node + 1];
+  }
+
+  // The nodes are sorted by type, then by label, so the nodes with a given
+  // label are found by a binary search within each type.
+  std::vector<uint32_t> find(std::string_view name) const {
+    std::vector<uint32_t> found;
+    uint32_t type_begin = 0;
+    while (type_begin < m_nodes) {
+      uint8_t t = m_types[type_begin];
+      uint32_t type_end =
+          std::upper_bound(m_types + type_begin, m_types + m_nodes, t) -
+          m_types;
+      uint32_t lo = type_begin;
+      uint32_t hi = type_end;
+      while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (label(mid) < name) {
+          lo = mid + 1;
+        } else {
+          hi = mid;
+        }
+      }
+      for (; lo < type_end && label(lo) == name; ++lo) {
+        found.push_back(lo);
+      }
+      type_begin = type_end;
+    }
+    return found;
+  }
+
+ private:
+  template <class T>
+  const T* take(size_t count) {
+    always_assert_log(reinterpret_cast<uintptr_t>(m_cur) % alignof(T) == 0,
+                      "Misaligned graph array");
+    always_assert_log(static_cast<size_t>(m_end - m_cur) / sizeof(T) >= count,
+                      "Truncated graph");
+    const auto* array = reinterpret_cast<const T*>(m_cur);
+    m_cur += count * sizeof(T);
+    return array;
+  }
+
+  const char* m_cur;
+  const char* m_end;
+  uint32_t m_nodes;
+  const uint64_t* m_label_offsets;
+  const uint32_t* m_retainer_offsets;
+  const uint32_t* m_retainers;
+  const uint8_t* m_types;
+  const char* m_labels;
+  std::vector<uint32_t> m_retained_offsets;
+  std::vector<uint32_t> m_retained;
+};
+
+void print_node(const GraphView& graph, uint32_t node) {
+  std::cout << type_name(graph.type(node)) << " " << graph.label(node)
+            << std::endl;
+}
+
+std::vector<uint32_t> find_or_die(const GraphView& graph,
+                                  const std::string& name) {
+  auto nodes = graph.find(name);
+  if (nodes.empty()) {
+    std::cerr << "No node named " << name << std::endl;
+    exit(EXIT_FAILURE);
+  }
+  return nodes;
+}
+
+// Prints the chain of retainers from the node back to the nearest seed, found
+// by a breadth-first search over the retainers.
+void why(const GraphView& graph, uint32_t target) {
+  constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> retained_by(graph.size(), NONE);
+  std::vector<uint32_t> queue{target};
+  retained_by[target] = target;
+  for (size_t i = 0; i < queue.size(); ++i) {
+    uint32_t node = queue[i];
+    if (graph.type(node) == static_cast<uint8_t>(ReachableObjectType::SEED)) {
+      for (; node != target; node = retained_by[node]) {
+        print_node(graph, node);
+      }
+      print_node(graph, target);
+      return;
+    }
+    for (const auto* r = graph.retainers_begin(node);
+         r != graph.retainers_end(node);
+         ++r) {
+      if (retained_by[*r] == NONE) {
+        retained_by[*r] = node;
+        queue.push_back(*r);
+      }
+    }
+  }
+  std::cout << "Not retained by any seed" << std::endl;
+}
+
+// Marks the nodes reachable from the seeds, without going through the removed
+// nodes.
+std::vector<bool> reachable(const GraphView& graph,
+                            const std::vector<uint32_t>& removed) {
+  std::vector<bool> visited(graph.size());
+  for (auto node : removed) {
+    visited[node] = true;
+  }
+  std::vector<uint32_t> stack;
+  for (uint32_t node = 0; node < graph.size(); ++node) {
+    if (!visited[node] &&
+        graph.type(node) == static_cast<uint8_t>(ReachableObjectType::SEED)) {
+      visited[node] = true;
+      stack.push_back(node);
+    }
+  }
+  while (!stack.empty()) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    for (const auto* s = graph.retained_begin(node);
+         s != graph.retained_end(node);
+         ++s) {
+      if (!visited[*s]) {
+        visited[*s] = true;
+        stack.push_back(*s);
+      }
+    }
+  }
+  for (auto node : removed) {
+    visited[node] = false;
+  }
+  return visited;
+}
+
+// Prints the nodes that are reachable now, but wouldn't be if the given nodes
+// were removed.
+void free_by_removing(const GraphView& graph,
+                      const std::vector<uint32_t>& removed) {
+  auto before = reachable(graph, {});
+  auto after = reachable(graph, removed);
+  size_t count = 0;
+  for (uint32_t node = 0; node < graph.size(); ++node) {
+    if (before[node] && !after[node]) {
+      print_node(graph, node);
+      ++count;
+    }
+  }
+  std::cerr << count << " node(s) freed" << std::endl;
+}
+
+class ReachabilityQuery : public Tool {
+ public:
+  ReachabilityQuery()
+      : Tool("reachability-query",
+             "answer questions about a dumped reachability graph") {}
+
+  void add_options(po::options_description& options) const override {
+    options.add_options()(
+        "graph,g",
+        po::value<std::string>()->value_name("reachability-graph")->required(),
+        "path to a graph written by RemoveUnreachablePass")(
+        "why,w",
+        po::value<std::string>()->value_name("NAME"),
+        "print a chain of retainers from a seed to the node")(
+        "free,f",
+        po::value<std::string>()->value_name("NAME"),
+        "print the nodes that removing the node would free")(
+        "search,s",
+        po::value<std::string>()->value_name("TEXT"),
+        "print the nodes whose name contains the text");
+  }
+
+  void run(const po::variables_map& options) override {
+    redex::read_file_with_contents(
+        options["graph"].as<std::string>(),
+        [&](const char* data, size_t size) {
+          GraphView graph(data, size);
+          if (options.count("why")) {
+            for (auto node :
+                 find_or_die(graph, options["why"].as<std::string>())) {
+              why(graph, node);
+            }
+          }
+          if (options.count("free")) {
+            free_by_removing(
+                graph, find_or_die(graph, options["free"].as<std::string>()));
+          }
+          if (options.count("search")) {
+            const auto& text = options["search"].as<std::string>();
+            for (uint32_t node = 0; node < graph.size(); ++node) {
+              if (graph.label(node).find(text) != std::string_view::npos) {
+                print_node(graph, node);
+              }
+            }
+          }
+        });
+  }
+};
+
+static ReachabilityQuery s_tool;
+
+} // namespace
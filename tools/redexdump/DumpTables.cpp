@@ -17,6 +17,15 @@
 #include <string>
 #include <vector>
 
+static bool matches_filter(ddump_data* rd, uint16_t typeidx) {
+  return class_filter == nullptr ||
+         strstr(dex_string_by_type_idx(rd, typeidx), class_filter) != nullptr;
+}
+
+static bool matches_filter(ddump_data* rd, const dex_class_def* cls_def) {
+  return matches_filter(rd, cls_def->typeidx);
+}
+
 /**
  * Return a proto string in the form
  * [shorty] (argTypes)returnType
@@ -534,28 +543,26 @@ void dump_strings(ddump_data* rd, bool print_headers) {
     redump("\nSTRING IDS TABLE: %d %d\n", size, length);
     redump("%s\n", string_data_header);
   }
-  for (uint32_t i = 0; i < size; ++i) {
-    auto str_data_off = *(uint32_t*)str_id_ptr;
-    str_id_ptr += 4;
-    const uint8_t* str_data_ptr = (uint8_t*)(rd->dexmmap) + str_data_off;
-    dump_string_data_item(&str_data_ptr);
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+      auto str_data_off = ((const uint32_t*)str_id_ptr)[i];
+      const uint8_t* str_data_ptr = (uint8_t*)(rd->dexmmap) + str_data_off;
+      dump_string_data_item(&str_data_ptr);
+    }
+  });
 }
 
 void dump_types(ddump_data* rd) {
   auto offset = rd->dexh->type_ids_off;
   const uint32_t* type_id_ptr = (uint32_t*)(rd->dexmmap + offset);
-  const uint32_t* type_ptr = type_id_ptr;
   auto size = rd->dexh->type_ids_size;
   redump("\nTYPE IDS TABLE: %d\n", size);
   redump("[type_ids_off] type name\n");
-  for (uint32_t i = 0; i < size; ++i) {
-    auto name_off = *(uint32_t*)type_ptr;
-    redump((uint32_t)(type_ptr - type_id_ptr),
-           "%s\n",
-           dex_string_by_idx(rd, name_off));
-    type_ptr++;
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; ++i) {
+      redump(i, "%s\n", dex_string_by_idx(rd, type_id_ptr[i]));
+    }
+  });
 }
 
 void dump_protos(ddump_data* rd, bool print_headers) {
@@ -564,9 +571,11 @@ void dump_protos(ddump_data* rd, bool print_headers) {
     redump("\nPROTO IDS TABLE: %d\n", size);
     redump("[proto_ids_off] shorty proto\n");
   }
-  for (uint32_t i = 0; i < size; i++) {
-    redump(i, "%s\n", get_proto(rd, i).c_str());
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      redump(i, "%s\n", get_proto(rd, i).c_str());
+    }
+  });
 }
 
 void dump_fields(ddump_data* rd, bool print_headers) {
@@ -575,9 +584,13 @@ void dump_fields(ddump_data* rd, bool print_headers) {
     redump("\nFIELD IDS TABLE: %d\n", size);
     redump("[field_ids_off] class type name\n");
   }
-  for (uint32_t i = 0; i < size; i++) {
-    redump(i, "%s\n", get_field(rd, i).c_str());
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      if (matches_filter(rd, rd->dex_field_ids[i].classidx)) {
+        redump(i, "%s\n", get_field(rd, i).c_str());
+      }
+    }
+  });
 }
 
 void dump_methods(ddump_data* rd, bool print_headers) {
@@ -586,9 +599,13 @@ void dump_methods(ddump_data* rd, bool print_headers) {
     redump("\nMETHOD IDS TABLE: %d\n", size);
     redump("[method_ids_off] class name proto_no_shorty\n");
   }
-  for (uint32_t i = 0; i < size; i++) {
-    redump(i, "%s\n", get_method(rd, i).c_str());
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      if (matches_filter(rd, rd->dex_method_ids[i].classidx)) {
+        redump(i, "%s\n", get_method(rd, i).c_str());
+      }
+    }
+  });
 }
 
 void dump_clsdefs(ddump_data* rd, bool print_headers) {
@@ -601,9 +618,13 @@ void dump_clsdefs(ddump_data* rd, bool print_headers) {
         "\t[file: <filename>] [anno: annotation_off] data: class_data_off "
         "[static values: static_value_off]\n");
   }
-  for (uint32_t i = 0; i < size; i++) {
-    redump(i, "%s\n", get_class_def(rd, i).c_str());
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      if (matches_filter(rd, rd->dex_class_defs + i)) {
+        redump(i, "%s\n", get_class_def(rd, i).c_str());
+      }
+    }
+  });
 }
 
 void dump_clsdata(ddump_data* rd, bool print_headers) {
@@ -617,13 +638,17 @@ void dump_clsdata(ddump_data* rd, bool print_headers) {
         "dmethods: <count> followed by dmethods\n"
         "vmethods: <count> followed by vmethods\n");
   }
-  for (uint32_t i = 0; i < size; i++) {
-    const dex_class_def* class_defs =
-        (dex_class_def*)(rd->dexmmap + rd->dexh->class_defs_off) + i;
-    redump(class_defs->class_data_offset,
-           "%s",
-           get_class_data_item(rd, i).c_str());
-  }
+  redump_parallel(size, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      const dex_class_def* class_defs =
+          (dex_class_def*)(rd->dexmmap + rd->dexh->class_defs_off) + i;
+      if (matches_filter(rd, class_defs)) {
+        redump(class_defs->class_data_offset,
+               "%s",
+               get_class_data_item(rd, i).c_str());
+      }
+    }
+  });
 }
 
 void dump_callsites(ddump_data* rd, bool print_headers) {
@@ -696,6 +721,36 @@ static void dump_debug_items(ddump_data* rd,
   }
 }
 
+// Calls `fn` on the code items of the methods of the classes that match the
+// class filter, in class def order.
+template <typename Fn>
+static void for_each_filtered_code_item(ddump_data* rd, const Fn& fn) {
+  for (uint32_t i = 0; i < rd->dexh->class_defs_size; i++) {
+    const dex_class_def* cls_def = rd->dex_class_defs + i;
+    if (!cls_def->class_data_offset || !matches_filter(rd, cls_def)) {
+      continue;
+    }
+    const uint8_t* class_data =
+        reinterpret_cast<const uint8_t*>(rd->dexmmap) +
+        cls_def->class_data_offset;
+    uint32_t sfield_count = read_uleb128(&class_data);
+    uint32_t ifield_count = read_uleb128(&class_data);
+    uint32_t dmethod_count = read_uleb128(&class_data);
+    uint32_t vmethod_count = read_uleb128(&class_data);
+    for (uint32_t j = 0; j < 2 * (sfield_count + ifield_count); j++) {
+      read_uleb128(&class_data);
+    }
+    for (uint32_t j = 0; j < dmethod_count + vmethod_count; j++) {
+      read_uleb128(&class_data); // method_idx_diff
+      read_uleb128(&class_data); // access_flags
+      auto code_off = read_uleb128(&class_data);
+      if (code_off) {
+        fn((dex_code_item*)(rd->dexmmap + code_off));
+      }
+    }
+  }
+}
+
 void dump_code(ddump_data* rd) {
   unsigned count;
   dex_map_item* maps;
@@ -709,6 +764,12 @@ void dump_code(ddump_data* rd) {
       "tries_size: <count>,"
       "debug_info_off: <addr>,"
       "insns_size: <count>\n");
+  if (class_filter != nullptr) {
+    for_each_filtered_code_item(rd, [&](dex_code_item* code_item) {
+      dump_code_items(rd, code_item, 1);
+    });
+    return;
+  }
   for (unsigned i = 0; i < count; i++) {
     if (maps[i].type == TYPE_CODE_ITEM) {
       auto code_items = (dex_code_item*)(rd->dexmmap + maps[i].offset);
@@ -785,15 +846,29 @@ static void dump_class_annotations(ddump_data* rd, dex_class_def* df) {
 }
 
 void dump_anno(ddump_data* rd) {
-  for (uint32_t i = 0; i < rd->dexh->class_defs_size; i++) {
-    dump_class_annotations(rd, &rd->dex_class_defs[i]);
-  }
+  redump_parallel(rd->dexh->class_defs_size,
+                  [&](uint32_t begin, uint32_t end) {
+                    for (uint32_t i = begin; i < end; i++) {
+                      if (matches_filter(rd, rd->dex_class_defs + i)) {
+                        dump_class_annotations(rd, &rd->dex_class_defs[i]);
+                      }
+                    }
+                  });
 }
 
 void dump_debug(ddump_data* rd) {
   unsigned count;
   dex_map_item* maps;
   get_dex_map_items(rd, &count, &maps);
+  if (class_filter != nullptr) {
+    for_each_filtered_code_item(rd, [&](dex_code_item* code_item) {
+      if (code_item->debug_info_off) {
+        dump_debug_items(
+            rd, (const uint8_t*)(rd->dexmmap + code_item->debug_info_off), 1);
+      }
+    });
+    return;
+  }
   for (unsigned i = 0; i < count; i++) {
     if (maps[i].type == TYPE_DEBUG_INFO_ITEM) {
       auto debug_items = (uint8_t*)(rd->dexmmap + maps[i].offset);
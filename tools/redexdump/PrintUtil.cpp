@@ -6,32 +6,114 @@
  */
 
 #include "PrintUtil.h"
+#include <algorithm>
 #include <cstdarg>
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 bool clean = false;
 bool raw = false;
 bool escape = false;
+const char* class_filter = nullptr;
+unsigned table_jobs = 1;
+
+namespace {
+
+// Ranges smaller than this are not worth a thread.
+constexpr uint32_t kMinItemsPerRange = 1024;
+
+thread_local std::string* t_output = nullptr;
+
+void vredump(const char* format, va_list va) {
+  if (t_output == nullptr) {
+    vprintf(format, va);
+    return;
+  }
+  char buf[256];
+  va_list copy;
+  va_copy(copy, va);
+  int len = vsnprintf(buf, sizeof(buf), format, copy);
+  va_end(copy);
+  if (len < 0) {
+    return;
+  }
+  if ((size_t)len < sizeof(buf)) {
+    t_output->append(buf, len);
+    return;
+  }
+  auto start = t_output->size();
+  t_output->resize(start + len + 1);
+  vsnprintf(&(*t_output)[start], len + 1, format, va);
+  t_output->resize(start + len);
+}
+
+void redump_prefix(const char* format, ...) {
+  va_list va;
+  va_start(va, format);
+  vredump(format, va);
+  va_end(va);
+}
+
+} // namespace
 
 void redump(const char* format, ...) {
   va_list va;
   va_start(va, format);
-  vprintf(format, va);
+  vredump(format, va);
   va_end(va);
 }
 
 void redump(uint32_t off, const char* format, ...) {
   va_list va;
   va_start(va, format);
-  if (!clean) printf("[0x%x] ", off);
-  vprintf(format, va);
+  if (!clean) redump_prefix("[0x%x] ", off);
+  vredump(format, va);
   va_end(va);
 }
 
 void redump(uint32_t pos, uint32_t off, const char* format, ...) {
   va_list va;
   va_start(va, format);
-  if (!clean) printf("(0x%x) [0x%x] ", pos, off);
-  vprintf(format, va);
+  if (!clean) redump_prefix("(0x%x) [0x%x] ", pos, off);
+  vredump(format, va);
   va_end(va);
 }
+
+void redump_str(const std::string& str) {
+  if (t_output == nullptr) {
+    fwrite(str.data(), 1, str.size(), stdout);
+  } else {
+    t_output->append(str);
+  }
+}
+
+RedumpBuffer::RedumpBuffer() : m_previous(t_output) { t_output = &m_buffer; }
+
+RedumpBuffer::~RedumpBuffer() { t_output = m_previous; }
+
+void redump_parallel(uint32_t size,
+                     const std::function<void(uint32_t, uint32_t)>& fn) {
+  uint32_t num_ranges = std::max(
+      1u, std::min<uint32_t>(table_jobs, size / kMinItemsPerRange));
+  if (num_ranges == 1) {
+    fn(0, size);
+    return;
+  }
+  std::vector<std::string> outputs(num_ranges);
+  std::vector<std::thread> threads;
+  threads.reserve(num_ranges);
+  for (uint32_t r = 0; r < num_ranges; ++r) {
+    threads.emplace_back([&, r]() {
+      RedumpBuffer buffer;
+      fn((uint64_t)size * r / num_ranges,
+         (uint64_t)size * (r + 1) / num_ranges);
+      outputs[r] = std::move(buffer.str());
+    });
+  }
+  for (uint32_t r = 0; r < num_ranges; ++r) {
+    threads[r].join();
+    redump_str(outputs[r]);
+    std::string().swap(outputs[r]);
+  }
+}
@@ -7,12 +7,44 @@
 
 #pragma once
 
+#include <functional>
 #include <stdint.h>
+#include <string>
 
 extern bool clean;
 extern bool raw;
 extern bool escape;
+// Only dump the classes whose descriptor contains this, if set.
+extern const char* class_filter;
+// The number of threads over which to spread the items of a table.
+extern unsigned table_jobs;
 
 void redump(const char* format, ...);
 void redump(uint32_t off, const char* format, ...);
 void redump(uint32_t pos, uint32_t off, const char* format, ...);
+void redump_str(const std::string& str);
+
+/*
+ * While alive, captures what redump prints on the current thread, so that
+ * output produced concurrently can be printed in order.
+ */
+class RedumpBuffer {
+ public:
+  RedumpBuffer();
+  ~RedumpBuffer();
+  RedumpBuffer(const RedumpBuffer&) = delete;
+  RedumpBuffer& operator=(const RedumpBuffer&) = delete;
+
+  std::string& str() { return m_buffer; }
+
+ private:
+  std::string m_buffer;
+  std::string* m_previous;
+};
+
+/*
+ * Calls `fn` on consecutive ranges of [0, size), on up to `table_jobs`
+ * threads, and prints what each range redumps in the order of the ranges.
+ */
+void redump_parallel(uint32_t size,
+                     const std::function<void(uint32_t, uint32_t)>& fn);
@@ -6,10 +6,14 @@
  */
 
 #include "RedexDump.h"
+#include <algorithm>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "Formatters.h"
 #include "PrintUtil.h"
@@ -47,10 +51,16 @@ static const char ddump_usage_string[] =
     "printing options:\n"
     "--clean: suppress indices and offsets\n"
     "--no-headers: suppress headers\n"
-    "--raw: print all bytes, even control characters\n";
-
-int main(int argc, char* argv[]) {
+    "--raw: print all bytes, even control characters\n"
+    "--class=<substring>: only print the class defs, class data, code, debug\n"
+    "    info, annotations, fields and methods of the classes whose\n"
+    "    descriptor contains <substring>\n"
+    "\n"
+    "performance options:\n"
+    "-j, --jobs=<n>: dump several dex files, or the items of large tables,\n"
+    "    on <n> threads. The output is the same as with one thread\n";
 
+struct DumpOptions {
   bool all = false;
   bool string = false;
   bool stringdata = false;
@@ -68,6 +78,67 @@ int main(int argc, char* argv[]) {
   bool redexdump_debug = false;
   uint32_t ddebug_offset = 0;
   int no_headers = 0;
+};
+
+static void dump_dex(const char* dexfile, const DumpOptions& o) {
+  ddump_data rd;
+  open_dex_file(dexfile, &rd);
+  if (!o.no_headers) {
+    redump(format_map(&rd).c_str());
+  }
+  if (o.string || o.all) {
+    dump_strings(&rd, !o.no_headers);
+  }
+  if (o.stringdata || o.all) {
+    dump_stringdata(&rd, !o.no_headers);
+  }
+  if (o.type || o.all) {
+    dump_types(&rd);
+  }
+  if (o.proto || o.all) {
+    dump_protos(&rd, !o.no_headers);
+  }
+  if (o.field || o.all) {
+    dump_fields(&rd, !o.no_headers);
+  }
+  if (o.meth || o.all) {
+    dump_methods(&rd, !o.no_headers);
+  }
+  if (o.methodhandle || o.all) {
+    dump_methodhandles(&rd, !o.no_headers);
+  }
+  if (o.callsite || o.all) {
+    dump_callsites(&rd, !o.no_headers);
+  }
+  if (o.clsdef || o.all) {
+    dump_clsdefs(&rd, !o.no_headers);
+  }
+  if (o.clsdata || o.all) {
+    dump_clsdata(&rd, !o.no_headers);
+  }
+  if (o.code || o.all) {
+    dump_code(&rd);
+  }
+  if (o.enarr || o.all) {
+    dump_enarr(&rd);
+  }
+  if (o.anno || o.all) {
+    dump_anno(&rd);
+  }
+
+  if (o.redexdump_debug || o.all) {
+    dump_debug(&rd);
+  }
+  if (o.ddebug_offset != 0) {
+    disassemble_debug(&rd, o.ddebug_offset);
+  }
+  redump("\n");
+}
+
+int main(int argc, char* argv[]) {
+
+  DumpOptions o;
+  unsigned jobs = 1;
 
   char c;
   static const struct option options[] = {
@@ -90,61 +161,69 @@ int main(int argc, char* argv[]) {
       {"clean", no_argument, (int*)&clean, 1},
       {"raw", no_argument, (int*)&raw, 1},
       {"escape", no_argument, (int*)&escape, 1},
-      {"no-headers", no_argument, &no_headers, 1},
+      {"no-headers", no_argument, &o.no_headers, 1},
+      {"class", required_argument, nullptr, 'F'},
+      {"jobs", required_argument, nullptr, 'j'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0},
   };
 
-  while ((c = getopt_long(argc, argv, "asStpfmcCxeAdDh", &options[0],
+  while ((c = getopt_long(argc, argv, "asStpfmcCxeAdDhj:", &options[0],
                           nullptr)) != -1) {
     switch (c) {
     case 'a':
-      all = true;
+      o.all = true;
       break;
     case 's':
-      string = true;
+      o.string = true;
       break;
     case 'S':
-      stringdata = true;
+      o.stringdata = true;
       break;
     case 't':
-      type = true;
+      o.type = true;
       break;
     case 'p':
-      proto = true;
+      o.proto = true;
       break;
     case 'f':
-      field = true;
+      o.field = true;
       break;
     case 'm':
-      meth = true;
+      o.meth = true;
       break;
     case 'H':
-      methodhandle = true;
+      o.methodhandle = true;
       break;
     case 'k':
-      callsite = true;
+      o.callsite = true;
       break;
     case 'c':
-      clsdef = true;
+      o.clsdef = true;
       break;
     case 'C':
-      clsdata = true;
+      o.clsdata = true;
       break;
     case 'x':
-      code = true;
+      o.code = true;
       break;
     case 'e':
-      enarr = true;
+      o.enarr = true;
       break;
     case 'A':
-      anno = true;
+      o.anno = true;
       break;
     case 'd':
-      redexdump_debug = true;
+      o.redexdump_debug = true;
       break;
     case 'D':
-      sscanf(optarg, "%x", &ddebug_offset);
+      sscanf(optarg, "%x", &o.ddebug_offset);
+      break;
+    case 'F':
+      class_filter = optarg;
+      break;
+    case 'j':
+      jobs = std::max(1, atoi(optarg));
       break;
     case 'h':
       puts(ddump_usage_string);
@@ -164,60 +243,32 @@ int main(int argc, char* argv[]) {
     return 1;
   }
 
-  while (optind < argc) {
-    const char* dexfile = argv[optind++];
-    ddump_data rd;
-    open_dex_file(dexfile, &rd);
-    if (!no_headers) {
-      redump(format_map(&rd).c_str());
-    }
-    if (string || all) {
-      dump_strings(&rd, !no_headers);
-    }
-    if (stringdata || all) {
-      dump_stringdata(&rd, !no_headers);
-    }
-    if (type || all) {
-      dump_types(&rd);
-    }
-    if (proto || all) {
-      dump_protos(&rd, !no_headers);
+  std::vector<const char*> dexfiles(argv + optind, argv + argc);
+  // Dex files are dumped in windows of `jobs`, each into its own buffer, and
+  // then printed in order. The remaining threads go to the tables.
+  size_t dex_jobs = std::min<size_t>(jobs, dexfiles.size());
+  table_jobs = std::max<size_t>(1, jobs / dex_jobs);
+  for (size_t start = 0; start < dexfiles.size(); start += dex_jobs) {
+    size_t end = std::min(start + dex_jobs, dexfiles.size());
+    if (end - start == 1) {
+      dump_dex(dexfiles[start], o);
+      fflush(stdout);
+      continue;
     }
-    if (field || all) {
-      dump_fields(&rd, !no_headers);
-    }
-    if (meth || all) {
-      dump_methods(&rd, !no_headers);
-    }
-    if (methodhandle || all) {
-      dump_methodhandles(&rd, !no_headers);
-    }
-    if (callsite || all) {
-      dump_callsites(&rd, !no_headers);
-    }
-    if (clsdef || all) {
-      dump_clsdefs(&rd, !no_headers);
-    }
-    if (clsdata || all) {
-      dump_clsdata(&rd, !no_headers);
-    }
-    if (code || all) {
-      dump_code(&rd);
-    }
-    if (enarr || all) {
-      dump_enarr(&rd);
-    }
-    if (anno || all) {
-      dump_anno(&rd);
-    }
-
-    if (redexdump_debug || all) {
-      dump_debug(&rd);
+    std::vector<std::string> outputs(end - start);
+    std::vector<std::thread> threads;
+    for (size_t i = start; i < end; ++i) {
+      threads.emplace_back([&, i]() {
+        RedumpBuffer buffer;
+        dump_dex(dexfiles[i], o);
+        outputs[i - start] = std::move(buffer.str());
+      });
     }
-    if (ddebug_offset != 0) {
-      disassemble_debug(&rd, ddebug_offset);
+    for (size_t i = start; i < end; ++i) {
+      threads[i - start].join();
+      redump_str(outputs[i - start]);
+      std::string().swap(outputs[i - start]);
     }
-    fprintf(stdout, "\n");
     fflush(stdout);
   }
 
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Generate a large synthetic app, as dex files, to benchmark Redex on inputs of
+a realistic size and shape: deep class hierarchies with virtual overrides,
+interfaces with many implementors, huge generated methods, and many strings.
+
+The Java sources are generated deterministically from the seed, compiled with
+javac, and dexed with d8, which must both be on the PATH (or given with
+--javac and --d8).
+"""
+
+import argparse
+import logging
+import os
+import random
+import shutil
+import subprocess
+import tempfile
+import zipfile
+
+
+PACKAGE = "com.redex.synthetic"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("output", help="Directory to write the dex files to")
+    parser.add_argument("--classes", type=int, default=10000)
+    parser.add_argument(
+        "--depth", type=int, default=6, help="Depth of the class hierarchies"
+    )
+    parser.add_argument("--interfaces", type=int, default=200)
+    parser.add_argument(
+        "--methods-per-class",
+        type=int,
+        default=8,
+        help="Number of virtual methods of each class, at least 1",
+    )
+    parser.add_argument(
+        "--huge-method-ratio",
+        type=float,
+        default=0.01,
+        help="Fraction of the classes with a huge generated method",
+    )
+    parser.add_argument(
+        "--huge-method-cases",
+        type=int,
+        default=500,
+        help="Number of switch cases of each huge method",
+    )
+    parser.add_argument("--strings-per-class", type=int, default=10)
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("--javac", default="javac")
+    parser.add_argument("--d8", default="d8")
+    parser.add_argument("--min-api", type=int, default=21)
+    parser.add_argument(
+        "--keep-sources",
+        action="store_true",
+        help="Also copy the generated Java sources to <output>/src",
+    )
+    args = parser.parse_args()
+    if args.methods_per_class < 1 or args.depth < 1:
+        parser.error("--methods-per-class and --depth must be positive")
+    return args
+
+
+def class_name(hierarchy, level):
+    return f"C{hierarchy}_{level}"
+
+
+def gen_interface(index, methods):
+    lines = [f"package {PACKAGE};", "", f"public interface I{index} {{"]
+    for m in range(methods):
+        lines.append(f"  int i{index}_{m}(int x);")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def gen_huge_method(rng, name, cases, strings):
+    lines = [f"  public static String {name}(int k) {{", "    switch (k) {"]
+    for c in range(cases):
+        s = strings[rng.randrange(len(strings))]
+        lines.append(f"      case {c * 7 + rng.randrange(7)}:")
+        lines.append(f'        return "{s}" + (k * {c + 1});')
+    lines.append("      default:")
+    lines.append("        return null;")
+    lines.append("    }")
+    lines.append("  }")
+    return lines
+
+
+def gen_class(rng, args, hierarchy, level, interfaces):
+    name = class_name(hierarchy, level)
+    extends = f" extends {class_name(hierarchy, level - 1)}" if level > 0 else ""
+    implements = ""
+    if interfaces:
+        implements = " implements " + ", ".join(f"I{i}" for i, _ in interfaces)
+    strings = [
+        f"{name}.str{s}.{rng.randrange(1 << 30):x}"
+        for s in range(args.strings_per_class)
+    ]
+    lines = [
+        f"package {PACKAGE};",
+        "",
+        f"public class {name}{extends}{implements} {{",
+        f'  protected static final String TAG = "{name}";',
+    ]
+    if level == 0:
+        lines.append("  protected int f;")
+    for i, (iface, methods) in enumerate(interfaces):
+        for m in range(methods):
+            lines.append(f"  public int i{iface}_{m}(int x) {{")
+            lines.append(f"    return x * {i + 2} + f + v0(x);")
+            lines.append("  }")
+    for m in range(args.methods_per_class):
+        # Half of the virtual methods override the parent's ones.
+        lines.append(f"  public int v{m}(int x) {{")
+        lines.append("    int r = f;")
+        lines.append(f"    for (int i = 0; i < x % {m + 3}; i++) {{")
+        lines.append(f"      r += i * {rng.randrange(1, 100)} ^ x;")
+        lines.append("      if (r < 0) {")
+        s = strings[rng.randrange(len(strings))]
+        lines.append(f'        throw new IllegalStateException("{s}");')
+        lines.append("      }")
+        lines.append("    }")
+        if level > 0 and m % 2 == 0:
+            lines.append(f"    return r + super.v{m}(x - 1);")
+        else:
+            lines.append("    return r;")
+        lines.append("  }")
+    for s, value in enumerate(strings):
+        lines.append(f"  public static String s{s}() {{")
+        lines.append(f'    return "{value}";')
+        lines.append("  }")
+    if rng.random() < args.huge_method_ratio:
+        lines += gen_huge_method(rng, "huge", args.huge_method_cases, strings)
+    lines.append("}")
+    return name, "\n".join(lines) + "\n"
+
+
+def gen_main(leaves):
+    lines = [
+        f"package {PACKAGE};",
+        "",
+        "public class Main {",
+        "  public static void main(String[] args) {",
+        "    int r = 0;",
+    ]
+    for leaf in leaves:
+        lines.append(f"    r += new {leaf}().v0(args.length);")
+    lines.append("    System.out.println(r);")
+    lines.append("  }")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def generate_sources(args, src_dir):
+    rng = random.Random(args.seed)
+    pkg_dir = os.path.join(src_dir, *PACKAGE.split("."))
+    os.makedirs(pkg_dir)
+
+    def write(name, text):
+        with open(os.path.join(pkg_dir, name + ".java"), "w") as f:
+            f.write(text)
+
+    iface_methods = [rng.randrange(1, 4) for _ in range(args.interfaces)]
+    for i, methods in enumerate(iface_methods):
+        write(f"I{i}", gen_interface(i, methods))
+
+    leaves = []
+    num_hierarchies = max(1, args.classes // args.depth)
+    for h in range(num_hierarchies):
+        for level in range(args.depth):
+            interfaces = []
+            if args.interfaces and rng.random() < 0.3:
+                iface = rng.randrange(args.interfaces)
+                interfaces.append((iface, iface_methods[iface]))
+            name, text = gen_class(rng, args, h, level, interfaces)
+            write(name, text)
+        leaves.append(class_name(h, args.depth - 1))
+    write("Main", gen_main(leaves))
+    return pkg_dir
+
+
+def main():
+    logging.basicConfig(level=logging.INFO)
+    args = parse_args()
+    os.makedirs(args.output, exist_ok=True)
+    with tempfile.TemporaryDirectory() as tmp:
+        src_dir = os.path.join(tmp, "src")
+        pkg_dir = generate_sources(args, src_dir)
+        sources = [os.path.join(pkg_dir, f) for f in sorted(os.listdir(pkg_dir))]
+        logging.info("Generated %d source files", len(sources))
+
+        classes_dir = os.path.join(tmp, "classes")
+        os.makedirs(classes_dir)
+        argfile = os.path.join(tmp, "sources.txt")
+        with open(argfile, "w") as f:
+            f.write("\n".join(sources))
+        subprocess.check_call(
+            [args.javac, "-nowarn", "-source", "8", "-target", "8"]
+            + ["-d", classes_dir, "@" + argfile]
+        )
+
+        jar = os.path.join(tmp, "classes.jar")
+        with zipfile.ZipFile(jar, "w") as z:
+            for root, _, files in os.walk(classes_dir):
+                for name in files:
+                    path = os.path.join(root, name)
+                    z.write(path, os.path.relpath(path, classes_dir))
+        subprocess.check_call(
+            [args.d8, "--release", "--min-api", str(args.min_api)]
+            + ["--output", args.output, jar]
+        )
+        if args.keep_sources:
+            shutil.copytree(src_dir, os.path.join(args.output, "src"))
+    logging.info("Wrote dex files to %s", args.output)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+# Copyright (c) Facebook, Inc. and its affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""
+Run redex-all with a standard pass list over dex files, e.g. the ones of
+gen_synthetic_app.py, and report the wall time, CPU time, thread utilization
+and RSS of every pass from the pass resources that redex-all writes.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+
+DEFAULT_CONFIG = os.path.join(
+    os.path.dirname(os.path.abspath(__file__)), "..", "..", "config", "default.config"
+)
+
+KEEP_RULES = """
+-keep class com.redex.synthetic.Main {
+  public static void main(java.lang.String[]);
+}
+-dontobfuscate
+"""
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("dex_dir", help="Directory with the input dex files")
+    parser.add_argument("--redex-all", default="redex-all")
+    parser.add_argument("--config", default=DEFAULT_CONFIG)
+    parser.add_argument(
+        "--jarpath", help="Library jar, e.g. android.jar", action="append"
+    )
+    parser.add_argument(
+        "--proguard-config", help="Keep rules; by default, keep Main.main"
+    )
+    parser.add_argument("--outdir", help="Output directory; a temporary one if unset")
+    parser.add_argument("--json", help="Also write the results to this file")
+    parser.add_argument(
+        "extra", nargs="*", help="Extra arguments for redex-all, after --"
+    )
+    return parser.parse_args()
+
+
+def run_redex(args, outdir):
+    os.makedirs(os.path.join(outdir, "meta"), exist_ok=True)
+    pg_config = args.proguard_config
+    if pg_config is None:
+        pg_config = os.path.join(outdir, "keep.pro")
+        with open(pg_config, "w") as f:
+            f.write(KEEP_RULES)
+    dexes = sorted(
+        os.path.join(args.dex_dir, f)
+        for f in os.listdir(args.dex_dir)
+        if f.endswith(".dex")
+    )
+    cmd = [args.redex_all, "--config", args.config, "--outdir", outdir]
+    cmd += ["--proguard-config", pg_config]
+    for jar in args.jarpath or []:
+        cmd += ["--jarpath", jar]
+    cmd += args.extra + dexes
+    start = time.time()
+    subprocess.check_call(cmd)
+    return time.time() - start
+
+
+def load_resources(outdir):
+    with open(os.path.join(outdir, "meta", "redex-pass-resources.json")) as f:
+        return json.load(f)
+
+
+def print_table(resources, total_s):
+    header = f"{'pass':<48} {'wall s':>8} {'cpu s':>8} {'util':>5} {'rss MB':>8}"
+    print(header)
+    print("-" * len(header))
+    for r in resources:
+        print(
+            f"{r['name']:<48} {r['wall_time_s']:>8.2f} {r['cpu_time_s']:>8.2f} "
+            f"{r['thread_utilization']:>5.2f} {r['vm_rss_after'] / 2**20:>8.0f}"
+        )
+    passes_s = sum(r["wall_time_s"] for r in resources)
+    print("-" * len(header))
+    print(f"{'passes':<48} {passes_s:>8.2f}")
+    print(f"{'redex-all':<48} {total_s:>8.2f}")
+    peak = max((r["vm_rss_after"] for r in resources), default=0)
+    print(f"{'peak rss after a pass, MB':<48} {peak / 2**20:>8.0f}")
+
+
+def main():
+    args = parse_args()
+    with tempfile.TemporaryDirectory() as tmp:
+        outdir = args.outdir or tmp
+        total_s = run_redex(args, outdir)
+        resources = load_resources(outdir)
+    print_table(resources, total_s)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({"total_s": total_s, "passes": resources}, f, indent=2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -10,6 +10,7 @@
 #endif
 
 #include "Debug.h"
+#include "JemallocUtil.h"
 
 extern "C" {
 
@@ -43,4 +44,30 @@ void enable_profiling() { set_profile_active(true); }
 
 void disable_profiling() { set_profile_active(false); }
 
+uint64_t get_allocated_bytes() {
+  if (mallctl == nullptr) {
+    return 0;
+  }
+  // Statistics are only refreshed when the epoch is advanced.
+  uint64_t epoch = 1;
+  size_t size = sizeof(epoch);
+  if (mallctl("epoch", &epoch, &size, &epoch, size) != 0) {
+    return 0;
+  }
+  size_t allocated = 0;
+  size = sizeof(allocated);
+  if (mallctl("stats.allocated", &allocated, &size, nullptr, 0) != 0) {
+    return 0;
+  }
+  return allocated;
+}
+
+void purge_arenas() {
+  if (mallctl == nullptr) {
+    return;
+  }
+  // 4096 is MALLCTL_ARENAS_ALL.
+  mallctl("arena.4096.purge", nullptr, nullptr, nullptr, 0);
+}
+
 } // namespace jemalloc_util
@@ -5,6 +5,7 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cstdint>
 #include <cstdio>
 
 namespace jemalloc_util {
@@ -13,6 +14,14 @@ void enable_profiling();
 
 void disable_profiling();
 
+// The number of bytes currently allocated by the application, as reported by
+// jemalloc's "stats.allocated". Returns 0 if jemalloc is not in use.
+uint64_t get_allocated_bytes();
+
+// Returns the unused dirty pages of all arenas to the OS. Does nothing if
+// jemalloc is not in use.
+void purge_arenas();
+
 class ScopedProfiling final {
  public:
   explicit ScopedProfiling(bool enable) {
@@ -7,15 +7,21 @@
 
 #pragma once
 
+#include <algorithm>
 #include <functional>
-#include <map>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 /*
  * Collection type that maintains a set of elements with associated
  * priorities, allowing updating priorities, and enabling efficient
  * retrieval of the element with the highest priority.
  *
+ * The elements are kept in an implicit d-ary heap, whose nodes have `Arity`
+ * children that are adjacent in memory, so that a sift takes fewer levels and
+ * fewer cache misses than with a binary heap.
+ *
  * Limitations:
  * - The same value cannot be present twice (even with a different priority)
  * - No two values can exist in the queue with the same priority at the same
@@ -23,47 +29,151 @@
  */
 template <class Value,
           class Priority,
-          class PriorityCompare = std::less<Priority>>
+          class PriorityCompare = std::less<Priority>,
+          size_t Arity = 4>
 class MutablePriorityQueue {
+  static_assert(Arity >= 2, "A heap node needs at least two children");
+
  private:
-  std::map<Priority, Value, PriorityCompare> m_values;
-  std::unordered_map<Value, Priority> m_priorities;
+  struct Entry {
+    Priority priority;
+    Value value;
+  };
+
+  std::vector<Entry> m_heap;
+  std::unordered_map<Value, size_t> m_indices;
+  PriorityCompare m_compare;
+
+  bool higher(const Priority& a, const Priority& b) const {
+    return m_compare(b, a);
+  }
+
+  void place(size_t index, Entry entry) {
+    m_indices[entry.value] = index;
+    m_heap[index] = std::move(entry);
+  }
+
+  void sift_up(size_t index) {
+    Entry entry = std::move(m_heap[index]);
+    while (index > 0) {
+      size_t parent = (index - 1) / Arity;
+      if (!higher(entry.priority, m_heap[parent].priority)) {
+        break;
+      }
+      place(index, std::move(m_heap[parent]));
+      index = parent;
+    }
+    place(index, std::move(entry));
+  }
+
+  void sift_down(size_t index) {
+    Entry entry = std::move(m_heap[index]);
+    const size_t size = m_heap.size();
+    for (;;) {
+      size_t first_child = index * Arity + 1;
+      if (first_child >= size) {
+        break;
+      }
+      size_t end_child = std::min(first_child + Arity, size);
+      size_t best_child = first_child;
+      for (size_t child = first_child + 1; child < end_child; ++child) {
+        if (higher(m_heap[child].priority, m_heap[best_child].priority)) {
+          best_child = child;
+        }
+      }
+      if (!higher(m_heap[best_child].priority, entry.priority)) {
+        break;
+      }
+      place(index, std::move(m_heap[best_child]));
+      index = best_child;
+    }
+    place(index, std::move(entry));
+  }
+
+  // Restores the heap property after the priority at the given index changed.
+  void fix(size_t index) {
+    if (index > 0 &&
+        higher(m_heap[index].priority, m_heap[(index - 1) / Arity].priority)) {
+      sift_up(index);
+    } else {
+      sift_down(index);
+    }
+  }
+
+  size_t index_of(const Value& value) const {
+    auto it = m_indices.find(value);
+    always_assert(it != m_indices.end());
+    return it->second;
+  }
 
  public:
   // Inserts a value with a priority; neither value or priority can already be
   // present.
   void insert(const Value& value, const Priority& priority) {
-    auto map_result = m_values.insert({priority, value});
-    always_assert(map_result.second);
-    auto priorities_result = m_priorities.insert({value, priority});
-    always_assert(priorities_result.second);
+    auto indices_result = m_indices.emplace(value, m_heap.size());
+    always_assert(indices_result.second);
+    m_heap.push_back({priority, value});
+    sift_up(m_heap.size() - 1);
   }
 
   // Erases a value that's currently in the queue.
   void erase(const Value& value) {
-    auto old_priority_it = m_priorities.find(value);
-    always_assert(old_priority_it != m_priorities.end());
-    const auto erased = m_values.erase(old_priority_it->second);
-    always_assert(erased);
-    m_priorities.erase(old_priority_it);
+    auto it = m_indices.find(value);
+    always_assert(it != m_indices.end());
+    size_t index = it->second;
+    m_indices.erase(it);
+    if (index + 1 == m_heap.size()) {
+      m_heap.pop_back();
+      return;
+    }
+    place(index, std::move(m_heap.back()));
+    m_heap.pop_back();
+    fix(index);
   }
 
   // Changes the priority of a value. The value must already be in the queue.
   // No current queue element may already have the new priority.
   void update_priority(const Value& value, const Priority& priority) {
-    erase(value);
-    insert(value, priority);
+    size_t index = index_of(value);
+    m_heap[index].priority = priority;
+    fix(index);
+  }
+
+  // Changes the priorities of many distinct values at once, with the same
+  // requirements as update_priority. When the batch covers a sizable part of
+  // the queue, rebuilding the heap in linear time is cheaper than sifting
+  // each value into place.
+  void update_priorities(
+      const std::vector<std::pair<Value, Priority>>& updates) {
+    if (updates.size() * 8 < m_heap.size()) {
+      for (auto& p : updates) {
+        update_priority(p.first, p.second);
+      }
+      return;
+    }
+    for (auto& p : updates) {
+      m_heap[index_of(p.first)].priority = p.second;
+    }
+    if (m_heap.size() < 2) {
+      return;
+    }
+    // Sift down all inner nodes, starting with the last one.
+    for (size_t index = (m_heap.size() - 2) / Arity + 1; index-- > 0;) {
+      sift_down(index);
+    }
   }
 
   // Removes all elements.
   void clear() {
-    m_values.clear();
-    m_priorities.clear();
+    m_heap.clear();
+    m_indices.clear();
   }
 
   // Checks if queue is empty.
-  bool empty() const { return m_values.empty(); }
+  bool empty() const { return m_heap.empty(); }
+
+  size_t size() const { return m_heap.size(); }
 
   // Returns element with highest priority.
-  Value front() const { return m_values.rbegin()->second; }
+  Value front() const { return m_heap.front().value; }
 };